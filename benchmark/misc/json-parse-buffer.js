@@ -0,0 +1,52 @@
+'use strict';
+
+// Compares parsing a JSON request body that arrives as a Buffer with
+// JSON.parse(buf.toString()) against the simdjson-based parser of the json
+// binding, which builds the values straight from the bytes.
+
+const common = require('../common.js');
+
+const bench = common.createBenchmark(main, {
+  method: ['JSON.parse', 'parse', 'parseFields'],
+  size: [16, 1024],
+  n: [1e3],
+}, {
+  flags: ['--expose-internals'],
+});
+
+function makeBody(size) {
+  const items = [];
+  for (let i = 0; i < size; i++) {
+    items.push({
+      id: i,
+      name: `item-${i}`,
+      price: i * 1.25,
+      tags: ['a', 'b', 'c'],
+      available: i % 2 === 0,
+    });
+  }
+  return Buffer.from(JSON.stringify({ user: { id: 42 }, items }));
+}
+
+function main({ method, size, n }) {
+  const { internalBinding } = require('internal/test/binding');
+  const { parse, parseFields } = internalBinding('json');
+  const body = makeBody(size);
+  const pointers = ['/user/id', '/items/0/name'];
+  let result;
+
+  bench.start();
+  switch (method) {
+    case 'JSON.parse':
+      for (let i = 0; i < n; i++) result = JSON.parse(body.toString());
+      break;
+    case 'parse':
+      for (let i = 0; i < n; i++) result = parse(body);
+      break;
+    case 'parseFields':
+      for (let i = 0; i < n; i++) result = parseFields(body, pointers);
+      break;
+  }
+  bench.end(n);
+  return result;
+}
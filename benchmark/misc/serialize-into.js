@@ -0,0 +1,45 @@
+'use strict';
+
+// Compares encoding small cache entries with v8.serialize(), which allocates
+// a new Buffer per value, against reusing one serializer with releaseInto()
+// and the one-shot serializeInto() of the serdes binding, which both write
+// into a preallocated buffer.
+
+const common = require('../common.js');
+
+const bench = common.createBenchmark(main, {
+  method: ['v8.serialize', 'releaseInto', 'serializeInto'],
+  n: [1e5],
+}, {
+  flags: ['--expose-internals'],
+});
+
+function main({ method, n }) {
+  const v8 = require('v8');
+  const { internalBinding } = require('internal/test/binding');
+  const { Serializer, serializeInto } = internalBinding('serdes');
+  const value = { id: 42, name: 'entry', tags: ['a', 'b'], ttl: 60.5 };
+  const target = Buffer.allocUnsafe(4096);
+  const serializer = new Serializer();
+  serializer._getDataCloneError = Error;
+  let size = 0;
+
+  bench.start();
+  switch (method) {
+    case 'v8.serialize':
+      for (let i = 0; i < n; i++) size += v8.serialize(value).length;
+      break;
+    case 'releaseInto':
+      for (let i = 0; i < n; i++) {
+        serializer.writeHeader();
+        serializer.writeValue(value);
+        size += serializer.releaseInto(target, 0);
+      }
+      break;
+    case 'serializeInto':
+      for (let i = 0; i < n; i++) size += serializeInto(value, target, 0);
+      break;
+  }
+  bench.end(n);
+  return size;
+}
@@ -0,0 +1,42 @@
+'use strict';
+
+// Compares sampling CPU time with process.cpuUsage(), which allocates a
+// result object per call, against the fast methods of the process binding,
+// which write into its preallocated resourceUsageBuffer.
+
+const common = require('../common.js');
+
+const bench = common.createBenchmark(main, {
+  method: ['process.cpuUsage', 'threadCpuUsage', 'sampleResourceUsage'],
+  n: [1e6],
+}, {
+  flags: ['--expose-internals'],
+});
+
+function main({ method, n }) {
+  const { internalBinding } = require('internal/test/binding');
+  const binding = internalBinding('process_methods');
+  const { resourceUsageBuffer } = binding;
+  let sum = 0;
+
+  bench.start();
+  switch (method) {
+    case 'process.cpuUsage':
+      for (let i = 0; i < n; i++) sum += process.cpuUsage().user;
+      break;
+    case 'threadCpuUsage':
+      for (let i = 0; i < n; i++) {
+        binding.threadCpuUsage();
+        sum += resourceUsageBuffer[0];
+      }
+      break;
+    case 'sampleResourceUsage':
+      for (let i = 0; i < n; i++) {
+        binding.sampleResourceUsage();
+        sum += resourceUsageBuffer[0];
+      }
+      break;
+  }
+  bench.end(n);
+  return sum;
+}
@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <node_api.h>
+#include <stdlib.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+typedef struct {
+  napi_async_work work;
+  napi_ref callback;
+} Work;
+
+// Does nothing, so that the benchmark measures the dispatch to the
+// threadpool and back.
+static void Execute(napi_env env, void* data) {}
+
+static void Complete(napi_env env, napi_status status, void* data) {
+  Work* work = data;
+  napi_value callback;
+  napi_value global;
+
+  assert(status == napi_ok && "work failed");
+  NAPI_CALL(napi_get_reference_value(env, work->callback, &callback));
+  NAPI_CALL(napi_get_global(env, &global));
+  NAPI_CALL(napi_delete_reference(env, work->callback));
+  NAPI_CALL(napi_delete_async_work(env, work->work));
+  free(work);
+  NAPI_CALL(napi_call_function(env, global, callback, 0, NULL, NULL));
+}
+
+// queue(callback): runs an empty work item on the threadpool and calls
+// callback when it completes.
+static napi_value Queue(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value callback;
+  napi_value name;
+  Work* work = malloc(sizeof(*work));
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, &callback, NULL, NULL));
+  NAPI_CALL(napi_create_reference(env, callback, 1, &work->callback));
+  NAPI_CALL(
+      napi_create_string_utf8(env, "benchmark", NAPI_AUTO_LENGTH, &name));
+  NAPI_CALL(napi_create_async_work(
+      env, NULL, name, Execute, Complete, work, &work->work));
+  NAPI_CALL(napi_queue_async_work(env, work->work));
+  return NULL;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "queue", Queue);
+  return exports;
+}
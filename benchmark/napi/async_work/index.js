@@ -0,0 +1,38 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+// With concurrency 1, each work item is queued when the previous one
+// completes, which measures the round trip latency. Higher concurrency
+// measures throughput.
+const bench = common.createBenchmark(main, {
+  concurrency: [1, 16, 128],
+  n: [1e5],
+});
+
+function main({ concurrency, n }) {
+  let queued = 0;
+  let completed = 0;
+
+  function onComplete() {
+    if (++completed === n) {
+      bench.end(n);
+    } else if (queued < n) {
+      queued++;
+      binding.queue(onComplete);
+    }
+  }
+
+  bench.start();
+  for (let i = 0; i < concurrency && queued < n; i++) {
+    queued++;
+    binding.queue(onComplete);
+  }
+}
@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <node_api.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+#define MAX_ARGS 8
+
+// call(n, fn, argc, bench, start, end): calls fn n times from native code
+// with argc arguments.
+static napi_value Call(napi_env env, napi_callback_info info) {
+  size_t argc = 6;
+  napi_value argv[6];
+  uint32_t n;
+  uint32_t fn_argc;
+  uint32_t index;
+  napi_value fn_argv[MAX_ARGS];
+  napi_value recv;
+  napi_handle_scope scope;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_value_uint32(env, argv[0], &n));
+  NAPI_CALL(napi_get_value_uint32(env, argv[2], &fn_argc));
+  assert(fn_argc <= MAX_ARGS && "too many arguments");
+  for (index = 0; index < fn_argc; index++) {
+    NAPI_CALL(napi_create_uint32(env, index, &fn_argv[index]));
+  }
+  NAPI_CALL(napi_get_undefined(env, &recv));
+
+  NAPI_CALL(napi_call_function(env, argv[3], argv[4], 0, NULL, NULL));
+  for (index = 0; index < n; index++) {
+    NAPI_CALL(napi_open_handle_scope(env, &scope));
+    NAPI_CALL(napi_call_function(env, recv, argv[1], fn_argc, fn_argv, NULL));
+    NAPI_CALL(napi_close_handle_scope(env, scope));
+  }
+  NAPI_CALL(napi_call_function(env, argv[3], argv[5], 1, &argv[0], NULL));
+
+  return NULL;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "call", Call);
+  return exports;
+}
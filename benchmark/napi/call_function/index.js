@@ -0,0 +1,25 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+const bench = common.createBenchmark(main, {
+  argc: [0, 2, 8],
+  n: [1e6],
+});
+
+let calls = 0;
+function callee() {
+  calls++;
+}
+
+function main({ argc, n }) {
+  binding.call(n, callee, argc, bench, bench.start, bench.end);
+  if (calls !== n) throw new Error(`Expected ${n} calls, got ${calls}`);
+}
@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <node_api.h>
+#include <stdio.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+#define MAX_PROPERTIES 64
+
+static char names[MAX_PROPERTIES][8];
+
+// create(n, properties, useDefineProperties, bench, start, end): creates n
+// objects with the given number of properties each.
+static napi_value Create(napi_env env, napi_callback_info info) {
+  size_t argc = 6;
+  napi_value argv[6];
+  uint32_t n;
+  uint32_t properties;
+  bool use_define_properties;
+  uint32_t index;
+  uint32_t prop;
+  napi_handle_scope scope;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_value_uint32(env, argv[0], &n));
+  NAPI_CALL(napi_get_value_uint32(env, argv[1], &properties));
+  NAPI_CALL(napi_get_value_bool(env, argv[2], &use_define_properties));
+  assert(properties <= MAX_PROPERTIES && "too many properties");
+
+  napi_value value;
+  NAPI_CALL(napi_create_int32(env, 42, &value));
+  napi_property_descriptor descriptors[MAX_PROPERTIES];
+  for (prop = 0; prop < properties; prop++) {
+    snprintf(names[prop], sizeof(names[prop]), "p%u", prop);
+    napi_property_descriptor descriptor = {
+        names[prop], NULL, NULL, NULL, NULL, value, napi_default_jsproperty,
+        NULL};
+    descriptors[prop] = descriptor;
+  }
+
+  NAPI_CALL(napi_call_function(env, argv[3], argv[4], 0, NULL, NULL));
+  for (index = 0; index < n; index++) {
+    napi_value object;
+    NAPI_CALL(napi_open_handle_scope(env, &scope));
+    NAPI_CALL(napi_create_object(env, &object));
+    if (use_define_properties) {
+      NAPI_CALL(napi_define_properties(env, object, properties, descriptors));
+    } else {
+      for (prop = 0; prop < properties; prop++) {
+        NAPI_CALL(napi_set_named_property(env, object, names[prop], value));
+      }
+    }
+    NAPI_CALL(napi_close_handle_scope(env, scope));
+  }
+  NAPI_CALL(napi_call_function(env, argv[3], argv[5], 1, &argv[0], NULL));
+
+  return NULL;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "create", Create);
+  return exports;
+}
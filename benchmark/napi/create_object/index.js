@@ -0,0 +1,21 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+const bench = common.createBenchmark(main, {
+  method: ['set_named_property', 'define_properties'],
+  properties: [1, 8, 32],
+  n: [1e5],
+});
+
+function main({ method, properties, n }) {
+  binding.create(n, properties, method === 'define_properties',
+                 bench, bench.start, bench.end);
+}
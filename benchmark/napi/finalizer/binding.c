@@ -0,0 +1,68 @@
+#include <assert.h>
+#include <node_api.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+static uint32_t finalized;
+
+static void Finalize(node_api_basic_env env, void* data, void* hint) {
+  finalized++;
+}
+
+// create(n, wrap): creates n objects with a finalizer each, either wrapped or
+// through napi_add_finalizer(), and drops them.
+static napi_value Create(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  uint32_t n;
+  bool wrap;
+  uint32_t index;
+  napi_handle_scope scope;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_value_uint32(env, argv[0], &n));
+  NAPI_CALL(napi_get_value_bool(env, argv[1], &wrap));
+  for (index = 0; index < n; index++) {
+    napi_value object;
+    NAPI_CALL(napi_open_handle_scope(env, &scope));
+    NAPI_CALL(napi_create_object(env, &object));
+    if (wrap) {
+      NAPI_CALL(napi_wrap(env, object, NULL, Finalize, NULL, NULL));
+    } else {
+      NAPI_CALL(napi_add_finalizer(env, object, NULL, Finalize, NULL, NULL));
+    }
+    NAPI_CALL(napi_close_handle_scope(env, scope));
+  }
+  return NULL;
+}
+
+static napi_value GetFinalized(napi_env env, napi_callback_info info) {
+  napi_value result;
+  NAPI_CALL(napi_create_uint32(env, finalized, &result));
+  return result;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "create", Create);
+  EXPORT_FUNC(env, exports, "getFinalized", GetFinalized);
+  return exports;
+}
@@ -0,0 +1,31 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+// Measures creating objects with finalizers, collecting them, and running
+// all of their finalizers.
+const bench = common.createBenchmark(main, {
+  method: ['wrap', 'add_finalizer'],
+  n: [1e5, 1e6],
+}, { flags: ['--expose-gc'] });
+
+function main({ method, n }) {
+  const start = binding.getFinalized();
+  bench.start();
+  binding.create(n, method === 'wrap');
+  (function waitForFinalizers() {
+    globalThis.gc();
+    if (binding.getFinalized() - start >= n) {
+      bench.end(n);
+    } else {
+      setImmediate(waitForFinalizers);
+    }
+  })();
+}
@@ -28,6 +28,8 @@ try {
   process.exit(0);
 }
 const napi = napi_binding.hello;
+// Only present when Node-API supports fast calls.
+const napiFast = napi_binding.fastHello || napi;
 
 let c = 0;
 function js() {
@@ -37,12 +39,17 @@ function js() {
 assert(js() === cxx());
 
 const bench = common.createBenchmark(main, {
-  type: ['js', 'cxx', 'napi'],
+  type: ['js', 'cxx', 'napi', 'napi_fast'],
   n: [1e6, 1e7, 5e7],
 });
 
 function main({ n, type }) {
-  const fn = type === 'cxx' ? cxx : type === 'napi' ? napi : js;
+  const fn = {
+    js,
+    cxx,
+    napi,
+    napi_fast: napiFast,
+  }[type];
   bench.start();
   for (let i = 0; i < n; i++) {
     fn();
@@ -10,6 +10,12 @@ static napi_value Hello(napi_env env, napi_callback_info info) {
   return result;
 }
 
+#ifdef NODE_API_EXPERIMENTAL_HAS_FAST_CALLS
+static int32_t FastHello(napi_value receiver) {
+  return increment++;
+}
+#endif
+
 NAPI_MODULE_INIT() {
   napi_value hello;
   napi_status status =
@@ -22,5 +28,22 @@ NAPI_MODULE_INIT() {
   assert(status == napi_ok);
   status = napi_set_named_property(env, exports, "hello", hello);
   assert(status == napi_ok);
+
+#ifdef NODE_API_EXPERIMENTAL_HAS_FAST_CALLS
+  node_api_fast_call_signature signature = {
+      (const void*)FastHello, node_api_fast_type_int32, 0, NULL};
+  napi_value fast_hello;
+  status = node_api_create_function_with_fast_call(env,
+                                                   "fastHello",
+                                                   NAPI_AUTO_LENGTH,
+                                                   Hello,
+                                                   &signature,
+                                                   NULL,
+                                                   &fast_hello);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, exports, "fastHello", fast_hello);
+  assert(status == napi_ok);
+#endif
+
   return exports;
 }
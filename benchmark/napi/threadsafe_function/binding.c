@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <node_api.h>
+#include <stdlib.h>
+#include <uv.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+#define MAX_PRODUCERS 16
+
+typedef struct {
+  napi_threadsafe_function tsfn;
+  uint32_t items_per_producer;
+  uint32_t producers;
+  uint32_t expected;
+  uint32_t received;
+  bool batching;
+  uv_thread_t threads[MAX_PRODUCERS];
+} Context;
+
+static int item;
+
+static void Produce(void* arg) {
+  Context* context = arg;
+  uint32_t index;
+  for (index = 0; index < context->items_per_producer; index++) {
+    napi_status status = napi_call_threadsafe_function(
+        context->tsfn, &item, napi_tsfn_blocking);
+    assert(status == napi_ok && "napi_call_threadsafe_function failed");
+  }
+  napi_release_threadsafe_function(context->tsfn, napi_tsfn_release);
+}
+
+static void CallJs(napi_env env, napi_value js_cb, void* data, void* items) {
+  Context* context = data;
+  if (env == NULL) return;
+
+#ifdef NODE_API_EXPERIMENTAL_HAS_THREADSAFE_FUNCTION_BATCHING
+  if (context->batching) {
+    context->received += ((node_api_threadsafe_function_batch*)items)->count;
+  } else {
+    context->received++;
+  }
+#else
+  context->received++;
+#endif
+
+  if (context->received == context->expected) {
+    napi_value undefined;
+    NAPI_CALL(napi_get_undefined(env, &undefined));
+    NAPI_CALL(napi_call_function(env, undefined, js_cb, 0, NULL, NULL));
+  }
+}
+
+static void Finalize(napi_env env, void* data, void* hint) {
+  Context* context = data;
+  uint32_t index;
+  for (index = 0; index < context->producers; index++) {
+    uv_thread_join(&context->threads[index]);
+  }
+  free(context);
+}
+
+// run(n, producers, maxQueueSize, batching, done): has each producer thread
+// call a thread-safe function n times, and calls done once all the calls
+// reached the main thread.
+static napi_value Run(napi_env env, napi_callback_info info) {
+  size_t argc = 5;
+  napi_value argv[5];
+  uint32_t max_queue_size;
+  napi_value name;
+  uint32_t index;
+  Context* context = calloc(1, sizeof(*context));
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_value_uint32(env, argv[0], &context->items_per_producer));
+  NAPI_CALL(napi_get_value_uint32(env, argv[1], &context->producers));
+  NAPI_CALL(napi_get_value_uint32(env, argv[2], &max_queue_size));
+  NAPI_CALL(napi_get_value_bool(env, argv[3], &context->batching));
+  assert(context->producers <= MAX_PRODUCERS && "too many producers");
+  context->expected = context->items_per_producer * context->producers;
+
+  NAPI_CALL(
+      napi_create_string_utf8(env, "benchmark", NAPI_AUTO_LENGTH, &name));
+  NAPI_CALL(napi_create_threadsafe_function(env,
+                                            argv[4],
+                                            NULL,
+                                            name,
+                                            max_queue_size,
+                                            context->producers,
+                                            context,
+                                            Finalize,
+                                            context,
+                                            CallJs,
+                                            &context->tsfn));
+#ifdef NODE_API_EXPERIMENTAL_HAS_THREADSAFE_FUNCTION_BATCHING
+  NAPI_CALL(node_api_set_threadsafe_function_batching(
+      env, context->tsfn, context->batching));
+#else
+  context->batching = false;
+#endif
+
+  for (index = 0; index < context->producers; index++) {
+    int err = uv_thread_create(&context->threads[index], Produce, context);
+    assert(err == 0 && "uv_thread_create failed");
+  }
+  return NULL;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "run", Run);
+  return exports;
+}
@@ -0,0 +1,9 @@
+{
+  'targets': [
+    {
+      'target_name': 'binding',
+      'sources': [ 'binding.c' ],
+      'defines': [ 'NAPI_EXPERIMENTAL' ],
+    }
+  ]
+}
@@ -0,0 +1,28 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+// Measures how many calls per second native threads can make into
+// JavaScript through a thread-safe function. Batching has no effect on
+// releases that do not support it.
+const bench = common.createBenchmark(main, {
+  producers: [1, 4],
+  maxQueueSize: [0, 1024],
+  batching: ['false', 'true'],
+  n: [1e6],
+});
+
+function main({ producers, maxQueueSize, batching, n }) {
+  const total = n * producers;
+  bench.start();
+  binding.run(n, producers, maxQueueSize, batching === 'true', () => {
+    bench.end(total);
+  });
+}
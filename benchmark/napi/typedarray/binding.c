@@ -0,0 +1,51 @@
+#include <assert.h>
+#include <node_api.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+// sum(array): returns the sum of the elements of a Float64Array, so that
+// each call pays for napi_get_typedarray_info() and the element access.
+static napi_value Sum(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value array;
+  napi_typedarray_type type;
+  size_t length;
+  void* data;
+  size_t index;
+  double sum = 0;
+  napi_value result;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, &array, NULL, NULL));
+  NAPI_CALL(napi_get_typedarray_info(
+      env, array, &type, &length, &data, NULL, NULL));
+  assert(type == napi_float64_array && "expected a Float64Array");
+  for (index = 0; index < length; index++) {
+    sum += ((double*)data)[index];
+  }
+  NAPI_CALL(napi_create_double(env, sum, &result));
+  return result;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "sum", Sum);
+  return exports;
+}
@@ -0,0 +1,25 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+const bench = common.createBenchmark(main, {
+  length: [4, 256, 16384],
+  n: [1e6],
+});
+
+function main({ length, n }) {
+  const array = new Float64Array(length).fill(1);
+  const sum = binding.sum;
+  bench.start();
+  for (let i = 0; i < n; i++) {
+    sum(array);
+  }
+  bench.end(n);
+}
@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <node_api.h>
+#include <stdlib.h>
+
+#define NAPI_CALL(call)                           \
+  do {                                            \
+    napi_status status = call;                    \
+    assert(status == napi_ok && #call " failed"); \
+  } while (0);
+
+#define EXPORT_FUNC(env, exports, name, func)       \
+  do {                                              \
+    napi_value js_func;                             \
+    NAPI_CALL(napi_create_function((env),           \
+                                  (name),           \
+                                  NAPI_AUTO_LENGTH, \
+                                  (func),           \
+                                  NULL,             \
+                                  &js_func));       \
+    NAPI_CALL(napi_set_named_property((env),        \
+                                     (exports),     \
+                                     (name),        \
+                                     js_func));     \
+  } while (0);
+
+static int native_object;
+
+static void Finalize(node_api_basic_env env, void* data, void* hint) {}
+
+// wrap(objects, bench, start, end): wraps each of the objects.
+static napi_value Wrap(napi_env env, napi_callback_info info) {
+  size_t argc = 4;
+  napi_value argv[4];
+  uint32_t n;
+  uint32_t index;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_array_length(env, argv[0], &n));
+  napi_value* objects = malloc(n * sizeof(*objects));
+  for (index = 0; index < n; index++) {
+    NAPI_CALL(napi_get_element(env, argv[0], index, &objects[index]));
+  }
+
+  napi_value count;
+  NAPI_CALL(napi_create_uint32(env, n, &count));
+  NAPI_CALL(napi_call_function(env, argv[1], argv[2], 0, NULL, NULL));
+  for (index = 0; index < n; index++) {
+    NAPI_CALL(
+        napi_wrap(env, objects[index], &native_object, Finalize, NULL, NULL));
+  }
+  NAPI_CALL(napi_call_function(env, argv[1], argv[3], 1, &count, NULL));
+
+  free(objects);
+  return NULL;
+}
+
+// unwrap(n, bench, start, end): unwraps one object n times.
+static napi_value Unwrap(napi_env env, napi_callback_info info) {
+  size_t argc = 4;
+  napi_value argv[4];
+  uint32_t n;
+  uint32_t index;
+  void* data;
+
+  NAPI_CALL(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(napi_get_value_uint32(env, argv[0], &n));
+  napi_value object;
+  NAPI_CALL(napi_create_object(env, &object));
+  NAPI_CALL(napi_wrap(env, object, &native_object, Finalize, NULL, NULL));
+
+  NAPI_CALL(napi_call_function(env, argv[1], argv[2], 0, NULL, NULL));
+  for (index = 0; index < n; index++) {
+    NAPI_CALL(napi_unwrap(env, object, &data));
+    assert(data == &native_object && "wrong native object");
+  }
+  NAPI_CALL(napi_call_function(env, argv[1], argv[3], 1, &argv[0], NULL));
+
+  return NULL;
+}
+
+NAPI_MODULE_INIT() {
+  EXPORT_FUNC(env, exports, "wrap", Wrap);
+  EXPORT_FUNC(env, exports, "unwrap", Unwrap);
+  return exports;
+}
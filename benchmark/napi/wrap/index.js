@@ -0,0 +1,24 @@
+'use strict';
+const common = require('../../common.js');
+
+let binding;
+try {
+  binding = require(`./build/${common.buildType}/binding`);
+} catch {
+  console.error(`${__filename}: Binding failed to load`);
+  process.exit(0);
+}
+
+const bench = common.createBenchmark(main, {
+  type: ['wrap', 'unwrap'],
+  n: [1e5, 1e6],
+});
+
+function main({ type, n }) {
+  if (type === 'wrap') {
+    const objects = Array.from({ length: n }, () => ({}));
+    binding.wrap(objects, bench, bench.start, bench.end);
+  } else {
+    binding.unwrap(n, bench, bench.start, bench.end);
+  }
+}
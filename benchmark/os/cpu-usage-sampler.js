@@ -0,0 +1,52 @@
+'use strict';
+
+// Compares computing per-core utilization by diffing two os.cpus() calls
+// against the CPUUsageSampler of the os binding, which keeps the previous
+// times natively and writes the deltas into a Float64Array.
+
+const common = require('../common.js');
+const os = require('os');
+
+const bench = common.createBenchmark(main, {
+  method: ['os.cpus', 'CPUUsageSampler'],
+  n: [1e3],
+}, {
+  flags: ['--expose-internals'],
+});
+
+function main({ method, n }) {
+  const { internalBinding } = require('internal/test/binding');
+  const { CPUUsageSampler } = internalBinding('os');
+  let busy = 0;
+
+  switch (method) {
+    case 'os.cpus': {
+      let previous = os.cpus();
+      bench.start();
+      for (let i = 0; i < n; i++) {
+        const current = os.cpus();
+        for (let j = 0; j < current.length; j++) {
+          const now = current[j].times;
+          const before = previous[j].times;
+          busy += (now.user - before.user) + (now.nice - before.nice) +
+                  (now.sys - before.sys) + (now.irq - before.irq);
+        }
+        previous = current;
+      }
+      bench.end(n);
+      break;
+    }
+    case 'CPUUsageSampler': {
+      const sampler = new CPUUsageSampler();
+      const deltas = new Float64Array(os.cpus().length * 2);
+      bench.start();
+      for (let i = 0; i < n; i++) {
+        const count = sampler.sample(deltas);
+        for (let j = 0; j < count; j++) busy += deltas[2 * j];
+      }
+      bench.end(n);
+      break;
+    }
+  }
+  return busy;
+}
@@ -0,0 +1,45 @@
+'use strict';
+
+// Compares the JavaScript posix path functions with the native ones of the
+// internal path binding. The `*Into` variants are V8 fast calls that write
+// the one-byte result into a preallocated buffer.
+
+const common = require('../common.js');
+const { posix } = require('path');
+
+const bench = common.createBenchmark(main, {
+  impl: ['js', 'native', 'native-into'],
+  op: ['normalize', 'resolve', 'relative'],
+  path: [
+    '/foo/bar/baz/../qux/./quux',
+    'foo/bar//baz/asdf/quux/..',
+  ],
+  n: [1e6],
+}, { flags: ['--expose-internals'] });
+
+function main({ impl, op, path, n }) {
+  const { internalBinding } = require('internal/test/binding');
+  const binding = internalBinding('path');
+  const out = new Uint8Array(4096);
+  const to = '/foo/bar/baz/asdf/quux';
+  let fn;
+
+  if (impl === 'js') {
+    if (op === 'relative') fn = () => posix.relative(path, to);
+    else fn = () => posix[op](path);
+  } else if (impl === 'native') {
+    if (op === 'relative') fn = () => binding.relative(path, to);
+    else fn = () => binding[op](path);
+  } else {
+    const into = binding[`${op}Into`];
+    if (op === 'relative') fn = () => into(path, to, out);
+    else fn = () => into(path, out);
+  }
+
+  // Warm up, so that the fast calls get optimized before the measurement.
+  for (let i = 0; i < 1e4; i++) fn();
+
+  bench.start();
+  for (let i = 0; i < n; i++) fn();
+  bench.end(n);
+}
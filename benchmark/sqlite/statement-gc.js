@@ -0,0 +1,30 @@
+'use strict';
+
+// Measures the time of full garbage collections while many prepared
+// statements are alive, which is what tracing them through cppgc instead of
+// weak handles affects.
+
+const common = require('../common.js');
+const { DatabaseSync } = require('node:sqlite');
+
+const bench = common.createBenchmark(main, {
+  statements: [1e3, 1e4, 1e5],
+  n: [20],
+}, {
+  flags: ['--expose-gc'],
+});
+
+function main({ statements, n }) {
+  const db = new DatabaseSync(':memory:', { statementCacheSize: 0 });
+  const held = [];
+  for (let i = 0; i < statements; i++) {
+    held.push(db.prepare(`SELECT ${i} AS value`));
+  }
+  globalThis.gc();
+
+  bench.start();
+  for (let i = 0; i < n; i++) globalThis.gc();
+  bench.end(n);
+
+  db.close();
+}
@@ -0,0 +1,24 @@
+'use strict';
+
+// Measures the per-call overhead of the watchdogs behind the `timeout` and
+// `breakOnSigint` options of vm, with a script that does almost nothing.
+
+const common = require('../common.js');
+const vm = require('vm');
+
+const bench = common.createBenchmark(main, {
+  option: ['none', 'timeout', 'breakOnSigint'],
+  n: [1e5],
+});
+
+function main({ option, n }) {
+  const context = vm.createContext({});
+  const script = new vm.Script('1 + 1');
+  const options = {};
+  if (option === 'timeout') options.timeout = 1000;
+  if (option === 'breakOnSigint') options.breakOnSigint = true;
+
+  bench.start();
+  for (let i = 0; i < n; i++) script.runInContext(context, options);
+  bench.end(n);
+}
@@ -0,0 +1,85 @@
+'use strict';
+
+// Compares writing iovecs through WASI fd_write with the same writes done
+// natively through fs.writevSync, both to /dev/null, so that what is measured
+// is the cost of crossing into the host rather than the cost of the I/O.
+
+const common = require('../common.js');
+const fs = require('fs');
+const { WASI } = require('wasi');
+
+const bench = common.createBenchmark(main, {
+  mode: ['wasi', 'native'],
+  iovs: [1, 4, 32],
+  size: [64],
+  n: [1e5],
+});
+
+// (module
+//   (import "wasi_snapshot_preview1" "fd_write"
+//     (func $fd_write (param i32 i32 i32 i32) (result i32)))
+//   (memory (export "memory") 1)
+//   (func (export "run") (param $fd i32) (param $iovs i32) (param $len i32)
+//                        (param $n i32)
+//     (loop $loop
+//       (drop (call $fd_write (local.get $fd) (local.get $iovs)
+//                             (local.get $len) (i32.const 0)))
+//       (br_if $loop (local.tee $n (i32.sub (local.get $n) (i32.const 1)))))))
+const bytes = Buffer.from([
+  0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+  // Types.
+  0x01, 0x10, 0x02,
+  0x60, 0x04, 0x7f, 0x7f, 0x7f, 0x7f, 0x01, 0x7f,
+  0x60, 0x04, 0x7f, 0x7f, 0x7f, 0x7f, 0x00,
+  // Imports.
+  0x02, 0x23, 0x01,
+  0x16, ...Buffer.from('wasi_snapshot_preview1'),
+  0x08, ...Buffer.from('fd_write'),
+  0x00, 0x00,
+  // Functions.
+  0x03, 0x02, 0x01, 0x01,
+  // Memory.
+  0x05, 0x03, 0x01, 0x00, 0x01,
+  // Exports.
+  0x07, 0x10, 0x02,
+  0x06, ...Buffer.from('memory'), 0x02, 0x00,
+  0x03, ...Buffer.from('run'), 0x00, 0x01,
+  // Code.
+  0x0a, 0x1b, 0x01, 0x19, 0x00,
+  0x03, 0x40,
+  0x20, 0x00, 0x20, 0x01, 0x20, 0x02, 0x41, 0x00, 0x10, 0x00, 0x1a,
+  0x20, 0x03, 0x41, 0x01, 0x6b, 0x22, 0x03,
+  0x0d, 0x00,
+  0x0b, 0x0b,
+]);
+
+const kIovsOffset = 16;
+const kDataOffset = 1024;
+
+function main({ mode, iovs, size, n }) {
+  const fd = fs.openSync('/dev/null', 'w');
+
+  if (mode === 'native') {
+    const buffers = [];
+    for (let i = 0; i < iovs; i++) buffers.push(Buffer.alloc(size, 0x61));
+    bench.start();
+    for (let i = 0; i < n; i++) fs.writevSync(fd, buffers);
+    bench.end(n);
+  } else {
+    const wasi = new WASI({ version: 'preview1', stdout: fd });
+    const instance = new WebAssembly.Instance(
+      new WebAssembly.Module(bytes), wasi.getImportObject());
+    wasi.initialize(instance);
+
+    const view = new DataView(instance.exports.memory.buffer);
+    for (let i = 0; i < iovs; i++) {
+      view.setUint32(kIovsOffset + i * 8, kDataOffset + i * size, true);
+      view.setUint32(kIovsOffset + i * 8 + 4, size, true);
+    }
+    bench.start();
+    instance.exports.run(1, kIovsOffset, iovs, n);
+    bench.end(n);
+  }
+
+  fs.closeSync(fd);
+}
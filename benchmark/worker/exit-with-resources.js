@@ -0,0 +1,39 @@
+'use strict';
+
+// Measures the lifecycle of workers that hold many native objects when they
+// exit, which are all destroyed when the worker tears its environment down.
+
+const common = require('../common.js');
+const { Worker } = require('worker_threads');
+
+const bench = common.createBenchmark(main, {
+  resources: [0, 1e3, 1e4],
+  n: [20],
+});
+
+const source = `
+const { workerData, parentPort } = require('worker_threads');
+const { MessageChannel } = require('worker_threads');
+globalThis.held = [];
+for (let i = 0; i < workerData; i++) held.push(new MessageChannel());
+parentPort.postMessage('ready');
+`;
+
+function main({ resources, n }) {
+  let exited = 0;
+
+  function spawn() {
+    const worker = new Worker(source, { eval: true, workerData: resources });
+    worker.once('message', () => worker.terminate());
+    worker.once('exit', () => {
+      if (++exited === n) {
+        bench.end(n);
+        return;
+      }
+      spawn();
+    });
+  }
+
+  bench.start();
+  spawn();
+}
@@ -0,0 +1,64 @@
+'use strict';
+
+// Compares posting small plain objects through a MessagePort, which takes the
+// plain object fast path of the messaging serializer, against v8.serialize(),
+// which always goes through the generic one.
+
+const common = require('../common.js');
+const v8 = require('v8');
+const { MessageChannel } = require('worker_threads');
+
+const bench = common.createBenchmark(main, {
+  payload: ['flat', 'nested', 'array', 'class'],
+  method: ['postMessage', 'v8.serialize'],
+  n: [1e5],
+});
+
+class Job {
+  constructor(id) {
+    this.id = id;
+    this.kind = 'job';
+  }
+}
+
+const payloads = {
+  flat: { id: 42, kind: 'job', priority: 1.5, done: false, owner: null },
+  nested: {
+    id: 42,
+    kind: 'job',
+    meta: { attempt: 1, tags: { region: 'eu', tier: 'gold' } },
+    args: { from: 'a', to: 'b', options: { retry: true } },
+  },
+  array: [
+    { id: 1, kind: 'job' },
+    { id: 2, kind: 'job' },
+    { id: 3, kind: 'job' },
+    { id: 4, kind: 'job' },
+  ],
+  // Class instances are not plain and take the generic path.
+  class: { jobs: [new Job(1), new Job(2), new Job(3), new Job(4)] },
+};
+
+function main({ n, payload, method }) {
+  const data = payloads[payload];
+
+  if (method === 'v8.serialize') {
+    bench.start();
+    for (let i = 0; i < n; i++)
+      v8.serialize(data);
+    bench.end(n);
+    return;
+  }
+
+  const { port1, port2 } = new MessageChannel();
+  let received = 0;
+  port2.on('message', () => {
+    if (++received === n) {
+      bench.end(n);
+      port1.close();
+    }
+  });
+  bench.start();
+  for (let i = 0; i < n; i++)
+    port1.postMessage(data);
+}
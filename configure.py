@@ -180,6 +180,13 @@ parser.add_argument("--enable-vtune-profiling",
          "JavaScript code executed in Node.js. This feature is only available "
          "for x32, x86, and x64 architectures.")
 
+parser.add_argument("--with-static-probes",
+    action="store_true",
+    dest="with_static_probes",
+    default=False,
+    help="Build with static USDT probes on Linux and ETW TraceLogging events "
+         "on Windows for hot runtime paths.")
+
 parser.add_argument("--enable-pgo-generate",
     action="store_true",
     dest="enable_pgo_generate",
@@ -560,6 +567,28 @@ shared_optgroup.add_argument('--shared-sqlite-libpath',
     dest='shared_sqlite_libpath',
     help='a directory to search for the shared sqlite DLL')
 
+shared_optgroup.add_argument('--shared-zstd',
+    action='store_true',
+    dest='shared_zstd',
+    default=None,
+    help='link to a shared zstd DLL, enabling the zstd compression streams')
+
+shared_optgroup.add_argument('--shared-zstd-includes',
+    action='store',
+    dest='shared_zstd_includes',
+    help='directory containing zstd header files')
+
+shared_optgroup.add_argument('--shared-zstd-libname',
+    action='store',
+    dest='shared_zstd_libname',
+    default='zstd',
+    help='alternative lib name to link to [default: %(default)s]')
+
+shared_optgroup.add_argument('--shared-zstd-libpath',
+    action='store',
+    dest='shared_zstd_libpath',
+    help='a directory to search for the shared zstd DLL')
+
 
 for builtin in shareable_builtins:
   builtin_id = 'shared_builtin_' + builtin + '_path'
@@ -1467,6 +1496,11 @@ def configure_node(o):
   else:
     o['variables']['node_enable_v8_vtunejit'] = 'false'
 
+  if options.with_static_probes and flavor not in ('linux', 'win'):
+    raise Exception(
+       'Static probes are only supported on Linux and Windows.')
+  o['variables']['node_use_static_probes'] = b(options.with_static_probes)
+
   if flavor != 'linux' and (options.enable_pgo_generate or options.enable_pgo_use):
     raise Exception(
       'The pgo option is supported only on linux.')
@@ -2194,6 +2228,7 @@ configure_library('nghttp2', output, pkgname='libnghttp2')
 configure_library('nghttp3', output, pkgname='libnghttp3')
 configure_library('ngtcp2', output, pkgname='libngtcp2')
 configure_library('sqlite', output, pkgname='sqlite3')
+configure_library('zstd', output, pkgname='libzstd')
 configure_library('uvwasi', output, pkgname='libuvwasi')
 configure_v8(output, configurations)
 configure_openssl(output)
@@ -1113,9 +1113,23 @@ enum uv_process_flags {
    * search for the exact file name before trying variants with
    * extensions like '.exe' or '.cmd'.
    */
-  UV_PROCESS_WINDOWS_FILE_PATH_EXACT_NAME = (1 << 7)
+  UV_PROCESS_WINDOWS_FILE_PATH_EXACT_NAME = (1 << 7),
+  /*
+   * On Linux with glibc 2.29 or newer, spawn the child with posix_spawn(),
+   * which creates it with clone(CLONE_VM | CLONE_VFORK) instead of copying
+   * the page tables of the parent with fork(). Falls back to fork() when
+   * the other options need it, e.g. UV_PROCESS_SETUID. macOS always uses
+   * posix_spawn() and other platforms silently ignore this flag.
+   */
+  UV_PROCESS_PREFER_POSIX_SPAWN = (1 << 8)
 };
 
+/*
+ * Lets embedders that may be built against a libuv without the flag test
+ * for it with #ifdef.
+ */
+#define UV_PROCESS_PREFER_POSIX_SPAWN UV_PROCESS_PREFER_POSIX_SPAWN
+
 /*
  * uv_process_t is a subclass of uv_handle_t.
  */
@@ -59,6 +59,19 @@ extern char **environ;
 # include <grp.h>
 #endif
 
+/* glibc 2.29 is the first release where posix_spawn_file_actions_adddup2()
+ * with the same source and target fd clears FD_CLOEXEC, which stands in for
+ * the addinherit_np() of macOS. */
+#if defined(__linux__) && defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+# include <spawn.h>
+# include <paths.h>
+# include <dlfcn.h>
+# define UV__HAVE_POSIX_SPAWN 1
+#elif defined(__APPLE__)
+# define UV__HAVE_POSIX_SPAWN 1
+#endif
+
 #if defined(__MVS__)
 # include "zos-base.h"
 #endif
@@ -407,7 +420,7 @@ static void uv__process_child_init(const uv_process_options_t* options,
 }
 
 
-#if defined(__APPLE__)
+#if defined(UV__HAVE_POSIX_SPAWN)
 typedef struct uv__posix_spawn_fncs_tag {
   struct {
     int (*addchdir_np)(const posix_spawn_file_actions_t *, const char *);
@@ -428,6 +441,7 @@ static void uv__spawn_init_posix_spawn_fncs(void) {
 
 
 static void uv__spawn_init_can_use_setsid(void) {
+#if defined(__APPLE__)
   int which[] = {CTL_KERN, KERN_OSRELEASE};
   unsigned major;
   unsigned minor;
@@ -444,6 +458,9 @@ static void uv__spawn_init_can_use_setsid(void) {
     return;
 
   posix_spawn_can_use_setsid = (major >= 19);  /* macOS Catalina */
+#else
+  posix_spawn_can_use_setsid = 1;  /* glibc 2.26 */
+#endif
 }
 
 
@@ -490,9 +507,10 @@ static int uv__spawn_set_posix_spawn_attrs(
    *    spawn-sigmask in attributes
    * 4) POSIX_SPAWN_SETSID: Make the process a new session leader if a detached
    *    session was requested. */
-  flags = POSIX_SPAWN_CLOEXEC_DEFAULT |
-          POSIX_SPAWN_SETSIGDEF |
-          POSIX_SPAWN_SETSIGMASK;
+  flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+#if defined(__APPLE__)
+  flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#endif
   if (options->flags & UV_PROCESS_DETACHED) {
     /* If running on a version of macOS where this flag is not supported,
      * revert back to the fork/exec flow. Otherwise posix_spawn will
@@ -609,7 +627,11 @@ static int uv__spawn_set_posix_spawn_file_actions(
     }
 
     if (fd == use_fd)
+#if defined(__APPLE__)
         err = posix_spawn_file_actions_addinherit_np(actions, fd);
+#else
+        err = posix_spawn_file_actions_adddup2(actions, fd, fd);
+#endif
     else
         err = posix_spawn_file_actions_adddup2(actions, use_fd, fd);
     assert(err != ENOSYS);
@@ -804,6 +826,15 @@ error:
    * already destroyed, only the happy path requires cleanup */
   return UV__ERR(err);
 }
+
+
+static int uv__spawn_prefer_posix_spawn(const uv_process_options_t* options) {
+#if defined(__APPLE__)
+  return 1;
+#else
+  return options->flags & UV_PROCESS_PREFER_POSIX_SPAWN;
+#endif
+}
 #endif
 
 static int uv__spawn_and_init_child_fork(const uv_process_options_t* options,
@@ -859,34 +890,48 @@ static int uv__spawn_and_init_child(
   int exec_errorno;
   ssize_t r;
 
-#if defined(__APPLE__)
-  uv_once(&posix_spawn_init_once, uv__spawn_init_posix_spawn);
-
-  /* Special child process spawn case for macOS Big Sur (11.0) onwards
-   *
-   * Big Sur introduced a significant performance degradation on a call to
-   * fork/exec when the process has many pages mmaped in with MAP_JIT, like, say
-   * a javascript interpreter. Electron-based applications, for example,
-   * are impacted; though the magnitude of the impact depends on how much the
-   * app relies on subprocesses.
-   *
-   * On macOS, though, posix_spawn is implemented in a way that does not
-   * exhibit the problem. This block implements the forking and preparation
-   * logic with posix_spawn and its related primitives. It also takes advantage of
-   * the macOS extension POSIX_SPAWN_CLOEXEC_DEFAULT that makes impossible to
-   * leak descriptors to the child process. */
-  err = uv__spawn_and_init_child_posix_spawn(options,
-                                             stdio_count,
-                                             pipes,
-                                             pid,
-                                             &posix_spawn_fncs);
-
-  /* The posix_spawn flow will return UV_ENOSYS if any of the posix_spawn_x_np
-   * non-standard functions is both _needed_ and _undefined_. In those cases,
-   * default back to the fork/execve strategy. For all other errors, just fail. */
-  if (err != UV_ENOSYS)
-    return err;
+#if defined(UV__HAVE_POSIX_SPAWN)
+  if (uv__spawn_prefer_posix_spawn(options)) {
+    uv_once(&posix_spawn_init_once, uv__spawn_init_posix_spawn);
+
+    /* Special child process spawn case for macOS Big Sur (11.0) onwards
+     *
+     * Big Sur introduced a significant performance degradation on a call to
+     * fork/exec when the process has many pages mmaped in with MAP_JIT, like,
+     * say a javascript interpreter. Electron-based applications, for example,
+     * are impacted; though the magnitude of the impact depends on how much
+     * the app relies on subprocesses.
+     *
+     * On macOS, though, posix_spawn is implemented in a way that does not
+     * exhibit the problem. This block implements the forking and preparation
+     * logic with posix_spawn and its related primitives. It also takes
+     * advantage of the macOS extension POSIX_SPAWN_CLOEXEC_DEFAULT that makes
+     * impossible to leak descriptors to the child process.
+     *
+     * On Linux, glibc implements posix_spawn with clone(CLONE_VM |
+     * CLONE_VFORK), which does not copy the page tables of a large parent
+     * like fork does. Without POSIX_SPAWN_CLOEXEC_DEFAULT the cloexec lock
+     * has to be held, just like for fork. */
+#if !defined(__APPLE__)
+    uv_rwlock_wrlock(&loop->cloexec_lock);
+#endif
+    err = uv__spawn_and_init_child_posix_spawn(options,
+                                               stdio_count,
+                                               pipes,
+                                               pid,
+                                               &posix_spawn_fncs);
+#if !defined(__APPLE__)
+    uv_rwlock_wrunlock(&loop->cloexec_lock);
+#endif
 
+    /* The posix_spawn flow will return UV_ENOSYS if any of the
+     * posix_spawn_x_np non-standard functions is both _needed_ and
+     * _undefined_, or if an option such as setuid needs the fork flow. In
+     * those cases, default back to the fork/execve strategy. For all other
+     * errors, just fail. */
+    if (err != UV_ENOSYS)
+      return err;
+  }
 #endif
 
   /* This pipe is used by the parent to wait until
@@ -970,6 +1015,7 @@ int uv_spawn(uv_loop_t* loop,
 
   assert(options->file != NULL);
   assert(!(options->flags & ~(UV_PROCESS_DETACHED |
+                              UV_PROCESS_PREFER_POSIX_SPAWN |
                               UV_PROCESS_SETGID |
                               UV_PROCESS_SETUID |
                               UV_PROCESS_WINDOWS_FILE_PATH_EXACT_NAME |
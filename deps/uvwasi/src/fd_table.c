@@ -335,13 +335,16 @@ uvwasi_errno_t uvwasi_fd_table_get(struct uvwasi_fd_table_t* table,
   if (table == NULL)
     return UVWASI_EINVAL;
 
-  uv_rwlock_wrlock(&table->rwlock);
+  /* Lookups only read the table, so concurrent lookups of different file
+     descriptors do not need to serialize on the table lock. The entry is
+     still protected by its own mutex once it is returned. */
+  uv_rwlock_rdlock(&table->rwlock);
   err = uvwasi_fd_table_get_nolock(table,
                                    id,
                                    wrap,
                                    rights_base,
                                    rights_inheriting);
-  uv_rwlock_wrunlock(&table->rwlock);
+  uv_rwlock_rdunlock(&table->rwlock);
   return err;
 }
 
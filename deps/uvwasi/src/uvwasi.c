@@ -14,6 +14,8 @@
 #endif /* _WIN32 */
 
 #define UVWASI__READDIR_NUM_ENTRIES 1
+/* Number of iovecs that are converted on the stack instead of the heap. */
+#define UVWASI__IOVS_STACK_SIZE 16
 
 #if !defined(_WIN32) && !defined(__ANDROID__)
 # define UVWASI_FD_READDIR_SUPPORTED 1
@@ -200,6 +202,7 @@ static uvwasi_errno_t uvwasi__lseek(uv_file fd,
 
 static uvwasi_errno_t uvwasi__setup_iovs(const uvwasi_t* uvwasi,
                                          uv_buf_t** buffers,
+                                         uv_buf_t* stack_bufs,
                                          const uvwasi_iovec_t* iovs,
                                          uvwasi_size_t iovs_len) {
   uv_buf_t* bufs;
@@ -208,9 +211,13 @@ static uvwasi_errno_t uvwasi__setup_iovs(const uvwasi_t* uvwasi,
   if ((iovs_len * sizeof(*bufs)) / (sizeof(*bufs)) != iovs_len)
     return UVWASI_ENOMEM;
 
-  bufs = uvwasi__malloc(uvwasi, iovs_len * sizeof(*bufs));
-  if (bufs == NULL)
-    return UVWASI_ENOMEM;
+  if (iovs_len <= UVWASI__IOVS_STACK_SIZE) {
+    bufs = stack_bufs;
+  } else {
+    bufs = uvwasi__malloc(uvwasi, iovs_len * sizeof(*bufs));
+    if (bufs == NULL)
+      return UVWASI_ENOMEM;
+  }
 
   for (i = 0; i < iovs_len; ++i)
     bufs[i] = uv_buf_init(iovs[i].buf, iovs[i].buf_len);
@@ -222,6 +229,7 @@ static uvwasi_errno_t uvwasi__setup_iovs(const uvwasi_t* uvwasi,
 
 static uvwasi_errno_t uvwasi__setup_ciovs(const uvwasi_t* uvwasi,
                                           uv_buf_t** buffers,
+                                          uv_buf_t* stack_bufs,
                                           const uvwasi_ciovec_t* iovs,
                                           uvwasi_size_t iovs_len) {
   uv_buf_t* bufs;
@@ -230,9 +238,13 @@ static uvwasi_errno_t uvwasi__setup_ciovs(const uvwasi_t* uvwasi,
   if ((iovs_len * sizeof(*bufs)) / (sizeof(*bufs)) != iovs_len)
     return UVWASI_ENOMEM;
 
-  bufs = uvwasi__malloc(uvwasi, iovs_len * sizeof(*bufs));
-  if (bufs == NULL)
-    return UVWASI_ENOMEM;
+  if (iovs_len <= UVWASI__IOVS_STACK_SIZE) {
+    bufs = stack_bufs;
+  } else {
+    bufs = uvwasi__malloc(uvwasi, iovs_len * sizeof(*bufs));
+    if (bufs == NULL)
+      return UVWASI_ENOMEM;
+  }
 
   for (i = 0; i < iovs_len; ++i)
     bufs[i] = uv_buf_init((char*)iovs[i].buf, iovs[i].buf_len);
@@ -241,6 +253,13 @@ static uvwasi_errno_t uvwasi__setup_ciovs(const uvwasi_t* uvwasi,
   return UVWASI_ESUCCESS;
 }
 
+static void uvwasi__free_iovs(const uvwasi_t* uvwasi,
+                              uv_buf_t* bufs,
+                              uv_buf_t* stack_bufs) {
+  if (bufs != stack_bufs)
+    uvwasi__free(uvwasi, bufs);
+}
+
 typedef struct new_connection_data_s {
   int done;
 } new_connection_data_t;
@@ -1143,6 +1162,7 @@ uvwasi_errno_t uvwasi_fd_pread(uvwasi_t* uvwasi,
                                uvwasi_filesize_t offset,
                                uvwasi_size_t* nread) {
   struct uvwasi_fd_wrap_t* wrap;
+  uv_buf_t stack_bufs[UVWASI__IOVS_STACK_SIZE];
   uv_buf_t* bufs;
   uv_fs_t req;
   uvwasi_errno_t err;
@@ -1177,7 +1197,7 @@ uvwasi_errno_t uvwasi_fd_pread(uvwasi_t* uvwasi,
     return UVWASI_ESUCCESS;
   }
 
-  err = uvwasi__setup_iovs(uvwasi, &bufs, iovs, iovs_len);
+  err = uvwasi__setup_iovs(uvwasi, &bufs, stack_bufs, iovs, iovs_len);
   if (err != UVWASI_ESUCCESS) {
     uv_mutex_unlock(&wrap->mutex);
     return err;
@@ -1187,7 +1207,7 @@ uvwasi_errno_t uvwasi_fd_pread(uvwasi_t* uvwasi,
   uv_mutex_unlock(&wrap->mutex);
   uvread = req.result;
   uv_fs_req_cleanup(&req);
-  uvwasi__free(uvwasi, bufs);
+  uvwasi__free_iovs(uvwasi, bufs, stack_bufs);
 
   if (r < 0)
     return uvwasi__translate_uv_error(r);
@@ -1275,6 +1295,7 @@ uvwasi_errno_t uvwasi_fd_pwrite(uvwasi_t* uvwasi,
                                 uvwasi_filesize_t offset,
                                 uvwasi_size_t* nwritten) {
   struct uvwasi_fd_wrap_t* wrap;
+  uv_buf_t stack_bufs[UVWASI__IOVS_STACK_SIZE];
   uv_buf_t* bufs;
   uv_fs_t req;
   uvwasi_errno_t err;
@@ -1309,7 +1330,7 @@ uvwasi_errno_t uvwasi_fd_pwrite(uvwasi_t* uvwasi,
     return UVWASI_ESUCCESS;
   }
 
-  err = uvwasi__setup_ciovs(uvwasi, &bufs, iovs, iovs_len);
+  err = uvwasi__setup_ciovs(uvwasi, &bufs, stack_bufs, iovs, iovs_len);
   if (err != UVWASI_ESUCCESS) {
     uv_mutex_unlock(&wrap->mutex);
     return err;
@@ -1319,7 +1340,7 @@ uvwasi_errno_t uvwasi_fd_pwrite(uvwasi_t* uvwasi,
   uv_mutex_unlock(&wrap->mutex);
   uvwritten = req.result;
   uv_fs_req_cleanup(&req);
-  uvwasi__free(uvwasi, bufs);
+  uvwasi__free_iovs(uvwasi, bufs, stack_bufs);
 
   if (r < 0)
     return uvwasi__translate_uv_error(r);
@@ -1335,6 +1356,7 @@ uvwasi_errno_t uvwasi_fd_read(uvwasi_t* uvwasi,
                               uvwasi_size_t iovs_len,
                               uvwasi_size_t* nread) {
   struct uvwasi_fd_wrap_t* wrap;
+  uv_buf_t stack_bufs[UVWASI__IOVS_STACK_SIZE];
   uv_buf_t* bufs;
   uv_fs_t req;
   uvwasi_errno_t err;
@@ -1363,7 +1385,7 @@ uvwasi_errno_t uvwasi_fd_read(uvwasi_t* uvwasi,
     return UVWASI_ESUCCESS;
   }
 
-  err = uvwasi__setup_iovs(uvwasi, &bufs, iovs, iovs_len);
+  err = uvwasi__setup_iovs(uvwasi, &bufs, stack_bufs, iovs, iovs_len);
   if (err != UVWASI_ESUCCESS) {
     uv_mutex_unlock(&wrap->mutex);
     return err;
@@ -1373,7 +1395,7 @@ uvwasi_errno_t uvwasi_fd_read(uvwasi_t* uvwasi,
   uv_mutex_unlock(&wrap->mutex);
   uvread = req.result;
   uv_fs_req_cleanup(&req);
-  uvwasi__free(uvwasi, bufs);
+  uvwasi__free_iovs(uvwasi, bufs, stack_bufs);
 
   if (r < 0)
     return uvwasi__translate_uv_error(r);
@@ -1643,6 +1665,7 @@ uvwasi_errno_t uvwasi_fd_write(uvwasi_t* uvwasi,
                                uvwasi_size_t iovs_len,
                                uvwasi_size_t* nwritten) {
   struct uvwasi_fd_wrap_t* wrap;
+  uv_buf_t stack_bufs[UVWASI__IOVS_STACK_SIZE];
   uv_buf_t* bufs;
   uv_fs_t req;
   uvwasi_errno_t err;
@@ -1672,7 +1695,7 @@ uvwasi_errno_t uvwasi_fd_write(uvwasi_t* uvwasi,
     return UVWASI_ESUCCESS;
   }
 
-  err = uvwasi__setup_ciovs(uvwasi, &bufs, iovs, iovs_len);
+  err = uvwasi__setup_ciovs(uvwasi, &bufs, stack_bufs, iovs, iovs_len);
   if (err != UVWASI_ESUCCESS) {
     uv_mutex_unlock(&wrap->mutex);
     return err;
@@ -1682,7 +1705,7 @@ uvwasi_errno_t uvwasi_fd_write(uvwasi_t* uvwasi,
   uv_mutex_unlock(&wrap->mutex);
   uvwritten = req.result;
   uv_fs_req_cleanup(&req);
-  uvwasi__free(uvwasi, bufs);
+  uvwasi__free_iovs(uvwasi, bufs, stack_bufs);
 
   if (r < 0)
     return uvwasi__translate_uv_error(r);
@@ -2717,6 +2740,7 @@ uvwasi_errno_t uvwasi_sock_send(uvwasi_t* uvwasi,
 
   struct uvwasi_fd_wrap_t* wrap;
   uvwasi_errno_t err = 0;
+  uv_buf_t stack_bufs[UVWASI__IOVS_STACK_SIZE];
   uv_buf_t* bufs;
   int r = 0;
 
@@ -2741,14 +2765,14 @@ uvwasi_errno_t uvwasi_sock_send(uvwasi_t* uvwasi,
   if (err != UVWASI_ESUCCESS)
     return err;
 
-  err = uvwasi__setup_ciovs(uvwasi, &bufs, si_data, si_data_len);
+  err = uvwasi__setup_ciovs(uvwasi, &bufs, stack_bufs, si_data, si_data_len);
   if (err != UVWASI_ESUCCESS) {
     uv_mutex_unlock(&wrap->mutex);
     return err;
   }
 
   r = uv_try_write((uv_stream_t*) wrap->sock, bufs, si_data_len);
-  uvwasi__free(uvwasi, bufs);
+  uvwasi__free_iovs(uvwasi, bufs, stack_bufs);
   uv_mutex_unlock(&wrap->mutex);
   if (r < 0)
     return uvwasi__translate_uv_error(r);
@@ -21,12 +21,14 @@
     'node_shared_cares%': 'false',
     'node_shared_libuv%': 'false',
     'node_shared_sqlite%': 'false',
+    'node_shared_zstd%': 'false',
     'node_shared_uvwasi%': 'false',
     'node_shared_nghttp2%': 'false',
     'node_use_openssl%': 'true',
     'node_shared_openssl%': 'false',
     'node_v8_options%': '',
     'node_enable_v8_vtunejit%': 'false',
+    'node_use_static_probes%': 'false',
     'node_core_target_name%': 'node',
     'node_lib_target_name%': 'libnode',
     'node_intermediate_lib_type%': 'static_library',
@@ -117,8 +119,11 @@
       'src/node_http_parser.cc',
       'src/node_http2.cc',
       'src/node_i18n.cc',
+      'src/node_json.cc',
+      'src/node_log_writer.cc',
       'src/node_main_instance.cc',
       'src/node_messaging.cc',
+      'src/node_metrics.cc',
       'src/node_metadata.cc',
       'src/node_modules.cc',
       'src/node_options.cc',
@@ -126,6 +131,7 @@
       'src/node_perf.cc',
       'src/node_platform.cc',
       'src/node_postmortem_metadata.cc',
+      'src/node_probes.cc',
       'src/node_process_events.cc',
       'src/node_process_methods.cc',
       'src/node_process_object.cc',
@@ -133,6 +139,7 @@
       'src/node_report.cc',
       'src/node_report_module.cc',
       'src/node_report_utils.cc',
+      'src/node_ring_channel.cc',
       'src/node_sea.cc',
       'src/node_serdes.cc',
       'src/node_shadow_realm.cc',
@@ -146,6 +153,7 @@
       'src/node_trace_events.cc',
       'src/node_types.cc',
       'src/node_url.cc',
+      'src/node_url_pattern.cc',
       'src/node_util.cc',
       'src/node_v8.cc',
       'src/node_wasi.cc',
@@ -163,6 +171,8 @@
       'src/permission/worker_permission.cc',
       'src/pipe_wrap.cc',
       'src/process_wrap.cc',
+      'src/request_object_pool.cc',
+      'src/shm_channel_wrap.cc',
       'src/signal_wrap.cc',
       'src/spawn_sync.cc',
       'src/stream_base.cc',
@@ -171,11 +181,13 @@
       'src/string_bytes.cc',
       'src/string_decoder.cc',
       'src/tcp_wrap.cc',
+      'src/threadpoolwork.cc',
       'src/timers.cc',
       'src/timer_wrap.cc',
       'src/tracing/agent.cc',
       'src/tracing/node_trace_buffer.cc',
       'src/tracing/node_trace_writer.cc',
+      'src/tracing/perfetto_trace_writer.cc',
       'src/tracing/trace_event.cc',
       'src/tracing/traced_value.cc',
       'src/tty_wrap.cc',
@@ -202,6 +214,7 @@
       'src/compile_cache.h',
       'src/connect_wrap.h',
       'src/connection_wrap.h',
+      'src/cppgc_helpers.h',
       'src/dataqueue/queue.h',
       'src/debug_utils.h',
       'src/debug_utils-inl.h',
@@ -244,10 +257,13 @@
       'src/node_http2_state.h',
       'src/node_i18n.h',
       'src/node_internals.h',
+      'src/node_json.h',
+      'src/node_log_writer.h',
       'src/node_main_instance.h',
       'src/node_mem.h',
       'src/node_mem-inl.h',
       'src/node_messaging.h',
+      'src/node_metrics.h',
       'src/node_metadata.h',
       'src/node_mutex.h',
       'src/node_modules.h',
@@ -257,6 +273,7 @@
       'src/node_perf.h',
       'src/node_perf_common.h',
       'src/node_platform.h',
+      'src/node_probes.h',
       'src/node_process.h',
       'src/node_process-inl.h',
       'src/node_realm.h',
@@ -274,6 +291,7 @@
       'src/node_stat_watcher.h',
       'src/node_union_bytes.h',
       'src/node_url.h',
+      'src/node_url_pattern.h',
       'src/node_version.h',
       'src/node_v8.h',
       'src/node_v8_platform-inl.h',
@@ -291,7 +309,9 @@
       'src/pipe_wrap.h',
       'src/req_wrap.h',
       'src/req_wrap-inl.h',
+      'src/request_object_pool.h',
       'src/spawn_sync.h',
+      'src/spsc_ring.h',
       'src/stream_base.h',
       'src/stream_base-inl.h',
       'src/stream_pipe.h',
@@ -304,6 +324,7 @@
       'src/tracing/agent.h',
       'src/tracing/node_trace_buffer.h',
       'src/tracing/node_trace_writer.h',
+      'src/tracing/perfetto_trace_writer.h',
       'src/tracing/trace_event.h',
       'src/tracing/trace_event_common.h',
       'src/tracing/traced_value.h',
@@ -337,6 +358,8 @@
       'src/crypto/crypto_keys.cc',
       'src/crypto/crypto_keygen.cc',
       'src/crypto/crypto_scrypt.cc',
+      'src/crypto/crypto_session_cache.cc',
+      'src/crypto/crypto_threadpool.cc',
       'src/crypto/crypto_tls.cc',
       'src/crypto/crypto_x509.cc',
       'src/crypto/crypto_bio.h',
@@ -353,6 +376,8 @@
       'src/crypto/crypto_keys.h',
       'src/crypto/crypto_keygen.h',
       'src/crypto/crypto_scrypt.h',
+      'src/crypto/crypto_session_cache.h',
+      'src/crypto/crypto_threadpool.h',
       'src/crypto/crypto_tls.h',
       'src/crypto/crypto_clienthello.h',
       'src/crypto/crypto_context.h',
@@ -407,10 +432,13 @@
       'test/cctest/test_base64.cc',
       'test/cctest/test_base_object_ptr.cc',
       'test/cctest/test_cppgc.cc',
+      'test/cctest/test_node_json.cc',
       'test/cctest/test_node_postmortem_metadata.cc',
       'test/cctest/test_node_task_runner.cc',
       'test/cctest/test_environment.cc',
+      'test/cctest/test_fs_permission.cc',
       'test/cctest/test_linked_binding.cc',
+      'test/cctest/test_metrics.cc',
       'test/cctest/test_node_api.cc',
       'test/cctest/test_path.cc',
       'test/cctest/test_per_process.cc',
@@ -418,7 +446,9 @@
       'test/cctest/test_report.cc',
       'test/cctest/test_json_utils.cc',
       'test/cctest/test_sockaddr.cc',
+      'test/cctest/test_timer_wheel.cc',
       'test/cctest/test_traced_value.cc',
+      'test/cctest/test_url_pattern.cc',
       'test/cctest/test_util.cc',
       'test/cctest/test_dataqueue.cc',
     ],
@@ -434,6 +464,20 @@
       'test/cctest/test_inspector_socket.cc',
       'test/cctest/test_inspector_socket_server.cc',
     ],
+    'node_microbench_sources': [
+      'src/node_snapshot_stub.cc',
+      'test/cctest/node_test_fixture.cc',
+      'test/cctest/node_test_fixture.h',
+      'test/microbench/microbench.cc',
+      'test/microbench/microbench.h',
+      'test/microbench/bench_aliased_buffer.cc',
+      'test/microbench/bench_dataqueue.cc',
+      'test/microbench/bench_histogram.cc',
+      'test/microbench/bench_permission.cc',
+      'test/microbench/bench_sockaddr.cc',
+      'test/microbench/bench_string_bytes.cc',
+      'test/microbench/bench_util.cc',
+    ],
     'node_mksnapshot_exec': '<(PRODUCT_DIR)/<(EXECUTABLE_PREFIX)node_mksnapshot<(EXECUTABLE_SUFFIX)',
     'node_js2c_exec': '<(PRODUCT_DIR)/<(EXECUTABLE_PREFIX)node_js2c<(EXECUTABLE_SUFFIX)',
     'conditions': [
@@ -959,6 +1003,9 @@
           'node_target_type=="executable"', {
           'defines': [ 'NODE_ENABLE_LARGE_CODE_PAGES=1' ],
         }],
+        [ 'node_use_static_probes=="true"', {
+          'defines': [ 'NODE_USE_STATIC_PROBES=1' ],
+        }],
         [ 'use_openssl_def==1', {
           # TODO(bnoordhuis) Make all platforms export the same list of symbols.
           # Teach mkssldef.py to generate linker maps that UNIX linkers understand.
@@ -1255,6 +1302,89 @@
       ],
     }, # cctest
 
+    {
+      'target_name': 'microbench',
+      'type': 'executable',
+
+      'dependencies': [
+        '<(node_lib_target_name)',
+        'deps/googletest/googletest.gyp:gtest',
+        'deps/googletest/googletest.gyp:gtest_main',
+        'deps/histogram/histogram.gyp:histogram',
+        'deps/sqlite/sqlite.gyp:sqlite',
+        'deps/simdjson/simdjson.gyp:simdjson',
+        'deps/simdutf/simdutf.gyp:simdutf',
+        'deps/ada/ada.gyp:ada',
+        'deps/nbytes/nbytes.gyp:nbytes',
+      ],
+
+      'includes': [
+        'node.gypi'
+      ],
+
+      'include_dirs': [
+        'src',
+        'tools/msvs/genfiles',
+        'deps/v8/include',
+        'deps/cares/include',
+        'deps/uv/include',
+        'deps/sqlite',
+        'test/cctest',
+        'test/microbench',
+      ],
+
+      'defines': [
+        'NODE_ARCH="<(target_arch)"',
+        'NODE_PLATFORM="<(OS)"',
+        'NODE_WANT_INTERNALS=1',
+      ],
+
+      'sources': [ '<@(node_microbench_sources)' ],
+
+      'conditions': [
+        [ 'node_use_openssl=="true"', {
+          'defines': [
+            'HAVE_OPENSSL=1',
+          ],
+          'dependencies': [
+            'deps/ncrypto/ncrypto.gyp:ncrypto',
+          ],
+        }],
+        ['v8_enable_inspector==1', {
+          'defines': [
+            'HAVE_INSPECTOR=1',
+          ],
+        }, {
+           'defines': [
+             'HAVE_INSPECTOR=0',
+           ]
+        }],
+        ['OS=="solaris"', {
+          'ldflags': [ '-I<(SHARED_INTERMEDIATE_DIR)' ]
+        }],
+        # Skip microbench while building shared lib node for Windows
+        [ 'OS=="win" and node_shared=="true"', {
+          'type': 'none',
+        }],
+        [ 'node_shared=="true"', {
+          'xcode_settings': {
+            'OTHER_LDFLAGS': [ '-Wl,-rpath,@loader_path', ],
+          },
+        }],
+        ['OS=="win"', {
+          'libraries': [
+            'Dbghelp.lib',
+            'winmm.lib',
+            'Ws2_32.lib',
+          ],
+        }],
+        # Avoid excessive LTO
+        ['enable_lto=="true"', {
+          'ldflags': [ '-fno-lto' ],
+        }],
+      ],
+    }, # microbench
+
     {
       'target_name': 'embedtest',
       'type': 'executable',
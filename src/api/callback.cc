@@ -80,8 +80,12 @@ InternalCallbackScope::InternalCallbackScope(Environment* env,
 
   isolate->SetIdle(false);
 
-  prior_context_frame_.Reset(
-      isolate, async_context_frame::exchange(isolate, context_frame));
+  // Callbacks from the event loop start out in the undefined root frame,
+  // which does not need a Global to be restored.
+  Local<Value> prior_context_frame =
+      async_context_frame::exchange(isolate, context_frame);
+  if (!prior_context_frame->IsUndefined())
+    prior_context_frame_.Reset(isolate, prior_context_frame);
 
   env->async_hooks()->push_async_context(
     async_context_.async_id, async_context_.trigger_async_id, object);
@@ -127,7 +131,11 @@ void InternalCallbackScope::Close() {
   if (pushed_ids_) {
     env_->async_hooks()->pop_async_context(async_context_.async_id);
 
-    async_context_frame::exchange(isolate, prior_context_frame_.Get(isolate));
+    if (prior_context_frame_.IsEmpty()) {
+      async_context_frame::set(isolate, Undefined(isolate));
+    } else {
+      async_context_frame::set(isolate, prior_context_frame_.Get(isolate));
+    }
   }
 
   if (failed_) return;
@@ -140,6 +148,9 @@ void InternalCallbackScope::Close() {
 
   if (!env_->can_call_into_js()) return;
 
+  performance::LoopPhaseTimer::Scope phase_scope(
+      env_->loop_phase_timer(),
+      performance::NODE_PERFORMANCE_LOOP_PHASE_MICROTASKS);
   auto weakref_cleanup = OnScopeLeave([&]() { env_->RunWeakRefCleanup(); });
 
   Local<Context> context = env_->context();
@@ -3,6 +3,8 @@
 #include "node.h"
 #include "node_snapshot_builder.h"
 
+#include <algorithm>
+
 using v8::Context;
 using v8::Function;
 using v8::Global;
@@ -94,6 +96,8 @@ struct CommonEnvironmentSetup::Impl {
   uv_loop_t loop;
   std::shared_ptr<ArrayBufferAllocator> allocator;
   std::optional<SnapshotCreator> snapshot_creator;
+  // Whether the main context is deserialized from a snapshot.
+  bool has_snapshot = false;
   Isolate* isolate = nullptr;
   DeleteFnPtr<IsolateData, FreeIsolateData> isolate_data;
   DeleteFnPtr<Environment, FreeEnvironment> env;
@@ -157,25 +161,69 @@ CommonEnvironmentSetup::CommonEnvironmentSetup(
     impl_->isolate_data.reset(CreateIsolateData(
         isolate, loop, platform, impl_->allocator.get(), snapshot_data));
     impl_->isolate_data->set_snapshot_config(snapshot_config);
+    impl_->has_snapshot = snapshot_data != nullptr;
 
-    if (snapshot_data) {
-      impl_->env.reset(make_env(this));
-      if (impl_->env) {
-        impl_->main_context.Reset(isolate, impl_->env->context());
-      }
-      return;
-    }
+    CreateMainContextAndEnvironment(errors, make_env);
+  }
+}
 
-    Local<Context> context = NewContext(isolate);
-    impl_->main_context.Reset(isolate, context);
-    if (context.IsEmpty()) {
-      errors->push_back("Failed to initialize V8 Context");
-      return;
+void CommonEnvironmentSetup::CreateMainContextAndEnvironment(
+    std::vector<std::string>* errors,
+    const std::function<Environment*(const CommonEnvironmentSetup*)>&
+        make_env) {
+  Isolate* isolate = impl_->isolate;
+  if (impl_->has_snapshot) {
+    impl_->env.reset(make_env(this));
+    if (impl_->env) {
+      impl_->main_context.Reset(isolate, impl_->env->context());
     }
+    return;
+  }
 
-    Context::Scope context_scope(context);
-    impl_->env.reset(make_env(this));
+  Local<Context> context = NewContext(isolate);
+  impl_->main_context.Reset(isolate, context);
+  if (context.IsEmpty()) {
+    errors->push_back("Failed to initialize V8 Context");
+    return;
   }
+
+  Context::Scope context_scope(context);
+  impl_->env.reset(make_env(this));
+}
+
+bool CommonEnvironmentSetup::RecreateEnvironmentImpl(
+    std::vector<std::string>* errors,
+    const std::function<Environment*(const CommonEnvironmentSetup*)>&
+        make_env) {
+  CHECK_NOT_NULL(impl_->isolate);
+  CHECK(!impl_->snapshot_creator.has_value());
+  Isolate* isolate = impl_->isolate;
+  Locker locker(isolate);
+  Isolate::Scope isolate_scope(isolate);
+
+  impl_->main_context.Reset();
+  impl_->env.reset();
+  // Let V8 know that the old context is gone, so that it can be collected
+  // sooner.
+  isolate->ContextDisposedNotification();
+
+  HandleScope handle_scope(isolate);
+  TryCatch try_catch(isolate);
+  auto print_exception = OnScopeLeave([&]() {
+    if (try_catch.HasCaught()) {
+      errors->push_back(FormatCaughtException(
+          isolate, isolate->GetCurrentContext(), try_catch));
+    }
+  });
+
+  size_t error_count = errors->size();
+  CreateMainContextAndEnvironment(errors, make_env);
+  if (impl_->env) return true;
+
+  impl_->main_context.Reset();
+  if (errors->size() == error_count && !try_catch.HasCaught())
+    errors->push_back("Failed to create Environment");
+  return false;
 }
 
 CommonEnvironmentSetup::CommonEnvironmentSetup(
@@ -249,6 +297,57 @@ CommonEnvironmentSetup::~CommonEnvironmentSetup() {
   delete impl_;
 }
 
+struct CommonEnvironmentSetupPool::Impl {
+  size_t max_idle;
+  CreateCallback create;
+  ResetCallback reset;
+  std::vector<std::unique_ptr<CommonEnvironmentSetup>> idle;
+};
+
+CommonEnvironmentSetupPool::CommonEnvironmentSetupPool(size_t max_idle,
+                                                       CreateCallback create,
+                                                       ResetCallback reset)
+    : impl_(new Impl{max_idle, std::move(create), std::move(reset), {}}) {
+  CHECK(impl_->create);
+  CHECK(impl_->reset);
+}
+
+CommonEnvironmentSetupPool::~CommonEnvironmentSetupPool() {
+  delete impl_;
+}
+
+bool CommonEnvironmentSetupPool::Fill(size_t count,
+                                      std::vector<std::string>* errors) {
+  count = std::min(count, impl_->max_idle);
+  while (impl_->idle.size() < count) {
+    std::unique_ptr<CommonEnvironmentSetup> setup = impl_->create(errors);
+    if (!setup) return false;
+    impl_->idle.push_back(std::move(setup));
+  }
+  return true;
+}
+
+std::unique_ptr<CommonEnvironmentSetup> CommonEnvironmentSetupPool::Acquire(
+    std::vector<std::string>* errors) {
+  if (impl_->idle.empty()) return impl_->create(errors);
+  std::unique_ptr<CommonEnvironmentSetup> setup =
+      std::move(impl_->idle.back());
+  impl_->idle.pop_back();
+  return setup;
+}
+
+void CommonEnvironmentSetupPool::Release(
+    std::unique_ptr<CommonEnvironmentSetup> setup) {
+  if (!setup || impl_->idle.size() >= impl_->max_idle) return;
+  std::vector<std::string> errors;
+  if (!impl_->reset(setup.get(), &errors)) return;
+  impl_->idle.push_back(std::move(setup));
+}
+
+size_t CommonEnvironmentSetupPool::idle_count() const {
+  return impl_->idle.size();
+}
+
 EmbedderSnapshotData::Pointer CommonEnvironmentSetup::CreateSnapshot() {
   CHECK_NOT_NULL(snapshot_creator());
   SnapshotData* snapshot_data = new SnapshotData();
@@ -5,8 +5,10 @@
 #include "node_errors.h"
 #include "node_exit_code.h"
 #include "node_internals.h"
+#include "node_log_writer.h"
 #include "node_options-inl.h"
 #include "node_platform.h"
+#include "node_probes.h"
 #include "node_realm-inl.h"
 #include "node_shadow_realm.h"
 #include "node_snapshot_builder.h"
@@ -101,27 +103,107 @@ MaybeLocal<Value> PrepareStackTraceCallback(Local<Context> context,
   return result;
 }
 
-void* NodeArrayBufferAllocator::Allocate(size_t size) {
-  void* ret;
-  if (zero_fill_field_ || per_process::cli_options->zero_fill_all_buffers)
-    ret = allocator_->Allocate(size);
-  else
-    ret = allocator_->AllocateUninitialized(size);
+NodeArrayBufferAllocator::NodeArrayBufferAllocator()
+    : pool_limit_(static_cast<size_t>(
+          per_process::cli_options->array_buffer_pool_size)) {}
+
+NodeArrayBufferAllocator::~NodeArrayBufferAllocator() {
+  for (size_t i = 0; i < kPoolClassCount; i++) {
+    for (void* data : pool_[i])
+      allocator_->Free(data, PoolClassSize(i));
+  }
+}
+
+size_t NodeArrayBufferAllocator::PoolClassSize(size_t index) {
+  if (index == 0) return kPoolMinSize;
+  const size_t doubling = (index - 1) / kPoolClassesPerDoubling;
+  const size_t sub = (index - 1) % kPoolClassesPerDoubling;
+  const size_t base = kPoolMinSize << doubling;
+  return base + (sub + 1) * (base / kPoolClassesPerDoubling);
+}
+
+size_t NodeArrayBufferAllocator::PoolClass(size_t size,
+                                           size_t* class_size) const {
+  if (pool_limit_ == 0 || size == 0 || size > kPoolMaxSize)
+    return kPoolClassCount;
+  if (size <= kPoolMinSize) {
+    *class_size = kPoolMinSize;
+    return 0;
+  }
+  // base < size <= 2 * base, a range that is split into four classes.
+  size_t doubling = 0;
+  while ((kPoolMinSize << (doubling + 1)) < size) doubling++;
+  const size_t step = (kPoolMinSize << doubling) / kPoolClassesPerDoubling;
+  const size_t sub = (size - (kPoolMinSize << doubling) - 1) / step;
+  const size_t index = 1 + doubling * kPoolClassesPerDoubling + sub;
+  *class_size = PoolClassSize(index);
+  return index;
+}
+
+void* NodeArrayBufferAllocator::AllocateFromPool(size_t size, bool zero_fill) {
+  size_t class_size;
+  const size_t index = PoolClass(size, &class_size);
+  void* ret = nullptr;
+  if (index == kPoolClassCount) {
+    ret = zero_fill ? allocator_->Allocate(size)
+                    : allocator_->AllocateUninitialized(size);
+  } else {
+    {
+      Mutex::ScopedLock lock(pool_mutex_);
+      if (!pool_[index].empty()) {
+        ret = pool_[index].back();
+        pool_[index].pop_back();
+        pool_cached_bytes_ -= class_size;
+        pool_hits_++;
+      } else {
+        pool_misses_++;
+      }
+    }
+    if (ret != nullptr) {
+      if (zero_fill) memset(ret, 0, size);
+    } else {
+      ret = zero_fill ? allocator_->Allocate(class_size)
+                      : allocator_->AllocateUninitialized(class_size);
+    }
+  }
   if (LIKELY(ret != nullptr))
     total_mem_usage_.fetch_add(size, std::memory_order_relaxed);
   return ret;
 }
 
+void* NodeArrayBufferAllocator::Allocate(size_t size) {
+  return AllocateFromPool(
+      size,
+      zero_fill_field_ || per_process::cli_options->zero_fill_all_buffers);
+}
+
 void* NodeArrayBufferAllocator::AllocateUninitialized(size_t size) {
-  void* ret = allocator_->AllocateUninitialized(size);
-  if (LIKELY(ret != nullptr))
-    total_mem_usage_.fetch_add(size, std::memory_order_relaxed);
-  return ret;
+  return AllocateFromPool(size, false);
 }
 
 void NodeArrayBufferAllocator::Free(void* data, size_t size) {
   total_mem_usage_.fetch_sub(size, std::memory_order_relaxed);
-  allocator_->Free(data, size);
+  size_t class_size;
+  const size_t index = PoolClass(size, &class_size);
+  if (index == kPoolClassCount) {
+    allocator_->Free(data, size);
+    return;
+  }
+  {
+    Mutex::ScopedLock lock(pool_mutex_);
+    if (pool_cached_bytes_ + class_size <= pool_limit_) {
+      pool_[index].push_back(data);
+      pool_cached_bytes_ += class_size;
+      return;
+    }
+  }
+  allocator_->Free(data, class_size);
+}
+
+NodeArrayBufferAllocator::PoolStats
+NodeArrayBufferAllocator::GetPoolStats() const {
+  Mutex::ScopedLock lock(pool_mutex_);
+  return PoolStats { pool_hits_, pool_misses_, pool_cached_bytes_ };
 }
 
 DebuggingArrayBufferAllocator::~DebuggingArrayBufferAllocator() {
@@ -239,6 +321,22 @@ void SetIsolateErrorHandlers(v8::Isolate* isolate, const IsolateSettings& s) {
   }
 }
 
+#if NODE_USE_STATIC_PROBES
+static void GCStartProbe(Isolate* isolate,
+                         v8::GCType type,
+                         v8::GCCallbackFlags flags) {
+  if (NODE_PROBE_ENABLED(gc__start))
+    NODE_PROBE2(gc__start, static_cast<int>(type), static_cast<int>(flags));
+}
+
+static void GCDoneProbe(Isolate* isolate,
+                        v8::GCType type,
+                        v8::GCCallbackFlags flags) {
+  if (NODE_PROBE_ENABLED(gc__done))
+    NODE_PROBE2(gc__done, static_cast<int>(type), static_cast<int>(flags));
+}
+#endif  // NODE_USE_STATIC_PROBES
+
 void SetIsolateMiscHandlers(v8::Isolate* isolate, const IsolateSettings& s) {
   isolate->SetMicrotasksPolicy(s.policy);
 
@@ -276,6 +374,11 @@ void SetIsolateMiscHandlers(v8::Isolate* isolate, const IsolateSettings& s) {
 
   if (s.flags & DETAILED_SOURCE_POSITIONS_FOR_PROFILING)
     v8::CpuProfiler::UseDetailedSourcePositionsForProfiling(isolate);
+
+#if NODE_USE_STATIC_PROBES
+  isolate->AddGCPrologueCallback(GCStartProbe);
+  isolate->AddGCEpilogueCallback(GCDoneProbe);
+#endif  // NODE_USE_STATIC_PROBES
 }
 
 void SetIsolateUpForNode(v8::Isolate* isolate,
@@ -463,6 +566,8 @@ Environment* CreateEnvironment(
     return nullptr;
   }
 
+  env->performance_state()->Mark(
+      performance::NODE_PERFORMANCE_MILESTONE_ENVIRONMENT_CREATED);
   return env;
 }
 
@@ -885,6 +990,7 @@ void DefaultProcessExitHandlerInternal(Environment* env, ExitCode exit_code) {
   env->set_can_call_into_js(false);
   env->stop_sub_worker_contexts();
   env->isolate()->DumpAndResetStats();
+  log_writer::FlushAll();
   // The tracing agent could be in the process of writing data using the
   // threadpool. Stop it before shutting down libuv. The rest of the tracing
   // agent disposal will be performed in DisposePlatform().
@@ -23,14 +23,11 @@ namespace async_context_frame {
 //
 // Scope helper
 //
-Scope::Scope(Isolate* isolate, Local<Value> object) : isolate_(isolate) {
-  auto prior = exchange(isolate, object);
-  prior_.Reset(isolate, prior);
-}
+Scope::Scope(Isolate* isolate, Local<Value> object)
+    : isolate_(isolate), prior_(exchange(isolate, object)) {}
 
 Scope::~Scope() {
-  auto value = prior_.Get(isolate_);
-  set(isolate_, value);
+  set(isolate_, prior_);
 }
 
 Local<Value> current(Isolate* isolate) {
@@ -43,6 +40,14 @@ void set(Isolate* isolate, Local<Value> value) {
     return;
   }
 
+  // Frames are shared until a store is modified, so the new frame is often
+  // the current one already, for example the undefined root frame.
+  AliasedFloat64Array& counters = env->async_context_frame_counters();
+  if (current(isolate) == value) {
+    counters[kFrameSwitchesElided] += 1;
+    return;
+  }
+  counters[kFrameSwitches] += 1;
   isolate->SetContinuationPreservedEmbedderData(value);
 }
 
@@ -80,6 +85,24 @@ void CreatePerContextProperties(Local<Object> target,
             binding->Get(context, setContinuationPreservedEmbedderData)
                 .ToLocalChecked())
       .Check();
+
+  target
+      ->Set(context,
+            FIXED_ONE_BYTE_STRING(env->isolate(), "counters"),
+            env->async_context_frame_counters().GetJSArray())
+      .Check();
+
+  Local<Object> constants = Object::New(env->isolate());
+  NODE_DEFINE_CONSTANT(constants, kFramesCreated);
+  NODE_DEFINE_CONSTANT(constants, kFramesCopied);
+  NODE_DEFINE_CONSTANT(constants, kFrameSwitches);
+  NODE_DEFINE_CONSTANT(constants, kFrameSwitchesElided);
+  NODE_DEFINE_CONSTANT(constants, kCounterFieldsCount);
+  target
+      ->Set(context,
+            FIXED_ONE_BYTE_STRING(env->isolate(), "constants"),
+            constants)
+      .Check();
 }
 
 }  // namespace async_context_frame
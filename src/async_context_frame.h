@@ -11,14 +11,31 @@
 namespace node {
 namespace async_context_frame {
 
+// Counters of the Environment's async_context_frame_counters() array. Frames
+// are created and copied by the JavaScript side of AsyncLocalStorage, which
+// counts them itself. Switches are counted natively: a switch to the frame
+// that is already current is elided and costs no call into V8.
+enum CounterFields {
+  kFramesCreated,
+  kFramesCopied,
+  kFrameSwitches,
+  kFrameSwitchesElided,
+  kCounterFieldsCount
+};
+
+// Makes |object| the current frame until the scope ends. Like the Local it
+// takes, a Scope has to live inside a HandleScope, which also keeps the prior
+// frame alive.
 class Scope {
  public:
   explicit Scope(v8::Isolate* isolate, v8::Local<v8::Value> object);
   ~Scope();
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
 
  private:
   v8::Isolate* isolate_;
-  v8::Global<v8::Value> prior_;
+  v8::Local<v8::Value> prior_;
 };
 
 v8::Local<v8::Value> current(v8::Isolate* isolate);
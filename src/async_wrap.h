@@ -60,12 +60,14 @@ namespace node {
   V(PROCESSWRAP)                                                               \
   V(PROMISE)                                                                   \
   V(QUERYWRAP)                                                                 \
+  V(RINGCHANNEL)                                                               \
   V(QUIC_ENDPOINT)                                                             \
   V(QUIC_LOGSTREAM)                                                            \
   V(QUIC_PACKET)                                                               \
   V(QUIC_SESSION)                                                              \
   V(QUIC_STREAM)                                                               \
   V(QUIC_UDP)                                                                  \
+  V(SHMCHANNELWRAP)                                                            \
   V(SHUTDOWNWRAP)                                                              \
   V(SIGNALWRAP)                                                                \
   V(STATWATCHER)                                                               \
@@ -43,6 +43,9 @@ BaseObject::~BaseObject() {
     return;
   }
 
+  // This is done during environment teardown too: cleanup hooks that run
+  // later in the drain may still unwrap this object, and Realm::~Realm()
+  // checks that every BaseObject is gone before the isolate is disposed.
   {
     HandleScope handle_scope(realm()->isolate());
     object()->SetAlignedPointerInInternalField(BaseObject::kSlot, nullptr);
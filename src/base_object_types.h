@@ -29,7 +29,8 @@ namespace node {
 // The first argument should match what the type passes to
 // SET_OBJECT_ID(), the second argument should match the C++ class
 // name.
-#define SERIALIZABLE_NON_BINDING_TYPES(V)
+#define SERIALIZABLE_NON_BINDING_TYPES(V)                                      \
+  V(module_wrap, loader::ModuleWrap)
 
 // Helper list of all binding data wrapper types.
 #define BINDING_TYPES(V)                                                       \
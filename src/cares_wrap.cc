@@ -34,8 +34,10 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <vector>
 #include <unordered_set>
@@ -70,11 +72,94 @@ using v8::Local;
 using v8::Maybe;
 using v8::Nothing;
 using v8::Null;
+using v8::Number;
 using v8::Object;
 using v8::String;
 using v8::Uint32;
 using v8::Value;
 
+DnsCache* DnsCache::Get() {
+  return &LeakedSingleton<DnsCache>::Get();
+}
+
+void DnsCache::Configure(const Config& config) {
+  Mutex::ScopedLock lock(mutex_);
+  config_ = config;
+  config_.max_ttl = std::max(config_.max_ttl, config_.min_ttl);
+  entries_.clear();
+  enabled_.store(config_.enabled && config_.max_entries > 0,
+                 std::memory_order_relaxed);
+}
+
+std::string DnsCache::LookupKey(std::string_view hostname,
+                                int family,
+                                int flags) {
+  return std::to_string(family) + ":" + std::to_string(flags) + ":" +
+         std::string(hostname);
+}
+
+bool DnsCache::Find(const std::string& key,
+                    int* status,
+                    std::vector<Address>* addresses) {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.expires_at <= uv_hrtime()) {
+    entries_.erase(it);
+    it = entries_.end();
+  }
+  if (it == entries_.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  *status = it->second.status;
+  *addresses = it->second.addresses;
+  return true;
+}
+
+void DnsCache::Insert(const std::string& key,
+                      int status,
+                      std::vector<Address>&& addresses,
+                      uint32_t ttl) {
+  Mutex::ScopedLock lock(mutex_);
+  if (!enabled()) return;
+  if (status == 0) {
+    ttl = std::clamp(ttl, config_.min_ttl, config_.max_ttl);
+  } else {
+    ttl = config_.negative_ttl;
+  }
+  if (ttl == 0) return;
+
+  uint64_t now = uv_hrtime();
+  if (entries_.size() >= config_.max_entries &&
+      entries_.find(key) == entries_.end()) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.expires_at <= now) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    // Still full, so make room for the new entry.
+    if (entries_.size() >= config_.max_entries) {
+      entries_.erase(entries_.begin());
+    }
+  }
+  entries_.insert_or_assign(
+      key,
+      Entry{status, std::move(addresses), now + uint64_t{ttl} * 1000000000});
+}
+
+void DnsCache::Flush() {
+  Mutex::ScopedLock lock(mutex_);
+  entries_.clear();
+}
+
+size_t DnsCache::size() const {
+  Mutex::ScopedLock lock(mutex_);
+  return entries_.size();
+}
+
 namespace {
 
 Mutex ares_library_mutex;
@@ -666,12 +751,141 @@ void ChannelWrap::New(const FunctionCallbackInfo<Value>& args) {
   new ChannelWrap(env, args.This(), timeout, tries);
 }
 
+namespace {
+
+// The dispatched lookups of each environment on this thread, by lookup key.
+std::map<std::pair<Environment*, std::string>, GetAddrInfoReqWrap*>&
+InFlightLookups() {
+  thread_local std::map<std::pair<Environment*, std::string>,
+                        GetAddrInfoReqWrap*>
+      lookups;
+  return lookups;
+}
+
+}  // anonymous namespace
+
 GetAddrInfoReqWrap::GetAddrInfoReqWrap(Environment* env,
                                        Local<Object> req_wrap_obj,
                                        uint8_t order)
     : ReqWrap(env, req_wrap_obj, AsyncWrap::PROVIDER_GETADDRINFOREQWRAP),
       order_(order) {}
 
+GetAddrInfoReqWrap::~GetAddrInfoReqWrap() {
+  if (in_flight_) InFlightLookups().erase({env(), lookup_key_});
+}
+
+LookupWrap::LookupWrap(ChannelWrap* channel, Local<Object> req_wrap_obj)
+    : AsyncWrap(channel->env(), req_wrap_obj, AsyncWrap::PROVIDER_QUERYWRAP),
+      channel_(channel) {}
+
+LookupWrap::~LookupWrap() {
+  for (CallbackData* data : callbacks_) data->wrap = nullptr;
+}
+
+void LookupWrap::Send(const char* name, int family) {
+  channel_->EnsureServers();
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN1(TRACING_CATEGORY_NODE2(dns, native),
+                                    "lookup",
+                                    this,
+                                    "hostname",
+                                    TRACE_STR_COPY(name));
+  // AAAA first, as RFC 8305 recommends. c-ares may call back synchronously,
+  // so count both queries before sending either.
+  std::vector<int> families;
+  if (family != 4) families.push_back(AF_INET6);
+  if (family != 6) families.push_back(AF_INET);
+  pending_ = families.size();
+  for (int af : families) {
+    auto data = new CallbackData{this, af};
+    callbacks_.push_back(data);
+    channel_->ModifyActivityQueryCount(1);
+    ares_gethostbyname(channel_->cares_channel(), name, af, Callback, data);
+  }
+}
+
+void LookupWrap::Callback(void* arg,
+                          int status,
+                          int timeouts,
+                          struct hostent* host) {
+  std::unique_ptr<CallbackData> data{static_cast<CallbackData*>(arg)};
+  LookupWrap* wrap = data->wrap;
+  if (wrap == nullptr) return;
+  auto& callbacks = wrap->callbacks_;
+  callbacks.erase(std::find(callbacks.begin(), callbacks.end(), data.get()));
+
+  std::vector<std::string> addresses;
+  if (status == ARES_SUCCESS && host != nullptr) {
+    for (int i = 0; host->h_addr_list[i] != nullptr; i++) {
+      char ip[INET6_ADDRSTRLEN];
+      if (uv_inet_ntop(host->h_addrtype, host->h_addr_list[i], ip, sizeof(ip)))
+        continue;
+      addresses.emplace_back(ip);
+    }
+  }
+
+  wrap->channel_->set_query_last_ok(status != ARES_ECONNREFUSED);
+  wrap->channel_->ModifyActivityQueryCount(-1);
+
+  BaseObjectPtr<LookupWrap> strong_ref{wrap};
+  wrap->env()->SetImmediate([strong_ref,
+                             family = data->family,
+                             status,
+                             addresses = std::move(addresses)](
+                                Environment*) mutable {
+    strong_ref->OnAnswer(family, status, std::move(addresses));
+  });
+}
+
+void LookupWrap::OnAnswer(int family,
+                          int status,
+                          std::vector<std::string>&& addresses) {
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  if (!addresses.empty()) {
+    answered_ = true;
+    MaybeStackBuffer<Local<Value>, 8> ips(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+      ips[i] = OneByteString(isolate, addresses[i].data(), addresses[i].size());
+    }
+    Local<Value> argv[] = {
+        Integer::New(isolate, family == AF_INET6 ? 6 : 4),
+        Array::New(isolate, ips.out(), addresses.size()),
+    };
+    MakeCallback(env()->onanswer_string(), arraysize(argv), argv);
+  } else if (first_error_ == ARES_SUCCESS) {
+    first_error_ = status == ARES_SUCCESS ? ARES_ENODATA : status;
+  }
+
+  if (--pending_ > 0) return;
+
+  TRACE_EVENT_NESTABLE_ASYNC_END1(
+      TRACING_CATEGORY_NODE2(dns, native), "lookup", this, "answered",
+      answered_);
+  Local<Value> arg = Integer::New(isolate, 0);
+  if (!answered_) arg = OneByteString(isolate, ToErrorCodeString(first_error_));
+  MakeCallback(env()->oncomplete_string(), 1, &arg);
+  // Deleted once the caller's strong reference goes out of scope.
+  Detach();
+}
+
+static void Lookup(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  ChannelWrap* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsString());
+  CHECK(args[2]->IsInt32());
+
+  node::Utf8Value hostname(env->isolate(), args[1]);
+  std::string ascii_hostname = ada::idna::to_ascii(hostname.ToStringView());
+  auto wrap = new LookupWrap(channel, args[0].As<Object>());
+  wrap->Send(ascii_hostname.c_str(), args[2].As<Int32>()->Value());
+  args.GetReturnValue().Set(0);
+}
+
 GetNameInfoReqWrap::GetNameInfoReqWrap(
     Environment* env,
     Local<Object> req_wrap_obj)
@@ -1430,10 +1644,11 @@ static void Query(const FunctionCallbackInfo<Value>& args) {
 }
 
 
-void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
-  auto cleanup = OnScopeLeave([&]() { uv_freeaddrinfo(res); });
-  BaseObjectPtr<GetAddrInfoReqWrap> req_wrap{
-      static_cast<GetAddrInfoReqWrap*>(req->data)};
+// Calls back into JavaScript with the addresses of a lookup, in the order
+// requested by |req_wrap|.
+void EmitLookupResult(GetAddrInfoReqWrap* req_wrap,
+                      int status,
+                      const std::vector<DnsCache::Address>& addresses) {
   Environment* env = req_wrap->env();
 
   HandleScope handle_scope(env->isolate());
@@ -1451,25 +1666,14 @@ void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
     Local<Array> results = Array::New(env->isolate());
 
     auto add = [&] (bool want_ipv4, bool want_ipv6) -> Maybe<bool> {
-      for (auto p = res; p != nullptr; p = p->ai_next) {
-        CHECK_EQ(p->ai_socktype, SOCK_STREAM);
-
-        const char* addr;
-        if (want_ipv4 && p->ai_family == AF_INET) {
-          addr = reinterpret_cast<char*>(
-              &(reinterpret_cast<struct sockaddr_in*>(p->ai_addr)->sin_addr));
-        } else if (want_ipv6 && p->ai_family == AF_INET6) {
-          addr = reinterpret_cast<char*>(
-              &(reinterpret_cast<struct sockaddr_in6*>(p->ai_addr)->sin6_addr));
-        } else {
+      for (const DnsCache::Address& address : addresses) {
+        if (!(want_ipv4 && address.family == AF_INET) &&
+            !(want_ipv6 && address.family == AF_INET6)) {
           continue;
         }
 
-        char ip[INET6_ADDRSTRLEN];
-        if (uv_inet_ntop(p->ai_family, addr, ip, sizeof(ip)))
-          continue;
-
-        Local<String> s = OneByteString(env->isolate(), ip);
+        Local<String> s = OneByteString(
+            env->isolate(), address.ip.data(), address.ip.size());
         if (results->Set(env->context(), n, s).IsNothing())
           return Nothing<bool>();
         n++;
@@ -1504,7 +1708,7 @@ void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
 
   TRACE_EVENT_NESTABLE_ASYNC_END2(TRACING_CATEGORY_NODE2(dns, native),
                                   "lookup",
-                                  req_wrap.get(),
+                                  req_wrap,
                                   "count",
                                   n,
                                   "order",
@@ -1514,6 +1718,59 @@ void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
   req_wrap->MakeCallback(env->oncomplete_string(), arraysize(argv), argv);
 }
 
+void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  auto cleanup = OnScopeLeave([&]() { uv_freeaddrinfo(res); });
+  BaseObjectPtr<GetAddrInfoReqWrap> req_wrap{
+      static_cast<GetAddrInfoReqWrap*>(req->data)};
+
+  std::vector<DnsCache::Address> addresses;
+  if (status == 0) {
+    for (auto p = res; p != nullptr; p = p->ai_next) {
+      CHECK_EQ(p->ai_socktype, SOCK_STREAM);
+
+      const char* addr;
+      if (p->ai_family == AF_INET) {
+        addr = reinterpret_cast<char*>(
+            &(reinterpret_cast<struct sockaddr_in*>(p->ai_addr)->sin_addr));
+      } else if (p->ai_family == AF_INET6) {
+        addr = reinterpret_cast<char*>(
+            &(reinterpret_cast<struct sockaddr_in6*>(p->ai_addr)->sin6_addr));
+      } else {
+        continue;
+      }
+
+      char ip[INET6_ADDRSTRLEN];
+      if (uv_inet_ntop(p->ai_family, addr, ip, sizeof(ip)))
+        continue;
+
+      addresses.push_back({p->ai_family, ip});
+    }
+  }
+
+  // Only cache answers, not transient failures like UV_EAI_AGAIN.
+  if (DnsCache::Get()->enabled() &&
+      (status == 0 || status == UV_EAI_NONAME || status == UV_EAI_NODATA)) {
+    // getaddrinfo() does not report TTLs, so the cache's maximum is used.
+    DnsCache::Get()->Insert(req_wrap->lookup_key(),
+                            status,
+                            std::vector<DnsCache::Address>(addresses),
+                            UINT32_MAX);
+  }
+
+  // Lookups started from the callbacks below are dispatched again.
+  InFlightLookups().erase({req_wrap->env(), req_wrap->lookup_key()});
+  req_wrap->set_in_flight(false);
+  std::vector<GetAddrInfoReqWrap*> followers;
+  followers.swap(*req_wrap->followers());
+
+  EmitLookupResult(req_wrap.get(), status, addresses);
+  for (GetAddrInfoReqWrap* follower : followers) {
+    BaseObjectPtr<GetAddrInfoReqWrap> ptr{follower};
+    ptr->Detach();
+    EmitLookupResult(ptr.get(), status, addresses);
+  }
+}
+
 
 void AfterGetNameInfo(uv_getnameinfo_t* req,
                       int status,
@@ -1621,6 +1878,32 @@ void GetAddrInfo(const FunctionCallbackInfo<Value>& args) {
   auto req_wrap =
       std::make_unique<GetAddrInfoReqWrap>(env, req_wrap_obj, order->Value());
 
+  req_wrap->lookup_key() = DnsCache::LookupKey(ascii_hostname, family, flags);
+  DnsCache* cache = DnsCache::Get();
+  if (cache->enabled()) {
+    int status;
+    std::vector<DnsCache::Address> addresses;
+    if (cache->Find(req_wrap->lookup_key(), &status, &addresses)) {
+      TRACE_EVENT_NESTABLE_ASYNC_BEGIN1(TRACING_CATEGORY_NODE2(dns, native),
+                                        "lookup",
+                                        req_wrap.get(),
+                                        "hostname",
+                                        TRACE_STR_COPY(ascii_hostname.data()));
+      // The callback must still be asynchronous. Like Dispatch(), keep the
+      // request alive until then.
+      req_wrap->ClearWeak();
+      env->SetImmediate([req_wrap = req_wrap.release(),
+                         status,
+                         addresses = std::move(addresses)](Environment* env) {
+        BaseObjectPtr<GetAddrInfoReqWrap> ptr{req_wrap};
+        ptr->Detach();
+        EmitLookupResult(ptr.get(), status, addresses);
+      });
+      args.GetReturnValue().Set(0);
+      return;
+    }
+  }
+
   struct addrinfo hints;
   memset(&hints, 0, sizeof(hints));
   hints.ai_family = family;
@@ -1637,11 +1920,25 @@ void GetAddrInfo(const FunctionCallbackInfo<Value>& args) {
                                     : family == AF_INET6 ? "ipv6"
                                                          : "unspec");
 
+  // Attach to an identical lookup that is in flight, which answers this one
+  // too, rather than occupying another threadpool thread.
+  auto in_flight = InFlightLookups().find({env, req_wrap->lookup_key()});
+  if (in_flight != InFlightLookups().end()) {
+    req_wrap->ClearWeak();
+    in_flight->second->followers()->push_back(req_wrap.release());
+    args.GetReturnValue().Set(0);
+    return;
+  }
+
   int err = req_wrap->Dispatch(
       uv_getaddrinfo, AfterGetAddrInfo, ascii_hostname.data(), nullptr, &hints);
-  if (err == 0)
+  if (err == 0) {
+    InFlightLookups().emplace(
+        std::make_pair(env, req_wrap->lookup_key()), req_wrap.get());
+    req_wrap->set_in_flight(true);
     // Release ownership of the pointer allowing the ownership to be transferred
     USE(req_wrap.release());
+  }
 
   args.GetReturnValue().Set(err);
 }
@@ -1910,6 +2207,34 @@ inline void safe_free_hostent(struct hostent* host) {
   free(host);
 }
 
+void ConfigureDnsCache(const FunctionCallbackInfo<Value>& args) {
+  CHECK_EQ(args.Length(), 5);
+  CHECK(args[0]->IsBoolean());
+  for (int i = 1; i < 5; i++) CHECK(args[i]->IsUint32());
+  DnsCache::Config config;
+  config.enabled = args[0]->IsTrue();
+  config.min_ttl = args[1].As<Uint32>()->Value();
+  config.max_ttl = args[2].As<Uint32>()->Value();
+  config.negative_ttl = args[3].As<Uint32>()->Value();
+  config.max_entries = args[4].As<Uint32>()->Value();
+  DnsCache::Get()->Configure(config);
+}
+
+void FlushDnsCache(const FunctionCallbackInfo<Value>& args) {
+  DnsCache::Get()->Flush();
+}
+
+void GetDnsCacheStats(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  DnsCache* cache = DnsCache::Get();
+  Local<Value> stats[] = {
+      Number::New(isolate, static_cast<double>(cache->hits())),
+      Number::New(isolate, static_cast<double>(cache->misses())),
+      Number::New(isolate, static_cast<double>(cache->size())),
+  };
+  args.GetReturnValue().Set(Array::New(isolate, stats, arraysize(stats)));
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -1924,6 +2249,9 @@ void Initialize(Local<Object> target,
       context, target, "convertIpv6StringToBuffer", ConvertIpv6StringToBuffer);
 
   SetMethod(context, target, "strerror", StrError);
+  SetMethod(context, target, "configureDnsCache", ConfigureDnsCache);
+  SetMethod(context, target, "flushDnsCache", FlushDnsCache);
+  SetMethodNoSideEffect(context, target, "getDnsCacheStats", GetDnsCacheStats);
 
   target->Set(env->context(), FIXED_ONE_BYTE_STRING(env->isolate(), "AF_INET"),
               Integer::New(env->isolate(), AF_INET)).Check();
@@ -2007,6 +2335,7 @@ void Initialize(Local<Object> target,
   SetProtoMethod(isolate, channel_wrap, "setServers", SetServers);
   SetProtoMethod(isolate, channel_wrap, "setLocalAddress", SetLocalAddress);
   SetProtoMethod(isolate, channel_wrap, "cancel", Cancel);
+  SetProtoMethod(isolate, channel_wrap, "lookup", Lookup);
 
   SetConstructorFunction(context, target, "ChannelWrap", channel_wrap);
 }
@@ -2017,6 +2346,9 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(CanonicalizeIP);
   registry->Register(ConvertIpv6StringToBuffer);
   registry->Register(StrError);
+  registry->Register(ConfigureDnsCache);
+  registry->Register(FlushDnsCache);
+  registry->Register(GetDnsCacheStats);
   registry->Register(ChannelWrap::New);
 
   registry->Register(Query<QueryAnyWrap>);
@@ -2037,6 +2369,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(SetServers);
   registry->Register(SetLocalAddress);
   registry->Register(Cancel);
+  registry->Register(Lookup);
 }
 
 }  // namespace cares_wrap
@@ -11,13 +11,19 @@
 #include "memory_tracker.h"
 #include "node.h"
 #include "node_internals.h"
+#include "node_mutex.h"
 #include "util.h"
 
 #include "ares.h"
 #include "v8.h"
 #include "uv.h"
 
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #ifdef __POSIX__
 # include <netdb.h>
@@ -175,6 +181,12 @@ class ChannelWrap final : public AsyncWrap {
   }
   inline int active_query_count() { return active_query_count_; }
   inline NodeAresTask::List* task_list() { return &task_list_; }
+  // The queries sent through ares_query() that have not been answered yet,
+  // by type, class and name. Identical queries attach to these instead of
+  // being sent again. The values are QueryWrap<Traits> of the type.
+  inline std::unordered_map<std::string, void*>* pending_queries() {
+    return &pending_queries_;
+  }
 
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(ChannelWrap)
@@ -192,6 +204,74 @@ class ChannelWrap final : public AsyncWrap {
   int tries_;
   int active_query_count_ = 0;
   NodeAresTask::List task_list_;
+  std::unordered_map<std::string, void*> pending_queries_;
+};
+
+// A process-wide cache of resolved addresses, shared by all environments
+// including workers. It serves dns.lookup() and is only filled by its
+// results. The answers of c-ares queries are kept out of it, since a
+// Resolver with its own servers must not change what dns.lookup() returns
+// for the rest of the process, which follows /etc/hosts and nsswitch.
+// It is disabled until it is configured.
+class DnsCache final {
+ public:
+  struct Address {
+    int family;
+    std::string ip;
+  };
+
+  struct Config {
+    bool enabled = false;
+    // TTLs in seconds. Answers are kept for their TTL clamped to
+    // [min_ttl, max_ttl]. dns.lookup() results have no TTL, so they are kept
+    // for max_ttl. Failures to resolve a name are kept for negative_ttl.
+    uint32_t min_ttl = 0;
+    uint32_t max_ttl = 300;
+    uint32_t negative_ttl = 0;
+    size_t max_entries = 1024;
+  };
+
+  static DnsCache* Get();
+
+  // Replaces the configuration and empties the cache.
+  void Configure(const Config& config);
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  static std::string LookupKey(std::string_view hostname,
+                               int family,
+                               int flags);
+
+  // Returns true if |key| is cached. |status| is 0 for addresses, or the
+  // libuv error of a cached failure.
+  bool Find(const std::string& key,
+            int* status,
+            std::vector<Address>* addresses);
+  void Insert(const std::string& key,
+              int status,
+              std::vector<Address>&& addresses,
+              uint32_t ttl);
+  void Flush();
+
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+  size_t size() const;
+
+ private:
+  struct Entry {
+    int status;
+    std::vector<Address> addresses;
+    uint64_t expires_at;
+  };
+
+  friend class LeakedSingleton<DnsCache>;
+  DnsCache() = default;
+
+  mutable Mutex mutex_;
+  Config config_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
 };
 
 class GetAddrInfoReqWrap final : public ReqWrap<uv_getaddrinfo_t> {
@@ -199,15 +279,65 @@ class GetAddrInfoReqWrap final : public ReqWrap<uv_getaddrinfo_t> {
   GetAddrInfoReqWrap(Environment* env,
                      v8::Local<v8::Object> req_wrap_obj,
                      uint8_t order);
+  ~GetAddrInfoReqWrap() override;
 
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(GetAddrInfoReqWrap)
   SET_SELF_SIZE(GetAddrInfoReqWrap)
 
   uint8_t order() const { return order_; }
+  // The hostname, family and flags of the lookup, as a DnsCache key.
+  std::string& lookup_key() { return lookup_key_; }
+  // Identical lookups that arrived while this one was in flight. They are
+  // answered with its result instead of being dispatched themselves.
+  std::vector<GetAddrInfoReqWrap*>* followers() { return &followers_; }
+  void set_in_flight(bool in_flight) { in_flight_ = in_flight; }
 
  private:
   const uint8_t order_;
+  std::string lookup_key_;
+  std::vector<GetAddrInfoReqWrap*> followers_;
+  // Whether this lookup is in the in-flight table of its environment.
+  bool in_flight_ = false;
+};
+
+// A lookup that resolves addresses through c-ares on the event loop instead
+// of getaddrinfo() on the threadpool. The hosts file is honored, and both
+// families are queried concurrently. The addresses of each family are
+// reported through onanswer(family, addresses) as soon as they arrive, so
+// that connecting can start with the first answer (RFC 8305). It ends with
+// oncomplete(error), where error is 0 if any family had addresses.
+class LookupWrap final : public AsyncWrap {
+ public:
+  LookupWrap(ChannelWrap* channel, v8::Local<v8::Object> req_wrap_obj);
+  ~LookupWrap() override;
+
+  // Starts the queries. |family| is 4, 6, or 0 for both.
+  void Send(const char* name, int family);
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(LookupWrap)
+  SET_SELF_SIZE(LookupWrap)
+
+ private:
+  // The argument of a c-ares callback. |wrap| is reset if the wrap is
+  // destroyed before c-ares calls back.
+  struct CallbackData {
+    LookupWrap* wrap;
+    int family;
+  };
+
+  static void Callback(void* arg,
+                       int status,
+                       int timeouts,
+                       struct hostent* host);
+  void OnAnswer(int family, int status, std::vector<std::string>&& addresses);
+
+  BaseObjectPtr<ChannelWrap> channel_;
+  std::vector<CallbackData*> callbacks_;
+  int pending_ = 0;
+  int first_error_ = ARES_SUCCESS;
+  bool answered_ = false;
 };
 
 class GetNameInfoReqWrap final : public ReqWrap<uv_getnameinfo_t> {
@@ -237,6 +367,8 @@ class QueryWrap final : public AsyncWrap {
   ~QueryWrap() {
     CHECK_EQ(false, persistent().IsEmpty());
 
+    RemovePendingQuery();
+
     // Let Callback() know that this object no longer exists.
     if (callback_ptr_ != nullptr)
       *callback_ptr_ = nullptr;
@@ -248,9 +380,22 @@ class QueryWrap final : public AsyncWrap {
 
   void AresQuery(const char* name, int dnsclass, int type) {
     channel_->EnsureServers();
+    name_ = name;
     TRACE_EVENT_NESTABLE_ASYNC_BEGIN1(
       TRACING_CATEGORY_NODE2(dns, native), trace_name_, this,
       "name", TRACE_STR_COPY(name));
+
+    pending_key_ = std::string(trace_name_) + ":" + std::to_string(dnsclass) +
+                   ":" + std::to_string(type) + ":" + name;
+    auto pending = channel_->pending_queries()->emplace(pending_key_, this);
+    if (!pending.second) {
+      // An identical query is in flight, answer this one with its result.
+      static_cast<QueryWrap<Traits>*>(pending.first->second)
+          ->followers_.push_back(this);
+      pending_key_.clear();
+      return;
+    }
+
     ares_query(
         channel_->cares_channel(),
         name,
@@ -273,6 +418,7 @@ class QueryWrap final : public AsyncWrap {
   }
 
   const BaseObjectPtr<ChannelWrap>& channel() const { return channel_; }
+  const std::string& name() const { return name_; }
 
   void AfterResponse() {
     CHECK(response_data_);
@@ -325,6 +471,22 @@ class QueryWrap final : public AsyncWrap {
     data->is_host = false;
     data->buf = MallocedBuffer<unsigned char>(buf_copy, answer_len);
 
+    wrap->RemovePendingQuery();
+    for (QueryWrap<Traits>* follower : wrap->followers_) {
+      unsigned char* follower_buf = nullptr;
+      if (buf_copy != nullptr) {
+        follower_buf = node::Malloc<unsigned char>(answer_len);
+        memcpy(follower_buf, buf_copy, answer_len);
+      }
+      follower->response_data_ = std::make_unique<ResponseData>();
+      follower->response_data_->status = status;
+      follower->response_data_->is_host = false;
+      follower->response_data_->buf =
+          MallocedBuffer<unsigned char>(follower_buf, answer_len);
+      follower->QueueResponseCallback(status);
+    }
+    wrap->followers_.clear();
+
     wrap->QueueResponseCallback(status);
   }
 
@@ -351,6 +513,12 @@ class QueryWrap final : public AsyncWrap {
     wrap->QueueResponseCallback(status);
   }
 
+  void RemovePendingQuery() {
+    if (pending_key_.empty()) return;
+    channel_->pending_queries()->erase(pending_key_);
+    pending_key_.clear();
+  }
+
   void QueueResponseCallback(int status) {
     BaseObjectPtr<QueryWrap<Traits>> strong_ref{this};
     env()->SetImmediate([this, strong_ref](Environment*) {
@@ -396,6 +564,12 @@ class QueryWrap final : public AsyncWrap {
 
   std::unique_ptr<ResponseData> response_data_;
   const char* trace_name_;
+  // The queried name, so that A and AAAA answers can fill the DnsCache.
+  std::string name_;
+  // The key of this query in the channel's pending queries, if it was sent.
+  std::string pending_key_;
+  // Identical queries that are answered with the response to this one.
+  std::vector<QueryWrap<Traits>*> followers_;
   // Pointer to pointer to 'this' that can be reset from the destructor,
   // in order to let Callback() know that 'this' no longer exists.
   QueryWrap<Traits>** callback_ptr_ = nullptr;
@@ -6,7 +6,6 @@
 #include <cstddef>
 #include <cstdint>
 #include <unordered_set>
-#include <vector>
 
 #include "memory_tracker.h"
 
@@ -33,18 +32,15 @@ class CleanupQueue : public MemoryRetainer {
   inline void Remove(Callback cb, void* arg);
   void Drain();
 
+  // Calls |iterator| for the BaseObjects in the queue, most recently added
+  // first. |iterator| must not add or remove hooks.
   template <typename T>
   inline void ForEachBaseObject(T&& iterator) const;
 
  private:
   class CleanupHookCallback {
    public:
-    CleanupHookCallback(Callback fn,
-                        void* arg,
-                        uint64_t insertion_order_counter)
-        : fn_(fn),
-          arg_(arg),
-          insertion_order_counter_(insertion_order_counter) {}
+    CleanupHookCallback(Callback fn, void* arg) : fn_(fn), arg_(arg) {}
 
     // Only hashes `arg_`, since that is usually enough to identify the hook.
     struct Hash {
@@ -62,20 +58,25 @@ class CleanupQueue : public MemoryRetainer {
     Callback fn_;
     void* arg_;
 
-    // We keep track of the insertion order for these objects, so that we can
-    // call the callbacks in reverse order when we are cleaning up.
-    uint64_t insertion_order_counter_;
+    // The hooks also form a list in insertion order, so that the callbacks
+    // can be called in reverse order when we are cleaning up without
+    // sorting them first. The links are not part of the key.
+    mutable const CleanupHookCallback* prev_ = nullptr;
+    mutable const CleanupHookCallback* next_ = nullptr;
   };
 
-  std::vector<CleanupHookCallback> GetOrdered() const;
+  inline void Unlink(const CleanupHookCallback* hook);
   inline BaseObject* GetBaseObject(const CleanupHookCallback& callback) const;
 
   // Use an unordered_set, so that we have efficient insertion and removal.
+  // Its nodes are stable, so they can be linked to each other.
   std::unordered_set<CleanupHookCallback,
                      CleanupHookCallback::Hash,
                      CleanupHookCallback::Equal>
       cleanup_hooks_;
-  uint64_t cleanup_hook_counter_ = 0;
+  // The oldest and the most recently added hook.
+  const CleanupHookCallback* head_ = nullptr;
+  const CleanupHookCallback* tail_ = nullptr;
 };
 
 }  // namespace node
@@ -1,5 +1,9 @@
 #include "compile_cache.h"
+#include <limits>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 #include "debug_utils-inl.h"
 #include "env-inl.h"
 #include "node_file.h"
@@ -8,6 +12,10 @@
 #include "path.h"
 #include "zlib.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 namespace node {
 std::string Uint32ToHex(uint32_t crc) {
   std::string str;
@@ -43,6 +51,24 @@ std::string GetCacheVersionTag() {
   return tag;
 }
 
+const char* GetCachedCodeTypeName(CachedCodeType type) {
+  switch (type) {
+    case CachedCodeType::kCommonJS:
+      return "CommonJS";
+    case CachedCodeType::kESM:
+      return "ESM";
+    case CachedCodeType::kCommonJSExports:
+      return "CommonJS exports of";
+    case CachedCodeType::kBuiltin:
+      return "builtin";
+    case CachedCodeType::kVmScript:
+      return "vm script";
+    case CachedCodeType::kWasm:
+      return "wasm module";
+  }
+  UNREACHABLE();
+}
+
 uint32_t GetCacheKey(std::string_view filename, CachedCodeType type) {
   uLong crc = crc32(0L, Z_NULL, 0);
   crc = crc32(crc, reinterpret_cast<const Bytef*>(&type), sizeof(type));
@@ -61,6 +87,12 @@ inline void CompileCacheHandler::Debug(const char* format,
 
 v8::ScriptCompiler::CachedData* CompileCacheEntry::CopyCache() const {
   DCHECK_NOT_NULL(cache);
+  if (cache->buffer_policy == v8::ScriptCompiler::CachedData::BufferNotOwned) {
+    return new v8::ScriptCompiler::CachedData(
+        cache->data,
+        cache->length,
+        v8::ScriptCompiler::CachedData::BufferNotOwned);
+  }
   int cache_size = cache->length;
   uint8_t* data = new uint8_t[cache_size];
   memcpy(data, cache->data, cache_size);
@@ -71,11 +103,166 @@ v8::ScriptCompiler::CachedData* CompileCacheEntry::CopyCache() const {
 // Used for identifying and verifying a file is a compile cache file.
 // See comments in CompileCacheHandler::Persist().
 constexpr uint32_t kCacheMagicNumber = 0x8adfdbb2;
+// Used for identifying and verifying a packed compile cache file.
+// See comments in CompileCacheHandler::PersistPacked().
+constexpr uint32_t kPackedCacheMagicNumber = 0x8adfdbb3;
+// Used for identifying and verifying a compiled WebAssembly module file.
+// See comments in CompileCacheHandler::WriteWasmCache().
+constexpr uint32_t kWasmCacheMagicNumber = 0x8adfdbb4;
+
+// A packed cache file, mapped into memory once and read-only afterwards.
+class CompileCacheHandler::PackedFile {
+ public:
+  struct Header {
+    uint32_t magic;
+    uint32_t bucket_count;  // A power of two.
+    uint32_t entry_count;
+    uint32_t reserved;
+  };
+
+  // Buckets with an offset of 0 are empty, as blobs are stored after the
+  // buckets.
+  struct Bucket {
+    uint32_t cache_key;
+    uint32_t code_size;
+    uint32_t code_hash;
+    uint32_t cache_size;
+    uint32_t cache_hash;
+    uint32_t reserved;
+    uint64_t offset;
+  };
+
+  // Returns nullptr if the file does not exist or is not a valid packed
+  // cache file.
+  static std::unique_ptr<PackedFile> Open(const std::string& path);
+  ~PackedFile();
+  PackedFile(const PackedFile&) = delete;
+  PackedFile& operator=(const PackedFile&) = delete;
+
+  // Returns nullptr if the file has no blob for |cache_key|, or if the blob
+  // lies outside of the file.
+  const Bucket* Find(uint32_t cache_key) const;
+  const uint8_t* blob(const Bucket& bucket) const {
+    return data_ + bucket.offset;
+  }
+
+  const Bucket* buckets_begin() const {
+    return reinterpret_cast<const Bucket*>(data_ + sizeof(Header));
+  }
+  const Bucket* buckets_end() const {
+    return buckets_begin() + header()->bucket_count;
+  }
+
+ private:
+  PackedFile() = default;
+  const Header* header() const {
+    return reinterpret_cast<const Header*>(data_);
+  }
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  // Where the file cannot be mapped, it is read into this buffer once.
+  std::string contents_;
+  bool mapped_ = false;
+};
+
+std::unique_ptr<CompileCacheHandler::PackedFile>
+CompileCacheHandler::PackedFile::Open(const std::string& path) {
+  std::unique_ptr<PackedFile> file(new PackedFile());
+#ifdef _WIN32
+  if (ReadFileSync(&file->contents_, path.c_str()) != 0) return nullptr;
+  file->data_ = reinterpret_cast<const uint8_t*>(file->contents_.data());
+  file->size_ = file->contents_.size();
+#else
+  uv_fs_t req;
+  uv_file fd = uv_fs_open(nullptr, &req, path.c_str(), O_RDONLY, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0) return nullptr;
+  auto defer_close = OnScopeLeave([fd]() {
+    uv_fs_t close_req;
+    CHECK_EQ(0, uv_fs_close(nullptr, &close_req, fd, nullptr));
+    uv_fs_req_cleanup(&close_req);
+  });
+  int err = uv_fs_fstat(nullptr, &req, fd, nullptr);
+  const size_t size = static_cast<size_t>(req.statbuf.st_size);
+  uv_fs_req_cleanup(&req);
+  if (err < 0 || size < sizeof(Header)) return nullptr;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) return nullptr;
+  file->data_ = static_cast<const uint8_t*>(data);
+  file->size_ = size;
+  file->mapped_ = true;
+#endif
+
+  if (file->size_ < sizeof(Header)) return nullptr;
+  const Header* header = file->header();
+  uint32_t bucket_count = header->bucket_count;
+  if (header->magic != kPackedCacheMagicNumber || bucket_count == 0 ||
+      (bucket_count & (bucket_count - 1)) != 0 ||
+      (file->size_ - sizeof(Header)) / sizeof(Bucket) < bucket_count) {
+    return nullptr;
+  }
+  return file;
+}
+
+CompileCacheHandler::PackedFile::~PackedFile() {
+#ifndef _WIN32
+  if (mapped_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+}
+
+const CompileCacheHandler::PackedFile::Bucket*
+CompileCacheHandler::PackedFile::Find(uint32_t cache_key) const {
+  uint32_t mask = header()->bucket_count - 1;
+  const Bucket* buckets = buckets_begin();
+  // Linear probing. PersistPacked() keeps at least half of the buckets
+  // empty, so this terminates quickly.
+  for (uint32_t i = 0; i <= mask; i++) {
+    const Bucket& bucket = buckets[(cache_key + i) & mask];
+    if (bucket.offset == 0) return nullptr;
+    if (bucket.cache_key != cache_key) continue;
+    if (bucket.offset > size_ || bucket.cache_size > size_ - bucket.offset)
+      return nullptr;
+    return &bucket;
+  }
+  return nullptr;
+}
+
+void CompileCacheHandler::ReadPackedEntry(CompileCacheEntry* entry) {
+  Debug("[compile cache] reading packed cache for %s %s...",
+        GetCachedCodeTypeName(entry->type),
+        entry->source_filename);
+  if (!packed_file_) {
+    Debug(" no valid packed cache file\n");
+    return;
+  }
+  const PackedFile::Bucket* bucket = packed_file_->Find(entry->cache_key);
+  if (bucket == nullptr) {
+    Debug(" not found\n");
+    return;
+  }
+  if (bucket->code_size != entry->code_size ||
+      bucket->code_hash != entry->code_hash) {
+    Debug(" code mismatch\n");
+    return;
+  }
+  const uint8_t* blob = packed_file_->blob(*bucket);
+  if (GetHash(reinterpret_cast<const char*>(blob), bucket->cache_size) !=
+      bucket->cache_hash) {
+    Debug(" cache hash mismatch\n");
+    return;
+  }
+  entry->cache.reset(new v8::ScriptCompiler::CachedData(
+      blob,
+      bucket->cache_size,
+      v8::ScriptCompiler::CachedData::BufferNotOwned));
+  Debug(" success, size=%d\n", bucket->cache_size);
+}
 
 void CompileCacheHandler::ReadCacheFile(CompileCacheEntry* entry) {
   Debug("[compile cache] reading cache from %s for %s %s...",
         entry->cache_filename,
-        entry->type == CachedCodeType::kCommonJS ? "CommonJS" : "ESM",
+        GetCachedCodeTypeName(entry->type),
         entry->source_filename);
 
   uv_fs_t req;
@@ -233,7 +420,11 @@ CompileCacheEntry* CompileCacheHandler::GetOrInsert(
 
   // TODO(joyeecheung): if we fail enough times, stop trying for any future
   // files.
-  ReadCacheFile(result);
+  if (use_packed_file_) {
+    ReadPackedEntry(result);
+  } else {
+    ReadCacheFile(result);
+  }
 
   return result;
 }
@@ -247,6 +438,11 @@ v8::ScriptCompiler::CachedData* SerializeCodeCache(v8::Local<v8::Module> mod) {
   return v8::ScriptCompiler::CreateCodeCache(mod->GetUnboundModuleScript());
 }
 
+v8::ScriptCompiler::CachedData* SerializeCodeCache(
+    v8::Local<v8::UnboundScript> script) {
+  return v8::ScriptCompiler::CreateCodeCache(script);
+}
+
 template <typename T>
 void CompileCacheHandler::MaybeSaveImpl(CompileCacheEntry* entry,
                                         v8::Local<T> func_or_mod,
@@ -259,8 +455,10 @@ void CompileCacheHandler::MaybeSaveImpl(CompileCacheEntry* entry,
                                     : "accepted");
   if (entry->cache != nullptr && !rejected) {  // accepted
     Debug("keeping the in-memory entry\n");
+    hits_++;
     return;
   }
+  misses_++;
   Debug("%s the in-memory entry\n",
         entry->cache == nullptr ? "initializing" : "refreshing");
 
@@ -283,6 +481,99 @@ void CompileCacheHandler::MaybeSave(CompileCacheEntry* entry,
   MaybeSaveImpl(entry, func, rejected);
 }
 
+void CompileCacheHandler::MaybeSave(CompileCacheEntry* entry,
+                                    v8::Local<v8::UnboundScript> script,
+                                    bool rejected) {
+  MaybeSaveImpl(entry, script, rejected);
+}
+
+void CompileCacheHandler::SaveData(CompileCacheEntry* entry,
+                                   std::string_view data) {
+  DCHECK_NOT_NULL(entry);
+  DCHECK_EQ(entry->type, CachedCodeType::kCommonJSExports);
+  Debug("[compile cache] saving %d bytes for %s %s\n",
+        data.size(),
+        GetCachedCodeTypeName(entry->type),
+        entry->source_filename);
+  uint8_t* buffer = new uint8_t[data.size()];
+  memcpy(buffer, data.data(), data.size());
+  entry->refreshed = true;
+  entry->cache = std::make_unique<v8::ScriptCompiler::CachedData>(
+      buffer,
+      static_cast<int>(data.size()),
+      v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+// Writes the entries collected by Persist() on a background thread. The
+// writer owns everything it writes, including a reference to the packed
+// file its carried over entries point into, so that it can outlive the
+// handler if waiting for it at exit times out.
+class CompileCacheHandler::Writer {
+ public:
+  struct Entry {
+    uint32_t cache_key;
+    uint32_t code_size;
+    uint32_t code_hash;
+    std::string cache_filename;
+    std::string source_filename;
+    // May be nullptr in the packed mode, where the entry then only keeps
+    // the stale entry of the old file from being carried over.
+    std::unique_ptr<v8::ScriptCompiler::CachedData> cache;
+  };
+
+  Writer(bool is_debug,
+         std::string packed_filename,
+         std::shared_ptr<PackedFile> packed_file)
+      : is_debug_(is_debug),
+        packed_filename_(std::move(packed_filename)),
+        packed_file_(std::move(packed_file)) {}
+
+  std::vector<Entry>* entries() { return &entries_; }
+
+  void Run() {
+    if (packed_filename_.empty()) {
+      WriteCacheFiles();
+    } else {
+      WritePackedFile();
+    }
+    Mutex::ScopedLock lock(mutex_);
+    done_ = true;
+    cond_.Broadcast(lock);
+  }
+
+  // Returns false if the writer did not finish within |timeout_ns|.
+  bool Wait(uint64_t timeout_ns) {
+    Mutex::ScopedLock lock(mutex_);
+    uint64_t deadline = uv_hrtime() + timeout_ns;
+    while (!done_) {
+      uint64_t now = uv_hrtime();
+      if (now >= deadline) return false;
+      cond_.TimedWait(lock, deadline - now);
+    }
+    return true;
+  }
+
+ private:
+  void WriteCacheFiles();
+  void WritePackedFile();
+
+  template <typename... Args>
+  inline void Debug(const char* format, Args&&... args) const {
+    if (UNLIKELY(is_debug_)) {
+      FPrintF(stderr, format, std::forward<Args>(args)...);
+    }
+  }
+
+  const bool is_debug_;
+  const std::string packed_filename_;
+  const std::shared_ptr<PackedFile> packed_file_;
+  std::vector<Entry> entries_;
+
+  Mutex mutex_;
+  ConditionVariable cond_;
+  bool done_ = false;
+};
+
 // Layout of a cache file:
 // [uint32_t] magic number
 // [uint32_t] code size
@@ -290,9 +581,7 @@ void CompileCacheHandler::MaybeSave(CompileCacheEntry* entry,
 // [uint32_t] cache size
 // [uint32_t] cache hash
 // .... compile cache content ....
-void CompileCacheHandler::Persist() {
-  DCHECK(!compile_cache_dir_.empty());
-
+void CompileCacheHandler::Writer::WriteCacheFiles() {
   // NOTE(joyeecheung): in most circumstances the code caching reading
   // writing logic is lenient enough that it's fine even if someone
   // overwrites the cache (that leads to either size or hash mismatch
@@ -300,37 +589,23 @@ void CompileCacheHandler::Persist() {
   // Also in most use cases users should not change the files on disk
   // too rapidly. Therefore locking is not currently implemented to
   // avoid the cost.
-  for (auto& pair : compiler_cache_store_) {
-    auto* entry = pair.second.get();
-    if (entry->cache == nullptr) {
-      Debug("[compile cache] skip %s because the cache was not initialized\n",
-            entry->source_filename);
-      continue;
-    }
-    if (entry->refreshed == false) {
-      Debug("[compile cache] skip %s because cache was the same\n",
-            entry->source_filename);
-      continue;
-    }
-
-    DCHECK_EQ(entry->cache->buffer_policy,
-              v8::ScriptCompiler::CachedData::BufferOwned);
+  for (const Entry& entry : entries_) {
     char* cache_ptr =
-        reinterpret_cast<char*>(const_cast<uint8_t*>(entry->cache->data));
-    uint32_t cache_size = static_cast<uint32_t>(entry->cache->length);
+        reinterpret_cast<char*>(const_cast<uint8_t*>(entry.cache->data));
+    uint32_t cache_size = static_cast<uint32_t>(entry.cache->length);
     uint32_t cache_hash = GetHash(cache_ptr, cache_size);
 
     // Generating headers.
     std::vector<uint32_t> headers(kHeaderCount);
     headers[kMagicNumberOffset] = kCacheMagicNumber;
-    headers[kCodeSizeOffset] = entry->code_size;
+    headers[kCodeSizeOffset] = entry.code_size;
     headers[kCacheSizeOffset] = cache_size;
-    headers[kCodeHashOffset] = entry->code_hash;
+    headers[kCodeHashOffset] = entry.code_hash;
     headers[kCacheHashOffset] = cache_hash;
 
     Debug("[compile cache] writing cache for %s in %s [%d %d %d %d %d]...",
-          entry->source_filename,
-          entry->cache_filename,
+          entry.source_filename,
+          entry.cache_filename,
           headers[kMagicNumberOffset],
           headers[kCodeSizeOffset],
           headers[kCacheSizeOffset],
@@ -339,10 +614,10 @@ void CompileCacheHandler::Persist() {
 
     uv_buf_t headers_buf = uv_buf_init(reinterpret_cast<char*>(headers.data()),
                                        headers.size() * sizeof(uint32_t));
-    uv_buf_t data_buf = uv_buf_init(cache_ptr, entry->cache->length);
+    uv_buf_t data_buf = uv_buf_init(cache_ptr, entry.cache->length);
     uv_buf_t bufs[] = {headers_buf, data_buf};
 
-    int err = WriteFileSync(entry->cache_filename.c_str(), bufs, 2);
+    int err = WriteFileSync(entry.cache_filename.c_str(), bufs, 2);
     if (err < 0) {
       Debug("failed: %s\n", uv_strerror(err));
     } else {
@@ -351,15 +626,299 @@ void CompileCacheHandler::Persist() {
   }
 }
 
+// Layout of a packed cache file:
+// [PackedFile::Header] magic number, bucket count, entry count
+// [PackedFile::Bucket] * bucket count: an open addressing hash table of the
+//                      cache keys, with the headers of the per-module cache
+//                      files and the offsets of the blobs
+// .... compile cache contents, each aligned to 8 bytes ....
+//
+// Unlike per-module files, the packed file is rewritten as a whole, into a
+// temporary file that is then renamed over it, so concurrent readers see
+// either the old or the new file. Entries of the old file that were not
+// loaded by this process are carried over.
+void CompileCacheHandler::Writer::WritePackedFile() {
+  using Bucket = PackedFile::Bucket;
+  struct Blob {
+    uint32_t cache_key;
+    uint32_t code_size;
+    uint32_t code_hash;
+    const uint8_t* data;
+    uint32_t size;
+  };
+  std::vector<Blob> blobs;
+  std::unordered_set<uint32_t> keys;
+  for (const Entry& entry : entries_) {
+    keys.insert(entry.cache_key);
+    if (entry.cache == nullptr) continue;
+    blobs.push_back({entry.cache_key,
+                     entry.code_size,
+                     entry.code_hash,
+                     entry.cache->data,
+                     static_cast<uint32_t>(entry.cache->length)});
+  }
+  if (packed_file_) {
+    for (const Bucket* it = packed_file_->buckets_begin();
+         it != packed_file_->buckets_end();
+         ++it) {
+      if (it->offset == 0 || keys.count(it->cache_key) != 0) continue;
+      if (packed_file_->Find(it->cache_key) != it) continue;
+      blobs.push_back({it->cache_key,
+                       it->code_size,
+                       it->code_hash,
+                       packed_file_->blob(*it),
+                       it->cache_size});
+    }
+  }
+
+  uint32_t bucket_count = 16;
+  while (bucket_count < 2 * blobs.size()) bucket_count *= 2;
+  PackedFile::Header header = {kPackedCacheMagicNumber,
+                               bucket_count,
+                               static_cast<uint32_t>(blobs.size()),
+                               0};
+  std::vector<Bucket> buckets(bucket_count);
+  static const char kPadding[8] = {};
+  std::vector<uv_buf_t> bufs;
+  bufs.reserve(2 * blobs.size() + 2);
+  bufs.push_back(uv_buf_init(reinterpret_cast<char*>(&header), sizeof(header)));
+  bufs.push_back(uv_buf_init(reinterpret_cast<char*>(buckets.data()),
+                             bucket_count * sizeof(Bucket)));
+  uint64_t offset = sizeof(header) + bucket_count * sizeof(Bucket);
+  for (const Blob& blob : blobs) {
+    uint32_t index = blob.cache_key & (bucket_count - 1);
+    while (buckets[index].offset != 0) index = (index + 1) & (bucket_count - 1);
+    buckets[index] = {blob.cache_key,
+                      blob.code_size,
+                      blob.code_hash,
+                      blob.size,
+                      GetHash(reinterpret_cast<const char*>(blob.data),
+                              blob.size),
+                      0,
+                      offset};
+    bufs.push_back(
+        uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(blob.data)),
+                    blob.size));
+    offset += blob.size;
+    if (offset % 8 != 0) {
+      bufs.push_back(
+          uv_buf_init(const_cast<char*>(kPadding), 8 - offset % 8));
+      offset += 8 - offset % 8;
+    }
+  }
+
+  std::string temp_filename =
+      packed_filename_ + "." + std::to_string(uv_os_getpid()) + ".tmp";
+  Debug("[compile cache] writing %d entries to %s...",
+        blobs.size(),
+        packed_filename_);
+  int err = WriteFileSync(temp_filename.c_str(), bufs.data(), bufs.size());
+  uv_fs_t req;
+  if (err == 0) {
+    // The old file stays mapped, but the entries are not read any more.
+    err = uv_fs_rename(nullptr,
+                       &req,
+                       temp_filename.c_str(),
+                       packed_filename_.c_str(),
+                       nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+  if (err < 0) {
+    uv_fs_unlink(nullptr, &req, temp_filename.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+    Debug("failed: %s\n", uv_strerror(err));
+  } else {
+    Debug("success\n");
+  }
+}
+
+// Serializing the code cache has already happened on the main thread in
+// MaybeSave(). Persist() only copies the caches that need to be written and
+// leaves checksumming and writing them to a background thread.
+void CompileCacheHandler::Persist() {
+  DCHECK(!compile_cache_dir_.empty());
+
+  WaitForPersist();
+  if (use_packed_file_) {
+    bool refreshed = false;
+    for (auto& pair : compiler_cache_store_) {
+      if (pair.second->cache != nullptr && pair.second->refreshed) {
+        refreshed = true;
+        break;
+      }
+    }
+    if (!refreshed) {
+      Debug("[compile cache] skip writing %s because no cache was "
+            "refreshed\n",
+            packed_filename_);
+      return;
+    }
+  }
+
+  auto writer = std::make_shared<Writer>(
+      is_debug_,
+      use_packed_file_ ? packed_filename_ : std::string(),
+      packed_file_);
+  for (auto& pair : compiler_cache_store_) {
+    auto* entry = pair.second.get();
+    if (!use_packed_file_) {
+      if (entry->cache == nullptr) {
+        Debug("[compile cache] skip %s because the cache was not "
+              "initialized\n",
+              entry->source_filename);
+        continue;
+      }
+      if (entry->refreshed == false) {
+        Debug("[compile cache] skip %s because cache was the same\n",
+              entry->source_filename);
+        continue;
+      }
+      DCHECK_EQ(entry->cache->buffer_policy,
+                v8::ScriptCompiler::CachedData::BufferOwned);
+    }
+    // Caches served from the packed file are not copied, and the writer
+    // keeps the file mapped.
+    writer->entries()->push_back(
+        {entry->cache_key,
+         entry->code_size,
+         entry->code_hash,
+         entry->cache_filename,
+         entry->source_filename,
+         std::unique_ptr<v8::ScriptCompiler::CachedData>(
+             entry->cache != nullptr ? entry->CopyCache() : nullptr)});
+    entry->refreshed = false;
+  }
+  if (writer->entries()->empty()) return;
+
+  writer_ = writer;
+  std::thread([writer = std::move(writer)]() { writer->Run(); }).detach();
+}
+
+void CompileCacheHandler::WaitForPersist() {
+  if (!writer_) return;
+  if (!writer_->Wait(kPersistTimeoutNs)) {
+    Debug("[compile cache] gave up waiting for the cache to be written\n");
+  }
+  writer_.reset();
+}
+
 CompileCacheHandler::CompileCacheHandler(Environment* env)
     : isolate_(env->isolate()),
       is_debug_(
           env->enabled_debug_list()->enabled(DebugCategory::COMPILE_CACHE)) {}
 
+CompileCacheHandler::~CompileCacheHandler() {
+  WaitForPersist();
+}
+
+std::string CompileCacheHandler::GetWasmCacheFilename(
+    std::string_view url) const {
+  DCHECK(!compile_cache_dir_.empty());
+  uint32_t key = GetCacheKey(url, CachedCodeType::kWasm);
+  std::u8string filename_u8 =
+      (compile_cache_dir_ / Uint32ToHex(key)).u8string();
+  return std::string(filename_u8.begin(), filename_u8.end()) + ".wasm.cache";
+}
+
+std::unique_ptr<WasmCacheEntry> CompileCacheHandler::ReadWasmCache(
+    const std::string& filename) {
+  Debug("[compile cache] reading wasm cache from %s...", filename);
+  std::string contents;
+  if (ReadFileSync(&contents, filename.c_str()) != 0) {
+    Debug(" not found\n");
+    return nullptr;
+  }
+
+  uint32_t headers[kHeaderCount];
+  if (contents.size() < sizeof(headers)) {
+    Debug(" reading header failed\n");
+    return nullptr;
+  }
+  memcpy(headers, contents.data(), sizeof(headers));
+  if (headers[kMagicNumberOffset] != kWasmCacheMagicNumber) {
+    Debug(" magic number mismatch\n");
+    return nullptr;
+  }
+
+  auto entry = std::make_unique<WasmCacheEntry>();
+  entry->module = contents.substr(sizeof(headers));
+  if (entry->module.size() != headers[kCacheSizeOffset] ||
+      GetHash(entry->module.data(), entry->module.size()) !=
+          headers[kCacheHashOffset]) {
+    Debug(" cache mismatch\n");
+    return nullptr;
+  }
+  entry->wire_size = headers[kCodeSizeOffset];
+  entry->wire_hash = headers[kCodeHashOffset];
+  Debug(" success, size=%d\n", entry->module.size());
+  return entry;
+}
+
+// A wasm cache file has the same header as the code cache files, with the
+// size and hash of the wire bytes in place of the code:
+// [uint32_t] magic number
+// [uint32_t] wire bytes size
+// [uint32_t] serialized module size
+// [uint32_t] wire bytes hash
+// [uint32_t] serialized module hash
+// ... serialized module
+// It is written to a temporary file first, so that a process reading it
+// while a module is being serialized never sees a partial file.
+void CompileCacheHandler::WriteWasmCache(const std::string& filename,
+                                         v8::CompiledWasmModule* module) {
+  v8::MemorySpan<const uint8_t> wire_bytes = module->GetWireBytesRef();
+  v8::OwnedBuffer serialized = module->Serialize();
+  if (serialized.size == 0 ||
+      serialized.size > std::numeric_limits<uint32_t>::max() ||
+      wire_bytes.size() > std::numeric_limits<uint32_t>::max()) {
+    return;
+  }
+
+  uint32_t headers[kHeaderCount];
+  headers[kMagicNumberOffset] = kWasmCacheMagicNumber;
+  headers[kCodeSizeOffset] = wire_bytes.size();
+  headers[kCacheSizeOffset] = serialized.size;
+  headers[kCodeHashOffset] =
+      UpdateWasmHash(0, wire_bytes.data(), wire_bytes.size());
+  headers[kCacheHashOffset] = GetHash(
+      reinterpret_cast<const char*>(serialized.buffer.get()), serialized.size);
+
+  uv_buf_t bufs[] = {
+      uv_buf_init(reinterpret_cast<char*>(headers), sizeof(headers)),
+      uv_buf_init(const_cast<char*>(
+                      reinterpret_cast<const char*>(serialized.buffer.get())),
+                  serialized.size),
+  };
+  std::string temp_filename =
+      filename + "." + std::to_string(uv_os_getpid()) + ".tmp";
+  int err = WriteFileSync(temp_filename.c_str(), bufs, arraysize(bufs));
+  uv_fs_t req;
+  if (err == 0) {
+    err = uv_fs_rename(
+        nullptr, &req, temp_filename.c_str(), filename.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+  if (err < 0) {
+    uv_fs_unlink(nullptr, &req, temp_filename.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+}
+
+uint32_t CompileCacheHandler::UpdateWasmHash(uint32_t hash,
+                                             const uint8_t* data,
+                                             size_t size) {
+  // The same crc32 as GetHash(), which starts from 0.
+  return crc32(hash, data, size);
+}
+
 // Directory structure:
 // - Compile cache directory (from NODE_COMPILE_CACHE)
 //   - $NODE_VERION-$ARCH-$CACHE_DATA_VERSION_TAG-$UID
 //     - $FILENAME_AND_MODULE_TYPE_HASH.cache: a hash of filename + module type
+//     - packed.cache: all of the above in one file, used instead with
+//       NODE_COMPILE_CACHE_SINGLE_FILE=1
+//     - $URL_HASH.wasm.cache: a compiled WebAssembly module, written with
+//       NODE_COMPILE_CACHE_WASM=1
 CompileCacheEnableResult CompileCacheHandler::Enable(Environment* env,
                                                      const std::string& dir) {
   std::string cache_tag = GetCacheVersionTag();
@@ -413,6 +972,27 @@ CompileCacheEnableResult CompileCacheHandler::Enable(Environment* env,
   compile_cache_dir_str_ = absolute_cache_dir_base;
   result.cache_directory = absolute_cache_dir_base;
   compile_cache_dir_ = cache_dir_with_tag;
+
+  std::string single_file;
+  if (credentials::SafeGetenv(
+          "NODE_COMPILE_CACHE_SINGLE_FILE", &single_file, env->env_vars()) &&
+      single_file == "1") {
+    std::u8string packed_filename_u8 =
+        (cache_dir_with_tag / "packed.cache").u8string();
+    use_packed_file_ = true;
+    packed_filename_ =
+        std::string(packed_filename_u8.begin(), packed_filename_u8.end());
+    packed_file_ = PackedFile::Open(packed_filename_);
+    Debug("[compile cache] using packed cache file %s...%s\n",
+          packed_filename_,
+          packed_file_ ? "loaded" : "not found or invalid");
+  }
+
+  std::string wasm_cache;
+  use_wasm_cache_ =
+      credentials::SafeGetenv(
+          "NODE_COMPILE_CACHE_WASM", &wasm_cache, env->env_vars()) &&
+      wasm_cache == "1";
   result.status = CompileCacheEnableStatus::ENABLED;
   return result;
 }
@@ -9,6 +9,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include "v8-wasm.h"
 #include "v8.h"
 
 namespace node {
@@ -18,6 +19,17 @@ class Environment;
 enum class CachedCodeType : uint8_t {
   kCommonJS = 0,
   kESM,
+  // The names that cjs-module-lexer detected in a CommonJS module, for
+  // importing it from ESM. Not V8 code, see CompileCacheHandler::SaveData().
+  kCommonJSExports,
+  // A built-in module that has no code cache in the binary or the snapshot,
+  // e.g. when running from a snapshot built without code cache.
+  kBuiltin,
+  // A vm.Script, cached when --vm-code-cache-size is set.
+  kVmScript,
+  // A compiled WebAssembly module, cached with NODE_COMPILE_CACHE_WASM=1.
+  // Stored in its own files, see CompileCacheHandler::ReadWasmCache().
+  kWasm,
 };
 
 struct CompileCacheEntry {
@@ -31,10 +43,19 @@ struct CompileCacheEntry {
   CachedCodeType type;
   bool refreshed = false;
   // Copy the cache into a new store for V8 to consume. Caller takes
-  // ownership.
+  // ownership. A cache served from a mapped packed cache file is not
+  // copied, the new store points into the mapping instead.
   v8::ScriptCompiler::CachedData* CopyCache() const;
 };
 
+// A compiled WebAssembly module read from the cache. V8 may only use it
+// once the wire bytes that were received match |wire_size| and |wire_hash|.
+struct WasmCacheEntry {
+  std::string module;
+  uint32_t wire_size;
+  uint32_t wire_hash;
+};
+
 #define COMPILE_CACHE_STATUS(V)                                                \
   V(FAILED)          /* Failed to enable the cache */                          \
   V(ENABLED)         /* Was not enabled before, and now enabled. */            \
@@ -56,8 +77,11 @@ struct CompileCacheEnableResult {
 class CompileCacheHandler {
  public:
   explicit CompileCacheHandler(Environment* env);
+  ~CompileCacheHandler();
   CompileCacheEnableResult Enable(Environment* env, const std::string& dir);
 
+  // Writes the refreshed caches to disk on a background thread. The
+  // destructor waits for the thread, for at most kPersistTimeoutNs.
   void Persist();
 
   CompileCacheEntry* GetOrInsert(v8::Local<v8::String> code,
@@ -69,10 +93,47 @@ class CompileCacheHandler {
   void MaybeSave(CompileCacheEntry* entry,
                  v8::Local<v8::Module> mod,
                  bool rejected);
+  void MaybeSave(CompileCacheEntry* entry,
+                 v8::Local<v8::UnboundScript> script,
+                 bool rejected);
+  // Replaces the cache of an entry that caches something other than V8
+  // code, which is stored and validated the same way.
+  void SaveData(CompileCacheEntry* entry, std::string_view data);
   std::string_view cache_dir() { return compile_cache_dir_str_; }
+  // Code caches that V8 accepted, and compilations that found no cache or
+  // had it rejected.
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+  // Compiled WebAssembly modules are looked up by the URL they were fetched
+  // from, and validated against the hash of their wire bytes, so that
+  // streaming compilation does not have to wait for all of the bytes.
+  bool wasm_cache_enabled() const { return use_wasm_cache_; }
+  std::string GetWasmCacheFilename(std::string_view url) const;
+  // Returns nullptr if there is no valid cache file.
+  std::unique_ptr<WasmCacheEntry> ReadWasmCache(const std::string& filename);
+  // Can be called from any thread, since V8 reports the modules that are
+  // ready for serialization from its compilation threads.
+  static void WriteWasmCache(const std::string& filename,
+                             v8::CompiledWasmModule* module);
+  // Extends the hash of wire bytes that are received in chunks.
+  static uint32_t UpdateWasmHash(uint32_t hash,
+                                 const uint8_t* data,
+                                 size_t size);
+
+  // The versioned subdirectory that the cache files are written to.
+  const std::filesystem::path& versioned_cache_dir() const {
+    return compile_cache_dir_;
+  }
 
  private:
+  class PackedFile;
+  class Writer;
+
   void ReadCacheFile(CompileCacheEntry* entry);
+  void ReadPackedEntry(CompileCacheEntry* entry);
+  // Waits for the files of the last Persist() to be written, for at most
+  // kPersistTimeoutNs.
+  void WaitForPersist();
 
   template <typename T>
   void MaybeSaveImpl(CompileCacheEntry* entry,
@@ -89,13 +150,24 @@ class CompileCacheHandler {
   static constexpr size_t kCacheHashOffset = 4;
   static constexpr size_t kHeaderCount = 5;
 
+  static constexpr uint64_t kPersistTimeoutNs = 1000 * 1000 * 1000;
+
   v8::Isolate* isolate_ = nullptr;
   bool is_debug_ = false;
 
   std::string compile_cache_dir_str_;
   std::filesystem::path compile_cache_dir_;
+  // With NODE_COMPILE_CACHE_SINGLE_FILE=1, all entries are kept in a single
+  // indexed file in the cache directory instead of one file per module.
+  bool use_packed_file_ = false;
+  std::string packed_filename_;
+  std::shared_ptr<PackedFile> packed_file_;
+  bool use_wasm_cache_ = false;
+  std::shared_ptr<Writer> writer_;
   std::unordered_map<uint32_t, std::unique_ptr<CompileCacheEntry>>
       compiler_cache_store_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
 };
 }  // namespace node
 
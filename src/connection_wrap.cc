@@ -2,20 +2,26 @@
 
 #include "connect_wrap.h"
 #include "env-inl.h"
+#include "node_probes.h"
 #include "pipe_wrap.h"
 #include "stream_base-inl.h"
 #include "stream_wrap.h"
 #include "tcp_wrap.h"
 #include "util-inl.h"
 
+#include <type_traits>
+
 namespace node {
 
+using v8::Array;
 using v8::Boolean;
 using v8::Context;
+using v8::FunctionCallbackInfo;
 using v8::HandleScope;
 using v8::Integer;
 using v8::Local;
 using v8::Object;
+using v8::Uint32;
 using v8::Value;
 
 
@@ -36,6 +42,11 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
   CHECK_NOT_NULL(wrap_data);
   CHECK_EQ(&wrap_data->handle_, reinterpret_cast<UVType*>(handle));
 
+  if constexpr (std::is_same_v<WrapType, TCPWrap>) {
+    if (NODE_PROBE_ENABLED(tcp__accept))
+      NODE_PROBE2(tcp__accept, wrap_data, status);
+  }
+
   Environment* env = wrap_data->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -46,6 +57,9 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
 
   Local<Value> client_handle;
 
+  // Errors are reported in order, after the connections accepted before them.
+  if (status != 0) wrap_data->FlushAcceptedConnections();
+
   if (status == 0) {
     // Instantiate the client javascript object and handle.
     Local<Object> client_obj;
@@ -63,6 +77,25 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
     if (uv_accept(handle, client))
       return;
 
+    if (wrap_data->accept_batch_size_ > 1) {
+      // libuv keeps calling us for every connection it accepts during this
+      // poll; collect them and call into JS once, from an immediate or when
+      // the batch is full.
+      wrap_data->accepted_connections_.emplace_back(wrap);
+      if (wrap_data->accepted_connections_.size() >=
+          wrap_data->accept_batch_size_) {
+        wrap_data->FlushAcceptedConnections();
+      } else if (!wrap_data->accept_flush_scheduled_) {
+        wrap_data->accept_flush_scheduled_ = true;
+        BaseObjectPtr<WrapType> strong_ref{wrap_data};
+        env->SetImmediate([strong_ref](Environment* env) {
+          strong_ref->accept_flush_scheduled_ = false;
+          strong_ref->FlushAcceptedConnections();
+        });
+      }
+      return;
+    }
+
     // Successful accept. Call the onconnection callback in JavaScript land.
     client_handle = client_obj;
   } else {
@@ -74,6 +107,44 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
 }
 
 
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::FlushAcceptedConnections() {
+  if (accepted_connections_.empty()) return;
+  std::vector<BaseObjectPtr<WrapType>> connections;
+  connections.swap(accepted_connections_);
+
+  Environment* env = this->env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  if (IsHandleClosing()) {
+    for (const BaseObjectPtr<WrapType>& connection : connections)
+      connection->Close();
+    return;
+  }
+
+  Local<Array> handles = Array::New(env->isolate(), connections.size());
+  for (size_t i = 0; i < connections.size(); i++) {
+    if (handles->Set(env->context(), i, connections[i]->object()).IsNothing())
+      return;
+  }
+
+  Local<Value> argv[] = { Integer::New(env->isolate(), 0), handles };
+  MakeCallback(env->onconnection_string(), arraysize(argv), argv);
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args) {
+  WrapType* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+  CHECK(args[0]->IsUint32());
+  wrap->accept_batch_size_ = args[0].As<Uint32>()->Value();
+  if (wrap->accept_batch_size_ <= 1) wrap->FlushAcceptedConnections();
+}
+
+
 template <typename WrapType, typename UVType>
 void ConnectionWrap<WrapType, UVType>::AfterConnect(uv_connect_t* req,
                                                     int status) {
@@ -83,6 +154,11 @@ void ConnectionWrap<WrapType, UVType>::AfterConnect(uv_connect_t* req,
   CHECK_EQ(req_wrap->env(), wrap->env());
   Environment* env = wrap->env();
 
+  if constexpr (std::is_same_v<WrapType, TCPWrap>) {
+    if (NODE_PROBE_ENABLED(tcp__connect__done))
+      NODE_PROBE2(tcp__connect__done, req_wrap.get(), status);
+  }
+
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
 
@@ -132,6 +208,12 @@ template void ConnectionWrap<PipeWrap, uv_pipe_t>::OnConnection(
 template void ConnectionWrap<TCPWrap, uv_tcp_t>::OnConnection(
     uv_stream_t* handle, int status);
 
+template void ConnectionWrap<PipeWrap, uv_pipe_t>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args);
+
 template void ConnectionWrap<PipeWrap, uv_pipe_t>::AfterConnect(
     uv_connect_t* handle, int status);
 
@@ -3,8 +3,11 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "base_object.h"
 #include "stream_wrap.h"
 
+#include <vector>
+
 namespace node {
 
 class Environment;
@@ -14,6 +17,12 @@ class ConnectionWrap : public LibuvStreamWrap {
  public:
   static void OnConnection(uv_stream_t* handle, int status);
   static void AfterConnect(uv_connect_t* req, int status);
+  // setAcceptBatchSize(n): when n > 1, sockets accepted during one I/O
+  // poll are handed to onconnection(0, [handle, ...]) together, at most n
+  // per call, instead of one callback per socket. 0 or 1 restores the
+  // default.
+  static void SetAcceptBatchSize(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
 
  protected:
   ConnectionWrap(Environment* env,
@@ -21,6 +30,13 @@ class ConnectionWrap : public LibuvStreamWrap {
                  ProviderType provider);
 
   UVType handle_;
+
+ private:
+  void FlushAcceptedConnections();
+
+  uint32_t accept_batch_size_ = 0;
+  bool accept_flush_scheduled_ = false;
+  std::vector<BaseObjectPtr<WrapType>> accepted_connections_;
 };
 
 }  // namespace node
@@ -0,0 +1,113 @@
+#ifndef SRC_CPPGC_HELPERS_H_
+#define SRC_CPPGC_HELPERS_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <type_traits>  // std::remove_reference
+#include "cppgc/allocation.h"
+#include "cppgc/garbage-collected.h"
+#include "cppgc/name-provider.h"
+#include "env.h"
+#include "util.h"
+#include "v8-cppgc.h"
+#include "v8-sandbox.h"
+#include "v8.h"
+
+namespace node {
+
+/**
+ * A mixin with a BaseObject-like interface for wrapper objects that are
+ * managed by V8's cppgc (Oilpan) library instead of a weak global handle.
+ * Such a wrapper is traced together with its JavaScript object, so it costs
+ * neither a global handle nor a weak callback per instance, and it is
+ * accounted for in heap snapshots by the CppHeap, so it does not need
+ * MemoryInfo().
+ *
+ * A class using it looks like this:
+ *
+ *   class Klass final : public cppgc::GarbageCollected<Klass>,
+ *                       public cppgc::NameProvider,
+ *                       public CppgcMixin {
+ *    public:
+ *     SET_CPPGC_NAME(Klass)
+ *
+ *     Klass(Environment* env, v8::Local<v8::Object> object) {
+ *       CppgcMixin::Wrap(this, env, object);
+ *     }
+ *
+ *     void Trace(cppgc::Visitor* visitor) const final {
+ *       CppgcMixin::Trace(visitor);
+ *       // Trace the TracedReferences and Members of Klass here.
+ *     }
+ *   };
+ *
+ * and is created with
+ *
+ *   cppgc::MakeGarbageCollected<Klass>(
+ *       env->isolate()->GetCppHeap()->GetAllocationHandle(), env, object);
+ *
+ * The destructor runs while the heap is being swept, so it must not touch
+ * other managed objects or create handles. It may release native resources
+ * and destroy TracedReferences, but not v8::Globals.
+ */
+class CppgcMixin : public cppgc::GarbageCollectedMixin {
+ public:
+  // Share the layout of BaseObjects, so that code that checks the embedder
+  // type of a wrapper can tell the two kinds apart.
+  enum InternalFields { kEmbedderType = 0, kSlot, kInternalFieldCount };
+
+  // Has to be called from the constructor of the class, because the mixin
+  // is constructed before the object is fully formed.
+  template <typename T>
+  static void Wrap(T* ptr, Environment* env, v8::Local<v8::Object> obj) {
+    CHECK_GE(obj->InternalFieldCount(), T::kInternalFieldCount);
+    ptr->env_ = env;
+    v8::Isolate* isolate = env->isolate();
+    ptr->traced_reference_ = v8::TracedReference<v8::Object>(isolate, obj);
+    v8::Object::Wrap<v8::CppHeapPointerTag::kDefaultTag>(isolate, obj, ptr);
+    obj->SetAlignedPointerInInternalField(
+        kEmbedderType, env->isolate_data()->embedder_id_for_cppgc());
+    obj->SetAlignedPointerInInternalField(kSlot, ptr);
+  }
+
+  v8::Local<v8::Object> object() const {
+    return traced_reference_.Get(env_->isolate());
+  }
+
+  Environment* env() const { return env_; }
+
+  // Mirrors BaseObject::Unwrap(). The pointer in kSlot is valid for as long
+  // as the wrapper object is alive, which |obj| guarantees.
+  template <typename T>
+  static T* Unwrap(v8::Local<v8::Object> obj) {
+    if (obj->InternalFieldCount() != T::kInternalFieldCount) return nullptr;
+    return static_cast<T*>(obj->GetAlignedPointerFromInternalField(kSlot));
+  }
+
+  void Trace(cppgc::Visitor* visitor) const override {
+    visitor->Trace(traced_reference_);
+  }
+
+ private:
+  Environment* env_;
+  v8::TracedReference<v8::Object> traced_reference_;
+};
+
+#define SET_CPPGC_NAME(Klass)                                                  \
+  inline const char* GetHumanReadableName() const final {                      \
+    return "Node / " #Klass;                                                   \
+  }
+
+// The counterpart of ASSIGN_OR_RETURN_UNWRAP() for CppgcMixin wrappers.
+#define ASSIGN_OR_RETURN_UNWRAP_CPPGC(ptr, obj, ...)                           \
+  do {                                                                         \
+    *ptr = CppgcMixin::Unwrap<                                                 \
+        typename std::remove_reference<decltype(**ptr)>::type>(obj);          \
+    if (*ptr == nullptr) return __VA_ARGS__;                                   \
+  } while (0)
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CPPGC_HELPERS_H_
@@ -192,6 +192,145 @@ void GetCipherInfo(const FunctionCallbackInfo<Value>& args) {
 
   args.GetReturnValue().Set(info);
 }
+
+// Encrypts or decrypts a whole message with an AEAD cipher straight into a
+// caller-provided buffer, without creating a CipherBase. Arguments:
+//   0. Cipher name
+//   1. Key
+//   2. IV
+//   3. AAD, or undefined
+//   4. Input
+//   5. Output
+//   6. Output offset
+//   7. When encrypting, the tag length. The tag is written to the output
+//      right after the ciphertext. When decrypting, the tag.
+// Returns the number of bytes written to the output.
+template <bool kEncrypt>
+void AEADCipherInto(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  MarkPopErrorOnReturn mark_pop_error_on_return;
+
+  CHECK(args[0]->IsString());
+  CHECK(args[5]->IsArrayBufferView());
+  CHECK(args[6]->IsUint32());
+
+  Utf8Value cipher_type(env->isolate(), args[0]);
+  const EVP_CIPHER* const cipher = EVP_get_cipherbyname(*cipher_type);
+  if (cipher == nullptr)
+    return THROW_ERR_CRYPTO_UNKNOWN_CIPHER(env);
+  if (!IsSupportedAuthenticatedMode(cipher)) {
+    return THROW_ERR_INVALID_ARG_VALUE(
+        env, "%s is not an authenticated cipher", *cipher_type);
+  }
+  const int mode = EVP_CIPHER_mode(cipher);
+
+  ArrayBufferOrViewContents<unsigned char> key(args[1]);
+  ArrayBufferOrViewContents<unsigned char> iv(args[2]);
+  ArrayBufferOrViewContents<unsigned char> aad(
+      args[3]->IsUndefined() ? Local<Value>() : args[3]);
+  ArrayBufferOrViewContents<unsigned char> input(args[4]);
+  ArrayBufferOrViewContents<unsigned char> output(args[5]);
+  if (UNLIKELY(!iv.CheckSizeInt32() || !aad.CheckSizeInt32() ||
+               !input.CheckSizeInt32())) {
+    return THROW_ERR_OUT_OF_RANGE(env, "data is too long");
+  }
+
+  if (key.size() != static_cast<size_t>(EVP_CIPHER_key_length(cipher)))
+    return THROW_ERR_CRYPTO_INVALID_KEYLEN(env);
+
+  if constexpr (kEncrypt) {
+    CHECK(args[7]->IsUint32());
+  }
+  ArrayBufferOrViewContents<unsigned char> tag(
+      kEncrypt ? Local<Value>() : args[7]);
+  const unsigned int tag_len =
+      kEncrypt ? args[7].As<Uint32>()->Value() : tag.size();
+  if (tag_len == 0 || tag_len > EVP_GCM_TLS_TAG_LEN ||
+      (mode == EVP_CIPH_GCM_MODE && !IsValidGCMTagLength(tag_len))) {
+    return THROW_ERR_CRYPTO_INVALID_AUTH_TAG(
+        env, "Invalid authentication tag length: %u", tag_len);
+  }
+
+  const size_t offset = args[6].As<Uint32>()->Value();
+  const size_t needed = input.size() + (kEncrypt ? tag_len : 0);
+  if (offset > output.size() || output.size() - offset < needed)
+    return THROW_ERR_OUT_OF_RANGE(env, "The output buffer is too small");
+  unsigned char* out = output.data() + offset;
+
+  CipherCtxPointer ctx(EVP_CIPHER_CTX_new());
+  if (!ctx ||
+      !EVP_CipherInit_ex(ctx.get(), cipher, nullptr, nullptr, nullptr,
+                         kEncrypt)) {
+    return ThrowCryptoError(env, ERR_get_error());
+  }
+  if (!EVP_CIPHER_CTX_ctrl(
+          ctx.get(), EVP_CTRL_AEAD_SET_IVLEN, iv.size(), nullptr)) {
+    return THROW_ERR_CRYPTO_INVALID_IV(env);
+  }
+
+  // CCM and OCB need the tag length, and CCM also needs the tag when
+  // decrypting, before the key is set.
+  if (mode == EVP_CIPH_CCM_MODE
+#ifndef OPENSSL_NO_OCB
+      || mode == EVP_CIPH_OCB_MODE
+#endif
+  ) {
+    unsigned char* tag_data =
+        !kEncrypt && mode == EVP_CIPH_CCM_MODE
+            ? const_cast<unsigned char*>(tag.data())
+            : nullptr;
+    if (!EVP_CIPHER_CTX_ctrl(
+            ctx.get(), EVP_CTRL_AEAD_SET_TAG, tag_len, tag_data)) {
+      return THROW_ERR_CRYPTO_INVALID_AUTH_TAG(
+          env, "Invalid authentication tag length: %u", tag_len);
+    }
+  }
+
+  int len;
+  if (!EVP_CipherInit_ex(ctx.get(), nullptr, nullptr, key.data(), iv.data(),
+                         kEncrypt) ||
+      (mode == EVP_CIPH_CCM_MODE &&
+       !EVP_CipherUpdate(ctx.get(), nullptr, &len, nullptr, input.size())) ||
+      (!aad.empty() &&
+       !EVP_CipherUpdate(ctx.get(), nullptr, &len, aad.data(), aad.size()))) {
+    return ThrowCryptoError(env, ERR_get_error());
+  }
+
+  const char* const auth_failed =
+      "Unsupported state or unable to authenticate data";
+  int written;
+  if (!EVP_CipherUpdate(
+          ctx.get(), out, &written, input.data(), input.size())) {
+    if (!kEncrypt && mode == EVP_CIPH_CCM_MODE)
+      return ThrowCryptoError(env, ERR_get_error(), auth_failed);
+    return ThrowCryptoError(env, ERR_get_error());
+  }
+
+  // In CCM mode, the tag has already been verified by EVP_CipherUpdate() and
+  // EVP_CipherFinal_ex() must not be called.
+  if (mode != EVP_CIPH_CCM_MODE) {
+    if (!kEncrypt &&
+        !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_SET_TAG, tag_len,
+                             const_cast<unsigned char*>(tag.data()))) {
+      return ThrowCryptoError(env, ERR_get_error(), auth_failed);
+    }
+    if (!EVP_CipherFinal_ex(ctx.get(), out + written, &len)) {
+      return ThrowCryptoError(
+          env, ERR_get_error(), kEncrypt ? nullptr : auth_failed);
+    }
+    written += len;
+  }
+
+  if constexpr (kEncrypt) {
+    if (!EVP_CIPHER_CTX_ctrl(
+            ctx.get(), EVP_CTRL_AEAD_GET_TAG, tag_len, out + written)) {
+      return ThrowCryptoError(env, ERR_get_error());
+    }
+    written += tag_len;
+  }
+
+  args.GetReturnValue().Set(written);
+}
 }  // namespace
 
 void CipherBase::GetSSLCiphers(const FunctionCallbackInfo<Value>& args) {
@@ -282,6 +421,7 @@ void CipherBase::Initialize(Environment* env, Local<Object> target) {
   SetProtoMethod(isolate, t, "init", Init);
   SetProtoMethod(isolate, t, "initiv", InitIv);
   SetProtoMethod(isolate, t, "update", Update);
+  SetProtoMethod(isolate, t, "updateInto", UpdateInto);
   SetProtoMethod(isolate, t, "final", Final);
   SetProtoMethod(isolate, t, "setAutoPadding", SetAutoPadding);
   SetProtoMethodNoSideEffect(isolate, t, "getAuthTag", GetAuthTag);
@@ -318,6 +458,8 @@ void CipherBase::Initialize(Environment* env, Local<Object> target) {
                                     EVP_PKEY_verify_recover>);
 
   SetMethodNoSideEffect(context, target, "getCipherInfo", GetCipherInfo);
+  SetMethod(context, target, "aeadEncryptInto", AEADCipherInto<true>);
+  SetMethod(context, target, "aeadDecryptInto", AEADCipherInto<false>);
 
   NODE_DEFINE_CONSTANT(target, kWebCryptoCipherEncrypt);
   NODE_DEFINE_CONSTANT(target, kWebCryptoCipherDecrypt);
@@ -330,6 +472,7 @@ void CipherBase::RegisterExternalReferences(
   registry->Register(Init);
   registry->Register(InitIv);
   registry->Register(Update);
+  registry->Register(UpdateInto);
   registry->Register(Final);
   registry->Register(SetAutoPadding);
   registry->Register(GetAuthTag);
@@ -353,6 +496,8 @@ void CipherBase::RegisterExternalReferences(
                                              EVP_PKEY_verify_recover>);
 
   registry->Register(GetCipherInfo);
+  registry->Register(AEADCipherInto<true>);
+  registry->Register(AEADCipherInto<false>);
 }
 
 void CipherBase::New(const FunctionCallbackInfo<Value>& args) {
@@ -786,13 +931,10 @@ void CipherBase::SetAAD(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(cipher->SetAAD(buf, plaintext_len));
 }
 
-CipherBase::UpdateResult CipherBase::Update(
-    const char* data,
-    size_t len,
-    std::unique_ptr<BackingStore>* out) {
+CipherBase::UpdateResult CipherBase::GetUpdateOutputLength(
+    const unsigned char* data, size_t len, int* out_len) {
   if (!ctx_ || len > INT_MAX)
     return kErrorState;
-  MarkPopErrorOnReturn mark_pop_error_on_return;
 
   const int mode = EVP_CIPHER_CTX_mode(ctx_.get());
 
@@ -807,29 +949,54 @@ CipherBase::UpdateResult CipherBase::Update(
   const int block_size = EVP_CIPHER_CTX_block_size(ctx_.get());
   CHECK_GT(block_size, 0);
   if (len + block_size > INT_MAX) return kErrorState;
-  int buf_len = len + block_size;
+  // Stream ciphers and stream-like modes, which include all supported AEAD
+  // modes, never buffer any input.
+  *out_len = block_size == 1 ? len : len + block_size;
 
   // For key wrapping algorithms, get output size by calling
   // EVP_CipherUpdate() with null output.
   if (kind_ == kCipher && mode == EVP_CIPH_WRAP_MODE &&
-      EVP_CipherUpdate(ctx_.get(),
-                       nullptr,
-                       &buf_len,
-                       reinterpret_cast<const unsigned char*>(data),
-                       len) != 1) {
+      EVP_CipherUpdate(ctx_.get(), nullptr, out_len, data, len) != 1) {
     return kErrorState;
   }
+  return kSuccess;
+}
+
+CipherBase::UpdateResult CipherBase::CipherUpdate(const unsigned char* data,
+                                                  size_t len,
+                                                  unsigned char* out,
+                                                  int* out_len) {
+  int r = EVP_CipherUpdate(ctx_.get(), out, out_len, data, len);
+
+  // When in CCM mode, EVP_CipherUpdate will fail if the authentication tag is
+  // invalid. In that case, remember the error and throw in final().
+  if (!r && kind_ == kDecipher &&
+      EVP_CIPHER_CTX_mode(ctx_.get()) == EVP_CIPH_CCM_MODE) {
+    pending_auth_failed_ = true;
+    return kSuccess;
+  }
+  return r == 1 ? kSuccess : kErrorState;
+}
+
+CipherBase::UpdateResult CipherBase::Update(
+    const char* data,
+    size_t len,
+    std::unique_ptr<BackingStore>* out) {
+  MarkPopErrorOnReturn mark_pop_error_on_return;
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+
+  int buf_len;
+  UpdateResult r = GetUpdateOutputLength(in, len, &buf_len);
+  if (r != kSuccess)
+    return r;
 
   {
     NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
     *out = ArrayBuffer::NewBackingStore(env()->isolate(), buf_len);
   }
 
-  int r = EVP_CipherUpdate(ctx_.get(),
-                           static_cast<unsigned char*>((*out)->Data()),
-                           &buf_len,
-                           reinterpret_cast<const unsigned char*>(data),
-                           len);
+  r = CipherUpdate(
+      in, len, static_cast<unsigned char*>((*out)->Data()), &buf_len);
 
   CHECK_LE(static_cast<size_t>(buf_len), (*out)->ByteLength());
   if (buf_len == 0) {
@@ -842,13 +1009,23 @@ CipherBase::UpdateResult CipherBase::Update(
            buf_len);
   }
 
-  // When in CCM mode, EVP_CipherUpdate will fail if the authentication tag is
-  // invalid. In that case, remember the error and throw in final().
-  if (!r && kind_ == kDecipher && mode == EVP_CIPH_CCM_MODE) {
-    pending_auth_failed_ = true;
-    return kSuccess;
-  }
-  return r == 1 ? kSuccess : kErrorState;
+  return r;
+}
+
+CipherBase::UpdateResult CipherBase::UpdateInto(const unsigned char* data,
+                                                size_t len,
+                                                unsigned char* out,
+                                                size_t out_capacity,
+                                                int* out_len) {
+  MarkPopErrorOnReturn mark_pop_error_on_return;
+
+  UpdateResult r = GetUpdateOutputLength(data, len, out_len);
+  if (r != kSuccess)
+    return r;
+  if (static_cast<size_t>(*out_len) > out_capacity)
+    return kErrorOutputSize;
+
+  return CipherUpdate(data, len, out, out_len);
 }
 
 void CipherBase::Update(const FunctionCallbackInfo<Value>& args) {
@@ -877,6 +1054,46 @@ void CipherBase::Update(const FunctionCallbackInfo<Value>& args) {
   });
 }
 
+// updateInto(data, output, outputOffset) writes the output into the given
+// view, which may be the input itself, and returns the number of bytes
+// written. Block ciphers need up to one block of extra room in the output.
+void CipherBase::UpdateInto(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CipherBase* cipher;
+  ASSIGN_OR_RETURN_UNWRAP(&cipher, args.This());
+
+  CHECK(IsAnyBufferSource(args[0]));
+  CHECK(args[1]->IsArrayBufferView());
+  CHECK(args[2]->IsUint32());
+
+  ArrayBufferOrViewContents<unsigned char> data(args[0]);
+  ArrayBufferOrViewContents<unsigned char> output(args[1]);
+  if (UNLIKELY(!data.CheckSizeInt32()))
+    return THROW_ERR_OUT_OF_RANGE(env, "data is too long");
+
+  const size_t offset = args[2].As<Uint32>()->Value();
+  if (offset > output.size())
+    return THROW_ERR_OUT_OF_RANGE(env, "The output offset is out of range");
+
+  int written;
+  UpdateResult r = cipher->UpdateInto(data.data(),
+                                      data.size(),
+                                      output.data() + offset,
+                                      output.size() - offset,
+                                      &written);
+  switch (r) {
+    case kSuccess:
+      return args.GetReturnValue().Set(written);
+    case kErrorOutputSize:
+      return THROW_ERR_OUT_OF_RANGE(env, "The output buffer is too small");
+    case kErrorState:
+      return ThrowCryptoError(env, ERR_get_error(),
+                              "Trying to add data in unsupported state");
+    case kErrorMessageSize:
+      return;
+  }
+}
+
 bool CipherBase::SetAutoPadding(bool auto_padding) {
   if (!ctx_)
     return false;
@@ -34,6 +34,7 @@ class CipherBase : public BaseObject {
   enum UpdateResult {
     kSuccess,
     kErrorMessageSize,
+    kErrorOutputSize,
     kErrorState
   };
   enum AuthTagState {
@@ -60,8 +61,20 @@ class CipherBase : public BaseObject {
   bool InitAuthenticated(const char* cipher_type, int iv_len,
                          unsigned int auth_tag_len);
   bool CheckCCMMessageLength(int message_len);
+  UpdateResult GetUpdateOutputLength(const unsigned char* data,
+                                     size_t len,
+                                     int* out_len);
+  UpdateResult CipherUpdate(const unsigned char* data,
+                            size_t len,
+                            unsigned char* out,
+                            int* out_len);
   UpdateResult Update(const char* data, size_t len,
                       std::unique_ptr<v8::BackingStore>* out);
+  UpdateResult UpdateInto(const unsigned char* data,
+                          size_t len,
+                          unsigned char* out,
+                          size_t out_capacity,
+                          int* out_len);
   bool Final(std::unique_ptr<v8::BackingStore>* out);
   bool SetAutoPadding(bool auto_padding);
 
@@ -75,6 +88,7 @@ class CipherBase : public BaseObject {
   static void Init(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void InitIv(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Update(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void UpdateInto(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Final(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetAutoPadding(const v8::FunctionCallbackInfo<v8::Value>& args);
 
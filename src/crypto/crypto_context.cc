@@ -2,6 +2,7 @@
 #include "base_object-inl.h"
 #include "crypto/crypto_bio.h"
 #include "crypto/crypto_common.h"
+#include "crypto/crypto_tls.h"
 #include "crypto/crypto_util.h"
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
@@ -38,11 +39,13 @@ using v8::JustVoid;
 using v8::Local;
 using v8::Maybe;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
 using v8::Signature;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 
 namespace crypto {
@@ -54,6 +57,15 @@ static const char system_cert_path[] = NODE_OPENSSL_SYSTEM_CERT_PATH;
 
 static std::string extra_root_certs_file;  // NOLINT(runtime/string)
 
+// Once its SSL_CTX is shared with other threads, a SecureContext is read-only.
+#define RETURN_IF_SHARED(sc)                                                   \
+  do {                                                                         \
+    if ((sc)->is_shared()) {                                                   \
+      return THROW_ERR_INVALID_STATE(                                          \
+          (sc)->env(), "A shared SecureContext cannot be modified");           \
+    }                                                                          \
+  } while (0)
+
 X509_STORE* GetOrCreateRootCertStore() {
   // Guaranteed thread-safe by standard, just don't use -fno-threadsafe-statics.
   static X509_STORE* store = NewRootCertStore();
@@ -333,8 +345,18 @@ Local<FunctionTemplate> SecureContext::GetConstructorTemplate(
     SetProtoMethod(isolate, tmpl, "setTicketKeys", SetTicketKeys);
     SetProtoMethod(
         isolate, tmpl, "enableTicketKeyCallback", EnableTicketKeyCallback);
+    SetProtoMethod(isolate, tmpl, "setSNIContexts", SetSNIContexts);
+    SetProtoMethod(isolate, tmpl, "enableSessionCache", EnableSessionCache);
+    SetProtoMethod(
+        isolate, tmpl, "enableClientSessionCache", EnableClientSessionCache);
 
     SetProtoMethodNoSideEffect(isolate, tmpl, "getTicketKeys", GetTicketKeys);
+    SetProtoMethodNoSideEffect(
+        isolate, tmpl, "getSessionCacheStats", GetSessionCacheStats);
+    SetProtoMethodNoSideEffect(isolate,
+                               tmpl,
+                               "getClientSessionCacheStats",
+                               GetClientSessionCacheStats);
     SetProtoMethodNoSideEffect(
         isolate, tmpl, "getCertificate", GetCertificate<true>);
     SetProtoMethodNoSideEffect(
@@ -406,6 +428,11 @@ void SecureContext::RegisterExternalReferences(
   registry->Register(LoadPKCS12);
   registry->Register(SetTicketKeys);
   registry->Register(EnableTicketKeyCallback);
+  registry->Register(SetSNIContexts);
+  registry->Register(EnableSessionCache);
+  registry->Register(GetSessionCacheStats);
+  registry->Register(EnableClientSessionCache);
+  registry->Register(GetClientSessionCacheStats);
   registry->Register(GetTicketKeys);
   registry->Register(GetCertificate<true>);
   registry->Register(GetCertificate<false>);
@@ -444,6 +471,9 @@ inline void SecureContext::Reset() {
   ctx_.reset();
   cert_.reset();
   issuer_.reset();
+  sni_contexts_.clear();
+  session_cache_.reset();
+  client_session_cache_.reset();
 }
 
 SecureContext::~SecureContext() {
@@ -552,6 +582,11 @@ void SecureContext::Init(const FunctionCallbackInfo<Value>& args) {
     return ThrowCryptoError(env, ERR_get_error(), "SSL_CTX_new");
   }
   SSL_CTX_set_app_data(sc->ctx_.get(), sc);
+  SharedCtxData* data = new SharedCtxData();
+  if (!SSL_CTX_set_ex_data(sc->ctx_.get(), SharedCtxDataIndex(), data)) {
+    delete data;
+    return ThrowCryptoError(env, ERR_get_error(), "SSL_CTX_set_ex_data");
+  }
 
   // Disable SSLv2 in the case when method == TLS_method() and the
   // cipher list contains SSLv2 ciphers (not the default, should be rare.)
@@ -581,13 +616,99 @@ void SecureContext::Init(const FunctionCallbackInfo<Value>& args) {
   // OpenSSL 1.1.0 changed the ticket key size, but the OpenSSL 1.0.x size was
   // exposed in the public API. To retain compatibility, install a callback
   // which restores the old algorithm.
-  if (!ncrypto::CSPRNG(sc->ticket_key_name_, sizeof(sc->ticket_key_name_)) ||
-      !ncrypto::CSPRNG(sc->ticket_key_hmac_, sizeof(sc->ticket_key_hmac_)) ||
-      !ncrypto::CSPRNG(sc->ticket_key_aes_, sizeof(sc->ticket_key_aes_))) {
+  if (!ncrypto::CSPRNG(data->ticket_key_name,
+                       sizeof(data->ticket_key_name)) ||
+      !ncrypto::CSPRNG(data->ticket_key_hmac,
+                       sizeof(data->ticket_key_hmac)) ||
+      !ncrypto::CSPRNG(data->ticket_key_aes, sizeof(data->ticket_key_aes))) {
     return THROW_ERR_CRYPTO_OPERATION_FAILED(
         env, "Error generating ticket keys");
   }
   SSL_CTX_set_tlsext_ticket_key_cb(sc->ctx_.get(), TicketCompatibilityCallback);
+
+  TLSWrap::ConfigureSecureContext(sc);
+}
+
+int SecureContext::SharedCtxDataIndex() {
+  static const int index = SSL_CTX_get_ex_new_index(
+      0,
+      nullptr,
+      nullptr,
+      nullptr,
+      [](void* parent,
+         void* ptr,
+         CRYPTO_EX_DATA* ad,
+         int idx,
+         long argl,  // NOLINT(runtime/int)
+         void* argp) { delete static_cast<SharedCtxData*>(ptr); });
+  CHECK_GE(index, 0);
+  return index;
+}
+
+SecureContext::SharedCtxData* SecureContext::shared_data() const {
+  CHECK(ctx_);
+  return static_cast<SharedCtxData*>(
+      SSL_CTX_get_ex_data(ctx_.get(), SharedCtxDataIndex()));
+}
+
+bool SecureContext::is_shared() const {
+  return ctx_ && shared_data()->shared.load(std::memory_order_acquire);
+}
+
+BaseObject::TransferMode SecureContext::GetTransferMode() const {
+  // The JavaScript ticket key callback and engine-backed keys are bound to
+  // the thread that set them up.
+  if (!ctx_ || ticket_key_callback_enabled_) {
+    return TransferMode::kDisallowCloneAndTransfer;
+  }
+#ifndef OPENSSL_NO_ENGINE
+  if (private_key_engine_ || client_cert_engine_provided_) {
+    return TransferMode::kDisallowCloneAndTransfer;
+  }
+#endif  // !OPENSSL_NO_ENGINE
+  return TransferMode::kCloneable;
+}
+
+std::unique_ptr<worker::TransferData> SecureContext::CloneForMessaging()
+    const {
+  shared_data()->shared.store(true, std::memory_order_release);
+  return std::make_unique<SecureContextTransferData>(this);
+}
+
+SecureContext::SecureContextTransferData::SecureContextTransferData(
+    const SecureContext* sc) {
+  CHECK_EQ(SSL_CTX_up_ref(sc->ctx_.get()), 1);
+  ctx_.reset(sc->ctx_.get());
+  if (sc->cert_) {
+    CHECK_EQ(X509_up_ref(sc->cert_.get()), 1);
+    cert_.reset(sc->cert_.get());
+  }
+  if (sc->issuer_) {
+    CHECK_EQ(X509_up_ref(sc->issuer_.get()), 1);
+    issuer_.reset(sc->issuer_.get());
+  }
+  session_cache_ = sc->session_cache_;
+  client_session_cache_ = sc->client_session_cache_;
+}
+
+BaseObjectPtr<BaseObject>
+SecureContext::SecureContextTransferData::Deserialize(
+    Environment* env,
+    Local<Context> context,
+    std::unique_ptr<worker::TransferData> self) {
+  if (context != env->context()) {
+    THROW_ERR_MESSAGE_TARGET_CONTEXT_UNAVAILABLE(env);
+    return {};
+  }
+
+  SecureContext* sc = SecureContext::Create(env);
+  if (sc == nullptr) return {};
+  sc->ctx_ = std::move(ctx_);
+  sc->cert_ = std::move(cert_);
+  sc->issuer_ = std::move(issuer_);
+  sc->session_cache_ = std::move(session_cache_);
+  sc->client_session_cache_ = std::move(client_session_cache_);
+  return BaseObjectPtr<BaseObject>(sc);
 }
 
 SSLPointer SecureContext::CreateSSL() {
@@ -606,6 +727,21 @@ void SecureContext::SetSelectSNIContextCallback(SelectSNIContextCb cb) {
   SSL_CTX_set_tlsext_servername_callback(ctx_.get(), cb);
 }
 
+SecureContext* SecureContext::FindSNIContext(const char* servername) const {
+  if (sni_contexts_.empty() || servername == nullptr) return nullptr;
+
+  std::string name = ToLower(servername);
+  auto it = sni_contexts_.find(name);
+  if (it == sni_contexts_.end()) {
+    size_t dot = name.find('.');
+    if (dot == std::string::npos || dot == 0) return nullptr;
+    name.replace(0, dot, "*");
+    it = sni_contexts_.find(name);
+    if (it == sni_contexts_.end()) return nullptr;
+  }
+  return it->second.get();
+}
+
 void SecureContext::SetKeylogCallback(KeylogCb cb) {
   SSL_CTX_set_keylog_callback(ctx_.get(), cb);
 }
@@ -631,6 +767,7 @@ void SecureContext::SetKey(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);  // Private key argument is mandatory
 
@@ -662,6 +799,7 @@ void SecureContext::SetKey(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetSigalgs(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
   ClearErrorOnReturn clear_error_on_return;
 
@@ -680,6 +818,7 @@ void SecureContext::SetEngineKey(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_EQ(args.Length(), 2);
 
@@ -746,6 +885,7 @@ void SecureContext::SetCert(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);  // Certificate argument is mandatory
 
@@ -773,6 +913,7 @@ void SecureContext::AddCACert(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);  // CA certificate argument is mandatory
 
@@ -811,6 +952,7 @@ void SecureContext::AddCRL(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);  // CRL argument is mandatory
 
@@ -830,6 +972,7 @@ void SecureContext::SetRootCerts() {
 void SecureContext::AddRootCerts(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   sc->SetRootCerts();
 }
 
@@ -838,6 +981,7 @@ void SecureContext::SetCipherSuites(const FunctionCallbackInfo<Value>& args) {
 #ifndef OPENSSL_IS_BORINGSSL
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
   ClearErrorOnReturn clear_error_on_return;
 
@@ -853,6 +997,7 @@ void SecureContext::SetCipherSuites(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetCiphers(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
   ClearErrorOnReturn clear_error_on_return;
 
@@ -877,6 +1022,7 @@ void SecureContext::SetCiphers(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetECDHCurve(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
 
   CHECK_GE(args.Length(), 1);  // ECDH curve name argument is mandatory
@@ -892,6 +1038,7 @@ void SecureContext::SetECDHCurve(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetDHParam(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
   ClearErrorOnReturn clear_error_on_return;
 
@@ -939,6 +1086,7 @@ void SecureContext::SetDHParam(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetMinProto(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_EQ(args.Length(), 1);
   CHECK(args[0]->IsInt32());
@@ -951,6 +1099,7 @@ void SecureContext::SetMinProto(const FunctionCallbackInfo<Value>& args) {
 void SecureContext::SetMaxProto(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_EQ(args.Length(), 1);
   CHECK(args[0]->IsInt32());
@@ -986,6 +1135,7 @@ void SecureContext::SetOptions(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);
   CHECK(args[0]->IsNumber());
@@ -1000,6 +1150,7 @@ void SecureContext::SetSessionIdContext(
     const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   Environment* env = sc->env();
 
   CHECK_GE(args.Length(), 1);
@@ -1031,6 +1182,7 @@ void SecureContext::SetSessionIdContext(
 void SecureContext::SetSessionTimeout(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   CHECK_GE(args.Length(), 1);
   CHECK(args[0]->IsInt32());
@@ -1040,6 +1192,144 @@ void SecureContext::SetSessionTimeout(const FunctionCallbackInfo<Value>& args) {
   SSL_CTX_set_timeout(sc->ctx_.get(), sessionTimeout);
 }
 
+// Bulk updates the server name map consulted by FindSNIContext(). Takes an
+// array of server names and a matching array of SecureContexts; an undefined
+// context removes the name. When the third argument is true the existing
+// entries are discarded first. Returns the resulting number of entries.
+void SecureContext::SetSNIContexts(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+
+  CHECK_EQ(args.Length(), 3);
+  CHECK(args[0]->IsArray());
+  CHECK(args[1]->IsArray());
+  CHECK(args[2]->IsBoolean());
+
+  Local<Array> names = args[0].As<Array>();
+  Local<Array> contexts = args[1].As<Array>();
+  CHECK_EQ(names->Length(), contexts->Length());
+
+  if (args[2]->IsTrue()) sc->sni_contexts_.clear();
+
+  Local<Context> context = env->context();
+  for (uint32_t n = 0; n < names->Length(); n++) {
+    Local<Value> name;
+    Local<Value> ctx;
+    if (!names->Get(context, n).ToLocal(&name) ||
+        !contexts->Get(context, n).ToLocal(&ctx)) {
+      return;
+    }
+    CHECK(name->IsString());
+    std::string key = ToLower(Utf8Value(env->isolate(), name).ToString());
+    if (ctx->IsUndefined()) {
+      sc->sni_contexts_.erase(key);
+      continue;
+    }
+    if (!HasInstance(env, ctx)) {
+      return THROW_ERR_INVALID_ARG_TYPE(
+          env, "SNI contexts must be SecureContext instances");
+    }
+    SecureContext* entry = Unwrap<SecureContext>(ctx.As<Object>());
+    CHECK_NOT_NULL(entry);
+    sc->sni_contexts_[std::move(key)] = BaseObjectPtr<SecureContext>(entry);
+  }
+
+  args.GetReturnValue().Set(
+      static_cast<double>(sc->sni_contexts_.size()));
+}
+
+// Sets up the native session cache. Takes the cache name (an empty string for
+// a cache private to this process), the maximum number of entries and the
+// maximum lifetime of an entry in seconds. Contexts created with the same
+// name, in this process or in others, share their sessions.
+void SecureContext::EnableSessionCache(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+
+  CHECK_EQ(args.Length(), 3);
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsUint32());
+  CHECK(args[2]->IsUint32());
+
+  std::string name = Utf8Value(env->isolate(), args[0]).ToString();
+  uint32_t max_entries = args[1].As<Uint32>()->Value();
+  uint32_t ttl = args[2].As<Uint32>()->Value();
+  if (name.find('/') != std::string::npos) {
+    return THROW_ERR_INVALID_ARG_VALUE(
+        env, "The session cache name must not contain '/'");
+  }
+  if (max_entries == 0) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The session cache must hold at least one entry");
+  }
+
+  sc->session_cache_ = TLSSessionCache::Open(name, max_entries, ttl);
+  if (!sc->session_cache_) {
+    return THROW_ERR_CRYPTO_OPERATION_FAILED(
+        env, "Failed to set up the TLS session cache");
+  }
+}
+
+void SecureContext::GetSessionCacheStats(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  if (!sc->session_cache_) return;
+
+  TLSSessionCache::Stats stats = sc->session_cache_->GetStats();
+  Local<Value> values[] = {
+      Number::New(env->isolate(), static_cast<double>(stats.hits)),
+      Number::New(env->isolate(), static_cast<double>(stats.misses)),
+      Number::New(env->isolate(), static_cast<double>(stats.stores)),
+      Number::New(env->isolate(), static_cast<double>(stats.evictions)),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
+// Sets up the native client session cache, which TLSWrap uses for clients
+// given a key with setClientSessionKey(). Takes the maximum number of keys.
+void SecureContext::EnableClientSessionCache(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+
+  CHECK_EQ(args.Length(), 1);
+  CHECK(args[0]->IsUint32());
+  uint32_t max_entries = args[0].As<Uint32>()->Value();
+  if (max_entries == 0) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The session cache must hold at least one entry");
+  }
+
+  sc->client_session_cache_ =
+      std::make_shared<TLSClientSessionCache>(max_entries);
+}
+
+void SecureContext::GetClientSessionCacheStats(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  if (!sc->client_session_cache_) return;
+
+  TLSClientSessionCache::Stats stats = sc->client_session_cache_->GetStats();
+  Local<Value> values[] = {
+      Number::New(env->isolate(), static_cast<double>(stats.lookups)),
+      Number::New(env->isolate(), static_cast<double>(stats.misses)),
+      Number::New(env->isolate(), static_cast<double>(stats.resumed)),
+      Number::New(env->isolate(), static_cast<double>(stats.stores)),
+      Number::New(env->isolate(), static_cast<double>(stats.evictions)),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
 void SecureContext::Close(const FunctionCallbackInfo<Value>& args) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
@@ -1055,6 +1345,7 @@ void SecureContext::LoadPKCS12(const FunctionCallbackInfo<Value>& args) {
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
   ClearErrorOnReturn clear_error_on_return;
 
   if (args.Length() < 1) {
@@ -1164,6 +1455,7 @@ void SecureContext::SetClientCertEngine(
 
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, args.This());
+  RETURN_IF_SHARED(sc);
 
   MarkPopErrorOnReturn mark_pop_error_on_return;
 
@@ -1211,9 +1503,11 @@ void SecureContext::GetTicketKeys(const FunctionCallbackInfo<Value>& args) {
   if (!Buffer::New(wrap->env(), 48).ToLocal(&buff))
     return;
 
-  memcpy(Buffer::Data(buff), wrap->ticket_key_name_, 16);
-  memcpy(Buffer::Data(buff) + 16, wrap->ticket_key_hmac_, 16);
-  memcpy(Buffer::Data(buff) + 32, wrap->ticket_key_aes_, 16);
+  SharedCtxData* data = wrap->shared_data();
+  Mutex::ScopedLock lock(data->mutex);
+  memcpy(Buffer::Data(buff), data->ticket_key_name, 16);
+  memcpy(Buffer::Data(buff) + 16, data->ticket_key_hmac, 16);
+  memcpy(Buffer::Data(buff) + 32, data->ticket_key_aes, 16);
 
   args.GetReturnValue().Set(buff);
 }
@@ -1228,9 +1522,13 @@ void SecureContext::SetTicketKeys(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_EQ(buf.length(), 48);
 
-  memcpy(wrap->ticket_key_name_, buf.data(), 16);
-  memcpy(wrap->ticket_key_hmac_, buf.data() + 16, 16);
-  memcpy(wrap->ticket_key_aes_, buf.data() + 32, 16);
+  // The keys are shared with any clones of this context, which pick up the
+  // new keys for their next handshake.
+  SharedCtxData* data = wrap->shared_data();
+  Mutex::ScopedLock lock(data->mutex);
+  memcpy(data->ticket_key_name, buf.data(), 16);
+  memcpy(data->ticket_key_hmac, buf.data() + 16, 16);
+  memcpy(data->ticket_key_aes, buf.data() + 32, 16);
 
   args.GetReturnValue().Set(true);
 }
@@ -1242,7 +1540,9 @@ void SecureContext::EnableTicketKeyCallback(
   SecureContext* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
 
+  RETURN_IF_SHARED(wrap);
   SSL_CTX_set_tlsext_ticket_key_cb(wrap->ctx_.get(), TicketKeyCallback);
+  wrap->ticket_key_callback_enabled_ = true;
 }
 
 int SecureContext::TicketKeyCallback(SSL* ssl,
@@ -1352,17 +1652,20 @@ int SecureContext::TicketCompatibilityCallback(SSL* ssl,
                                                EVP_CIPHER_CTX* ectx,
                                                HMAC_CTX* hctx,
                                                int enc) {
-  SecureContext* sc = static_cast<SecureContext*>(
-      SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  // This can run on any thread that shares the SSL_CTX, so the keys are
+  // taken from the SSL_CTX rather than from the SecureContext that created it.
+  SharedCtxData* data = static_cast<SharedCtxData*>(
+      SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), SharedCtxDataIndex()));
+  Mutex::ScopedLock lock(data->mutex);
 
   if (enc) {
-    memcpy(name, sc->ticket_key_name_, sizeof(sc->ticket_key_name_));
+    memcpy(name, data->ticket_key_name, sizeof(data->ticket_key_name));
     if (!ncrypto::CSPRNG(iv, 16) ||
         EVP_EncryptInit_ex(
-            ectx, EVP_aes_128_cbc(), nullptr, sc->ticket_key_aes_, iv) <= 0 ||
+            ectx, EVP_aes_128_cbc(), nullptr, data->ticket_key_aes, iv) <= 0 ||
         HMAC_Init_ex(hctx,
-                     sc->ticket_key_hmac_,
-                     sizeof(sc->ticket_key_hmac_),
+                     data->ticket_key_hmac,
+                     sizeof(data->ticket_key_hmac),
                      EVP_sha256(),
                      nullptr) <= 0) {
       return -1;
@@ -1370,14 +1673,14 @@ int SecureContext::TicketCompatibilityCallback(SSL* ssl,
     return 1;
   }
 
-  if (memcmp(name, sc->ticket_key_name_, sizeof(sc->ticket_key_name_)) != 0) {
+  if (memcmp(name, data->ticket_key_name, sizeof(data->ticket_key_name)) != 0) {
     // The ticket key name does not match. Discard the ticket.
     return 0;
   }
 
-  if (EVP_DecryptInit_ex(ectx, EVP_aes_128_cbc(), nullptr, sc->ticket_key_aes_,
-                         iv) <= 0 ||
-      HMAC_Init_ex(hctx, sc->ticket_key_hmac_, sizeof(sc->ticket_key_hmac_),
+  if (EVP_DecryptInit_ex(ectx, EVP_aes_128_cbc(), nullptr,
+                         data->ticket_key_aes, iv) <= 0 ||
+      HMAC_Init_ex(hctx, data->ticket_key_hmac, sizeof(data->ticket_key_hmac),
                    EVP_sha256(), nullptr) <= 0) {
     return -1;
   }
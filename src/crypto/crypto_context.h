@@ -5,11 +5,18 @@
 
 #include "base_object.h"
 #include "crypto/crypto_keys.h"
+#include "crypto/crypto_session_cache.h"
 #include "crypto/crypto_util.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_mutex.h"
+#include "node_worker.h"
 #include "v8.h"
 
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
 namespace node {
 namespace crypto {
 // A maxVersion of 0 means "any", but OpenSSL may support TLS versions that
@@ -54,6 +61,21 @@ class SecureContext final : public BaseObject {
   void SetNewSessionCallback(NewSessionCb cb);
   void SetSelectSNIContextCallback(SelectSNIContextCb cb);
 
+  // Returns the context registered with setSNIContexts() for the given server
+  // name, or nullptr if there is none. Names are compared case-insensitively,
+  // and a "*.example.com" entry matches exactly one additional leading label.
+  SecureContext* FindSNIContext(const char* servername) const;
+
+  // The native server-side session cache set up with enableSessionCache(),
+  // if any. When present, TLSWrap stores and resumes sessions through it
+  // instead of the 'newSession' and 'resumeSession' events.
+  TLSSessionCache* session_cache() const { return session_cache_.get(); }
+
+  // The client session cache set up with enableClientSessionCache(), if any.
+  TLSClientSessionCache* client_session_cache() const {
+    return client_session_cache_.get();
+  }
+
   inline const X509Pointer& issuer() const { return issuer_; }
   inline const X509Pointer& cert() const { return cert_; }
 
@@ -69,6 +91,38 @@ class SecureContext final : public BaseObject {
   SET_MEMORY_INFO_NAME(SecureContext)
   SET_SELF_SIZE(SecureContext)
 
+  // A SecureContext can be cloned into other threads with postMessage(). The
+  // clone shares the same SSL_CTX (and with it the certificates, keys, X509
+  // store and ticket keys) rather than parsing everything again. Once that
+  // happened, the SSL_CTX is used without synchronization on several threads
+  // and none of the SecureContexts sharing it may modify it any further.
+  class SecureContextTransferData : public worker::TransferData {
+   public:
+    explicit SecureContextTransferData(const SecureContext* sc);
+
+    BaseObjectPtr<BaseObject> Deserialize(
+        Environment* env,
+        v8::Local<v8::Context> context,
+        std::unique_ptr<worker::TransferData> self) override;
+
+    SET_MEMORY_INFO_NAME(SecureContextTransferData)
+    SET_SELF_SIZE(SecureContextTransferData)
+    SET_NO_MEMORY_INFO()
+
+   private:
+    SSLCtxPointer ctx_;
+    X509Pointer cert_;
+    X509Pointer issuer_;
+    std::shared_ptr<TLSSessionCache> session_cache_;
+    std::shared_ptr<TLSClientSessionCache> client_session_cache_;
+  };
+
+  BaseObject::TransferMode GetTransferMode() const override;
+  std::unique_ptr<worker::TransferData> CloneForMessaging() const override;
+
+  // True once the SSL_CTX has been shared with another SecureContext.
+  bool is_shared() const;
+
   static const int kMaxSessionSize = 10 * 1024;
 
   // See TicketKeyCallback
@@ -116,6 +170,15 @@ class SecureContext final : public BaseObject {
   static void SetTicketKeys(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void EnableTicketKeyCallback(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetSNIContexts(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableSessionCache(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetSessionCacheStats(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableClientSessionCache(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetClientSessionCacheStats(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
   static void CtxGetter(const v8::FunctionCallbackInfo<v8::Value>& info);
 
   template <bool primary>
@@ -138,6 +201,20 @@ class SecureContext final : public BaseObject {
   SecureContext(Environment* env, v8::Local<v8::Object> wrap);
   void Reset();
 
+  // State that is attached to the SSL_CTX itself, and therefore common to
+  // every SecureContext using it, on whichever thread. It is released by
+  // OpenSSL together with the SSL_CTX.
+  struct SharedCtxData {
+    Mutex mutex;
+    unsigned char ticket_key_name[16];
+    unsigned char ticket_key_aes[16];
+    unsigned char ticket_key_hmac[16];
+    std::atomic<bool> shared{false};
+  };
+
+  static int SharedCtxDataIndex();
+  SharedCtxData* shared_data() const;
+
  private:
   SSLCtxPointer ctx_;
   X509Pointer cert_;
@@ -147,9 +224,11 @@ class SecureContext final : public BaseObject {
   ncrypto::EnginePointer private_key_engine_;
 #endif  // !OPENSSL_NO_ENGINE
 
-  unsigned char ticket_key_name_[16];
-  unsigned char ticket_key_aes_[16];
-  unsigned char ticket_key_hmac_[16];
+  bool ticket_key_callback_enabled_ = false;
+
+  std::unordered_map<std::string, BaseObjectPtr<SecureContext>> sni_contexts_;
+  std::shared_ptr<TLSSessionCache> session_cache_;
+  std::shared_ptr<TLSClientSessionCache> client_session_cache_;
 };
 
 int SSL_CTX_use_certificate_chain(SSL_CTX* ctx,
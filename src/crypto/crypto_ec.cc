@@ -581,6 +581,11 @@ EVPKeyCtxPointer EcKeyGenTraits::Setup(EcKeyPairGenConfig* params) {
   return key_ctx;
 }
 
+std::string EcKeyGenTraits::PoolKey(const EcKeyPairGenConfig& params) {
+  return "ec:" + std::to_string(params.params.curve_nid) + ":" +
+         std::to_string(params.params.param_encoding);
+}
+
 // EcKeyPairGenJob input arguments
 //   1. CryptoJobMode
 //   2. Curve Name
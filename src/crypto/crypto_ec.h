@@ -106,6 +106,7 @@ struct EcKeyGenTraits final {
   static constexpr const char* JobName = "EcKeyPairGenJob";
 
   static EVPKeyCtxPointer Setup(EcKeyPairGenConfig* params);
+  static std::string PoolKey(const EcKeyPairGenConfig& params);
 
   static v8::Maybe<bool> AdditionalConfig(
       CryptoJobMode mode,
@@ -11,6 +11,8 @@
 
 namespace node {
 
+using v8::Array;
+using v8::ArrayBufferView;
 using v8::Context;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
@@ -24,6 +26,8 @@ using v8::Name;
 using v8::Nothing;
 using v8::Object;
 using v8::Uint32;
+using v8::Uint32Array;
+using v8::Undefined;
 using v8::Value;
 
 namespace crypto {
@@ -202,6 +206,42 @@ const EVP_MD* GetDigestImplementation(Environment* env,
 #endif
 }
 
+namespace {
+// Digests count inputs into consecutive EVP_MD_size(md) sized slots of out.
+// A single context is reused throughout, so that past the first input the
+// cost is just the hash itself rather than a context allocation and digest
+// fetch per input as with EVP_Digest().
+template <typename InputAt>
+bool DigestEach(const EVP_MD* md,
+                size_t count,
+                InputAt input_at,
+                unsigned char* out) {
+  EVPMDCtxPointer ctx(EVP_MD_CTX_new());
+  if (!ctx) return false;
+  const size_t md_len = EVP_MD_size(md);
+  for (size_t i = 0; i < count; i++) {
+    auto [data, length] = input_at(i);
+    unsigned int result_size;
+    if (EVP_DigestInit_ex(ctx.get(), md, nullptr) <= 0 ||
+        EVP_DigestUpdate(ctx.get(), data, length) <= 0 ||
+        EVP_DigestFinal_ex(ctx.get(), out + i * md_len, &result_size) <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that offsets has at least one entry, and describes non-decreasing
+// ranges that end within length.
+bool ValidBatchOffsets(const uint32_t* offsets, size_t count, size_t length) {
+  if (count == 0) return false;
+  for (size_t i = 1; i < count; i++) {
+    if (offsets[i] < offsets[i - 1]) return false;
+  }
+  return offsets[count - 1] <= length;
+}
+}  // namespace
+
 // crypto.digest(algorithm, algorithmId, algorithmCache,
 //               input, outputEncoding, outputEncodingId)
 void Hash::OneShotDigest(const FunctionCallbackInfo<Value>& args) {
@@ -267,6 +307,85 @@ void Hash::OneShotDigest(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(rc.FromMaybe(Local<Value>()));
 }
 
+// hash.batchDigest(algorithm, algorithmId, algorithmCache, input, offsets)
+//
+// Returns a single Buffer holding the digests of every input, back to back.
+// The inputs are either an array of ArrayBufferViews (offsets undefined) or
+// one ArrayBufferView and a Uint32Array of n + 1 offsets delimiting n inputs.
+void Hash::BatchDigest(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  CHECK_EQ(args.Length(), 5);
+  CHECK(args[0]->IsString());                                 // algorithm
+  CHECK(args[1]->IsInt32());                                  // algorithmId
+  CHECK(args[2]->IsObject());                                 // algorithmCache
+  CHECK(args[3]->IsArray() || args[3]->IsArrayBufferView());  // input
+  CHECK(args[4]->IsUint32Array() || args[4]->IsUndefined());  // offsets
+
+  const EVP_MD* md = GetDigestImplementation(env, args[0], args[1], args[2]);
+  if (md == nullptr) {
+    Utf8Value method(isolate, args[0]);
+    std::string message =
+        "Digest method " + method.ToString() + " is not supported";
+    return ThrowCryptoError(env, ERR_get_error(), message.c_str());
+  }
+  const size_t md_len = EVP_MD_size(md);
+
+  bool success;
+  Local<Object> result;
+  if (args[3]->IsArray()) {
+    CHECK(args[4]->IsUndefined());
+    Local<Array> inputs = args[3].As<Array>();
+    std::vector<std::pair<const unsigned char*, size_t>> views;
+    views.reserve(inputs->Length());
+    for (uint32_t i = 0; i < inputs->Length(); i++) {
+      Local<Value> input;
+      if (!inputs->Get(env->context(), i).ToLocal(&input)) return;
+      if (!input->IsArrayBufferView()) {
+        return THROW_ERR_INVALID_ARG_TYPE(
+            env, "Every batch input must be an ArrayBufferView");
+      }
+      Local<ArrayBufferView> view = input.As<ArrayBufferView>();
+      views.emplace_back(
+          static_cast<const unsigned char*>(view->Buffer()->Data()) +
+              view->ByteOffset(),
+          view->ByteLength());
+    }
+    if (!Buffer::New(env, views.size() * md_len).ToLocal(&result)) return;
+    success = DigestEach(
+        md,
+        views.size(),
+        [&](size_t i) { return views[i]; },
+        reinterpret_cast<unsigned char*>(Buffer::Data(result)));
+  } else {
+    CHECK(args[4]->IsUint32Array());
+    ArrayBufferViewContents<unsigned char> input(args[3]);
+    Local<Uint32Array> offsets_array = args[4].As<Uint32Array>();
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(
+        static_cast<const char*>(offsets_array->Buffer()->Data()) +
+        offsets_array->ByteOffset());
+    const size_t offset_count = offsets_array->Length();
+    if (!ValidBatchOffsets(offsets, offset_count, input.length())) {
+      return THROW_ERR_OUT_OF_RANGE(env, "Invalid batch offsets");
+    }
+    const size_t count = offset_count - 1;
+    if (!Buffer::New(env, count * md_len).ToLocal(&result)) return;
+    success = DigestEach(
+        md,
+        count,
+        [&](size_t i) {
+          return std::make_pair(input.data() + offsets[i],
+                                size_t{offsets[i + 1] - offsets[i]});
+        },
+        reinterpret_cast<unsigned char*>(Buffer::Data(result)));
+  }
+
+  if (!success) {
+    return ThrowCryptoError(env, ERR_get_error());
+  }
+  args.GetReturnValue().Set(result);
+}
+
 void Hash::Initialize(Environment* env, Local<Object> target) {
   Isolate* isolate = env->isolate();
   Local<Context> context = env->context();
@@ -282,8 +401,11 @@ void Hash::Initialize(Environment* env, Local<Object> target) {
   SetMethodNoSideEffect(context, target, "getHashes", GetHashes);
   SetMethodNoSideEffect(context, target, "getCachedAliases", GetCachedAliases);
   SetMethodNoSideEffect(context, target, "oneShotDigest", OneShotDigest);
+  SetMethodNoSideEffect(context, target, "batchDigest", BatchDigest);
 
   HashJob::Initialize(env, target);
+  BatchHashJob::Initialize(env, target);
+  HashUpdateJob::Initialize(env, target);
 
   SetMethodNoSideEffect(
       context, target, "internalVerifyIntegrity", InternalVerifyIntegrity);
@@ -296,8 +418,11 @@ void Hash::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetHashes);
   registry->Register(GetCachedAliases);
   registry->Register(OneShotDigest);
+  registry->Register(BatchDigest);
 
   HashJob::RegisterExternalReferences(registry);
+  BatchHashJob::RegisterExternalReferences(registry);
+  HashUpdateJob::RegisterExternalReferences(registry);
 
   registry->Register(InternalVerifyIntegrity);
 }
@@ -310,6 +435,10 @@ void Hash::New(const FunctionCallbackInfo<Value>& args) {
   const EVP_MD* md = nullptr;
   if (args[0]->IsObject()) {
     ASSIGN_OR_RETURN_UNWRAP(&orig, args[0].As<Object>());
+    if (UNLIKELY(orig->async_pending_)) {
+      return THROW_ERR_CRYPTO_INVALID_STATE(
+          env, "Hash is in use by an asynchronous update");
+    }
     md = EVP_MD_CTX_md(orig->mdctx_.get());
   } else {
     md = GetDigestImplementation(env, args[0], args[2], args[3]);
@@ -367,6 +496,10 @@ void Hash::HashUpdate(const FunctionCallbackInfo<Value>& args) {
                   const char* data,
                   size_t size) {
                  Environment* env = Environment::GetCurrent(args);
+                 if (UNLIKELY(hash->async_pending_)) {
+                   return THROW_ERR_CRYPTO_INVALID_STATE(
+                       env, "Hash is in use by an asynchronous update");
+                 }
                  if (UNLIKELY(size > INT_MAX))
                    return THROW_ERR_OUT_OF_RANGE(env, "data is too long");
                  bool r = hash->HashUpdate(data, size);
@@ -374,25 +507,15 @@ void Hash::HashUpdate(const FunctionCallbackInfo<Value>& args) {
                });
 }
 
-void Hash::HashDigest(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
-
-  Hash* hash;
-  ASSIGN_OR_RETURN_UNWRAP(&hash, args.This());
-
-  enum encoding encoding = BUFFER;
-  if (args.Length() >= 1) {
-    encoding = ParseEncoding(env->isolate(), args[0], BUFFER);
-  }
-
-  unsigned int len = hash->md_len_;
+bool Hash::HashFinal() {
+  unsigned int len = md_len_;
 
   // TODO(tniessen): SHA3_squeeze does not work for zero-length outputs on all
   // platforms and will cause a segmentation fault if called. This workaround
   // causes hash.digest() to correctly return an empty buffer / string.
   // See https://github.com/openssl/openssl/issues/9431.
 
-  if (!hash->digest_ && len > 0) {
+  if (!digest_ && len > 0) {
     // Some hash algorithms such as SHA3 do not support calling
     // EVP_DigestFinal_ex more than once, however, Hash._flush
     // and Hash.digest can both be used to retrieve the digest,
@@ -401,24 +524,47 @@ void Hash::HashDigest(const FunctionCallbackInfo<Value>& args) {
 
     ByteSource::Builder digest(len);
 
-    size_t default_len = EVP_MD_CTX_size(hash->mdctx_.get());
+    size_t default_len = EVP_MD_CTX_size(mdctx_.get());
     int ret;
     if (len == default_len) {
       ret = EVP_DigestFinal_ex(
-          hash->mdctx_.get(), digest.data<unsigned char>(), &len);
-      // The output length should always equal hash->md_len_
-      CHECK_EQ(len, hash->md_len_);
+          mdctx_.get(), digest.data<unsigned char>(), &len);
+      // The output length should always equal md_len_
+      CHECK_EQ(len, md_len_);
     } else {
       ret = EVP_DigestFinalXOF(
-          hash->mdctx_.get(), digest.data<unsigned char>(), len);
+          mdctx_.get(), digest.data<unsigned char>(), len);
     }
 
     if (ret != 1)
-      return ThrowCryptoError(env, ERR_get_error());
+      return false;
+
+    digest_ = std::move(digest).release();
+  }
+
+  return true;
+}
+
+void Hash::HashDigest(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  Hash* hash;
+  ASSIGN_OR_RETURN_UNWRAP(&hash, args.This());
 
-    hash->digest_ = std::move(digest).release();
+  enum encoding encoding = BUFFER;
+  if (args.Length() >= 1) {
+    encoding = ParseEncoding(env->isolate(), args[0], BUFFER);
+  }
+
+  if (UNLIKELY(hash->async_pending_)) {
+    return THROW_ERR_CRYPTO_INVALID_STATE(
+        env, "Hash is in use by an asynchronous update");
   }
 
+  unsigned int len = hash->md_len_;
+  if (!hash->HashFinal())
+    return ThrowCryptoError(env, ERR_get_error());
+
   Local<Value> error;
   MaybeLocal<Value> rc = StringBytes::Encode(
       env->isolate(), hash->digest_.data<char>(), len, encoding, &error);
@@ -534,6 +680,214 @@ bool HashTraits::DeriveBits(
   return true;
 }
 
+BatchHashConfig::BatchHashConfig(BatchHashConfig&& other) noexcept
+    : mode(other.mode),
+      in(std::move(other.in)),
+      offsets(std::move(other.offsets)),
+      digest(other.digest) {}
+
+BatchHashConfig& BatchHashConfig::operator=(BatchHashConfig&& other) noexcept {
+  if (&other == this) return *this;
+  this->~BatchHashConfig();
+  return *new (this) BatchHashConfig(std::move(other));
+}
+
+void BatchHashConfig::MemoryInfo(MemoryTracker* tracker) const {
+  // If the Job is sync, then the BatchHashConfig does not own the data.
+  if (mode == kCryptoJobAsync)
+    tracker->TrackFieldWithSize("in", in.size());
+  tracker->TrackFieldWithSize("offsets", offsets.size() * sizeof(uint32_t));
+}
+
+Maybe<bool> BatchHashTraits::EncodeOutput(
+    Environment* env,
+    const BatchHashConfig& params,
+    ByteSource* out,
+    v8::Local<v8::Value>* result) {
+  *result = out->ToArrayBuffer(env);
+  return Just(!result->IsEmpty());
+}
+
+// new BatchHashJob(mode, algorithm, data, offsets)
+Maybe<bool> BatchHashTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    BatchHashConfig* params) {
+  Environment* env = Environment::GetCurrent(args);
+
+  params->mode = mode;
+
+  CHECK(args[offset]->IsString());  // Hash algorithm
+  Utf8Value digest(env->isolate(), args[offset]);
+  params->digest = EVP_get_digestbyname(*digest);
+  if (UNLIKELY(params->digest == nullptr)) {
+    THROW_ERR_CRYPTO_INVALID_DIGEST(env, "Invalid digest: %s", *digest);
+    return Nothing<bool>();
+  }
+
+  ArrayBufferOrViewContents<char> data(args[offset + 1]);
+  CHECK(args[offset + 2]->IsUint32Array());
+  Local<Uint32Array> offsets = args[offset + 2].As<Uint32Array>();
+  params->offsets.resize(offsets->Length());
+  offsets->CopyContents(params->offsets.data(),
+                        params->offsets.size() * sizeof(uint32_t));
+  if (!ValidBatchOffsets(
+          params->offsets.data(), params->offsets.size(), data.size())) {
+    THROW_ERR_OUT_OF_RANGE(env, "Invalid batch offsets");
+    return Nothing<bool>();
+  }
+  params->in = mode == kCryptoJobAsync
+      ? data.ToCopy()
+      : data.ToByteSource();
+
+  return Just(true);
+}
+
+bool BatchHashTraits::DeriveBits(
+    Environment* env,
+    const BatchHashConfig& params,
+    ByteSource* out) {
+  const size_t count = params.offsets.size() - 1;
+  ByteSource::Builder buf(count * EVP_MD_size(params.digest));
+  const unsigned char* in = params.in.data<unsigned char>();
+  if (!DigestEach(
+          params.digest,
+          count,
+          [&](size_t i) {
+            return std::make_pair(
+                in + params.offsets[i],
+                size_t{params.offsets[i + 1] - params.offsets[i]});
+          },
+          buf.data<unsigned char>())) {
+    return false;
+  }
+  *out = std::move(buf).release();
+  return true;
+}
+
+HashUpdateConfig::~HashUpdateConfig() {
+  if (hash) hash->set_async_pending(false);
+}
+
+HashUpdateConfig::HashUpdateConfig(HashUpdateConfig&& other) noexcept
+    : mode(other.mode),
+      hash(std::move(other.hash)),
+      chunks(std::move(other.chunks)),
+      finalize(other.finalize) {}
+
+HashUpdateConfig& HashUpdateConfig::operator=(
+    HashUpdateConfig&& other) noexcept {
+  if (&other == this) return *this;
+  this->~HashUpdateConfig();
+  return *new (this) HashUpdateConfig(std::move(other));
+}
+
+void HashUpdateConfig::MemoryInfo(MemoryTracker* tracker) const {
+  // If the Job is sync, then the HashUpdateConfig does not own the data.
+  if (mode == kCryptoJobAsync) {
+    size_t size = 0;
+    for (const ByteSource& chunk : chunks) size += chunk.size();
+    tracker->TrackFieldWithSize("chunks", size);
+  }
+}
+
+Maybe<bool> HashUpdateTraits::EncodeOutput(
+    Environment* env,
+    const HashUpdateConfig& params,
+    ByteSource* out,
+    v8::Local<v8::Value>* result) {
+  if (!params.finalize) {
+    *result = Undefined(env->isolate());
+    return Just(true);
+  }
+  *result = out->ToArrayBuffer(env);
+  return Just(!result->IsEmpty());
+}
+
+// new HashUpdateJob(mode, hash, chunks, finalize)
+// chunks is an ArrayBuffer, an ArrayBufferView or an Array of them.
+Maybe<bool> HashUpdateTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    HashUpdateConfig* params) {
+  Environment* env = Environment::GetCurrent(args);
+
+  params->mode = mode;
+
+  CHECK(args[offset]->IsObject());  // Hash
+  Hash* hash;
+  ASSIGN_OR_RETURN_UNWRAP(
+      &hash, args[offset].As<Object>(), Nothing<bool>());
+  if (UNLIKELY(hash->async_pending())) {
+    THROW_ERR_CRYPTO_INVALID_STATE(
+        env, "Hash is in use by an asynchronous update");
+    return Nothing<bool>();
+  }
+
+  auto add_chunk = [&](Local<Value> value) {
+    if (!IsAnyBufferSource(value)) {
+      THROW_ERR_INVALID_ARG_TYPE(env, "Invalid hash input");
+      return false;
+    }
+    ArrayBufferOrViewContents<char> data(value);
+    if (UNLIKELY(!data.CheckSizeInt32())) {
+      THROW_ERR_OUT_OF_RANGE(env, "data is too long");
+      return false;
+    }
+    params->chunks.push_back(mode == kCryptoJobAsync
+        ? data.ToCopy()
+        : data.ToByteSource());
+    return true;
+  };
+
+  if (args[offset + 1]->IsArray()) {
+    Local<Array> chunks = args[offset + 1].As<Array>();
+    params->chunks.reserve(chunks->Length());
+    for (uint32_t i = 0; i < chunks->Length(); i++) {
+      Local<Value> chunk;
+      if (!chunks->Get(env->context(), i).ToLocal(&chunk) ||
+          !add_chunk(chunk)) {
+        return Nothing<bool>();
+      }
+    }
+  } else if (!add_chunk(args[offset + 1])) {
+    return Nothing<bool>();
+  }
+
+  CHECK(args[offset + 2]->IsBoolean());  // Finalize
+  params->finalize = args[offset + 2]->IsTrue();
+
+  hash->set_async_pending(true);
+  params->hash.reset(hash);
+
+  return Just(true);
+}
+
+bool HashUpdateTraits::DeriveBits(
+    Environment* env,
+    const HashUpdateConfig& params,
+    ByteSource* out) {
+  Hash* hash = params.hash.get();
+  for (const ByteSource& chunk : params.chunks) {
+    if (!hash->HashUpdate(chunk.data<char>(), chunk.size()))
+      return false;
+  }
+
+  if (params.finalize) {
+    if (!hash->HashFinal())
+      return false;
+    const ByteSource& digest = hash->digest();
+    ByteSource::Builder buf(digest.size());
+    if (digest.size() > 0)
+      memcpy(buf.data<char>(), digest.data<char>(), digest.size());
+    *out = std::move(buf).release();
+  }
+
+  return true;
+}
+
 void InternalVerifyIntegrity(const v8::FunctionCallbackInfo<v8::Value>& args) {
   Environment* env = Environment::GetCurrent(args);
 
@@ -23,10 +23,20 @@ class Hash final : public BaseObject {
 
   bool HashInit(const EVP_MD* md, v8::Maybe<unsigned int> xof_md_len);
   bool HashUpdate(const char* data, size_t len);
+  // Computes the digest on first use and keeps it for later calls.
+  bool HashFinal();
+
+  const ByteSource& digest() const { return digest_; }
+
+  // Set while a HashUpdateJob uses the context, which update() and digest()
+  // must not touch in the meantime.
+  bool async_pending() const { return async_pending_; }
+  void set_async_pending(bool pending) { async_pending_ = pending; }
 
   static void GetHashes(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void GetCachedAliases(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void OneShotDigest(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void BatchDigest(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  protected:
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -39,6 +49,7 @@ class Hash final : public BaseObject {
   EVPMDCtxPointer mdctx_{};
   unsigned int md_len_ = 0;
   ByteSource digest_;
+  bool async_pending_ = false;
 };
 
 struct HashConfig final : public MemoryRetainer {
@@ -84,6 +95,100 @@ struct HashTraits final {
 
 using HashJob = DeriveBitsJob<HashTraits>;
 
+// Hashes many inputs, stored back to back in `in`, in one job. Input i is
+// the range [offsets[i], offsets[i + 1]) and its digest ends up at
+// i * EVP_MD_size(digest) in the output.
+struct BatchHashConfig final : public MemoryRetainer {
+  CryptoJobMode mode;
+  ByteSource in;
+  std::vector<uint32_t> offsets;
+  const EVP_MD* digest;
+
+  BatchHashConfig() = default;
+
+  explicit BatchHashConfig(BatchHashConfig&& other) noexcept;
+
+  BatchHashConfig& operator=(BatchHashConfig&& other) noexcept;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(BatchHashConfig)
+  SET_SELF_SIZE(BatchHashConfig)
+};
+
+struct BatchHashTraits final {
+  using AdditionalParameters = BatchHashConfig;
+  static constexpr const char* JobName = "BatchHashJob";
+  static constexpr AsyncWrap::ProviderType Provider =
+      AsyncWrap::PROVIDER_HASHREQUEST;
+
+  static v8::Maybe<bool> AdditionalConfig(
+      CryptoJobMode mode,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      unsigned int offset,
+      BatchHashConfig* params);
+
+  static bool DeriveBits(
+      Environment* env,
+      const BatchHashConfig& params,
+      ByteSource* out);
+
+  static v8::Maybe<bool> EncodeOutput(
+      Environment* env,
+      const BatchHashConfig& params,
+      ByteSource* out,
+      v8::Local<v8::Value>* result);
+};
+
+using BatchHashJob = DeriveBitsJob<BatchHashTraits>;
+
+// Feeds chunks into an existing Hash off the main thread, so that hashing a
+// very large input does not block the event loop. The Hash cannot be used
+// otherwise until the job is done. With `finalize` set, the job also
+// produces the digest, which digest() returns afterwards as well.
+struct HashUpdateConfig final : public MemoryRetainer {
+  CryptoJobMode mode;
+  BaseObjectPtr<Hash> hash;
+  std::vector<ByteSource> chunks;
+  bool finalize = false;
+
+  HashUpdateConfig() = default;
+  ~HashUpdateConfig();
+
+  explicit HashUpdateConfig(HashUpdateConfig&& other) noexcept;
+
+  HashUpdateConfig& operator=(HashUpdateConfig&& other) noexcept;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(HashUpdateConfig)
+  SET_SELF_SIZE(HashUpdateConfig)
+};
+
+struct HashUpdateTraits final {
+  using AdditionalParameters = HashUpdateConfig;
+  static constexpr const char* JobName = "HashUpdateJob";
+  static constexpr AsyncWrap::ProviderType Provider =
+      AsyncWrap::PROVIDER_HASHREQUEST;
+
+  static v8::Maybe<bool> AdditionalConfig(
+      CryptoJobMode mode,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      unsigned int offset,
+      HashUpdateConfig* params);
+
+  static bool DeriveBits(
+      Environment* env,
+      const HashUpdateConfig& params,
+      ByteSource* out);
+
+  static v8::Maybe<bool> EncodeOutput(
+      Environment* env,
+      const HashUpdateConfig& params,
+      ByteSource* out,
+      v8::Local<v8::Value>* result);
+};
+
+using HashUpdateJob = DeriveBitsJob<HashUpdateTraits>;
+
 void InternalVerifyIntegrity(const v8::FunctionCallbackInfo<v8::Value>& args);
 
 }  // namespace crypto
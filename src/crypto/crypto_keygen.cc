@@ -5,23 +5,171 @@
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
 #include "ncrypto.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "node_mutex.h"
 #include "threadpoolwork-inl.h"
 #include "v8.h"
 
 #include <cmath>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
 
 namespace node {
 
+using v8::Array;
 using v8::FunctionCallbackInfo;
 using v8::Int32;
 using v8::Just;
 using v8::Local;
 using v8::Maybe;
+using v8::Number;
 using v8::Object;
 using v8::Uint32;
 using v8::Value;
 
 namespace crypto {
+namespace {
+// Bounds the memory and background work spent on parameter sets that are
+// requested only once.
+constexpr size_t kMaxKeyPairPools = 16;
+constexpr size_t kMaxKeyPairPoolSize = 1024;
+
+struct Pool final {
+  explicit Pool(KeyPairPool::Generator&& generator)
+      : generator(std::move(generator)) {}
+
+  const KeyPairPool::Generator generator;
+  std::deque<EVPKeyPointer> keys;
+  bool refilling = false;
+};
+
+struct KeyPairPools final {
+  static KeyPairPools& Get() { return LeakedSingleton<KeyPairPools>::Get(); }
+
+  Mutex mutex;
+  size_t size = 0;
+  size_t low_water = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  std::unordered_map<std::string, std::shared_ptr<Pool>> pools;
+};
+
+// Runs on a thread of its own until the pool is full again, or until it has
+// been dropped because pooling was disabled or resized.
+void RefillPool(std::shared_ptr<Pool> pool) {
+  KeyPairPools& pools = KeyPairPools::Get();
+  for (;;) {
+    {
+      Mutex::ScopedLock lock(pools.mutex);
+      if (pool->keys.size() >= pools.size) {
+        pool->refilling = false;
+        return;
+      }
+    }
+    EVPKeyPointer key = pool->generator();
+    Mutex::ScopedLock lock(pools.mutex);
+    if (!key) {
+      ERR_clear_error();
+      pool->refilling = false;
+      return;
+    }
+    pool->keys.push_back(std::move(key));
+  }
+}
+
+void SetKeyPairPoolSize(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  if (!args[0]->IsUint32() ||
+      args[0].As<Uint32>()->Value() > kMaxKeyPairPoolSize) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The key pair pool size must be between 0 and 1024");
+  }
+  uint32_t size = args[0].As<Uint32>()->Value();
+  if (!args[1]->IsUint32() || args[1].As<Uint32>()->Value() > size) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The low-water mark must not exceed the pool size");
+  }
+  KeyPairPool::SetSize(size, args[1].As<Uint32>()->Value());
+}
+
+void GetKeyPairPoolStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  KeyPairPool::Stats stats = KeyPairPool::GetStats();
+  Local<Value> values[] = {
+      Number::New(env->isolate(), static_cast<double>(stats.hits)),
+      Number::New(env->isolate(), static_cast<double>(stats.misses)),
+      Number::New(env->isolate(), static_cast<double>(stats.pooled)),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+}  // namespace
+
+bool KeyPairPool::IsEnabled() {
+  KeyPairPools& pools = KeyPairPools::Get();
+  Mutex::ScopedLock lock(pools.mutex);
+  return pools.size > 0;
+}
+
+EVPKeyPointer KeyPairPool::Take(const std::string& name,
+                                Generator&& generator) {
+  KeyPairPools& pools = KeyPairPools::Get();
+  Mutex::ScopedLock lock(pools.mutex);
+  if (pools.size == 0) return EVPKeyPointer();
+
+  auto it = pools.pools.find(name);
+  if (it == pools.pools.end()) {
+    if (pools.pools.size() >= kMaxKeyPairPools) return EVPKeyPointer();
+    it = pools.pools
+             .emplace(name, std::make_shared<Pool>(std::move(generator)))
+             .first;
+  }
+  std::shared_ptr<Pool> pool = it->second;
+
+  EVPKeyPointer key;
+  if (pool->keys.empty()) {
+    pools.misses++;
+  } else {
+    pools.hits++;
+    key = std::move(pool->keys.front());
+    pool->keys.pop_front();
+  }
+
+  if (pool->keys.size() <= pools.low_water && !pool->refilling) {
+    pool->refilling = true;
+    std::thread(RefillPool, pool).detach();
+  }
+  return key;
+}
+
+void KeyPairPool::SetSize(size_t size, size_t low_water) {
+  CHECK_LE(low_water, size);
+  KeyPairPools& pools = KeyPairPools::Get();
+  Mutex::ScopedLock lock(pools.mutex);
+  pools.size = size;
+  pools.low_water = low_water;
+  if (size == 0) {
+    // Refill threads that are still running hold on to their pool and
+    // stop once they see the new size.
+    pools.pools.clear();
+    return;
+  }
+  for (auto& entry : pools.pools) {
+    while (entry.second->keys.size() > size) entry.second->keys.pop_back();
+  }
+}
+
+KeyPairPool::Stats KeyPairPool::GetStats() {
+  KeyPairPools& pools = KeyPairPools::Get();
+  Mutex::ScopedLock lock(pools.mutex);
+  uint64_t pooled = 0;
+  for (const auto& entry : pools.pools) pooled += entry.second->keys.size();
+  return Stats{pools.hits, pools.misses, pooled};
+}
+
 // NidKeyPairGenJob input arguments:
 //   1. CryptoJobMode
 //   2. NID
@@ -90,11 +238,18 @@ namespace Keygen {
 void Initialize(Environment* env, Local<Object> target) {
   NidKeyPairGenJob::Initialize(env, target);
   SecretKeyGenJob::Initialize(env, target);
+
+  Local<v8::Context> context = env->context();
+  SetMethod(context, target, "setKeyPairPoolSize", SetKeyPairPoolSize);
+  SetMethodNoSideEffect(
+      context, target, "getKeyPairPoolStats", GetKeyPairPoolStats);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   NidKeyPairGenJob::RegisterExternalReferences(registry);
   SecretKeyGenJob::RegisterExternalReferences(registry);
+  registry->Register(SetKeyPairPoolSize);
+  registry->Register(GetKeyPairPoolStats);
 }
 
 }  // namespace Keygen
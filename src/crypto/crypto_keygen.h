@@ -11,6 +11,9 @@
 #include "memory_tracker.h"
 #include "v8.h"
 
+#include <functional>
+#include <string>
+
 namespace node {
 namespace crypto {
 namespace Keygen {
@@ -119,6 +122,35 @@ class KeyGenJob final : public CryptoJob<KeyGenTraits> {
   KeyGenJobStatus status_ = KeyGenJobStatus::FAILED;
 };
 
+// Keeps key pairs generated ahead of time on background threads, with one
+// pool per algorithm and parameter set, so that generateKeyPair() for slow
+// algorithms such as RSA can return without waiting for key generation. A
+// pool is created the first time its parameter set is requested and is
+// refilled whenever it drops below the low-water mark. Pooling is disabled
+// until setKeyPairPoolSize() gives the pools a capacity.
+class KeyPairPool final {
+ public:
+  using Generator = std::function<EVPKeyPointer()>;
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t pooled;
+  };
+
+  static bool IsEnabled();
+
+  // Returns a key from the pool identified by name, or an empty pointer if
+  // it has none left. The generator is used to refill the pool and must be
+  // safe to call from any thread.
+  static EVPKeyPointer Take(const std::string& name, Generator&& generator);
+
+  // A size of zero disables pooling and frees every pooled key.
+  static void SetSize(size_t size, size_t low_water);
+
+  static Stats GetStats();
+};
+
 // A Base KeyGenTraits for Key Pair generation algorithms.
 template <typename KeyPairAlgorithmTraits>
 struct KeyPairGenTraits final {
@@ -161,20 +193,43 @@ struct KeyPairGenTraits final {
     return v8::Just(true);
   }
 
-  static KeyGenJobStatus DoKeyGen(
-      Environment* env,
-      AdditionalParameters* params) {
+  static EVPKeyPointer Generate(AdditionalParameters* params) {
     EVPKeyCtxPointer ctx = KeyPairAlgorithmTraits::Setup(params);
 
     if (!ctx)
-      return KeyGenJobStatus::FAILED;
+      return EVPKeyPointer();
 
     // Generate the key
     EVP_PKEY* pkey = nullptr;
     if (!EVP_PKEY_keygen(ctx.get(), &pkey))
+      return EVPKeyPointer();
+
+    return EVPKeyPointer(pkey);
+  }
+
+  static KeyGenJobStatus DoKeyGen(
+      Environment* env,
+      AdditionalParameters* params) {
+    EVPKeyPointer key;
+    // Only algorithms that describe their parameter set can be pooled.
+    if constexpr (requires { KeyPairAlgorithmTraits::PoolKey(*params); }) {
+      if (KeyPairPool::IsEnabled()) {
+        key = KeyPairPool::Take(
+            KeyPairAlgorithmTraits::PoolKey(*params),
+            [algorithm_params = params->params]() {
+              AdditionalParameters config;
+              config.params = algorithm_params;
+              return Generate(&config);
+            });
+      }
+    }
+
+    if (!key)
+      key = Generate(params);
+    if (!key)
       return KeyGenJobStatus::FAILED;
 
-    params->key = ManagedEVPPKey(EVPKeyPointer(pkey));
+    params->key = ManagedEVPPKey(std::move(key));
     return KeyGenJobStatus::OK;
   }
 
@@ -4,19 +4,30 @@
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
 #include "ncrypto.h"
+#include "node_debug.h"
+#include "node_external_reference.h"
 #include "threadpoolwork-inl.h"
 #include "v8.h"
 
 #include <openssl/bn.h>
+#include <openssl/crypto.h>
 #include <openssl/rand.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif  // _WIN32
+#include <atomic>
 #include <compare>
+#include <cstring>
 
 namespace node {
 
 using v8::ArrayBuffer;
 using v8::BackingStore;
 using v8::Boolean;
+using v8::FastApiCallbackOptions;
+using v8::FastApiTypedArray;
 using v8::FunctionCallbackInfo;
+using v8::HandleScope;
 using v8::Int32;
 using v8::Just;
 using v8::Local;
@@ -27,6 +38,92 @@ using v8::Uint32;
 using v8::Value;
 
 namespace crypto {
+namespace {
+// Small requests are served from a per-thread block of CSPRNG output, which
+// saves calling into OpenSSL for each of them. Bytes are wiped as soon as they
+// have been handed out so that the same output is never returned twice, and
+// a forked child discards the block it inherited from its parent.
+constexpr size_t kRandomCacheSize = 4096;
+constexpr size_t kMaxCachedRandomRequest = 256;
+
+std::atomic<uint64_t> fork_generation{0};
+
+struct RandomCache {
+  unsigned char data[kRandomCacheSize];
+  size_t offset = kRandomCacheSize;
+  uint64_t generation = 0;
+
+  ~RandomCache() { OPENSSL_cleanse(data, sizeof(data)); }
+};
+
+thread_local RandomCache random_cache;
+
+void RegisterForkHandler() {
+#ifndef _WIN32
+  static const bool registered = [] {
+    return pthread_atfork(nullptr, nullptr, [] {
+             fork_generation.fetch_add(1, std::memory_order_relaxed);
+           }) == 0;
+  }();
+  CHECK(registered);
+#endif  // _WIN32
+}
+
+bool CachedCSPRNG(unsigned char* buffer, size_t length) {
+  if (length > kMaxCachedRandomRequest) return ncrypto::CSPRNG(buffer, length);
+  RegisterForkHandler();
+
+  RandomCache& cache = random_cache;
+  const uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  if (cache.generation != generation) {
+    OPENSSL_cleanse(cache.data, sizeof(cache.data));
+    cache.offset = kRandomCacheSize;
+    cache.generation = generation;
+  }
+
+  if (kRandomCacheSize - cache.offset < length) {
+    if (!ncrypto::CSPRNG(cache.data, kRandomCacheSize)) {
+      cache.offset = kRandomCacheSize;
+      return false;
+    }
+    cache.offset = 0;
+  }
+  unsigned char* data = cache.data + cache.offset;
+  memcpy(buffer, data, length);
+  OPENSSL_cleanse(data, length);
+  cache.offset += length;
+  return true;
+}
+
+void SecureRandomFill(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsArrayBufferView());
+  ArrayBufferOrViewContents<unsigned char> buffer(args[0]);
+  if (!CachedCSPRNG(buffer.data(), buffer.size())) {
+    THROW_ERR_CRYPTO_OPERATION_FAILED(env, "Error generating random bytes");
+  }
+}
+
+void FastSecureRandomFill(Local<Value> receiver,
+                          const FastApiTypedArray<uint8_t>& buffer,
+                          // NOLINTNEXTLINE(runtime/references)
+                          FastApiCallbackOptions& options) {
+  uint8_t* data;
+  CHECK(buffer.getStorageIfAligned(&data));
+  if (!CachedCSPRNG(data, buffer.length())) {
+    TRACK_V8_FAST_API_CALL("crypto.secureRandomFill.error");
+    HandleScope scope(options.isolate);
+    THROW_ERR_CRYPTO_OPERATION_FAILED(options.isolate,
+                                      "Error generating random bytes");
+    return;
+  }
+  TRACK_V8_FAST_API_CALL("crypto.secureRandomFill.ok");
+}
+
+static v8::CFunction fast_secure_random_fill(
+    v8::CFunction::Make(FastSecureRandomFill));
+}  // namespace
+
 Maybe<bool> RandomBytesTraits::EncodeOutput(
     Environment* env,
     const RandomBytesConfig& params,
@@ -62,7 +159,7 @@ bool RandomBytesTraits::DeriveBits(
     Environment* env,
     const RandomBytesConfig& params,
     ByteSource* unused) {
-  return ncrypto::CSPRNG(params.buffer, params.size);
+  return CachedCSPRNG(params.buffer, params.size);
 }
 
 void RandomPrimeConfig::MemoryInfo(MemoryTracker* tracker) const {
@@ -223,12 +320,20 @@ void Initialize(Environment* env, Local<Object> target) {
   RandomBytesJob::Initialize(env, target);
   RandomPrimeJob::Initialize(env, target);
   CheckPrimeJob::Initialize(env, target);
+  SetFastMethod(env->context(),
+                target,
+                "secureRandomFill",
+                SecureRandomFill,
+                &fast_secure_random_fill);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   RandomBytesJob::RegisterExternalReferences(registry);
   RandomPrimeJob::RegisterExternalReferences(registry);
   CheckPrimeJob::RegisterExternalReferences(registry);
+  registry->Register(SecureRandomFill);
+  registry->Register(FastSecureRandomFill);
+  registry->Register(fast_secure_random_fill.GetTypeInfo());
 }
 }  // namespace Random
 }  // namespace crypto
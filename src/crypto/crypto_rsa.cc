@@ -96,6 +96,15 @@ EVPKeyCtxPointer RsaKeyGenTraits::Setup(RsaKeyPairGenConfig* params) {
   return ctx;
 }
 
+std::string RsaKeyGenTraits::PoolKey(const RsaKeyPairGenConfig& params) {
+  const RsaKeyPairParams& p = params.params;
+  return "rsa:" + std::to_string(p.variant) + ":" +
+         std::to_string(p.modulus_bits) + ":" + std::to_string(p.exponent) +
+         ":" + std::to_string(p.md != nullptr ? EVP_MD_type(p.md) : 0) + ":" +
+         std::to_string(p.mgf1_md != nullptr ? EVP_MD_type(p.mgf1_md) : 0) +
+         ":" + std::to_string(p.saltlen);
+}
+
 // Input parameters to the RsaKeyGenJob:
 // For key variants RSA-OAEP and RSA-SSA-PKCS1-v1_5
 //   1. CryptoJobMode
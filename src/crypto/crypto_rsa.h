@@ -42,6 +42,7 @@ struct RsaKeyGenTraits final {
   static constexpr const char* JobName = "RsaKeyPairGenJob";
 
   static EVPKeyCtxPointer Setup(RsaKeyPairGenConfig* params);
+  static std::string PoolKey(const RsaKeyPairGenConfig& params);
 
   static v8::Maybe<bool> AdditionalConfig(
       CryptoJobMode mode,
@@ -0,0 +1,533 @@
+#include "crypto/crypto_session_cache.h"
+#include "node_mutex.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+
+namespace node {
+namespace crypto {
+
+namespace {
+constexpr uint32_t kMagic = 0x6e544c53;  // "nTLS"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kWays = 4;
+constexpr uint64_t kNsPerMs = 1000000;
+
+// A set's lock holds the ID of the process that owns it. A lock that is
+// still held after kMaxLockAttempts tries is taken over if its owner has
+// died, and the set is emptied because the owner may have left it half
+// written. If the owner is still alive, the operation gives up instead:
+// Store() does not store the session and Lookup() reports a miss.
+constexpr int kSpinAttempts = 64;
+constexpr int kMaxLockAttempts = 4096;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory segments need address-free atomics");
+
+// Laid out at the start of the cache memory, followed by the sets.
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t set_count;
+  uint32_t set_length;
+  std::atomic<uint32_t> ready;
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> stores;
+  std::atomic<uint64_t> evictions;
+};
+
+struct Slot {
+  uint64_t expires_at;
+  uint32_t length;
+  uint8_t id_length;
+  uint8_t id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  uint8_t data[TLSSessionCache::kMaxSessionLength];
+};
+
+class SetLock final {
+ public:
+  explicit SetLock(std::atomic<uint32_t>* lock) : lock_(lock) {
+    const uint32_t self = static_cast<uint32_t>(uv_os_getpid());
+    uint32_t owner = 0;
+    for (int n = 0; n < kMaxLockAttempts; n++) {
+      owner = 0;
+      if (lock_->compare_exchange_weak(owner,
+                                       self,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        locked_ = true;
+        return;
+      }
+      if (n >= kSpinAttempts) std::this_thread::yield();
+    }
+#ifndef _WIN32
+    if (owner != 0 && owner != self &&
+        kill(static_cast<pid_t>(owner), 0) == -1 && errno == ESRCH &&
+        lock_->compare_exchange_strong(owner,
+                                       self,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      locked_ = true;
+      taken_over_ = true;
+    }
+#endif  // _WIN32
+  }
+
+  ~SetLock() {
+    if (locked_) lock_->store(0, std::memory_order_release);
+  }
+
+  bool locked() const { return locked_; }
+
+  // True if the lock was taken over from a process that died holding it.
+  bool taken_over() const { return taken_over_; }
+
+ private:
+  std::atomic<uint32_t>* lock_;
+  bool locked_ = false;
+  bool taken_over_ = false;
+};
+
+uint64_t NowMs() {
+  return uv_hrtime() / kNsPerMs;
+}
+
+struct SessionCaches final {
+  static SessionCaches& Get() { return LeakedSingleton<SessionCaches>::Get(); }
+
+  Mutex mutex;
+  std::unordered_map<std::string, std::weak_ptr<TLSSessionCache>> named;
+};
+}  // namespace
+
+struct TLSSessionCache::Set {
+  std::atomic<uint32_t> lock;
+  Slot slots[kWays];
+};
+
+#ifndef _WIN32
+namespace {
+constexpr int kMaxWaitMs = 1000;
+
+std::string SegmentName(const std::string& name) {
+  return "/node-tls-" + name;
+}
+
+// Returns true if |shm_name| still refers to the segment open as |fd|, and
+// not to one that replaced it.
+bool NamesSegment(const std::string& shm_name, int fd) {
+  int current = shm_open(shm_name.c_str(), O_RDONLY, 0);
+  if (current == -1) return false;
+  struct stat a, b;
+  bool same = fstat(fd, &a) == 0 && fstat(current, &b) == 0 &&
+              a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+  close(current);
+  return same;
+}
+
+// Sets up a segment that this process has just created. The other processes
+// wait for ready before they use it.
+void* InitSegment(int fd,
+                  size_t size,
+                  uint32_t set_count,
+                  uint32_t set_length) {
+  if (ftruncate(fd, size) != 0) return nullptr;
+  void* addr =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) return nullptr;
+  // ftruncate() zero-filled the segment, so every set is unlocked and every
+  // slot is empty.
+  auto header = static_cast<Header*>(addr);
+  header->magic = kMagic;
+  header->version = kVersion;
+  header->set_count = set_count;
+  header->set_length = set_length;
+  header->ready.store(1, std::memory_order_release);
+  return addr;
+}
+
+// Maps a segment that another process created. The sessions in the segment
+// are trusted for resumption, so it is only adopted if it belongs to this
+// user and nobody else can access it; otherwise another local user could
+// plant sessions in it. Sets |*stale| if the segment can never be used
+// here: it was set up for a different number of entries, or its creator
+// died before it finished setting it up.
+void* AdoptSegment(int fd,
+                   size_t size,
+                   uint32_t set_count,
+                   uint32_t set_length,
+                   bool* stale) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_uid != geteuid() ||
+      (st.st_mode & 077) != 0) {
+    return nullptr;
+  }
+  for (int n = 0;; n++) {
+    if (fstat(fd, &st) != 0) return nullptr;
+    if (static_cast<size_t>(st.st_size) >= sizeof(Header)) break;
+    if (n == kMaxWaitMs) {
+      *stale = true;
+      return nullptr;
+    }
+    usleep(1000);
+  }
+  if (static_cast<size_t>(st.st_size) != size) {
+    *stale = true;
+    return nullptr;
+  }
+
+  void* addr =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) return nullptr;
+  auto header = static_cast<Header*>(addr);
+  for (int n = 0; header->ready.load(std::memory_order_acquire) == 0; n++) {
+    if (n == kMaxWaitMs) {
+      munmap(addr, size);
+      *stale = true;
+      return nullptr;
+    }
+    usleep(1000);
+  }
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->set_count != set_count || header->set_length != set_length) {
+    munmap(addr, size);
+    *stale = true;
+    return nullptr;
+  }
+  return addr;
+}
+
+// Maps the named segment, creating it if this is the first process to use
+// it. A stale segment is removed and created again, once; the processes
+// that still map it keep using it on their own. On success, |*fd_out| is
+// the segment's descriptor, with a shared lock that marks this process as
+// one of its users (see ~TLSSessionCache()).
+void* MapSharedSegment(const std::string& shm_name,
+                       size_t size,
+                       uint32_t set_count,
+                       uint32_t set_length,
+                       int* fd_out) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool creator = true;
+    int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 && errno == EEXIST) {
+      creator = false;
+      fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+      // The last user removed it in the meantime.
+      if (fd == -1 && errno == ENOENT) continue;
+    }
+    if (fd == -1) return nullptr;
+    // Not all systems support flock() on shared memory. The segment is then
+    // never removed.
+    flock(fd, LOCK_SH);
+
+    if (creator) {
+      void* addr = InitSegment(fd, size, set_count, set_length);
+      if (addr == nullptr) {
+        shm_unlink(shm_name.c_str());
+        close(fd);
+      } else {
+        *fd_out = fd;
+      }
+      return addr;
+    }
+
+    bool stale = false;
+    void* addr = AdoptSegment(fd, size, set_count, set_length, &stale);
+    if (addr != nullptr) {
+      *fd_out = fd;
+      return addr;
+    }
+    if (stale && NamesSegment(shm_name, fd)) shm_unlink(shm_name.c_str());
+    close(fd);
+    if (!stale) return nullptr;
+  }
+  return nullptr;
+}
+}  // namespace
+#endif  // _WIN32
+
+std::shared_ptr<TLSSessionCache> TLSSessionCache::Open(const std::string& name,
+                                                       uint32_t max_entries,
+                                                       uint32_t ttl_seconds) {
+  CHECK_GT(max_entries, 0);
+  uint32_t set_count = (max_entries + kWays - 1) / kWays;
+  size_t size = sizeof(Header) + sizeof(Set) * set_count;
+
+  if (name.empty()) {
+    void* base = calloc(1, size);
+    if (base == nullptr) return nullptr;
+    auto header = static_cast<Header*>(base);
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->set_count = set_count;
+    header->set_length = sizeof(Set);
+    return std::shared_ptr<TLSSessionCache>(
+        new TLSSessionCache(name, base, size, ttl_seconds, -1));
+  }
+
+#ifdef _WIN32
+  return nullptr;
+#else
+  SessionCaches& caches = SessionCaches::Get();
+  Mutex::ScopedLock lock(caches.mutex);
+  auto it = caches.named.find(name);
+  if (it != caches.named.end()) {
+    if (auto cache = it->second.lock()) {
+      if (cache->size_ != size) return nullptr;
+      return cache;
+    }
+  }
+
+  int fd;
+  void* base =
+      MapSharedSegment(SegmentName(name), size, set_count, sizeof(Set), &fd);
+  if (base == nullptr) return nullptr;
+  std::shared_ptr<TLSSessionCache> cache(
+      new TLSSessionCache(name, base, size, ttl_seconds, fd));
+  caches.named[name] = cache;
+  return cache;
+#endif  // _WIN32
+}
+
+TLSSessionCache::TLSSessionCache(std::string name,
+                                 void* base,
+                                 size_t size,
+                                 uint32_t ttl_seconds,
+                                 int fd)
+    : name_(std::move(name)),
+      base_(base),
+      size_(size),
+      ttl_ms_(static_cast<uint64_t>(ttl_seconds) * 1000),
+      fd_(fd) {}
+
+TLSSessionCache::~TLSSessionCache() {
+  if (name_.empty()) {
+    free(base_);
+    return;
+  }
+#ifndef _WIN32
+  munmap(base_, size_);
+  // Every other user of the segment holds a shared lock on it, and the
+  // kernel drops the locks of processes that exit or crash. The exclusive
+  // lock is therefore only granted to the last user, which removes the
+  // segment unless it has been replaced already.
+  if (flock(fd_, LOCK_EX | LOCK_NB) == 0) {
+    std::string shm_name = SegmentName(name_);
+    if (NamesSegment(shm_name, fd_)) shm_unlink(shm_name.c_str());
+  }
+  close(fd_);
+#endif  // _WIN32
+}
+
+TLSSessionCache::Set* TLSSessionCache::GetSet(const unsigned char* id,
+                                              size_t length) const {
+  // FNV-1a over the session ID.
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) hash = (hash ^ id[i]) * 16777619u;
+  auto header = static_cast<Header*>(base_);
+  auto sets = reinterpret_cast<Set*>(header + 1);
+  return &sets[hash % header->set_count];
+}
+
+bool TLSSessionCache::Store(SSL_SESSION* session) {
+  unsigned int id_length;
+  const unsigned char* id = SSL_SESSION_get_id(session, &id_length);
+  if (id_length == 0 || id_length > SSL_MAX_SSL_SESSION_ID_LENGTH)
+    return false;
+
+  int length = i2d_SSL_SESSION(session, nullptr);
+  if (length <= 0 || static_cast<size_t>(length) > kMaxSessionLength)
+    return false;
+  unsigned char buffer[kMaxSessionLength];
+  unsigned char* p = buffer;
+  CHECK_EQ(i2d_SSL_SESSION(session, &p), length);
+
+  const uint64_t now = NowMs();
+  const uint64_t ttl = std::min<uint64_t>(
+      ttl_ms_, static_cast<uint64_t>(SSL_SESSION_get_timeout(session)) * 1000);
+  auto header = static_cast<Header*>(base_);
+  Set* set = GetSet(id, id_length);
+
+  SetLock lock(&set->lock);
+  if (!lock.locked()) return false;
+  if (lock.taken_over()) memset(set->slots, 0, sizeof(set->slots));
+
+  // Reuse the slot holding the same ID, otherwise an empty or expired one,
+  // otherwise evict the entry closest to expiring.
+  Slot* target = nullptr;
+  for (Slot& slot : set->slots) {
+    if (slot.id_length == id_length && memcmp(slot.id, id, id_length) == 0) {
+      target = &slot;
+      break;
+    }
+    if (target == nullptr || slot.expires_at < target->expires_at)
+      target = &slot;
+  }
+  if (target->expires_at > now &&
+      (target->id_length != id_length ||
+       memcmp(target->id, id, id_length) != 0)) {
+    header->evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  target->expires_at = now + ttl;
+  target->length = length;
+  target->id_length = id_length;
+  memcpy(target->id, id, id_length);
+  memcpy(target->data, buffer, length);
+  header->stores.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+SSLSessionPointer TLSSessionCache::Lookup(const unsigned char* id,
+                                          size_t length) {
+  auto header = static_cast<Header*>(base_);
+  if (length == 0 || length > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+    header->misses.fetch_add(1, std::memory_order_relaxed);
+    return SSLSessionPointer();
+  }
+
+  unsigned char buffer[kMaxSessionLength];
+  uint32_t session_length = 0;
+  {
+    const uint64_t now = NowMs();
+    Set* set = GetSet(id, length);
+    SetLock lock(&set->lock);
+    if (lock.taken_over()) memset(set->slots, 0, sizeof(set->slots));
+    if (lock.locked()) {
+      for (Slot& slot : set->slots) {
+        // The slots may live in memory shared with other processes, so
+        // their lengths are not trusted.
+        if (slot.id_length != length || slot.expires_at <= now ||
+            slot.length == 0 || slot.length > kMaxSessionLength) {
+          continue;
+        }
+        if (memcmp(slot.id, id, length) == 0) {
+          session_length = slot.length;
+          memcpy(buffer, slot.data, session_length);
+          break;
+        }
+      }
+    }
+  }
+
+  if (session_length == 0) {
+    header->misses.fetch_add(1, std::memory_order_relaxed);
+    return SSLSessionPointer();
+  }
+
+  const unsigned char* p = buffer;
+  SSLSessionPointer session(d2i_SSL_SESSION(nullptr, &p, session_length));
+  if (session) {
+    header->hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    header->misses.fetch_add(1, std::memory_order_relaxed);
+  }
+  return session;
+}
+
+TLSSessionCache::Stats TLSSessionCache::GetStats() const {
+  auto header = static_cast<Header*>(base_);
+  return Stats{header->hits.load(std::memory_order_relaxed),
+               header->misses.load(std::memory_order_relaxed),
+               header->stores.load(std::memory_order_relaxed),
+               header->evictions.load(std::memory_order_relaxed)};
+}
+
+TLSClientSessionCache::TLSClientSessionCache(size_t max_entries)
+    : max_entries_(max_entries) {
+  CHECK_GT(max_entries, 0);
+}
+
+void TLSClientSessionCache::Erase(
+    std::unordered_map<std::string, Entry>::iterator it) {
+  order_.erase(it->second.order);
+  entries_.erase(it);
+}
+
+void TLSClientSessionCache::Store(const std::string& key,
+                                  SSL_SESSION* session) {
+  if (!SSL_SESSION_is_resumable(session)) return;
+
+  Mutex::ScopedLock lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) Erase(it);
+  while (entries_.size() >= max_entries_) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+    stats_.evictions++;
+  }
+
+  SSL_SESSION_up_ref(session);
+  order_.push_back(key);
+  entries_.emplace(key, Entry{SSLSessionPointer(session), --order_.end()});
+  stats_.stores++;
+}
+
+SSLSessionPointer TLSClientSessionCache::Lookup(const std::string& key) {
+  Mutex::ScopedLock lock(mutex_);
+  stats_.lookups++;
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    stats_.misses++;
+    return SSLSessionPointer();
+  }
+
+  SSL_SESSION* session = it->second.session.get();
+  const uint64_t expires =
+      static_cast<uint64_t>(SSL_SESSION_get_time(session)) +
+      SSL_SESSION_get_timeout(session);
+  if (expires <= static_cast<uint64_t>(time(nullptr))) {
+    Erase(it);
+    stats_.misses++;
+    return SSLSessionPointer();
+  }
+
+  if (SSL_SESSION_get_protocol_version(session) >= TLS1_3_VERSION) {
+    SSLSessionPointer taken = std::move(it->second.session);
+    Erase(it);
+    return taken;
+  }
+  SSL_SESSION_up_ref(session);
+  return SSLSessionPointer(session);
+}
+
+void TLSClientSessionCache::Resumed(const std::string& key,
+                                    const SSL_SESSION* offered,
+                                    bool reused) {
+  Mutex::ScopedLock lock(mutex_);
+  if (reused) {
+    stats_.resumed++;
+    return;
+  }
+  // A session stored by the handshake that rejected this one stays.
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.session.get() == offered) Erase(it);
+}
+
+TLSClientSessionCache::Stats TLSClientSessionCache::GetStats() const {
+  Mutex::ScopedLock lock(mutex_);
+  return stats_;
+}
+
+}  // namespace crypto
+}  // namespace node
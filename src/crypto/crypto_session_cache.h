@@ -0,0 +1,147 @@
+#ifndef SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
+#define SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "crypto/crypto_util.h"
+#include "node_mutex.h"
+
+#include <openssl/ssl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace node {
+namespace crypto {
+
+// A fixed-size, set-associative cache of serialized server-side TLS sessions,
+// keyed by session ID. It lets TLSWrap resume sessions without emitting the
+// 'newSession' and 'resumeSession' events.
+//
+// A named cache is kept in a POSIX shared memory segment. Every process and
+// thread that opens the same name (the workers of a cluster, for instance)
+// can resume sessions established by the others. Each set of entries has its
+// own lock, so unrelated lookups do not contend. An unnamed cache is private
+// to the process.
+//
+// The segment, /node-tls-<name>, belongs to the user that created it and is
+// removed by the last process that closes its cache. A process that crashes
+// does not keep it alive for the others, but if it was the last user, the
+// segment stays until the next process uses it. A segment created for a
+// different number of entries, or whose creator died while setting it up,
+// is removed and created again by the next process that opens it.
+class TLSSessionCache final {
+ public:
+  // Serialized sessions larger than this (typically because they carry a
+  // large client certificate chain) are not cached.
+  static constexpr size_t kMaxSessionLength = 4000;
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+  };
+
+  // Returns nullptr if the cache could not be set up, e.g. because the named
+  // segment belongs to another user or can be accessed by others, because
+  // the name is already open in this process with a different number of
+  // entries, or because named caches are not supported on this platform.
+  static std::shared_ptr<TLSSessionCache> Open(const std::string& name,
+                                               uint32_t max_entries,
+                                               uint32_t ttl_seconds);
+
+  ~TLSSessionCache();
+  TLSSessionCache(const TLSSessionCache&) = delete;
+  TLSSessionCache& operator=(const TLSSessionCache&) = delete;
+
+  // Returns false if the session was not stored.
+  bool Store(SSL_SESSION* session);
+
+  // Returns a new reference to the session stored under the given ID, if
+  // there is one that has not expired.
+  SSLSessionPointer Lookup(const unsigned char* id, size_t length);
+
+  Stats GetStats() const;
+
+  const std::string& name() const { return name_; }
+
+ private:
+  struct Set;
+
+  TLSSessionCache(std::string name,
+                  void* base,
+                  size_t size,
+                  uint32_t ttl_seconds,
+                  int fd);
+
+  Set* GetSet(const unsigned char* id, size_t length) const;
+
+  std::string name_;
+  void* base_;
+  size_t size_;
+  uint64_t ttl_ms_;
+  int fd_;  // The segment of a named cache; -1 otherwise.
+};
+
+// A client-side cache of TLS sessions, keyed by a string chosen by the
+// caller (usually "servername:port"). Sessions stay SSL_SESSION objects and
+// are handed to SSL_set_session() directly. The least recently stored keys
+// are evicted first. TLS 1.3 tickets are used at most once, as RFC 8446
+// recommends, while TLS 1.2 sessions stay until they expire or the server
+// stops accepting them.
+//
+// A cache can be shared by SecureContexts on several threads.
+class TLSClientSessionCache final {
+ public:
+  struct Stats {
+    uint64_t lookups;
+    uint64_t misses;
+    uint64_t resumed;
+    uint64_t stores;
+    uint64_t evictions;
+  };
+
+  explicit TLSClientSessionCache(size_t max_entries);
+  TLSClientSessionCache(const TLSClientSessionCache&) = delete;
+  TLSClientSessionCache& operator=(const TLSClientSessionCache&) = delete;
+
+  void Store(const std::string& key, SSL_SESSION* session);
+
+  // Returns a new reference to a resumable session stored under key, if
+  // there is one.
+  SSLSessionPointer Lookup(const std::string& key);
+
+  // Records whether the server accepted a session returned by Lookup().
+  // A rejected session is dropped.
+  void Resumed(const std::string& key,
+               const SSL_SESSION* offered,
+               bool reused);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    SSLSessionPointer session;
+    std::list<std::string>::iterator order;
+  };
+
+  void Erase(std::unordered_map<std::string, Entry>::iterator it);
+
+  const size_t max_entries_;
+  mutable Mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> order_;  // Oldest first.
+  Stats stats_{};
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
@@ -12,6 +12,7 @@
 
 namespace node {
 
+using v8::Array;
 using v8::ArrayBuffer;
 using v8::BackingStore;
 using v8::Boolean;
@@ -344,6 +345,7 @@ void Sign::Initialize(Environment* env, Local<Object> target) {
   SetConstructorFunction(env->context(), target, "Sign", t);
 
   SignJob::Initialize(env, target);
+  BatchSignJob::Initialize(env, target);
 
   constexpr int kSignJobModeSign = SignConfiguration::kSign;
   constexpr int kSignJobModeVerify = SignConfiguration::kVerify;
@@ -361,6 +363,7 @@ void Sign::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(SignUpdate);
   registry->Register(SignFinal);
   SignJob::RegisterExternalReferences(registry);
+  BatchSignJob::RegisterExternalReferences(registry);
 }
 
 void Sign::New(const FunctionCallbackInfo<Value>& args) {
@@ -620,12 +623,14 @@ void SignConfiguration::MemoryInfo(MemoryTracker* tracker) const {
   }
 }
 
-Maybe<bool> SignTraits::AdditionalConfig(
-    CryptoJobMode mode,
-    const FunctionCallbackInfo<Value>& args,
-    unsigned int offset,
-    SignConfiguration* params) {
-  ClearErrorOnReturn clear_error_on_return;
+namespace {
+// Parses the arguments shared by SignJob and BatchSignJob: the mode, the key
+// and the digest, padding, salt length and DSA signature encoding. The data
+// and signatures are left to the caller.
+Maybe<bool> GetSignJobOptions(CryptoJobMode mode,
+                              const FunctionCallbackInfo<Value>& args,
+                              unsigned int offset,
+                              SignConfiguration* params) {
   Environment* env = Environment::GetCurrent(args);
 
   params->job_mode = mode;
@@ -646,15 +651,6 @@ Maybe<bool> SignTraits::AdditionalConfig(
     return Nothing<bool>();
   params->key = key;
 
-  ArrayBufferOrViewContents<char> data(args[offset + 5]);
-  if (UNLIKELY(!data.CheckSizeInt32())) {
-    THROW_ERR_OUT_OF_RANGE(env, "data is too big");
-    return Nothing<bool>();
-  }
-  params->data = mode == kCryptoJobAsync
-      ? data.ToCopy()
-      : data.ToByteSource();
-
   if (args[offset + 6]->IsString()) {
     Utf8Value digest(env->isolate(), args[offset + 6]);
     params->digest = EVP_get_digestbyname(*digest);
@@ -683,34 +679,35 @@ Maybe<bool> SignTraits::AdditionalConfig(
     }
   }
 
-  if (params->mode == SignConfiguration::kVerify) {
-    ArrayBufferOrViewContents<char> signature(args[offset + 10]);
-    if (UNLIKELY(!signature.CheckSizeInt32())) {
-      THROW_ERR_OUT_OF_RANGE(env, "signature is too big");
-      return Nothing<bool>();
-    }
-    // If this is an EC key (assuming ECDSA) we need to convert the
-    // the signature from WebCrypto format into DER format...
-    ManagedEVPPKey m_pkey = params->key;
-    Mutex::ScopedLock lock(*m_pkey.mutex());
-    if (UseP1363Encoding(m_pkey, params->dsa_encoding)) {
-      params->signature =
-          ConvertSignatureToDER(m_pkey, signature.ToByteSource());
-    } else {
-      params->signature = mode == kCryptoJobAsync
-          ? signature.ToCopy()
-          : signature.ToByteSource();
-    }
-  }
-
   return Just(true);
 }
 
-bool SignTraits::DeriveBits(
-    Environment* env,
-    const SignConfiguration& params,
-    ByteSource* out) {
-  ClearErrorOnReturn clear_error_on_return;
+// Returns the signature to verify in the form OpenSSL expects. If this is an
+// EC key (assuming ECDSA), the signature may need to be converted from
+// WebCrypto format into DER format.
+bool GetVerifySignature(Environment* env,
+                        CryptoJobMode mode,
+                        const SignConfiguration& params,
+                        Local<Value> value,
+                        ByteSource* out) {
+  ArrayBufferOrViewContents<char> signature(value);
+  if (UNLIKELY(!signature.CheckSizeInt32())) {
+    THROW_ERR_OUT_OF_RANGE(env, "signature is too big");
+    return false;
+  }
+  if (UseP1363Encoding(params.key, params.dsa_encoding)) {
+    *out = ConvertSignatureToDER(params.key, signature.ToByteSource());
+  } else {
+    *out = mode == kCryptoJobAsync ? signature.ToCopy()
+                                   : signature.ToByteSource();
+  }
+  return true;
+}
+
+// Returns a context that is ready to sign or verify with params.key, with
+// the RSA options applied.
+EVPMDCtxPointer InitSignJobContext(Environment* env,
+                                   const SignConfiguration& params) {
   EVPMDCtxPointer context(EVP_MD_CTX_new());
   EVP_PKEY_CTX* ctx = nullptr;
 
@@ -723,7 +720,7 @@ bool SignTraits::DeriveBits(
               nullptr,
               params.key.get())) {
         crypto::CheckThrow(env, SignBase::Error::kSignInit);
-        return false;
+        return EVPMDCtxPointer();
       }
       break;
     case SignConfiguration::kVerify:
@@ -734,7 +731,7 @@ bool SignTraits::DeriveBits(
               nullptr,
               params.key.get())) {
         crypto::CheckThrow(env, SignBase::Error::kSignInit);
-        return false;
+        return EVPMDCtxPointer();
       }
       break;
   }
@@ -752,69 +749,126 @@ bool SignTraits::DeriveBits(
           padding,
           salt_length)) {
     crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
+    return EVPMDCtxPointer();
+  }
+
+  return context;
+}
+
+bool SignWithContext(Environment* env,
+                     EVP_MD_CTX* context,
+                     const SignConfiguration& params,
+                     const ByteSource& data,
+                     ByteSource* out) {
+  if (IsOneShot(params.key)) {
+    size_t len;
+    if (!EVP_DigestSign(
+        context,
+        nullptr,
+        &len,
+        data.data<unsigned char>(),
+        data.size())) {
+      crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
+      return false;
+    }
+    ByteSource::Builder buf(len);
+    if (!EVP_DigestSign(context,
+                        buf.data<unsigned char>(),
+                        &len,
+                        data.data<unsigned char>(),
+                        data.size())) {
+      crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
+      return false;
+    }
+    *out = std::move(buf).release(len);
+    return true;
+  }
+
+  size_t len;
+  if (!EVP_DigestSignUpdate(
+          context,
+          data.data<unsigned char>(),
+          data.size()) ||
+      !EVP_DigestSignFinal(context, nullptr, &len)) {
+    crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
+    return false;
+  }
+  ByteSource::Builder buf(len);
+  if (!EVP_DigestSignFinal(
+          context, buf.data<unsigned char>(), &len)) {
+    crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
     return false;
   }
 
-  switch (params.mode) {
-    case SignConfiguration::kSign: {
-      if (IsOneShot(params.key)) {
-        size_t len;
-        if (!EVP_DigestSign(
-            context.get(),
-            nullptr,
-            &len,
-            params.data.data<unsigned char>(),
-            params.data.size())) {
-          crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
-          return false;
-        }
-        ByteSource::Builder buf(len);
-        if (!EVP_DigestSign(context.get(),
-                            buf.data<unsigned char>(),
-                            &len,
-                            params.data.data<unsigned char>(),
-                            params.data.size())) {
-          crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
-          return false;
-        }
-        *out = std::move(buf).release(len);
-      } else {
-        size_t len;
-        if (!EVP_DigestSignUpdate(
-                context.get(),
-                params.data.data<unsigned char>(),
-                params.data.size()) ||
-            !EVP_DigestSignFinal(context.get(), nullptr, &len)) {
-          crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
-          return false;
-        }
-        ByteSource::Builder buf(len);
-        if (!EVP_DigestSignFinal(
-                context.get(), buf.data<unsigned char>(), &len)) {
-          crypto::CheckThrow(env, SignBase::Error::kSignPrivateKey);
-          return false;
-        }
+  if (UseP1363Encoding(params.key, params.dsa_encoding)) {
+    *out = ConvertSignatureToP1363(
+        env, params.key, std::move(buf).release());
+  } else {
+    *out = std::move(buf).release(len);
+  }
+  return true;
+}
 
-        if (UseP1363Encoding(params.key, params.dsa_encoding)) {
-          *out = ConvertSignatureToP1363(
-              env, params.key, std::move(buf).release());
-        } else {
-          *out = std::move(buf).release(len);
-        }
-      }
-      break;
+bool VerifyWithContext(EVP_MD_CTX* context,
+                       const ByteSource& signature,
+                       const ByteSource& data) {
+  return EVP_DigestVerify(
+             context,
+             signature.data<unsigned char>(),
+             signature.size(),
+             data.data<unsigned char>(),
+             data.size()) == 1;
+}
+}  // namespace
+
+Maybe<bool> SignTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    SignConfiguration* params) {
+  ClearErrorOnReturn clear_error_on_return;
+  Environment* env = Environment::GetCurrent(args);
+
+  if (GetSignJobOptions(mode, args, offset, params).IsNothing())
+    return Nothing<bool>();
+
+  ArrayBufferOrViewContents<char> data(args[offset + 5]);
+  if (UNLIKELY(!data.CheckSizeInt32())) {
+    THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+    return Nothing<bool>();
+  }
+  params->data = mode == kCryptoJobAsync
+      ? data.ToCopy()
+      : data.ToByteSource();
+
+  if (params->mode == SignConfiguration::kVerify) {
+    ManagedEVPPKey m_pkey = params->key;
+    Mutex::ScopedLock lock(*m_pkey.mutex());
+    if (!GetVerifySignature(
+            env, mode, *params, args[offset + 10], &params->signature)) {
+      return Nothing<bool>();
     }
+  }
+
+  return Just(true);
+}
+
+bool SignTraits::DeriveBits(
+    Environment* env,
+    const SignConfiguration& params,
+    ByteSource* out) {
+  ClearErrorOnReturn clear_error_on_return;
+  EVPMDCtxPointer context = InitSignJobContext(env, params);
+  if (!context)
+    return false;
+
+  switch (params.mode) {
+    case SignConfiguration::kSign:
+      return SignWithContext(env, context.get(), params, params.data, out);
     case SignConfiguration::kVerify: {
       ByteSource::Builder buf(1);
-      buf.data<char>()[0] = 0;
-      if (EVP_DigestVerify(
-              context.get(),
-              params.signature.data<unsigned char>(),
-              params.signature.size(),
-              params.data.data<unsigned char>(),
-              params.data.size()) == 1) {
-        buf.data<char>()[0] = 1;
-      }
+      buf.data<char>()[0] =
+          VerifyWithContext(context.get(), params.signature, params.data);
       *out = std::move(buf).release();
     }
   }
@@ -840,5 +894,162 @@ Maybe<bool> SignTraits::EncodeOutput(
   return Just(!result->IsEmpty());
 }
 
+void BatchSignConfiguration::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("options", options);
+  if (options.job_mode == kCryptoJobAsync) {
+    size_t size = 0;
+    for (const ByteSource& item : data) size += item.size();
+    for (const ByteSource& item : signatures) size += item.size();
+    tracker->TrackFieldWithSize("data", size);
+  }
+}
+
+// BatchSignJob takes the same arguments as SignJob, except that the data
+// (and, when verifying, the signatures) are arrays of buffer sources.
+Maybe<bool> BatchSignTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    BatchSignConfiguration* params) {
+  ClearErrorOnReturn clear_error_on_return;
+  Environment* env = Environment::GetCurrent(args);
+
+  if (GetSignJobOptions(mode, args, offset, &params->options).IsNothing())
+    return Nothing<bool>();
+
+  Local<v8::Context> context = env->context();
+  CHECK(args[offset + 5]->IsArray());
+  Local<Array> data = args[offset + 5].As<Array>();
+  params->data.reserve(data->Length());
+  for (uint32_t i = 0; i < data->Length(); i++) {
+    Local<Value> item;
+    if (!data->Get(context, i).ToLocal(&item))
+      return Nothing<bool>();
+    if (!IsAnyBufferSource(item)) {
+      THROW_ERR_INVALID_ARG_TYPE(env, "data[%d] must be a buffer source", i);
+      return Nothing<bool>();
+    }
+    ArrayBufferOrViewContents<char> contents(item);
+    if (UNLIKELY(!contents.CheckSizeInt32())) {
+      THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+      return Nothing<bool>();
+    }
+    params->data.push_back(mode == kCryptoJobAsync ? contents.ToCopy()
+                                                   : contents.ToByteSource());
+  }
+
+  if (params->options.mode == SignConfiguration::kVerify) {
+    CHECK(args[offset + 10]->IsArray());
+    Local<Array> signatures = args[offset + 10].As<Array>();
+    if (signatures->Length() != data->Length()) {
+      THROW_ERR_INVALID_ARG_VALUE(
+          env, "There must be one signature for each data item");
+      return Nothing<bool>();
+    }
+    ManagedEVPPKey m_pkey = params->options.key;
+    Mutex::ScopedLock lock(*m_pkey.mutex());
+    params->signatures.reserve(signatures->Length());
+    for (uint32_t i = 0; i < signatures->Length(); i++) {
+      Local<Value> item;
+      if (!signatures->Get(context, i).ToLocal(&item))
+        return Nothing<bool>();
+      if (!IsAnyBufferSource(item)) {
+        THROW_ERR_INVALID_ARG_TYPE(
+            env, "signatures[%d] must be a buffer source", i);
+        return Nothing<bool>();
+      }
+      ByteSource signature;
+      if (!GetVerifySignature(env, mode, params->options, item, &signature))
+        return Nothing<bool>();
+      params->signatures.push_back(std::move(signature));
+    }
+  }
+
+  return Just(true);
+}
+
+// The key is only set up once. Each item then works on a copy of that
+// context, which is much cheaper than initializing a new one.
+bool BatchSignTraits::DeriveBits(
+    Environment* env,
+    const BatchSignConfiguration& params,
+    ByteSource* out) {
+  ClearErrorOnReturn clear_error_on_return;
+  const SignConfiguration& options = params.options;
+  EVPMDCtxPointer base = InitSignJobContext(env, options);
+  if (!base)
+    return false;
+  EVPMDCtxPointer context(EVP_MD_CTX_new());
+  if (!context)
+    return false;
+
+  const size_t count = params.data.size();
+  if (options.mode == SignConfiguration::kVerify) {
+    ByteSource::Builder bitmap((count + 7) / 8);
+    memset(bitmap.data<void>(), 0, (count + 7) / 8);
+    for (size_t i = 0; i < count; i++) {
+      if (EVP_MD_CTX_copy_ex(context.get(), base.get()) != 1)
+        return false;
+      if (VerifyWithContext(
+              context.get(), params.signatures[i], params.data[i])) {
+        bitmap.data<unsigned char>()[i / 8] |= 1 << (i % 8);
+      }
+    }
+    *out = std::move(bitmap).release();
+    return true;
+  }
+
+  // The signatures are returned as their lengths, as uint32_t values,
+  // followed by the signatures themselves.
+  std::vector<ByteSource> signatures(count);
+  size_t total = count * sizeof(uint32_t);
+  for (size_t i = 0; i < count; i++) {
+    if (EVP_MD_CTX_copy_ex(context.get(), base.get()) != 1 ||
+        !SignWithContext(
+            env, context.get(), options, params.data[i], &signatures[i])) {
+      return false;
+    }
+    total += signatures[i].size();
+  }
+  ByteSource::Builder buf(total);
+  uint32_t* lengths = buf.data<uint32_t>();
+  unsigned char* p = buf.data<unsigned char>() + count * sizeof(uint32_t);
+  for (size_t i = 0; i < count; i++) {
+    lengths[i] = static_cast<uint32_t>(signatures[i].size());
+    memcpy(p, signatures[i].data(), signatures[i].size());
+    p += signatures[i].size();
+  }
+  *out = std::move(buf).release();
+  return true;
+}
+
+// Signing results in an array of ArrayBuffers. Verification results in an
+// ArrayBuffer holding one bit per item, starting with the least significant
+// bit of the first byte, that is set if the signature was valid.
+Maybe<bool> BatchSignTraits::EncodeOutput(
+    Environment* env,
+    const BatchSignConfiguration& params,
+    ByteSource* out,
+    Local<Value>* result) {
+  if (params.options.mode == SignConfiguration::kVerify) {
+    *result = out->ToArrayBuffer(env);
+    return Just(!result->IsEmpty());
+  }
+
+  const size_t count = params.data.size();
+  const uint32_t* lengths = out->data<uint32_t>();
+  const char* p = out->data<char>() + count * sizeof(uint32_t);
+  std::vector<Local<Value>> signatures(count);
+  for (size_t i = 0; i < count; i++) {
+    std::shared_ptr<BackingStore> store =
+        ArrayBuffer::NewBackingStore(env->isolate(), lengths[i]);
+    memcpy(store->Data(), p, lengths[i]);
+    p += lengths[i];
+    signatures[i] = ArrayBuffer::New(env->isolate(), std::move(store));
+  }
+  *result = Array::New(env->isolate(), signatures.data(), count);
+  return Just(true);
+}
+
 }  // namespace crypto
 }  // namespace node
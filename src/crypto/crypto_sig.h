@@ -161,6 +161,46 @@ struct SignTraits final {
 
 using SignJob = DeriveBitsJob<SignTraits>;
 
+// Signs or verifies many items with the same key and options as a single
+// job, which saves setting up the key and dispatching a job for each item.
+struct BatchSignConfiguration final : public MemoryRetainer {
+  // The data and signature of the options are unused.
+  SignConfiguration options;
+  std::vector<ByteSource> data;
+  std::vector<ByteSource> signatures;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(BatchSignConfiguration)
+  SET_SELF_SIZE(BatchSignConfiguration)
+};
+
+struct BatchSignTraits final {
+  using AdditionalParameters = BatchSignConfiguration;
+  static constexpr const char* JobName = "BatchSignJob";
+
+  static constexpr AsyncWrap::ProviderType Provider =
+      AsyncWrap::PROVIDER_SIGNREQUEST;
+
+  static v8::Maybe<bool> AdditionalConfig(
+      CryptoJobMode mode,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      unsigned int offset,
+      BatchSignConfiguration* params);
+
+  static bool DeriveBits(
+      Environment* env,
+      const BatchSignConfiguration& params,
+      ByteSource* out);
+
+  static v8::Maybe<bool> EncodeOutput(
+      Environment* env,
+      const BatchSignConfiguration& params,
+      ByteSource* out,
+      v8::Local<v8::Value>* result);
+};
+
+using BatchSignJob = DeriveBitsJob<BatchSignTraits>;
+
 }  // namespace crypto
 }  // namespace node
 
@@ -0,0 +1,365 @@
+#include "crypto/crypto_threadpool.h"
+#include "env-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "node_mutex.h"
+#include "node_options-inl.h"
+#include "tracing/trace_event.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+
+using v8::Array;
+using v8::FunctionCallbackInfo;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Uint32;
+using v8::Value;
+
+namespace crypto {
+
+namespace {
+constexpr const char* kWorkType = "crypto";
+
+struct PoolCounters {
+  std::atomic<uint64_t> queued{0};
+  std::atomic<uint64_t> running{0};
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> total_wait_ns{0};
+  std::atomic<uint64_t> max_wait_ns{0};
+
+  void Started(uint64_t queued_at) {
+    uint64_t wait = uv_hrtime() - queued_at;
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    running.fetch_add(1, std::memory_order_relaxed);
+    total_wait_ns.fetch_add(wait, std::memory_order_relaxed);
+    uint64_t max = max_wait_ns.load(std::memory_order_relaxed);
+    while (wait > max &&
+           !max_wait_ns.compare_exchange_weak(
+               max, wait, std::memory_order_relaxed)) {
+    }
+  }
+
+  void Finished() {
+    running.fetch_sub(1, std::memory_order_relaxed);
+    completed.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+struct EnvCompletions;
+
+struct Task {
+  ThreadPoolWork* work;
+  uint64_t queued_at;
+  // Only used on the libuv threadpool.
+  uv_work_t req;
+  uint64_t monitor_queued_at;
+  // Only used on the crypto pool.
+  EnvCompletions* completions;
+};
+
+// The tasks of one Environment that have finished on the crypto pool. They
+// are handed back to its event loop through a single async handle, which is
+// only referenced while the Environment has tasks outstanding.
+struct EnvCompletions {
+  Environment* env;
+  uv_async_t async;
+  // Only accessed on the event loop thread.
+  size_t outstanding = 0;
+  Mutex mutex;
+  std::vector<Task*> done;
+};
+
+class ThreadPoolState final {
+ public:
+  static ThreadPoolState& Get() {
+    return LeakedSingleton<ThreadPoolState>::Get();
+  }
+
+  void SetSize(size_t size) {
+    CHECK_LE(size, CryptoThreadPool::kMaxThreads);
+    Mutex::ScopedLock lock(mutex_);
+    target_ = size;
+    size_.store(size, std::memory_order_relaxed);
+    for (; threads_ < target_; threads_++)
+      std::thread([this]() { WorkerMain(); }).detach();
+    cond_.Broadcast(lock);
+  }
+
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  void Enqueue(Task* task) {
+    Mutex::ScopedLock lock(mutex_);
+    queue_.push_back(task);
+    cond_.Signal(lock);
+  }
+
+  EnvCompletions* GetCompletions(Environment* env);
+
+  PoolCounters* counters(CryptoThreadPool::Pool pool) {
+    return &counters_[pool];
+  }
+
+ private:
+  friend class LeakedSingleton<ThreadPoolState>;
+  ThreadPoolState() {
+    int64_t size;
+    {
+      Mutex::ScopedLock lock(per_process::cli_options_mutex);
+      size = per_process::cli_options->crypto_threadpool_size;
+    }
+    if (size > 0) SetSize(static_cast<size_t>(size));
+  }
+
+  static void OnCompletions(uv_async_t* handle);
+  static void CleanupCompletions(void* arg);
+
+  void WorkerMain();
+
+  Mutex mutex_;
+  ConditionVariable cond_;
+  std::deque<Task*> queue_;
+  size_t target_ = 0;
+  size_t threads_ = 0;
+  std::atomic<size_t> size_{0};
+  PoolCounters counters_[CryptoThreadPool::kThreadPoolCount];
+
+  Mutex completions_mutex_;
+  std::unordered_map<Environment*, EnvCompletions*> completions_;
+};
+
+void RunTask(CryptoThreadPool::Pool pool, Task* task) {
+  PoolCounters* counters = ThreadPoolState::Get().counters(pool);
+  counters->Started(task->queued_at);
+  TRACE_EVENT_BEGIN0(TRACING_CATEGORY_NODE2(threadpoolwork, sync), kWorkType);
+  task->work->DoThreadPoolWork();
+  TRACE_EVENT_END0(TRACING_CATEGORY_NODE2(threadpoolwork, sync), kWorkType);
+  counters->Finished();
+}
+
+void FinishTask(Task* task, int status) {
+  ThreadPoolWork* work = task->work;
+  delete task;
+  work->env()->DecreaseWaitingRequestCounter();
+  TRACE_EVENT_NESTABLE_ASYNC_END1(TRACING_CATEGORY_NODE2(threadpoolwork, async),
+                                  kWorkType,
+                                  work,
+                                  "result",
+                                  status);
+  work->AfterThreadPoolWork(status);
+}
+
+void ThreadPoolState::WorkerMain() {
+  Mutex::ScopedLock lock(mutex_);
+  for (;;) {
+    while (queue_.empty() && threads_ <= target_) cond_.Wait(lock);
+    // When the pool is disabled, the remaining threads drain the queue first
+    // because nothing else will.
+    if (threads_ > target_ && (queue_.empty() || target_ > 0)) {
+      threads_--;
+      return;
+    }
+    Task* task = queue_.front();
+    queue_.pop_front();
+    Mutex::ScopedUnlock unlock(lock);
+    RunTask(CryptoThreadPool::kThreadPoolCrypto, task);
+    EnvCompletions* completions = task->completions;
+    // The event loop cannot observe the task, and so cannot release the
+    // completions, until uv_async_send() has returned.
+    Mutex::ScopedLock completions_lock(completions->mutex);
+    completions->done.push_back(task);
+    uv_async_send(&completions->async);
+  }
+}
+
+EnvCompletions* ThreadPoolState::GetCompletions(Environment* env) {
+  Mutex::ScopedLock lock(completions_mutex_);
+  auto it = completions_.find(env);
+  if (it != completions_.end()) return it->second;
+
+  auto completions = new EnvCompletions();
+  completions->env = env;
+  CHECK_EQ(uv_async_init(env->event_loop(),
+                         &completions->async,
+                         OnCompletions),
+           0);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&completions->async));
+  // Cleanup hooks run once the Environment has no requests left waiting,
+  // so every task has been delivered by then.
+  env->AddCleanupHook(CleanupCompletions, completions);
+  completions_.emplace(env, completions);
+  return completions;
+}
+
+void ThreadPoolState::OnCompletions(uv_async_t* handle) {
+  EnvCompletions* completions =
+      ContainerOf(&EnvCompletions::async, handle);
+  std::vector<Task*> done;
+  {
+    Mutex::ScopedLock lock(completions->mutex);
+    done.swap(completions->done);
+  }
+  for (Task* task : done) {
+    completions->outstanding--;
+    FinishTask(task, 0);
+  }
+  if (completions->outstanding == 0)
+    uv_unref(reinterpret_cast<uv_handle_t*>(handle));
+}
+
+void ThreadPoolState::CleanupCompletions(void* arg) {
+  EnvCompletions* completions = static_cast<EnvCompletions*>(arg);
+  CHECK_EQ(completions->outstanding, 0);
+  ThreadPoolState& state = Get();
+  {
+    Mutex::ScopedLock lock(state.completions_mutex_);
+    state.completions_.erase(completions->env);
+  }
+  completions->env->CloseHandle(&completions->async, [](uv_async_t* handle) {
+    EnvCompletions* completions = ContainerOf(&EnvCompletions::async, handle);
+    delete completions;
+  });
+}
+
+void SetThreadPoolSize(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  if (!args[0]->IsUint32() ||
+      args[0].As<Uint32>()->Value() > CryptoThreadPool::kMaxThreads) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The crypto threadpool size must be between 0 and 128");
+  }
+  CryptoThreadPool::SetSize(args[0].As<Uint32>()->Value());
+}
+
+void GetThreadPoolSize(const FunctionCallbackInfo<Value>& args) {
+  args.GetReturnValue().Set(
+      static_cast<uint32_t>(CryptoThreadPool::GetSize()));
+}
+
+void GetThreadPoolStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsUint32());
+  uint32_t pool = args[0].As<Uint32>()->Value();
+  CHECK_LT(pool, CryptoThreadPool::kThreadPoolCount);
+  CryptoThreadPool::Stats stats =
+      CryptoThreadPool::GetStats(static_cast<CryptoThreadPool::Pool>(pool));
+  Local<Value> values[] = {
+      Number::New(env->isolate(), static_cast<double>(stats.threads)),
+      Number::New(env->isolate(), static_cast<double>(stats.queued)),
+      Number::New(env->isolate(), static_cast<double>(stats.running)),
+      Number::New(env->isolate(), static_cast<double>(stats.completed)),
+      Number::New(env->isolate(), static_cast<double>(stats.total_wait_ns)),
+      Number::New(env->isolate(), static_cast<double>(stats.max_wait_ns)),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+}  // namespace
+
+void CryptoThreadPool::Schedule(ThreadPoolWork* work) {
+  ThreadPoolState& state = ThreadPoolState::Get();
+  Environment* env = work->env();
+  env->IncreaseWaitingRequestCounter();
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0(
+      TRACING_CATEGORY_NODE2(threadpoolwork, async), kWorkType, work);
+  Task* task = new Task();
+  task->work = work;
+  task->queued_at = uv_hrtime();
+
+  if (state.size() == 0) {
+    state.counters(kThreadPoolLibuv)
+        ->queued.fetch_add(1, std::memory_order_relaxed);
+    ThreadPoolWorkQueue* queue = env->threadpool_work_queue();
+    task->monitor_queued_at =
+        queue->WorkQueued(kThreadPoolWorkCrypto);
+    int status = queue->Queue(
+        kThreadPoolWorkCrypto,
+        &task->req,
+        [](uv_work_t* req) {
+          Task* task = ContainerOf(&Task::req, req);
+          ThreadPoolWorkQueue* queue =
+              task->work->env()->threadpool_work_queue();
+          uint64_t started_at =
+              queue->WorkStarted(kThreadPoolWorkCrypto,
+                                 task->monitor_queued_at);
+          RunTask(kThreadPoolLibuv, task);
+          queue->WorkFinished(kThreadPoolWorkCrypto,
+                              started_at);
+        },
+        [](uv_work_t* req, int status) {
+          Task* task = ContainerOf(&Task::req, req);
+          ThreadPoolWorkQueue* queue =
+              task->work->env()->threadpool_work_queue();
+          if (status == UV_ECANCELED)
+            queue->WorkCancelled(kThreadPoolWorkCrypto);
+          queue->Done(kThreadPoolWorkCrypto);
+          if (status == UV_ECANCELED) {
+            ThreadPoolState::Get()
+                .counters(kThreadPoolLibuv)
+                ->queued.fetch_sub(1, std::memory_order_relaxed);
+          }
+          FinishTask(task, status);
+        });
+    CHECK_EQ(status, 0);
+    return;
+  }
+
+  EnvCompletions* completions = state.GetCompletions(env);
+  if (completions->outstanding++ == 0)
+    uv_ref(reinterpret_cast<uv_handle_t*>(&completions->async));
+  task->completions = completions;
+  state.counters(kThreadPoolCrypto)
+      ->queued.fetch_add(1, std::memory_order_relaxed);
+  state.Enqueue(task);
+}
+
+void CryptoThreadPool::SetSize(size_t threads) {
+  ThreadPoolState::Get().SetSize(threads);
+}
+
+size_t CryptoThreadPool::GetSize() {
+  return ThreadPoolState::Get().size();
+}
+
+CryptoThreadPool::Stats CryptoThreadPool::GetStats(Pool pool) {
+  PoolCounters* counters = ThreadPoolState::Get().counters(pool);
+  return Stats{
+      static_cast<uint64_t>(
+          pool == kThreadPoolLibuv ? GetLibuvThreadPoolSize() : GetSize()),
+      counters->queued.load(std::memory_order_relaxed),
+      counters->running.load(std::memory_order_relaxed),
+      counters->completed.load(std::memory_order_relaxed),
+      counters->total_wait_ns.load(std::memory_order_relaxed),
+      counters->max_wait_ns.load(std::memory_order_relaxed)};
+}
+
+void CryptoThreadPool::Initialize(Environment* env, Local<Object> target) {
+  Local<v8::Context> context = env->context();
+  SetMethod(context, target, "setThreadPoolSize", SetThreadPoolSize);
+  SetMethodNoSideEffect(
+      context, target, "getThreadPoolSize", GetThreadPoolSize);
+  SetMethodNoSideEffect(
+      context, target, "getThreadPoolStats", GetThreadPoolStats);
+
+  NODE_DEFINE_CONSTANT(target, kThreadPoolLibuv);
+  NODE_DEFINE_CONSTANT(target, kThreadPoolCrypto);
+}
+
+void CryptoThreadPool::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(SetThreadPoolSize);
+  registry->Register(GetThreadPoolSize);
+  registry->Register(GetThreadPoolStats);
+}
+
+}  // namespace crypto
+}  // namespace node
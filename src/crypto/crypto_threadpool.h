@@ -0,0 +1,66 @@
+#ifndef SRC_CRYPTO_CRYPTO_THREADPOOL_H_
+#define SRC_CRYPTO_CRYPTO_THREADPOOL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_internals.h"
+#include "v8.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace node {
+
+class ExternalReferenceRegistry;
+
+namespace crypto {
+
+// Schedules asynchronous CryptoJobs. By default they run on the libuv
+// threadpool alongside file system, DNS and zlib work, where a burst of
+// expensive operations (scrypt, RSA key generation, signing) can hold every
+// thread and delay unrelated I/O. Giving the process-wide crypto pool threads,
+// with --crypto-threadpool-size or setThreadPoolSize(), moves crypto work onto
+// them instead. Queue depth and wait times are tracked for both pools so that
+// saturation of either one is visible.
+class CryptoThreadPool final {
+ public:
+  static constexpr size_t kMaxThreads = 128;
+
+  enum Pool {
+    kThreadPoolLibuv,
+    kThreadPoolCrypto,
+    kThreadPoolCount
+  };
+
+  // Only CryptoJobs are counted, also for the libuv threadpool.
+  struct Stats {
+    uint64_t threads;
+    uint64_t queued;
+    uint64_t running;
+    uint64_t completed;
+    uint64_t total_wait_ns;
+    uint64_t max_wait_ns;
+  };
+
+  // Runs work->DoThreadPoolWork() on a pool thread and then
+  // work->AfterThreadPoolWork() on the event loop of work->env().
+  static void Schedule(ThreadPoolWork* work);
+
+  // Zero threads disables the crypto pool. Jobs that are already queued on
+  // it still run.
+  static void SetSize(size_t threads);
+  static size_t GetSize();
+
+  static Stats GetStats(Pool pool);
+
+  static void Initialize(Environment* env, v8::Local<v8::Object> target);
+  static void RegisterExternalReferences(
+      ExternalReferenceRegistry* registry);
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CRYPTO_CRYPTO_THREADPOOL_H_
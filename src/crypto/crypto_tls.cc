@@ -66,6 +66,19 @@ namespace crypto {
 
 namespace {
 
+// The largest plaintext that fits into a single TLS record (RFC 8446 5.1).
+constexpr size_t kMaxTLSRecordPlaintext = 16384;
+
+// With dynamic record sizing, application data is first sent in records that
+// fit into a single TCP segment, so that the peer can decrypt each of them as
+// soon as it arrives instead of waiting for a whole 16 KB record while the
+// congestion window is still small. Once enough data has been sent the
+// records grow to the maximum size, and they shrink again after the
+// connection has been idle for a while.
+constexpr size_t kSlowStartTLSRecordPlaintext = 1360;
+constexpr uint64_t kRecordSizeBoostThreshold = 1024 * 1024;
+constexpr uint64_t kRecordSizeIdleResetNs = 1000 * 1000 * 1000;
+
 // Our custom implementation of the certificate verify callback
 // used when establishing a TLS handshake. Because we cannot perform
 // I/O quickly enough with X509_STORE_CTX_ APIs in this callback,
@@ -92,7 +105,12 @@ SSL_SESSION* GetSessionCallback(
     int* copy) {
   TLSWrap* w = static_cast<TLSWrap*>(SSL_get_app_data(s));
   *copy = 0;
-  return w->ReleaseSession();
+  SSL_SESSION* session = w->ReleaseSession();
+  if (session == nullptr && w->is_server()) {
+    if (TLSSessionCache* cache = w->session_cache())
+      session = cache->Lookup(key, len).release();
+  }
+  return session;
 }
 
 void OnClientHello(
@@ -134,6 +152,9 @@ void OnClientHello(
 
 void KeylogCallback(const SSL* s, const char* line) {
   TLSWrap* w = static_cast<TLSWrap*>(SSL_get_app_data(s));
+  // The callback is installed on every context, but only connections that
+  // called enableKeylogCallback() report their secrets.
+  if (!w->has_keylog_callback()) return;
   Environment* env = w->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -151,6 +172,19 @@ void KeylogCallback(const SSL* s, const char* line) {
 
 int NewSessionCallback(SSL* s, SSL_SESSION* sess) {
   TLSWrap* w = static_cast<TLSWrap*>(SSL_get_app_data(s));
+
+  // Connections using a native session cache never hand sessions to
+  // JavaScript.
+  if (w->is_server()) {
+    if (TLSSessionCache* cache = w->session_cache()) {
+      cache->Store(sess);
+      return 0;
+    }
+  } else if (TLSClientSessionCache* cache = w->client_session_cache()) {
+    cache->Store(w->client_session_key(), sess);
+    return 0;
+  }
+
   Environment* env = w->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -210,6 +244,13 @@ int SSLCertCallback(SSL* s, void* arg) {
     // handshake will continue after certcb is done.
     return -1;
 
+  // A context picked from the native SNI map already answers what the
+  // JavaScript callback would be asked, unless an OCSP response is needed.
+  if (w->has_registered_sni_context() &&
+      SSL_get_tlsext_status_type(s) != TLSEXT_STATUSTYPE_ocsp) {
+    return 1;
+  }
+
   Environment* env = w->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -341,12 +382,6 @@ int TLSExtStatusCallback(SSL* s, void* arg) {
   return SSL_TLSEXT_ERR_OK;
 }
 
-void ConfigureSecureContext(SecureContext* sc) {
-  // OCSP stapling
-  SSL_CTX_set_tlsext_status_cb(sc->ctx().get(), TLSExtStatusCallback);
-  SSL_CTX_set_tlsext_status_arg(sc->ctx().get(), nullptr);
-}
-
 inline bool Set(
     Environment* env,
     Local<Object> target,
@@ -392,9 +427,6 @@ TLSWrap::TLSWrap(Environment* env,
   ssl_ = sc_->CreateSSL();
   CHECK(ssl_);
 
-  sc_->SetGetSessionCallback(GetSessionCallback);
-  sc_->SetNewSessionCallback(NewSessionCallback);
-
   StreamBase::AttachToObject(GetObject());
   stream->PushStreamListener(this);
 
@@ -408,6 +440,17 @@ TLSWrap::~TLSWrap() {
   Destroy();
 }
 
+void TLSWrap::ConfigureSecureContext(SecureContext* sc) {
+  sc->SetGetSessionCallback(GetSessionCallback);
+  sc->SetNewSessionCallback(NewSessionCallback);
+  sc->SetSelectSNIContextCallback(SelectSNIContextCallback);
+  sc->SetKeylogCallback(KeylogCallback);
+
+  // OCSP stapling
+  SSL_CTX_set_tlsext_status_cb(sc->ctx().get(), TLSExtStatusCallback);
+  SSL_CTX_set_tlsext_status_arg(sc->ctx().get(), nullptr);
+}
+
 MaybeLocal<ArrayBufferView> TLSWrap::ocsp_response() const {
   if (ocsp_response_.IsEmpty())
     return MaybeLocal<ArrayBufferView>();
@@ -474,11 +517,6 @@ void TLSWrap::InitSSL() {
   //   https://github.com/openssl/openssl/issues/7199#issuecomment-420670544
   SSL_set_info_callback(ssl_.get(), SSLInfoCallback);
 
-  if (is_server())
-    sc_->SetSelectSNIContextCallback(SelectSNIContextCallback);
-
-  ConfigureSecureContext(sc_.get());
-
   SSL_set_cert_cb(ssl_.get(), SSLCertCallback, this);
 
   if (is_server()) {
@@ -598,6 +636,15 @@ void TLSWrap::SSLInfoCallback(const SSL* ssl_, int where, int ret) {
 
     c->established_ = true;
 
+    if (c->offered_client_session_ != nullptr) {
+      if (TLSClientSessionCache* cache = c->client_session_cache()) {
+        cache->Resumed(c->client_session_key_,
+                       c->offered_client_session_,
+                       SSL_session_reused(ssl));
+      }
+      c->offered_client_session_ = nullptr;
+    }
+
     if (object->Get(env->context(), env->onhandshakedone_string())
           .ToLocal(&callback) && callback->IsFunction()) {
       c->MakeCallback(callback.As<Function>(), 0, nullptr);
@@ -892,19 +939,19 @@ void TLSWrap::ClearIn() {
   std::unique_ptr<BackingStore> bs = std::move(pending_cleartext_input_);
   MarkPopErrorOnReturn mark_pop_error_on_return;
 
-  NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(bs->ByteLength());
-  int written = SSL_write(ssl_.get(), bs->Data(), bs->ByteLength());
-  Debug(this, "Writing %zu bytes, written = %d", bs->ByteLength(), written);
-  CHECK(written == -1 || written == static_cast<int>(bs->ByteLength()));
+  const size_t length = bs->ByteLength();
+  NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(length);
+  size_t written = WriteRecords(static_cast<const char*>(bs->Data()), length);
+  Debug(this, "Writing %zu bytes, written = %zu", length, written);
 
   // All written
-  if (written != -1) {
+  if (written == length) {
     Debug(this, "Successfully wrote all data to SSL");
     return;
   }
 
   // Error or partial write
-  int err = SSL_get_error(ssl_.get(), written);
+  int err = SSL_get_error(ssl_.get(), -1);
   if (err == SSL_ERROR_SSL || err == SSL_ERROR_SYSCALL) {
     Debug(this, "Got SSL error (%d)", err);
     write_callback_scheduled_ = true;
@@ -917,9 +964,52 @@ void TLSWrap::ClearIn() {
   Debug(this, "Pushing data back");
   // Push back the not-yet-written data. This can be skipped in the error
   // case because no further writes would succeed anyway.
+  if (written > 0) {
+    std::unique_ptr<BackingStore> rest;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+      rest = ArrayBuffer::NewBackingStore(env()->isolate(), length - written);
+    }
+    memcpy(rest->Data(),
+           static_cast<const char*>(bs->Data()) + written,
+           length - written);
+    bs = std::move(rest);
+  }
   pending_cleartext_input_ = std::move(bs);
 }
 
+size_t TLSWrap::WriteRecords(const char* data, size_t length) {
+  size_t record_size = kMaxTLSRecordPlaintext;
+  if (dynamic_record_sizing_) {
+    const uint64_t now = uv_hrtime();
+    if (now - last_record_time_ > kRecordSizeIdleResetNs)
+      record_bytes_sent_ = 0;
+    last_record_time_ = now;
+    if (record_bytes_sent_ < kRecordSizeBoostThreshold)
+      record_size = kSlowStartTLSRecordPlaintext;
+  }
+
+  // Each SSL_write() call of at most record_size bytes is encrypted into a
+  // single record. A larger one is split by OpenSSL into maximum-size
+  // records, with a short one at the end.
+  size_t offset = 0;
+  while (offset < length) {
+    size_t chunk = length - offset;
+    if (record_size < kMaxTLSRecordPlaintext)
+      chunk = std::min(chunk, record_size);
+    int r = SSL_write(ssl_.get(), data + offset, chunk);
+    if (r == -1) break;
+    CHECK_EQ(static_cast<size_t>(r), chunk);
+    offset += chunk;
+    if (dynamic_record_sizing_ && record_size < kMaxTLSRecordPlaintext) {
+      record_bytes_sent_ += chunk;
+      if (record_bytes_sent_ >= kRecordSizeBoostThreshold)
+        record_size = kMaxTLSRecordPlaintext;
+    }
+  }
+  return offset;
+}
+
 std::string TLSWrap::diagnostic_name() const {
   std::string name = "TLSWrap ";
   name += is_server() ? "server (" : "client (";
@@ -971,6 +1061,7 @@ void TLSWrap::ClearError() {
 
 // Called by StreamBase::Write() to request async write of clear text into SSL.
 // TODO(@sam-github) Should there be a TLSWrap::DoTryWrite()?
+
 int TLSWrap::DoWrite(WriteWrap* w,
                      uv_buf_t* bufs,
                      size_t count,
@@ -1038,7 +1129,7 @@ int TLSWrap::DoWrite(WriteWrap* w,
   std::unique_ptr<BackingStore> bs;
   MarkPopErrorOnReturn mark_pop_error_on_return;
 
-  int written = 0;
+  int written = -1;
 
   // It is common for zero length buffers to be written,
   // don't copy data if there there is one buffer with data
@@ -1048,7 +1139,48 @@ int TLSWrap::DoWrite(WriteWrap* w,
   // of data supplied to end() there is no sense allocating
   // and copying it when it could just be used.
 
-  if (nonempty_count != 1) {
+  // When every buffer but the last fills at least a whole TLS record on its
+  // own, encrypting them one by one yields about the same records as
+  // encrypting their concatenation, so skip gathering them into one copy.
+  // This is the common shape of large writes (file chunks behind a small
+  // trailer), where the copy was a significant part of the cost.
+  bool record_sized = nonempty_count > 1;
+  for (i = 0; record_sized && i < nonempty_i; i++) {
+    if (bufs[i].len > 0 && bufs[i].len < kMaxTLSRecordPlaintext)
+      record_sized = false;
+  }
+
+  // Whatever WriteRecords() does not take is kept for ClearIn().
+  auto save_unwritten = [&](size_t unwritten) {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    bs = ArrayBuffer::NewBackingStore(env()->isolate(), unwritten);
+  };
+
+  if (record_sized) {
+    size_t offset = 0;
+    size_t n = 0;
+    for (i = 0; i < count; i++) {
+      if (bufs[i].len == 0) continue;
+      NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(bufs[i].len);
+      n = WriteRecords(bufs[i].base, bufs[i].len);
+      offset += n;
+      if (n != bufs[i].len) break;
+    }
+    written = offset == length ? static_cast<int>(length) : -1;
+
+    if (written == -1) {
+      save_unwritten(length - offset);
+      size_t copied = bufs[i].len - n;
+      memcpy(bs->Data(), bufs[i].base + n, copied);
+      for (i++; i < count; i++) {
+        memcpy(static_cast<char*>(bs->Data()) + copied,
+               bufs[i].base, bufs[i].len);
+        copied += bufs[i].len;
+      }
+    }
+  } else if (nonempty_count != 1) {
+    // Gathering small buffers into one lets them share records instead of
+    // each being encrypted into a record of its own.
     {
       NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
       bs = ArrayBuffer::NewBackingStore(env()->isolate(), length);
@@ -1061,17 +1193,26 @@ int TLSWrap::DoWrite(WriteWrap* w,
     }
 
     NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(length);
-    written = SSL_write(ssl_.get(), bs->Data(), length);
+    size_t n = WriteRecords(static_cast<const char*>(bs->Data()), length);
+    if (n == length) {
+      written = static_cast<int>(length);
+    } else if (n > 0) {
+      std::unique_ptr<BackingStore> all = std::move(bs);
+      save_unwritten(length - n);
+      memcpy(bs->Data(), static_cast<const char*>(all->Data()) + n,
+             length - n);
+    }
   } else {
     // Only one buffer: try to write directly, only store if it fails
     uv_buf_t* buf = &bufs[nonempty_i];
     NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(buf->len);
-    written = SSL_write(ssl_.get(), buf->base, buf->len);
+    size_t n = WriteRecords(buf->base, buf->len);
 
-    if (written == -1) {
-      NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
-      bs = ArrayBuffer::NewBackingStore(env()->isolate(), length);
-      memcpy(bs->Data(), buf->base, buf->len);
+    if (n == length) {
+      written = static_cast<int>(length);
+    } else {
+      save_unwritten(length - n);
+      memcpy(bs->Data(), buf->base + n, length - n);
     }
   }
 
@@ -1080,7 +1221,7 @@ int TLSWrap::DoWrite(WriteWrap* w,
 
   if (written == -1) {
     // If we stopped writing because of an error, it's fatal, discard the data.
-    int err = SSL_get_error(ssl_.get(), written);
+    int err = SSL_get_error(ssl_.get(), -1);
     if (err == SSL_ERROR_SSL || err == SSL_ERROR_SYSCALL) {
       // TODO(@jasnell): What are we doing with the error?
       Debug(this, "Got SSL error (%d), returning UV_EPROTO", err);
@@ -1225,8 +1366,7 @@ void TLSWrap::EnableSessionCallbacks(const FunctionCallbackInfo<Value>& args) {
 void TLSWrap::EnableKeylogCallback(const FunctionCallbackInfo<Value>& args) {
   TLSWrap* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
-  CHECK(wrap->sc_);
-  wrap->sc_->SetKeylogCallback(KeylogCallback);
+  wrap->keylog_callback_ = true;
 }
 
 // Check required capabilities were not excluded from the OpenSSL build:
@@ -1334,6 +1474,18 @@ void TLSWrap::GetServername(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// Dynamic record sizing is on by default. Turning it off makes every write
+// use records of the maximum size right away, as before.
+void TLSWrap::SetDynamicRecordSizing(const FunctionCallbackInfo<Value>& args) {
+  TLSWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+
+  CHECK_EQ(args.Length(), 1);
+  CHECK(args[0]->IsBoolean());
+  wrap->dynamic_record_sizing_ = args[0]->IsTrue();
+  wrap->record_bytes_sent_ = 0;
+}
+
 void TLSWrap::SetServername(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
 
@@ -1353,6 +1505,7 @@ void TLSWrap::SetServername(const FunctionCallbackInfo<Value>& args) {
 
 int TLSWrap::SelectSNIContextCallback(SSL* s, int* ad, void* arg) {
   TLSWrap* p = static_cast<TLSWrap*>(SSL_get_app_data(s));
+  if (!p->is_server()) return SSL_TLSEXT_ERR_OK;
   Environment* env = p->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -1361,6 +1514,9 @@ int TLSWrap::SelectSNIContextCallback(SSL* s, int* ad, void* arg) {
   if (!Set(env, p->GetOwner(), env->servername_string(), servername))
     return SSL_TLSEXT_ERR_NOACK;
 
+  if (p->UseRegisteredSNIContext(servername))
+    return SSL_TLSEXT_ERR_OK;
+
   Local<Value> ctx = p->object()->Get(env->context(), env->sni_context_string())
       .FromMaybe(Local<Value>());
 
@@ -1378,13 +1534,26 @@ int TLSWrap::SelectSNIContextCallback(SSL* s, int* ad, void* arg) {
   CHECK_NOT_NULL(sc);
   p->sni_context_ = BaseObjectPtr<SecureContext>(sc);
 
-  ConfigureSecureContext(sc);
   CHECK_EQ(SSL_set_SSL_CTX(p->ssl_.get(), sc->ctx().get()), sc->ctx().get());
   p->SetCACerts(sc);
 
   return SSL_TLSEXT_ERR_OK;
 }
 
+bool TLSWrap::UseRegisteredSNIContext(const char* servername) {
+  SecureContext* sc = sc_->FindSNIContext(servername);
+  if (sc == nullptr || !sc->ctx())
+    return false;
+
+  Debug(this, "Using registered SNI context for %s", servername);
+  sni_context_ = BaseObjectPtr<SecureContext>(sc);
+  registered_sni_context_ = true;
+
+  CHECK_EQ(SSL_set_SSL_CTX(ssl_.get(), sc->ctx().get()), sc->ctx().get());
+  SetCACerts(sc);
+  return true;
+}
+
 int TLSWrap::SetCACerts(SecureContext* sc) {
   int err = SSL_set1_verify_cert_store(ssl_.get(),
                                        SSL_CTX_get_cert_store(sc->ctx().get()));
@@ -1802,6 +1971,32 @@ void TLSWrap::SetSession(const FunctionCallbackInfo<Value>& args) {
     return env->ThrowError("SSL_set_session error");
 }
 
+// Makes a client use the SecureContext's client session cache under the given
+// key, typically "servername:port". Must be called before start(). Returns
+// whether a cached session is offered to the server.
+void TLSWrap::SetClientSessionKey(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  TLSWrap* w;
+  ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
+
+  CHECK_EQ(args.Length(), 1);
+  CHECK(args[0]->IsString());
+  CHECK(w->is_client());
+  CHECK(!w->started_);
+  CHECK(w->ssl_);
+
+  w->client_session_key_ = Utf8Value(env->isolate(), args[0]).ToString();
+  TLSClientSessionCache* cache = w->client_session_cache();
+  if (cache == nullptr) return args.GetReturnValue().Set(false);
+
+  SSLSessionPointer sess = cache->Lookup(w->client_session_key_);
+  if (!sess) return args.GetReturnValue().Set(false);
+  if (!SetTLSSession(w->ssl_, sess))
+    return env->ThrowError("SSL_set_session error");
+  w->offered_client_session_ = sess.get();
+  args.GetReturnValue().Set(true);
+}
+
 void TLSWrap::IsSessionReused(const FunctionCallbackInfo<Value>& args) {
   TLSWrap* w;
   ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
@@ -2128,6 +2323,8 @@ void TLSWrap::SetMaxSendFragment(const FunctionCallbackInfo<Value>& args) {
   int rv = SSL_set_max_send_fragment(
       w->ssl_.get(),
       args[0]->Int32Value(env->context()).FromJust());
+  // An explicitly chosen fragment size takes precedence.
+  if (rv == 1) w->dynamic_record_sizing_ = false;
   args.GetReturnValue().Set(rv);
 }
 #endif  // SSL_set_max_send_fragment
@@ -2180,6 +2377,9 @@ void TLSWrap::Initialize(
   SetProtoMethod(isolate, t, "setALPNProtocols", SetALPNProtocols);
   SetProtoMethod(isolate, t, "setKeyCert", SetKeyCert);
   SetProtoMethod(isolate, t, "setOCSPResponse", SetOCSPResponse);
+  SetProtoMethod(isolate, t, "setClientSessionKey", SetClientSessionKey);
+  SetProtoMethod(
+      isolate, t, "setDynamicRecordSizing", SetDynamicRecordSizing);
   SetProtoMethod(isolate, t, "setServername", SetServername);
   SetProtoMethod(isolate, t, "setSession", SetSession);
   SetProtoMethod(isolate, t, "setVerifyMode", SetVerifyMode);
@@ -2250,6 +2450,8 @@ void TLSWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(RequestOCSP);
   registry->Register(SetALPNProtocols);
   registry->Register(SetOCSPResponse);
+  registry->Register(SetClientSessionKey);
+  registry->Register(SetDynamicRecordSizing);
   registry->Register(SetServername);
   registry->Register(SetSession);
   registry->Register(SetVerifyMode);
@@ -56,17 +56,35 @@ class TLSWrap : public AsyncWrap,
                          void* priv);
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
 
+  // Installs the SSL_CTX callbacks that TLSWrap relies on. Called once by
+  // SecureContext::Init(), because the SSL_CTX may later be shared with
+  // other threads and must not be modified per connection.
+  static void ConfigureSecureContext(SecureContext* sc);
+
   ~TLSWrap() override;
 
   bool is_cert_cb_running() const { return cert_cb_running_; }
   bool is_waiting_cert_cb() const { return cert_cb_ != nullptr; }
   bool has_session_callbacks() const { return session_callbacks_; }
+  bool has_keylog_callback() const { return keylog_callback_; }
   void set_cert_cb_running(bool on = true) { cert_cb_running_ = on; }
   void set_awaiting_new_session(bool on = true) { awaiting_new_session_ = on; }
   void enable_session_callbacks() { session_callbacks_ = true; }
   bool is_server() const { return kind_ == Kind::kServer; }
   bool is_client() const { return kind_ == Kind::kClient; }
   bool is_awaiting_new_session() const { return awaiting_new_session_; }
+  bool has_registered_sni_context() const { return registered_sni_context_; }
+  TLSSessionCache* session_cache() const {
+    return sc_ ? sc_->session_cache() : nullptr;
+  }
+  // Set for clients given a key with setClientSessionKey().
+  TLSClientSessionCache* client_session_cache() const {
+    return sc_ && !client_session_key_.empty() ? sc_->client_session_cache()
+                                               : nullptr;
+  }
+  const std::string& client_session_key() const {
+    return client_session_key_;
+  }
 
   // Implement StreamBase:
   bool IsAlive() override;
@@ -134,6 +152,10 @@ class TLSWrap : public AsyncWrap,
 
   void WaitForCertCb(CertCb cb, void* arg);
 
+  // Switches to the context registered on sc_ for the given server name, if
+  // there is one, without calling out to JavaScript.
+  bool UseRegisteredSNIContext(const char* servername);
+
   TLSWrap(Environment* env,
           v8::Local<v8::Object> obj,
           Kind kind,
@@ -152,6 +174,9 @@ class TLSWrap : public AsyncWrap,
   void EncOut();  // Write encrypted data from enc_out_ to underlying stream.
   void ClearIn();  // SSL_write() clear data "in" to SSL.
   void ClearOut();  // SSL_read() clear text "out" from SSL.
+  // SSL_write() data in records sized for the state of the connection.
+  // Returns how much of it was written.
+  size_t WriteRecords(const char* data, size_t length);
   void Destroy();
 
   // Call Done() on outstanding WriteWrap request.
@@ -215,6 +240,10 @@ class TLSWrap : public AsyncWrap,
   static void SetALPNProtocols(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetKeyCert(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetOCSPResponse(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetClientSessionKey(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetDynamicRecordSizing(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetServername(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetSession(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetVerifyMode(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -266,11 +295,13 @@ class TLSWrap : public AsyncWrap,
   std::string error_;
 
   bool session_callbacks_ = false;
+  bool keylog_callback_ = false;
   bool awaiting_new_session_ = false;
   bool in_dowrite_ = false;
   bool started_ = false;
   bool shutdown_ = false;
   bool cert_cb_running_ = false;
+  bool registered_sni_context_ = false;
   bool eof_ = false;
 
   // TODO(@jasnell): These state flags should be revisited.
@@ -284,6 +315,16 @@ class TLSWrap : public AsyncWrap,
 
   int cycle_depth_ = 0;
 
+  // The client session cache entry used by this connection. The offered
+  // session is only compared against, never dereferenced.
+  std::string client_session_key_;
+  const SSL_SESSION* offered_client_session_ = nullptr;
+
+  // Dynamic record sizing, see WriteRecords().
+  bool dynamic_record_sizing_ = true;
+  uint64_t record_bytes_sent_ = 0;
+  uint64_t last_record_time_ = 0;
+
   // SSL_set_cert_cb
   CertCb cert_cb_ = nullptr;
   void* cert_cb_arg_ = nullptr;
@@ -4,6 +4,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "async_wrap.h"
+#include "crypto/crypto_threadpool.h"
 #include "env.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
@@ -408,7 +409,7 @@ class CryptoJob : public AsyncWrap, public ThreadPoolWork {
     CryptoJob<CryptoJobTraits>* job;
     ASSIGN_OR_RETURN_UNWRAP(&job, args.This());
     if (job->mode() == kCryptoJobAsync)
-      return job->ScheduleWork();
+      return CryptoThreadPool::Schedule(job);
 
     v8::Local<v8::Value> ret[2];
     env->PrintSyncTrace();
@@ -922,10 +922,32 @@ v8::MaybeLocal<v8::Value> X509Certificate::toObject(Environment* env) {
   return toObject(env, view());
 }
 
+// A TLS server typically sees the same few client certificates over and over,
+// so the converted objects are cached per Environment. Every caller gets its
+// own shallow copy, which it can extend (with issuerCertificate, for
+// instance) without affecting the others, but nested objects are shared.
 v8::MaybeLocal<v8::Value> X509Certificate::toObject(
     Environment* env, const ncrypto::X509View& cert) {
+  static constexpr size_t kMaxCachedObjects = 128;
   if (!cert) return {};
-  return X509ToObject(env, cert).FromMaybe(Local<Value>());
+
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int md_size;
+  if (!X509_digest(cert.get(), EVP_sha256(), md, &md_size))
+    return X509ToObject(env, cert).FromMaybe(Local<Value>());
+  std::string key(reinterpret_cast<const char*>(md), md_size);
+
+  auto& cache = env->x509_object_cache;
+  Local<Object> info;
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    info = it->second.Get(env->isolate());
+  } else {
+    if (!X509ToObject(env, cert).ToLocal(&info)) return {};
+    if (cache.size() >= kMaxCachedObjects) cache.clear();
+    cache.emplace(std::move(key), v8::Global<Object>(env->isolate(), info));
+  }
+  return info->Clone();
 }
 
 X509Certificate::X509Certificate(
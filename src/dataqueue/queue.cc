@@ -8,6 +8,7 @@
 #include <node_errors.h>
 #include <node_external_reference.h>
 #include <node_file-inl.h>
+#include <node_mutex.h>
 #include <stream_base-inl.h>
 #include <util-inl.h>
 #include <uv.h>
@@ -15,9 +16,15 @@
 #include <algorithm>
 #include <deque>
 #include <initializer_list>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 namespace node {
 
 using v8::ArrayBufferView;
@@ -34,6 +41,11 @@ class NonIdempotentDataQueueReader;
 class EntryImpl : public DataQueue::Entry {
  public:
   virtual std::shared_ptr<DataQueue::Reader> get_reader() = 0;
+
+  // Returns the bytes of the entry if it holds them in memory.
+  virtual std::optional<DataQueue::Vec> in_memory_data() const {
+    return std::nullopt;
+  }
 };
 
 class DataQueueImpl final : public DataQueue,
@@ -698,6 +710,13 @@ class InMemoryEntry final : public EntryImpl {
 
   std::optional<uint64_t> size() const override { return byte_length_; }
 
+  std::optional<DataQueue::Vec> in_memory_data() const override {
+    return DataQueue::Vec{
+        static_cast<uint8_t*>(backing_store_->Data()) + offset_,
+        byte_length_,
+    };
+  }
+
   bool is_idempotent() const override { return true; }
 
   void MemoryInfo(node::MemoryTracker* tracker) const override {
@@ -800,6 +819,127 @@ class DataQueueEntry : public EntryImpl {
 
 // ============================================================================
 
+// An Entry that wraps an arbitrary bob::Source, such as a transform over
+// another DataQueue. It can only be read once.
+class SourceEntry final : public EntryImpl {
+ public:
+  explicit SourceEntry(std::shared_ptr<DataQueue::Reader> source)
+      : source_(std::move(source)) {
+    CHECK(source_);
+  }
+
+  // Disallow moving and copying.
+  SourceEntry(const SourceEntry&) = delete;
+  SourceEntry(SourceEntry&&) = delete;
+  SourceEntry& operator=(const SourceEntry&) = delete;
+  SourceEntry& operator=(SourceEntry&&) = delete;
+
+  std::shared_ptr<DataQueue::Reader> get_reader() override {
+    return std::move(source_);
+  }
+
+  std::unique_ptr<Entry> slice(
+      uint64_t start, std::optional<uint64_t> end = std::nullopt) override {
+    return nullptr;
+  }
+
+  std::optional<uint64_t> size() const override { return std::nullopt; }
+
+  bool is_idempotent() const override { return false; }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(SourceEntry)
+  SET_SELF_SIZE(SourceEntry)
+
+ private:
+  std::shared_ptr<DataQueue::Reader> source_;
+};
+
+// ============================================================================
+
+#ifndef _WIN32
+// A private mapping of a whole file. FdEntry readers for the same unmodified
+// file share one mapping, and hand out views of it instead of reading into
+// fresh buffers, so concurrent reads of a file share its pages. The mapping
+// is unmapped once the last view is released.
+class FileMapping final {
+ public:
+  // Returns the mapping of the file opened as |fd|, whose stat is |stat|,
+  // or nullptr if it cannot be mapped.
+  static std::shared_ptr<FileMapping> Get(int fd, const uv_stat_t& stat) {
+    if (stat.st_size == 0 || !S_ISREG(stat.st_mode)) return nullptr;
+    Key key{stat.st_dev,
+            stat.st_ino,
+            stat.st_size,
+            stat.st_mtim.tv_sec,
+            stat.st_mtim.tv_nsec};
+
+    static Mutex mutex;
+    static std::map<Key, std::weak_ptr<FileMapping>> mappings;
+    Mutex::ScopedLock lock(mutex);
+    auto it = mappings.find(key);
+    if (it != mappings.end()) {
+      if (auto mapping = it->second.lock()) return mapping;
+    }
+
+    // Writable, so that ArrayBuffers over the mapping behave like any other.
+    // Writes are copy-on-write and never reach the file.
+    void* data = mmap(nullptr,
+                      stat.st_size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE,
+                      fd,
+                      0);
+    if (data == MAP_FAILED) return nullptr;
+    std::shared_ptr<FileMapping> mapping(
+        new FileMapping(static_cast<uint8_t*>(data), stat.st_size));
+
+    for (auto i = mappings.begin(); i != mappings.end();) {
+      i = i->second.expired() ? mappings.erase(i) : std::next(i);
+    }
+    mappings[key] = mapping;
+    return mapping;
+  }
+
+  FileMapping(const FileMapping&) = delete;
+  FileMapping& operator=(const FileMapping&) = delete;
+  ~FileMapping() { munmap(data_, size_); }
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  using Key = std::tuple<uint64_t, uint64_t, uint64_t, int64_t, int64_t>;
+
+  FileMapping(uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  uint8_t* data_;
+  size_t size_;
+};
+#endif  // _WIN32
+
+// A temporary file that in-memory entries were spilled to. It is removed
+// once the last FdEntry reading from it is gone.
+class SpillFile final {
+ public:
+  explicit SpillFile(std::string path) : path_(std::move(path)) {}
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  ~SpillFile() {
+    uv_fs_t req;
+    uv_fs_unlink(nullptr, &req, path_.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// ============================================================================
+
 // An FdEntry reads from a file descriptor. A check is made before each read
 // to determine if the fd has changed on disc. This is a best-effort check
 // that only looks at file size, creation, and modification times. The stat
@@ -827,24 +967,37 @@ class FdEntry final : public EntryImpl {
     auto buf = std::make_shared<BufferValue>(env->isolate(), path);
     if (uv_fs_stat(nullptr, &req, buf->out(), nullptr) < 0) return nullptr;
 
-    return std::make_unique<FdEntry>(
-        env, std::move(buf), req.statbuf, 0, req.statbuf.st_size);
+    return std::make_unique<FdEntry>(env,
+                                     std::move(buf),
+                                     req.statbuf,
+                                     0,
+                                     req.statbuf.st_size,
+                                     env->options()->experimental_blob_mmap);
   }
 
   FdEntry(Environment* env,
           std::shared_ptr<BufferValue> path_,
           uv_stat_t stat,
           uint64_t start,
-          uint64_t end)
+          uint64_t end,
+          bool use_mmap = false,
+          std::shared_ptr<SpillFile> spill_file = nullptr)
       : env_(env),
         path_(std::move(path_)),
         stat_(stat),
         start_(start),
-        end_(end) {
+        end_(end),
+        use_mmap_(use_mmap),
+        spill_file_(std::move(spill_file)) {
     CHECK_LE(start, end);
   }
 
   std::shared_ptr<DataQueue::Reader> get_reader() override {
+#ifndef _WIN32
+    if (use_mmap_) {
+      if (auto reader = MappedReaderImpl::Create(this)) return reader;
+    }
+#endif
     return ReaderImpl::Create(this);
   }
 
@@ -859,7 +1012,8 @@ class FdEntry final : public EntryImpl {
     CHECK(new_start >= start_);
     CHECK(new_end <= end_);
 
-    return std::make_unique<FdEntry>(env_, path_, stat_, new_start, new_end);
+    return std::make_unique<FdEntry>(
+        env_, path_, stat_, new_start, new_end, use_mmap_, spill_file_);
   }
 
   std::optional<uint64_t> size() const override { return end_ - start_; }
@@ -878,6 +1032,8 @@ class FdEntry final : public EntryImpl {
   uv_stat_t stat_;
   uint64_t start_ = 0;
   uint64_t end_ = 0;
+  bool use_mmap_ = false;
+  std::shared_ptr<SpillFile> spill_file_;
 
   bool is_modified(const uv_stat_t& other) {
     return other.st_size != stat_.st_size ||
@@ -897,6 +1053,92 @@ class FdEntry final : public EntryImpl {
     return entry->is_modified(req.statbuf);
   }
 
+  static bool CheckModified(FdEntry* entry) {
+    uv_fs_t req = uv_fs_t();
+    auto cleanup = OnScopeLeave([&] { uv_fs_req_cleanup(&req); });
+    if (uv_fs_stat(nullptr, &req, entry->path_->out(), nullptr) < 0) {
+      return true;
+    }
+    return entry->is_modified(req.statbuf);
+  }
+
+#ifndef _WIN32
+  // Reads through a FileMapping. Every pull is answered synchronously with a
+  // view of the mapping, which keeps the mapping alive until it is released.
+  // As with ReaderImpl, the file is checked for modifications before each
+  // pull, here by path since the mapping outlives the fd.
+  class MappedReaderImpl final
+      : public DataQueue::Reader,
+        public std::enable_shared_from_this<MappedReaderImpl> {
+   public:
+    static constexpr uint64_t kChunkSize = 1024 * 1024;
+
+    static std::shared_ptr<MappedReaderImpl> Create(FdEntry* entry) {
+      uv_fs_t req;
+      auto cleanup = OnScopeLeave([&] { uv_fs_req_cleanup(&req); });
+      int file =
+          uv_fs_open(nullptr, &req, entry->path_->out(), O_RDONLY, 0, nullptr);
+      if (file < 0) return nullptr;
+      auto close = OnScopeLeave([&] {
+        uv_fs_t close_req;
+        uv_fs_close(nullptr, &close_req, file, nullptr);
+        uv_fs_req_cleanup(&close_req);
+      });
+      if (FdEntry::CheckModified(entry, file)) return nullptr;
+
+      std::shared_ptr<FileMapping> mapping =
+          FileMapping::Get(file, entry->stat_);
+      if (!mapping || mapping->size() < entry->end_) return nullptr;
+      return std::make_shared<MappedReaderImpl>(entry, std::move(mapping));
+    }
+
+    MappedReaderImpl(FdEntry* entry, std::shared_ptr<FileMapping> mapping)
+        : entry_(entry),
+          mapping_(std::move(mapping)),
+          position_(entry->start_) {}
+
+    int Pull(Next next,
+             int options,
+             DataQueue::Vec* data,
+             size_t count,
+             size_t max_count_hint = bob::kMaxCountHint) override {
+      auto self = shared_from_this();
+      if (ended_ || position_ >= entry_->end_) {
+        ended_ = true;
+        std::move(next)(bob::STATUS_EOS, nullptr, 0, [](uint64_t) {});
+        return bob::STATUS_EOS;
+      }
+
+      if (FdEntry::CheckModified(entry_)) {
+        ended_ = true;
+        std::move(next)(UV_EINVAL, nullptr, 0, [](uint64_t) {});
+        return UV_EINVAL;
+      }
+
+      uint64_t length = std::min(entry_->end_ - position_, kChunkSize);
+      DataQueue::Vec vec{mapping_->data() + position_, length};
+      position_ += length;
+      std::move(next)(bob::STATUS_CONTINUE,
+                      &vec,
+                      1,
+                      [mapping = mapping_](uint64_t) mutable {
+                        mapping.reset();
+                      });
+      return bob::STATUS_CONTINUE;
+    }
+
+    SET_NO_MEMORY_INFO()
+    SET_MEMORY_INFO_NAME(FdEntry::MappedReader)
+    SET_SELF_SIZE(MappedReaderImpl)
+
+   private:
+    FdEntry* entry_;
+    std::shared_ptr<FileMapping> mapping_;
+    uint64_t position_;
+    bool ended_ = false;
+  };
+#endif  // _WIN32
+
   class ReaderImpl final : public DataQueue::Reader,
                            public StreamListener,
                            public std::enable_shared_from_this<ReaderImpl> {
@@ -1137,6 +1379,88 @@ std::unique_ptr<DataQueue::Entry> DataQueue::CreateFdEntry(Environment* env,
   return FdEntry::Create(env, path);
 }
 
+std::unique_ptr<DataQueue::Entry> DataQueue::CreateSourceEntry(
+    std::shared_ptr<Reader> source) {
+  return std::make_unique<SourceEntry>(std::move(source));
+}
+
+void DataQueue::MaybeSpillToDisk(Environment* env,
+                                 std::vector<std::unique_ptr<Entry>>* entries,
+                                 uint64_t threshold) {
+  if (threshold == 0) return;
+  uint64_t total = 0;
+  for (const auto& entry : *entries) {
+    if (entry == nullptr) continue;
+    auto data = static_cast<EntryImpl*>(entry.get())->in_memory_data();
+    if (data.has_value()) total += data->len;
+  }
+  if (total <= threshold) return;
+
+  char tmpdir[PATH_MAX_BYTES];
+  size_t tmpdir_size = sizeof(tmpdir);
+  if (uv_os_tmpdir(tmpdir, &tmpdir_size) != 0) return;
+  std::string path_template = std::string(tmpdir) + "/node-blob-XXXXXX";
+
+  uv_fs_t req;
+  int fd = uv_fs_mkstemp(nullptr, &req, path_template.c_str(), nullptr);
+  std::string path = fd >= 0 ? req.path : "";
+  uv_fs_req_cleanup(&req);
+  if (fd < 0) return;
+  // Removes the file again if writing it fails.
+  auto spill_file = std::make_shared<SpillFile>(std::move(path));
+  auto close = OnScopeLeave([fd] {
+    uv_fs_t close_req;
+    uv_fs_close(nullptr, &close_req, fd, nullptr);
+    uv_fs_req_cleanup(&close_req);
+  });
+
+  // Write all of the data before replacing any entry, so that a failure
+  // leaves the entries as they were.
+  int64_t position = 0;
+  for (const auto& entry : *entries) {
+    if (entry == nullptr) continue;
+    auto data = static_cast<EntryImpl*>(entry.get())->in_memory_data();
+    if (!data.has_value()) continue;
+    uint64_t written = 0;
+    while (written < data->len) {
+      uv_buf_t buf = uv_buf_init(
+          reinterpret_cast<char*>(data->base + written),
+          static_cast<unsigned int>(
+              std::min<uint64_t>(data->len - written, 1 << 30)));
+      int result = uv_fs_write(nullptr, &req, fd, &buf, 1, position, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (result <= 0) return;
+      written += result;
+      position += result;
+    }
+  }
+
+  int result = uv_fs_fstat(nullptr, &req, fd, nullptr);
+  uv_stat_t stat = req.statbuf;
+  uv_fs_req_cleanup(&req);
+  if (result < 0) return;
+
+  v8::HandleScope handle_scope(env->isolate());
+  Local<Value> js_path;
+  if (!ToV8Value(env->context(), spill_file->path()).ToLocal(&js_path)) return;
+  auto path_value = std::make_shared<BufferValue>(env->isolate(), js_path);
+
+  uint64_t start = 0;
+  for (auto& entry : *entries) {
+    if (entry == nullptr) continue;
+    auto data = static_cast<EntryImpl*>(entry.get())->in_memory_data();
+    if (!data.has_value()) continue;
+    entry = std::make_unique<FdEntry>(env,
+                                      path_value,
+                                      stat,
+                                      start,
+                                      start + data->len,
+                                      env->options()->experimental_blob_mmap,
+                                      spill_file);
+    start += data->len;
+  }
+}
+
 void DataQueue::Initialize(Environment* env, v8::Local<v8::Object> target) {
   // Nothing to do here currently.
 }
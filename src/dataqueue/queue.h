@@ -224,6 +224,22 @@ class DataQueue : public MemoryRetainer {
   static std::unique_ptr<Entry> CreateFdEntry(Environment* env,
                                               v8::Local<v8::Value> path);
 
+  // Creates a non-idempotent Entry of unknown size whose data is pulled
+  // from |source|. This lets other parts of the runtime, such as zlib,
+  // put their own transforms into a DataQueue. The source is handed to
+  // the first reader of the entry only.
+  static std::unique_ptr<Entry> CreateSourceEntry(
+      std::shared_ptr<Reader> source);
+
+  // If the in-memory entries of |entries| hold more than |threshold| bytes,
+  // moves their bytes into a temporary file and replaces them with entries
+  // that read the file back. The file is removed once no entry uses it.
+  // |entries| is left as it is if |threshold| is 0 or the file cannot be
+  // written.
+  static void MaybeSpillToDisk(Environment* env,
+                               std::vector<std::unique_ptr<Entry>>* entries,
+                               uint64_t threshold);
+
   // Creates a Reader for the given queue. If the queue is idempotent,
   // any number of readers can be created, all of which are guaranteed
   // to provide the same data. Otherwise, only a single reader is
@@ -1,21 +1,33 @@
 #include "encoding_binding.h"
 #include "ada.h"
+#include "base_object-inl.h"
 #include "env-inl.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
+#include "nbytes.h"
 #include "simdutf.h"
 #include "string_bytes.h"
+#include "util-inl.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <optional>
 
 namespace node {
 namespace encoding_binding {
 
 using v8::ArrayBuffer;
 using v8::BackingStore;
+using v8::CFunction;
 using v8::Context;
+using v8::FastApiCallbackOptions;
+using v8::FastApiTypedArray;
+using v8::FastOneByteString;
 using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
@@ -82,6 +94,91 @@ void BindingData::Deserialize(Local<Context> context,
   CHECK_NOT_NULL(binding);
 }
 
+namespace {
+// Returns how many characters of the Latin-1 |data| fit into |capacity|
+// bytes once they are encoded as UTF-8.
+size_t Latin1PrefixForUtf8(const char* data, size_t length, size_t capacity) {
+  size_t i = 0;
+  for (size_t size = 0; i < length; i++) {
+    size += static_cast<uint8_t>(data[i]) < 0x80 ? 1 : 2;
+    if (size > capacity) break;
+  }
+  return i;
+}
+
+// Returns how many code units of the well-formed UTF-16 |data| fit into
+// |capacity| bytes once they are encoded as UTF-8, without splitting
+// surrogate pairs.
+size_t Utf16PrefixForUtf8(const char16_t* data,
+                          size_t length,
+                          size_t capacity) {
+  size_t i = 0;
+  for (size_t size = 0; i < length;) {
+    char16_t c = data[i];
+    size_t units = 1;
+    if (c < 0x80) {
+      size += 1;
+    } else if (c < 0x800) {
+      size += 2;
+    } else if (c >= 0xD800 && c < 0xDC00) {
+      size += 4;
+      units = 2;
+    } else {
+      size += 3;
+    }
+    if (size > capacity) break;
+    i += units;
+  }
+  return i;
+}
+
+// Transcodes as much of |source| as fits into |dest| with simdutf, reading
+// the Latin-1 or UTF-16 contents of the string in place instead of going
+// through String::WriteUtf8(). Returns false, without writing anything, for
+// two-byte strings with lone surrogates, which have to be replaced with
+// U+FFFD by the caller.
+bool EncodeIntoUtf8(Isolate* isolate,
+                    Local<String> source,
+                    char* dest,
+                    size_t dest_length,
+                    size_t* read,
+                    size_t* written) {
+  String::ValueView view(isolate, source);
+  size_t length = view.length();
+  if (view.is_one_byte()) {
+    const char* data = reinterpret_cast<const char*>(view.data8());
+    if (simdutf::utf8_length_from_latin1(data, length) > dest_length) {
+      length = Latin1PrefixForUtf8(data, length, dest_length);
+    }
+    *read = length;
+    *written = simdutf::convert_latin1_to_utf8(data, length, dest);
+    return true;
+  }
+
+  const char16_t* data = reinterpret_cast<const char16_t*>(view.data16());
+  if (!simdutf::validate_utf16(data, length)) return false;
+  if (simdutf::utf8_length_from_utf16(data, length) > dest_length) {
+    length = Utf16PrefixForUtf8(data, length, dest_length);
+  }
+  *read = length;
+  *written = simdutf::convert_utf16_to_utf8(data, length, dest);
+  return true;
+}
+
+// Returns the length of |source| in UTF-8, or nothing for two-byte strings
+// with lone surrogates.
+std::optional<size_t> Utf8Length(Isolate* isolate, Local<String> source) {
+  String::ValueView view(isolate, source);
+  if (view.is_one_byte()) {
+    return simdutf::utf8_length_from_latin1(
+        reinterpret_cast<const char*>(view.data8()), view.length());
+  }
+  const char16_t* data = reinterpret_cast<const char16_t*>(view.data16());
+  if (!simdutf::validate_utf16(data, view.length())) return std::nullopt;
+  return simdutf::utf8_length_from_utf16(data, view.length());
+}
+}  // anonymous namespace
+
 void BindingData::EncodeInto(const FunctionCallbackInfo<Value>& args) {
   CHECK_GE(args.Length(), 2);
   CHECK(args[0]->IsString());
@@ -98,18 +195,50 @@ void BindingData::EncodeInto(const FunctionCallbackInfo<Value>& args) {
   char* write_result = static_cast<char*>(buf->Data()) + dest->ByteOffset();
   size_t dest_length = dest->ByteLength();
 
+  size_t read;
+  size_t written;
+  if (EncodeIntoUtf8(
+          isolate, source, write_result, dest_length, &read, &written)) {
+    return binding_data->SetEncodeIntoResults(read, written);
+  }
+
   int nchars;
-  int written = source->WriteUtf8(
+  written = source->WriteUtf8(
       isolate,
       write_result,
       dest_length,
       &nchars,
       String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
 
-  binding_data->encode_into_results_buffer_[0] = nchars;
-  binding_data->encode_into_results_buffer_[1] = written;
+  binding_data->SetEncodeIntoResults(nchars, written);
 }
 
+// V8 only takes this path for sequential one-byte strings, which are
+// Latin-1, so short strings skip the slow call entirely.
+void BindingData::FastEncodeInto(
+    Local<Value> receiver,
+    const FastOneByteString& source,
+    const FastApiTypedArray<uint8_t>& dest,
+    // NOLINTNEXTLINE(runtime/references) This is V8 api.
+    FastApiCallbackOptions& options) {
+  uint8_t* dest_data;
+  CHECK(dest.getStorageIfAligned(&dest_data));
+  char* write_result = reinterpret_cast<char*>(dest_data);
+  size_t dest_length = dest.length();
+
+  size_t length = source.length;
+  if (simdutf::utf8_length_from_latin1(source.data, length) > dest_length) {
+    length = Latin1PrefixForUtf8(source.data, length, dest_length);
+  }
+  size_t written =
+      simdutf::convert_latin1_to_utf8(source.data, length, write_result);
+
+  Realm* realm = Realm::GetCurrent(options.isolate);
+  realm->GetBindingData<BindingData>()->SetEncodeIntoResults(length, written);
+}
+
+static CFunction fast_encode_into(CFunction::Make(BindingData::FastEncodeInto));
+
 // Encode a single string to a UTF-8 Uint8Array (not Buffer).
 // Used in TextEncoder.prototype.encode.
 void BindingData::EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
@@ -119,7 +248,9 @@ void BindingData::EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsString());
 
   Local<String> str = args[0].As<String>();
-  size_t length = str->Utf8Length(isolate);
+  std::optional<size_t> utf8_length = Utf8Length(isolate, str);
+  size_t length =
+      utf8_length.has_value() ? *utf8_length : str->Utf8Length(isolate);
 
   Local<ArrayBuffer> ab;
   {
@@ -129,11 +260,19 @@ void BindingData::EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
 
     CHECK(bs);
 
-    str->WriteUtf8(isolate,
-                   static_cast<char*>(bs->Data()),
-                   -1,  // We are certain that `data` is sufficiently large
-                   nullptr,
-                   String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+    char* data = static_cast<char*>(bs->Data());
+    size_t read;
+    size_t written;
+    // The allocation may have moved the string, so it is looked at again.
+    if (!utf8_length.has_value() ||
+        !EncodeIntoUtf8(isolate, str, data, length, &read, &written)) {
+      str->WriteUtf8(
+          isolate,
+          data,
+          -1,  // We are certain that `data` is sufficiently large
+          nullptr,
+          String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+    }
 
     ab = ArrayBuffer::New(isolate, std::move(bs));
   }
@@ -218,14 +357,336 @@ void BindingData::ToUnicode(const v8::FunctionCallbackInfo<v8::Value>& args) {
       String::NewFromUtf8(env->isolate(), out.c_str()).ToLocalChecked());
 }
 
+void BindingData::SetEncodeIntoResults(uint32_t read, uint32_t written) {
+  encode_into_results_buffer_[0] = read;
+  encode_into_results_buffer_[1] = written;
+}
+
+namespace {
+// The characters that simdutf skips in base64 input.
+inline bool IsBase64Whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+size_t CountBase64Whitespace(const char* data, size_t length) {
+  size_t count = 0;
+  for (size_t i = 0; i < length; i++) count += IsBase64Whitespace(data[i]);
+  return count;
+}
+
+// Returns the index just past the count-th character that is not
+// whitespace, or length.
+size_t SkipBase64Characters(const char* data, size_t length, size_t count) {
+  size_t i = 0;
+  for (; i < length && count > 0; i++) {
+    if (!IsBase64Whitespace(data[i])) count--;
+  }
+  return i;
+}
+
+inline simdutf::base64_options Base64Options(enum encoding encoding) {
+  return encoding == BASE64URL ? simdutf::base64_url
+                               : simdutf::base64_default;
+}
+}  // anonymous namespace
+
+StreamingCodec::StreamingCodec(Environment* env,
+                               Local<Object> object,
+                               enum encoding encoding,
+                               bool decode)
+    : BaseObject(env, object), codec_(encoding, decode) {
+  MakeWeak();
+}
+
+void StreamingCodec::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsInt32());
+  enum encoding encoding =
+      static_cast<enum encoding>(args[0].As<v8::Int32>()->Value());
+  CHECK(encoding == BASE64 || encoding == BASE64URL || encoding == HEX);
+  new StreamingCodec(env, args.This(), encoding, args[1]->IsTrue());
+}
+
+void StreamingCodec::Update(const FunctionCallbackInfo<Value>& args) {
+  Realm* realm = Realm::GetCurrent(args);
+  StreamingCodec* codec;
+  ASSIGN_OR_RETURN_UNWRAP(&codec, args.This());
+  CHECK(args[0]->IsArrayBufferView());
+  CHECK(args[1]->IsUint8Array());
+
+  ArrayBufferViewContents<char> input(args[0]);
+  Local<Uint8Array> dest = args[1].As<Uint8Array>();
+  char* out = static_cast<char*>(dest->Buffer()->Data()) + dest->ByteOffset();
+  // The results are reported as 32-bit values.
+  constexpr size_t kMaxLength = std::numeric_limits<uint32_t>::max();
+  const size_t in_length = std::min(input.length(), kMaxLength);
+  const size_t out_length = std::min(dest->ByteLength(), kMaxLength);
+  const bool final = args[2]->IsTrue() && in_length == input.length();
+
+  size_t read = 0;
+  size_t written = 0;
+  if (!codec->codec_.Update(input.data(), in_length, out, out_length,
+                            final, &read, &written)) {
+    return THROW_ERR_ENCODING_INVALID_ENCODED_DATA(
+        realm->isolate(),
+        codec->codec_.encoding() == HEX
+            ? "The encoded data was not valid for encoding hex"
+            : "The encoded data was not valid for encoding base64");
+  }
+  realm->GetBindingData<BindingData>()->SetEncodeIntoResults(
+      static_cast<uint32_t>(read), static_cast<uint32_t>(written));
+}
+
+void StreamingCodec::MaxOutputLength(const FunctionCallbackInfo<Value>& args) {
+  StreamingCodec* codec;
+  ASSIGN_OR_RETURN_UNWRAP(&codec, args.This());
+  CHECK(args[0]->IsNumber());
+  const int64_t length = args[0].As<Integer>()->Value();
+  CHECK_GE(length, 0);
+  args.GetReturnValue().Set(static_cast<double>(
+      codec->codec_.MaxOutputLength(static_cast<size_t>(length),
+                                    args[1]->IsTrue())));
+}
+
+void StreamingCodec::Reset(const FunctionCallbackInfo<Value>& args) {
+  StreamingCodec* codec;
+  ASSIGN_OR_RETURN_UNWRAP(&codec, args.This());
+  codec->codec_.Reset();
+}
+
+bool ChunkedCodec::Update(const char* in, size_t in_length,
+                          char* out, size_t out_length,
+                          bool final, size_t* read, size_t* written) {
+  *read = 0;
+  *written = 0;
+  bool ok;
+  if (!decode_) {
+    if (encoding_ == HEX) {
+      *read = std::min(in_length, out_length / 2);
+      *written = nbytes::HexEncode(in, *read, out, *read * 2);
+      ok = true;
+    } else {
+      ok = EncodeBase64(in, in_length, out, out_length, final, read, written);
+    }
+  } else if (encoding_ == HEX) {
+    ok = DecodeHex(in, in_length, out, out_length, final, read, written);
+  } else {
+    ok = DecodeBase64(in, in_length, out, out_length, final, read, written);
+  }
+  if (!ok) Reset();
+  return ok;
+}
+
+size_t ChunkedCodec::MaxOutputLength(size_t in_length, bool final) const {
+  const size_t total = carry_length_ + in_length;
+  if (!decode_) {
+    if (encoding_ == HEX) return in_length * 2;
+    return final ? simdutf::base64_length_from_binary(
+                       total, Base64Options(encoding_))
+                 : total / 3 * 4;
+  }
+  if (encoding_ == HEX) return total / 2;
+  // Whitespace is counted as if it were data.
+  return (final ? total + 3 : total) / 4 * 3;
+}
+
+bool ChunkedCodec::EncodeBase64(const char* in, size_t in_length,
+                                char* out, size_t out_length,
+                                bool final, size_t* read,
+                                size_t* written) {
+  const simdutf::base64_options options = Base64Options(encoding_);
+  size_t r = 0;
+  size_t w = 0;
+
+  // A group started in an earlier chunk is completed, and then written out
+  // when there is room for it.
+  if (carry_length_ > 0) {
+    while (carry_length_ < 3 && r < in_length)
+      carry_[carry_length_++] = in[r++];
+    if (carry_length_ == 3 && out_length >= 4) {
+      w += simdutf::binary_to_base64(carry_, 3, out, options);
+      carry_length_ = 0;
+    }
+  }
+
+  if (carry_length_ == 0) {
+    const size_t groups = std::min((in_length - r) / 3, (out_length - w) / 4);
+    if (groups > 0) {
+      w += simdutf::binary_to_base64(in + r, groups * 3, out + w, options);
+      r += groups * 3;
+    }
+    if (in_length - r < 3) {
+      while (r < in_length) carry_[carry_length_++] = in[r++];
+    }
+  }
+
+  if (final && r == in_length && carry_length_ > 0 &&
+      out_length - w >=
+          simdutf::base64_length_from_binary(carry_length_, options)) {
+    w += simdutf::binary_to_base64(carry_, carry_length_, out + w, options);
+    carry_length_ = 0;
+  }
+
+  *read = r;
+  *written = w;
+  return true;
+}
+
+bool ChunkedCodec::DecodeBase64Carry(char* out,
+                                     size_t out_length,
+                                     size_t* written) {
+  if (finished_) return false;
+  size_t length = out_length;
+  simdutf::result result = simdutf::base64_to_binary_safe(
+      carry_, carry_length_, out, length, Base64Options(encoding_));
+  if (result.error != simdutf::error_code::SUCCESS) return false;
+  finished_ = carry_[carry_length_ - 1] == '=';
+  carry_length_ = 0;
+  *written += length;
+  return true;
+}
+
+bool ChunkedCodec::DecodeBase64Groups(const char* in, size_t in_length,
+                                      bool has_whitespace,
+                                      char* out, size_t out_length,
+                                      size_t* written) {
+  const simdutf::base64_options options = Base64Options(encoding_);
+  simdutf::result result;
+  size_t length = out_length;
+  if (!has_whitespace) {
+    result = simdutf::base64_to_binary_safe(
+        in, in_length, out, length, options);
+  } else if (simdutf::maximal_binary_length_from_base64(in, in_length) <=
+             out_length) {
+    result = simdutf::base64_to_binary(in, in_length, out, options);
+    length = result.count;
+  } else {
+    // base64_to_binary_safe() can reject whitespace in the last group when
+    // the output is exactly large enough, so the whitespace is removed first.
+    MaybeStackBuffer<char> characters(in_length);
+    size_t count = 0;
+    for (size_t i = 0; i < in_length; i++) {
+      if (!IsBase64Whitespace(in[i])) characters[count++] = in[i];
+    }
+    result = simdutf::base64_to_binary_safe(
+        *characters, count, out, length, options);
+  }
+  if (result.error != simdutf::error_code::SUCCESS) return false;
+  *written += length;
+  return true;
+}
+
+bool ChunkedCodec::DecodeBase64(const char* in, size_t in_length,
+                                char* out, size_t out_length,
+                                bool final, size_t* read,
+                                size_t* written) {
+  size_t r = 0;
+  size_t w = 0;
+
+  // A group started in an earlier chunk is completed, and then decoded when
+  // there is room for it.
+  while (carry_length_ > 0 && carry_length_ < 4 && r < in_length) {
+    const char c = in[r++];
+    if (!IsBase64Whitespace(c)) carry_[carry_length_++] = c;
+  }
+  if (carry_length_ == 4 && out_length >= 3 &&
+      !DecodeBase64Carry(out, out_length, &w)) {
+    return false;
+  }
+
+  if (carry_length_ == 0 && r < in_length) {
+    const size_t whitespace = CountBase64Whitespace(in + r, in_length - r);
+    const size_t characters = in_length - r - whitespace;
+    if (finished_ && characters > 0) return false;
+    const size_t groups = std::min(characters / 4, (out_length - w) / 3);
+    const size_t end =
+        whitespace == 0
+            ? r + groups * 4
+            : r + SkipBase64Characters(in + r, in_length - r, groups * 4);
+    if (end > r) {
+      if (!DecodeBase64Groups(in + r, end - r, whitespace > 0,
+                              out + w, out_length - w, &w)) {
+        return false;
+      }
+      // The last character that is not whitespace.
+      size_t last = end;
+      while (IsBase64Whitespace(in[last - 1])) last--;
+      finished_ = in[last - 1] == '=';
+      r = end;
+    }
+    if (groups == characters / 4) {
+      // What is left is either whitespace or a partial group.
+      while (r < in_length) {
+        const char c = in[r++];
+        if (IsBase64Whitespace(c)) continue;
+        if (finished_) return false;
+        carry_[carry_length_++] = c;
+      }
+    }
+  }
+
+  if (final && r == in_length && carry_length_ > 0 &&
+      out_length - w >= carry_length_ * 3 / 4 &&
+      !DecodeBase64Carry(out + w, out_length - w, &w)) {
+    return false;
+  }
+
+  *read = r;
+  *written = w;
+  return true;
+}
+
+bool ChunkedCodec::DecodeHex(const char* in, size_t in_length,
+                             char* out, size_t out_length,
+                             bool final, size_t* read, size_t* written) {
+  auto decode_pair = [](char high, char low, char* out) {
+    const int8_t a = nbytes::unhex_table[static_cast<uint8_t>(high)];
+    const int8_t b = nbytes::unhex_table[static_cast<uint8_t>(low)];
+    if (a < 0 || b < 0) return false;
+    *out = static_cast<char>(a * 16 + b);
+    return true;
+  };
+
+  size_t r = 0;
+  size_t w = 0;
+  if (carry_length_ == 1 && r < in_length && out_length > 0) {
+    if (!decode_pair(carry_[0], in[r++], out + w++)) return false;
+    carry_length_ = 0;
+  }
+  if (carry_length_ == 0) {
+    const size_t pairs = std::min((in_length - r) / 2, out_length - w);
+    for (size_t i = 0; i < pairs; i++, r += 2) {
+      if (!decode_pair(in[r], in[r + 1], out + w++)) return false;
+    }
+    if (in_length - r == 1) carry_[carry_length_++] = in[r++];
+  }
+  // Hex input with an odd number of characters is an error.
+  if (final && r == in_length && carry_length_ > 0) return false;
+
+  *read = r;
+  *written = w;
+  return true;
+}
+
 void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
                                              Local<ObjectTemplate> target) {
   Isolate* isolate = isolate_data->isolate();
-  SetMethod(isolate, target, "encodeInto", EncodeInto);
+  SetFastMethod(isolate, target, "encodeInto", EncodeInto, &fast_encode_into);
   SetMethodNoSideEffect(isolate, target, "encodeUtf8String", EncodeUtf8String);
   SetMethodNoSideEffect(isolate, target, "decodeUTF8", DecodeUTF8);
   SetMethodNoSideEffect(isolate, target, "toASCII", ToASCII);
   SetMethodNoSideEffect(isolate, target, "toUnicode", ToUnicode);
+
+  Local<FunctionTemplate> codec =
+      NewFunctionTemplate(isolate, StreamingCodec::New);
+  codec->InstanceTemplate()->SetInternalFieldCount(
+      StreamingCodec::kInternalFieldCount);
+  SetProtoMethod(isolate, codec, "update", StreamingCodec::Update);
+  SetProtoMethodNoSideEffect(
+      isolate, codec, "maxOutputLength", StreamingCodec::MaxOutputLength);
+  SetProtoMethod(isolate, codec, "reset", StreamingCodec::Reset);
+  SetConstructorFunction(isolate, target, "StreamingCodec", codec);
 }
 
 void BindingData::CreatePerContextProperties(Local<Object> target,
@@ -239,10 +700,16 @@ void BindingData::CreatePerContextProperties(Local<Object> target,
 void BindingData::RegisterTimerExternalReferences(
     ExternalReferenceRegistry* registry) {
   registry->Register(EncodeInto);
+  registry->Register(FastEncodeInto);
+  registry->Register(fast_encode_into.GetTypeInfo());
   registry->Register(EncodeUtf8String);
   registry->Register(DecodeUTF8);
   registry->Register(ToASCII);
   registry->Register(ToUnicode);
+  registry->Register(StreamingCodec::New);
+  registry->Register(StreamingCodec::Update);
+  registry->Register(StreamingCodec::MaxOutputLength);
+  registry->Register(StreamingCodec::Reset);
 }
 
 }  // namespace encoding_binding
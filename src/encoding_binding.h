@@ -5,6 +5,7 @@
 
 #include <cinttypes>
 #include "aliased_buffer.h"
+#include "base_object.h"
 #include "node_snapshotable.h"
 #include "v8-fast-api-calls.h"
 
@@ -29,6 +30,12 @@ class BindingData : public SnapshotableObject {
   SET_MEMORY_INFO_NAME(BindingData)
 
   static void EncodeInto(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void FastEncodeInto(
+      v8::Local<v8::Value> receiver,
+      const v8::FastOneByteString& source,
+      const v8::FastApiTypedArray<uint8_t>& dest,
+      // NOLINTNEXTLINE(runtime/references) This is V8 api.
+      v8::FastApiCallbackOptions& options);
   static void EncodeUtf8String(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void DecodeUTF8(const v8::FunctionCallbackInfo<v8::Value>& args);
 
@@ -44,12 +51,91 @@ class BindingData : public SnapshotableObject {
   static void RegisterTimerExternalReferences(
       ExternalReferenceRegistry* registry);
 
+  void SetEncodeIntoResults(uint32_t read, uint32_t written);
+
  private:
   static constexpr size_t kEncodeIntoResultsLength = 2;
   AliasedUint32Array encode_into_results_buffer_;
   InternalFieldInfo* internal_field_info_ = nullptr;
 };
 
+// Converts binary data to base64, base64url or hex and back one chunk at a
+// time, writing into buffers provided by the caller. Input that does not
+// make up a complete group yet (up to two bytes for base64 encoding, three
+// characters for base64 decoding, one character for hex decoding) is kept
+// until the next chunk.
+class ChunkedCodec {
+ public:
+  ChunkedCodec(enum encoding encoding, bool decode)
+      : encoding_(encoding), decode_(decode) {}
+
+  // Converts as much of |in| as fits into |out| and stores the number of
+  // bytes read and written. With |final| set, everything that is left is
+  // flushed if |out| has room for it. Returns false, and resets the codec,
+  // if the input is not validly encoded.
+  bool Update(const char* in, size_t in_length,
+              char* out, size_t out_length,
+              bool final, size_t* read, size_t* written);
+  size_t MaxOutputLength(size_t in_length, bool final) const;
+  void Reset() {
+    carry_length_ = 0;
+    finished_ = false;
+  }
+
+  enum encoding encoding() const { return encoding_; }
+
+ private:
+  // All of these return false if the input is not validly encoded.
+  bool EncodeBase64(const char* in, size_t in_length,
+                    char* out, size_t out_length,
+                    bool final, size_t* read, size_t* written);
+  bool DecodeBase64(const char* in, size_t in_length,
+                    char* out, size_t out_length,
+                    bool final, size_t* read, size_t* written);
+  bool DecodeHex(const char* in, size_t in_length,
+                 char* out, size_t out_length,
+                 bool final, size_t* read, size_t* written);
+  bool DecodeBase64Carry(char* out, size_t out_length, size_t* written);
+  bool DecodeBase64Groups(const char* in, size_t in_length,
+                          bool has_whitespace,
+                          char* out, size_t out_length,
+                          size_t* written);
+
+  const enum encoding encoding_;
+  const bool decode_;
+  char carry_[4];
+  size_t carry_length_ = 0;
+  // Set once base64 padding has been decoded, after which only whitespace
+  // may follow.
+  bool finished_ = false;
+};
+
+// Exposes a ChunkedCodec to JS.
+class StreamingCodec : public BaseObject {
+ public:
+  StreamingCodec(Environment* env,
+                 v8::Local<v8::Object> object,
+                 enum encoding encoding,
+                 bool decode);
+
+  // new StreamingCodec(encoding, decode)
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // update(input, output, final) stores the number of bytes read and written
+  // in encodeIntoResults. With final set, everything that is left is flushed
+  // if output has room for it.
+  static void Update(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // maxOutputLength(inputLength, final)
+  static void MaxOutputLength(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Reset(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(StreamingCodec)
+  SET_SELF_SIZE(StreamingCodec)
+
+ private:
+  ChunkedCodec codec_;
+};
+
 }  // namespace encoding_binding
 
 }  // namespace node
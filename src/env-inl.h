@@ -40,6 +40,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
 #include <utility>
 
 namespace node {
@@ -91,6 +92,10 @@ inline worker::Worker* IsolateData::worker_context() const {
   return worker_context_;
 }
 
+inline contextify::ScriptCodeCache* IsolateData::script_code_cache() const {
+  return script_code_cache_.get();
+}
+
 inline v8::Local<v8::String> IsolateData::async_wrap_provider(int index) const {
   return async_wrap_providers_[index].Get(isolate_);
 }
@@ -257,6 +262,9 @@ inline void Environment::CloseHandle(T* handle, OnCloseCallback callback) {
   handle->data = new CloseData { this, callback, handle->data };
   uv_close(reinterpret_cast<uv_handle_t*>(handle), [](uv_handle_t* handle) {
     std::unique_ptr<CloseData> data { static_cast<CloseData*>(handle->data) };
+    performance::LoopPhaseTimer::Scope phase_scope(
+        data->env->loop_phase_timer(),
+        performance::NODE_PERFORMANCE_LOOP_PHASE_CLOSE);
     data->env->handle_cleanup_waiting_--;
     handle->data = data->original_data;
     data->callback(reinterpret_cast<T*>(handle));
@@ -368,6 +376,10 @@ inline AliasedUint32Array& Environment::should_abort_on_uncaught_toggle() {
   return should_abort_on_uncaught_toggle_;
 }
 
+inline AliasedFloat64Array& Environment::async_context_frame_counters() {
+  return async_context_frame_counters_;
+}
+
 inline AliasedInt32Array& Environment::stream_base_state() {
   return stream_base_state_;
 }
@@ -465,6 +477,18 @@ inline bool Environment::use_compile_cache() const {
   return compile_cache_handler_.get() != nullptr;
 }
 
+inline modules::PackageConfigCache* Environment::package_config_cache() {
+  return package_config_cache_.get();
+}
+
+inline RequestObjectPool* Environment::write_wrap_pool() {
+  return &write_wrap_pool_;
+}
+
+inline RequestObjectPool* Environment::fsreqpromise_pool() {
+  return &fsreqpromise_pool_;
+}
+
 #if HAVE_INSPECTOR
 inline void Environment::set_coverage_directory(const char* dir) {
   coverage_directory_ = std::string(dir);
@@ -495,6 +519,27 @@ Environment::cpu_profiler_connection() {
   return cpu_profiler_connection_.get();
 }
 
+inline void Environment::set_continuous_cpu_profiler(
+    std::unique_ptr<profiler::ContinuousCpuProfiler> profiler) {
+  CHECK_NULL(continuous_cpu_profiler_);
+  std::swap(continuous_cpu_profiler_, profiler);
+}
+
+inline profiler::ContinuousCpuProfiler*
+Environment::continuous_cpu_profiler() {
+  return continuous_cpu_profiler_.get();
+}
+
+inline void Environment::set_cpu_profile_capture(
+    std::unique_ptr<profiler::CpuProfileCapture> capture) {
+  CHECK_NULL(cpu_profile_capture_);
+  std::swap(cpu_profile_capture_, capture);
+}
+
+inline profiler::CpuProfileCapture* Environment::cpu_profile_capture() {
+  return cpu_profile_capture_.get();
+}
+
 inline void Environment::set_cpu_prof_interval(uint64_t interval) {
   cpu_prof_interval_ = interval;
 }
@@ -530,6 +575,17 @@ Environment::heap_profiler_connection() {
   return heap_profiler_connection_.get();
 }
 
+inline void Environment::set_continuous_heap_profiler(
+    std::unique_ptr<profiler::ContinuousHeapProfiler> profiler) {
+  CHECK_NULL(continuous_heap_profiler_);
+  std::swap(continuous_heap_profiler_, profiler);
+}
+
+inline profiler::ContinuousHeapProfiler*
+Environment::continuous_heap_profiler() {
+  return continuous_heap_profiler_.get();
+}
+
 inline void Environment::set_heap_prof_name(const std::string& name) {
   heap_prof_name_ = name;
 }
@@ -746,6 +802,10 @@ inline performance::PerformanceState* Environment::performance_state() {
   return performance_state_.get();
 }
 
+inline performance::LoopPhaseTimer* Environment::loop_phase_timer() {
+  return &loop_phase_timer_;
+}
+
 inline IsolateData* Environment::isolate_data() const {
   return isolate_data_;
 }
@@ -800,6 +860,18 @@ void Environment::RemoveCleanupHook(CleanupQueue::Callback fn, void* arg) {
   cleanup_queue_.Remove(fn, arg);
 }
 
+void Environment::AddMemoryPressureHook(MemoryPressureHook hook, void* arg) {
+  memory_pressure_hooks_.emplace_back(hook, arg);
+}
+
+void Environment::RemoveMemoryPressureHook(MemoryPressureHook hook,
+                                           void* arg) {
+  auto it = std::find(memory_pressure_hooks_.begin(),
+                      memory_pressure_hooks_.end(),
+                      std::make_pair(hook, arg));
+  if (it != memory_pressure_hooks_.end()) memory_pressure_hooks_.erase(it);
+}
+
 void Environment::set_process_exit_handler(
     std::function<void(Environment*, ExitCode)>&& handler) {
   process_exit_handler_ = std::move(handler);
@@ -1,4 +1,5 @@
 #include "env.h"
+#include "async_context_frame.h"
 #include "async_wrap.h"
 #include "base_object-inl.h"
 #include "debug_utils-inl.h"
@@ -9,7 +10,9 @@
 #include "node_context_data.h"
 #include "node_contextify.h"
 #include "node_errors.h"
+#include "node_file.h"
 #include "node_internals.h"
+#include "node_modules.h"
 #include "node_options-inl.h"
 #include "node_process-inl.h"
 #include "node_shadow_realm.h"
@@ -18,6 +21,7 @@
 #include "node_worker.h"
 #include "req_wrap-inl.h"
 #include "stream_base.h"
+#include "stream_wrap.h"
 #include "tracing/agent.h"
 #include "tracing/traced_value.h"
 #include "util-inl.h"
@@ -608,6 +612,11 @@ IsolateData::IsolateData(Isolate* isolate,
   } else {
     DeserializeProperties(&snapshot_data->isolate_data_info);
   }
+
+  if (options_->vm_code_cache_size > 0) {
+    script_code_cache_ = std::make_unique<contextify::ScriptCodeCache>(
+        options_->vm_code_cache_size);
+  }
 }
 
 IsolateData::~IsolateData() {
@@ -639,6 +648,9 @@ void IsolateData::MemoryInfo(MemoryTracker* tracker) const {
   if (node_allocator_ != nullptr) {
     tracker->TrackFieldWithSize(
         "node_allocator", sizeof(*node_allocator_), "NodeArrayBufferAllocator");
+    tracker->TrackFieldWithSize("node_allocator_pool",
+                                node_allocator_->GetPoolStats().cached_bytes,
+                                "ArrayBufferPool");
   }
   tracker->TrackFieldWithSize(
       "platform", sizeof(*platform_), "MultiIsolatePlatform");
@@ -743,10 +755,28 @@ void Environment::add_refs(int64_t diff) {
     uv_ref(reinterpret_cast<uv_handle_t*>(&task_queues_async_));
 }
 
+// Returns the index into managed_buffer_pool_ for buffers of exactly |size|
+// bytes, or -1 if buffers of that size are not pooled.
+static int ManagedBufferSizeClass(size_t size, size_t min_shift,
+                                  size_t max_shift) {
+  for (size_t shift = min_shift; shift <= max_shift; shift++) {
+    if (size == (size_t{1} << shift))
+      return static_cast<int>(shift - min_shift);
+  }
+  return -1;
+}
+
 uv_buf_t Environment::allocate_managed_buffer(const size_t suggested_size) {
-  NoArrayBufferZeroFillScope no_zero_fill_scope(isolate_data());
-  std::unique_ptr<v8::BackingStore> bs =
-      v8::ArrayBuffer::NewBackingStore(isolate(), suggested_size);
+  std::unique_ptr<v8::BackingStore> bs;
+  int size_class = ManagedBufferSizeClass(
+      suggested_size, kMinPooledBufferShift, kMaxPooledBufferShift);
+  if (size_class >= 0 && !managed_buffer_pool_[size_class].empty()) {
+    bs = std::move(managed_buffer_pool_[size_class].back());
+    managed_buffer_pool_[size_class].pop_back();
+  } else {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(isolate_data());
+    bs = v8::ArrayBuffer::NewBackingStore(isolate(), suggested_size);
+  }
   uv_buf_t buf = uv_buf_init(static_cast<char*>(bs->Data()), bs->ByteLength());
   released_allocated_buffers_.emplace(buf.base, std::move(bs));
   return buf;
@@ -764,6 +794,27 @@ std::unique_ptr<v8::BackingStore> Environment::release_managed_buffer(
   return bs;
 }
 
+void Environment::recycle_managed_buffer(
+    std::unique_ptr<v8::BackingStore> bs) {
+  if (!bs) return;
+  int size_class = ManagedBufferSizeClass(
+      bs->ByteLength(), kMinPooledBufferShift, kMaxPooledBufferShift);
+  if (size_class < 0 ||
+      managed_buffer_pool_[size_class].size() >= kMaxPooledBuffersPerClass) {
+    return;
+  }
+  managed_buffer_pool_[size_class].emplace_back(std::move(bs));
+}
+
+void Environment::NotifyMemoryPressure(v8::MemoryPressureLevel level) {
+  if (level != v8::MemoryPressureLevel::kNone) {
+    // Pooled read buffers are cheap to allocate again.
+    for (auto& pool : managed_buffer_pool_) pool.clear();
+    for (const auto& [hook, arg] : memory_pressure_hooks_) hook(arg);
+  }
+  isolate()->MemoryPressureNotification(level);
+}
+
 std::string Environment::GetExecPath(const std::vector<std::string>& argv) {
   char exec_path_buf[2 * PATH_MAX];
   size_t exec_path_len = sizeof(exec_path_buf);
@@ -816,6 +867,10 @@ Environment::Environment(IsolateData* isolate_data,
       stream_base_state_(isolate_,
                          StreamBase::kNumStreamBaseStateFields,
                          MAYBE_FIELD_PTR(env_info, stream_base_state)),
+      async_context_frame_counters_(
+          isolate_,
+          async_context_frame::kCounterFieldsCount,
+          MAYBE_FIELD_PTR(env_info, async_context_frame_counters)),
       time_origin_(performance::performance_process_start),
       time_origin_timestamp_(performance::performance_process_start_timestamp),
       environment_start_(PERFORMANCE_NOW()),
@@ -980,6 +1035,11 @@ void Environment::InitializeMainContext(Local<Context> context,
   performance_state_->Mark(performance::NODE_PERFORMANCE_MILESTONE_NODE_START,
                            per_process::node_start_time);
 
+  if (performance::performance_platform_start != 0) {
+    performance_state_->Mark(
+        performance::NODE_PERFORMANCE_MILESTONE_PLATFORM_START,
+        performance::performance_platform_start);
+  }
   if (per_process::v8_initialized) {
     performance_state_->Mark(performance::NODE_PERFORMANCE_MILESTONE_V8_START,
                             performance::performance_v8_start);
@@ -990,6 +1050,10 @@ Environment::~Environment() {
   HandleScope handle_scope(isolate());
   Local<Context> ctx = context();
 
+  // Streaming tasks that already started use the isolate.
+  for (auto& [url, compile] : module_streaming_compiles) compile->Cancel();
+  module_streaming_compiles.clear();
+
   if (Environment** interrupt_data = interrupt_data_.load()) {
     // There are pending RequestInterrupt() callbacks. Tell them not to run,
     // then force V8 to run interrupts by compiling and running an empty script
@@ -1140,10 +1204,20 @@ CompileCacheEnableResult Environment::EnableCompileCache(
         std::make_unique<CompileCacheHandler>(this);
     result = handler->Enable(this, cache_dir);
     if (result.status == CompileCacheEnableStatus::ENABLED) {
+      std::string resolution;
+      if (credentials::SafeGetenv(
+              "NODE_COMPILE_CACHE_RESOLUTION", &resolution, env_vars()) &&
+          resolution == "1") {
+        package_config_cache_ = std::make_unique<modules::PackageConfigCache>(
+            (handler->versioned_cache_dir() / "package-json.cache").string());
+      }
       compile_cache_handler_ = std::move(handler);
       AtExit(
-          [](void* env) {
-            static_cast<Environment*>(env)->compile_cache_handler()->Persist();
+          [](void* data) {
+            Environment* env = static_cast<Environment*>(data);
+            env->compile_cache_handler()->Persist();
+            if (env->package_config_cache_)
+              env->package_config_cache_->Persist();
           },
           this);
     }
@@ -1233,10 +1307,12 @@ void Environment::StartProfilerIdleNotifier() {
   uv_prepare_start(&idle_prepare_handle_, [](uv_prepare_t* handle) {
     Environment* env = ContainerOf(&Environment::idle_prepare_handle_, handle);
     env->isolate()->SetIdle(true);
+    env->loop_phase_timer()->EnterPoll();
   });
   uv_check_start(&idle_check_handle_, [](uv_check_t* handle) {
     Environment* env = ContainerOf(&Environment::idle_check_handle_, handle);
     env->isolate()->SetIdle(false);
+    env->loop_phase_timer()->LeavePoll();
   });
 }
 
@@ -1308,6 +1384,12 @@ void Environment::AtExit(void (*cb)(void* arg), void* arg) {
   at_exit_functions_.push_front(ExitCallback{cb, arg});
 }
 
+void Environment::RemoveAtExit(void (*cb)(void* arg), void* arg) {
+  at_exit_functions_.remove_if([&](const ExitCallback& at_exit) {
+    return at_exit.cb_ == cb && at_exit.arg_ == arg;
+  });
+}
+
 Maybe<bool> Environment::CheckUnsettledTopLevelAwait() {
   HandleScope scope(isolate_);
   Local<Context> ctx = context();
@@ -1470,6 +1552,8 @@ void Environment::ToggleTimerRef(bool ref) {
 void Environment::RunTimers(uv_timer_t* handle) {
   Environment* env = Environment::from_timer_handle(handle);
   TRACE_EVENT0(TRACING_CATEGORY_NODE1(environment), "RunTimers");
+  performance::LoopPhaseTimer::Scope phase_scope(
+      env->loop_phase_timer(), performance::NODE_PERFORMANCE_LOOP_PHASE_TIMERS);
 
   if (!env->can_call_into_js())
     return;
@@ -1528,9 +1612,30 @@ void Environment::RunTimers(uv_timer_t* handle) {
 }
 
 
+void Environment::MarkFirstTick() {
+  first_tick_marked_ = true;
+  performance_state_->Mark(performance::NODE_PERFORMANCE_MILESTONE_FIRST_TICK);
+  // Mark() traces the milestones, this adds the work accumulated during
+  // startup for trace consumers.
+  TRACE_EVENT_INSTANT2(TRACING_CATEGORY_NODE1(bootstrap),
+                       "startupCounters",
+                       TRACE_EVENT_SCOPE_THREAD,
+                       "builtinCompileTimeNs",
+                       principal_realm_->builtins_compile_time,
+                       "packageJsonReadTimeNs",
+                       principal_realm_->package_json_read_time);
+}
+
 void Environment::CheckImmediate(uv_check_t* handle) {
   Environment* env = Environment::from_immediate_check_handle(handle);
   TRACE_EVENT0(TRACING_CATEGORY_NODE1(environment), "CheckImmediate");
+  performance::LoopPhaseTimer::Scope phase_scope(
+      env->loop_phase_timer(),
+      performance::NODE_PERFORMANCE_LOOP_PHASE_IMMEDIATES);
+
+  if (!env->first_tick_marked_) [[unlikely]] {
+    env->MarkFirstTick();
+  }
 
   HandleScope scope(env->isolate());
   Context::Scope context_scope(env->context());
@@ -1906,6 +2011,8 @@ EnvSerializeInfo Environment::Serialize(SnapshotCreator* creator) {
   info.stream_base_state = stream_base_state_.Serialize(ctx, creator);
   info.should_abort_on_uncaught_toggle =
       should_abort_on_uncaught_toggle_.Serialize(ctx, creator);
+  info.async_context_frame_counters =
+      async_context_frame_counters_.Serialize(ctx, creator);
 
   info.principal_realm = principal_realm_->Serialize(creator);
   // For now we only support serialization of the main context.
@@ -1959,6 +2066,7 @@ void Environment::DeserializeProperties(const EnvSerializeInfo* info) {
   exit_info_.Deserialize(ctx);
   stream_base_state_.Deserialize(ctx);
   should_abort_on_uncaught_toggle_.Deserialize(ctx);
+  async_context_frame_counters_.Deserialize(ctx);
 }
 
 void Environment::BuildEmbedderGraph(Isolate* isolate,
@@ -2176,6 +2284,8 @@ void Environment::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("should_abort_on_uncaught_toggle",
                       should_abort_on_uncaught_toggle_);
   tracker->TrackField("stream_base_state", stream_base_state_);
+  tracker->TrackField("async_context_frame_counters",
+                      async_context_frame_counters_);
   tracker->TrackField("cleanup_queue", cleanup_queue_);
   tracker->TrackField("async_hooks", async_hooks_);
   tracker->TrackField("immediate_info", immediate_info_);
@@ -46,6 +46,7 @@
 #include "node_snapshotable.h"
 #include "permission/permission.h"
 #include "req_wrap.h"
+#include "request_object_pool.h"
 #include "util.h"
 #include "uv.h"
 #include "v8.h"
@@ -79,6 +80,11 @@ class ShadowRealm;
 namespace contextify {
 class ContextifyScript;
 class CompiledFnEntry;
+class ScriptCodeCache;
+}
+
+namespace modules {
+class PackageConfigCache;
 }
 
 namespace performance {
@@ -91,6 +97,9 @@ class AgentWriterHandle;
 
 #if HAVE_INSPECTOR
 namespace profiler {
+class ContinuousCpuProfiler;
+class CpuProfileCapture;
+class ContinuousHeapProfiler;
 class V8CoverageConnection;
 class V8CpuProfilerConnection;
 class V8HeapProfilerConnection;
@@ -105,12 +114,23 @@ namespace worker {
 class Worker;
 }
 
+namespace fs {
+class LatencyMonitor;
+}
+
 namespace loader {
+class ModuleStreamingCompile;
 class ModuleWrap;
 }  // namespace loader
 
 class Environment;
 class Realm;
+class StreamIdleTimeouts;
+class ThreadPoolWorkQueue;
+class ZlibContextPool;
+
+// Defined in node_zlib.cc, where ZlibContextPool is complete.
+void DeleteZlibContextPool(ZlibContextPool* pool);
 
 // Disables zero-filling for ArrayBuffer allocations in this scope. This is
 // similar to how we implement Buffer.allocUnsafe() in JS land.
@@ -185,6 +205,9 @@ class NODE_EXTERN_PRIVATE IsolateData : public MemoryRetainer {
   inline worker::Worker* worker_context() const;
   inline void set_worker_context(worker::Worker* context);
 
+  // nullptr unless --vm-code-cache-size is set.
+  inline contextify::ScriptCodeCache* script_code_cache() const;
+
 #define VP(PropertyName, StringValue) V(v8::Private, PropertyName)
 #define VY(PropertyName, StringValue) V(v8::Symbol, PropertyName)
 #define VS(PropertyName, StringValue) V(v8::String, PropertyName)
@@ -262,6 +285,7 @@ class NODE_EXTERN_PRIVATE IsolateData : public MemoryRetainer {
   std::shared_ptr<PerIsolateOptions> options_;
   worker::Worker* worker_context_ = nullptr;
   PerIsolateWrapperData* wrapper_data_;
+  std::unique_ptr<contextify::ScriptCodeCache> script_code_cache_;
 
   static Mutex isolate_data_mutex_;
   static std::unordered_map<uint16_t, std::unique_ptr<PerIsolateWrapperData>>
@@ -531,6 +555,7 @@ struct EnvSerializeInfo {
   AliasedBufferIndex exit_info;
   AliasedBufferIndex stream_base_state;
   AliasedBufferIndex should_abort_on_uncaught_toggle;
+  AliasedBufferIndex async_context_frame_counters;
 
   RealmSerializeInfo principal_realm;
   friend std::ostream& operator<<(std::ostream& o, const EnvSerializeInfo& i);
@@ -716,6 +741,10 @@ class Environment final : public MemoryRetainer {
 
   inline void IncreaseWaitingRequestCounter();
   inline void DecreaseWaitingRequestCounter();
+  ThreadPoolWorkQueue* threadpool_work_queue();
+  StreamIdleTimeouts* stream_idle_timeouts();
+  fs::LatencyMonitor* fs_latency_monitor();
+  ZlibContextPool* zlib_context_pool();
 
   inline AsyncHooks* async_hooks();
   inline ImmediateInfo* immediate_info();
@@ -756,6 +785,9 @@ class Environment final : public MemoryRetainer {
 
   inline AliasedInt32Array& stream_base_state();
 
+  // Indexed by async_context_frame::CounterFields.
+  inline AliasedFloat64Array& async_context_frame_counters();
+
   // The necessary API for async_hooks.
   inline double new_async_id();
   inline double execution_async_id();
@@ -768,10 +800,15 @@ class Environment final : public MemoryRetainer {
   builtins::BuiltinLoader* builtin_loader();
 
   std::unordered_multimap<int, loader::ModuleWrap*> hash_to_module_map;
+  // Modules parsed ahead of their ModuleWrap, by URL.
+  std::unordered_map<std::string,
+                     std::shared_ptr<loader::ModuleStreamingCompile>>
+      module_streaming_compiles;
 
   EnabledDebugList* enabled_debug_list() { return &enabled_debug_list_; }
 
   inline performance::PerformanceState* performance_state();
+  inline performance::LoopPhaseTimer* loop_phase_timer();
 
   void CollectUVExceptionInfo(v8::Local<v8::Value> context,
                               int errorno,
@@ -848,6 +885,7 @@ class Environment final : public MemoryRetainer {
                                const char* dest = nullptr);
 
   void AtExit(void (*cb)(void* arg), void* arg);
+  void RemoveAtExit(void (*cb)(void* arg), void* arg);
   void RunAtExitCallbacks();
 
   v8::Maybe<bool> CheckUnsettledTopLevelAwait();
@@ -962,6 +1000,17 @@ class Environment final : public MemoryRetainer {
   inline void RemoveCleanupHook(CleanupQueue::Callback cb, void* arg);
   void RunCleanup();
 
+  // Hooks that release memory held by native caches, such as pooled zlib
+  // states and parsed package.json files. They run on the thread of the
+  // Environment when NotifyMemoryPressure() is called with a level other
+  // than kNone, and must not add or remove hooks themselves.
+  using MemoryPressureHook = void (*)(void* arg);
+  inline void AddMemoryPressureHook(MemoryPressureHook hook, void* arg);
+  inline void RemoveMemoryPressureHook(MemoryPressureHook hook, void* arg);
+  // Trims the caches of the Environment and then notifies V8, which may
+  // collect garbage right away at kCritical.
+  void NotifyMemoryPressure(v8::MemoryPressureLevel level);
+
   static void TracePromises(v8::PromiseHookType type,
                             v8::Local<v8::Promise> promise,
                             v8::Local<v8::Value> parent);
@@ -998,10 +1047,22 @@ class Environment final : public MemoryRetainer {
   inline void set_cpu_prof_dir(const std::string& dir);
   inline const std::string& cpu_prof_dir() const;
 
+  void set_continuous_cpu_profiler(
+      std::unique_ptr<profiler::ContinuousCpuProfiler> profiler);
+  profiler::ContinuousCpuProfiler* continuous_cpu_profiler();
+
+  void set_cpu_profile_capture(
+      std::unique_ptr<profiler::CpuProfileCapture> capture);
+  profiler::CpuProfileCapture* cpu_profile_capture();
+
   void set_heap_profiler_connection(
       std::unique_ptr<profiler::V8HeapProfilerConnection> connection);
   profiler::V8HeapProfilerConnection* heap_profiler_connection();
 
+  void set_continuous_heap_profiler(
+      std::unique_ptr<profiler::ContinuousHeapProfiler> profiler);
+  profiler::ContinuousHeapProfiler* continuous_heap_profiler();
+
   inline void set_heap_prof_name(const std::string& name);
   inline const std::string& heap_prof_name() const;
 
@@ -1021,7 +1082,14 @@ class Environment final : public MemoryRetainer {
 
   inline CompileCacheHandler* compile_cache_handler();
   inline bool use_compile_cache() const;
+  // nullptr unless NODE_COMPILE_CACHE_RESOLUTION=1 was set when the compile
+  // cache was enabled.
+  inline modules::PackageConfigCache* package_config_cache();
   void InitializeCompileCache();
+
+  // Objects of finished WriteWraps and FSReqPromises that C++ created.
+  inline RequestObjectPool* write_wrap_pool();
+  inline RequestObjectPool* fsreqpromise_pool();
   // Enable built-in compile cache if it has not yet been enabled.
   // The cache will be persisted to disk on exit.
   CompileCacheEnableResult EnableCompileCache(const std::string& cache_dir);
@@ -1031,6 +1099,10 @@ class Environment final : public MemoryRetainer {
 
   uv_buf_t allocate_managed_buffer(const size_t suggested_size);
   std::unique_ptr<v8::BackingStore> release_managed_buffer(const uv_buf_t& buf);
+  // Returns a BackingStore obtained through release_managed_buffer() whose
+  // contents have been copied elsewhere, so that a later
+  // allocate_managed_buffer() call of the same size can reuse it.
+  void recycle_managed_buffer(std::unique_ptr<v8::BackingStore> bs);
 
   void AddUnmanagedFd(int fd);
   void RemoveUnmanagedFd(int fd);
@@ -1061,6 +1133,9 @@ class Environment final : public MemoryRetainer {
 #endif  // OPENSSL_VERSION_MAJOR >= 3
   std::unordered_map<std::string, size_t> alias_to_md_id_map;
   std::vector<std::string> supported_hash_algorithms;
+  // Legacy objects of recently converted certificates, keyed by the SHA-256
+  // digest of their DER encoding. See X509Certificate::toObject().
+  std::unordered_map<std::string, v8::Global<v8::Object>> x509_object_cache;
 #endif  // HAVE_OPENSSL
 
   v8::Global<v8::Module> temporary_required_module_facade_original;
@@ -1120,13 +1195,19 @@ class Environment final : public MemoryRetainer {
   std::string cpu_prof_dir_;
   std::string cpu_prof_name_;
   uint64_t cpu_prof_interval_;
+  std::unique_ptr<profiler::ContinuousCpuProfiler> continuous_cpu_profiler_;
+  std::unique_ptr<profiler::CpuProfileCapture> cpu_profile_capture_;
   std::unique_ptr<profiler::V8HeapProfilerConnection> heap_profiler_connection_;
   std::string heap_prof_dir_;
   std::string heap_prof_name_;
   uint64_t heap_prof_interval_;
+  std::unique_ptr<profiler::ContinuousHeapProfiler> continuous_heap_profiler_;
 #endif  // HAVE_INSPECTOR
 
   std::unique_ptr<CompileCacheHandler> compile_cache_handler_;
+  std::unique_ptr<modules::PackageConfigCache> package_config_cache_;
+  RequestObjectPool write_wrap_pool_;
+  RequestObjectPool fsreqpromise_pool_;
   std::shared_ptr<EnvironmentOptions> options_;
   // options_ contains debug options parsed from CLI arguments,
   // while inspector_host_port_ stores the actual inspector host
@@ -1159,6 +1240,8 @@ class Environment final : public MemoryRetainer {
 
   AliasedInt32Array stream_base_state_;
 
+  AliasedFloat64Array async_context_frame_counters_;
+
   // As PerformanceNodeTiming is exposed in worker_threads, the per_process
   // time origin is exposed in the worker threads. This is an intentional
   // diverge from the HTML spec of web workers.
@@ -1171,6 +1254,7 @@ class Environment final : public MemoryRetainer {
   // This is the time when the environment is created.
   const uint64_t environment_start_;
   std::unique_ptr<performance::PerformanceState> performance_state_;
+  performance::LoopPhaseTimer loop_phase_timer_;
 
   bool has_serialized_options_ = false;
 
@@ -1197,6 +1281,9 @@ class Environment final : public MemoryRetainer {
   std::list<HandleCleanup> handle_cleanup_queue_;
   int handle_cleanup_waiting_ = 0;
   int request_waiting_ = 0;
+  std::unique_ptr<ThreadPoolWorkQueue> threadpool_work_queue_;
+  std::unique_ptr<StreamIdleTimeouts> stream_idle_timeouts_;
+  std::unique_ptr<fs::LatencyMonitor> fs_latency_monitor_;
 
   EnabledDebugList enabled_debug_list_;
 
@@ -1227,10 +1314,16 @@ class Environment final : public MemoryRetainer {
   std::atomic<Environment**> interrupt_data_ {nullptr};
   void RequestInterruptFromV8();
   static void CheckImmediate(uv_check_t* handle);
+  void MarkFirstTick();
+  bool first_tick_marked_ = false;
 
   CleanupQueue cleanup_queue_;
   bool started_cleanup_ = false;
 
+  std::vector<std::pair<MemoryPressureHook, void*>> memory_pressure_hooks_;
+  // Declared after memory_pressure_hooks_, so that it is destroyed first.
+  DeleteFnPtr<ZlibContextPool, DeleteZlibContextPool> zlib_context_pool_;
+
   std::unordered_set<int> unmanaged_fds_;
 
   std::function<void(Environment*, ExitCode)> process_exit_handler_{
@@ -1246,6 +1339,16 @@ class Environment final : public MemoryRetainer {
   std::unordered_map<char*, std::unique_ptr<v8::BackingStore>>
       released_allocated_buffers_;
 
+  // Free lists of read buffers, one per power-of-two size class between
+  // kMinPooledBufferSize and kMaxPooledBufferSize. Reads that are copied into
+  // an exactly-sized BackingStore return their scratch buffer here instead of
+  // freeing it, which avoids a malloc/free pair per read on busy sockets.
+  static constexpr size_t kMinPooledBufferShift = 12;  // 4 KiB
+  static constexpr size_t kMaxPooledBufferShift = 16;  // 64 KiB
+  static constexpr size_t kMaxPooledBuffersPerClass = 16;
+  std::vector<std::unique_ptr<v8::BackingStore>>
+      managed_buffer_pool_[kMaxPooledBufferShift - kMinPooledBufferShift + 1];
+
   std::unordered_map<std::uintptr_t, v8::Global<v8::Value>>
       async_resource_context_frames_;
 };
@@ -24,11 +24,29 @@
 #include "handle_wrap.h"
 #include "node.h"
 #include "node_external_reference.h"
+#include "node_file.h"
 #include "permission/permission.h"
+#include "path.h"
 #include "string_bytes.h"
+#include "timer_wrap-inl.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#endif
 
 namespace node {
 
+using v8::Array;
 using v8::Context;
 using v8::DontDelete;
 using v8::DontEnum;
@@ -38,12 +56,14 @@ using v8::HandleScope;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
+using v8::LocalVector;
 using v8::MaybeLocal;
 using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
 using v8::Signature;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 
 namespace {
@@ -74,9 +94,333 @@ class FSEventWrap: public HandleWrap {
 
   uv_fs_event_t handle_;
   enum encoding encoding_ = kDefaultEncoding;
+  // Absolute form of the watched path, dropped from the module resolution
+  // stat cache on every event. Empty unless the cache is enabled.
+  std::string stat_cache_path_;
 };
 
 
+#ifdef __linux__
+
+// Watches a directory tree with a single inotify instance, for recursive
+// fs.watch() on Linux. The watch descriptors of all directories share one
+// fd and one uv_poll_t, and their paths are kept here, so the memory used
+// grows with the number of directories rather than with the number of
+// handles and JS objects. Directories that appear in the tree are watched
+// as they are created. Events are delivered to JS in batches, at most one
+// per `debounce` milliseconds, with duplicate events of a batch coalesced.
+class FSEventTreeWrap : public HandleWrap {
+ public:
+  static void Initialize(Environment* env,
+                         Local<Object> target,
+                         Local<Context> context);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Start(const FunctionCallbackInfo<Value>& args);
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(FSEventTreeWrap)
+  SET_SELF_SIZE(FSEventTreeWrap)
+
+ private:
+  static const encoding kDefaultEncoding = UTF8;
+  static constexpr uint32_t kWatchMask =
+      IN_ATTRIB | IN_CREATE | IN_MODIFY | IN_DELETE | IN_DELETE_SELF |
+      IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_DONT_FOLLOW;
+
+  FSEventTreeWrap(Environment* env, Local<Object> object);
+  ~FSEventTreeWrap() override;
+
+  // Watches |relative| and the directories below it. With |report|, the
+  // entries that are found are reported as renamed, since they may have
+  // been created before the directory was watched. Returns the error of
+  // watching |relative| itself.
+  int AddTree(const std::string& relative, bool report);
+  void ReadEvents();
+  void QueueEvent(bool rename, std::string&& filename);
+  void Flush();
+  void OnClose() override;
+
+  static void OnPoll(uv_poll_t* handle, int status, int events);
+
+  uv_poll_t handle_;
+  int fd_ = -1;
+  std::string root_;
+  // Paths of the watched directories, relative to root_.
+  std::unordered_map<int, std::string> paths_;
+  enum encoding encoding_ = kDefaultEncoding;
+  uint64_t debounce_ = 0;
+  std::unique_ptr<TimerWrapHandle> timer_;
+  bool flush_scheduled_ = false;
+  // The events of the next batch, as (rename, filename) pairs.
+  std::vector<std::pair<bool, std::string>> pending_;
+  std::unordered_set<std::string> pending_keys_;
+  std::string stat_cache_path_;
+};
+
+FSEventTreeWrap::FSEventTreeWrap(Environment* env, Local<Object> object)
+    : HandleWrap(env,
+                 object,
+                 reinterpret_cast<uv_handle_t*>(&handle_),
+                 AsyncWrap::PROVIDER_FSEVENTWRAP) {
+  MarkAsUninitialized();
+}
+
+FSEventTreeWrap::~FSEventTreeWrap() {
+  // Only set here if Start() failed before the poll handle was started.
+  if (fd_ != -1) close(fd_);
+}
+
+void FSEventTreeWrap::Initialize(Environment* env,
+                                 Local<Object> target,
+                                 Local<Context> context) {
+  Isolate* isolate = env->isolate();
+  Local<FunctionTemplate> t = NewFunctionTemplate(isolate, New);
+  t->InstanceTemplate()->SetInternalFieldCount(
+      FSEventTreeWrap::kInternalFieldCount);
+  t->Inherit(HandleWrap::GetConstructorTemplate(env));
+  SetProtoMethod(isolate, t, "start", Start);
+  SetConstructorFunction(context, target, "FSEventTree", t);
+}
+
+void FSEventTreeWrap::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Start);
+}
+
+void FSEventTreeWrap::New(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args.IsConstructCall());
+  Environment* env = Environment::GetCurrent(args);
+  new FSEventTreeWrap(env, args.This());
+}
+
+void FSEventTreeWrap::MemoryInfo(MemoryTracker* tracker) const {
+  size_t paths_size = 0;
+  for (const auto& entry : paths_)
+    paths_size += sizeof(entry) + entry.second.capacity();
+  tracker->TrackFieldWithSize("paths", paths_size);
+  tracker->TrackField("timer", timer_);
+}
+
+// wrap.start(filename, persistent, encoding, debounce)
+void FSEventTreeWrap::Start(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  FSEventTreeWrap* wrap = Unwrap<FSEventTreeWrap>(args.This());
+  CHECK_NOT_NULL(wrap);
+  CHECK(wrap->IsHandleClosing());  // Check that Start() has not been called.
+  CHECK_GE(args.Length(), 4);
+  CHECK(args[3]->IsUint32());
+
+  BufferValue path(env->isolate(), args[0]);
+  CHECK_NOT_NULL(*path);
+  THROW_IF_INSUFFICIENT_PERMISSIONS(
+      env, permission::PermissionScope::kFileSystemRead, *path);
+
+  wrap->root_ = path.ToString();
+  wrap->encoding_ = ParseEncoding(env->isolate(), args[2], kDefaultEncoding);
+  wrap->debounce_ = args[3].As<Uint32>()->Value();
+  if (fs::stat_cache::IsEnabled())
+    wrap->stat_cache_path_ = PathResolve(env, {path.ToStringView()});
+
+  wrap->fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (wrap->fd_ == -1)
+    return args.GetReturnValue().Set(uv_translate_sys_error(errno));
+
+  int err = wrap->AddTree("", false);
+  if (err == 0)
+    err = uv_poll_init(env->event_loop(), &wrap->handle_, wrap->fd_);
+  if (err != 0) {
+    wrap->paths_.clear();
+    return args.GetReturnValue().Set(err);
+  }
+
+  wrap->MarkAsInitialized();
+  err = uv_poll_start(&wrap->handle_, UV_READABLE, OnPoll);
+  if (err != 0) {
+    wrap->Close();
+    return args.GetReturnValue().Set(err);
+  }
+
+  wrap->timer_ = std::make_unique<TimerWrapHandle>(env, [wrap]() {
+    wrap->flush_scheduled_ = false;
+    wrap->Flush();
+  });
+  wrap->timer_->Unref();
+
+  if (!args[1]->IsTrue())
+    uv_unref(reinterpret_cast<uv_handle_t*>(&wrap->handle_));
+
+  args.GetReturnValue().Set(0);
+}
+
+int FSEventTreeWrap::AddTree(const std::string& relative, bool report) {
+  std::vector<std::string> stack = {relative};
+  while (!stack.empty()) {
+    std::string dir = std::move(stack.back());
+    stack.pop_back();
+    std::string full = dir.empty() ? root_ : root_ + '/' + dir;
+
+    int wd = inotify_add_watch(fd_, full.c_str(), kWatchMask);
+    if (wd == -1) {
+      // Entries below the root can disappear while they are being added.
+      if (dir == relative) return uv_translate_sys_error(errno);
+      continue;
+    }
+    paths_[wd] = dir;
+
+    DIR* d = opendir(full.c_str());
+    if (d == nullptr) continue;  // The root can be a file.
+    while (dirent* entry = readdir(d)) {
+      std::string_view name = entry->d_name;
+      if (name == "." || name == "..") continue;
+      std::string child = dir.empty() ? std::string(name)
+                                      : dir + '/' + std::string(name);
+      bool is_dir = entry->d_type == DT_DIR;
+      if (entry->d_type == DT_UNKNOWN) {
+        struct stat st;
+        std::string child_full = root_ + '/' + child;
+        is_dir = lstat(child_full.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+      }
+      if (report) QueueEvent(true, std::string(child));
+      if (is_dir) stack.push_back(std::move(child));
+    }
+    closedir(d);
+  }
+  return 0;
+}
+
+void FSEventTreeWrap::OnPoll(uv_poll_t* handle, int status, int events) {
+  FSEventTreeWrap* wrap = static_cast<FSEventTreeWrap*>(handle->data);
+  if (status != 0) {
+    Environment* env = wrap->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Value> argv[] = {Integer::New(env->isolate(), status)};
+    wrap->MakeCallback(env->onchange_string(), arraysize(argv), argv);
+    return;
+  }
+
+  wrap->ReadEvents();
+  if (wrap->pending_.empty()) return;
+  if (wrap->debounce_ == 0) {
+    wrap->Flush();
+  } else if (!wrap->flush_scheduled_) {
+    wrap->flush_scheduled_ = true;
+    wrap->timer_->Update(wrap->debounce_);
+  }
+}
+
+void FSEventTreeWrap::ReadEvents() {
+  alignas(inotify_event) char buf[16 * 1024];
+  while (true) {
+    ssize_t size = read(fd_, buf, sizeof(buf));
+    if (size == -1 && errno == EINTR) continue;
+    if (size <= 0) return;
+
+    for (char* p = buf; p < buf + size;) {
+      const inotify_event* event = reinterpret_cast<inotify_event*>(p);
+      p += sizeof(*event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        // Some events were dropped, report the whole tree as changed.
+        QueueEvent(true, std::string());
+        continue;
+      }
+      auto it = paths_.find(event->wd);
+      if (it == paths_.end()) continue;
+      if (event->mask & IN_IGNORED) {
+        paths_.erase(it);
+        continue;
+      }
+
+      std::string filename = it->second;
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // The parent directory reports these for the directories below the
+        // root. For the root, report its own name like uv_fs_event_t does.
+        if (!filename.empty()) continue;
+        filename = root_.substr(root_.find_last_of('/') + 1);
+      } else if (event->len > 0) {
+        if (!filename.empty()) filename += '/';
+        filename += event->name;
+      }
+
+      bool rename = (event->mask & (IN_ATTRIB | IN_MODIFY)) == 0;
+      if ((event->mask & IN_ISDIR) &&
+          (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+        AddTree(filename, true);
+      }
+      QueueEvent(rename, std::move(filename));
+    }
+  }
+}
+
+void FSEventTreeWrap::QueueEvent(bool rename, std::string&& filename) {
+  std::string key = rename ? "r" : "c";
+  key += filename;
+  if (!pending_keys_.insert(std::move(key)).second) return;
+  pending_.emplace_back(rename, std::move(filename));
+}
+
+// Calls onchange(status, events), where events is a flat array of
+// (eventType, filename) pairs.
+void FSEventTreeWrap::Flush() {
+  if (pending_.empty() || IsHandleClosing()) return;
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+
+  if (!stat_cache_path_.empty()) fs::stat_cache::Invalidate(stat_cache_path_);
+
+  std::vector<std::pair<bool, std::string>> events;
+  events.swap(pending_);
+  pending_keys_.clear();
+
+  LocalVector<Value> values(isolate);
+  values.reserve(events.size() * 2);
+  for (const auto& [rename, filename] : events) {
+    values.push_back(rename ? env->rename_string() : env->change_string());
+    Local<Value> error;
+    Local<Value> name;
+    if (!StringBytes::Encode(isolate,
+                             filename.data(),
+                             filename.size(),
+                             encoding_,
+                             &error)
+             .ToLocal(&name) &&
+        !StringBytes::Encode(isolate,
+                             filename.data(),
+                             filename.size(),
+                             BUFFER,
+                             &error)
+             .ToLocal(&name)) {
+      return;
+    }
+    values.push_back(name);
+  }
+
+  Local<Value> argv[] = {
+      Integer::New(isolate, 0),
+      Array::New(isolate, values.data(), values.size()),
+  };
+  MakeCallback(env->onchange_string(), arraysize(argv), argv);
+}
+
+void FSEventTreeWrap::OnClose() {
+  // The poll handle is closed, so the fd is no longer in use.
+  close(fd_);
+  fd_ = -1;
+  timer_.reset();
+  paths_.clear();
+  pending_.clear();
+  pending_keys_.clear();
+}
+
+#endif  // __linux__
+
+
 FSEventWrap::FSEventWrap(Environment* env, Local<Object> object)
     : HandleWrap(env,
                  object,
@@ -119,6 +463,10 @@ void FSEventWrap::Initialize(Local<Object> target,
       static_cast<PropertyAttribute>(ReadOnly | DontDelete | DontEnum));
 
   SetConstructorFunction(context, target, "FSEvent", t);
+
+#ifdef __linux__
+  FSEventTreeWrap::Initialize(env, target, context);
+#endif
 }
 
 void FSEventWrap::RegisterExternalReferences(
@@ -126,6 +474,9 @@ void FSEventWrap::RegisterExternalReferences(
   registry->Register(New);
   registry->Register(Start);
   registry->Register(GetInitialized);
+#ifdef __linux__
+  FSEventTreeWrap::RegisterExternalReferences(registry);
+#endif
 }
 
 void FSEventWrap::New(const FunctionCallbackInfo<Value>& args) {
@@ -156,6 +507,16 @@ void FSEventWrap::Start(const FunctionCallbackInfo<Value>& args) {
 
   wrap->encoding_ = ParseEncoding(env->isolate(), args[3], kDefaultEncoding);
 
+  if (fs::stat_cache::IsEnabled()) {
+#ifdef _WIN32
+    BufferValue resolved(env->isolate(), args[0]);
+    ToNamespacedPath(env, &resolved);
+    wrap->stat_cache_path_ = resolved.ToString();
+#else
+    wrap->stat_cache_path_ = PathResolve(env, {path.ToStringView()});
+#endif
+  }
+
   int err = uv_fs_event_init(wrap->env()->event_loop(), &wrap->handle_);
   if (err != 0) {
     return args.GetReturnValue().Set(err);
@@ -188,6 +549,11 @@ void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
 
   CHECK_EQ(wrap->persistent().IsEmpty(), false);
 
+  // The event may be for any entry below the watched path, and `filename`
+  // is not always reported, so drop everything the watcher covers.
+  if (!wrap->stat_cache_path_.empty())
+    fs::stat_cache::Invalidate(wrap->stat_cache_path_);
+
   // We're in a bind here. libuv can set both UV_RENAME and UV_CHANGE but
   // the Node API only lets us pass a single event to JS land.
   //
@@ -237,6 +603,7 @@ void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
   wrap->MakeCallback(env->onchange_string(), arraysize(argv), argv);
 }
 
+
 }  // anonymous namespace
 }  // namespace node
 
@@ -1,5 +1,6 @@
 #include "diagnosticfilename-inl.h"
 #include "env-inl.h"
+#include "handle_wrap.h"
 #include "memory_tracker-inl.h"
 #include "node_external_reference.h"
 #include "path.h"
@@ -18,6 +19,13 @@
 #endif  // S_IWUSR
 #endif
 
+#ifdef __linux__
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using v8::Array;
 using v8::Boolean;
 using v8::Context;
@@ -27,6 +35,7 @@ using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::Global;
 using v8::HandleScope;
+using v8::Integer;
 using v8::HeapProfiler;
 using v8::HeapSnapshot;
 using v8::Isolate;
@@ -476,6 +485,338 @@ void TriggerHeapSnapshot(const FunctionCallbackInfo<Value>& args) {
   return args.GetReturnValue().Set(filename_v);
 }
 
+#ifdef __linux__
+namespace {
+
+// Progress records sent by a forked snapshot child to its parent. The last
+// record sent has `done` set to kDone and the child's error code, or 0, in
+// `total`. kHeartbeat records only tell the parent that the child is still
+// making progress while it writes the snapshot out.
+struct ForkedSnapshotRecord {
+  static constexpr int32_t kDone = -1;
+  static constexpr int32_t kHeartbeat = -2;
+  int32_t done;
+  int32_t total;
+};
+
+// A child that sends no record for this long is assumed to be deadlocked and
+// is killed, see RunForkedSnapshot().
+constexpr uint64_t kForkedSnapshotStallTimeoutMs = 60 * 1000;
+
+class PipeActivityControl : public v8::ActivityControl {
+ public:
+  explicit PipeActivityControl(int fd) : fd_(fd) {}
+
+  ControlOption ReportProgressValue(uint32_t done, uint32_t total) override {
+    // Only send whole percent steps, V8 reports progress much more often.
+    uint32_t percent =
+        total == 0 ? 0 : static_cast<uint64_t>(done) * 100 / total;
+    if (percent != last_percent_) {
+      last_percent_ = percent;
+      Send({static_cast<int32_t>(done), static_cast<int32_t>(total)});
+    }
+    return kContinue;
+  }
+
+  void Heartbeat() {
+    // At most once per second, so that large snapshots are not slowed down.
+    uint64_t now = uv_hrtime();
+    if (now - last_heartbeat_ < 1000 * 1000 * 1000) return;
+    last_heartbeat_ = now;
+    Send({ForkedSnapshotRecord::kHeartbeat, 0});
+  }
+
+  void Send(ForkedSnapshotRecord record) {
+    // Records are smaller than PIPE_BUF, so they are written atomically.
+    ssize_t ret;
+    do {
+      ret = write(fd_, &record, sizeof(record));
+    } while (ret == -1 && errno == EINTR);
+  }
+
+ private:
+  int fd_;
+  uint32_t last_percent_ = 101;
+  uint64_t last_heartbeat_ = 0;
+};
+
+class ForkedSnapshotOutputStream final : public FileOutputStream {
+ public:
+  ForkedSnapshotOutputStream(int fd, uv_fs_t* req, PipeActivityControl* control)
+      : FileOutputStream(fd, req), control_(control) {}
+
+  WriteResult WriteAsciiChunk(char* data, const int size) override {
+    control_->Heartbeat();
+    return FileOutputStream::WriteAsciiChunk(data, size);
+  }
+
+ private:
+  PipeActivityControl* control_;
+};
+
+// Runs in the forked child. Only the thread that forked exists in the child,
+// so the snapshot is taken and written entirely on it. Parallel GC jobs
+// posted by V8 are joined by the posting thread and still complete.
+//
+// The child is not async-signal-safe: any lock that another thread of the
+// parent held at the time of fork(), such as one inside malloc, V8 or
+// OpenSSL, stays locked forever in the child. Taking it deadlocks the child.
+// The parent kills a child that has not reported anything for
+// kForkedSnapshotStallTimeoutMs, and ondone() then reports UV_ETIMEDOUT.
+[[noreturn]] void RunForkedSnapshot(Environment* env,
+                                    int fd,
+                                    const char* filename,
+                                    HeapProfiler::HeapSnapshotOptions options) {
+  // Don't outlive the process being snapshotted.
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  PipeActivityControl control(fd);
+  options.control = &control;
+
+  uv_fs_t req;
+  int err = uv_fs_open(nullptr,
+                       &req,
+                       filename,
+                       O_WRONLY | O_CREAT | O_TRUNC,
+                       S_IWUSR | S_IRUSR,
+                       nullptr);
+  uv_fs_req_cleanup(&req);
+  if (err >= 0) {
+    const int out_fd = err;
+    ForkedSnapshotOutputStream stream(out_fd, &req, &control);
+    TakeSnapshot(env, &stream, options);
+    err = stream.status();
+    int close_err = uv_fs_close(nullptr, &req, out_fd, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err == 0) err = close_err;
+  }
+
+  control.Send({ForkedSnapshotRecord::kDone, err});
+  _exit(err == 0 ? 0 : 1);
+}
+
+// The parent's end of a forked heap snapshot. Progress is reported through
+// `onprogress(done, total)` and completion through
+// `ondone(err, exitCode, signal)`, where `err` is the error the child hit
+// while writing the snapshot, UV_ETIMEDOUT if it stalled and was killed, or
+// UV_EOF if the child died before reporting. Closing the handle before
+// completion kills the child.
+class HeapSnapshotForkWrap final : public HandleWrap {
+ public:
+  static Local<FunctionTemplate> GetConstructorTemplate(Environment* env) {
+    Local<FunctionTemplate> tmpl =
+        env->heapsnapshotfork_constructor_template();
+    if (tmpl.IsEmpty()) {
+      Isolate* isolate = env->isolate();
+      tmpl = NewFunctionTemplate(isolate, nullptr);
+      tmpl->Inherit(HandleWrap::GetConstructorTemplate(env));
+      tmpl->SetClassName(
+          FIXED_ONE_BYTE_STRING(isolate, "HeapSnapshotForkWrap"));
+      tmpl->InstanceTemplate()->SetInternalFieldCount(
+          HandleWrap::kInternalFieldCount);
+      env->set_heapsnapshotfork_constructor_template(tmpl);
+    }
+    return tmpl;
+  }
+
+  static BaseObjectPtr<HeapSnapshotForkWrap> Create(Environment* env,
+                                                    pid_t pid,
+                                                    int fd) {
+    Local<Object> obj;
+    if (!GetConstructorTemplate(env)
+             ->InstanceTemplate()
+             ->NewInstance(env->context())
+             .ToLocal(&obj)) {
+      return {};
+    }
+    return MakeBaseObject<HeapSnapshotForkWrap>(env, obj, pid, fd);
+  }
+
+  HeapSnapshotForkWrap(Environment* env,
+                       Local<Object> obj,
+                       pid_t pid,
+                       int fd)
+      : HandleWrap(env,
+                   obj,
+                   reinterpret_cast<uv_handle_t*>(&pipe_),
+                   AsyncWrap::PROVIDER_HEAPSNAPSHOT),
+        pid_(pid) {
+    CHECK_EQ(uv_pipe_init(env->event_loop(), &pipe_, 0), 0);
+    int err = uv_pipe_open(&pipe_, fd);
+    if (err == 0) {
+      err = uv_read_start(
+          reinterpret_cast<uv_stream_t*>(&pipe_), OnAlloc, OnRead);
+    }
+    if (err != 0) close(fd);
+
+    stall_timer_ = new uv_timer_t();
+    stall_timer_->data = this;
+    CHECK_EQ(uv_timer_init(env->event_loop(), stall_timer_), 0);
+    uv_unref(reinterpret_cast<uv_handle_t*>(stall_timer_));
+    RestartStallTimer();
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {}
+  SET_MEMORY_INFO_NAME(HeapSnapshotForkWrap)
+  SET_SELF_SIZE(HeapSnapshotForkWrap)
+
+ protected:
+  void OnClose() override {
+    env()->CloseHandle(stall_timer_, [](uv_timer_t* handle) { delete handle; });
+    stall_timer_ = nullptr;
+    if (pid_ == 0) return;
+    kill(pid_, SIGKILL);
+    int status;
+    while (waitpid(pid_, &status, 0) == -1 && errno == EINTR) {}
+    pid_ = 0;
+  }
+
+ private:
+  void RestartStallTimer() {
+    uv_timer_start(stall_timer_, OnStall, kForkedSnapshotStallTimeoutMs, 0);
+  }
+
+  static void OnStall(uv_timer_t* handle) {
+    HeapSnapshotForkWrap* wrap =
+        static_cast<HeapSnapshotForkWrap*>(handle->data);
+    // The pipe sees EOF once the child is gone, which calls Finish().
+    if (wrap->pid_ == 0) return;
+    wrap->timed_out_ = true;
+    kill(wrap->pid_, SIGKILL);
+  }
+
+  static void OnAlloc(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+    HeapSnapshotForkWrap* wrap = static_cast<HeapSnapshotForkWrap*>(
+        handle->data);
+    *buf = uv_buf_init(wrap->read_buffer_ + wrap->buffered_,
+                       sizeof(wrap->read_buffer_) - wrap->buffered_);
+  }
+
+  static void OnRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t*) {
+    HeapSnapshotForkWrap* wrap = static_cast<HeapSnapshotForkWrap*>(
+        stream->data);
+    if (nread == 0) return;
+    if (nread < 0) return wrap->Finish(UV_EOF);
+
+    Environment* env = wrap->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    wrap->RestartStallTimer();
+    wrap->buffered_ += nread;
+    size_t offset = 0;
+    while (wrap->buffered_ - offset >= sizeof(ForkedSnapshotRecord)) {
+      ForkedSnapshotRecord record;
+      memcpy(&record, wrap->read_buffer_ + offset, sizeof(record));
+      offset += sizeof(record);
+      if (record.done == ForkedSnapshotRecord::kDone)
+        return wrap->Finish(record.total);
+      if (record.done == ForkedSnapshotRecord::kHeartbeat) continue;
+      Local<Value> argv[] = {
+          Integer::New(env->isolate(), record.done),
+          Integer::New(env->isolate(), record.total),
+      };
+      if (wrap->MakeCallback(env->onprogress_string(), arraysize(argv), argv)
+              .IsEmpty() ||
+          !IsAlive(wrap)) {
+        return;
+      }
+    }
+    wrap->buffered_ -= offset;
+    memmove(wrap->read_buffer_, wrap->read_buffer_ + offset, wrap->buffered_);
+  }
+
+  void Finish(int err) {
+    uv_read_stop(reinterpret_cast<uv_stream_t*>(&pipe_));
+    uv_timer_stop(stall_timer_);
+    if (timed_out_ && err == UV_EOF) err = UV_ETIMEDOUT;
+    // The child closes its end of the pipe only by exiting, so this does not
+    // block for long.
+    int status = 0;
+    while (waitpid(pid_, &status, 0) == -1 && errno == EINTR) {}
+    pid_ = 0;
+
+    Environment* env = this->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Value> argv[] = {
+        Integer::New(env->isolate(), err),
+        Integer::New(env->isolate(),
+                     WIFEXITED(status) ? WEXITSTATUS(status) : 0),
+        Integer::New(env->isolate(),
+                     WIFSIGNALED(status) ? WTERMSIG(status) : 0),
+    };
+    MakeCallback(env->ondone_string(), arraysize(argv), argv);
+    Close();
+  }
+
+  uv_pipe_t pipe_;
+  uv_timer_t* stall_timer_ = nullptr;
+  pid_t pid_;
+  bool timed_out_ = false;
+  char read_buffer_[sizeof(ForkedSnapshotRecord) * 64];
+  size_t buffered_ = 0;
+};
+
+}  // namespace
+
+// Writes a heap snapshot from a forked copy of the process, so that this
+// process is only paused for as long as fork() takes. Linux only.
+void ForkHeapSnapshot(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = args.GetIsolate();
+  CHECK_EQ(args.Length(), 2);
+  auto options = GetHeapSnapshotOptions(args[1]);
+
+  std::string filename;
+  if (args[0]->IsUndefined()) {
+    THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env,
+        permission::PermissionScope::kFileSystemWrite,
+        Environment::GetCwd(env->exec_path()));
+    filename = *DiagnosticFilename(env, "Heap", "heapsnapshot");
+  } else {
+    BufferValue path(isolate, args[0]);
+    CHECK_NOT_NULL(*path);
+    ToNamespacedPath(env, &path);
+    THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env, permission::PermissionScope::kFileSystemWrite,
+        path.ToStringView());
+    filename = path.ToString();
+  }
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+    return env->ThrowErrnoException(errno, "pipe2");
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    int err = errno;
+    close(fds[0]);
+    close(fds[1]);
+    return env->ThrowErrnoException(err, "fork");
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    RunForkedSnapshot(env, fds[1], filename.c_str(), options);
+  }
+  close(fds[1]);
+
+  BaseObjectPtr<HeapSnapshotForkWrap> wrap =
+      HeapSnapshotForkWrap::Create(env, pid, fds[0]);
+  if (!wrap) return;
+  Local<Object> obj = wrap->object();
+  Local<Value> filename_v;
+  if (obj->Set(env->context(),
+               env->pid_string(),
+               Integer::New(isolate, pid)).IsNothing() ||
+      !String::NewFromUtf8(isolate, filename.c_str()).ToLocal(&filename_v) ||
+      obj->Set(env->context(), env->filename_string(), filename_v)
+          .IsNothing()) {
+    return;
+  }
+  args.GetReturnValue().Set(obj);
+}
+#endif  // __linux__
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -484,12 +825,18 @@ void Initialize(Local<Object> target,
   SetMethod(context, target, "triggerHeapSnapshot", TriggerHeapSnapshot);
   SetMethod(
       context, target, "createHeapSnapshotStream", CreateHeapSnapshotStream);
+#ifdef __linux__
+  SetMethod(context, target, "forkHeapSnapshot", ForkHeapSnapshot);
+#endif  // __linux__
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(BuildEmbedderGraph);
   registry->Register(TriggerHeapSnapshot);
   registry->Register(CreateHeapSnapshotStream);
+#ifdef __linux__
+  registry->Register(ForkHeapSnapshot);
+#endif  // __linux__
 }
 
 }  // namespace heap
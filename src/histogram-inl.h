@@ -7,6 +7,9 @@
 #include "base_object-inl.h"
 #include "node_internals.h"
 
+#include <utility>
+#include <vector>
+
 namespace node {
 
 void Histogram::Reset() {
@@ -18,17 +21,38 @@ void Histogram::Reset() {
 }
 
 double Histogram::Add(const Histogram& other) {
+  // Copy the recorded buckets of other first, so that only one mutex is held
+  // at a time.
+  std::vector<std::pair<int64_t, int64_t>> values;
+  size_t count;
+  size_t exceeds;
+  uint64_t prev;
+  {
+    Mutex::ScopedLock lock(other.mutex_);
+    hdr_iter iter;
+    hdr_iter_recorded_init(&iter, other.histogram_.get());
+    while (hdr_iter_next(&iter))
+      values.emplace_back(iter.value, iter.count);
+    count = other.count_.load(std::memory_order_relaxed);
+    exceeds = other.exceeds_.load(std::memory_order_relaxed);
+    prev = other.prev_;
+  }
+
   Mutex::ScopedLock lock(mutex_);
-  count_ += other.count_;
-  exceeds_ += other.exceeds_;
-  if (other.prev_ > prev_)
-    prev_ = other.prev_;
-  return static_cast<double>(hdr_add(histogram_.get(), other.histogram_.get()));
+  count_.fetch_add(count, std::memory_order_relaxed);
+  exceeds_.fetch_add(exceeds, std::memory_order_relaxed);
+  if (prev > prev_)
+    prev_ = prev;
+  int64_t dropped = 0;
+  for (const auto& [value, value_count] : values) {
+    if (!RecordValues(value, value_count))
+      dropped += value_count;
+  }
+  return static_cast<double>(dropped);
 }
 
 size_t Histogram::Count() const {
-  Mutex::ScopedLock lock(mutex_);
-  return count_;
+  return count_.load(std::memory_order_relaxed);
 }
 
 int64_t Histogram::Min() const {
@@ -69,13 +93,24 @@ void Histogram::Percentiles(Iterator&& fn) {
   }
 }
 
+bool Histogram::RecordValues(int64_t value, int64_t count) {
+  return concurrent_
+      ? hdr_record_values_atomic(histogram_.get(), value, count)
+      : hdr_record_values(histogram_.get(), value, count);
+}
+
 bool Histogram::Record(int64_t value) {
-  Mutex::ScopedLock lock(mutex_);
-  bool recorded = hdr_record_value(histogram_.get(), value);
+  bool recorded;
+  if (concurrent_) {
+    recorded = hdr_record_value_atomic(histogram_.get(), value);
+  } else {
+    Mutex::ScopedLock lock(mutex_);
+    recorded = hdr_record_value(histogram_.get(), value);
+  }
   if (!recorded)
-    exceeds_++;
+    exceeds_.fetch_add(1, std::memory_order_relaxed);
   else
-    count_++;
+    count_.fetch_add(1, std::memory_order_relaxed);
   return recorded;
 }
 
@@ -86,10 +121,10 @@ uint64_t Histogram::RecordDelta() {
   if (prev_ > 0) {
     CHECK_GE(time, prev_);
     delta = time - prev_;
-    if (hdr_record_value(histogram_.get(), delta))
-      count_++;
+    if (RecordValues(delta, 1))
+      count_.fetch_add(1, std::memory_order_relaxed);
     else
-      exceeds_++;
+      exceeds_.fetch_add(1, std::memory_order_relaxed);
   }
   prev_ = time;
   return delta;
@@ -2,9 +2,13 @@
 #include "base_object-inl.h"
 #include "histogram-inl.h"
 #include "memory_tracker-inl.h"
+#include "node_buffer.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "util.h"
+#include "zlib.h"
+
+#include <cstring>
 
 namespace node {
 
@@ -26,7 +30,42 @@ using v8::String;
 using v8::Uint32;
 using v8::Value;
 
-Histogram::Histogram(const Options& options) {
+namespace {
+// Cookies of the V2 encodings, as written by HdrHistogram_c.
+constexpr uint32_t kHdrV2EncodingCookie = 0x1c849303 | 0x10;
+constexpr uint32_t kHdrV2CompressedEncodingCookie = 0x1c849304 | 0x10;
+constexpr size_t kHdrV2HeaderSize = 40;
+constexpr size_t kHdrV2CompressedHeaderSize = 8;
+
+void WriteBigEndian(uint8_t* dst, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++)
+    dst[i] = static_cast<uint8_t>(value >> (8 * (bytes - i - 1)));
+}
+
+void AppendBigEndian(std::vector<uint8_t>* out, uint64_t value, size_t bytes) {
+  size_t offset = out->size();
+  out->resize(offset + bytes);
+  WriteBigEndian(out->data() + offset, value, bytes);
+}
+
+// ZigZag LEB128, where the ninth byte carries eight bits.
+void AppendZigZag(std::vector<uint8_t>* out, int64_t value) {
+  uint64_t bits = (static_cast<uint64_t>(value) << 1) ^
+                  static_cast<uint64_t>(value >> 63);
+  for (int i = 0; i < 8; i++) {
+    if (bits < 0x80) {
+      out->push_back(static_cast<uint8_t>(bits));
+      return;
+    }
+    out->push_back(static_cast<uint8_t>((bits & 0x7f) | 0x80));
+    bits >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(bits));
+}
+}  // namespace
+
+Histogram::Histogram(const Options& options)
+    : concurrent_(options.concurrent) {
   hdr_histogram* histogram;
   CHECK_EQ(0, hdr_init(options.lowest,
                        options.highest,
@@ -35,6 +74,62 @@ Histogram::Histogram(const Options& options) {
   histogram_.reset(histogram);
 }
 
+bool Histogram::Encode(std::vector<uint8_t>* out) const {
+  std::vector<uint8_t> encoded;
+  {
+    Mutex::ScopedLock lock(mutex_);
+    const hdr_histogram* h = histogram_.get();
+    int32_t counts_limit = h->counts_len;
+    while (counts_limit > 0 && h->counts[counts_limit - 1] == 0)
+      counts_limit--;
+
+    encoded.reserve(kHdrV2HeaderSize + counts_limit);
+    AppendBigEndian(&encoded, kHdrV2EncodingCookie, 4);
+    // The payload length is filled in once the counts are encoded.
+    AppendBigEndian(&encoded, 0, 4);
+    AppendBigEndian(&encoded, h->normalizing_index_offset, 4);
+    AppendBigEndian(&encoded, h->significant_figures, 4);
+    AppendBigEndian(&encoded, h->lowest_discernible_value, 8);
+    AppendBigEndian(&encoded, h->highest_trackable_value, 8);
+    uint64_t conversion_ratio_bits;
+    memcpy(&conversion_ratio_bits, &h->conversion_ratio, sizeof(double));
+    AppendBigEndian(&encoded, conversion_ratio_bits, 8);
+
+    // Runs of empty buckets are written as their negated length.
+    for (int32_t i = 0; i < counts_limit;) {
+      int64_t count = h->counts[i++];
+      if (count == 0) {
+        int64_t zeros = 1;
+        while (i < counts_limit && h->counts[i] == 0) {
+          zeros++;
+          i++;
+        }
+        count = -zeros;
+      }
+      AppendZigZag(&encoded, count);
+    }
+  }
+  WriteBigEndian(
+      encoded.data() + 4, encoded.size() - kHdrV2HeaderSize, 4);
+
+  size_t offset = out->size();
+  uLongf compressed_size = compressBound(encoded.size());
+  out->resize(offset + kHdrV2CompressedHeaderSize + compressed_size);
+  uint8_t* dst = out->data() + offset;
+  if (compress2(dst + kHdrV2CompressedHeaderSize,
+                &compressed_size,
+                encoded.data(),
+                encoded.size(),
+                Z_DEFAULT_COMPRESSION) != Z_OK) {
+    out->resize(offset);
+    return false;
+  }
+  WriteBigEndian(dst, kHdrV2CompressedEncodingCookie, 4);
+  WriteBigEndian(dst + 4, compressed_size, 4);
+  out->resize(offset + kHdrV2CompressedHeaderSize + compressed_size);
+  return true;
+}
+
 void Histogram::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackFieldWithSize("histogram", GetMemorySize());
 }
@@ -69,6 +164,10 @@ CFunction IntervalHistogram::fast_start_(
     CFunction::Make(&IntervalHistogram::FastStart));
 CFunction IntervalHistogram::fast_stop_(
     CFunction::Make(&IntervalHistogram::FastStop));
+CFunction LoopDelayHistogram::fast_start_(
+    CFunction::Make(&LoopDelayHistogram::FastStart));
+CFunction LoopDelayHistogram::fast_stop_(
+    CFunction::Make(&LoopDelayHistogram::FastStop));
 
 void HistogramImpl::AddMethods(Isolate* isolate, Local<FunctionTemplate> tmpl) {
   // TODO(@jasnell): The bigint API variations do not yet support fast
@@ -82,6 +181,7 @@ void HistogramImpl::AddMethods(Isolate* isolate, Local<FunctionTemplate> tmpl) {
   SetProtoMethodNoSideEffect(isolate, tmpl, "percentiles", GetPercentiles);
   SetProtoMethodNoSideEffect(
       isolate, tmpl, "percentilesBigInt", GetPercentilesBigInt);
+  SetProtoMethodNoSideEffect(isolate, tmpl, "encode", DoEncode);
   auto instance = tmpl->InstanceTemplate();
   SetFastMethodNoSideEffect(
       isolate, instance, "count", GetCount, &fast_get_count_);
@@ -116,6 +216,7 @@ void HistogramImpl::RegisterExternalReferences(
   registry->Register(GetPercentileBigInt);
   registry->Register(GetPercentiles);
   registry->Register(GetPercentilesBigInt);
+  registry->Register(DoEncode);
   registry->Register(DoReset);
   registry->Register(fast_reset_.GetTypeInfo());
   registry->Register(fast_get_count_.GetTypeInfo());
@@ -208,9 +309,12 @@ void HistogramBase::Add(const FunctionCallbackInfo<Value>& args) {
   HistogramBase* histogram;
   ASSIGN_OR_RETURN_UNWRAP(&histogram, args.This());
 
-  CHECK(GetConstructorTemplate(env->isolate_data())->HasInstance(args[0]));
-  HistogramBase* other;
-  ASSIGN_OR_RETURN_UNWRAP(&other, args[0]);
+  // Histograms received from other threads share the Histogram they were
+  // cloned from, so any of them can be added here.
+  CHECK(GetConstructorTemplate(env->isolate_data())->HasInstance(args[0]) ||
+        IntervalHistogram::GetConstructorTemplate(env)->HasInstance(args[0]) ||
+        LoopDelayHistogram::GetConstructorTemplate(env)->HasInstance(args[0]));
+  HistogramImpl* other = HistogramImpl::FromJSObject(args[0]);
 
   double count = (*histogram)->Add(*(other->histogram()));
   args.GetReturnValue().Set(count);
@@ -250,6 +354,7 @@ void HistogramBase::New(const FunctionCallbackInfo<Value>& args) {
   CHECK_IMPLIES(!args[0]->IsNumber(), args[0]->IsBigInt());
   CHECK_IMPLIES(!args[1]->IsNumber(), args[1]->IsBigInt());
   CHECK(args[2]->IsUint32());
+  CHECK_IMPLIES(!args[3]->IsUndefined(), args[3]->IsBoolean());
 
   int64_t lowest = 1;
   int64_t highest = std::numeric_limits<int64_t>::max();
@@ -269,8 +374,9 @@ void HistogramBase::New(const FunctionCallbackInfo<Value>& args) {
   }
 
   int32_t figures = args[2].As<Uint32>()->Value();
+  bool concurrent = args[3]->IsTrue();
   new HistogramBase(env, args.This(), Histogram::Options {
-    lowest, highest, figures
+    lowest, highest, figures, concurrent
   });
 }
 
@@ -456,6 +562,132 @@ void IntervalHistogram::FastStop(Local<Value> receiver) {
   histogram->OnStop();
 }
 
+Local<FunctionTemplate> LoopDelayHistogram::GetConstructorTemplate(
+    Environment* env) {
+  Local<FunctionTemplate> tmpl = env->loopdelayhistogram_constructor_template();
+  if (tmpl.IsEmpty()) {
+    Isolate* isolate = env->isolate();
+    tmpl = NewFunctionTemplate(isolate, nullptr);
+    tmpl->Inherit(HandleWrap::GetConstructorTemplate(env));
+    tmpl->SetClassName(OneByteString(isolate, "Histogram"));
+    auto instance = tmpl->InstanceTemplate();
+    instance->SetInternalFieldCount(HistogramImpl::kInternalFieldCount);
+    HistogramImpl::AddMethods(isolate, tmpl);
+    SetFastMethod(isolate, instance, "start", Start, &fast_start_);
+    SetFastMethod(isolate, instance, "stop", Stop, &fast_stop_);
+    env->set_loopdelayhistogram_constructor_template(tmpl);
+  }
+  return tmpl;
+}
+
+void LoopDelayHistogram::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(Start);
+  registry->Register(Stop);
+  registry->Register(fast_start_.GetTypeInfo());
+  registry->Register(fast_stop_.GetTypeInfo());
+  registry->Register(FastStart);
+  registry->Register(FastStop);
+  HistogramImpl::RegisterExternalReferences(registry);
+}
+
+LoopDelayHistogram::LoopDelayHistogram(
+    Environment* env,
+    Local<Object> wrap,
+    const Histogram::Options& options)
+    : HandleWrap(
+          env,
+          wrap,
+          reinterpret_cast<uv_handle_t*>(&prepare_),
+          AsyncWrap::PROVIDER_ELDHISTOGRAM),
+      HistogramImpl(options) {
+  MakeWeak();
+  wrap->SetAlignedPointerInInternalField(
+      HistogramImpl::InternalFields::kImplField,
+      static_cast<HistogramImpl*>(this));
+  uv_prepare_init(env->event_loop(), &prepare_);
+}
+
+BaseObjectPtr<LoopDelayHistogram> LoopDelayHistogram::Create(
+    Environment* env,
+    const Histogram::Options& options) {
+  Local<Object> obj;
+  if (!GetConstructorTemplate(env)
+          ->InstanceTemplate()
+          ->NewInstance(env->context()).ToLocal(&obj)) {
+    return BaseObjectPtr<LoopDelayHistogram>();
+  }
+
+  return MakeBaseObject<LoopDelayHistogram>(env, obj, options);
+}
+
+void LoopDelayHistogram::PrepareCB(uv_prepare_t* handle) {
+  LoopDelayHistogram* histogram =
+      ContainerOf(&LoopDelayHistogram::prepare_, handle);
+
+  uint64_t now = uv_hrtime();
+  uint64_t idle_time = uv_metrics_idle_time(handle->loop);
+  if (histogram->prev_prepare_time_ != 0) {
+    // The previous poll returned once it had been blocked for as long as the
+    // idle time grew since it was prepared.
+    uint64_t poll_end = histogram->prev_prepare_time_ +
+                        (idle_time - histogram->prev_idle_time_);
+    if (now > poll_end)
+      histogram->histogram()->Record(now - poll_end);
+  }
+  histogram->prev_prepare_time_ = now;
+  histogram->prev_idle_time_ = idle_time;
+}
+
+void LoopDelayHistogram::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("histogram", histogram());
+}
+
+void LoopDelayHistogram::OnStart(bool reset) {
+  if (enabled_ || IsHandleClosing()) return;
+  enabled_ = true;
+  if (reset)
+    histogram()->Reset();
+  prev_prepare_time_ = 0;
+  uv_prepare_start(&prepare_, PrepareCB);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&prepare_));
+}
+
+void LoopDelayHistogram::OnStop() {
+  if (!enabled_ || IsHandleClosing()) return;
+  enabled_ = false;
+  uv_prepare_stop(&prepare_);
+}
+
+void LoopDelayHistogram::Start(const FunctionCallbackInfo<Value>& args) {
+  LoopDelayHistogram* histogram;
+  ASSIGN_OR_RETURN_UNWRAP(&histogram, args.This());
+  histogram->OnStart(args[0]->IsTrue());
+}
+
+void LoopDelayHistogram::FastStart(Local<Value> receiver, bool reset) {
+  LoopDelayHistogram* histogram;
+  ASSIGN_OR_RETURN_UNWRAP(&histogram, receiver);
+  histogram->OnStart(reset);
+}
+
+void LoopDelayHistogram::Stop(const FunctionCallbackInfo<Value>& args) {
+  LoopDelayHistogram* histogram;
+  ASSIGN_OR_RETURN_UNWRAP(&histogram, args.This());
+  histogram->OnStop();
+}
+
+void LoopDelayHistogram::FastStop(Local<Value> receiver) {
+  LoopDelayHistogram* histogram;
+  ASSIGN_OR_RETURN_UNWRAP(&histogram, receiver);
+  histogram->OnStop();
+}
+
+std::unique_ptr<worker::TransferData>
+LoopDelayHistogram::CloneForMessaging() const {
+  return std::make_unique<HistogramBase::HistogramTransferData>(histogram());
+}
+
 void HistogramImpl::GetCount(const FunctionCallbackInfo<Value>& args) {
   HistogramImpl* histogram = HistogramImpl::FromJSObject(args.This());
   double value = static_cast<double>((*histogram)->Count());
@@ -561,6 +793,21 @@ void HistogramImpl::GetPercentilesBigInt(
   });
 }
 
+void HistogramImpl::DoEncode(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  HistogramImpl* histogram = HistogramImpl::FromJSObject(args.This());
+  std::vector<uint8_t> encoded;
+  if (!(*histogram)->Encode(&encoded))
+    return THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+  Local<Object> buffer;
+  if (Buffer::Copy(env,
+                   reinterpret_cast<const char*>(encoded.data()),
+                   encoded.size())
+          .ToLocal(&buffer)) {
+    args.GetReturnValue().Set(buffer);
+  }
+}
+
 void HistogramImpl::DoReset(const FunctionCallbackInfo<Value>& args) {
   HistogramImpl* histogram = HistogramImpl::FromJSObject(args.This());
   (*histogram)->Reset();
@@ -11,10 +11,12 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <atomic>
 #include <functional>
 #include <limits>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace node {
 
@@ -28,6 +30,10 @@ class Histogram : public MemoryRetainer {
     int64_t lowest = 1;
     int64_t highest = std::numeric_limits<int64_t>::max();
     int figures = kDefaultHistogramFigures;
+    // Concurrent histograms record without taking the mutex, so that several
+    // threads sharing one histogram do not serialize on it. Readers may then
+    // observe a recording that is only partially applied.
+    bool concurrent = false;
   };
 
   explicit Histogram(const Options& options);
@@ -40,13 +46,23 @@ class Histogram : public MemoryRetainer {
   inline double Mean() const;
   inline double Stddev() const;
   inline int64_t Percentile(double percentile) const;
-  inline size_t Exceeds() const { return exceeds_; }
+  inline size_t Exceeds() const {
+    return exceeds_.load(std::memory_order_relaxed);
+  }
   inline size_t Count() const;
 
   inline uint64_t RecordDelta();
 
+  // Adds the values recorded by other, which may be this histogram or one
+  // that other threads record into. Returns the number of values that were
+  // out of range for this histogram.
   inline double Add(const Histogram& other);
 
+  // Appends the histogram in the compressed V2 encoding used by HdrHistogram
+  // logs. The base64 encoding of the result is the histogram column of a log
+  // line. Returns false if compression fails.
+  bool Encode(std::vector<uint8_t>* out) const;
+
   // Iterator is a function type that takes two doubles as argument, one for
   // percentile and one for the value at that percentile.
   template <typename Iterator>
@@ -59,11 +75,14 @@ class Histogram : public MemoryRetainer {
   SET_SELF_SIZE(Histogram)
 
  private:
+  inline bool RecordValues(int64_t value, int64_t count);
+
   using HistogramPointer = DeleteFnPtr<hdr_histogram, hdr_close>;
   HistogramPointer histogram_;
+  const bool concurrent_;
   uint64_t prev_ = 0;
-  size_t exceeds_ = 0;
-  size_t count_ = 0;
+  std::atomic<size_t> exceeds_{0};
+  std::atomic<size_t> count_{0};
   Mutex mutex_;
 };
 
@@ -100,6 +119,7 @@ class HistogramImpl {
   static void GetPercentiles(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void GetPercentilesBigInt(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void DoEncode(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   static void FastReset(v8::Local<v8::Value> receiver);
   static double FastGetCount(v8::Local<v8::Value> receiver);
@@ -259,6 +279,57 @@ class IntervalHistogram final : public HandleWrap, public HistogramImpl {
   static v8::CFunction fast_stop_;
 };
 
+// Records, in nanoseconds, how long each event loop iteration keeps the loop
+// from polling for I/O: the time from the moment poll returned to the moment
+// the next poll is prepared. Unlike an IntervalHistogram sampling loop delay,
+// it sees every stall, however short, and does not wake the loop up. It
+// relies on the loop's idle time metrics to tell when poll returned.
+class LoopDelayHistogram final : public HandleWrap, public HistogramImpl {
+ public:
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
+      Environment* env);
+
+  static BaseObjectPtr<LoopDelayHistogram> Create(
+      Environment* env,
+      const Histogram::Options& options);
+
+  LoopDelayHistogram(
+      Environment* env,
+      v8::Local<v8::Object> wrap,
+      const Histogram::Options& options = Histogram::Options {});
+
+  static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Stop(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  static void FastStart(v8::Local<v8::Value> receiver, bool reset);
+  static void FastStop(v8::Local<v8::Value> receiver);
+
+  BaseObject::TransferMode GetTransferMode() const override {
+    return TransferMode::kCloneable;
+  }
+  std::unique_ptr<worker::TransferData> CloneForMessaging() const override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(LoopDelayHistogram)
+  SET_SELF_SIZE(LoopDelayHistogram)
+
+ private:
+  static void PrepareCB(uv_prepare_t* handle);
+  void OnStart(bool reset);
+  void OnStop();
+
+  bool enabled_ = false;
+  // When the previous poll was prepared, and the loop's idle time then.
+  uint64_t prev_prepare_time_ = 0;
+  uint64_t prev_idle_time_ = 0;
+  uv_prepare_t prepare_;
+
+  static v8::CFunction fast_start_;
+  static v8::CFunction fast_stop_;
+};
+
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
@@ -7,13 +7,20 @@
 #include "node_external_reference.h"
 #include "node_file.h"
 #include "node_internals.h"
+#include "threadpoolwork-inl.h"
+#include "timer_wrap-inl.h"
 #include "util-inl.h"
 #include "v8-inspector.h"
+#include "zlib.h"
 
 #include <cinttypes>
+#include <cmath>
 #include <filesystem>
 #include <limits>
+#include <map>
 #include <sstream>
+#include <tuple>
+#include <unordered_map>
 #include "simdutf.h"
 
 namespace node {
@@ -29,6 +36,7 @@ using v8::Local;
 using v8::NewStringType;
 using v8::Object;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 
 using v8_inspector::StringView;
@@ -445,6 +453,561 @@ void V8HeapProfilerConnection::End() {
   DispatchMessage("HeapProfiler.stopSampling", nullptr, true);
 }
 
+namespace {
+
+// Just enough of the protobuf wire format to write a pprof profile.
+class ProtoWriter {
+ public:
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    buffer_.push_back(static_cast<char>(value));
+  }
+
+  void Int(int field, int64_t value) {
+    if (value == 0) return;
+    Varint(static_cast<uint64_t>(field) << 3);
+    Varint(static_cast<uint64_t>(value));
+  }
+
+  void Bytes(int field, std::string_view value) {
+    Varint(static_cast<uint64_t>(field) << 3 | 2);
+    Varint(value.size());
+    buffer_.append(value);
+  }
+
+  template <typename T>
+  void Packed(int field, const std::vector<T>& values) {
+    if (values.empty()) return;
+    ProtoWriter packed;
+    for (T value : values) packed.Varint(static_cast<uint64_t>(value));
+    Bytes(field, packed.buffer());
+  }
+
+  const std::string& buffer() const { return buffer_; }
+
+ private:
+  std::string buffer_;
+};
+
+int GzipCompress(const std::string& input, std::string* output) {
+  z_stream stream{};
+  // 16 added to the window bits selects the gzip wrapper.
+  int err = deflateInit2(&stream,
+                         Z_DEFAULT_COMPRESSION,
+                         Z_DEFLATED,
+                         15 + 16,
+                         8,
+                         Z_DEFAULT_STRATEGY);
+  if (err != Z_OK) return err;
+  output->resize(deflateBound(&stream, input.size()));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef*>(output->data());
+  stream.avail_out = output->size();
+  err = deflate(&stream, Z_FINISH);
+  output->resize(stream.total_out);
+  deflateEnd(&stream);
+  return err == Z_STREAM_END ? Z_OK : err;
+}
+
+void WriteGzippedPprof(const ProfileWindow& window, const std::string& path) {
+  std::string compressed;
+  int err = GzipCompress(EncodePprof(window), &compressed);
+  if (err != Z_OK) {
+    fprintf(stderr, "Failed to compress profile %s: %d\n",
+            path.c_str(), err);
+    return;
+  }
+  uv_buf_t buf = uv_buf_init(compressed.data(), compressed.size());
+  int ret = WriteFileSync(path.c_str(), buf);
+  if (ret != 0) {
+    char err_buf[128];
+    uv_err_name_r(ret, err_buf, sizeof(err_buf));
+    fprintf(stderr, "%s: Failed to write file %s\n", err_buf, path.c_str());
+  }
+}
+
+// Writes a window of a continuous profiler on the threadpool. The work owns
+// everything it touches, so a write that is still pending when the
+// Environment goes away is simply waited for.
+class PprofWriteWork final : public ThreadPoolWork {
+ public:
+  PprofWriteWork(Environment* env,
+                 const char* type,
+                 ProfileWindow&& window,
+                 std::string&& path)
+      : ThreadPoolWork(env, type),
+        window_(std::move(window)),
+        path_(std::move(path)) {}
+
+  void DoThreadPoolWork() override { WriteGzippedPprof(window_, path_); }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<PprofWriteWork> self(this);
+    Debug(env(),
+          DebugCategory::INSPECTOR_PROFILER,
+          "Written continuous profile to %s, status = %d\n",
+          path_,
+          status);
+  }
+
+ private:
+  ProfileWindow window_;
+  std::string path_;
+};
+
+// Copies the call tree and the CPU time per frame out of |profile|, and
+// deletes it. Returns std::nullopt if it recorded nothing worth writing.
+std::optional<ProfileWindow> FlattenCpuProfile(v8::CpuProfile* profile,
+                                               int64_t start_us,
+                                               uint64_t interval_us) {
+  ProfileWindow window;
+  window.count_type = "samples";
+  window.value_type = "cpu";
+  window.value_unit = "nanoseconds";
+  window.period_type = "cpu";
+  window.period = static_cast<int64_t>(interval_us) * 1000;
+  window.start_time_us = start_us;
+  window.duration_us = profile->GetEndTime() - profile->GetStartTime();
+
+  // Copy the call tree out, leaving out the root itself.
+  std::unordered_map<const v8::CpuProfileNode*, uint32_t> indices;
+  std::vector<std::pair<const v8::CpuProfileNode*, uint32_t>> stack;
+  const v8::CpuProfileNode* root = profile->GetTopDownRoot();
+  for (int i = 0; i < root->GetChildrenCount(); i++)
+    stack.emplace_back(root->GetChild(i), ProfileWindow::kNoParent);
+  while (!stack.empty()) {
+    auto [node, parent] = stack.back();
+    stack.pop_back();
+    uint32_t index = static_cast<uint32_t>(window.frames.size());
+    indices.emplace(node, index);
+    window.frames.push_back(
+        ProfileWindow::Frame{node->GetFunctionNameStr(),
+                             node->GetScriptResourceNameStr(),
+                             node->GetLineNumber(),
+                             node->GetColumnNumber(),
+                             parent});
+    for (int i = 0; i < node->GetChildrenCount(); i++)
+      stack.emplace_back(node->GetChild(i), index);
+  }
+
+  // Attribute to each sample the time until the next one. Idle samples are
+  // dropped since they are not CPU time.
+  std::vector<ProfileWindow::Sample> samples(window.frames.size(),
+                                             ProfileWindow::Sample{0, 0, 0});
+  int count = profile->GetSamplesCount();
+  for (int i = 0; i < count; i++) {
+    auto it = indices.find(profile->GetSample(i));
+    if (it == indices.end()) continue;
+    if (window.frames[it->second].function_name == "(idle)") continue;
+    int64_t next = i + 1 < count ? profile->GetSampleTimestamp(i + 1)
+                                 : profile->GetEndTime();
+    ProfileWindow::Sample& sample = samples[it->second];
+    sample.frame = it->second;
+    sample.count++;
+    sample.value += (next - profile->GetSampleTimestamp(i)) * 1000;
+  }
+  profile->Delete();
+
+  for (const ProfileWindow::Sample& sample : samples) {
+    if (sample.count > 0) window.samples.push_back(sample);
+  }
+  if (window.samples.empty()) return std::nullopt;
+  return window;
+}
+
+}  // namespace
+
+ContinuousCpuProfiler::ContinuousCpuProfiler(Environment* env,
+                                             std::string directory,
+                                             uint64_t interval_us,
+                                             uint64_t window_ms)
+    : env_(env),
+      directory_(std::move(directory)),
+      interval_us_(interval_us),
+      window_ms_(window_ms) {}
+
+ContinuousCpuProfiler::~ContinuousCpuProfiler() {
+  if (profiler_ != nullptr) profiler_->Dispose();
+}
+
+void ContinuousCpuProfiler::Start() {
+  CHECK_NULL(profiler_);
+  if (!EnsureDirectory(directory_, "CPU")) return;
+  profiler_ = v8::CpuProfiler::New(env_->isolate());
+  profiler_->SetSamplingInterval(static_cast<int>(interval_us_));
+  StartWindow();
+  timer_ = std::make_unique<TimerWrapHandle>(env_, [this] {
+    std::optional<Window> window = Rotate(true);
+    if (!window.has_value()) return;
+    (new PprofWriteWork(
+         env_, "cpuprofile", std::move(window.value()), NextPath()))
+        ->ScheduleWork();
+  });
+  timer_->Update(window_ms_, window_ms_);
+  timer_->Unref();
+}
+
+void ContinuousCpuProfiler::End() {
+  Debug(env_,
+        DebugCategory::INSPECTOR_PROFILER,
+        "ContinuousCpuProfiler::End(), running = %d\n",
+        running_);
+  if (!running_) return;
+  timer_.reset();
+  std::optional<Window> window = Rotate(false);
+  if (window.has_value()) WriteGzippedPprof(window.value(), NextPath());
+  profiler_->Dispose();
+  profiler_ = nullptr;
+}
+
+void ContinuousCpuProfiler::StartWindow() {
+  // Bound the samples kept per window to twice what the window should
+  // produce, in case the window timer is delayed by a blocked loop.
+  uint64_t max_samples =
+      interval_us_ == 0 ? v8::CpuProfilingOptions::kNoSampleLimit
+                        : window_ms_ * 1000 / interval_us_ * 2 + 1;
+  v8::CpuProfilingOptions options(
+      v8::kLeafNodeLineNumbers,
+      static_cast<unsigned>(std::min<uint64_t>(
+          max_samples, v8::CpuProfilingOptions::kNoSampleLimit)));
+  v8::CpuProfilingResult result = profiler_->Start(std::move(options));
+  if (result.status != v8::CpuProfilingStatus::kStarted) {
+    running_ = false;
+    return;
+  }
+  current_ = result.id;
+  window_start_us_ = static_cast<int64_t>(GetCurrentTimeInMicroseconds());
+  running_ = true;
+}
+
+std::optional<ContinuousCpuProfiler::Window> ContinuousCpuProfiler::Rotate(
+    bool restart) {
+  if (!running_) return std::nullopt;
+  v8::ProfilerId id = current_;
+  int64_t start_us = window_start_us_;
+  if (restart) StartWindow();
+  v8::CpuProfile* profile = profiler_->Stop(id);
+  if (profile == nullptr) return std::nullopt;
+  return FlattenCpuProfile(profile, start_us, interval_us_);
+}
+
+std::string ContinuousCpuProfiler::NextPath() {
+  DiagnosticFilename filename(env_, "CPU", "pb.gz");
+  return (std::filesystem::path(directory_) / *filename).string();
+}
+
+CpuProfileCapture::CpuProfileCapture(Environment* env,
+                                     std::string directory,
+                                     uint64_t interval_us,
+                                     uint64_t duration_ms)
+    : env_(env),
+      directory_(std::move(directory)),
+      interval_us_(interval_us),
+      duration_ms_(duration_ms) {}
+
+CpuProfileCapture::~CpuProfileCapture() {
+  CloseSignal();
+  if (profiler_ != nullptr) profiler_->Dispose();
+}
+
+int CpuProfileCapture::WatchSignal(int signum) {
+  CHECK_NULL(signal_);
+  signal_ = new uv_signal_t();
+  CHECK_EQ(uv_signal_init(env_->event_loop(), signal_), 0);
+  signal_->data = this;
+  int err = uv_signal_start(
+      signal_,
+      [](uv_signal_t* handle, int signum) {
+        CpuProfileCapture* capture =
+            static_cast<CpuProfileCapture*>(handle->data);
+        capture->Capture(capture->duration_ms_);
+      },
+      signum);
+  if (err != 0) {
+    env_->CloseHandle(signal_, [](uv_signal_t* handle) { delete handle; });
+    signal_ = nullptr;
+    return err;
+  }
+  // Like the signals of process.report, it does not keep the process alive.
+  uv_unref(reinterpret_cast<uv_handle_t*>(signal_));
+  env_->AddCleanupHook(CleanupHook, this);
+  return 0;
+}
+
+void CpuProfileCapture::CleanupHook(void* data) {
+  static_cast<CpuProfileCapture*>(data)->CloseSignal();
+}
+
+void CpuProfileCapture::CloseSignal() {
+  if (signal_ == nullptr) return;
+  env_->RemoveCleanupHook(CleanupHook, this);
+  env_->CloseHandle(signal_, [](uv_signal_t* handle) { delete handle; });
+  signal_ = nullptr;
+}
+
+bool CpuProfileCapture::Capture(uint64_t duration_ms) {
+  if (running_) return false;
+  if (!EnsureDirectory(directory_, "CPU")) return false;
+  if (profiler_ == nullptr) {
+    profiler_ = v8::CpuProfiler::New(env_->isolate());
+    profiler_->SetSamplingInterval(static_cast<int>(interval_us_));
+  }
+
+  // Bound the samples to twice what the duration should produce, in case
+  // the timer that ends the capture is delayed by a blocked loop.
+  uint64_t max_samples =
+      interval_us_ == 0 ? v8::CpuProfilingOptions::kNoSampleLimit
+                        : duration_ms * 1000 / interval_us_ * 2 + 1;
+  v8::CpuProfilingOptions options(
+      v8::kLeafNodeLineNumbers,
+      static_cast<unsigned>(std::min<uint64_t>(
+          max_samples, v8::CpuProfilingOptions::kNoSampleLimit)));
+  v8::CpuProfilingResult result = profiler_->Start(std::move(options));
+  if (result.status != v8::CpuProfilingStatus::kStarted) return false;
+  current_ = result.id;
+  start_us_ = static_cast<int64_t>(GetCurrentTimeInMicroseconds());
+  running_ = true;
+  Debug(env_,
+        DebugCategory::INSPECTOR_PROFILER,
+        "Capturing a CPU profile for %" PRIu64 " ms\n",
+        duration_ms);
+
+  timer_ = std::make_unique<TimerWrapHandle>(env_, [this] {
+    std::optional<ProfileWindow> window = Stop();
+    if (!window.has_value()) return;
+    (new PprofWriteWork(
+         env_, "cpuprofile", std::move(window.value()), NextPath()))
+        ->ScheduleWork();
+  });
+  timer_->Update(duration_ms);
+  timer_->Unref();
+  return true;
+}
+
+void CpuProfileCapture::End() {
+  Debug(env_,
+        DebugCategory::INSPECTOR_PROFILER,
+        "CpuProfileCapture::End(), running = %d\n",
+        running_);
+  CloseSignal();
+  std::optional<ProfileWindow> window = Stop();
+  if (window.has_value()) WriteGzippedPprof(window.value(), NextPath());
+}
+
+std::optional<ProfileWindow> CpuProfileCapture::Stop() {
+  // The TimerWrap is only deleted once its handle is closed, so this is
+  // fine from the callback of the timer as well.
+  timer_.reset();
+  if (!running_) return std::nullopt;
+  running_ = false;
+  v8::CpuProfile* profile = profiler_->Stop(current_);
+  if (profile == nullptr) return std::nullopt;
+  return FlattenCpuProfile(profile, start_us_, interval_us_);
+}
+
+std::string CpuProfileCapture::NextPath() {
+  DiagnosticFilename filename(env_, "CPU", "pb.gz");
+  return (std::filesystem::path(directory_) / *filename).string();
+}
+
+std::string EncodePprof(const ProfileWindow& window) {
+  // Field numbers from perftools.profiles.Profile in pprof's profile.proto.
+  std::vector<std::string_view> strings;
+  std::unordered_map<std::string_view, int64_t> string_ids;
+  auto intern = [&](std::string_view str) {
+    auto [it, inserted] = string_ids.emplace(str, strings.size());
+    if (inserted) strings.push_back(str);
+    return it->second;
+  };
+  intern("");
+
+  ProtoWriter profile;
+  auto value_type = [&](int field, const char* type, const char* unit) {
+    ProtoWriter message;
+    message.Int(1, intern(type));
+    message.Int(2, intern(unit));
+    profile.Bytes(field, message.buffer());
+  };
+  value_type(1, window.count_type, "count");
+  value_type(1, window.value_type, window.value_unit);
+
+  // Frames of the same function in different call paths share one function
+  // and one location, using the same id for both.
+  std::map<std::tuple<std::string_view, std::string_view, int, int>, uint64_t>
+      function_ids;
+  std::vector<uint64_t> frame_functions(window.frames.size());
+  std::vector<const ProfileWindow::Frame*> functions;
+  for (size_t i = 0; i < window.frames.size(); i++) {
+    const ProfileWindow::Frame& frame = window.frames[i];
+    auto [it, inserted] = function_ids.emplace(
+        std::make_tuple(std::string_view(frame.function_name),
+                        std::string_view(frame.url),
+                        frame.line,
+                        frame.column),
+        functions.size() + 1);
+    if (inserted) functions.push_back(&frame);
+    frame_functions[i] = it->second;
+  }
+
+  for (const ProfileWindow::Sample& sample : window.samples) {
+    std::vector<uint64_t> location_ids;
+    for (uint32_t frame = sample.frame; frame != ProfileWindow::kNoParent;
+         frame = window.frames[frame].parent) {
+      location_ids.push_back(frame_functions[frame]);
+    }
+    ProtoWriter message;
+    message.Packed(1, location_ids);
+    message.Packed(2, std::vector<int64_t>{sample.count, sample.value});
+    profile.Bytes(2, message.buffer());
+  }
+
+  for (size_t i = 0; i < functions.size(); i++) {
+    const ProfileWindow::Frame& frame = *functions[i];
+    uint64_t id = i + 1;
+    ProtoWriter line;
+    line.Int(1, id);
+    line.Int(2, frame.line);
+    line.Int(3, frame.column);
+    ProtoWriter location;
+    location.Int(1, id);
+    location.Bytes(4, line.buffer());
+    profile.Bytes(4, location.buffer());
+  }
+
+  for (size_t i = 0; i < functions.size(); i++) {
+    const ProfileWindow::Frame& frame = *functions[i];
+    int64_t name = intern(frame.function_name.empty()
+                              ? std::string_view("(anonymous)")
+                              : std::string_view(frame.function_name));
+    ProtoWriter function;
+    function.Int(1, i + 1);
+    function.Int(2, name);
+    function.Int(3, name);
+    function.Int(4, intern(frame.url));
+    function.Int(5, frame.line);
+    profile.Bytes(5, function.buffer());
+  }
+
+  // The period type is interned before the string table is written out.
+  ProtoWriter period_type;
+  period_type.Int(1, intern(window.period_type));
+  period_type.Int(2, intern(window.value_unit));
+  for (std::string_view str : strings) profile.Bytes(6, str);
+  profile.Int(9, window.start_time_us * 1000);
+  profile.Int(10, window.duration_us * 1000);
+  profile.Bytes(11, period_type.buffer());
+  profile.Int(12, window.period);
+  return profile.buffer();
+}
+
+ContinuousHeapProfiler::ContinuousHeapProfiler(Environment* env,
+                                               std::string directory,
+                                               uint64_t interval_bytes,
+                                               uint64_t window_ms)
+    : env_(env),
+      directory_(std::move(directory)),
+      interval_bytes_(interval_bytes),
+      window_ms_(window_ms) {}
+
+ContinuousHeapProfiler::~ContinuousHeapProfiler() {
+  if (running_) env_->isolate()->GetHeapProfiler()->StopSamplingHeapProfiler();
+}
+
+void ContinuousHeapProfiler::Start() {
+  CHECK(!running_);
+  if (!EnsureDirectory(directory_, "heap")) return;
+  v8::HeapProfiler* profiler = env_->isolate()->GetHeapProfiler();
+  if (!profiler->StartSamplingHeapProfiler(interval_bytes_)) return;
+  running_ = true;
+  window_start_us_ = static_cast<int64_t>(GetCurrentTimeInMicroseconds());
+  timer_ = std::make_unique<TimerWrapHandle>(env_, [this] {
+    std::optional<ProfileWindow> window = Collect();
+    if (!window.has_value()) return;
+    (new PprofWriteWork(
+         env_, "heapprofile", std::move(window.value()), NextPath()))
+        ->ScheduleWork();
+  });
+  timer_->Update(window_ms_, window_ms_);
+  timer_->Unref();
+}
+
+void ContinuousHeapProfiler::End() {
+  Debug(env_,
+        DebugCategory::INSPECTOR_PROFILER,
+        "ContinuousHeapProfiler::End(), running = %d\n",
+        running_);
+  if (!running_) return;
+  timer_.reset();
+  std::optional<ProfileWindow> window = Collect();
+  if (window.has_value()) WriteGzippedPprof(window.value(), NextPath());
+  env_->isolate()->GetHeapProfiler()->StopSamplingHeapProfiler();
+  running_ = false;
+}
+
+std::optional<ProfileWindow> ContinuousHeapProfiler::Collect() {
+  HandleScope handle_scope(env_->isolate());
+  std::unique_ptr<v8::AllocationProfile> profile(
+      env_->isolate()->GetHeapProfiler()->GetAllocationProfile());
+  if (!profile) return std::nullopt;
+
+  int64_t now_us = static_cast<int64_t>(GetCurrentTimeInMicroseconds());
+  ProfileWindow window;
+  window.count_type = "inuse_objects";
+  window.value_type = "inuse_space";
+  window.value_unit = "bytes";
+  window.period_type = "space";
+  window.period = static_cast<int64_t>(interval_bytes_);
+  window.start_time_us = window_start_us_;
+  window.duration_us = now_us - window_start_us_;
+  window_start_us_ = now_us;
+
+  // V8 samples an allocation of `size` bytes with probability
+  // 1 - exp(-size / interval), so each sample stands for 1 / that many
+  // allocations of its size.
+  const double interval = static_cast<double>(interval_bytes_);
+  std::vector<std::pair<v8::AllocationProfile::Node*, uint32_t>> stack;
+  v8::AllocationProfile::Node* root = profile->GetRootNode();
+  for (v8::AllocationProfile::Node* child : root->children)
+    stack.emplace_back(child, ProfileWindow::kNoParent);
+  while (!stack.empty()) {
+    auto [node, parent] = stack.back();
+    stack.pop_back();
+    uint32_t index = static_cast<uint32_t>(window.frames.size());
+    Utf8Value name(env_->isolate(), node->name);
+    Utf8Value url(env_->isolate(), node->script_name);
+    window.frames.push_back(ProfileWindow::Frame{name.ToString(),
+                                                 url.ToString(),
+                                                 node->line_number,
+                                                 node->column_number,
+                                                 parent});
+    ProfileWindow::Sample sample{index, 0, 0};
+    for (const v8::AllocationProfile::Allocation& allocation :
+         node->allocations) {
+      double scale =
+          interval > 0 ? 1 / (1 - std::exp(-allocation.size / interval)) : 1;
+      sample.count += static_cast<int64_t>(allocation.count * scale);
+      sample.value +=
+          static_cast<int64_t>(allocation.count * allocation.size * scale);
+    }
+    if (sample.count > 0) window.samples.push_back(sample);
+    for (v8::AllocationProfile::Node* child : node->children)
+      stack.emplace_back(child, index);
+  }
+
+  if (window.samples.empty()) return std::nullopt;
+  return window;
+}
+
+std::string ContinuousHeapProfiler::NextPath() {
+  DiagnosticFilename filename(env_, "Heap", "pb.gz");
+  return (std::filesystem::path(directory_) / *filename).string();
+}
+
 // For now, we only support coverage profiling, but we may add more
 // in the future.
 static void EndStartedProfilers(Environment* env) {
@@ -464,6 +1027,41 @@ static void EndStartedProfilers(Environment* env) {
   if (connection != nullptr) {
     connection->End();
   }
+
+  ContinuousCpuProfiler* continuous = env->continuous_cpu_profiler();
+  if (continuous != nullptr) {
+    continuous->End();
+  }
+
+  ContinuousHeapProfiler* continuous_heap = env->continuous_heap_profiler();
+  if (continuous_heap != nullptr) {
+    continuous_heap->End();
+  }
+
+  CpuProfileCapture* capture = env->cpu_profile_capture();
+  if (capture != nullptr) {
+    capture->End();
+  }
+}
+
+static CpuProfileCapture* GetOrCreateCpuProfileCapture(Environment* env) {
+  if (env->cpu_profile_capture() == nullptr) {
+    const std::string& dir = env->options()->cpu_prof_dir;
+    env->set_cpu_profile_capture(std::make_unique<CpuProfileCapture>(
+        env,
+        dir.empty() ? Environment::GetCwd(env->exec_path()) : dir,
+        env->options()->cpu_prof_interval,
+        env->options()->cpu_prof_duration));
+  }
+  return env->cpu_profile_capture();
+}
+
+// Returns the number of the signal called |name|, such as "SIGUSR2", or 0.
+static int GetSignalNumber(const std::string& name) {
+  for (int signum = 1; signum < 64; signum++) {
+    if (name == signo_string(signum)) return signum;
+  }
+  return 0;
 }
 
 void StartProfilers(Environment* env) {
@@ -494,6 +1092,33 @@ void StartProfilers(Environment* env) {
         std::make_unique<V8CpuProfilerConnection>(env));
     env->cpu_profiler_connection()->Start();
   }
+  if (env->options()->cpu_prof_continuous) {
+    const std::string& dir = env->options()->cpu_prof_dir;
+    uint64_t interval = env->options()->cpu_prof_interval;
+    if (interval == EnvironmentOptions::kDefaultCpuProfInterval)
+      interval = EnvironmentOptions::kDefaultContinuousCpuProfInterval;
+    env->set_continuous_cpu_profiler(std::make_unique<ContinuousCpuProfiler>(
+        env,
+        dir.empty() ? Environment::GetCwd(env->exec_path()) : dir,
+        interval,
+        env->options()->cpu_prof_window));
+    env->continuous_cpu_profiler()->Start();
+  }
+  if (!env->options()->cpu_prof_signal.empty()) {
+    const std::string& name = env->options()->cpu_prof_signal;
+    int signum = GetSignalNumber(name);
+    int err = signum == 0
+                  ? UV_EINVAL
+                  : GetOrCreateCpuProfileCapture(env)->WatchSignal(signum);
+    if (err != 0) {
+      char err_buf[128];
+      uv_err_name_r(err, err_buf, sizeof(err_buf));
+      fprintf(stderr,
+              "%s: Failed to watch %s for --cpu-prof-signal\n",
+              err_buf,
+              name.c_str());
+    }
+  }
   if (env->options()->heap_prof) {
     const std::string& dir = env->options()->heap_prof_dir;
     env->set_heap_prof_interval(env->options()->heap_prof_interval);
@@ -509,6 +1134,15 @@ void StartProfilers(Environment* env) {
         std::make_unique<profiler::V8HeapProfilerConnection>(env));
     env->heap_profiler_connection()->Start();
   }
+  if (env->options()->heap_prof_continuous) {
+    const std::string& dir = env->options()->heap_prof_dir;
+    env->set_continuous_heap_profiler(std::make_unique<ContinuousHeapProfiler>(
+        env,
+        dir.empty() ? Environment::GetCwd(env->exec_path()) : dir,
+        env->options()->heap_prof_interval,
+        env->options()->heap_prof_window));
+    env->continuous_heap_profiler()->Start();
+  }
 }
 
 static void SetCoverageDirectory(const FunctionCallbackInfo<Value>& args) {
@@ -556,6 +1190,21 @@ static void StopCoverage(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// captureCpuProfile([duration]) starts capturing a CPU profile of
+// |duration| milliseconds, or of --cpu-prof-duration, which is written to
+// --cpu-prof-dir once it is done. Returns false if a capture is already
+// running.
+static void CaptureCpuProfile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CpuProfileCapture* capture = GetOrCreateCpuProfileCapture(env);
+  uint64_t duration = capture->duration_ms();
+  if (!args[0]->IsUndefined()) {
+    CHECK(args[0]->IsUint32());
+    duration = args[0].As<Uint32>()->Value();
+  }
+  args.GetReturnValue().Set(capture->Capture(duration));
+}
+
 static void Initialize(Local<Object> target,
                        Local<Value> unused,
                        Local<Context> context,
@@ -565,6 +1214,7 @@ static void Initialize(Local<Object> target,
       context, target, "setSourceMapCacheGetter", SetSourceMapCacheGetter);
   SetMethod(context, target, "takeCoverage", TakeCoverage);
   SetMethod(context, target, "stopCoverage", StopCoverage);
+  SetMethod(context, target, "captureCpuProfile", CaptureCpuProfile);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
@@ -572,6 +1222,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(SetSourceMapCacheGetter);
   registry->Register(TakeCoverage);
   registry->Register(StopCoverage);
+  registry->Register(CaptureCpuProfile);
 }
 
 }  // namespace profiler
@@ -8,13 +8,17 @@
 #endif
 
 #include <optional>
+#include <string>
 #include <unordered_set>
+#include <vector>
 #include "inspector_agent.h"
 #include "simdjson.h"
+#include "v8-profiler.h"
 
 namespace node {
 // Forward declaration to break recursive dependency chain with src/env.h.
 class Environment;
+class TimerWrapHandle;
 
 namespace profiler {
 
@@ -144,6 +148,169 @@ class V8HeapProfilerConnection : public V8ProfilerConnection {
   bool ending_ = false;
 };
 
+// One window of a continuous profiler: the call tree and the samples that
+// were recorded, copied out of V8 so that they can be encoded as pprof off
+// the JS thread. Every sample has a count and one value, such as CPU time
+// or bytes.
+struct ProfileWindow {
+  struct Frame {
+    std::string function_name;
+    std::string url;
+    int line;
+    int column;
+    // Index of the parent frame, or kNoParent for the children of the root.
+    uint32_t parent;
+  };
+
+  // The samples of a window, aggregated per leaf frame.
+  struct Sample {
+    uint32_t frame;
+    int64_t count;
+    int64_t value;
+  };
+
+  static constexpr uint32_t kNoParent = static_cast<uint32_t>(-1);
+
+  // The pprof sample types. The count is always in units of "count", and
+  // the period is the sampling interval in units of the value.
+  const char* count_type;
+  const char* value_type;
+  const char* value_unit;
+  const char* period_type;
+  int64_t period;
+  // Wall clock time at which the window started.
+  int64_t start_time_us;
+  int64_t duration_us;
+  std::vector<Frame> frames;
+  std::vector<Sample> samples;
+};
+
+// Encodes a window as an uncompressed perftools.profiles.Profile message.
+std::string EncodePprof(const ProfileWindow& window);
+
+// Samples the JS thread with a v8::CpuProfiler for the lifetime of the
+// Environment, without going through an inspector session. The recorded
+// profile is rotated every window; each finished window is flattened on the
+// JS thread and then encoded as gzipped pprof and written to disk on the
+// threadpool.
+class ContinuousCpuProfiler {
+ public:
+  using Window = ProfileWindow;
+
+  ContinuousCpuProfiler(Environment* env,
+                        std::string directory,
+                        uint64_t interval_us,
+                        uint64_t window_ms);
+  ~ContinuousCpuProfiler();
+
+  ContinuousCpuProfiler(const ContinuousCpuProfiler&) = delete;
+  ContinuousCpuProfiler& operator=(const ContinuousCpuProfiler&) = delete;
+
+  void Start();
+  // Stops profiling and writes the last, possibly partial, window
+  // synchronously.
+  void End();
+
+ private:
+  void StartWindow();
+  // Stops the current window and returns it flattened, or std::nullopt if
+  // it recorded nothing worth writing. When `restart` is true, the next
+  // window is started before the current one is stopped, so that no samples
+  // are lost between the two.
+  std::optional<Window> Rotate(bool restart);
+  std::string NextPath();
+
+  Environment* env_;
+  std::string directory_;
+  uint64_t interval_us_;
+  uint64_t window_ms_;
+  v8::CpuProfiler* profiler_ = nullptr;
+  v8::ProfilerId current_ = 0;
+  int64_t window_start_us_ = 0;
+  bool running_ = false;
+  std::unique_ptr<TimerWrapHandle> timer_;
+};
+
+// Captures a CPU profile of a bounded duration on demand, when the signal
+// of --cpu-prof-signal is received or captureCpuProfile() is called, so
+// that a running process can be profiled without restarting it or opening
+// an inspector port. The profile is written like a window of
+// ContinuousCpuProfiler, as gzipped pprof on the threadpool.
+class CpuProfileCapture {
+ public:
+  CpuProfileCapture(Environment* env,
+                    std::string directory,
+                    uint64_t interval_us,
+                    uint64_t duration_ms);
+  ~CpuProfileCapture();
+
+  CpuProfileCapture(const CpuProfileCapture&) = delete;
+  CpuProfileCapture& operator=(const CpuProfileCapture&) = delete;
+
+  // Captures a profile of the default duration whenever |signum| is
+  // received. Returns a libuv error code.
+  int WatchSignal(int signum);
+  // Returns false if a capture is running already, or could not be started.
+  bool Capture(uint64_t duration_ms);
+  // Stops watching the signal, and writes a running capture synchronously.
+  void End();
+
+  uint64_t duration_ms() const { return duration_ms_; }
+
+ private:
+  static void CleanupHook(void* data);
+  void CloseSignal();
+  std::optional<ProfileWindow> Stop();
+  std::string NextPath();
+
+  Environment* env_;
+  std::string directory_;
+  uint64_t interval_us_;
+  uint64_t duration_ms_;
+  v8::CpuProfiler* profiler_ = nullptr;
+  v8::ProfilerId current_ = 0;
+  int64_t start_us_ = 0;
+  bool running_ = false;
+  uv_signal_t* signal_ = nullptr;
+  std::unique_ptr<TimerWrapHandle> timer_;
+};
+
+// Runs the V8 sampling heap profiler for the lifetime of the Environment,
+// without going through an inspector session. Every window, the sampled
+// allocations that are still alive are flattened on the JS thread and then
+// encoded as a gzipped pprof heap profile and written to disk on the
+// threadpool, like ContinuousCpuProfiler does for CPU time.
+class ContinuousHeapProfiler {
+ public:
+  ContinuousHeapProfiler(Environment* env,
+                         std::string directory,
+                         uint64_t interval_bytes,
+                         uint64_t window_ms);
+  ~ContinuousHeapProfiler();
+
+  ContinuousHeapProfiler(const ContinuousHeapProfiler&) = delete;
+  ContinuousHeapProfiler& operator=(const ContinuousHeapProfiler&) = delete;
+
+  void Start();
+  // Writes the allocations that are alive at this point synchronously, and
+  // stops the sampling heap profiler.
+  void End();
+
+ private:
+  // Returns the allocations that are alive now, or std::nullopt if there
+  // are none.
+  std::optional<ProfileWindow> Collect();
+  std::string NextPath();
+
+  Environment* env_;
+  std::string directory_;
+  uint64_t interval_bytes_;
+  uint64_t window_ms_;
+  int64_t window_start_us_ = 0;
+  bool running_ = false;
+  std::unique_ptr<TimerWrapHandle> timer_;
+};
+
 }  // namespace profiler
 }  // namespace node
 
@@ -538,6 +538,24 @@ node_api_post_finalizer(node_api_basic_env env,
 
 #endif  // NAPI_EXPERIMENTAL
 
+#ifdef NAPI_EXPERIMENTAL
+#define NODE_API_EXPERIMENTAL_HAS_FAST_CALLS
+
+// Like napi_create_function(), but optimized code calls signature->function
+// directly instead of cb when the arguments match the signature. cb is still
+// called for calls that do not match and before the caller is optimized, so
+// both must behave the same.
+NAPI_EXTERN napi_status NAPI_CDECL node_api_create_function_with_fast_call(
+    napi_env env,
+    const char* utf8name,
+    size_t length,
+    napi_callback cb,
+    const node_api_fast_call_signature* signature,
+    void* data,
+    napi_value* result);
+
+#endif  // NAPI_EXPERIMENTAL
+
 #if NAPI_VERSION >= 6
 
 // BigInt
@@ -208,4 +208,28 @@ typedef struct {
 } napi_type_tag;
 #endif  // NAPI_VERSION >= 8
 
+#ifdef NAPI_EXPERIMENTAL
+typedef enum {
+  node_api_fast_type_void,  // Only valid as a return type.
+  node_api_fast_type_bool,
+  node_api_fast_type_int32,
+  node_api_fast_type_uint32,
+  node_api_fast_type_int64,
+  node_api_fast_type_uint64,
+  node_api_fast_type_float32,
+  node_api_fast_type_float64,
+} node_api_fast_type;
+
+typedef struct {
+  // A C function that takes the receiver as a napi_value, followed by
+  // arg_count arguments of the given types, for example
+  // `double add(napi_value receiver, double a, double b)`. It is called
+  // without a napi_env and must not call into Node-API or JavaScript.
+  const void* function;
+  node_api_fast_type return_type;
+  size_t arg_count;
+  const node_api_fast_type* arg_types;
+} node_api_fast_call_signature;
+#endif  // NAPI_EXPERIMENTAL
+
 #endif  // SRC_JS_NATIVE_API_TYPES_H_
@@ -5,7 +5,9 @@
 #include "env-inl.h"
 #include "js_native_api.h"
 #include "js_native_api_v8.h"
+#include "node_metrics.h"
 #include "util-inl.h"
+#include "v8-fast-api-calls.h"
 
 #define CHECK_MAYBE_NOTHING(env, maybe, status)                                \
   RETURN_STATUS_IF_FALSE((env), !((maybe).IsNothing()), (status))
@@ -84,6 +86,68 @@ void napi_env__::InvokeFinalizerFromGC(v8impl::RefTracker* finalizer) {
 }
 
 namespace v8impl {
+
+void RefTracker::RefList::Add(RefTracker* tracker) {
+  CHECK_NULL(tracker->list_);
+  tracker->list_ = this;
+  tracker->list_index_ = trackers_.size();
+  trackers_.push_back(tracker);
+  node::metrics::runtime().napi_references->Add(1);
+}
+
+void RefTracker::RefList::Remove(RefTracker* tracker) {
+  CHECK_EQ(tracker->list_, this);
+  RefTracker* last = trackers_.back();
+  trackers_[tracker->list_index_] = last;
+  last->list_index_ = tracker->list_index_;
+  trackers_.pop_back();
+  tracker->list_ = nullptr;
+  tracker->list_index_ = kNone;
+  node::metrics::runtime().napi_references->Add(-1);
+}
+
+void RefTracker::FinalizerQueue::Push(RefTracker* tracker) {
+  if (tracker->queue_index_ != kNone) return;
+  tracker->queue_index_ = trackers_.size();
+  trackers_.push_back(tracker);
+  size_++;
+  node::metrics::runtime().napi_pending_finalizers->Add(1);
+}
+
+void RefTracker::FinalizerQueue::Remove(RefTracker* tracker) {
+  if (tracker->queue_index_ == kNone) return;
+  trackers_[tracker->queue_index_] = nullptr;
+  tracker->queue_index_ = kNone;
+  size_--;
+  node::metrics::runtime().napi_pending_finalizers->Add(-1);
+}
+
+RefTracker* RefTracker::FinalizerQueue::Pop() {
+  RefTracker* tracker = nullptr;
+  while (tracker == nullptr && head_ < trackers_.size()) {
+    tracker = trackers_[head_++];
+  }
+  if (tracker != nullptr) {
+    tracker->queue_index_ = kNone;
+    size_--;
+    node::metrics::runtime().napi_pending_finalizers->Add(-1);
+  }
+
+  // Reclaim the consumed front of the queue once it dominates, so that a
+  // queue that never runs empty does not grow without bounds.
+  if (size_ == 0) {
+    trackers_.clear();
+    head_ = 0;
+  } else if (head_ >= 1024 && head_ > trackers_.size() / 2) {
+    trackers_.erase(trackers_.begin(), trackers_.begin() + head_);
+    head_ = 0;
+    for (size_t i = 0; i < trackers_.size(); i++) {
+      if (trackers_[i] != nullptr) trackers_[i]->queue_index_ = i;
+    }
+  }
+  return tracker;
+}
+
 namespace {
 
 template <typename CCharType, typename StringMaker>
@@ -386,13 +450,18 @@ class CallbackBundle {
  public:
   // Creates an object to be made available to the static function callback
   // wrapper, used to retrieve the native callback function and data pointer.
-  static inline v8::Local<v8::Value> New(napi_env env,
-                                         napi_callback cb,
-                                         void* data) {
+  static inline v8::Local<v8::Value> New(
+      napi_env env,
+      napi_callback cb,
+      void* data,
+      std::unique_ptr<v8::CFunctionInfo> fast_call_info = nullptr,
+      std::vector<v8::CTypeInfo> fast_call_args = {}) {
     CallbackBundle* bundle = new CallbackBundle();
     bundle->cb = cb;
     bundle->cb_data = data;
     bundle->env = env;
+    bundle->fast_call_info = std::move(fast_call_info);
+    bundle->fast_call_args = std::move(fast_call_args);
 
     v8::Local<v8::Value> cbdata = v8::External::New(env->isolate, bundle);
     ReferenceWithFinalizer::New(
@@ -408,6 +477,10 @@ class CallbackBundle {
   napi_env env;   // Necessary to invoke C++ NAPI callback
   void* cb_data;  // The user provided callback data
   napi_callback cb;
+  // The type information of a fast call, which V8 keeps pointers to for as
+  // long as the function exists. fast_call_info points into fast_call_args.
+  std::unique_ptr<v8::CFunctionInfo> fast_call_info;
+  std::vector<v8::CTypeInfo> fast_call_args;
 
  private:
   static void Delete(napi_env env, void* data, void* hint) {
@@ -416,6 +489,42 @@ class CallbackBundle {
   }
 };
 
+// Maps a Node-API fast call type to the V8 type. Returns false for types that
+// are not valid in that position.
+inline bool FastCallType(node_api_fast_type type,
+                         bool is_return,
+                         v8::CTypeInfo* result) {
+  using Type = v8::CTypeInfo::Type;
+  switch (type) {
+    case node_api_fast_type_void:
+      if (!is_return) return false;
+      *result = v8::CTypeInfo(Type::kVoid);
+      return true;
+    case node_api_fast_type_bool:
+      *result = v8::CTypeInfo(Type::kBool);
+      return true;
+    case node_api_fast_type_int32:
+      *result = v8::CTypeInfo(Type::kInt32);
+      return true;
+    case node_api_fast_type_uint32:
+      *result = v8::CTypeInfo(Type::kUint32);
+      return true;
+    case node_api_fast_type_int64:
+      *result = v8::CTypeInfo(Type::kInt64);
+      return true;
+    case node_api_fast_type_uint64:
+      *result = v8::CTypeInfo(Type::kUint64);
+      return true;
+    case node_api_fast_type_float32:
+      *result = v8::CTypeInfo(Type::kFloat32);
+      return true;
+    case node_api_fast_type_float64:
+      *result = v8::CTypeInfo(Type::kFloat64);
+      return true;
+  }
+  return false;
+}
+
 // Wraps up v8::FunctionCallbackInfo.
 // The class must be stack allocated.
 class FunctionCallbackWrapper {
@@ -453,6 +562,57 @@ class FunctionCallbackWrapper {
     return napi_clear_last_error(env);
   }
 
+  static inline napi_status NewFastFunction(
+      napi_env env,
+      napi_callback cb,
+      const node_api_fast_call_signature* signature,
+      void* cb_data,
+      v8::Local<v8::Function>* result) {
+    v8::CTypeInfo return_info(v8::CTypeInfo::Type::kVoid);
+    RETURN_STATUS_IF_FALSE(
+        env,
+        FastCallType(signature->return_type, true, &return_info),
+        napi_invalid_arg);
+    RETURN_STATUS_IF_FALSE(
+        env, signature->arg_count < INT_MAX, napi_invalid_arg);
+
+    // The receiver comes first.
+    std::vector<v8::CTypeInfo> args;
+    args.reserve(signature->arg_count + 1);
+    args.emplace_back(v8::CTypeInfo::Type::kV8Value);
+    for (size_t i = 0; i < signature->arg_count; i++) {
+      v8::CTypeInfo arg(v8::CTypeInfo::Type::kVoid);
+      RETURN_STATUS_IF_FALSE(
+          env,
+          FastCallType(signature->arg_types[i], false, &arg),
+          napi_invalid_arg);
+      args.push_back(arg);
+    }
+    auto info = std::make_unique<v8::CFunctionInfo>(
+        return_info, args.size(), args.data());
+    v8::CFunction c_function(signature->function, info.get());
+
+    v8::Local<v8::Value> cbdata = v8impl::CallbackBundle::New(
+        env, cb, cb_data, std::move(info), std::move(args));
+    RETURN_STATUS_IF_FALSE(env, !cbdata.IsEmpty(), napi_generic_failure);
+
+    v8::Local<v8::FunctionTemplate> tpl =
+        v8::FunctionTemplate::New(env->isolate,
+                                  Invoke,
+                                  cbdata,
+                                  v8::Local<v8::Signature>(),
+                                  0,
+                                  v8::ConstructorBehavior::kThrow,
+                                  v8::SideEffectType::kHasSideEffect,
+                                  &c_function);
+    v8::MaybeLocal<v8::Function> maybe_function =
+        tpl->GetFunction(env->context());
+    CHECK_MAYBE_EMPTY(env, maybe_function, napi_generic_failure);
+
+    *result = maybe_function.ToLocalChecked();
+    return napi_clear_last_error(env);
+  }
+
   napi_value GetNewTarget() {
     if (cbinfo_.IsConstructCall()) {
       return v8impl::JsValueFromV8LocalValue(cbinfo_.NewTarget());
@@ -960,6 +1120,39 @@ napi_status NAPI_CDECL napi_create_function(napi_env env,
   return GET_RETURN_STATUS(env);
 }
 
+napi_status NAPI_CDECL
+node_api_create_function_with_fast_call(napi_env env,
+                                        const char* utf8name,
+                                        size_t length,
+                                        napi_callback cb,
+                                        const node_api_fast_call_signature* sig,
+                                        void* callback_data,
+                                        napi_value* result) {
+  NAPI_PREAMBLE(env);
+  CHECK_ARG(env, result);
+  CHECK_ARG(env, cb);
+  CHECK_ARG(env, sig);
+  CHECK_ARG(env, sig->function);
+  if (sig->arg_count > 0) CHECK_ARG(env, sig->arg_types);
+
+  v8::Local<v8::Function> return_value;
+  v8::EscapableHandleScope scope(env->isolate);
+  v8::Local<v8::Function> fn;
+  STATUS_CALL(v8impl::FunctionCallbackWrapper::NewFastFunction(
+      env, cb, sig, callback_data, &fn));
+  return_value = scope.Escape(fn);
+
+  if (utf8name != nullptr) {
+    v8::Local<v8::String> name_string;
+    CHECK_NEW_FROM_UTF8_LEN(env, name_string, utf8name, length);
+    return_value->SetName(name_string);
+  }
+
+  *result = v8impl::JsValueFromV8LocalValue(return_value);
+
+  return GET_RETURN_STATUS(env);
+}
+
 napi_status NAPI_CDECL
 napi_define_class(napi_env env,
                   const char* utf8name,
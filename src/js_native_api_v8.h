@@ -8,46 +8,81 @@ inline napi_status napi_clear_last_error(node_api_basic_env env);
 
 namespace v8impl {
 
-// Base class to track references and finalizers in a doubly linked list.
+// Base class to track references and finalizers. A tracker is linked into at
+// most one RefList, and may at the same time be queued in a FinalizerQueue.
 class RefTracker {
  public:
-  using RefList = RefTracker;
+  class RefList;
+  class FinalizerQueue;
 
   RefTracker() = default;
   virtual ~RefTracker() = default;
   virtual void Finalize() {}
 
-  inline void Link(RefList* list) {
-    prev_ = list;
-    next_ = list->next_;
-    if (next_ != nullptr) {
-      next_->prev_ = this;
-    }
-    list->next_ = this;
-  }
+  inline void Link(RefList* list);
+  inline void Unlink();
 
-  inline void Unlink() {
-    if (prev_ != nullptr) {
-      prev_->next_ = next_;
-    }
-    if (next_ != nullptr) {
-      next_->prev_ = prev_;
-    }
-    prev_ = nullptr;
-    next_ = nullptr;
-  }
+  static inline void FinalizeAll(RefList* list);
 
-  static void FinalizeAll(RefList* list) {
-    while (list->next_ != nullptr) {
-      list->next_->Finalize();
-    }
-  }
+ private:
+  static constexpr size_t kNone = static_cast<size_t>(-1);
+
+  RefList* list_ = nullptr;
+  size_t list_index_ = kNone;
+  size_t queue_index_ = kNone;
+};
+
+// A slab of trackers. Linking and unlinking are O(1): a tracker knows its
+// slot, and unlinking moves the last tracker into the freed slot.
+class RefTracker::RefList {
+ public:
+  size_t size() const { return trackers_.size(); }
 
  private:
-  RefList* next_ = nullptr;
-  RefList* prev_ = nullptr;
+  friend class RefTracker;
+
+  void Add(RefTracker* tracker);
+  void Remove(RefTracker* tracker);
+
+  std::vector<RefTracker*> trackers_;
 };
 
+// The finalizers that the GC has scheduled, in the order they were enqueued.
+// Removing a finalizer before it runs is O(1) and leaves a hole that Pop()
+// skips.
+class RefTracker::FinalizerQueue {
+ public:
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Does nothing if the tracker is already queued.
+  void Push(RefTracker* tracker);
+  // Does nothing if the tracker is not queued.
+  void Remove(RefTracker* tracker);
+  // Returns nullptr if the queue is empty.
+  RefTracker* Pop();
+
+ private:
+  std::vector<RefTracker*> trackers_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+void RefTracker::Link(RefList* list) {
+  list->Add(this);
+}
+
+void RefTracker::Unlink() {
+  if (list_ != nullptr) list_->Remove(this);
+}
+
+void RefTracker::FinalizeAll(RefList* list) {
+  // Finalize() unlinks the tracker, and may unlink others.
+  while (!list->trackers_.empty()) {
+    list->trackers_.back()->Finalize();
+  }
+}
+
 }  // end of namespace v8impl
 
 struct napi_env__ {
@@ -109,13 +144,13 @@ struct napi_env__ {
   // Implementation should drain the queue at the time it is safe to call
   // into JavaScript.
   virtual void EnqueueFinalizer(v8impl::RefTracker* finalizer) {
-    pending_finalizers.emplace(finalizer);
+    pending_finalizers.Push(finalizer);
   }
 
   // Remove the finalizer from the scheduled second pass weak callback queue.
   // The finalizer can be deleted after this call.
   virtual void DequeueFinalizer(v8impl::RefTracker* finalizer) {
-    pending_finalizers.erase(finalizer);
+    pending_finalizers.Remove(finalizer);
   }
 
   virtual void DeleteMe() {
@@ -152,8 +187,7 @@ struct napi_env__ {
   // have such a callback. See `~napi_env__()` above for details.
   v8impl::RefTracker::RefList reflist;
   v8impl::RefTracker::RefList finalizing_reflist;
-  // The invocation order of the finalizers is not determined.
-  std::unordered_set<v8impl::RefTracker*> pending_finalizers;
+  v8impl::RefTracker::FinalizerQueue pending_finalizers;
   napi_extended_error_info last_error;
   int open_handle_scopes = 0;
   int open_callback_scopes = 0;
@@ -26,6 +26,11 @@ class JSONWriter {
  public:
   JSONWriter(std::ostream& out, bool compact)
     : out_(out), compact_(compact) {}
+  // Continues an object at nesting level |depth| that another writer with the
+  // same |compact| setting has written members to, so that members can be
+  // rendered separately and appended to that writer's stream later.
+  JSONWriter(std::ostream& out, bool compact, int depth)
+      : out_(out), compact_(compact), indent_(depth * 2), state_(kAfterValue) {}
 
  private:
   inline void indent() { indent_ += 2; }
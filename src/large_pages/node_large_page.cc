@@ -105,7 +105,45 @@ extern char __start_lpstub;
 #endif  // defined(__linux__) || defined(__FreeBSD__)
 
 #endif  // defined(NODE_ENABLE_LARGE_CODE_PAGES) && NODE_ENABLE_LARGE_CODE_PAGES
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#endif  // defined(__linux__)
+
 namespace node {
+
+namespace {
+
+[[maybe_unused]] inline void PrintWarning(const char* warn) {
+  fprintf(stderr, "Hugepages WARNING: %s\n", warn);
+}
+
+#if defined(__linux__)
+bool IsTransparentHugePagesEnabled() {
+  // File format reference:
+  // https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/mm/huge_memory.c?id=13391c60da3308ed9980de0168f74cce6c62ac1d#n163
+  const char* filename = "/sys/kernel/mm/transparent_hugepage/enabled";
+  std::ifstream config_stream(filename, std::ios::in);
+  if (!config_stream.good()) {
+    PrintWarning("could not open /sys/kernel/mm/transparent_hugepage/enabled");
+    return false;
+  }
+
+  std::string token;
+  config_stream >> token;
+  if ("[always]" == token) return true;
+  config_stream >> token;
+  if ("[madvise]" == token) return true;
+  return false;
+}
+#endif  // defined(__linux__)
+
+}  // namespace
+
 #if defined(NODE_ENABLE_LARGE_CODE_PAGES) && NODE_ENABLE_LARGE_CODE_PAGES
 
 namespace {
@@ -126,10 +164,6 @@ inline void Debug(std::string fmt, Args&&... args) {
               std::forward<Args>(args)...);
 }
 
-inline void PrintWarning(const char* warn) {
-  fprintf(stderr, "Hugepages WARNING: %s\n", warn);
-}
-
 inline void PrintSystemError(int error) {
   PrintWarning(strerror(error));
 }
@@ -261,25 +295,7 @@ struct text_region FindNodeTextRegion() {
   return nregion;
 }
 
-#if defined(__linux__)
-bool IsTransparentHugePagesEnabled() {
-  // File format reference:
-  // https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/mm/huge_memory.c?id=13391c60da3308ed9980de0168f74cce6c62ac1d#n163
-  const char* filename = "/sys/kernel/mm/transparent_hugepage/enabled";
-  std::ifstream config_stream(filename, std::ios::in);
-  if (!config_stream.good()) {
-    PrintWarning("could not open /sys/kernel/mm/transparent_hugepage/enabled");
-    return false;
-  }
-
-  std::string token;
-  config_stream >> token;
-  if ("[always]" == token) return true;
-  config_stream >> token;
-  if ("[madvise]" == token) return true;
-  return false;
-}
-#elif defined(__FreeBSD__)
+#if defined(__FreeBSD__)
 bool IsSuperPagesEnabled() {
   // It is enabled by default on amd64.
   unsigned int super_pages = 0;
@@ -438,6 +454,142 @@ int MapStaticCodeToLargePages() {
 #endif
 }
 
+#if defined(__linux__)
+namespace {
+
+// A page allocator that works like V8's default one on Linux, but asks the
+// kernel to back regions of at least one huge page with transparent huge
+// pages. V8 reserves the code space and the old space in such regions, which
+// are then mostly covered by 2MB iTLB and dTLB entries.
+class LargePageAllocator final : public v8::PageAllocator {
+ public:
+  LargePageAllocator() : page_size_(sysconf(_SC_PAGESIZE)) {}
+
+  size_t AllocatePageSize() override { return page_size_; }
+  size_t CommitPageSize() override { return page_size_; }
+
+  // Leave the placement of the reservations, and with it their
+  // randomization, to the kernel.
+  void SetRandomMmapSeed(int64_t seed) override {}
+  void* GetRandomMmapAddr() override { return nullptr; }
+
+  void* AllocatePages(void* hint,
+                      size_t length,
+                      size_t alignment,
+                      Permission access) override {
+    // Over-reserve so that the result can be aligned, then trim the excess.
+    size_t request = length + (alignment > page_size_ ? alignment : 0);
+    void* result = mmap(hint,
+                        request,
+                        GetProtection(access),
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                        -1,
+                        0);
+    if (result == MAP_FAILED) return nullptr;
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(result);
+    uintptr_t aligned = base;
+    if (alignment > page_size_)
+      aligned = (base + alignment - 1) & ~(alignment - 1);
+    if (aligned != base)
+      munmap(result, aligned - base);
+    if (base + request != aligned + length)
+      munmap(reinterpret_cast<void*>(aligned + length),
+             base + request - aligned - length);
+
+    void* address = reinterpret_cast<void*>(aligned);
+    AdviseHugePages(address, length);
+    return address;
+  }
+
+  bool FreePages(void* address, size_t length) override {
+    return munmap(address, length) == 0;
+  }
+
+  bool ReleasePages(void* address, size_t length, size_t new_length) override {
+    return munmap(static_cast<char*>(address) + new_length,
+                  length - new_length) == 0;
+  }
+
+  bool SetPermissions(void* address,
+                      size_t length,
+                      Permission access) override {
+    if (mprotect(address, length, GetProtection(access)) != 0) return false;
+    // Give inaccessible pages back to the kernel, like V8 does.
+    if (access == kNoAccess) DiscardSystemPages(address, length);
+    return true;
+  }
+
+  bool RecommitPages(void* address,
+                     size_t length,
+                     Permission access) override {
+    return SetPermissions(address, length, access);
+  }
+
+  bool DiscardSystemPages(void* address, size_t size) override {
+    return madvise(address, size, MADV_DONTNEED) == 0;
+  }
+
+  bool DecommitPages(void* address, size_t size) override {
+    // Replacing the mapping drops the pages and zero-initializes the range.
+    void* result = mmap(address,
+                        size,
+                        PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                        -1,
+                        0);
+    if (result != address) return false;
+    AdviseHugePages(address, size);
+    return true;
+  }
+
+ private:
+  static int GetProtection(Permission access) {
+    switch (access) {
+      case kNoAccess:
+      case kNoAccessWillJitLater:
+        return PROT_NONE;
+      case kRead:
+        return PROT_READ;
+      case kReadWrite:
+        return PROT_READ | PROT_WRITE;
+      case kReadWriteExecute:
+        return PROT_READ | PROT_WRITE | PROT_EXEC;
+      case kReadExecute:
+        return PROT_READ | PROT_EXEC;
+    }
+    return PROT_NONE;
+  }
+
+  void AdviseHugePages(void* address, size_t length) {
+    // Smaller regions cannot contain an aligned huge page.
+    if (length < kHugePageSize) return;
+    madvise(address, length, MADV_HUGEPAGE);
+  }
+
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+  const size_t page_size_;
+};
+
+}  // namespace
+#endif  // defined(__linux__)
+
+std::unique_ptr<v8::PageAllocator> CreateLargePageAllocator(int* status) {
+#if defined(__linux__)
+  // The allocator does not move any code, so unlike the static code mapping
+  // it only needs transparent huge pages.
+  if (!IsTransparentHugePagesEnabled()) {
+    *status = EACCES;
+    return nullptr;
+  }
+  *status = 0;
+  return std::make_unique<LargePageAllocator>();
+#else
+  *status = ENOTSUP;
+  return nullptr;
+#endif
+}
+
 const char* LargePagesError(int status) {
   switch (status) {
     case ENOTSUP:
@@ -25,9 +25,19 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <memory>
+
+#include "v8-platform.h"
+
 namespace node {
 int MapStaticCodeToLargePages();
 const char* LargePagesError(int status);
+
+// Returns a page allocator for V8 that backs the large reservations of the
+// heap, including code space, with transparent huge pages. Returns nullptr
+// and sets |status| to one of the errors known to LargePagesError() if this
+// is not supported.
+std::unique_ptr<v8::PageAllocator> CreateLargePageAllocator(int* status);
 }  // namespace node
 
 #endif  // NODE_WANT_INTERNALS
@@ -57,7 +57,7 @@ ModuleWrap::ModuleWrap(Realm* realm,
                        Local<String> url,
                        Local<Object> context_object,
                        Local<Value> synthetic_evaluation_step)
-    : BaseObject(realm, object),
+    : SnapshotableObject(realm, object, type_int),
       module_(realm->isolate(), module),
       module_hash_(module->GetIdentityHash()) {
   realm->env()->hash_to_module_map.emplace(module_hash_, this);
@@ -142,6 +142,141 @@ v8::Maybe<bool> ModuleWrap::CheckUnsettledTopLevelAwait() {
   return v8::Just(false);
 }
 
+// Hands the whole source to V8 in a single chunk.
+class ModuleStreamingCompile::SourceStream final
+    : public ScriptCompiler::ExternalSourceStream {
+ public:
+  SourceStream(std::unique_ptr<uint8_t[]> data, size_t size)
+      : data_(std::move(data)), size_(size) {}
+
+  size_t GetMoreData(const uint8_t** src) override {
+    if (!data_) return 0;
+    *src = data_.release();
+    return size_;
+  }
+
+ private:
+  std::unique_ptr<uint8_t[]> data_;
+  size_t size_;
+};
+
+namespace {
+
+class StreamingCompileTask final : public v8::Task {
+ public:
+  explicit StreamingCompileTask(
+      std::shared_ptr<ModuleStreamingCompile> compile)
+      : compile_(std::move(compile)) {}
+
+  void Run() override { compile_->Run(); }
+
+ private:
+  std::shared_ptr<ModuleStreamingCompile> compile_;
+};
+
+}  // namespace
+
+ModuleStreamingCompile::ModuleStreamingCompile(Isolate* isolate,
+                                               Local<String> source)
+    : source_(isolate, source) {
+  // The worker thread cannot read the V8 string, so copy its contents.
+  size_t length = source->Length();
+  if (source->IsOneByte()) {
+    auto data = std::make_unique<uint8_t[]>(length);
+    source->WriteOneByte(
+        isolate, data.get(), 0, length, String::NO_NULL_TERMINATION);
+    streamed_source_ = std::make_unique<ScriptCompiler::StreamedSource>(
+        std::make_unique<SourceStream>(std::move(data), length),
+        ScriptCompiler::StreamedSource::ONE_BYTE);
+  } else {
+    size_t size = length * sizeof(uint16_t);
+    auto data = std::make_unique<uint8_t[]>(size);
+    source->Write(isolate,
+                  reinterpret_cast<uint16_t*>(data.get()),
+                  0,
+                  length,
+                  String::NO_NULL_TERMINATION);
+    streamed_source_ = std::make_unique<ScriptCompiler::StreamedSource>(
+        std::make_unique<SourceStream>(std::move(data), size),
+        ScriptCompiler::StreamedSource::TWO_BYTE);
+  }
+}
+
+std::shared_ptr<ModuleStreamingCompile> ModuleStreamingCompile::Start(
+    Isolate* isolate, Local<String> source) {
+  auto compile = std::make_shared<ModuleStreamingCompile>(isolate, source);
+  ScriptCompiler::ScriptStreamingTask* task = ScriptCompiler::StartStreaming(
+      isolate, compile->streamed_source_.get(), v8::ScriptType::kModule);
+  if (task == nullptr) return nullptr;
+  compile->task_.reset(task);
+  return compile;
+}
+
+void ModuleStreamingCompile::Run() {
+  if (claimed_.exchange(true)) return;
+  task_->Run();
+  Mutex::ScopedLock lock(mutex_);
+  done_ = true;
+  cond_.Broadcast(lock);
+}
+
+void ModuleStreamingCompile::Finish() {
+  Run();
+  Mutex::ScopedLock lock(mutex_);
+  while (!done_) cond_.Wait(lock);
+}
+
+void ModuleStreamingCompile::Cancel() {
+  if (!claimed_.exchange(true)) {
+    task_.reset();
+    return;
+  }
+  Mutex::ScopedLock lock(mutex_);
+  while (!done_) cond_.Wait(lock);
+}
+
+bool ModuleStreamingCompile::Matches(Isolate* isolate,
+                                     Local<String> source) const {
+  return source_.Get(isolate)->StringEquals(source);
+}
+
+MaybeLocal<Module> ModuleStreamingCompile::Compile(
+    Local<Context> context,
+    Local<String> source,
+    const ScriptOrigin& origin) {
+  DCHECK(done_);
+  return ScriptCompiler::CompileModule(
+      context, streamed_source_.get(), source, origin);
+}
+
+// preparseModule(url, source)
+void ModuleWrap::PreparseModule(const FunctionCallbackInfo<Value>& args) {
+  Realm* realm = Realm::GetCurrent(args);
+  Environment* env = realm->env();
+  Isolate* isolate = realm->isolate();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  Local<String> source = args[1].As<String>();
+
+  // Consuming a code cache is cheaper than parsing, even in parallel.
+  if (env->use_compile_cache()) {
+    CompileCacheEntry* entry = env->compile_cache_handler()->GetOrInsert(
+        source, args[0].As<String>(), CachedCodeType::kESM);
+    if (entry != nullptr && entry->cache != nullptr) return;
+  }
+
+  Utf8Value url(isolate, args[0]);
+  std::string key = url.ToString();
+  if (env->module_streaming_compiles.count(key) != 0) return;
+
+  std::shared_ptr<ModuleStreamingCompile> compile =
+      ModuleStreamingCompile::Start(isolate, source);
+  if (!compile) return;
+  env->module_streaming_compiles.emplace(std::move(key), compile);
+  env->isolate_data()->platform()->CallOnWorkerThread(
+      std::make_unique<StreamingCompileTask>(std::move(compile)));
+}
+
 Local<PrimitiveArray> ModuleWrap::GetHostDefinedOptions(
     Isolate* isolate, Local<Symbol> id_symbol) {
   Local<PrimitiveArray> host_defined_options =
@@ -374,6 +509,27 @@ MaybeLocal<Module> ModuleWrap::CompileSourceTextModule(
     cached_data = cache_entry->CopyCache();
   }
 
+  // Finish parsing on a worker thread that preparseModule() started, if
+  // it was for the same source.
+  std::shared_ptr<ModuleStreamingCompile> streaming_compile;
+  Environment* env = realm->env();
+  if (!env->module_streaming_compiles.empty() &&
+      !user_cached_data.has_value()) {
+    Utf8Value url_utf8(isolate, url);
+    auto it = env->module_streaming_compiles.find(url_utf8.ToString());
+    if (it != env->module_streaming_compiles.end()) {
+      streaming_compile = std::move(it->second);
+      env->module_streaming_compiles.erase(it);
+      if (cached_data == nullptr &&
+          streaming_compile->Matches(isolate, source_text)) {
+        streaming_compile->Finish();
+      } else {
+        streaming_compile->Cancel();
+        streaming_compile.reset();
+      }
+    }
+  }
+
   ScriptCompiler::Source source(source_text, origin, cached_data);
   ScriptCompiler::CompileOptions options;
   if (cached_data == nullptr) {
@@ -383,8 +539,12 @@ MaybeLocal<Module> ModuleWrap::CompileSourceTextModule(
   }
 
   Local<Module> module;
-  if (!ScriptCompiler::CompileModule(isolate, &source, options)
-           .ToLocal(&module)) {
+  MaybeLocal<Module> maybe_module =
+      streaming_compile
+          ? streaming_compile->Compile(
+                isolate->GetCurrentContext(), source_text, origin)
+          : ScriptCompiler::CompileModule(isolate, &source, options);
+  if (!maybe_module.ToLocal(&module)) {
     return scope.EscapeMaybe(MaybeLocal<Module>());
   }
 
@@ -1118,6 +1278,7 @@ void ModuleWrap::CreatePerIsolateProperties(IsolateData* isolate_data,
             target,
             "createRequiredModuleFacade",
             CreateRequiredModuleFacade);
+  SetMethod(isolate, target, "preparseModule", PreparseModule);
 }
 
 void ModuleWrap::CreatePerContextProperties(Local<Object> target,
@@ -1141,6 +1302,50 @@ void ModuleWrap::CreatePerContextProperties(Local<Object> target,
 #undef V
 }
 
+bool ModuleWrap::PrepareForSerialization(Local<Context> context,
+                                         v8::SnapshotCreator* creator) {
+  if (contextify_context_ != nullptr) {
+    Utf8Value url(env()->isolate(),
+                  object()->GetInternalField(kURLSlot).As<Value>());
+    fprintf(stderr,
+            "Cannot serialize module %s, which belongs to a vm context, "
+            "into the snapshot\n",
+            *url);
+    ABORT();
+  }
+  // The resolve cache is only used to instantiate the module. A module that
+  // has not been instantiated yet is linked again after deserialization.
+  resolve_cache_.clear();
+  // The module itself is kept alive by the wrapper's internal fields.
+  return true;
+}
+
+InternalFieldInfoBase* ModuleWrap::Serialize(int index) {
+  DCHECK_IS_SNAPSHOT_SLOT(index);
+  InternalFieldInfo* info =
+      InternalFieldInfoBase::New<InternalFieldInfo>(type());
+  return info;
+}
+
+void ModuleWrap::Deserialize(Local<Context> context,
+                             Local<Object> holder,
+                             int index,
+                             InternalFieldInfoBase* info) {
+  DCHECK_IS_SNAPSHOT_SLOT(index);
+  HandleScope scope(context->GetIsolate());
+  Realm* realm = Realm::GetCurrent(context);
+  // The internal fields were serialized along with the wrapper, re-create
+  // the native side from them.
+  Local<Module> module = holder->GetInternalField(kModuleSlot).As<Module>();
+  Local<String> url = holder->GetInternalField(kURLSlot).As<String>();
+  Local<Object> context_object =
+      holder->GetInternalField(kContextObjectSlot).As<Object>();
+  Local<Value> synthetic_evaluation_step =
+      holder->GetInternalField(kSyntheticEvaluationStepsSlot).As<Value>();
+  new ModuleWrap(
+      realm, holder, module, url, context_object, synthetic_evaluation_step);
+}
+
 void ModuleWrap::RegisterExternalReferences(
     ExternalReferenceRegistry* registry) {
   registry->Register(New);
@@ -1159,9 +1364,13 @@ void ModuleWrap::RegisterExternalReferences(
   registry->Register(GetError);
 
   registry->Register(CreateRequiredModuleFacade);
+  registry->Register(PreparseModule);
 
   registry->Register(SetImportModuleDynamicallyCallback);
   registry->Register(SetInitializeImportMetaObjectCallback);
+
+  // Synthetic modules keep a pointer to this in the snapshot.
+  registry->Register(SyntheticModuleEvaluationStepsCallback);
 }
 }  // namespace loader
 }  // namespace node
@@ -3,11 +3,15 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "base_object.h"
+#include "node_mutex.h"
+#include "node_snapshotable.h"
 #include "v8-script.h"
 
 namespace node {
@@ -33,7 +37,52 @@ enum HostDefinedOptions : int {
   kLength = 9,
 };
 
-class ModuleWrap : public BaseObject {
+// A source text module that is parsed by a V8 streaming task on a worker
+// thread ahead of its ModuleWrap, which then only has to finalize the
+// compilation. The loader starts these with preparseModule() for modules it
+// discovers while the graph is still being fetched. Compiling does not run
+// any module code, so the evaluation order is unaffected.
+class ModuleStreamingCompile {
+ public:
+  // Returns nullptr if V8 cannot stream the source.
+  static std::shared_ptr<ModuleStreamingCompile> Start(
+      v8::Isolate* isolate, v8::Local<v8::String> source);
+
+  ModuleStreamingCompile(v8::Isolate* isolate, v8::Local<v8::String> source);
+  ModuleStreamingCompile(const ModuleStreamingCompile&) = delete;
+  ModuleStreamingCompile& operator=(const ModuleStreamingCompile&) = delete;
+
+  // Runs the streaming task unless another thread already claimed it.
+  void Run();
+  // Runs the task on the calling thread if no worker has picked it up yet,
+  // otherwise waits for the worker. Has to be called before the isolate is
+  // disposed, and before Compile().
+  void Finish();
+  // Gives up on the task if it has not started yet.
+  void Cancel();
+
+  bool Matches(v8::Isolate* isolate, v8::Local<v8::String> source) const;
+  v8::MaybeLocal<v8::Module> Compile(v8::Local<v8::Context> context,
+                                     v8::Local<v8::String> source,
+                                     const v8::ScriptOrigin& origin);
+
+ private:
+  class SourceStream;
+
+  v8::Global<v8::String> source_;
+  std::unique_ptr<v8::ScriptCompiler::StreamedSource> streamed_source_;
+  std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task_;
+  std::atomic<bool> claimed_{false};
+  Mutex mutex_;
+  ConditionVariable cond_;
+  bool done_ = false;
+};
+
+// ModuleWraps of the main context are kept in the startup snapshot built with
+// --build-snapshot, so that the module graph that the entry point loaded does
+// not have to be compiled, linked and evaluated again at startup. Modules
+// created by vm.SourceTextModule cannot be serialized.
+class ModuleWrap : public SnapshotableObject {
  public:
   enum InternalFields {
     kModuleSlot = BaseObject::kInternalFieldCount,
@@ -64,6 +113,10 @@ class ModuleWrap : public BaseObject {
 
   SET_MEMORY_INFO_NAME(ModuleWrap)
   SET_SELF_SIZE(ModuleWrap)
+  SET_OBJECT_ID(module_wrap)
+
+  using InternalFieldInfo = InternalFieldInfoBase;
+  SERIALIZABLE_OBJECT_METHODS()
 
   bool IsNotIndicativeOfMemoryLeakAtExit() const override {
     // XXX: The garbage collection rules for ModuleWrap are *super* unclear.
@@ -90,6 +143,9 @@ class ModuleWrap : public BaseObject {
 
   static void CreateRequiredModuleFacade(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  // preparseModule(url, source) starts parsing a module that the loader
+  // will create a ModuleWrap for later.
+  static void PreparseModule(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  private:
   ModuleWrap(Realm* realm,
@@ -37,6 +37,7 @@
 #include "node_metadata.h"
 #include "node_options-inl.h"
 #include "node_perf.h"
+#include "node_probes.h"
 #include "node_process-inl.h"
 #include "node_realm-inl.h"
 #include "node_report.h"
@@ -120,6 +121,7 @@
 
 // ========== global C++ headers ==========
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>  // PATH_MAX
 #include <csignal>
@@ -127,6 +129,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -765,6 +768,28 @@ static ExitCode ProcessGlobalArgsInternal(std::vector<std::string>* args,
     env_opts->abort_on_uncaught_exception = true;
   }
 
+#ifdef __linux__
+  // libuv already knows how to submit read, write, open, close, stat and
+  // friends through io_uring and to fall back to the threadpool when the
+  // kernel lacks support, but keeps it disabled by default because of
+  // CVE-2024-22017. The choice is latched the first time a loop is
+  // initialized, so it has to be made before anything calls uv_default_loop().
+  // The variable is restored once the default loop has latched it, so that
+  // child processes do not inherit the setting.
+  if (per_process::cli_options->experimental_fs_io_uring) {
+    const char* previous = getenv("UV_USE_IO_URING");
+    std::optional<std::string> saved;
+    if (previous != nullptr) saved = previous;
+    setenv("UV_USE_IO_URING", "1", 1);
+    uv_default_loop();
+    if (saved.has_value()) {
+      setenv("UV_USE_IO_URING", saved->c_str(), 1);
+    } else {
+      unsetenv("UV_USE_IO_URING");
+    }
+  }
+#endif
+
 #ifdef __POSIX__
   // Block SIGPROF signals when sleeping in epoll_wait/kevent/etc.  Avoids the
   // performance penalty of frequent EINTR wakeups when the profiler is running.
@@ -1165,9 +1190,27 @@ InitializeOncePerProcessInternal(const std::vector<std::string>& args,
 #endif  // HAVE_OPENSSL
   }
 
+  probes::Initialize();
+
   if (!(flags & ProcessInitializationFlags::kNoInitializeNodeV8Platform)) {
-    per_process::v8_platform.Initialize(
-        static_cast<int>(per_process::cli_options->v8_thread_pool_size));
+    performance::performance_platform_start = PERFORMANCE_NOW();
+    std::unique_ptr<v8::PageAllocator> page_allocator;
+    if (!(flags & ProcessInitializationFlags::kNoUseLargePages) &&
+        per_process::cli_options->use_largepages_heap) {
+      int lp_result = 0;
+      page_allocator = CreateLargePageAllocator(&lp_result);
+      if (lp_result != 0) {
+        result->errors_.emplace_back(node::LargePagesError(lp_result));
+      }
+    }
+    int v8_thread_pool_size =
+        static_cast<int>(per_process::cli_options->v8_thread_pool_size);
+    if (v8_thread_pool_size < 0) {
+      v8_thread_pool_size =
+          static_cast<int>(std::min(4u, GetAvailableParallelism()));
+    }
+    per_process::v8_platform.Initialize(v8_thread_pool_size,
+                                        std::move(page_allocator));
     result->platform_ = per_process::v8_platform.Platform();
   }
 
@@ -1229,6 +1272,7 @@ std::shared_ptr<InitializationResult> InitializeOncePerProcess(
 void TearDownOncePerProcess() {
   const uint32_t flags = init_process_flags.load();
   ResetStdio();
+  probes::TearDown();
   if (!(flags & ProcessInitializationFlags::kNoDefaultSignalHandling)) {
     ResetSignalHandlers();
   }
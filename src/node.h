@@ -932,6 +932,22 @@ class NODE_EXTERN CommonEnvironmentSetup {
       const SnapshotConfig& snapshot_config = {});
   EmbedderSnapshotData::Pointer CreateSnapshot();
 
+  // Free the Environment and its main context, and create a new one on the
+  // same Isolate, IsolateData and event loop. This skips creating the
+  // Isolate, which makes it much cheaper than creating a new
+  // CommonEnvironmentSetup when an embedder runs many short-lived
+  // Environments, for example one per request. If the setup was created
+  // from a snapshot, the new context is deserialized from it again.
+  // env_args will be passed through as arguments to CreateEnvironment(), as
+  // for Create(). If any error occurs, `*errors` will be populated and false
+  // will be returned; env() is then nullptr.
+  // The previous Environment must not be running, i.e. SpinEventLoop() must
+  // have returned or node::Stop() must have been called.
+  // This is not supported for setups created by CreateForSnapshotting().
+  template <typename... EnvironmentArgs>
+  bool RecreateEnvironment(std::vector<std::string>* errors,
+                           EnvironmentArgs&&... env_args);
+
   struct uv_loop_s* event_loop() const;
   v8::SnapshotCreator* snapshot_creator();
   // Empty for snapshotting environments.
@@ -966,6 +982,58 @@ class NODE_EXTERN CommonEnvironmentSetup {
       uint32_t flags,
       std::function<Environment*(const CommonEnvironmentSetup*)>,
       const SnapshotConfig* config = nullptr);
+
+  bool RecreateEnvironmentImpl(
+      std::vector<std::string>*,
+      const std::function<Environment*(const CommonEnvironmentSetup*)>&);
+  void CreateMainContextAndEnvironment(
+      std::vector<std::string>*,
+      const std::function<Environment*(const CommonEnvironmentSetup*)>&);
+};
+
+// A pool of CommonEnvironmentSetup instances whose Environments are created
+// ahead of time, so that handing one out costs neither creating an Isolate
+// nor bootstrapping an Environment. Released setups get a fresh Environment
+// through the reset callback, usually a call to RecreateEnvironment(), and
+// are kept for the next Acquire() call.
+//
+// The pool itself is not thread-safe. As with any CommonEnvironmentSetup,
+// a setup that was handed out must only be used by one thread at a time.
+class NODE_EXTERN CommonEnvironmentSetupPool {
+ public:
+  using CreateCallback = std::function<std::unique_ptr<CommonEnvironmentSetup>(
+      std::vector<std::string>* errors)>;
+  using ResetCallback = std::function<bool(CommonEnvironmentSetup* setup,
+                                           std::vector<std::string>* errors)>;
+
+  // At most `max_idle` setups are kept. Setups that are released while the
+  // pool is full are destroyed.
+  CommonEnvironmentSetupPool(size_t max_idle,
+                             CreateCallback create,
+                             ResetCallback reset);
+  ~CommonEnvironmentSetupPool();
+
+  CommonEnvironmentSetupPool(const CommonEnvironmentSetupPool&) = delete;
+  CommonEnvironmentSetupPool& operator=(const CommonEnvironmentSetupPool&) =
+      delete;
+
+  // Create setups until `count` of them, but at most `max_idle`, are idle.
+  // Returns false and populates `*errors` if creating one fails.
+  bool Fill(size_t count, std::vector<std::string>* errors);
+  // Return an idle setup, or create one if there is none. If any error
+  // occurs, `*errors` will be populated and the returned pointer will be
+  // empty.
+  std::unique_ptr<CommonEnvironmentSetup> Acquire(
+      std::vector<std::string>* errors);
+  // Reset the Environment of `setup` and keep it for later. It is destroyed
+  // instead if the pool is full or the reset fails.
+  void Release(std::unique_ptr<CommonEnvironmentSetup> setup);
+
+  size_t idle_count() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
 };
 
 // Implementation for CommonEnvironmentSetup::Create
@@ -1008,6 +1076,17 @@ CommonEnvironmentSetup::CreateFromSnapshot(
   return ret;
 }
 
+template <typename... EnvironmentArgs>
+bool CommonEnvironmentSetup::RecreateEnvironment(
+    std::vector<std::string>* errors, EnvironmentArgs&&... env_args) {
+  return RecreateEnvironmentImpl(
+      errors, [&](const CommonEnvironmentSetup* setup) -> Environment* {
+        return CreateEnvironment(setup->isolate_data(),
+                                 setup->context(),
+                                 std::forward<EnvironmentArgs>(env_args)...);
+      });
+}
+
 /* Converts a unixtime to V8 Date */
 NODE_DEPRECATED("Use v8::Date::New() directly",
                 inline v8::Local<v8::Value> NODE_UNIXTIME_V8(double time) {
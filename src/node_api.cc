@@ -19,6 +19,7 @@
 #include <atomic>
 #include <cstring>
 #include <memory>
+#include <vector>
 
 node_napi_env__::node_napi_env__(v8::Local<v8::Context> context,
                                  const std::string& module_filename,
@@ -33,6 +34,50 @@ void node_napi_env__::DeleteMe() {
   napi_env__::DeleteMe();
 }
 
+// The same size as the default Buffer.poolSize.
+static constexpr size_t kBufferPoolSize = 8 * 1024;
+
+v8::MaybeLocal<v8::Object> node_napi_env__::NewPooledBuffer(size_t length) {
+  // Like in lib/buffer.js, larger buffers would keep a pool alive for too
+  // little gain.
+  if (length == 0 || length >= kBufferPoolSize / 2) {
+    return node::Buffer::New(isolate, length);
+  }
+
+  node::Environment* env = node_env();
+  if (buffer_pool.IsEmpty() || buffer_pool_offset + length > kBufferPoolSize) {
+    node::NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    std::unique_ptr<v8::BackingStore> store =
+        v8::ArrayBuffer::NewBackingStore(isolate, kBufferPoolSize);
+    if (!store) {
+      node::THROW_ERR_MEMORY_ALLOCATION_FAILED(isolate);
+      return v8::MaybeLocal<v8::Object>();
+    }
+    v8::Local<v8::ArrayBuffer> pool =
+        v8::ArrayBuffer::New(isolate, std::move(store));
+    // Transferring one slice would detach all the others.
+    if (pool->SetPrivate(context(),
+                         env->untransferable_object_private_symbol(),
+                         v8::True(isolate))
+            .IsNothing()) {
+      return v8::MaybeLocal<v8::Object>();
+    }
+    buffer_pool.Reset(isolate, pool);
+    buffer_pool_offset = 0;
+  }
+
+  v8::Local<v8::Uint8Array> buffer;
+  if (!node::Buffer::New(
+           env, buffer_pool.Get(isolate), buffer_pool_offset, length)
+           .ToLocal(&buffer)) {
+    return v8::MaybeLocal<v8::Object>();
+  }
+  // Keep the slices 8-byte aligned, as lib/buffer.js does.
+  buffer_pool_offset += length;
+  buffer_pool_offset = (buffer_pool_offset + 7) & ~static_cast<size_t>(7);
+  return buffer;
+}
+
 bool node_napi_env__::can_call_into_js() const {
   return node_env()->can_call_into_js();
 }
@@ -49,8 +94,17 @@ void node_napi_env__::CallFinalizer(napi_finalize cb, void* data, void* hint) {
       [&](napi_env env) { cb(env, data, hint); });
 }
 
+// Finalizers that run from an immediate yield to the event loop after this
+// long, so that a GC which collected millions of wrapped objects does not
+// stall it. The remaining ones run from the next immediate.
+static constexpr uint64_t kFinalizerTimeBudgetNs = 5 * 1000 * 1000;
+
 void node_napi_env__::EnqueueFinalizer(v8impl::RefTracker* finalizer) {
   napi_env__::EnqueueFinalizer(finalizer);
+  ScheduleFinalizers();
+}
+
+void node_napi_env__::ScheduleFinalizers() {
   // Schedule a second pass only when it has not been scheduled, and not
   // destructing the env.
   // When the env is being destructed, queued finalizers are drained in the
@@ -61,19 +115,25 @@ void node_napi_env__::EnqueueFinalizer(v8impl::RefTracker* finalizer) {
     node_env()->SetImmediate([this](node::Environment* node_env) {
       finalization_scheduled = false;
       Unref();
-      DrainFinalizerQueue();
+      DrainFinalizerQueue(kFinalizerTimeBudgetNs);
     });
   }
 }
 
-void node_napi_env__::DrainFinalizerQueue() {
+void node_napi_env__::DrainFinalizerQueue(uint64_t time_budget_ns) {
+  const uint64_t deadline =
+      time_budget_ns == 0 ? 0 : uv_hrtime() + time_budget_ns;
+  size_t finalized = 0;
   // As userland code can delete additional references in one finalizer,
-  // the list of pending finalizers may be mutated as we execute them, so
-  // we keep iterating it until it is empty.
-  while (!pending_finalizers.empty()) {
-    v8impl::RefTracker* ref_tracker = *pending_finalizers.begin();
-    pending_finalizers.erase(ref_tracker);
+  // the queue of pending finalizers may be mutated as we execute them, so
+  // we keep popping until it is empty.
+  while (v8impl::RefTracker* ref_tracker = pending_finalizers.Pop()) {
     ref_tracker->Finalize();
+    // Reading the clock is not free, so only do it every few finalizers.
+    if (deadline != 0 && ++finalized % 64 == 0 && uv_hrtime() >= deadline) {
+      if (!pending_finalizers.empty()) ScheduleFinalizers();
+      return;
+    }
   }
 }
 
@@ -196,6 +256,52 @@ inline napi_env NewEnv(v8::Local<v8::Context> context,
   return result;
 }
 
+// A multi-producer, single-consumer queue after Dmitry Vyukov's non-intrusive
+// MPSC queue. Push() is wait-free and can be called from any thread. Pop()
+// must only be called from one thread at a time. It can briefly miss an item
+// whose producer is still inside Push(), and report the queue as empty.
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    void* data;
+    while (Pop(&data)) {
+    }
+    if (tail_ != &stub_) delete tail_;
+  }
+
+  void Push(void* data) {
+    Node* node = new Node(data);
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  bool Pop(void** data) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) return false;
+    // |next| becomes the new stub, and |tail| is no longer referenced.
+    tail_ = next;
+    *data = next->data;
+    if (tail != &stub_) delete tail;
+    return true;
+  }
+
+ private:
+  struct Node {
+    explicit Node(void* data) : data(data) {}
+    std::atomic<Node*> next{nullptr};
+    void* data;
+  };
+
+  Node stub_{nullptr};
+  std::atomic<Node*> head_;
+  Node* tail_;
+};
+
 class ThreadSafeFunction : public node::AsyncResource {
  public:
   ThreadSafeFunction(v8::Local<v8::Function> func,
@@ -234,10 +340,16 @@ class ThreadSafeFunction : public node::AsyncResource {
   // These methods can be called from any thread.
 
   napi_status Push(void* data, napi_threadsafe_function_call_mode mode) {
+    // The common case, where the queue has room, does not take the mutex.
+    if (!is_closing.load(std::memory_order_acquire) && TryReserve()) {
+      queue.Push(data);
+      Send();
+      return napi_ok;
+    }
+
     node::Mutex::ScopedLock lock(this->mutex);
 
-    while (queue.size() >= max_queue_size && max_queue_size > 0 &&
-           !is_closing) {
+    while (!is_closing && !TryReserve()) {
       if (mode == napi_tsfn_nonblocking) {
         return napi_queue_full;
       }
@@ -252,7 +364,7 @@ class ThreadSafeFunction : public node::AsyncResource {
         return napi_closing;
       }
     } else {
-      queue.push(data);
+      queue.Push(data);
       Send();
       return napi_ok;
     }
@@ -293,8 +405,17 @@ class ThreadSafeFunction : public node::AsyncResource {
   }
 
   void EmptyQueueAndDelete() {
-    for (; !queue.empty(); queue.pop()) {
-      call_js_cb(nullptr, nullptr, context, queue.front());
+    void* data;
+    while (queue.Pop(&data)) {
+      if (batching) {
+        batch.push_back(data);
+      } else {
+        call_js_cb(nullptr, nullptr, context, data);
+      }
+    }
+    if (!batch.empty()) {
+      node_api_threadsafe_function_batch items{batch.data(), batch.size()};
+      call_js_cb(nullptr, nullptr, context, &items);
     }
     delete this;
   }
@@ -346,6 +467,8 @@ class ThreadSafeFunction : public node::AsyncResource {
 
   inline void* Context() { return context; }
 
+  inline void SetBatching(bool value) { batching = value; }
+
  protected:
   void Dispatch() {
     bool has_more = true;
@@ -378,15 +501,27 @@ class ThreadSafeFunction : public node::AsyncResource {
       if (is_closing) {
         CloseHandlesAndMaybeDelete();
       } else {
-        size_t size = queue.size();
-        if (size > 0) {
-          data = queue.front();
-          queue.pop();
+        // Counts items that are reserved but still being pushed, which
+        // Pop() may not see yet.
+        size_t size = queue_size.load(std::memory_order_acquire);
+        size_t popped = 0;
+        if (batching) {
+          // Bounded by the size read above, so that producers that keep up
+          // with the loop cannot make this batch grow forever.
+          while (popped < size && queue.Pop(&data)) {
+            batch.push_back(data);
+            popped++;
+          }
+        } else if (size > 0 && queue.Pop(&data)) {
+          popped = 1;
+        }
+        if (popped > 0) {
           popped_value = true;
-          if (size == max_queue_size && max_queue_size > 0) {
-            cond->Signal(lock);
+          size = queue_size.fetch_sub(popped, std::memory_order_acq_rel);
+          if (size >= max_queue_size && max_queue_size > 0) {
+            cond->Broadcast(lock);
           }
-          size--;
+          size -= popped;
         }
 
         if (size == 0) {
@@ -412,13 +547,35 @@ class ThreadSafeFunction : public node::AsyncResource {
             v8::Local<v8::Function>::New(env->isolate, ref);
         js_callback = v8impl::JsValueFromV8LocalValue(js_cb);
       }
-      env->CallbackIntoModule<false>(
-          [&](napi_env env) { call_js_cb(env, js_callback, context, data); });
+      if (batching) {
+        node_api_threadsafe_function_batch items{batch.data(), batch.size()};
+        env->CallbackIntoModule<false>([&](napi_env env) {
+          call_js_cb(env, js_callback, context, &items);
+        });
+        batch.clear();
+      } else {
+        env->CallbackIntoModule<false>(
+            [&](napi_env env) { call_js_cb(env, js_callback, context, data); });
+      }
     }
 
     return has_more;
   }
 
+  // Reserves a slot in the queue. Fails if the queue is full.
+  bool TryReserve() {
+    if (max_queue_size == 0) {
+      queue_size.fetch_add(1, std::memory_order_acq_rel);
+      return true;
+    }
+    size_t size = queue_size.load(std::memory_order_relaxed);
+    do {
+      if (size >= max_queue_size) return false;
+    } while (!queue_size.compare_exchange_weak(
+        size, size + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+    return true;
+  }
+
   void Finalize() {
     v8::HandleScope scope(env->isolate);
     if (finalize_cb) {
@@ -503,13 +660,18 @@ class ThreadSafeFunction : public node::AsyncResource {
 
   static const unsigned int kMaxIterationCount = 1000;
 
-  // These are variables protected by the mutex.
+  // Producers push without the mutex after reserving a slot in queue_size,
+  // so that it never exceeds max_queue_size.
+  MpscQueue queue;
+  std::atomic<size_t> queue_size{0};
+
+  // These are variables protected by the mutex. is_closing is only written
+  // with the mutex held, but read without it by Push().
   node::Mutex mutex;
   std::unique_ptr<node::ConditionVariable> cond;
-  std::queue<void*> queue;
   uv_async_t async;
   size_t thread_count;
-  bool is_closing;
+  std::atomic<bool> is_closing;
   std::atomic_uchar dispatch_state;
 
   // These are variables set once, upon creation, and then never again, which
@@ -524,6 +686,8 @@ class ThreadSafeFunction : public node::AsyncResource {
   napi_finalize finalize_cb;
   napi_threadsafe_function_call_js call_js_cb;
   bool handles_closing;
+  bool batching = false;
+  std::vector<void*> batch;
 };
 
 /**
@@ -1039,6 +1203,29 @@ napi_status NAPI_CDECL napi_create_buffer(napi_env env,
   return GET_RETURN_STATUS(env);
 }
 
+napi_status NAPI_CDECL node_api_create_buffer_from_pool(napi_env env,
+                                                        size_t length,
+                                                        void** data,
+                                                        napi_value* result) {
+  NAPI_PREAMBLE(env);
+  CHECK_ARG(env, result);
+
+  v8::MaybeLocal<v8::Object> maybe =
+      static_cast<node_napi_env>(env)->NewPooledBuffer(length);
+
+  CHECK_MAYBE_EMPTY(env, maybe, napi_generic_failure);
+
+  v8::Local<v8::Object> buffer = maybe.ToLocalChecked();
+
+  *result = v8impl::JsValueFromV8LocalValue(buffer);
+
+  if (data != nullptr) {
+    *data = node::Buffer::Data(buffer);
+  }
+
+  return GET_RETURN_STATUS(env);
+}
+
 napi_status NAPI_CDECL
 napi_create_external_buffer(napi_env env,
                             size_t length,
@@ -1418,6 +1605,15 @@ napi_status NAPI_CDECL napi_ref_threadsafe_function(
   return reinterpret_cast<v8impl::ThreadSafeFunction*>(func)->Ref();
 }
 
+napi_status NAPI_CDECL
+node_api_set_threadsafe_function_batching(node_api_basic_env env,
+                                          napi_threadsafe_function func,
+                                          bool batching) {
+  CHECK_NOT_NULL(func);
+  reinterpret_cast<v8impl::ThreadSafeFunction*>(func)->SetBatching(batching);
+  return napi_ok;
+}
+
 napi_status NAPI_CDECL node_api_get_module_file_name(
     node_api_basic_env basic_env, const char** result) {
   napi_env env = const_cast<napi_env>(basic_env);
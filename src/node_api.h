@@ -148,6 +148,19 @@ NAPI_EXTERN napi_status NAPI_CDECL napi_get_buffer_info(napi_env env,
                                                         void** data,
                                                         size_t* length);
 
+#ifdef NAPI_EXPERIMENTAL
+#define NODE_API_EXPERIMENTAL_HAS_POOLED_BUFFERS
+
+// Like napi_create_buffer(), but small buffers are slices of a shared pool,
+// the way Buffer.allocUnsafe() works, so they need neither an allocation nor
+// a finalizer of their own. The contents are not initialized.
+NAPI_EXTERN napi_status NAPI_CDECL
+node_api_create_buffer_from_pool(napi_env env,
+                                 size_t length,
+                                 void** data,
+                                 napi_value* result);
+#endif  // NAPI_EXPERIMENTAL
+
 // Methods to manage simple async operations
 NAPI_EXTERN napi_status NAPI_CDECL
 napi_create_async_work(napi_env env,
@@ -236,6 +249,19 @@ NAPI_EXTERN napi_status NAPI_CDECL napi_ref_threadsafe_function(
 
 #endif  // NAPI_VERSION >= 4
 
+#ifdef NAPI_EXPERIMENTAL
+#define NODE_API_EXPERIMENTAL_HAS_THREADSAFE_FUNCTION_BATCHING
+
+// In batch mode, call_js_cb is called once with all the items that are
+// queued at that time, passed as a node_api_threadsafe_function_batch*,
+// instead of once per item. Must be called from the main thread.
+NAPI_EXTERN napi_status NAPI_CDECL
+node_api_set_threadsafe_function_batching(node_api_basic_env env,
+                                          napi_threadsafe_function func,
+                                          bool batching);
+
+#endif  // NAPI_EXPERIMENTAL
+
 #if NAPI_VERSION >= 8
 
 NAPI_EXTERN napi_status NAPI_CDECL
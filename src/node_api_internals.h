@@ -19,7 +19,10 @@ struct node_napi_env__ : public napi_env__ {
   void CallFinalizer(napi_finalize cb, void* data, void* hint);
 
   void EnqueueFinalizer(v8impl::RefTracker* finalizer) override;
-  void DrainFinalizerQueue();
+  void ScheduleFinalizers();
+  // Runs the pending finalizers. With a non-zero |time_budget_ns|, stops
+  // after that long and schedules the rest for the next immediate.
+  void DrainFinalizerQueue(uint64_t time_budget_ns = 0);
 
   void trigger_fatal_exception(v8::Local<v8::Value> local_err);
   template <bool enforceUncaughtExceptionPolicy, typename T>
@@ -27,6 +30,9 @@ struct node_napi_env__ : public napi_env__ {
 
   void DeleteMe() override;
 
+  // Returns a buffer that is a slice of buffer_pool if it is small enough.
+  v8::MaybeLocal<v8::Object> NewPooledBuffer(size_t length);
+
   inline node::Environment* node_env() const {
     return node::Environment::GetCurrent(context());
   }
@@ -35,6 +41,8 @@ struct node_napi_env__ : public napi_env__ {
   std::string filename;
   bool destructing = false;
   bool finalization_scheduled = false;
+  v8impl::Persistent<v8::ArrayBuffer> buffer_pool;
+  size_t buffer_pool_offset = 0;
 };
 
 using node_napi_env = node_napi_env__*;
@@ -36,6 +36,15 @@ typedef void(NAPI_CDECL* napi_threadsafe_function_call_js)(
     napi_env env, napi_value js_callback, void* context, void* data);
 #endif  // NAPI_VERSION >= 4
 
+#ifdef NAPI_EXPERIMENTAL
+// What call_js_cb receives as its data for a thread-safe function in batch
+// mode. It is only valid during the call.
+typedef struct {
+  void** items;
+  size_t count;
+} node_api_threadsafe_function_batch;
+#endif  // NAPI_EXPERIMENTAL
+
 typedef struct {
   uint32_t major;
   uint32_t minor;
@@ -58,20 +58,26 @@
   V(internal_only_v8)                                                          \
   V(js_stream)                                                                 \
   V(js_udp_wrap)                                                               \
+  V(json)                                                                      \
+  V(log_writer)                                                                \
   V(messaging)                                                                 \
+  V(metrics)                                                                   \
   V(modules)                                                                   \
   V(module_wrap)                                                               \
   V(mksnapshot)                                                                \
   V(options)                                                                   \
   V(os)                                                                        \
+  V(path)                                                                      \
   V(performance)                                                               \
   V(permission)                                                                \
   V(pipe_wrap)                                                                 \
   V(process_wrap)                                                              \
   V(process_methods)                                                           \
   V(report)                                                                    \
+  V(ring_channel)                                                              \
   V(sea)                                                                       \
   V(serdes)                                                                    \
+  V(shm_channel_wrap)                                                          \
   V(signal_wrap)                                                               \
   V(spawn_sync)                                                                \
   V(sqlite)                                                                    \
@@ -87,6 +93,7 @@
   V(types)                                                                     \
   V(udp_wrap)                                                                  \
   V(url)                                                                       \
+  V(url_pattern)                                                               \
   V(util)                                                                      \
   V(uv)                                                                        \
   V(v8)                                                                        \
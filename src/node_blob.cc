@@ -8,12 +8,15 @@
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_file.h"
+#include "node_mutex.h"
 #include "path.h"
 #include "permission/permission.h"
 #include "util.h"
 #include "v8.h"
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace node {
 
@@ -39,6 +42,9 @@ using v8::Value;
 
 namespace {
 
+// Upper bound for the bytes a Blob::Reader coalesces into a single pull().
+constexpr size_t kMaxPullBatchSize = 16 * 1024 * 1024;
+
 // Concatenate multiple ArrayBufferView/ArrayBuffers into a single ArrayBuffer.
 // This method treats all ArrayBufferView types the same.
 void Concat(const FunctionCallbackInfo<Value>& args) {
@@ -241,6 +247,9 @@ void Blob::New(const FunctionCallbackInfo<Value>& args) {
     }
   }
 
+  DataQueue::MaybeSpillToDisk(
+      env, &entries, env->options()->blob_spill_threshold);
+
   auto blob = Create(env, DataQueue::CreateIdempotent(std::move(entries)));
   if (blob)
     args.GetReturnValue().Set(blob->object());
@@ -251,8 +260,17 @@ void Blob::GetReader(const FunctionCallbackInfo<Value>& args) {
   Blob* blob;
   ASSIGN_OR_RETURN_UNWRAP(&blob, args.This());
 
-  BaseObjectPtr<Blob::Reader> reader =
-      Blob::Reader::Create(env, BaseObjectPtr<Blob>(blob));
+  size_t high_water_mark = 0;
+  if (args[0]->IsNumber()) {
+    double value = args[0].As<v8::Number>()->Value();
+    if (value > 0) {
+      high_water_mark = static_cast<size_t>(
+          std::min(value, static_cast<double>(kMaxPullBatchSize)));
+    }
+  }
+
+  BaseObjectPtr<Blob::Reader> reader = Blob::Reader::Create(
+      env, BaseObjectPtr<Blob>(blob), high_water_mark);
   if (reader) args.GetReturnValue().Set(reader->object());
 }
 
@@ -285,15 +303,287 @@ Blob::Blob(Environment* env,
   MakeWeak();
 }
 
+// A chunk yielded by a Remote's DataQueue::Reader. Its memory stays valid
+// until the chunk is destroyed, which may happen on any thread.
+struct Blob::Reader::RemoteChunk {
+  std::shared_ptr<Remote> remote;
+  int status = bob::STATUS_CONTINUE;
+  std::vector<DataQueue::Vec> vecs;
+  bob::Done done;
+
+  ~RemoteChunk();
+};
+
+// Ties a transferred Blob::Reader to the DataQueue::Reader that it was
+// created with, which stays on the thread that owns the queue. Every pull is
+// forwarded to that thread, and the chunk it yields is sent back to the
+// receiving thread with the DataQueue's Done callback. That callback, which
+// keeps the chunk's memory alive, is invoked on the owning thread again once
+// the receiver is finished with the chunk.
+class Blob::Reader::Remote final
+    : public std::enable_shared_from_this<Blob::Reader::Remote> {
+ public:
+  // Called on the thread that owns |inner|.
+  static std::shared_ptr<Remote> Create(
+      Environment* env, std::shared_ptr<DataQueue::Reader> inner) {
+    auto remote = std::make_shared<Remote>(env, std::move(inner));
+    remote->keep_alive_ = remote;
+    env->AddCleanupHook(OnOwnerCleanup, remote.get());
+    return remote;
+  }
+
+  Remote(Environment* env, std::shared_ptr<DataQueue::Reader> inner)
+      : owner_(env), inner_(std::move(inner)) {}
+
+  ~Remote() { CHECK_NULL(owner_); }
+
+  // The methods below are called on the receiving thread.
+  void Attach(Reader* reader) {
+    Mutex::ScopedLock lock(mutex_);
+    CHECK_NULL(receiver_);
+    receiver_ = reader;
+  }
+
+  void Detach(Reader* reader) {
+    Mutex::ScopedLock lock(mutex_);
+    if (receiver_ == reader) receiver_ = nullptr;
+  }
+
+  // Returns bob::STATUS_WAIT, after which the result is passed to
+  // Reader::OnRemoteChunk(), or UV_ECANCELED if the owning thread is gone.
+  int Pull() {
+    Mutex::ScopedLock lock(mutex_);
+    if (owner_ == nullptr) return UV_ECANCELED;
+    owner_->SetImmediateThreadsafe(
+        [self = shared_from_this()](Environment* env) { self->DoPull(); });
+    return bob::STATUS_WAIT;
+  }
+
+  void Receive(Environment* env, std::unique_ptr<RemoteChunk> chunk) {
+    Reader* reader;
+    {
+      Mutex::ScopedLock lock(mutex_);
+      reader = receiver_;
+    }
+    if (reader != nullptr && reader->env() == env)
+      reader->OnRemoteChunk(std::move(chunk));
+  }
+
+  // Lets the owning thread drop the DataQueue::Reader once nothing is going
+  // to pull from it anymore.
+  void Close() {
+    Mutex::ScopedLock lock(mutex_);
+    if (owner_ == nullptr) return;
+    owner_->SetImmediateThreadsafe([self = shared_from_this()](
+                                       Environment* env) {
+      std::shared_ptr<Remote> keep_alive;
+      {
+        Mutex::ScopedLock lock(self->mutex_);
+        if (self->owner_ == nullptr) return;
+        env->RemoveCleanupHook(OnOwnerCleanup, self.get());
+        self->owner_ = nullptr;
+        keep_alive = std::move(self->keep_alive_);
+      }
+      self->inner_.reset();
+    });
+  }
+
+  // May be called on any thread.
+  void Release(bob::Done done) {
+    {
+      Mutex::ScopedLock lock(mutex_);
+      if (owner_ != nullptr) {
+        owner_->SetImmediateThreadsafe(
+            [done = std::move(done)](Environment* env) { done(0); });
+        return;
+      }
+    }
+    done(0);
+  }
+
+ private:
+  // Called on the owning thread.
+  void DoPull() {
+    if (!inner_) return;
+    inner_->Pull(
+        [self = shared_from_this()](int status,
+                                    const DataQueue::Vec* vecs,
+                                    size_t count,
+                                    bob::Done done) {
+          auto chunk = std::make_unique<RemoteChunk>();
+          chunk->remote = self;
+          chunk->status = status;
+          if (count > 0) {
+            chunk->vecs.assign(vecs, vecs + count);
+            chunk->done = std::move(done);
+          }
+          self->Deliver(std::move(chunk));
+        },
+        bob::OPTIONS_END,
+        nullptr,
+        0);
+  }
+
+  void Deliver(std::unique_ptr<RemoteChunk> chunk) {
+    {
+      Mutex::ScopedLock lock(mutex_);
+      if (receiver_ != nullptr) {
+        receiver_->env()->SetImmediateThreadsafe(
+            [chunk = std::move(chunk)](Environment* env) mutable {
+              std::shared_ptr<Remote> remote = chunk->remote;
+              remote->Receive(env, std::move(chunk));
+            });
+        return;
+      }
+    }
+    // Nobody wants the chunk anymore; dropping it outside of the lock
+    // releases its memory.
+  }
+
+  static void OnOwnerCleanup(void* arg) {
+    Remote* remote = static_cast<Remote*>(arg);
+    std::shared_ptr<Remote> keep_alive;
+    {
+      Mutex::ScopedLock lock(remote->mutex_);
+      remote->owner_ = nullptr;
+      keep_alive = std::move(remote->keep_alive_);
+    }
+    remote->inner_.reset();
+  }
+
+  Mutex mutex_;
+  // The Environment that owns inner_, until it is cleaned up.
+  Environment* owner_;
+  Reader* receiver_ = nullptr;
+  // Only touched on the owning thread.
+  std::shared_ptr<DataQueue::Reader> inner_;
+  // Keeps this alive for as long as owner_ is set.
+  std::shared_ptr<Remote> keep_alive_;
+};
+
+Blob::Reader::RemoteChunk::~RemoteChunk() {
+  if (done) remote->Release(std::move(done));
+}
+
+class Blob::Reader::ReaderTransferData : public worker::TransferData {
+ public:
+  explicit ReaderTransferData(std::shared_ptr<Remote> remote)
+      : remote_(std::move(remote)) {}
+
+  ~ReaderTransferData() override {
+    // The message was never received.
+    if (remote_) remote_->Close();
+  }
+
+  BaseObjectPtr<BaseObject> Deserialize(
+      Environment* env,
+      Local<Context> context,
+      std::unique_ptr<worker::TransferData> self) override {
+    if (context != env->context()) {
+      THROW_ERR_MESSAGE_TARGET_CONTEXT_UNAVAILABLE(env);
+      return {};
+    }
+    return Blob::Reader::Create(env, std::move(remote_));
+  }
+
+  SET_MEMORY_INFO_NAME(BlobReaderTransferData)
+  SET_SELF_SIZE(ReaderTransferData)
+  SET_NO_MEMORY_INFO()
+
+ private:
+  std::shared_ptr<Remote> remote_;
+};
+
 Blob::Reader::Reader(Environment* env,
                      v8::Local<v8::Object> obj,
-                     BaseObjectPtr<Blob> strong_ptr)
+                     BaseObjectPtr<Blob> strong_ptr,
+                     size_t high_water_mark)
     : AsyncWrap(env, obj, AsyncWrap::PROVIDER_BLOBREADER),
       inner_(strong_ptr->data_queue_->get_reader()),
-      strong_ptr_(std::move(strong_ptr)) {
+      strong_ptr_(std::move(strong_ptr)),
+      high_water_mark_(high_water_mark) {
+  MakeWeak();
+}
+
+Blob::Reader::Reader(Environment* env,
+                     v8::Local<v8::Object> obj,
+                     std::shared_ptr<Remote> remote)
+    : AsyncWrap(env, obj, AsyncWrap::PROVIDER_BLOBREADER),
+      remote_(std::move(remote)) {
+  remote_->Attach(this);
   MakeWeak();
 }
 
+Blob::Reader::~Reader() {
+  if (remote_) {
+    remote_->Detach(this);
+    remote_->Close();
+  }
+}
+
+BaseObject::TransferMode Blob::Reader::GetTransferMode() const {
+  if (pull_pending_ || !remote_callback_.IsEmpty() || (!inner_ && !remote_))
+    return TransferMode::kDisallowCloneAndTransfer;
+  return TransferMode::kTransferable;
+}
+
+std::unique_ptr<worker::TransferData> Blob::Reader::TransferForMessaging() {
+  std::shared_ptr<Remote> remote;
+  if (remote_) {
+    remote = std::move(remote_);
+    remote->Detach(this);
+  } else {
+    remote = Remote::Create(env(), std::move(inner_));
+  }
+  strong_ptr_.reset();
+  return std::make_unique<ReaderTransferData>(std::move(remote));
+}
+
+void Blob::Reader::OnRemoteChunk(std::unique_ptr<RemoteChunk> chunk) {
+  if (remote_callback_.IsEmpty()) return;
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Local<Function> fn = remote_callback_.Get(isolate);
+  remote_callback_.Reset();
+
+  const int status = chunk->status;
+  if (status == bob::STATUS_EOS) eos_ = true;
+
+  if (chunk->vecs.empty()) {
+    Local<Value> argv[2] = {Int32::New(isolate, status), Undefined(isolate)};
+    MakeCallback(fn, arraysize(argv), argv);
+    return;
+  }
+
+  std::shared_ptr<BackingStore> store;
+  if (chunk->vecs.size() == 1 && chunk->vecs[0].len > 0) {
+    // Hand out the chunk's memory itself. The chunk, and with it the
+    // memory, is released when the ArrayBuffer is collected.
+    const DataQueue::Vec vec = chunk->vecs[0];
+    store = ArrayBuffer::NewBackingStore(
+        vec.base,
+        vec.len,
+        [](void*, size_t, void* data) {
+          delete static_cast<RemoteChunk*>(data);
+        },
+        chunk.release());
+  } else {
+    size_t total = 0;
+    for (const DataQueue::Vec& vec : chunk->vecs) total += vec.len;
+    store = ArrayBuffer::NewBackingStore(isolate, total);
+    auto ptr = static_cast<uint8_t*>(store->Data());
+    for (const DataQueue::Vec& vec : chunk->vecs) {
+      std::copy(vec.base, vec.base + vec.len, ptr);
+      ptr += vec.len;
+    }
+    chunk.reset();
+  }
+  Local<Value> argv[2] = {Uint32::New(isolate, status),
+                          ArrayBuffer::New(isolate, store)};
+  MakeCallback(fn, arraysize(argv), argv);
+}
+
 bool Blob::Reader::HasInstance(Environment* env, v8::Local<v8::Value> value) {
   return GetConstructorTemplate(env)->HasInstance(value);
 }
@@ -313,7 +603,22 @@ Local<FunctionTemplate> Blob::Reader::GetConstructorTemplate(Environment* env) {
 }
 
 BaseObjectPtr<Blob::Reader> Blob::Reader::Create(Environment* env,
-                                                 BaseObjectPtr<Blob> blob) {
+                                                 BaseObjectPtr<Blob> blob,
+                                                 size_t high_water_mark) {
+  Local<Object> obj;
+  if (!GetConstructorTemplate(env)
+           ->InstanceTemplate()
+           ->NewInstance(env->context())
+           .ToLocal(&obj)) {
+    return BaseObjectPtr<Blob::Reader>();
+  }
+
+  return MakeBaseObject<Blob::Reader>(
+      env, obj, std::move(blob), high_water_mark);
+}
+
+BaseObjectPtr<Blob::Reader> Blob::Reader::Create(
+    Environment* env, std::shared_ptr<Remote> remote) {
   Local<Object> obj;
   if (!GetConstructorTemplate(env)
            ->InstanceTemplate()
@@ -322,9 +627,22 @@ BaseObjectPtr<Blob::Reader> Blob::Reader::Create(Environment* env,
     return BaseObjectPtr<Blob::Reader>();
   }
 
-  return MakeBaseObject<Blob::Reader>(env, obj, std::move(blob));
+  return MakeBaseObject<Blob::Reader>(env, obj, std::move(remote));
 }
 
+struct Blob::Reader::PullState {
+  BaseObjectPtr<Blob::Reader> reader;
+  Global<Function> callback;
+  // The bytes yielded by inner_ so far, copied out so that every chunk can
+  // be released right away.
+  std::vector<uint8_t> buffered;
+  // Set while inner_->Pull() is on the stack, so that a synchronous answer
+  // lets PullBatch() loop instead of recursing.
+  bool in_pull = false;
+  bool pull_again = false;
+  bool delivered = false;
+};
+
 void Blob::Reader::Pull(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Blob::Reader* reader;
@@ -334,65 +652,110 @@ void Blob::Reader::Pull(const FunctionCallbackInfo<Value>& args) {
   Local<Function> fn = args[0].As<Function>();
   CHECK(!fn->IsConstructor());
 
-  if (reader->eos_) {
+  // A reader that was transferred away has nothing left to read either.
+  if (reader->eos_ || (!reader->inner_ && !reader->remote_)) {
     Local<Value> arg = Int32::New(env->isolate(), bob::STATUS_EOS);
     reader->MakeCallback(fn, 1, &arg);
     return args.GetReturnValue().Set(bob::STATUS_EOS);
   }
 
-  struct Impl {
-    BaseObjectPtr<Blob::Reader> reader;
-    Global<Function> callback;
-    Environment* env;
-  };
-  // TODO(@jasnell): A unique_ptr is likely better here but making this a unique
-  // pointer that is passed into the lambda causes the std::move(next) below to
-  // complain about std::function needing to be copy-constructible.
-  Impl* impl = new Impl();
-  impl->reader = BaseObjectPtr<Blob::Reader>(reader);
-  impl->callback.Reset(env->isolate(), fn);
-  impl->env = env;
-
-  auto next = [impl](int status,
-                     const DataQueue::Vec* vecs,
-                     size_t count,
-                     bob::Done doneCb) mutable {
-    auto dropMe = std::unique_ptr<Impl>(impl);
-    Environment* env = impl->env;
-    HandleScope handleScope(env->isolate());
-    Local<Function> fn = impl->callback.Get(env->isolate());
-
-    if (status == bob::STATUS_EOS) impl->reader->eos_ = true;
-
-    if (count > 0) {
-      // Copy the returns vectors into a single ArrayBuffer.
-      size_t total = 0;
-      for (size_t n = 0; n < count; n++) total += vecs[n].len;
+  if (reader->remote_) {
+    CHECK(reader->remote_callback_.IsEmpty());
+    int status = reader->remote_->Pull();
+    if (status == bob::STATUS_WAIT) {
+      reader->remote_callback_.Reset(env->isolate(), fn);
+    } else {
+      Local<Value> argv[2] = {Int32::New(env->isolate(), status),
+                              Undefined(env->isolate())};
+      reader->MakeCallback(fn, arraysize(argv), argv);
+    }
+    return args.GetReturnValue().Set(status);
+  }
 
-      std::shared_ptr<BackingStore> store =
-          v8::ArrayBuffer::NewBackingStore(env->isolate(), total);
-      auto ptr = static_cast<uint8_t*>(store->Data());
+  auto state = std::make_shared<PullState>();
+  state->reader = BaseObjectPtr<Blob::Reader>(reader);
+  state->callback.Reset(env->isolate(), fn);
+  reader->pull_pending_ = true;
+  args.GetReturnValue().Set(PullBatch(std::move(state)));
+}
+
+int Blob::Reader::PullBatch(std::shared_ptr<PullState> state) {
+  Blob::Reader* reader = state->reader.get();
+  auto next = [state](int status,
+                      const DataQueue::Vec* vecs,
+                      size_t count,
+                      bob::Done doneCb) {
+    Blob::Reader* reader = state->reader.get();
+    size_t total = 0;
+    for (size_t n = 0; n < count; n++) total += vecs[n].len;
+    if (total > 0) {
+      std::vector<uint8_t>& buffered = state->buffered;
+      if (buffered.empty()) {
+        buffered.reserve(std::max(total, reader->high_water_mark_));
+      }
       for (size_t n = 0; n < count; n++) {
-        std::copy(vecs[n].base, vecs[n].base + vecs[n].len, ptr);
-        ptr += vecs[n].len;
+        buffered.insert(
+            buffered.end(), vecs[n].base, vecs[n].base + vecs[n].len);
+      }
+    }
+    // Since we copied the data buffers, signal that we're done with them.
+    if (count > 0) std::move(doneCb)(0);
+
+    if (status == bob::STATUS_CONTINUE &&
+        state->buffered.size() < reader->high_water_mark_) {
+      if (state->in_pull) {
+        state->pull_again = true;
+      } else {
+        // The answer came in asynchronously. Pull again from the event loop
+        // rather than from within inner_'s callback.
+        reader->env()->SetImmediate(
+            [state](Environment* env) { PullBatch(state); });
       }
-      // Since we copied the data buffers, signal that we're done with them.
-      std::move(doneCb)(0);
-      Local<Value> argv[2] = {Uint32::New(env->isolate(), status),
-                              ArrayBuffer::New(env->isolate(), store)};
-      impl->reader->MakeCallback(fn, arraysize(argv), argv);
       return;
     }
-
-    Local<Value> argv[2] = {
-        Int32::New(env->isolate(), status),
-        Undefined(env->isolate()),
-    };
-    impl->reader->MakeCallback(fn, arraysize(argv), argv);
+    Deliver(state.get(), status);
   };
 
-  args.GetReturnValue().Set(reader->inner_->Pull(
-      std::move(next), node::bob::OPTIONS_END, nullptr, 0));
+  int status;
+  do {
+    state->pull_again = false;
+    state->in_pull = true;
+    status = reader->inner_->Pull(next, bob::OPTIONS_END, nullptr, 0);
+    state->in_pull = false;
+  } while (state->pull_again && !state->delivered);
+  return status;
+}
+
+void Blob::Reader::Deliver(PullState* state, int status) {
+  Blob::Reader* reader = state->reader.get();
+  Environment* env = reader->env();
+  Isolate* isolate = env->isolate();
+  state->delivered = true;
+  reader->pull_pending_ = false;
+  HandleScope handle_scope(isolate);
+  Local<Function> fn = state->callback.Get(isolate);
+  state->callback.Reset();
+
+  if (status == bob::STATUS_EOS) reader->eos_ = true;
+
+  if (state->buffered.empty()) {
+    Local<Value> argv[2] = {Int32::New(isolate, status), Undefined(isolate)};
+    reader->MakeCallback(fn, arraysize(argv), argv);
+    return;
+  }
+
+  // Hand the buffered bytes over to the ArrayBuffer without another copy.
+  auto buffered = new std::vector<uint8_t>(std::move(state->buffered));
+  std::shared_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+      buffered->data(),
+      buffered->size(),
+      [](void*, size_t, void* data) {
+        delete static_cast<std::vector<uint8_t>*>(data);
+      },
+      buffered);
+  Local<Value> argv[2] = {Uint32::New(isolate, status),
+                          ArrayBuffer::New(isolate, store)};
+  reader->MakeCallback(fn, arraysize(argv), argv);
 }
 
 BaseObjectPtr<BaseObject>
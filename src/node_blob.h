@@ -74,27 +74,63 @@ class Blob : public BaseObject {
     std::shared_ptr<DataQueue> data_queue;
   };
 
+  // A Reader can be transferred to another thread. The DataQueue::Reader
+  // stays on the thread that created it and is pulled from there, so the
+  // queue's BackpressureListeners keep working, and the chunks it yields are
+  // handed over without being copied.
   class Reader final : public AsyncWrap {
    public:
+    class Remote;
+
     static bool HasInstance(Environment* env, v8::Local<v8::Value> value);
     static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
         Environment* env);
     static BaseObjectPtr<Reader> Create(Environment* env,
-                                        BaseObjectPtr<Blob> blob);
+                                        BaseObjectPtr<Blob> blob,
+                                        size_t high_water_mark = 0);
+    static BaseObjectPtr<Reader> Create(Environment* env,
+                                        std::shared_ptr<Remote> remote);
     static void Pull(const v8::FunctionCallbackInfo<v8::Value>& args);
 
-    explicit Reader(Environment* env,
-                    v8::Local<v8::Object> obj,
-                    BaseObjectPtr<Blob> strong_ptr);
+    Reader(Environment* env,
+           v8::Local<v8::Object> obj,
+           BaseObjectPtr<Blob> strong_ptr,
+           size_t high_water_mark);
+    Reader(Environment* env,
+           v8::Local<v8::Object> obj,
+           std::shared_ptr<Remote> remote);
+    ~Reader() override;
+
+    BaseObject::TransferMode GetTransferMode() const override;
+    std::unique_ptr<worker::TransferData> TransferForMessaging() override;
 
     SET_NO_MEMORY_INFO()
     SET_MEMORY_INFO_NAME(Blob::Reader)
     SET_SELF_SIZE(Reader)
 
    private:
+    class ReaderTransferData;
+    struct RemoteChunk;
+    struct PullState;
+
+    void OnRemoteChunk(std::unique_ptr<RemoteChunk> chunk);
+    // Pulls from inner_ until the state has buffered high_water_mark_ bytes
+    // or the source stops yielding data, then calls back into JavaScript
+    // once with everything that was buffered.
+    static int PullBatch(std::shared_ptr<PullState> state);
+    static void Deliver(PullState* state, int status);
+
     std::shared_ptr<DataQueue::Reader> inner_;
+    // Set instead of inner_ when the Reader was transferred to this thread.
+    std::shared_ptr<Remote> remote_;
     BaseObjectPtr<Blob> strong_ptr_;
+    // The callback of the pull() that remote_ has not answered yet.
+    v8::Global<v8::Function> remote_callback_;
+    // Chunks are coalesced per pull() until this many bytes are buffered.
+    // With 0, every pull() yields what a single pull of inner_ produces.
+    size_t high_water_mark_ = 0;
     bool eos_ = false;
+    bool pull_pending_ = false;
   };
 
   BaseObject::TransferMode GetTransferMode() const override;
@@ -38,8 +38,18 @@
 #include <stdint.h>
 #include <climits>
 #include <cstring>
+#include <string>
+#include <vector>
 #include "nbytes.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NODE_BUFFER_SEARCH_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_BUFFER_SEARCH_NEON 1
+#endif
+
 #define THROW_AND_RETURN_UNLESS_BUFFER(env, obj)                            \
   THROW_AND_RETURN_IF_NOT_BUFFER(env, obj, "argument")                      \
 
@@ -54,6 +64,7 @@
 namespace node {
 namespace Buffer {
 
+using v8::Array;
 using v8::ArrayBuffer;
 using v8::ArrayBufferView;
 using v8::BackingStore;
@@ -61,9 +72,11 @@ using v8::Context;
 using v8::EscapableHandleScope;
 using v8::FastApiTypedArray;
 using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
 using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
+using v8::Int32Array;
 using v8::Integer;
 using v8::Isolate;
 using v8::Just;
@@ -1155,6 +1168,235 @@ int32_t FastIndexOfNumber(v8::Local<v8::Value>,
 static v8::CFunction fast_index_of_number(
     v8::CFunction::Make(FastIndexOfNumber));
 
+// Finds the first occurrence of any of a set of needles in a single pass.
+// Positions where a needle may start are located by comparing 16 bytes at a
+// time against the distinct first bytes of the needles, as long as there are
+// at most kMaxVectorFirstBytes of them, and through a lookup table otherwise.
+class MultiNeedleSearch {
+ public:
+  static constexpr size_t kMaxNeedles = 64;
+  static constexpr size_t kMaxVectorFirstBytes = 4;
+
+  // Returns false, with an exception pending, if needles is not an array
+  // of at most kMaxNeedles non-empty buffers.
+  bool Init(Environment* env, Local<Value> needles);
+
+  // Returns the offset of the first match at or after offset, or length if
+  // there is none. If several needles match at the same offset, the one that
+  // comes first in the array wins.
+  size_t Find(const uint8_t* data,
+              size_t length,
+              size_t offset,
+              size_t* needle_index) const;
+
+  size_t needle_length(size_t index) const { return needles_[index].size(); }
+
+ private:
+  size_t FindCandidate(const uint8_t* data, size_t length, size_t pos) const;
+
+  std::vector<std::string> needles_;
+  bool is_first_byte_[256] = {};
+  uint8_t vector_first_bytes_[kMaxVectorFirstBytes] = {};
+  size_t vector_first_byte_count_ = 0;  // 0 if there are too many.
+};
+
+bool MultiNeedleSearch::Init(Environment* env, Local<Value> needles) {
+  CHECK(needles->IsArray());
+  Local<Array> array = needles.As<Array>();
+  const uint32_t count = array->Length();
+  if (count == 0 || count > kMaxNeedles) {
+    THROW_ERR_OUT_OF_RANGE(env, "The number of needles must be 1 to 64");
+    return false;
+  }
+
+  size_t first_byte_count = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> needle;
+    if (!array->Get(env->context(), i).ToLocal(&needle)) return false;
+    if (!needle->IsArrayBufferView()) {
+      THROW_ERR_INVALID_ARG_TYPE(env, "needles must be buffers");
+      return false;
+    }
+    ArrayBufferViewContents<char> contents(needle);
+    if (contents.length() == 0) {
+      THROW_ERR_INVALID_ARG_VALUE(env, "needles must not be empty");
+      return false;
+    }
+    needles_.emplace_back(contents.data(), contents.length());
+
+    const uint8_t first_byte = static_cast<uint8_t>(contents.data()[0]);
+    if (!is_first_byte_[first_byte]) {
+      is_first_byte_[first_byte] = true;
+      if (first_byte_count < kMaxVectorFirstBytes)
+        vector_first_bytes_[first_byte_count] = first_byte;
+      first_byte_count++;
+    }
+  }
+  if (first_byte_count <= kMaxVectorFirstBytes)
+    vector_first_byte_count_ = first_byte_count;
+  return true;
+}
+
+size_t MultiNeedleSearch::FindCandidate(const uint8_t* data,
+                                        size_t length,
+                                        size_t pos) const {
+#if defined(NODE_BUFFER_SEARCH_SSE2)
+  if (vector_first_byte_count_ > 0) {
+    __m128i first_bytes[kMaxVectorFirstBytes];
+    for (size_t i = 0; i < vector_first_byte_count_; i++)
+      first_bytes[i] = _mm_set1_epi8(static_cast<char>(vector_first_bytes_[i]));
+    for (; pos + 16 <= length; pos += 16) {
+      const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+      __m128i hits = _mm_cmpeq_epi8(chunk, first_bytes[0]);
+      for (size_t i = 1; i < vector_first_byte_count_; i++)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, first_bytes[i]));
+      if (_mm_movemask_epi8(hits) != 0) break;
+    }
+  }
+#elif defined(NODE_BUFFER_SEARCH_NEON)
+  if (vector_first_byte_count_ > 0) {
+    uint8x16_t first_bytes[kMaxVectorFirstBytes];
+    for (size_t i = 0; i < vector_first_byte_count_; i++)
+      first_bytes[i] = vdupq_n_u8(vector_first_bytes_[i]);
+    for (; pos + 16 <= length; pos += 16) {
+      const uint8x16_t chunk = vld1q_u8(data + pos);
+      uint8x16_t hits = vceqq_u8(chunk, first_bytes[0]);
+      for (size_t i = 1; i < vector_first_byte_count_; i++)
+        hits = vorrq_u8(hits, vceqq_u8(chunk, first_bytes[i]));
+      if (vmaxvq_u8(hits) != 0) break;
+    }
+  }
+#endif
+  // Either the block at pos contains a candidate, or there are fewer than
+  // 16 bytes left, or the needles start with too many different bytes.
+  for (; pos < length; pos++) {
+    if (is_first_byte_[data[pos]]) return pos;
+  }
+  return length;
+}
+
+size_t MultiNeedleSearch::Find(const uint8_t* data,
+                               size_t length,
+                               size_t offset,
+                               size_t* needle_index) const {
+  for (size_t pos = offset; pos < length; pos++) {
+    pos = FindCandidate(data, length, pos);
+    if (pos == length) break;
+    for (size_t i = 0; i < needles_.size(); i++) {
+      const std::string& needle = needles_[i];
+      if (needle.size() <= length - pos &&
+          memcmp(data + pos, needle.data(), needle.size()) == 0) {
+        *needle_index = i;
+        return pos;
+      }
+    }
+  }
+  return length;
+}
+
+// indexOfAny(buffer, needles, byteOffset)
+void IndexOfAny(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[2]->IsNumber());
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+  ArrayBufferViewContents<uint8_t> haystack(args[0]);
+
+  MultiNeedleSearch search;
+  if (!search.Init(env, args[1])) return;
+
+  const int64_t offset = IndexOfOffset(
+      haystack.length(), args[2].As<Integer>()->Value(), 1, true);
+  if (offset <= -1) return args.GetReturnValue().Set(-1);
+
+  size_t needle_index;
+  const size_t result = search.Find(haystack.data(),
+                                    haystack.length(),
+                                    static_cast<size_t>(offset),
+                                    &needle_index);
+  args.GetReturnValue().Set(result == haystack.length()
+                                ? -1
+                                : static_cast<double>(result));
+}
+
+// indexesOf(buffer, needles, byteOffset, limit) returns an Int32Array of
+// [offset, needle index] pairs for the non-overlapping matches.
+void IndexesOf(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[2]->IsNumber());
+  CHECK(args[3]->IsUint32());
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+  ArrayBufferViewContents<uint8_t> haystack(args[0]);
+  if (haystack.length() > static_cast<size_t>(INT32_MAX))
+    return THROW_ERR_OUT_OF_RANGE(env, "Buffer is too large to search");
+
+  MultiNeedleSearch search;
+  if (!search.Init(env, args[1])) return;
+  const uint32_t limit = args[3].As<Uint32>()->Value();
+
+  std::vector<int32_t> matches;
+  int64_t offset = IndexOfOffset(
+      haystack.length(), args[2].As<Integer>()->Value(), 1, true);
+  if (offset > -1) {
+    size_t pos = static_cast<size_t>(offset);
+    size_t needle_index;
+    while (matches.size() / 2 < limit &&
+           (pos = search.Find(haystack.data(),
+                              haystack.length(),
+                              pos,
+                              &needle_index)) < haystack.length()) {
+      matches.push_back(static_cast<int32_t>(pos));
+      matches.push_back(static_cast<int32_t>(needle_index));
+      pos += search.needle_length(needle_index);
+    }
+  }
+
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(env->isolate(), matches.size() * sizeof(int32_t));
+  if (!matches.empty()) {
+    memcpy(ab->Data(), matches.data(), matches.size() * sizeof(int32_t));
+  }
+  args.GetReturnValue().Set(Int32Array::New(ab, 0, matches.size()));
+}
+
+// split(buffer, needles, limit) returns an array of Buffers that share
+// memory with buffer, one for each piece between matches.
+void Split(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[2]->IsUint32());
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+  Local<ArrayBufferView> view = args[0].As<ArrayBufferView>();
+  ArrayBufferViewContents<uint8_t> haystack(view);
+
+  MultiNeedleSearch search;
+  if (!search.Init(env, args[1])) return;
+  const uint32_t limit = args[2].As<Uint32>()->Value();
+
+  std::vector<std::pair<size_t, size_t>> pieces;
+  size_t start = 0;
+  size_t needle_index;
+  while (pieces.size() < limit) {
+    const size_t pos = search.Find(
+        haystack.data(), haystack.length(), start, &needle_index);
+    pieces.emplace_back(start, pos - start);
+    if (pos == haystack.length()) break;
+    start = pos + search.needle_length(needle_index);
+  }
+
+  Local<ArrayBuffer> ab = view->Buffer();
+  const size_t base = view->ByteOffset();
+  std::vector<Local<Value>> results;
+  results.reserve(pieces.size());
+  for (const auto& piece : pieces) {
+    Local<Uint8Array> result;
+    if (!New(env, ab, base + piece.first, piece.second).ToLocal(&result))
+      return;
+    results.push_back(result);
+  }
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), results.data(), results.size()));
+}
+
 void Swap16(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
@@ -1442,6 +1684,157 @@ void CopyArrayBuffer(const FunctionCallbackInfo<Value>& args) {
   memcpy(dest, src, bytes_to_copy);
 }
 
+// Copies the contents of views into a single new Buffer of total_length
+// bytes, allocated without zero-filling. Bytes beyond the end of the views
+// are zeroed; views that do not fit are truncated.
+MaybeLocal<Object> ConcatViews(Environment* env,
+                               const std::vector<Local<ArrayBufferView>>& views,
+                               size_t total_length) {
+  Local<Object> result;
+  if (!New(env, total_length).ToLocal(&result)) return MaybeLocal<Object>();
+  char* dest = Data(result);
+  size_t offset = 0;
+  for (Local<ArrayBufferView> view : views) {
+    if (offset == total_length) break;
+    offset += view->CopyContents(dest + offset, total_length - offset);
+  }
+  memset(dest + offset, 0, total_length - offset);
+  return result;
+}
+
+// Collects the elements of list, which must all be ArrayBufferViews, and
+// their total byte length. Returns false, with an exception pending,
+// otherwise.
+bool GetConcatViews(Environment* env,
+                    Local<Value> list,
+                    std::vector<Local<ArrayBufferView>>* views,
+                    size_t* total_length) {
+  if (!list->IsArray()) {
+    THROW_ERR_INVALID_ARG_TYPE(env, "list must be an array");
+    return false;
+  }
+  Local<Array> array = list.As<Array>();
+  const uint32_t count = array->Length();
+  views->reserve(count);
+  *total_length = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> element;
+    if (!array->Get(env->context(), i).ToLocal(&element)) return false;
+    if (!element->IsArrayBufferView()) {
+      THROW_ERR_INVALID_ARG_TYPE(env, "list must only contain buffers");
+      return false;
+    }
+    Local<ArrayBufferView> view = element.As<ArrayBufferView>();
+    *total_length += view->ByteLength();
+    views->push_back(view);
+  }
+  return true;
+}
+
+// Concatenates an array of ArrayBufferViews with a single allocation.
+void Concat(const FunctionCallbackInfo<Value>& args) {
+  // args[0] == Array of ArrayBufferViews
+  // args[1] == Total length, or undefined to use the sum of the lengths
+  Environment* env = Environment::GetCurrent(args);
+  std::vector<Local<ArrayBufferView>> views;
+  size_t total_length;
+  if (!GetConcatViews(env, args[0], &views, &total_length)) return;
+  if (!args[1]->IsUndefined()) {
+    CHECK(args[1]->IsNumber());
+    const double length = args[1].As<Number>()->Value();
+    CHECK_GE(length, 0);
+    total_length = static_cast<size_t>(length);
+  }
+
+  Local<Object> result;
+  if (ConcatViews(env, views, total_length).ToLocal(&result))
+    args.GetReturnValue().Set(result);
+}
+
+// Accumulates buffers without copying them until contiguous access is
+// needed, e.g. for request bodies that are only read once they are
+// complete. flatten() joins the chunks with one allocation and keeps the
+// result as the only chunk, so that repeated calls do not copy again.
+class BufferRope final : public BaseObject {
+ public:
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args.IsConstructCall());
+    new BufferRope(env, args.This());
+  }
+
+  static void Append(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    BufferRope* rope;
+    ASSIGN_OR_RETURN_UNWRAP(&rope, args.This());
+    THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+    Local<ArrayBufferView> view = args[0].As<ArrayBufferView>();
+    const size_t length = view->ByteLength();
+    if (length > kMaxLength - rope->byte_length_) {
+      env->isolate()->ThrowException(ERR_BUFFER_TOO_LARGE(env->isolate()));
+      return;
+    }
+    if (length > 0) {
+      rope->chunks_.emplace_back(env->isolate(), view);
+      rope->byte_length_ += length;
+    }
+    args.GetReturnValue().Set(static_cast<double>(rope->byte_length_));
+  }
+
+  static void ByteLength(const FunctionCallbackInfo<Value>& args) {
+    BufferRope* rope;
+    ASSIGN_OR_RETURN_UNWRAP(&rope, args.This());
+    args.GetReturnValue().Set(static_cast<double>(rope->byte_length_));
+  }
+
+  static void Flatten(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    BufferRope* rope;
+    ASSIGN_OR_RETURN_UNWRAP(&rope, args.This());
+    Isolate* isolate = env->isolate();
+
+    if (rope->chunks_.size() == 1) {
+      Local<ArrayBufferView> chunk = rope->chunks_[0].Get(isolate);
+      if (chunk->IsUint8Array()) {
+        return args.GetReturnValue().Set(chunk);
+      }
+    }
+
+    std::vector<Local<ArrayBufferView>> views;
+    views.reserve(rope->chunks_.size());
+    for (const auto& chunk : rope->chunks_) views.push_back(chunk.Get(isolate));
+
+    Local<Object> result;
+    if (!ConcatViews(env, views, rope->byte_length_).ToLocal(&result)) return;
+    rope->chunks_.clear();
+    if (rope->byte_length_ > 0)
+      rope->chunks_.emplace_back(isolate, result.As<ArrayBufferView>());
+    args.GetReturnValue().Set(result);
+  }
+
+  static void Clear(const FunctionCallbackInfo<Value>& args) {
+    BufferRope* rope;
+    ASSIGN_OR_RETURN_UNWRAP(&rope, args.This());
+    rope->chunks_.clear();
+    rope->byte_length_ = 0;
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackField("chunks", chunks_);
+  }
+
+  SET_MEMORY_INFO_NAME(BufferRope)
+  SET_SELF_SIZE(BufferRope)
+
+ private:
+  BufferRope(Environment* env, Local<Object> wrap) : BaseObject(env, wrap) {
+    MakeWeak();
+  }
+
+  std::vector<Global<ArrayBufferView>> chunks_;
+  size_t byte_length_ = 0;
+};
+
 template <encoding encoding>
 void SlowWriteString(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
@@ -1517,9 +1910,23 @@ void Initialize(Local<Object> target,
                             SlowIndexOfNumber,
                             &fast_index_of_number);
   SetMethodNoSideEffect(context, target, "indexOfString", IndexOfString);
+  SetMethodNoSideEffect(context, target, "indexOfAny", IndexOfAny);
+  SetMethodNoSideEffect(context, target, "indexesOf", IndexesOf);
+  SetMethodNoSideEffect(context, target, "split", Split);
 
   SetMethod(context, target, "detachArrayBuffer", DetachArrayBuffer);
   SetMethod(context, target, "copyArrayBuffer", CopyArrayBuffer);
+  SetMethodNoSideEffect(context, target, "concat", Concat);
+
+  Local<FunctionTemplate> rope = NewFunctionTemplate(isolate, BufferRope::New);
+  rope->InstanceTemplate()->SetInternalFieldCount(
+      BufferRope::kInternalFieldCount);
+  SetProtoMethod(isolate, rope, "append", BufferRope::Append);
+  SetProtoMethodNoSideEffect(
+      isolate, rope, "byteLength", BufferRope::ByteLength);
+  SetProtoMethod(isolate, rope, "flatten", BufferRope::Flatten);
+  SetProtoMethod(isolate, rope, "clear", BufferRope::Clear);
+  SetConstructorFunction(context, target, "BufferRope", rope);
 
   SetMethod(context, target, "swap16", Swap16);
   SetMethod(context, target, "swap32", Swap32);
@@ -1582,6 +1989,9 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(FastIndexOfNumber);
   registry->Register(fast_index_of_number.GetTypeInfo());
   registry->Register(IndexOfString);
+  registry->Register(IndexOfAny);
+  registry->Register(IndexesOf);
+  registry->Register(Split);
 
   registry->Register(Swap16);
   registry->Register(Swap32);
@@ -1614,6 +2024,12 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
 
   registry->Register(DetachArrayBuffer);
   registry->Register(CopyArrayBuffer);
+  registry->Register(Concat);
+  registry->Register(BufferRope::New);
+  registry->Register(BufferRope::Append);
+  registry->Register(BufferRope::ByteLength);
+  registry->Register(BufferRope::Flatten);
+  registry->Register(BufferRope::Clear);
 
   registry->Register(Atob);
   registry->Register(Btoa);
@@ -1,4 +1,5 @@
 #include "node_builtins.h"
+#include "compile_cache.h"
 #include "debug_utils-inl.h"
 #include "env-inl.h"
 #include "node_external_reference.h"
@@ -281,7 +282,27 @@ MaybeLocal<Function> BuiltinLoader::LookupAndCompileInternal(
     }
   }
 
-  const bool has_cache = cached_data.data != nullptr;
+  ScriptCompiler::CachedData* script_cached_data =
+      cached_data.data != nullptr ? cached_data.AsCachedData().release()
+                                  : nullptr;
+
+  // Builtins that are not covered by the code cache in the binary or in the
+  // snapshot are looked up in the on-disk compile cache, so that they are
+  // only compiled from source once across runs.
+  CompileCacheEntry* disk_cache_entry = nullptr;
+  if (script_cached_data == nullptr && optional_realm != nullptr) {
+    Environment* env = optional_realm->env();
+    if (env->use_compile_cache() &&
+        !env->isolate_data()->is_building_snapshot()) {
+      disk_cache_entry = env->compile_cache_handler()->GetOrInsert(
+          source, filename, CachedCodeType::kBuiltin);
+    }
+    if (disk_cache_entry != nullptr && disk_cache_entry->cache != nullptr) {
+      script_cached_data = disk_cache_entry->CopyCache();
+    }
+  }
+
+  const bool has_cache = script_cached_data != nullptr;
   ScriptCompiler::CompileOptions options =
       has_cache ? ScriptCompiler::kConsumeCodeCache
                 : ScriptCompiler::kNoCompileOptions;
@@ -292,10 +313,8 @@ MaybeLocal<Function> BuiltinLoader::LookupAndCompileInternal(
       options = ScriptCompiler::kEagerCompile;
     }
   }
-  ScriptCompiler::Source script_source(
-      source,
-      origin,
-      has_cache ? cached_data.AsCachedData().release() : nullptr);
+  // script_source takes ownership of script_cached_data.
+  ScriptCompiler::Source script_source(source, origin, script_cached_data);
 
   per_process::Debug(
       DebugCategory::CODE_CACHE,
@@ -304,6 +323,7 @@ MaybeLocal<Function> BuiltinLoader::LookupAndCompileInternal(
       has_cache ? "with" : "without",
       options == ScriptCompiler::kEagerCompile ? "eagerly" : "lazily");
 
+  uint64_t compile_start = uv_hrtime();
   MaybeLocal<Function> maybe_fun =
       ScriptCompiler::CompileFunction(context,
                                       &script_source,
@@ -312,6 +332,9 @@ MaybeLocal<Function> BuiltinLoader::LookupAndCompileInternal(
                                       0,
                                       nullptr,
                                       options);
+  if (optional_realm != nullptr) {
+    optional_realm->builtins_compile_time += uv_hrtime() - compile_start;
+  }
 
   // This could fail when there are early errors in the built-in modules,
   // e.g. the syntax errors
@@ -348,6 +371,13 @@ MaybeLocal<Function> BuiltinLoader::LookupAndCompileInternal(
                                                                : "is accepted");
   }
 
+  if (disk_cache_entry != nullptr) {
+    optional_realm->env()->compile_cache_handler()->MaybeSave(
+        disk_cache_entry,
+        fun,
+        has_cache && script_source.GetCachedData()->rejected);
+  }
+
   if (result == Result::kWithoutCache && optional_realm != nullptr &&
       !optional_realm->env()->isolate_data()->is_building_snapshot()) {
     // We failed to accept this cache, maybe because it was rejected, maybe
@@ -643,6 +673,15 @@ void BuiltinLoader::GetCacheUsage(const FunctionCallbackInfo<Value>& args) {
     return;
   }
 
+  // In milliseconds, like the performance milestones.
+  if (result
+          ->Set(context,
+                OneByteString(isolate, "compileTime"),
+                v8::Number::New(isolate, realm->builtins_compile_time / 1e6))
+          .IsNothing()) {
+    return;
+  }
+
   args.GetReturnValue().Set(result);
 }
 
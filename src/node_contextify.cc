@@ -48,6 +48,7 @@ using v8::EscapableHandleScope;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
 using v8::HandleScope;
 using v8::IndexedPropertyHandlerConfiguration;
 using v8::IndexFilter;
@@ -68,6 +69,7 @@ using v8::MicrotasksPolicy;
 using v8::Name;
 using v8::NamedPropertyHandlerConfiguration;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::PrimitiveArray;
@@ -117,8 +119,18 @@ Local<Name> Uint32ToName(Local<Context> context, uint32_t index) {
 }  // anonymous namespace
 
 BaseObjectPtr<ContextifyContext> ContextifyContext::New(
-    Environment* env, Local<Object> sandbox_obj, ContextOptions* options) {
+    Environment* env,
+    Local<Object> sandbox_obj,
+    ContextOptions* options,
+    ContextPool* pool) {
   HandleScope scope(env->isolate());
+  Local<Context> v8_context;
+  // Pooled contexts share the microtask queue of the main context.
+  if (pool != nullptr && !options->own_microtask_queue &&
+      pool->Take().ToLocal(&v8_context)) {
+    return New(v8_context, env, sandbox_obj, options);
+  }
+
   Local<ObjectTemplate> object_template = env->contextify_global_template();
   DCHECK(!object_template.IsEmpty());
   const SnapshotData* snapshot_data = env->isolate_data()->snapshot_data();
@@ -128,7 +140,6 @@ BaseObjectPtr<ContextifyContext> ContextifyContext::New(
           ? options->own_microtask_queue.get()
           : env->isolate()->GetCurrentContext()->GetMicrotaskQueue();
 
-  Local<Context> v8_context;
   if (!(CreateV8Context(env->isolate(), object_template, snapshot_data, queue)
             .ToLocal(&v8_context))) {
     // Allocation failure, maximum call stack size reached, termination, etc.
@@ -375,11 +386,12 @@ void ContextifyContext::RegisterExternalReferences(
   registry->Register(IndexedPropertyEnumeratorCallback);
 }
 
-// makeContext(sandbox, name, origin, strings, wasm);
+// makeContext(sandbox, name, origin, strings, wasm, ownMicrotaskQueue,
+//             hostDefinedOptionId[, pool]);
 void ContextifyContext::MakeContext(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
 
-  CHECK_EQ(args.Length(), 7);
+  CHECK(args.Length() == 7 || args.Length() == 8);
   CHECK(args[0]->IsObject());
   Local<Object> sandbox = args[0].As<Object>();
 
@@ -413,9 +425,15 @@ void ContextifyContext::MakeContext(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[6]->IsSymbol());
   options.host_defined_options_id = args[6].As<Symbol>();
 
+  ContextPool* pool = nullptr;
+  if (args.Length() == 8 && !args[7]->IsUndefined()) {
+    CHECK(args[7]->IsObject());
+    ASSIGN_OR_RETURN_UNWRAP(&pool, args[7].As<Object>());
+  }
+
   TryCatchScope try_catch(env);
   BaseObjectPtr<ContextifyContext> context_ptr =
-      ContextifyContext::New(env, sandbox, &options);
+      ContextifyContext::New(env, sandbox, &options, pool);
 
   if (try_catch.HasCaught()) {
     if (!try_catch.HasTerminated())
@@ -892,6 +910,179 @@ Intercepted ContextifyContext::IndexedPropertyDeleterCallback(
   return Intercepted::kYes;
 }
 
+ContextPool::ContextPool(Environment* env, Local<Object> object, size_t size)
+    : BaseObject(env, object), size_(size) {
+  MakeWeak();
+}
+
+void ContextPool::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize(
+      "contexts", contexts_.size() * sizeof(Global<Context>));
+}
+
+void ContextPool::CreatePerIsolateProperties(IsolateData* isolate_data,
+                                             Local<ObjectTemplate> target) {
+  Isolate* isolate = isolate_data->isolate();
+  Local<FunctionTemplate> tmpl = NewFunctionTemplate(isolate, New);
+  tmpl->InstanceTemplate()->SetInternalFieldCount(
+      ContextPool::kInternalFieldCount);
+  SetProtoMethod(isolate, tmpl, "fill", Fill);
+  SetProtoMethodNoSideEffect(isolate, tmpl, "getStats", GetStats);
+  SetConstructorFunction(isolate, target, "ContextPool", tmpl);
+}
+
+void ContextPool::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Fill);
+  registry->Register(GetStats);
+}
+
+// new ContextPool(size)
+void ContextPool::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsUint32());
+  size_t size = args[0].As<Uint32>()->Value();
+  CHECK_GT(size, 0);
+  new ContextPool(env, args.This(), size);
+}
+
+void ContextPool::Fill(const FunctionCallbackInfo<Value>& args) {
+  ContextPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.This());
+  size_t count = pool->size_;
+  if (args[0]->IsUint32()) {
+    count = std::min<size_t>(count, args[0].As<Uint32>()->Value());
+  }
+  if (!pool->Fill(count)) return;
+  args.GetReturnValue().Set(static_cast<uint32_t>(pool->contexts_.size()));
+}
+
+void ContextPool::GetStats(const FunctionCallbackInfo<Value>& args) {
+  ContextPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.This());
+  Isolate* isolate = args.GetIsolate();
+  Local<Value> stats[] = {
+      Number::New(isolate, static_cast<double>(pool->contexts_.size())),
+      Number::New(isolate, static_cast<double>(pool->hits_)),
+      Number::New(isolate, static_cast<double>(pool->misses_)),
+  };
+  args.GetReturnValue().Set(Array::New(isolate, stats, arraysize(stats)));
+}
+
+bool ContextPool::Fill(size_t count) {
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope scope(isolate);
+  Local<ObjectTemplate> object_template = env->contextify_global_template();
+  const SnapshotData* snapshot_data = env->isolate_data()->snapshot_data();
+  MicrotaskQueue* queue = env->context()->GetMicrotaskQueue();
+
+  while (contexts_.size() < count) {
+    Local<Context> context;
+    if (!ContextifyContext::CreateV8Context(
+             isolate, object_template, snapshot_data, queue)
+             .ToLocal(&context)) {
+      return false;
+    }
+    contexts_.emplace_back(isolate, context);
+  }
+  return true;
+}
+
+MaybeLocal<Context> ContextPool::Take() {
+  if (contexts_.empty()) {
+    misses_++;
+    ScheduleRefill();
+    return MaybeLocal<Context>();
+  }
+  hits_++;
+  Local<Context> context = PersistentToLocal::Strong(contexts_.front());
+  contexts_.pop_front();
+  if (contexts_.size() <= size_ / 2) ScheduleRefill();
+  return context;
+}
+
+void ContextPool::ScheduleRefill() {
+  if (refill_scheduled_) return;
+  refill_scheduled_ = true;
+  env()->SetImmediate(
+      [pool = BaseObjectWeakPtr<ContextPool>(this)](Environment* env) {
+        if (!pool) return;
+        pool->refill_scheduled_ = false;
+        // Termination or allocation failure; the next Take() retries.
+        USE(pool->Fill(pool->size_));
+      },
+      CallbackFlags::kUnrefed);
+}
+
+std::string ScriptCodeCache::GetKey(Isolate* isolate,
+                                    Local<String> code,
+                                    const std::vector<Local<String>>* params) {
+  std::string key;
+  if (params != nullptr) {
+    // Parameter names cannot contain NUL, so they cannot run into the body.
+    for (Local<String> param : *params) {
+      Utf8Value param_utf8(isolate, param);
+      key.append(param_utf8.out(), param_utf8.length());
+      key.push_back('\0');
+    }
+    key.push_back('\0');
+  }
+  Utf8Value code_utf8(isolate, code);
+  key.append(code_utf8.out(), code_utf8.length());
+  return key;
+}
+
+ScriptCompiler::CachedData* ScriptCodeCache::Get(const std::string& key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  const ScriptCompiler::CachedData* data = it->second->data.get();
+  return new ScriptCompiler::CachedData(
+      data->data, data->length, ScriptCompiler::CachedData::BufferNotOwned);
+}
+
+void ScriptCodeCache::Put(std::string&& key, ScriptCompiler::CachedData* data) {
+  std::unique_ptr<ScriptCompiler::CachedData> owned(data);
+  if (owned == nullptr || key.size() + owned->length > max_size_) return;
+
+  auto it = index_.find(key);
+  if (it != index_.end()) Evict(it->second);
+
+  entries_.push_front(Entry{std::move(key), std::move(owned)});
+  index_.emplace(entries_.front().key, entries_.begin());
+  size_ += entries_.front().size();
+  while (size_ > max_size_) Evict(std::prev(entries_.end()));
+}
+
+void ScriptCodeCache::Evict(std::list<Entry>::iterator it) {
+  size_ -= it->size();
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+void ScriptCodeCache::GetStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  ScriptCodeCache* cache = env->isolate_data()->script_code_cache();
+  if (cache == nullptr) return;
+  Isolate* isolate = env->isolate();
+  Local<Value> stats[] = {
+      Number::New(isolate, static_cast<double>(cache->entries_.size())),
+      Number::New(isolate, static_cast<double>(cache->size_)),
+      Number::New(isolate, static_cast<double>(cache->max_size_)),
+      Number::New(isolate, static_cast<double>(cache->hits_)),
+      Number::New(isolate, static_cast<double>(cache->misses_)),
+      Number::New(isolate, static_cast<double>(cache->rejected_)),
+  };
+  args.GetReturnValue().Set(Array::New(isolate, stats, arraysize(stats)));
+}
+
 void ContextifyScript::CreatePerIsolateProperties(
     IsolateData* isolate_data, Local<ObjectTemplate> target) {
   Isolate* isolate = isolate_data->isolate();
@@ -984,6 +1175,27 @@ void ContextifyScript::New(const FunctionCallbackInfo<Value>& args) {
         data + cached_data_buf->ByteOffset(), cached_data_buf->ByteLength());
   }
 
+  // Without cachedData from the caller, look for the code of an earlier
+  // script with the same source in memory, and then on disk.
+  ScriptCodeCache* code_cache =
+      cached_data == nullptr ? env->isolate_data()->script_code_cache()
+                             : nullptr;
+  std::string code_cache_key;
+  bool code_cache_hit = false;
+  CompileCacheEntry* disk_cache_entry = nullptr;
+  if (code_cache != nullptr) {
+    code_cache_key = ScriptCodeCache::GetKey(isolate, code, nullptr);
+    cached_data = code_cache->Get(code_cache_key);
+    code_cache_hit = cached_data != nullptr;
+    if (!code_cache_hit && env->use_compile_cache()) {
+      disk_cache_entry = env->compile_cache_handler()->GetOrInsert(
+          code, filename, CachedCodeType::kVmScript);
+    }
+    if (disk_cache_entry != nullptr && disk_cache_entry->cache != nullptr) {
+      cached_data = disk_cache_entry->CopyCache();
+    }
+  }
+
   Local<PrimitiveArray> host_defined_options =
       PrimitiveArray::New(isolate, loader::HostDefinedOptions::kLength);
   host_defined_options->Set(
@@ -1028,6 +1240,21 @@ void ContextifyScript::New(const FunctionCallbackInfo<Value>& args) {
   contextify_script->script_.SetWeak();
   contextify_script->object()->SetInternalField(kUnboundScriptSlot, v8_script);
 
+  if (code_cache != nullptr) {
+    bool rejected = cached_data != nullptr && cached_data->rejected;
+    if (rejected) code_cache->OnRejected();
+    if (disk_cache_entry != nullptr) {
+      env->compile_cache_handler()->MaybeSave(
+          disk_cache_entry, v8_script, rejected);
+    }
+    if (!code_cache_hit || rejected) {
+      code_cache->Put(std::move(code_cache_key),
+                      ScriptCompiler::CreateCodeCache(v8_script));
+    }
+    // The cache was not requested by the caller, so it is not reported.
+    compile_options = ScriptCompiler::kNoCompileOptions;
+  }
+
   std::unique_ptr<ScriptCompiler::CachedData> new_cached_data;
   if (produce_cached_data) {
     new_cached_data.reset(ScriptCompiler::CreateCodeCache(v8_script));
@@ -1396,14 +1623,6 @@ void ContextifyContext::CompileFunction(
                       false,           // is WASM
                       false,           // is ES Module
                       host_defined_options);
-  ScriptCompiler::Source source(code, origin, cached_data);
-
-  ScriptCompiler::CompileOptions options;
-  if (source.GetCachedData() != nullptr) {
-    options = ScriptCompiler::kConsumeCodeCache;
-  } else {
-    options = ScriptCompiler::kNoCompileOptions;
-  }
 
   Context::Scope scope(parsing_context);
 
@@ -1429,16 +1648,40 @@ void ContextifyContext::CompileFunction(
     }
   }
 
+  // Without cachedData from the caller, look for the code of an earlier
+  // function with the same source and parameters. Functions compiled with
+  // context extensions are not cached.
+  ScriptCodeCache* code_cache = env->isolate_data()->script_code_cache();
+  std::string code_cache_key;
+  if (code_cache != nullptr && cached_data == nullptr &&
+      context_extensions.empty()) {
+    code_cache_key = ScriptCodeCache::GetKey(isolate, code, &params);
+    cached_data = code_cache->Get(code_cache_key);
+  } else {
+    code_cache = nullptr;
+  }
+
+  ScriptCompiler::Source source(code, origin, cached_data);
+
+  ScriptCompiler::CompileOptions options;
+  if (source.GetCachedData() != nullptr) {
+    options = ScriptCompiler::kConsumeCodeCache;
+  } else {
+    options = ScriptCompiler::kNoCompileOptions;
+  }
+
   TryCatchScope try_catch(env);
-  Local<Object> result = CompileFunctionAndCacheResult(env,
-                                                       parsing_context,
-                                                       &source,
-                                                       params,
-                                                       context_extensions,
-                                                       options,
-                                                       produce_cached_data,
-                                                       id_symbol,
-                                                       try_catch);
+  Local<Object> result = CompileFunctionAndCacheResult(
+      env,
+      parsing_context,
+      &source,
+      params,
+      context_extensions,
+      options,
+      produce_cached_data,
+      id_symbol,
+      code_cache != nullptr ? &code_cache_key : nullptr,
+      try_catch);
 
   if (try_catch.HasCaught() && !try_catch.HasTerminated()) {
     try_catch.ReThrow();
@@ -1470,6 +1713,7 @@ Local<Object> ContextifyContext::CompileFunctionAndCacheResult(
     ScriptCompiler::CompileOptions options,
     bool produce_cached_data,
     Local<Symbol> id_symbol,
+    std::string* code_cache_key,
     const TryCatchScope& try_catch) {
   MaybeLocal<Function> maybe_fn = ScriptCompiler::CompileFunction(
       parsing_context,
@@ -1506,6 +1750,20 @@ Local<Object> ContextifyContext::CompileFunctionAndCacheResult(
           .IsNothing())
     return Object::New(env->isolate());
 
+  if (code_cache_key != nullptr) {
+    // The cache can only have come from the ScriptCodeCache.
+    ScriptCodeCache* code_cache = env->isolate_data()->script_code_cache();
+    bool hit = options == ScriptCompiler::kConsumeCodeCache;
+    bool rejected = hit && source->GetCachedData()->rejected;
+    if (rejected) code_cache->OnRejected();
+    if (!hit || rejected) {
+      code_cache->Put(std::move(*code_cache_key),
+                      ScriptCompiler::CreateCodeCacheForFunction(fn));
+    }
+    // The cache was not requested by the caller, so it is not reported.
+    options = ScriptCompiler::kNoCompileOptions;
+  }
+
   std::unique_ptr<ScriptCompiler::CachedData> new_cached_data;
   if (produce_cached_data) {
     new_cached_data.reset(ScriptCompiler::CreateCodeCacheForFunction(fn));
@@ -1900,6 +2158,7 @@ void CreatePerIsolateProperties(IsolateData* isolate_data,
 
   ContextifyContext::CreatePerIsolateProperties(isolate_data, target);
   ContextifyScript::CreatePerIsolateProperties(isolate_data, target);
+  ContextPool::CreatePerIsolateProperties(isolate_data, target);
 
   SetMethod(isolate, target, "startSigintWatchdog", StartSigintWatchdog);
   SetMethod(isolate, target, "stopSigintWatchdog", StopSigintWatchdog);
@@ -1915,6 +2174,10 @@ void CreatePerIsolateProperties(IsolateData* isolate_data,
 
   SetMethod(isolate, target, "containsModuleSyntax", ContainsModuleSyntax);
   SetMethod(isolate, target, "shouldRetryAsESM", ShouldRetryAsESM);
+  SetMethodNoSideEffect(isolate,
+                        target,
+                        "getScriptCodeCacheStats",
+                        ScriptCodeCache::GetStats);
 }
 
 static void CreatePerContextProperties(Local<Object> target,
@@ -1953,6 +2216,7 @@ static void CreatePerContextProperties(Local<Object> target,
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   ContextifyContext::RegisterExternalReferences(registry);
   ContextifyScript::RegisterExternalReferences(registry);
+  ContextPool::RegisterExternalReferences(registry);
 
   registry->Register(CompileFunctionForCJSLoader);
   registry->Register(StartSigintWatchdog);
@@ -1961,6 +2225,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(MeasureMemory);
   registry->Register(ContainsModuleSyntax);
   registry->Register(ShouldRetryAsESM);
+  registry->Register(ScriptCodeCache::GetStats);
 }
 }  // namespace contextify
 }  // namespace node
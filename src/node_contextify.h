@@ -7,6 +7,11 @@
 #include "node_context_data.h"
 #include "node_errors.h"
 
+#include <deque>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+
 namespace node {
 class ExternalReferenceRegistry;
 
@@ -21,6 +26,8 @@ struct ContextOptions {
   v8::Local<v8::Symbol> host_defined_options_id;
 };
 
+class ContextPool;
+
 class ContextifyContext : public BaseObject {
  public:
   ContextifyContext(Environment* env,
@@ -72,7 +79,8 @@ class ContextifyContext : public BaseObject {
  private:
   static BaseObjectPtr<ContextifyContext> New(Environment* env,
                                               v8::Local<v8::Object> sandbox_obj,
-                                              ContextOptions* options);
+                                              ContextOptions* options,
+                                              ContextPool* pool = nullptr);
   // Initialize a context created from CreateV8Context()
   static BaseObjectPtr<ContextifyContext> New(v8::Local<v8::Context> ctx,
                                               Environment* env,
@@ -93,6 +101,7 @@ class ContextifyContext : public BaseObject {
       v8::ScriptCompiler::CompileOptions options,
       bool produce_cached_data,
       v8::Local<v8::Symbol> id_symbol,
+      std::string* code_cache_key,
       const errors::TryCatchScope& try_catch);
   static v8::Intercepted PropertyQueryCallback(
       v8::Local<v8::Name> property,
@@ -139,6 +148,94 @@ class ContextifyContext : public BaseObject {
   std::unique_ptr<v8::MicrotaskQueue> microtask_queue_;
 };
 
+// Keeps a number of vm contexts deserialized from the vm context snapshot
+// ready, so that vm.createContext() only has to attach a sandbox to one.
+// A context that was handed out is never returned to the pool, since
+// scripts that ran in it may have modified the builtins of the context in
+// ways that cannot be undone. Instead the pool refills itself in an
+// immediate once it drops to half of its size.
+class ContextPool : public BaseObject {
+ public:
+  ContextPool(Environment* env, v8::Local<v8::Object> object, size_t size);
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(ContextPool)
+  SET_SELF_SIZE(ContextPool)
+
+  static void CreatePerIsolateProperties(IsolateData* isolate_data,
+                                         v8::Local<v8::ObjectTemplate> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  // Returns an empty handle if the pool is exhausted. The context is bound
+  // to the microtask queue of the main context.
+  v8::MaybeLocal<v8::Context> Take();
+
+ private:
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // fill([count]): creates contexts until the pool holds |count| of them,
+  // or is full. Returns the number of contexts in the pool.
+  static void Fill(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // getStats(): returns [available, hits, misses].
+  static void GetStats(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  bool Fill(size_t count);
+  void ScheduleRefill();
+
+  const size_t size_;
+  std::deque<v8::Global<v8::Context>> contexts_;
+  bool refill_scheduled_ = false;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+// A per-isolate cache of the code of vm scripts and functions, keyed by
+// their source, so that compiling the same source again, e.g. into many
+// contexts, consumes a code cache instead of compiling from scratch. It is
+// only used when the caller did not pass cachedData. The least recently
+// used entries are evicted to stay within the size given to
+// --vm-code-cache-size, which counts both the sources and the code.
+class ScriptCodeCache final {
+ public:
+  explicit ScriptCodeCache(size_t max_size) : max_size_(max_size) {}
+  ScriptCodeCache(const ScriptCodeCache&) = delete;
+  ScriptCodeCache& operator=(const ScriptCodeCache&) = delete;
+
+  // The key of a function includes its parameters, which change the code
+  // that is compiled for the same body.
+  static std::string GetKey(v8::Isolate* isolate,
+                            v8::Local<v8::String> code,
+                            const std::vector<v8::Local<v8::String>>* params);
+
+  // Returns the cached code for |key| for V8 to consume, or nullptr. The
+  // returned data points into the cache, and is only valid until the next
+  // call to Put().
+  v8::ScriptCompiler::CachedData* Get(const std::string& key);
+  // Replaces the entry of |key|. Takes ownership of |data|.
+  void Put(std::string&& key, v8::ScriptCompiler::CachedData* data);
+  void OnRejected() { rejected_++; }
+
+  // getScriptCodeCacheStats(): returns [entries, size, maxSize, hits,
+  // misses, rejected], or undefined if the cache is disabled.
+  static void GetStats(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+ private:
+  struct Entry {
+    std::string key;
+    std::unique_ptr<v8::ScriptCompiler::CachedData> data;
+    size_t size() const { return key.size() + data->length; }
+  };
+  void Evict(std::list<Entry>::iterator it);
+
+  const size_t max_size_;
+  size_t size_ = 0;
+  // Most recently used first. The map keys point into the entries.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t rejected_ = 0;
+};
+
 class ContextifyScript : public BaseObject {
  public:
   enum InternalFields {
@@ -39,6 +39,7 @@ namespace crypto {
 #define CRYPTO_NAMESPACE_LIST_BASE(V)                                          \
   V(AES)                                                                       \
   V(CipherBase)                                                                \
+  V(CryptoThreadPool)                                                          \
   V(DiffieHellman)                                                             \
   V(DSAAlg)                                                                    \
   V(ECDH)                                                                      \
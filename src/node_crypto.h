@@ -46,6 +46,7 @@
 #include "crypto/crypto_scrypt.h"
 #include "crypto/crypto_sig.h"
 #include "crypto/crypto_spkac.h"
+#include "crypto/crypto_threadpool.h"
 #include "crypto/crypto_timing.h"
 #include "crypto/crypto_tls.h"
 #include "crypto/crypto_util.h"
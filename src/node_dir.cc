@@ -10,6 +10,7 @@
 #include "tracing/trace_event.h"
 
 #include "string_bytes.h"
+#include "threadpoolwork-inl.h"
 
 #include <fcntl.h>
 #include <sys/types.h>
@@ -44,6 +45,9 @@ using v8::Object;
 using v8::ObjectTemplate;
 using v8::Value;
 
+// Upper bound for the number of entries a single prefetch reads.
+constexpr size_t kMaxPrefetchBatchSize = 4096;
+
 static const char* get_dir_func_name_by_type(uv_fs_type req_type) {
   switch (req_type) {
 #define FS_TYPE_TO_NAME(type, name)                                            \
@@ -96,6 +100,72 @@ static const char* get_dir_func_name_by_type(uv_fs_type req_type) {
                                   name,                                        \
                                   value);
 
+// Reads one batch of entries on the threadpool. The entries are copied out
+// of the uv_dirent_t array so that the next batch can be read into it before
+// the previous one is converted for JS. FinishPrefetch() can take the result
+// from the main thread before AfterThreadPoolWork() runs; whichever of the
+// two comes second deletes the work.
+class DirHandle::PrefetchWork final : public ThreadPoolWork {
+ public:
+  PrefetchWork(DirHandle* handle, size_t batch_size)
+      : ThreadPoolWork(handle->env(), "readdir"),
+        handle_(handle),
+        dir_(handle->dir()),
+        dirents_(batch_size) {}
+
+  void DoThreadPoolWork() override {
+    dir_->dirents = dirents_.data();
+    dir_->nentries = dirents_.size();
+
+    uv_fs_t req;
+    int result = uv_fs_readdir(nullptr, &req, dir_, nullptr);
+    for (int i = 0; i < result; i++)
+      entries_.push_back(Entry{dirents_[i].name, dirents_[i].type});
+    uv_fs_req_cleanup(&req);
+
+    dir_->dirents = nullptr;
+    dir_->nentries = 0;
+
+    Mutex::ScopedLock lock(mutex_);
+    result_ = result;
+    finished_ = true;
+    cond_.Broadcast(lock);
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<PrefetchWork> self(this);
+    BaseObjectPtr<DirHandle> handle = std::move(handle_);
+    if (taken_) return;
+    handle->OnPrefetchDone(this, status);
+  }
+
+  // Called on the main thread while the work is still queued or running.
+  // Returns false if it was cancelled before reading anything.
+  bool Wait() {
+    taken_ = true;
+    if (CancelWork() == 0) return false;
+    Mutex::ScopedLock lock(mutex_);
+    while (!finished_) cond_.Wait(lock);
+    return true;
+  }
+
+  int result() const { return result_; }
+  std::vector<Entry>* entries() { return &entries_; }
+  size_t batch_size() const { return dirents_.size(); }
+
+ private:
+  BaseObjectPtr<DirHandle> handle_;
+  uv_dir_t* dir_;
+  std::vector<uv_dirent_t> dirents_;
+  std::vector<Entry> entries_;
+  int result_ = 0;
+  bool taken_ = false;
+
+  Mutex mutex_;
+  ConditionVariable cond_;
+  bool finished_ = false;
+};
+
 DirHandle::DirHandle(Environment* env, Local<Object> obj, uv_dir_t* dir)
     : AsyncWrap(env, obj, AsyncWrap::PROVIDER_DIRHANDLE),
       dir_(dir) {
@@ -128,6 +198,109 @@ DirHandle::~DirHandle() {
 
 void DirHandle::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackFieldWithSize("dir", sizeof(*dir_));
+  tracker->TrackFieldWithSize("prefetched",
+                              prefetched_.capacity() * sizeof(Entry));
+}
+
+void DirHandle::StartPrefetch() {
+  if (prefetch_ != nullptr || closing_ || closed_ || prefetch_eof_ ||
+      prefetch_error_ != 0) {
+    return;
+  }
+  prefetch_ = new PrefetchWork(this, prefetch_batch_size_);
+  prefetch_->ScheduleWork();
+}
+
+void DirHandle::FinishPrefetch() {
+  if (prefetch_ == nullptr) return;
+  PrefetchWork* work = prefetch_;
+  prefetch_ = nullptr;
+  // AfterThreadPoolWork() still runs and deletes the work.
+  if (work->Wait()) TakePrefetchResult(work, 0);
+}
+
+void DirHandle::OnPrefetchDone(PrefetchWork* work, int status) {
+  CHECK_EQ(prefetch_, work);
+  prefetch_ = nullptr;
+  TakePrefetchResult(work, status);
+  if (pending_read_) ResolvePendingRead();
+}
+
+void DirHandle::TakePrefetchResult(PrefetchWork* work, int status) {
+  if (status == UV_ECANCELED) {
+    prefetch_error_ = UV_ECANCELED;
+  } else if (work->result() < 0) {
+    prefetch_error_ = work->result();
+  } else if (work->result() == 0) {
+    prefetch_eof_ = true;
+  } else {
+    std::vector<Entry>* entries = work->entries();
+    if (prefetched_.empty()) {
+      prefetched_.swap(*entries);
+    } else {
+      std::move(entries->begin(), entries->end(),
+                std::back_inserter(prefetched_));
+    }
+    if (static_cast<size_t>(work->result()) == work->batch_size()) {
+      prefetch_batch_size_ =
+          std::min(prefetch_batch_size_ * 2,
+                   std::max(kMaxPrefetchBatchSize, dirents_.size()));
+    }
+  }
+}
+
+void DirHandle::ResolvePendingRead() {
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(pending_read_);
+  req_wrap->Detach();
+  if (!env()->can_call_into_js()) return;
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  if (prefetched_.empty()) {
+    if (prefetch_error_ != 0) {
+      int err = prefetch_error_;
+      prefetch_error_ = 0;
+      return req_wrap->Reject(
+          UVException(isolate, err, req_wrap->syscall()));
+    }
+    CHECK(prefetch_eof_);
+    return req_wrap->Resolve(Null(isolate));
+  }
+
+  std::vector<Entry> entries;
+  entries.swap(prefetched_);
+  // Read the next batch while this one is being consumed.
+  StartPrefetch();
+
+  Local<Value> error;
+  Local<Array> js_array;
+  if (!EntryListToArray(isolate, entries, req_wrap->encoding(), &error)
+           .ToLocal(&js_array)) {
+    return req_wrap->Reject(error);
+  }
+  req_wrap->Resolve(js_array);
+}
+
+MaybeLocal<Array> DirHandle::EntryListToArray(Isolate* isolate,
+                                              const std::vector<Entry>& ents,
+                                              enum encoding encoding,
+                                              Local<Value>* err_out) {
+  MaybeStackBuffer<Local<Value>, 64> entries(ents.size() * 2);
+
+  size_t j = 0;
+  for (const Entry& ent : ents) {
+    if (!StringBytes::Encode(
+             isolate, ent.name.data(), ent.name.size(), encoding, err_out)
+             .ToLocal(&entries[j])) {
+      return MaybeLocal<Array>();
+    }
+    entries[j + 1] = Integer::New(isolate, ent.type);
+    j += 2;
+  }
+
+  return Array::New(isolate, entries.out(), j);
 }
 
 // Close the directory handle if it hasn't already been closed. A process
@@ -136,6 +309,8 @@ void DirHandle::MemoryInfo(MemoryTracker* tracker) const {
 // will crash the process immediately.
 inline void DirHandle::GCClose() {
   if (closed_) return;
+  // A PrefetchWork in flight keeps the handle alive, so none can be left.
+  CHECK_NULL(prefetch_);
   uv_fs_t req;
   FS_DIR_SYNC_TRACE_BEGIN(closedir);
   int ret = uv_fs_closedir(nullptr, &req, dir_, nullptr);
@@ -189,6 +364,10 @@ void DirHandle::Close(const FunctionCallbackInfo<Value>& args) {
   DirHandle* dir;
   ASSIGN_OR_RETURN_UNWRAP(&dir, args.This());
 
+  // The threadpool must be done with the uv_dir_t before it is closed.
+  dir->FinishPrefetch();
+  dir->prefetched_.clear();
+
   dir->closing_ = false;
   dir->closed_ = true;
 
@@ -236,47 +415,6 @@ static MaybeLocal<Array> DirentListToArray(
   return Array::New(env->isolate(), entries.out(), j);
 }
 
-static void AfterDirRead(uv_fs_t* req) {
-  BaseObjectPtr<FSReqBase> req_wrap { FSReqBase::from_req(req) };
-  FSReqAfterScope after(req_wrap.get(), req);
-  FS_DIR_ASYNC_TRACE_END1(
-      req->fs_type, req_wrap, "result", static_cast<int>(req->result))
-  if (!after.Proceed()) {
-    return;
-  }
-
-  Environment* env = req_wrap->env();
-  Isolate* isolate = env->isolate();
-
-  if (req->result == 0) {
-    // Done
-    Local<Value> done = Null(isolate);
-    after.Clear();
-    req_wrap->Resolve(done);
-    return;
-  }
-
-  uv_dir_t* dir = static_cast<uv_dir_t*>(req->ptr);
-
-  Local<Value> error;
-  Local<Array> js_array;
-  if (!DirentListToArray(env,
-                         dir->dirents,
-                         static_cast<int>(req->result),
-                         req_wrap->encoding(),
-                         &error)
-           .ToLocal(&js_array)) {
-    // Clear libuv resources *before* delivering results to JS land because
-    // that can schedule another operation on the same uv_dir_t. Ditto below.
-    after.Clear();
-    return req_wrap->Reject(error);
-  }
-
-  after.Clear();
-  req_wrap->Resolve(js_array);
-}
-
-
 void DirHandle::Read(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Isolate* isolate = env->isolate();
@@ -293,17 +431,53 @@ void DirHandle::Read(const FunctionCallbackInfo<Value>& args) {
 
   if (buffer_size != dir->dirents_.size()) {
     dir->dirents_.resize(buffer_size);
-    dir->dir_->nentries = buffer_size;
-    dir->dir_->dirents = dir->dirents_.data();
+    dir->prefetch_batch_size_ = buffer_size;
   }
 
   if (!args[2]->IsUndefined()) {  // dir.read(encoding, bufferSize, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 2);
     CHECK_NOT_NULL(req_wrap_async);
-    FS_DIR_ASYNC_TRACE_BEGIN0(UV_FS_READDIR, req_wrap_async)
-    AsyncCall(env, req_wrap_async, args, "readdir", encoding,
-              AfterDirRead, uv_fs_readdir, dir->dir());
+    CHECK(!dir->pending_read_);
+    req_wrap_async->Init("readdir", nullptr, 0, encoding);
+    dir->pending_read_.reset(req_wrap_async);
+    if (dir->prefetch_ == nullptr) {
+      if (dir->prefetched_.empty() && !dir->prefetch_eof_ &&
+          dir->prefetch_error_ == 0) {
+        dir->StartPrefetch();
+      } else {
+        // The next batch is already here, but the callback must not run
+        // before read() returns.
+        env->SetImmediate([dir = BaseObjectPtr<DirHandle>(dir)](Environment*) {
+          if (dir->pending_read_) dir->ResolvePendingRead();
+        });
+      }
+    }
+    req_wrap_async->SetReturnValue(args);
   } else {  // dir.read(encoding, bufferSize)
+    dir->FinishPrefetch();
+    if (!dir->prefetched_.empty() || dir->prefetch_eof_ ||
+        dir->prefetch_error_ != 0) {
+      // Hand out what an earlier asynchronous read prefetched first.
+      std::vector<Entry> entries;
+      entries.swap(dir->prefetched_);
+      if (entries.empty()) {
+        if (dir->prefetch_eof_) return args.GetReturnValue().SetNull();
+        int err = dir->prefetch_error_;
+        dir->prefetch_error_ = 0;
+        return env->ThrowUVException(err, "readdir");
+      }
+      Local<Value> error;
+      Local<Array> js_array;
+      if (!EntryListToArray(isolate, entries, encoding, &error)
+               .ToLocal(&js_array)) {
+        isolate->ThrowException(error);
+        return;
+      }
+      return args.GetReturnValue().Set(js_array);
+    }
+
+    dir->dir_->nentries = dir->dirents_.size();
+    dir->dir_->dirents = dir->dirents_.data();
     FSReqWrapSync req_wrap_sync("readdir");
     FS_DIR_SYNC_TRACE_BEGIN(readdir);
     int err =
@@ -5,6 +5,9 @@
 
 #include "node_file.h"
 
+#include <string>
+#include <vector>
+
 namespace node {
 
 namespace fs_dir {
@@ -36,11 +39,43 @@ class DirHandle : public AsyncWrap {
   // Synchronous close that emits a warning
   void GCClose();
 
+  class PrefetchWork;
+
+  struct Entry {
+    std::string name;
+    uv_dirent_type_t type;
+  };
+
+  // Asynchronous reads are served from entries that a PrefetchWork read on
+  // the threadpool, and the next batch is requested before the current one
+  // is handed to JS.
+  void StartPrefetch();
+  // Waits for the PrefetchWork in flight, if any, and takes its entries.
+  void FinishPrefetch();
+  void OnPrefetchDone(PrefetchWork* work, int status);
+  void TakePrefetchResult(PrefetchWork* work, int status);
+  void ResolvePendingRead();
+  static v8::MaybeLocal<v8::Array> EntryListToArray(
+      v8::Isolate* isolate,
+      const std::vector<Entry>& ents,
+      enum encoding encoding,
+      v8::Local<v8::Value>* err_out);
+
   uv_dir_t* dir_;
   // Multiple entries are read through a single libuv call.
   std::vector<uv_dirent_t> dirents_;
   bool closing_ = false;
   bool closed_ = false;
+
+  PrefetchWork* prefetch_ = nullptr;
+  std::vector<Entry> prefetched_;
+  // Reported once the prefetched entries before it have been consumed.
+  int prefetch_error_ = 0;
+  bool prefetch_eof_ = false;
+  // Starts at the buffer size requested by JS and doubles after every batch
+  // that fills up, up to kMaxPrefetchBatchSize.
+  size_t prefetch_batch_size_ = 0;
+  BaseObjectPtr<fs::FSReqBase> pending_read_;
 };
 
 }  // namespace fs_dir
@@ -7,6 +7,7 @@
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_log_writer.h"
 #include "node_process-inl.h"
 #include "node_report.h"
 #include "node_v8_platform-inl.h"
@@ -432,6 +433,8 @@ static void ReportFatalException(Environment* env,
   CHECK(!message.IsEmpty());
   HandleScope scope(isolate);
 
+  // Buffered output was logged before the exception, so it goes first.
+  log_writer::FlushAll();
   AppendExceptionLine(env, error, message, FATAL_ERROR);
 
   auto report_to_inspector = [&]() {
@@ -567,6 +570,7 @@ static void ReportFatalException(Environment* env,
 }
 
 [[noreturn]] void OnFatalError(const char* location, const char* message) {
+  log_writer::FlushAllOnFatalError();
   if (location) {
     FPrintF(stderr, "FATAL ERROR: %s %s\n", location, message);
   } else {
@@ -592,6 +596,7 @@ void OOMErrorHandler(const char* location, const v8::OOMDetails& details) {
   // We should never recover from this handler so once it's true it's always
   // true.
   is_in_oom.store(true);
+  log_writer::FlushAllOnFatalError();
   const char* message =
       details.is_heap_oom ? "Allocation failed - JavaScript heap out of memory"
                           : "Allocation failed - process out of memory";
@@ -26,6 +26,12 @@ using CFunctionCallbackWithInt64 = void (*)(v8::Local<v8::Object> receiver,
                                             int64_t);
 using CFunctionCallbackWithBool = void (*)(v8::Local<v8::Object> receiver,
                                            bool);
+using CFunctionCallbackWithUint32 = void (*)(v8::Local<v8::Object> receiver,
+                                             uint32_t);
+using CFunctionCallbackWithUint32Bool =
+    void (*)(v8::Local<v8::Object> receiver, uint32_t, bool);
+using CFunctionCallbackWithUint32BoolReturnUint32 =
+    uint32_t (*)(v8::Local<v8::Object> receiver, uint32_t, bool);
 using CFunctionCallbackWithString =
     bool (*)(v8::Local<v8::Value>, const v8::FastOneByteString& input);
 using CFunctionCallbackWithStrings =
@@ -41,12 +47,40 @@ using CFunctionCallbackWithTwoUint8ArraysFallback =
              const v8::FastApiTypedArray<uint8_t>&,
              const v8::FastApiTypedArray<uint8_t>&,
              v8::FastApiCallbackOptions&);
+using CFunctionCallbackWithUint8ArrayFallback =
+    void (*)(v8::Local<v8::Value>,
+             const v8::FastApiTypedArray<uint8_t>&,
+             v8::FastApiCallbackOptions&);
 using CFunctionCallbackWithUint8ArrayUint32Int64Bool =
     int32_t (*)(v8::Local<v8::Value>,
                 const v8::FastApiTypedArray<uint8_t>&,
                 uint32_t,
                 int64_t,
                 bool);
+using CFunctionCallbackWithUint8ArrayReturnInt32 =
+    int32_t (*)(v8::Local<v8::Value>, const v8::FastApiTypedArray<uint8_t>&);
+using CFunctionCallbackWithOneByteStringUint8ArrayReturnInt32 =
+    int32_t (*)(v8::Local<v8::Value>,
+                const v8::FastOneByteString&,
+                const v8::FastApiTypedArray<uint8_t>&);
+using CFunctionCallbackWithOneByteStringUint8ArrayFallback =
+    void (*)(v8::Local<v8::Value>,
+             const v8::FastOneByteString&,
+             const v8::FastApiTypedArray<uint8_t>&,
+             v8::FastApiCallbackOptions&);
+using CFunctionCallbackWithOneByteStringUint8ArrayFallbackReturnInt32 =
+    int32_t (*)(v8::Local<v8::Value>,
+                const v8::FastOneByteString&,
+                const v8::FastApiTypedArray<uint8_t>&,
+                v8::FastApiCallbackOptions&);
+using CFunctionCallbackWithTwoOneByteStringsUint8ArrayFallbackReturnInt32 =
+    int32_t (*)(v8::Local<v8::Value>,
+                const v8::FastOneByteString&,
+                const v8::FastOneByteString&,
+                const v8::FastApiTypedArray<uint8_t>&,
+                v8::FastApiCallbackOptions&);
+using CFunctionCallbackValueReturnInt32 =
+    int32_t (*)(v8::Local<v8::Value> receiver);
 using CFunctionWithUint32 = uint32_t (*)(v8::Local<v8::Value>,
                                          const uint32_t input);
 using CFunctionWithDoubleReturnDouble = double (*)(v8::Local<v8::Value>,
@@ -55,6 +89,9 @@ using CFunctionWithInt64Fallback = void (*)(v8::Local<v8::Value>,
                                             const int64_t,
                                             v8::FastApiCallbackOptions&);
 using CFunctionWithBool = void (*)(v8::Local<v8::Value>, bool);
+using CFunctionWithUint32Double = void (*)(v8::Local<v8::Value>,
+                                           uint32_t,
+                                           double);
 
 using CFunctionWriteString =
     uint32_t (*)(v8::Local<v8::Value> receiver,
@@ -85,15 +122,26 @@ class ExternalReferenceRegistry {
   V(CFunctionCallbackValueReturnDouble)                                        \
   V(CFunctionCallbackWithInt64)                                                \
   V(CFunctionCallbackWithBool)                                                 \
+  V(CFunctionCallbackWithUint32)                                               \
+  V(CFunctionCallbackWithUint32Bool)                                           \
+  V(CFunctionCallbackWithUint32BoolReturnUint32)                               \
   V(CFunctionCallbackWithString)                                               \
   V(CFunctionCallbackWithStrings)                                              \
   V(CFunctionCallbackWithTwoUint8Arrays)                                       \
   V(CFunctionCallbackWithTwoUint8ArraysFallback)                               \
+  V(CFunctionCallbackWithUint8ArrayFallback)                                   \
   V(CFunctionCallbackWithUint8ArrayUint32Int64Bool)                            \
+  V(CFunctionCallbackWithUint8ArrayReturnInt32)                                \
+  V(CFunctionCallbackWithOneByteStringUint8ArrayReturnInt32)                   \
+  V(CFunctionCallbackWithOneByteStringUint8ArrayFallback)                      \
+  V(CFunctionCallbackWithOneByteStringUint8ArrayFallbackReturnInt32)           \
+  V(CFunctionCallbackWithTwoOneByteStringsUint8ArrayFallbackReturnInt32)       \
+  V(CFunctionCallbackValueReturnInt32)                                         \
   V(CFunctionWithUint32)                                                       \
   V(CFunctionWithDoubleReturnDouble)                                           \
   V(CFunctionWithInt64Fallback)                                                \
   V(CFunctionWithBool)                                                         \
+  V(CFunctionWithUint32Double)                                                 \
   V(CFunctionBufferCopy)                                                       \
   V(CFunctionWriteString)                                                      \
   V(const v8::CFunctionInfo*)                                                  \
@@ -111,6 +159,7 @@ class ExternalReferenceRegistry {
   V(v8::IndexedPropertyDefinerCallbackV2)                                      \
   V(v8::IndexedPropertyDeleterCallbackV2)                                      \
   V(v8::IndexedPropertyQueryCallbackV2)                                        \
+  V(v8::Module::SyntheticModuleEvaluationSteps)                                \
   V(const v8::String::ExternalStringResourceBase*)
 
 #define V(ExternalReferenceType)                                               \
@@ -152,29 +201,36 @@ class ExternalReferenceRegistry {
   V(heap_utils)                                                                \
   V(http_parser)                                                               \
   V(internal_only_v8)                                                          \
+  V(json)                                                                      \
+  V(log_writer)                                                                \
   V(messaging)                                                                 \
+  V(metrics)                                                                   \
   V(mksnapshot)                                                                \
   V(module_wrap)                                                               \
   V(modules)                                                                   \
   V(options)                                                                   \
   V(os)                                                                        \
+  V(path)                                                                      \
   V(performance)                                                               \
   V(permission)                                                                \
   V(process_methods)                                                           \
   V(process_object)                                                            \
   V(process_wrap)                                                              \
   V(report)                                                                    \
+  V(ring_channel)                                                              \
   V(task_queue)                                                                \
   V(tcp_wrap)                                                                  \
   V(tty_wrap)                                                                  \
   V(udp_wrap)                                                                  \
   V(url)                                                                       \
+  V(url_pattern)                                                               \
   V(util)                                                                      \
   V(pipe_wrap)                                                                 \
   V(sea)                                                                       \
   V(serdes)                                                                    \
   V(string_decoder)                                                            \
   V(stream_wrap)                                                               \
+  V(shm_channel_wrap)                                                          \
   V(signal_wrap)                                                               \
   V(spawn_sync)                                                                \
   V(trace_events)                                                              \
@@ -4,6 +4,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "node_file.h"
+#include "node_probes.h"
 #include "req_wrap-inl.h"
 
 namespace node {
@@ -54,6 +55,7 @@ void FSReqBase::Init(const char* syscall,
                      enum encoding encoding) {
   syscall_ = syscall;
   encoding_ = encoding;
+  started_at_ = env()->fs_latency_monitor()->Start();
 
   if (data != nullptr) {
     CHECK(!has_data_);
@@ -68,6 +70,7 @@ FSReqBase::FSReqBuffer&
 FSReqBase::Init(const char* syscall, size_t len, enum encoding encoding) {
   syscall_ = syscall;
   encoding_ = encoding;
+  started_at_ = env()->fs_latency_monitor()->Start();
 
   buffer_.AllocateSufficientStorage(len + 1);
   has_data_ = false;  // so that the data does not show up in error messages
@@ -182,8 +185,8 @@ FSReqPromise<AliasedBufferT>::New(BindingData* binding_data,
                                   bool use_bigint) {
   Environment* env = binding_data->env();
   v8::Local<v8::Object> obj;
-  if (!env->fsreqpromise_constructor_template()
-           ->NewInstance(env->context())
+  if (!env->fsreqpromise_pool()
+           ->Get(env, env->fsreqpromise_constructor_template())
            .ToLocal(&obj)) {
     return nullptr;
   }
@@ -201,6 +204,12 @@ FSReqPromise<AliasedBufferT>::~FSReqPromise() {
   // the Isolate is not terminating because in this case the promise might have
   // not finished.
   CHECK_IMPLIES(!finished_, !env()->can_call_into_js());
+  // The promise was created by New() and is only referenced through the
+  // `promise` property, which the next request overwrites.
+  if (finished_ && env()->can_call_into_js()) {
+    v8::HandleScope handle_scope(env()->isolate());
+    env()->fsreqpromise_pool()->Put(env(), object());
+  }
 }
 
 template <typename AliasedBufferT>
@@ -313,6 +322,8 @@ FSReqBase* AsyncDestCall(Environment* env, FSReqBase* req_wrap,
                          Func fn, Args... fn_args) {
   CHECK_NOT_NULL(req_wrap);
   req_wrap->Init(syscall, dest, len, enc);
+  if (NODE_PROBE_ENABLED(fs__op__start))
+    NODE_PROBE2(fs__op__start, req_wrap, syscall);
   int err = req_wrap->Dispatch(fn, fn_args..., after);
   if (err < 0) {
     uv_fs_t* uv_req = req_wrap->req();
@@ -348,7 +359,12 @@ int SyncCall(Environment* env, v8::Local<v8::Value> ctx,
              FSReqWrapSync* req_wrap, const char* syscall,
              Func fn, Args... args) {
   env->PrintSyncTrace();
+  LatencyMonitor* monitor = env->fs_latency_monitor();
+  uint64_t started_at = monitor->Start();
   int err = fn(env->event_loop(), &(req_wrap->req), args..., nullptr);
+  if (started_at != 0) {
+    monitor->Record(req_wrap->req.fs_type, started_at, err);
+  }
   if (err < 0) {
     v8::Local<v8::Context> context = env->context();
     v8::Local<v8::Object> ctx_obj = ctx.As<v8::Object>();
@@ -371,7 +387,12 @@ int SyncCallAndThrowIf(Predicate should_throw,
                        Func fn,
                        Args... args) {
   env->PrintSyncTrace();
+  LatencyMonitor* monitor = env->fs_latency_monitor();
+  uint64_t started_at = monitor->Start();
   int result = fn(nullptr, &(req_wrap->req), args..., nullptr);
+  if (started_at != 0) {
+    monitor->Record(req_wrap->req.fs_type, started_at, result);
+  }
   if (should_throw(result)) {
     env->ThrowUVException(result,
                           req_wrap->syscall_p,
@@ -21,12 +21,14 @@
 #include "node_file.h"  // NOLINT(build/include_inline)
 #include "ada.h"
 #include "aliased_buffer-inl.h"
+#include "histogram-inl.h"
 #include "memory_tracker-inl.h"
 #include "node_buffer.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_file-inl.h"
 #include "node_metadata.h"
+#include "node_metrics.h"
 #include "node_process-inl.h"
 #include "node_stat_watcher.h"
 #include "node_url.h"
@@ -39,10 +41,13 @@
 #include "req_wrap-inl.h"
 #include "stream_base-inl.h"
 #include "string_bytes.h"
+#include "threadpoolwork-inl.h"
 #include "uv.h"
 #include "v8-fast-api-calls.h"
 
+#include <atomic>
 #include <filesystem>
+#include <map>
 
 #if defined(__MINGW32__) || defined(_MSC_VER)
 # include <io.h>
@@ -51,6 +56,9 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -58,7 +66,10 @@ namespace node {
 
 namespace fs {
 
+using errors::TryCatchScope;
 using v8::Array;
+using v8::ArrayBuffer;
+using v8::BackingStore;
 using v8::BigInt;
 using v8::Context;
 using v8::EscapableHandleScope;
@@ -81,6 +92,8 @@ using v8::Object;
 using v8::ObjectTemplate;
 using v8::Promise;
 using v8::String;
+using v8::Uint32;
+using v8::Uint8Array;
 using v8::Undefined;
 using v8::Value;
 
@@ -88,6 +101,143 @@ using v8::Value;
 # define S_ISDIR(mode)  (((mode) & S_IFMT) == S_IFDIR)
 #endif
 
+#ifdef _WIN32
+constexpr char kPathSeparator = '\\';
+#else
+constexpr char kPathSeparator = '/';
+#endif
+
+namespace stat_cache {
+namespace {
+Mutex mutex;
+std::map<std::string, int, std::less<>> entries;
+std::atomic<uint64_t> hits{0};
+std::atomic<uint64_t> misses{0};
+
+// Upper bound on the number of cached paths. The cache is emptied when it is
+// reached; module resolution refills the hot entries right away.
+constexpr size_t kMaxEntries = 16 * 1024;
+
+// Only absolute paths without `.`, `..` or empty segments are cached, so that
+// every path names exactly one key and Invalidate() can find it. Relative
+// paths would also go stale on process.chdir().
+bool IsCacheable(std::string_view path) {
+#ifdef _WIN32
+  // ToNamespacedPath() turns absolute paths into `\\?\C:\...` or UNC form.
+  if (!path.starts_with("\\\\?\\")) return false;
+  path.remove_prefix(4);
+#else
+  if (path.empty() || path[0] != kPathSeparator) return false;
+  path.remove_prefix(1);
+#endif
+  while (!path.empty()) {
+    size_t end = path.find(kPathSeparator);
+    std::string_view segment = path.substr(0, end);
+    if (segment.empty() || segment == "." || segment == "..") return false;
+    if (end == std::string_view::npos) break;
+    path.remove_prefix(end + 1);
+    if (path.empty()) return false;  // Trailing separator.
+  }
+  return true;
+}
+}  // anonymous namespace
+
+bool IsEnabled() {
+  static const bool enabled = []() {
+    Mutex::ScopedLock lock(per_process::cli_options_mutex);
+    return per_process::cli_options->experimental_stat_cache;
+  }();
+  return enabled;
+}
+
+std::optional<int> Lookup(std::string_view path) {
+  if (!IsCacheable(path)) return std::nullopt;
+  Mutex::ScopedLock lock(mutex);
+  auto it = entries.find(path);
+  if (it == entries.end()) {
+    misses++;
+    return std::nullopt;
+  }
+  hits++;
+  return it->second;
+}
+
+void Insert(std::string_view path, int result) {
+  if (!IsCacheable(path)) return;
+  Mutex::ScopedLock lock(mutex);
+  if (entries.size() >= kMaxEntries && entries.find(path) == entries.end())
+    entries.clear();
+  entries.insert_or_assign(std::string(path), result);
+}
+
+void Invalidate(std::string_view path) {
+  if (!IsEnabled()) return;
+  while (path.size() > 1 && path.back() == kPathSeparator)
+    path.remove_suffix(1);
+  // A relative or unnormalized path may alias any cached key, e.g. `a` and
+  // `/cwd/a`, so drop everything.
+  if (!IsCacheable(path)) return Clear();
+  Mutex::ScopedLock lock(mutex);
+  // Entries below `path` sort right after it, though not necessarily
+  // contiguously, e.g. `a/b` < `a/b.js` < `a/b/c`.
+  auto it = entries.lower_bound(path);
+  while (it != entries.end() && it->first.starts_with(path)) {
+    const std::string& key = it->first;
+    if (key.size() == path.size() || key[path.size()] == kPathSeparator) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Clear() {
+  Mutex::ScopedLock lock(mutex);
+  entries.clear();
+}
+
+static void GetCounters(uint64_t* hit_count,
+                        uint64_t* miss_count,
+                        size_t* size) {
+  Mutex::ScopedLock lock(mutex);
+  *hit_count = hits;
+  *miss_count = misses;
+  *size = entries.size();
+}
+}  // namespace stat_cache
+
+// Returns the S_IFMT bits of the st_mode of `path`, or a negative libuv error
+// code, going through the stat cache when it is enabled.
+static int CachedStatMode(uv_loop_t* loop, const char* path) {
+  bool use_cache = stat_cache::IsEnabled();
+  if (use_cache) {
+    std::optional<int> cached = stat_cache::Lookup(path);
+    if (cached.has_value()) return cached.value();
+  }
+
+  uv_fs_t req;
+  int rc = uv_fs_stat(loop, &req, path, nullptr);
+  if (rc == 0) {
+    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
+    rc = static_cast<int>(s->st_mode & S_IFMT);
+  }
+  uv_fs_req_cleanup(&req);
+
+  if (use_cache) stat_cache::Insert(path, rc);
+  return rc;
+}
+
+// Reads issued ahead of the consumer start at this size and double after
+// every read that fills its buffer, up to kMaxReadAheadChunkSize.
+constexpr size_t kInitialReadAheadChunkSize = 64 * 1024;
+constexpr size_t kMaxReadAheadChunkSize = 1024 * 1024;
+constexpr size_t kMaxReadsAheadInFlight = 3;
+
+// Writes queued behind an in-flight write are submitted together, up to this
+// many bytes or kMaxWriteBatchBuffers buffers per uv_fs_write().
+constexpr size_t kDefaultWriteBatchSize = 1024 * 1024;
+constexpr size_t kMaxWriteBatchBuffers = 1024;
+
 inline int64_t GetOffset(Local<Value> value) {
   return IsSafeJsInt(value) ? value.As<Integer>()->Value() : -1;
 }
@@ -136,6 +286,38 @@ static const char* get_fs_func_name_by_type(uv_fs_type req_type) {
   }
 }
 
+void LatencyMonitor::Record(uv_fs_type type,
+                            uint64_t started_at,
+                            ssize_t result) {
+  if (type < 0 || type >= kTypeCount || !latency_[type]) return;
+  latency_[type]->Record(std::max<int64_t>(uv_hrtime() - started_at, 1));
+  if (result <= 0) return;
+  if (type == UV_FS_READ) {
+    read_bytes_->Record(result);
+  } else if (type == UV_FS_WRITE) {
+    write_bytes_->Record(result);
+  }
+}
+
+void LatencyMonitor::StartMonitoring() {
+  if (!read_bytes_) {
+    Histogram::Options options;
+    for (int i = 0; i < kTypeCount; i++) {
+      if (GetTypeName(static_cast<uv_fs_type>(i)) != nullptr)
+        latency_[i] = std::make_shared<Histogram>(options);
+    }
+    read_bytes_ = std::make_shared<Histogram>(options);
+    write_bytes_ = std::make_shared<Histogram>(options);
+  }
+  monitoring_ = true;
+}
+
+const char* LatencyMonitor::GetTypeName(uv_fs_type type) {
+  if (type == UV_FS_CUSTOM) return nullptr;
+  const char* name = get_fs_func_name_by_type(type);
+  return strcmp(name, "unknown") != 0 ? name : nullptr;
+}
+
 #define TRACE_NAME(name) "fs.sync." #name
 #define GET_TRACE_ENABLED                                                      \
   (*TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED(                                \
@@ -201,7 +383,16 @@ void FSContinuationData::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("paths", paths_);
 }
 
-FileHandleReadWrap::~FileHandleReadWrap() = default;
+FileHandleReadWrap::~FileHandleReadWrap() {
+  ReleaseReadAheadStorage();
+}
+
+void FileHandleReadWrap::ReleaseReadAheadStorage() {
+  if (read_ahead_storage_.base == nullptr) return;
+  env()->recycle_managed_buffer(
+      env()->release_managed_buffer(read_ahead_storage_));
+  read_ahead_storage_ = uv_buf_init(nullptr, 0);
+}
 
 FSReqBase::~FSReqBase() = default;
 
@@ -217,6 +408,8 @@ FileHandle::FileHandle(BindingData* binding_data,
     : AsyncWrap(binding_data->env(), obj, AsyncWrap::PROVIDER_FILEHANDLE),
       StreamBase(env()),
       fd_(fd),
+      read_ahead_chunk_size_(kInitialReadAheadChunkSize),
+      write_batch_size_(kDefaultWriteBatchSize),
       binding_data_(binding_data) {
   MakeWeak();
   StreamBase::AttachToObject(GetObject());
@@ -265,15 +458,153 @@ FileHandle::~FileHandle() {
   CHECK(closed_);    // We have to be closed at the point
 }
 
+typedef SimpleWriteWrap<ReqWrap<uv_fs_t>> FileHandleWriteWrap;
+
+WriteWrap* FileHandle::CreateWriteWrap(Local<Object> object) {
+  return new FileHandleWriteWrap(this, object);
+}
+
 int FileHandle::DoWrite(WriteWrap* w,
                         uv_buf_t* bufs,
                         size_t count,
                         uv_stream_t* send_handle) {
-  return UV_ENOSYS;  // Not implemented (yet).
+  CHECK_NULL(send_handle);
+  if (closing_ || closed_ || pending_shutdown_ != nullptr) return UV_EBADF;
+
+  write_queue_.push_back(PendingWrite{BaseObjectPtr<AsyncWrap>(
+                                          w->GetAsyncWrap()),
+                                      w,
+                                      std::vector<uv_buf_t>(bufs,
+                                                            bufs + count)});
+  if (writes_in_flight_ > 0) return 0;
+
+  // Nothing was in flight, so this write is the whole batch. If it cannot be
+  // submitted the caller reports the error and w->Done() must not be called.
+  CHECK_EQ(write_queue_.size(), 1);
+  int err = FlushWrites();
+  if (err < 0) write_queue_.clear();
+  return err;
+}
+
+int FileHandle::FlushWrites() {
+  CHECK_EQ(writes_in_flight_, 0);
+  if (write_queue_.empty()) return 0;
+
+  write_batch_bufs_.clear();
+  size_t batch_bytes = 0;
+  size_t entries = 0;
+  for (const PendingWrite& pending : write_queue_) {
+    size_t bytes = 0;
+    for (const uv_buf_t& buf : pending.bufs) bytes += buf.len;
+    // Always submit at least one write, however large it is.
+    if (entries > 0 &&
+        (batch_bytes + bytes > write_batch_size_ ||
+         write_batch_bufs_.size() + pending.bufs.size() >
+             kMaxWriteBatchBuffers)) {
+      break;
+    }
+    write_batch_bufs_.insert(
+        write_batch_bufs_.end(), pending.bufs.begin(), pending.bufs.end());
+    batch_bytes += bytes;
+    entries++;
+  }
+
+  // uv_fs_write() rejects an empty list of buffers, but an empty write is
+  // still a write the caller expects a callback for.
+  if (write_batch_bufs_.empty())
+    write_batch_bufs_.push_back(uv_buf_init(nullptr, 0));
+
+  // The head of the batch carries the uv_fs_t for all of it.
+  FileHandleWriteWrap* req_wrap =
+      static_cast<FileHandleWriteWrap*>(write_queue_.front().write_wrap);
+  FS_ASYNC_TRACE_BEGIN0(UV_FS_WRITE, req_wrap)
+  int err = req_wrap->Dispatch(
+      uv_fs_write,
+      fd_,
+      write_batch_bufs_.data(),
+      static_cast<unsigned int>(write_batch_bufs_.size()),
+      -1,
+      uv_fs_callback_t{[](uv_fs_t* req) {
+        FileHandleWriteWrap* req_wrap = static_cast<FileHandleWriteWrap*>(
+            FileHandleWriteWrap::from_req(req));
+        FS_ASYNC_TRACE_END1(
+            req->fs_type, req_wrap, "result", static_cast<int>(req->result))
+        FileHandle* handle = static_cast<FileHandle*>(req_wrap->stream());
+        ssize_t result = req->result;
+        uv_fs_req_cleanup(req);
+        handle->AfterWrite(result);
+      }});
+  if (err < 0) return err;
+
+  writes_in_flight_ = entries;
+  write_keepalive_.reset(this);
+  return 0;
+}
+
+void FileHandle::AfterWrite(ssize_t result) {
+  size_t in_flight = writes_in_flight_;
+  writes_in_flight_ = 0;
+
+  // Take the writes that finished off the queue before anything can call
+  // back into JS, so that writes issued from their callbacks stay behind
+  // the ones still queued.
+  std::vector<PendingWrite> done;
+  int status = 0;
+  if (result < 0) {
+    status = static_cast<int>(result);
+  } else {
+    size_t remaining = static_cast<size_t>(result);
+    for (size_t i = 0; i < in_flight; i++) {
+      PendingWrite& pending = write_queue_.front();
+      size_t bytes = 0;
+      for (const uv_buf_t& buf : pending.bufs) bytes += buf.len;
+      if (bytes > remaining) {
+        // Short write: keep the rest of this write at the front of the
+        // queue so the next batch picks it up where this one stopped.
+        auto it = pending.bufs.begin();
+        while (remaining >= it->len) remaining -= (it++)->len;
+        it->base += remaining;
+        it->len -= remaining;
+        pending.bufs.erase(pending.bufs.begin(), it);
+        // No progress at all means the next attempt would not do better.
+        if (result == 0) status = UV_EIO;
+        break;
+      }
+      remaining -= bytes;
+      done.push_back(std::move(pending));
+      write_queue_.pop_front();
+    }
+  }
+
+  BaseObjectPtr<FileHandle> keepalive = std::move(write_keepalive_);
+
+  if (status == 0) status = FlushWrites();
+  // After an error nothing behind the failed write is attempted.
+  std::deque<PendingWrite> failed;
+  if (status < 0) failed.swap(write_queue_);
+
+  for (PendingWrite& pending : done) pending.write_wrap->Done(0);
+  for (PendingWrite& pending : failed) pending.write_wrap->Done(status);
+
+  if (write_queue_.empty() && pending_shutdown_ != nullptr) {
+    ShutdownWrap* shutdown = pending_shutdown_;
+    pending_shutdown_ = nullptr;
+    DoShutdown(shutdown);
+  }
+}
+
+void FileHandle::SetWriteBatchSize(const FunctionCallbackInfo<Value>& args) {
+  FileHandle* fd;
+  ASSIGN_OR_RETURN_UNWRAP(&fd, args.This());
+  CHECK(args[0]->IsUint32());
+  fd->write_batch_size_ = args[0].As<Uint32>()->Value();
 }
 
 void FileHandle::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("current_read", current_read_);
+  tracker->TrackField("read_ahead", read_ahead_);
+  tracker->TrackFieldWithSize("write_queue",
+                              write_queue_.size() * sizeof(PendingWrite));
 }
 
 BaseObject::TransferMode FileHandle::GetTransferMode() const {
@@ -456,6 +787,16 @@ MaybeLocal<Promise> FileHandle::ClosePromise() {
   object()->SetInternalField(FileHandle::kClosingPromiseSlot, promise);
 
   CloseReq* req = new CloseReq(env(), close_req_obj, promise, object());
+  if (HasReadsInFlight()) {
+    pending_close_ = req;
+  } else {
+    DispatchClose(req);
+  }
+  return scope.Escape(promise);
+}
+
+void FileHandle::DispatchClose(CloseReq* req) {
+  ClearReadAhead();
   auto AfterClose = uv_fs_callback_t{[](uv_fs_t* req) {
     CloseReq* req_wrap = CloseReq::from_req(req);
     FS_ASYNC_TRACE_END1(
@@ -477,11 +818,11 @@ MaybeLocal<Promise> FileHandle::ClosePromise() {
   FS_ASYNC_TRACE_BEGIN0(UV_FS_CLOSE, req)
   int ret = req->Dispatch(uv_fs_close, fd_, AfterClose);
   if (ret < 0) {
+    Isolate* isolate = env()->isolate();
+    HandleScope handle_scope(isolate);
     req->Reject(UVException(isolate, ret, "close"));
     delete req;
   }
-
-  return scope.Escape(promise);
 }
 
 void FileHandle::Close(const FunctionCallbackInfo<Value>& args) {
@@ -523,51 +864,77 @@ FileHandleReadWrap::FileHandleReadWrap(FileHandle* handle, Local<Object> obj)
   : ReqWrap(handle->env(), obj, AsyncWrap::PROVIDER_FSREQCALLBACK),
     file_handle_(handle) {}
 
+BaseObjectPtr<FileHandleReadWrap> FileHandle::NewReadWrap() {
+  // Create a new FileHandleReadWrap or re-use one.
+  // Either way, we need these two scopes for AsyncReset() or otherwise
+  // for creating the new instance.
+  HandleScope handle_scope(env()->isolate());
+  AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(this);
+
+  BaseObjectPtr<FileHandleReadWrap> read_wrap;
+  auto& freelist = binding_data_->file_handle_read_wrap_freelist;
+  if (freelist.size() > 0) {
+    read_wrap = std::move(freelist.back());
+    freelist.pop_back();
+    // Use a fresh async resource.
+    // Lifetime is ensured via AsyncWrap::resource_.
+    Local<Object> resource = Object::New(env()->isolate());
+    USE(resource->Set(
+        env()->context(), env()->handle_string(), read_wrap->object()));
+    read_wrap->AsyncReset(resource);
+    read_wrap->file_handle_ = this;
+  } else {
+    Local<Object> wrap_obj;
+    if (!env()
+             ->filehandlereadwrap_template()
+             ->NewInstance(env()->context())
+             .ToLocal(&wrap_obj)) {
+      return {};
+    }
+    read_wrap = MakeDetachedBaseObject<FileHandleReadWrap>(this, wrap_obj);
+  }
+  return read_wrap;
+}
+
+void FileHandle::RecycleReadWrap(
+    BaseObjectPtr<FileHandleReadWrap>&& read_wrap) {
+  // Push the read wrap back to the freelist, or let it be destroyed
+  // once we’re exiting the current scope.
+  constexpr size_t kWantedFreelistFill = 100;
+  auto& freelist = binding_data_->file_handle_read_wrap_freelist;
+  if (freelist.size() < kWantedFreelistFill) {
+    read_wrap->Reset();
+    read_wrap->ReleaseReadAheadStorage();
+    freelist.emplace_back(std::move(read_wrap));
+  }
+}
+
 int FileHandle::ReadStart() {
   if (!IsAlive() || IsClosing())
     return UV_EOF;
 
   reading_ = true;
 
-  if (current_read_)
+  // Positional reads do not race on the file position, so several of them
+  // can be kept in flight instead of serializing disk latency with whatever
+  // the consumer does with the data.
+  if (read_offset_ >= 0) {
+    FlushReadAhead();
+    ReadAhead();
     return 0;
+  }
 
-  BaseObjectPtr<FileHandleReadWrap> read_wrap;
+  if (current_read_)
+    return 0;
 
   if (read_length_ == 0) {
     EmitRead(UV_EOF);
     return 0;
   }
 
-  {
-    // Create a new FileHandleReadWrap or re-use one.
-    // Either way, we need these two scopes for AsyncReset() or otherwise
-    // for creating the new instance.
-    HandleScope handle_scope(env()->isolate());
-    AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(this);
-
-    auto& freelist = binding_data_->file_handle_read_wrap_freelist;
-    if (freelist.size() > 0) {
-      read_wrap = std::move(freelist.back());
-      freelist.pop_back();
-      // Use a fresh async resource.
-      // Lifetime is ensured via AsyncWrap::resource_.
-      Local<Object> resource = Object::New(env()->isolate());
-      USE(resource->Set(
-          env()->context(), env()->handle_string(), read_wrap->object()));
-      read_wrap->AsyncReset(resource);
-      read_wrap->file_handle_ = this;
-    } else {
-      Local<Object> wrap_obj;
-      if (!env()
-               ->filehandlereadwrap_template()
-               ->NewInstance(env()->context())
-               .ToLocal(&wrap_obj)) {
-        return UV_EBUSY;
-      }
-      read_wrap = MakeDetachedBaseObject<FileHandleReadWrap>(this, wrap_obj);
-    }
-  }
+  BaseObjectPtr<FileHandleReadWrap> read_wrap = NewReadWrap();
+  if (!read_wrap) return UV_EBUSY;
+
   int64_t recommended_read = 65536;
   if (read_length_ >= 0 && read_length_ <= recommended_read)
     recommended_read = read_length_;
@@ -575,6 +942,7 @@ int FileHandle::ReadStart() {
   read_wrap->buffer_ = EmitAlloc(recommended_read);
 
   current_read_ = std::move(read_wrap);
+  read_keepalive_.reset(this);
   FS_ASYNC_TRACE_BEGIN0(UV_FS_READ, current_read_.get())
   current_read_->Dispatch(uv_fs_read,
                           fd_,
@@ -602,14 +970,7 @@ int FileHandle::ReadStart() {
 
     uv_fs_req_cleanup(req);
 
-    // Push the read wrap back to the freelist, or let it be destroyed
-    // once we’re exiting the current scope.
-    constexpr size_t kWantedFreelistFill = 100;
-    auto& freelist = handle->binding_data_->file_handle_read_wrap_freelist;
-    if (freelist.size() < kWantedFreelistFill) {
-      read_wrap->Reset();
-      freelist.emplace_back(std::move(read_wrap));
-    }
+    handle->RecycleReadWrap(std::move(read_wrap));
 
     if (result >= 0) {
       // Read at most as many bytes as we originally planned to.
@@ -620,10 +981,6 @@ int FileHandle::ReadStart() {
       // how much we have read.
       if (handle->read_length_ >= 0)
         handle->read_length_ -= result;
-
-      // If we have an offset, increase it by how much we have read.
-      if (handle->read_offset_ >= 0)
-        handle->read_offset_ += result;
     }
 
     // Reading 0 bytes from a file always means EOF, or that we reached
@@ -636,11 +993,210 @@ int FileHandle::ReadStart() {
     // Start over, if EmitRead() didn’t tell us to stop.
     if (handle->reading_)
       handle->ReadStart();
+    handle->AfterRead();
   }});
 
   return 0;
 }
 
+void FileHandle::ReadAhead() {
+  if (!read_ahead_advised_) {
+    read_ahead_advised_ = true;
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Only a hint; errors (e.g. for pipes) are irrelevant.
+    USE(posix_fadvise(fd_,
+                      read_offset_,
+                      read_length_ > 0 ? read_length_ : 0,
+                      POSIX_FADV_SEQUENTIAL));
+#endif
+  }
+
+  bool dispatch_failed = false;
+  while (reading_ && IsAlive() && !IsClosing() &&
+         pending_shutdown_ == nullptr && !read_ahead_eof_ &&
+         read_length_ != 0 && read_ahead_.size() < kMaxReadsAheadInFlight) {
+    size_t size = read_ahead_chunk_size_;
+    if (read_length_ >= 0 && static_cast<uint64_t>(read_length_) < size)
+      size = static_cast<size_t>(read_length_);
+
+    BaseObjectPtr<FileHandleReadWrap> read_wrap = NewReadWrap();
+    if (!read_wrap) break;
+    // Listeners that accept managed buffers take this memory over as it is.
+    read_wrap->read_ahead_storage_ = env()->allocate_managed_buffer(size);
+    read_wrap->buffer_ = uv_buf_init(read_wrap->read_ahead_storage_.base, size);
+    read_wrap->offset_ = read_offset_;
+    read_wrap->result_ = 0;
+    read_wrap->consumed_ = 0;
+    read_wrap->done_ = false;
+    read_wrap->discarded_ = false;
+
+    read_offset_ += size;
+    if (read_length_ >= 0) read_length_ -= size;
+
+    FileHandleReadWrap* req_wrap = read_wrap.get();
+    read_ahead_.emplace_back(std::move(read_wrap));
+    FS_ASYNC_TRACE_BEGIN0(UV_FS_READ, req_wrap)
+    int err = req_wrap->Dispatch(uv_fs_read,
+                                 fd_,
+                                 &req_wrap->buffer_,
+                                 1,
+                                 req_wrap->offset_,
+                                 uv_fs_callback_t{[](uv_fs_t* req) {
+      FileHandleReadWrap* req_wrap = FileHandleReadWrap::from_req(req);
+      FS_ASYNC_TRACE_END1(
+          req->fs_type, req_wrap, "result", static_cast<int>(req->result))
+      req_wrap->result_ = req->result;
+      req_wrap->done_ = true;
+      uv_fs_req_cleanup(req);
+
+      FileHandle* handle = req_wrap->file_handle_;
+      if (!handle->closing_) {
+        handle->FlushReadAhead();
+        handle->ReadAhead();
+      }
+      handle->AfterRead();
+    }});
+    if (err < 0) {
+      req_wrap->result_ = err;
+      req_wrap->done_ = true;
+      dispatch_failed = true;
+      break;
+    }
+    read_keepalive_.reset(this);
+  }
+
+  if (dispatch_failed) FlushReadAhead();
+
+  // The listener has been told about an error already.
+  if (reading_ && read_ahead_.empty() && !read_ahead_failed_ &&
+      (read_length_ == 0 || read_ahead_eof_)) {
+    EmitRead(UV_EOF);
+  }
+}
+
+void FileHandle::DiscardReadAhead() {
+  for (const auto& read_wrap : read_ahead_) {
+    if (read_wrap->discarded_) continue;
+    read_wrap->discarded_ = true;
+    if (read_length_ >= 0) read_length_ += read_wrap->buffer_.len;
+  }
+}
+
+void FileHandle::FlushReadAhead() {
+  while (reading_ && !read_ahead_.empty() && read_ahead_.front()->done_) {
+    FileHandleReadWrap* read_wrap = read_ahead_.front().get();
+    const ssize_t result = read_wrap->result_;
+    const size_t requested = read_wrap->buffer_.len;
+
+    if (!read_wrap->discarded_ && read_wrap->consumed_ == 0) {
+      if (result <= 0) {
+        // Everything behind an error or EOF is stale.
+        read_wrap->discarded_ = true;
+        DiscardReadAhead();
+        read_ahead_eof_ = true;
+        if (result < 0) {
+          read_ahead_failed_ = true;
+          EmitRead(result);
+        }
+      } else if (static_cast<size_t>(result) < requested) {
+        // A short read means the end of the file was reached while the
+        // reads behind this one were already in flight. Throw those away
+        // and continue from where this one stopped, in case the file grows.
+        auto self = read_ahead_.front();
+        read_ahead_.pop_front();
+        DiscardReadAhead();
+        read_ahead_.push_front(std::move(self));
+        read_offset_ = read_wrap->offset_ + result;
+        if (read_length_ >= 0) read_length_ += requested - result;
+      } else if (read_ahead_chunk_size_ < kMaxReadAheadChunkSize) {
+        read_ahead_chunk_size_ *= 2;
+      }
+    }
+
+    if (!read_wrap->discarded_ && read_wrap->consumed_ == 0 && result > 0 &&
+        listener_->AcceptsManagedBuffers()) {
+      uv_buf_t buf = read_wrap->read_ahead_storage_;
+      read_wrap->read_ahead_storage_ = uv_buf_init(nullptr, 0);
+      read_wrap->consumed_ = result;
+      EmitRead(result, buf);
+    } else if (!read_wrap->discarded_) {
+      // The listener may hand out less memory than it is offered, and may
+      // stop reading at any point, so the data can be delivered in pieces.
+      while (reading_ && read_wrap->consumed_ < static_cast<size_t>(result)) {
+        const size_t remaining = result - read_wrap->consumed_;
+        uv_buf_t buf = EmitAlloc(remaining);
+        const size_t length = std::min(remaining, buf.len);
+        memcpy(buf.base,
+               read_wrap->read_ahead_storage_.base + read_wrap->consumed_,
+               length);
+        read_wrap->consumed_ += length;
+        EmitRead(length, buf);
+      }
+      if (read_wrap->consumed_ < static_cast<size_t>(result)) return;
+    }
+
+    if (read_ahead_.empty() || read_ahead_.front().get() != read_wrap) return;
+    BaseObjectPtr<FileHandleReadWrap> done = std::move(read_ahead_.front());
+    read_ahead_.pop_front();
+    RecycleReadWrap(std::move(done));
+  }
+}
+
+void FileHandle::ClearReadAhead() {
+  while (!read_ahead_.empty()) {
+    CHECK(read_ahead_.front()->done_);
+    BaseObjectPtr<FileHandleReadWrap> done = std::move(read_ahead_.front());
+    read_ahead_.pop_front();
+    RecycleReadWrap(std::move(done));
+  }
+}
+
+bool FileHandle::HasReadsInFlight() const {
+  if (current_read_) return true;
+  return std::any_of(read_ahead_.begin(),
+                     read_ahead_.end(),
+                     [](const auto& read_wrap) { return !read_wrap->done_; });
+}
+
+void FileHandle::AfterRead() {
+  if (HasReadsInFlight()) return;
+  if (pending_close_ != nullptr) {
+    CloseReq* req = pending_close_;
+    pending_close_ = nullptr;
+    DispatchClose(req);
+  } else if (pending_shutdown_ != nullptr && write_queue_.empty()) {
+    ShutdownWrap* shutdown = pending_shutdown_;
+    pending_shutdown_ = nullptr;
+    DoShutdown(shutdown);
+  }
+  // This may destroy the FileHandle.
+  read_keepalive_.reset();
+}
+
+bool FileHandle::StartSendfile(int64_t* offset, int64_t* length) {
+  if (reading_ || closing_ || closed_ || current_read_ || !read_ahead_.empty())
+    return false;
+#ifdef _WIN32
+  return false;
+#else
+  if (read_offset_ < 0) {
+    // The file position is not advanced by sendfile(), so switch the stream
+    // over to explicit offsets from where the position is now.
+    off_t position = lseek(fd_, 0, SEEK_CUR);
+    if (position < 0) return false;
+    read_offset_ = position;
+  }
+  *offset = read_offset_;
+  *length = read_length_;
+  return true;
+#endif
+}
+
+void FileHandle::AdvanceSendfile(size_t bytes) {
+  read_offset_ += bytes;
+  if (read_length_ >= 0) read_length_ -= bytes;
+}
+
 int FileHandle::ReadStop() {
   reading_ = false;
   return 0;
@@ -657,8 +1213,16 @@ int FileHandle::DoShutdown(ShutdownWrap* req_wrap) {
     req_wrap->Done(0);
     return 1;
   }
+  // Close once the queued writes have reached the file, and the reads that
+  // are still in flight have completed.
+  if (!write_queue_.empty() || HasReadsInFlight()) {
+    CHECK_NULL(pending_shutdown_);
+    pending_shutdown_ = req_wrap;
+    return 0;
+  }
   FileHandleCloseWrap* wrap = static_cast<FileHandleCloseWrap*>(req_wrap);
   closing_ = true;
+  ClearReadAhead();
   CHECK_NE(fd_, -1);
   FS_ASYNC_TRACE_BEGIN0(UV_FS_CLOSE, wrap)
   wrap->Dispatch(uv_fs_close, fd_, uv_fs_callback_t{[](uv_fs_t* req) {
@@ -716,6 +1280,17 @@ FSReqAfterScope::FSReqAfterScope(FSReqBase* wrap, uv_fs_t* req)
       handle_scope_(wrap->env()->isolate()),
       context_scope_(wrap->env()->context()) {
   CHECK_EQ(wrap_->req(), req);
+  if (NODE_PROBE_ENABLED(fs__op__done)) {
+    NODE_PROBE3(fs__op__done,
+                wrap,
+                wrap->syscall(),
+                static_cast<int64_t>(req->result));
+  }
+  metrics::runtime().fs_requests->Increment();
+  if (wrap->started_at() != 0) {
+    wrap->env()->fs_latency_monitor()->Record(
+        req->fs_type, wrap->started_at(), req->result);
+  }
 }
 
 FSReqAfterScope::~FSReqAfterScope() {
@@ -763,6 +1338,33 @@ bool FSReqAfterScope::Proceed() {
   return true;
 }
 
+FSReqThreadPoolWork::FSReqThreadPoolWork(FSReqBase* req_wrap, const char* type)
+    : ThreadPoolWork(req_wrap->env(), type), req_wrap_(req_wrap) {}
+
+void FSReqThreadPoolWork::AfterThreadPoolWork(int status) {
+  std::unique_ptr<FSReqThreadPoolWork> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+
+  Environment* env = req_wrap->env();
+  if (!env->can_call_into_js()) return;
+
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  if (status == UV_ECANCELED) result_ = UV_ECANCELED;
+  if (result_ < 0) {
+    return req_wrap->Reject(UVException(
+        env->isolate(),
+        result_,
+        req_wrap->syscall(),
+        nullptr,
+        error_path_.empty() ? nullptr : error_path_.c_str(),
+        req_wrap->data()));
+  }
+  Resolve(req_wrap.get());
+}
+
 void AfterNoArgs(uv_fs_t* req) {
   FSReqBase* req_wrap = FSReqBase::from_req(req);
   FSReqAfterScope after(req_wrap, req);
@@ -1008,6 +1610,14 @@ static void ExistsSync(const FunctionCallbackInfo<Value>& args) {
   THROW_IF_INSUFFICIENT_PERMISSIONS(
       env, permission::PermissionScope::kFileSystemRead, path.ToStringView());
 
+  if (stat_cache::IsEnabled()) {
+    std::optional<int> cached = stat_cache::Lookup(path.ToStringView());
+    if (cached.has_value()) {
+      args.GetReturnValue().Set(cached.value() >= 0);
+      return;
+    }
+  }
+
   uv_fs_t req;
   auto make = OnScopeLeave([&req]() { uv_fs_req_cleanup(&req); });
   FS_SYNC_TRACE_BEGIN(access);
@@ -1025,6 +1635,11 @@ static void ExistsSync(const FunctionCallbackInfo<Value>& args) {
   }
 #endif  // _WIN32
 
+  // access() does not tell files and directories apart, so only a missing
+  // path can be shared with the other users of the cache.
+  if (err == UV_ENOENT && stat_cache::IsEnabled())
+    stat_cache::Insert(path.ToStringView(), err);
+
   args.GetReturnValue().Set(err == 0);
 }
 
@@ -1041,13 +1656,8 @@ static void InternalModuleStat(const FunctionCallbackInfo<Value>& args) {
   THROW_IF_INSUFFICIENT_PERMISSIONS(
       env, permission::PermissionScope::kFileSystemRead, path.ToStringView());
 
-  uv_fs_t req;
-  int rc = uv_fs_stat(env->event_loop(), &req, *path, nullptr);
-  if (rc == 0) {
-    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
-    rc = S_ISDIR(s->st_mode);
-  }
-  uv_fs_req_cleanup(&req);
+  int rc = CachedStatMode(env->event_loop(), *path);
+  if (rc >= 0) rc = S_ISDIR(rc);
 
   args.GetReturnValue().Set(rc);
 }
@@ -1064,6 +1674,13 @@ static int32_t FastInternalModuleStat(
   THROW_IF_INSUFFICIENT_PERMISSIONS(
       env, permission::PermissionScope::kFileSystemRead, path.string(), -1);
 
+  if (stat_cache::IsEnabled()) {
+    int mode = CachedStatMode(env->event_loop(), path.string().c_str());
+    if (mode < 0) return -1;
+    if (S_ISDIR(mode)) return 1;
+    return (mode == S_IFREG) ? 0 : -1;
+  }
+
   switch (std::filesystem::status(path).type()) {
     case std::filesystem::file_type::directory:
       return 1;
@@ -1077,6 +1694,37 @@ static int32_t FastInternalModuleStat(
 v8::CFunction fast_internal_module_stat_(
     v8::CFunction::Make(FastInternalModuleStat));
 
+// clearStatCache([path]) drops `path` and everything below it from the stat
+// cache, or the whole cache when no path is passed.
+static void ClearStatCache(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  if (args.Length() < 1 || args[0]->IsUndefined()) {
+    stat_cache::Clear();
+    return;
+  }
+
+  BufferValue path(env->isolate(), args[0]);
+  CHECK_NOT_NULL(*path);
+  ToNamespacedPath(env, &path);
+  stat_cache::Invalidate(path.ToStringView());
+}
+
+// Returns [hits, misses, entries] for the stat cache.
+static void GetStatCacheStats(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  uint64_t hits, misses;
+  size_t size;
+  stat_cache::GetCounters(&hits, &misses, &size);
+
+  Local<Value> result[] = {
+      Number::New(isolate, static_cast<double>(hits)),
+      Number::New(isolate, static_cast<double>(misses)),
+      Number::New(isolate, static_cast<double>(size)),
+  };
+  args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
+}
+
 constexpr bool is_uv_error_except_no_entry(int result) {
   return result < 0 && result != UV_ENOENT;
 }
@@ -1285,6 +1933,8 @@ static void Symlink(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[2]->IsInt32());
   int flags = args[2].As<Int32>()->Value();
 
+  stat_cache::Invalidate(path.ToStringView());
+
   if (argc > 3) {  // symlink(target, path, flags, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 3);
     FS_ASYNC_TRACE_BEGIN2(UV_FS_SYMLINK,
@@ -1323,6 +1973,8 @@ static void Link(const FunctionCallbackInfo<Value>& args) {
 
   const auto dest_view = dest.ToStringView();
 
+  stat_cache::Invalidate(dest_view);
+
   if (argc > 2) {  // link(src, dest, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 2);
     // To avoid bypass the link target should be allowed to read and write
@@ -1428,6 +2080,9 @@ static void Rename(const FunctionCallbackInfo<Value>& args) {
   CHECK_NOT_NULL(*new_path);
   ToNamespacedPath(env, &new_path);
 
+  stat_cache::Invalidate(view_old_path);
+  stat_cache::Invalidate(new_path.ToStringView());
+
   if (argc > 2) {  // rename(old_path, new_path, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 2);
     ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
@@ -1558,6 +2213,8 @@ static void Unlink(const FunctionCallbackInfo<Value>& args) {
   CHECK_NOT_NULL(*path);
   ToNamespacedPath(env, &path);
 
+  stat_cache::Invalidate(path.ToStringView());
+
   if (argc > 1) {  // unlink(path, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 1);
     ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
@@ -1594,6 +2251,8 @@ static void RMDir(const FunctionCallbackInfo<Value>& args) {
   THROW_IF_INSUFFICIENT_PERMISSIONS(
       env, permission::PermissionScope::kFileSystemWrite, path.ToStringView());
 
+  stat_cache::Invalidate(path.ToStringView());
+
   if (argc > 1) {
     FSReqBase* req_wrap_async = GetReqWrap(args, 1);  // rmdir(path, req)
     FS_ASYNC_TRACE_BEGIN1(
@@ -1619,6 +2278,7 @@ static void RmSync(const FunctionCallbackInfo<Value>& args) {
   ToNamespacedPath(env, &path);
   THROW_IF_INSUFFICIENT_PERMISSIONS(
       env, permission::PermissionScope::kFileSystemWrite, path.ToStringView());
+  stat_cache::Invalidate(path.ToStringView());
   auto file_path = std::filesystem::path(path.ToStringView());
   std::error_code error;
   auto file_status = std::filesystem::status(file_path, error);
@@ -1707,6 +2367,361 @@ static void RmSync(const FunctionCallbackInfo<Value>& args) {
       UV_UNKNOWN, "rm", message.c_str(), path_c_str);
 }
 
+#ifndef _WIN32
+// RemoveEntryAt() keeps one directory open per level it descends. From this
+// depth on it reads each directory in full and closes it before descending,
+// opening the subdirectories by path, so that deep trees do not run into
+// EMFILE.
+constexpr int kMaxRmOpenDirs = 64;
+
+// Removes `name` relative to the directory `dir_fd`, recursing into it if it
+// is a directory. Working relative to directory file descriptors avoids
+// resolving the full path again for every entry. `parent` is only used to
+// build `error_path` and, past kMaxRmOpenDirs levels, the paths of children.
+static int RemoveEntryAt(int dir_fd,
+                         const char* name,
+                         bool is_dir_hint,
+                         const std::string& parent,
+                         std::string* error_path,
+                         int depth) {
+  auto fail = [&](int err, const char* child = nullptr) {
+    *error_path = parent.empty() ? name : parent + kPathSeparator + name;
+    if (child != nullptr) *error_path += kPathSeparator + std::string(child);
+    return uv_translate_sys_error(err);
+  };
+
+  if (!is_dir_hint) {
+    if (unlinkat(dir_fd, name, 0) == 0 || errno == ENOENT) return 0;
+    // Linux reports EISDIR for directories, other systems report EPERM.
+    if (errno != EISDIR && errno != EPERM) return fail(errno);
+  }
+
+  int fd;
+  do {
+    fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  } while (fd == -1 && errno == EINTR);
+  if (fd == -1) {
+    if (errno == ENOENT) return 0;
+    // The hint was stale, the entry was replaced with something else.
+    if (errno == ENOTDIR && is_dir_hint)
+      return RemoveEntryAt(dir_fd, name, false, parent, error_path, depth);
+    return fail(errno);
+  }
+  DIR* dir = fdopendir(fd);
+  if (dir == nullptr) {
+    int err = errno;
+    close(fd);
+    return fail(err);
+  }
+
+  const bool by_path = depth >= kMaxRmOpenDirs;
+  std::vector<std::pair<std::string, bool>> deferred;
+  int err = 0;
+  std::string path;
+  while (err == 0) {
+    errno = 0;
+    struct dirent* ent = readdir(dir);
+    if (ent == nullptr) {
+      if (errno != 0) err = fail(errno);
+      break;
+    }
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    if (path.empty())
+      path = parent.empty() ? name : parent + kPathSeparator + name;
+#ifdef DT_DIR
+    const bool child_is_dir = ent->d_type == DT_DIR;
+#else
+    const bool child_is_dir = false;
+#endif
+    if (by_path) {
+      deferred.emplace_back(ent->d_name, child_is_dir);
+      continue;
+    }
+    err = RemoveEntryAt(
+        fd, ent->d_name, child_is_dir, path, error_path, depth + 1);
+  }
+  closedir(dir);
+  for (const auto& [child, child_is_dir] : deferred) {
+    if (err != 0) break;
+    const std::string child_path = path + kPathSeparator + child;
+    err = RemoveEntryAt(
+        AT_FDCWD, child_path.c_str(), child_is_dir, "", error_path, depth + 1);
+  }
+  if (err != 0) return err;
+
+  if (unlinkat(dir_fd, name, AT_REMOVEDIR) == 0 || errno == ENOENT) return 0;
+  return fail(errno);
+}
+#endif  // _WIN32
+
+// Errors that are worth retrying for rm(), see RmSync().
+static bool IsRetriableRmError(int err) {
+  return err == UV_EBUSY || err == UV_EMFILE || err == UV_ENFILE ||
+         err == UV_ENOTEMPTY || err == UV_EPERM;
+}
+
+// Native engine behind the async recursive fs.rm(). The entries of the root
+// directory are split across up to kRmConcurrency threadpool jobs, which
+// each remove their subtrees depth-first using unlinkat() relative to
+// directory file descriptors. The root itself is removed last, retrying
+// retriable errors like RmSync() does. A missing root is only ignored with
+// `force`.
+class RmRecursiveJob final {
+ public:
+  RmRecursiveJob(FSReqBase* req_wrap,
+                 std::string&& path,
+                 int max_retries,
+                 int retry_delay,
+                 bool force)
+      : env_(req_wrap->env()),
+        req_wrap_(req_wrap),
+        path_(std::move(path)),
+        max_retries_(max_retries),
+        retry_delay_(retry_delay),
+        force_(force) {}
+
+  void Start() { Schedule(Phase::kList); }
+
+  RmRecursiveJob(const RmRecursiveJob&) = delete;
+  RmRecursiveJob& operator=(const RmRecursiveJob&) = delete;
+
+ private:
+  static constexpr size_t kRmConcurrency = 4;
+
+  enum class Phase { kList, kRemove, kFinish };
+
+  struct Child {
+    std::string name;
+    bool is_dir;
+  };
+
+  class Work final : public ThreadPoolWork {
+   public:
+    Work(RmRecursiveJob* job, Phase phase, size_t slot)
+        : ThreadPoolWork(job->env_, "rmrecursive"),
+          job_(job),
+          phase_(phase),
+          slot_(slot) {}
+
+    void DoThreadPoolWork() override;
+    void AfterThreadPoolWork(int status) override;
+
+   private:
+    RmRecursiveJob* job_;
+    Phase phase_;
+    size_t slot_;
+  };
+
+  void Schedule(Phase phase, size_t slot = 0) {
+    pending_++;
+    (new Work(this, phase, slot))->ScheduleWork();
+  }
+  void Done();
+
+  // These run on the threadpool.
+  void List();
+  void RemoveChildren(size_t slot);
+  void Finish();
+  void SetError(int err, const char* syscall, const std::string& path) {
+    Mutex::ScopedLock lock(error_mutex_);
+    if (error_ == 0) {
+      error_ = err;
+      error_syscall_ = syscall;
+      error_path_ = path;
+    }
+  }
+
+  Environment* env_;
+  BaseObjectPtr<FSReqBase> req_wrap_;
+  std::string path_;
+  int max_retries_;
+  int retry_delay_;
+  bool force_;
+  std::vector<Child> children_;
+  size_t slots_ = 0;
+  size_t pending_ = 0;
+  bool done_ = false;
+
+  Mutex error_mutex_;
+  int error_ = 0;
+  const char* error_syscall_ = nullptr;
+  std::string error_path_;
+};
+
+void RmRecursiveJob::Work::DoThreadPoolWork() {
+  switch (phase_) {
+    case Phase::kList:
+      job_->List();
+      break;
+    case Phase::kRemove:
+      job_->RemoveChildren(slot_);
+      break;
+    case Phase::kFinish:
+      job_->Finish();
+      break;
+  }
+}
+
+void RmRecursiveJob::Work::AfterThreadPoolWork(int status) {
+  std::unique_ptr<Work> self(this);
+  RmRecursiveJob* job = job_;
+  job->pending_--;
+  if (status == UV_ECANCELED) job->SetError(UV_ECANCELED, "rm", job->path_);
+
+  if (!job->env_->can_call_into_js()) {
+    if (job->pending_ == 0) delete job;
+    return;
+  }
+
+  if (phase_ == Phase::kList && !job->done_) {
+    for (size_t i = 0; i < job->slots_; i++) job->Schedule(Phase::kRemove, i);
+  }
+  // Retriable errors get another chance when the root is removed.
+  if (job->pending_ == 0 && phase_ != Phase::kFinish && !job->done_ &&
+      (job->error_ == 0 || IsRetriableRmError(job->error_))) {
+    job->Schedule(Phase::kFinish);
+  }
+  if (job->pending_ == 0) job->Done();
+}
+
+void RmRecursiveJob::List() {
+#ifdef _WIN32
+  // There is no unlinkat() on Windows, remove everything in this job.
+  done_ = true;
+  std::error_code error;
+  std::filesystem::remove_all(std::filesystem::path(path_), error);
+  if (error) SetError(uv_translate_sys_error(error.value()), "rm", path_);
+#else
+  uv_fs_t req;
+  int err = uv_fs_lstat(nullptr, &req, path_.c_str(), nullptr);
+  const bool is_dir = err == 0 && S_ISDIR(req.statbuf.st_mode);
+  uv_fs_req_cleanup(&req);
+  if (err == 0 && !is_dir) {
+    // Not a directory (or a link to one), there is nothing to split up.
+    done_ = true;
+    err = uv_fs_unlink(nullptr, &req, path_.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  } else if (err == 0) {
+    err = uv_fs_scandir(nullptr, &req, path_.c_str(), 0, nullptr);
+  }
+  if (err < 0) {
+    uv_fs_req_cleanup(&req);
+    done_ = true;
+    if (err != UV_ENOENT || !force_) SetError(err, "rm", path_);
+    return;
+  }
+  if (done_) return;
+
+  uv_dirent_t ent;
+  while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+    children_.push_back(Child{ent.name, ent.type == UV_DIRENT_DIR});
+  }
+  uv_fs_req_cleanup(&req);
+  slots_ = std::min(children_.size(), kRmConcurrency);
+#endif  // _WIN32
+}
+
+void RmRecursiveJob::RemoveChildren(size_t slot) {
+#ifndef _WIN32
+  int dir_fd;
+  do {
+    dir_fd = open(path_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  } while (dir_fd == -1 && errno == EINTR);
+  if (dir_fd == -1) {
+    if (errno != ENOENT) SetError(uv_translate_sys_error(errno), "rm", path_);
+    return;
+  }
+
+  std::string error_path;
+  for (size_t i = slot; i < children_.size(); i += slots_) {
+    int err = RemoveEntryAt(dir_fd,
+                            children_[i].name.c_str(),
+                            children_[i].is_dir,
+                            path_,
+                            &error_path,
+                            1);
+    if (err != 0) {
+      SetError(err, "rm", error_path);
+      break;
+    }
+  }
+  close(dir_fd);
+#endif  // _WIN32
+}
+
+void RmRecursiveJob::Finish() {
+#ifndef _WIN32
+  int err = error_;
+  std::string error_path = error_path_;
+  for (int attempt = 0;; attempt++) {
+    if (err == 0) {
+      err = RemoveEntryAt(AT_FDCWD, path_.c_str(), true, "", &error_path, 0);
+    }
+    if (err == 0 || !IsRetriableRmError(err) || attempt >= max_retries_) break;
+    if (retry_delay_ > 0) uv_sleep((attempt + 1) * retry_delay_);
+    err = 0;
+  }
+
+  Mutex::ScopedLock lock(error_mutex_);
+  error_ = err;
+  error_syscall_ = "rm";
+  error_path_ = err == 0 ? std::string() : error_path;
+#endif  // _WIN32
+}
+
+void RmRecursiveJob::Done() {
+  std::unique_ptr<RmRecursiveJob> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+
+  Isolate* isolate = env_->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env_->context());
+
+  if (error_ == 0) return req_wrap->Resolve(Undefined(isolate));
+  req_wrap->Reject(UVException(
+      isolate, error_, error_syscall_, nullptr, error_path_.c_str()));
+}
+
+// Recursively removes `path` without blocking the event loop, see
+// RmRecursiveJob.
+//
+// rmRecursive(path, maxRetries, retryDelay, force, req)
+static void RmRecursive(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK_EQ(args.Length(), 5);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+  ToNamespacedPath(env, &path);
+
+  CHECK(args[1]->IsInt32());
+  const int max_retries = args[1].As<Int32>()->Value();
+  CHECK(args[2]->IsInt32());
+  const int retry_delay = args[2].As<Int32>()->Value();
+  CHECK(args[3]->IsBoolean());
+  const bool force = args[3]->IsTrue();
+
+  FSReqBase* req_wrap_async = GetReqWrap(args, 4);
+  CHECK_NOT_NULL(req_wrap_async);
+  ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
+      env,
+      req_wrap_async,
+      permission::PermissionScope::kFileSystemWrite,
+      path.ToStringView());
+
+  stat_cache::Invalidate(path.ToStringView());
+
+  req_wrap_async->Init("rm", nullptr, 0, UTF8);
+  auto* job = new RmRecursiveJob(
+      req_wrap_async, path.ToString(), max_retries, retry_delay, force);
+  job->Start();
+  req_wrap_async->SetReturnValue(args);
+}
+
 int MKDirpSync(uv_loop_t* loop,
                uv_fs_t* req,
                const std::string& path,
@@ -1889,6 +2904,8 @@ static void MKDir(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[2]->IsBoolean());
   bool mkdirp = args[2]->IsTrue();
 
+  stat_cache::Invalidate(path.ToStringView());
+
   if (argc > 3) {  // mkdir(path, mode, recursive, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 3);
     FS_ASYNC_TRACE_BEGIN1(
@@ -2043,24 +3060,217 @@ static void ReadDir(const FunctionCallbackInfo<Value>& args) {
         return;
       }
 
-      name_v.push_back(filename.ToLocalChecked());
+      name_v.push_back(filename.ToLocalChecked());
+
+      if (with_types) {
+        type_v.emplace_back(Integer::New(isolate, ent.type));
+      }
+    }
+
+
+    Local<Array> names = Array::New(isolate, name_v.data(), name_v.size());
+    if (with_types) {
+      Local<Value> result[] = {
+        names,
+        Array::New(isolate, type_v.data(), type_v.size())
+      };
+      args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
+    } else {
+      args.GetReturnValue().Set(names);
+    }
+  }
+}
+
+struct DirentWithStat {
+  std::string name;
+  int type;
+  uv_stat_t stat;
+};
+
+// Scans `path` and stat()s every entry on the calling thread, which is
+// either the main thread for the synchronous binding or a threadpool thread.
+// Entries that disappear between the two steps are skipped. On failure,
+// `error_path` is set to the path that the returned error refers to.
+static int ScanDirWithStats(const std::string& path,
+                            bool follow_symlinks,
+                            std::vector<DirentWithStat>* entries,
+                            std::string* error_path) {
+  uv_fs_t scan_req;
+  auto cleanup = OnScopeLeave([&]() { uv_fs_req_cleanup(&scan_req); });
+  int err = uv_fs_scandir(nullptr, &scan_req, path.c_str(), 0, nullptr);
+  if (err < 0) {
+    *error_path = path;
+    return err;
+  }
+
+  std::string entry_path = path;
+  if (entry_path.empty() || entry_path.back() != kPathSeparator)
+    entry_path += kPathSeparator;
+  const size_t dir_length = entry_path.size();
+
+  uv_dirent_t ent;
+  while ((err = uv_fs_scandir_next(&scan_req, &ent)) != UV_EOF) {
+    if (err < 0) {
+      *error_path = path;
+      return err;
+    }
+
+    entry_path.resize(dir_length);
+    entry_path += ent.name;
+
+    uv_fs_t stat_req;
+    err = follow_symlinks
+              ? uv_fs_stat(nullptr, &stat_req, entry_path.c_str(), nullptr)
+              : uv_fs_lstat(nullptr, &stat_req, entry_path.c_str(), nullptr);
+    if (err == 0) {
+      entries->push_back(
+          DirentWithStat{ent.name, static_cast<int>(ent.type),
+                         stat_req.statbuf});
+    }
+    uv_fs_req_cleanup(&stat_req);
+    if (err < 0 && err != UV_ENOENT) {
+      *error_path = entry_path;
+      return err;
+    }
+  }
+
+  return 0;
+}
+
+// Returns [names, types, stats] where stats packs kFsStatsFieldsNumber
+// fields per entry, laid out the same way as the binding's stats array.
+static MaybeLocal<Value> DirentsWithStatsToArray(
+    Environment* env,
+    const std::vector<DirentWithStat>& entries,
+    enum encoding encoding,
+    bool use_bigint,
+    Local<Value>* error) {
+  Isolate* isolate = env->isolate();
+  constexpr size_t kFieldsPerEntry =
+      static_cast<size_t>(FsStatsOffset::kFsStatsFieldsNumber);
+  std::vector<Local<Value>> name_v;
+  std::vector<Local<Value>> type_v;
+  name_v.reserve(entries.size());
+  type_v.reserve(entries.size());
+
+  for (const DirentWithStat& entry : entries) {
+    Local<Value> filename;
+    if (!StringBytes::Encode(isolate, entry.name.c_str(), encoding, error)
+             .ToLocal(&filename)) {
+      return MaybeLocal<Value>();
+    }
+    name_v.push_back(filename);
+    type_v.push_back(Integer::New(isolate, entry.type));
+  }
+
+  Local<Value> stats;
+  const size_t length = std::max<size_t>(entries.size(), 1) * kFieldsPerEntry;
+  if (use_bigint) {
+    AliasedBigInt64Array fields(isolate, length);
+    for (size_t i = 0; i < entries.size(); i++)
+      FillStatsArray(&fields, &entries[i].stat, i * kFieldsPerEntry);
+    stats = fields.GetJSArray();
+  } else {
+    AliasedFloat64Array fields(isolate, length);
+    for (size_t i = 0; i < entries.size(); i++)
+      FillStatsArray(&fields, &entries[i].stat, i * kFieldsPerEntry);
+    stats = fields.GetJSArray();
+  }
+
+  Local<Value> result[] = {Array::New(isolate, name_v.data(), name_v.size()),
+                           Array::New(isolate, type_v.data(), type_v.size()),
+                           stats};
+  return Array::New(isolate, result, arraysize(result));
+}
+
+class ReadDirWithStatsWork final : public FSReqThreadPoolWork {
+ public:
+  ReadDirWithStatsWork(FSReqBase* req_wrap,
+                       std::string&& path,
+                       bool follow_symlinks)
+      : FSReqThreadPoolWork(req_wrap, "readdirwithstats"),
+        path_(std::move(path)),
+        follow_symlinks_(follow_symlinks) {}
+
+  void DoThreadPoolWork() override {
+    result_ =
+        ScanDirWithStats(path_, follow_symlinks_, &entries_, &error_path_);
+  }
+
+ protected:
+  void Resolve(FSReqBase* req_wrap) override {
+    Local<Value> error;
+    Local<Value> result;
+    if (!DirentsWithStatsToArray(env(),
+                                 entries_,
+                                 req_wrap->encoding(),
+                                 req_wrap->use_bigint(),
+                                 &error)
+             .ToLocal(&result)) {
+      return req_wrap->Reject(error);
+    }
+    req_wrap->Resolve(result);
+  }
+
+ private:
+  std::string path_;
+  bool follow_symlinks_;
+  std::vector<DirentWithStat> entries_;
+};
+
+// Fused readdir(withFileTypes) + stat of every entry, performed as a single
+// threadpool job (or a single synchronous call) instead of one request per
+// entry. The result is [names, types, stats], see DirentsWithStatsToArray().
+static void ReadDirWithStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 4);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+  ToNamespacedPath(env, &path);
+
+  const enum encoding encoding = ParseEncoding(isolate, args[1], UTF8);
+  bool use_bigint = args[2]->IsTrue();
+  bool follow_symlinks = args[3]->IsTrue();
 
-      if (with_types) {
-        type_v.emplace_back(Integer::New(isolate, ent.type));
-      }
+  if (argc > 4) {  // readdirWithStats(path, encoding, bigint, follow, req)
+    FSReqBase* req_wrap_async = GetReqWrap(args, 4, use_bigint);
+    CHECK_NOT_NULL(req_wrap_async);
+    ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env,
+        req_wrap_async,
+        permission::PermissionScope::kFileSystemRead,
+        path.ToStringView());
+    req_wrap_async->Init("scandir", nullptr, 0, encoding);
+    auto* work = new ReadDirWithStatsWork(
+        req_wrap_async, path.ToString(), follow_symlinks);
+    work->ScheduleWork();
+    req_wrap_async->SetReturnValue(args);
+  } else {  // readdirWithStats(path, encoding, bigint, follow)
+    THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env, permission::PermissionScope::kFileSystemRead, path.ToStringView());
+    std::vector<DirentWithStat> entries;
+    std::string error_path;
+    FS_SYNC_TRACE_BEGIN(readdir);
+    env->PrintSyncTrace();
+    int err =
+        ScanDirWithStats(path.ToString(), follow_symlinks, &entries, &error_path);
+    FS_SYNC_TRACE_END(readdir);
+    if (is_uv_error(err)) {
+      return env->ThrowUVException(err, "scandir", nullptr, error_path.c_str());
     }
 
-
-    Local<Array> names = Array::New(isolate, name_v.data(), name_v.size());
-    if (with_types) {
-      Local<Value> result[] = {
-        names,
-        Array::New(isolate, type_v.data(), type_v.size())
-      };
-      args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
-    } else {
-      args.GetReturnValue().Set(names);
+    Local<Value> error;
+    Local<Value> result;
+    if (!DirentsWithStatsToArray(env, entries, encoding, use_bigint, &error)
+             .ToLocal(&result)) {
+      isolate->ThrowException(error);
+      return;
     }
+    args.GetReturnValue().Set(result);
   }
 }
 
@@ -2143,6 +3353,8 @@ static void Open(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[2]->IsInt32());
   const int mode = args[2].As<Int32>()->Value();
 
+  if (flags & UV_FS_O_CREAT) stat_cache::Invalidate(path.ToStringView());
+
   if (argc > 3) {  // open(path, flags, mode, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 3);
     CHECK_NOT_NULL(req_wrap_async);
@@ -2185,6 +3397,7 @@ static void OpenFileHandle(const FunctionCallbackInfo<Value>& args) {
   const int mode = args[2].As<Int32>()->Value();
 
   if (CheckOpenPermissions(env, path, flags).IsNothing()) return;
+  if (flags & UV_FS_O_CREAT) stat_cache::Invalidate(path.ToStringView());
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 3);
   if (req_wrap_async != nullptr) {  // openFileHandle(path, flags, mode, req)
@@ -2228,6 +3441,8 @@ static void CopyFile(const FunctionCallbackInfo<Value>& args) {
   CHECK_NOT_NULL(*dest);
   ToNamespacedPath(env, &dest);
 
+  stat_cache::Invalidate(dest.ToStringView());
+
   if (argc > 3) {  // copyFile(src, dest, flags, req)
     FSReqBase* req_wrap_async = GetReqWrap(args, 3);
     ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
@@ -2509,6 +3724,7 @@ static void WriteFileUtf8(const FunctionCallbackInfo<Value>& args) {
     CHECK_NOT_NULL(*path);
     ToNamespacedPath(env, &path);
     if (CheckOpenPermissions(env, path, flags).IsNothing()) return;
+    if (flags & UV_FS_O_CREAT) stat_cache::Invalidate(path.ToStringView());
 
     FSReqWrapSync req_open("open", *path);
 
@@ -2694,6 +3910,206 @@ static void ReadFileUtf8(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(val);
 }
 
+// A private, copy-on-write mapping of a whole regular file. Until a page is
+// written to it is shared with the page cache, so processes mapping the same
+// file do not each hold their own copy of it. That also means pages that
+// were not written to yet are not a snapshot: they may reflect later writes
+// to the file, and if the file is truncated, touching a page past its new
+// end raises SIGBUS, which terminates the process. No signal handler can
+// recover from that, since the Buffer can be read from anywhere, so only
+// files that other users cannot modify, through descriptors that cannot
+// write to them, are mapped.
+struct MappedFile {
+  void* data = nullptr;
+  size_t size = 0;
+};
+
+// Returns UV_ENOTSUP when the file cannot or should not be mapped (it is not
+// a regular file owned by the current user and writable by nobody else, it
+// is empty, the descriptor is open for writing, or the platform does not
+// support it), in which case callers fall back to a buffered read.
+static int MapFileForReading(const std::string& path,
+                             bool is_fd,
+                             uv_file file,
+                             int flags,
+                             MappedFile* out) {
+#if defined(_WIN32) || defined(V8_ENABLE_SANDBOX)
+  return UV_ENOTSUP;
+#else
+  if ((flags & O_ACCMODE) != O_RDONLY) return UV_ENOTSUP;
+  if (is_fd) {
+    int fd_flags = fcntl(file, F_GETFL);
+    if (fd_flags == -1) return uv_translate_sys_error(errno);
+    if ((fd_flags & O_ACCMODE) != O_RDONLY) return UV_ENOTSUP;
+  }
+
+  uv_fs_t req;
+  if (!is_fd) {
+    file = uv_fs_open(nullptr, &req, path.c_str(), flags, 0666, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (file < 0) return file;
+  }
+  auto defer_close = OnScopeLeave([&]() {
+    if (!is_fd) {
+      CHECK_EQ(0, uv_fs_close(nullptr, &req, file, nullptr));
+      uv_fs_req_cleanup(&req);
+    }
+  });
+
+  int err = uv_fs_fstat(nullptr, &req, file, nullptr);
+  const uv_stat_t stat = req.statbuf;
+  uv_fs_req_cleanup(&req);
+  if (err < 0) return err;
+  if (!S_ISREG(stat.st_mode) || stat.st_size == 0) return UV_ENOTSUP;
+  if (stat.st_uid != geteuid() || (stat.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    return UV_ENOTSUP;
+  if (stat.st_size > Buffer::kMaxLength) return UV_EFBIG;
+
+  const size_t size = static_cast<size_t>(stat.st_size);
+  void* data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+  if (data == MAP_FAILED) return uv_translate_sys_error(errno);
+
+  out->data = data;
+  out->size = size;
+  return 0;
+#endif  // defined(_WIN32) || defined(V8_ENABLE_SANDBOX)
+}
+
+static MaybeLocal<Value> MappedFileToBuffer(Environment* env,
+                                            const MappedFile& mapped) {
+#if defined(_WIN32) || defined(V8_ENABLE_SANDBOX)
+  UNREACHABLE();
+#else
+  std::unique_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+      mapped.data,
+      mapped.size,
+      [](void* data, size_t length, void*) { munmap(data, length); },
+      nullptr);
+  Local<ArrayBuffer> ab = ArrayBuffer::New(env->isolate(), std::move(store));
+  return Buffer::New(env, ab, 0, mapped.size).FromMaybe(Local<Uint8Array>());
+#endif  // defined(_WIN32) || defined(V8_ENABLE_SANDBOX)
+}
+
+class ReadFileMappedWork final : public FSReqThreadPoolWork {
+ public:
+  ReadFileMappedWork(FSReqBase* req_wrap,
+                     std::string&& path,
+                     bool is_fd,
+                     uv_file file,
+                     int flags)
+      : FSReqThreadPoolWork(req_wrap, "readfilemapped"),
+        path_(std::move(path)),
+        is_fd_(is_fd),
+        file_(file),
+        flags_(flags) {}
+
+  ~ReadFileMappedWork() override {
+#if !defined(_WIN32) && !defined(V8_ENABLE_SANDBOX)
+    // The mapping was never handed over to a Buffer.
+    if (mapped_.data != nullptr) munmap(mapped_.data, mapped_.size);
+#endif
+  }
+
+  void DoThreadPoolWork() override {
+    result_ = MapFileForReading(path_, is_fd_, file_, flags_, &mapped_);
+    if (result_ == UV_ENOTSUP) result_ = 0;
+    if (result_ < 0 && !is_fd_) error_path_ = path_;
+  }
+
+ protected:
+  void Resolve(FSReqBase* req_wrap) override {
+    if (mapped_.data == nullptr)
+      return req_wrap->Resolve(Undefined(env()->isolate()));
+    MappedFile mapped = std::exchange(mapped_, MappedFile{});
+    Local<Value> buffer;
+    Local<Value> exception;
+    {
+      TryCatchScope try_catch(env());
+      if (!MappedFileToBuffer(env(), mapped).ToLocal(&buffer)) {
+        if (try_catch.HasTerminated()) return;
+        exception = try_catch.HasCaught()
+                        ? try_catch.Exception()
+                        : UVException(env()->isolate(), UV_ENOMEM, "mmap");
+      }
+    }
+    if (buffer.IsEmpty()) return req_wrap->Reject(exception);
+    req_wrap->Resolve(buffer);
+  }
+
+ private:
+  std::string path_;
+  bool is_fd_;
+  uv_file file_;
+  int flags_;
+  MappedFile mapped_;
+};
+
+// Reads a whole regular file by mapping it into memory instead of copying
+// it into the heap. Resolves to a Buffer backed by the mapping, which is
+// unmapped once the Buffer is garbage collected, or to undefined if the file
+// cannot be mapped and has to be read the regular way.
+//
+// Only meant for files that are not modified while the Buffer is alive,
+// such as installed application sources: see MappedFile for what happens
+// when they are written to or truncated, and which files are therefore
+// read the regular way.
+//
+// readFileMapped(pathOrFd, flags[, req])
+static void ReadFileMapped(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 2);
+
+  CHECK(args[1]->IsInt32());
+  const int flags = args[1].As<Int32>()->Value();
+
+  FSReqBase* req_wrap_async = argc > 2 ? GetReqWrap(args, 2) : nullptr;
+  const bool is_fd = args[0]->IsInt32();
+  uv_file file = -1;
+  std::string path;
+  if (is_fd) {
+    file = args[0].As<Int32>()->Value();
+  } else {
+    BufferValue path_value(env->isolate(), args[0]);
+    CHECK_NOT_NULL(*path_value);
+    ToNamespacedPath(env, &path_value);
+    if (req_wrap_async != nullptr) {
+      if (AsyncCheckOpenPermissions(env, req_wrap_async, path_value, flags)
+              .IsNothing()) {
+        return;
+      }
+    } else if (CheckOpenPermissions(env, path_value, flags).IsNothing()) {
+      return;
+    }
+    path = path_value.ToString();
+  }
+
+  if (req_wrap_async != nullptr) {  // readFileMapped(pathOrFd, flags, req)
+    req_wrap_async->Init("open", nullptr, 0, UTF8);
+    auto* work = new ReadFileMappedWork(
+        req_wrap_async, std::move(path), is_fd, file, flags);
+    work->ScheduleWork();
+    req_wrap_async->SetReturnValue(args);
+    return;
+  }
+
+  MappedFile mapped;
+  FS_SYNC_TRACE_BEGIN(open);
+  int err = MapFileForReading(path, is_fd, file, flags, &mapped);
+  FS_SYNC_TRACE_END(open);
+  if (err == UV_ENOTSUP) return;
+  if (err < 0) {
+    return env->ThrowUVException(
+        err, "open", nullptr, is_fd ? nullptr : path.c_str());
+  }
+
+  Local<Value> buffer;
+  if (MappedFileToBuffer(env, mapped).ToLocal(&buffer))
+    args.GetReturnValue().Set(buffer);
+}
+
 // Wrapper for readv(2).
 //
 // bytesRead = fs.readv(fd, buffers[, position], callback)
@@ -3243,6 +4659,480 @@ static void CpSyncCheckPaths(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// Native engine behind a recursive fs.cp(). The tree is walked, and
+// destination directories are created, by one threadpool job. Files and
+// symbolic links are then copied by up to kCpConcurrency jobs running in
+// parallel, kCpBatchSize entries each, reporting progress to JS after every
+// batch. Regular files are copied with uv_fs_copyfile() and
+// UV_FS_COPYFILE_FICLONE, which tries a reflink first and otherwise falls
+// back to an in-kernel copy (copy_file_range()/sendfile() on Linux).
+class CpRecursiveJob final {
+ public:
+  struct Options {
+    bool dereference;
+    bool force;
+    bool error_on_exist;
+    bool preserve_timestamps;
+  };
+
+  CpRecursiveJob(FSReqBase* req_wrap,
+                 std::string&& src,
+                 std::string&& dest,
+                 Options options,
+                 Local<Function> on_progress);
+
+  void Start();
+
+  CpRecursiveJob(const CpRecursiveJob&) = delete;
+  CpRecursiveJob& operator=(const CpRecursiveJob&) = delete;
+
+ private:
+  static constexpr size_t kCpConcurrency = 4;
+  static constexpr size_t kCpBatchSize = 256;
+
+  enum class Phase { kWalk, kCopy, kFinish };
+
+  enum class ErrorKind { kUV, kExists, kDirToNonDir, kSocket, kFifo, kUnknown };
+
+  struct Entry {
+    std::string src;
+    std::string dest;
+    bool is_symlink;
+    uv_timespec_t atime;
+    uv_timespec_t mtime;
+  };
+
+  struct Directory {
+    std::string dest;
+    uint64_t mode;
+  };
+
+  class Work final : public ThreadPoolWork {
+   public:
+    Work(CpRecursiveJob* job, Phase phase, size_t begin, size_t end)
+        : ThreadPoolWork(job->env_, "cprecursive"),
+          job_(job),
+          phase_(phase),
+          begin_(begin),
+          end_(end) {}
+
+    void DoThreadPoolWork() override;
+    void AfterThreadPoolWork(int status) override;
+
+   private:
+    CpRecursiveJob* job_;
+    Phase phase_;
+    size_t begin_;
+    size_t end_;
+    size_t copied_ = 0;
+  };
+
+  void Schedule(Phase phase, size_t begin = 0, size_t end = 0);
+  void ScheduleCopies();
+  void Done();
+
+  // These run on the threadpool.
+  void Walk();
+  bool CopyEntry(const Entry& entry);
+  void ApplyDirectoryModes();
+  int Stat(const std::string& path, uv_stat_t* stat);
+  bool MakeDirectory(const std::string& dest, const uv_stat_t& stat);
+  bool SetError(ErrorKind kind, int err, const char* syscall,
+                const std::string& path);
+  bool has_error() {
+    Mutex::ScopedLock lock(error_mutex_);
+    return error_kind_.has_value();
+  }
+
+  Environment* env_;
+  BaseObjectPtr<FSReqBase> req_wrap_;
+  std::string src_;
+  std::string dest_;
+  Options options_;
+  v8::Global<Function> on_progress_;
+
+  std::vector<Entry> entries_;
+  std::vector<Directory> directories_;
+  size_t next_entry_ = 0;
+  size_t copied_ = 0;
+  size_t pending_ = 0;
+
+  Mutex error_mutex_;
+  std::optional<ErrorKind> error_kind_;
+  int error_ = 0;
+  const char* error_syscall_ = nullptr;
+  std::string error_path_;
+};
+
+CpRecursiveJob::CpRecursiveJob(FSReqBase* req_wrap,
+                               std::string&& src,
+                               std::string&& dest,
+                               Options options,
+                               Local<Function> on_progress)
+    : env_(req_wrap->env()),
+      req_wrap_(req_wrap),
+      src_(std::move(src)),
+      dest_(std::move(dest)),
+      options_(options) {
+  if (!on_progress.IsEmpty())
+    on_progress_.Reset(env_->isolate(), on_progress);
+}
+
+void CpRecursiveJob::Start() {
+  Schedule(Phase::kWalk);
+}
+
+void CpRecursiveJob::Schedule(Phase phase, size_t begin, size_t end) {
+  pending_++;
+  (new Work(this, phase, begin, end))->ScheduleWork();
+}
+
+void CpRecursiveJob::ScheduleCopies() {
+  while (!has_error() && pending_ < kCpConcurrency &&
+         next_entry_ < entries_.size()) {
+    size_t begin = next_entry_;
+    next_entry_ = std::min(begin + kCpBatchSize, entries_.size());
+    Schedule(Phase::kCopy, begin, next_entry_);
+  }
+}
+
+void CpRecursiveJob::Work::DoThreadPoolWork() {
+  switch (phase_) {
+    case Phase::kWalk:
+      job_->Walk();
+      break;
+    case Phase::kCopy:
+      for (size_t i = begin_; i < end_ && !job_->has_error(); i++) {
+        if (job_->CopyEntry(job_->entries_[i])) copied_++;
+      }
+      break;
+    case Phase::kFinish:
+      job_->ApplyDirectoryModes();
+      break;
+  }
+}
+
+void CpRecursiveJob::Work::AfterThreadPoolWork(int status) {
+  std::unique_ptr<Work> self(this);
+  CpRecursiveJob* job = job_;
+  job->pending_--;
+  job->copied_ += copied_;
+  if (status == UV_ECANCELED)
+    job->SetError(ErrorKind::kUV, UV_ECANCELED, "cp", job->src_);
+
+  Environment* env = job->env_;
+  if (!env->can_call_into_js()) {
+    if (job->pending_ == 0) delete job;
+    return;
+  }
+
+  if (phase_ == Phase::kCopy && !job->on_progress_.IsEmpty() &&
+      !job->has_error()) {
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Value> argv[] = {
+        Number::New(env->isolate(), static_cast<double>(job->copied_)),
+        Number::New(env->isolate(),
+                    static_cast<double>(job->entries_.size()))};
+    if (job->req_wrap_
+            ->MakeCallback(job->on_progress_.Get(env->isolate()),
+                           arraysize(argv),
+                           argv)
+            .IsEmpty()) {
+      job->SetError(ErrorKind::kUV, UV_ECANCELED, "cp", job->src_);
+    }
+  }
+
+  if (!job->has_error()) {
+    if (phase_ != Phase::kFinish) job->ScheduleCopies();
+    if (job->pending_ == 0 && phase_ != Phase::kFinish)
+      job->Schedule(Phase::kFinish);
+  }
+  if (job->pending_ == 0) job->Done();
+}
+
+void CpRecursiveJob::Done() {
+  std::unique_ptr<CpRecursiveJob> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+
+  Isolate* isolate = env_->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env_->context());
+
+  if (!error_kind_.has_value()) {
+    return req_wrap->Resolve(
+        Number::New(isolate, static_cast<double>(copied_)));
+  }
+
+  const char* path = error_path_.c_str();
+  switch (*error_kind_) {
+    case ErrorKind::kUV:
+      return req_wrap->Reject(
+          UVException(isolate, error_, error_syscall_, nullptr, path));
+    case ErrorKind::kExists:
+      return req_wrap->Reject(
+          ERR_FS_CP_EEXIST(isolate, "Target already exists: %s", path));
+    case ErrorKind::kDirToNonDir:
+      return req_wrap->Reject(ERR_FS_CP_DIR_TO_NON_DIR(
+          isolate, "Cannot overwrite non-directory %s with directory", path));
+    case ErrorKind::kSocket:
+      return req_wrap->Reject(
+          ERR_FS_CP_SOCKET(isolate, "Cannot copy a socket file: %s", path));
+    case ErrorKind::kFifo:
+      return req_wrap->Reject(
+          ERR_FS_CP_FIFO_PIPE(isolate, "Cannot copy a FIFO pipe: %s", path));
+    case ErrorKind::kUnknown:
+      return req_wrap->Reject(ERR_FS_CP_UNKNOWN(
+          isolate, "Cannot copy an unknown file type: %s", path));
+  }
+}
+
+bool CpRecursiveJob::SetError(ErrorKind kind,
+                              int err,
+                              const char* syscall,
+                              const std::string& path) {
+  Mutex::ScopedLock lock(error_mutex_);
+  if (!error_kind_.has_value()) {
+    error_kind_ = kind;
+    error_ = err;
+    error_syscall_ = syscall;
+    error_path_ = path;
+  }
+  return false;
+}
+
+int CpRecursiveJob::Stat(const std::string& path, uv_stat_t* stat) {
+  uv_fs_t req;
+  int err = options_.dereference
+                ? uv_fs_stat(nullptr, &req, path.c_str(), nullptr)
+                : uv_fs_lstat(nullptr, &req, path.c_str(), nullptr);
+  if (err == 0) *stat = req.statbuf;
+  uv_fs_req_cleanup(&req);
+  return err;
+}
+
+bool CpRecursiveJob::MakeDirectory(const std::string& dest,
+                                   const uv_stat_t& stat) {
+  uv_fs_t req;
+  int err = uv_fs_mkdir(nullptr, &req, dest.c_str(), 0777, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (err == 0) {
+    // Like the JS implementation, only restore the mode of directories that
+    // did not exist, and only once their contents have been copied, in case
+    // the source directory is not writable.
+    directories_.push_back(Directory{dest, stat.st_mode});
+    return true;
+  }
+  if (err != UV_EEXIST) return SetError(ErrorKind::kUV, err, "mkdir", dest);
+
+  err = uv_fs_stat(nullptr, &req, dest.c_str(), nullptr);
+  const bool is_dir = err == 0 && S_ISDIR(req.statbuf.st_mode);
+  uv_fs_req_cleanup(&req);
+  if (err < 0) return SetError(ErrorKind::kUV, err, "stat", dest);
+  if (!is_dir) return SetError(ErrorKind::kDirToNonDir, 0, "mkdir", dest);
+  return true;
+}
+
+void CpRecursiveJob::Walk() {
+  uv_stat_t stat;
+  int err = Stat(src_, &stat);
+  if (err < 0) {
+    SetError(ErrorKind::kUV, err, options_.dereference ? "stat" : "lstat",
+             src_);
+    return;
+  }
+
+  std::vector<std::pair<std::string, std::string>> stack;
+  auto add = [&](std::string&& src, std::string&& dest, const uv_stat_t& st) {
+    switch (st.st_mode & S_IFMT) {
+      case S_IFDIR:
+        if (MakeDirectory(dest, st))
+          stack.emplace_back(std::move(src), std::move(dest));
+        return;
+      case S_IFREG:
+#ifdef S_IFLNK
+      case S_IFLNK:
+#endif
+        entries_.push_back(Entry{std::move(src),
+                                 std::move(dest),
+                                 (st.st_mode & S_IFMT) != S_IFREG,
+                                 st.st_atim,
+                                 st.st_mtim});
+        return;
+#ifdef S_IFSOCK
+      case S_IFSOCK:
+        SetError(ErrorKind::kSocket, 0, "cp", dest);
+        return;
+#endif
+#ifdef S_IFIFO
+      case S_IFIFO:
+        SetError(ErrorKind::kFifo, 0, "cp", dest);
+        return;
+#endif
+      default:
+        SetError(ErrorKind::kUnknown, 0, "cp", dest);
+    }
+  };
+
+  add(std::string(src_), std::string(dest_), stat);
+
+  while (!stack.empty() && !has_error()) {
+    auto [src_dir, dest_dir] = std::move(stack.back());
+    stack.pop_back();
+
+    uv_fs_t req;
+    auto cleanup = OnScopeLeave([&]() { uv_fs_req_cleanup(&req); });
+    err = uv_fs_scandir(nullptr, &req, src_dir.c_str(), 0, nullptr);
+    if (err < 0) {
+      SetError(ErrorKind::kUV, err, "scandir", src_dir);
+      return;
+    }
+
+    uv_dirent_t ent;
+    while ((err = uv_fs_scandir_next(&req, &ent)) != UV_EOF) {
+      if (err < 0) {
+        SetError(ErrorKind::kUV, err, "scandir", src_dir);
+        return;
+      }
+      std::string src_path = src_dir + kPathSeparator + ent.name;
+      std::string dest_path = dest_dir + kPathSeparator + ent.name;
+      err = Stat(src_path, &stat);
+      if (err < 0) {
+        SetError(ErrorKind::kUV, err, options_.dereference ? "stat" : "lstat",
+                 src_path);
+        return;
+      }
+      add(std::move(src_path), std::move(dest_path), stat);
+      if (has_error()) return;
+    }
+  }
+}
+
+bool CpRecursiveJob::CopyEntry(const Entry& entry) {
+  uv_fs_t req;
+  int err;
+
+  if (entry.is_symlink) {
+    err = uv_fs_readlink(nullptr, &req, entry.src.c_str(), nullptr);
+    if (err < 0) {
+      uv_fs_req_cleanup(&req);
+      return SetError(ErrorKind::kUV, err, "readlink", entry.src);
+    }
+    std::string target(static_cast<const char*>(req.ptr));
+    uv_fs_req_cleanup(&req);
+
+    err = uv_fs_symlink(
+        nullptr, &req, target.c_str(), entry.dest.c_str(), 0, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err == UV_EEXIST && options_.force) {
+      err = uv_fs_unlink(nullptr, &req, entry.dest.c_str(), nullptr);
+      uv_fs_req_cleanup(&req);
+      if (err == 0) {
+        err = uv_fs_symlink(
+            nullptr, &req, target.c_str(), entry.dest.c_str(), 0, nullptr);
+        uv_fs_req_cleanup(&req);
+      }
+    }
+  } else {
+    int flags = UV_FS_COPYFILE_FICLONE;
+    if (!options_.force) flags |= UV_FS_COPYFILE_EXCL;
+    err = uv_fs_copyfile(
+        nullptr, &req, entry.src.c_str(), entry.dest.c_str(), flags, nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+
+  if (err == UV_EEXIST) {
+    if (options_.error_on_exist)
+      return SetError(ErrorKind::kExists, err, "cp", entry.dest);
+    return false;
+  }
+  if (err < 0) {
+    return SetError(ErrorKind::kUV,
+                    err,
+                    entry.is_symlink ? "symlink" : "copyfile",
+                    entry.src);
+  }
+
+  if (options_.preserve_timestamps && !entry.is_symlink) {
+    auto to_double = [](const uv_timespec_t& ts) {
+      return static_cast<double>(ts.tv_sec) + ts.tv_nsec / 1e9;
+    };
+    err = uv_fs_utime(nullptr,
+                      &req,
+                      entry.dest.c_str(),
+                      to_double(entry.atime),
+                      to_double(entry.mtime),
+                      nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err < 0) return SetError(ErrorKind::kUV, err, "utime", entry.dest);
+  }
+  return true;
+}
+
+void CpRecursiveJob::ApplyDirectoryModes() {
+  // Innermost directories first, so that no parent becomes read-only while
+  // its children still need to be updated.
+  for (auto it = directories_.rbegin(); it != directories_.rend(); ++it) {
+    uv_fs_t req;
+    int err = uv_fs_chmod(
+        nullptr, &req, it->dest.c_str(), static_cast<int>(it->mode), nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err < 0) {
+      SetError(ErrorKind::kUV, err, "chmod", it->dest);
+      return;
+    }
+  }
+}
+
+// Recursively copies `src` to `dest` on the threadpool, see CpRecursiveJob.
+// Resolves with the number of files and links that were copied.
+//
+// cpRecursive(src, dest, dereference, force, errorOnExist,
+//             preserveTimestamps, onProgress, req)
+static void CpRecursive(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK_EQ(args.Length(), 8);
+
+  BufferValue src(isolate, args[0]);
+  CHECK_NOT_NULL(*src);
+  ToNamespacedPath(env, &src);
+
+  BufferValue dest(isolate, args[1]);
+  CHECK_NOT_NULL(*dest);
+  ToNamespacedPath(env, &dest);
+
+  CpRecursiveJob::Options options{args[2]->IsTrue(),
+                                  args[3]->IsTrue(),
+                                  args[4]->IsTrue(),
+                                  args[5]->IsTrue()};
+  Local<Function> on_progress;
+  if (args[6]->IsFunction()) on_progress = args[6].As<Function>();
+
+  FSReqBase* req_wrap_async = GetReqWrap(args, 7);
+  CHECK_NOT_NULL(req_wrap_async);
+  ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
+      env,
+      req_wrap_async,
+      permission::PermissionScope::kFileSystemRead,
+      src.ToStringView());
+  ASYNC_THROW_IF_INSUFFICIENT_PERMISSIONS(
+      env,
+      req_wrap_async,
+      permission::PermissionScope::kFileSystemWrite,
+      dest.ToStringView());
+
+  stat_cache::Invalidate(dest.ToStringView());
+
+  req_wrap_async->Init("cp", nullptr, 0, UTF8);
+  auto* job = new CpRecursiveJob(
+      req_wrap_async, src.ToString(), dest.ToString(), options, on_progress);
+  job->Start();
+  req_wrap_async->SetReturnValue(args);
+}
+
 BindingData::FilePathIsFileReturnType BindingData::FilePathIsFile(
     Environment* env, const std::string& file_path) {
   THROW_IF_INSUFFICIENT_PERMISSIONS(
@@ -3251,16 +5141,8 @@ BindingData::FilePathIsFileReturnType BindingData::FilePathIsFile(
       file_path,
       BindingData::FilePathIsFileReturnType::kThrowInsufficientPermissions);
 
-  uv_fs_t req;
-
-  int rc = uv_fs_stat(env->event_loop(), &req, file_path.c_str(), nullptr);
-
-  if (rc == 0) {
-    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
-    rc = S_ISDIR(s->st_mode);
-  }
-
-  uv_fs_req_cleanup(&req);
+  int rc = CachedStatMode(env->event_loop(), file_path.c_str());
+  if (rc >= 0) rc = S_ISDIR(rc);
 
   // rc is 0 if the path refers to a file
   if (rc == 0) return BindingData::FilePathIsFileReturnType::kIsFile;
@@ -3562,6 +5444,7 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "openFileHandle", OpenFileHandle);
   SetMethod(isolate, target, "read", Read);
   SetMethod(isolate, target, "readFileUtf8", ReadFileUtf8);
+  SetMethod(isolate, target, "readFileMapped", ReadFileMapped);
   SetMethod(isolate, target, "readBuffers", ReadBuffers);
   SetMethod(isolate, target, "fdatasync", Fdatasync);
   SetMethod(isolate, target, "fsync", Fsync);
@@ -3569,13 +5452,17 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "ftruncate", FTruncate);
   SetMethod(isolate, target, "rmdir", RMDir);
   SetMethod(isolate, target, "rmSync", RmSync);
+  SetMethod(isolate, target, "rmRecursive", RmRecursive);
   SetMethod(isolate, target, "mkdir", MKDir);
   SetMethod(isolate, target, "readdir", ReadDir);
+  SetMethod(isolate, target, "readdirWithStats", ReadDirWithStats);
   SetFastMethod(isolate,
                 target,
                 "internalModuleStat",
                 InternalModuleStat,
                 &fast_internal_module_stat_);
+  SetMethod(isolate, target, "clearStatCache", ClearStatCache);
+  SetMethod(isolate, target, "getStatCacheStats", GetStatCacheStats);
   SetMethod(isolate, target, "stat", Stat);
   SetMethod(isolate, target, "lstat", LStat);
   SetMethod(isolate, target, "fstat", FStat);
@@ -3605,6 +5492,7 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "mkdtemp", Mkdtemp);
 
   SetMethod(isolate, target, "cpSyncCheckPaths", CpSyncCheckPaths);
+  SetMethod(isolate, target, "cpRecursive", CpRecursive);
 
   StatWatcher::CreatePerIsolateProperties(isolate_data, target);
   BindingData::CreatePerIsolateProperties(isolate_data, target);
@@ -3647,6 +5535,8 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   fd->Inherit(AsyncWrap::GetConstructorTemplate(isolate_data));
   SetProtoMethod(isolate, fd, "close", FileHandle::Close);
   SetProtoMethod(isolate, fd, "releaseFD", FileHandle::ReleaseFD);
+  SetProtoMethod(
+      isolate, fd, "setWriteBatchSize", FileHandle::SetWriteBatchSize);
   Local<ObjectTemplate> fdt = fd->InstanceTemplate();
   fdt->SetInternalFieldCount(FileHandle::kInternalFieldCount);
   StreamBase::AddMethods(isolate_data, fd);
@@ -3689,6 +5579,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(OpenFileHandle);
   registry->Register(Read);
   registry->Register(ReadFileUtf8);
+  registry->Register(ReadFileMapped);
   registry->Register(ReadBuffers);
   registry->Register(Fdatasync);
   registry->Register(Fsync);
@@ -3696,11 +5587,15 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(FTruncate);
   registry->Register(RMDir);
   registry->Register(RmSync);
+  registry->Register(RmRecursive);
   registry->Register(MKDir);
   registry->Register(ReadDir);
+  registry->Register(ReadDirWithStats);
   registry->Register(InternalModuleStat);
   registry->Register(FastInternalModuleStat);
   registry->Register(fast_internal_module_stat_.GetTypeInfo());
+  registry->Register(ClearStatCache);
+  registry->Register(GetStatCacheStats);
   registry->Register(Stat);
   registry->Register(LStat);
   registry->Register(FStat);
@@ -3717,6 +5612,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(CopyFile);
 
   registry->Register(CpSyncCheckPaths);
+  registry->Register(CpRecursive);
 
   registry->Register(Chmod);
   registry->Register(FChmod);
@@ -3735,11 +5631,18 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(FileHandle::New);
   registry->Register(FileHandle::Close);
   registry->Register(FileHandle::ReleaseFD);
+  registry->Register(FileHandle::SetWriteBatchSize);
   StreamBase::RegisterExternalReferences(registry);
 }
 
 }  // namespace fs
 
+fs::LatencyMonitor* Environment::fs_latency_monitor() {
+  if (!fs_latency_monitor_)
+    fs_latency_monitor_ = std::make_unique<fs::LatencyMonitor>();
+  return fs_latency_monitor_.get();
+}
+
 }  // end namespace node
 
 NODE_BINDING_CONTEXT_AWARE_INTERNAL(fs, node::fs::CreatePerContextProperties)
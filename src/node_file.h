@@ -3,8 +3,10 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <deque>
 #include <optional>
 #include "aliased_buffer.h"
+#include "node_internals.h"
 #include "node_messaging.h"
 #include "node_snapshotable.h"
 #include "stream_base.h"
@@ -55,6 +57,66 @@ enum class FsStatFsOffset {
 constexpr size_t kFsStatFsBufferLength =
     static_cast<size_t>(FsStatFsOffset::kFsStatFsFieldsNumber);
 
+// Process-wide cache of the stat() results that module resolution asks for
+// over and over (InternalModuleStat(), FilePathIsFile(), ExistsSync()).
+// Entries hold the S_IFMT bits of st_mode, or a negative libuv error code for
+// failed lookups. The cache is only consulted with --experimental-stat-cache,
+// and only holds absolute, normalized paths.
+// It is invalidated by fs.watch() events, by the fs bindings that create or
+// remove paths in this process, and by clearStatCache(); changes made by
+// other processes to unwatched paths are not noticed.
+namespace stat_cache {
+bool IsEnabled();
+std::optional<int> Lookup(std::string_view path);
+void Insert(std::string_view path, int result);
+// Drops `path` and every cached entry below it. Drops the whole cache when
+// `path` is relative or not normalized.
+void Invalidate(std::string_view path);
+void Clear();
+}  // namespace stat_cache
+
+// Records, per Environment, how long fs operations take from the time they
+// are dispatched until they complete, for each uv_fs_type, and how many
+// bytes each read and write transfers. Asynchronous operations include the
+// time spent waiting for a thread of the libuv threadpool. Nothing is
+// recorded, and no clock is read, unless monitoring was started.
+class LatencyMonitor final {
+ public:
+  static constexpr int kTypeCount = UV_FS_LUTIME + 1;
+
+  LatencyMonitor() = default;
+  LatencyMonitor(const LatencyMonitor&) = delete;
+  LatencyMonitor& operator=(const LatencyMonitor&) = delete;
+
+  // Returns the current time if monitoring and 0 otherwise. The value is
+  // passed to Record() once the operation completes.
+  uint64_t Start() const { return monitoring_ ? uv_hrtime() : 0; }
+  void Record(uv_fs_type type, uint64_t started_at, ssize_t result);
+
+  // The histograms are created by the first StartMonitoring() call and kept
+  // afterwards, since operations that are in flight may still record into
+  // them.
+  void StartMonitoring();
+  void StopMonitoring() { monitoring_ = false; }
+  const std::shared_ptr<Histogram>& latency(uv_fs_type type) const {
+    return latency_[type];
+  }
+  const std::shared_ptr<Histogram>& read_bytes() const { return read_bytes_; }
+  const std::shared_ptr<Histogram>& write_bytes() const {
+    return write_bytes_;
+  }
+
+  // The name of the operation, as in fs trace events, or nullptr for
+  // types that the fs bindings do not dispatch.
+  static const char* GetTypeName(uv_fs_type type);
+
+ private:
+  std::shared_ptr<Histogram> latency_[kTypeCount];
+  std::shared_ptr<Histogram> read_bytes_;
+  std::shared_ptr<Histogram> write_bytes_;
+  bool monitoring_ = false;
+};
+
 class BindingData : public SnapshotableObject {
  public:
   struct InternalFieldInfo : public node::InternalFieldInfoBase {
@@ -162,6 +224,8 @@ class FSReqBase : public ReqWrap<uv_fs_t> {
   bool use_bigint() const { return use_bigint_; }
   bool is_plain_open() const { return is_plain_open_; }
   bool with_file_types() const { return with_file_types_; }
+  // The value of LatencyMonitor::Start() when the request was initialized.
+  uint64_t started_at() const { return started_at_; }
 
   void set_is_plain_open(bool value) { is_plain_open_ = value; }
   void set_with_file_types(bool value) { with_file_types_ = value; }
@@ -192,6 +256,7 @@ class FSReqBase : public ReqWrap<uv_fs_t> {
   bool is_plain_open_ = false;
   bool with_file_types_ = false;
   const char* syscall_ = nullptr;
+  uint64_t started_at_ = 0;
 
   BaseObjectPtr<BindingData> binding_data_;
 
@@ -292,6 +357,32 @@ class FSReqAfterScope final {
   v8::Context::Scope context_scope_;
 };
 
+// Runs a file system operation that does not map onto a single uv_fs_*()
+// call, e.g. scanning a directory and stat()ing every entry, as one job on
+// the libuv threadpool and settles the FSReqBase back on the event loop.
+// Subclasses report failure by storing a negative libuv error code in
+// result_, which rejects the request the same way FSReqAfterScope does.
+class FSReqThreadPoolWork : public ThreadPoolWork {
+ public:
+  FSReqThreadPoolWork(FSReqBase* req_wrap, const char* type);
+
+  void AfterThreadPoolWork(int status) final;
+
+  FSReqThreadPoolWork(const FSReqThreadPoolWork&) = delete;
+  FSReqThreadPoolWork& operator=(const FSReqThreadPoolWork&) = delete;
+
+ protected:
+  // Called on the event loop thread if DoThreadPoolWork() succeeded.
+  virtual void Resolve(FSReqBase* req_wrap) = 0;
+
+  int result_ = 0;
+  // The path reported in the error if result_ is negative.
+  std::string error_path_;
+
+ private:
+  BaseObjectPtr<FSReqBase> req_wrap_;
+};
+
 class FileHandle;
 
 // A request wrap specifically for uv_fs_read()s scheduled for reading
@@ -313,6 +404,17 @@ class FileHandleReadWrap final : public ReqWrap<uv_fs_t> {
   FileHandle* file_handle_;
   uv_buf_t buffer_;
 
+  // Only used by reads that FileHandle::ReadAhead() issues into memory it
+  // owns, before the listener has asked for the data. The memory comes from
+  // Environment::allocate_managed_buffer().
+  void ReleaseReadAheadStorage();
+  uv_buf_t read_ahead_storage_ = uv_buf_init(nullptr, 0);
+  int64_t offset_ = -1;
+  ssize_t result_ = 0;
+  size_t consumed_ = 0;
+  bool done_ = false;
+  bool discarded_ = false;
+
   friend class FileHandle;
 };
 
@@ -346,6 +448,10 @@ class FileHandle final : public AsyncWrap, public StreamBase {
   // Releases ownership of the FD.
   static void ReleaseFD(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  // Sets the maximum number of bytes that queued writes are coalesced into.
+  static void SetWriteBatchSize(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
   // StreamBase interface:
   int ReadStart() override;
   int ReadStop() override;
@@ -354,10 +460,24 @@ class FileHandle final : public AsyncWrap, public StreamBase {
   bool IsClosing() override { return closing_; }
   AsyncWrap* GetAsyncWrap() override { return this; }
 
+  // Lets a StreamPipe move the file to a socket with sendfile() instead of
+  // reading it. Only possible before the stream has started reading. On
+  // success, `*offset` is where the stream continues and `*length` is the
+  // number of bytes it has left, or -1 if it runs until the end of the file.
+  bool StartSendfile(int64_t* offset, int64_t* length);
+  // Marks `bytes` more of the stream as consumed by sendfile().
+  void AdvanceSendfile(size_t bytes);
+
   // In the case of file streams, shutting down corresponds to closing.
   ShutdownWrap* CreateShutdownWrap(v8::Local<v8::Object> object) override;
   int DoShutdown(ShutdownWrap* req_wrap) override;
 
+  // Writes that arrive while another one is in flight are queued and then
+  // submitted together as a single uv_fs_write() once it completes. This only
+  // covers writes made through the stream interface. filehandle.write(),
+  // writeBuffer(s) and fs.writev() go through the fd-based bindings, which
+  // take an explicit position and resolve one request per call.
+  WriteWrap* CreateWriteWrap(v8::Local<v8::Object> object) override;
   int DoWrite(WriteWrap* w,
               uv_buf_t* bufs,
               size_t count,
@@ -436,6 +556,33 @@ class FileHandle final : public AsyncWrap, public StreamBase {
 
   // Asynchronous close
   v8::MaybeLocal<v8::Promise> ClosePromise();
+  void DispatchClose(CloseReq* req);
+
+  BaseObjectPtr<FileHandleReadWrap> NewReadWrap();
+  void RecycleReadWrap(BaseObjectPtr<FileHandleReadWrap>&& read_wrap);
+
+  // Streams with a known position keep several reads in flight at increasing
+  // offsets and hand the data to the listener in order once it wants it.
+  void ReadAhead();
+  void FlushReadAhead();
+  void DiscardReadAhead();
+  void ClearReadAhead();
+
+  // Stopping a stream does not cancel the reads that use fd_ already, so
+  // closing waits for them. AfterRead() runs once each read has completed.
+  bool HasReadsInFlight() const;
+  void AfterRead();
+
+  struct PendingWrite {
+    BaseObjectPtr<AsyncWrap> req_wrap;
+    WriteWrap* write_wrap;
+    std::vector<uv_buf_t> bufs;
+  };
+
+  // Submits as many queued writes as fit in one batch, starting at the front
+  // of write_queue_.
+  int FlushWrites();
+  void AfterWrite(ssize_t result);
 
   int fd_;
   bool closing_ = false;
@@ -446,6 +593,24 @@ class FileHandle final : public AsyncWrap, public StreamBase {
 
   BaseObjectPtr<FileHandleReadWrap> current_read_;
 
+  std::deque<BaseObjectPtr<FileHandleReadWrap>> read_ahead_;
+  size_t read_ahead_chunk_size_;
+  bool read_ahead_eof_ = false;
+  bool read_ahead_failed_ = false;
+  bool read_ahead_advised_ = false;
+  // Keeps the handle alive while reads are in flight.
+  BaseObjectPtr<FileHandle> read_keepalive_;
+  CloseReq* pending_close_ = nullptr;
+
+  std::deque<PendingWrite> write_queue_;
+  // The number of entries at the front of write_queue_ that are in flight.
+  size_t writes_in_flight_ = 0;
+  size_t write_batch_size_;
+  std::vector<uv_buf_t> write_batch_bufs_;
+  ShutdownWrap* pending_shutdown_ = nullptr;
+  // Keeps the handle alive while writes are queued.
+  BaseObjectPtr<FileHandle> write_keepalive_;
+
   BaseObjectPtr<BindingData> binding_data_;
 };
 
@@ -11,6 +11,7 @@
 #include "node_perf.h"
 #include "node_revert.h"
 #include "stream_base-inl.h"
+#include "threadpoolwork-inl.h"
 #include "util-inl.h"
 
 #include "nbytes.h"
@@ -21,6 +22,10 @@
 #include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 namespace node {
 
 using v8::Array;
@@ -34,6 +39,7 @@ using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
+using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
@@ -43,6 +49,7 @@ using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
+using v8::Uint32;
 using v8::Uint8Array;
 using v8::Undefined;
 using v8::Value;
@@ -128,6 +135,16 @@ Http2Options::Http2Options(Http2State* http2_state, SessionType type) {
     nghttp2_option_set_builtin_recv_extension_type(option, NGHTTP2_ORIGIN);
   }
 
+  // Server side sessions understand RFC 9218 extensible priorities. The
+  // urgency scheduler is only engaged once the local SETTINGS advertise
+  // SETTINGS_NO_RFC7540_PRIORITIES = 1, and falls back to the RFC 7540
+  // priority tree if the client never confirms the setting.
+  if (type == NGHTTP2_SESSION_SERVER) {
+    nghttp2_option_set_builtin_recv_extension_type(option,
+                                                   NGHTTP2_PRIORITY_UPDATE);
+    nghttp2_option_set_server_fallback_rfc7540_priorities(option, 1);
+  }
+
   AliasedUint32Array& buffer = http2_state->options_buffer;
   uint32_t flags = buffer[IDX_OPTIONS_FLAGS];
 
@@ -208,6 +225,14 @@ Http2Options::Http2Options(Http2State* http2_state, SessionType type) {
         option,
         static_cast<size_t>(buffer[IDX_OPTIONS_MAX_SETTINGS]));
   }
+
+  // Enables the auto-tuning of the receive windows, which grows them up to
+  // this size. Flow control windows cannot exceed 2^31-1 bytes.
+  if (flags & (1 << IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE)) {
+    set_max_auto_window_size(std::min<uint32_t>(
+        buffer[IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE],
+        NGHTTP2_MAX_WINDOW_SIZE));
+  }
 }
 
 #define GRABSETTING(entries, count, name)                                      \
@@ -437,6 +462,25 @@ const char* Http2Session::TypeName() const {
   }
 }
 
+Http2HeaderSet::Http2HeaderSet(Environment* env,
+                               Local<Object> object,
+                               Local<Array> headers)
+    : BaseObject(env, object), headers_(env, headers) {
+  MakeWeak();
+}
+
+void Http2HeaderSet::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsArray());
+  new Http2HeaderSet(env, args.This(), args[0].As<Array>());
+}
+
+void Http2HeaderSet::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("headers",
+                              headers_.length() * sizeof(nghttp2_nv));
+}
+
 Origins::Origins(
     Environment* env,
     Local<String> origin_string,
@@ -565,6 +609,7 @@ Http2Session::Http2Session(Http2State* http2_state,
 
   max_outstanding_pings_ = opts.max_outstanding_pings();
   max_outstanding_settings_ = opts.max_outstanding_settings();
+  max_auto_window_size_ = opts.max_auto_window_size();
 
   local_custom_settings_.number = 0;
   remote_custom_settings_.number = 0;
@@ -580,6 +625,10 @@ Http2Session::Http2Session(Http2State* http2_state,
       nghttp2_session_server_new3 :
       nghttp2_session_client_new3;
 
+  // nghttp2 makes many small, short-lived allocations (frames, stream state,
+  // header buffers); keep freed ones around for reuse within this session.
+  // They are released together with the session.
+  EnableBlockPool();
   nghttp2_mem alloc_info = MakeAllocator();
 
   // This should fail only if the system is out of memory, which
@@ -647,6 +696,8 @@ void Http2Session::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackFieldWithSize("pending_rst_streams",
                               pending_rst_streams_.size() * sizeof(int32_t));
   tracker->TrackFieldWithSize("nghttp2_memory", current_nghttp2_memory_);
+  for (const std::shared_ptr<Histogram>& histogram : histograms_)
+    tracker->TrackField("histogram", histogram);
 }
 
 std::string Http2Session::diagnostic_name() const {
@@ -671,6 +722,9 @@ MaybeLocal<Object> Http2StreamPerformanceEntryTraits::GetDetails(
   SET(bytes_read_string, received_bytes)
   SET(bytes_written_string, sent_bytes)
   SET(id_string, id)
+  SET(urgency_string, urgency)
+  SET(incremental_string, incremental)
+  SET(priority_updates_string, priority_updates)
 #undef SET
 
 #define SET(name, val)                                                         \
@@ -711,8 +765,10 @@ MaybeLocal<Object> Http2SessionPerformanceEntryTraits::GetDetails(
   SET(bytes_read_string, data_received)
   SET(frames_received_string, frame_count)
   SET(frames_sent_string, frame_sent)
+  SET(auto_window_size_string, auto_window_size)
   SET(max_concurrent_streams_string, max_concurrent_streams)
   SET(ping_rtt_string, ping_rtt)
+  SET(priority_updates_string, priority_updates)
   SET(stream_average_duration_string, stream_average_duration)
   SET(stream_count_string, stream_count)
 
@@ -852,6 +908,12 @@ void Http2Session::AddStream(Http2Stream* stream) {
   if (size > statistics_.max_concurrent_streams)
     statistics_.max_concurrent_streams = size;
   IncrementCurrentSessionMemory(sizeof(*stream));
+  // Streams start out with the initial window of the SETTINGS, so bring
+  // them up to the window the auto-tuning chose so far.
+  if (statistics_.auto_window_size > 0) {
+    nghttp2_session_set_local_window_size(
+        session_.get(), NGHTTP2_FLAG_NONE, stream->id(), auto_window_size_);
+  }
 }
 
 
@@ -1066,6 +1128,13 @@ int Http2Session::OnFrameReceive(nghttp2_session* handle,
     case NGHTTP2_PRIORITY:
       session->HandlePriorityFrame(frame);
       break;
+    case NGHTTP2_PRIORITY_UPDATE:
+      session->HandlePriorityUpdateFrame(frame);
+      break;
+    case NGHTTP2_WINDOW_UPDATE:
+      if (session->has_histograms())
+        session->HandleWindowUpdateFrame(frame);
+      break;
     case NGHTTP2_GOAWAY:
       session->HandleGoawayFrame(frame);
       break;
@@ -1199,6 +1268,12 @@ int Http2Session::OnFrameSent(nghttp2_session* handle,
                               void* user_data) {
   Http2Session* session = static_cast<Http2Session*>(user_data);
   session->statistics_.frame_sent += 1;
+  if (frame->hd.type == NGHTTP2_DATA && session->has_histograms()) {
+    BaseObjectPtr<Http2Stream> stream =
+        session->FindStream(frame->hd.stream_id);
+    if (stream && !stream->is_destroyed())
+      stream->MaybeStartFlowControlStall();
+  }
   return 0;
 }
 
@@ -1276,6 +1351,7 @@ int Http2Session::OnDataChunkReceived(nghttp2_session* handle,
   // so that it can send a WINDOW_UPDATE frame. This is a critical part of
   // the flow control process in http2
   CHECK_EQ(nghttp2_session_consume_connection(handle, len), 0);
+  session->SampleBdp(len);
   BaseObjectPtr<Http2Stream> stream = session->FindStream(id);
 
   // If the stream has been destroyed, ignore this chunk
@@ -1283,6 +1359,8 @@ int Http2Session::OnDataChunkReceived(nghttp2_session* handle,
     return 0;
 
   stream->statistics_.received_bytes += len;
+  if (stream->statistics_.first_byte == 0)
+    stream->statistics_.first_byte = uv_hrtime();
 
   // Repeatedly ask the stream's owner for memory, and copy the read data
   // into those buffers.
@@ -1439,6 +1517,9 @@ void Http2Session::HandleHeadersFrame(const nghttp2_frame* frame) {
   if (!stream || stream->is_destroyed())
     return;
 
+  // A request's priority header is applied by nghttp2 before we get here.
+  stream->UpdatePriorityStatistics();
+
   // The headers are stored as a vector of Http2Header instances.
   // The following converts that into a JS array with the structure:
   // [name1, value1, name2, value2, name3, value3, name3, value4] and so on.
@@ -1502,6 +1583,35 @@ void Http2Session::HandlePriorityFrame(const nghttp2_frame* frame) {
                arraysize(argv), argv);
 }
 
+// Called by OnFrameReceived when a PRIORITY_UPDATE frame has been received.
+// nghttp2 has already moved the stream within its urgency scheduler, so all
+// that is left is to record the change.
+void Http2Session::HandlePriorityUpdateFrame(const nghttp2_frame* frame) {
+  const nghttp2_ext_priority_update* update =
+      static_cast<const nghttp2_ext_priority_update*>(frame->ext.payload);
+  Debug(this, "handle priority update frame for stream %d",
+        update->stream_id);
+  statistics_.priority_updates++;
+  BaseObjectPtr<Http2Stream> stream = FindStream(update->stream_id);
+  if (stream && !stream->is_destroyed())
+    stream->UpdatePriorityStatistics();
+}
+
+// Called by OnFrameReceived when a WINDOW_UPDATE frame has been received
+// while histograms are enabled. A connection level update may unblock any
+// of the streams.
+void Http2Session::HandleWindowUpdateFrame(const nghttp2_frame* frame) {
+  int32_t id = GetFrameID(frame);
+  if (id == 0) {
+    for (const auto& s : streams_)
+      s.second->MaybeEndFlowControlStall();
+    return;
+  }
+  BaseObjectPtr<Http2Stream> stream = FindStream(id);
+  if (stream && !stream->is_destroyed())
+    stream->MaybeEndFlowControlStall();
+}
+
 
 // Called by OnFrameReceived when a complete DATA frame has been received.
 // If we know that this was the last DATA frame (because the END_STREAM flag
@@ -1612,6 +1722,7 @@ void Http2Session::HandlePingFrame(const nghttp2_frame* frame) {
   Local<Value> arg;
   bool ack = frame->hd.flags & NGHTTP2_FLAG_ACK;
   if (ack) {
+    if (OnBdpPingAck(frame->ping.opaque_data)) return;
     BaseObjectPtr<Http2Ping> ping = PopPing();
 
     if (!ping) {
@@ -1638,6 +1749,75 @@ void Http2Session::HandlePingFrame(const nghttp2_frame* frame) {
   MakeCallback(env()->http2session_on_ping_function(), 1, &arg);
 }
 
+void Http2Session::SampleBdp(size_t length) {
+  if (max_auto_window_size_ == 0) return;
+  if (!bdp_ping_outstanding_) {
+    // The payload only has to tell the ack apart from those of user pings.
+    memcpy(bdp_ping_payload_, "bdp\0", 4);
+    bdp_ping_count_++;
+    memcpy(bdp_ping_payload_ + 4, &bdp_ping_count_, 4);
+    if (nghttp2_submit_ping(
+            session_.get(), NGHTTP2_FLAG_NONE, bdp_ping_payload_) != 0) {
+      return;
+    }
+    bdp_ping_outstanding_ = true;
+    bdp_ping_sent_at_ = uv_hrtime();
+    bdp_sample_ = 0;
+  }
+  bdp_sample_ += length;
+}
+
+bool Http2Session::OnBdpPingAck(const uint8_t* payload) {
+  if (!bdp_ping_outstanding_ ||
+      memcmp(payload, bdp_ping_payload_, sizeof(bdp_ping_payload_)) != 0) {
+    return false;
+  }
+  bdp_ping_outstanding_ = false;
+  uint64_t rtt = uv_hrtime() - bdp_ping_sent_at_;
+  statistics_.ping_rtt = rtt;
+
+  // Smooth the round trip time, but weigh recent samples heavily, as gRPC
+  // does, so that a few slow acks do not keep the window small.
+  bdp_rtt_ = bdp_rtt_ == 0 ? rtt : bdp_rtt_ + (rtt - bdp_rtt_) * 0.9;
+  double bandwidth = bdp_sample_ / bdp_rtt_;
+  if (bandwidth > bdp_max_bandwidth_) bdp_max_bandwidth_ = bandwidth;
+
+  if (auto_window_size_ == 0) {
+    auto_window_size_ = nghttp2_session_get_local_settings(
+        session_.get(), NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE);
+  }
+  // Only grow the window while the data received during a round trip comes
+  // close to filling it, and the bandwidth is not going down, which would
+  // mean that the window is not what limits the throughput.
+  if (auto_window_size_ >= max_auto_window_size_ ||
+      bdp_sample_ < auto_window_size_ * 2 / 3 ||
+      bandwidth < bdp_max_bandwidth_) {
+    return true;
+  }
+  uint64_t window = std::min<uint64_t>(bdp_sample_ * 2, max_auto_window_size_);
+  if (window > auto_window_size_) GrowAutoWindow(window);
+  return true;
+}
+
+void Http2Session::GrowAutoWindow(uint32_t window) {
+  Debug(this, "auto-tuning grows the receive windows to %u", window);
+  auto_window_size_ = window;
+  statistics_.auto_window_size = window;
+  nghttp2_session* session = session_.get();
+  // This sends the WINDOW_UPDATE frames. Windows that were made larger
+  // through setLocalWindowSize() are left alone.
+  int32_t size = static_cast<int32_t>(window);
+  if (nghttp2_session_get_effective_local_window_size(session) < size)
+    nghttp2_session_set_local_window_size(session, NGHTTP2_FLAG_NONE, 0, size);
+  for (const auto& [id, stream] : streams_) {
+    if (nghttp2_session_get_stream_effective_local_window_size(session, id) <
+        size) {
+      nghttp2_session_set_local_window_size(
+          session, NGHTTP2_FLAG_NONE, id, size);
+    }
+  }
+}
+
 // Called by OnFrameReceived when a complete SETTINGS frame has been received.
 void Http2Session::HandleSettingsFrame(const nghttp2_frame* frame) {
   bool ack = frame->hd.flags & NGHTTP2_FLAG_ACK;
@@ -1700,6 +1880,11 @@ void Http2Session::OnStreamAfterWrite(WriteWrap* w, int status) {
   Debug(this, "write finished with status %d", status);
 
   CHECK(is_write_in_progress());
+  if (sending_file_data_ && status == 0 &&
+      outgoing_index_ < outgoing_buffers_.size()) {
+    ContinueOutgoing();
+    return;
+  }
   set_write_in_progress(false);
 
   // Inform all pending writes about their completion.
@@ -1785,6 +1970,10 @@ void Http2Session::ClearOutgoing(int status) {
   CHECK(is_sending());
 
   set_sending(false);
+  has_outgoing_file_ = false;
+  sending_file_data_ = false;
+  outgoing_index_ = 0;
+  file_fallback_store_.reset();
 
   if (!outgoing_buffers_.empty()) {
     outgoing_storage_.clear();
@@ -1867,11 +2056,18 @@ uint8_t Http2Session::SendPendingData() {
   CHECK(outgoing_buffers_.empty());
   CHECK(outgoing_storage_.empty());
 
-  // Part One: Gather data from nghttp2
+  // Part One: Gather data from nghttp2, across all streams that are ready,
+  // until either nghttp2 has nothing left or the send budget is used up.
+  // Anything left over is sent once this write has finished.
 
+  bool over_budget = false;
   while ((src_length = nghttp2_session_mem_send(session_.get(), &src)) > 0) {
     Debug(this, "nghttp2 has %d bytes to send", src_length);
     CopyDataIntoOutgoing(src, src_length);
+    if (send_budget_ != 0 && outgoing_length_ >= send_budget_) {
+      over_budget = true;
+      break;
+    }
   }
 
   CHECK_NE(src_length, NGHTTP2_ERR_NOMEM);
@@ -1891,23 +2087,54 @@ uint8_t Http2Session::SendPendingData() {
     ClearOutgoing(0);
     return 0;
   }
+  RecordHistogram(HTTP2_HISTOGRAM_OUTGOING_QUEUE_DEPTH, count);
+  if (has_outgoing_file_) {
+    size_t offset = 0;
+    for (NgHttp2StreamWrite& write : outgoing_buffers_) {
+      statistics_.data_sent += write.buf.len;
+      if (!write.is_file() && write.buf.base == nullptr) {
+        write.buf.base =
+            reinterpret_cast<char*>(outgoing_storage_.data() + offset);
+        offset += write.buf.len;
+      }
+    }
+    chunks_sent_since_last_write_++;
+
+    CHECK(!is_write_in_progress());
+    set_write_in_progress();
+    sending_file_data_ = true;
+    outgoing_index_ = 0;
+    ContinueOutgoing();
+    MaybeStopReading();
+    return 0;
+  }
+
   MaybeStackBuffer<uv_buf_t, 32> bufs;
   bufs.AllocateSufficientStorage(count);
 
   // Set the buffer base pointers for copied data that ended up in the
   // sessions's own storage since it might have shifted around during gathering.
-  // (Those are marked by having .base == nullptr.)
+  // (Those are marked by having .base == nullptr.) Copied chunks that follow
+  // each other are also adjacent in the storage, so they are merged into a
+  // single buffer; stream-provided data is referenced without copying.
   size_t offset = 0;
   size_t i = 0;
+  bool last_was_copy = false;
   for (const NgHttp2StreamWrite& write : outgoing_buffers_) {
     statistics_.data_sent += write.buf.len;
     if (write.buf.base == nullptr) {
-      bufs[i++] = uv_buf_init(
-          reinterpret_cast<char*>(outgoing_storage_.data() + offset),
-          write.buf.len);
+      if (last_was_copy) {
+        bufs[i - 1].len += write.buf.len;
+      } else {
+        bufs[i++] = uv_buf_init(
+            reinterpret_cast<char*>(outgoing_storage_.data() + offset),
+            write.buf.len);
+      }
       offset += write.buf.len;
+      last_was_copy = true;
     } else {
       bufs[i++] = write.buf;
+      last_was_copy = false;
     }
   }
 
@@ -1915,10 +2142,13 @@ uint8_t Http2Session::SendPendingData() {
 
   CHECK(!is_write_in_progress());
   set_write_in_progress();
-  StreamWriteResult res = underlying_stream()->Write(*bufs, count);
+  StreamWriteResult res = underlying_stream()->Write(*bufs, i);
   if (!res.async) {
     set_write_in_progress(false);
     ClearOutgoing(res.err);
+    // OnStreamAfterWrite() takes care of this for asynchronous writes.
+    if (over_budget && !is_write_scheduled())
+      MaybeScheduleWrite();
   }
 
   MaybeStopReading();
@@ -1927,6 +2157,194 @@ uint8_t Http2Session::SendPendingData() {
 }
 
 
+class Http2Session::SendfileWork final : public ThreadPoolWork {
+ public:
+  SendfileWork(Http2Session* session,
+               int out_fd,
+               int in_fd,
+               int64_t offset,
+               size_t length)
+      : ThreadPoolWork(session->env(), "http2_sendfile"),
+        session_(session),
+        out_fd_(out_fd),
+        in_fd_(in_fd),
+        offset_(offset),
+        length_(length) {}
+
+  void DoThreadPoolWork() override {
+#ifdef __linux__
+    // uv_fs_sendfile() would try copy_file_range() first, which fails for
+    // sockets and makes it fall back to copying through user space.
+    off_t offset = offset_;
+    ssize_t result;
+    do {
+      result = sendfile(out_fd_, in_fd_, &offset, length_);
+    } while (result == -1 && errno == EINTR);
+    result_ = result >= 0 ? result : uv_translate_sys_error(errno);
+#else
+    uv_fs_t req;
+    result_ = uv_fs_sendfile(
+        nullptr, &req, out_fd_, in_fd_, offset_, length_, nullptr);
+    uv_fs_req_cleanup(&req);
+#endif
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<SendfileWork> self(this);
+    BaseObjectPtr<Http2Session> session = std::move(session_);
+    session->AfterSendfile(
+        status == UV_ECANCELED ? static_cast<ssize_t>(UV_ECANCELED) : result_);
+  }
+
+ private:
+  BaseObjectPtr<Http2Session> session_;
+  int out_fd_;
+  int in_fd_;
+  int64_t offset_;
+  size_t length_;
+  ssize_t result_ = 0;
+};
+
+bool Http2Session::CanSendFile() {
+#ifdef _WIN32
+  return false;
+#else
+  if (stream_ == nullptr) return false;
+  // Sockets that transform the data, like TLS, need it in memory.
+  const AsyncWrap::ProviderType type =
+      underlying_stream()->GetAsyncWrap()->provider_type();
+  if (type != AsyncWrap::PROVIDER_TCPWRAP &&
+      type != AsyncWrap::PROVIDER_PIPEWRAP) {
+    return false;
+  }
+  return underlying_stream()->GetFD() >= 0;
+#endif
+}
+
+// Writes outgoing_buffers_ from outgoing_index_ on: runs of in-memory data
+// with a regular write, file ranges with sendfile(). Each step continues
+// from OnStreamAfterWrite() or AfterSendfile() until all data is written.
+void Http2Session::ContinueOutgoing() {
+  CHECK(sending_file_data_);
+  CHECK(is_write_in_progress());
+  if (stream_ == nullptr)
+    return FinishOutgoing(UV_ECANCELED);
+
+  while (outgoing_index_ < outgoing_buffers_.size()) {
+    const NgHttp2StreamWrite& write = outgoing_buffers_[outgoing_index_];
+    if (write.is_file()) {
+      auto* work = new SendfileWork(this,
+                                    underlying_stream()->GetFD(),
+                                    write.fd,
+                                    write.file_offset,
+                                    write.buf.len);
+      work->ScheduleWork();
+      return;
+    }
+
+    size_t end = outgoing_index_;
+    while (end < outgoing_buffers_.size() && !outgoing_buffers_[end].is_file())
+      end++;
+    const size_t count = end - outgoing_index_;
+    MaybeStackBuffer<uv_buf_t, 32> bufs(count);
+    for (size_t i = 0; i < count; i++)
+      bufs[i] = outgoing_buffers_[outgoing_index_ + i].buf;
+    outgoing_index_ = end;
+
+    StreamWriteResult res = underlying_stream()->Write(*bufs, count);
+    if (res.err != 0)
+      return FinishOutgoing(res.err);
+    if (res.async)
+      return;  // OnStreamAfterWrite() picks up from here.
+  }
+  FinishOutgoing(0);
+}
+
+void Http2Session::FinishOutgoing(int status) {
+  if (stream_ == nullptr) {
+    set_write_in_progress(false);
+    ClearOutgoing(UV_ECANCELED);
+    return;
+  }
+  outgoing_index_ = outgoing_buffers_.size();
+  OnStreamAfterWrite(nullptr, status);
+}
+
+void Http2Session::AfterSendfile(ssize_t result) {
+  if (!env()->can_call_into_js()) return;
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+
+  NgHttp2StreamWrite& write = outgoing_buffers_[outgoing_index_];
+  if (result > 0) {
+    write.file_offset += result;
+    write.buf.len -= result;
+  }
+  if (write.buf.len == 0) {
+    outgoing_index_++;
+    ContinueOutgoing();
+    return;
+  }
+  if (result == 0) {
+    // The file is shorter than what was announced in the DATA frames.
+    FinishOutgoing(UV_EIO);
+    return;
+  }
+  if (result < 0 && result != UV_EAGAIN) {
+    FinishOutgoing(result);
+    return;
+  }
+  // The socket is full. The rest of this frame is read into memory and
+  // written the regular way, which waits for the socket to drain.
+  ReadFileFallback();
+}
+
+void Http2Session::ReadFileFallback() {
+  const NgHttp2StreamWrite& write = outgoing_buffers_[outgoing_index_];
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    file_fallback_store_ =
+        ArrayBuffer::NewBackingStore(env()->isolate(), write.buf.len);
+  }
+  uv_buf_t buf = uv_buf_init(static_cast<char*>(file_fallback_store_->Data()),
+                             write.buf.len);
+  int err = uv_fs_read(env()->event_loop(),
+                       &file_fallback_req_,
+                       write.fd,
+                       &buf,
+                       1,
+                       write.file_offset,
+                       AfterFileFallbackRead);
+  if (err < 0) {
+    FinishOutgoing(err);
+    return;
+  }
+  file_fallback_keepalive_.reset(this);
+}
+
+void Http2Session::AfterFileFallbackRead(uv_fs_t* req) {
+  Http2Session* session = ContainerOf(&Http2Session::file_fallback_req_, req);
+  BaseObjectPtr<Http2Session> keepalive =
+      std::move(session->file_fallback_keepalive_);
+  const ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+
+  Environment* env = session->env();
+  if (!env->can_call_into_js()) return;
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  NgHttp2StreamWrite& write =
+      session->outgoing_buffers_[session->outgoing_index_];
+  if (result < 0 || static_cast<size_t>(result) != write.buf.len) {
+    session->FinishOutgoing(result < 0 ? static_cast<int>(result) : UV_EIO);
+    return;
+  }
+  write.fd = -1;
+  write.buf.base = static_cast<char*>(session->file_fallback_store_->Data());
+  session->ContinueOutgoing();
+}
+
 // This callback is called from nghttp2 when it wants to send DATA frames for a
 // given Http2Stream, when we set the `NGHTTP2_DATA_FLAG_NO_COPY` flag earlier
 // in the Http2Stream::Provider::Stream::OnRead callback.
@@ -1957,19 +2375,34 @@ int Http2Session::OnSendData(
     CHECK(!stream->queue_.empty());
 
     NgHttp2StreamWrite& write = stream->queue_.front();
+    if (write.is_file())
+      session->has_outgoing_file_ = true;
     if (write.buf.len <= length) {
       // This write does not suffice by itself, so we can consume it completely.
       length -= write.buf.len;
+      if (write.is_file()) {
+        stream->queued_file_writes_--;
+        stream->memory_before_file_ = write.memory_after;
+        if (stream->last_file_write_ == &write)
+          stream->last_file_write_ = nullptr;
+      }
       session->PushOutgoingBuffer(std::move(write));
       stream->queue_.pop();
       continue;
     }
 
     // Slice off `length` bytes of the first write in the queue.
-    session->PushOutgoingBuffer(NgHttp2StreamWrite {
-      uv_buf_init(write.buf.base, length)
-    });
-    write.buf.base += length;
+    if (write.is_file()) {
+      session->PushOutgoingBuffer(NgHttp2StreamWrite {
+        BaseObjectPtr<AsyncWrap>(), write.fd, write.file_offset, length
+      });
+      write.file_offset += length;
+    } else {
+      session->PushOutgoingBuffer(NgHttp2StreamWrite {
+        uv_buf_init(write.buf.base, length)
+      });
+      write.buf.base += length;
+    }
     write.buf.len -= length;
     break;
   }
@@ -2159,6 +2592,7 @@ Http2Stream::Http2Stream(Http2Session* session,
   StreamBase::AttachToObject(GetObject());
   statistics_.id = id;
   statistics_.start_time = uv_hrtime();
+  statistics_.urgency = NGHTTP2_EXTPRI_DEFAULT_URGENCY;
 
   // Limit the number of header pairs
   max_header_pairs_ = session->max_header_pairs();
@@ -2292,9 +2726,52 @@ void Http2Stream::Destroy() {
   session_->statistics_.stream_average_duration =
       ((statistics_.end_time - statistics_.start_time) /
           session_->statistics_.stream_count) / 1e6;
+  if (session_->has_histograms()) {
+    uint64_t first_byte = session_->type() == NGHTTP2_SESSION_SERVER ?
+        statistics_.first_byte_sent : statistics_.first_byte;
+    if (first_byte != 0) {
+      session_->RecordHistogram(HTTP2_HISTOGRAM_TIME_TO_FIRST_BYTE,
+                                first_byte - statistics_.start_time);
+    }
+    session_->RecordHistogram(HTTP2_HISTOGRAM_STREAM_DURATION,
+                              statistics_.end_time - statistics_.start_time);
+    if (flow_control_stall_start_ != 0) {
+      session_->RecordHistogram(
+          HTTP2_HISTOGRAM_FLOW_CONTROL_STALL,
+          statistics_.end_time - flow_control_stall_start_);
+      flow_control_stall_start_ = 0;
+    }
+  }
   EmitStatistics();
 }
 
+// Called after a DATA frame for this stream has been sent. If more data is
+// queued but the peer's window, for either the stream or the connection, is
+// used up, the stream stalls until a WINDOW_UPDATE arrives.
+void Http2Stream::MaybeStartFlowControlStall() {
+  if (flow_control_stall_start_ != 0 || available_outbound_length_ == 0)
+    return;
+  nghttp2_session* s = session_->session();
+  if (nghttp2_session_get_stream_remote_window_size(s, id_) > 0 &&
+      nghttp2_session_get_remote_window_size(s) > 0) {
+    return;
+  }
+  flow_control_stall_start_ = uv_hrtime();
+}
+
+void Http2Stream::MaybeEndFlowControlStall() {
+  if (flow_control_stall_start_ == 0 || is_destroyed())
+    return;
+  nghttp2_session* s = session_->session();
+  if (nghttp2_session_get_stream_remote_window_size(s, id_) <= 0 ||
+      nghttp2_session_get_remote_window_size(s) <= 0) {
+    return;
+  }
+  session_->RecordHistogram(HTTP2_HISTOGRAM_FLOW_CONTROL_STALL,
+                            uv_hrtime() - flow_control_stall_start_);
+  flow_control_stall_start_ = 0;
+}
+
 
 // Initiates a response on the Http2Stream using data provided via the
 // StreamBase Streams API.
@@ -2394,6 +2871,60 @@ int Http2Stream::SubmitPriority(const Http2Priority& priority,
   return ret;
 }
 
+// Changes the RFC 9218 urgency and incremental flag of this stream. Server
+// sessions reprioritize the stream in nghttp2's urgency scheduler directly,
+// which decides the order in which SendPendingData() pulls DATA frames;
+// client sessions signal the new priority with a PRIORITY_UPDATE frame.
+int Http2Stream::SubmitExtensiblePriority(const nghttp2_extpri& extpri,
+                                          bool ignore_client_signal) {
+  CHECK(!this->is_destroyed());
+  Http2Scope h2scope(this);
+  Debug(this, "sending extensible priority u=%d, i=%d",
+        extpri.urgency, extpri.inc);
+  int ret;
+  if (session_->type() == NGHTTP2_SESSION_SERVER) {
+    ret = nghttp2_session_change_extpri_stream_priority(
+        session_->session(),
+        id_,
+        &extpri,
+        ignore_client_signal ? 1 : 0);
+  } else {
+    char field[8];
+    int len = snprintf(field, sizeof(field), "u=%u%s",
+                       extpri.urgency, extpri.inc ? ", i" : "");
+    ret = nghttp2_submit_priority_update(
+        session_->session(),
+        NGHTTP2_FLAG_NONE,
+        id_,
+        reinterpret_cast<const uint8_t*>(field),
+        len);
+  }
+  CHECK_NE(ret, NGHTTP2_ERR_NOMEM);
+  if (ret == 0) {
+    statistics_.urgency = extpri.urgency;
+    statistics_.incremental = extpri.inc;
+    statistics_.priority_updates++;
+  }
+  return ret;
+}
+
+// Captures the priority nghttp2 currently holds for this stream, as set by
+// the request's priority header or a later PRIORITY_UPDATE frame.
+void Http2Stream::UpdatePriorityStatistics() {
+  nghttp2_extpri extpri;
+  if (session_->type() != NGHTTP2_SESSION_SERVER ||
+      nghttp2_session_get_extpri_stream_priority(
+          session_->session(), &extpri, id_) != 0) {
+    return;
+  }
+  if (extpri.urgency != statistics_.urgency ||
+      static_cast<uint64_t>(extpri.inc) != statistics_.incremental) {
+    statistics_.urgency = extpri.urgency;
+    statistics_.incremental = extpri.inc;
+    statistics_.priority_updates++;
+  }
+}
+
 // Closes the Http2Stream by submitting an RST_STREAM frame to the connected
 // peer.
 void Http2Stream::SubmitRstStream(const uint32_t code) {
@@ -2525,6 +3056,8 @@ int Http2Stream::DoWrite(WriteWrap* req_wrap,
       bufs[i]
     });
     IncrementAvailableOutboundLength(bufs[i].len);
+    if (last_file_write_ != nullptr)
+      last_file_write_->memory_after += bufs[i].len;
   }
   CHECK_NE(nghttp2_session_resume_data(
       session_->session(),
@@ -2624,13 +3157,25 @@ ssize_t Http2Stream::Provider::Stream::OnRead(nghttp2_session* handle,
 
   if (!stream->queue_.empty()) {
     Debug(session, "stream %d has pending outbound data", id);
-    amount = std::min(stream->available_outbound_length_, length);
+    const NgHttp2StreamWrite& head = stream->queue_.front();
+    if (head.is_file()) {
+      // File data goes out in frames of its own so that it can be sent with
+      // sendfile(), and is not counted as session memory.
+      amount = std::min(head.buf.len, length);
+      stream->available_outbound_length_ -= amount;
+    } else if (stream->queued_file_writes_ > 0) {
+      amount = std::min(stream->memory_before_file_, length);
+      stream->memory_before_file_ -= amount;
+      stream->DecrementAvailableOutboundLength(amount);
+    } else {
+      amount = std::min(stream->available_outbound_length_, length);
+      stream->DecrementAvailableOutboundLength(amount);
+    }
     Debug(session, "sending %d bytes for data frame on stream %d", amount, id);
     if (amount > 0) {
       // Just return the length, let Http2Session::OnSendData take care of
       // actually taking the buffers out of the queue.
       *flags |= NGHTTP2_DATA_FLAG_NO_COPY;
-      stream->DecrementAvailableOutboundLength(amount);
     }
   }
 
@@ -2732,6 +3277,63 @@ void Http2Session::SetLocalWindowSize(
   Debug(session, "set local window size to %d", window_size);
 }
 
+// Limit the number of bytes that are gathered into a single write to the
+// underlying stream. 0 means no limit.
+void Http2Session::SetSendBudget(const FunctionCallbackInfo<Value>& args) {
+  Http2Session* session;
+  ASSIGN_OR_RETURN_UNWRAP(&session, args.This());
+  CHECK(args[0]->IsNumber());
+  session->send_budget_ =
+      static_cast<size_t>(args[0].As<Number>()->Value());
+  Debug(session, "set send budget to %zu", session->send_budget_);
+}
+
+void Http2Session::RecordHistogram(Http2HistogramType type, int64_t value) {
+  if (histograms_[type])
+    histograms_[type]->Record(value);
+}
+
+// Start recording the distributions listed in Http2HistogramType. This is
+// opt-in because each histogram preallocates its buckets.
+void Http2Session::EnableHistograms(const FunctionCallbackInfo<Value>& args) {
+  Http2Session* session;
+  ASSIGN_OR_RETURN_UNWRAP(&session, args.This());
+  if (session->has_histograms())
+    return;
+  // Durations are recorded in nanoseconds with microsecond resolution, up
+  // to an hour.
+  Histogram::Options duration_options;
+  duration_options.lowest = 1000;
+  duration_options.highest = 3600 * static_cast<int64_t>(1e9);
+  duration_options.figures = 2;
+  Histogram::Options depth_options;
+  depth_options.highest = 1 << 16;
+  depth_options.figures = 2;
+  for (int n = 0; n < HTTP2_HISTOGRAM_COUNT; n++) {
+    session->histograms_[n] = std::make_shared<Histogram>(
+        n == HTTP2_HISTOGRAM_OUTGOING_QUEUE_DEPTH ? depth_options
+                                                  : duration_options);
+  }
+  Debug(session, "histograms enabled");
+}
+
+// Returns a histogram object sharing the given distribution, which can be
+// read at any time, or undefined if histograms are not enabled.
+void Http2Session::GetHistogram(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2Session* session;
+  ASSIGN_OR_RETURN_UNWRAP(&session, args.This());
+  CHECK(args[0]->IsUint32());
+  uint32_t type = args[0].As<Uint32>()->Value();
+  CHECK_LT(type, HTTP2_HISTOGRAM_COUNT);
+  if (!session->histograms_[type])
+    return;
+  BaseObjectPtr<HistogramBase> histogram =
+      HistogramBase::Create(env, session->histograms_[type]);
+  if (histogram)
+    args.GetReturnValue().Set(histogram->object());
+}
+
 // A TypedArray instance is shared between C++ and JS land to contain the
 // SETTINGS (either remote or local). RefreshSettings updates the current
 // values established for each of the settings so those can be read in JS land.
@@ -2816,18 +3418,27 @@ void Http2Session::Request(const FunctionCallbackInfo<Value>& args) {
   ASSIGN_OR_RETURN_UNWRAP(&session, args.This());
   Environment* env = session->env();
 
-  Local<Array> headers = args[0].As<Array>();
   int32_t options = args[1]->Int32Value(env->context()).ToChecked();
 
   Debug(session, "request submitted");
 
   int32_t ret = 0;
-  Http2Stream* stream =
-      session->Http2Session::SubmitRequest(
-          Http2Priority(env, args[2], args[3], args[4]),
-          Http2Headers(env, headers),
-          &ret,
-          static_cast<int>(options));
+  Http2Stream* stream;
+  if (args[0]->IsArray()) {
+    stream = session->Http2Session::SubmitRequest(
+        Http2Priority(env, args[2], args[3], args[4]),
+        Http2Headers(env, args[0].As<Array>()),
+        &ret,
+        static_cast<int>(options));
+  } else {
+    Http2HeaderSet* header_set;
+    ASSIGN_OR_RETURN_UNWRAP(&header_set, args[0]);
+    stream = session->Http2Session::SubmitRequest(
+        Http2Priority(env, args[2], args[3], args[4]),
+        header_set->headers(),
+        &ret,
+        static_cast<int>(options));
+  }
 
   if (ret <= 0 || stream == nullptr) {
     Debug(session, "could not submit request: %s", nghttp2_strerror(ret));
@@ -2915,13 +3526,21 @@ void Http2Stream::Respond(const FunctionCallbackInfo<Value>& args) {
   Http2Stream* stream;
   ASSIGN_OR_RETURN_UNWRAP(&stream, args.This());
 
-  Local<Array> headers = args[0].As<Array>();
   int32_t options = args[1]->Int32Value(env->context()).ToChecked();
 
-  args.GetReturnValue().Set(
-      stream->SubmitResponse(
-          Http2Headers(env, headers),
-          static_cast<int>(options)));
+  // The headers are either a [string, count] pair or an Http2HeaderSet.
+  if (args[0]->IsArray()) {
+    args.GetReturnValue().Set(
+        stream->SubmitResponse(
+            Http2Headers(env, args[0].As<Array>()),
+            static_cast<int>(options)));
+  } else {
+    Http2HeaderSet* header_set;
+    ASSIGN_OR_RETURN_UNWRAP(&header_set, args[0]);
+    args.GetReturnValue().Set(
+        stream->SubmitResponse(header_set->headers(),
+                               static_cast<int>(options)));
+  }
   Debug(stream, "response submitted");
 }
 
@@ -2943,10 +3562,59 @@ void Http2Stream::Trailers(const FunctionCallbackInfo<Value>& args) {
   Http2Stream* stream;
   ASSIGN_OR_RETURN_UNWRAP(&stream, args.This());
 
-  Local<Array> headers = args[0].As<Array>();
+  if (args[0]->IsArray()) {
+    args.GetReturnValue().Set(
+        stream->SubmitTrailers(Http2Headers(env, args[0].As<Array>())));
+  } else {
+    Http2HeaderSet* header_set;
+    ASSIGN_OR_RETURN_UNWRAP(&header_set, args[0]);
+    args.GetReturnValue().Set(
+        stream->SubmitTrailers(header_set->headers()));
+  }
+}
 
-  args.GetReturnValue().Set(
-      stream->SubmitTrailers(Http2Headers(env, headers)));
+// stream.sendFile(req, fd, offset, length) queues `length` bytes of the file
+// `fd`, starting at `offset`, to be sent with sendfile() as the payload of
+// DATA frames. `req` completes once all of it has been written. Returns
+// UV_ENOTSUP if the session is not directly on top of a TCP or pipe socket,
+// in which case the file has to be written the regular way.
+void Http2Stream::SendFile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2Stream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.This());
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsInt32());
+  CHECK(args[2]->IsNumber());
+  CHECK(args[3]->IsNumber());
+  const int fd = args[1].As<Int32>()->Value();
+  const int64_t offset = args[2]->IntegerValue(env->context()).FromJust();
+  const int64_t length = args[3]->IntegerValue(env->context()).FromJust();
+
+  if (fd < 0 || offset < 0 || length <= 0)
+    return args.GetReturnValue().Set(UV_EINVAL);
+  if (!stream->session() || !stream->session()->CanSendFile())
+    return args.GetReturnValue().Set(UV_ENOTSUP);
+
+  Http2Scope h2scope(stream);
+  if (!stream->is_writable() || stream->is_destroyed())
+    return args.GetReturnValue().Set(UV_EOF);
+
+  WriteWrap* req_wrap = stream->CreateWriteWrap(args[0].As<Object>());
+  stream->queue_.emplace(NgHttp2StreamWrite {
+    BaseObjectPtr<AsyncWrap>(req_wrap->GetAsyncWrap()),
+    fd,
+    offset,
+    static_cast<size_t>(length)
+  });
+  if (stream->queued_file_writes_++ == 0)
+    stream->memory_before_file_ = stream->available_outbound_length_;
+  stream->last_file_write_ = &stream->queue_.back();
+  stream->available_outbound_length_ += length;
+  CHECK_NE(nghttp2_session_resume_data(
+      stream->session()->session(),
+      stream->id()), NGHTTP2_ERR_NOMEM);
+  args.GetReturnValue().Set(0);
 }
 
 // Grab the numeric id of the Http2Stream
@@ -3002,6 +3670,38 @@ void Http2Stream::Priority(const FunctionCallbackInfo<Value>& args) {
   Debug(stream, "priority submitted");
 }
 
+// Set the RFC 9218 extensible priority of the stream. Returns 0 or an
+// nghttp2 error code, e.g. when the session has not enabled extensible
+// priorities through SETTINGS_NO_RFC7540_PRIORITIES.
+void Http2Stream::SetPriority(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2Stream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.This());
+
+  uint32_t urgency;
+  if (!args[0]->Uint32Value(env->context()).To(&urgency)) return;
+  nghttp2_extpri extpri;
+  extpri.urgency = std::min<uint32_t>(urgency, NGHTTP2_EXTPRI_URGENCY_LOW);
+  extpri.inc = args[1]->IsTrue() ? 1 : 0;
+  args.GetReturnValue().Set(
+      stream->SubmitExtensiblePriority(extpri, args[2]->IsTrue()));
+}
+
+// Returns the RFC 9218 priority of the stream as [urgency, incremental].
+void Http2Stream::GetPriority(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2Stream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.This());
+
+  stream->UpdatePriorityStatistics();
+  Local<Value> values[] = {
+    Integer::NewFromUnsigned(env->isolate(), stream->statistics_.urgency),
+    Boolean::New(env->isolate(), stream->statistics_.incremental != 0)
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
 // A TypedArray shared by C++ and JS land is used to communicate state
 // information about the Http2Stream. This updates the values in that
 // TypedArray so that the state can be read by JS.
@@ -3367,11 +4067,14 @@ void Initialize(Local<Object> target,
   SetProtoMethod(isolate, stream, "id", Http2Stream::GetID);
   SetProtoMethod(isolate, stream, "destroy", Http2Stream::Destroy);
   SetProtoMethod(isolate, stream, "priority", Http2Stream::Priority);
+  SetProtoMethod(isolate, stream, "setPriority", Http2Stream::SetPriority);
+  SetProtoMethod(isolate, stream, "getPriority", Http2Stream::GetPriority);
   SetProtoMethod(isolate, stream, "pushPromise", Http2Stream::PushPromise);
   SetProtoMethod(isolate, stream, "info", Http2Stream::Info);
   SetProtoMethod(isolate, stream, "trailers", Http2Stream::Trailers);
   SetProtoMethod(isolate, stream, "respond", Http2Stream::Respond);
   SetProtoMethod(isolate, stream, "rstStream", Http2Stream::RstStream);
+  SetProtoMethod(isolate, stream, "sendFile", Http2Stream::SendFile);
   SetProtoMethod(isolate, stream, "refreshState", Http2Stream::RefreshState);
   stream->Inherit(AsyncWrap::GetConstructorTemplate(env));
   StreamBase::AddMethods(env, stream);
@@ -3398,6 +4101,12 @@ void Initialize(Local<Object> target,
       isolate, session, "setNextStreamID", Http2Session::SetNextStreamID);
   SetProtoMethod(
       isolate, session, "setLocalWindowSize", Http2Session::SetLocalWindowSize);
+  SetProtoMethod(
+      isolate, session, "setSendBudget", Http2Session::SetSendBudget);
+  SetProtoMethod(
+      isolate, session, "enableHistograms", Http2Session::EnableHistograms);
+  SetProtoMethod(
+      isolate, session, "getHistogram", Http2Session::GetHistogram);
   SetProtoMethod(
       isolate, session, "updateChunksSent", Http2Session::UpdateChunksSent);
   SetProtoMethod(isolate, session, "refreshState", Http2Session::RefreshState);
@@ -3414,6 +4123,12 @@ void Initialize(Local<Object> target,
                                     false>);
   SetConstructorFunction(context, target, "Http2Session", session);
 
+  Local<FunctionTemplate> header_set =
+      NewFunctionTemplate(isolate, Http2HeaderSet::New);
+  header_set->InstanceTemplate()->SetInternalFieldCount(
+      Http2HeaderSet::kInternalFieldCount);
+  SetConstructorFunction(context, target, "Http2HeaderSet", header_set);
+
   Local<Object> constants = Object::New(isolate);
 
   // This does allocate one more slot than needed but it's not used.
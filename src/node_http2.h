@@ -10,6 +10,7 @@
 
 #include "env.h"
 #include "aliased_struct.h"
+#include "histogram.h"
 #include "node_http2_state.h"
 #include "node_http_common.h"
 #include "node_mem.h"
@@ -97,6 +98,20 @@ enum SessionType {
   NGHTTP2_SESSION_CLIENT
 };
 
+// Distributions that an Http2Session can record once histograms have been
+// enabled. Durations are in nanoseconds.
+enum Http2HistogramType {
+  // Stream start until the first DATA byte was received (client) or sent
+  // (server)
+  HTTP2_HISTOGRAM_TIME_TO_FIRST_BYTE,
+  HTTP2_HISTOGRAM_STREAM_DURATION,
+  // Time a stream with pending data spent waiting for a WINDOW_UPDATE
+  HTTP2_HISTOGRAM_FLOW_CONTROL_STALL,
+  // Number of chunks gathered for a single write to the underlying stream
+  HTTP2_HISTOGRAM_OUTGOING_QUEUE_DEPTH,
+  HTTP2_HISTOGRAM_COUNT
+};
+
 template <typename T, void(*fn)(T*)>
 struct Nghttp2Deleter {
   void operator()(T* ptr) const noexcept { fn(ptr); }
@@ -147,10 +162,27 @@ using Http2RcBufferPointer = NgRcBufPointer<Http2RcBufferPointerTraits>;
 struct NgHttp2StreamWrite : public MemoryRetainer {
   BaseObjectPtr<AsyncWrap> req_wrap;
   uv_buf_t buf;
+  // For file writes, |buf.len| bytes starting at |file_offset| in |fd| are
+  // sent with sendfile() and |buf.base| is unused.
+  int fd = -1;
+  int64_t file_offset = 0;
+  // For file writes queued on an Http2Stream: the number of in-memory bytes
+  // queued after this write and before the next file write, if any.
+  size_t memory_after = 0;
 
   inline explicit NgHttp2StreamWrite(uv_buf_t buf_) : buf(buf_) {}
   inline NgHttp2StreamWrite(BaseObjectPtr<AsyncWrap> req_wrap, uv_buf_t buf_) :
       req_wrap(std::move(req_wrap)), buf(buf_) {}
+  inline NgHttp2StreamWrite(BaseObjectPtr<AsyncWrap> req_wrap,
+                            int fd_,
+                            int64_t offset,
+                            size_t length)
+      : req_wrap(std::move(req_wrap)),
+        buf(uv_buf_init(nullptr, length)),
+        fd(fd_),
+        file_offset(offset) {}
+
+  bool is_file() const { return fd >= 0; }
 
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(NgHttp2StreamWrite)
@@ -234,6 +266,14 @@ class Http2Options {
     return max_session_memory_;
   }
 
+  void set_max_auto_window_size(uint32_t max) {
+    max_auto_window_size_ = max;
+  }
+
+  uint32_t max_auto_window_size() const {
+    return max_auto_window_size_;
+  }
+
  private:
   Nghttp2OptionPointer options_;
   uint64_t max_session_memory_ = kDefaultMaxSessionMemory;
@@ -241,6 +281,7 @@ class Http2Options {
   PaddingStrategy padding_strategy_ = PADDING_STRATEGY_NONE;
   size_t max_outstanding_pings_ = kDefaultMaxPings;
   size_t max_outstanding_settings_ = kDefaultMaxSettings;
+  uint32_t max_auto_window_size_ = 0;
 };
 
 struct Http2Priority : public nghttp2_priority_spec {
@@ -309,6 +350,15 @@ class Http2Stream : public AsyncWrap,
   // Submit a PRIORITY frame for this stream
   int SubmitPriority(const Http2Priority& priority, bool silent = false);
 
+  // Change the RFC 9218 extensible priority of this stream
+  int SubmitExtensiblePriority(const nghttp2_extpri& extpri,
+                               bool ignore_client_signal = false);
+  void UpdatePriorityStatistics();
+
+  // Track time spent blocked on the peer's flow control window
+  void MaybeStartFlowControlStall();
+  void MaybeEndFlowControlStall();
+
   // Submits an RST_STREAM frame using the given code
   void SubmitRstStream(const uint32_t code);
 
@@ -444,12 +494,15 @@ class Http2Stream : public AsyncWrap,
   static void GetID(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Destroy(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Priority(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetPriority(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetPriority(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void PushPromise(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void RefreshState(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Info(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Trailers(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Respond(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void RstStream(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SendFile(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   class Provider;
 
@@ -462,6 +515,9 @@ class Http2Stream : public AsyncWrap,
     uint64_t sent_bytes;
     uint64_t received_bytes;
     uint64_t id;
+    uint64_t urgency;           // RFC 9218 urgency, 0 (highest) to 7
+    uint64_t incremental;
+    uint64_t priority_updates;  // Number of priority changes
   };
 
   Statistics statistics_ = {};
@@ -501,6 +557,18 @@ class Http2Stream : public AsyncWrap,
   std::queue<NgHttp2StreamWrite> queue_;
   size_t available_outbound_length_ = 0;
 
+  // File writes in queue_ are sent in DATA frames of their own, so the
+  // number of in-memory bytes at the head of the queue, before the first
+  // file write, is tracked separately. File data does not count towards the
+  // session memory.
+  size_t queued_file_writes_ = 0;
+  size_t memory_before_file_ = 0;
+  NgHttp2StreamWrite* last_file_write_ = nullptr;
+
+  // Set while the stream has data queued but no flow control window to
+  // send it with.
+  uint64_t flow_control_stall_start_ = 0;
+
   Http2StreamListener stream_listener_;
 
   friend class Http2Session;
@@ -582,6 +650,10 @@ class Http2Session : public AsyncWrap,
     return static_cast<StreamBase*>(stream_);
   }
 
+  // Whether file data can be sent with sendfile(), which is the case when
+  // the session runs directly on top of a TCP or pipe socket.
+  bool CanSendFile();
+
   void Close(uint32_t code = NGHTTP2_NO_ERROR,
              bool socket_closed = false);
 
@@ -658,6 +730,10 @@ class Http2Session : public AsyncWrap,
   // Schedule a write if nghttp2 indicates it wants to write to the socket.
   void MaybeScheduleWrite();
 
+  bool has_histograms() const { return histograms_[0] != nullptr; }
+  // Records a value if histograms have been enabled for this session.
+  void RecordHistogram(Http2HistogramType type, int64_t value);
+
   // Stop reading if nghttp2 doesn't want to anymore.
   void MaybeStopReading();
 
@@ -717,6 +793,10 @@ class Http2Session : public AsyncWrap,
   static void SetNextStreamID(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetLocalWindowSize(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetSendBudget(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableHistograms(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetHistogram(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Goaway(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void UpdateChunksSent(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void RefreshState(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -777,8 +857,11 @@ class Http2Session : public AsyncWrap,
     uint64_t data_received;
     uint32_t frame_count;
     uint32_t frame_sent;
+    uint32_t priority_updates;  // PRIORITY_UPDATE frames received
     int32_t stream_count;
     size_t max_concurrent_streams;
+    // The receive window chosen by the flow control auto-tuning, or 0.
+    uint32_t auto_window_size;
     double stream_average_duration;
     SessionType session_type;
   };
@@ -801,8 +884,19 @@ class Http2Session : public AsyncWrap,
   void HandleGoawayFrame(const nghttp2_frame* frame);
   void HandleHeadersFrame(const nghttp2_frame* frame);
   void HandlePriorityFrame(const nghttp2_frame* frame);
+  void HandlePriorityUpdateFrame(const nghttp2_frame* frame);
+  void HandleWindowUpdateFrame(const nghttp2_frame* frame);
   void HandleSettingsFrame(const nghttp2_frame* frame);
   void HandlePingFrame(const nghttp2_frame* frame);
+
+  // Flow control auto-tuning. Like gRPC, the bandwidth-delay product of the
+  // connection is estimated from the DATA received during the round trip
+  // of a PING, and the receive windows of the connection and of the streams
+  // are grown to twice that while the estimate keeps up with the window.
+  void SampleBdp(size_t length);
+  // Returns false if |payload| is not that of the outstanding BDP ping.
+  bool OnBdpPingAck(const uint8_t* payload);
+  void GrowAutoWindow(uint32_t window);
   void HandleAltSvcFrame(const nghttp2_frame* frame);
   void HandleOriginFrame(const nghttp2_frame* frame);
 
@@ -929,12 +1023,38 @@ class Http2Session : public AsyncWrap,
   size_t max_outstanding_settings_ = kDefaultMaxSettings;
   std::queue<BaseObjectPtr<Http2Settings>> outstanding_settings_;
 
+  // State of the flow control auto-tuning, which is enabled when
+  // max_auto_window_size_ is not 0.
+  uint32_t max_auto_window_size_ = 0;
+  uint32_t auto_window_size_ = 0;
+  bool bdp_ping_outstanding_ = false;
+  uint32_t bdp_ping_count_ = 0;
+  uint8_t bdp_ping_payload_[8];
+  uint64_t bdp_ping_sent_at_ = 0;
+  uint64_t bdp_sample_ = 0;
+  double bdp_rtt_ = 0;
+  double bdp_max_bandwidth_ = 0;
+
   struct custom_settings_state local_custom_settings_;
   struct custom_settings_state remote_custom_settings_;
 
   std::vector<NgHttp2StreamWrite> outgoing_buffers_;
   std::vector<uint8_t> outgoing_storage_;
   size_t outgoing_length_ = 0;
+  // Set when outgoing_buffers_ contains file data. The buffers are then
+  // written one run at a time, with sendfile() for the file ranges, and
+  // outgoing_index_ is the next one to write.
+  bool has_outgoing_file_ = false;
+  bool sending_file_data_ = false;
+  size_t outgoing_index_ = 0;
+  uv_fs_t file_fallback_req_;
+  std::unique_ptr<v8::BackingStore> file_fallback_store_;
+  BaseObjectPtr<Http2Session> file_fallback_keepalive_;
+  // Upper bound on the number of bytes gathered from nghttp2 for a single
+  // write to the underlying stream, or 0 for no limit.
+  size_t send_budget_ = 0;
+  // Only allocated once enableHistograms() has been called.
+  std::shared_ptr<Histogram> histograms_[HTTP2_HISTOGRAM_COUNT];
   std::vector<int32_t> pending_rst_streams_;
   // Count streams that have been rejected while being opened. Exceeding a fixed
   // limit will result in the session being destroyed, as an indication of a
@@ -951,6 +1071,13 @@ class Http2Session : public AsyncWrap,
   void CopyDataIntoOutgoing(const uint8_t* src, size_t src_length);
   void ClearOutgoing(int status);
 
+  class SendfileWork;
+  void ContinueOutgoing();
+  void FinishOutgoing(int status);
+  void AfterSendfile(ssize_t result);
+  void ReadFileFallback();
+  static void AfterFileFallbackRead(uv_fs_t* req);
+
   friend class Http2Scope;
   friend class Http2StreamListener;
 };
@@ -1074,6 +1201,28 @@ class Origins {
   std::unique_ptr<v8::BackingStore> bs_;
 };
 
+// A header list that has been converted from its JS representation once, so
+// that it can be submitted for any number of streams without repeating the
+// conversion. HPACK encoding itself still happens per session, as it depends
+// on the state of that session's dynamic table.
+class Http2HeaderSet final : public BaseObject {
+ public:
+  Http2HeaderSet(Environment* env,
+                 v8::Local<v8::Object> object,
+                 v8::Local<v8::Array> headers);
+
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  const Http2Headers& headers() const { return headers_; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(Http2HeaderSet)
+  SET_SELF_SIZE(Http2HeaderSet)
+
+ private:
+  Http2Headers headers_;
+};
+
 #define HTTP2_HIDDEN_CONSTANTS(V)                                              \
   V(NGHTTP2_HCAT_REQUEST)                                                      \
   V(NGHTTP2_HCAT_RESPONSE)                                                     \
@@ -1087,6 +1236,10 @@ class Origins {
   V(NGHTTP2_ERR_STREAM_CLOSED)                                                 \
   V(NGHTTP2_ERR_NOMEM)                                                         \
   V(STREAM_OPTION_EMPTY_PAYLOAD)                                               \
+  V(HTTP2_HISTOGRAM_TIME_TO_FIRST_BYTE)                                        \
+  V(HTTP2_HISTOGRAM_STREAM_DURATION)                                           \
+  V(HTTP2_HISTOGRAM_FLOW_CONTROL_STALL)                                        \
+  V(HTTP2_HISTOGRAM_OUTGOING_QUEUE_DEPTH)                                      \
   V(STREAM_OPTION_GET_TRAILERS)
 
 #define HTTP2_ERROR_CODES(V)                                                   \
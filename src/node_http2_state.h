@@ -58,6 +58,7 @@ namespace http2 {
     IDX_OPTIONS_MAX_OUTSTANDING_SETTINGS,
     IDX_OPTIONS_MAX_SESSION_MEMORY,
     IDX_OPTIONS_MAX_SETTINGS,
+    IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE,
     IDX_OPTIONS_FLAGS
   };
 
@@ -430,7 +430,15 @@ class NgRcBufPointer : public MemoryRetainer {
       }
 
       if (ptr.IsInternalizable() && len < 64) {
-        v8::MaybeLocal<v8::String> ret = GetInternalizedString(env, ptr);
+        v8::MaybeLocal<v8::String> ret;
+        // Allocators that keep a cache of recently seen header strings get
+        // to serve them without going through the V8 string table.
+        if constexpr (requires { allocator->GetCachedHeaderString(
+                                     ptr.data(), len); }) {
+          ret = allocator->GetCachedHeaderString(ptr.data(), len);
+        } else {
+          ret = GetInternalizedString(env, ptr);
+        }
         ptr.reset();
         return ret;
       }
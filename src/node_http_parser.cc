@@ -28,11 +28,15 @@
 #include "llhttp.h"
 #include "memory_tracker-inl.h"
 #include "node_external_reference.h"
+#include "node_metrics.h"
+#include "node_probes.h"
 #include "stream_base-inl.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cstdlib>  // free()
 #include <cstring>  // strdup(), strchr()
+#include <string_view>
 
 
 // This is a binding to llhttp (https://github.com/nodejs/llhttp)
@@ -51,6 +55,9 @@ namespace node {
 namespace http_parser {  // NOLINT(build/namespaces)
 
 using v8::Array;
+using v8::ArrayBuffer;
+using v8::ArrayBufferView;
+using v8::BackingStore;
 using v8::Boolean;
 using v8::Context;
 using v8::EscapableHandleScope;
@@ -58,17 +65,21 @@ using v8::Exception;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
+using v8::NewStringType;
 using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
+using v8::Uint8Array;
 using v8::Uint32;
+using v8::Uint32Array;
 using v8::Undefined;
 using v8::Value;
 
@@ -79,6 +90,7 @@ const uint32_t kOnBody = 3;
 const uint32_t kOnMessageComplete = 4;
 const uint32_t kOnExecute = 5;
 const uint32_t kOnTimeout = 6;
+const uint32_t kOnMessages = 7;
 // Any more fields than this will be flushed into JS
 const size_t kMaxHeaderFieldsCount = 32;
 // Maximum size of chunk extensions
@@ -114,11 +126,92 @@ class BindingData : public BaseObject {
   std::vector<char> parser_buffer;
   bool parser_buffer_in_use = false;
 
+  // Direct-mapped cache of internalized strings for header names and a fixed
+  // set of common header values. Entries are matched byte-for-byte so that
+  // raw header casing is preserved. Other values are never cached: they may
+  // carry credentials, and arbitrary peer input should neither be kept
+  // alive by the cache nor be able to evict the common entries.
+  static constexpr size_t kHeaderCacheSize = 512;
+  static constexpr size_t kMaxCachedHeaderLength = 32;
+
+  struct HeaderCacheEntry {
+    uint8_t length = 0;
+    char data[kMaxCachedHeaderLength];
+    Global<String> string;
+  };
+
+  Local<String> GetHeaderString(Isolate* isolate,
+                                const char* str,
+                                size_t size) {
+    if (size == 0 || size > kMaxCachedHeaderLength)
+      return OneByteString(isolate, str, size);
+
+    // FNV-1a over the raw bytes.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+      hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+    HeaderCacheEntry& entry = header_cache_[hash % kHeaderCacheSize];
+
+    if (entry.length == size && memcmp(entry.data, str, size) == 0)
+      return entry.string.Get(isolate);
+
+    Local<String> string =
+        String::NewFromOneByte(isolate,
+                               reinterpret_cast<const uint8_t*>(str),
+                               NewStringType::kInternalized,
+                               static_cast<int>(size))
+            .ToLocalChecked();
+    entry.length = static_cast<uint8_t>(size);
+    memcpy(entry.data, str, size);
+    entry.string.Reset(isolate, string);
+    return string;
+  }
+
+  Local<String> GetHeaderValueString(Isolate* isolate,
+                                     const char* str,
+                                     size_t size) {
+    static constexpr std::string_view kCommonValues[] = {
+        "*/*",
+        "0",
+        "1",
+        "Upgrade",
+        "XMLHttpRequest",
+        "application/json",
+        "br",
+        "bytes",
+        "chunked",
+        "close",
+        "deflate",
+        "gzip",
+        "gzip, deflate",
+        "gzip, deflate, br",
+        "gzip, deflate, br, zstd",
+        "identity",
+        "keep-alive",
+        "max-age=0",
+        "no-cache",
+        "text/html",
+        "text/html; charset=utf-8",
+        "text/plain",
+        "websocket",
+    };
+    const std::string_view value(str, size);
+    for (std::string_view common : kCommonValues) {
+      if (value == common) return GetHeaderString(isolate, str, size);
+    }
+    return OneByteString(isolate, str, size);
+  }
+
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackField("parser_buffer", parser_buffer);
+    tracker->TrackFieldWithSize("header_cache",
+                                sizeof(header_cache_));
   }
   SET_SELF_SIZE(BindingData)
   SET_MEMORY_INFO_NAME(BindingData)
+
+ private:
+  HeaderCacheEntry header_cache_[kHeaderCacheSize];
 };
 
 // helper class for the Parser
@@ -196,6 +289,21 @@ struct StringPtr {
   }
 
 
+  Local<String> ToCachedString(Environment* env, BindingData* binding_data) {
+    return binding_data->GetHeaderString(env->isolate(), str_, size_);
+  }
+
+
+  // Values are only cached if they are one of a few common ones.
+  Local<String> ToTrimmedCachedValueString(Environment* env,
+                                           BindingData* binding_data) {
+    while (size_ > 0 && IsOWS(str_[size_ - 1])) {
+      size_--;
+    }
+    return binding_data->GetHeaderValueString(env->isolate(), str_, size_);
+  }
+
+
   const char* str_;
   bool on_heap_;
   size_t size_;
@@ -273,6 +381,9 @@ class Parser : public AsyncWrap, public StreamListener {
       connectionsList_->PopActive(this);
     }
 
+    if (NODE_PROBE_ENABLED(http__message__start))
+      NODE_PROBE2(http__message__start, this, static_cast<int>(parser_.type));
+
     num_fields_ = num_values_ = 0;
     headers_completed_ = false;
     chunk_extensions_nread_ = 0;
@@ -285,6 +396,26 @@ class Parser : public AsyncWrap, public StreamListener {
       connectionsList_->PushActive(this);
     }
 
+    if (batch_mode_ && parser_.type == HTTP_REQUEST) {
+      Isolate* isolate = env()->isolate();
+      pending_message_ = Array::New(isolate, A_BATCH_MAX);
+      for (uint32_t i = 0; i < A_BATCH_MAX; i++) {
+        if (pending_message_->Set(env()->context(), i, Undefined(isolate))
+                .IsNothing()) {
+          return -1;
+        }
+      }
+      if (batch_.IsEmpty())
+        batch_ = Array::New(isolate);
+      batching_message_ = true;
+      return 0;
+    }
+
+    return EmitMessageBegin();
+  }
+
+
+  int EmitMessageBegin() {
     Local<Value> cb = object()->Get(env()->context(), kOnMessageBegin)
                               .ToLocalChecked();
     if (cb->IsFunction()) {
@@ -375,21 +506,28 @@ class Parser : public AsyncWrap, public StreamListener {
     headers_completed_ = true;
     header_nread_ = 0;
 
-    // Arguments for the on-headers-complete javascript callback. This
-    // list needs to be kept in sync with the actual argument list for
-    // `parserOnHeadersComplete` in lib/_http_common.js.
-    enum on_headers_complete_arg_index {
-      A_VERSION_MAJOR = 0,
-      A_VERSION_MINOR,
-      A_HEADERS,
-      A_METHOD,
-      A_URL,
-      A_STATUS_CODE,
-      A_STATUS_MESSAGE,
-      A_UPGRADE,
-      A_SHOULD_KEEP_ALIVE,
-      A_MAX
-    };
+    if (NODE_PROBE_ENABLED(http__headers__complete)) {
+      std::string url(url_.str_ != nullptr ? url_.str_ : "", url_.size_);
+      NODE_PROBE3(http__headers__complete,
+                  this,
+                  parser_.type == HTTP_REQUEST
+                      ? static_cast<int>(parser_.method)
+                      : static_cast<int>(parser_.status_code),
+                  url.c_str());
+    }
+
+    if (batching_message_) {
+      // Upgrades need the return value of onHeadersComplete, so deliver
+      // everything parsed so far and handle this message the regular way.
+      if (parser_.upgrade) {
+        if (!EmitBatch() || !EmitPendingMessageStart()) {
+          got_exception_ = true;
+          return -1;
+        }
+      } else {
+        return BatchHeadersComplete();
+      }
+    }
 
     Local<Value> argv[A_MAX];
     Local<Object> obj = object();
@@ -441,6 +579,8 @@ class Parser : public AsyncWrap, public StreamListener {
 
     argv[A_UPGRADE] = Boolean::New(env()->isolate(), parser_.upgrade);
 
+    StartBodyAccumulation();
+
     MaybeLocal<Value> head_response;
     {
       InternalCallbackScope callback_scope(
@@ -468,15 +608,55 @@ class Parser : public AsyncWrap, public StreamListener {
       return 0;
 
     Environment* env = this->env();
+
+    if (batching_message_) {
+      Local<Value> body;
+      if (!pending_message_->Get(env->context(), A_BATCH_BODY).ToLocal(&body))
+        return -1;
+      if (body->IsUndefined()) {
+        body = Array::New(env->isolate());
+        if (pending_message_->Set(env->context(), A_BATCH_BODY, body)
+                .IsNothing()) {
+          return -1;
+        }
+      }
+      Local<Array> chunks = body.As<Array>();
+      if (chunks->Set(env->context(),
+                      chunks->Length(),
+                      Buffer::Copy(env, at, length).ToLocalChecked())
+              .IsNothing()) {
+        return -1;
+      }
+      return 0;
+    }
+
     HandleScope handle_scope(env->isolate());
 
-    Local<Value> cb = object()->Get(env->context(), kOnBody).ToLocalChecked();
+    if (accumulating_body_) {
+      if (body_length_ <= body_limit_ &&
+          length <= body_limit_ - body_length_) {
+        AppendBody(at, length);
+        return 0;
+      }
+      // Over the limit: hand out what was collected so far and stream the
+      // rest of the message through onBody.
+      accumulating_body_ = false;
+      if (body_length_ > 0) {
+        int rv = EmitBody(TakeBody());
+        if (rv != 0) return rv;
+      }
+    }
+
+    return EmitBody(Buffer::Copy(env, at, length).ToLocalChecked());
+  }
+
+
+  int EmitBody(Local<Value> buffer) {
+    Local<Value> cb = object()->Get(env()->context(), kOnBody).ToLocalChecked();
 
     if (!cb->IsFunction())
       return 0;
 
-    Local<Value> buffer = Buffer::Copy(env, at, length).ToLocalChecked();
-
     MaybeLocal<Value> r = MakeCallback(cb.As<Function>(), 1, &buffer);
 
     if (r.IsEmpty()) {
@@ -492,6 +672,10 @@ class Parser : public AsyncWrap, public StreamListener {
   int on_message_complete() {
     HandleScope scope(env()->isolate());
 
+    if (NODE_PROBE_ENABLED(http__message__done))
+      NODE_PROBE1(http__message__done, this);
+    metrics::runtime().http_messages->Increment();
+
     // Important: Pop from the lists BEFORE resetting the last_message_start_
     // otherwise std::set.erase will fail.
     if (connectionsList_ != nullptr) {
@@ -505,6 +689,9 @@ class Parser : public AsyncWrap, public StreamListener {
       connectionsList_->Push(this);
     }
 
+    if (batching_message_)
+      return BatchMessageComplete();
+
     if (num_fields_)
       Flush();  // Flush trailing HTTP headers.
 
@@ -512,14 +699,26 @@ class Parser : public AsyncWrap, public StreamListener {
     Local<Value> cb = obj->Get(env()->context(),
                                kOnMessageComplete).ToLocalChecked();
 
-    if (!cb->IsFunction())
+    if (!cb->IsFunction()) {
+      ResetBody();
       return 0;
+    }
+
+    // With body accumulation, the complete body is passed as the only
+    // argument, or undefined if the message had none.
+    Local<Value> body = Undefined(env()->isolate());
+    int argc = 0;
+    if (accumulating_body_) {
+      if (body_length_ > 0) body = TakeBody();
+      argc = 1;
+      ResetBody();
+    }
 
     MaybeLocal<Value> r;
     {
       InternalCallbackScope callback_scope(
           this, InternalCallbackScope::kSkipTaskQueues);
-      r = cb.As<Function>()->Call(env()->context(), object(), 0, nullptr);
+      r = cb.As<Function>()->Call(env()->context(), object(), argc, &body);
       if (r.IsEmpty()) callback_scope.MarkAsFailed();
     }
 
@@ -756,6 +955,53 @@ class Parser : public AsyncWrap, public StreamListener {
     args.GetReturnValue().Set(duration);
   }
 
+  // parser.setPackedHeaders(data, table) enables packed header delivery:
+  // onHeaders/onHeadersComplete receive the number of headers instead of an
+  // array of strings, with the raw bytes in `data` (a Uint8Array) and
+  // [nameOffset, nameLength, valueOffset, valueLength] for each header in
+  // `table` (a Uint32Array). Both may be shared between parsers. Passing no
+  // arguments restores the default behavior.
+  static void SetPackedHeaders(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.This());
+
+    if (args[0]->IsUndefined()) {
+      parser->packed_data_store_.reset();
+      parser->packed_table_store_.reset();
+      return;
+    }
+
+    CHECK(args[0]->IsUint8Array());
+    CHECK(args[1]->IsUint32Array());
+    Local<Uint8Array> data = args[0].As<Uint8Array>();
+    Local<Uint32Array> table = args[1].As<Uint32Array>();
+    parser->packed_data_store_ = data->Buffer()->GetBackingStore();
+    parser->packed_data_offset_ = data->ByteOffset();
+    parser->packed_data_length_ = data->ByteLength();
+    parser->packed_table_store_ = table->Buffer()->GetBackingStore();
+    parser->packed_table_offset_ = table->ByteOffset();
+    parser->packed_table_length_ = table->Length();
+  }
+
+  // parser.setBatchMode(enabled)
+  static void SetBatchMode(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.This());
+    parser->batch_mode_ = args[0]->IsTrue();
+  }
+
+  // setBodyAccumulation(limit) makes the parser collect the body of each
+  // message of up to |limit| bytes into a single Buffer, which is passed to
+  // onMessageComplete instead of emitting onBody per chunk. Chunked bodies
+  // arrive decoded, so they end up contiguous as well. Larger bodies are
+  // streamed through onBody as usual. A limit of 0 turns it off.
+  static void SetBodyAccumulation(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.This());
+    CHECK(args[0]->IsNumber());
+    parser->body_limit_ = static_cast<size_t>(args[0].As<Number>()->Value());
+  }
+
   static void HeadersCompleted(const FunctionCallbackInfo<Value>& args) {
     Parser* parser;
     ASSIGN_OR_RETURN_UNWRAP(&parser, args.This());
@@ -859,6 +1105,9 @@ class Parser : public AsyncWrap, public StreamListener {
       llhttp_pause(&parser_);
     }
 
+    if (!got_exception_ && !FinishBatch())
+      got_exception_ = true;
+
     current_buffer_len_ = 0;
     current_buffer_data_ = nullptr;
 
@@ -905,13 +1154,52 @@ class Parser : public AsyncWrap, public StreamListener {
     return scope.Escape(nread_obj);
   }
 
-  Local<Array> CreateHeaders() {
+  // Copy the header names and (trimmed) values into the buffer configured
+  // through setPackedHeaders() and record an [offset, length] pair for each
+  // of them in the offset table, in the same name/value order that
+  // CreateHeaders() uses. Returns false if the buffer is too small, in which
+  // case the caller falls back to creating strings.
+  bool PackHeaders() {
+    char* data = static_cast<char*>(packed_data_store_->Data()) +
+                 packed_data_offset_;
+    uint32_t* table = reinterpret_cast<uint32_t*>(
+        static_cast<char*>(packed_table_store_->Data()) +
+        packed_table_offset_);
+    size_t used = 0;
+
+    if (packed_table_length_ < num_values_ * 4) return false;
+
+    for (size_t i = 0; i < num_values_; ++i) {
+      StringPtr* parts[] = {&fields_[i], &values_[i]};
+      for (size_t j = 0; j < arraysize(parts); ++j) {
+        StringPtr* str = parts[j];
+        if (j == 1) {
+          while (str->size_ > 0 && IsOWS(str->str_[str->size_ - 1]))
+            str->size_--;
+        }
+        if (str->size_ > packed_data_length_ - used) return false;
+        if (str->size_ > 0) memcpy(data + used, str->str_, str->size_);
+        table[i * 4 + j * 2] = static_cast<uint32_t>(used);
+        table[i * 4 + j * 2 + 1] = static_cast<uint32_t>(str->size_);
+        used += str->size_;
+      }
+    }
+    return true;
+  }
+
+  Local<Value> CreateHeaders() {
+    // In packed mode the headers are passed as a count; the data itself lives
+    // in the shared buffer and is only valid until the callback returns.
+    if (packed_data_store_ && !batching_message_ && PackHeaders())
+      return Integer::NewFromUnsigned(env()->isolate(), num_values_);
+
     // There could be extra entries but the max size should be fixed
     Local<Value> headers_v[kMaxHeaderFieldsCount * 2];
 
     for (size_t i = 0; i < num_values_; ++i) {
-      headers_v[i * 2] = fields_[i].ToString(env());
-      headers_v[i * 2 + 1] = values_[i].ToTrimmedString(env());
+      headers_v[i * 2] = fields_[i].ToCachedString(env(), binding_data_.get());
+      headers_v[i * 2 + 1] =
+          values_[i].ToTrimmedCachedValueString(env(), binding_data_.get());
     }
 
     return Array::New(env()->isolate(), headers_v, num_values_ * 2);
@@ -920,6 +1208,14 @@ class Parser : public AsyncWrap, public StreamListener {
 
   // spill headers and request path to JS land
   void Flush() {
+    if (batching_message_) {
+      // Keep the headers with the batched message; the URL is still
+      // complete in url_ and is picked up in BatchHeadersComplete().
+      if (!AppendPendingHeaders(A_HEADERS))
+        got_exception_ = true;
+      return;
+    }
+
     HandleScope scope(env()->isolate());
 
     Local<Object> obj = object();
@@ -945,6 +1241,182 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // Moves the collected header names/values into slot |index| of the pending
+  // batched message, appending to any headers that are already there.
+  bool AppendPendingHeaders(uint32_t index) {
+    Local<Context> context = env()->context();
+    Local<Value> existing;
+    if (!pending_message_->Get(context, index).ToLocal(&existing))
+      return false;
+    Local<Array> headers = CreateHeaders().As<Array>();
+    if (existing->IsUndefined())
+      return pending_message_->Set(context, index, headers).IsJust();
+
+    Local<Array> all = existing.As<Array>();
+    for (uint32_t i = 0; i < headers->Length(); i++) {
+      Local<Value> item;
+      if (!headers->Get(context, i).ToLocal(&item) ||
+          all->Set(context, all->Length(), item).IsNothing()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int BatchHeadersComplete() {
+    Isolate* isolate = env()->isolate();
+    Local<Context> context = env()->context();
+
+    if (!AppendPendingHeaders(A_HEADERS))
+      return -1;
+    num_fields_ = 0;
+    num_values_ = 0;
+
+    Local<Value> fields[] = {
+        Integer::New(isolate, parser_.http_major),
+        Integer::New(isolate, parser_.http_minor),
+        Uint32::NewFromUnsigned(isolate, parser_.method),
+        url_.ToString(env()),
+        Boolean::New(isolate, parser_.upgrade),
+        Boolean::New(isolate, llhttp_should_keep_alive(&parser_)),
+    };
+    const uint32_t indices[] = {A_VERSION_MAJOR,
+                                A_VERSION_MINOR,
+                                A_METHOD,
+                                A_URL,
+                                A_UPGRADE,
+                                A_SHOULD_KEEP_ALIVE};
+    for (size_t i = 0; i < arraysize(fields); i++) {
+      if (pending_message_->Set(context, indices[i], fields[i]).IsNothing())
+        return -1;
+    }
+    return 0;
+  }
+
+  int BatchMessageComplete() {
+    if (num_fields_ > 0 && !AppendPendingHeaders(A_BATCH_TRAILERS))
+      return -1;
+    num_fields_ = 0;
+    num_values_ = 0;
+
+    if (batch_->Set(env()->context(), batch_->Length(), pending_message_)
+            .IsNothing()) {
+      return -1;
+    }
+    pending_message_.Clear();
+    batching_message_ = false;
+    return 0;
+  }
+
+  // Delivers the messages completed so far to onMessages(messages), where
+  // each message is an array laid out like the onHeadersComplete arguments
+  // followed by the body chunks and trailers (or undefined).
+  bool EmitBatch() {
+    if (batch_.IsEmpty())
+      return true;
+    Local<Value> messages = batch_;
+    bool empty = batch_->Length() == 0;
+    batch_.Clear();
+    if (empty)
+      return true;
+
+    Local<Value> cb =
+        object()->Get(env()->context(), kOnMessages).ToLocalChecked();
+    if (!cb->IsFunction())
+      return true;
+
+    InternalCallbackScope callback_scope(
+        this, InternalCallbackScope::kSkipTaskQueues);
+    MaybeLocal<Value> r =
+        cb.As<Function>()->Call(env()->context(), object(), 1, &messages);
+    if (r.IsEmpty()) {
+      callback_scope.MarkAsFailed();
+      return false;
+    }
+    return true;
+  }
+
+  // Switches the message that is being collected back to the regular
+  // per-event callbacks, replaying what has been parsed of it so far.
+  bool EmitPendingMessageStart() {
+    Local<Context> context = env()->context();
+    Local<Object> message = pending_message_;
+    batching_message_ = false;
+    pending_message_.Clear();
+
+    EmitMessageBegin();
+
+    Local<Value> headers;
+    if (!message->Get(context, A_HEADERS).ToLocal(&headers))
+      return false;
+    if (!headers->IsUndefined()) {
+      Local<Value> cb =
+          object()->Get(context, kOnHeaders).ToLocalChecked();
+      if (cb->IsFunction()) {
+        Local<Value> argv[2] = {headers, url_.ToString(env())};
+        if (MakeCallback(cb.As<Function>(), arraysize(argv), argv).IsEmpty())
+          return false;
+      }
+      url_.Reset();
+      have_flushed_ = true;
+    }
+    return true;
+  }
+
+  bool FinishBatch() {
+    if (!EmitBatch())
+      return false;
+    if (!batching_message_)
+      return true;
+
+    if (!headers_completed_)
+      return EmitPendingMessageStart();
+
+    // The message is incomplete: replay its headers and body through the
+    // regular callbacks and let the rest of it arrive the same way.
+    Local<Context> context = env()->context();
+    Local<Array> message = pending_message_;
+    batching_message_ = false;
+    pending_message_.Clear();
+
+    EmitMessageBegin();
+
+    Local<Value> argv[A_MAX];
+    for (uint32_t i = 0; i < A_MAX; i++) {
+      if (!message->Get(context, i).ToLocal(&argv[i]))
+        return false;
+    }
+    Local<Value> cb =
+        object()->Get(context, kOnHeadersComplete).ToLocalChecked();
+    if (cb->IsFunction()) {
+      InternalCallbackScope callback_scope(
+          this, InternalCallbackScope::kSkipTaskQueues);
+      if (cb.As<Function>()
+              ->Call(context, object(), arraysize(argv), argv)
+              .IsEmpty()) {
+        callback_scope.MarkAsFailed();
+        return false;
+      }
+    }
+
+    Local<Value> body;
+    if (!message->Get(context, A_BATCH_BODY).ToLocal(&body))
+      return false;
+    cb = object()->Get(context, kOnBody).ToLocalChecked();
+    if (body->IsUndefined() || !cb->IsFunction())
+      return true;
+    Local<Array> chunks = body.As<Array>();
+    for (uint32_t i = 0; i < chunks->Length(); i++) {
+      Local<Value> chunk;
+      if (!chunks->Get(context, i).ToLocal(&chunk) ||
+          MakeCallback(cb.As<Function>(), 1, &chunk).IsEmpty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
   void Init(llhttp_type_t type, uint64_t max_http_header_size,
             uint32_t lenient_flags) {
     llhttp_init(&parser_, type, &settings);
@@ -988,10 +1460,74 @@ class Parser : public AsyncWrap, public StreamListener {
     have_flushed_ = false;
     got_exception_ = false;
     headers_completed_ = false;
+    batch_mode_ = false;
+    batching_message_ = false;
+    body_limit_ = 0;
+    ResetBody();
     max_http_header_size_ = max_http_header_size;
   }
 
 
+  void StartBodyAccumulation() {
+    ResetBody();
+    if (body_limit_ == 0 || parser_.upgrade)
+      return;
+    if (parser_.flags & F_CONTENT_LENGTH) {
+      if (parser_.content_length > body_limit_)
+        return;
+      // The size is known up front, so the body is read into a buffer of
+      // exactly that size and handed out without another copy.
+      if (parser_.content_length > 0)
+        ReserveBody(parser_.content_length);
+    }
+    accumulating_body_ = true;
+  }
+
+
+  void ReserveBody(size_t capacity) {
+    std::unique_ptr<BackingStore> store;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+      store = ArrayBuffer::NewBackingStore(env()->isolate(), capacity);
+    }
+    if (body_length_ > 0)
+      memcpy(store->Data(), body_store_->Data(), body_length_);
+    body_store_ = std::move(store);
+  }
+
+
+  void AppendBody(const char* data, size_t length) {
+    size_t capacity = body_store_ ? body_store_->ByteLength() : 0;
+    if (capacity - body_length_ < length) {
+      // Chunked bodies have no known size, so grow geometrically.
+      size_t wanted = std::max(body_length_ + length,
+                               std::max<size_t>(capacity * 2, 16 * 1024));
+      ReserveBody(std::min(wanted, body_limit_));
+    }
+    memcpy(static_cast<char*>(body_store_->Data()) + body_length_,
+           data,
+           length);
+    body_length_ += length;
+  }
+
+
+  Local<Value> TakeBody() {
+    Local<ArrayBuffer> ab =
+        ArrayBuffer::New(env()->isolate(), std::move(body_store_));
+    Local<Value> buffer =
+        Buffer::New(env(), ab, 0, body_length_).ToLocalChecked();
+    body_length_ = 0;
+    return buffer;
+  }
+
+
+  void ResetBody() {
+    accumulating_body_ = false;
+    body_store_.reset();
+    body_length_ = 0;
+  }
+
+
   int TrackHeader(size_t len) {
     header_nread_ += len;
     if (header_nread_ >= max_http_header_size_) {
@@ -1021,6 +1557,26 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // Arguments for the on-headers-complete javascript callback. This
+  // list needs to be kept in sync with the actual argument list for
+  // `parserOnHeadersComplete` in lib/_http_common.js. Batched messages
+  // use the same layout, followed by the body chunks and trailers.
+  enum on_headers_complete_arg_index {
+    A_VERSION_MAJOR = 0,
+    A_VERSION_MINOR,
+    A_HEADERS,
+    A_METHOD,
+    A_URL,
+    A_STATUS_CODE,
+    A_STATUS_MESSAGE,
+    A_UPGRADE,
+    A_SHOULD_KEEP_ALIVE,
+    A_MAX,
+    A_BATCH_BODY = A_MAX,
+    A_BATCH_TRAILERS,
+    A_BATCH_MAX
+  };
+
   llhttp_t parser_;
   StringPtr fields_[kMaxHeaderFieldsCount];  // header fields
   StringPtr values_[kMaxHeaderFieldsCount];  // header values
@@ -1034,6 +1590,19 @@ class Parser : public AsyncWrap, public StreamListener {
   const char* current_buffer_data_;
   bool headers_completed_ = false;
   bool pending_pause_ = false;
+  // Batched mode (requests only): complete messages are collected into
+  // batch_ and delivered through a single onMessages callback at the end of
+  // Execute(). Both handles are only valid for the duration of Execute().
+  bool batch_mode_ = false;
+  bool batching_message_ = false;
+  Local<Array> batch_;
+  Local<Array> pending_message_;
+  // Body accumulation: the body of the current message is collected into
+  // body_store_ while accumulating_body_ is set. See SetBodyAccumulation().
+  size_t body_limit_ = 0;
+  bool accumulating_body_ = false;
+  std::unique_ptr<BackingStore> body_store_;
+  size_t body_length_ = 0;
   uint64_t header_nread_ = 0;
   uint64_t chunk_extensions_nread_ = 0;
   uint64_t max_http_header_size_;
@@ -1042,6 +1611,13 @@ class Parser : public AsyncWrap, public StreamListener {
 
   BaseObjectPtr<BindingData> binding_data_;
 
+  std::shared_ptr<BackingStore> packed_data_store_;
+  size_t packed_data_offset_ = 0;
+  size_t packed_data_length_ = 0;
+  std::shared_ptr<BackingStore> packed_table_store_;
+  size_t packed_table_offset_ = 0;
+  size_t packed_table_length_ = 0;
+
   // These are helper functions for filling `http_parser_settings`, which turn
   // a member function of Parser into a C-style HTTP parser callback.
   template <typename Parser, Parser> struct Proxy;
@@ -1245,6 +1821,159 @@ const llhttp_settings_t Parser::settings = {
     nullptr,
 };
 
+// Lookup tables for the characters allowed in header names (RFC 9110 tokens)
+// and header values (HTAB, SP, VCHAR and obs-text), matching the checks done
+// by checkIsHttpToken() and checkInvalidHeaderChar() in lib/_http_common.js.
+struct HeaderCharTables {
+  bool token[256] = {};
+  bool value[256] = {};
+
+  constexpr HeaderCharTables() {
+    for (int c = '0'; c <= '9'; c++) token[c] = true;
+    for (int c = 'a'; c <= 'z'; c++) token[c] = true;
+    for (int c = 'A'; c <= 'Z'; c++) token[c] = true;
+    for (char c : "!#$%&'*+-.^_`|~") token[static_cast<uint8_t>(c)] = true;
+    token[0] = false;
+    value['\t'] = true;
+    for (int c = 0x20; c <= 0x7e; c++) value[c] = true;
+    for (int c = 0x80; c <= 0xff; c++) value[c] = true;
+  }
+};
+
+constexpr HeaderCharTables kHeaderChars;
+
+// Bodies up to this size are copied behind the head so that the response
+// goes out as a single buffer; larger ones are written as a second buffer.
+constexpr size_t kMaxInlineBodySize = 16 * 1024;
+
+// Copies a one-byte string into |out| and checks every character against
+// |allowed|. Returns the number of bytes written, or -1 if the string
+// contains a disallowed character.
+ssize_t WriteHeaderChars(Isolate* isolate,
+                         Local<String> str,
+                         char* out,
+                         const bool* allowed,
+                         bool allow_empty) {
+  int length = str->Length();
+  if (length == 0) return allow_empty ? 0 : -1;
+  if (!str->ContainsOnlyOneByte()) return -1;
+  str->WriteOneByte(isolate,
+                    reinterpret_cast<uint8_t*>(out),
+                    0,
+                    length,
+                    String::NO_NULL_TERMINATION);
+  for (int i = 0; i < length; i++) {
+    if (!allowed[static_cast<uint8_t>(out[i])]) return -1;
+  }
+  return length;
+}
+
+// err = writeResponseHead(stream, req, statusCode, statusMessage, headers
+//                         [, body])
+// Serializes an HTTP/1.1 status line and the flat [name, value, ...] header
+// array into a single buffer and writes it, together with `body` if given,
+// to the StreamBase `stream` using the write request `req`. Returns a libuv
+// error code, or UV_EINVAL without writing anything if a header name or
+// value contains invalid characters. As with writeBuffer(), `req` must keep
+// `body` alive until it completes.
+static void WriteResponseHead(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsObject());
+  CHECK(args[2]->IsUint32());
+  CHECK(args[3]->IsString());
+  CHECK(args[4]->IsArray());
+  StreamBase* stream = StreamBase::FromObject(args[0].As<Object>());
+  CHECK_NOT_NULL(stream);
+  Local<Object> req_wrap_obj = args[1].As<Object>();
+  uint32_t status_code = args[2].As<Uint32>()->Value();
+  Local<String> status_message = args[3].As<String>();
+  Local<Array> headers = args[4].As<Array>();
+  CHECK_EQ(headers->Length() % 2, 0);
+  CHECK_LE(status_code, 999);
+
+  ArrayBufferViewContents<char> contents;
+  uv_buf_t body = uv_buf_init(nullptr, 0);
+  if (args.Length() > 5 && !args[5]->IsUndefined()) {
+    CHECK(args[5]->IsArrayBufferView());
+    contents.Read(args[5].As<ArrayBufferView>());
+    body = uv_buf_init(const_cast<char*>(contents.data()), contents.length());
+  }
+
+  // "HTTP/1.1 NNN " + message + CRLF, each header as name + ": " + value +
+  // CRLF, and the final CRLF.
+  // Each item is read once, so that the buffer is sized and written from
+  // the same strings even if the array has getters.
+  size_t size = 13 + status_message->Length() + 2 + 2;
+  const uint32_t header_count = headers->Length();
+  MaybeStackBuffer<Local<String>, 64> items(header_count);
+  for (uint32_t i = 0; i < header_count; i++) {
+    Local<Value> item;
+    if (!headers->Get(context, i).ToLocal(&item)) return;
+    CHECK(item->IsString());
+    items[i] = item.As<String>();
+    size += items[i]->Length() + 2;
+  }
+  const bool inline_body = body.len <= kMaxInlineBodySize;
+  if (inline_body) size += body.len;
+
+  // Round up to a size class of the managed buffer pool so that the buffer
+  // can be reused for the next response.
+  size_t alloc_size = 4096;
+  while (alloc_size < size) alloc_size *= 2;
+  std::unique_ptr<BackingStore> bs =
+      env->release_managed_buffer(env->allocate_managed_buffer(alloc_size));
+  char* const base = static_cast<char*>(bs->Data());
+  char* out = base;
+
+  out += snprintf(out, 14, "HTTP/1.1 %03u ", status_code);
+  ssize_t written = WriteHeaderChars(
+      isolate, status_message, out, kHeaderChars.value, true);
+  if (written < 0) {
+    env->recycle_managed_buffer(std::move(bs));
+    return args.GetReturnValue().Set(UV_EINVAL);
+  }
+  out += written;
+  *out++ = '\r';
+  *out++ = '\n';
+
+  for (uint32_t i = 0; i < header_count; i += 2) {
+    written = WriteHeaderChars(
+        isolate, items[i], out, kHeaderChars.token, false);
+    if (written >= 0) {
+      out += written;
+      *out++ = ':';
+      *out++ = ' ';
+      written = WriteHeaderChars(
+          isolate, items[i + 1], out, kHeaderChars.value, true);
+    }
+    if (written < 0) {
+      env->recycle_managed_buffer(std::move(bs));
+      return args.GetReturnValue().Set(UV_EINVAL);
+    }
+    out += written;
+    *out++ = '\r';
+    *out++ = '\n';
+  }
+  *out++ = '\r';
+  *out++ = '\n';
+
+  if (inline_body && body.len > 0) {
+    memcpy(out, body.base, body.len);
+    out += body.len;
+  }
+  CHECK_LE(static_cast<size_t>(out - base), size);
+
+  uv_buf_t bufs[2] = {uv_buf_init(base, out - base), body};
+  int err = stream->WriteFromNative(
+      req_wrap_obj, bufs, inline_body ? 1 : 2, &bs);
+  if (bs) env->recycle_managed_buffer(std::move(bs));
+  args.GetReturnValue().Set(err);
+}
+
 void CreatePerIsolateProperties(IsolateData* isolate_data,
                                 Local<ObjectTemplate> target) {
   Isolate* isolate = isolate_data->isolate();
@@ -1270,6 +1999,8 @@ void CreatePerIsolateProperties(IsolateData* isolate_data,
          Integer::NewFromUnsigned(isolate, kOnExecute));
   t->Set(FIXED_ONE_BYTE_STRING(isolate, "kOnTimeout"),
          Integer::NewFromUnsigned(isolate, kOnTimeout));
+  t->Set(FIXED_ONE_BYTE_STRING(isolate, "kOnMessages"),
+         Integer::NewFromUnsigned(isolate, kOnMessages));
 
   t->Set(FIXED_ONE_BYTE_STRING(isolate, "kLenientNone"),
          Integer::NewFromUnsigned(isolate, kLenientNone));
@@ -1311,6 +2042,10 @@ void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetProtoMethod(isolate, t, "getCurrentBuffer", Parser::GetCurrentBuffer);
   SetProtoMethod(isolate, t, "duration", Parser::Duration);
   SetProtoMethod(isolate, t, "headersCompleted", Parser::HeadersCompleted);
+  SetProtoMethod(isolate, t, "setPackedHeaders", Parser::SetPackedHeaders);
+  SetProtoMethod(isolate, t, "setBatchMode", Parser::SetBatchMode);
+  SetProtoMethod(
+      isolate, t, "setBodyAccumulation", Parser::SetBodyAccumulation);
 
   SetConstructorFunction(isolate, target, "HTTPParser", t);
 
@@ -1323,6 +2058,8 @@ void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetProtoMethod(isolate, c, "active", ConnectionsList::Active);
   SetProtoMethod(isolate, c, "expired", ConnectionsList::Expired);
   SetConstructorFunction(isolate, target, "ConnectionsList", c);
+
+  SetMethod(isolate, target, "writeResponseHead", WriteResponseHead);
 }
 
 void CreatePerContextProperties(Local<Object> target,
@@ -1382,11 +2119,15 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Parser::GetCurrentBuffer);
   registry->Register(Parser::Duration);
   registry->Register(Parser::HeadersCompleted);
+  registry->Register(Parser::SetPackedHeaders);
+  registry->Register(Parser::SetBatchMode);
+  registry->Register(Parser::SetBodyAccumulation);
   registry->Register(ConnectionsList::New);
   registry->Register(ConnectionsList::All);
   registry->Register(ConnectionsList::Idle);
   registry->Register(ConnectionsList::Active);
   registry->Register(ConnectionsList::Expired);
+  registry->Register(WriteResponseHead);
 }
 
 }  // namespace http_parser
@@ -33,8 +33,11 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <memory>
 
 #include <string>
 #include <vector>
@@ -54,6 +57,7 @@ extern uint64_t node_start_time;
 
 // Forward declaration
 class Environment;
+class Histogram;
 
 // Convert a struct sockaddr to a { address: '1.2.3.4', port: 1234 } JS object.
 // Sets address and port properties on the info object and returns it.
@@ -115,8 +119,26 @@ v8::Maybe<bool> InitializeBaseContextForSnapshot(
 v8::Maybe<bool> InitializeContextRuntime(v8::Local<v8::Context> context);
 v8::Maybe<bool> InitializePrimordials(v8::Local<v8::Context> context);
 
+// Backing stores between kPoolMinSize and kPoolMaxSize bytes are rounded up
+// to one of four size classes per power of two, and freed ones are kept for
+// reuse, up to --array-buffer-pool-size bytes in total. This saves the
+// malloc() and page fault cost of streaming code that keeps allocating
+// similarly sized Buffers. V8 may free backing stores from its own threads,
+// so the pool is locked.
 class NodeArrayBufferAllocator : public ArrayBufferAllocator {
  public:
+  static constexpr size_t kPoolMinSize = 4 * 1024;
+  static constexpr size_t kPoolMaxSize = 1024 * 1024;
+
+  struct PoolStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cached_bytes;
+  };
+
+  NodeArrayBufferAllocator();
+  ~NodeArrayBufferAllocator() override;
+
   inline uint32_t* zero_fill_field() { return &zero_fill_field_; }
 
   void* Allocate(size_t size) override;  // Defined in src/node.cc
@@ -134,13 +156,32 @@ class NodeArrayBufferAllocator : public ArrayBufferAllocator {
     return total_mem_usage_.load(std::memory_order_relaxed);
   }
 
+  PoolStats GetPoolStats() const;
+
  private:
+  static constexpr size_t kPoolClassesPerDoubling = 4;
+  // One class for kPoolMinSize, and four for each doubling up to
+  // kPoolMaxSize (2^12 to 2^20).
+  static constexpr size_t kPoolClassCount = 1 + 8 * kPoolClassesPerDoubling;
+
+  // Returns kPoolClassCount if size is not pooled.
+  size_t PoolClass(size_t size, size_t* class_size) const;
+  static size_t PoolClassSize(size_t index);
+  void* AllocateFromPool(size_t size, bool zero_fill);
+
   uint32_t zero_fill_field_ = 1;  // Boolean but exposed as uint32 to JS land.
   std::atomic<size_t> total_mem_usage_ {0};
 
   // Delegate to V8's allocator for compatibility with the V8 memory cage.
   std::unique_ptr<v8::ArrayBuffer::Allocator> allocator_{
       v8::ArrayBuffer::Allocator::NewDefaultAllocator()};
+
+  const size_t pool_limit_;  // 0 disables the pool.
+  mutable Mutex pool_mutex_;  // Protects everything below.
+  std::vector<void*> pool_[kPoolClassCount];
+  size_t pool_cached_bytes_ = 0;
+  uint64_t pool_hits_ = 0;
+  uint64_t pool_misses_ = 0;
 };
 
 class DebuggingArrayBufferAllocator final : public NodeArrayBufferAllocator {
@@ -283,10 +324,117 @@ class DebugSealHandleScope {
 #endif
 };
 
+// Hands work to the libuv threadpool for one Environment, with a separate
+// limit on how much work of each category can be on the threadpool at once.
+// A burst of slow file system work can then not take every thread while zlib,
+// crypto, Node-API or DNS work waits behind it. Work beyond the limit of its
+// category waits in a FIFO for that category and is passed on to libuv when
+// earlier work of the same category completes.
+enum ThreadPoolWorkCategory {
+  kThreadPoolWorkFs,
+  kThreadPoolWorkCrypto,
+  kThreadPoolWorkZlib,
+  kThreadPoolWorkUser,
+  kThreadPoolWorkCategoryCount
+};
+
+class ThreadPoolWorkQueue final {
+ public:
+  using Category = ThreadPoolWorkCategory;
+
+  explicit ThreadPoolWorkQueue(Environment* env);
+  ThreadPoolWorkQueue(const ThreadPoolWorkQueue&) = delete;
+  ThreadPoolWorkQueue& operator=(const ThreadPoolWorkQueue&) = delete;
+
+  // Maps the type string of a ThreadPoolWork to its category. Unknown types
+  // count as user work.
+  static Category GetCategory(const char* type);
+
+  // Like uv_queue_work() on the Environment's event loop. after_work_cb must
+  // call Done() with the same category.
+  int Queue(Category category,
+            uv_work_t* req,
+            uv_work_cb work_cb,
+            uv_after_work_cb after_work_cb);
+  void Done(Category category);
+  // Like uv_cancel() for a request passed to Queue().
+  int Cancel(Category category, uv_work_t* req);
+
+  // Called on the event loop thread when work is scheduled. Returns the
+  // current time if durations are being recorded and 0 otherwise.
+  uint64_t WorkQueued(Category category);
+  // Called on the threadpool before and after running the work, each with the
+  // value returned by the previous call.
+  uint64_t WorkStarted(Category category, uint64_t queued_at);
+  void WorkFinished(Category category, uint64_t started_at);
+  // Called on the event loop thread for work that was cancelled before it
+  // started.
+  void WorkCancelled(Category category);
+
+  // While monitoring, the time that work waits before it starts and the time
+  // it runs for are recorded, in nanoseconds, for each category.
+  void StartMonitoring();
+  void StopMonitoring() { monitoring_ = false; }
+  const std::shared_ptr<Histogram>& wait_time(Category category) const {
+    return lanes_[category].wait_time;
+  }
+  const std::shared_ptr<Histogram>& run_time(Category category) const {
+    return lanes_[category].run_time;
+  }
+
+  uint64_t queued(Category category) const {
+    return lanes_[category].queued.load(std::memory_order_relaxed);
+  }
+  uint64_t running(Category category) const {
+    return lanes_[category].running.load(std::memory_order_relaxed);
+  }
+  size_t limit(Category category) const { return lanes_[category].limit; }
+
+  static const char* GetCategoryName(Category category);
+
+ private:
+  struct Pending {
+    uv_work_t* req;
+    uv_work_cb work_cb;
+    uv_after_work_cb after_work_cb;
+  };
+
+  struct Lane {
+    size_t limit;
+    size_t active = 0;
+    std::deque<Pending> pending;
+    // Updated from the threadpool as well.
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> running{0};
+    // Created by the first StartMonitoring() call and kept afterwards, since
+    // work that is already queued may still record into them.
+    std::shared_ptr<Histogram> wait_time;
+    std::shared_ptr<Histogram> run_time;
+  };
+
+  void TraceCounters(Category category) const;
+
+  Environment* env_;
+  Lane lanes_[kThreadPoolWorkCategoryCount];
+  bool monitoring_ = false;
+};
+
+// The number of threads in the libuv threadpool, following how libuv reads
+// UV_THREADPOOL_SIZE.
+size_t GetLibuvThreadPoolSize();
+
+// The CPU bandwidth limit of the cgroup (v1 or v2) of the process and its
+// ancestors, as a number of CPUs, or 0 if there is none. Linux only.
+double GetCgroupCpuQuota();
+// uv_available_parallelism(), capped by GetCgroupCpuQuota().
+unsigned int GetAvailableParallelism();
+
 class ThreadPoolWork {
  public:
   explicit inline ThreadPoolWork(Environment* env, const char* type)
-      : env_(env), type_(type) {
+      : env_(env),
+        type_(type),
+        category_(ThreadPoolWorkQueue::GetCategory(type)) {
     CHECK_NOT_NULL(env);
   }
   inline virtual ~ThreadPoolWork() = default;
@@ -303,6 +451,8 @@ class ThreadPoolWork {
   Environment* env_;
   uv_work_t work_req_;
   const char* type_;
+  ThreadPoolWorkQueue::Category category_;
+  uint64_t queued_at_ = 0;
 };
 
 #define TRACING_CATEGORY_NODE "node"
@@ -0,0 +1,392 @@
+#include "node_json.h"
+#include "env-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "simdjson.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace node {
+namespace json {
+
+using v8::Array;
+using v8::ArrayBufferView;
+using v8::Boolean;
+using v8::Context;
+using v8::Exception;
+using v8::FunctionCallbackInfo;
+using v8::Integer;
+using v8::Isolate;
+using v8::JSON;
+using v8::Local;
+using v8::LocalVector;
+using v8::NewStringType;
+using v8::Null;
+using v8::Number;
+using v8::Object;
+using v8::String;
+using v8::Value;
+
+namespace {
+
+// Parses JSON from the bytes of an ArrayBufferView with the simdjson
+// on-demand parser and builds the V8 values directly, instead of decoding
+// the bytes into a string for JSON.parse() to scan again.
+class Parser {
+ public:
+  Parser(Isolate* isolate, Local<Context> context)
+      : isolate_(isolate), context_(context) {}
+
+  // Returns false if an exception is pending.
+  bool Iterate(Local<ArrayBufferView> view,
+               simdjson::ondemand::document* document);
+
+  // Returns false with error_ set if the JSON is invalid, and false with
+  // error_ unset if a V8 exception is pending.
+  template <typename T>
+  bool ToV8(T&& json, Local<Value>* out);
+
+  // Throws a SyntaxError for error_.
+  void ThrowError();
+
+  simdjson::error_code error_ = simdjson::SUCCESS;
+
+ private:
+  // Parses |json| with V8's JSON parser. Returns false with a pending
+  // exception if it is invalid.
+  bool ParseWithV8(std::string_view json, Local<Value>* out);
+
+  bool NumberToV8(std::string_view token,
+                  simdjson::ondemand::number_type type,
+                  int64_t int_value,
+                  double double_value,
+                  Local<Value>* out);
+
+  Isolate* isolate_;
+  Local<Context> context_;
+};
+
+// Returns whether |token| has the JSON number syntax, with any whitespace
+// that follows it.
+bool IsJSONNumber(std::string_view token) {
+  token = token.substr(0, token.find_last_not_of(" \t\r\n") + 1);
+  size_t pos = 0;
+  auto digits = [&]() {
+    const size_t start = pos;
+    while (pos < token.size() && token[pos] >= '0' && token[pos] <= '9') pos++;
+    return pos > start;
+  };
+  if (pos < token.size() && token[pos] == '-') pos++;
+  if (pos < token.size() && token[pos] == '0') {
+    pos++;
+  } else if (!digits()) {
+    return false;
+  }
+  if (pos < token.size() && token[pos] == '.') {
+    pos++;
+    if (!digits()) return false;
+  }
+  if (pos < token.size() && (token[pos] == 'e' || token[pos] == 'E')) {
+    pos++;
+    if (pos < token.size() && (token[pos] == '+' || token[pos] == '-')) pos++;
+    if (!digits()) return false;
+  }
+  return pos == token.size();
+}
+
+// simdjson reads up to SIMDJSON_PADDING bytes past the end of the input.
+// Most Buffers are slices of a larger pool, so they can be parsed in place.
+// The others are copied into a scratch buffer of the thread first.
+thread_local simdjson::ondemand::parser json_parser;
+thread_local std::vector<char> scratch;
+
+bool Parser::Iterate(Local<ArrayBufferView> view,
+                     simdjson::ondemand::document* document) {
+  size_t length = view->ByteLength();
+  size_t offset = view->ByteOffset();
+  Local<v8::ArrayBuffer> buffer = view->Buffer();
+  const char* data = static_cast<const char*>(buffer->Data()) + offset;
+  size_t capacity = buffer->ByteLength() - offset;
+
+  if (capacity < length + simdjson::SIMDJSON_PADDING) {
+    scratch.resize(length + simdjson::SIMDJSON_PADDING);
+    memcpy(scratch.data(), data, length);
+    data = scratch.data();
+    capacity = scratch.size();
+  }
+
+  error_ = json_parser.iterate(data, length, capacity).get(*document);
+  if (error_) {
+    ThrowError();
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool Parser::ToV8(T&& json, Local<Value>* out) {
+  simdjson::ondemand::json_type type;
+  if ((error_ = json.type().get(type))) return false;
+
+  switch (type) {
+    case simdjson::ondemand::json_type::array: {
+      simdjson::ondemand::array array;
+      if ((error_ = json.get_array().get(array))) return false;
+      LocalVector<Value> elements(isolate_);
+      for (auto element : array) {
+        simdjson::ondemand::value value;
+        Local<Value> item;
+        if ((error_ = element.get(value))) return false;
+        if (!ToV8(value, &item)) return false;
+        elements.push_back(item);
+      }
+      *out = Array::New(isolate_, elements.data(), elements.size());
+      return true;
+    }
+    case simdjson::ondemand::json_type::object: {
+      simdjson::ondemand::object object;
+      if ((error_ = json.get_object().get(object))) return false;
+      Local<Object> result = Object::New(isolate_);
+      for (auto field : object) {
+        // unescaped_key() consumes the key, so the escaped key is read
+        // first.
+        std::string_view escaped_key;
+        std::string_view key;
+        if ((error_ = field.escaped_key().get(escaped_key))) return false;
+        // Keys repeat across objects, so internalize them like JSON.parse()
+        // does. The name has to be created before the value is parsed,
+        // which may reuse the storage of |key|.
+        Local<String> name;
+        error_ = field.unescaped_key().get(key);
+        if (error_ == simdjson::STRING_ERROR) {
+          // See the string case below.
+          error_ = simdjson::SUCCESS;
+          Local<Value> parsed;
+          if (!ParseWithV8("\"" + std::string(escaped_key) + "\"", &parsed))
+            return false;
+          name = parsed.As<String>()->InternalizeString(isolate_);
+        } else if (error_) {
+          return false;
+        } else if (!String::NewFromUtf8(isolate_,
+                                        key.data(),
+                                        NewStringType::kInternalized,
+                                        key.size())
+                        .ToLocal(&name)) {
+          return false;
+        }
+        simdjson::ondemand::value value;
+        Local<Value> item;
+        if ((error_ = field.value().get(value))) return false;
+        if (!ToV8(value, &item)) return false;
+        if (result->CreateDataProperty(context_, name, item).IsNothing()) {
+          return false;
+        }
+      }
+      *out = result;
+      return true;
+    }
+    case simdjson::ondemand::json_type::number: {
+      simdjson::ondemand::number_type number_type;
+      std::string_view token;
+      if ((error_ = json.get_number_type().get(number_type))) return false;
+      // Documents return a simdjson_result here, and values a string_view.
+      if ((error_ = simdjson::simdjson_result<std::string_view>(
+                        json.raw_json_token())
+                        .get(token))) {
+        return false;
+      }
+      int64_t int_value = 0;
+      double double_value = 0;
+      if (number_type == simdjson::ondemand::number_type::signed_integer) {
+        if ((error_ = json.get_int64().get(int_value))) return false;
+      } else if ((error_ = json.get_double().get(double_value))) {
+        // simdjson rejects numbers that overflow a double, which JSON.parse()
+        // turns into Infinity. raw_json() consumes the number.
+        if (error_ != simdjson::NUMBER_ERROR || !IsJSONNumber(token))
+          return false;
+        if ((error_ = json.raw_json().get(token))) return false;
+        double_value = std::strtod(std::string(token).c_str(), nullptr);
+      }
+      return NumberToV8(token, number_type, int_value, double_value, out);
+    }
+    case simdjson::ondemand::json_type::string: {
+      std::string_view value;
+      error_ = json.get_string().get(value);
+      if (error_ == simdjson::STRING_ERROR) {
+        // simdjson rejects escaped lone surrogates, which JSON.parse() keeps
+        // in the string, so such strings are left to V8. It throws for the
+        // strings that are invalid. raw_json() consumes the string.
+        if ((error_ = json.raw_json().get(value))) return false;
+        return ParseWithV8(value, out);
+      }
+      if (error_) return false;
+      return String::NewFromUtf8(
+                 isolate_, value.data(), NewStringType::kNormal, value.size())
+          .ToLocal(out);
+    }
+    case simdjson::ondemand::json_type::boolean: {
+      bool value;
+      if ((error_ = json.get_bool().get(value))) return false;
+      *out = Boolean::New(isolate_, value);
+      return true;
+    }
+    case simdjson::ondemand::json_type::null: {
+      bool is_null;
+      if ((error_ = json.is_null().get(is_null))) return false;
+      if (!is_null) {
+        error_ = simdjson::INCORRECT_TYPE;
+        return false;
+      }
+      *out = Null(isolate_);
+      return true;
+    }
+    default:
+      error_ = simdjson::TAPE_ERROR;
+      return false;
+  }
+}
+
+bool Parser::NumberToV8(std::string_view token,
+                        simdjson::ondemand::number_type type,
+                        int64_t int_value,
+                        double double_value,
+                        Local<Value>* out) {
+  switch (type) {
+    case simdjson::ondemand::number_type::signed_integer:
+      if (int_value == 0 && token[0] == '-') {
+        *out = Number::New(isolate_, -0.0);
+      } else if (int_value >= INT32_MIN && int_value <= INT32_MAX) {
+        *out = Integer::New(isolate_, static_cast<int32_t>(int_value));
+      } else {
+        *out = Number::New(isolate_, static_cast<double>(int_value));
+      }
+      return true;
+    default:
+      *out = Number::New(isolate_, double_value);
+      return true;
+  }
+}
+
+bool Parser::ParseWithV8(std::string_view json, Local<Value>* out) {
+  Local<String> source;
+  return String::NewFromUtf8(
+             isolate_, json.data(), NewStringType::kNormal, json.size())
+             .ToLocal(&source) &&
+         JSON::Parse(context_, source).ToLocal(out);
+}
+
+void Parser::ThrowError() {
+  Local<String> message;
+  std::string text =
+      std::string("Invalid JSON: ") + simdjson::error_message(error_);
+  if (!String::NewFromUtf8(isolate_, text.data(), NewStringType::kNormal)
+           .ToLocal(&message)) {
+    return;
+  }
+  isolate_->ThrowException(Exception::SyntaxError(message));
+}
+
+// parse(view) returns the value of the JSON document in |view|, which must
+// be UTF-8. Throws a SyntaxError like JSON.parse() if it is invalid.
+void Parse(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsArrayBufferView());
+
+  Parser parser(env->isolate(), env->context());
+  simdjson::ondemand::document document;
+  if (!parser.Iterate(args[0].As<ArrayBufferView>(), &document)) return;
+
+  Local<Value> result;
+  if (!parser.ToV8(document, &result)) {
+    if (parser.error_) parser.ThrowError();
+    return;
+  }
+  if (!document.at_end()) {
+    parser.error_ = simdjson::TRAILING_CONTENT;
+    return parser.ThrowError();
+  }
+  args.GetReturnValue().Set(result);
+}
+
+// parseFields(view, pointers) returns an array with the value at each JSON
+// Pointer (RFC 6901) of |pointers|, or undefined where the document has no
+// such value. Only the parts of the document that lead to the selected
+// values are materialized, and validated.
+void ParseFields(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  CHECK(args[0]->IsArrayBufferView());
+  CHECK(args[1]->IsArray());
+
+  Local<Array> pointers = args[1].As<Array>();
+  uint32_t count = pointers->Length();
+  std::vector<std::string> paths;
+  paths.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> pointer;
+    if (!pointers->Get(context, i).ToLocal(&pointer)) return;
+    if (!pointer->IsString()) {
+      return THROW_ERR_INVALID_ARG_TYPE(
+          isolate, "The \"pointers\" argument must be an array of strings.");
+    }
+    paths.emplace_back(Utf8Value(isolate, pointer).ToString());
+  }
+
+  Parser parser(isolate, context);
+  simdjson::ondemand::document document;
+  if (!parser.Iterate(args[0].As<ArrayBufferView>(), &document)) return;
+
+  LocalVector<Value> values(isolate);
+  values.reserve(count);
+  for (const std::string& path : paths) {
+    simdjson::ondemand::value value;
+    simdjson::error_code error = document.at_pointer(path).get(value);
+    if (error == simdjson::NO_SUCH_FIELD ||
+        error == simdjson::INDEX_OUT_OF_BOUNDS) {
+      values.push_back(Undefined(isolate));
+      continue;
+    }
+    if (error == simdjson::INVALID_JSON_POINTER) {
+      return THROW_ERR_INVALID_ARG_VALUE(
+          isolate, "\"%s\" is not a valid JSON Pointer.", path);
+    }
+    Local<Value> result;
+    if (error) {
+      parser.error_ = error;
+    } else if (parser.ToV8(value, &result)) {
+      values.push_back(result);
+      continue;
+    }
+    if (parser.error_) parser.ThrowError();
+    return;
+  }
+  args.GetReturnValue().Set(Array::New(isolate, values.data(), values.size()));
+}
+
+}  // anonymous namespace
+
+void CreatePerContextProperties(Local<Object> target,
+                                Local<Value> unused,
+                                Local<Context> context,
+                                void* priv) {
+  SetMethodNoSideEffect(context, target, "parse", Parse);
+  SetMethodNoSideEffect(context, target, "parseFields", ParseFields);
+}
+
+void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+  registry->Register(Parse);
+  registry->Register(ParseFields);
+}
+
+}  // namespace json
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(json,
+                                    node::json::CreatePerContextProperties)
+NODE_BINDING_EXTERNAL_REFERENCE(json, node::json::RegisterExternalReferences)
@@ -0,0 +1,25 @@
+#ifndef SRC_NODE_JSON_H_
+#define SRC_NODE_JSON_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "v8.h"
+
+namespace node {
+class ExternalReferenceRegistry;
+
+namespace json {
+
+// Sets parse() and parseFields() of the binding on |target|.
+void CreatePerContextProperties(v8::Local<v8::Object> target,
+                                v8::Local<v8::Value> unused,
+                                v8::Local<v8::Context> context,
+                                void* priv);
+void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+}  // namespace json
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_JSON_H_
@@ -0,0 +1,359 @@
+#include "node_log_writer.h"
+#include "base_object-inl.h"
+#include "env-inl.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __POSIX__
+#include <poll.h>
+#endif
+
+namespace node {
+namespace log_writer {
+
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Int32;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Uint32;
+using v8::Value;
+
+namespace {
+
+// All open writers of the process, for FlushAll().
+Mutex writers_mutex;
+std::vector<LogWriter*> writers;
+
+// How long FlushAllOnFatalError() waits for each writer's file descriptor
+// to become writable.
+constexpr int kFatalFlushTimeoutMs = 1000;
+
+#ifdef __POSIX__
+// stdout and stderr can be non-blocking pipes or TTYs, when they are shared
+// with a parent process that set them up that way. Waits for at most
+// |timeout_ms| milliseconds, or without a limit if it is negative, and
+// returns false if the time ran out.
+bool WaitWritable(uv_file fd, int timeout_ms) {
+  pollfd pfd = {fd, POLLOUT, 0};
+  int r;
+  while ((r = poll(&pfd, 1, timeout_ms)) == -1 && errno == EINTR) {
+  }
+  return r != 0;
+}
+#endif
+
+}  // anonymous namespace
+
+LogWriter::LogWriter(Environment* env,
+                     Local<Object> object,
+                     uv_file fd,
+                     size_t capacity,
+                     size_t threshold,
+                     bool use_thread)
+    : BaseObject(env, object),
+      fd_(fd),
+      capacity_(capacity),
+      threshold_(std::min(threshold, capacity)),
+      data_(new char[capacity]) {
+  MakeWeak();
+  if (use_thread) {
+    CHECK_EQ(uv_thread_create(&thread_, ThreadMain, this), 0);
+    has_thread_ = true;
+  }
+  Mutex::ScopedLock lock(writers_mutex);
+  writers.push_back(this);
+}
+
+LogWriter::~LogWriter() {
+  DoClose();
+}
+
+void LogWriter::ThreadMain(void* arg) {
+  LogWriter* writer = static_cast<LogWriter*>(arg);
+  while (true) {
+    {
+      Mutex::ScopedLock lock(writer->mutex_);
+      while (!writer->flush_requested_ && !writer->stopping_)
+        writer->cond_.Wait(lock);
+      // DoClose() flushes what is left once the thread is joined.
+      if (writer->stopping_) return;
+      writer->flush_requested_ = false;
+    }
+    writer->FlushNow();
+  }
+}
+
+void LogWriter::Append(const char* data, size_t length) {
+  if (length > capacity_) {
+    // Keep the order of the output, but do not copy what cannot fit anyway.
+    FlushNow();
+    Mutex::ScopedLock write_lock(write_mutex_);
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(data), length);
+    WriteAll(&buf, 1, -1);
+    return;
+  }
+
+  bool over_threshold;
+  while (true) {
+    {
+      Mutex::ScopedLock lock(mutex_);
+      if (capacity_ - size_ >= length) {
+        size_t tail = (head_ + size_) % capacity_;
+        size_t first = std::min(length, capacity_ - tail);
+        memcpy(data_.get() + tail, data, first);
+        memcpy(data_.get(), data + first, length - first);
+        size_ += length;
+        over_threshold = size_ >= threshold_;
+        break;
+      }
+    }
+    FlushNow();
+  }
+
+  if (over_threshold) {
+    RequestFlush();
+  } else {
+    ScheduleFlush();
+  }
+}
+
+size_t LogWriter::GetBuffered(uv_buf_t bufs[2], size_t* nbufs) const {
+  *nbufs = 0;
+  if (size_ == 0) return 0;
+  size_t first = std::min(size_, capacity_ - head_);
+  bufs[0] = uv_buf_init(data_.get() + head_, first);
+  *nbufs = 1;
+  if (first < size_) {
+    bufs[1] = uv_buf_init(data_.get(), size_ - first);
+    *nbufs = 2;
+  }
+  return size_;
+}
+
+void LogWriter::Consume(size_t length) {
+  head_ = (head_ + length) % capacity_;
+  size_ -= length;
+}
+
+void LogWriter::FlushNow() {
+  Mutex::ScopedLock write_lock(write_mutex_);
+  uv_buf_t bufs[2];
+  size_t nbufs;
+  size_t length;
+  {
+    Mutex::ScopedLock lock(mutex_);
+    length = GetBuffered(bufs, &nbufs);
+    if (length == 0) return;
+  }
+
+  // On errors the data is dropped, as it is for process.stdout.
+  WriteAll(bufs, nbufs, -1);
+
+  Mutex::ScopedLock lock(mutex_);
+  Consume(length);
+}
+
+void LogWriter::FlushOnFatalError() {
+  // The thread holding a lock may be the one that failed, or be stuck in a
+  // write, so nothing is written rather than waiting for it.
+  if (!write_mutex_.TryLock()) return;
+  uv_buf_t bufs[2];
+  size_t nbufs;
+  size_t length = 0;
+  if (mutex_.TryLock()) {
+    length = GetBuffered(bufs, &nbufs);
+    mutex_.Unlock();
+  }
+
+  if (length > 0) {
+    WriteAll(bufs, nbufs, kFatalFlushTimeoutMs);
+    // Whether it was written or not, the data must not be written again by
+    // a later flush.
+    if (mutex_.TryLock()) {
+      Consume(length);
+      mutex_.Unlock();
+    }
+  }
+  write_mutex_.Unlock();
+}
+
+void LogWriter::WriteAll(uv_buf_t* bufs, size_t nbufs, int timeout_ms) {
+  const uint64_t start = uv_hrtime();
+  while (nbufs > 0) {
+    uv_fs_t req;
+    int r = uv_fs_write(nullptr, &req, fd_, bufs, nbufs, -1, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (r == UV_EINTR) continue;
+#ifdef __POSIX__
+    if (r == UV_EAGAIN) {
+      int wait_ms = -1;
+      if (timeout_ms >= 0) {
+        uint64_t elapsed_ms = (uv_hrtime() - start) / 1000000;
+        wait_ms = elapsed_ms < static_cast<uint64_t>(timeout_ms)
+                      ? timeout_ms - static_cast<int>(elapsed_ms)
+                      : 0;
+      }
+      if (wait_ms != 0 && WaitWritable(fd_, wait_ms)) continue;
+      last_error_.store(UV_ETIMEDOUT, std::memory_order_relaxed);
+      return;
+    }
+#endif
+    if (r < 0) {
+      last_error_.store(r, std::memory_order_relaxed);
+      return;
+    }
+    size_t written = r;
+    while (nbufs > 0 && written >= bufs->len) {
+      written -= bufs->len;
+      bufs++;
+      nbufs--;
+    }
+    if (nbufs > 0) {
+      bufs->base += written;
+      bufs->len -= written;
+    }
+  }
+}
+
+void LogWriter::RequestFlush() {
+  if (!has_thread_) {
+    FlushNow();
+    return;
+  }
+  Mutex::ScopedLock lock(mutex_);
+  flush_requested_ = true;
+  cond_.Signal(lock);
+}
+
+void LogWriter::ScheduleFlush() {
+  if (flush_scheduled_) return;
+  flush_scheduled_ = true;
+  env()->SetImmediate(
+      [self = BaseObjectPtr<LogWriter>(this)](Environment* env) {
+        self->flush_scheduled_ = false;
+        if (!self->closed_) self->RequestFlush();
+      });
+}
+
+void LogWriter::DoClose() {
+  if (closed_) return;
+  closed_ = true;
+  if (has_thread_) {
+    {
+      Mutex::ScopedLock lock(mutex_);
+      stopping_ = true;
+      cond_.Signal(lock);
+    }
+    CHECK_EQ(uv_thread_join(&thread_), 0);
+    has_thread_ = false;
+  }
+  {
+    Mutex::ScopedLock lock(writers_mutex);
+    writers.erase(std::find(writers.begin(), writers.end(), this));
+  }
+  FlushNow();
+}
+
+void LogWriter::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("buffer", capacity_);
+}
+
+void LogWriter::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsInt32());    // fd
+  CHECK(args[1]->IsUint32());   // capacity
+  CHECK(args[2]->IsUint32());   // threshold
+  CHECK(args[3]->IsBoolean());  // useThread
+
+  uint32_t capacity = args[1].As<Uint32>()->Value();
+  CHECK_GT(capacity, 0);
+  new LogWriter(env,
+                args.This(),
+                args[0].As<Int32>()->Value(),
+                capacity,
+                args[2].As<Uint32>()->Value(),
+                args[3]->IsTrue());
+}
+
+// write(data) appends a string, as UTF-8, or an ArrayBufferView.
+void LogWriter::Write(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LogWriter* writer;
+  ASSIGN_OR_RETURN_UNWRAP(&writer, args.This());
+  if (writer->closed_) {
+    return THROW_ERR_INVALID_STATE(env, "The log writer is closed");
+  }
+
+  if (args[0]->IsArrayBufferView()) {
+    ArrayBufferViewContents<char> contents(args[0]);
+    writer->Append(contents.data(), contents.length());
+  } else {
+    CHECK(args[0]->IsString());
+    Utf8Value value(env->isolate(), args[0]);
+    writer->Append(*value, value.length());
+  }
+}
+
+// flush() writes out the buffer synchronously, and returns the libuv error
+// code of the last failed write, or 0.
+void LogWriter::Flush(const FunctionCallbackInfo<Value>& args) {
+  LogWriter* writer;
+  ASSIGN_OR_RETURN_UNWRAP(&writer, args.This());
+  writer->FlushNow();
+  args.GetReturnValue().Set(
+      writer->last_error_.exchange(0, std::memory_order_relaxed));
+}
+
+void LogWriter::Close(const FunctionCallbackInfo<Value>& args) {
+  LogWriter* writer;
+  ASSIGN_OR_RETURN_UNWRAP(&writer, args.This());
+  writer->DoClose();
+}
+
+void FlushAll() {
+  Mutex::ScopedLock lock(writers_mutex);
+  for (LogWriter* writer : writers) writer->FlushNow();
+}
+
+void FlushAllOnFatalError() {
+  if (!writers_mutex.TryLock()) return;
+  for (LogWriter* writer : writers) writer->FlushOnFatalError();
+  writers_mutex.Unlock();
+}
+
+static void Initialize(Local<Object> target,
+                       Local<Value> unused,
+                       Local<Context> context,
+                       void* priv) {
+  Isolate* isolate = context->GetIsolate();
+  Local<FunctionTemplate> tmpl = NewFunctionTemplate(isolate, LogWriter::New);
+  tmpl->InstanceTemplate()->SetInternalFieldCount(
+      LogWriter::kInternalFieldCount);
+  SetProtoMethod(isolate, tmpl, "write", LogWriter::Write);
+  SetProtoMethod(isolate, tmpl, "flush", LogWriter::Flush);
+  SetProtoMethod(isolate, tmpl, "close", LogWriter::Close);
+  SetConstructorFunction(context, target, "LogWriter", tmpl);
+}
+
+static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+  registry->Register(LogWriter::New);
+  registry->Register(LogWriter::Write);
+  registry->Register(LogWriter::Flush);
+  registry->Register(LogWriter::Close);
+}
+
+}  // namespace log_writer
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(log_writer, node::log_writer::Initialize)
+NODE_BINDING_EXTERNAL_REFERENCE(log_writer,
+                                node::log_writer::RegisterExternalReferences)
@@ -0,0 +1,111 @@
+#ifndef SRC_NODE_LOG_WRITER_H_
+#define SRC_NODE_LOG_WRITER_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "base_object.h"
+#include "node_mutex.h"
+#include "uv.h"
+
+#include <atomic>
+#include <memory>
+
+namespace node {
+namespace log_writer {
+
+// Buffers writes to a file descriptor, usually stdout or stderr, in a ring
+// buffer and writes them out with one writev() per flush instead of one
+// write() per line. The buffer is flushed once it holds |threshold| bytes,
+// at the end of the current loop iteration, on close() and when the process
+// exits, including through a fatal error.
+//
+// With a flusher thread the writes happen off the event loop, so blocking
+// targets such as files and TTYs do not stall it.
+class LogWriter final : public BaseObject {
+ public:
+  LogWriter(Environment* env,
+            v8::Local<v8::Object> object,
+            uv_file fd,
+            size_t capacity,
+            size_t threshold,
+            bool use_thread);
+  ~LogWriter() override;
+
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Write(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Flush(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Close(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Appends |length| bytes. Flushes synchronously while they do not fit.
+  void Append(const char* data, size_t length);
+  // Writes out everything that was appended before the call. Can be called
+  // from any thread.
+  void FlushNow();
+  // Like FlushNow(), but does not wait for locks held by other threads, and
+  // drops the data that cannot be written within a bounded time.
+  void FlushOnFatalError();
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(LogWriter)
+  SET_SELF_SIZE(LogWriter)
+
+ private:
+  static void ThreadMain(void* arg);
+
+  // Flushes on the flusher thread if there is one, and right away otherwise.
+  void RequestFlush();
+  // Requests a flush once the current loop iteration is done.
+  void ScheduleFlush();
+  // Returns the number of buffered bytes, and sets |bufs| to the one or two
+  // parts of the ring that hold them. mutex_ must be held.
+  size_t GetBuffered(uv_buf_t bufs[2], size_t* nbufs) const;
+  // Drops |length| bytes from the start of the ring. mutex_ must be held.
+  void Consume(size_t length);
+  // Writes all of |bufs| to the file descriptor, retrying short writes.
+  // Gives up on the first error, which is kept in last_error_, and when a
+  // non-blocking descriptor is not writable again within |timeout_ms|
+  // milliseconds, unless that is negative.
+  void WriteAll(uv_buf_t* bufs, size_t nbufs, int timeout_ms);
+  void DoClose();
+
+  const uv_file fd_;
+  const size_t capacity_;
+  const size_t threshold_;
+  std::unique_ptr<char[]> data_;
+
+  // Guards the ring indices. Appends fill the free space after the data, and
+  // a flush only consumes the data it saw when it started, so the lock is
+  // not held while writing.
+  Mutex mutex_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  // Serializes writes to the file descriptor, so that flushes from the event
+  // loop, the flusher thread and FlushAll() keep the data in order.
+  Mutex write_mutex_;
+
+  ConditionVariable cond_;
+  uv_thread_t thread_;
+  bool has_thread_ = false;
+  bool flush_requested_ = false;
+  bool stopping_ = false;
+
+  bool flush_scheduled_ = false;
+  bool closed_ = false;
+  std::atomic<int> last_error_{0};
+};
+
+// Flushes every open LogWriter of the process when it exits. Can be called
+// from any thread.
+void FlushAll();
+
+// Used instead of FlushAll() by the fatal error handlers, which must not
+// hang: writers whose locks are held are skipped, and output that cannot be
+// written within a bounded time is dropped.
+void FlushAllOnFatalError();
+
+}  // namespace log_writer
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_LOG_WRITER_H_
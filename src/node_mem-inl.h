@@ -6,9 +6,50 @@
 #include "node_mem.h"
 #include "node_internals.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace node {
 namespace mem {
 
+inline BlockPool::~BlockPool() {
+  for (std::vector<char*>& blocks : free_) {
+    for (char* block : blocks) free(block);
+  }
+}
+
+size_t BlockPool::ClassSize(size_t size) {
+  if (size == 0 || size > (size_t{1} << kMaxClassShift)) return 0;
+  size_t class_size = size_t{1} << kMinClassShift;
+  while (class_size < size) class_size <<= 1;
+  return class_size;
+}
+
+size_t BlockPool::ClassIndex(size_t class_size) {
+  size_t index = 0;
+  while ((size_t{1} << (kMinClassShift + index)) < class_size) index++;
+  return index;
+}
+
+char* BlockPool::Take(size_t class_size) {
+  std::vector<char*>& blocks = free_[ClassIndex(class_size)];
+  if (blocks.empty()) return nullptr;
+  char* block = blocks.back();
+  blocks.pop_back();
+  cached_bytes_ -= class_size;
+  return block;
+}
+
+bool BlockPool::Put(char* block, size_t class_size) {
+  if (ClassSize(class_size) != class_size ||
+      cached_bytes_ + class_size > kMaxCachedBytes) {
+    return false;
+  }
+  free_[ClassIndex(class_size)].push_back(block);
+  cached_bytes_ += class_size;
+  return true;
+}
+
 template <typename Class, typename AllocatorStruct>
 AllocatorStruct NgLibMemoryManager<Class, AllocatorStruct>::MakeAllocator() {
   return AllocatorStruct {
@@ -20,6 +61,34 @@ AllocatorStruct NgLibMemoryManager<Class, AllocatorStruct>::MakeAllocator() {
   };
 }
 
+// Like UncheckedRealloc(), but rounds small sizes up to a BlockPool class
+// size (updating |*size|) and takes and returns blocks of those sizes from
+// and to |pool|.
+template <typename Class, typename T>
+char* NgLibMemoryManager<Class, T>::PooledRealloc(BlockPool* pool,
+                                                  char* ptr,
+                                                  size_t previous_size,
+                                                  size_t* size) {
+  const size_t class_size = BlockPool::ClassSize(*size);
+  if (class_size != 0 && class_size == previous_size) {
+    *size = class_size;
+    return ptr;
+  }
+
+  char* mem = nullptr;
+  if (*size > 0) {
+    if (class_size != 0) {
+      *size = class_size;
+      mem = pool->Take(class_size);
+    }
+    if (mem == nullptr) mem = UncheckedMalloc(*size);
+    if (mem == nullptr) return nullptr;
+    if (ptr != nullptr) memcpy(mem, ptr, std::min(previous_size, *size));
+  }
+  if (ptr != nullptr && !pool->Put(ptr, previous_size)) free(ptr);
+  return mem;
+}
+
 template <typename Class, typename T>
 void* NgLibMemoryManager<Class, T>::ReallocImpl(void* ptr,
                                              size_t size,
@@ -49,7 +118,10 @@ void* NgLibMemoryManager<Class, T>::ReallocImpl(void* ptr,
 
   manager->CheckAllocatedSize(previous_size);
 
-  char* mem = UncheckedRealloc(original_ptr, size);
+  BlockPool* pool = static_cast<NgLibMemoryManager*>(manager)->pool_.get();
+  char* mem = pool != nullptr
+                  ? PooledRealloc(pool, original_ptr, previous_size, &size)
+                  : UncheckedRealloc(original_ptr, size);
 
   if (mem != nullptr) {
     // Adjust the memory info counter.
@@ -4,6 +4,8 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace node {
 namespace mem {
@@ -13,6 +15,39 @@ namespace mem {
 // use different struct names. To allow for code re-use,
 // the NgLibMemoryManager template class can be used for both.
 
+// A cache of freed small blocks, grouped by power-of-two size class, so that
+// a memory manager can reuse its own recent allocations instead of going back
+// to the general heap for each of them. Every block is a separate heap
+// allocation, so a block that leaves the pool can always be free()d.
+class BlockPool {
+ public:
+  static constexpr size_t kMinClassShift = 5;   // 32 bytes
+  static constexpr size_t kMaxClassShift = 10;  // 1 KiB
+  // Upper bound on the memory held in free blocks.
+  static constexpr size_t kMaxCachedBytes = 16 * 1024;
+
+  BlockPool() = default;
+  inline ~BlockPool();
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  // Returns the class size that |size| is rounded up to, or 0 if |size| is
+  // 0 or too large to be pooled.
+  static inline size_t ClassSize(size_t size);
+
+  // Returns a free block of |class_size| bytes, or nullptr.
+  inline char* Take(size_t class_size);
+  // Keeps |block| of |class_size| bytes for reuse. Returns false if it was
+  // not taken, in which case the caller frees it.
+  inline bool Put(char* block, size_t class_size);
+
+ private:
+  static inline size_t ClassIndex(size_t class_size);
+
+  std::vector<char*> free_[kMaxClassShift - kMinClassShift + 1];
+  size_t cached_bytes_ = 0;
+};
+
 struct NgLibMemoryManagerBase {
   virtual void StopTrackingMemory(void* ptr) = 0;
 };
@@ -30,11 +65,22 @@ class NgLibMemoryManager : public NgLibMemoryManagerBase {
 
   void StopTrackingMemory(void* ptr) override;
 
+ protected:
+  // Opts in to reusing freed small blocks through a BlockPool. Must be called
+  // before the first allocation.
+  void EnableBlockPool() { pool_ = std::make_unique<BlockPool>(); }
+
  private:
+  static char* PooledRealloc(BlockPool* pool,
+                             char* ptr,
+                             size_t previous_size,
+                             size_t* size);
   static void* ReallocImpl(void* ptr, size_t size, void* user_data);
   static void* MallocImpl(size_t size, void* user_data);
   static void FreeImpl(void* ptr, void* user_data);
   static void* CallocImpl(size_t nmemb, size_t size, void* user_data);
+
+  std::unique_ptr<BlockPool> pool_;
 };
 
 }  // namespace mem
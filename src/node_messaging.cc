@@ -29,12 +29,14 @@ using v8::Local;
 using v8::Maybe;
 using v8::MaybeLocal;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::SharedArrayBuffer;
 using v8::SharedValueConveyor;
 using v8::String;
 using v8::Symbol;
+using v8::Uint32;
 using v8::Value;
 using v8::ValueDeserializer;
 using v8::ValueSerializer;
@@ -214,6 +216,11 @@ MaybeLocal<Value> Message::Deserialize(Environment* env,
         ArrayBuffer::New(env->isolate(), std::move(array_buffers_[i]));
     deserializer.TransferArrayBuffer(i, ab);
   }
+  for (uint32_t i = 0; i < read_only_array_buffers_.size(); ++i) {
+    Local<ArrayBuffer> ab =
+        ArrayBuffer::New(env->isolate(), read_only_array_buffers_[i]);
+    deserializer.TransferArrayBuffer(array_buffers_.size() + i, ab);
+  }
 
   if (deserializer.ReadHeader(context).IsNothing())
     return {};
@@ -312,6 +319,16 @@ class SerializerDelegate : public ValueSerializer::Delegate {
       return Just(true);
     }
 
+    // Fast path for plain objects, which is what most messages consist of:
+    // JSTransferables are always class instances, so an object whose
+    // prototype is Object.prototype or null cannot be one and does not need
+    // the private symbol lookup below. Anything else falls through to it.
+    if (object->InternalFieldCount() == 0) {
+      Local<Value> prototype = object->GetPrototypeV2();
+      if (prototype->IsNull() || prototype == object_prototype_)
+        return Just(false);
+    }
+
     return Just(JSTransferable::IsJSTransferable(env_, context_, object));
   }
 
@@ -391,6 +408,11 @@ class SerializerDelegate : public ValueSerializer::Delegate {
     return Just(true);
   }
 
+  // Enables the plain object fast path in IsHostObject().
+  void set_object_prototype(Local<Value> prototype) {
+    object_prototype_ = prototype;
+  }
+
   inline void AddHostObject(BaseObjectPtr<BaseObject> host_object) {
     // Make sure we have not started serializing the value itself yet.
     CHECK_EQ(first_cloned_object_index_, SIZE_MAX);
@@ -448,6 +470,8 @@ class SerializerDelegate : public ValueSerializer::Delegate {
   Environment* env_;
   Local<Context> context_;
   Message* msg_;
+  // Object.prototype of the serializing context.
+  Local<Value> object_prototype_;
   std::vector<Global<SharedArrayBuffer>> seen_shared_array_buffers_;
   std::vector<BaseObjectPtr<BaseObject>> host_objects_;
   size_t first_cloned_object_index_ = SIZE_MAX;
@@ -461,7 +485,8 @@ Maybe<bool> Message::Serialize(Environment* env,
                                Local<Context> context,
                                Local<Value> input,
                                const TransferList& transfer_list_v,
-                               Local<Object> source_port) {
+                               Local<Object> source_port,
+                               const TransferList& share_list_v) {
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(context);
 
@@ -572,6 +597,38 @@ Maybe<bool> Message::Serialize(Environment* env,
   if (delegate.AddNestedHostObjects().IsNothing())
     return Nothing<bool>();
 
+  // Shared ArrayBuffers use the IDs after those of the transferred ones, and
+  // stay usable in this Isolate.
+  std::vector<Local<ArrayBuffer>> shared_array_buffers;
+  for (uint32_t i = 0; i < share_list_v.length(); ++i) {
+    Local<Value> entry = share_list_v[i];
+    if (!entry->IsArrayBuffer() || entry.As<ArrayBuffer>()->WasDetached() ||
+        entry.As<ArrayBuffer>()->IsResizableByUserJavaScript()) {
+      ThrowDataCloneException(context, env->transfer_unsupported_type_str());
+      return Nothing<bool>();
+    }
+    Local<ArrayBuffer> ab = entry.As<ArrayBuffer>();
+    if (std::find(array_buffers.begin(), array_buffers.end(), ab) !=
+            array_buffers.end() ||
+        std::find(shared_array_buffers.begin(),
+                  shared_array_buffers.end(),
+                  ab) != shared_array_buffers.end()) {
+      ThrowDataCloneException(
+          context,
+          FIXED_ONE_BYTE_STRING(
+              env->isolate(),
+              "Transfer list contains duplicate ArrayBuffer"));
+      return Nothing<bool>();
+    }
+    serializer.TransferArrayBuffer(
+        array_buffers.size() + shared_array_buffers.size(), ab);
+    shared_array_buffers.push_back(ab);
+  }
+
+  if (input->IsObject()) {
+    delegate.set_object_prototype(
+        Object::New(env->isolate())->GetPrototypeV2());
+  }
   serializer.WriteHeader();
   if (serializer.WriteValue(context, input).IsNothing()) {
     return Nothing<bool>();
@@ -584,6 +641,8 @@ Maybe<bool> Message::Serialize(Environment* env,
 
     array_buffers_.emplace_back(std::move(backing_store));
   }
+  for (Local<ArrayBuffer> ab : shared_array_buffers)
+    read_only_array_buffers_.emplace_back(ab->GetBackingStore());
 
   if (delegate.Finish(context).IsNothing())
     return Nothing<bool>();
@@ -599,7 +658,61 @@ Maybe<bool> Message::Serialize(Environment* env,
 void Message::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("array_buffers_", array_buffers_);
   tracker->TrackField("shared_array_buffers", shared_array_buffers_);
+  tracker->TrackField("read_only_array_buffers", read_only_array_buffers_);
   tracker->TrackField("transferables", transferables_);
+  // The shared objects themselves live in the shared heap and are reported
+  // by V8; the conveyor only holds handles that keep them alive.
+  if (shared_value_conveyor_.has_value()) {
+    tracker->TrackFieldWithSize("shared_value_conveyor",
+                                sizeof(SharedValueConveyor));
+  }
+}
+
+IncomingMessageQueue::IncomingMessageQueue()
+    : head_(new Node()), tail_(head_.load()) {}
+
+IncomingMessageQueue::~IncomingMessageQueue() {
+  while (Pop()) {
+  }
+  delete tail_;
+}
+
+bool IncomingMessageQueue::Push(std::shared_ptr<Message> message) {
+  Node* node = new Node();
+  node->message = std::move(message);
+  Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+  // Until this store, the consumer cannot see `node` or anything pushed
+  // after it.
+  prev->next.store(node, std::memory_order_release);
+  posted_.fetch_add(1, std::memory_order_relaxed);
+  // The count is only raised once the node is linked, so a consumer that
+  // finds no message while size() is not zero knows that a Push() is still
+  // in progress.
+  return size_.fetch_add(1) == 0;
+}
+
+Message* IncomingMessageQueue::Peek() const {
+  Node* next = tail_->next.load(std::memory_order_acquire);
+  return next != nullptr ? next->message.get() : nullptr;
+}
+
+std::shared_ptr<Message> IncomingMessageQueue::Pop() {
+  Node* next = tail_->next.load(std::memory_order_acquire);
+  if (next == nullptr) return {};
+  std::shared_ptr<Message> message = std::move(next->message);
+  delete tail_;
+  tail_ = next;
+  size_.fetch_sub(1);
+  received_++;
+  return message;
+}
+
+void IncomingMessageQueue::MemoryInfo(MemoryTracker* tracker) const {
+  for (Node* node = tail_->next.load(std::memory_order_acquire);
+       node != nullptr;
+       node = node->next.load(std::memory_order_acquire)) {
+    tracker->TrackField("message", node->message);
+  }
 }
 
 MessagePortData::MessagePortData(MessagePort* owner)
@@ -612,17 +725,19 @@ MessagePortData::~MessagePortData() {
 }
 
 void MessagePortData::MemoryInfo(MemoryTracker* tracker) const {
-  Mutex::ScopedLock lock(mutex_);
   tracker->TrackField("incoming_messages", incoming_messages_);
 }
 
 void MessagePortData::AddToIncomingQueue(std::shared_ptr<Message> message) {
-  // This function will be called by other threads.
-  Mutex::ScopedLock lock(mutex_);
-  incoming_messages_.emplace_back(std::move(message));
+  // This function will be called by other threads. Only the sender that
+  // finds the queue empty wakes up the owner; the others rely on the owner
+  // draining the queue before it goes back to sleep.
+  if (!incoming_messages_.Push(std::move(message))) return;
 
+  Mutex::ScopedLock lock(mutex_);
   if (owner_ != nullptr) {
     Debug(owner_, "Adding message to incoming queue");
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
     owner_->TriggerAsync();
   }
 }
@@ -758,7 +873,8 @@ MaybeLocal<Value> MessagePort::ReceiveMessage(Local<Context> context,
   std::shared_ptr<Message> received;
   {
     // Get the head of the message queue.
-    Mutex::ScopedLock lock(data_->mutex_);
+    IncomingMessageQueue* queue = &data_->incoming_messages_;
+    Message* front = queue->Peek();
 
     Debug(this, "MessagePort has message");
 
@@ -769,14 +885,20 @@ MaybeLocal<Value> MessagePort::ReceiveMessage(Local<Context> context,
     // - There are no pending messages
     // - We are not intending to receive messages, and the message we would
     //   receive is not the final "close" message.
-    if (data_->incoming_messages_.empty() ||
-        (!wants_message &&
-         !data_->incoming_messages_.front()->IsCloseMessage())) {
+    if (front == nullptr) {
+      // A sender is between linking its message and counting it, and will
+      // not wake us up because the queue was not empty. Check again later.
+      if (queue->size() > 0) {
+        Mutex::ScopedLock lock(data_->mutex_);
+        TriggerAsync();
+      }
+      return env()->no_message_symbol();
+    }
+    if (!wants_message && !front->IsCloseMessage()) {
       return env()->no_message_symbol();
     }
 
-    received = data_->incoming_messages_.front();
-    data_->incoming_messages_.pop_front();
+    received = queue->Pop();
   }
 
   if (received->IsCloseMessage()) {
@@ -804,13 +926,17 @@ void MessagePort::OnMessage(MessageProcessingMode mode) {
 
   size_t processing_limit;
   if (mode == MessageProcessingMode::kNormalOperation) {
-    Mutex::ScopedLock lock(data_->mutex_);
     processing_limit = std::max(data_->incoming_messages_.size(),
                                 static_cast<size_t>(1000));
   } else {
     processing_limit = std::numeric_limits<size_t>::max();
   }
 
+  if (mode == MessageProcessingMode::kNormalOperation &&
+      batch_max_count_ > 1) {
+    return OnMessageBatch(context, processing_limit);
+  }
+
   // data_ can only ever be modified by the owner thread, so no need to lock.
   // However, the message port may be transferred while it is processing
   // messages, so we need to check that this handle still owns its `data_` field
@@ -876,6 +1002,91 @@ void MessagePort::OnMessage(MessageProcessingMode mode) {
   }
 }
 
+void MessagePort::OnMessageBatch(Local<Context> context,
+                                 size_t processing_limit) {
+  Isolate* isolate = env()->isolate();
+  const MessageProcessingMode mode = MessageProcessingMode::kNormalOperation;
+
+  // Same as OnMessage(), except that one MakeCallback() delivers up to
+  // batch_max_count_ messages. A message that fails to deserialize ends the
+  // batch, so that the 'messageerror' event keeps its place in the order.
+  while (data_) {
+    HandleScope handle_scope(isolate);
+    Context::Scope context_scope(context);
+    Local<Function> emit_message = PersistentToLocal::Strong(emit_message_fn_);
+
+    std::vector<Local<Value>> payloads;
+    std::vector<Local<Value>> port_lists;
+    Local<Value> message_error;
+    bool failed = false;
+    bool drained = false;
+    const uint64_t start = uv_hrtime();
+
+    while (payloads.size() < batch_max_count_ && processing_limit > 0) {
+      Local<Value> payload;
+      Local<Value> port_list = Undefined(isolate);
+      {
+        TryCatchScope try_catch(env());
+        if (!ReceiveMessage(context, mode, &port_list).ToLocal(&payload)) {
+          if (try_catch.HasCaught() && !try_catch.HasTerminated())
+            message_error = try_catch.Exception();
+          failed = true;
+          break;
+        }
+      }
+      if (payload == env()->no_message_symbol()) {
+        drained = true;
+        break;
+      }
+      processing_limit--;
+
+      // Without JS, there is nothing to do but to drain the queue.
+      if (!env()->can_call_into_js()) continue;
+      payloads.push_back(payload);
+      port_lists.push_back(port_list);
+
+      if (batch_max_time_ns_ != 0 &&
+          uv_hrtime() - start >= batch_max_time_ns_) {
+        break;
+      }
+    }
+
+    if (!payloads.empty()) {
+      Local<Value> argv[] = {
+          Array::New(isolate, payloads.data(), payloads.size()),
+          Array::New(isolate, port_lists.data(), port_lists.size()),
+          env()->messagebatch_string(),
+      };
+      if (MakeCallback(emit_message, arraysize(argv), argv).IsEmpty()) {
+        if (data_) TriggerAsync();
+        return;
+      }
+    }
+
+    if (failed) {
+      if (!message_error.IsEmpty()) {
+        Local<Value> argv[] = {
+            message_error,
+            Undefined(isolate),
+            env()->messageerror_string(),
+        };
+        USE(MakeCallback(emit_message, arraysize(argv), argv));
+      }
+      // Re-schedule OnMessageBatch() execution in case of failure.
+      if (data_) TriggerAsync();
+      return;
+    }
+
+    if (drained) return;
+
+    if (processing_limit == 0) {
+      // See OnMessage() for why the rest waits for another iteration.
+      TriggerAsync();
+      return;
+    }
+  }
+}
+
 void MessagePort::OnClose() {
   Debug(this, "MessagePort::OnClose()");
   if (data_) {
@@ -913,7 +1124,8 @@ BaseObjectPtr<BaseObject> MessagePortData::Deserialize(
 Maybe<bool> MessagePort::PostMessage(Environment* env,
                                      Local<Context> context,
                                      Local<Value> message_v,
-                                     const TransferList& transfer_v) {
+                                     const TransferList& transfer_v,
+                                     const TransferList& share_v) {
   Isolate* isolate = env->isolate();
   Local<Object> obj = object(isolate);
   TryCatchScope try_catch(env);
@@ -924,7 +1136,7 @@ Maybe<bool> MessagePort::PostMessage(Environment* env,
   // serialize the input message, even if the MessagePort is closed or detached.
 
   Maybe<bool> serialization_maybe =
-      msg->Serialize(env, context, message_v, transfer_v, obj);
+      msg->Serialize(env, context, message_v, transfer_v, obj, share_v);
   if (try_catch.HasCaught() && !try_catch.HasTerminated()) {
     try_catch.ReThrow();
   }
@@ -1017,10 +1229,12 @@ static Maybe<bool> ReadIterable(Environment* env,
   return Just(true);
 }
 
+// If share_list_out is given, options.shareReadOnly is read into it.
 bool GetTransferList(Environment* env,
                      Local<Context> context,
                      Local<Value> transfer_list_v,
-                     TransferList* transfer_list_out) {
+                     TransferList* transfer_list_out,
+                     TransferList* share_list_out = nullptr) {
   if (transfer_list_v->IsNullOrUndefined()) {
     // Browsers ignore null or undefined, and otherwise accept an array or an
     // options object.
@@ -1053,6 +1267,25 @@ bool GetTransferList(Environment* env,
         return false;
       }
     }
+
+    if (share_list_out != nullptr) {
+      Local<Value> share_option;
+      if (!transfer_list_v.As<Object>()
+               ->Get(context, env->share_read_only_string())
+               .ToLocal(&share_option))
+        return false;
+      if (!share_option->IsUndefined()) {
+        if (!ReadIterable(env, context, *share_list_out, share_option)
+                 .To(&was_iterable))
+          return false;
+        if (!was_iterable) {
+          THROW_ERR_INVALID_ARG_TYPE(
+              env,
+              "Optional options.shareReadOnly argument must be an iterable");
+          return false;
+        }
+      }
+    }
   }
 
   return true;
@@ -1069,7 +1302,8 @@ void MessagePort::PostMessage(const FunctionCallbackInfo<Value>& args) {
   }
 
   TransferList transfer_list;
-  if (!GetTransferList(env, context, args[1], &transfer_list)) {
+  TransferList share_list;
+  if (!GetTransferList(env, context, args[1], &transfer_list, &share_list)) {
     return;
   }
   MessagePort* port = Unwrap<MessagePort>(args.This());
@@ -1078,11 +1312,12 @@ void MessagePort::PostMessage(const FunctionCallbackInfo<Value>& args) {
   // transfers.
   if (port == nullptr || port->IsHandleClosing()) {
     Message msg;
-    USE(msg.Serialize(env, context, args[0], transfer_list, obj));
+    USE(msg.Serialize(env, context, args[0], transfer_list, obj, share_list));
     return;
   }
 
-  Maybe<bool> res = port->PostMessage(env, context, args[0], transfer_list);
+  Maybe<bool> res =
+      port->PostMessage(env, context, args[0], transfer_list, share_list);
   if (res.IsJust())
     args.GetReturnValue().Set(res.FromJust());
 }
@@ -1091,7 +1326,7 @@ void MessagePort::Start() {
   Debug(this, "Start receiving messages");
   receiving_messages_ = true;
   Mutex::ScopedLock lock(data_->mutex_);
-  if (!data_->incoming_messages_.empty())
+  if (data_->incoming_messages_.size() > 0)
     TriggerAsync();
 }
 
@@ -1132,6 +1367,45 @@ void MessagePort::Drain(const FunctionCallbackInfo<Value>& args) {
   port->OnMessage(MessageProcessingMode::kForceReadMessages);
 }
 
+size_t MessagePort::queued_messages() const {
+  return data_ ? data_->incoming_messages_.size() : 0;
+}
+
+void MessagePort::GetStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  MessagePort* port;
+  ASSIGN_OR_RETURN_UNWRAP(&port, args[0].As<Object>());
+  if (!port->data_) return;
+  const MessagePortData* data = port->data_.get();
+  Local<Value> values[] = {
+      Number::New(env->isolate(),
+                  static_cast<double>(data->incoming_messages_.posted())),
+      Number::New(env->isolate(),
+                  static_cast<double>(data->incoming_messages_.received())),
+      Number::New(env->isolate(),
+                  static_cast<double>(
+                      data->wakeups_.load(std::memory_order_relaxed))),
+      Number::New(env->isolate(),
+                  static_cast<double>(data->incoming_messages_.size())),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
+void MessagePort::SetBatching(const FunctionCallbackInfo<Value>& args) {
+  // args[0] == MessagePort
+  // args[1] == Maximum number of messages per batch, 0 or 1 to disable
+  // args[2] == Maximum time to spend collecting a batch in ms, 0 for no limit
+  MessagePort* port;
+  ASSIGN_OR_RETURN_UNWRAP(&port, args[0].As<Object>());
+  CHECK(args[1]->IsUint32());
+  CHECK(args[2]->IsNumber());
+  const double max_time_ms = args[2].As<Number>()->Value();
+  CHECK_GE(max_time_ms, 0);
+  port->batch_max_count_ = args[1].As<Uint32>()->Value();
+  port->batch_max_time_ns_ = static_cast<uint64_t>(max_time_ms * 1e6);
+}
+
 void MessagePort::ReceiveMessage(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   if (!args[0]->IsObject() ||
@@ -1674,6 +1948,10 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "stopMessagePort", MessagePort::Stop);
   SetMethod(isolate, target, "checkMessagePort", MessagePort::CheckType);
   SetMethod(isolate, target, "drainMessagePort", MessagePort::Drain);
+  SetMethodNoSideEffect(
+      isolate, target, "getMessagePortStats", MessagePort::GetStats);
+  SetMethod(
+      isolate, target, "setMessagePortBatching", MessagePort::SetBatching);
   SetMethod(
       isolate, target, "receiveMessageOnPort", MessagePort::ReceiveMessage);
   SetMethod(
@@ -1710,6 +1988,8 @@ static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(MessagePort::Stop);
   registry->Register(MessagePort::CheckType);
   registry->Register(MessagePort::Drain);
+  registry->Register(MessagePort::GetStats);
+  registry->Register(MessagePort::SetBatching);
   registry->Register(MessagePort::ReceiveMessage);
   registry->Register(MessagePort::MoveToContext);
   registry->Register(SetDeserializerCreateObjectFunction);
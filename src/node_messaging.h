@@ -6,7 +6,7 @@
 #include "env.h"
 #include "node_mutex.h"
 #include "v8.h"
-#include <deque>
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <set>
@@ -72,12 +72,16 @@ class Message : public MemoryRetainer {
   // deserialization.
   // The source_port parameter, if provided, will make Serialize() throw a
   // "DataCloneError" DOMException if source_port is found in transfer_list.
+  // The ArrayBuffers in share_list are neither copied nor detached: the
+  // receiver gets an ArrayBuffer over the same BackingStore. Neither side
+  // may modify their contents afterwards.
   v8::Maybe<bool> Serialize(Environment* env,
                             v8::Local<v8::Context> context,
                             v8::Local<v8::Value> input,
                             const TransferList& transfer_list,
                             v8::Local<v8::Object> source_port =
-                                v8::Local<v8::Object>());
+                                v8::Local<v8::Object>(),
+                            const TransferList& share_list = TransferList());
 
   // Internal method of Message that is called when a new SharedArrayBuffer
   // object is encountered in the incoming value's structure.
@@ -115,6 +119,10 @@ class Message : public MemoryRetainer {
   // with C++17.
   std::vector<std::shared_ptr<v8::BackingStore>> array_buffers_;
   std::vector<std::shared_ptr<v8::BackingStore>> shared_array_buffers_;
+  // Stores of ArrayBuffers passed in Serialize()'s share_list. Unlike
+  // array_buffers_, these are not consumed by Deserialize(), so a message
+  // can carry them to every port of a BroadcastChannel.
+  std::vector<std::shared_ptr<v8::BackingStore>> read_only_array_buffers_;
   std::vector<std::unique_ptr<TransferData>> transferables_;
   std::vector<v8::CompiledWasmModule> wasm_modules_;
   std::optional<v8::SharedValueConveyor> shared_value_conveyor_;
@@ -167,6 +175,52 @@ class SiblingGroup final : public std::enable_shared_from_this<SiblingGroup> {
   static Map groups_;
 };
 
+// The incoming messages of a MessagePortData. Any thread may push without
+// taking a lock, while only the thread that currently owns the receiving
+// port pops. This is Dmitry Vyukov's non-intrusive MPSC queue: producers swap
+// themselves in at the head, and the consumer follows `next` pointers from a
+// stub node at the tail.
+class IncomingMessageQueue : public MemoryRetainer {
+ public:
+  IncomingMessageQueue();
+  ~IncomingMessageQueue() override;
+
+  IncomingMessageQueue(const IncomingMessageQueue&) = delete;
+  IncomingMessageQueue& operator=(const IncomingMessageQueue&) = delete;
+
+  // Returns true if the queue was empty, i.e. the consumer needs a wakeup.
+  // This may be called from any thread.
+  bool Push(std::shared_ptr<Message> message);
+
+  // Returns the oldest message without removing it, or nullptr if there is
+  // none. A message whose Push() has not completed yet, and every message
+  // behind it, is not visible, so this can return nullptr even though
+  // size() is not zero.
+  Message* Peek() const;
+  std::shared_ptr<Message> Pop();
+
+  // The number of messages pushed and not yet popped.
+  size_t size() const { return size_.load(); }
+  uint64_t posted() const { return posted_.load(std::memory_order_relaxed); }
+  uint64_t received() const { return received_; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(IncomingMessageQueue)
+  SET_SELF_SIZE(IncomingMessageQueue)
+
+ private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    std::shared_ptr<Message> message;
+  };
+
+  std::atomic<Node*> head_;  // The most recently pushed node.
+  Node* tail_;               // The stub node, owned by the consumer.
+  std::atomic<size_t> size_{0};
+  std::atomic<uint64_t> posted_{0};
+  uint64_t received_ = 0;
+};
+
 // This contains all data for a `MessagePort` instance that is not tied to
 // a specific Environment/Isolate/event loop, for easier transfer between those.
 class MessagePortData : public TransferData {
@@ -206,13 +260,16 @@ class MessagePortData : public TransferData {
   SET_SELF_SIZE(MessagePortData)
 
  private:
-  // This mutex protects all fields below it, with the exception of
-  // sibling_.
-  mutable Mutex mutex_;
   // TODO(addaleax): Make this a std::variant<std::shared_ptr, std::unique_ptr>
   // once that is available with C++17, because std::shared_ptr comes with
   // overhead that is only necessary for BroadcastChannel.
-  std::deque<std::shared_ptr<Message>> incoming_messages_;
+  IncomingMessageQueue incoming_messages_;
+  // The number of times the owner was woken up for new messages. Pushing
+  // onto a queue that is not empty does not wake it up again.
+  std::atomic<uint64_t> wakeups_{0};
+  // This mutex protects all fields below it. It is only taken by senders
+  // when the queue was empty.
+  mutable Mutex mutex_;
   MessagePort* owner_ = nullptr;
   std::shared_ptr<SiblingGroup> group_;
   friend class MessagePort;
@@ -248,7 +305,8 @@ class MessagePort : public HandleWrap {
   v8::Maybe<bool> PostMessage(Environment* env,
                               v8::Local<v8::Context> context,
                               v8::Local<v8::Value> message,
-                              const TransferList& transfer);
+                              const TransferList& transfer,
+                              const TransferList& share = TransferList());
 
   // Start processing messages on this port as a receiving end.
   void Start();
@@ -264,6 +322,8 @@ class MessagePort : public HandleWrap {
   static void CheckType(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Drain(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void ReceiveMessage(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetStats(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetBatching(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   /* static */
   static void MoveToContext(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -290,6 +350,9 @@ class MessagePort : public HandleWrap {
   // NULL pointer to the C++ MessagePort object is also detached.
   inline bool IsDetached() const;
 
+  // The number of messages that have arrived but not been emitted yet.
+  size_t queued_messages() const;
+
   BaseObject::TransferMode GetTransferMode() const override;
   std::unique_ptr<TransferData> TransferForMessaging() override;
 
@@ -305,6 +368,7 @@ class MessagePort : public HandleWrap {
 
   void OnClose() override;
   void OnMessage(MessageProcessingMode mode);
+  void OnMessageBatch(v8::Local<v8::Context> context, size_t processing_limit);
   void TriggerAsync();
   v8::MaybeLocal<v8::Value> ReceiveMessage(
       v8::Local<v8::Context> context,
@@ -313,6 +377,11 @@ class MessagePort : public HandleWrap {
 
   std::unique_ptr<MessagePortData> data_ = nullptr;
   bool receiving_messages_ = false;
+  // When batch_max_count_ is greater than one, messages are emitted as
+  // 'messagebatch' events carrying arrays of up to that many payloads,
+  // collected for at most batch_max_time_ns_ (if non-zero).
+  size_t batch_max_count_ = 0;
+  uint64_t batch_max_time_ns_ = 0;
   uv_async_t async_;
   v8::Global<v8::Function> emit_message_fn_;
 
@@ -0,0 +1,501 @@
+#include "node_metrics.h"
+#include "env-inl.h"
+#include "handle_wrap.h"
+#include "histogram-inl.h"
+#include "node_debug.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "node_internals.h"
+#include "util-inl.h"
+#include "v8-fast-api-calls.h"
+#include "v8.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace node {
+namespace metrics {
+
+using v8::CFunction;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::GCCallbackFlags;
+using v8::GCType;
+using v8::HeapStatistics;
+using v8::Isolate;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::String;
+using v8::Value;
+
+namespace {
+
+constexpr double kSummaryQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+bool IsValidName(std::string_view name) {
+  if (name.empty()) return false;
+  for (size_t i = 0; i < name.size(); i++) {
+    char c = name[i];
+    bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                 c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+    if (!valid) return false;
+  }
+  return true;
+}
+
+void AppendDouble(std::string* out, double value) {
+  if (std::isnan(value)) {
+    out->append("NaN");
+  } else if (std::isinf(value)) {
+    out->append(value > 0 ? "+Inf" : "-Inf");
+  } else {
+    // Use the shorter precision when it reads back as the same value, so
+    // that e.g. the 0.9 quantile is not labelled 0.90000000000000002.
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%.15g", value);
+    if (strtod(buf, nullptr) != value)
+      len = snprintf(buf, sizeof(buf), "%.17g", value);
+    out->append(buf, len);
+  }
+}
+
+void AppendUint(std::string* out, uint64_t value) {
+  char buf[24];
+  int len = snprintf(buf, sizeof(buf), "%" PRIu64, value);
+  out->append(buf, len);
+}
+
+// HELP text escapes backslashes and line feeds.
+void AppendEscaped(std::string* out, std::string_view text) {
+  for (char c : text) {
+    if (c == '\\') {
+      out->append("\\\\");
+    } else if (c == '\n') {
+      out->append("\\n");
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+void AppendMetadata(std::string* out,
+                    std::string_view name,
+                    const char* type,
+                    std::string_view help) {
+  out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+  if (!help.empty()) {
+    out->append("# HELP ").append(name).append(" ");
+    AppendEscaped(out, help);
+    out->append("\n");
+  }
+}
+
+void AppendGauge(std::string* out,
+                 std::string_view name,
+                 std::string_view help,
+                 double value) {
+  AppendMetadata(out, name, "gauge", help);
+  out->append(name).append(" ");
+  AppendDouble(out, value);
+  out->append("\n");
+}
+
+const char* TypeName(Metric::Type type) {
+  switch (type) {
+    case Metric::Type::kCounter:
+      return "counter";
+    case Metric::Type::kGauge:
+      return "gauge";
+    case Metric::Type::kHistogram:
+      return "summary";
+  }
+  UNREACHABLE();
+}
+
+// GC pauses of the isolate of this thread, for the runtime metrics.
+thread_local uint64_t gc_start_time = 0;
+thread_local bool gc_callbacks_installed = false;
+
+void GCPrologue(Isolate* isolate, GCType type, GCCallbackFlags flags) {
+  gc_start_time = uv_hrtime();
+}
+
+void GCEpilogue(Isolate* isolate, GCType type, GCCallbackFlags flags) {
+  if (gc_start_time == 0) return;
+  const RuntimeMetrics& metrics = runtime();
+  metrics.gc_runs->Increment();
+  metrics.gc_duration->Record(uv_hrtime() - gc_start_time);
+  gc_start_time = 0;
+}
+
+void RemoveGCCallbacks(void* data) {
+  Isolate* isolate = static_cast<Isolate*>(data);
+  isolate->RemoveGCPrologueCallback(GCPrologue);
+  isolate->RemoveGCEpilogueCallback(GCEpilogue);
+  gc_callbacks_installed = false;
+}
+
+}  // namespace
+
+void Counter::RenderSamples(std::string* out) const {
+  out->append(name()).append("_total ");
+  AppendUint(out, value());
+  out->append("\n");
+}
+
+void Gauge::RenderSamples(std::string* out) const {
+  out->append(name()).append(" ");
+  AppendDouble(out, value());
+  out->append("\n");
+}
+
+HistogramMetric::HistogramMetric(std::string_view name,
+                                 std::string_view help,
+                                 double scale)
+    : Metric(kType, name, help),
+      histogram_(Histogram::Options{.concurrent = true}),
+      scale_(scale) {}
+
+void HistogramMetric::Record(int64_t value) {
+  histogram_.histogram()->Record(value);
+}
+
+void HistogramMetric::RenderSamples(std::string* out) const {
+  const Histogram& histogram = *histogram_.histogram();
+  const size_t count = histogram.Count();
+  for (double quantile : kSummaryQuantiles) {
+    out->append(name()).append("{quantile=\"");
+    AppendDouble(out, quantile);
+    out->append("\"} ");
+    AppendDouble(out,
+                 count > 0 ? histogram.Percentile(quantile * 100) * scale_
+                           : std::nan(""));
+    out->append("\n");
+  }
+  // The HDR histogram keeps no sum, so it is derived from the mean.
+  out->append(name()).append("_sum ");
+  AppendDouble(out, count > 0 ? histogram.Mean() * count * scale_ : 0);
+  out->append("\n");
+  out->append(name()).append("_count ");
+  AppendUint(out, count);
+  out->append("\n");
+}
+
+Registry* Registry::Get() {
+  return &LeakedSingleton<Registry>::Get();
+}
+
+template <typename T, typename... Args>
+T* Registry::GetOrCreate(std::string_view name,
+                         std::string_view help,
+                         Args... args) {
+  if (!IsValidName(name)) return nullptr;
+  Mutex::ScopedLock lock(mutex_);
+  auto it = ids_.find(std::string(name));
+  if (it != ids_.end()) {
+    Metric* metric = metrics_[it->second].get();
+    return metric->type() == T::kType ? static_cast<T*>(metric) : nullptr;
+  }
+  const size_t id = size_.load(std::memory_order_relaxed);
+  if (id == kMaxMetrics) return nullptr;
+  T* metric = new T(name, help, args...);
+  metrics_[id].reset(metric);
+  ids_.emplace(name, id);
+  size_.store(id + 1, std::memory_order_release);
+  return metric;
+}
+
+Counter* Registry::GetCounter(std::string_view name, std::string_view help) {
+  return GetOrCreate<Counter>(name, help);
+}
+
+Gauge* Registry::GetGauge(std::string_view name, std::string_view help) {
+  return GetOrCreate<Gauge>(name, help);
+}
+
+HistogramMetric* Registry::GetHistogram(std::string_view name,
+                                        std::string_view help,
+                                        double scale) {
+  return GetOrCreate<HistogramMetric>(name, help, scale);
+}
+
+int32_t Registry::GetId(const Metric* metric) const {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = ids_.find(metric->name());
+  CHECK(it != ids_.end());
+  return it->second;
+}
+
+void Registry::Render(std::string* out) const {
+  // The registry only grows, so nothing below size_ can change under us.
+  const size_t size = size_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < size; i++) {
+    const Metric* metric = metrics_[i].get();
+    AppendMetadata(out, metric->name(), TypeName(metric->type()),
+                   metric->help());
+    metric->RenderSamples(out);
+  }
+}
+
+const RuntimeMetrics& runtime() {
+  static const RuntimeMetrics metrics = [] {
+    Registry* registry = Registry::Get();
+    return RuntimeMetrics{
+        registry->GetCounter("nodejs_http_messages",
+                             "HTTP messages parsed by the native parser."),
+        registry->GetCounter("nodejs_fs_requests",
+                             "Asynchronous file system requests completed."),
+        registry->GetCounter("nodejs_gc_runs", "Garbage collections."),
+        registry->GetHistogram("nodejs_gc_duration_seconds",
+                               "Garbage collection pauses.",
+                               1e-9),
+        registry->GetGauge("nodejs_napi_references",
+                           "Live Node-API references and finalizers."),
+        registry->GetGauge("nodejs_napi_pending_finalizers",
+                           "Node-API finalizers waiting to run."),
+    };
+  }();
+  return metrics;
+}
+
+void RenderOpenMetrics(Environment* env, std::string* out) {
+  runtime();
+  Registry::Get()->Render(out);
+
+  size_t handles = 0;
+  for (HandleWrap* w : *env->handle_wrap_queue()) {
+    if (HandleWrap::HasRef(w)) handles++;
+  }
+  AppendGauge(out,
+              "nodejs_active_handles",
+              "Referenced libuv handles of this thread.",
+              handles);
+  size_t requests = 0;
+  for (ReqWrapBase* req_wrap : *env->req_wrap_queue()) {
+    USE(req_wrap);
+    requests++;
+  }
+  AppendGauge(out,
+              "nodejs_active_requests",
+              "Pending libuv requests of this thread.",
+              requests);
+
+  HeapStatistics heap;
+  env->isolate()->GetHeapStatistics(&heap);
+  AppendGauge(out,
+              "nodejs_heap_used_bytes",
+              "V8 heap in use on this thread.",
+              heap.used_heap_size());
+  AppendGauge(out,
+              "nodejs_heap_total_bytes",
+              "V8 heap reserved on this thread.",
+              heap.total_heap_size());
+
+  ThreadPoolWorkQueue* queue = env->threadpool_work_queue();
+  static constexpr struct {
+    const char* name;
+    const char* help;
+    uint64_t (ThreadPoolWorkQueue::*get)(ThreadPoolWorkCategory) const;
+  } kThreadPoolGauges[] = {
+      {"nodejs_threadpool_queued",
+       "Threadpool work of this thread waiting to run.",
+       &ThreadPoolWorkQueue::queued},
+      {"nodejs_threadpool_running",
+       "Threadpool work of this thread that is running.",
+       &ThreadPoolWorkQueue::running},
+  };
+  for (const auto& gauge : kThreadPoolGauges) {
+    AppendMetadata(out, gauge.name, "gauge", gauge.help);
+    for (int i = 0; i < kThreadPoolWorkCategoryCount; i++) {
+      auto category = static_cast<ThreadPoolWorkCategory>(i);
+      out->append(gauge.name).append("{category=\"");
+      out->append(ThreadPoolWorkQueue::GetCategoryName(category));
+      out->append("\"} ");
+      AppendUint(out, (queue->*gauge.get)(category));
+      out->append("\n");
+    }
+  }
+
+  out->append("# EOF\n");
+}
+
+// createCounter(name, help), createGauge(name, help) and
+// createHistogram(name, help) return the id of the metric. Names starting
+// with `nodejs_` are reserved for the runtime.
+template <typename T>
+static void CreateMetric(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  Utf8Value name(env->isolate(), args[0]);
+  Utf8Value help(env->isolate(), args[1]);
+  T* metric = nullptr;
+  if (!name.ToStringView().starts_with("nodejs_")) {
+    Registry* registry = Registry::Get();
+    if constexpr (T::kType == Metric::Type::kCounter) {
+      metric = registry->GetCounter(*name, *help);
+    } else if constexpr (T::kType == Metric::Type::kGauge) {
+      metric = registry->GetGauge(*name, *help);
+    } else {
+      metric = registry->GetHistogram(*name, *help);
+    }
+  }
+  if (metric == nullptr) {
+    return THROW_ERR_INVALID_ARG_VALUE(
+        env, "Metric name \"%s\" is invalid or already in use", *name);
+  }
+  args.GetReturnValue().Set(Registry::Get()->GetId(metric));
+}
+
+template <typename T>
+static T* MetricFromId(Local<Value> value) {
+  T* metric = Registry::Get()->FromId<T>(value.As<v8::Uint32>()->Value());
+  CHECK_NOT_NULL(metric);
+  return metric;
+}
+
+template <typename T>
+static T* MetricFromId(uint32_t id) {
+  T* metric = Registry::Get()->FromId<T>(id);
+  CHECK_NOT_NULL(metric);
+  return metric;
+}
+
+// Counters only count up, so anything but a positive value is ignored.
+static void CounterAddValue(Counter* counter, double value) {
+  if (value > 0) counter->Increment(static_cast<uint64_t>(value));
+}
+
+// counterAdd(id, value)
+static void CounterAdd(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsNumber());
+  CounterAddValue(MetricFromId<Counter>(args[0]),
+                  args[1].As<Number>()->Value());
+}
+
+static void FastCounterAdd(Local<Value> receiver,
+                           uint32_t id,
+                           double value) {
+  TRACK_V8_FAST_API_CALL("metrics.counterAdd");
+  CounterAddValue(MetricFromId<Counter>(id), value);
+}
+
+// gaugeSet(id, value)
+static void GaugeSet(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsNumber());
+  MetricFromId<Gauge>(args[0])->Set(args[1].As<Number>()->Value());
+}
+
+static void FastGaugeSet(Local<Value> receiver, uint32_t id, double value) {
+  TRACK_V8_FAST_API_CALL("metrics.gaugeSet");
+  MetricFromId<Gauge>(id)->Set(value);
+}
+
+// gaugeAdd(id, value)
+static void GaugeAdd(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsNumber());
+  MetricFromId<Gauge>(args[0])->Add(args[1].As<Number>()->Value());
+}
+
+static void FastGaugeAdd(Local<Value> receiver, uint32_t id, double value) {
+  TRACK_V8_FAST_API_CALL("metrics.gaugeAdd");
+  MetricFromId<Gauge>(id)->Add(value);
+}
+
+// histogramRecord(id, value)
+static void HistogramRecord(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsNumber());
+  MetricFromId<HistogramMetric>(args[0])->Record(
+      static_cast<int64_t>(args[1].As<Number>()->Value()));
+}
+
+static void FastHistogramRecord(Local<Value> receiver,
+                                uint32_t id,
+                                double value) {
+  TRACK_V8_FAST_API_CALL("metrics.histogramRecord");
+  MetricFromId<HistogramMetric>(id)->Record(static_cast<int64_t>(value));
+}
+
+// render() returns every metric, with the runtime metrics of the calling
+// thread, as an OpenMetrics text exposition.
+static void Render(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  std::string out;
+  RenderOpenMetrics(env, &out);
+  Local<String> result;
+  if (String::NewFromUtf8(env->isolate(),
+                          out.data(),
+                          v8::NewStringType::kNormal,
+                          out.size())
+          .ToLocal(&result)) {
+    args.GetReturnValue().Set(result);
+  }
+}
+
+static CFunction fast_counter_add(CFunction::Make(FastCounterAdd));
+static CFunction fast_gauge_set(CFunction::Make(FastGaugeSet));
+static CFunction fast_gauge_add(CFunction::Make(FastGaugeAdd));
+static CFunction fast_histogram_record(CFunction::Make(FastHistogramRecord));
+
+static void Initialize(Local<Object> target,
+                       Local<Value> unused,
+                       Local<Context> context,
+                       void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Isolate* isolate = env->isolate();
+
+  // The GC metrics are recorded for every isolate that uses the registry.
+  if (!gc_callbacks_installed) {
+    isolate->AddGCPrologueCallback(GCPrologue);
+    isolate->AddGCEpilogueCallback(GCEpilogue);
+    gc_callbacks_installed = true;
+    env->AddCleanupHook(RemoveGCCallbacks, isolate);
+  }
+
+  SetMethod(context, target, "createCounter", CreateMetric<Counter>);
+  SetMethod(context, target, "createGauge", CreateMetric<Gauge>);
+  SetMethod(
+      context, target, "createHistogram", CreateMetric<HistogramMetric>);
+  SetFastMethod(context, target, "counterAdd", CounterAdd, &fast_counter_add);
+  SetFastMethod(context, target, "gaugeSet", GaugeSet, &fast_gauge_set);
+  SetFastMethod(context, target, "gaugeAdd", GaugeAdd, &fast_gauge_add);
+  SetFastMethod(context,
+                target,
+                "histogramRecord",
+                HistogramRecord,
+                &fast_histogram_record);
+  SetMethodNoSideEffect(context, target, "render", Render);
+}
+
+static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+  registry->Register(CreateMetric<Counter>);
+  registry->Register(CreateMetric<Gauge>);
+  registry->Register(CreateMetric<HistogramMetric>);
+  registry->Register(CounterAdd);
+  registry->Register(FastCounterAdd);
+  registry->Register(fast_counter_add.GetTypeInfo());
+  registry->Register(GaugeSet);
+  registry->Register(FastGaugeSet);
+  registry->Register(fast_gauge_set.GetTypeInfo());
+  registry->Register(GaugeAdd);
+  registry->Register(FastGaugeAdd);
+  registry->Register(fast_gauge_add.GetTypeInfo());
+  registry->Register(HistogramRecord);
+  registry->Register(FastHistogramRecord);
+  registry->Register(fast_histogram_record.GetTypeInfo());
+  registry->Register(Render);
+}
+
+}  // namespace metrics
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(metrics, node::metrics::Initialize)
+NODE_BINDING_EXTERNAL_REFERENCE(metrics,
+                                node::metrics::RegisterExternalReferences)
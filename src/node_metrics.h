@@ -0,0 +1,176 @@
+#ifndef SRC_NODE_METRICS_H_
+#define SRC_NODE_METRICS_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "histogram.h"
+#include "node_mutex.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace node {
+
+class Environment;
+
+// A process-wide registry of counters, gauges and histograms that C++ code
+// and JavaScript on any thread can record into, rendered as OpenMetrics text
+// for a Prometheus scrape.
+//
+// Metrics are never unregistered, so C++ code can look a metric up once and
+// keep the pointer. Recording is a relaxed atomic operation and never takes
+// the registry lock.
+namespace metrics {
+
+class Metric {
+ public:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  Metric(Type type, std::string_view name, std::string_view help)
+      : type_(type), name_(name), help_(help) {}
+  virtual ~Metric() = default;
+  Metric(const Metric&) = delete;
+  Metric& operator=(const Metric&) = delete;
+
+  Type type() const { return type_; }
+  const std::string& name() const { return name_; }
+  const std::string& help() const { return help_; }
+
+  // Appends the sample lines of the metric, without its metadata.
+  virtual void RenderSamples(std::string* out) const = 0;
+
+ private:
+  const Type type_;
+  const std::string name_;
+  const std::string help_;
+};
+
+// A monotonic count. The sample is rendered as `<name>_total`.
+class Counter final : public Metric {
+ public:
+  static constexpr Type kType = Type::kCounter;
+
+  Counter(std::string_view name, std::string_view help)
+      : Metric(kType, name, help) {}
+
+  void Increment(uint64_t value = 1) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+  void RenderSamples(std::string* out) const override;
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+class Gauge final : public Metric {
+ public:
+  static constexpr Type kType = Type::kGauge;
+
+  Gauge(std::string_view name, std::string_view help)
+      : Metric(kType, name, help) {}
+
+  void Set(double value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(double value) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+  double value() const { return value_.load(std::memory_order_relaxed); }
+
+  void RenderSamples(std::string* out) const override;
+
+ private:
+  std::atomic<double> value_{0};
+};
+
+// Records into a concurrent HDR histogram, which keeps quantiles rather than
+// fixed buckets, so it is rendered as an OpenMetrics summary. Recorded values
+// are multiplied by |scale| when rendered, so that for example nanoseconds
+// can be recorded into a metric in seconds.
+class HistogramMetric final : public Metric {
+ public:
+  static constexpr Type kType = Type::kHistogram;
+
+  HistogramMetric(std::string_view name,
+                  std::string_view help,
+                  double scale = 1);
+
+  void Record(int64_t value);
+
+  void RenderSamples(std::string* out) const override;
+
+ private:
+  HistogramImpl histogram_;
+  const double scale_;
+};
+
+class Registry final {
+ public:
+  static constexpr size_t kMaxMetrics = 1024;
+
+  static Registry* Get();
+
+  // Returns the metric called |name|, creating it if it does not exist yet.
+  // Returns nullptr if the name is not a valid metric name, if it is taken
+  // by a metric of another type, or if the registry is full.
+  Counter* GetCounter(std::string_view name, std::string_view help);
+  Gauge* GetGauge(std::string_view name, std::string_view help);
+  HistogramMetric* GetHistogram(std::string_view name,
+                                std::string_view help,
+                                double scale = 1);
+
+  // Returns the id of the metric, for use from JavaScript, which stays valid
+  // for the lifetime of the process.
+  int32_t GetId(const Metric* metric) const;
+  // Returns the metric with the given id if it exists and is a T.
+  template <typename T>
+  T* FromId(uint32_t id) const {
+    if (id >= size_.load(std::memory_order_acquire)) return nullptr;
+    Metric* metric = metrics_[id].get();
+    return metric->type() == T::kType ? static_cast<T*>(metric) : nullptr;
+  }
+
+  // Appends all metrics of the registry in the OpenMetrics text format,
+  // without the terminating `# EOF` line.
+  void Render(std::string* out) const;
+
+ private:
+  friend class LeakedSingleton<Registry>;
+  Registry() = default;
+
+  template <typename T, typename... Args>
+  T* GetOrCreate(std::string_view name, std::string_view help, Args... args);
+
+  mutable Mutex mutex_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  // Only appended to, under mutex_. Readers see the entries below size_.
+  std::unique_ptr<Metric> metrics_[kMaxMetrics];
+  std::atomic<size_t> size_{0};
+};
+
+// The runtime's own process-wide metrics, recorded from C++ hot paths.
+struct RuntimeMetrics {
+  Counter* http_messages;
+  Counter* fs_requests;
+  Counter* gc_runs;
+  HistogramMetric* gc_duration;
+  Gauge* napi_references;
+  Gauge* napi_pending_finalizers;
+};
+
+const RuntimeMetrics& runtime();
+
+// Appends the registry, followed by the runtime metrics that belong to |env|
+// (handles, requests, heap and threadpool), and the `# EOF` line.
+void RenderOpenMetrics(Environment* env, std::string* out);
+
+}  // namespace metrics
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_METRICS_H_
@@ -1,5 +1,6 @@
 #include "node_modules.h"
 #include <cstdio>
+#include <cstring>
 #include "base_object-inl.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
@@ -25,6 +26,8 @@ using v8::FunctionCallbackInfo;
 using v8::HandleScope;
 using v8::Isolate;
 using v8::Local;
+using v8::LocalVector;
+using v8::MaybeLocal;
 using v8::NewStringType;
 using v8::Object;
 using v8::ObjectTemplate;
@@ -40,7 +43,17 @@ void BindingData::MemoryInfo(MemoryTracker* tracker) const {
 BindingData::BindingData(Realm* realm,
                          v8::Local<v8::Object> object,
                          InternalFieldInfo* info)
-    : SnapshotableObject(realm, object, type_int) {}
+    : SnapshotableObject(realm, object, type_int) {
+  env()->AddMemoryPressureHook(OnMemoryPressure, this);
+}
+
+BindingData::~BindingData() {
+  env()->RemoveMemoryPressureHook(OnMemoryPressure, this);
+}
+
+void BindingData::OnMemoryPressure(void* data) {
+  static_cast<BindingData*>(data)->package_configs_.clear();
+}
 
 bool BindingData::PrepareForSerialization(v8::Local<v8::Context> context,
                                           v8::SnapshotCreator* creator) {
@@ -94,10 +107,34 @@ const BindingData::PackageConfig* BindingData::GetPackageJSON(
     return &cache_entry->second;
   }
 
+  uint64_t read_start = uv_hrtime();
+  auto record_read_time = OnScopeLeave([realm, read_start]() {
+    realm->package_json_read_time += uv_hrtime() - read_start;
+  });
+
   PackageConfig package_config{};
+  PackageConfigCache* persistent_cache = realm->env()->package_config_cache();
+  if (persistent_cache != nullptr) {
+    switch (persistent_cache->Get(path, &package_config)) {
+      case PackageConfigCache::Result::kFound: {
+        auto cached = binding_data->package_configs_.insert(
+            {std::string(path), std::move(package_config)});
+        return &cached.first->second;
+      }
+      case PackageConfigCache::Result::kNotFound:
+        return nullptr;
+      case PackageConfigCache::Result::kMiss:
+        break;
+    }
+  }
+
   package_config.file_path = path;
   // No need to exclude BOM since simdjson will skip it.
-  if (ReadFileSync(&package_config.raw_json, path.data()) < 0) {
+  int err = ReadFileSync(&package_config.raw_json, path.data());
+  if (err < 0) {
+    if (persistent_cache != nullptr && err == UV_ENOENT) {
+      persistent_cache->AddNotFound(path);
+    }
     return nullptr;
   }
 
@@ -227,6 +264,10 @@ const BindingData::PackageConfig* BindingData::GetPackageJSON(
       }
     }
   }
+  if (persistent_cache != nullptr) {
+    persistent_cache->AddFound(package_config);
+  }
+
   // package_config could be quite large, so we should move it instead of
   // copying it.
   auto cached = binding_data->package_configs_.insert(
@@ -235,6 +276,219 @@ const BindingData::PackageConfig* BindingData::GetPackageJSON(
   return &cached.first->second;
 }
 
+// Used for identifying and verifying a package config cache file.
+constexpr uint32_t kPackageConfigCacheMagicNumber = 0x8adfdbb4;
+
+// Layout of a package config cache file, in native byte order:
+// [uint32_t] magic number
+// [uint32_t] entry count
+// per entry:
+//   [uint8_t] result, kFound or kNotFound
+//   [uint64_t] * 4 mtime seconds, mtime nanoseconds, size and inode
+//   [string] path
+//   for kFound, [uint8_t] a bit per present optional field, then the
+//   [string]s name, main, type, exports, imports and scripts, where
+//   absent ones are omitted
+// Strings are a uint32_t length followed by the bytes.
+namespace {
+
+class CacheWriter {
+ public:
+  template <typename T>
+  void Write(T value) {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  void WriteString(std::string_view str) {
+    Write(static_cast<uint32_t>(str.size()));
+    buffer_.append(str);
+  }
+  std::string* buffer() { return &buffer_; }
+
+ private:
+  std::string buffer_;
+};
+
+class CacheReader {
+ public:
+  explicit CacheReader(std::string_view data) : data_(data) {}
+
+  template <typename T>
+  bool Read(T* value) {
+    if (data_.size() < sizeof(T)) return false;
+    memcpy(value, data_.data(), sizeof(T));
+    data_.remove_prefix(sizeof(T));
+    return true;
+  }
+  bool ReadString(std::string* str) {
+    uint32_t size;
+    if (!Read(&size) || data_.size() < size) return false;
+    str->assign(data_.data(), size);
+    data_.remove_prefix(size);
+    return true;
+  }
+  bool ReadOptionalString(uint8_t present,
+                          int bit,
+                          std::optional<std::string>* str) {
+    if ((present & (1 << bit)) == 0) return true;
+    return ReadString(&str->emplace());
+  }
+
+ private:
+  std::string_view data_;
+};
+
+}  // namespace
+
+PackageConfigCache::PackageConfigCache(std::string path)
+    : path_(std::move(path)) {
+  Read();
+}
+
+void PackageConfigCache::Read() {
+  std::string contents;
+  if (ReadFileSync(&contents, path_.c_str()) != 0) return;
+
+  CacheReader reader(contents);
+  uint32_t magic;
+  uint32_t count;
+  if (!reader.Read(&magic) || magic != kPackageConfigCacheMagicNumber ||
+      !reader.Read(&count)) {
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    Entry entry;
+    uint8_t result;
+    std::string path;
+    if (!reader.Read(&result) || !reader.Read(&entry.mtime_sec) ||
+        !reader.Read(&entry.mtime_nsec) || !reader.Read(&entry.size) ||
+        !reader.Read(&entry.ino) || !reader.ReadString(&path)) {
+      return;
+    }
+    entry.result = static_cast<Result>(result);
+    if (entry.result == Result::kFound) {
+      PackageConfig& config = entry.config;
+      uint8_t present;
+      if (!reader.Read(&present) ||
+          !reader.ReadOptionalString(present, 0, &config.name) ||
+          !reader.ReadOptionalString(present, 1, &config.main) ||
+          !reader.ReadString(&config.type) ||
+          !reader.ReadOptionalString(present, 2, &config.exports) ||
+          !reader.ReadOptionalString(present, 3, &config.imports) ||
+          !reader.ReadOptionalString(present, 4, &config.scripts)) {
+        return;
+      }
+      config.file_path = path;
+    } else if (entry.result != Result::kNotFound) {
+      return;
+    }
+    entries_.insert_or_assign(std::move(path), std::move(entry));
+  }
+}
+
+bool PackageConfigCache::Stat(std::string_view path, Entry* entry) {
+  std::string stat_path(path);
+  if (entry->result == Result::kNotFound) {
+    stat_path = std::filesystem::path(stat_path).parent_path().string();
+  }
+  uv_fs_t req;
+  int err = uv_fs_stat(nullptr, &req, stat_path.c_str(), nullptr);
+  const uv_stat_t stat = req.statbuf;
+  uv_fs_req_cleanup(&req);
+  if (err < 0) return false;
+  entry->mtime_sec = stat.st_mtim.tv_sec;
+  entry->mtime_nsec = stat.st_mtim.tv_nsec;
+  entry->size = entry->result == Result::kFound ? stat.st_size : 0;
+  entry->ino = stat.st_ino;
+  return true;
+}
+
+PackageConfigCache::Result PackageConfigCache::Get(std::string_view path,
+                                                   PackageConfig* config) {
+  auto it = entries_.find(std::string(path));
+  if (it == entries_.end()) return Result::kMiss;
+
+  const Entry& cached = it->second;
+  Entry current;
+  current.result = cached.result;
+  if (!Stat(path, &current) || current.mtime_sec != cached.mtime_sec ||
+      current.mtime_nsec != cached.mtime_nsec || current.size != cached.size ||
+      current.ino != cached.ino) {
+    entries_.erase(it);
+    dirty_ = true;
+    return Result::kMiss;
+  }
+  if (cached.result == Result::kFound) *config = cached.config;
+  return cached.result;
+}
+
+void PackageConfigCache::AddFound(const PackageConfig& config) {
+  Entry entry;
+  entry.result = Result::kFound;
+  if (!Stat(config.file_path, &entry)) return;
+  entry.config = config;
+  // The raw JSON is only needed for parsing.
+  entry.config.raw_json.clear();
+  entries_.insert_or_assign(config.file_path, std::move(entry));
+  dirty_ = true;
+}
+
+void PackageConfigCache::AddNotFound(std::string_view path) {
+  Entry entry;
+  entry.result = Result::kNotFound;
+  if (!Stat(path, &entry)) return;
+  entries_.insert_or_assign(std::string(path), std::move(entry));
+  dirty_ = true;
+}
+
+void PackageConfigCache::Persist() {
+  if (!dirty_) return;
+  dirty_ = false;
+
+  CacheWriter writer;
+  writer.Write(kPackageConfigCacheMagicNumber);
+  writer.Write(static_cast<uint32_t>(entries_.size()));
+  for (const auto& [path, entry] : entries_) {
+    writer.Write(static_cast<uint8_t>(entry.result));
+    writer.Write(entry.mtime_sec);
+    writer.Write(entry.mtime_nsec);
+    writer.Write(entry.size);
+    writer.Write(entry.ino);
+    writer.WriteString(path);
+    if (entry.result != Result::kFound) continue;
+    const PackageConfig& config = entry.config;
+    uint8_t present = (config.name.has_value() ? 1 : 0) |
+                      (config.main.has_value() ? 2 : 0) |
+                      (config.exports.has_value() ? 4 : 0) |
+                      (config.imports.has_value() ? 8 : 0) |
+                      (config.scripts.has_value() ? 16 : 0);
+    writer.Write(present);
+    if (config.name.has_value()) writer.WriteString(*config.name);
+    if (config.main.has_value()) writer.WriteString(*config.main);
+    writer.WriteString(config.type);
+    if (config.exports.has_value()) writer.WriteString(*config.exports);
+    if (config.imports.has_value()) writer.WriteString(*config.imports);
+    if (config.scripts.has_value()) writer.WriteString(*config.scripts);
+  }
+
+  // Write into a temporary file that is renamed over the old one, so that
+  // concurrently starting processes never read a partial file.
+  std::string temp_path =
+      path_ + "." + std::to_string(uv_os_getpid()) + ".tmp";
+  uv_buf_t buf =
+      uv_buf_init(writer.buffer()->data(), writer.buffer()->size());
+  int err = WriteFileSync(temp_path.c_str(), buf);
+  uv_fs_t req;
+  if (err == 0) {
+    err = uv_fs_rename(
+        nullptr, &req, temp_path.c_str(), path_.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+  if (err < 0) {
+    uv_fs_unlink(nullptr, &req, temp_path.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+}
+
 void BindingData::ReadPackageJSON(const FunctionCallbackInfo<Value>& args) {
   CHECK_GE(args.Length(), 1);  // path, [is_esm, base, specifier]
   CHECK(args[0]->IsString());  // path
@@ -462,6 +716,97 @@ void GetCompileCacheDir(const FunctionCallbackInfo<Value>& args) {
           .ToLocalChecked());
 }
 
+// Layout of the cached CommonJS exports of a module:
+// [uint32_t] export count, followed by the exports
+// [uint32_t] reexport count, followed by the reexports
+// Names are a uint32_t length followed by the UTF-8 bytes.
+static bool AppendCjsExportNames(Isolate* isolate,
+                                 Local<Context> context,
+                                 Local<Value> value,
+                                 CacheWriter* writer) {
+  CHECK(value->IsArray());
+  Local<Array> names = value.As<Array>();
+  writer->Write(names->Length());
+  for (uint32_t i = 0; i < names->Length(); i++) {
+    Local<Value> name;
+    if (!names->Get(context, i).ToLocal(&name)) return false;
+    CHECK(name->IsString());
+    Utf8Value utf8(isolate, name);
+    writer->WriteString(utf8.ToStringView());
+  }
+  return true;
+}
+
+static MaybeLocal<Array> ReadCjsExportNames(Isolate* isolate,
+                                            CacheReader* reader) {
+  uint32_t count;
+  if (!reader->Read(&count)) return MaybeLocal<Array>();
+  LocalVector<Value> names(isolate);
+  std::string name;
+  for (uint32_t i = 0; i < count; i++) {
+    Local<String> str;
+    if (!reader->ReadString(&name) ||
+        !String::NewFromUtf8(
+             isolate, name.data(), NewStringType::kNormal, name.size())
+             .ToLocal(&str)) {
+      return MaybeLocal<Array>();
+    }
+    names.push_back(str);
+  }
+  return Array::New(isolate, names.data(), names.size());
+}
+
+// getCachedCjsExports(filename, source) returns [exports, reexports] as
+// detected by cjs-module-lexer on a previous run for the same source, or
+// undefined.
+void GetCachedCjsExports(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  if (!env->use_compile_cache()) return;
+
+  CompileCacheEntry* entry = env->compile_cache_handler()->GetOrInsert(
+      args[1].As<String>(),
+      args[0].As<String>(),
+      CachedCodeType::kCommonJSExports);
+  if (entry == nullptr || entry->cache == nullptr) return;
+
+  CacheReader reader(
+      std::string_view(reinterpret_cast<const char*>(entry->cache->data),
+                       entry->cache->length));
+  Local<Array> exports;
+  Local<Array> reexports;
+  if (!ReadCjsExportNames(isolate, &reader).ToLocal(&exports) ||
+      !ReadCjsExportNames(isolate, &reader).ToLocal(&reexports)) {
+    return;
+  }
+  Local<Value> result[] = {exports, reexports};
+  args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
+}
+
+// setCachedCjsExports(filename, source, exports, reexports)
+void SetCachedCjsExports(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  if (!env->use_compile_cache()) return;
+
+  CacheWriter writer;
+  if (!AppendCjsExportNames(isolate, context, args[2], &writer) ||
+      !AppendCjsExportNames(isolate, context, args[3], &writer)) {
+    return;
+  }
+  CompileCacheEntry* entry = env->compile_cache_handler()->GetOrInsert(
+      args[1].As<String>(),
+      args[0].As<String>(),
+      CachedCodeType::kCommonJSExports);
+  if (entry == nullptr) return;
+  env->compile_cache_handler()->SaveData(entry, *writer.buffer());
+}
+
 void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
                                              Local<ObjectTemplate> target) {
   Isolate* isolate = isolate_data->isolate();
@@ -477,6 +822,8 @@ void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "getPackageScopeConfig", GetPackageScopeConfig);
   SetMethod(isolate, target, "enableCompileCache", EnableCompileCache);
   SetMethod(isolate, target, "getCompileCacheDir", GetCompileCacheDir);
+  SetMethod(isolate, target, "getCachedCjsExports", GetCachedCjsExports);
+  SetMethod(isolate, target, "setCachedCjsExports", SetCachedCjsExports);
 }
 
 void BindingData::CreatePerContextProperties(Local<Object> target,
@@ -509,6 +856,8 @@ void BindingData::RegisterExternalReferences(
   registry->Register(GetPackageScopeConfig);
   registry->Register(EnableCompileCache);
   registry->Register(GetCompileCacheDir);
+  registry->Register(GetCachedCjsExports);
+  registry->Register(SetCachedCjsExports);
 }
 
 }  // namespace modules
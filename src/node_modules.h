@@ -47,6 +47,7 @@ class BindingData : public SnapshotableObject {
   BindingData(Realm* realm,
               v8::Local<v8::Object> obj,
               InternalFieldInfo* info = nullptr);
+  ~BindingData() override;
   SERIALIZABLE_OBJECT_METHODS()
   SET_BINDING_ID(modules_binding_data)
 
@@ -73,6 +74,10 @@ class BindingData : public SnapshotableObject {
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
 
  private:
+  // Drops the parsed package.json files under memory pressure. They are
+  // read again on their next lookup.
+  static void OnMemoryPressure(void* data);
+
   std::unordered_map<std::string, PackageConfig> package_configs_;
   simdjson::ondemand::parser json_parser;
   // returns null on error
@@ -84,6 +89,48 @@ class BindingData : public SnapshotableObject {
       Realm* realm, const std::filesystem::path& check_path);
 };
 
+// A persistent cache of package.json lookups, stored next to the compile
+// cache with NODE_COMPILE_CACHE_RESOLUTION=1, so that unchanged deployments
+// do not read and parse every package.json again on each start.
+//
+// Parsed configs are validated by the mtime, size and inode of their
+// package.json, and failed lookups by the mtime and inode of the directory
+// that would contain it, so a hit costs a single stat().
+class PackageConfigCache {
+ public:
+  using PackageConfig = BindingData::PackageConfig;
+  enum class Result { kMiss, kFound, kNotFound };
+
+  // Reads the cache file at |path|, if there is a valid one.
+  explicit PackageConfigCache(std::string path);
+
+  // Fills |config| for kFound.
+  Result Get(std::string_view path, PackageConfig* config);
+  void AddFound(const PackageConfig& config);
+  void AddNotFound(std::string_view path);
+
+  // Rewrites the cache file if any entry was added.
+  void Persist();
+
+ private:
+  struct Entry {
+    Result result;
+    // Of the package.json for kFound, of its directory for kNotFound.
+    uint64_t mtime_sec;
+    uint64_t mtime_nsec;
+    uint64_t size;
+    uint64_t ino;
+    PackageConfig config;
+  };
+
+  static bool Stat(std::string_view path, Entry* entry);
+  void Read();
+
+  const std::string path_;
+  std::unordered_map<std::string, Entry> entries_;
+  bool dirty_ = false;
+};
+
 }  // namespace modules
 }  // namespace node
 
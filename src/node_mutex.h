@@ -71,6 +71,8 @@ class MutexBase {
   inline MutexBase();
   inline ~MutexBase();
   inline void Lock();
+  // Returns false instead of waiting if the mutex is held.
+  inline bool TryLock();
   inline void Unlock();
   inline void RdLock();
   inline void RdUnlock();
@@ -139,6 +141,8 @@ class ConditionVariableBase {
   inline void Broadcast(const ScopedLock&);
   inline void Signal(const ScopedLock&);
   inline void Wait(const ScopedLock& scoped_lock);
+  // Returns false if the timeout elapsed without a wakeup.
+  inline bool TimedWait(const ScopedLock& scoped_lock, uint64_t timeout_ns);
 
   ConditionVariableBase(const ConditionVariableBase&) = delete;
   ConditionVariableBase& operator=(const ConditionVariableBase&) = delete;
@@ -175,6 +179,12 @@ struct LibuvMutexTraits {
     uv_cond_wait(cond, mutex);
   }
 
+  static inline int cond_timedwait(CondT* cond,
+                                   MutexT* mutex,
+                                   uint64_t timeout) {
+    return uv_cond_timedwait(cond, mutex, timeout);
+  }
+
   static inline void mutex_destroy(MutexT* mutex) {
     uv_mutex_destroy(mutex);
   }
@@ -183,6 +193,10 @@ struct LibuvMutexTraits {
     uv_mutex_lock(mutex);
   }
 
+  static inline int mutex_trylock(MutexT* mutex) {
+    return uv_mutex_trylock(mutex);
+  }
+
   static inline void mutex_unlock(MutexT* mutex) {
     uv_mutex_unlock(mutex);
   }
@@ -211,6 +225,10 @@ struct LibuvRwlockTraits {
     uv_rwlock_wrlock(mutex);
   }
 
+  static inline int mutex_trylock(MutexT* mutex) {
+    return uv_rwlock_trywrlock(mutex);
+  }
+
   static inline void mutex_unlock(MutexT* mutex) {
     uv_rwlock_wrunlock(mutex);
   }
@@ -249,6 +267,13 @@ void ConditionVariableBase<Traits>::Wait(const ScopedLock& scoped_lock) {
   Traits::cond_wait(&cond_, &scoped_lock.mutex_.mutex_);
 }
 
+template <typename Traits>
+bool ConditionVariableBase<Traits>::TimedWait(const ScopedLock& scoped_lock,
+                                              uint64_t timeout_ns) {
+  return Traits::cond_timedwait(
+             &cond_, &scoped_lock.mutex_.mutex_, timeout_ns) == 0;
+}
+
 template <typename Traits>
 MutexBase<Traits>::MutexBase() {
   CHECK_EQ(0, Traits::mutex_init(&mutex_));
@@ -264,6 +289,11 @@ void MutexBase<Traits>::Lock() {
   Traits::mutex_lock(&mutex_);
 }
 
+template <typename Traits>
+bool MutexBase<Traits>::TryLock() {
+  return Traits::mutex_trylock(&mutex_) == 0;
+}
+
 template <typename Traits>
 void MutexBase<Traits>::Unlock() {
   Traits::mutex_unlock(&mutex_);
@@ -90,8 +90,27 @@ void PerProcessOptions::CheckOptions(std::vector<std::string>* errors,
     if ((secure_heap_min & (secure_heap_min - 1)) != 0)
       errors->push_back("--secure-heap-min must be a power of 2");
   }
+
+  if (crypto_threadpool_size < 0 || crypto_threadpool_size > 128)
+    errors->push_back("--crypto-threadpool-size must be between 0 and 128");
 #endif  // HAVE_OPENSSL
 
+  if (array_buffer_pool_size < 0)
+    errors->push_back("--array-buffer-pool-size must not be negative");
+
+  if (trace_event_format != "json" && trace_event_format != "perfetto") {
+    errors->push_back("invalid value for --trace-event-format");
+  }
+
+  if (threadpool_fs_limit < 0)
+    errors->push_back("--threadpool-fs-limit must not be negative");
+  if (threadpool_crypto_limit < 0)
+    errors->push_back("--threadpool-crypto-limit must not be negative");
+  if (threadpool_zlib_limit < 0)
+    errors->push_back("--threadpool-zlib-limit must not be negative");
+  if (threadpool_user_limit < 0)
+    errors->push_back("--threadpool-user-limit must not be negative");
+
   if (use_largepages != "off" &&
       use_largepages != "on" &&
       use_largepages != "silent") {
@@ -198,17 +217,37 @@ void EnvironmentOptions::CheckOptions(std::vector<std::string>* errors,
     if (!cpu_prof_name.empty()) {
       errors->push_back("--cpu-prof-name must be used with --cpu-prof");
     }
+  }
+
+  if (!cpu_prof && !cpu_prof_continuous && cpu_prof_signal.empty()) {
     if (!cpu_prof_dir.empty()) {
-      errors->push_back("--cpu-prof-dir must be used with --cpu-prof");
+      errors->push_back("--cpu-prof-dir must be used with --cpu-prof, "
+                        "--cpu-prof-continuous or --cpu-prof-signal");
     }
     // We can't catch the case where the value passed is the default value,
     // then the option just becomes a noop which is fine.
     if (cpu_prof_interval != kDefaultCpuProfInterval) {
-      errors->push_back("--cpu-prof-interval must be used with --cpu-prof");
+      errors->push_back("--cpu-prof-interval must be used with --cpu-prof, "
+                        "--cpu-prof-continuous or --cpu-prof-signal");
     }
   }
 
-  if (cpu_prof && cpu_prof_dir.empty() && !diagnostic_dir.empty()) {
+  if (cpu_prof_duration == 0) {
+    errors->push_back("--cpu-prof-duration must be greater than 0");
+  }
+
+  if (cpu_prof_continuous) {
+    if (cpu_prof_window == 0) {
+      errors->push_back("--cpu-prof-window must be greater than 0");
+    }
+  } else if (cpu_prof_window != kDefaultCpuProfWindow) {
+    errors->push_back("--cpu-prof-window must be used with "
+                      "--cpu-prof-continuous");
+  }
+
+  if ((cpu_prof || cpu_prof_continuous || !cpu_prof_signal.empty()) &&
+      cpu_prof_dir.empty() &&
+      !diagnostic_dir.empty()) {
       cpu_prof_dir = diagnostic_dir;
     }
 
@@ -216,17 +255,32 @@ void EnvironmentOptions::CheckOptions(std::vector<std::string>* errors,
     if (!heap_prof_name.empty()) {
       errors->push_back("--heap-prof-name must be used with --heap-prof");
     }
+  }
+
+  if (!heap_prof && !heap_prof_continuous) {
     if (!heap_prof_dir.empty()) {
-      errors->push_back("--heap-prof-dir must be used with --heap-prof");
+      errors->push_back("--heap-prof-dir must be used with --heap-prof or "
+                        "--heap-prof-continuous");
     }
     // We can't catch the case where the value passed is the default value,
     // then the option just becomes a noop which is fine.
     if (heap_prof_interval != kDefaultHeapProfInterval) {
-      errors->push_back("--heap-prof-interval must be used with --heap-prof");
+      errors->push_back("--heap-prof-interval must be used with --heap-prof "
+                        "or --heap-prof-continuous");
     }
   }
 
-  if (heap_prof && heap_prof_dir.empty() && !diagnostic_dir.empty()) {
+  if (heap_prof_continuous) {
+    if (heap_prof_window == 0) {
+      errors->push_back("--heap-prof-window must be greater than 0");
+    }
+  } else if (heap_prof_window != kDefaultHeapProfWindow) {
+    errors->push_back("--heap-prof-window must be used with "
+                      "--heap-prof-continuous");
+  }
+
+  if ((heap_prof || heap_prof_continuous) && heap_prof_dir.empty() &&
+      !diagnostic_dir.empty()) {
     heap_prof_dir = diagnostic_dir;
   }
 
@@ -423,6 +477,16 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             "experimental node:sqlite module",
             &EnvironmentOptions::experimental_sqlite,
             kAllowedInEnvvar);
+  AddOption("--experimental-blob-mmap",
+            "serve reads of file-backed Blobs from a shared memory mapping "
+            "of the file",
+            &EnvironmentOptions::experimental_blob_mmap,
+            kAllowedInEnvvar);
+  AddOption("--blob-spill-threshold",
+            "move the contents of Blobs larger than this many bytes to a "
+            "temporary file (default: 0, never)",
+            &EnvironmentOptions::blob_spill_threshold,
+            kAllowedInEnvvar);
   AddOption("--experimental-webstorage",
             "experimental Web Storage API",
             &EnvironmentOptions::experimental_webstorage,
@@ -604,6 +668,25 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             "Directory where the V8 profiles generated by --cpu-prof will be "
             "placed. Does not affect --prof.",
             &EnvironmentOptions::cpu_prof_dir);
+  AddOption("--cpu-prof-continuous",
+            "Keep the V8 CPU profiler running for the lifetime of the "
+            "process, and write one gzipped pprof profile to --cpu-prof-dir "
+            "every --cpu-prof-window milliseconds. Samples every 10000 "
+            "microseconds unless --cpu-prof-interval is specified.",
+            &EnvironmentOptions::cpu_prof_continuous);
+  AddOption("--cpu-prof-window",
+            "specified length in milliseconds of each profile written by "
+            "--cpu-prof-continuous. (default: 60000)",
+            &EnvironmentOptions::cpu_prof_window);
+  AddOption("--cpu-prof-signal",
+            "Capture a CPU profile of --cpu-prof-duration milliseconds "
+            "whenever the specified signal is received, and write it to "
+            "--cpu-prof-dir as gzipped pprof.",
+            &EnvironmentOptions::cpu_prof_signal);
+  AddOption("--cpu-prof-duration",
+            "specified length in milliseconds of the CPU profiles captured "
+            "on demand. (default: 10000)",
+            &EnvironmentOptions::cpu_prof_duration);
   AddOption("--experimental-network-inspection",
             "experimental network inspection support",
             &EnvironmentOptions::experimental_network_inspection);
@@ -625,11 +708,26 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             "specified sampling interval in bytes for the V8 heap "
             "profile generated with --heap-prof. (default: 512 * 1024)",
             &EnvironmentOptions::heap_prof_interval);
+  AddOption("--heap-prof-continuous",
+            "Keep the V8 sampling heap profiler running for the lifetime of "
+            "the process, and write the sampled allocations that are still "
+            "alive as a gzipped pprof profile to --heap-prof-dir every "
+            "--heap-prof-window milliseconds.",
+            &EnvironmentOptions::heap_prof_continuous);
+  AddOption("--heap-prof-window",
+            "specified interval in milliseconds between the profiles written "
+            "by --heap-prof-continuous. (default: 60000)",
+            &EnvironmentOptions::heap_prof_window);
 #endif  // HAVE_INSPECTOR
   AddOption("--max-http-header-size",
             "set the maximum size of HTTP headers (default: 16384 (16KB))",
             &EnvironmentOptions::max_http_header_size,
             kAllowedInEnvvar);
+  AddOption("--request-object-pool-size",
+            "keep up to this many objects of finished internal write and "
+            "fs promise requests for reuse (default: 64, 0 disables)",
+            &EnvironmentOptions::request_object_pool_size,
+            kAllowedInEnvvar);
   AddOption("--redirect-warnings",
             "write warnings to file instead of stderr",
             &EnvironmentOptions::redirect_warnings,
@@ -877,6 +975,11 @@ PerIsolateOptionsParser::PerIsolateOptionsParser(
             "track heap object allocations for heap snapshots",
             &PerIsolateOptions::track_heap_objects,
             kAllowedInEnvvar);
+  AddOption("--vm-code-cache-size",
+            "cache the code of vm scripts and functions compiled from "
+            "identical sources, up to this many bytes (default: 0, disabled)",
+            &PerIsolateOptions::vm_code_cache_size,
+            kAllowedInEnvvar);
 
   // Explicitly add some V8 flags to mark them as allowed in NODE_OPTIONS.
   AddOption("--abort-on-uncaught-exception",
@@ -938,6 +1041,15 @@ PerIsolateOptionsParser::PerIsolateOptionsParser(
   Implies("--experimental-shadow-realm", "--harmony-shadow-realm");
   Implies("--harmony-shadow-realm", "--experimental-shadow-realm");
   ImpliesNot("--no-harmony-shadow-realm", "--experimental-shadow-realm");
+  AddOption("--experimental-shared-structs",
+            "experimental support for shared structs and shared arrays, "
+            "which can be posted between threads without being copied",
+            &PerIsolateOptions::experimental_shared_structs,
+            kAllowedInEnvvar);
+  AddOption("--harmony-struct", "", V8Option{});
+  Implies("--experimental-shared-structs", "--harmony-struct");
+  Implies("--harmony-struct", "--experimental-shared-structs");
+  ImpliesNot("--no-harmony-struct", "--experimental-shared-structs");
   AddOption("--build-snapshot",
             "Generate a snapshot blob when the process exits.",
             &PerIsolateOptions::build_snapshot,
@@ -967,10 +1079,16 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "data, it supports ${rotation} and ${pid}.",
             &PerProcessOptions::trace_event_file_pattern,
             kAllowedInEnvvar);
+  AddOption("--trace-event-format",
+            "format of the trace-events data, 'json' (default) or "
+            "'perfetto' for a Perfetto protobuf trace",
+            &PerProcessOptions::trace_event_format,
+            kAllowedInEnvvar);
   AddAlias("--trace-events-enabled", {
     "--trace-event-categories", "v8,node,node.async_hooks" });
   AddOption("--v8-pool-size",
-            "set V8's thread pool size",
+            "set V8's thread pool size (default: 4, or the number of CPUs "
+            "of the cgroup CPU quota if that is lower)",
             &PerProcessOptions::v8_thread_pool_size,
             kAllowedInEnvvar);
   AddOption("--zero-fill-buffers",
@@ -978,6 +1096,35 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "SlowBuffer instances",
             &PerProcessOptions::zero_fill_all_buffers,
             kAllowedInEnvvar);
+  AddOption("--array-buffer-pool-size",
+            "maximum number of bytes of freed ArrayBuffer memory that each "
+            "isolate keeps for reuse (0 disables the pool)",
+            &PerProcessOptions::array_buffer_pool_size,
+            kAllowedInEnvvar);
+  AddOption("--threadpool-fs-limit",
+            "maximum number of file system tasks that each event loop runs "
+            "on the libuv threadpool at a time (0 for one less than the "
+            "threadpool size)",
+            &PerProcessOptions::threadpool_fs_limit,
+            kAllowedInEnvvar);
+  AddOption("--threadpool-crypto-limit",
+            "maximum number of crypto tasks that each event loop runs on the "
+            "libuv threadpool at a time (0 for one less than the threadpool "
+            "size)",
+            &PerProcessOptions::threadpool_crypto_limit,
+            kAllowedInEnvvar);
+  AddOption("--threadpool-zlib-limit",
+            "maximum number of zlib tasks that each event loop runs on the "
+            "libuv threadpool at a time (0 for one less than the threadpool "
+            "size)",
+            &PerProcessOptions::threadpool_zlib_limit,
+            kAllowedInEnvvar);
+  AddOption("--threadpool-user-limit",
+            "maximum number of Node-API and other addon tasks that each "
+            "event loop runs on the libuv threadpool at a time (0 for one "
+            "less than the threadpool size)",
+            &PerProcessOptions::threadpool_user_limit,
+            kAllowedInEnvvar);
   AddOption("--debug-arraybuffer-allocations",
             "", /* undocumented, only for debugging */
             &PerProcessOptions::debug_arraybuffer_allocations,
@@ -1015,6 +1162,11 @@ PerProcessOptionsParser::PerProcessOptionsParser(
   AddOption("--v8-options",
             "print V8 command line options",
             &PerProcessOptions::print_v8_help);
+  AddOption("--report-async",
+            "format and write reports requested through the JavaScript API "
+            "or the report signal on a background thread",
+            &PerProcessOptions::report_async,
+            kAllowedInEnvvar);
   AddOption("--report-compact",
             "output compact single-line JSON",
             &PerProcessOptions::report_compact,
@@ -1096,6 +1248,11 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "minimum allocation size from the OpenSSL secure heap",
             &PerProcessOptions::secure_heap_min,
             kAllowedInEnvvar);
+  AddOption("--crypto-threadpool-size",
+            "number of threads reserved for asynchronous crypto operations, "
+            "which otherwise run on the libuv threadpool",
+            &PerProcessOptions::crypto_threadpool_size,
+            kAllowedInEnvvar);
 #endif  // HAVE_OPENSSL
 #if OPENSSL_VERSION_MAJOR >= 3
   AddOption("--openssl-legacy-provider",
@@ -1115,6 +1272,11 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "or 'silent' (map and silently ignore failure)",
             &PerProcessOptions::use_largepages,
             kAllowedInEnvvar);
+  AddOption("--use-largepages-heap",
+            "Back the V8 heap, including generated code, with transparent "
+            "huge pages. Failure is reported to stderr and ignored",
+            &PerProcessOptions::use_largepages_heap,
+            kAllowedInEnvvar);
 
   AddOption("--trace-sigint",
             "enable printing JavaScript stacktrace on SIGINT",
@@ -1145,6 +1307,21 @@ PerProcessOptionsParser::PerProcessOptionsParser(
       "performance.",
       &PerProcessOptions::disable_wasm_trap_handler,
       kAllowedInEnvvar);
+  AddOption("--experimental-fs-io-uring",
+            "submit supported asynchronous file system operations through "
+            "io_uring instead of the libuv threadpool (Linux only)",
+            &PerProcessOptions::experimental_fs_io_uring,
+            kAllowedInEnvvar);
+  AddOption("--experimental-stat-cache",
+            "cache the file system lookups made during module resolution "
+            "for the lifetime of the process",
+            &PerProcessOptions::experimental_stat_cache,
+            kAllowedInEnvvar);
+  AddOption("--experimental-watch-file-events",
+            "back fs.watchFile() with file system notifications where "
+            "available and only poll rarely as a fallback",
+            &PerProcessOptions::experimental_watch_file_events,
+            kAllowedInEnvvar);
 }
 
 inline std::string RemoveBrackets(const std::string& host) {
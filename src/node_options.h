@@ -125,6 +125,8 @@ class EnvironmentOptions : public Options {
   bool experimental_websocket = true;
   bool experimental_sqlite = false;
   bool experimental_webstorage = false;
+  bool experimental_blob_mmap = false;
+  uint64_t blob_spill_threshold = 0;
   std::string localstorage_file;
   bool experimental_global_navigator = true;
   bool experimental_global_web_crypto = true;
@@ -150,6 +152,7 @@ class EnvironmentOptions : public Options {
   bool network_family_autoselection = true;
   uint64_t network_family_autoselection_attempt_timeout = 250;
   uint64_t max_http_header_size = 16 * 1024;
+  uint64_t request_object_pool_size = 64;
   bool deprecation = true;
   bool force_async_hooks_checks = true;
   bool allow_native_addons = true;
@@ -167,12 +170,24 @@ class EnvironmentOptions : public Options {
   uint64_t cpu_prof_interval = kDefaultCpuProfInterval;
   std::string cpu_prof_name;
   bool cpu_prof = false;
+  // Continuous profiling samples less often by default, to keep its overhead
+  // low enough to leave on in production.
+  static const uint64_t kDefaultContinuousCpuProfInterval = 10000;
+  static const uint64_t kDefaultCpuProfWindow = 60000;
+  uint64_t cpu_prof_window = kDefaultCpuProfWindow;
+  bool cpu_prof_continuous = false;
+  std::string cpu_prof_signal;
+  static const uint64_t kDefaultCpuProfDuration = 10000;
+  uint64_t cpu_prof_duration = kDefaultCpuProfDuration;
   bool experimental_network_inspection = false;
   std::string heap_prof_dir;
   std::string heap_prof_name;
   static const uint64_t kDefaultHeapProfInterval = 512 * 1024;
   uint64_t heap_prof_interval = kDefaultHeapProfInterval;
   bool heap_prof = false;
+  static const uint64_t kDefaultHeapProfWindow = 60000;
+  uint64_t heap_prof_window = kDefaultHeapProfWindow;
+  bool heap_prof_continuous = false;
 #endif  // HAVE_INSPECTOR
   std::string redirect_warnings;
   std::string diagnostic_dir;
@@ -266,9 +281,11 @@ class PerIsolateOptions : public Options {
 
   std::shared_ptr<EnvironmentOptions> per_env { new EnvironmentOptions() };
   bool track_heap_objects = false;
+  uint64_t vm_code_cache_size = 0;
   bool report_uncaught_exception = false;
   bool report_on_signal = false;
   bool experimental_shadow_realm = false;
+  bool experimental_shared_structs = false;
   std::string report_signal = "SIGUSR2";
   bool build_snapshot = false;
   std::string build_snapshot_config;
@@ -297,8 +314,16 @@ class PerProcessOptions : public Options {
   std::string title;
   std::string trace_event_categories;
   std::string trace_event_file_pattern = "node_trace.${rotation}.log";
-  int64_t v8_thread_pool_size = 4;
+  std::string trace_event_format = "json";
+  // -1 picks 4 threads, or fewer under a cgroup CPU quota.
+  int64_t v8_thread_pool_size = -1;
   bool zero_fill_all_buffers = false;
+  int64_t array_buffer_pool_size = 8 * 1024 * 1024;
+  // 0 picks a limit based on the size of the libuv threadpool.
+  int64_t threadpool_fs_limit = 0;
+  int64_t threadpool_crypto_limit = 0;
+  int64_t threadpool_zlib_limit = 0;
+  int64_t threadpool_user_limit = 0;
   bool debug_arraybuffer_allocations = false;
   std::string disable_proto;
   // We enable the shared read-only heap which currently requires that the
@@ -326,6 +351,7 @@ class PerProcessOptions : public Options {
   std::string tls_cipher_list = DEFAULT_CIPHER_LIST_CORE;
   int64_t secure_heap = 0;
   int64_t secure_heap_min = 2;
+  int64_t crypto_threadpool_size = 0;
 #ifdef NODE_OPENSSL_CERT_STORE
   bool ssl_openssl_cert_store = true;
 #else
@@ -342,15 +368,20 @@ class PerProcessOptions : public Options {
 #endif
 
   bool disable_wasm_trap_handler = false;
+  bool experimental_fs_io_uring = false;
+  bool experimental_stat_cache = false;
+  bool experimental_watch_file_events = false;
 
   // Per-process because reports can be triggered outside a known V8 context.
   bool report_on_fatalerror = false;
   bool report_compact = false;
+  bool report_async = false;
   std::string report_directory;
   std::string report_filename;
 
   // TODO(addaleax): Some of these could probably be per-Environment.
   std::string use_largepages = "off";
+  bool use_largepages_heap = false;
   bool trace_sigint = false;
   std::vector<std::string> cmdline;
 
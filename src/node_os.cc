@@ -19,7 +19,9 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#include "base_object-inl.h"
 #include "env-inl.h"
+#include "memory_tracker-inl.h"
 #include "node_external_reference.h"
 #include "string_bytes.h"
 
@@ -34,6 +36,8 @@
 #include <array>
 #include <cerrno>
 #include <cstring>
+#include <string>
+#include <vector>
 
 namespace node {
 namespace os {
@@ -44,6 +48,7 @@ using v8::Boolean;
 using v8::Context;
 using v8::Float64Array;
 using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
 using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
@@ -135,6 +140,125 @@ static void GetCPUInfo(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+// Keeps the CPU times of the previous sample, so that utilization can be
+// computed from the deltas without building the objects of os.cpus() for
+// every core twice. The models and speeds of the cores do not change, so
+// they are read once and only turned into JS values when asked for.
+class CPUUsageSampler final : public BaseObject {
+ public:
+  CPUUsageSampler(Environment* env, Local<Object> object)
+      : BaseObject(env, object) {
+    MakeWeak();
+  }
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Sample(const FunctionCallbackInfo<Value>& args);
+  static void GetStaticInfo(const FunctionCallbackInfo<Value>& args);
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("previous",
+                                previous_.capacity() * sizeof(previous_[0]));
+    tracker->TrackField("models", models_);
+  }
+  SET_MEMORY_INFO_NAME(CPUUsageSampler)
+  SET_SELF_SIZE(CPUUsageSampler)
+
+ private:
+  // Returns the libuv error code of uv_cpu_info() on failure.
+  int Update(double* fields, size_t length);
+
+  std::vector<uv_cpu_times_s> previous_;
+  std::vector<std::string> models_;
+  std::vector<int> speeds_;
+};
+
+int CPUUsageSampler::Update(double* fields, size_t length) {
+  uv_cpu_info_t* cpu_infos;
+  int count;
+  int err = uv_cpu_info(&cpu_infos, &count);
+  if (err) return err;
+
+  if (models_.empty()) {
+    models_.reserve(count);
+    speeds_.reserve(count);
+    for (int i = 0; i < count; i++) {
+      models_.emplace_back(cpu_infos[i].model);
+      speeds_.push_back(cpu_infos[i].speed);
+    }
+  }
+
+  // Cores that came online since the last sample, and counters that went
+  // backwards because a core was replugged, have no meaningful delta.
+  auto delta = [](uint64_t now, uint64_t before) {
+    return now > before ? static_cast<double>(now - before) : 0;
+  };
+  previous_.resize(count);
+  for (int i = 0; i < count; i++) {
+    const uv_cpu_times_s& now = cpu_infos[i].cpu_times;
+    uv_cpu_times_s& before = previous_[i];
+    bool is_new =
+        before.user + before.nice + before.sys + before.idle + before.irq == 0;
+    if (2 * static_cast<size_t>(i) + 1 < length) {
+      if (is_new) {
+        fields[2 * i] = fields[2 * i + 1] = 0;
+      } else {
+        fields[2 * i] = delta(now.user, before.user) +
+                        delta(now.nice, before.nice) +
+                        delta(now.sys, before.sys) + delta(now.irq, before.irq);
+        fields[2 * i + 1] = delta(now.idle, before.idle);
+      }
+    }
+    before = now;
+  }
+
+  uv_free_cpu_info(cpu_infos, count);
+  return count;
+}
+
+void CPUUsageSampler::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CPUUsageSampler* sampler = new CPUUsageSampler(env, args.This());
+  // Take the first sample, which the first call to sample() is relative to.
+  sampler->Update(nullptr, 0);
+}
+
+// sample(array) writes the busy and idle milliseconds of each core since
+// the previous sample into the Float64Array |array|, as
+// [busy0, idle0, busy1, idle1, ...], and returns the number of cores.
+// Cores that do not fit into |array| are skipped, so that the caller can
+// allocate a larger one for the next call. Returns undefined if the CPU
+// times could not be read.
+void CPUUsageSampler::Sample(const FunctionCallbackInfo<Value>& args) {
+  CPUUsageSampler* sampler;
+  ASSIGN_OR_RETURN_UNWRAP(&sampler, args.This());
+  CHECK(args[0]->IsFloat64Array());
+
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  double* fields = reinterpret_cast<double*>(
+      static_cast<char*>(array->Buffer()->Data()) + array->ByteOffset());
+  int count = sampler->Update(fields, array->Length());
+  if (count < 0) return;
+  args.GetReturnValue().Set(count);
+}
+
+// getStaticInfo() returns [model, speed, model2, speed2, ...] as read by
+// the first sample.
+void CPUUsageSampler::GetStaticInfo(const FunctionCallbackInfo<Value>& args) {
+  CPUUsageSampler* sampler;
+  ASSIGN_OR_RETURN_UNWRAP(&sampler, args.This());
+  Isolate* isolate = args.GetIsolate();
+
+  std::vector<Local<Value>> result;
+  result.reserve(sampler->models_.size() * 2);
+  for (size_t i = 0; i < sampler->models_.size(); i++) {
+    result.emplace_back(OneByteString(isolate, sampler->models_[i].c_str()));
+    result.emplace_back(Number::New(isolate, sampler->speeds_[i]));
+  }
+  args.GetReturnValue().Set(Array::New(isolate, result.data(), result.size()));
+}
+
+
 static void GetFreeMemory(const FunctionCallbackInfo<Value>& args) {
   double amount = static_cast<double>(uv_get_free_memory());
   args.GetReturnValue().Set(amount);
@@ -381,7 +505,7 @@ static void GetPriority(const FunctionCallbackInfo<Value>& args) {
 }
 
 static void GetAvailableParallelism(const FunctionCallbackInfo<Value>& args) {
-  unsigned int parallelism = uv_available_parallelism();
+  unsigned int parallelism = node::GetAvailableParallelism();
   args.GetReturnValue().Set(parallelism);
 }
 
@@ -404,6 +528,17 @@ void Initialize(Local<Object> target,
   SetMethod(
       context, target, "getAvailableParallelism", GetAvailableParallelism);
   SetMethod(context, target, "getOSInformation", GetOSInformation);
+
+  Isolate* isolate = env->isolate();
+  Local<FunctionTemplate> sampler =
+      NewFunctionTemplate(isolate, CPUUsageSampler::New);
+  sampler->InstanceTemplate()->SetInternalFieldCount(
+      CPUUsageSampler::kInternalFieldCount);
+  SetProtoMethod(isolate, sampler, "sample", CPUUsageSampler::Sample);
+  SetProtoMethodNoSideEffect(
+      isolate, sampler, "getStaticInfo", CPUUsageSampler::GetStaticInfo);
+  SetConstructorFunction(context, target, "CPUUsageSampler", sampler);
+
   target
       ->Set(context,
             FIXED_ONE_BYTE_STRING(env->isolate(), "isBigEndian"),
@@ -425,6 +560,9 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetPriority);
   registry->Register(GetAvailableParallelism);
   registry->Register(GetOSInformation);
+  registry->Register(CPUUsageSampler::New);
+  registry->Register(CPUUsageSampler::Sample);
+  registry->Register(CPUUsageSampler::GetStaticInfo);
 }
 
 }  // namespace os
@@ -1,29 +1,43 @@
 #include "node_perf.h"
 #include "aliased_buffer-inl.h"
+#include "async_context_frame.h"
+#include "compile_cache.h"
 #include "env-inl.h"
 #include "histogram-inl.h"
 #include "memory_tracker-inl.h"
 #include "node_buffer.h"
 #include "node_external_reference.h"
+#include "node_file.h"
 #include "node_internals.h"
 #include "node_process-inl.h"
+#include "node_v8_platform-inl.h"
 #include "util-inl.h"
 
+#include <algorithm>
 #include <cinttypes>
+#include <cstring>
+#include <vector>
 
 namespace node {
 namespace performance {
 
+using v8::Array;
 using v8::Context;
 using v8::DontDelete;
+using v8::Float64Array;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::GCCallbackFlags;
 using v8::GCType;
+using v8::HandleScope;
+using v8::HeapSpaceStatistics;
+using v8::HeapStatistics;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
+using v8::LocalVector;
 using v8::MaybeLocal;
+using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::PropertyAttribute;
@@ -39,6 +53,7 @@ const uint64_t performance_process_start = PERFORMANCE_NOW();
 const double performance_process_start_timestamp =
     GetCurrentTimeInMicroseconds();
 uint64_t performance_v8_start;
+uint64_t performance_platform_start;
 
 PerformanceState::PerformanceState(Isolate* isolate,
                                    uint64_t time_origin,
@@ -67,6 +82,8 @@ PerformanceState::PerformanceState(Isolate* isolate,
   }
 }
 
+PerformanceState::~PerformanceState() = default;
+
 void PerformanceState::ResetMilestones() {
   size_t milestones_length = milestones.Length();
   for (size_t i = 0; i < milestones_length; ++i) {
@@ -127,12 +144,51 @@ void PerformanceState::Mark(PerformanceMilestone milestone, uint64_t ts) {
       TRACE_EVENT_SCOPE_THREAD, ts / 1000);
 }
 
+void LoopPhaseTimer::Start(uv_loop_t* loop, bool record_histograms) {
+  if (record_histograms) {
+    for (std::shared_ptr<Histogram>& histogram : histograms_) {
+      if (!histogram)
+        histogram = std::make_shared<Histogram>(Histogram::Options{});
+    }
+    record_histograms_ = true;
+  }
+  if (enabled_) return;
+  loop_ = loop;
+  current_ = NODE_PERFORMANCE_LOOP_PHASE_OTHER;
+  last_switch_ = PERFORMANCE_NOW();
+  last_idle_time_ = uv_metrics_idle_time(loop);
+  enabled_ = true;
+}
+
+void GCHeapStatistics::Collect(Isolate* isolate) {
+  HeapStatistics heap_statistics;
+  isolate->GetHeapStatistics(&heap_statistics);
+  used_heap_size = heap_statistics.used_heap_size();
+  total_heap_size = heap_statistics.total_heap_size();
+
+  size_t space_count = isolate->NumberOfHeapSpaces();
+  space_used_size.resize(space_count);
+  for (size_t i = 0; i < space_count; i++) {
+    HeapSpaceStatistics space_statistics;
+    isolate->GetHeapSpaceStatistics(&space_statistics, i);
+    space_used_size[i] = space_statistics.space_used_size();
+  }
+}
+
+void LoopPhaseTimer::Record(PerformanceLoopPhase phase, uint64_t duration) {
+  if (duration > 0) histograms_[phase]->Record(duration);
+}
+
 void SetupPerformanceObservers(const FunctionCallbackInfo<Value>& args) {
   Realm* realm = Realm::GetCurrent(args);
   // TODO(legendecas): Remove this check once the sub-realms are supported.
   CHECK_EQ(realm->kind(), Realm::Kind::kPrincipal);
   CHECK(args[0]->IsFunction());
   realm->set_performance_entry_callback(args[0].As<Function>());
+  // When given, GC entries are passed to this callback in batches instead of
+  // one by one to the entry callback.
+  if (args[1]->IsFunction())
+    realm->set_performance_gc_entries_callback(args[1].As<Function>());
 }
 
 // Marks the start of a GC cycle
@@ -147,8 +203,11 @@ void MarkGarbageCollectionStart(
   if (env->performance_state()->current_gc_type != 0) {
     return;
   }
-  env->performance_state()->performance_last_gc_start_mark = PERFORMANCE_NOW();
-  env->performance_state()->current_gc_type = type;
+  PerformanceState* state = env->performance_state();
+  state->performance_last_gc_start_mark = PERFORMANCE_NOW();
+  state->current_gc_type = type;
+  if (UNLIKELY(state->observers[NODE_PERFORMANCE_ENTRY_TYPE_GC]))
+    state->gc_start_heap_statistics.Collect(isolate);
 }
 
 MaybeLocal<Object> GCPerformanceEntryTraits::GetDetails(
@@ -174,9 +233,108 @@ MaybeLocal<Object> GCPerformanceEntryTraits::GetDetails(
     return MaybeLocal<Object>();
   }
 
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  const GCHeapStatistics& before = entry.details.before;
+  const GCHeapStatistics& after = entry.details.after;
+  auto set_number = [&](Local<Object> target, const char* key, double value) {
+    return target
+        ->Set(context,
+              OneByteString(isolate, key),
+              Number::New(isolate, value))
+        .IsJust();
+  };
+
+  if (!set_number(obj, "heapUsedBefore", before.used_heap_size) ||
+      !set_number(obj, "heapUsedAfter", after.used_heap_size) ||
+      !set_number(obj, "heapTotalBefore", before.total_heap_size) ||
+      !set_number(obj, "heapTotalAfter", after.total_heap_size) ||
+      !set_number(obj,
+                  "bytesFreed",
+                  static_cast<double>(before.used_heap_size) -
+                      static_cast<double>(after.used_heap_size))) {
+    return MaybeLocal<Object>();
+  }
+
+  // Heap statistics are only collected while GC entries are observed, so the
+  // first entry after observing starts may lack the sizes before it.
+  Local<Object> spaces = Object::New(isolate);
+  double bytes_promoted = 0;
+  size_t space_count = std::min(before.space_used_size.size(),
+                                after.space_used_size.size());
+  for (size_t i = 0; i < space_count; i++) {
+    HeapSpaceStatistics space_statistics;
+    isolate->GetHeapSpaceStatistics(&space_statistics, i);
+    const char* name = space_statistics.space_name();
+    double used_before = static_cast<double>(before.space_used_size[i]);
+    double used_after = static_cast<double>(after.space_used_size[i]);
+    // A scavenge only allocates in the old space to promote objects.
+    if (entry.details.kind == NODE_PERFORMANCE_GC_MINOR &&
+        strcmp(name, "old_space") == 0 && used_after > used_before) {
+      bytes_promoted = used_after - used_before;
+    }
+
+    Local<Object> space = Object::New(isolate);
+    if (!set_number(space, "usedBefore", used_before) ||
+        !set_number(space, "usedAfter", used_after) ||
+        !set_number(space, "bytesFreed", used_before - used_after) ||
+        !spaces->Set(context, OneByteString(isolate, name), space)
+             .IsJust()) {
+      return MaybeLocal<Object>();
+    }
+  }
+
+  if (!set_number(obj, "bytesPromoted", bytes_promoted) ||
+      !obj->Set(context, FIXED_ONE_BYTE_STRING(isolate, "spaces"), spaces)
+           .IsJust()) {
+    return MaybeLocal<Object>();
+  }
+
   return obj;
 }
 
+// Delivers the GC entries buffered since the last delivery, in one call when
+// a batch callback was set up.
+static void DeliverGCPerformanceEntries(Environment* env) {
+  PerformanceState* state = env->performance_state();
+  std::vector<std::unique_ptr<GCPerformanceEntry>> entries;
+  entries.swap(state->pending_gc_entries);
+  if (!state->observers[NODE_PERFORMANCE_ENTRY_TYPE_GC]) return;
+
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Local<Context> context = env->context();
+  Context::Scope context_scope(context);
+
+  Local<Function> callback = env->performance_gc_entries_callback();
+  if (callback.IsEmpty()) {
+    for (const auto& entry : entries)
+      entry->Notify(env);
+    return;
+  }
+
+  // The times array holds the start time and duration of each entry.
+  LocalVector<Value> times(isolate);
+  LocalVector<Value> details(isolate);
+  times.reserve(2 * entries.size());
+  details.reserve(entries.size());
+  for (const auto& entry : entries) {
+    Local<Object> detail;
+    if (!GCPerformanceEntryTraits::GetDetails(env, *entry).ToLocal(&detail))
+      return;
+    times.push_back(Number::New(isolate, entry->start_time));
+    times.push_back(Number::New(isolate, entry->duration));
+    details.push_back(detail);
+  }
+
+  Local<Value> argv[] = {
+    Array::New(isolate, times.data(), times.size()),
+    Array::New(isolate, details.data(), details.size())
+  };
+  MakeSyncCallback(
+      isolate, context->Global(), callback, arraysize(argv), argv);
+}
+
 // Marks the end of a GC cycle
 void MarkGarbageCollectionEnd(
     Isolate* isolate,
@@ -199,17 +357,26 @@ void MarkGarbageCollectionEnd(
   double duration = (PERFORMANCE_NOW() / NANOS_PER_MILLIS) -
                     (state->performance_last_gc_start_mark / NANOS_PER_MILLIS);
 
+  GCHeapStatistics after;
+  after.Collect(isolate);
+
   std::unique_ptr<GCPerformanceEntry> entry =
       std::make_unique<GCPerformanceEntry>(
           "gc",
           start_time,
           duration,
-          GCPerformanceEntry::Details(static_cast<PerformanceGCKind>(type),
-                                      static_cast<PerformanceGCFlags>(flags)));
-
-  env->SetImmediate([entry = std::move(entry)](Environment* env) {
-    entry->Notify(env);
-  }, CallbackFlags::kUnrefed);
+          GCPerformanceEntry::Details(
+              static_cast<PerformanceGCKind>(type),
+              static_cast<PerformanceGCFlags>(flags),
+              std::move(state->gc_start_heap_statistics),
+              std::move(after)));
+  state->gc_start_heap_statistics = GCHeapStatistics();
+
+  // GCs that happen before the entries are delivered join the same batch.
+  bool schedule = state->pending_gc_entries.empty();
+  state->pending_gc_entries.push_back(std::move(entry));
+  if (schedule)
+    env->SetImmediate(DeliverGCPerformanceEntries, CallbackFlags::kUnrefed);
 }
 
 void GarbageCollectionCleanupHook(void* data) {
@@ -282,6 +449,210 @@ void CreateELDHistogram(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(histogram->object());
 }
 
+void CreateLoopDelayHistogram(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  BaseObjectPtr<LoopDelayHistogram> histogram =
+      LoopDelayHistogram::Create(env, Histogram::Options { 1000 });
+  if (histogram)
+    args.GetReturnValue().Set(histogram->object());
+}
+
+// Starts recording threadpool wait and run times for this Environment and
+// returns their histograms, two per ThreadPoolWorkQueue category.
+void StartThreadPoolMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  ThreadPoolWorkQueue* queue = env->threadpool_work_queue();
+  queue->StartMonitoring();
+  Local<Value> histograms[2 * kThreadPoolWorkCategoryCount];
+  for (int i = 0; i < kThreadPoolWorkCategoryCount; i++) {
+    auto category = static_cast<ThreadPoolWorkQueue::Category>(i);
+    BaseObjectPtr<HistogramBase> wait_time =
+        HistogramBase::Create(env, queue->wait_time(category));
+    BaseObjectPtr<HistogramBase> run_time =
+        HistogramBase::Create(env, queue->run_time(category));
+    if (!wait_time || !run_time) return;
+    histograms[2 * i] = wait_time->object();
+    histograms[2 * i + 1] = run_time->object();
+  }
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), histograms, arraysize(histograms)));
+}
+
+void StopThreadPoolMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->threadpool_work_queue()->StopMonitoring();
+}
+
+// Starts recording the latency of fs operations and returns
+// { latency: { [operation]: histogram }, readBytes, writeBytes }.
+void StartFsLatencyMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  fs::LatencyMonitor* monitor = env->fs_latency_monitor();
+  monitor->StartMonitoring();
+
+  Local<Object> latency = Object::New(isolate);
+  for (int i = 0; i < fs::LatencyMonitor::kTypeCount; i++) {
+    auto type = static_cast<uv_fs_type>(i);
+    const char* name = fs::LatencyMonitor::GetTypeName(type);
+    if (name == nullptr) continue;
+    BaseObjectPtr<HistogramBase> histogram =
+        HistogramBase::Create(env, monitor->latency(type));
+    if (!histogram ||
+        latency
+            ->Set(context, OneByteString(isolate, name), histogram->object())
+            .IsNothing()) {
+      return;
+    }
+  }
+  BaseObjectPtr<HistogramBase> read_bytes =
+      HistogramBase::Create(env, monitor->read_bytes());
+  BaseObjectPtr<HistogramBase> write_bytes =
+      HistogramBase::Create(env, monitor->write_bytes());
+  if (!read_bytes || !write_bytes) return;
+
+  Local<Object> result = Object::New(isolate);
+  if (result->Set(context, FIXED_ONE_BYTE_STRING(isolate, "latency"), latency)
+          .IsNothing() ||
+      result
+          ->Set(context,
+                FIXED_ONE_BYTE_STRING(isolate, "readBytes"),
+                read_bytes->object())
+          .IsNothing() ||
+      result
+          ->Set(context,
+                FIXED_ONE_BYTE_STRING(isolate, "writeBytes"),
+                write_bytes->object())
+          .IsNothing()) {
+    return;
+  }
+  args.GetReturnValue().Set(result);
+}
+
+void StopFsLatencyMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->fs_latency_monitor()->StopMonitoring();
+}
+
+// Starts charging the active time of the event loop to its phases. With a
+// truthy argument, also returns one histogram per phase, in the order of
+// NODE_PERFORMANCE_LOOP_PHASES.
+void StartLoopPhaseMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LoopPhaseTimer* timer = env->loop_phase_timer();
+  bool record_histograms = args[0]->IsTrue();
+  timer->Start(env->event_loop(), record_histograms);
+  if (!record_histograms) return;
+
+  Local<Value> histograms[NODE_PERFORMANCE_LOOP_PHASE_INVALID];
+  for (int i = 0; i < NODE_PERFORMANCE_LOOP_PHASE_INVALID; i++) {
+    BaseObjectPtr<HistogramBase> histogram = HistogramBase::Create(
+        env, timer->histogram(static_cast<PerformanceLoopPhase>(i)));
+    if (!histogram) return;
+    histograms[i] = histogram->object();
+  }
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), histograms, arraysize(histograms)));
+}
+
+void StopLoopPhaseMonitoring(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->loop_phase_timer()->Stop();
+}
+
+// Fills a Float64Array with the active time, in milliseconds, charged to each
+// event loop phase while monitoring was on.
+void GetLoopPhaseTimes(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), NODE_PERFORMANCE_LOOP_PHASE_INVALID);
+  double* data = static_cast<double*>(array->Buffer()->Data()) +
+                 array->ByteOffset() / sizeof(double);
+  LoopPhaseTimer* timer = env->loop_phase_timer();
+  for (int i = 0; i < NODE_PERFORMANCE_LOOP_PHASE_INVALID; i++) {
+    data[i] = static_cast<double>(
+                  timer->total(static_cast<PerformanceLoopPhase>(i))) /
+              NANOS_PER_MILLIS;
+  }
+}
+
+// Fills a Float64Array with the number of queued and running tasks for each
+// ThreadPoolWorkQueue category.
+void GetThreadPoolCounts(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(),
+           2 * kThreadPoolWorkCategoryCount);
+  double* data = static_cast<double*>(array->Buffer()->Data()) +
+                 array->ByteOffset() / sizeof(double);
+  ThreadPoolWorkQueue* queue = env->threadpool_work_queue();
+  for (int i = 0; i < kThreadPoolWorkCategoryCount; i++) {
+    auto category = static_cast<ThreadPoolWorkQueue::Category>(i);
+    data[2 * i] = static_cast<double>(queue->queued(category));
+    data[2 * i + 1] = static_cast<double>(queue->running(category));
+  }
+}
+
+// Fills a Float64Array with the AsyncContextFrame counters of this
+// Environment, in the order of async_context_frame::CounterFields.
+void GetAsyncContextFrameCounts(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), async_context_frame::kCounterFieldsCount);
+  double* data = static_cast<double*>(array->Buffer()->Data()) +
+                 array->ByteOffset() / sizeof(double);
+  AliasedFloat64Array& counters = env->async_context_frame_counters();
+  for (int i = 0; i < async_context_frame::kCounterFieldsCount; i++)
+    data[i] = counters[i];
+}
+
+// Fills a Float64Array with the ForegroundTaskStats of this isolate. Returns
+// false if Node.js does not run the isolate's foreground tasks itself.
+void GetForegroundTaskStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), 4);
+  NodePlatform* platform = per_process::v8_platform.Platform();
+  ForegroundTaskStats stats;
+  if (platform == nullptr || env->isolate_data()->platform() != platform ||
+      !platform->GetForegroundTaskStats(env->isolate(), &stats)) {
+    return args.GetReturnValue().Set(false);
+  }
+  double* data = static_cast<double*>(array->Buffer()->Data()) +
+                 array->ByteOffset() / sizeof(double);
+  data[0] = static_cast<double>(stats.tasks_run);
+  data[1] = static_cast<double>(stats.delayed_tasks_run);
+  data[2] = static_cast<double>(stats.run_time) / NANOS_PER_MILLIS;
+  data[3] = static_cast<double>(stats.budget_exceeded);
+  args.GetReturnValue().Set(true);
+}
+
+// Fills a Float64Array with the startup counters of this Environment, in the
+// order of NODE_PERFORMANCE_STARTUP_COUNTERS.
+void GetStartupCounters(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), NODE_PERFORMANCE_STARTUP_COUNTER_INVALID);
+  double* data = static_cast<double*>(array->Buffer()->Data()) +
+                 array->ByteOffset() / sizeof(double);
+  Realm* realm = env->principal_realm();
+  data[NODE_PERFORMANCE_STARTUP_COUNTER_BUILTIN_COMPILE_TIME] =
+      static_cast<double>(realm->builtins_compile_time) / NANOS_PER_MILLIS;
+  data[NODE_PERFORMANCE_STARTUP_COUNTER_PACKAGE_JSON_READ_TIME] =
+      static_cast<double>(realm->package_json_read_time) / NANOS_PER_MILLIS;
+  CompileCacheHandler* handler = env->compile_cache_handler();
+  data[NODE_PERFORMANCE_STARTUP_COUNTER_COMPILE_CACHE_HITS] =
+      handler != nullptr ? static_cast<double>(handler->hits()) : 0;
+  data[NODE_PERFORMANCE_STARTUP_COUNTER_COMPILE_CACHE_MISSES] =
+      handler != nullptr ? static_cast<double>(handler->misses()) : 0;
+}
+
 void MarkBootstrapComplete(const FunctionCallbackInfo<Value>& args) {
   Realm* realm = Realm::GetCurrent(args);
   CHECK_EQ(realm->kind(), Realm::Kind::kPrincipal);
@@ -323,7 +694,32 @@ static void CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethod(isolate, target, "notify", Notify);
   SetMethod(isolate, target, "loopIdleTime", LoopIdleTime);
   SetMethod(isolate, target, "createELDHistogram", CreateELDHistogram);
+  SetMethod(
+      isolate, target, "createLoopDelayHistogram", CreateLoopDelayHistogram);
   SetMethod(isolate, target, "markBootstrapComplete", MarkBootstrapComplete);
+  SetMethod(isolate,
+            target,
+            "startThreadPoolMonitoring",
+            StartThreadPoolMonitoring);
+  SetMethod(
+      isolate, target, "stopThreadPoolMonitoring", StopThreadPoolMonitoring);
+  SetMethod(
+      isolate, target, "startFsLatencyMonitoring", StartFsLatencyMonitoring);
+  SetMethod(
+      isolate, target, "stopFsLatencyMonitoring", StopFsLatencyMonitoring);
+  SetMethod(isolate, target, "getThreadPoolCounts", GetThreadPoolCounts);
+  SetMethod(
+      isolate, target, "startLoopPhaseMonitoring", StartLoopPhaseMonitoring);
+  SetMethod(
+      isolate, target, "stopLoopPhaseMonitoring", StopLoopPhaseMonitoring);
+  SetMethod(isolate, target, "getLoopPhaseTimes", GetLoopPhaseTimes);
+  SetMethod(
+      isolate, target, "getForegroundTaskStats", GetForegroundTaskStats);
+  SetMethod(isolate,
+            target,
+            "getAsyncContextFrameCounts",
+            GetAsyncContextFrameCounts);
+  SetMethod(isolate, target, "getStartupCounters", GetStartupCounters);
   SetFastMethodNoSideEffect(
       isolate, target, "now", SlowPerformanceNow, &fast_performance_now);
 }
@@ -350,6 +746,12 @@ void CreatePerContextProperties(Local<Object> target,
   NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_GC_INCREMENTAL);
   NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_GC_WEAKCB);
 
+  NODE_DEFINE_CONSTANT(constants, kThreadPoolWorkFs);
+  NODE_DEFINE_CONSTANT(constants, kThreadPoolWorkCrypto);
+  NODE_DEFINE_CONSTANT(constants, kThreadPoolWorkZlib);
+  NODE_DEFINE_CONSTANT(constants, kThreadPoolWorkUser);
+  NODE_DEFINE_CONSTANT(constants, kThreadPoolWorkCategoryCount);
+
   NODE_DEFINE_CONSTANT(
     constants, NODE_PERFORMANCE_GC_FLAGS_NO);
   NODE_DEFINE_CONSTANT(
@@ -370,11 +772,23 @@ void CreatePerContextProperties(Local<Object> target,
   NODE_PERFORMANCE_ENTRY_TYPES(V)
 #undef V
 
+#define V(name, _)                                                            \
+  NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_LOOP_PHASE_##name);
+  NODE_PERFORMANCE_LOOP_PHASES(V)
+#undef V
+  NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_LOOP_PHASE_INVALID);
+
 #define V(name, _)                                                            \
   NODE_DEFINE_HIDDEN_CONSTANT(constants, NODE_PERFORMANCE_MILESTONE_##name);
   NODE_PERFORMANCE_MILESTONES(V)
 #undef V
 
+#define V(name, _)                                                            \
+  NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_STARTUP_COUNTER_##name);
+  NODE_PERFORMANCE_STARTUP_COUNTERS(V)
+#undef V
+  NODE_DEFINE_CONSTANT(constants, NODE_PERFORMANCE_STARTUP_COUNTER_INVALID);
+
   PropertyAttribute attr =
       static_cast<PropertyAttribute>(ReadOnly | DontDelete);
 
@@ -389,12 +803,25 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Notify);
   registry->Register(LoopIdleTime);
   registry->Register(CreateELDHistogram);
+  registry->Register(CreateLoopDelayHistogram);
   registry->Register(MarkBootstrapComplete);
+  registry->Register(StartThreadPoolMonitoring);
+  registry->Register(StopThreadPoolMonitoring);
+  registry->Register(StartFsLatencyMonitoring);
+  registry->Register(StopFsLatencyMonitoring);
+  registry->Register(GetThreadPoolCounts);
+  registry->Register(StartLoopPhaseMonitoring);
+  registry->Register(StopLoopPhaseMonitoring);
+  registry->Register(GetLoopPhaseTimes);
+  registry->Register(GetForegroundTaskStats);
+  registry->Register(GetAsyncContextFrameCounts);
+  registry->Register(GetStartupCounters);
   registry->Register(SlowPerformanceNow);
   registry->Register(FastPerformanceNow);
   registry->Register(fast_performance_now.GetTypeInfo());
   HistogramBase::RegisterExternalReferences(registry);
   IntervalHistogram::RegisterExternalReferences(registry);
+  LoopDelayHistogram::RegisterExternalReferences(registry);
 }
 }  // namespace performance
 }  // namespace node
@@ -13,6 +13,7 @@
 #include "uv.h"
 
 #include <string>
+#include <utility>
 
 namespace node {
 
@@ -146,9 +147,17 @@ struct GCPerformanceEntryTraits {
   struct Details {
     PerformanceGCKind kind;
     PerformanceGCFlags flags;
-
-    Details(PerformanceGCKind kind_, PerformanceGCFlags flags_)
-        : kind(kind_), flags(flags_) {}
+    GCHeapStatistics before;
+    GCHeapStatistics after;
+
+    Details(PerformanceGCKind kind_,
+            PerformanceGCFlags flags_,
+            GCHeapStatistics before_,
+            GCHeapStatistics after_)
+        : kind(kind_),
+          flags(flags_),
+          before(std::move(before_)),
+          after(std::move(after_)) {}
   };
 
   static v8::MaybeLocal<v8::Object> GetDetails(
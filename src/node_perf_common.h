@@ -11,9 +11,14 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace node {
+
+class Histogram;
+
 namespace performance {
 
 #define PERFORMANCE_NOW() uv_hrtime()
@@ -23,17 +28,33 @@ namespace performance {
 extern const uint64_t performance_process_start;
 extern const double performance_process_start_timestamp;
 extern uint64_t performance_v8_start;
+extern uint64_t performance_platform_start;
 
+// platformStart is when the V8 platform starts to be initialized, and
+// environmentCreated is when the Environment has been deserialized from the
+// snapshot or bootstrapped from scratch. firstTick is the end of the first
+// event loop iteration.
 #define NODE_PERFORMANCE_MILESTONES(V)                                         \
   V(TIME_ORIGIN_TIMESTAMP, "timeOriginTimestamp")                              \
   V(TIME_ORIGIN, "timeOrigin")                                                 \
   V(ENVIRONMENT, "environment")                                                \
   V(NODE_START, "nodeStart")                                                   \
+  V(PLATFORM_START, "platformStart")                                           \
   V(V8_START, "v8Start")                                                       \
+  V(ENVIRONMENT_CREATED, "environmentCreated")                                 \
   V(LOOP_START, "loopStart")                                                   \
+  V(FIRST_TICK, "firstTick")                                                   \
   V(LOOP_EXIT, "loopExit")                                                     \
   V(BOOTSTRAP_COMPLETE, "bootstrapComplete")
 
+// Work during startup that is spread over many calls, and so is accumulated
+// rather than marked. Times are in milliseconds.
+#define NODE_PERFORMANCE_STARTUP_COUNTERS(V)                                   \
+  V(BUILTIN_COMPILE_TIME, "builtinCompileTime")                                \
+  V(PACKAGE_JSON_READ_TIME, "packageJsonReadTime")                             \
+  V(COMPILE_CACHE_HITS, "compileCacheHits")                                    \
+  V(COMPILE_CACHE_MISSES, "compileCacheMisses")
+
 #define NODE_PERFORMANCE_ENTRY_TYPES(V)                                       \
   V(GC, "gc")                                                                 \
   V(HTTP, "http")                                                             \
@@ -41,6 +62,17 @@ extern uint64_t performance_v8_start;
   V(NET, "net")                                                               \
   V(DNS, "dns")
 
+// Phases of the event loop that LoopPhaseTimer attributes active time to.
+// Time that none of the instrumented phases claims, such as pending callbacks
+// and the main script, counts as other.
+#define NODE_PERFORMANCE_LOOP_PHASES(V)                                        \
+  V(TIMERS, "timers")                                                          \
+  V(IO, "io")                                                                  \
+  V(IMMEDIATES, "immediates")                                                  \
+  V(MICROTASKS, "microtasks")                                                  \
+  V(CLOSE, "close")                                                            \
+  V(OTHER, "other")
+
 enum PerformanceMilestone {
 #define V(name, _) NODE_PERFORMANCE_MILESTONE_##name,
   NODE_PERFORMANCE_MILESTONES(V)
@@ -48,6 +80,13 @@ enum PerformanceMilestone {
   NODE_PERFORMANCE_MILESTONE_INVALID
 };
 
+enum PerformanceStartupCounter {
+#define V(name, _) NODE_PERFORMANCE_STARTUP_COUNTER_##name,
+  NODE_PERFORMANCE_STARTUP_COUNTERS(V)
+#undef V
+  NODE_PERFORMANCE_STARTUP_COUNTER_INVALID
+};
+
 enum PerformanceEntryType {
 #define V(name, _) NODE_PERFORMANCE_ENTRY_TYPE_##name,
   NODE_PERFORMANCE_ENTRY_TYPES(V)
@@ -55,6 +94,129 @@ enum PerformanceEntryType {
   NODE_PERFORMANCE_ENTRY_TYPE_INVALID
 };
 
+enum PerformanceLoopPhase {
+#define V(name, _) NODE_PERFORMANCE_LOOP_PHASE_##name,
+  NODE_PERFORMANCE_LOOP_PHASES(V)
+#undef V
+  NODE_PERFORMANCE_LOOP_PHASE_INVALID
+};
+
+// Accumulates the active time of an Environment's event loop per phase, in
+// nanoseconds. Each nanosecond is charged to exactly one phase: entering a
+// nested phase, such as the microtask checkpoint after a timer callback,
+// pauses the enclosing one. Time the loop spends blocked in poll is left out,
+// since uv_metrics_idle_time() already reports it. While stopped, a Scope
+// costs a single branch.
+class LoopPhaseTimer {
+ public:
+  class Scope {
+   public:
+    inline Scope(LoopPhaseTimer* timer, PerformanceLoopPhase phase);
+    inline ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    LoopPhaseTimer* timer_;
+    PerformanceLoopPhase phase_;
+    PerformanceLoopPhase previous_;
+    uint64_t total_at_enter_;
+  };
+
+  bool enabled() const { return enabled_; }
+  // With record_histograms, the time charged to each occurrence of a phase
+  // is also recorded into that phase's histogram.
+  void Start(uv_loop_t* loop, bool record_histograms);
+  void Stop() { enabled_ = false; }
+
+  // Called from the prepare and check hooks around the poll phase.
+  inline void EnterPoll();
+  inline void LeavePoll();
+
+  uint64_t total(PerformanceLoopPhase phase) const { return totals_[phase]; }
+  const std::shared_ptr<Histogram>& histogram(
+      PerformanceLoopPhase phase) const {
+    return histograms_[phase];
+  }
+
+ private:
+  // Charges the time since the last switch to the current phase and makes
+  // phase current. Returns the previous phase.
+  inline PerformanceLoopPhase Switch(PerformanceLoopPhase phase);
+  void Record(PerformanceLoopPhase phase, uint64_t duration);
+
+  bool enabled_ = false;
+  bool record_histograms_ = false;
+  uv_loop_t* loop_ = nullptr;
+  PerformanceLoopPhase current_ = NODE_PERFORMANCE_LOOP_PHASE_OTHER;
+  uint64_t last_switch_ = 0;
+  uint64_t last_idle_time_ = 0;
+  uint64_t poll_total_at_enter_ = 0;
+  uint64_t totals_[NODE_PERFORMANCE_LOOP_PHASE_INVALID] = {};
+  std::shared_ptr<Histogram> histograms_[NODE_PERFORMANCE_LOOP_PHASE_INVALID];
+};
+
+PerformanceLoopPhase LoopPhaseTimer::Switch(PerformanceLoopPhase phase) {
+  uint64_t now = PERFORMANCE_NOW();
+  uint64_t elapsed = now - last_switch_;
+  if (current_ == NODE_PERFORMANCE_LOOP_PHASE_IO) {
+    uint64_t idle_time = uv_metrics_idle_time(loop_);
+    elapsed -= std::min(elapsed, idle_time - last_idle_time_);
+    last_idle_time_ = idle_time;
+  }
+  totals_[current_] += elapsed;
+  last_switch_ = now;
+
+  PerformanceLoopPhase previous = current_;
+  current_ = phase;
+  return previous;
+}
+
+void LoopPhaseTimer::EnterPoll() {
+  if (!enabled_) return;
+  last_idle_time_ = uv_metrics_idle_time(loop_);
+  Switch(NODE_PERFORMANCE_LOOP_PHASE_IO);
+  poll_total_at_enter_ = totals_[NODE_PERFORMANCE_LOOP_PHASE_IO];
+}
+
+void LoopPhaseTimer::LeavePoll() {
+  if (!enabled_ || current_ != NODE_PERFORMANCE_LOOP_PHASE_IO) return;
+  Switch(NODE_PERFORMANCE_LOOP_PHASE_OTHER);
+  if (record_histograms_) {
+    Record(NODE_PERFORMANCE_LOOP_PHASE_IO,
+           totals_[NODE_PERFORMANCE_LOOP_PHASE_IO] - poll_total_at_enter_);
+  }
+}
+
+LoopPhaseTimer::Scope::Scope(LoopPhaseTimer* timer,
+                             PerformanceLoopPhase phase)
+    : timer_(timer->enabled() ? timer : nullptr), phase_(phase) {
+  if (timer_ == nullptr) return;
+  previous_ = timer_->Switch(phase);
+  total_at_enter_ = timer_->totals_[phase];
+}
+
+LoopPhaseTimer::Scope::~Scope() {
+  if (timer_ == nullptr) return;
+  timer_->Switch(previous_);
+  if (timer_->record_histograms_)
+    timer_->Record(phase_, timer_->totals_[phase_] - total_at_enter_);
+}
+
+template <typename Traits>
+struct PerformanceEntry;
+struct GCPerformanceEntryTraits;
+
+// Heap sizes captured around a garbage collection for GC performance entries.
+struct GCHeapStatistics {
+  size_t used_heap_size = 0;
+  size_t total_heap_size = 0;
+  // Indexed like v8::Isolate::GetHeapSpaceStatistics().
+  std::vector<size_t> space_used_size;
+
+  void Collect(v8::Isolate* isolate);
+};
+
 class PerformanceState {
  public:
   struct SerializeInfo {
@@ -67,6 +229,7 @@ class PerformanceState {
                             uint64_t time_origin,
                             double time_origin_timestamp,
                             const SerializeInfo* info);
+  ~PerformanceState();
   SerializeInfo Serialize(v8::Local<v8::Context> context,
                           v8::SnapshotCreator* creator);
   void Deserialize(v8::Local<v8::Context> context,
@@ -80,6 +243,11 @@ class PerformanceState {
 
   uint64_t performance_last_gc_start_mark = 0;
   uint16_t current_gc_type = 0;
+  // Only collected while GC entries are observed.
+  GCHeapStatistics gc_start_heap_statistics;
+  // GC entries waiting to be delivered to JS together.
+  std::vector<std::unique_ptr<PerformanceEntry<GCPerformanceEntryTraits>>>
+      pending_gc_entries;
 
   void Mark(enum PerformanceMilestone milestone,
             uint64_t ts = PERFORMANCE_NOW());
@@ -5,6 +5,7 @@
 #include "debug_utils-inl.h"
 #include <algorithm>  // find_if(), find(), move()
 #include <cmath>  // llround()
+#include <deque>
 #include <memory>  // unique_ptr(), shared_ptr(), make_shared()
 
 namespace node {
@@ -16,47 +17,205 @@ using v8::Task;
 
 namespace {
 
-struct PlatformWorkerData {
-  TaskQueue<Task>* task_queue;
-  Mutex* platform_workers_mutex;
-  ConditionVariable* platform_workers_ready;
-  int* pending_platform_workers;
-  int id;
-};
+static int GetActualThreadPoolSize(int thread_pool_size) {
+  if (thread_pool_size < 1) {
+    thread_pool_size = GetAvailableParallelism() - 1;
+  }
+  return std::max(thread_pool_size, 1);
+}
 
-static void PlatformWorkerThread(void* data) {
-  std::unique_ptr<PlatformWorkerData>
-      worker_data(static_cast<PlatformWorkerData*>(data));
+}  // namespace
 
-  TaskQueue<Task>* pending_worker_tasks = worker_data->task_queue;
-  TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
-                        "PlatformWorkerThread");
+class WorkerThreadsTaskRunner::WorkerTaskQueue {
+ public:
+  static constexpr size_t kMaxWorkers = 256;
 
-  // Notify the main thread that the platform worker is ready.
-  {
-    Mutex::ScopedLock lock(*worker_data->platform_workers_mutex);
-    (*worker_data->pending_platform_workers)--;
-    worker_data->platform_workers_ready->Signal(lock);
+  WorkerTaskQueue() : lanes_(new std::atomic<Lane*>[kMaxWorkers]) {
+    for (size_t i = 0; i < kMaxWorkers; i++) lanes_[i].store(nullptr);
   }
 
-  while (std::unique_ptr<Task> task = pending_worker_tasks->BlockingPop()) {
-    task->Run();
-    pending_worker_tasks->NotifyOfCompletion();
+  ~WorkerTaskQueue() {
+    for (size_t i = 0; i < kMaxWorkers; i++) delete lanes_[i].load();
   }
-}
 
-static int GetActualThreadPoolSize(int thread_pool_size) {
-  if (thread_pool_size < 1) {
-    thread_pool_size = uv_available_parallelism() - 1;
+  WorkerTaskQueue(const WorkerTaskQueue&) = delete;
+  WorkerTaskQueue& operator=(const WorkerTaskQueue&) = delete;
+
+  // Workers with an id of at least count return from BlockingPop() once they
+  // are done with their current task. Must not be called concurrently with
+  // itself.
+  void SetWorkerCount(size_t count) {
+    CHECK_GT(count, 0);
+    CHECK_LE(count, kMaxWorkers);
+    size_t lane_count = lane_count_.load();
+    for (size_t i = lane_count; i < count; i++)
+      lanes_[i].store(new Lane(), std::memory_order_release);
+    // Lanes are never removed, so that tasks still queued for workers that
+    // have stopped can be stolen by the others.
+    if (count > lane_count) lane_count_.store(count);
+    worker_count_.store(count);
+
+    Mutex::ScopedLock lock(idle_mutex_);
+    tasks_available_.Broadcast(lock);
   }
-  return std::max(thread_pool_size, 1);
-}
 
-}  // namespace
+  void Push(v8::TaskPriority priority, std::unique_ptr<Task> task) {
+    // Tasks posted by a platform worker, e.g. the parallel parts of a GC
+    // phase, are queued for that worker. Others are spread over all workers.
+    size_t id = current_queue_ == this
+                    ? current_id_
+                    : next_lane_.fetch_add(1, std::memory_order_relaxed) %
+                          worker_count_.load();
+    Lane* lane = lanes_[id].load(std::memory_order_acquire);
+    size_t index = static_cast<size_t>(priority);
+    CHECK_LT(index, kPriorityCount);
+
+    outstanding_tasks_++;
+    // Incremented before the task is visible, so that workers which find no
+    // task while this is non-zero scan again instead of going to sleep.
+    pending_tasks_++;
+    {
+      Mutex::ScopedLock lock(lane->mutex);
+      lane->tasks[index].push_back(std::move(task));
+      lane->size[index].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (idle_workers_.load() > 0) {
+      Mutex::ScopedLock lock(idle_mutex_);
+      tasks_available_.Signal(lock);
+    }
+  }
+
+  // Returns nullptr once the queue is stopped or the worker should exit.
+  std::unique_ptr<Task> BlockingPop(size_t id) {
+    for (;;) {
+      if (stopped_.load() || id >= worker_count_.load()) return nullptr;
+      if (std::unique_ptr<Task> task = TryPop(id)) return task;
+
+      Mutex::ScopedLock lock(idle_mutex_);
+      idle_workers_++;
+      while (pending_tasks_.load() == 0 && !stopped_.load() &&
+             id < worker_count_.load()) {
+        tasks_available_.Wait(lock);
+      }
+      idle_workers_--;
+    }
+  }
+
+  void NotifyOfCompletion() {
+    if (--outstanding_tasks_ == 0) {
+      Mutex::ScopedLock lock(drain_mutex_);
+      tasks_drained_.Broadcast(lock);
+    }
+  }
 
+  void BlockingDrain() {
+    Mutex::ScopedLock lock(drain_mutex_);
+    while (outstanding_tasks_.load() > 0) {
+      tasks_drained_.Wait(lock);
+    }
+  }
+
+  void Stop() {
+    stopped_.store(true);
+    Mutex::ScopedLock lock(idle_mutex_);
+    tasks_available_.Broadcast(lock);
+  }
+
+  struct WorkerData {
+    WorkerTaskQueue* queue;
+    size_t id;
+    Mutex* platform_workers_mutex;
+    ConditionVariable* platform_workers_ready;
+    int* pending_platform_workers;
+  };
+
+  static void PlatformWorkerThread(void* data) {
+    std::unique_ptr<WorkerData> worker_data(static_cast<WorkerData*>(data));
+    WorkerTaskQueue* queue = worker_data->queue;
+    size_t id = worker_data->id;
+    TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
+                          "PlatformWorkerThread");
+    current_queue_ = queue;
+    current_id_ = id;
+
+    // Notify the main thread that the platform worker is ready.
+    {
+      Mutex::ScopedLock lock(*worker_data->platform_workers_mutex);
+      (*worker_data->pending_platform_workers)--;
+      worker_data->platform_workers_ready->Signal(lock);
+    }
+
+    while (std::unique_ptr<Task> task = queue->BlockingPop(id)) {
+      task->Run();
+      task.reset();
+      queue->NotifyOfCompletion();
+    }
+    current_queue_ = nullptr;
+  }
+
+ private:
+  static constexpr size_t kPriorityCount =
+      static_cast<size_t>(v8::TaskPriority::kMaxPriority) + 1;
+
+  struct Lane {
+    Mutex mutex;
+    std::deque<std::unique_ptr<Task>> tasks[kPriorityCount];
+    // Read without holding the mutex to skip empty queues.
+    std::atomic<size_t> size[kPriorityCount] = {};
+  };
+
+  // Takes the oldest task of the highest priority that any worker has queued,
+  // looking at the queues of worker `id` first.
+  std::unique_ptr<Task> TryPop(size_t id) {
+    size_t lane_count = lane_count_.load();
+    for (size_t index = kPriorityCount; index-- > 0;) {
+      for (size_t i = 0; i < lane_count; i++) {
+        Lane* lane = lanes_[(id + i) % lane_count].load(
+            std::memory_order_acquire);
+        if (lane->size[index].load(std::memory_order_relaxed) == 0) continue;
+        Mutex::ScopedLock lock(lane->mutex);
+        std::deque<std::unique_ptr<Task>>& tasks = lane->tasks[index];
+        if (tasks.empty()) continue;
+        std::unique_ptr<Task> task = std::move(tasks.front());
+        tasks.pop_front();
+        lane->size[index].fetch_sub(1, std::memory_order_relaxed);
+        pending_tasks_--;
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  static thread_local WorkerTaskQueue* current_queue_;
+  static thread_local size_t current_id_;
+
+  std::unique_ptr<std::atomic<Lane*>[]> lanes_;
+  std::atomic<size_t> lane_count_{0};
+  std::atomic<size_t> worker_count_{0};
+  std::atomic<size_t> next_lane_{0};
+
+  // Tasks that have been pushed but not taken by a worker yet.
+  std::atomic<size_t> pending_tasks_{0};
+  // Tasks that have been pushed but have not finished running yet.
+  std::atomic<size_t> outstanding_tasks_{0};
+  std::atomic<size_t> idle_workers_{0};
+  std::atomic<bool> stopped_{false};
+
+  Mutex idle_mutex_;
+  ConditionVariable tasks_available_;
+  Mutex drain_mutex_;
+  ConditionVariable tasks_drained_;
+};
+
+thread_local WorkerThreadsTaskRunner::WorkerTaskQueue*
+    WorkerThreadsTaskRunner::WorkerTaskQueue::current_queue_ = nullptr;
+thread_local size_t WorkerThreadsTaskRunner::WorkerTaskQueue::current_id_ = 0;
+
+// Keeps delayed tasks in a heap ordered by deadline and moves them to the
+// worker queues once they expire.
 class WorkerThreadsTaskRunner::DelayedTaskScheduler {
  public:
-  explicit DelayedTaskScheduler(TaskQueue<Task>* tasks)
+  explicit DelayedTaskScheduler(WorkerTaskQueue* tasks)
     : pending_worker_tasks_(tasks) {}
 
   std::unique_ptr<uv_thread_t> Start() {
@@ -64,133 +223,107 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
       static_cast<DelayedTaskScheduler*>(data)->Run();
     };
     std::unique_ptr<uv_thread_t> t { new uv_thread_t() };
-    uv_sem_init(&ready_, 0);
     CHECK_EQ(0, uv_thread_create(t.get(), start_thread, this));
-    uv_sem_wait(&ready_);
-    uv_sem_destroy(&ready_);
     return t;
   }
 
-  void PostDelayedTask(std::unique_ptr<Task> task, double delay_in_seconds) {
-    tasks_.Push(std::make_unique<ScheduleTask>(this, std::move(task),
-                                               delay_in_seconds));
-    uv_async_send(&flush_tasks_);
+  void PostDelayedTask(v8::TaskPriority priority,
+                       std::unique_ptr<Task> task,
+                       double delay_in_seconds) {
+    uint64_t delay_ns = std::max(llround(delay_in_seconds * 1e9), 0LL);
+    Mutex::ScopedLock lock(mutex_);
+    if (stopped_) return;
+    uint64_t sequence = next_sequence_++;
+    timers_.push_back(TimerEntry{
+        uv_hrtime() + delay_ns, sequence, priority, std::move(task)});
+    std::push_heap(timers_.begin(), timers_.end(), FiresLater);
+    // Run() only needs to wake up if the earliest deadline has changed.
+    if (timers_.front().sequence == sequence) timers_changed_.Signal(lock);
   }
 
   void Stop() {
-    tasks_.Push(std::make_unique<StopTask>(this));
-    uv_async_send(&flush_tasks_);
+    Mutex::ScopedLock lock(mutex_);
+    stopped_ = true;
+    timers_.clear();
+    timers_changed_.Signal(lock);
   }
 
  private:
-  void Run() {
-    TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
-                          "WorkerThreadsTaskRunner::DelayedTaskScheduler");
-    loop_.data = this;
-    CHECK_EQ(0, uv_loop_init(&loop_));
-    flush_tasks_.data = this;
-    CHECK_EQ(0, uv_async_init(&loop_, &flush_tasks_, FlushTasks));
-    uv_sem_post(&ready_);
-
-    uv_run(&loop_, UV_RUN_DEFAULT);
-    CheckedUvLoopClose(&loop_);
-  }
-
-  static void FlushTasks(uv_async_t* flush_tasks) {
-    DelayedTaskScheduler* scheduler =
-        ContainerOf(&DelayedTaskScheduler::loop_, flush_tasks->loop);
-    while (std::unique_ptr<Task> task = scheduler->tasks_.Pop())
-      task->Run();
-  }
-
-  class StopTask : public Task {
-   public:
-    explicit StopTask(DelayedTaskScheduler* scheduler): scheduler_(scheduler) {}
-
-    void Run() override {
-      std::vector<uv_timer_t*> timers;
-      for (uv_timer_t* timer : scheduler_->timers_)
-        timers.push_back(timer);
-      for (uv_timer_t* timer : timers)
-        scheduler_->TakeTimerTask(timer);
-      uv_close(reinterpret_cast<uv_handle_t*>(&scheduler_->flush_tasks_),
-               [](uv_handle_t* handle) {});
-    }
-
-   private:
-     DelayedTaskScheduler* scheduler_;
+  struct TimerEntry {
+    uint64_t deadline;
+    uint64_t sequence;
+    v8::TaskPriority priority;
+    std::unique_ptr<Task> task;
   };
 
-  class ScheduleTask : public Task {
-   public:
-    ScheduleTask(DelayedTaskScheduler* scheduler,
-                 std::unique_ptr<Task> task,
-                 double delay_in_seconds)
-      : scheduler_(scheduler),
-        task_(std::move(task)),
-        delay_in_seconds_(delay_in_seconds) {}
-
-    void Run() override {
-      uint64_t delay_millis = llround(delay_in_seconds_ * 1000);
-      std::unique_ptr<uv_timer_t> timer(new uv_timer_t());
-      CHECK_EQ(0, uv_timer_init(&scheduler_->loop_, timer.get()));
-      timer->data = task_.release();
-      CHECK_EQ(0, uv_timer_start(timer.get(), RunTask, delay_millis, 0));
-      scheduler_->timers_.insert(timer.release());
-    }
-
-   private:
-    DelayedTaskScheduler* scheduler_;
-    std::unique_ptr<Task> task_;
-    double delay_in_seconds_;
-  };
-
-  static void RunTask(uv_timer_t* timer) {
-    DelayedTaskScheduler* scheduler =
-        ContainerOf(&DelayedTaskScheduler::loop_, timer->loop);
-    scheduler->pending_worker_tasks_->Push(scheduler->TakeTimerTask(timer));
+  // Tasks with the same deadline are queued in the order they were posted.
+  static bool FiresLater(const TimerEntry& a, const TimerEntry& b) {
+    if (a.deadline != b.deadline) return a.deadline > b.deadline;
+    return a.sequence > b.sequence;
   }
 
-  std::unique_ptr<Task> TakeTimerTask(uv_timer_t* timer) {
-    std::unique_ptr<Task> task(static_cast<Task*>(timer->data));
-    uv_timer_stop(timer);
-    uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
-      delete reinterpret_cast<uv_timer_t*>(handle);
-    });
-    timers_.erase(timer);
-    return task;
+  void Run() {
+    TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
+                          "WorkerThreadsTaskRunner::DelayedTaskScheduler");
+    Mutex::ScopedLock lock(mutex_);
+    while (!stopped_) {
+      if (timers_.empty()) {
+        timers_changed_.Wait(lock);
+        continue;
+      }
+      uint64_t now = uv_hrtime();
+      uint64_t deadline = timers_.front().deadline;
+      if (deadline > now) {
+        timers_changed_.TimedWait(lock, deadline - now);
+        continue;
+      }
+      std::pop_heap(timers_.begin(), timers_.end(), FiresLater);
+      TimerEntry expired = std::move(timers_.back());
+      timers_.pop_back();
+      Mutex::ScopedUnlock unlock(lock);
+      pending_worker_tasks_->Push(expired.priority, std::move(expired.task));
+    }
   }
 
-  uv_sem_t ready_;
-  TaskQueue<Task>* pending_worker_tasks_;
+  WorkerTaskQueue* pending_worker_tasks_;
 
-  TaskQueue<Task> tasks_;
-  uv_loop_t loop_;
-  uv_async_t flush_tasks_;
-  std::unordered_set<uv_timer_t*> timers_;
+  Mutex mutex_;
+  ConditionVariable timers_changed_;
+  std::vector<TimerEntry> timers_;
+  uint64_t next_sequence_ = 0;
+  bool stopped_ = false;
 };
 
-WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
+WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size)
+    : pending_worker_tasks_(std::make_unique<WorkerTaskQueue>()),
+      delayed_task_scheduler_(std::make_unique<DelayedTaskScheduler>(
+          pending_worker_tasks_.get())) {
+  delayed_task_scheduler_thread_ = delayed_task_scheduler_->Start();
+  SetThreadPoolSize(thread_pool_size);
+  CHECK_GT(number_of_threads_.load(), 0);
+}
+
+WorkerThreadsTaskRunner::~WorkerThreadsTaskRunner() = default;
+
+void WorkerThreadsTaskRunner::StartThreads(size_t count) {
   Mutex platform_workers_mutex;
   ConditionVariable platform_workers_ready;
 
   Mutex::ScopedLock lock(platform_workers_mutex);
-  int pending_platform_workers = thread_pool_size;
+  int pending_platform_workers = 0;
 
-  delayed_task_scheduler_ = std::make_unique<DelayedTaskScheduler>(
-      &pending_worker_tasks_);
-  threads_.push_back(delayed_task_scheduler_->Start());
-
-  for (int i = 0; i < thread_pool_size; i++) {
-    PlatformWorkerData* worker_data = new PlatformWorkerData{
-      &pending_worker_tasks_, &platform_workers_mutex,
-      &platform_workers_ready, &pending_platform_workers, i
+  for (size_t i = threads_.size(); i < count; i++) {
+    auto* worker_data = new WorkerTaskQueue::WorkerData{
+      pending_worker_tasks_.get(), i, &platform_workers_mutex,
+      &platform_workers_ready, &pending_platform_workers
     };
     std::unique_ptr<uv_thread_t> t { new uv_thread_t() };
-    if (uv_thread_create(t.get(), PlatformWorkerThread,
+    if (uv_thread_create(t.get(), WorkerTaskQueue::PlatformWorkerThread,
                          worker_data) != 0) {
+      delete worker_data;
       break;
     }
+    pending_platform_workers++;
     threads_.push_back(std::move(t));
   }
 
@@ -201,29 +334,61 @@ WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
   }
 }
 
-void WorkerThreadsTaskRunner::PostTask(std::unique_ptr<Task> task) {
-  pending_worker_tasks_.Push(std::move(task));
+void WorkerThreadsTaskRunner::SetThreadPoolSize(int thread_pool_size) {
+  size_t count = std::min(static_cast<size_t>(std::max(thread_pool_size, 1)),
+                          WorkerTaskQueue::kMaxWorkers);
+  Mutex::ScopedLock lock(threads_mutex_);
+  if (has_shut_down_) return;
+
+  size_t current = threads_.size();
+  if (count > current) {
+    // Tasks may be queued for the new workers before their threads start,
+    // the existing workers steal them in the meantime.
+    pending_worker_tasks_->SetWorkerCount(count);
+    StartThreads(count);
+    if (threads_.size() < count) {
+      if (threads_.empty()) return;
+      pending_worker_tasks_->SetWorkerCount(threads_.size());
+    }
+  } else if (count < current) {
+    pending_worker_tasks_->SetWorkerCount(count);
+    for (size_t i = count; i < current; i++)
+      CHECK_EQ(0, uv_thread_join(threads_[i].get()));
+    threads_.resize(count);
+  }
+  number_of_threads_.store(static_cast<int>(threads_.size()));
+}
+
+void WorkerThreadsTaskRunner::PostTask(v8::TaskPriority priority,
+                                       std::unique_ptr<Task> task) {
+  pending_worker_tasks_->Push(priority, std::move(task));
 }
 
-void WorkerThreadsTaskRunner::PostDelayedTask(std::unique_ptr<Task> task,
+void WorkerThreadsTaskRunner::PostDelayedTask(v8::TaskPriority priority,
+                                              std::unique_ptr<Task> task,
                                               double delay_in_seconds) {
-  delayed_task_scheduler_->PostDelayedTask(std::move(task), delay_in_seconds);
+  delayed_task_scheduler_->PostDelayedTask(
+      priority, std::move(task), delay_in_seconds);
 }
 
 void WorkerThreadsTaskRunner::BlockingDrain() {
-  pending_worker_tasks_.BlockingDrain();
+  pending_worker_tasks_->BlockingDrain();
 }
 
 void WorkerThreadsTaskRunner::Shutdown() {
-  pending_worker_tasks_.Stop();
+  Mutex::ScopedLock lock(threads_mutex_);
+  if (has_shut_down_) return;
+  has_shut_down_ = true;
+  pending_worker_tasks_->Stop();
   delayed_task_scheduler_->Stop();
+  CHECK_EQ(0, uv_thread_join(delayed_task_scheduler_thread_.get()));
   for (size_t i = 0; i < threads_.size(); i++) {
     CHECK_EQ(0, uv_thread_join(threads_[i].get()));
   }
 }
 
 int WorkerThreadsTaskRunner::NumberOfWorkerThreads() const {
-  return threads_.size();
+  return number_of_threads_.load();
 }
 
 PerIsolatePlatformData::PerIsolatePlatformData(
@@ -233,6 +398,10 @@ PerIsolatePlatformData::PerIsolatePlatformData(
   CHECK_EQ(0, uv_async_init(loop, flush_tasks_, FlushTasks));
   flush_tasks_->data = static_cast<void*>(this);
   uv_unref(reinterpret_cast<uv_handle_t*>(flush_tasks_));
+  delayed_tasks_timer_ = new uv_timer_t();
+  CHECK_EQ(0, uv_timer_init(loop, delayed_tasks_timer_));
+  delayed_tasks_timer_->data = static_cast<void*>(this);
+  uv_unref(reinterpret_cast<uv_handle_t*>(delayed_tasks_timer_));
 }
 
 std::shared_ptr<v8::TaskRunner>
@@ -272,7 +441,6 @@ void PerIsolatePlatformData::PostDelayedTaskImpl(
   }
   std::unique_ptr<DelayedTask> delayed(new DelayedTask());
   delayed->task = std::move(task);
-  delayed->platform_data = shared_from_this();
   delayed->timeout = delay_in_seconds;
   foreground_delayed_tasks_.Push(std::move(delayed));
   uv_async_send(flush_tasks_);
@@ -309,12 +477,13 @@ void PerIsolatePlatformData::Shutdown() {
   // effectively deleting the tasks instead of running them.
   foreground_delayed_tasks_.PopAll();
   foreground_tasks_.PopAll();
+  deferred_tasks_ = {};
   scheduled_delayed_tasks_.clear();
 
-  // Both destroying the scheduled_delayed_tasks_ lists and closing
-  // flush_tasks_ handle add tasks to the event loop. We keep a count of all
-  // non-closed handles, and when that reaches zero, we inform any shutdown
-  // callbacks that the platform is done as far as this Isolate is concerned.
+  // Closing the flush_tasks_ and delayed_tasks_timer_ handles adds tasks to
+  // the event loop. We keep a count of all non-closed handles, and when that
+  // reaches zero, we inform any shutdown callbacks that the platform is done
+  // as far as this Isolate is concerned.
   self_reference_ = shared_from_this();
   uv_close(reinterpret_cast<uv_handle_t*>(flush_tasks_),
            [](uv_handle_t* handle) {
@@ -323,14 +492,24 @@ void PerIsolatePlatformData::Shutdown() {
     PerIsolatePlatformData* platform_data =
         static_cast<PerIsolatePlatformData*>(flush_tasks->data);
     platform_data->DecreaseHandleCount();
-    platform_data->self_reference_.reset();
   });
   flush_tasks_ = nullptr;
+  uv_close(reinterpret_cast<uv_handle_t*>(delayed_tasks_timer_),
+           [](uv_handle_t* handle) {
+    std::unique_ptr<uv_timer_t> timer {
+        reinterpret_cast<uv_timer_t*>(handle) };
+    PerIsolatePlatformData* platform_data =
+        static_cast<PerIsolatePlatformData*>(timer->data);
+    platform_data->DecreaseHandleCount();
+  });
+  delayed_tasks_timer_ = nullptr;
 }
 
 void PerIsolatePlatformData::DecreaseHandleCount() {
   CHECK_GE(uv_handle_count_, 1);
   if (--uv_handle_count_ == 0) {
+    // Keeps this object alive until the callbacks have run.
+    std::shared_ptr<PerIsolatePlatformData> self = std::move(self_reference_);
     for (const auto& callback : shutdown_callbacks_)
       callback.cb(callback.data);
   }
@@ -416,6 +595,20 @@ void NodePlatform::Shutdown() {
   }
 }
 
+bool NodePlatform::GetForegroundTaskStats(Isolate* isolate,
+                                          ForegroundTaskStats* stats) {
+  Mutex::ScopedLock lock(per_isolate_mutex_);
+  auto it = per_isolate_.find(isolate);
+  if (it == per_isolate_.end() || !it->second.second) return false;
+  *stats = it->second.second->stats();
+  return true;
+}
+
+void NodePlatform::SetThreadPoolSize(int thread_pool_size) {
+  worker_thread_task_runner_->SetThreadPoolSize(
+      GetActualThreadPoolSize(thread_pool_size));
+}
+
 int NodePlatform::NumberOfWorkerThreads() {
   return worker_thread_task_runner_->NumberOfWorkerThreads();
 }
@@ -442,20 +635,47 @@ void PerIsolatePlatformData::RunForegroundTask(std::unique_ptr<Task> task) {
   }
 }
 
-void PerIsolatePlatformData::DeleteFromScheduledTasks(DelayedTask* task) {
-  auto it = std::find_if(scheduled_delayed_tasks_.begin(),
-                         scheduled_delayed_tasks_.end(),
-                         [task](const DelayedTaskPointer& delayed) -> bool {
-          return delayed.get() == task;
-      });
-  CHECK_NE(it, scheduled_delayed_tasks_.end());
-  scheduled_delayed_tasks_.erase(it);
+bool PerIsolatePlatformData::IsDueLater(const ScheduledTask& a,
+                                        const ScheduledTask& b) {
+  if (a.due != b.due) return a.due > b.due;
+  return a.sequence > b.sequence;
 }
 
-void PerIsolatePlatformData::RunForegroundTask(uv_timer_t* handle) {
-  DelayedTask* delayed = ContainerOf(&DelayedTask::timer, handle);
-  delayed->platform_data->RunForegroundTask(std::move(delayed->task));
-  delayed->platform_data->DeleteFromScheduledTasks(delayed);
+void PerIsolatePlatformData::ScheduleDelayedTasksTimer() {
+  if (delayed_tasks_timer_ == nullptr) return;
+  if (scheduled_delayed_tasks_.empty()) {
+    uv_timer_stop(delayed_tasks_timer_);
+    return;
+  }
+  uint64_t now = uv_now(loop_);
+  uint64_t due = scheduled_delayed_tasks_.front().due;
+  uv_timer_start(
+      delayed_tasks_timer_, RunDelayedTasks, due > now ? due - now : 0, 0);
+}
+
+void PerIsolatePlatformData::RunDelayedTasks(uv_timer_t* timer) {
+  auto platform_data = static_cast<PerIsolatePlatformData*>(timer->data);
+  std::vector<ScheduledTask>& scheduled =
+      platform_data->scheduled_delayed_tasks_;
+  ForegroundTaskStats& stats = platform_data->stats_;
+  const uint64_t now = uv_now(timer->loop);
+  const uint64_t start = uv_hrtime();
+  uint64_t end = start;
+  while (!scheduled.empty() && scheduled.front().due <= now) {
+    if (end - start > kFlushBudgetNs) {
+      // The timer fires again after the loop has polled for I/O.
+      stats.budget_exceeded++;
+      break;
+    }
+    std::pop_heap(scheduled.begin(), scheduled.end(), IsDueLater);
+    std::unique_ptr<Task> task = std::move(scheduled.back().task);
+    scheduled.pop_back();
+    stats.delayed_tasks_run++;
+    platform_data->RunForegroundTask(std::move(task));
+    end = uv_hrtime();
+  }
+  stats.run_time += end - start;
+  platform_data->ScheduleDelayedTasksTimer();
 }
 
 void NodePlatform::DrainTasks(Isolate* isolate) {
@@ -471,39 +691,56 @@ void NodePlatform::DrainTasks(Isolate* isolate) {
 bool PerIsolatePlatformData::FlushForegroundTasksInternal() {
   bool did_work = false;
 
+  bool scheduled = false;
   while (std::unique_ptr<DelayedTask> delayed =
       foreground_delayed_tasks_.Pop()) {
     did_work = true;
+    scheduled = true;
     uint64_t delay_millis = llround(delayed->timeout * 1000);
+    scheduled_delayed_tasks_.push_back(
+        ScheduledTask{uv_now(loop_) + delay_millis,
+                      next_delayed_task_sequence_++,
+                      std::move(delayed->task)});
+    std::push_heap(scheduled_delayed_tasks_.begin(),
+                   scheduled_delayed_tasks_.end(),
+                   IsDueLater);
+  }
+  if (scheduled) ScheduleDelayedTasksTimer();
+
+  // Move all foreground tasks into a separate queue and flush that queue,
+  // after the tasks that a previous flush did not get to. This way tasks that
+  // are posted while flushing the queue will be run on the next call of
+  // FlushForegroundTasksInternal.
+  std::queue<std::unique_ptr<Task>> tasks;
+  tasks.swap(deferred_tasks_);
+  std::queue<std::unique_ptr<Task>> posted = foreground_tasks_.PopAll();
+  while (!posted.empty()) {
+    tasks.push(std::move(posted.front()));
+    posted.pop();
+  }
 
-    delayed->timer.data = static_cast<void*>(delayed.get());
-    uv_timer_init(loop_, &delayed->timer);
-    // Timers may not guarantee queue ordering of events with the same delay if
-    // the delay is non-zero. This should not be a problem in practice.
-    uv_timer_start(&delayed->timer, RunForegroundTask, delay_millis, 0);
-    uv_unref(reinterpret_cast<uv_handle_t*>(&delayed->timer));
-    uv_handle_count_++;
-
-    scheduled_delayed_tasks_.emplace_back(delayed.release(),
-                                          [](DelayedTask* delayed) {
-      uv_close(reinterpret_cast<uv_handle_t*>(&delayed->timer),
-               [](uv_handle_t* handle) {
-        std::unique_ptr<DelayedTask> task {
-            static_cast<DelayedTask*>(handle->data) };
-        task->platform_data->DecreaseHandleCount();
-      });
-    });
-  }
-  // Move all foreground tasks into a separate queue and flush that queue.
-  // This way tasks that are posted while flushing the queue will be run on the
-  // next call of FlushForegroundTasksInternal.
-  std::queue<std::unique_ptr<Task>> tasks = foreground_tasks_.PopAll();
+  const uint64_t start = uv_hrtime();
+  uint64_t end = start;
   while (!tasks.empty()) {
+    if (end - start > kFlushBudgetNs) {
+      // Let the event loop poll for I/O before running the rest.
+      stats_.budget_exceeded++;
+      while (!deferred_tasks_.empty()) {
+        tasks.push(std::move(deferred_tasks_.front()));
+        deferred_tasks_.pop();
+      }
+      deferred_tasks_.swap(tasks);
+      if (flush_tasks_ != nullptr) uv_async_send(flush_tasks_);
+      break;
+    }
     std::unique_ptr<Task> task = std::move(tasks.front());
     tasks.pop();
     did_work = true;
+    stats_.tasks_run++;
     RunForegroundTask(std::move(task));
+    end = uv_hrtime();
   }
+  stats_.run_time += end - start;
   return did_work;
 }
 
@@ -511,7 +748,7 @@ void NodePlatform::PostTaskOnWorkerThreadImpl(
     v8::TaskPriority priority,
     std::unique_ptr<v8::Task> task,
     const v8::SourceLocation& location) {
-  worker_thread_task_runner_->PostTask(std::move(task));
+  worker_thread_task_runner_->PostTask(priority, std::move(task));
 }
 
 void NodePlatform::PostDelayedTaskOnWorkerThreadImpl(
@@ -519,8 +756,8 @@ void NodePlatform::PostDelayedTaskOnWorkerThreadImpl(
     std::unique_ptr<v8::Task> task,
     double delay_in_seconds,
     const v8::SourceLocation& location) {
-  worker_thread_task_runner_->PostDelayedTask(std::move(task),
-                                              delay_in_seconds);
+  worker_thread_task_runner_->PostDelayedTask(
+      priority, std::move(task), delay_in_seconds);
 }
 
 IsolatePlatformDelegate* NodePlatform::ForIsolate(Isolate* isolate) {
@@ -3,6 +3,7 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
 #include <functional>
 #include <queue>
 #include <unordered_map>
@@ -44,9 +45,16 @@ class TaskQueue {
 
 struct DelayedTask {
   std::unique_ptr<v8::Task> task;
-  uv_timer_t timer;
   double timeout;
-  std::shared_ptr<PerIsolatePlatformData> platform_data;
+};
+
+struct ForegroundTaskStats {
+  uint64_t tasks_run;
+  uint64_t delayed_tasks_run;
+  // Time spent running tasks, in nanoseconds.
+  uint64_t run_time;
+  // Number of flushes that stopped because they ran out of time.
+  uint64_t budget_exceeded;
 };
 
 // This acts as the foreground task runner for a given Isolate.
@@ -70,10 +78,14 @@ class PerIsolatePlatformData
 
   // Returns true if work was dispatched or executed. New tasks that are
   // posted during flushing of the queue are postponed until the next
-  // flushing.
+  // flushing. A flush that takes longer than kFlushBudgetNs leaves the
+  // remaining tasks to the next iteration of the event loop.
   bool FlushForegroundTasksInternal();
 
   const uv_loop_t* event_loop() const { return loop_; }
+  const ForegroundTaskStats& stats() const { return stats_; }
+
+  static constexpr uint64_t kFlushBudgetNs = 10 * 1000 * 1000;
 
  private:
   // v8::TaskRunner implementation.
@@ -91,12 +103,13 @@ class PerIsolatePlatformData
       double delay_in_seconds,
       const v8::SourceLocation& location) override;
 
-  void DeleteFromScheduledTasks(DelayedTask* task);
   void DecreaseHandleCount();
 
   static void FlushTasks(uv_async_t* handle);
   void RunForegroundTask(std::unique_ptr<v8::Task> task);
-  static void RunForegroundTask(uv_timer_t* timer);
+  // Runs the delayed tasks that are due and re-arms delayed_tasks_timer_.
+  static void RunDelayedTasks(uv_timer_t* timer);
+  void ScheduleDelayedTasksTimer();
 
   struct ShutdownCallback {
     void (*cb)(void*);
@@ -106,40 +119,73 @@ class PerIsolatePlatformData
   ShutdownCbList shutdown_callbacks_;
   // shared_ptr to self to keep this object alive during shutdown.
   std::shared_ptr<PerIsolatePlatformData> self_reference_;
-  uint32_t uv_handle_count_ = 1;  // 1 = flush_tasks_
+  // flush_tasks_ and delayed_tasks_timer_.
+  uint32_t uv_handle_count_ = 2;
 
   v8::Isolate* const isolate_;
   uv_loop_t* const loop_;
   uv_async_t* flush_tasks_ = nullptr;
   TaskQueue<v8::Task> foreground_tasks_;
   TaskQueue<DelayedTask> foreground_delayed_tasks_;
+  // Tasks taken from foreground_tasks_ that a flush ran out of time for.
+  std::queue<std::unique_ptr<v8::Task>> deferred_tasks_;
+
+  // Delayed tasks that have been moved to this thread, in a min-heap ordered
+  // by due time. A single timer is armed for the earliest one.
+  struct ScheduledTask {
+    uint64_t due;  // In event loop time (milliseconds).
+    uint64_t sequence;
+    std::unique_ptr<v8::Task> task;
+  };
+  static bool IsDueLater(const ScheduledTask& a, const ScheduledTask& b);
+  std::vector<ScheduledTask> scheduled_delayed_tasks_;
+  uint64_t next_delayed_task_sequence_ = 0;
+  uv_timer_t* delayed_tasks_timer_ = nullptr;
 
-  // Use a custom deleter because libuv needs to close the handle first.
-  typedef std::unique_ptr<DelayedTask, void (*)(DelayedTask*)>
-      DelayedTaskPointer;
-  std::vector<DelayedTaskPointer> scheduled_delayed_tasks_;
+  ForegroundTaskStats stats_{};
 };
 
 // This acts as the single worker thread task runner for all Isolates.
+// Every platform worker thread has its own queues, one per v8::TaskPriority.
+// Threads take higher priority tasks first and steal from the queues of other
+// threads when their own are empty, so that posting and running tasks does
+// not serialize on a single lock.
 class WorkerThreadsTaskRunner {
  public:
   explicit WorkerThreadsTaskRunner(int thread_pool_size);
+  ~WorkerThreadsTaskRunner();
 
-  void PostTask(std::unique_ptr<v8::Task> task);
-  void PostDelayedTask(std::unique_ptr<v8::Task> task, double delay_in_seconds);
+  void PostTask(v8::TaskPriority priority, std::unique_ptr<v8::Task> task);
+  void PostDelayedTask(v8::TaskPriority priority,
+                       std::unique_ptr<v8::Task> task,
+                       double delay_in_seconds);
 
   void BlockingDrain();
   void Shutdown();
 
+  // Starts or stops platform worker threads until thread_pool_size of them
+  // are running. Threads that are stopped finish their current task first,
+  // the tasks queued for them are run by the others.
+  void SetThreadPoolSize(int thread_pool_size);
+
   int NumberOfWorkerThreads() const;
 
  private:
-  TaskQueue<v8::Task> pending_worker_tasks_;
+  class WorkerTaskQueue;
+  std::unique_ptr<WorkerTaskQueue> pending_worker_tasks_;
 
   class DelayedTaskScheduler;
   std::unique_ptr<DelayedTaskScheduler> delayed_task_scheduler_;
+  std::unique_ptr<uv_thread_t> delayed_task_scheduler_thread_;
 
+  // Must be called with threads_mutex_ held.
+  void StartThreads(size_t count);
+
+  // Protects threads_, which is indexed by the id of the worker thread.
+  Mutex threads_mutex_;
   std::vector<std::unique_ptr<uv_thread_t>> threads_;
+  std::atomic<int> number_of_threads_{0};
+  bool has_shut_down_ = false;
 };
 
 class NodePlatform : public MultiIsolatePlatform {
@@ -152,6 +198,15 @@ class NodePlatform : public MultiIsolatePlatform {
   void DrainTasks(v8::Isolate* isolate) override;
   void Shutdown();
 
+  // Returns false if the isolate is not registered or not driven by a libuv
+  // loop.
+  bool GetForegroundTaskStats(v8::Isolate* isolate,
+                              ForegroundTaskStats* stats);
+
+  // Resizes the pool of threads that run V8 background tasks. A value below
+  // 1 picks a size based on the available parallelism.
+  void SetThreadPoolSize(int thread_pool_size);
+
   // v8::Platform implementation.
   int NumberOfWorkerThreads() override;
   void PostTaskOnWorkerThreadImpl(v8::TaskPriority priority,
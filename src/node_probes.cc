@@ -0,0 +1,49 @@
+#include "node_probes.h"
+
+#if NODE_USE_STATIC_PROBES && defined(__linux__)
+
+// The semaphores live in the .probes section, where tracers look for them
+// through the probes' ELF notes. Their C linkage comes from node_probes.h.
+#define V(name)                                                                \
+  unsigned short node_##name##_semaphore                                       \
+      __attribute__((section(".probes"), used)) = 0;
+NODE_PROBES(V)
+#undef V
+
+#elif NODE_USE_STATIC_PROBES && defined(_WIN32)
+
+// {c68f4d00-9372-5a5e-7bf5-c01041ff52af}, the EventSource style GUID of the
+// name "Node.js", so that tools can enable the provider by name.
+TRACELOGGING_DEFINE_PROVIDER(node_probes_provider,
+                             "Node.js",
+                             (0xc68f4d00,
+                              0x9372,
+                              0x5a5e,
+                              0x7b,
+                              0xf5,
+                              0xc0,
+                              0x10,
+                              0x41,
+                              0xff,
+                              0x52,
+                              0xaf));
+
+#endif
+
+namespace node {
+namespace probes {
+
+void Initialize() {
+#if NODE_USE_STATIC_PROBES && defined(_WIN32)
+  TraceLoggingRegister(node_probes_provider);
+#endif
+}
+
+void TearDown() {
+#if NODE_USE_STATIC_PROBES && defined(_WIN32)
+  TraceLoggingUnregister(node_probes_provider);
+#endif
+}
+
+}  // namespace probes
+}  // namespace node
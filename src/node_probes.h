@@ -0,0 +1,105 @@
+#ifndef SRC_NODE_PROBES_H_
+#define SRC_NODE_PROBES_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+// Static probes on hot paths of the runtime, for tools like bpftrace,
+// SystemTap and perf on Linux (USDT) and for ETW consumers on Windows.
+// Probes are compiled in with ./configure --with-static-probes and cost a
+// single predictable branch while no tool is attached:
+//
+//   if (NODE_PROBE_ENABLED(fs__op__done))
+//     NODE_PROBE3(fs__op__done, req, syscall, result);
+//
+// Arguments are only evaluated while the probe is enabled. On Linux, a
+// probe named `fs__op__done` is available as `usdt:node:fs__op__done`.
+#define NODE_PROBES(V)                                                         \
+  /* (parser, type): type is 1 for requests and 2 for responses. */           \
+  V(http__message__start)                                                      \
+  /* (parser, method or status code, url) */                                  \
+  V(http__headers__complete)                                                   \
+  /* (parser) */                                                               \
+  V(http__message__done)                                                       \
+  /* (req, syscall) */                                                         \
+  V(fs__op__start)                                                             \
+  /* (req, syscall, result) */                                                 \
+  V(fs__op__done)                                                              \
+  /* (work, type) */                                                           \
+  V(threadpool__work__queued)                                                  \
+  /* (work, type) */                                                           \
+  V(threadpool__work__start)                                                   \
+  /* (work, type, status) */                                                   \
+  V(threadpool__work__done)                                                    \
+  /* (server handle, status) */                                                \
+  V(tcp__accept)                                                               \
+  /* (req) */                                                                  \
+  V(tcp__connect__start)                                                       \
+  /* (req, status) */                                                          \
+  V(tcp__connect__done)                                                        \
+  /* (type, flags): the v8::GCType and v8::GCCallbackFlags. */                \
+  V(gc__start)                                                                 \
+  /* (type, flags) */                                                          \
+  V(gc__done)
+
+#if NODE_USE_STATIC_PROBES && defined(__linux__)
+
+// Semaphores make the probes' enabled checks a load of a counter that the
+// tracer increments while attached.
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define V(name) extern "C" unsigned short node_##name##_semaphore;
+NODE_PROBES(V)
+#undef V
+
+#define NODE_PROBE_ENABLED(name) (node_##name##_semaphore != 0)
+#define NODE_PROBE1(name, a1) STAP_PROBE1(node, name, a1)
+#define NODE_PROBE2(name, a1, a2) STAP_PROBE2(node, name, a1, a2)
+#define NODE_PROBE3(name, a1, a2, a3) STAP_PROBE3(node, name, a1, a2, a3)
+
+#elif NODE_USE_STATIC_PROBES && defined(_WIN32)
+
+#include <windows.h>
+// windows.h has to come first.
+#include <TraceLoggingProvider.h>
+
+TRACELOGGING_DECLARE_PROVIDER(node_probes_provider);
+
+#define NODE_PROBE_ENABLED(name)                                               \
+  TraceLoggingProviderEnabled(node_probes_provider, 0, 0)
+#define NODE_PROBE1(name, a1)                                                  \
+  TraceLoggingWrite(node_probes_provider, #name, TraceLoggingValue(a1, "arg1"))
+#define NODE_PROBE2(name, a1, a2)                                              \
+  TraceLoggingWrite(node_probes_provider,                                      \
+                    #name,                                                     \
+                    TraceLoggingValue(a1, "arg1"),                             \
+                    TraceLoggingValue(a2, "arg2"))
+#define NODE_PROBE3(name, a1, a2, a3)                                          \
+  TraceLoggingWrite(node_probes_provider,                                      \
+                    #name,                                                     \
+                    TraceLoggingValue(a1, "arg1"),                             \
+                    TraceLoggingValue(a2, "arg2"),                             \
+                    TraceLoggingValue(a3, "arg3"))
+
+#else
+
+#define NODE_PROBE_ENABLED(name) false
+#define NODE_PROBE1(name, a1) static_cast<void>(0)
+#define NODE_PROBE2(name, a1, a2) static_cast<void>(0)
+#define NODE_PROBE3(name, a1, a2, a3) static_cast<void>(0)
+
+#endif
+
+namespace node {
+namespace probes {
+
+// Registers the ETW provider on Windows. A no-op everywhere else.
+void Initialize();
+void TearDown();
+
+}  // namespace probes
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_PROBES_H_
@@ -52,6 +52,17 @@ class BindingData : public SnapshotableObject {
  public:
   struct InternalFieldInfo : public node::InternalFieldInfoBase {
     AliasedBufferIndex hrtime_buffer;
+    AliasedBufferIndex resource_usage_buffer;
+  };
+
+  // The layout of resourceUsageBuffer. CPU times are in microseconds, and
+  // the RSS in bytes. A field is NaN if it could not be sampled.
+  enum ResourceUsageField {
+    kThreadCPUTime,
+    kProcessUserCPUTime,
+    kProcessSystemCPUTime,
+    kRss,
+    kResourceUsageFieldsCount
   };
 
   static void AddMethods(v8::Isolate* isolate,
@@ -86,12 +97,36 @@ class BindingData : public SnapshotableObject {
 
   static void SlowBigInt(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  // Writes the CPU time of the calling thread, which is the thread of the
+  // worker inside Workers, into resourceUsageBuffer.
+  static void ThreadCPUUsageImpl(BindingData* receiver);
+
+  static void FastThreadCPUUsage(v8::Local<v8::Value> receiver) {
+    ThreadCPUUsageImpl(FromV8Value(receiver));
+  }
+
+  static void SlowThreadCPUUsage(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Writes all fields of resourceUsageBuffer.
+  static void SampleResourceUsageImpl(BindingData* receiver);
+
+  static void FastSampleResourceUsage(v8::Local<v8::Value> receiver) {
+    SampleResourceUsageImpl(FromV8Value(receiver));
+  }
+
+  static void SlowSampleResourceUsage(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
   static void LoadEnvFile(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  private:
   // Buffer length in uint32.
   static constexpr size_t kHrTimeBufferLength = 3;
   AliasedUint32Array hrtime_buffer_;
+  // Sampled by the methods above, so that per-request accounting does not
+  // allocate a result object for every sample.
+  AliasedFloat64Array resource_usage_buffer_;
   InternalFieldInfo* internal_field_info_ = nullptr;
 
   // These need to be static so that we have their addresses available to
@@ -99,6 +134,8 @@ class BindingData : public SnapshotableObject {
   // time.
   static v8::CFunction fast_number_;
   static v8::CFunction fast_bigint_;
+  static v8::CFunction fast_thread_cpu_usage_;
+  static v8::CFunction fast_sample_resource_usage_;
 };
 
 }  // namespace process
@@ -7,6 +7,7 @@
 #include "node_dotenv.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_file.h"
 #include "node_internals.h"
 #include "node_process-inl.h"
 #include "path.h"
@@ -23,6 +24,8 @@
 
 #include <climits>  // PATH_MAX
 #include <cstdio>
+#include <ctime>  // clock_gettime
+#include <limits>
 
 #if defined(_MSC_VER)
 #include <direct.h>
@@ -95,6 +98,8 @@ static void Chdir(const FunctionCallbackInfo<Value>& args) {
     uv_cwd(buf, &cwd_len);
     return env->ThrowUVException(err, "chdir", nullptr, buf, *path);
   }
+  InvalidateCachedCwd();
+  fs::stat_cache::Clear();
 }
 
 inline Local<ArrayBuffer> get_fields_array_buffer(
@@ -512,7 +517,10 @@ BindingData::BindingData(Realm* realm,
     : SnapshotableObject(realm, object, type_int),
       hrtime_buffer_(realm->isolate(),
                      kHrTimeBufferLength,
-                     MAYBE_FIELD_PTR(info, hrtime_buffer)) {
+                     MAYBE_FIELD_PTR(info, hrtime_buffer)),
+      resource_usage_buffer_(realm->isolate(),
+                             kResourceUsageFieldsCount,
+                             MAYBE_FIELD_PTR(info, resource_usage_buffer)) {
   Isolate* isolate = realm->isolate();
   Local<Context> context = realm->context();
 
@@ -522,23 +530,44 @@ BindingData::BindingData(Realm* realm,
               FIXED_ONE_BYTE_STRING(isolate, "hrtimeBuffer"),
               hrtime_buffer_.GetJSArray())
         .ToChecked();
+    object
+        ->Set(context,
+              FIXED_ONE_BYTE_STRING(isolate, "resourceUsageBuffer"),
+              resource_usage_buffer_.GetJSArray())
+        .ToChecked();
   } else {
     hrtime_buffer_.Deserialize(realm->context());
+    resource_usage_buffer_.Deserialize(realm->context());
   }
 
-  // The hrtime buffer is referenced from the binding data js object.
-  // Make the native handle weak to avoid keeping the realm alive.
+  // The buffers are referenced from the binding data js object.
+  // Make the native handles weak to avoid keeping the realm alive.
   hrtime_buffer_.MakeWeak();
+  resource_usage_buffer_.MakeWeak();
 }
 
 v8::CFunction BindingData::fast_number_(v8::CFunction::Make(FastNumber));
 v8::CFunction BindingData::fast_bigint_(v8::CFunction::Make(FastBigInt));
+v8::CFunction BindingData::fast_thread_cpu_usage_(
+    v8::CFunction::Make(FastThreadCPUUsage));
+v8::CFunction BindingData::fast_sample_resource_usage_(
+    v8::CFunction::Make(FastSampleResourceUsage));
 
 void BindingData::AddMethods(Isolate* isolate, Local<ObjectTemplate> target) {
   SetFastMethodNoSideEffect(
       isolate, target, "hrtime", SlowNumber, &fast_number_);
   SetFastMethodNoSideEffect(
       isolate, target, "hrtimeBigInt", SlowBigInt, &fast_bigint_);
+  SetFastMethodNoSideEffect(isolate,
+                            target,
+                            "threadCpuUsage",
+                            SlowThreadCPUUsage,
+                            &fast_thread_cpu_usage_);
+  SetFastMethodNoSideEffect(isolate,
+                            target,
+                            "sampleResourceUsage",
+                            SlowSampleResourceUsage,
+                            &fast_sample_resource_usage_);
 }
 
 void BindingData::RegisterExternalReferences(
@@ -549,6 +578,12 @@ void BindingData::RegisterExternalReferences(
   registry->Register(FastBigInt);
   registry->Register(fast_number_.GetTypeInfo());
   registry->Register(fast_bigint_.GetTypeInfo());
+  registry->Register(SlowThreadCPUUsage);
+  registry->Register(SlowSampleResourceUsage);
+  registry->Register(FastThreadCPUUsage);
+  registry->Register(FastSampleResourceUsage);
+  registry->Register(fast_thread_cpu_usage_.GetTypeInfo());
+  registry->Register(fast_sample_resource_usage_.GetTypeInfo());
 }
 
 BindingData* BindingData::FromV8Value(Local<Value> value) {
@@ -559,6 +594,7 @@ BindingData* BindingData::FromV8Value(Local<Value> value) {
 
 void BindingData::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("hrtime_buffer", hrtime_buffer_);
+  tracker->TrackField("resource_usage_buffer", resource_usage_buffer_);
 }
 
 // This is the legacy version of hrtime before BigInt was introduced in
@@ -595,12 +631,74 @@ void BindingData::SlowNumber(const v8::FunctionCallbackInfo<v8::Value>& args) {
   NumberImpl(FromJSObject<BindingData>(args.This()));
 }
 
+// Unlike uv_getrusage(), which is process-wide, this only counts the time
+// spent on the calling thread.
+static double GetThreadCPUTime() {
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(),
+                      &creation_time,
+                      &exit_time,
+                      &kernel_time,
+                      &user_time)) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  // FILETIMEs count 100-nanosecond intervals.
+  uint64_t kernel = (static_cast<uint64_t>(kernel_time.dwHighDateTime) << 32) |
+                    kernel_time.dwLowDateTime;
+  uint64_t user = (static_cast<uint64_t>(user_time.dwHighDateTime) << 32) |
+                  user_time.dwLowDateTime;
+  return (kernel + user) / 10.0;
+#else
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    return std::numeric_limits<double>::quiet_NaN();
+  return MICROS_PER_SEC * ts.tv_sec + ts.tv_nsec / 1e3;
+#endif
+}
+
+void BindingData::ThreadCPUUsageImpl(BindingData* receiver) {
+  receiver->resource_usage_buffer_[kThreadCPUTime] = GetThreadCPUTime();
+}
+
+void BindingData::SampleResourceUsageImpl(BindingData* receiver) {
+  AliasedFloat64Array& fields = receiver->resource_usage_buffer_;
+  fields[kThreadCPUTime] = GetThreadCPUTime();
+
+  uv_rusage_t rusage;
+  if (uv_getrusage(&rusage) == 0) {
+    fields[kProcessUserCPUTime] =
+        MICROS_PER_SEC * rusage.ru_utime.tv_sec + rusage.ru_utime.tv_usec;
+    fields[kProcessSystemCPUTime] =
+        MICROS_PER_SEC * rusage.ru_stime.tv_sec + rusage.ru_stime.tv_usec;
+  } else {
+    fields[kProcessUserCPUTime] = std::numeric_limits<double>::quiet_NaN();
+    fields[kProcessSystemCPUTime] = std::numeric_limits<double>::quiet_NaN();
+  }
+
+  size_t rss;
+  fields[kRss] = uv_resident_set_memory(&rss) == 0
+                     ? static_cast<double>(rss)
+                     : std::numeric_limits<double>::quiet_NaN();
+}
+
+void BindingData::SlowThreadCPUUsage(const FunctionCallbackInfo<Value>& args) {
+  ThreadCPUUsageImpl(FromJSObject<BindingData>(args.This()));
+}
+
+void BindingData::SlowSampleResourceUsage(
+    const FunctionCallbackInfo<Value>& args) {
+  SampleResourceUsageImpl(FromJSObject<BindingData>(args.This()));
+}
+
 bool BindingData::PrepareForSerialization(Local<Context> context,
                                           v8::SnapshotCreator* creator) {
   DCHECK_NULL(internal_field_info_);
   internal_field_info_ = InternalFieldInfoBase::New<InternalFieldInfo>(type());
   internal_field_info_->hrtime_buffer =
       hrtime_buffer_.Serialize(context, creator);
+  internal_field_info_->resource_usage_buffer =
+      resource_usage_buffer_.Serialize(context, creator);
   // Return true because we need to maintain the reference to the binding from
   // JS land.
   return true;
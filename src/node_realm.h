@@ -123,6 +123,10 @@ class Realm : public MemoryRetainer {
   std::set<struct node_module*> internal_bindings;
   std::set<std::string> builtins_with_cache;
   std::set<std::string> builtins_without_cache;
+  // Time spent compiling builtins in this realm, in nanoseconds.
+  uint64_t builtins_compile_time = 0;
+  // Time spent reading and parsing package.json files, in nanoseconds.
+  uint64_t package_json_read_time = 0;
   // This is only filled during deserialization. We use a vector since
   // it's only used for tests.
   std::vector<std::string> builtins_in_snapshot;
@@ -23,6 +23,8 @@
 #include <cwctype>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <thread>
 
 constexpr int NODE_REPORT_VERSION = 3;
 constexpr int NANOS_PER_SEC = 1000 * 1000 * 1000;
@@ -53,7 +55,37 @@ using v8::V8;
 using v8::Value;
 
 namespace report {
+// The state that a report has to take on the thread that it is about. The
+// rest of the report is process-wide and can be filled in on any thread.
+struct ReportCapture {
+  std::string message;
+  std::string trigger;
+  std::string filename;
+  TIME_TYPE tm_struct;
+  std::string timestamp;
+  bool has_thread_id = false;
+  uint64_t thread_id = 0;
+  std::vector<std::string> cmdline;
+  bool compact = false;
+  bool exclude_network = false;
+  // The javascriptStack and javascriptHeap members of the report object.
+  std::string javascript;
+  std::vector<void*> native_stack;
+  // The uvthreadResourceUsage, libuv and workers members.
+  std::string thread;
+};
+
 // Internal/static function declarations
+static void CaptureNodeReport(Isolate* isolate,
+                              Environment* env,
+                              const char* message,
+                              const char* trigger,
+                              const std::string& filename,
+                              Local<Value> error,
+                              bool compact,
+                              bool exclude_network,
+                              ReportCapture* capture);
+static void WriteNodeReport(const ReportCapture& capture, std::ostream& out);
 static void WriteNodeReport(Isolate* isolate,
                             Environment* env,
                             const char* message,
@@ -76,8 +108,15 @@ static void PrintJavaScriptStack(JSONWriter* writer,
 static void PrintJavaScriptErrorProperties(JSONWriter* writer,
                                            Isolate* isolate,
                                            Local<Value> error);
-static void PrintNativeStack(JSONWriter* writer);
+static std::vector<void*> CaptureNativeStack();
+static void PrintNativeStack(JSONWriter* writer,
+                             const std::vector<void*>& frames);
 static void PrintResourceUsage(JSONWriter* writer);
+static void PrintThreadResourceUsage(JSONWriter* writer);
+static void PrintLibuv(JSONWriter* writer, Environment* env);
+static void PrintWorkers(JSONWriter* writer,
+                         Environment* env,
+                         const char* trigger);
 static void PrintGCStatistics(JSONWriter* writer, Isolate* isolate);
 static void PrintSystemInformation(JSONWriter* writer);
 static void PrintLoadedLibraries(JSONWriter* writer);
@@ -86,21 +125,73 @@ static void PrintRelease(JSONWriter* writer);
 static void PrintCpuInfo(JSONWriter* writer);
 static void PrintNetworkInterfaceInfo(JSONWriter* writer);
 
+// Takes everything that a report needs from the current thread: the
+// JavaScript stack and heap, the native stack, and the libuv handles and
+// workers of |env|.
+static void CaptureNodeReport(Isolate* isolate,
+                              Environment* env,
+                              const char* message,
+                              const char* trigger,
+                              const std::string& filename,
+                              Local<Value> error,
+                              bool compact,
+                              bool exclude_network,
+                              ReportCapture* capture) {
+  capture->message = message;
+  capture->trigger = trigger;
+  capture->filename = filename;
+  capture->compact = compact;
+  capture->exclude_network = exclude_network;
+
+  // Obtain the current time.
+  DiagnosticFilename::LocalTime(&capture->tm_struct);
+  uv_timeval64_t ts;
+  if (uv_gettimeofday(&ts) == 0)
+    capture->timestamp = std::to_string(ts.tv_sec * 1000 + ts.tv_usec / 1000);
+
+  if (env != nullptr) {
+    capture->has_thread_id = true;
+    capture->thread_id = env->thread_id();
+  }
+  capture->cmdline = per_process::cli_options->cmdline;
+
+  {
+    // Members of the report object come after the header, one level down.
+    std::ostringstream out;
+    JSONWriter writer(out, compact, 1);
+    writer.json_objectstart("javascriptStack");
+    if (isolate != nullptr) {
+      // Report summary JavaScript error stack backtrace
+      PrintJavaScriptErrorStack(&writer, isolate, error, trigger);
+      writer.json_objectend();  // the end of 'javascriptStack'
+
+      // Report V8 Heap and Garbage Collector information
+      PrintGCStatistics(&writer, isolate);
+    } else {
+      PrintEmptyJavaScriptStack(&writer);
+      writer.json_objectend();  // the end of 'javascriptStack'
+    }
+    capture->javascript = out.str();
+  }
+
+  capture->native_stack = CaptureNativeStack();
+
+  {
+    std::ostringstream out;
+    JSONWriter writer(out, compact, 1);
+    PrintThreadResourceUsage(&writer);
+    PrintLibuv(&writer, env);
+    PrintWorkers(&writer, env, trigger);
+    capture->thread = out.str();
+  }
+}
+
 // Internal function to coordinate and write the various
 // sections of the report to the supplied stream
-static void WriteNodeReport(Isolate* isolate,
-                            Environment* env,
-                            const char* message,
-                            const char* trigger,
-                            const std::string& filename,
-                            std::ostream& out,
-                            Local<Value> error,
-                            bool compact,
-                            bool exclude_network) {
-  // Obtain the current time and the pid.
-  TIME_TYPE tm_struct;
-  DiagnosticFilename::LocalTime(&tm_struct);
+static void WriteNodeReport(const ReportCapture& capture, std::ostream& out) {
+  // Obtain the pid.
   uv_pid_t pid = uv_os_getpid();
+  const TIME_TYPE& tm_struct = capture.tm_struct;
 
   // Save formatting for output stream.
   std::ios old_state(nullptr);
@@ -109,14 +200,14 @@ static void WriteNodeReport(Isolate* isolate,
   // File stream opened OK, now start printing the report content:
   // the title and header information (event, filename, timestamp and pid)
 
-  JSONWriter writer(out, compact);
+  JSONWriter writer(out, capture.compact);
   writer.json_start();
   writer.json_objectstart("header");
   writer.json_keyvalue("reportVersion", NODE_REPORT_VERSION);
-  writer.json_keyvalue("event", message);
-  writer.json_keyvalue("trigger", trigger);
-  if (!filename.empty())
-    writer.json_keyvalue("filename", filename);
+  writer.json_keyvalue("event", capture.message);
+  writer.json_keyvalue("trigger", capture.trigger);
+  if (!capture.filename.empty())
+    writer.json_keyvalue("filename", capture.filename);
   else
     writer.json_keyvalue("filename", JSONWriter::Null{});
 
@@ -146,16 +237,13 @@ static void WriteNodeReport(Isolate* isolate,
   writer.json_keyvalue("dumpEventTime", timebuf);
 #endif
 
-  uv_timeval64_t ts;
-  if (uv_gettimeofday(&ts) == 0) {
-    writer.json_keyvalue("dumpEventTimeStamp",
-                         std::to_string(ts.tv_sec * 1000 + ts.tv_usec / 1000));
-  }
+  if (!capture.timestamp.empty())
+    writer.json_keyvalue("dumpEventTimeStamp", capture.timestamp);
 
   // Report native process ID
   writer.json_keyvalue("processId", pid);
-  if (env != nullptr)
-    writer.json_keyvalue("threadId", env->thread_id());
+  if (capture.has_thread_id)
+    writer.json_keyvalue("threadId", capture.thread_id);
   else
     writer.json_keyvalue("threadId", JSONWriter::Null{});
 
@@ -168,59 +256,86 @@ static void WriteNodeReport(Isolate* isolate,
   }
 
   // Report out the command line.
-  if (!per_process::cli_options->cmdline.empty()) {
+  if (!capture.cmdline.empty()) {
     writer.json_arraystart("commandLine");
-    for (const std::string& arg : per_process::cli_options->cmdline) {
+    for (const std::string& arg : capture.cmdline) {
       writer.json_element(arg);
     }
     writer.json_arrayend();
   }
 
   // Report Node.js and OS version information
-  PrintVersionInformation(&writer, exclude_network);
+  PrintVersionInformation(&writer, capture.exclude_network);
   writer.json_objectend();
 
-  if (isolate != nullptr) {
-    writer.json_objectstart("javascriptStack");
-    // Report summary JavaScript error stack backtrace
-    PrintJavaScriptErrorStack(&writer, isolate, error, trigger);
-
-    writer.json_objectend();  // the end of 'javascriptStack'
-
-    // Report V8 Heap and Garbage Collector information
-    PrintGCStatistics(&writer, isolate);
-  } else {
-    writer.json_objectstart("javascriptStack");
-    PrintEmptyJavaScriptStack(&writer);
-    writer.json_objectend();  // the end of 'javascriptStack'
-  }
+  out << capture.javascript;
 
   // Report native stack backtrace
-  PrintNativeStack(&writer);
+  PrintNativeStack(&writer, capture.native_stack);
 
-  // Report OS and current thread resource usage
+  // Report OS resource usage
   PrintResourceUsage(&writer);
 
-  writer.json_arraystart("libuv");
+  out << capture.thread;
+
+  // Report operating system information
+  PrintSystemInformation(&writer);
+
+  writer.json_objectend();
+
+  // Restore output stream formatting.
+  out.copyfmt(old_state);
+}
+
+static void WriteNodeReport(Isolate* isolate,
+                            Environment* env,
+                            const char* message,
+                            const char* trigger,
+                            const std::string& filename,
+                            std::ostream& out,
+                            Local<Value> error,
+                            bool compact,
+                            bool exclude_network) {
+  ReportCapture capture;
+  CaptureNodeReport(isolate,
+                    env,
+                    message,
+                    trigger,
+                    filename,
+                    error,
+                    compact,
+                    exclude_network,
+                    &capture);
+  WriteNodeReport(capture, out);
+}
+
+// Report the libuv handles and the event loop.
+static void PrintLibuv(JSONWriter* writer, Environment* env) {
+  writer->json_arraystart("libuv");
   if (env != nullptr) {
-    uv_walk(env->event_loop(), WalkHandle, static_cast<void*>(&writer));
+    uv_walk(env->event_loop(), WalkHandle, static_cast<void*>(writer));
 
-    writer.json_start();
-    writer.json_keyvalue("type", "loop");
-    writer.json_keyvalue("is_active",
+    writer->json_start();
+    writer->json_keyvalue("type", "loop");
+    writer->json_keyvalue("is_active",
         static_cast<bool>(uv_loop_alive(env->event_loop())));
-    writer.json_keyvalue("address",
+    writer->json_keyvalue("address",
         ValueToHexString(reinterpret_cast<int64_t>(env->event_loop())));
 
     // Report Event loop idle time
     uint64_t idle_time = uv_metrics_idle_time(env->event_loop());
-    writer.json_keyvalue("loopIdleTimeSeconds", 1.0 * idle_time / 1e9);
-    writer.json_end();
+    writer->json_keyvalue("loopIdleTimeSeconds", 1.0 * idle_time / 1e9);
+    writer->json_end();
   }
 
-  writer.json_arrayend();
+  writer->json_arrayend();
+}
 
-  writer.json_arraystart("workers");
+// Report the worker threads, each of which writes its own subreport.
+static void PrintWorkers(JSONWriter* writer,
+                         Environment* env,
+                         const char* trigger) {
+  writer->json_arraystart("workers");
   if (env != nullptr) {
     Mutex workers_mutex;
     ConditionVariable notify;
@@ -245,17 +360,9 @@ static void WriteNodeReport(Isolate* isolate,
     while (worker_infos.size() < expected_results)
       notify.Wait(lock);
     for (const std::string& worker_info : worker_infos)
-      writer.json_element(JSONWriter::ForeignJSON { worker_info });
+      writer->json_element(JSONWriter::ForeignJSON { worker_info });
   }
-  writer.json_arrayend();
-
-  // Report operating system information
-  PrintSystemInformation(&writer);
-
-  writer.json_objectend();
-
-  // Restore output stream formatting.
-  out.copyfmt(old_state);
+  writer->json_arrayend();
 }
 
 // Report Node.js version, OS version and machine information.
@@ -540,15 +647,22 @@ static void PrintJavaScriptErrorStack(JSONWriter* writer,
   PrintJavaScriptErrorProperties(writer, isolate, error);
 }
 
-// Report a native stack backtrace
-static void PrintNativeStack(JSONWriter* writer) {
+// Take a native stack backtrace, which is symbolized when it is printed.
+static std::vector<void*> CaptureNativeStack() {
   auto sym_ctx = NativeSymbolDebuggingContext::New();
   void* frames[256];
   const int size = sym_ctx->GetStackTrace(frames, arraysize(frames));
+  if (size <= 1) return {};
+  // Skip our own frame.
+  return std::vector<void*>(frames + 1, frames + size);
+}
+
+// Report a native stack backtrace
+static void PrintNativeStack(JSONWriter* writer,
+                             const std::vector<void*>& frames) {
+  auto sym_ctx = NativeSymbolDebuggingContext::New();
   writer->json_arraystart("nativeStack");
-  int i;
-  for (i = 1; i < size; i++) {
-    void* frame = frames[i];
+  for (void* frame : frames) {
     writer->json_start();
     writer->json_keyvalue("pc",
                           ValueToHexString(reinterpret_cast<uintptr_t>(frame)));
@@ -641,6 +755,11 @@ static void PrintResourceUsage(JSONWriter* writer) {
     writer->json_keyvalue("constrained_memory", constrained_memory);
   }
 
+  double cpu_quota = GetCgroupCpuQuota();
+  if (cpu_quota > 0) {
+    writer->json_keyvalue("cpu_quota", cpu_quota);
+  }
+
   uint64_t available_memory = uv_get_available_memory();
   writer->json_keyvalue("available_memory", available_memory);
 
@@ -669,7 +788,16 @@ static void PrintResourceUsage(JSONWriter* writer) {
     writer->json_objectend();
   }
   writer->json_objectend();
+}
+
+// Report the resource usage of the current thread.
+static void PrintThreadResourceUsage(JSONWriter* writer) {
 #ifdef RUSAGE_THREAD
+  // Get process uptime in seconds
+  uint64_t uptime =
+      (uv_hrtime() - per_process::node_start_time) / (NANOS_PER_SEC);
+  if (uptime == 0) uptime = 1;  // avoid division by zero.
+
   struct rusage stats;
   if (getrusage(RUSAGE_THREAD, &stats) == 0) {
     writer->json_objectstart("uvthreadResourceUsage");
@@ -831,12 +959,60 @@ static void PrintRelease(JSONWriter* writer) {
 
 }  // namespace report
 
-std::string TriggerNodeReport(Isolate* isolate,
-                              Environment* env,
-                              const char* message,
-                              const char* trigger,
-                              const std::string& name,
-                              Local<Value> error) {
+namespace report {
+
+// Opens the report file stream for writing. Supports stdout/err,
+// user-specified or (default) generated name. Returns nullptr if the file
+// cannot be opened.
+static std::ostream* OpenReportStream(const std::string& filename,
+                                      const std::string& report_directory,
+                                      std::ofstream* outfile) {
+  if (filename == "stdout") return &std::cout;
+  if (filename == "stderr") return &std::cerr;
+
+  // Regular file. Append filename to directory path if one was specified
+  if (!report_directory.empty()) {
+    std::string pathname =
+        (std::filesystem::path(report_directory) / filename).string();
+    outfile->open(pathname, std::ios::out | std::ios::binary);
+  } else {
+    outfile->open(filename, std::ios::out | std::ios::binary);
+  }
+  // Check for errors on the file open
+  if (!outfile->is_open()) {
+    std::cerr << "\nFailed to open Node.js report file: " << filename;
+
+    if (report_directory.length() > 0)
+      std::cerr << " directory: " << report_directory;
+
+    std::cerr << " (errno: " << errno << ")" << std::endl;
+    return nullptr;
+  }
+  std::cerr << "\nWriting Node.js report to file: " << filename;
+  return outfile;
+}
+
+static void FinishReport(const std::string& filename, std::ofstream* outfile) {
+  // Do not close stdout/stderr, only close files we opened.
+  if (outfile->is_open()) {
+    outfile->close();
+  }
+
+  // Do not mix JSON and free-form text on stderr.
+  if (filename != "stderr") {
+    std::cerr << "\nNode.js report completed" << std::endl;
+  }
+}
+
+}  // namespace report
+
+static std::string TriggerNodeReport(Isolate* isolate,
+                                     Environment* env,
+                                     const char* message,
+                                     const char* trigger,
+                                     const std::string& name,
+                                     Local<Value> error,
+                                     bool allow_async = false) {
   std::string filename;
 
   // Determine the required report filename. In order of priority:
@@ -872,52 +1048,50 @@ std::string TriggerNodeReport(Isolate* isolate,
     }
   }
 
-  // Open the report file stream for writing. Supports stdout/err,
-  // user-specified or (default) generated name
-  std::ofstream outfile;
-  std::ostream* outstream;
-  if (filename == "stdout") {
-    outstream = &std::cout;
-  } else if (filename == "stderr") {
-    outstream = &std::cerr;
-  } else {
-    std::string report_directory;
-    {
-      Mutex::ScopedLock lock(per_process::cli_options_mutex);
-      report_directory = per_process::cli_options->report_directory;
-    }
-    // Regular file. Append filename to directory path if one was specified
-    if (!report_directory.empty()) {
-      std::string pathname =
-          (std::filesystem::path(report_directory) / filename).string();
-      outfile.open(pathname, std::ios::out | std::ios::binary);
-    } else {
-      outfile.open(filename, std::ios::out | std::ios::binary);
-    }
-    // Check for errors on the file open
-    if (!outfile.is_open()) {
-      std::cerr << "\nFailed to open Node.js report file: " << filename;
-
-      if (report_directory.length() > 0)
-        std::cerr << " directory: " << report_directory;
-
-      std::cerr << " (errno: " << errno << ")" << std::endl;
-      return "";
-    }
-    outstream = &outfile;
-    std::cerr << "\nWriting Node.js report to file: " << filename;
-  }
-
+  std::string report_directory;
   bool compact;
+  bool async;
   {
     Mutex::ScopedLock lock(per_process::cli_options_mutex);
+    report_directory = per_process::cli_options->report_directory;
     compact = per_process::cli_options->report_compact;
+    async = per_process::cli_options->report_async;
   }
 
   bool exclude_network = env != nullptr ? env->options()->report_exclude_network
                                         : per_process::cli_options->per_isolate
                                               ->per_env->report_exclude_network;
 
+  if (allow_async && async && filename != "stdout" && filename != "stderr") {
+    // Only take what has to come from this thread here. Symbolizing the
+    // native stack, collecting the system information, formatting and
+    // writing happen on a thread of their own.
+    auto capture = std::make_unique<report::ReportCapture>();
+    report::CaptureNodeReport(isolate,
+                              env,
+                              message,
+                              trigger,
+                              filename,
+                              error,
+                              compact,
+                              exclude_network,
+                              capture.get());
+    std::thread([capture = std::move(capture), report_directory]() {
+      std::ofstream outfile;
+      std::ostream* outstream = report::OpenReportStream(
+          capture->filename, report_directory, &outfile);
+      if (outstream == nullptr) return;
+      report::WriteNodeReport(*capture, *outstream);
+      report::FinishReport(capture->filename, &outfile);
+    }).detach();
+    return filename;
+  }
+
+  std::ofstream outfile;
+  std::ostream* outstream =
+      report::OpenReportStream(filename, report_directory, &outfile);
+  if (outstream == nullptr) return "";
+
   report::WriteNodeReport(isolate,
                           env,
                           message,
@@ -928,15 +1102,7 @@ std::string TriggerNodeReport(Isolate* isolate,
                           compact,
                           exclude_network);
 
-  // Do not close stdout/stderr, only close files we opened.
-  if (outfile.is_open()) {
-    outfile.close();
-  }
-
-  // Do not mix JSON and free-form text on stderr.
-  if (filename != "stderr") {
-    std::cerr << "\nNode.js report completed" << std::endl;
-  }
+  report::FinishReport(filename, &outfile);
   return filename;
 }
 
@@ -967,6 +1133,17 @@ std::string TriggerNodeReport(Environment* env,
                            error);
 }
 
+namespace report {
+std::string TriggerNodeReportMaybeAsync(Environment* env,
+                                        const char* message,
+                                        const char* trigger,
+                                        const std::string& name,
+                                        Local<Value> error) {
+  return node::TriggerNodeReport(
+      env->isolate(), env, message, trigger, name, error, true);
+}
+}  // namespace report
+
 // External function to trigger a report, writing to a supplied stream.
 void GetNodeReport(Isolate* isolate,
                    const char* message,
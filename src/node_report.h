@@ -30,6 +30,15 @@ std::string ValueToHexString(T value) {
   return hex.str();
 }
 
+// Like TriggerNodeReport(), but with --report-async a report that goes to a
+// file is only captured on this thread, and formatted and written on another
+// one. The file may not be complete yet when this returns.
+std::string TriggerNodeReportMaybeAsync(Environment* env,
+                                        const char* message,
+                                        const char* trigger,
+                                        const std::string& name,
+                                        v8::Local<v8::Value> error);
+
 // Function declarations - export functions in src/node_report_module.cc
 void WriteReport(const v8::FunctionCallbackInfo<v8::Value>& info);
 void GetReport(const v8::FunctionCallbackInfo<v8::Value>& info);
@@ -44,7 +44,8 @@ void WriteReport(const FunctionCallbackInfo<Value>& info) {
   else
     error = Local<Value>();
 
-  filename = TriggerNodeReport(env, *message, *trigger, filename, error);
+  filename =
+      TriggerNodeReportMaybeAsync(env, *message, *trigger, filename, error);
   // Return value is the report filename
   info.GetReturnValue().Set(
       String::NewFromUtf8(isolate, filename.c_str()).ToLocalChecked());
@@ -84,6 +85,17 @@ static void SetCompact(const FunctionCallbackInfo<Value>& info) {
   per_process::cli_options->report_compact = compact;
 }
 
+static void GetAsync(const FunctionCallbackInfo<Value>& info) {
+  Mutex::ScopedLock lock(per_process::cli_options_mutex);
+  info.GetReturnValue().Set(per_process::cli_options->report_async);
+}
+
+static void SetAsync(const FunctionCallbackInfo<Value>& info) {
+  CHECK(info[0]->IsBoolean());
+  Mutex::ScopedLock lock(per_process::cli_options_mutex);
+  per_process::cli_options->report_async = info[0]->IsTrue();
+}
+
 static void GetExcludeNetwork(const FunctionCallbackInfo<Value>& info) {
   Environment* env = Environment::GetCurrent(info);
   info.GetReturnValue().Set(env->options()->report_exclude_network);
@@ -185,6 +197,8 @@ static void Initialize(Local<Object> exports,
   SetMethod(context, exports, "getReport", GetReport);
   SetMethod(context, exports, "getCompact", GetCompact);
   SetMethod(context, exports, "setCompact", SetCompact);
+  SetMethod(context, exports, "getAsync", GetAsync);
+  SetMethod(context, exports, "setAsync", SetAsync);
   SetMethod(context, exports, "getExcludeNetwork", GetExcludeNetwork);
   SetMethod(context, exports, "setExcludeNetwork", SetExcludeNetwork);
   SetMethod(context, exports, "getDirectory", GetDirectory);
@@ -213,6 +227,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetReport);
   registry->Register(GetCompact);
   registry->Register(SetCompact);
+  registry->Register(GetAsync);
+  registry->Register(SetAsync);
   registry->Register(GetExcludeNetwork);
   registry->Register(SetExcludeNetwork);
   registry->Register(GetDirectory);
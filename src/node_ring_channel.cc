@@ -0,0 +1,378 @@
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "handle_wrap.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "node_mutex.h"
+#include "spsc_ring.h"
+#include "util-inl.h"
+#include "v8-fast-api-calls.h"
+#include "v8.h"
+
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+// A channel of framed binary records in a SharedArrayBuffer, for passing
+// data between worker threads without going through MessagePort.
+//
+// The buffer holds a single-producer/single-consumer ring that is laid out
+// so that JavaScript can take part through Atomics as well:
+//
+//   offset   0  head, as a 64-bit count of bytes ever written
+//   offset  64  tail, as a 64-bit count of bytes ever consumed
+//   offset 128  reader waiting flag, an Int32 (index 32 of an Int32Array)
+//   offset 192  ring data, up to the end of the buffer
+//
+// The records are framed as described in spsc_ring.h. Writes and reads copy
+// straight between the caller's Uint8Array and the ring through fast API
+// calls.
+//
+// A reader that finds the ring empty sets the waiting flag. A writer that
+// clears the flag wakes the reader through a uv_async_t, so that an idle
+// reader costs nothing and a busy one is never woken at all. Native
+// writers cannot Atomics.notify(), so a peer that blocks in Atomics.wait()
+// must be woken by a JavaScript writer.
+
+namespace node {
+
+using v8::BackingStore;
+using v8::CFunction;
+using v8::Context;
+using v8::FastApiTypedArray;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::SharedArrayBuffer;
+using v8::Value;
+
+namespace {
+
+constexpr size_t kRingChannelHeadOffset = 0;
+constexpr size_t kRingChannelTailOffset = 64;
+constexpr size_t kRingChannelWaitingOffset = 128;
+constexpr size_t kRingChannelDataOffset = 192;
+constexpr size_t kRingChannelMinSize = 1024;
+// Returned by read() and nextLength() when the ring is empty.
+constexpr int32_t kRingChannelEmpty = SPSCRing::kEmpty;
+
+// Shared by every RingChannel over the same SharedArrayBuffer, on whichever
+// thread they live. |reader| is only set while the reader is started.
+struct Doorbell {
+  Mutex mutex;
+  uv_async_t* reader = nullptr;
+  bool has_reader = false;
+  bool has_writer = false;
+};
+
+// Keyed by the data pointer of the backing store, which is the same for
+// every SharedArrayBuffer object that refers to it.
+Mutex doorbells_mutex;
+std::unordered_map<const void*, std::weak_ptr<Doorbell>> doorbells;
+
+std::shared_ptr<Doorbell> GetDoorbell(const void* key) {
+  Mutex::ScopedLock lock(doorbells_mutex);
+  std::weak_ptr<Doorbell>& entry = doorbells[key];
+  std::shared_ptr<Doorbell> doorbell = entry.lock();
+  if (!doorbell) {
+    doorbell = std::make_shared<Doorbell>();
+    entry = doorbell;
+  }
+  return doorbell;
+}
+
+class RingChannel : public HandleWrap {
+ public:
+  static void Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv) {
+    Environment* env = Environment::GetCurrent(context);
+    Isolate* isolate = env->isolate();
+    Local<FunctionTemplate> constructor = NewFunctionTemplate(isolate, New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(
+        RingChannel::kInternalFieldCount);
+    constructor->Inherit(HandleWrap::GetConstructorTemplate(env));
+
+    SetProtoMethod(isolate, constructor, "start", Start);
+    SetProtoMethod(isolate, constructor, "stop", Stop);
+    Local<v8::ObjectTemplate> instance = constructor->InstanceTemplate();
+    SetFastMethod(isolate, instance, "write", Write, &fast_write_);
+    SetFastMethod(isolate, instance, "read", Read, &fast_read_);
+    SetFastMethod(
+        isolate, instance, "nextLength", NextLength, &fast_next_length_);
+
+    SetConstructorFunction(context, target, "RingChannel", constructor);
+
+    NODE_DEFINE_CONSTANT(target, kRingChannelHeadOffset);
+    NODE_DEFINE_CONSTANT(target, kRingChannelTailOffset);
+    NODE_DEFINE_CONSTANT(target, kRingChannelWaitingOffset);
+    NODE_DEFINE_CONSTANT(target, kRingChannelDataOffset);
+    NODE_DEFINE_CONSTANT(target, kRingChannelMinSize);
+    NODE_DEFINE_CONSTANT(target, kRingChannelEmpty);
+  }
+
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+    registry->Register(New);
+    registry->Register(Start);
+    registry->Register(Stop);
+    registry->Register(Write);
+    registry->Register(FastWrite);
+    registry->Register(fast_write_.GetTypeInfo());
+    registry->Register(Read);
+    registry->Register(FastRead);
+    registry->Register(fast_read_.GetTypeInfo());
+    registry->Register(NextLength);
+    registry->Register(FastNextLength);
+    registry->Register(fast_next_length_.GetTypeInfo());
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(RingChannel)
+  SET_SELF_SIZE(RingChannel)
+
+  ~RingChannel() override {
+    if (!doorbell_) return;
+    {
+      Mutex::ScopedLock lock(doorbell_->mutex);
+      if (doorbell_->reader == &handle_) doorbell_->reader = nullptr;
+      (is_reader_ ? doorbell_->has_reader : doorbell_->has_writer) = false;
+    }
+    const void* key = store_->Data();
+    doorbell_.reset();
+    Mutex::ScopedLock lock(doorbells_mutex);
+    auto it = doorbells.find(key);
+    if (it != doorbells.end() && it->second.expired()) doorbells.erase(it);
+  }
+
+  void Close(Local<Value> close_callback) override {
+    Unregister();
+    HandleWrap::Close(close_callback);
+  }
+
+ private:
+  // new RingChannel(sharedArrayBuffer, isReader)
+  //
+  // There can be one reader and one writer per buffer at a time.
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    CHECK(args.IsConstructCall());
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsSharedArrayBuffer());
+    std::shared_ptr<BackingStore> store =
+        args[0].As<SharedArrayBuffer>()->GetBackingStore();
+    const bool is_reader = args[1]->IsTrue();
+
+    if (store->ByteLength() < kRingChannelDataOffset + kRingChannelMinSize ||
+        reinterpret_cast<uintptr_t>(store->Data()) %
+                SPSCRing::kRecordAlignment != 0) {
+      return THROW_ERR_INVALID_ARG_VALUE(
+          env,
+          "The SharedArrayBuffer must be at least %u bytes long",
+          kRingChannelDataOffset + kRingChannelMinSize);
+    }
+
+    std::shared_ptr<Doorbell> doorbell = GetDoorbell(store->Data());
+    {
+      Mutex::ScopedLock lock(doorbell->mutex);
+      bool& taken = is_reader ? doorbell->has_reader : doorbell->has_writer;
+      if (taken) {
+        return THROW_ERR_INVALID_STATE(
+            env,
+            "The SharedArrayBuffer already has a ring channel %s",
+            is_reader ? "reader" : "writer");
+      }
+      taken = true;
+    }
+
+    new RingChannel(
+        env, args.This(), std::move(store), std::move(doorbell), is_reader);
+  }
+
+  RingChannel(Environment* env,
+              Local<Object> object,
+              std::shared_ptr<BackingStore> store,
+              std::shared_ptr<Doorbell> doorbell,
+              bool is_reader)
+      : HandleWrap(env,
+                   object,
+                   reinterpret_cast<uv_handle_t*>(&handle_),
+                   AsyncWrap::PROVIDER_RINGCHANNEL),
+        store_(std::move(store)),
+        doorbell_(std::move(doorbell)),
+        ring_(word<uint64_t>(kRingChannelHeadOffset),
+              word<uint64_t>(kRingChannelTailOffset),
+              word<int32_t>(kRingChannelWaitingOffset),
+              static_cast<char*>(store_->Data()) + kRingChannelDataOffset,
+              (store_->ByteLength() - kRingChannelDataOffset) /
+                  SPSCRing::kRecordAlignment * SPSCRing::kRecordAlignment),
+        is_reader_(is_reader) {
+    CHECK_EQ(uv_async_init(env->event_loop(),
+                           &handle_,
+                           [](uv_async_t* handle) {
+                             RingChannel* channel =
+                                 ContainerOf(&RingChannel::handle_, handle);
+                             channel->OnReadable();
+                           }),
+             0);
+    // Only a started reader keeps the event loop alive.
+    uv_unref(reinterpret_cast<uv_handle_t*>(&handle_));
+  }
+
+  template <typename T>
+  T* word(size_t offset) const {
+    return reinterpret_cast<T*>(static_cast<char*>(store_->Data()) + offset);
+  }
+
+  void Unregister() {
+    if (!is_reader_) return;
+    Mutex::ScopedLock lock(doorbell_->mutex);
+    if (doorbell_->reader == &handle_) doorbell_->reader = nullptr;
+  }
+
+  // Returns 0, UV_EAGAIN when the ring is full, or UV_ENOBUFS when the
+  // record is too large for it.
+  int32_t DoWrite(const uint8_t* data, size_t length) {
+    if (is_reader_ || IsHandleClosing()) return UV_EBADF;
+    bool wake;
+    const int err = ring_.Write(data, length, &wake);
+    if (wake) {
+      Mutex::ScopedLock lock(doorbell_->mutex);
+      if (doorbell_->reader != nullptr) uv_async_send(doorbell_->reader);
+    }
+    return err;
+  }
+
+  // Returns the length of the next record and points |payload| at it,
+  // kRingChannelEmpty if there is none, or UV_EPROTO. An empty ring sets
+  // the waiting flag, so the next write wakes the reader.
+  int32_t Peek(const char** payload) {
+    if (!is_reader_ || IsHandleClosing()) return UV_EBADF;
+    return ring_.Peek(payload);
+  }
+
+  // Copies the next record into |out| and returns its length,
+  // kRingChannelEmpty, UV_ENOBUFS if |out| is too small (the record stays
+  // in the ring), or UV_EPROTO.
+  int32_t DoRead(uint8_t* out, size_t capacity) {
+    const char* payload;
+    const int32_t length = Peek(&payload);
+    if (length < 0) return length;
+    if (static_cast<size_t>(length) > capacity) return UV_ENOBUFS;
+    if (length > 0) memcpy(out, payload, length);
+    ring_.Consume(length);
+    return length;
+  }
+
+  // onreadable()
+  void OnReadable() {
+    Environment* env = this->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    MakeCallback(env->onreadable_string(), 0, nullptr);
+  }
+
+  // start() makes an idle reader wake up, and call onreadable(), when a
+  // record is written. The callback should read until the ring is empty.
+  static void Start(const FunctionCallbackInfo<Value>& args) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+    if (!channel->is_reader_ || channel->IsHandleClosing())
+      return args.GetReturnValue().Set(UV_EBADF);
+    {
+      Mutex::ScopedLock lock(channel->doorbell_->mutex);
+      channel->doorbell_->reader = &channel->handle_;
+    }
+    uv_ref(reinterpret_cast<uv_handle_t*>(&channel->handle_));
+    // Records may have been written while nobody was waiting.
+    if (channel->ring_.StartWaiting()) uv_async_send(&channel->handle_);
+    args.GetReturnValue().Set(0);
+  }
+
+  static void Stop(const FunctionCallbackInfo<Value>& args) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+    channel->Unregister();
+    if (!channel->IsHandleClosing())
+      uv_unref(reinterpret_cast<uv_handle_t*>(&channel->handle_));
+    args.GetReturnValue().Set(0);
+  }
+
+  // write(uint8Array)
+  static void Write(const FunctionCallbackInfo<Value>& args) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+    ArrayBufferViewContents<uint8_t> data(args[0]);
+    args.GetReturnValue().Set(channel->DoWrite(data.data(), data.length()));
+  }
+
+  static int32_t FastWrite(Local<Value> receiver,
+                           const FastApiTypedArray<uint8_t>& data) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, receiver, UV_EBADF);
+    uint8_t* data_ptr;
+    CHECK(data.getStorageIfAligned(&data_ptr));
+    return channel->DoWrite(data_ptr, data.length());
+  }
+
+  // read(uint8Array)
+  static void Read(const FunctionCallbackInfo<Value>& args) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+    SPREAD_BUFFER_ARG(args[0], out);
+    args.GetReturnValue().Set(channel->DoRead(
+        reinterpret_cast<uint8_t*>(out_data), out_length));
+  }
+
+  static int32_t FastRead(Local<Value> receiver,
+                          const FastApiTypedArray<uint8_t>& out) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, receiver, UV_EBADF);
+    uint8_t* out_ptr;
+    CHECK(out.getStorageIfAligned(&out_ptr));
+    return channel->DoRead(out_ptr, out.length());
+  }
+
+  // nextLength() returns the length of the next record without consuming
+  // it, so that the caller can size the buffer it passes to read().
+  static void NextLength(const FunctionCallbackInfo<Value>& args) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, args.This());
+    const char* payload;
+    args.GetReturnValue().Set(channel->Peek(&payload));
+  }
+
+  static int32_t FastNextLength(Local<Value> receiver) {
+    RingChannel* channel;
+    ASSIGN_OR_RETURN_UNWRAP(&channel, receiver, UV_EBADF);
+    const char* payload;
+    return channel->Peek(&payload);
+  }
+
+  static CFunction fast_write_;
+  static CFunction fast_read_;
+  static CFunction fast_next_length_;
+
+  uv_async_t handle_;
+  // Keeps the memory alive for as long as this end exists, even if the
+  // SharedArrayBuffer object is collected.
+  std::shared_ptr<BackingStore> store_;
+  std::shared_ptr<Doorbell> doorbell_;
+  SPSCRing ring_;
+  const bool is_reader_;
+};
+
+CFunction RingChannel::fast_write_(CFunction::Make(RingChannel::FastWrite));
+CFunction RingChannel::fast_read_(CFunction::Make(RingChannel::FastRead));
+CFunction RingChannel::fast_next_length_(
+    CFunction::Make(RingChannel::FastNextLength));
+
+}  // anonymous namespace
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(ring_channel,
+                                    node::RingChannel::Initialize)
+NODE_BINDING_EXTERNAL_REFERENCE(ring_channel,
+                                node::RingChannel::RegisterExternalReferences)
@@ -11,8 +11,15 @@
 #include "node_snapshot_builder.h"
 #include "node_union_bytes.h"
 #include "node_v8_platform-inl.h"
+#include "string_bytes.h"
 #include "util-inl.h"
 
+#include "brotli/decode.h"
+#include "brotli/encode.h"
+#if NODE_HAVE_ZSTD
+#include "zstd.h"
+#endif  // NODE_HAVE_ZSTD
+
 // The POSTJECT_SENTINEL_FUSE macro is a string of random characters selected by
 // the Node.js project that is present only once in the entire binary. It is
 // used by the postject_has_resource() function to efficiently detect if a
@@ -112,13 +119,22 @@ size_t SeaSerializer::Write(const SeaResource& sea) {
   if (!sea.assets.empty()) {
     Debug("Write SEA resource assets size %zu\n", sea.assets.size());
     written_total += WriteArithmetic<size_t>(sea.assets.size());
-    for (auto const& [key, content] : sea.assets) {
-      Debug("Write SEA resource asset %s at %p, size=%zu\n",
+    bool compressed =
+        static_cast<bool>(sea.flags & SeaFlags::kCompressedAssets);
+    for (auto const& [key, asset] : sea.assets) {
+      Debug("Write SEA resource asset %s at %p, size=%zu, codec=%d\n",
             key,
-            content.data(),
-            content.size());
+            asset.content.data(),
+            asset.content.size(),
+            static_cast<int>(asset.codec));
       written_total += WriteStringView(key, StringLogMode::kAddressAndContent);
-      written_total += WriteStringView(content, StringLogMode::kAddressOnly);
+      if (compressed) {
+        written_total +=
+            WriteArithmetic<uint8_t>(static_cast<uint8_t>(asset.codec));
+        written_total += WriteArithmetic<size_t>(asset.size);
+      }
+      written_total +=
+          WriteStringView(asset.content, StringLogMode::kAddressOnly);
     }
   }
   return written_total;
@@ -169,18 +185,29 @@ SeaResource SeaDeserializer::Read() {
           code_cache.size());
   }
 
-  std::unordered_map<std::string_view, std::string_view> assets;
+  std::unordered_map<std::string_view, SeaAsset> assets;
   if (static_cast<bool>(flags & SeaFlags::kIncludeAssets)) {
     size_t assets_size = ReadArithmetic<size_t>();
     Debug("Read SEA resource assets size %zu\n", assets_size);
+    bool compressed = static_cast<bool>(flags & SeaFlags::kCompressedAssets);
+    assets.reserve(assets_size);
     for (size_t i = 0; i < assets_size; ++i) {
       std::string_view key = ReadStringView(StringLogMode::kAddressAndContent);
-      std::string_view content = ReadStringView(StringLogMode::kAddressOnly);
-      Debug("Read SEA resource asset %s at %p, size=%zu\n",
+      SeaAsset asset;
+      if (compressed) {
+        asset.codec = static_cast<AssetCodec>(ReadArithmetic<uint8_t>());
+        asset.size = ReadArithmetic<size_t>();
+      }
+      asset.content = ReadStringView(StringLogMode::kAddressOnly);
+      if (!compressed) {
+        asset.size = asset.content.size();
+      }
+      Debug("Read SEA resource asset %s at %p, size=%zu, codec=%d\n",
             key,
-            content.data(),
-            content.size());
-      assets.emplace(key, content);
+            asset.content.data(),
+            asset.content.size(),
+            static_cast<int>(asset.codec));
+      assets.emplace(key, asset);
     }
   }
   return {flags, code_path, code, code_cache, assets};
@@ -284,6 +311,7 @@ struct SeaConfig {
   std::string main_path;
   std::string output_path;
   SeaFlags flags = SeaFlags::kDefault;
+  AssetCodec asset_codec = AssetCodec::kNone;
   std::unordered_map<std::string, std::string> assets;
 };
 
@@ -376,6 +404,24 @@ std::optional<SeaConfig> ParseSingleExecutableConfig(
     result.assets = std::move(assets_opt.value());
   }
 
+  std::string asset_compression =
+      parser.GetTopLevelStringField("assetCompression").value_or("none");
+  if (asset_compression == "brotli") {
+    result.asset_codec = AssetCodec::kBrotli;
+#if NODE_HAVE_ZSTD
+  } else if (asset_compression == "zstd") {
+    result.asset_codec = AssetCodec::kZstd;
+#endif  // NODE_HAVE_ZSTD
+  } else if (asset_compression != "none") {
+    FPrintF(stderr,
+            "\"assetCompression\" field of %s is not a supported codec\n",
+            config_path);
+    return std::nullopt;
+  }
+  if (result.asset_codec != AssetCodec::kNone && !result.assets.empty()) {
+    result.flags |= SeaFlags::kCompressedAssets;
+  }
+
   return result;
 }
 
@@ -473,17 +519,82 @@ std::optional<std::string> GenerateCodeCache(std::string_view main_path,
   return code_cache;
 }
 
-int BuildAssets(const std::unordered_map<std::string, std::string>& config,
-                std::unordered_map<std::string, std::string>* assets) {
-  for (auto const& [key, path] : config) {
-    std::string blob;
-    int r = ReadFileSync(&blob, path.c_str());
+// Asset compression happens once at build time, but the highest levels of
+// both codecs take minutes for assets in the hundreds of megabytes.
+constexpr int kBrotliAssetQuality = 9;
+#if NODE_HAVE_ZSTD
+constexpr int kZstdAssetLevel = 19;
+#endif  // NODE_HAVE_ZSTD
+
+std::optional<std::string> CompressAsset(AssetCodec codec,
+                                         std::string_view input) {
+  std::string output;
+  switch (codec) {
+    case AssetCodec::kBrotli: {
+      size_t size = BrotliEncoderMaxCompressedSize(input.size());
+      if (size == 0) return std::nullopt;
+      output.resize(size);
+      if (!BrotliEncoderCompress(
+              kBrotliAssetQuality,
+              BROTLI_DEFAULT_WINDOW,
+              BROTLI_MODE_GENERIC,
+              input.size(),
+              reinterpret_cast<const uint8_t*>(input.data()),
+              &size,
+              reinterpret_cast<uint8_t*>(output.data()))) {
+        return std::nullopt;
+      }
+      output.resize(size);
+      break;
+    }
+#if NODE_HAVE_ZSTD
+    case AssetCodec::kZstd: {
+      output.resize(ZSTD_compressBound(input.size()));
+      size_t size = ZSTD_compress(output.data(),
+                                  output.size(),
+                                  input.data(),
+                                  input.size(),
+                                  kZstdAssetLevel);
+      if (ZSTD_isError(size)) return std::nullopt;
+      output.resize(size);
+      break;
+    }
+#endif  // NODE_HAVE_ZSTD
+    default:
+      return std::nullopt;
+  }
+  return output;
+}
+
+struct BuiltAsset {
+  std::string content;
+  AssetCodec codec = AssetCodec::kNone;
+  size_t size = 0;
+};
+
+int BuildAssets(const SeaConfig& config,
+                std::unordered_map<std::string, BuiltAsset>* assets) {
+  for (auto const& [key, path] : config.assets) {
+    BuiltAsset asset;
+    int r = ReadFileSync(&asset.content, path.c_str());
     if (r != 0) {
       const char* err = uv_strerror(r);
       FPrintF(stderr, "Cannot read asset %s: %s\n", path.c_str(), err);
       return r;
     }
-    assets->emplace(key, std::move(blob));
+    asset.size = asset.content.size();
+    if (config.asset_codec != AssetCodec::kNone) {
+      // Keep assets that do not get smaller, e.g. images, uncompressed so
+      // that they can still be accessed without a copy.
+      std::optional<std::string> compressed =
+          CompressAsset(config.asset_codec, asset.content);
+      if (compressed.has_value() &&
+          compressed->size() < asset.content.size()) {
+        asset.content = std::move(compressed.value());
+        asset.codec = config.asset_codec;
+      }
+    }
+    assets->emplace(key, std::move(asset));
   }
   return 0;
 }
@@ -528,13 +639,13 @@ ExitCode GenerateSingleExecutableBlob(
     optional_sv_code_cache = code_cache;
   }
 
-  std::unordered_map<std::string, std::string> assets;
-  if (!config.assets.empty() && BuildAssets(config.assets, &assets) != 0) {
+  std::unordered_map<std::string, BuiltAsset> assets;
+  if (!config.assets.empty() && BuildAssets(config, &assets) != 0) {
     return ExitCode::kGenericUserError;
   }
-  std::unordered_map<std::string_view, std::string_view> assets_view;
-  for (auto const& [key, content] : assets) {
-    assets_view.emplace(key, content);
+  std::unordered_map<std::string_view, SeaAsset> assets_view;
+  for (auto const& [key, asset] : assets) {
+    assets_view.emplace(key, SeaAsset{asset.content, asset.codec, asset.size});
   }
   SeaResource sea{
       config.flags,
@@ -578,27 +689,112 @@ ExitCode BuildSingleExecutableBlob(const std::string& config_path,
   return ExitCode::kGenericUserError;
 }
 
+// Sets |store| to the contents of the asset |key|, or leaves it empty if
+// there is no such asset. Returns false if an exception is pending.
+static bool ReadAsset(Environment* env,
+                      const char* key,
+                      std::unique_ptr<BackingStore>* store) {
+  SeaResource sea_resource = FindSingleExecutableResource();
+  if (sea_resource.assets.empty()) {
+    return true;
+  }
+  auto it = sea_resource.assets.find(key);
+  if (it == sea_resource.assets.end()) {
+    return true;
+  }
+  const SeaAsset& asset = it->second;
+  if (asset.codec == AssetCodec::kNone) {
+    // We cast away the constness here, the JS land should ensure that
+    // the data is not mutated.
+    *store = ArrayBuffer::NewBackingStore(
+        const_cast<char*>(asset.content.data()),
+        asset.content.size(),
+        [](void*, size_t, void*) {},
+        nullptr);
+    return true;
+  }
+
+  // Decompress straight into the memory of the ArrayBuffer, the size is
+  // known up front.
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    *store = ArrayBuffer::NewBackingStore(env->isolate(), asset.size);
+  }
+  if (!*store) {
+    THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+    return false;
+  }
+  bool ok = false;
+  switch (asset.codec) {
+    case AssetCodec::kBrotli: {
+      size_t decoded_size = asset.size;
+      ok = BrotliDecoderDecompress(
+               asset.content.size(),
+               reinterpret_cast<const uint8_t*>(asset.content.data()),
+               &decoded_size,
+               static_cast<uint8_t*>((*store)->Data())) ==
+               BROTLI_DECODER_RESULT_SUCCESS &&
+           decoded_size == asset.size;
+      break;
+    }
+#if NODE_HAVE_ZSTD
+    case AssetCodec::kZstd: {
+      size_t decoded_size = ZSTD_decompress((*store)->Data(),
+                                            asset.size,
+                                            asset.content.data(),
+                                            asset.content.size());
+      ok = !ZSTD_isError(decoded_size) && decoded_size == asset.size;
+      break;
+    }
+#endif  // NODE_HAVE_ZSTD
+    default:
+      break;
+  }
+  if (!ok) {
+    THROW_ERR_INVALID_STATE(
+        env, "Cannot decompress single executable asset %s", key);
+    return false;
+  }
+  return true;
+}
+
 void GetAsset(const FunctionCallbackInfo<Value>& args) {
   CHECK_EQ(args.Length(), 1);
   CHECK(args[0]->IsString());
-  Utf8Value key(args.GetIsolate(), args[0]);
-  SeaResource sea_resource = FindSingleExecutableResource();
-  if (sea_resource.assets.empty()) {
+  Environment* env = Environment::GetCurrent(args);
+  Utf8Value key(env->isolate(), args[0]);
+  std::unique_ptr<BackingStore> store;
+  if (!ReadAsset(env, *key, &store) || !store) {
     return;
   }
-  auto it = sea_resource.assets.find(*key);
-  if (it == sea_resource.assets.end()) {
+  args.GetReturnValue().Set(ArrayBuffer::New(env->isolate(), std::move(store)));
+}
+
+// getAssetAsString(key, encoding) decodes an asset without copying it into
+// the V8 heap where possible: the string refers to the memory of the
+// executable, or to the single buffer that a compressed asset was
+// decompressed into.
+void GetAssetAsString(const FunctionCallbackInfo<Value>& args) {
+  CHECK_EQ(args.Length(), 2);
+  CHECK(args[0]->IsString());
+  Environment* env = Environment::GetCurrent(args);
+  Utf8Value key(env->isolate(), args[0]);
+  enum encoding encoding = ParseEncoding(env->isolate(), args[1], UTF8);
+  std::unique_ptr<BackingStore> store;
+  if (!ReadAsset(env, *key, &store) || !store) {
+    return;
+  }
+  size_t length = store->ByteLength();
+  Local<Value> error;
+  MaybeLocal<Value> ret = StringBytes::EncodeExternal(
+      env->isolate(), std::move(store), 0, length, encoding, &error);
+  Local<Value> str;
+  if (!ret.ToLocal(&str)) {
+    CHECK(!error.IsEmpty());
+    env->isolate()->ThrowException(error);
     return;
   }
-  // We cast away the constness here, the JS land should ensure that
-  // the data is not mutated.
-  std::unique_ptr<v8::BackingStore> store = ArrayBuffer::NewBackingStore(
-      const_cast<char*>(it->second.data()),
-      it->second.size(),
-      [](void*, size_t, void*) {},
-      nullptr);
-  Local<ArrayBuffer> ab = ArrayBuffer::New(args.GetIsolate(), std::move(store));
-  args.GetReturnValue().Set(ab);
+  args.GetReturnValue().Set(str);
 }
 
 MaybeLocal<Value> LoadSingleExecutableApplication(
@@ -651,12 +847,14 @@ void Initialize(Local<Object> target,
             "isExperimentalSeaWarningNeeded",
             IsExperimentalSeaWarningNeeded);
   SetMethod(context, target, "getAsset", GetAsset);
+  SetMethod(context, target, "getAssetAsString", GetAssetAsString);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(IsSea);
   registry->Register(IsExperimentalSeaWarningNeeded);
   registry->Register(GetAsset);
+  registry->Register(GetAssetAsString);
 }
 
 }  // namespace sea
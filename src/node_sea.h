@@ -28,6 +28,23 @@ enum class SeaFlags : uint32_t {
   kUseSnapshot = 1 << 1,
   kUseCodeCache = 1 << 2,
   kIncludeAssets = 1 << 3,
+  // Each asset is preceded by its AssetCodec and uncompressed size.
+  kCompressedAssets = 1 << 4,
+};
+
+enum class AssetCodec : uint8_t {
+  kNone = 0,
+  kBrotli = 1,
+  kZstd = 2,
+};
+
+// An asset points into the SEA blob. Uncompressed assets are handed to
+// JavaScript without a copy, compressed ones are decompressed on access.
+struct SeaAsset {
+  std::string_view content;
+  AssetCodec codec = AssetCodec::kNone;
+  // The size of the asset after decompression.
+  size_t size = 0;
 };
 
 struct SeaResource {
@@ -35,7 +52,7 @@ struct SeaResource {
   std::string_view code_path;
   std::string_view main_code_or_snapshot;
   std::optional<std::string_view> code_cache;
-  std::unordered_map<std::string_view, std::string_view> assets;
+  std::unordered_map<std::string_view, SeaAsset> assets;
 
   bool use_snapshot() const;
   bool use_code_cache() const;
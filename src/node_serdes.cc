@@ -5,11 +5,16 @@
 #include "node_internals.h"
 #include "util-inl.h"
 
+#include <optional>
+
 namespace node {
 
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
+using v8::BackingStore;
 using v8::Context;
+using v8::Exception;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
@@ -20,9 +25,11 @@ using v8::Local;
 using v8::Maybe;
 using v8::MaybeLocal;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::SharedArrayBuffer;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 using v8::ValueDeserializer;
 using v8::ValueSerializer;
@@ -35,12 +42,16 @@ class SerializerContext : public BaseObject,
   SerializerContext(Environment* env,
                     Local<Object> wrap);
 
-  ~SerializerContext() override = default;
+  ~SerializerContext() override;
 
   void ThrowDataCloneError(Local<String> message) override;
   Maybe<bool> WriteHostObject(Isolate* isolate, Local<Object> object) override;
   Maybe<uint32_t> GetSharedArrayBufferId(
       Isolate* isolate, Local<SharedArrayBuffer> shared_array_buffer) override;
+  void* ReallocateBufferMemory(void* old_buffer,
+                               size_t size,
+                               size_t* actual_size) override;
+  void FreeBufferMemory(void* buffer) override;
 
   static void SetTreatArrayBufferViewsAsHostObjects(
       const FunctionCallbackInfo<Value>& args);
@@ -49,18 +60,34 @@ class SerializerContext : public BaseObject,
   static void WriteHeader(const FunctionCallbackInfo<Value>& args);
   static void WriteValue(const FunctionCallbackInfo<Value>& args);
   static void ReleaseBuffer(const FunctionCallbackInfo<Value>& args);
+  static void ReleaseInto(const FunctionCallbackInfo<Value>& args);
+  static void Reset(const FunctionCallbackInfo<Value>& args);
   static void TransferArrayBuffer(const FunctionCallbackInfo<Value>& args);
   static void WriteUint32(const FunctionCallbackInfo<Value>& args);
   static void WriteUint64(const FunctionCallbackInfo<Value>& args);
   static void WriteDouble(const FunctionCallbackInfo<Value>& args);
   static void WriteRawBytes(const FunctionCallbackInfo<Value>& args);
 
-  SET_NO_MEMORY_INFO()
+  void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(SerializerContext)
   SET_SELF_SIZE(SerializerContext)
 
  private:
-  ValueSerializer serializer_;
+  // Starts a new serialization, keeping buffer_ for the output.
+  void ResetSerializer();
+
+  std::optional<ValueSerializer> serializer_;
+  bool treat_array_buffer_views_as_host_objects_ = false;
+
+  // The output buffer. ValueSerializer grows it through
+  // ReallocateBufferMemory(), and it outlives resets, so that serializing
+  // many values with one Serializer does not allocate once it is large
+  // enough. releaseBuffer() hands it over to the returned Buffer.
+  uint8_t* buffer_ = nullptr;
+  size_t capacity_ = 0;
+  // The size of the output of the last releaseInto() call that did not fit
+  // into the target, while it is kept in buffer_ for the next call.
+  std::optional<size_t> pending_size_;
 };
 
 class DeserializerContext : public BaseObject,
@@ -96,11 +123,49 @@ class DeserializerContext : public BaseObject,
 };
 
 SerializerContext::SerializerContext(Environment* env, Local<Object> wrap)
-  : BaseObject(env, wrap),
-    serializer_(env->isolate(), this) {
+  : BaseObject(env, wrap) {
+  serializer_.emplace(env->isolate(), this);
   MakeWeak();
 }
 
+SerializerContext::~SerializerContext() {
+  serializer_.reset();
+  free(buffer_);
+}
+
+void SerializerContext::ResetSerializer() {
+  serializer_.reset();
+  serializer_.emplace(env()->isolate(), this);
+  serializer_->SetTreatArrayBufferViewsAsHostObjects(
+      treat_array_buffer_views_as_host_objects_);
+  pending_size_.reset();
+}
+
+void* SerializerContext::ReallocateBufferMemory(void* old_buffer,
+                                                size_t size,
+                                                size_t* actual_size) {
+  // The serializer starts out without a buffer, and then only ever grows
+  // the one it got, which is buffer_ in both cases.
+  CHECK(old_buffer == nullptr || old_buffer == buffer_);
+  if (size > capacity_) {
+    void* buffer = realloc(buffer_, size);
+    if (buffer == nullptr) return nullptr;
+    buffer_ = static_cast<uint8_t*>(buffer);
+    capacity_ = size;
+  }
+  *actual_size = capacity_;
+  return buffer_;
+}
+
+void SerializerContext::FreeBufferMemory(void* buffer) {
+  // buffer_ is kept for the next serialization, and freed with the object.
+  if (buffer != buffer_) free(buffer);
+}
+
+void SerializerContext::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("buffer", capacity_);
+}
+
 void SerializerContext::ThrowDataCloneError(Local<String> message) {
   Local<Value> args[1] = { message };
   Local<Value> get_data_clone_error =
@@ -181,14 +246,14 @@ void SerializerContext::New(const FunctionCallbackInfo<Value>& args) {
 void SerializerContext::WriteHeader(const FunctionCallbackInfo<Value>& args) {
   SerializerContext* ctx;
   ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
-  ctx->serializer_.WriteHeader();
+  ctx->serializer_->WriteHeader();
 }
 
 void SerializerContext::WriteValue(const FunctionCallbackInfo<Value>& args) {
   SerializerContext* ctx;
   ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
   Maybe<bool> ret =
-      ctx->serializer_.WriteValue(ctx->env()->context(), args[0]);
+      ctx->serializer_->WriteValue(ctx->env()->context(), args[0]);
 
   if (ret.IsJust()) args.GetReturnValue().Set(ret.FromJust());
 }
@@ -199,25 +264,68 @@ void SerializerContext::SetTreatArrayBufferViewsAsHostObjects(
   ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
 
   bool value = args[0]->BooleanValue(ctx->env()->isolate());
-  ctx->serializer_.SetTreatArrayBufferViewsAsHostObjects(value);
+  ctx->treat_array_buffer_views_as_host_objects_ = value;
+  ctx->serializer_->SetTreatArrayBufferViewsAsHostObjects(value);
 }
 
 void SerializerContext::ReleaseBuffer(const FunctionCallbackInfo<Value>& args) {
   SerializerContext* ctx;
   ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
 
-  // Note: Both ValueSerializer and this Buffer::New() variant use malloc()
-  // as the underlying allocator.
-  std::pair<uint8_t*, size_t> ret = ctx->serializer_.Release();
-  auto buf = Buffer::New(ctx->env(),
-                         reinterpret_cast<char*>(ret.first),
-                         ret.second);
+  // Note: Both ReallocateBufferMemory() and this Buffer::New() variant use
+  // malloc() as the underlying allocator.
+  size_t size = ctx->pending_size_.has_value()
+                    ? ctx->pending_size_.value()
+                    : ctx->serializer_->Release().second;
+  uint8_t* data = size > 0 ? ctx->buffer_ : nullptr;
+  if (data != nullptr) {
+    ctx->buffer_ = nullptr;
+    ctx->capacity_ = 0;
+  }
+  ctx->pending_size_.reset();
+  auto buf = Buffer::New(ctx->env(), reinterpret_cast<char*>(data), size);
 
   if (!buf.IsEmpty()) {
     args.GetReturnValue().Set(buf.ToLocalChecked());
   }
 }
 
+// releaseInto(target, offset) copies the output into |target| at |offset|
+// and resets the serializer for the next value, keeping its buffer. Returns
+// the size of the output. If that is more than fits into |target|, nothing
+// is copied and the output is kept for the next releaseInto() or
+// releaseBuffer() call.
+void SerializerContext::ReleaseInto(const FunctionCallbackInfo<Value>& args) {
+  SerializerContext* ctx;
+  ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
+  CHECK(args[0]->IsArrayBufferView());
+  CHECK(args[1]->IsUint32());
+
+  if (!ctx->pending_size_.has_value())
+    ctx->pending_size_ = ctx->serializer_->Release().second;
+  size_t size = ctx->pending_size_.value();
+  args.GetReturnValue().Set(static_cast<double>(size));
+
+  Local<ArrayBufferView> target = args[0].As<ArrayBufferView>();
+  size_t offset = args[1].As<Uint32>()->Value();
+  CHECK_LE(offset, target->ByteLength());
+  if (size > target->ByteLength() - offset) return;
+
+  if (size > 0) {
+    uint8_t* data = static_cast<uint8_t*>(target->Buffer()->Data());
+    memcpy(data + target->ByteOffset() + offset, ctx->buffer_, size);
+  }
+  ctx->ResetSerializer();
+}
+
+// reset() discards the output and the state of the current serialization,
+// so that the serializer can be used for the next value.
+void SerializerContext::Reset(const FunctionCallbackInfo<Value>& args) {
+  SerializerContext* ctx;
+  ASSIGN_OR_RETURN_UNWRAP(&ctx, args.This());
+  ctx->ResetSerializer();
+}
+
 void SerializerContext::TransferArrayBuffer(
     const FunctionCallbackInfo<Value>& args) {
   SerializerContext* ctx;
@@ -231,7 +339,7 @@ void SerializerContext::TransferArrayBuffer(
         ctx->env(), "arrayBuffer must be an ArrayBuffer");
 
   Local<ArrayBuffer> ab = args[1].As<ArrayBuffer>();
-  ctx->serializer_.TransferArrayBuffer(id.FromJust(), ab);
+  ctx->serializer_->TransferArrayBuffer(id.FromJust(), ab);
   return;
 }
 
@@ -242,7 +350,7 @@ void SerializerContext::WriteUint32(const FunctionCallbackInfo<Value>& args) {
   Maybe<uint32_t> value = args[0]->Uint32Value(ctx->env()->context());
   if (value.IsNothing()) return;
 
-  ctx->serializer_.WriteUint32(value.FromJust());
+  ctx->serializer_->WriteUint32(value.FromJust());
 }
 
 void SerializerContext::WriteUint64(const FunctionCallbackInfo<Value>& args) {
@@ -256,7 +364,7 @@ void SerializerContext::WriteUint64(const FunctionCallbackInfo<Value>& args) {
 
   uint64_t hi = arg0.FromJust();
   uint64_t lo = arg1.FromJust();
-  ctx->serializer_.WriteUint64((hi << 32) | lo);
+  ctx->serializer_->WriteUint64((hi << 32) | lo);
 }
 
 void SerializerContext::WriteDouble(const FunctionCallbackInfo<Value>& args) {
@@ -266,7 +374,7 @@ void SerializerContext::WriteDouble(const FunctionCallbackInfo<Value>& args) {
   Maybe<double> value = args[0]->NumberValue(ctx->env()->context());
   if (value.IsNothing()) return;
 
-  ctx->serializer_.WriteDouble(value.FromJust());
+  ctx->serializer_->WriteDouble(value.FromJust());
 }
 
 void SerializerContext::WriteRawBytes(const FunctionCallbackInfo<Value>& args) {
@@ -279,7 +387,7 @@ void SerializerContext::WriteRawBytes(const FunctionCallbackInfo<Value>& args) {
   }
 
   ArrayBufferViewContents<char> bytes(args[0]);
-  ctx->serializer_.WriteRawBytes(bytes.data(), bytes.length());
+  ctx->serializer_->WriteRawBytes(bytes.data(), bytes.length());
 }
 
 DeserializerContext::DeserializerContext(Environment* env,
@@ -450,6 +558,89 @@ void DeserializerContext::ReadRawBytes(
   args.GetReturnValue().Set(offset);
 }
 
+// A delegate that lets the serializer write straight into the memory of an
+// ArrayBufferView, and moves the output to the heap if it does not fit.
+class TargetSerializerDelegate : public ValueSerializer::Delegate {
+ public:
+  TargetSerializerDelegate(Isolate* isolate, uint8_t* target, size_t length)
+      : isolate_(isolate), target_(target), length_(length) {}
+
+  ~TargetSerializerDelegate() { free(heap_); }
+
+  // Like the DefaultSerializer of the v8 module, which has no
+  // _getDataCloneError() of its own.
+  void ThrowDataCloneError(Local<String> message) override {
+    isolate_->ThrowException(Exception::Error(message));
+  }
+
+  void* ReallocateBufferMemory(void* old_buffer,
+                               size_t size,
+                               size_t* actual_size) override {
+    if (heap_ == nullptr && size <= length_) {
+      *actual_size = length_;
+      return target_;
+    }
+    void* buffer = realloc(heap_, size);
+    if (buffer == nullptr) return nullptr;
+    // Everything written so far is in the target when switching over.
+    if (heap_ == nullptr && old_buffer != nullptr)
+      memcpy(buffer, target_, length_);
+    heap_ = static_cast<uint8_t*>(buffer);
+    *actual_size = size;
+    return heap_;
+  }
+
+  void FreeBufferMemory(void* buffer) override {}
+
+  bool fits() const { return heap_ == nullptr; }
+  const uint8_t* heap() const { return heap_; }
+
+ private:
+  Isolate* isolate_;
+  uint8_t* target_;
+  size_t length_;
+  uint8_t* heap_ = nullptr;
+};
+
+// serializeInto(value, target, offset) writes the header and |value| into
+// |target| at |offset|, like v8.serialize() without the intermediate
+// Buffer. ArrayBufferViews are written by V8 itself rather than as host
+// objects, which v8.deserialize() reads back as well. Returns the size of
+// the output. If that is more than fits into |target|, its contents past
+// |offset| are unspecified and the call has to be repeated with a larger
+// target.
+static void SerializeInto(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[1]->IsArrayBufferView());
+  CHECK(args[2]->IsUint32());
+
+  Local<ArrayBufferView> view = args[1].As<ArrayBufferView>();
+  size_t offset = args[2].As<Uint32>()->Value();
+  CHECK_LE(offset, view->ByteLength());
+  // Getters that run during the serialization can detach or transfer the
+  // buffer, so hold on to its memory until the serializer is done.
+  std::shared_ptr<BackingStore> store = view->Buffer()->GetBackingStore();
+  uint8_t* target = static_cast<uint8_t*>(store->Data());
+  size_t length = view->ByteLength() - offset;
+  if (store->IsResizableByUserJavaScript()) length = 0;
+
+  TargetSerializerDelegate delegate(
+      env->isolate(), target + view->ByteOffset() + offset, length);
+  size_t size;
+  {
+    ValueSerializer serializer(env->isolate(), &delegate);
+    serializer.WriteHeader();
+    if (serializer.WriteValue(env->context(), args[0]).IsNothing()) return;
+    size = serializer.Release().second;
+  }
+  if (!delegate.fits() && size <= length) {
+    // The serializer asks for more than it needs when it grows its buffer,
+    // so small outputs can end up on the heap even though they fit.
+    memcpy(target + view->ByteOffset() + offset, delegate.heap(), size);
+  }
+  args.GetReturnValue().Set(static_cast<double>(size));
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -467,6 +658,9 @@ void Initialize(Local<Object> target,
   SetProtoMethod(isolate, ser, "writeValue", SerializerContext::WriteValue);
   SetProtoMethod(
       isolate, ser, "releaseBuffer", SerializerContext::ReleaseBuffer);
+  SetProtoMethod(
+      isolate, ser, "releaseInto", SerializerContext::ReleaseInto);
+  SetProtoMethod(isolate, ser, "reset", SerializerContext::Reset);
   SetProtoMethod(isolate,
                  ser,
                  "transferArrayBuffer",
@@ -509,6 +703,8 @@ void Initialize(Local<Object> target,
   des->SetLength(1);
   des->ReadOnlyPrototype();
   SetConstructorFunction(context, target, "Deserializer", des);
+
+  SetMethod(context, target, "serializeInto", SerializeInto);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
@@ -517,6 +713,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(SerializerContext::WriteHeader);
   registry->Register(SerializerContext::WriteValue);
   registry->Register(SerializerContext::ReleaseBuffer);
+  registry->Register(SerializerContext::ReleaseInto);
+  registry->Register(SerializerContext::Reset);
   registry->Register(SerializerContext::TransferArrayBuffer);
   registry->Register(SerializerContext::WriteUint32);
   registry->Register(SerializerContext::WriteUint64);
@@ -533,6 +731,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(DeserializerContext::ReadUint64);
   registry->Register(DeserializerContext::ReadDouble);
   registry->Register(DeserializerContext::ReadRawBytes);
+
+  registry->Register(SerializeInto);
 }
 
 }  // namespace serdes
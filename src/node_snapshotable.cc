@@ -12,6 +12,7 @@
 #include "encoding_binding.h"
 #include "env-inl.h"
 #include "json_parser.h"
+#include "module_wrap.h"
 #include "node_blob.h"
 #include "node_builtins.h"
 #include "node_contextify.h"
@@ -135,6 +136,8 @@ std::ostream& operator<<(std::ostream& output, const EnvSerializeInfo& i) {
          << i.stream_base_state << ",  // stream_base_state\n"
          << i.should_abort_on_uncaught_toggle
          << ",  // should_abort_on_uncaught_toggle\n"
+         << i.async_context_frame_counters
+         << ",  // async_context_frame_counters\n"
          << "// -- principal_realm begins --\n"
          << i.principal_realm << ",\n"
          << "// -- principal_realm ends --\n"
@@ -5,10 +5,12 @@
 #include "memory_tracker-inl.h"
 #include "node.h"
 #include "node_errors.h"
+#include "node_internals.h"
 #include "node_mem-inl.h"
 #include "sqlite3.h"
 #include "util-inl.h"
 
+#include <algorithm>
 #include <cinttypes>
 
 namespace node {
@@ -17,22 +19,38 @@ namespace sqlite {
 using v8::Array;
 using v8::ArrayBuffer;
 using v8::BigInt;
+using v8::BigInt64Array;
 using v8::Boolean;
 using v8::Context;
+using v8::DictionaryTemplate;
 using v8::Exception;
+using v8::Float64Array;
+using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
+using v8::HandleScope;
+using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
+using v8::Just;
 using v8::Local;
+using v8::Maybe;
 using v8::LocalVector;
 using v8::MaybeLocal;
+using v8::MemorySpan;
 using v8::Name;
+using v8::Nothing;
 using v8::Null;
 using v8::Number;
 using v8::Object;
+using v8::Promise;
 using v8::String;
+using v8::Symbol;
+using v8::TypedArray;
+using v8::Uint32;
 using v8::Uint8Array;
+using v8::Undefined;
 using v8::Value;
 
 #define CHECK_ERROR_OR_THROW(isolate, db, expr, expected, ret)                 \
@@ -52,10 +70,10 @@ using v8::Value;
     }                                                                          \
   } while (0)
 
-inline Local<Value> CreateSQLiteError(Isolate* isolate, sqlite3* db) {
-  int errcode = sqlite3_extended_errcode(db);
+inline Local<Value> CreateSQLiteError(Isolate* isolate,
+                                      int errcode,
+                                      const char* errmsg) {
   const char* errstr = sqlite3_errstr(errcode);
-  const char* errmsg = sqlite3_errmsg(db);
   Local<String> js_msg = String::NewFromUtf8(isolate, errmsg).ToLocalChecked();
   Local<Object> e = Exception::Error(js_msg)
                         ->ToObject(isolate->GetCurrentContext())
@@ -75,15 +93,416 @@ inline Local<Value> CreateSQLiteError(Isolate* isolate, sqlite3* db) {
   return e;
 }
 
+inline Local<Value> CreateSQLiteError(Isolate* isolate, sqlite3* db) {
+  return CreateSQLiteError(
+      isolate, sqlite3_extended_errcode(db), sqlite3_errmsg(db));
+}
+
+// The SQLite error message of a user-defined function that threw. Its
+// JavaScript exception is still pending, so it must not be replaced.
+constexpr char kJsExceptionMessage[] =
+    "A JavaScript exception was thrown by a user-defined function";
+
 inline void THROW_ERR_SQLITE_ERROR(Isolate* isolate, sqlite3* db) {
+  if (strcmp(sqlite3_errmsg(db), kJsExceptionMessage) == 0) return;
   isolate->ThrowException(CreateSQLiteError(isolate, db));
 }
 
+MaybeLocal<Value> Int64ToValue(Isolate* isolate,
+                               int64_t value,
+                               int column,
+                               bool use_big_ints) {
+  if (use_big_ints) {
+    return BigInt::New(isolate, value);
+  } else if (std::abs(value) <= kMaxSafeJsInteger) {
+    return Number::New(isolate, value);
+  }
+  THROW_ERR_OUT_OF_RANGE(isolate,
+                         "The value of column %d is too large to be "
+                         "represented as a JavaScript number: %" PRId64,
+                         column,
+                         value);
+  return MaybeLocal<Value>();
+}
+
+// Creates the result of run() and runMany().
+MaybeLocal<Object> CreateRunResult(Environment* env,
+                                   int64_t changes,
+                                   int64_t last_insert_rowid,
+                                   bool use_big_ints) {
+  Isolate* isolate = env->isolate();
+  Local<Object> result = Object::New(isolate);
+  Local<Value> last_insert_rowid_val;
+  Local<Value> changes_val;
+
+  if (use_big_ints) {
+    last_insert_rowid_val = BigInt::New(isolate, last_insert_rowid);
+    changes_val = BigInt::New(isolate, changes);
+  } else {
+    last_insert_rowid_val = Number::New(isolate, last_insert_rowid);
+    changes_val = Number::New(isolate, changes);
+  }
+
+  if (result
+          ->Set(env->context(),
+                FIXED_ONE_BYTE_STRING(isolate, "lastInsertRowid"),
+                last_insert_rowid_val)
+          .IsNothing() ||
+      result
+          ->Set(env->context(),
+                FIXED_ONE_BYTE_STRING(isolate, "changes"),
+                changes_val)
+          .IsNothing()) {
+    return MaybeLocal<Object>();
+  }
+  return result;
+}
+
+namespace {
+
+// Reads the boolean option |name| into |out| if it is set.
+bool ReadBooleanOption(Environment* env,
+                       Local<Object> options,
+                       const char* name,
+                       bool* out) {
+  Local<Value> value;
+  if (!options->Get(env->context(), OneByteString(env->isolate(), name))
+           .ToLocal(&value)) {
+    return false;
+  }
+  if (value->IsUndefined()) return true;
+  if (!value->IsBoolean()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env->isolate(),
+        "The \"options.%s\" argument must be a boolean.",
+        name);
+    return false;
+  }
+  *out = value->IsTrue();
+  return true;
+}
+
+// The options shared by db.function() and db.aggregate().
+struct FunctionOptions {
+  bool deterministic = false;
+  bool direct_only = false;
+  bool use_bigint_arguments = false;
+  bool varargs = false;
+
+  bool Read(Environment* env, Local<Object> options) {
+    return ReadBooleanOption(env, options, "deterministic", &deterministic) &&
+           ReadBooleanOption(env, options, "directOnly", &direct_only) &&
+           ReadBooleanOption(
+               env, options, "useBigIntArguments", &use_bigint_arguments) &&
+           ReadBooleanOption(env, options, "varargs", &varargs);
+  }
+
+  int flags() const {
+    return SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0) |
+           (direct_only ? SQLITE_DIRECTONLY : 0);
+  }
+};
+
+// Returns the number of arguments SQL passes to |fn|, which is its length
+// minus |extra| unless it takes a variable number of arguments.
+Maybe<int> FunctionArgc(Environment* env,
+                        Local<Function> fn,
+                        int extra,
+                        bool varargs) {
+  if (varargs) return Just(-1);
+  Local<Value> length;
+  if (!fn->Get(env->context(), env->length_string()).ToLocal(&length)) {
+    return Nothing<int>();
+  }
+  int argc = length->IsInt32() ? length.As<Int32>()->Value() - extra : 0;
+  return Just(std::max(argc, 0));
+}
+
+MaybeLocal<Value> SQLiteValueToJS(Isolate* isolate,
+                                  sqlite3_value* value,
+                                  bool use_big_ints) {
+  switch (sqlite3_value_type(value)) {
+    case SQLITE_INTEGER: {
+      int64_t val = sqlite3_value_int64(value);
+      if (use_big_ints) {
+        return BigInt::New(isolate, val);
+      } else if (std::abs(val) <= kMaxSafeJsInteger) {
+        return Number::New(isolate, val);
+      }
+      THROW_ERR_OUT_OF_RANGE(isolate,
+                             "The argument is too large to be represented as "
+                             "a JavaScript number: %" PRId64,
+                             val);
+      return MaybeLocal<Value>();
+    }
+    case SQLITE_FLOAT:
+      return Number::New(isolate, sqlite3_value_double(value));
+    case SQLITE_TEXT: {
+      const char* data =
+          reinterpret_cast<const char*>(sqlite3_value_text(value));
+      return String::NewFromUtf8(isolate,
+                                 data,
+                                 v8::NewStringType::kNormal,
+                                 sqlite3_value_bytes(value))
+          .As<Value>();
+    }
+    case SQLITE_BLOB: {
+      size_t size = static_cast<size_t>(sqlite3_value_bytes(value));
+      auto store = ArrayBuffer::NewBackingStore(isolate, size);
+      if (size > 0) memcpy(store->Data(), sqlite3_value_blob(value), size);
+      auto ab = ArrayBuffer::New(isolate, std::move(store));
+      return Uint8Array::New(ab, 0, size);
+    }
+    case SQLITE_NULL:
+      return Null(isolate);
+    default:
+      UNREACHABLE("Bad SQLite value type");
+  }
+}
+
+// Sets the result of a user-defined function, following the rules of
+// StatementSync::BindValue().
+void SetSQLiteResult(Isolate* isolate,
+                     sqlite3_context* ctx,
+                     Local<Value> value) {
+  if (value->IsNumber()) {
+    sqlite3_result_double(ctx, value.As<Number>()->Value());
+  } else if (value->IsString()) {
+    Utf8Value val(isolate, value);
+    sqlite3_result_text(ctx, *val, val.length(), SQLITE_TRANSIENT);
+  } else if (value->IsNullOrUndefined()) {
+    sqlite3_result_null(ctx);
+  } else if (value->IsArrayBufferView()) {
+    ArrayBufferViewContents<uint8_t> buf(value);
+    sqlite3_result_blob(ctx, buf.data(), buf.length(), SQLITE_TRANSIENT);
+  } else if (value->IsBigInt()) {
+    bool lossless;
+    int64_t as_int = value.As<BigInt>()->Int64Value(&lossless);
+    if (!lossless) {
+      sqlite3_result_error(ctx, "BigInt value is too large for SQLite", -1);
+      return;
+    }
+    sqlite3_result_int64(ctx, as_int);
+  } else if (value->IsPromise()) {
+    sqlite3_result_error(
+        ctx, "Asynchronous user-defined functions are not supported", -1);
+  } else {
+    sqlite3_result_error(
+        ctx,
+        "Returned JavaScript value cannot be converted to a SQLite value",
+        -1);
+  }
+}
+
+// Calls |fn| with |prefix| (if not empty) followed by the SQL arguments.
+// Returns an empty handle if the call threw, after failing |ctx| so that
+// the pending exception is rethrown by THROW_ERR_SQLITE_ERROR()'s caller.
+MaybeLocal<Value> CallWithSQLiteArgs(Environment* env,
+                                     sqlite3_context* ctx,
+                                     Local<Function> fn,
+                                     Local<Value> prefix,
+                                     int argc,
+                                     sqlite3_value** argv,
+                                     bool use_big_ints) {
+  Isolate* isolate = env->isolate();
+  int offset = prefix.IsEmpty() ? 0 : 1;
+  // Most functions take a few arguments, which fit on the stack.
+  MaybeStackBuffer<Local<Value>, 8> js_argv(argc + offset);
+  if (offset == 1) js_argv[0] = prefix;
+  for (int i = 0; i < argc; ++i) {
+    if (!SQLiteValueToJS(isolate, argv[i], use_big_ints)
+             .ToLocal(&js_argv[i + offset])) {
+      sqlite3_result_error(ctx, kJsExceptionMessage, -1);
+      return MaybeLocal<Value>();
+    }
+  }
+  Local<Value> result;
+  if (!fn->Call(env->context(),
+                Undefined(isolate),
+                argc + offset,
+                js_argv.out())
+           .ToLocal(&result)) {
+    sqlite3_result_error(ctx, kJsExceptionMessage, -1);
+    return MaybeLocal<Value>();
+  }
+  return result;
+}
+
+// Whether |ctx| can call into JavaScript. Fails |ctx| otherwise.
+bool CanCallIntoJS(Environment* env, sqlite3_context* ctx) {
+  if (env->can_call_into_js()) return true;
+  sqlite3_result_error(ctx, "Cannot call into JavaScript", -1);
+  return false;
+}
+
+// The user data of a function registered with db.function(). Owned by the
+// connection, which deletes it when the function is replaced or the
+// connection is closed.
+class UserDefinedFunction {
+ public:
+  UserDefinedFunction(Environment* env,
+                      Local<Function> fn,
+                      bool use_bigint_arguments)
+      : env_(env),
+        fn_(env->isolate(), fn),
+        use_bigint_arguments_(use_bigint_arguments) {}
+
+  static void xFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    auto self = static_cast<UserDefinedFunction*>(sqlite3_user_data(ctx));
+    Environment* env = self->env_;
+    if (!CanCallIntoJS(env, ctx)) return;
+    HandleScope scope(env->isolate());
+    Local<Value> result;
+    if (CallWithSQLiteArgs(env,
+                           ctx,
+                           self->fn_.Get(env->isolate()),
+                           Local<Value>(),
+                           argc,
+                           argv,
+                           self->use_bigint_arguments_)
+            .ToLocal(&result)) {
+      SetSQLiteResult(env->isolate(), ctx, result);
+    }
+  }
+
+  static void xDestroy(void* self) {
+    delete static_cast<UserDefinedFunction*>(self);
+  }
+
+ private:
+  Environment* env_;
+  Global<Function> fn_;
+  bool use_bigint_arguments_;
+};
+
+// The user data of a function registered with db.aggregate(). The
+// accumulator of each group lives in the group's aggregate context.
+class UserDefinedAggregate {
+ public:
+  UserDefinedAggregate(Environment* env,
+                       Local<Value> start,
+                       Local<Function> step,
+                       Local<Value> inverse,
+                       Local<Value> result,
+                       bool use_bigint_arguments)
+      : env_(env),
+        start_(env->isolate(), start),
+        step_(env->isolate(), step),
+        use_bigint_arguments_(use_bigint_arguments) {
+    if (inverse->IsFunction()) {
+      inverse_.Reset(env->isolate(), inverse.As<Function>());
+    }
+    if (result->IsFunction()) {
+      result_.Reset(env->isolate(), result.As<Function>());
+    }
+  }
+
+  bool is_window() const { return !inverse_.IsEmpty(); }
+
+  static void xStep(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    From(ctx)->Apply(ctx, From(ctx)->step_, argc, argv);
+  }
+
+  static void xInverse(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    From(ctx)->Apply(ctx, From(ctx)->inverse_, argc, argv);
+  }
+
+  static void xValue(sqlite3_context* ctx) { From(ctx)->Result(ctx, false); }
+
+  static void xFinal(sqlite3_context* ctx) { From(ctx)->Result(ctx, true); }
+
+  static void xDestroy(void* self) {
+    delete static_cast<UserDefinedAggregate*>(self);
+  }
+
+ private:
+  static UserDefinedAggregate* From(sqlite3_context* ctx) {
+    return static_cast<UserDefinedAggregate*>(sqlite3_user_data(ctx));
+  }
+
+  // Returns the accumulator of the group, creating it from the start value
+  // on first use. Returns nullptr after failing |ctx|.
+  Global<Value>* Accumulator(sqlite3_context* ctx) {
+    auto slot = static_cast<Global<Value>**>(
+        sqlite3_aggregate_context(ctx, sizeof(Global<Value>*)));
+    if (slot == nullptr) {
+      sqlite3_result_error_nomem(ctx);
+      return nullptr;
+    }
+    if (*slot != nullptr) return *slot;
+
+    Isolate* isolate = env_->isolate();
+    Local<Value> start = start_.Get(isolate);
+    if (start->IsFunction() &&
+        !start.As<Function>()
+             ->Call(env_->context(), Undefined(isolate), 0, nullptr)
+             .ToLocal(&start)) {
+      sqlite3_result_error(ctx, kJsExceptionMessage, -1);
+      return nullptr;
+    }
+    *slot = new Global<Value>(isolate, start);
+    return *slot;
+  }
+
+  void Apply(sqlite3_context* ctx,
+             const Global<Function>& fn,
+             int argc,
+             sqlite3_value** argv) {
+    if (!CanCallIntoJS(env_, ctx)) return;
+    Isolate* isolate = env_->isolate();
+    HandleScope scope(isolate);
+    Global<Value>* accumulator = Accumulator(ctx);
+    if (accumulator == nullptr) return;
+    Local<Value> value;
+    if (CallWithSQLiteArgs(env_,
+                           ctx,
+                           fn.Get(isolate),
+                           accumulator->Get(isolate),
+                           argc,
+                           argv,
+                           use_bigint_arguments_)
+            .ToLocal(&value)) {
+      accumulator->Reset(isolate, value);
+    }
+  }
+
+  void Result(sqlite3_context* ctx, bool final) {
+    Global<Value>* accumulator = nullptr;
+    auto cleanup = OnScopeLeave([&]() {
+      if (final) delete accumulator;
+    });
+    if (!CanCallIntoJS(env_, ctx)) return;
+    Isolate* isolate = env_->isolate();
+    HandleScope scope(isolate);
+    accumulator = Accumulator(ctx);
+    if (accumulator == nullptr) return;
+    Local<Value> value = accumulator->Get(isolate);
+    if (!result_.IsEmpty() &&
+        !result_.Get(isolate)
+             ->Call(env_->context(), Undefined(isolate), 1, &value)
+             .ToLocal(&value)) {
+      sqlite3_result_error(ctx, kJsExceptionMessage, -1);
+      return;
+    }
+    SetSQLiteResult(isolate, ctx, value);
+  }
+
+  Environment* env_;
+  Global<Value> start_;
+  Global<Function> step_;
+  Global<Function> inverse_;
+  Global<Function> result_;
+  bool use_bigint_arguments_;
+};
+
+}  // namespace
+
 DatabaseSync::DatabaseSync(Environment* env,
                            Local<Object> object,
                            Local<String> location,
-                           bool open)
-    : BaseObject(env, object) {
+                           bool open,
+                           size_t statement_cache_size)
+    : BaseObject(env, object), statement_cache_size_(statement_cache_size) {
   MakeWeak();
   node::Utf8Value utf8_location(env->isolate(), location);
   location_ = utf8_location.ToString();
@@ -104,6 +523,8 @@ DatabaseSync::~DatabaseSync() {
 
 void DatabaseSync::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("location", location_);
+  tracker->TrackFieldWithSize("statement_cache",
+                              statement_cache_.size() * sizeof(StatementSync));
 }
 
 bool DatabaseSync::Open() {
@@ -120,6 +541,8 @@ bool DatabaseSync::Open() {
 }
 
 void DatabaseSync::FinalizeStatements() {
+  statement_cache_index_.clear();
+  statement_cache_.clear();
   for (auto stmt : statements_) {
     stmt->Finalize();
   }
@@ -134,6 +557,33 @@ void DatabaseSync::UntrackStatement(StatementSync* statement) {
   }
 }
 
+StatementSync* DatabaseSync::TakeCachedStatement(std::string_view sql) {
+  auto it = statement_cache_index_.find(sql);
+  if (it == statement_cache_index_.end()) {
+    statement_cache_misses_++;
+    return nullptr;
+  }
+  statement_cache_hits_++;
+  statement_cache_.splice(
+      statement_cache_.begin(), statement_cache_, it->second);
+  StatementSync* stmt = it->second->second.get();
+  // Hand the statement out as if it had just been prepared. Iterators that
+  // were still stepping it are invalidated by the reset.
+  stmt->Reset();
+  sqlite3_clear_bindings(stmt->statement_);
+  return stmt;
+}
+
+void DatabaseSync::CacheStatement(std::string&& sql, StatementSync* stmt) {
+  if (statement_cache_.size() >= statement_cache_size_) {
+    statement_cache_index_.erase(statement_cache_.back().first);
+    statement_cache_.pop_back();
+  }
+  statement_cache_.emplace_front(std::move(sql), StatementSyncRef(stmt));
+  statement_cache_index_.emplace(statement_cache_.front().first,
+                                 statement_cache_.begin());
+}
+
 inline bool DatabaseSync::IsOpen() {
   return connection_ != nullptr;
 }
@@ -157,6 +607,7 @@ void DatabaseSync::New(const FunctionCallbackInfo<Value>& args) {
   }
 
   bool open = true;
+  double statement_cache_size = 0;
 
   if (args.Length() > 1) {
     if (!args[1]->IsObject()) {
@@ -179,9 +630,33 @@ void DatabaseSync::New(const FunctionCallbackInfo<Value>& args) {
       }
       open = open_v.As<Boolean>()->Value();
     }
+
+    Local<Value> cache_size_v;
+    if (!options
+             ->Get(env->context(),
+                   FIXED_ONE_BYTE_STRING(env->isolate(), "statementCacheSize"))
+             .ToLocal(&cache_size_v)) {
+      return;
+    }
+    if (!cache_size_v->IsUndefined()) {
+      if (!cache_size_v->IsNumber() ||
+          !IsSafeJsInt(cache_size_v.As<Number>()) ||
+          cache_size_v.As<Number>()->Value() < 0) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env->isolate(),
+            "The \"options.statementCacheSize\" argument must be a "
+            "non-negative integer.");
+        return;
+      }
+      statement_cache_size = cache_size_v.As<Number>()->Value();
+    }
   }
 
-  new DatabaseSync(env, args.This(), args[0].As<String>(), open);
+  new DatabaseSync(env,
+                   args.This(),
+                   args[0].As<String>(),
+                   open,
+                   static_cast<size_t>(statement_cache_size));
 }
 
 void DatabaseSync::Open(const FunctionCallbackInfo<Value>& args) {
@@ -214,14 +689,54 @@ void DatabaseSync::Prepare(const FunctionCallbackInfo<Value>& args) {
   }
 
   auto sql = node::Utf8Value(env->isolate(), args[0].As<String>());
+  bool use_cache = db->statement_cache_size_ > 0;
+  if (use_cache) {
+    StatementSync* cached = db->TakeCachedStatement(sql.ToStringView());
+    if (cached != nullptr) {
+      args.GetReturnValue().Set(cached->object());
+      return;
+    }
+  }
+
   sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db->connection_, *sql, -1, &s, 0);
+  int r = sqlite3_prepare_v3(db->connection_,
+                             *sql,
+                             sql.length(),
+                             use_cache ? SQLITE_PREPARE_PERSISTENT : 0,
+                             &s,
+                             0);
   CHECK_ERROR_OR_THROW(env->isolate(), db->connection_, r, SQLITE_OK, void());
-  BaseObjectPtr<StatementSync> stmt = StatementSync::Create(env, db, s);
-  db->statements_.insert(stmt.get());
+  StatementSync* stmt = StatementSync::Create(env, db, s);
+  if (stmt == nullptr) {
+    sqlite3_finalize(s);
+    return;
+  }
+  db->statements_.insert(stmt);
+  if (use_cache) db->CacheStatement(sql.ToString(), stmt);
   args.GetReturnValue().Set(stmt->object());
 }
 
+void DatabaseSync::GetStatementCacheStats(
+    const FunctionCallbackInfo<Value>& args) {
+  DatabaseSync* db;
+  ASSIGN_OR_RETURN_UNWRAP(&db, args.This());
+  Isolate* isolate = args.GetIsolate();
+  Local<Name> names[] = {
+      FIXED_ONE_BYTE_STRING(isolate, "size"),
+      FIXED_ONE_BYTE_STRING(isolate, "capacity"),
+      FIXED_ONE_BYTE_STRING(isolate, "hits"),
+      FIXED_ONE_BYTE_STRING(isolate, "misses"),
+  };
+  Local<Value> values[] = {
+      Number::New(isolate, static_cast<double>(db->statement_cache_.size())),
+      Number::New(isolate, static_cast<double>(db->statement_cache_size_)),
+      Number::New(isolate, static_cast<double>(db->statement_cache_hits_)),
+      Number::New(isolate, static_cast<double>(db->statement_cache_misses_)),
+  };
+  args.GetReturnValue().Set(Object::New(
+      isolate, Null(isolate), names, values, arraysize(names)));
+}
+
 void DatabaseSync::Exec(const FunctionCallbackInfo<Value>& args) {
   DatabaseSync* db;
   ASSIGN_OR_RETURN_UNWRAP(&db, args.This());
@@ -239,12 +754,142 @@ void DatabaseSync::Exec(const FunctionCallbackInfo<Value>& args) {
   CHECK_ERROR_OR_THROW(env->isolate(), db->connection_, r, SQLITE_OK, void());
 }
 
+void DatabaseSync::CustomFunction(const FunctionCallbackInfo<Value>& args) {
+  DatabaseSync* db;
+  ASSIGN_OR_RETURN_UNWRAP(&db, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  THROW_AND_RETURN_ON_BAD_STATE(env, !db->IsOpen(), "database is not open");
+
+  if (!args[0]->IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env->isolate(),
+                                     "The \"name\" argument must be a string.");
+    return;
+  }
+
+  int fn_index = 1;
+  FunctionOptions options;
+  if (args[1]->IsObject() && !args[1]->IsFunction()) {
+    if (!options.Read(env, args[1].As<Object>())) return;
+    fn_index = 2;
+  }
+
+  if (!args[fn_index]->IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env->isolate(), "The \"function\" argument must be a function.");
+    return;
+  }
+
+  Local<Function> fn = args[fn_index].As<Function>();
+  int argc;
+  if (!FunctionArgc(env, fn, 0, options.varargs).To(&argc)) return;
+
+  auto udf = new UserDefinedFunction(env, fn, options.use_bigint_arguments);
+  Utf8Value name(env->isolate(), args[0]);
+  // SQLite calls xDestroy, which deletes |udf|, even if this fails.
+  int r = sqlite3_create_function_v2(db->connection_,
+                                     *name,
+                                     argc,
+                                     options.flags(),
+                                     udf,
+                                     UserDefinedFunction::xFunc,
+                                     nullptr,
+                                     nullptr,
+                                     UserDefinedFunction::xDestroy);
+  CHECK_ERROR_OR_THROW(env->isolate(), db->connection_, r, SQLITE_OK, void());
+}
+
+void DatabaseSync::AggregateFunction(const FunctionCallbackInfo<Value>& args) {
+  DatabaseSync* db;
+  ASSIGN_OR_RETURN_UNWRAP(&db, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  THROW_AND_RETURN_ON_BAD_STATE(env, !db->IsOpen(), "database is not open");
+
+  if (!args[0]->IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(isolate,
+                                     "The \"name\" argument must be a string.");
+    return;
+  }
+
+  if (!args[1]->IsObject()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        isolate, "The \"options\" argument must be an object.");
+    return;
+  }
+
+  Local<Object> obj = args[1].As<Object>();
+  FunctionOptions options;
+  if (!options.Read(env, obj)) return;
+
+  Local<Value> start;
+  Local<Value> step;
+  Local<Value> inverse;
+  Local<Value> result;
+  if (!obj->Get(env->context(), FIXED_ONE_BYTE_STRING(isolate, "start"))
+           .ToLocal(&start) ||
+      !obj->Get(env->context(), FIXED_ONE_BYTE_STRING(isolate, "step"))
+           .ToLocal(&step) ||
+      !obj->Get(env->context(), FIXED_ONE_BYTE_STRING(isolate, "inverse"))
+           .ToLocal(&inverse) ||
+      !obj->Get(env->context(), FIXED_ONE_BYTE_STRING(isolate, "result"))
+           .ToLocal(&result)) {
+    return;
+  }
+
+  if (!step->IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        isolate, "The \"options.step\" argument must be a function.");
+    return;
+  }
+  if (!inverse->IsUndefined() && !inverse->IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        isolate, "The \"options.inverse\" argument must be a function.");
+    return;
+  }
+  if (!result->IsUndefined() && !result->IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        isolate, "The \"options.result\" argument must be a function.");
+    return;
+  }
+
+  // The accumulator is the first argument of step().
+  int argc;
+  if (!FunctionArgc(env, step.As<Function>(), 1, options.varargs).To(&argc)) {
+    return;
+  }
+
+  auto aggregate =
+      new UserDefinedAggregate(env,
+                               start,
+                               step.As<Function>(),
+                               inverse,
+                               result,
+                               options.use_bigint_arguments);
+  Utf8Value name(isolate, args[0]);
+  // Aggregates with an inverse can also be used as window functions.
+  // SQLite calls xDestroy, which deletes |aggregate|, even if this fails.
+  int r = sqlite3_create_window_function(
+      db->connection_,
+      *name,
+      argc,
+      options.flags(),
+      aggregate,
+      UserDefinedAggregate::xStep,
+      UserDefinedAggregate::xFinal,
+      aggregate->is_window() ? UserDefinedAggregate::xValue : nullptr,
+      aggregate->is_window() ? UserDefinedAggregate::xInverse : nullptr,
+      UserDefinedAggregate::xDestroy);
+  CHECK_ERROR_OR_THROW(isolate, db->connection_, r, SQLITE_OK, void());
+}
+
+StatementSyncRef::StatementSyncRef(StatementSync* stmt)
+    : stmt_(stmt), object_(stmt->env()->isolate(), stmt->object()) {}
+
 StatementSync::StatementSync(Environment* env,
                              Local<Object> object,
                              DatabaseSync* db,
-                             sqlite3_stmt* stmt)
-    : BaseObject(env, object) {
-  MakeWeak();
+                             sqlite3_stmt* stmt) {
+  CppgcMixin::Wrap(this, env, object);
   db_ = db;
   statement_ = stmt;
   // In the future, some of these options could be set at the database
@@ -254,6 +899,8 @@ StatementSync::StatementSync(Environment* env,
   bare_named_params_ = std::nullopt;
 }
 
+// Statements of a database that is closed or destroyed are finalized by
+// DatabaseSync::FinalizeStatements(), so db_ is valid here.
 StatementSync::~StatementSync() {
   if (!IsFinalized()) {
     db_->UntrackStatement(this);
@@ -270,6 +917,11 @@ inline bool StatementSync::IsFinalized() {
   return statement_ == nullptr;
 }
 
+int StatementSync::Reset() {
+  reset_generation_++;
+  return sqlite3_reset(statement_);
+}
+
 bool StatementSync::BindParams(const FunctionCallbackInfo<Value>& args) {
   int r = sqlite3_clear_bindings(statement_);
   CHECK_ERROR_OR_THROW(
@@ -279,92 +931,108 @@ bool StatementSync::BindParams(const FunctionCallbackInfo<Value>& args) {
   int anon_start = 0;
 
   if (args[0]->IsObject() && !args[0]->IsUint8Array()) {
-    Local<Object> obj = args[0].As<Object>();
-    Local<Context> context = obj->GetIsolate()->GetCurrentContext();
-    Local<Array> keys;
-    if (!obj->GetOwnPropertyNames(context).ToLocal(&keys)) {
+    if (!BindNamedParams(args[0].As<Object>())) {
       return false;
     }
+    anon_start++;
+  }
 
-    if (allow_bare_named_params_ && !bare_named_params_.has_value()) {
-      bare_named_params_.emplace();
-      int param_count = sqlite3_bind_parameter_count(statement_);
-      // Parameter indexing starts at one.
-      for (int i = 1; i <= param_count; ++i) {
-        const char* name = sqlite3_bind_parameter_name(statement_, i);
-        if (name == nullptr) {
-          continue;
-        }
+  for (int i = anon_start; i < args.Length(); ++i) {
+    if (!BindAnonymousParam(args[i], &anon_idx)) {
+      return false;
+    }
+  }
 
-        auto bare_name = std::string(name + 1);
-        auto full_name = std::string(name);
-        auto insertion = bare_named_params_->insert({bare_name, full_name});
-        if (insertion.second == false) {
-          auto existing_full_name = (*insertion.first).second;
-          if (full_name != existing_full_name) {
-            node::THROW_ERR_INVALID_STATE(
-                env(),
-                "Cannot create bare named parameter '%s' because of "
-                "conflicting names '%s' and '%s'.",
-                bare_name,
-                existing_full_name,
-                full_name);
-            return false;
-          }
-        }
-      }
+  return true;
+}
+
+bool StatementSync::BindNamedParams(Local<Object> obj) {
+  Local<Context> context = env()->context();
+  Local<Array> keys;
+  if (!obj->GetOwnPropertyNames(context).ToLocal(&keys)) {
+    return false;
+  }
+
+  uint32_t len = keys->Length();
+  for (uint32_t j = 0; j < len; j++) {
+    Local<Value> key;
+    if (!keys->Get(context, j).ToLocal(&key)) {
+      return false;
     }
 
-    uint32_t len = keys->Length();
-    for (uint32_t j = 0; j < len; j++) {
-      Local<Value> key;
-      if (!keys->Get(context, j).ToLocal(&key)) {
-        return false;
-      }
+    int r = NamedParamIndex(key);
+    if (r == 0) {
+      return false;
+    }
 
-      auto utf8_key = node::Utf8Value(env()->isolate(), key);
-      int r = sqlite3_bind_parameter_index(statement_, *utf8_key);
-      if (r == 0) {
-        if (allow_bare_named_params_) {
-          auto lookup = bare_named_params_->find(std::string(*utf8_key));
-          if (lookup != bare_named_params_->end()) {
-            r = sqlite3_bind_parameter_index(statement_,
-                                             lookup->second.c_str());
-          }
-        }
+    Local<Value> value;
+    if (!obj->Get(context, key).ToLocal(&value)) {
+      return false;
+    }
 
-        if (r == 0) {
-          node::THROW_ERR_INVALID_STATE(
-              env(), "Unknown named parameter '%s'", *utf8_key);
-          return false;
-        }
-      }
+    if (!BindValue(value, r)) {
+      return false;
+    }
+  }
 
-      Local<Value> value;
-      if (!obj->Get(context, key).ToLocal(&value)) {
-        return false;
+  return true;
+}
+
+bool StatementSync::BindAnonymousParam(Local<Value> value, int* anon_idx) {
+  while (sqlite3_bind_parameter_name(statement_, *anon_idx) != nullptr) {
+    (*anon_idx)++;
+  }
+
+  return BindValue(value, (*anon_idx)++);
+}
+
+int StatementSync::NamedParamIndex(Local<Value> key) {
+  if (allow_bare_named_params_ && !bare_named_params_.has_value()) {
+    bare_named_params_.emplace();
+    int param_count = sqlite3_bind_parameter_count(statement_);
+    // Parameter indexing starts at one.
+    for (int i = 1; i <= param_count; ++i) {
+      const char* name = sqlite3_bind_parameter_name(statement_, i);
+      if (name == nullptr) {
+        continue;
       }
 
-      if (!BindValue(value, r)) {
-        return false;
+      auto bare_name = std::string(name + 1);
+      auto full_name = std::string(name);
+      auto insertion = bare_named_params_->insert({bare_name, full_name});
+      if (insertion.second == false) {
+        auto existing_full_name = (*insertion.first).second;
+        if (full_name != existing_full_name) {
+          node::THROW_ERR_INVALID_STATE(
+              env(),
+              "Cannot create bare named parameter '%s' because of "
+              "conflicting names '%s' and '%s'.",
+              bare_name,
+              existing_full_name,
+              full_name);
+          return 0;
+        }
       }
     }
-    anon_start++;
   }
 
-  for (int i = anon_start; i < args.Length(); ++i) {
-    while (sqlite3_bind_parameter_name(statement_, anon_idx) != nullptr) {
-      anon_idx++;
+  auto utf8_key = node::Utf8Value(env()->isolate(), key);
+  int r = sqlite3_bind_parameter_index(statement_, *utf8_key);
+  if (r == 0) {
+    if (allow_bare_named_params_) {
+      auto lookup = bare_named_params_->find(std::string(*utf8_key));
+      if (lookup != bare_named_params_->end()) {
+        r = sqlite3_bind_parameter_index(statement_, lookup->second.c_str());
+      }
     }
 
-    if (!BindValue(args[i], anon_idx)) {
-      return false;
+    if (r == 0) {
+      node::THROW_ERR_INVALID_STATE(
+          env(), "Unknown named parameter '%s'", *utf8_key);
     }
-
-    anon_idx++;
   }
 
-  return true;
+  return r;
 }
 
 bool StatementSync::BindValue(const Local<Value>& value, const int index) {
@@ -411,21 +1079,11 @@ bool StatementSync::BindValue(const Local<Value>& value, const int index) {
 
 MaybeLocal<Value> StatementSync::ColumnToValue(const int column) {
   switch (sqlite3_column_type(statement_, column)) {
-    case SQLITE_INTEGER: {
-      sqlite3_int64 value = sqlite3_column_int64(statement_, column);
-      if (use_big_ints_) {
-        return BigInt::New(env()->isolate(), value);
-      } else if (std::abs(value) <= kMaxSafeJsInteger) {
-        return Number::New(env()->isolate(), value);
-      } else {
-        THROW_ERR_OUT_OF_RANGE(env()->isolate(),
-                               "The value of column %d is too large to be "
-                               "represented as a JavaScript number: %" PRId64,
-                               column,
-                               value);
-        return MaybeLocal<Value>();
-      }
-    }
+    case SQLITE_INTEGER:
+      return Int64ToValue(env()->isolate(),
+                          sqlite3_column_int64(statement_, column),
+                          column,
+                          use_big_ints_);
     case SQLITE_FLOAT:
       return Number::New(env()->isolate(),
                          sqlite3_column_double(statement_, column));
@@ -462,16 +1120,225 @@ MaybeLocal<Name> StatementSync::ColumnNameToName(const int column) {
   return String::NewFromUtf8(env()->isolate(), col_name).As<Name>();
 }
 
-void StatementSync::MemoryInfo(MemoryTracker* tracker) const {}
+bool StatementSync::ColumnNames(LocalVector<Name>* names) {
+  int num_cols = sqlite3_column_count(statement_);
+  names->reserve(num_cols);
+  for (int i = 0; i < num_cols; ++i) {
+    Local<Name> key;
+    if (!ColumnNameToName(i).ToLocal(&key)) return false;
+    names->emplace_back(key);
+  }
+  return true;
+}
 
-void StatementSync::All(const FunctionCallbackInfo<Value>& args) {
-  StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
-  Environment* env = Environment::GetCurrent(args);
-  THROW_AND_RETURN_ON_BAD_STATE(
-      env, stmt->IsFinalized(), "statement has been finalized");
-  Isolate* isolate = env->isolate();
-  int r = sqlite3_reset(stmt->statement_);
+MaybeLocal<Value> StatementSync::ReadRow(LocalVector<Name>* names) {
+  Isolate* isolate = env()->isolate();
+  int num_cols = sqlite3_column_count(statement_);
+  LocalVector<Value> values(isolate);
+  values.reserve(num_cols);
+  for (int i = 0; i < num_cols; ++i) {
+    Local<Value> val;
+    if (!ColumnToValue(i).ToLocal(&val)) return MaybeLocal<Value>();
+    values.emplace_back(val);
+  }
+
+  switch (result_mode_) {
+    case ResultMode::kArray:
+      return Array::New(isolate, values.data(), values.size());
+    case ResultMode::kTemplate: {
+      Local<DictionaryTemplate> tmpl;
+      if (!RowTemplate().ToLocal(&tmpl)) return MaybeLocal<Value>();
+      std::vector<MaybeLocal<Value>> maybe_values(values.begin(),
+                                                  values.end());
+      return tmpl->NewInstance(
+          env()->context(),
+          MemorySpan<MaybeLocal<Value>>(maybe_values.data(),
+                                        maybe_values.size()));
+    }
+    case ResultMode::kObject:
+    case ResultMode::kColumnar:
+      if (names->empty() && !ColumnNames(names)) return MaybeLocal<Value>();
+      return Object::New(
+          isolate, Null(isolate), names->data(), values.data(), num_cols);
+  }
+  UNREACHABLE();
+}
+
+MaybeLocal<DictionaryTemplate> StatementSync::RowTemplate() {
+  Isolate* isolate = env()->isolate();
+  // The column names can only change when the statement is recompiled
+  // after a schema change, which happens on a step after a reset.
+  if (!row_template_.IsEmpty() &&
+      row_template_generation_ == reset_generation_) {
+    return row_template_.Get(isolate);
+  }
+
+  int num_cols = sqlite3_column_count(statement_);
+  std::vector<std::string> names;
+  names.reserve(num_cols);
+  for (int i = 0; i < num_cols; ++i) {
+    const char* col_name = sqlite3_column_name(statement_, i);
+    if (col_name == nullptr) {
+      node::THROW_ERR_INVALID_STATE(env(), "Cannot get name of column %d", i);
+      return MaybeLocal<DictionaryTemplate>();
+    }
+    names.emplace_back(col_name);
+  }
+
+  if (row_template_.IsEmpty() || names != row_template_names_) {
+    std::vector<std::string_view> keys(names.begin(), names.end());
+    std::sort(keys.begin(), keys.end());
+    auto duplicate = std::adjacent_find(keys.begin(), keys.end());
+    if (duplicate != keys.end()) {
+      node::THROW_ERR_INVALID_STATE(
+          env(),
+          "Duplicate column name %s cannot be used in the template result "
+          "mode",
+          std::string(*duplicate));
+      return MaybeLocal<DictionaryTemplate>();
+    }
+    keys.assign(names.begin(), names.end());
+    row_template_.Reset(
+        isolate,
+        DictionaryTemplate::New(
+            isolate,
+            MemorySpan<const std::string_view>(keys.data(), keys.size())));
+    row_template_names_ = std::move(names);
+  }
+  row_template_generation_ = reset_generation_;
+  return row_template_.Get(isolate);
+}
+
+namespace {
+
+// A column of the columnar result mode. Starts out collecting numbers into
+// a buffer for a typed array, and falls back to an array of values on the
+// first value that does not fit.
+class ResultColumn {
+ public:
+  enum class Kind : uint8_t { kEmpty, kFloat64, kBigInt64, kValues };
+
+  explicit ResultColumn(Isolate* isolate) : values_(isolate) {}
+
+  bool AppendDouble(double value) {
+    if (kind_ != Kind::kEmpty && kind_ != Kind::kFloat64) return false;
+    kind_ = Kind::kFloat64;
+    doubles_.push_back(value);
+    return true;
+  }
+
+  bool AppendInt64(int64_t value) {
+    if (kind_ != Kind::kEmpty && kind_ != Kind::kBigInt64) return false;
+    kind_ = Kind::kBigInt64;
+    ints_.push_back(value);
+    return true;
+  }
+
+  void AppendValue(Isolate* isolate, Local<Value> value) {
+    if (kind_ != Kind::kValues) {
+      values_.reserve(doubles_.size() + ints_.size() + 1);
+      for (double d : doubles_) values_.push_back(Number::New(isolate, d));
+      for (int64_t i : ints_) values_.push_back(BigInt::New(isolate, i));
+      doubles_ = {};
+      ints_ = {};
+      kind_ = Kind::kValues;
+    }
+    values_.push_back(value);
+  }
+
+  Local<Value> ToValue(Isolate* isolate) {
+    switch (kind_) {
+      case Kind::kFloat64:
+        return Float64Array::New(CopyToArrayBuffer(isolate, doubles_),
+                                 0,
+                                 doubles_.size());
+      case Kind::kBigInt64:
+        return BigInt64Array::New(
+            CopyToArrayBuffer(isolate, ints_), 0, ints_.size());
+      case Kind::kEmpty:
+      case Kind::kValues:
+        return Array::New(isolate, values_.data(), values_.size());
+    }
+    UNREACHABLE();
+  }
+
+ private:
+  template <typename T>
+  static Local<ArrayBuffer> CopyToArrayBuffer(Isolate* isolate,
+                                              const std::vector<T>& data) {
+    size_t size = data.size() * sizeof(T);
+    auto store = ArrayBuffer::NewBackingStore(isolate, size);
+    memcpy(store->Data(), data.data(), size);
+    return ArrayBuffer::New(isolate, std::move(store));
+  }
+
+  Kind kind_ = Kind::kEmpty;
+  std::vector<double> doubles_;
+  std::vector<int64_t> ints_;
+  LocalVector<Value> values_;
+};
+
+}  // namespace
+
+MaybeLocal<Object> StatementSync::ReadColumns() {
+  Isolate* isolate = env()->isolate();
+  int num_cols = sqlite3_column_count(statement_);
+  LocalVector<Name> names(isolate);
+  if (!ColumnNames(&names)) return MaybeLocal<Object>();
+  std::vector<ResultColumn> columns;
+  columns.reserve(num_cols);
+  for (int i = 0; i < num_cols; ++i) columns.emplace_back(isolate);
+
+  int r;
+  while ((r = sqlite3_step(statement_)) == SQLITE_ROW) {
+    for (int i = 0; i < num_cols; ++i) {
+      ResultColumn& column = columns[i];
+      switch (sqlite3_column_type(statement_, i)) {
+        case SQLITE_INTEGER: {
+          sqlite3_int64 value = sqlite3_column_int64(statement_, i);
+          if (use_big_ints_ ? column.AppendInt64(value)
+                            : (std::abs(value) <= kMaxSafeJsInteger &&
+                               column.AppendDouble(value))) {
+            continue;
+          }
+          break;
+        }
+        case SQLITE_FLOAT:
+          if (column.AppendDouble(sqlite3_column_double(statement_, i))) {
+            continue;
+          }
+          break;
+      }
+      Local<Value> val;
+      if (!ColumnToValue(i).ToLocal(&val)) return MaybeLocal<Object>();
+      column.AppendValue(isolate, val);
+    }
+  }
+  CHECK_ERROR_OR_THROW(
+      isolate, db_->Connection(), r, SQLITE_DONE, MaybeLocal<Object>());
+
+  LocalVector<Value> values(isolate);
+  values.reserve(num_cols);
+  for (ResultColumn& column : columns) {
+    values.emplace_back(column.ToValue(isolate));
+  }
+  return Object::New(
+      isolate, Null(isolate), names.data(), values.data(), num_cols);
+}
+
+void StatementSync::Trace(cppgc::Visitor* visitor) const {
+  CppgcMixin::Trace(visitor);
+  visitor->Trace(row_template_);
+}
+
+void StatementSync::All(const FunctionCallbackInfo<Value>& args) {
+  StatementSync* stmt;
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  THROW_AND_RETURN_ON_BAD_STATE(
+      env, stmt->IsFinalized(), "statement has been finalized");
+  Isolate* isolate = env->isolate();
+  int r = stmt->Reset();
   CHECK_ERROR_OR_THROW(isolate, stmt->db_->Connection(), r, SQLITE_OK, void());
 
   if (!stmt->BindParams(args)) {
@@ -479,25 +1346,21 @@ void StatementSync::All(const FunctionCallbackInfo<Value>& args) {
   }
 
   auto reset = OnScopeLeave([&]() { sqlite3_reset(stmt->statement_); });
-  int num_cols = sqlite3_column_count(stmt->statement_);
-  LocalVector<Value> rows(isolate);
-  while ((r = sqlite3_step(stmt->statement_)) == SQLITE_ROW) {
-    LocalVector<Name> row_keys(isolate);
-    row_keys.reserve(num_cols);
-    LocalVector<Value> row_values(isolate);
-    row_values.reserve(num_cols);
-
-    for (int i = 0; i < num_cols; ++i) {
-      Local<Name> key;
-      if (!stmt->ColumnNameToName(i).ToLocal(&key)) return;
-      Local<Value> val;
-      if (!stmt->ColumnToValue(i).ToLocal(&val)) return;
-      row_keys.emplace_back(key);
-      row_values.emplace_back(val);
+  if (stmt->result_mode_ == ResultMode::kColumnar) {
+    Local<Object> columns;
+    if (stmt->ReadColumns().ToLocal(&columns)) {
+      args.GetReturnValue().Set(columns);
     }
+    return;
+  }
 
-    Local<Object> row = Object::New(
-        isolate, Null(isolate), row_keys.data(), row_values.data(), num_cols);
+  // The column names are the same for every row, so they are only created
+  // once.
+  LocalVector<Name> row_keys(isolate);
+  LocalVector<Value> rows(isolate);
+  while ((r = sqlite3_step(stmt->statement_)) == SQLITE_ROW) {
+    Local<Value> row;
+    if (!stmt->ReadRow(&row_keys).ToLocal(&row)) return;
     rows.emplace_back(row);
   }
 
@@ -508,12 +1371,12 @@ void StatementSync::All(const FunctionCallbackInfo<Value>& args) {
 
 void StatementSync::Get(const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
   Isolate* isolate = env->isolate();
-  int r = sqlite3_reset(stmt->statement_);
+  int r = stmt->Reset();
   CHECK_ERROR_OR_THROW(isolate, stmt->db_->Connection(), r, SQLITE_OK, void());
 
   if (!stmt->BindParams(args)) {
@@ -534,32 +1397,39 @@ void StatementSync::Get(const FunctionCallbackInfo<Value>& args) {
   }
 
   LocalVector<Name> keys(isolate);
-  keys.reserve(num_cols);
-  LocalVector<Value> values(isolate);
-  values.reserve(num_cols);
+  Local<Value> result;
+  if (!stmt->ReadRow(&keys).ToLocal(&result)) return;
 
-  for (int i = 0; i < num_cols; ++i) {
-    Local<Name> key;
-    if (!stmt->ColumnNameToName(i).ToLocal(&key)) return;
-    Local<Value> val;
-    if (!stmt->ColumnToValue(i).ToLocal(&val)) return;
-    keys.emplace_back(key);
-    values.emplace_back(val);
-  }
+  args.GetReturnValue().Set(result);
+}
+
+void StatementSync::Iterate(const FunctionCallbackInfo<Value>& args) {
+  StatementSync* stmt;
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  THROW_AND_RETURN_ON_BAD_STATE(
+      env, stmt->IsFinalized(), "statement has been finalized");
+  int r = stmt->Reset();
+  CHECK_ERROR_OR_THROW(
+      env->isolate(), stmt->db_->Connection(), r, SQLITE_OK, void());
 
-  Local<Object> result =
-      Object::New(isolate, Null(isolate), keys.data(), values.data(), num_cols);
+  if (!stmt->BindParams(args)) {
+    return;
+  }
 
-  args.GetReturnValue().Set(result);
+  BaseObjectPtr<StatementSyncIterator> iter =
+      StatementSyncIterator::Create(env, stmt);
+  if (!iter) return;
+  args.GetReturnValue().Set(iter->object());
 }
 
 void StatementSync::Run(const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
-  int r = sqlite3_reset(stmt->statement_);
+  int r = stmt->Reset();
   CHECK_ERROR_OR_THROW(
       env->isolate(), stmt->db_->Connection(), r, SQLITE_OK, void());
 
@@ -574,38 +1444,222 @@ void StatementSync::Run(const FunctionCallbackInfo<Value>& args) {
     return;
   }
 
-  Local<Object> result = Object::New(env->isolate());
-  Local<String> last_insert_rowid_string =
-      FIXED_ONE_BYTE_STRING(env->isolate(), "lastInsertRowid");
-  Local<String> changes_string =
-      FIXED_ONE_BYTE_STRING(env->isolate(), "changes");
-  sqlite3_int64 last_insert_rowid =
-      sqlite3_last_insert_rowid(stmt->db_->Connection());
-  sqlite3_int64 changes = sqlite3_changes64(stmt->db_->Connection());
-  Local<Value> last_insert_rowid_val;
-  Local<Value> changes_val;
+  Local<Object> result;
+  if (CreateRunResult(env,
+                      sqlite3_changes64(stmt->db_->Connection()),
+                      sqlite3_last_insert_rowid(stmt->db_->Connection()),
+                      stmt->use_big_ints_)
+          .ToLocal(&result)) {
+    args.GetReturnValue().Set(result);
+  }
+}
 
-  if (stmt->use_big_ints_) {
-    last_insert_rowid_val = BigInt::New(env->isolate(), last_insert_rowid);
-    changes_val = BigInt::New(env->isolate(), changes);
-  } else {
-    last_insert_rowid_val = Number::New(env->isolate(), last_insert_rowid);
-    changes_val = Number::New(env->isolate(), changes);
+struct StatementSync::BatchColumn {
+  int index;
+  // Set for arrays and for typed arrays that are not copied below.
+  Local<Value> values;
+  // Typed arrays of numbers are copied up front, so that their rows are
+  // bound without creating a JavaScript value each.
+  std::variant<std::monostate,
+               std::vector<double>,
+               std::vector<int32_t>,
+               std::vector<int64_t>>
+      numbers;
+};
+
+bool StatementSync::BindColumnarRow(const std::vector<BatchColumn>& columns,
+                                    uint32_t row) {
+  for (const BatchColumn& column : columns) {
+    int r;
+    if (const auto* values = std::get_if<std::vector<double>>(
+            &column.numbers)) {
+      r = sqlite3_bind_double(statement_, column.index, (*values)[row]);
+    } else if (const auto* values = std::get_if<std::vector<int32_t>>(
+                   &column.numbers)) {
+      r = sqlite3_bind_int(statement_, column.index, (*values)[row]);
+    } else if (const auto* values = std::get_if<std::vector<int64_t>>(
+                   &column.numbers)) {
+      r = sqlite3_bind_int64(statement_, column.index, (*values)[row]);
+    } else {
+      Local<Value> value;
+      if (!column.values.As<Object>()
+               ->Get(env()->context(), row)
+               .ToLocal(&value) ||
+          !BindValue(value, column.index)) {
+        return false;
+      }
+      continue;
+    }
+    CHECK_ERROR_OR_THROW(
+        env()->isolate(), db_->Connection(), r, SQLITE_OK, false);
   }
+  return true;
+}
 
-  if (result
-          ->Set(env->context(), last_insert_rowid_string, last_insert_rowid_val)
-          .IsNothing() ||
-      result->Set(env->context(), changes_string, changes_val).IsNothing()) {
+void StatementSync::RunMany(const FunctionCallbackInfo<Value>& args) {
+  StatementSync* stmt;
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  THROW_AND_RETURN_ON_BAD_STATE(
+      env, stmt->IsFinalized(), "statement has been finalized");
+
+  if (!args[0]->IsObject() || args[0]->IsArrayBufferView()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        isolate, "The \"rows\" argument must be an array or an object.");
     return;
   }
 
-  args.GetReturnValue().Set(result);
+  // A columnar batch maps parameter names to arrays or typed arrays of
+  // equal length, one element per row.
+  std::vector<BatchColumn> columns;
+  uint32_t num_rows = 0;
+  if (!args[0]->IsArray()) {
+    Local<Object> obj = args[0].As<Object>();
+    Local<Array> keys;
+    if (!obj->GetOwnPropertyNames(context).ToLocal(&keys)) {
+      return;
+    }
+    for (uint32_t i = 0; i < keys->Length(); i++) {
+      Local<Value> key;
+      Local<Value> values;
+      if (!keys->Get(context, i).ToLocal(&key) ||
+          !obj->Get(context, key).ToLocal(&values)) {
+        return;
+      }
+
+      BatchColumn column;
+      column.index = stmt->NamedParamIndex(key);
+      if (column.index == 0) {
+        return;
+      }
+
+      uint32_t length;
+      if (values->IsArray()) {
+        length = values.As<Array>()->Length();
+        column.values = values;
+      } else if (values->IsTypedArray()) {
+        Local<TypedArray> typed_array = values.As<TypedArray>();
+        length = typed_array->Length();
+        if (values->IsFloat64Array()) {
+          auto& copy = column.numbers.emplace<std::vector<double>>(length);
+          typed_array->CopyContents(copy.data(), length * sizeof(double));
+        } else if (values->IsInt32Array()) {
+          auto& copy = column.numbers.emplace<std::vector<int32_t>>(length);
+          typed_array->CopyContents(copy.data(), length * sizeof(int32_t));
+        } else if (values->IsBigInt64Array()) {
+          auto& copy = column.numbers.emplace<std::vector<int64_t>>(length);
+          typed_array->CopyContents(copy.data(), length * sizeof(int64_t));
+        } else {
+          column.values = values;
+        }
+      } else {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            isolate,
+            "The \"rows.%s\" argument must be an array or a typed array.",
+            *node::Utf8Value(isolate, key));
+        return;
+      }
+
+      if (columns.empty()) {
+        num_rows = length;
+      } else if (length != num_rows) {
+        node::THROW_ERR_INVALID_ARG_VALUE(
+            env, "All columns of a columnar batch must have the same length.");
+        return;
+      }
+      columns.push_back(std::move(column));
+    }
+  } else {
+    num_rows = args[0].As<Array>()->Length();
+  }
+
+  sqlite3* db = stmt->db_->Connection();
+  int r = stmt->Reset();
+  CHECK_ERROR_OR_THROW(isolate, db, r, SQLITE_OK, void());
+
+  // Run the batch in one transaction unless the caller already opened one,
+  // so that it is applied atomically and only synced to disk once.
+  bool own_transaction = sqlite3_get_autocommit(db) != 0;
+  if (own_transaction) {
+    r = sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+    CHECK_ERROR_OR_THROW(isolate, db, r, SQLITE_OK, void());
+  }
+  bool committed = false;
+  auto rollback = OnScopeLeave([&]() {
+    sqlite3_reset(stmt->statement_);
+    if (own_transaction && !committed) {
+      sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+  });
+
+  int64_t changes = 0;
+  for (uint32_t i = 0; i < num_rows; i++) {
+    r = sqlite3_clear_bindings(stmt->statement_);
+    CHECK_ERROR_OR_THROW(isolate, db, r, SQLITE_OK, void());
+
+    if (!columns.empty()) {
+      if (!stmt->BindColumnarRow(columns, i)) {
+        return;
+      }
+    } else {
+      Local<Value> row;
+      if (!args[0].As<Array>()->Get(context, i).ToLocal(&row)) {
+        return;
+      }
+      // Like the arguments of run(): an array of anonymous parameters, an
+      // object of named parameters, or a single anonymous parameter.
+      if (row->IsArray()) {
+        Local<Array> values = row.As<Array>();
+        int anon_idx = 1;
+        for (uint32_t j = 0; j < values->Length(); j++) {
+          Local<Value> value;
+          if (!values->Get(context, j).ToLocal(&value) ||
+              !stmt->BindAnonymousParam(value, &anon_idx)) {
+            return;
+          }
+        }
+      } else if (row->IsObject() && !row->IsUint8Array()) {
+        if (!stmt->BindNamedParams(row.As<Object>())) {
+          return;
+        }
+      } else {
+        int anon_idx = 1;
+        if (!stmt->BindAnonymousParam(row, &anon_idx)) {
+          return;
+        }
+      }
+    }
+
+    r = sqlite3_step(stmt->statement_);
+    if (r != SQLITE_ROW && r != SQLITE_DONE) {
+      THROW_ERR_SQLITE_ERROR(isolate, db);
+      return;
+    }
+    changes += sqlite3_changes64(db);
+    sqlite3_reset(stmt->statement_);
+  }
+
+  if (own_transaction) {
+    r = sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+    CHECK_ERROR_OR_THROW(isolate, db, r, SQLITE_OK, void());
+    committed = true;
+  }
+
+  Local<Object> result;
+  if (CreateRunResult(env,
+                      changes,
+                      sqlite3_last_insert_rowid(db),
+                      stmt->use_big_ints_)
+          .ToLocal(&result)) {
+    args.GetReturnValue().Set(result);
+  }
 }
 
 void StatementSync::SourceSQL(const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
@@ -619,7 +1673,7 @@ void StatementSync::SourceSQL(const FunctionCallbackInfo<Value>& args) {
 
 void StatementSync::ExpandedSQL(const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
@@ -636,7 +1690,7 @@ void StatementSync::ExpandedSQL(const FunctionCallbackInfo<Value>& args) {
 void StatementSync::SetAllowBareNamedParameters(
     const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
@@ -653,7 +1707,7 @@ void StatementSync::SetAllowBareNamedParameters(
 
 void StatementSync::SetReadBigInts(const FunctionCallbackInfo<Value>& args) {
   StatementSync* stmt;
-  ASSIGN_OR_RETURN_UNWRAP(&stmt, args.This());
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
   Environment* env = Environment::GetCurrent(args);
   THROW_AND_RETURN_ON_BAD_STATE(
       env, stmt->IsFinalized(), "statement has been finalized");
@@ -667,6 +1721,36 @@ void StatementSync::SetReadBigInts(const FunctionCallbackInfo<Value>& args) {
   stmt->use_big_ints_ = args[0]->IsTrue();
 }
 
+void StatementSync::SetResultMode(const FunctionCallbackInfo<Value>& args) {
+  StatementSync* stmt;
+  ASSIGN_OR_RETURN_UNWRAP_CPPGC(&stmt, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  THROW_AND_RETURN_ON_BAD_STATE(
+      env, stmt->IsFinalized(), "statement has been finalized");
+
+  if (!args[0]->IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env->isolate(), "The \"mode\" argument must be a string.");
+    return;
+  }
+
+  Utf8Value mode(env->isolate(), args[0]);
+  if (mode.ToStringView() == "object") {
+    stmt->result_mode_ = ResultMode::kObject;
+  } else if (mode.ToStringView() == "array") {
+    stmt->result_mode_ = ResultMode::kArray;
+  } else if (mode.ToStringView() == "template") {
+    stmt->result_mode_ = ResultMode::kTemplate;
+  } else if (mode.ToStringView() == "columnar") {
+    stmt->result_mode_ = ResultMode::kColumnar;
+  } else {
+    node::THROW_ERR_INVALID_ARG_VALUE(
+        env->isolate(),
+        "The \"mode\" argument must be one of 'object', 'array', "
+        "'template' or 'columnar'.");
+  }
+}
+
 void IllegalConstructor(const FunctionCallbackInfo<Value>& args) {
   node::THROW_ERR_ILLEGAL_CONSTRUCTOR(Environment::GetCurrent(args));
 }
@@ -683,7 +1767,9 @@ Local<FunctionTemplate> StatementSync::GetConstructorTemplate(
         StatementSync::kInternalFieldCount);
     SetProtoMethod(isolate, tmpl, "all", StatementSync::All);
     SetProtoMethod(isolate, tmpl, "get", StatementSync::Get);
+    SetProtoMethod(isolate, tmpl, "iterate", StatementSync::Iterate);
     SetProtoMethod(isolate, tmpl, "run", StatementSync::Run);
+    SetProtoMethod(isolate, tmpl, "runMany", StatementSync::RunMany);
     SetProtoMethod(isolate, tmpl, "sourceSQL", StatementSync::SourceSQL);
     SetProtoMethod(isolate, tmpl, "expandedSQL", StatementSync::ExpandedSQL);
     SetProtoMethod(isolate,
@@ -692,23 +1778,773 @@ Local<FunctionTemplate> StatementSync::GetConstructorTemplate(
                    StatementSync::SetAllowBareNamedParameters);
     SetProtoMethod(
         isolate, tmpl, "setReadBigInts", StatementSync::SetReadBigInts);
+    SetProtoMethod(
+        isolate, tmpl, "setResultMode", StatementSync::SetResultMode);
     env->set_sqlite_statement_sync_constructor_template(tmpl);
   }
   return tmpl;
 }
 
-BaseObjectPtr<StatementSync> StatementSync::Create(Environment* env,
-                                                   DatabaseSync* db,
-                                                   sqlite3_stmt* stmt) {
+StatementSync* StatementSync::Create(Environment* env,
+                                     DatabaseSync* db,
+                                     sqlite3_stmt* stmt) {
   Local<Object> obj;
   if (!GetConstructorTemplate(env)
            ->InstanceTemplate()
            ->NewInstance(env->context())
            .ToLocal(&obj)) {
-    return BaseObjectPtr<StatementSync>();
+    return nullptr;
   }
 
-  return MakeBaseObject<StatementSync>(env, obj, db, stmt);
+  return cppgc::MakeGarbageCollected<StatementSync>(
+      env->isolate()->GetCppHeap()->GetAllocationHandle(), env, obj, db, stmt);
+}
+
+StatementSyncIterator::StatementSyncIterator(Environment* env,
+                                             Local<Object> object,
+                                             StatementSync* stmt)
+    : BaseObject(env, object),
+      stmt_(stmt),
+      generation_(stmt_->reset_generation_) {
+  MakeWeak();
+}
+
+StatementSyncIterator::~StatementSyncIterator() {
+  // Do not hold the read transaction of an abandoned iteration open.
+  Finish();
+}
+
+void StatementSyncIterator::MemoryInfo(MemoryTracker* tracker) const {
+  // The statement is reported by the CppHeap.
+}
+
+void StatementSyncIterator::Finish() {
+  if (done_) return;
+  done_ = true;
+  column_names_.clear();
+  if (!stmt_->IsFinalized() && stmt_->reset_generation_ == generation_) {
+    sqlite3_reset(stmt_->statement_);
+  }
+}
+
+bool StatementSyncIterator::Step(Local<Value>* row) {
+  *row = Local<Value>();
+  if (done_) return true;
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  if (stmt_->IsFinalized()) {
+    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
+    return false;
+  }
+  if (stmt_->reset_generation_ != generation_) {
+    node::THROW_ERR_INVALID_STATE(
+        env, "iterator was invalidated by another use of the statement");
+    return false;
+  }
+
+  int r = sqlite3_step(stmt_->statement_);
+  if (r == SQLITE_DONE) {
+    Finish();
+    return true;
+  }
+  if (r != SQLITE_ROW) {
+    THROW_ERR_SQLITE_ERROR(isolate, stmt_->db_->Connection());
+    Finish();
+    return false;
+  }
+
+  LocalVector<Name> names(isolate);
+  names.reserve(column_names_.size());
+  for (const Global<Name>& name : column_names_) {
+    names.emplace_back(name.Get(isolate));
+  }
+  if (!stmt_->ReadRow(&names).ToLocal(row)) return false;
+  if (column_names_.empty() && !names.empty()) {
+    column_names_.reserve(names.size());
+    for (Local<Name> name : names) column_names_.emplace_back(isolate, name);
+  }
+  return true;
+}
+
+void StatementSyncIterator::Next(const FunctionCallbackInfo<Value>& args) {
+  StatementSyncIterator* iter;
+  ASSIGN_OR_RETURN_UNWRAP(&iter, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Value> row;
+  if (!iter->Step(&row)) return;
+
+  Local<Name> keys[] = {env->done_string(), env->value_string()};
+  Local<Value> values[] = {
+      Boolean::New(isolate, row.IsEmpty()),
+      row.IsEmpty() ? Undefined(isolate).As<Value>() : row};
+  args.GetReturnValue().Set(
+      Object::New(isolate, Null(isolate), keys, values, arraysize(keys)));
+}
+
+void StatementSyncIterator::NextBatch(const FunctionCallbackInfo<Value>& args) {
+  StatementSyncIterator* iter;
+  ASSIGN_OR_RETURN_UNWRAP(&iter, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  if (!args[0]->IsUint32() || args[0].As<Uint32>()->Value() == 0) {
+    node::THROW_ERR_INVALID_ARG_VALUE(
+        isolate, "The \"size\" argument must be a positive integer.");
+    return;
+  }
+
+  uint32_t size = args[0].As<Uint32>()->Value();
+  LocalVector<Value> rows(isolate);
+  while (rows.size() < size) {
+    Local<Value> row;
+    if (!iter->Step(&row)) return;
+    if (row.IsEmpty()) break;
+    rows.emplace_back(row);
+  }
+  args.GetReturnValue().Set(Array::New(isolate, rows.data(), rows.size()));
+}
+
+void StatementSyncIterator::Return(const FunctionCallbackInfo<Value>& args) {
+  StatementSyncIterator* iter;
+  ASSIGN_OR_RETURN_UNWRAP(&iter, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  iter->Finish();
+
+  Local<Name> keys[] = {env->done_string(), env->value_string()};
+  Local<Value> values[] = {Boolean::New(isolate, true), Undefined(isolate)};
+  args.GetReturnValue().Set(
+      Object::New(isolate, Null(isolate), keys, values, arraysize(keys)));
+}
+
+static void ReturnThis(const FunctionCallbackInfo<Value>& args) {
+  args.GetReturnValue().Set(args.This());
+}
+
+Local<FunctionTemplate> StatementSyncIterator::GetConstructorTemplate(
+    Environment* env) {
+  Local<FunctionTemplate> tmpl =
+      env->sqlite_statement_sync_iterator_constructor_template();
+  if (tmpl.IsEmpty()) {
+    Isolate* isolate = env->isolate();
+    tmpl = NewFunctionTemplate(isolate, IllegalConstructor);
+    tmpl->SetClassName(
+        FIXED_ONE_BYTE_STRING(isolate, "StatementSyncIterator"));
+    tmpl->InstanceTemplate()->SetInternalFieldCount(
+        StatementSyncIterator::kInternalFieldCount);
+    SetProtoMethod(isolate, tmpl, "next", StatementSyncIterator::Next);
+    SetProtoMethod(
+        isolate, tmpl, "nextBatch", StatementSyncIterator::NextBatch);
+    SetProtoMethod(isolate, tmpl, "return", StatementSyncIterator::Return);
+    tmpl->PrototypeTemplate()->Set(Symbol::GetIterator(isolate),
+                                   NewFunctionTemplate(isolate, ReturnThis));
+    env->set_sqlite_statement_sync_iterator_constructor_template(tmpl);
+  }
+  return tmpl;
+}
+
+BaseObjectPtr<StatementSyncIterator> StatementSyncIterator::Create(
+    Environment* env, StatementSync* stmt) {
+  Local<Object> obj;
+  if (!GetConstructorTemplate(env)
+           ->InstanceTemplate()
+           ->NewInstance(env->context())
+           .ToLocal(&obj)) {
+    return BaseObjectPtr<StatementSyncIterator>();
+  }
+
+  return MakeBaseObject<StatementSyncIterator>(env, obj, stmt);
+}
+
+struct Database::Job {
+  enum Type { kExec, kRun, kGet, kAll, kClose };
+
+  Type type;
+  std::string sql;
+  std::vector<SQLiteValue> params;
+  std::vector<std::pair<std::string, SQLiteValue>> named_params;
+  Global<Promise::Resolver> resolver;
+
+  // Written on the database thread.
+  int errcode = SQLITE_OK;
+  // An SQLite error message, or the message of an ERR_INVALID_STATE.
+  std::string errmsg;
+  bool invalid_state = false;
+  std::vector<std::string> column_names;
+  // The values of all rows, row by row.
+  std::vector<SQLiteValue> cells;
+  int64_t changes = 0;
+  int64_t last_insert_rowid = 0;
+
+  void SetError(sqlite3* connection) {
+    errcode = sqlite3_extended_errcode(connection);
+    errmsg = sqlite3_errmsg(connection);
+  }
+};
+
+namespace {
+
+// Follows the rules of StatementSync::BindValue().
+bool ToSQLiteValue(Environment* env,
+                   Local<Value> value,
+                   int index,
+                   SQLiteValue* out) {
+  if (value->IsNumber()) {
+    *out = value.As<Number>()->Value();
+  } else if (value->IsString()) {
+    *out = Utf8Value(env->isolate(), value).ToString();
+  } else if (value->IsNull()) {
+    *out = std::monostate();
+  } else if (value->IsUint8Array()) {
+    ArrayBufferViewContents<uint8_t> buf(value);
+    *out = std::vector<uint8_t>(buf.data(), buf.data() + buf.length());
+  } else if (value->IsBigInt()) {
+    bool lossless;
+    int64_t as_int = value.As<BigInt>()->Int64Value(&lossless);
+    if (!lossless) {
+      node::THROW_ERR_INVALID_ARG_VALUE(env,
+                                        "BigInt value is too large to bind.");
+      return false;
+    }
+    *out = as_int;
+  } else {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env->isolate(),
+        "Provided value cannot be bound to SQLite parameter %d.",
+        index);
+    return false;
+  }
+  return true;
+}
+
+int BindSQLiteValue(sqlite3_stmt* stmt, int index, const SQLiteValue& value) {
+  if (const auto* val = std::get_if<int64_t>(&value)) {
+    return sqlite3_bind_int64(stmt, index, *val);
+  } else if (const auto* val = std::get_if<double>(&value)) {
+    return sqlite3_bind_double(stmt, index, *val);
+  } else if (const auto* val = std::get_if<std::string>(&value)) {
+    return sqlite3_bind_text(
+        stmt, index, val->data(), val->size(), SQLITE_STATIC);
+  } else if (const auto* val = std::get_if<std::vector<uint8_t>>(&value)) {
+    return sqlite3_bind_blob(
+        stmt, index, val->data(), val->size(), SQLITE_STATIC);
+  }
+  return sqlite3_bind_null(stmt, index);
+}
+
+SQLiteValue ReadSQLiteValue(sqlite3_stmt* stmt, int column) {
+  switch (sqlite3_column_type(stmt, column)) {
+    case SQLITE_INTEGER:
+      return static_cast<int64_t>(sqlite3_column_int64(stmt, column));
+    case SQLITE_FLOAT:
+      return sqlite3_column_double(stmt, column);
+    case SQLITE_TEXT: {
+      const char* data =
+          reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+      return std::string(data, sqlite3_column_bytes(stmt, column));
+    }
+    case SQLITE_BLOB: {
+      auto data =
+          reinterpret_cast<const uint8_t*>(sqlite3_column_blob(stmt, column));
+      return std::vector<uint8_t>(data,
+                                  data + sqlite3_column_bytes(stmt, column));
+    }
+    case SQLITE_NULL:
+      return std::monostate();
+    default:
+      UNREACHABLE("Bad SQLite column type");
+  }
+}
+
+}  // namespace
+
+Database::Database(Environment* env,
+                   Local<Object> object,
+                   std::string location,
+                   bool read_only,
+                   bool use_big_ints)
+    : BaseObject(env, object),
+      location_(std::move(location)),
+      read_only_(read_only),
+      use_big_ints_(use_big_ints),
+      async_(new uv_async_t) {
+  MakeWeak();
+  CHECK_EQ(uv_async_init(env->event_loop(), async_, OnJobsDone), 0);
+  async_->data = this;
+  // The handle only keeps the loop alive while queries are in flight.
+  uv_unref(reinterpret_cast<uv_handle_t*>(async_));
+  CHECK_EQ(uv_thread_create(&thread_, ThreadMain, this), 0);
+}
+
+Database::~Database() {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    stopping_ = true;
+    if (connection_ != nullptr) sqlite3_interrupt(connection_);
+    cond_.Signal(lock);
+  }
+  CHECK_EQ(uv_thread_join(&thread_), 0);
+  env()->CloseHandle(async_, [](uv_async_t* handle) { delete handle; });
+}
+
+void Database::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("location", location_);
+}
+
+void Database::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  if (!args.IsConstructCall()) {
+    THROW_ERR_CONSTRUCT_CALL_REQUIRED(env);
+    return;
+  }
+
+  if (!args[0]->IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env->isolate(),
+                                     "The \"path\" argument must be a string.");
+    return;
+  }
+
+  bool read_only = false;
+  bool use_big_ints = false;
+  if (args.Length() > 1) {
+    if (!args[1]->IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env->isolate(), "The \"options\" argument must be an object.");
+      return;
+    }
+
+    Local<Object> options = args[1].As<Object>();
+    const std::pair<const char*, bool*> flags[] = {
+        {"readOnly", &read_only},
+        {"readBigInts", &use_big_ints},
+    };
+    for (const auto& [name, out] : flags) {
+      Local<Value> value;
+      if (!options->Get(env->context(), OneByteString(env->isolate(), name))
+               .ToLocal(&value)) {
+        return;
+      }
+      if (value->IsUndefined()) continue;
+      if (!value->IsBoolean()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env->isolate(),
+            "The \"options.%s\" argument must be a boolean.",
+            name);
+        return;
+      }
+      *out = value->IsTrue();
+    }
+  }
+
+  new Database(env,
+               args.This(),
+               Utf8Value(env->isolate(), args[0]).ToString(),
+               read_only,
+               use_big_ints);
+}
+
+void Database::Exec(const FunctionCallbackInfo<Value>& args) {
+  Enqueue(args, Job::kExec);
+}
+
+void Database::Run(const FunctionCallbackInfo<Value>& args) {
+  Enqueue(args, Job::kRun);
+}
+
+void Database::Get(const FunctionCallbackInfo<Value>& args) {
+  Enqueue(args, Job::kGet);
+}
+
+void Database::All(const FunctionCallbackInfo<Value>& args) {
+  Enqueue(args, Job::kAll);
+}
+
+void Database::Close(const FunctionCallbackInfo<Value>& args) {
+  Enqueue(args, Job::kClose);
+}
+
+void Database::Enqueue(const FunctionCallbackInfo<Value>& args, int type) {
+  Database* db;
+  ASSIGN_OR_RETURN_UNWRAP(&db, args.This());
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  THROW_AND_RETURN_ON_BAD_STATE(env, db->closed_, "database is not open");
+
+  auto job = std::make_unique<Job>();
+  job->type = static_cast<Job::Type>(type);
+  if (job->type != Job::kClose) {
+    if (!args[0]->IsString()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          isolate, "The \"sql\" argument must be a string.");
+      return;
+    }
+    job->sql = Utf8Value(isolate, args[0]).ToString();
+  }
+
+  if (job->type == Job::kRun || job->type == Job::kGet ||
+      job->type == Job::kAll) {
+    int anon_start = 1;
+    if (args[1]->IsObject() && !args[1]->IsUint8Array()) {
+      Local<Object> obj = args[1].As<Object>();
+      Local<Array> keys;
+      if (!obj->GetOwnPropertyNames(env->context()).ToLocal(&keys)) return;
+      for (uint32_t j = 0; j < keys->Length(); j++) {
+        Local<Value> key;
+        Local<Value> value;
+        SQLiteValue param;
+        if (!keys->Get(env->context(), j).ToLocal(&key) ||
+            !obj->Get(env->context(), key).ToLocal(&value) ||
+            !ToSQLiteValue(env, value, j + 1, &param)) {
+          return;
+        }
+        job->named_params.emplace_back(Utf8Value(isolate, key).ToString(),
+                                       std::move(param));
+      }
+      anon_start++;
+    }
+    for (int i = anon_start; i < args.Length(); ++i) {
+      SQLiteValue param;
+      if (!ToSQLiteValue(env, args[i], i - anon_start + 1, &param)) return;
+      job->params.push_back(std::move(param));
+    }
+  }
+
+  Local<Promise::Resolver> resolver;
+  if (!Promise::Resolver::New(env->context()).ToLocal(&resolver)) return;
+  job->resolver.Reset(isolate, resolver);
+
+  if (job->type == Job::kClose) db->closed_ = true;
+  if (db->jobs_in_flight_++ == 0) {
+    db->ClearWeak();
+    uv_ref(reinterpret_cast<uv_handle_t*>(db->async_));
+  }
+  {
+    Mutex::ScopedLock lock(db->mutex_);
+    db->pending_.push_back(std::move(job));
+    db->cond_.Signal(lock);
+  }
+  args.GetReturnValue().Set(resolver->GetPromise());
+}
+
+void Database::ThreadMain(void* data) {
+  Database* db = static_cast<Database*>(data);
+  // Only this thread uses the connection.
+  int flags = SQLITE_OPEN_NOMUTEX |
+              (db->read_only_ ? SQLITE_OPEN_READONLY
+                              : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+  sqlite3* connection = nullptr;
+  int r = sqlite3_open_v2(db->location_.c_str(), &connection, flags, nullptr);
+  if (r != SQLITE_OK) {
+    db->open_errcode_ =
+        connection != nullptr ? sqlite3_extended_errcode(connection) : r;
+    db->open_errmsg_ = connection != nullptr ? sqlite3_errmsg(connection)
+                                             : sqlite3_errstr(r);
+    sqlite3_close_v2(connection);
+    connection = nullptr;
+  }
+  {
+    Mutex::ScopedLock lock(db->mutex_);
+    db->connection_ = connection;
+  }
+
+  while (true) {
+    std::unique_ptr<Job> job;
+    {
+      Mutex::ScopedLock lock(db->mutex_);
+      while (db->pending_.empty() && !db->stopping_) db->cond_.Wait(lock);
+      if (db->stopping_) break;
+      job = std::move(db->pending_.front());
+      db->pending_.pop_front();
+    }
+    bool close = job->type == Job::kClose;
+    db->Execute(job.get());
+    {
+      Mutex::ScopedLock lock(db->mutex_);
+      db->done_.push_back(std::move(job));
+    }
+    uv_async_send(db->async_);
+    if (close) return;
+  }
+
+  // The environment is being torn down without close().
+  Job job;
+  job.type = Job::kClose;
+  db->Execute(&job);
+}
+
+void Database::Execute(Job* job) {
+  sqlite3* connection = connection_;
+  if (job->type == Job::kClose) {
+    for (const auto& [sql, stmt] : statements_) sqlite3_finalize(stmt);
+    statements_.clear();
+    {
+      Mutex::ScopedLock lock(mutex_);
+      connection_ = nullptr;
+    }
+    if (connection != nullptr && sqlite3_close_v2(connection) != SQLITE_OK) {
+      job->SetError(connection);
+    }
+    return;
+  }
+
+  if (connection == nullptr) {
+    job->errcode = open_errcode_;
+    job->errmsg = open_errmsg_;
+    return;
+  }
+
+  if (job->type == Job::kExec) {
+    if (sqlite3_exec(connection, job->sql.c_str(), nullptr, nullptr, nullptr) !=
+        SQLITE_OK) {
+      job->SetError(connection);
+    }
+    return;
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  auto cached = statements_.find(job->sql);
+  if (cached != statements_.end()) {
+    stmt = cached->second;
+  } else {
+    if (sqlite3_prepare_v3(connection,
+                           job->sql.data(),
+                           job->sql.size(),
+                           SQLITE_PREPARE_PERSISTENT,
+                           &stmt,
+                           nullptr) != SQLITE_OK) {
+      job->SetError(connection);
+      return;
+    }
+    // The statement was empty, e.g. only a comment.
+    if (stmt == nullptr) return;
+    if (statements_.size() >= kMaxCachedStatements) {
+      for (const auto& [sql, cached_stmt] : statements_) {
+        sqlite3_finalize(cached_stmt);
+      }
+      statements_.clear();
+    }
+    statements_.emplace(job->sql, stmt);
+  }
+
+  auto reset = OnScopeLeave([&]() {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+  });
+  if (!Bind(job, stmt)) return;
+
+  int num_cols = sqlite3_column_count(stmt);
+  if (job->type != Job::kRun) {
+    for (int i = 0; i < num_cols; ++i) {
+      const char* name = sqlite3_column_name(stmt, i);
+      if (name == nullptr) {
+        job->invalid_state = true;
+        job->errmsg = "Cannot get name of column " + std::to_string(i);
+        return;
+      }
+      job->column_names.emplace_back(name);
+    }
+  }
+
+  int r;
+  while ((r = sqlite3_step(stmt)) == SQLITE_ROW && job->type != Job::kRun) {
+    for (int i = 0; i < num_cols; ++i) {
+      job->cells.push_back(ReadSQLiteValue(stmt, i));
+    }
+    if (job->type == Job::kGet) break;
+  }
+  if (r != SQLITE_ROW && r != SQLITE_DONE) {
+    job->SetError(connection);
+    job->cells.clear();
+    return;
+  }
+  if (job->type == Job::kRun) {
+    job->changes = sqlite3_changes64(connection);
+    job->last_insert_rowid = sqlite3_last_insert_rowid(connection);
+  }
+}
+
+bool Database::Bind(Job* job, sqlite3_stmt* stmt) {
+  for (const auto& [name, value] : job->named_params) {
+    int index = sqlite3_bind_parameter_index(stmt, name.c_str());
+    if (index == 0) {
+      // A bare name, like the ones StatementSync accepts.
+      std::string matched;
+      for (char prefix : {':', '$', '@'}) {
+        std::string full_name = prefix + name;
+        int i = sqlite3_bind_parameter_index(stmt, full_name.c_str());
+        if (i == 0) continue;
+        if (index != 0) {
+          job->invalid_state = true;
+          job->errmsg = "Cannot create bare named parameter '" + name +
+                        "' because of conflicting names '" + matched +
+                        "' and '" + full_name + "'.";
+          return false;
+        }
+        index = i;
+        matched = std::move(full_name);
+      }
+    }
+    if (index == 0) {
+      job->invalid_state = true;
+      job->errmsg = "Unknown named parameter '" + name + "'";
+      return false;
+    }
+    if (BindSQLiteValue(stmt, index, value) != SQLITE_OK) {
+      job->SetError(sqlite3_db_handle(stmt));
+      return false;
+    }
+  }
+
+  int anon_idx = 1;
+  for (const SQLiteValue& value : job->params) {
+    while (sqlite3_bind_parameter_name(stmt, anon_idx) != nullptr) {
+      anon_idx++;
+    }
+    if (BindSQLiteValue(stmt, anon_idx, value) != SQLITE_OK) {
+      job->SetError(sqlite3_db_handle(stmt));
+      return false;
+    }
+    anon_idx++;
+  }
+  return true;
+}
+
+MaybeLocal<Value> Database::ToValue(const SQLiteValue& value, int column) {
+  Isolate* isolate = env()->isolate();
+  if (const auto* val = std::get_if<int64_t>(&value)) {
+    return Int64ToValue(isolate, *val, column, use_big_ints_);
+  } else if (const auto* val = std::get_if<double>(&value)) {
+    return Number::New(isolate, *val);
+  } else if (const auto* val = std::get_if<std::string>(&value)) {
+    return String::NewFromUtf8(
+               isolate, val->data(), v8::NewStringType::kNormal, val->size())
+        .As<Value>();
+  } else if (const auto* val = std::get_if<std::vector<uint8_t>>(&value)) {
+    auto store = ArrayBuffer::NewBackingStore(isolate, val->size());
+    memcpy(store->Data(), val->data(), val->size());
+    auto ab = ArrayBuffer::New(isolate, std::move(store));
+    return Uint8Array::New(ab, 0, val->size());
+  }
+  return Null(isolate);
+}
+
+MaybeLocal<Value> Database::Settle(Job* job) {
+  Isolate* isolate = env()->isolate();
+  switch (job->type) {
+    case Job::kExec:
+    case Job::kClose:
+      return Undefined(isolate);
+    case Job::kRun: {
+      Local<Value> last_insert_rowid_val;
+      Local<Value> changes_val;
+      if (use_big_ints_) {
+        last_insert_rowid_val = BigInt::New(isolate, job->last_insert_rowid);
+        changes_val = BigInt::New(isolate, job->changes);
+      } else {
+        last_insert_rowid_val = Number::New(isolate, job->last_insert_rowid);
+        changes_val = Number::New(isolate, job->changes);
+      }
+      Local<Context> context = env()->context();
+      Local<Object> result = Object::New(isolate);
+      if (result
+              ->Set(context,
+                    FIXED_ONE_BYTE_STRING(isolate, "lastInsertRowid"),
+                    last_insert_rowid_val)
+              .IsNothing() ||
+          result
+              ->Set(context,
+                    FIXED_ONE_BYTE_STRING(isolate, "changes"),
+                    changes_val)
+              .IsNothing()) {
+        return MaybeLocal<Value>();
+      }
+      return result;
+    }
+    case Job::kGet:
+    case Job::kAll:
+      break;
+  }
+
+  size_t num_cols = job->column_names.size();
+  LocalVector<Name> names(isolate);
+  names.reserve(num_cols);
+  for (const std::string& name : job->column_names) {
+    Local<String> key;
+    if (!String::NewFromUtf8(
+             isolate, name.data(), v8::NewStringType::kNormal, name.size())
+             .ToLocal(&key)) {
+      return MaybeLocal<Value>();
+    }
+    names.emplace_back(key);
+  }
+
+  LocalVector<Value> rows(isolate);
+  LocalVector<Value> values(isolate);
+  values.reserve(num_cols);
+  for (size_t start = 0; num_cols > 0 && start < job->cells.size();
+       start += num_cols) {
+    values.clear();
+    for (size_t i = 0; i < num_cols; ++i) {
+      Local<Value> value;
+      if (!ToValue(job->cells[start + i], i).ToLocal(&value)) {
+        return MaybeLocal<Value>();
+      }
+      values.emplace_back(value);
+    }
+    rows.emplace_back(Object::New(
+        isolate, Null(isolate), names.data(), values.data(), num_cols));
+  }
+
+  if (job->type == Job::kGet) {
+    return rows.empty() ? Undefined(isolate).As<Value>() : rows[0];
+  }
+  return Array::New(isolate, rows.data(), rows.size());
+}
+
+void Database::OnJobsDone(uv_async_t* handle) {
+  Database* db = static_cast<Database*>(handle->data);
+  std::deque<std::unique_ptr<Job>> done;
+  {
+    Mutex::ScopedLock lock(db->mutex_);
+    done.swap(db->done_);
+  }
+  if (done.empty()) return;
+
+  Environment* env = db->env();
+  Isolate* isolate = env->isolate();
+  if (!env->can_call_into_js()) return;
+  {
+    HandleScope scope(isolate);
+    Local<Context> context = env->context();
+    Context::Scope context_scope(context);
+    InternalCallbackScope callback_scope(env, db->object(), {0, 0});
+    for (const std::unique_ptr<Job>& job : done) {
+      Local<Promise::Resolver> resolver = job->resolver.Get(isolate);
+      if (job->invalid_state) {
+        USE(resolver->Reject(
+            context, ERR_INVALID_STATE(isolate, "%s", job->errmsg)));
+      } else if (job->errcode != SQLITE_OK) {
+        USE(resolver->Reject(
+            context,
+            CreateSQLiteError(isolate, job->errcode, job->errmsg.c_str())));
+      } else {
+        errors::TryCatchScope try_catch(env);
+        Local<Value> value;
+        if (db->Settle(job.get()).ToLocal(&value)) {
+          USE(resolver->Resolve(context, value));
+        } else if (try_catch.HasCaught() && !try_catch.HasTerminated()) {
+          USE(resolver->Reject(context, try_catch.Exception()));
+        }
+      }
+    }
+  }
+
+  db->jobs_in_flight_ -= done.size();
+  if (db->jobs_in_flight_ == 0) {
+    uv_unref(reinterpret_cast<uv_handle_t*>(db->async_));
+    db->MakeWeak();
+  }
 }
 
 static void Initialize(Local<Object> target,
@@ -726,11 +2562,29 @@ static void Initialize(Local<Object> target,
   SetProtoMethod(isolate, db_tmpl, "close", DatabaseSync::Close);
   SetProtoMethod(isolate, db_tmpl, "prepare", DatabaseSync::Prepare);
   SetProtoMethod(isolate, db_tmpl, "exec", DatabaseSync::Exec);
+  SetProtoMethod(isolate, db_tmpl, "function", DatabaseSync::CustomFunction);
+  SetProtoMethod(
+      isolate, db_tmpl, "aggregate", DatabaseSync::AggregateFunction);
+  SetProtoMethod(isolate,
+                 db_tmpl,
+                 "getStatementCacheStats",
+                 DatabaseSync::GetStatementCacheStats);
   SetConstructorFunction(context, target, "DatabaseSync", db_tmpl);
   SetConstructorFunction(context,
                          target,
                          "StatementSync",
                          StatementSync::GetConstructorTemplate(env));
+
+  Local<FunctionTemplate> async_db_tmpl =
+      NewFunctionTemplate(isolate, Database::New);
+  async_db_tmpl->InstanceTemplate()->SetInternalFieldCount(
+      Database::kInternalFieldCount);
+  SetProtoMethod(isolate, async_db_tmpl, "exec", Database::Exec);
+  SetProtoMethod(isolate, async_db_tmpl, "run", Database::Run);
+  SetProtoMethod(isolate, async_db_tmpl, "get", Database::Get);
+  SetProtoMethod(isolate, async_db_tmpl, "all", Database::All);
+  SetProtoMethod(isolate, async_db_tmpl, "close", Database::Close);
+  SetConstructorFunction(context, target, "Database", async_db_tmpl);
 }
 
 }  // namespace sqlite
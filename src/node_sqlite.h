@@ -4,30 +4,63 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "base_object.h"
+#include "cppgc_helpers.h"
 #include "node_mem.h"
+#include "node_mutex.h"
 #include "sqlite3.h"
 #include "util.h"
+#include "uv.h"
 
+#include <deque>
+#include <list>
 #include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
+#include <variant>
+#include <vector>
 
 namespace node {
 namespace sqlite {
 
 class StatementSync;
 
+// A strong reference to a StatementSync from native code, which keeps its
+// JavaScript object, and through it the statement, alive.
+class StatementSyncRef {
+ public:
+  StatementSyncRef() = default;
+  explicit StatementSyncRef(StatementSync* stmt);
+
+  StatementSync* get() const { return stmt_; }
+  StatementSync* operator->() const { return stmt_; }
+  explicit operator bool() const { return stmt_ != nullptr; }
+
+ private:
+  StatementSync* stmt_ = nullptr;
+  v8::Global<v8::Object> object_;
+};
+
 class DatabaseSync : public BaseObject {
  public:
   DatabaseSync(Environment* env,
                v8::Local<v8::Object> object,
                v8::Local<v8::String> location,
-               bool open);
+               bool open,
+               size_t statement_cache_size);
   void MemoryInfo(MemoryTracker* tracker) const override;
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Open(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Close(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Prepare(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Exec(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void CustomFunction(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void AggregateFunction(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetStatementCacheStats(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
   void FinalizeStatements();
   void UntrackStatement(StatementSync* statement);
   bool IsOpen();
@@ -37,51 +70,230 @@ class DatabaseSync : public BaseObject {
   SET_SELF_SIZE(DatabaseSync)
 
  private:
+  using StatementCacheEntry = std::pair<std::string, StatementSyncRef>;
+
   bool Open();
+  // Returns the cached statement for |sql| after resetting it, or nullptr.
+  StatementSync* TakeCachedStatement(std::string_view sql);
+  void CacheStatement(std::string&& sql, StatementSync* stmt);
 
   ~DatabaseSync() override;
   std::string location_;
   sqlite3* connection_;
   std::unordered_set<StatementSync*> statements_;
+  // An LRU of the statements returned by prepare(), most recently used
+  // first. Cached statements are kept alive by the cache until they are
+  // evicted or the database is closed.
+  const size_t statement_cache_size_;
+  std::list<StatementCacheEntry> statement_cache_;
+  std::unordered_map<std::string_view, std::list<StatementCacheEntry>::iterator>
+      statement_cache_index_;
+  uint64_t statement_cache_hits_ = 0;
+  uint64_t statement_cache_misses_ = 0;
 };
 
-class StatementSync : public BaseObject {
+// Managed by cppgc rather than as a BaseObject, as applications can hold
+// many thousands of prepared statements, which would otherwise each cost a
+// weak global handle and a weak callback on every GC.
+class StatementSync final : public cppgc::GarbageCollected<StatementSync>,
+                            public cppgc::NameProvider,
+                            public CppgcMixin {
  public:
+  SET_CPPGC_NAME(StatementSync)
+
   StatementSync(Environment* env,
                 v8::Local<v8::Object> object,
                 DatabaseSync* db,
                 sqlite3_stmt* stmt);
-  void MemoryInfo(MemoryTracker* tracker) const override;
+  ~StatementSync();
+  void Trace(cppgc::Visitor* visitor) const final;
   static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
       Environment* env);
-  static BaseObjectPtr<StatementSync> Create(Environment* env,
-                                             DatabaseSync* db,
-                                             sqlite3_stmt* stmt);
+  static StatementSync* Create(Environment* env,
+                               DatabaseSync* db,
+                               sqlite3_stmt* stmt);
   static void All(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Get(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Iterate(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Run(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void RunMany(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SourceSQL(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void ExpandedSQL(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetAllowBareNamedParameters(
       const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetReadBigInts(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetResultMode(const v8::FunctionCallbackInfo<v8::Value>& args);
   void Finalize();
   bool IsFinalized();
 
-  SET_MEMORY_INFO_NAME(StatementSync)
-  SET_SELF_SIZE(StatementSync)
-
  private:
-  ~StatementSync() override;
+  // How rows are returned, see setResultMode().
+  enum class ResultMode : uint8_t {
+    // An object with a null prototype per row.
+    kObject,
+    // An array of the column values per row.
+    kArray,
+    // An object per row, created from a v8::DictionaryTemplate of the
+    // column names, so that all rows share one map and are in fast mode.
+    kTemplate,
+    // all() returns an object with one array per column. Columns that only
+    // hold numbers are returned as typed arrays. get() and iterate() return
+    // rows like kObject.
+    kColumnar,
+  };
+
   DatabaseSync* db_;
   sqlite3_stmt* statement_;
   bool use_big_ints_;
   bool allow_bare_named_params_;
   std::optional<std::map<std::string, std::string>> bare_named_params_;
+  // Incremented whenever the statement is reset, which invalidates the
+  // iterators that were stepping it.
+  uint64_t reset_generation_ = 0;
+  ResultMode result_mode_ = ResultMode::kObject;
+  v8::TracedReference<v8::DictionaryTemplate> row_template_;
+  std::vector<std::string> row_template_names_;
+  // The reset generation for which the column names were last checked
+  // against row_template_names_.
+  uint64_t row_template_generation_ = 0;
+  int Reset();
   bool BindParams(const v8::FunctionCallbackInfo<v8::Value>& args);
+  bool BindNamedParams(v8::Local<v8::Object> obj);
+  // Binds |value| to the first anonymous parameter at or after |anon_idx|,
+  // and advances |anon_idx| past it.
+  bool BindAnonymousParam(v8::Local<v8::Value> value, int* anon_idx);
+  // Returns the index of the parameter called |key|, or 0 after throwing.
+  int NamedParamIndex(v8::Local<v8::Value> key);
+  // A column of a columnar runMany() batch.
+  struct BatchColumn;
+  // Binds the |row|th value of each column of a columnar batch.
+  bool BindColumnarRow(const std::vector<BatchColumn>& columns, uint32_t row);
   bool BindValue(const v8::Local<v8::Value>& value, const int index);
   v8::MaybeLocal<v8::Value> ColumnToValue(const int column);
   v8::MaybeLocal<v8::Name> ColumnNameToName(const int column);
+  bool ColumnNames(v8::LocalVector<v8::Name>* names);
+  // Reads the current row in the result mode. In the object modes, |names|
+  // is filled with the column names if it is empty, so that it can be
+  // reused for the next rows.
+  v8::MaybeLocal<v8::Value> ReadRow(v8::LocalVector<v8::Name>* names);
+  v8::MaybeLocal<v8::DictionaryTemplate> RowTemplate();
+  // Steps the statement to completion, for all() in the columnar mode.
+  v8::MaybeLocal<v8::Object> ReadColumns();
+
+  friend class DatabaseSync;
+  friend class StatementSyncIterator;
+};
+
+// Returned by statement.iterate(). Steps the statement on demand, so that
+// only the rows that JavaScript holds on to are kept in the heap, however
+// large the result set is.
+class StatementSyncIterator : public BaseObject {
+ public:
+  StatementSyncIterator(Environment* env,
+                        v8::Local<v8::Object> object,
+                        StatementSync* stmt);
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
+      Environment* env);
+  static BaseObjectPtr<StatementSyncIterator> Create(
+      Environment* env, StatementSync* stmt);
+  // next(): returns an iterator result for the next row.
+  static void Next(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // nextBatch(size): returns an array of up to |size| rows, which is empty
+  // once the result set is exhausted.
+  static void NextBatch(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // return(): stops the iteration and resets the statement.
+  static void Return(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  SET_MEMORY_INFO_NAME(StatementSyncIterator)
+  SET_SELF_SIZE(StatementSyncIterator)
+
+ private:
+  ~StatementSyncIterator() override;
+  // Steps the statement once. Returns false if an exception is pending,
+  // and sets |row| to an empty handle when the result set is exhausted.
+  bool Step(v8::Local<v8::Value>* row);
+  void Finish();
+
+  StatementSyncRef stmt_;
+  uint64_t generation_;
+  bool done_ = false;
+  // The column names, looked up once for all rows.
+  std::vector<v8::Global<v8::Name>> column_names_;
+};
+
+// A value that is passed between JavaScript and a Database thread: NULL,
+// INTEGER, FLOAT, TEXT or BLOB.
+using SQLiteValue = std::variant<std::monostate,
+                                 int64_t,
+                                 double,
+                                 std::string,
+                                 std::vector<uint8_t>>;
+
+// The asynchronous counterpart of DatabaseSync. The connection is owned by
+// a thread of the database, which runs the queries in the order they were
+// made, so that slow queries and checkpoints do not block the event loop.
+// Parameters are converted to SQLiteValues before they are queued, and
+// results are converted back to JavaScript values when the promise of the
+// query is settled.
+class Database : public BaseObject {
+ public:
+  Database(Environment* env,
+           v8::Local<v8::Object> object,
+           std::string location,
+           bool read_only,
+           bool use_big_ints);
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // exec(sql), run(sql, ...params), get(sql, ...params), all(sql, ...params)
+  // and close() return promises.
+  static void Exec(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Run(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Get(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void All(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Close(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  SET_MEMORY_INFO_NAME(Database)
+  SET_SELF_SIZE(Database)
+
+ private:
+  struct Job;
+
+  // Prepared statements are kept for reuse, up to this many.
+  static constexpr size_t kMaxCachedStatements = 128;
+
+  ~Database() override;
+  static void Enqueue(const v8::FunctionCallbackInfo<v8::Value>& args,
+                      int type);
+  static void ThreadMain(void* data);
+  static void OnJobsDone(uv_async_t* handle);
+  void Execute(Job* job);
+  bool Bind(Job* job, sqlite3_stmt* stmt);
+  v8::MaybeLocal<v8::Value> ToValue(const SQLiteValue& value, int column);
+  v8::MaybeLocal<v8::Value> Settle(Job* job);
+
+  const std::string location_;
+  const bool read_only_;
+  const bool use_big_ints_;
+  bool closed_ = false;
+  size_t jobs_in_flight_ = 0;
+  uv_async_t* async_;
+  uv_thread_t thread_;
+
+  Mutex mutex_;
+  ConditionVariable cond_;
+  // Guarded by mutex_.
+  std::deque<std::unique_ptr<Job>> pending_;
+  std::deque<std::unique_ptr<Job>> done_;
+  bool stopping_ = false;
+  // Written by the database thread under mutex_, so that queries can be
+  // interrupted at teardown.
+  sqlite3* connection_ = nullptr;
+
+  // Only used on the database thread.
+  int open_errcode_ = SQLITE_OK;
+  std::string open_errmsg_;
+  std::unordered_map<std::string, sqlite3_stmt*> statements_;
 };
 
 }  // namespace sqlite
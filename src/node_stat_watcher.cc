@@ -25,9 +25,11 @@
 #include "memory_tracker-inl.h"
 #include "node_external_reference.h"
 #include "node_file-inl.h"
+#include "node_options.h"
 #include "permission/permission.h"
 #include "util-inl.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 
@@ -45,6 +47,10 @@ using v8::ObjectTemplate;
 using v8::Uint32;
 using v8::Value;
 
+// In event mode the poll handle only backs up the notifications, so it runs
+// at least this rarely (in milliseconds).
+constexpr uint32_t kEventModePollInterval = 5 * 60 * 1000;
+
 void StatWatcher::CreatePerIsolateProperties(IsolateData* isolate_data,
                                              Local<ObjectTemplate> target) {
   Isolate* isolate = isolate_data->isolate();
@@ -82,17 +88,176 @@ void StatWatcher::Callback(uv_fs_poll_t* handle,
                            const uv_stat_t* prev,
                            const uv_stat_t* curr) {
   StatWatcher* wrap = ContainerOf(&StatWatcher::watcher_, handle);
-  Environment* env = wrap->env();
-  HandleScope handle_scope(env->isolate());
-  Context::Scope context_scope(env->context());
+  if (wrap->event_watcher_ != nullptr) {
+    // The notifications may already have reported this change.
+    wrap->ReportIfChanged(status, curr);
+    return;
+  }
+  wrap->Emit(status, prev, curr);
+}
+
+void StatWatcher::Emit(int status,
+                       const uv_stat_t* prev,
+                       const uv_stat_t* curr) {
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+
+  Local<Value> arr =
+      fs::FillGlobalStatsArray(binding_data_.get(), use_bigint_, curr);
+  USE(fs::FillGlobalStatsArray(binding_data_.get(), use_bigint_, prev, true));
+
+  Local<Value> argv[2] = { Integer::New(env()->isolate(), status), arr };
+  MakeCallback(env()->onchange_string(), arraysize(argv), argv);
+}
+
+// Compares the same fields as libuv's fs poll watcher does.
+static bool StatEqual(const uv_stat_t& a, const uv_stat_t& b) {
+  return a.st_ctim.tv_nsec == b.st_ctim.tv_nsec &&
+         a.st_mtim.tv_nsec == b.st_mtim.tv_nsec &&
+         a.st_birthtim.tv_nsec == b.st_birthtim.tv_nsec &&
+         a.st_ctim.tv_sec == b.st_ctim.tv_sec &&
+         a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+         a.st_birthtim.tv_sec == b.st_birthtim.tv_sec &&
+         a.st_size == b.st_size && a.st_mode == b.st_mode &&
+         a.st_uid == b.st_uid && a.st_gid == b.st_gid &&
+         a.st_ino == b.st_ino && a.st_dev == b.st_dev &&
+         a.st_flags == b.st_flags && a.st_gen == b.st_gen;
+}
+
+void StatWatcher::ReportIfChanged(int status, const uv_stat_t* curr) {
+  uv_stat_t zero_stat = {};
+  if (status < 0) curr = &zero_stat;
+
+  if (!have_last_) {
+    have_last_ = true;
+    last_status_ = status;
+    last_stat_ = *curr;
+    return;
+  }
+  if (status == last_status_ && StatEqual(*curr, last_stat_)) return;
+
+  uv_stat_t prev = last_stat_;
+  last_status_ = status;
+  last_stat_ = *curr;
+  Emit(status, &prev, curr);
+}
+
+bool StatWatcher::StartEvents(const std::string& path) {
+#ifdef _WIN32
+  size_t separator = path.find_last_of("\\/");
+#else
+  size_t separator = path.rfind('/');
+#endif
+  std::string dirname;
+  if (separator == std::string::npos) {
+    dirname = ".";
+    basename_ = path;
+  } else {
+    dirname = separator == 0 ? path.substr(0, 1) : path.substr(0, separator);
+    basename_ = path.substr(separator + 1);
+  }
+  if (basename_.empty()) return false;
+
+#ifdef __linux__
+  // Notifications do not cover changes made by other hosts, so network file
+  // systems keep being polled at the requested interval.
+  uv_fs_t statfs_req;
+  int err = uv_fs_statfs(nullptr, &statfs_req, dirname.c_str(), nullptr);
+  if (err == 0) {
+    const uint64_t type =
+        static_cast<const uv_statfs_t*>(statfs_req.ptr)->f_type;
+    switch (type) {
+      case 0x6969:        // NFS
+      case 0x517B:        // SMB
+      case 0xFF534D42:    // CIFS
+      case 0xFE534D42:    // SMB2
+      case 0x01021997:    // 9P
+      case 0x5346414F:    // AFS
+      case 0x00C36400:    // Ceph
+      case 0x65735546:    // FUSE
+        err = UV_ENOTSUP;
+        break;
+    }
+  }
+  uv_fs_req_cleanup(&statfs_req);
+  if (err != 0) return false;
+#endif
 
-  Local<Value> arr = fs::FillGlobalStatsArray(
-      wrap->binding_data_.get(), wrap->use_bigint_, curr);
-  USE(fs::FillGlobalStatsArray(
-      wrap->binding_data_.get(), wrap->use_bigint_, prev, true));
+  auto* handle = new uv_fs_event_t;
+  if (uv_fs_event_init(env()->event_loop(), handle) != 0) {
+    delete handle;
+    return false;
+  }
+  handle->data = this;
+  auto close_handle = [](uv_handle_t* handle) {
+    delete reinterpret_cast<uv_fs_event_t*>(handle);
+  };
+  if (uv_fs_event_start(handle, OnEvent, dirname.c_str(), 0) != 0) {
+    uv_close(reinterpret_cast<uv_handle_t*>(handle), close_handle);
+    return false;
+  }
+  // watcher_ decides whether the loop is kept alive.
+  uv_unref(reinterpret_cast<uv_handle_t*>(handle));
+
+  event_watcher_ = handle;
+  path_ = path;
+  // Record the state that later changes are compared against.
+  StatAfterEvent();
+  return true;
+}
+
+void StatWatcher::OnEvent(uv_fs_event_t* handle,
+                          const char* filename,
+                          int events,
+                          int status) {
+  StatWatcher* wrap = static_cast<StatWatcher*>(handle->data);
+  if (wrap == nullptr) return;
+  if (status == 0 && filename != nullptr && wrap->basename_ != filename)
+    return;
+  wrap->StatAfterEvent();
+}
+
+void StatWatcher::StatAfterEvent() {
+  if (IsHandleClosing()) return;
+  if (stat_in_flight_) {
+    stat_again_ = true;
+    return;
+  }
+  int err = uv_fs_stat(
+      env()->event_loop(), &stat_req_, path_.c_str(), AfterEventStat);
+  if (err != 0) return;
+  stat_in_flight_ = true;
+  stat_keepalive_.reset(this);
+}
 
-  Local<Value> argv[2] = { Integer::New(env->isolate(), status), arr };
-  wrap->MakeCallback(env->onchange_string(), arraysize(argv), argv);
+void StatWatcher::AfterEventStat(uv_fs_t* req) {
+  StatWatcher* wrap = ContainerOf(&StatWatcher::stat_req_, req);
+  BaseObjectPtr<StatWatcher> keepalive = std::move(wrap->stat_keepalive_);
+  wrap->stat_in_flight_ = false;
+
+  const int status = static_cast<int>(req->result);
+  const uv_stat_t statbuf = req->statbuf;
+  uv_fs_req_cleanup(req);
+
+  if (wrap->IsHandleClosing() || !wrap->env()->can_call_into_js()) return;
+  wrap->ReportIfChanged(status < 0 ? status : 0, &statbuf);
+
+  if (wrap->stat_again_) {
+    wrap->stat_again_ = false;
+    wrap->StatAfterEvent();
+  }
+}
+
+void StatWatcher::Close(Local<Value> close_callback) {
+  if (event_watcher_ != nullptr) {
+    event_watcher_->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t*>(event_watcher_),
+             [](uv_handle_t* handle) {
+               delete reinterpret_cast<uv_fs_event_t*>(handle);
+             });
+    event_watcher_ = nullptr;
+  }
+  HandleWrap::Close(close_callback);
 }
 
 
@@ -102,9 +267,9 @@ void StatWatcher::New(const FunctionCallbackInfo<Value>& args) {
   new StatWatcher(binding_data, args.This(), args[0]->IsTrue());
 }
 
-// wrap.start(filename, interval)
+// wrap.start(filename, interval[, useEvents])
 void StatWatcher::Start(const FunctionCallbackInfo<Value>& args) {
-  CHECK_EQ(args.Length(), 2);
+  CHECK_GE(args.Length(), 2);
 
   StatWatcher* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
@@ -118,7 +283,17 @@ void StatWatcher::Start(const FunctionCallbackInfo<Value>& args) {
       path.ToStringView());
 
   CHECK(args[1]->IsUint32());
-  const uint32_t interval = args[1].As<Uint32>()->Value();
+  uint32_t interval = args[1].As<Uint32>()->Value();
+
+  bool use_events;
+  if (args.Length() > 2 && !args[2]->IsUndefined()) {
+    use_events = args[2]->IsTrue();
+  } else {
+    Mutex::ScopedLock lock(per_process::cli_options_mutex);
+    use_events = per_process::cli_options->experimental_watch_file_events;
+  }
+  if (use_events && wrap->StartEvents(*path))
+    interval = std::max(interval, kEventModePollInterval);
 
   // Note that uv_fs_poll_start does not return ENOENT, we are handling
   // mostly memory errors here.
@@ -24,6 +24,7 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <string>
 #include "node.h"
 #include "handle_wrap.h"
 #include "uv.h"
@@ -51,6 +52,9 @@ class StatWatcher : public HandleWrap {
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(StatWatcher)
   SET_SELF_SIZE(StatWatcher)
@@ -60,10 +64,37 @@ class StatWatcher : public HandleWrap {
                        int status,
                        const uv_stat_t* prev,
                        const uv_stat_t* curr);
+  void Emit(int status, const uv_stat_t* prev, const uv_stat_t* curr);
+
+  // In event mode the parent directory is watched for notifications about
+  // the file, which is then stat()ed and reported if it changed. The poll
+  // handle keeps running at a long interval to catch missed notifications
+  // and to carry the ref state of the watcher.
+  bool StartEvents(const std::string& path);
+  static void OnEvent(uv_fs_event_t* handle,
+                      const char* filename,
+                      int events,
+                      int status);
+  void StatAfterEvent();
+  static void AfterEventStat(uv_fs_t* req);
+  void ReportIfChanged(int status, const uv_stat_t* curr);
 
   uv_fs_poll_t watcher_;
   const bool use_bigint_;
   BaseObjectPtr<fs::BindingData> binding_data_;
+
+  // Allocated separately because it is closed independently of watcher_.
+  uv_fs_event_t* event_watcher_ = nullptr;
+  std::string path_;
+  std::string basename_;
+  uv_fs_t stat_req_;
+  bool stat_in_flight_ = false;
+  bool stat_again_ = false;
+  BaseObjectPtr<StatWatcher> stat_keepalive_;
+  // The last state reported to JS, or seen first, in event mode.
+  bool have_last_ = false;
+  int last_status_ = 0;
+  uv_stat_t last_stat_;
 };
 
 }  // namespace node
@@ -274,6 +274,119 @@ void BindingData::Parse(const FunctionCallbackInfo<Value>& args) {
       ToV8Value(realm->context(), out->get_href(), isolate).ToLocalChecked());
 }
 
+namespace {
+
+// Writes the status, the href offset and the components of |url| to |out|.
+void WriteBatchEntry(uint32_t* out,
+                     const ada::url_aggregator& url,
+                     bool unchanged,
+                     uint32_t href_start) {
+  const ada::url_components& components = url.get_components();
+  out[0] = unchanged ? BindingData::kURLBatchUnchanged
+                     : BindingData::kURLBatchNormalized;
+  out[1] = href_start;
+  out[2] = components.protocol_end;
+  out[3] = components.username_end;
+  out[4] = components.host_start;
+  out[5] = components.host_end;
+  out[6] = components.port;
+  out[7] = components.pathname_start;
+  out[8] = components.search_start;
+  out[9] = components.hash_start;
+  out[10] = url.type;
+  static_assert(BindingData::kURLBatchStride == 11,
+                "kURLBatchStride should be up-to-date");
+}
+
+}  // namespace
+
+// parseBatch(input, out, base, withHrefs) parses many URLs in one call.
+// |input| is an array of strings, or a buffer of newline-delimited URLs.
+// For every input, kURLBatchStride values are written to the Uint32Array
+// |out|, which bounds the number of inputs that are parsed. Returns that
+// number. If |withHrefs| is true, returns [count, hrefs] instead, where
+// hrefs joins the normalized hrefs of all valid inputs with newlines.
+void BindingData::ParseBatch(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsArray() || args[0]->IsArrayBufferView());  // input
+  CHECK(args[1]->IsUint32Array());                            // out
+  // args[2] // base url
+  const bool with_hrefs = args[3]->IsTrue();
+
+  Realm* realm = Realm::GetCurrent(args);
+  Isolate* isolate = realm->isolate();
+  Local<Context> context = realm->context();
+
+  ada::result<ada::url_aggregator> base;
+  ada::url_aggregator* base_pointer = nullptr;
+  if (args[2]->IsString()) {
+    base = ada::parse<ada::url_aggregator>(
+        Utf8Value(isolate, args[2]).ToStringView());
+    if (!base) return;
+    base_pointer = &base.value();
+  }
+
+  Local<v8::Uint32Array> out_array = args[1].As<v8::Uint32Array>();
+  uint32_t* out = reinterpret_cast<uint32_t*>(
+      static_cast<char*>(out_array->Buffer()->Data()) +
+      out_array->ByteOffset());
+  const size_t capacity = out_array->Length() / kURLBatchStride;
+
+  std::string hrefs;
+  size_t count = 0;
+  auto parse_one = [&](std::string_view input) {
+    uint32_t* entry = out + count * kURLBatchStride;
+    count++;
+    auto url = ada::parse<ada::url_aggregator>(input, base_pointer);
+    if (!url) {
+      std::fill_n(entry, kURLBatchStride, 0);
+      return;
+    }
+    const std::string_view href = url->get_href();
+    uint32_t href_start = 0;
+    if (with_hrefs) {
+      if (!hrefs.empty()) hrefs += '\n';
+      href_start = static_cast<uint32_t>(hrefs.size());
+      hrefs += href;
+    }
+    WriteBatchEntry(entry, *url, href == input, href_start);
+  };
+
+  if (args[0]->IsArray()) {
+    Local<v8::Array> inputs = args[0].As<v8::Array>();
+    const size_t length = std::min<size_t>(inputs->Length(), capacity);
+    for (uint32_t i = 0; i < length; i++) {
+      Local<Value> value;
+      if (!inputs->Get(context, i).ToLocal(&value)) return;
+      if (!value->IsString()) {
+        std::fill_n(out + count++ * kURLBatchStride, kURLBatchStride, 0);
+        continue;
+      }
+      parse_one(Utf8Value(isolate, value).ToStringView());
+    }
+  } else {
+    ArrayBufferViewContents<char> buffer(args[0]);
+    std::string_view rest(buffer.data(), buffer.length());
+    while (!rest.empty() && count < capacity) {
+      size_t end = rest.find('\n');
+      std::string_view line = rest.substr(0, end);
+      rest = end == std::string_view::npos ? std::string_view()
+                                           : rest.substr(end + 1);
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+      parse_one(line);
+    }
+  }
+
+  Local<Value> result = v8::Integer::NewFromUnsigned(
+      isolate, static_cast<uint32_t>(count));
+  if (with_hrefs) {
+    Local<Value> hrefs_string;
+    if (!ToV8Value(context, hrefs, isolate).ToLocal(&hrefs_string)) return;
+    Local<Value> pair[] = {result, hrefs_string};
+    result = v8::Array::New(isolate, pair, arraysize(pair));
+  }
+  args.GetReturnValue().Set(result);
+}
+
 void BindingData::Update(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsString());    // href
   CHECK(args[1]->IsNumber());    // action type
@@ -371,6 +484,7 @@ void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
   SetMethodNoSideEffect(isolate, target, "format", Format);
   SetMethodNoSideEffect(isolate, target, "getOrigin", GetOrigin);
   SetMethod(isolate, target, "parse", Parse);
+  SetMethod(isolate, target, "parseBatch", ParseBatch);
   SetMethod(isolate, target, "update", Update);
   SetFastMethodNoSideEffect(
       isolate, target, "canParse", CanParse, {fast_can_parse_methods_, 2});
@@ -391,6 +505,7 @@ void BindingData::RegisterExternalReferences(
   registry->Register(Format);
   registry->Register(GetOrigin);
   registry->Register(Parse);
+  registry->Register(ParseBatch);
   registry->Register(Update);
   registry->Register(CanParse);
   registry->Register(FastCanParse);
@@ -59,6 +59,7 @@ class BindingData : public SnapshotableObject {
   static void Format(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void GetOrigin(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Parse(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void ParseBatch(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Update(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   static void CreatePerIsolateProperties(IsolateData* isolate_data,
@@ -69,8 +70,18 @@ class BindingData : public SnapshotableObject {
                                          void* priv);
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
 
- private:
   static constexpr size_t kURLComponentsLength = 9;
+  // parseBatch() writes this many Uint32 values per input: a status, the
+  // offset of the href in the joined hrefs, and the url_components.
+  static constexpr size_t kURLBatchStride = kURLComponentsLength + 2;
+  enum URLBatchStatus : uint32_t {
+    kURLBatchInvalid = 0,
+    // The href is the input itself, so the caller can slice the input.
+    kURLBatchUnchanged = 1,
+    kURLBatchNormalized = 2,
+  };
+
+ private:
   AliasedUint32Array url_components_buffer_;
 
   void UpdateComponents(const ada::url_components& components,
@@ -0,0 +1,824 @@
+#include "node_url_pattern.h"
+#include "ada.h"
+#include "base_object-inl.h"
+#include "env-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A native URLPattern. Pattern strings are compiled into regular expressions
+// as the URLPattern specification describes, and the URLs to match are
+// parsed with ada.
+//
+// A URLPatternList holds many patterns and matches a URL against all of them
+// in a single call, parsing the URL and creating its component strings only
+// once. Components that are `*` or contain no groups, and the literal text
+// that a pattern starts with, are checked without running a regular
+// expression, so that most patterns of a router are ruled out cheaply.
+//
+// Constructor strings such as "https://*.example.com/:id" are split into
+// their components in JavaScript; the binding takes the components.
+
+namespace node {
+namespace url_pattern {
+
+using v8::Array;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Global;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::RegExp;
+using v8::String;
+using v8::Value;
+
+namespace {
+
+enum Component {
+  kProtocol,
+  kUsername,
+  kPassword,
+  kHostname,
+  kPort,
+  kPathname,
+  kSearch,
+  kHash,
+  kComponentCount,
+};
+
+constexpr const char* kComponentNames[kComponentCount] = {
+    "protocol",
+    "username",
+    "password",
+    "hostname",
+    "port",
+    "pathname",
+    "search",
+    "hash",
+};
+
+// The order in which components are matched. The ones that rule out most
+// patterns of a typical router cheaply come first.
+constexpr Component kMatchOrder[kComponentCount] = {
+    kProtocol,
+    kHostname,
+    kPort,
+    kPathname,
+    kSearch,
+    kHash,
+    kUsername,
+    kPassword,
+};
+
+// One part of a parsed pattern string.
+struct Part {
+  enum class Type { kFixed, kRegexp, kSegmentWildcard, kFullWildcard };
+  enum class Modifier { kNone, kOptional, kZeroOrMore, kOneOrMore };
+
+  Type type = Type::kFixed;
+  Modifier modifier = Modifier::kNone;
+  // The fixed text, or the regular expression of a kRegexp part.
+  std::string value;
+  std::string name;
+  std::string prefix;
+  std::string suffix;
+};
+
+bool IsNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+std::string EscapeRegExp(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  for (char c : text) {
+    switch (c) {
+      case '.':
+      case '+':
+      case '*':
+      case '?':
+      case '^':
+      case '$':
+      case '{':
+      case '}':
+      case '(':
+      case ')':
+      case '[':
+      case ']':
+      case '|':
+      case '/':
+      case '\\':
+        out += '\\';
+        break;
+    }
+    out += c;
+  }
+  return out;
+}
+
+const char* ModifierString(Part::Modifier modifier) {
+  switch (modifier) {
+    case Part::Modifier::kOptional:
+      return "?";
+    case Part::Modifier::kZeroOrMore:
+      return "*";
+    case Part::Modifier::kOneOrMore:
+      return "+";
+    default:
+      return "";
+  }
+}
+
+// Parses a pattern string into parts. |prefix_char| is the character that
+// becomes the prefix of a group directly following it, such as the `/` in
+// `/:id?` that is optional together with the group. Returns std::nullopt
+// and sets |error| if the pattern is invalid.
+class PatternParser {
+ public:
+  PatternParser(std::string_view pattern, char prefix_char)
+      : pattern_(pattern), prefix_char_(prefix_char) {}
+
+  std::optional<std::vector<Part>> Parse(const char** error) {
+    std::string pending;
+    while (pos_ < pattern_.size()) {
+      char c = pattern_[pos_];
+      if (c == '\\') {
+        if (pos_ + 1 >= pattern_.size()) return Fail(error, "trailing '\\'");
+        pending += pattern_[pos_ + 1];
+        pos_ += 2;
+      } else if (c == '{') {
+        FlushFixed(&pending);
+        pos_++;
+        if (!ParseGroup(error)) return std::nullopt;
+      } else if (c == ':' || c == '(' || c == '*') {
+        Part part;
+        if (!ParseMatcher(&part, error)) return std::nullopt;
+        if (prefix_char_ != '\0' && !pending.empty() &&
+            pending.back() == prefix_char_) {
+          part.prefix = std::string(1, prefix_char_);
+          pending.pop_back();
+        }
+        FlushFixed(&pending);
+        part.modifier = ParseModifier();
+        parts_.push_back(std::move(part));
+      } else {
+        pending += c;
+        pos_++;
+      }
+    }
+    FlushFixed(&pending);
+    return std::move(parts_);
+  }
+
+ private:
+  std::nullopt_t Fail(const char** error, const char* message) {
+    *error = message;
+    return std::nullopt;
+  }
+
+  void FlushFixed(std::string* pending) {
+    if (pending->empty()) return;
+    Part part;
+    part.value = std::move(*pending);
+    pending->clear();
+    parts_.push_back(std::move(part));
+  }
+
+  Part::Modifier ParseModifier() {
+    if (pos_ >= pattern_.size()) return Part::Modifier::kNone;
+    switch (pattern_[pos_]) {
+      case '?':
+        pos_++;
+        return Part::Modifier::kOptional;
+      case '*':
+        pos_++;
+        return Part::Modifier::kZeroOrMore;
+      case '+':
+        pos_++;
+        return Part::Modifier::kOneOrMore;
+      default:
+        return Part::Modifier::kNone;
+    }
+  }
+
+  // Parses `:name`, `:name(regexp)`, `(regexp)` or `*` at pos_.
+  bool ParseMatcher(Part* part, const char** error) {
+    if (pattern_[pos_] == '*') {
+      pos_++;
+      part->type = Part::Type::kFullWildcard;
+      part->name = std::to_string(next_index_++);
+      return true;
+    }
+    if (pattern_[pos_] == ':') {
+      size_t start = ++pos_;
+      while (pos_ < pattern_.size() && IsNameChar(pattern_[pos_])) pos_++;
+      if (pos_ == start) {
+        *error = "missing group name";
+        return false;
+      }
+      part->name = std::string(pattern_.substr(start, pos_ - start));
+      part->type = Part::Type::kSegmentWildcard;
+      if (pos_ >= pattern_.size() || pattern_[pos_] != '(') return true;
+    } else {
+      part->name = std::to_string(next_index_++);
+    }
+    part->type = Part::Type::kRegexp;
+    return ParseRegExp(&part->value, error);
+  }
+
+  // Reads the balanced `(...)` at pos_ into |out|, without the parentheses.
+  bool ParseRegExp(std::string* out, const char** error) {
+    int depth = 1;
+    size_t start = ++pos_;
+    while (pos_ < pattern_.size()) {
+      char c = pattern_[pos_];
+      if (c == '\\') {
+        pos_ += 2;
+        continue;
+      }
+      if (c == '(') {
+        // Capturing groups would shift the indices of the named groups.
+        if (pos_ + 1 >= pattern_.size() || pattern_[pos_ + 1] != '?') {
+          *error = "capturing groups are not allowed";
+          return false;
+        }
+        depth++;
+      } else if (c == ')' && --depth == 0) {
+        *out = std::string(pattern_.substr(start, pos_ - start));
+        pos_++;
+        if (out->empty()) {
+          *error = "empty regular expression";
+          return false;
+        }
+        return true;
+      }
+      pos_++;
+    }
+    *error = "unbalanced regular expression";
+    return false;
+  }
+
+  // Parses `{prefix matcher suffix}modifier` after the opening brace.
+  bool ParseGroup(const char** error) {
+    std::string prefix;
+    std::string suffix;
+    std::optional<Part> matcher;
+    while (true) {
+      if (pos_ >= pattern_.size()) {
+        *error = "missing '}'";
+        return false;
+      }
+      char c = pattern_[pos_];
+      if (c == '}') {
+        pos_++;
+        break;
+      }
+      if (c == '{') {
+        *error = "nested groups are not allowed";
+        return false;
+      }
+      if (c == ':' || c == '(' || c == '*') {
+        if (matcher.has_value()) {
+          *error = "a group can hold a single matcher";
+          return false;
+        }
+        matcher.emplace();
+        if (!ParseMatcher(&*matcher, error)) return false;
+        continue;
+      }
+      if (c == '\\') {
+        if (pos_ + 1 >= pattern_.size()) {
+          *error = "trailing '\\'";
+          return false;
+        }
+        c = pattern_[++pos_];
+      }
+      (matcher.has_value() ? suffix : prefix) += c;
+      pos_++;
+    }
+
+    Part part;
+    if (matcher.has_value()) {
+      part = std::move(*matcher);
+      part.prefix = std::move(prefix);
+      part.suffix = std::move(suffix);
+    } else {
+      part.value = std::move(prefix);
+    }
+    part.modifier = ParseModifier();
+    if (part.type == Part::Type::kFixed && part.value.empty()) return true;
+    parts_.push_back(std::move(part));
+    return true;
+  }
+
+  std::string_view pattern_;
+  const char prefix_char_;
+  size_t pos_ = 0;
+  int next_index_ = 0;
+  std::vector<Part> parts_;
+};
+
+struct CompiledComponent {
+  std::string pattern;
+  std::vector<std::string> names;
+  // Set if the pattern is `*`, which matches everything.
+  bool matches_everything = false;
+  // Set if the pattern has no groups and matches |literal| only.
+  bool is_literal = false;
+  std::string literal;
+  // Text that every match starts with.
+  std::string literal_prefix;
+  Global<RegExp> regexp;
+};
+
+// Follows "generate a regular expression and name list" of the spec.
+std::string GenerateRegExp(const std::vector<Part>& parts,
+                           char delimiter,
+                           std::vector<std::string>* names) {
+  const std::string segment_wildcard =
+      delimiter == '\0'
+          ? std::string("[^]+?")
+          : "[^" + EscapeRegExp(std::string_view(&delimiter, 1)) + "]+?";
+  std::string out = "^";
+  for (const Part& part : parts) {
+    const char* modifier = ModifierString(part.modifier);
+    if (part.type == Part::Type::kFixed) {
+      if (part.modifier == Part::Modifier::kNone) {
+        out += EscapeRegExp(part.value);
+      } else {
+        out += "(?:" + EscapeRegExp(part.value) + ")" + modifier;
+      }
+      continue;
+    }
+
+    names->push_back(part.name);
+    std::string value;
+    switch (part.type) {
+      case Part::Type::kSegmentWildcard:
+        value = segment_wildcard;
+        break;
+      case Part::Type::kFullWildcard:
+        value = ".*";
+        break;
+      default:
+        value = part.value;
+        break;
+    }
+    const bool single = part.modifier == Part::Modifier::kNone ||
+                        part.modifier == Part::Modifier::kOptional;
+    if (part.prefix.empty() && part.suffix.empty()) {
+      if (single) {
+        out += "(" + value + ")" + modifier;
+      } else {
+        out += "((?:" + value + ")" + modifier + ")";
+      }
+      continue;
+    }
+    const std::string prefix = EscapeRegExp(part.prefix);
+    const std::string suffix = EscapeRegExp(part.suffix);
+    if (single) {
+      out += "(?:" + prefix + "(" + value + ")" + suffix + ")" + modifier;
+    } else {
+      out += "(?:" + prefix + "((?:" + value + ")(?:" + suffix + prefix +
+             "(?:" + value + "))*)" + suffix + ")";
+      if (part.modifier == Part::Modifier::kZeroOrMore) out += "?";
+    }
+  }
+  out += "$";
+  return out;
+}
+
+// Compiles |pattern| for |component|. Returns false with a pending exception
+// if it is invalid.
+bool CompileComponent(Environment* env,
+                      Component component,
+                      std::string_view pattern,
+                      bool ignore_case,
+                      CompiledComponent* out) {
+  out->pattern = std::string(pattern);
+  if (pattern == "*") {
+    out->matches_everything = true;
+    out->names.push_back("0");
+    return true;
+  }
+
+  const char delimiter = component == kPathname   ? '/'
+                         : component == kHostname ? '.'
+                                                  : '\0';
+  const char prefix_char = component == kPathname ? '/' : '\0';
+  const char* error = nullptr;
+  std::optional<std::vector<Part>> parts =
+      PatternParser(pattern, prefix_char).Parse(&error);
+  if (!parts.has_value()) {
+    THROW_ERR_INVALID_ARG_VALUE(env,
+                                "Invalid %s pattern '%s': %s",
+                                kComponentNames[component],
+                                out->pattern,
+                                error);
+    return false;
+  }
+
+  bool all_fixed = true;
+  bool in_prefix = true;
+  for (const Part& part : *parts) {
+    const bool plain_fixed = part.type == Part::Type::kFixed &&
+                             part.modifier == Part::Modifier::kNone;
+    if (!plain_fixed) {
+      all_fixed = false;
+      in_prefix = false;
+    } else if (in_prefix) {
+      out->literal_prefix += part.value;
+    }
+  }
+  if (all_fixed && !ignore_case) {
+    out->is_literal = true;
+    out->literal = std::move(out->literal_prefix);
+    out->literal_prefix.clear();
+    return true;
+  }
+  // Case-insensitive matches can differ from the literal text.
+  if (ignore_case) out->literal_prefix.clear();
+
+  Isolate* isolate = env->isolate();
+  std::string source = GenerateRegExp(*parts, delimiter, &out->names);
+  Local<String> source_string;
+  Local<RegExp> regexp;
+  int flags = RegExp::kUnicode;
+  if (ignore_case) flags |= RegExp::kIgnoreCase;
+  if (!String::NewFromUtf8(isolate, source.data(),
+                           v8::NewStringType::kNormal,
+                           static_cast<int>(source.size()))
+           .ToLocal(&source_string) ||
+      !RegExp::New(env->context(),
+                   source_string,
+                   static_cast<RegExp::Flags>(flags))
+           .ToLocal(&regexp)) {
+    return false;
+  }
+  out->regexp.Reset(isolate, regexp);
+  return true;
+}
+
+// The components of a URL to match, with their JavaScript strings created
+// on first use so that they are shared by all patterns of a list.
+class MatchInput {
+ public:
+  // Parses |input|, either a URL string resolved against |base| or an object
+  // of components. Returns false if the URL cannot be parsed.
+  v8::Maybe<bool> Init(Environment* env,
+                       Local<Value> input,
+                       Local<Value> base) {
+    Isolate* isolate = env->isolate();
+    if (input->IsString()) {
+      Utf8Value href(isolate, input);
+      std::optional<std::string> base_href;
+      if (base->IsString()) base_href = Utf8Value(isolate, base).ToString();
+      ada::result<ada::url_aggregator> url;
+      if (base_href.has_value()) {
+        auto base_url = ada::parse<ada::url_aggregator>(*base_href);
+        if (!base_url) return v8::Just(false);
+        url = ada::parse<ada::url_aggregator>(href.ToStringView(),
+                                              &base_url.value());
+      } else {
+        url = ada::parse<ada::url_aggregator>(href.ToStringView());
+      }
+      if (!url) return v8::Just(false);
+      std::string_view protocol = url->get_protocol();
+      if (!protocol.empty()) protocol.remove_suffix(1);  // The ':'.
+      std::string_view search = url->get_search();
+      if (!search.empty()) search.remove_prefix(1);  // The '?'.
+      std::string_view hash = url->get_hash();
+      if (!hash.empty()) hash.remove_prefix(1);  // The '#'.
+      values_[kProtocol] = protocol;
+      values_[kUsername] = url->get_username();
+      values_[kPassword] = url->get_password();
+      values_[kHostname] = url->get_hostname();
+      values_[kPort] = url->get_port();
+      values_[kPathname] = url->get_pathname();
+      values_[kSearch] = search;
+      values_[kHash] = hash;
+      return v8::Just(true);
+    }
+
+    CHECK(input->IsObject());
+    Local<Object> init = input.As<Object>();
+    for (int i = 0; i < kComponentCount; i++) {
+      Local<Value> value;
+      if (!init->Get(env->context(),
+                     OneByteString(isolate, kComponentNames[i]))
+               .ToLocal(&value)) {
+        return v8::Nothing<bool>();
+      }
+      if (value->IsString()) {
+        values_[i] = Utf8Value(isolate, value).ToString();
+        strings_[i] = value.As<String>();
+      }
+    }
+    return v8::Just(true);
+  }
+
+  const std::string& value(Component component) const {
+    return values_[component];
+  }
+
+  Local<String> string(Isolate* isolate, Component component) {
+    if (strings_[component].IsEmpty()) {
+      strings_[component] = String::NewFromUtf8(
+          isolate,
+          values_[component].data(),
+          v8::NewStringType::kNormal,
+          static_cast<int>(values_[component].size())).ToLocalChecked();
+    }
+    return strings_[component];
+  }
+
+ private:
+  std::string values_[kComponentCount];
+  Local<String> strings_[kComponentCount];
+};
+
+}  // anonymous namespace
+
+class URLPattern : public BaseObject {
+ public:
+  static Local<FunctionTemplate> GetConstructorTemplate(Environment* env);
+  static bool HasInstance(Environment* env, Local<Value> value) {
+    return GetConstructorTemplate(env)->HasInstance(value);
+  }
+
+  URLPattern(Environment* env, Local<Object> obj) : BaseObject(env, obj) {
+    MakeWeak();
+  }
+
+  // new URLPattern(components, ignoreCase)
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    Isolate* isolate = env->isolate();
+    CHECK(args.IsConstructCall());
+    CHECK(args[0]->IsObject());
+    Local<Object> init = args[0].As<Object>();
+    const bool ignore_case = args[1]->IsTrue();
+
+    URLPattern* pattern = new URLPattern(env, args.This());
+    for (int i = 0; i < kComponentCount; i++) {
+      Local<String> name = OneByteString(isolate, kComponentNames[i]);
+      Local<Value> value;
+      if (!init->Get(env->context(), name).ToLocal(&value)) return;
+      std::string source = "*";
+      if (value->IsString()) source = Utf8Value(isolate, value).ToString();
+      if (!CompileComponent(env,
+                            static_cast<Component>(i),
+                            source,
+                            ignore_case,
+                            &pattern->components_[i])) {
+        return;
+      }
+      Local<String> source_string;
+      if (!String::NewFromUtf8(isolate, source.data(),
+                               v8::NewStringType::kNormal,
+                               static_cast<int>(source.size()))
+               .ToLocal(&source_string) ||
+          args.This()->Set(env->context(), name, source_string).IsNothing()) {
+        return;
+      }
+    }
+  }
+
+  // test(input[, baseURL])
+  static void Test(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    URLPattern* pattern;
+    ASSIGN_OR_RETURN_UNWRAP(&pattern, args.This());
+    MatchInput input;
+    bool parsed;
+    if (!input.Init(env, args[0], args[1]).To(&parsed)) return;
+    bool matched = false;
+    if (parsed && !pattern->Match(env, &input, nullptr).To(&matched)) return;
+    args.GetReturnValue().Set(matched);
+  }
+
+  // exec(input[, baseURL])
+  static void Exec(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    URLPattern* pattern;
+    ASSIGN_OR_RETURN_UNWRAP(&pattern, args.This());
+    MatchInput input;
+    bool parsed;
+    if (!input.Init(env, args[0], args[1]).To(&parsed)) return;
+    if (!parsed) return args.GetReturnValue().SetNull();
+    Local<Object> result;
+    bool matched;
+    if (!pattern->Match(env, &input, &result).To(&matched)) return;
+    if (!matched) return args.GetReturnValue().SetNull();
+    Local<Value> arg = args[0];
+    Local<Value> inputs = Array::New(env->isolate(), &arg, 1);
+    if (result->Set(env->context(),
+                    FIXED_ONE_BYTE_STRING(env->isolate(), "inputs"),
+                    inputs).IsNothing()) {
+      return;
+    }
+    args.GetReturnValue().Set(result);
+  }
+
+  // Matches all components. If |result| is set and the pattern matches, it
+  // receives an object with the input and the groups of every component.
+  v8::Maybe<bool> Match(Environment* env,
+                        MatchInput* input,
+                        Local<Object>* result) {
+    // Rule out the pattern with plain string comparisons first.
+    for (Component component : kMatchOrder) {
+      const CompiledComponent& compiled = components_[component];
+      const std::string& value = input->value(component);
+      if (compiled.is_literal && value != compiled.literal)
+        return v8::Just(false);
+      if (!compiled.literal_prefix.empty() &&
+          value.compare(0, compiled.literal_prefix.size(),
+                        compiled.literal_prefix) != 0) {
+        return v8::Just(false);
+      }
+    }
+
+    Isolate* isolate = env->isolate();
+    Local<Context> context = env->context();
+    Local<Value> matches[kComponentCount];
+    for (Component component : kMatchOrder) {
+      const CompiledComponent& compiled = components_[component];
+      if (compiled.regexp.IsEmpty()) continue;
+      Local<Object> match;
+      if (!compiled.regexp.Get(isolate)
+               ->Exec(context, input->string(isolate, component))
+               .ToLocal(&match)) {
+        return v8::Nothing<bool>();
+      }
+      if (match->IsNull()) return v8::Just(false);
+      matches[component] = match;
+    }
+    if (result == nullptr) return v8::Just(true);
+
+    *result = Object::New(isolate);
+    for (int i = 0; i < kComponentCount; i++) {
+      const Component component = static_cast<Component>(i);
+      const CompiledComponent& compiled = components_[i];
+      Local<String> value = input->string(isolate, component);
+      Local<Object> groups = Object::New(isolate);
+      for (size_t n = 0; n < compiled.names.size(); n++) {
+        Local<Value> group = value;
+        if (!compiled.matches_everything) {
+          if (!matches[i].As<Object>()
+                   ->Get(context, static_cast<uint32_t>(n + 1))
+                   .ToLocal(&group)) {
+            return v8::Nothing<bool>();
+          }
+        }
+        if (groups->Set(context,
+                        OneByteString(isolate, compiled.names[n].c_str()),
+                        group).IsNothing()) {
+          return v8::Nothing<bool>();
+        }
+      }
+      Local<Object> entry = Object::New(isolate);
+      if (entry->Set(context, env->input_string(), value).IsNothing() ||
+          entry->Set(context,
+                     FIXED_ONE_BYTE_STRING(isolate, "groups"),
+                     groups).IsNothing() ||
+          (*result)->Set(context,
+                         OneByteString(isolate, kComponentNames[i]),
+                         entry).IsNothing()) {
+        return v8::Nothing<bool>();
+      }
+    }
+    return v8::Just(true);
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(URLPattern)
+  SET_SELF_SIZE(URLPattern)
+
+ private:
+  CompiledComponent components_[kComponentCount];
+};
+
+Local<FunctionTemplate> URLPattern::GetConstructorTemplate(Environment* env) {
+  Local<FunctionTemplate> tmpl = env->url_pattern_constructor_template();
+  if (tmpl.IsEmpty()) {
+    Isolate* isolate = env->isolate();
+    tmpl = NewFunctionTemplate(isolate, New);
+    tmpl->InstanceTemplate()->SetInternalFieldCount(
+        BaseObject::kInternalFieldCount);
+    SetProtoMethod(isolate, tmpl, "test", Test);
+    SetProtoMethod(isolate, tmpl, "exec", Exec);
+    env->set_url_pattern_constructor_template(tmpl);
+  }
+  return tmpl;
+}
+
+class URLPatternList : public BaseObject {
+ public:
+  URLPatternList(Environment* env, Local<Object> obj) : BaseObject(env, obj) {
+    MakeWeak();
+  }
+
+  // new URLPatternList(patterns)
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args.IsConstructCall());
+    CHECK(args[0]->IsArray());
+    Local<Array> array = args[0].As<Array>();
+
+    URLPatternList* list = new URLPatternList(env, args.This());
+    list->patterns_.reserve(array->Length());
+    for (uint32_t i = 0; i < array->Length(); i++) {
+      Local<Value> value;
+      if (!array->Get(env->context(), i).ToLocal(&value)) return;
+      if (!URLPattern::HasInstance(env, value)) {
+        return THROW_ERR_INVALID_ARG_TYPE(
+            env, "The patterns must be URLPattern instances");
+      }
+      list->patterns_.emplace_back(Unwrap<URLPattern>(value.As<Object>()));
+    }
+  }
+
+  // match(input[, baseURL]) returns the index of the first pattern that
+  // matches and its exec() result, as [index, result], or null.
+  static void Match(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    Isolate* isolate = env->isolate();
+    URLPatternList* list;
+    ASSIGN_OR_RETURN_UNWRAP(&list, args.This());
+    MatchInput input;
+    bool parsed;
+    if (!input.Init(env, args[0], args[1]).To(&parsed)) return;
+    if (!parsed) return args.GetReturnValue().SetNull();
+    for (size_t i = 0; i < list->patterns_.size(); i++) {
+      Local<Object> result;
+      bool matched;
+      if (!list->patterns_[i]->Match(env, &input, &result).To(&matched))
+        return;
+      if (!matched) continue;
+      Local<Value> arg = args[0];
+      Local<Value> inputs = Array::New(isolate, &arg, 1);
+      if (result->Set(env->context(),
+                      FIXED_ONE_BYTE_STRING(isolate, "inputs"),
+                      inputs).IsNothing()) {
+        return;
+      }
+      Local<Value> pair[] = {Integer::NewFromUnsigned(isolate, i), result};
+      return args.GetReturnValue().Set(
+          Array::New(isolate, pair, arraysize(pair)));
+    }
+    args.GetReturnValue().SetNull();
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(URLPatternList)
+  SET_SELF_SIZE(URLPatternList)
+
+ private:
+  std::vector<BaseObjectPtr<URLPattern>> patterns_;
+};
+
+void CreatePerContextProperties(Local<Object> target,
+                                Local<Value> unused,
+                                Local<Context> context,
+                                void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Isolate* isolate = env->isolate();
+
+  SetConstructorFunction(context,
+                         target,
+                         "URLPattern",
+                         URLPattern::GetConstructorTemplate(env));
+
+  Local<FunctionTemplate> list =
+      NewFunctionTemplate(isolate, URLPatternList::New);
+  list->InstanceTemplate()->SetInternalFieldCount(
+      BaseObject::kInternalFieldCount);
+  SetProtoMethod(isolate, list, "match", URLPatternList::Match);
+  SetConstructorFunction(context, target, "URLPatternList", list);
+}
+
+void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+  registry->Register(URLPattern::New);
+  registry->Register(URLPattern::Test);
+  registry->Register(URLPattern::Exec);
+  registry->Register(URLPatternList::New);
+  registry->Register(URLPatternList::Match);
+}
+
+}  // namespace url_pattern
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(
+    url_pattern, node::url_pattern::CreatePerContextProperties)
+NODE_BINDING_EXTERNAL_REFERENCE(url_pattern,
+                                node::url_pattern::RegisterExternalReferences)
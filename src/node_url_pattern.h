@@ -0,0 +1,26 @@
+#ifndef SRC_NODE_URL_PATTERN_H_
+#define SRC_NODE_URL_PATTERN_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "v8.h"
+
+namespace node {
+class ExternalReferenceRegistry;
+
+namespace url_pattern {
+
+// Sets the URLPattern and URLPatternList constructors of the binding on
+// |target|.
+void CreatePerContextProperties(v8::Local<v8::Object> target,
+                                v8::Local<v8::Value> unused,
+                                v8::Local<v8::Context> context,
+                                void* priv);
+void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+}  // namespace url_pattern
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_URL_PATTERN_H_
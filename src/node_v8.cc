@@ -25,23 +25,33 @@
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
 #include "node.h"
+#include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_internals.h"
+#include "node_v8_platform-inl.h"
+#include "timer_wrap-inl.h"
 #include "util-inl.h"
 #include "v8.h"
 
+#include <cstdlib>
+#include <string_view>
+
 namespace node {
 namespace v8_utils {
 using v8::Array;
 using v8::Context;
+using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
 using v8::HeapCodeStatistics;
 using v8::HeapSpaceStatistics;
 using v8::HeapStatistics;
+using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
+using v8::MemoryPressureLevel;
 using v8::Object;
 using v8::ScriptCompiler;
 using v8::String;
@@ -238,6 +248,24 @@ void SetFlagsFromString(const FunctionCallbackInfo<Value>& args) {
   V8::SetFlagsFromString(*flags, static_cast<size_t>(flags.length()));
 }
 
+// Resizes the pool of threads that run V8 background tasks and returns the
+// new number of threads. This is a no-op when Node.js runs on a platform
+// provided by an embedder.
+void SetPlatformThreadPoolSize(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsInt32());
+  if (!env->is_main_thread()) {
+    THROW_ERR_INVALID_STATE(
+        env, "The platform thread pool can only be resized by the main thread");
+    return;
+  }
+  NodePlatform* platform = per_process::v8_platform.Platform();
+  if (platform == nullptr || env->isolate_data()->platform() != platform)
+    return;
+  platform->SetThreadPoolSize(args[0].As<Int32>()->Value());
+  args.GetReturnValue().Set(platform->NumberOfWorkerThreads());
+}
+
 static const char* GetGCTypeName(v8::GCType gc_type) {
   switch (gc_type) {
     case v8::GCType::kGCTypeScavenge:
@@ -416,6 +444,171 @@ void GCProfiler::Stop(const FunctionCallbackInfo<v8::Value>& args) {
                                 .ToLocalChecked());
 }
 
+namespace {
+
+// Returns the rest of the first line of |text| that starts with |prefix|, or
+// an empty view.
+std::string_view FindLine(std::string_view text, std::string_view prefix) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string_view::npos) end = text.size();
+    std::string_view line = text.substr(pos, end - pos);
+    if (line.substr(0, prefix.size()) == prefix)
+      return line.substr(prefix.size());
+    pos = end + 1;
+  }
+  return {};
+}
+
+// Returns a counter of a cgroup memory.events file, such as "high ".
+uint64_t GetEventCount(std::string_view events, std::string_view key) {
+  std::string value(FindLine(events, key));
+  return strtoull(value.c_str(), nullptr, 10);
+}
+
+// Returns the avg10 percentage of the "some " or "full " line of a PSI file.
+double GetPressureAvg10(std::string_view pressure, std::string_view kind) {
+  std::string_view line = FindLine(pressure, kind);
+  size_t pos = line.find("avg10=");
+  if (pos == std::string_view::npos) return 0;
+  return strtod(std::string(line.substr(pos + 6)).c_str(), nullptr);
+}
+
+}  // anonymous namespace
+
+MemoryPressureMonitor::MemoryPressureMonitor(Environment* env,
+                                             Local<Object> object,
+                                             Local<Function> callback)
+    : BaseObject(env, object),
+      callback_(env->isolate(), callback),
+      timer_(env, [this]() { Sample(); }) {
+  MakeWeak();
+  timer_.Unref();
+}
+
+int MemoryPressureMonitor::FindFiles() {
+#ifdef __linux__
+  events_path_.clear();
+  pressure_path_.clear();
+  std::string text;
+  // With cgroup v2, the line of the unified hierarchy is "0::<path>".
+  if (ReadFileSync(&text, "/proc/self/cgroup") == 0) {
+    std::string_view path = FindLine(text, "0::");
+    while (!path.empty() && path.back() == '/') path.remove_suffix(1);
+    if (!path.empty() || text.find("0::/") != std::string::npos) {
+      std::string dir = "/sys/fs/cgroup" + std::string(path);
+      std::string events = dir + "/memory.events";
+      if (ReadFileSync(&text, events.c_str()) == 0) {
+        events_path_ = events;
+        high_events_ = GetEventCount(text, "high ");
+        max_events_ = GetEventCount(text, "max ") + GetEventCount(text, "oom ");
+      }
+      std::string pressure = dir + "/memory.pressure";
+      if (ReadFileSync(&text, pressure.c_str()) == 0)
+        pressure_path_ = pressure;
+    }
+  }
+  // The root cgroup has no files of its own, but the system-wide PSI file
+  // covers it.
+  if (pressure_path_.empty() &&
+      ReadFileSync(&text, "/proc/pressure/memory") == 0) {
+    pressure_path_ = "/proc/pressure/memory";
+  }
+  if (events_path_.empty() && pressure_path_.empty()) return UV_ENOTSUP;
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+void MemoryPressureMonitor::Sample() {
+  MemoryPressureLevel level = MemoryPressureLevel::kNone;
+  std::string text;
+  // The counters only grow while the cgroup is at its limits, so any
+  // change since the last sample means that it still is.
+  if (!events_path_.empty() && ReadFileSync(&text, events_path_.c_str()) == 0) {
+    uint64_t high = GetEventCount(text, "high ");
+    uint64_t max = GetEventCount(text, "max ") + GetEventCount(text, "oom ");
+    if (max != max_events_) {
+      level = MemoryPressureLevel::kCritical;
+    } else if (high != high_events_) {
+      level = MemoryPressureLevel::kModerate;
+    }
+    high_events_ = high;
+    max_events_ = max;
+  }
+  if (level == MemoryPressureLevel::kNone && psi_threshold_ > 0 &&
+      !pressure_path_.empty() &&
+      ReadFileSync(&text, pressure_path_.c_str()) == 0) {
+    if (GetPressureAvg10(text, "full ") >= psi_threshold_) {
+      level = MemoryPressureLevel::kCritical;
+    } else if (GetPressureAvg10(text, "some ") >= psi_threshold_) {
+      level = MemoryPressureLevel::kModerate;
+    }
+  }
+
+  // Only changes are reported, as V8 collects garbage right away on each
+  // critical notification.
+  if (level == level_) return;
+  level_ = level;
+  env()->NotifyMemoryPressure(level);
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+  Local<Value> arg = Integer::New(isolate, static_cast<int>(level));
+  InternalCallbackScope callback_scope(env(), object(), {0, 0});
+  if (callback_.Get(isolate)
+          ->Call(env()->context(), object(), 1, &arg)
+          .IsEmpty()) {
+    callback_scope.MarkAsFailed();
+  }
+}
+
+void MemoryPressureMonitor::New(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsFunction());
+  Environment* env = Environment::GetCurrent(args);
+  new MemoryPressureMonitor(env, args.This(), args[0].As<Function>());
+}
+
+// start(intervalMs, psiThreshold) samples the files every |intervalMs|.
+// A |psiThreshold| of 0 ignores PSI. Returns 0 or a libuv error code.
+void MemoryPressureMonitor::Start(const FunctionCallbackInfo<Value>& args) {
+  MemoryPressureMonitor* monitor;
+  ASSIGN_OR_RETURN_UNWRAP(&monitor, args.This());
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsNumber());
+  uint32_t interval = args[0].As<Uint32>()->Value();
+  CHECK_GT(interval, 0);
+
+  int err = monitor->FindFiles();
+  if (err == 0) {
+    monitor->psi_threshold_ = args[1].As<v8::Number>()->Value();
+    monitor->timer_.Update(interval, interval);
+    monitor->ClearWeak();
+  }
+  args.GetReturnValue().Set(err);
+}
+
+void MemoryPressureMonitor::Stop(const FunctionCallbackInfo<Value>& args) {
+  MemoryPressureMonitor* monitor;
+  ASSIGN_OR_RETURN_UNWRAP(&monitor, args.This());
+  monitor->timer_.Stop();
+  monitor->MakeWeak();
+}
+
+// notifyMemoryPressure(level) lets JS code report pressure it detected
+// itself, such as a cache over its budget, to V8 and the native caches.
+void NotifyMemoryPressure(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsUint32());
+  uint32_t level = args[0].As<Uint32>()->Value();
+  CHECK_LE(level, static_cast<uint32_t>(MemoryPressureLevel::kCritical));
+  env->NotifyMemoryPressure(static_cast<MemoryPressureLevel>(level));
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -478,6 +671,10 @@ void Initialize(Local<Object> target,
 
   // Export symbols used by v8.setFlagsFromString()
   SetMethod(context, target, "setFlagsFromString", SetFlagsFromString);
+  SetMethod(context,
+            target,
+            "setPlatformThreadPoolSize",
+            SetPlatformThreadPoolSize);
 
   // GCProfiler
   Local<FunctionTemplate> t =
@@ -486,6 +683,26 @@ void Initialize(Local<Object> target,
   SetProtoMethod(env->isolate(), t, "start", GCProfiler::Start);
   SetProtoMethod(env->isolate(), t, "stop", GCProfiler::Stop);
   SetConstructorFunction(context, target, "GCProfiler", t);
+
+  // MemoryPressureMonitor
+  t = NewFunctionTemplate(env->isolate(), MemoryPressureMonitor::New);
+  t->InstanceTemplate()->SetInternalFieldCount(BaseObject::kInternalFieldCount);
+  SetProtoMethod(env->isolate(), t, "start", MemoryPressureMonitor::Start);
+  SetProtoMethod(env->isolate(), t, "stop", MemoryPressureMonitor::Stop);
+  SetConstructorFunction(context, target, "MemoryPressureMonitor", t);
+  SetMethod(context, target, "notifyMemoryPressure", NotifyMemoryPressure);
+
+#define V(name, level)                                                         \
+  target                                                                       \
+      ->Set(context,                                                           \
+            FIXED_ONE_BYTE_STRING(env->isolate(), name),                       \
+            Uint32::NewFromUnsigned(env->isolate(),                            \
+                                    static_cast<uint32_t>(level)))             \
+      .Check();
+  V("kMemoryPressureNone", MemoryPressureLevel::kNone)
+  V("kMemoryPressureModerate", MemoryPressureLevel::kModerate)
+  V("kMemoryPressureCritical", MemoryPressureLevel::kCritical)
+#undef V
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
@@ -494,10 +711,15 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(UpdateHeapCodeStatisticsBuffer);
   registry->Register(UpdateHeapSpaceStatisticsBuffer);
   registry->Register(SetFlagsFromString);
+  registry->Register(SetPlatformThreadPoolSize);
   registry->Register(SetHeapSnapshotNearHeapLimit);
   registry->Register(GCProfiler::New);
   registry->Register(GCProfiler::Start);
   registry->Register(GCProfiler::Stop);
+  registry->Register(MemoryPressureMonitor::New);
+  registry->Register(MemoryPressureMonitor::Start);
+  registry->Register(MemoryPressureMonitor::Stop);
+  registry->Register(NotifyMemoryPressure);
 }
 
 }  // namespace v8_utils
@@ -8,6 +8,7 @@
 #include "base_object.h"
 #include "json_utils.h"
 #include "node_snapshotable.h"
+#include "timer_wrap.h"
 #include "util.h"
 #include "v8.h"
 
@@ -68,6 +69,40 @@ class GCProfiler : public BaseObject {
   JSONWriter writer_;
 };
 
+// Watches the memory pressure of the cgroup (v2) of the process, and
+// forwards changes of its level to Environment::NotifyMemoryPressure() and
+// to the JS callback passed to the constructor. The level is critical once
+// memory.events reports that the cgroup hit memory.max or the OOM killer,
+// and moderate once it went over memory.high or the avg10 of the PSI
+// memory pressure reached a threshold. Only supported on Linux.
+class MemoryPressureMonitor : public BaseObject {
+ public:
+  MemoryPressureMonitor(Environment* env,
+                        v8::Local<v8::Object> object,
+                        v8::Local<v8::Function> callback);
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Stop(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(MemoryPressureMonitor)
+  SET_SELF_SIZE(MemoryPressureMonitor)
+
+ private:
+  // Returns 0, or a libuv error code if there is nothing to watch.
+  int FindFiles();
+  void Sample();
+
+  v8::Global<v8::Function> callback_;
+  TimerWrapHandle timer_;
+  std::string events_path_;
+  std::string pressure_path_;
+  double psi_threshold_ = 0;
+  uint64_t high_events_ = 0;
+  uint64_t max_events_ = 0;
+  v8::MemoryPressureLevel level_ = v8::MemoryPressureLevel::kNone;
+};
+
 }  // namespace v8_utils
 
 }  // namespace node
@@ -85,7 +85,9 @@ struct V8Platform {
   bool initialized_ = false;
 
 #if NODE_USE_V8_PLATFORM
-  inline void Initialize(int thread_pool_size) {
+  inline void Initialize(
+      int thread_pool_size,
+      std::unique_ptr<v8::PageAllocator> page_allocator = nullptr) {
     CHECK(!initialized_);
     initialized_ = true;
     tracing_agent_ = std::make_unique<tracing::Agent>();
@@ -101,7 +103,9 @@ struct V8Platform {
       StartTracingAgent();
     }
     // Tracing must be initialized before platform threads are created.
-    platform_ = new NodePlatform(thread_pool_size, controller);
+    page_allocator_ = std::move(page_allocator);
+    platform_ =
+        new NodePlatform(thread_pool_size, controller, page_allocator_.get());
     v8::V8::InitializePlatform(platform_);
   }
   // Make sure V8Platform don not call into Libuv threadpool,
@@ -115,6 +119,7 @@ struct V8Platform {
     platform_->Shutdown();
     delete platform_;
     platform_ = nullptr;
+    page_allocator_.reset();
     // Destroy tracing after the platform (and platform threads) have been
     // stopped.
     tracing_agent_.reset(nullptr);
@@ -146,7 +151,10 @@ struct V8Platform {
           convert_to_set(categories),
           std::unique_ptr<tracing::AsyncTraceWriter>(
               new tracing::NodeTraceWriter(
-                  per_process::cli_options->trace_event_file_pattern)),
+                  per_process::cli_options->trace_event_file_pattern,
+                  per_process::cli_options->trace_event_format == "perfetto"
+                      ? tracing::NodeTraceWriter::Format::kPerfetto
+                      : tracing::NodeTraceWriter::Format::kJSON)),
           tracing::Agent::kUseDefaultCategories);
     }
   }
@@ -162,9 +170,14 @@ struct V8Platform {
   std::unique_ptr<NodeTraceStateObserver> trace_state_observer_;
   std::unique_ptr<tracing::Agent> tracing_agent_;
   tracing::AgentWriterHandle tracing_file_writer_;
+  // Outlives the platform, V8 and cppgc allocate through it until they are
+  // disposed.
+  std::unique_ptr<v8::PageAllocator> page_allocator_;
   NodePlatform* platform_;
 #else   // !NODE_USE_V8_PLATFORM
-  inline void Initialize(int thread_pool_size) {}
+  inline void Initialize(
+      int thread_pool_size,
+      std::unique_ptr<v8::PageAllocator> page_allocator = nullptr) {}
   inline void Dispose() {}
   inline void DrainVMTasks(v8::Isolate* isolate) {}
   inline void StartTracingAgent() {
@@ -26,6 +26,17 @@ inline void Debug(const WASI& wasi, Args&&... args) {
     }                                                                          \
   } while (0)
 
+// Iovec arrays are converted into host iovecs pointing straight into the
+// Wasm memory. Most calls pass only a few, which then stay on the stack.
+template <typename T>
+using IovecBuffer = MaybeStackBuffer<T, 16>;
+
+// The byte size of |len| serialized iovecs, computed without wrapping around
+// so that a huge count fails the bounds check before anything is allocated.
+inline size_t IovecsSize(uint32_t len) {
+  return static_cast<size_t>(len) * UVWASI_SERDES_SIZE_iovec_t;
+}
+
 using v8::Array;
 using v8::ArrayBuffer;
 using v8::BigInt;
@@ -638,20 +649,19 @@ uint32_t WASI::FdPread(WASI& wasi,
         iovs_len,
         offset,
         nread_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, iovs_ptr, iovs_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, iovs_ptr, IovecsSize(iovs_len));
   CHECK_BOUNDS_OR_RETURN(memory.size, nread_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_iovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_iovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_iovec_t(
-      memory.data, memory.size, iovs_ptr, iovs.data(), iovs_len);
+      memory.data, memory.size, iovs_ptr, iovs.out(), iovs_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
 
   uvwasi_size_t nread;
-  err = uvwasi_fd_pread(&wasi.uvw_, fd, iovs.data(), iovs_len, offset, &nread);
+  err = uvwasi_fd_pread(&wasi.uvw_, fd, iovs.out(), iovs_len, offset, &nread);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory.data, nread_ptr, nread);
 
@@ -698,21 +708,20 @@ uint32_t WASI::FdPwrite(WASI& wasi,
         iovs_len,
         offset,
         nwritten_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, iovs_ptr, iovs_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, iovs_ptr, IovecsSize(iovs_len));
   CHECK_BOUNDS_OR_RETURN(memory.size, nwritten_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_ciovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_ciovec_t(
-      memory.data, memory.size, iovs_ptr, iovs.data(), iovs_len);
+      memory.data, memory.size, iovs_ptr, iovs.out(), iovs_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
 
   uvwasi_size_t nwritten;
   err = uvwasi_fd_pwrite(
-      &wasi.uvw_, fd, iovs.data(), iovs_len, offset, &nwritten);
+      &wasi.uvw_, fd, iovs.out(), iovs_len, offset, &nwritten);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory.data, nwritten_ptr, nwritten);
 
@@ -726,20 +735,19 @@ uint32_t WASI::FdRead(WASI& wasi,
                       uint32_t iovs_len,
                       uint32_t nread_ptr) {
   Debug(wasi, "fd_read(%d, %d, %d, %d)\n", fd, iovs_ptr, iovs_len, nread_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, iovs_ptr, iovs_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, iovs_ptr, IovecsSize(iovs_len));
   CHECK_BOUNDS_OR_RETURN(memory.size, nread_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_iovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_iovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_iovec_t(
-      memory.data, memory.size, iovs_ptr, iovs.data(), iovs_len);
+      memory.data, memory.size, iovs_ptr, iovs.out(), iovs_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
 
   uvwasi_size_t nread;
-  err = uvwasi_fd_read(&wasi.uvw_, fd, iovs.data(), iovs_len, &nread);
+  err = uvwasi_fd_read(&wasi.uvw_, fd, iovs.out(), iovs_len, &nread);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory.data, nread_ptr, nread);
 
@@ -827,20 +835,19 @@ uint32_t WASI::FdWrite(WASI& wasi,
         iovs_ptr,
         iovs_len,
         nwritten_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, iovs_ptr, iovs_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, iovs_ptr, IovecsSize(iovs_len));
   CHECK_BOUNDS_OR_RETURN(memory.size, nwritten_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_ciovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_ciovec_t(
-      memory.data, memory.size, iovs_ptr, iovs.data(), iovs_len);
+      memory.data, memory.size, iovs_ptr, iovs.out(), iovs_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
 
   uvwasi_size_t nwritten;
-  err = uvwasi_fd_write(&wasi.uvw_, fd, iovs.data(), iovs_len, &nwritten);
+  err = uvwasi_fd_write(&wasi.uvw_, fd, iovs.out(), iovs_len, &nwritten);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory.data, nwritten_ptr, nwritten);
 
@@ -1183,13 +1190,12 @@ uint32_t WASI::SockRecv(WASI& wasi,
         ri_flags,
         ro_datalen_ptr,
         ro_flags_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, ri_data_ptr, ri_data_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, ri_data_ptr, IovecsSize(ri_data_len));
   CHECK_BOUNDS_OR_RETURN(memory.size, ro_datalen_ptr, 4);
   CHECK_BOUNDS_OR_RETURN(memory.size, ro_flags_ptr, 4);
-  std::vector<uvwasi_iovec_t> ri_data(ri_data_len);
+  IovecBuffer<uvwasi_iovec_t> ri_data(ri_data_len);
   uvwasi_errno_t err = uvwasi_serdes_readv_iovec_t(
-      memory.data, memory.size, ri_data_ptr, ri_data.data(), ri_data_len);
+      memory.data, memory.size, ri_data_ptr, ri_data.out(), ri_data_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
@@ -1198,7 +1204,7 @@ uint32_t WASI::SockRecv(WASI& wasi,
   uvwasi_roflags_t ro_flags;
   err = uvwasi_sock_recv(&wasi.uvw_,
                          sock,
-                         ri_data.data(),
+                         ri_data.out(),
                          ri_data_len,
                          ri_flags,
                          &ro_datalen,
@@ -1225,20 +1231,19 @@ uint32_t WASI::SockSend(WASI& wasi,
         si_data_len,
         si_flags,
         so_datalen_ptr);
-  CHECK_BOUNDS_OR_RETURN(
-      memory.size, si_data_ptr, si_data_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_BOUNDS_OR_RETURN(memory.size, si_data_ptr, IovecsSize(si_data_len));
   CHECK_BOUNDS_OR_RETURN(
       memory.size, so_datalen_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> si_data(si_data_len);
+  IovecBuffer<uvwasi_ciovec_t> si_data(si_data_len);
   uvwasi_errno_t err = uvwasi_serdes_readv_ciovec_t(
-      memory.data, memory.size, si_data_ptr, si_data.data(), si_data_len);
+      memory.data, memory.size, si_data_ptr, si_data.out(), si_data_len);
   if (err != UVWASI_ESUCCESS) {
     return err;
   }
 
   uvwasi_size_t so_datalen;
   err = uvwasi_sock_send(
-      &wasi.uvw_, sock, si_data.data(), si_data_len, si_flags, &so_datalen);
+      &wasi.uvw_, sock, si_data.out(), si_data_len, si_flags, &so_datalen);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory.data, so_datalen_ptr, so_datalen);
 
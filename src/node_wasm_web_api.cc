@@ -1,5 +1,7 @@
 #include "node_wasm_web_api.h"
 
+#include "compile_cache.h"
+#include "env-inl.h"
 #include "memory_tracker-inl.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
@@ -54,6 +56,10 @@ void WasmStreamingObject::MemoryInfo(MemoryTracker* tracker) const {
   // module that is being compiled is roughly what V8 allocates (as in, off by
   // only a small factor).
   tracker->TrackFieldWithSize("streaming", wasm_size_);
+  if (wasm_cache_entry_) {
+    tracker->TrackFieldWithSize("wasm_cache_entry",
+                                wasm_cache_entry_->module.size());
+  }
 }
 
 MaybeLocal<Object> WasmStreamingObject::Create(
@@ -86,8 +92,38 @@ void WasmStreamingObject::SetURL(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_EQ(args.Length(), 1);
   CHECK(args[0]->IsString());
-  Utf8Value url(Environment::GetCurrent(args)->isolate(), args[0]);
+  Environment* env = Environment::GetCurrent(args);
+  Utf8Value url(env->isolate(), args[0]);
   obj->streaming_->SetUrl(url.out(), url.length());
+  obj->MaybeUseWasmCache(env, url.ToStringView());
+}
+
+void WasmStreamingObject::MaybeUseWasmCache(Environment* env,
+                                            std::string_view url) {
+  CompileCacheHandler* handler = env->compile_cache_handler();
+  // SetCompiledModuleBytes() has to come before any bytes.
+  if (handler == nullptr || !handler->wasm_cache_enabled() ||
+      wasm_size_ != 0 || wasm_cache_hit_) {
+    return;
+  }
+
+  std::string filename = handler->GetWasmCacheFilename(url);
+  wasm_cache_entry_ = handler->ReadWasmCache(filename);
+  if (wasm_cache_entry_ &&
+      !streaming_->SetCompiledModuleBytes(
+          reinterpret_cast<const uint8_t*>(wasm_cache_entry_->module.data()),
+          wasm_cache_entry_->module.size())) {
+    wasm_cache_entry_.reset();
+  }
+
+  auto cache_hit = std::make_shared<std::atomic<bool>>(false);
+  wasm_cache_hit_ = cache_hit;
+  streaming_->SetMoreFunctionsCanBeSerializedCallback(
+      [filename = std::move(filename),
+       cache_hit = std::move(cache_hit)](v8::CompiledWasmModule module) {
+        if (cache_hit->load()) return;
+        CompileCacheHandler::WriteWasmCache(filename, &module);
+      });
 }
 
 void WasmStreamingObject::Push(const FunctionCallbackInfo<Value>& args) {
@@ -121,9 +157,13 @@ void WasmStreamingObject::Push(const FunctionCallbackInfo<Value>& args) {
   }
 
   // Forward the data to V8. Internally, V8 will make a copy.
-  obj->streaming_->OnBytesReceived(static_cast<const uint8_t*>(bytes) + offset,
-                                   size);
+  const uint8_t* data = static_cast<const uint8_t*>(bytes) + offset;
+  obj->streaming_->OnBytesReceived(data, size);
   obj->wasm_size_ += size;
+  if (obj->wasm_cache_entry_) {
+    obj->wire_hash_ =
+        CompileCacheHandler::UpdateWasmHash(obj->wire_hash_, data, size);
+  }
 }
 
 void WasmStreamingObject::Finish(const FunctionCallbackInfo<Value>& args) {
@@ -132,7 +172,15 @@ void WasmStreamingObject::Finish(const FunctionCallbackInfo<Value>& args) {
   CHECK(obj->streaming_);
 
   CHECK_EQ(args.Length(), 0);
-  obj->streaming_->Finish();
+  bool can_use_compiled_module = true;
+  if (obj->wasm_cache_entry_) {
+    can_use_compiled_module =
+        obj->wasm_size_ == obj->wasm_cache_entry_->wire_size &&
+        obj->wire_hash_ == obj->wasm_cache_entry_->wire_hash;
+    obj->wasm_cache_hit_->store(can_use_compiled_module);
+  }
+  obj->streaming_->Finish(can_use_compiled_module);
+  obj->wasm_cache_entry_.reset();
 }
 
 void WasmStreamingObject::Abort(const FunctionCallbackInfo<Value>& args) {
@@ -142,6 +190,7 @@ void WasmStreamingObject::Abort(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_EQ(args.Length(), 1);
   obj->streaming_->Abort(args[0]);
+  obj->wasm_cache_entry_.reset();
 }
 
 void StartStreamingCompilation(const FunctionCallbackInfo<Value>& info) {
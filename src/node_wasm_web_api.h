@@ -6,7 +6,12 @@
 #include "base_object-inl.h"
 #include "v8.h"
 
+#include <atomic>
+#include <memory>
+
 namespace node {
+struct WasmCacheEntry;
+
 namespace wasm_web_api {
 
 // Wrapper for interacting with a v8::WasmStreaming instance from JavaScript.
@@ -38,8 +43,22 @@ class WasmStreamingObject final : public BaseObject {
   static void Finish(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Abort(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  // Looks up the compiled module for |url| in the compile cache, and asks V8
+  // to write the module back to the cache once it can be serialized.
+  void MaybeUseWasmCache(Environment* env, std::string_view url);
+
   std::shared_ptr<v8::WasmStreaming> streaming_;
   size_t wasm_size_ = 0;
+
+  // The compiled module passed to SetCompiledModuleBytes(), which must stay
+  // alive until Finish() or Abort(). V8 only gets to use it if the received
+  // wire bytes hash to the same value.
+  std::unique_ptr<WasmCacheEntry> wasm_cache_entry_;
+  uint32_t wire_hash_ = 0;
+  // Whether V8 used the cached module, in which case there is nothing new
+  // to write back. Shared with the serialization callback, which V8 can
+  // call on its compilation threads.
+  std::shared_ptr<std::atomic<bool>> wasm_cache_hit_;
 };
 
 // This is a v8::WasmStreamingCallback implementation that must be passed to
@@ -39,63 +39,142 @@ using v8::Local;
 using v8::Object;
 using v8::Value;
 
-Watchdog::Watchdog(v8::Isolate* isolate, uint64_t ms, bool* timed_out)
-    : isolate_(isolate), timed_out_(timed_out) {
-
-  int rc;
-  rc = uv_loop_init(&loop_);
-  if (rc != 0) {
-    UNREACHABLE("Failed to initialize uv loop.");
+// The thread that serves the deadlines of all Watchdogs of the process. They
+// are kept in a binary min-heap, so that starting and cancelling a timeout
+// costs O(log n) under a lock, instead of a thread and an event loop.
+class WatchdogThread {
+ public:
+  static WatchdogThread* GetInstance() {
+    return &LeakedSingleton<WatchdogThread>::Get();
   }
 
-  rc = uv_async_init(&loop_, &async_, [](uv_async_t* signal) {
-    Watchdog* w = ContainerOf(&Watchdog::async_, signal);
-    uv_stop(&w->loop_);
-  });
+  void Add(Watchdog* wd);
+  void Remove(Watchdog* wd);
 
-  CHECK_EQ(0, rc);
+ private:
+  static constexpr size_t kNotQueued = static_cast<size_t>(-1);
 
-  rc = uv_timer_init(&loop_, &timer_);
-  CHECK_EQ(0, rc);
+  friend class LeakedSingleton<WatchdogThread>;
+  // The thread is never joined.
+  WatchdogThread() = default;
 
-  rc = uv_timer_start(&timer_, &Watchdog::Timer, ms, 0);
-  CHECK_EQ(0, rc);
+  static void Run(void* arg);
 
-  rc = uv_thread_create(&thread_, &Watchdog::Run, this);
-  CHECK_EQ(0, rc);
-}
+  void RemoveAt(size_t index);
+  void SiftUp(size_t index);
+  void SiftDown(size_t index);
+  void Swap(size_t a, size_t b);
 
+  Mutex mutex_;
+  ConditionVariable cond_;
+  std::vector<Watchdog*> heap_;
+  uv_thread_t thread_;
+  bool has_thread_ = false;
+};
 
-Watchdog::~Watchdog() {
-  uv_async_send(&async_);
-  uv_thread_join(&thread_);
+void WatchdogThread::Add(Watchdog* wd) {
+  Mutex::ScopedLock lock(mutex_);
+  if (!has_thread_) {
+    CHECK_EQ(0, uv_thread_create(&thread_, &WatchdogThread::Run, this));
+    has_thread_ = true;
+  }
+  wd->heap_index_ = heap_.size();
+  heap_.push_back(wd);
+  SiftUp(wd->heap_index_);
+  // The thread only needs to wake up earlier if this is the new earliest
+  // deadline.
+  if (wd->heap_index_ == 0) cond_.Signal(lock);
+}
 
-  uv_close(reinterpret_cast<uv_handle_t*>(&async_), nullptr);
+void WatchdogThread::Remove(Watchdog* wd) {
+  Mutex::ScopedLock lock(mutex_);
+  if (wd->heap_index_ != kNotQueued) RemoveAt(wd->heap_index_);
+}
 
-  // UV_RUN_DEFAULT so that libuv has a chance to clean up.
-  uv_run(&loop_, UV_RUN_DEFAULT);
+void WatchdogThread::Run(void* arg) {
+  WatchdogThread* thread = static_cast<WatchdogThread*>(arg);
+  Mutex::ScopedLock lock(thread->mutex_);
+  for (;;) {
+    if (thread->heap_.empty()) {
+      thread->cond_.Wait(lock);
+      continue;
+    }
+    Watchdog* wd = thread->heap_[0];
+    uint64_t now = uv_hrtime();
+    if (wd->deadline_ > now) {
+      thread->cond_.TimedWait(lock, wd->deadline_ - now);
+      continue;
+    }
+    // Still under the lock, so the Watchdog cannot be destroyed meanwhile.
+    thread->RemoveAt(0);
+    if (wd->timed_out_ != nullptr) *wd->timed_out_ = true;
+    wd->isolate()->TerminateExecution();
+  }
+}
 
-  CheckedUvLoopClose(&loop_);
+void WatchdogThread::RemoveAt(size_t index) {
+  size_t last = heap_.size() - 1;
+  heap_[index]->heap_index_ = kNotQueued;
+  if (index != last) {
+    heap_[index] = heap_[last];
+    heap_[index]->heap_index_ = index;
+  }
+  heap_.pop_back();
+  if (index < heap_.size()) {
+    SiftDown(index);
+    SiftUp(index);
+  }
 }
 
+void WatchdogThread::SiftUp(size_t index) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (heap_[parent]->deadline_ <= heap_[index]->deadline_) break;
+    Swap(parent, index);
+    index = parent;
+  }
+}
 
-void Watchdog::Run(void* arg) {
-  Watchdog* wd = static_cast<Watchdog*>(arg);
+void WatchdogThread::SiftDown(size_t index) {
+  while (true) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < heap_.size() &&
+        heap_[left]->deadline_ < heap_[smallest]->deadline_) {
+      smallest = left;
+    }
+    if (right < heap_.size() &&
+        heap_[right]->deadline_ < heap_[smallest]->deadline_) {
+      smallest = right;
+    }
+    if (smallest == index) break;
+    Swap(smallest, index);
+    index = smallest;
+  }
+}
 
-  // UV_RUN_DEFAULT the loop will be stopped either by the async or the
-  // timer handle.
-  uv_run(&wd->loop_, UV_RUN_DEFAULT);
+void WatchdogThread::Swap(size_t a, size_t b) {
+  std::swap(heap_[a], heap_[b]);
+  heap_[a]->heap_index_ = a;
+  heap_[b]->heap_index_ = b;
+}
 
-  // Loop ref count reaches zero when both handles are closed.
-  // Close the timer handle on this side and let ~Watchdog() close async_
-  uv_close(reinterpret_cast<uv_handle_t*>(&wd->timer_), nullptr);
+Watchdog::Watchdog(v8::Isolate* isolate, uint64_t ms, bool* timed_out)
+    : isolate_(isolate), timed_out_(timed_out) {
+  constexpr uint64_t kNsPerMs = 1000000;
+  uint64_t now = uv_hrtime();
+  if (ms > (UINT64_MAX - now) / kNsPerMs) {
+    deadline_ = UINT64_MAX;
+  } else {
+    deadline_ = now + ms * kNsPerMs;
+  }
+  WatchdogThread::GetInstance()->Add(this);
 }
 
-void Watchdog::Timer(uv_timer_t* timer) {
-  Watchdog* w = ContainerOf(&Watchdog::timer_, timer);
-  *w->timed_out_ = true;
-  w->isolate()->TerminateExecution();
-  uv_stop(&w->loop_);
+
+Watchdog::~Watchdog() {
+  WatchdogThread::GetInstance()->Remove(this);
 }
 
 
@@ -298,21 +377,23 @@ int SigintWatchdogHelper::Start() {
   }
 
 #ifdef __POSIX__
-  CHECK_EQ(has_running_thread_, false);
   has_pending_signal_ = false;
-  stopping_ = false;
 
-  sigset_t sigmask;
-  sigfillset(&sigmask);
-  sigset_t savemask;
-  CHECK_EQ(0, pthread_sigmask(SIG_SETMASK, &sigmask, &savemask));
-  sigmask = savemask;
-  int ret = pthread_create(&thread_, nullptr, RunSigintWatchdog, nullptr);
-  CHECK_EQ(0, pthread_sigmask(SIG_SETMASK, &sigmask, nullptr));
-  if (ret != 0) {
-    return ret;
+  // The helper thread is kept across Stop() calls, so that only the first
+  // breakOnSigint evaluation of the process pays for creating it.
+  if (!has_running_thread_) {
+    sigset_t sigmask;
+    sigfillset(&sigmask);
+    sigset_t savemask;
+    CHECK_EQ(0, pthread_sigmask(SIG_SETMASK, &sigmask, &savemask));
+    sigmask = savemask;
+    int ret = pthread_create(&thread_, nullptr, RunSigintWatchdog, nullptr);
+    CHECK_EQ(0, pthread_sigmask(SIG_SETMASK, &sigmask, nullptr));
+    if (ret != 0) {
+      return ret;
+    }
+    has_running_thread_ = true;
   }
-  has_running_thread_ = true;
 
   RegisterSignalHandler(SIGINT, HandleSignal);
 #else
@@ -341,28 +422,15 @@ bool SigintWatchdogHelper::Stop() {
       return had_pending_signal;
     }
 
-#ifdef __POSIX__
-    // Set stopping now because it's only protected by list_mutex_.
-    stopping_ = true;
-#endif
-
     watchdogs_.clear();
   }
 
 #ifdef __POSIX__
-  if (!has_running_thread_) {
-    has_pending_signal_ = false;
-    return had_pending_signal;
+  // The helper thread stays parked on sem_ until the next Start(), and only
+  // SIGINT goes back to its default handling.
+  if (has_running_thread_) {
+    RegisterSignalHandler(SIGINT, SignalExit, true);
   }
-
-  // Wake up the helper thread.
-  uv_sem_post(&sem_);
-
-  // Wait for the helper thread to finish.
-  CHECK_EQ(0, pthread_join(thread_, nullptr));
-  has_running_thread_ = false;
-
-  RegisterSignalHandler(SIGINT, SignalExit, true);
 #else
   watchdog_disabled_ = true;
 #endif
@@ -414,7 +482,18 @@ SigintWatchdogHelper::~SigintWatchdogHelper() {
   Stop();
 
 #ifdef __POSIX__
-  CHECK_EQ(has_running_thread_, false);
+  if (has_running_thread_) {
+    {
+      // Set stopping now because it's only protected by list_mutex_.
+      Mutex::ScopedLock list_lock(list_mutex_);
+      stopping_ = true;
+    }
+
+    // Wake up the helper thread and wait for it to finish.
+    uv_sem_post(&sem_);
+    CHECK_EQ(0, pthread_join(thread_, nullptr));
+    has_running_thread_ = false;
+  }
   uv_sem_destroy(&sem_);
 #endif
 }
@@ -42,6 +42,11 @@ enum class SignalPropagation {
   kStopPropagation,
 };
 
+class WatchdogThread;
+
+// Terminates execution on |isolate| if the Watchdog is still alive after
+// |ms| milliseconds. The deadlines of all Watchdogs of the process are served
+// by one shared thread.
 class Watchdog {
  public:
   explicit Watchdog(v8::Isolate* isolate,
@@ -51,15 +56,14 @@ class Watchdog {
   v8::Isolate* isolate() { return isolate_; }
 
  private:
-  static void Run(void* arg);
-  static void Timer(uv_timer_t* timer);
+  friend class WatchdogThread;
 
   v8::Isolate* isolate_;
-  uv_thread_t thread_;
-  uv_loop_t loop_;
-  uv_async_t async_;
-  uv_timer_t timer_;
   bool* timed_out_;
+  // In uv_hrtime() nanoseconds.
+  uint64_t deadline_;
+  // The position in the timer heap of the watchdog thread, while pending.
+  size_t heap_index_;
 };
 
 class SigintWatchdogBase {
@@ -6,6 +6,7 @@
 #include "node.h"
 #include "node_errors.h"
 #include "node_mem-inl.h"
+#include "node_process-inl.h"
 #include "path.h"
 #include "sqlite3.h"
 #include "util-inl.h"
@@ -89,15 +90,27 @@ Storage::Storage(Environment* env,
   symbols_.Reset(env->isolate(), Map::New(env->isolate()));
   db_ = nullptr;
   location_ = std::string(location);
+  env->AtExit(FlushAtExit, this);
 }
 
 Storage::~Storage() {
+  env()->RemoveAtExit(FlushAtExit, this);
+  // This also runs when the environment is torn down, so that writes made
+  // during the last tick are not lost.
+  if (db_) Flush();
   db_ = nullptr;
 }
 
+void Storage::FlushAtExit(void* arg) {
+  Storage* storage = static_cast<Storage*>(arg);
+  // The process is exiting, so there is nobody left to report errors to.
+  if (storage->db_) USE(storage->Flush());
+}
+
 void Storage::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("symbols", symbols_);
   tracker->TrackField("location", location_);
+  tracker->TrackFieldWithSize("items", total_size_);
 }
 
 Maybe<void> Storage::Open() {
@@ -201,10 +214,187 @@ Maybe<void> Storage::Open() {
     CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
   }
 
+  if (LoadItems(db).IsNothing()) {
+    return Nothing<void>();
+  }
+
   db_ = conn_unique_ptr(db);
   return JustVoid();
 }
 
+Maybe<void> Storage::LoadItems(sqlite3* db) {
+  static constexpr std::string_view state_sql =
+      "SELECT max_size, total_size FROM nodejs_webstorage_state";
+  static constexpr std::string_view items_sql =
+      "SELECT key, value FROM nodejs_webstorage";
+
+  sqlite3_stmt* s = nullptr;
+  int r = sqlite3_prepare_v2(db, state_sql.data(), state_sql.size(), &s, 0);
+  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
+  auto stmt = stmt_unique_ptr(s);
+  CHECK_ERROR_OR_THROW(
+      env(), sqlite3_step(stmt.get()), SQLITE_ROW, Nothing<void>());
+  max_size_ = sqlite3_column_int64(stmt.get(), 0);
+  total_size_ = sqlite3_column_int64(stmt.get(), 1);
+
+  r = sqlite3_prepare_v2(db, items_sql.data(), items_sql.size(), &s, 0);
+  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
+  stmt = stmt_unique_ptr(s);
+  items_.clear();
+  while ((r = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+    CHECK(sqlite3_column_type(stmt.get(), 0) == SQLITE_BLOB);
+    CHECK(sqlite3_column_type(stmt.get(), 1) == SQLITE_BLOB);
+    auto key = static_cast<const char16_t*>(sqlite3_column_blob(stmt.get(), 0));
+    auto key_size = sqlite3_column_bytes(stmt.get(), 0) / sizeof(char16_t);
+    auto val = static_cast<const char16_t*>(sqlite3_column_blob(stmt.get(), 1));
+    auto val_size = sqlite3_column_bytes(stmt.get(), 1) / sizeof(char16_t);
+    items_.emplace(std::u16string(key, key_size),
+                   std::u16string(val, val_size));
+  }
+  CHECK_ERROR_OR_THROW(env(), r, SQLITE_DONE, Nothing<void>());
+  return JustVoid();
+}
+
+int Storage::Flush() {
+  static constexpr std::string_view clear_sql =
+      "DELETE FROM nodejs_webstorage";
+  static constexpr std::string_view store_sql =
+      "INSERT INTO nodejs_webstorage (key, value) VALUES (?, ?)"
+      "  ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value"
+      "  WHERE EXCLUDED.key = key";
+  static constexpr std::string_view remove_sql =
+      "DELETE FROM nodejs_webstorage WHERE key = ?";
+  // The quota was enforced when the changes were made, but applying them
+  // in key order can exceed it temporarily, so the triggers are given an
+  // unlimited quota until the transaction is done.
+  static constexpr std::string_view lift_quota_sql =
+      "UPDATE nodejs_webstorage_state SET max_size = 9223372036854775807";
+  static constexpr std::string_view restore_quota_sql =
+      "UPDATE nodejs_webstorage_state SET max_size = ?";
+
+  if (!pending_clear_ && pending_.empty()) {
+    return SQLITE_OK;
+  }
+
+  sqlite3* db = db_.get();
+  int r = sqlite3_exec(db, "BEGIN IMMEDIATE", 0, 0, nullptr);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  bool committed = false;
+  auto rollback = OnScopeLeave([&]() {
+    if (!committed) sqlite3_exec(db, "ROLLBACK", 0, 0, nullptr);
+  });
+
+  r = sqlite3_exec(db, lift_quota_sql.data(), 0, 0, nullptr);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  if (pending_clear_) {
+    r = sqlite3_exec(db, clear_sql.data(), 0, 0, nullptr);
+    if (r != SQLITE_OK) {
+      return r;
+    }
+  }
+
+  sqlite3_stmt* s = nullptr;
+  r = sqlite3_prepare_v2(db, store_sql.data(), store_sql.size(), &s, 0);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  auto store = stmt_unique_ptr(s);
+  r = sqlite3_prepare_v2(db, remove_sql.data(), remove_sql.size(), &s, 0);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  auto remove = stmt_unique_ptr(s);
+
+  for (const auto& [key, value] : pending_) {
+    sqlite3_stmt* stmt = value.has_value() ? store.get() : remove.get();
+    r = sqlite3_bind_blob(stmt,
+                          1,
+                          key.data(),
+                          key.size() * sizeof(char16_t),
+                          SQLITE_STATIC);
+    if (r == SQLITE_OK && value.has_value()) {
+      r = sqlite3_bind_blob(stmt,
+                            2,
+                            value->data(),
+                            value->size() * sizeof(char16_t),
+                            SQLITE_STATIC);
+    }
+    if (r == SQLITE_OK) {
+      r = sqlite3_step(stmt);
+    }
+    sqlite3_reset(stmt);
+    if (r != SQLITE_DONE) {
+      return r;
+    }
+  }
+
+  r = sqlite3_prepare_v2(
+      db, restore_quota_sql.data(), restore_quota_sql.size(), &s, 0);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  auto restore_quota = stmt_unique_ptr(s);
+  r = sqlite3_bind_int64(restore_quota.get(), 1, max_size_);
+  if (r == SQLITE_OK) {
+    r = sqlite3_step(restore_quota.get());
+  }
+  if (r != SQLITE_DONE) {
+    return r;
+  }
+
+  r = sqlite3_exec(db, "COMMIT", 0, 0, nullptr);
+  if (r != SQLITE_OK) {
+    return r;
+  }
+  committed = true;
+  pending_.clear();
+  pending_clear_ = false;
+  return SQLITE_OK;
+}
+
+void Storage::DropPendingChanges() {
+  pending_.clear();
+  pending_clear_ = false;
+  items_.clear();
+  // Reopen the database on the next access, which reloads the items.
+  db_ = nullptr;
+}
+
+Maybe<void> Storage::FlushOrThrow() {
+  int r = Flush();
+  if (r != SQLITE_OK) {
+    DropPendingChanges();
+    THROW_SQLITE_ERROR(env(), r);
+    return Nothing<void>();
+  }
+  return JustVoid();
+}
+
+void Storage::ScheduleFlush() {
+  if (flush_scheduled_) {
+    return;
+  }
+  flush_scheduled_ = true;
+  env()->SetImmediate([self = BaseObjectPtr<Storage>(this)](Environment* env) {
+    self->flush_scheduled_ = false;
+    if (!self->db_) {
+      return;
+    }
+    int r = self->Flush();
+    if (r != SQLITE_OK) {
+      self->DropPendingChanges();
+      if (env->can_call_into_js()) {
+        ProcessEmitWarning(
+            env, "Failed to write to localStorage: %s", sqlite3_errstr(r));
+      }
+    }
+  });
+}
+
 void Storage::New(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Realm* realm = Realm::GetCurrent(args);
@@ -232,45 +422,46 @@ Maybe<void> Storage::Clear() {
     return Nothing<void>();
   }
 
-  static constexpr std::string_view sql = "DELETE FROM nodejs_webstorage";
-  sqlite3_stmt* s = nullptr;
-  CHECK_ERROR_OR_THROW(
-      env(),
-      sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0),
-      SQLITE_OK,
-      Nothing<void>());
-  auto stmt = stmt_unique_ptr(s);
-  CHECK_ERROR_OR_THROW(
-      env(), sqlite3_step(stmt.get()), SQLITE_DONE, Nothing<void>());
+  items_.clear();
+  pending_.clear();
+  pending_clear_ = true;
+  total_size_ = 0;
+  ScheduleFlush();
   return JustVoid();
 }
 
+static MaybeLocal<String> ToV8String(Isolate* isolate,
+                                     const std::u16string& str) {
+  return String::NewFromTwoByte(isolate,
+                                reinterpret_cast<const uint16_t*>(str.data()),
+                                NewStringType::kNormal,
+                                str.size());
+}
+
+static std::u16string ToU16String(Isolate* isolate, Local<Value> value) {
+  TwoByteValue utf16(isolate, value);
+  return std::u16string(reinterpret_cast<const char16_t*>(utf16.out()),
+                        utf16.length());
+}
+
+static int64_t ByteLength(const std::u16string& str) {
+  return static_cast<int64_t>(str.size() * sizeof(char16_t));
+}
+
 MaybeLocal<Array> Storage::Enumerate() {
   if (!Open().IsJust()) {
     return Local<Array>();
   }
 
-  static constexpr std::string_view sql = "SELECT key FROM nodejs_webstorage";
-  sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Array>());
-  auto stmt = stmt_unique_ptr(s);
   std::vector<Local<Value>> values;
-  Local<Value> value;
-  while ((r = sqlite3_step(stmt.get())) == SQLITE_ROW) {
-    CHECK(sqlite3_column_type(stmt.get(), 0) == SQLITE_BLOB);
-    auto size = sqlite3_column_bytes(stmt.get(), 0) / sizeof(uint16_t);
-    if (!String::NewFromTwoByte(env()->isolate(),
-                                reinterpret_cast<const uint16_t*>(
-                                    sqlite3_column_blob(stmt.get(), 0)),
-                                NewStringType::kNormal,
-                                size)
-             .ToLocal(&value)) {
+  values.reserve(items_.size());
+  Local<String> value;
+  for (const auto& [key, unused] : items_) {
+    if (!ToV8String(env()->isolate(), key).ToLocal(&value)) {
       return Local<Array>();
     }
     values.emplace_back(value);
   }
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_DONE, Local<Array>());
   return Array::New(env()->isolate(), values.data(), values.size());
 }
 
@@ -279,17 +470,7 @@ MaybeLocal<Value> Storage::Length() {
     return {};
   }
 
-  static constexpr std::string_view sql =
-      "SELECT count(*) FROM nodejs_webstorage";
-  sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Value>());
-  auto stmt = stmt_unique_ptr(s);
-  CHECK_ERROR_OR_THROW(
-      env(), sqlite3_step(stmt.get()), SQLITE_ROW, Local<Value>());
-  CHECK(sqlite3_column_type(stmt.get(), 0) == SQLITE_INTEGER);
-  int result = sqlite3_column_int(stmt.get(), 0);
-  return Integer::New(env()->isolate(), result);
+  return Integer::NewFromUnsigned(env()->isolate(), items_.size());
 }
 
 MaybeLocal<Value> Storage::Load(Local<Name> key) {
@@ -302,32 +483,11 @@ MaybeLocal<Value> Storage::Load(Local<Name> key) {
     return {};
   }
 
-  static constexpr std::string_view sql =
-      "SELECT value FROM nodejs_webstorage WHERE key = ? LIMIT 1";
-  sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Value>());
-  auto stmt = stmt_unique_ptr(s);
-  TwoByteValue utf16key(env()->isolate(), key);
-  auto key_size = utf16key.length() * sizeof(uint16_t);
-  r = sqlite3_bind_blob(stmt.get(), 1, utf16key.out(), key_size, SQLITE_STATIC);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Value>());
-  r = sqlite3_step(stmt.get());
-  if (r == SQLITE_ROW) {
-    CHECK(sqlite3_column_type(stmt.get(), 0) == SQLITE_BLOB);
-    auto size = sqlite3_column_bytes(stmt.get(), 0) / sizeof(uint16_t);
-    return String::NewFromTwoByte(env()->isolate(),
-                                  reinterpret_cast<const uint16_t*>(
-                                      sqlite3_column_blob(stmt.get(), 0)),
-                                  NewStringType::kNormal,
-                                  size)
-        .As<Value>();
-  } else if (r != SQLITE_DONE) {
-    THROW_SQLITE_ERROR(env(), r);
-    return {};
-  } else {
+  auto it = items_.find(ToU16String(env()->isolate(), key));
+  if (it == items_.end()) {
     return Null(env()->isolate());
   }
+  return ToV8String(env()->isolate(), it->second).As<Value>();
 }
 
 MaybeLocal<Value> Storage::LoadKey(const int index) {
@@ -335,31 +495,11 @@ MaybeLocal<Value> Storage::LoadKey(const int index) {
     return {};
   }
 
-  static constexpr std::string_view sql =
-      "SELECT key FROM nodejs_webstorage LIMIT 1 OFFSET ?";
-  sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Value>());
-  auto stmt = stmt_unique_ptr(s);
-  r = sqlite3_bind_int(stmt.get(), 1, index);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Local<Value>());
-
-  r = sqlite3_step(stmt.get());
-  if (r == SQLITE_ROW) {
-    CHECK(sqlite3_column_type(stmt.get(), 0) == SQLITE_BLOB);
-    auto size = sqlite3_column_bytes(stmt.get(), 0) / sizeof(uint16_t);
-    return String::NewFromTwoByte(env()->isolate(),
-                                  reinterpret_cast<const uint16_t*>(
-                                      sqlite3_column_blob(stmt.get(), 0)),
-                                  NewStringType::kNormal,
-                                  size)
-        .As<Value>();
-  } else if (r != SQLITE_DONE) {
-    THROW_SQLITE_ERROR(env(), r);
-    return {};
-  } else {
+  if (index < 0 || static_cast<size_t>(index) >= items_.size()) {
     return Null(env()->isolate());
   }
+  return ToV8String(env()->isolate(), std::next(items_.begin(), index)->first)
+      .As<Value>();
 }
 
 Maybe<void> Storage::Remove(Local<Name> key) {
@@ -373,18 +513,18 @@ Maybe<void> Storage::Remove(Local<Name> key) {
     return Nothing<void>();
   }
 
-  static constexpr std::string_view sql =
-      "DELETE FROM nodejs_webstorage WHERE key = ?";
-  sqlite3_stmt* s = nullptr;
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
-  auto stmt = stmt_unique_ptr(s);
-  TwoByteValue utf16key(env()->isolate(), key);
-  auto key_size = utf16key.length() * sizeof(uint16_t);
-  r = sqlite3_bind_blob(stmt.get(), 1, utf16key.out(), key_size, SQLITE_STATIC);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
-  CHECK_ERROR_OR_THROW(
-      env(), sqlite3_step(stmt.get()), SQLITE_DONE, Nothing<void>());
+  auto it = items_.find(ToU16String(env()->isolate(), key));
+  if (it == items_.end()) {
+    return JustVoid();
+  }
+  total_size_ -= ByteLength(it->first) + ByteLength(it->second);
+  pending_.insert_or_assign(it->first, std::nullopt);
+  items_.erase(it);
+
+  if (pending_.size() >= kMaxPendingWrites) {
+    return FlushOrThrow();
+  }
+  ScheduleFlush();
   return JustVoid();
 }
 
@@ -404,30 +544,29 @@ Maybe<void> Storage::Store(Local<Name> key, Local<Value> value) {
     return Nothing<void>();
   }
 
-  static constexpr std::string_view sql =
-      "INSERT INTO nodejs_webstorage (key, value) VALUES (?, ?)"
-      "  ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value"
-      "  WHERE EXCLUDED.key = key";
-  sqlite3_stmt* s = nullptr;
-  TwoByteValue utf16key(env()->isolate(), key);
-  TwoByteValue utf16val(env()->isolate(), val);
-  int r = sqlite3_prepare_v2(db_.get(), sql.data(), sql.size(), &s, 0);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
-  auto stmt = stmt_unique_ptr(s);
-  auto key_size = utf16key.length() * sizeof(uint16_t);
-  r = sqlite3_bind_blob(stmt.get(), 1, utf16key.out(), key_size, SQLITE_STATIC);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
-  auto val_size = utf16val.length() * sizeof(uint16_t);
-  r = sqlite3_bind_blob(stmt.get(), 2, utf16val.out(), val_size, SQLITE_STATIC);
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_OK, Nothing<void>());
-
-  r = sqlite3_step(stmt.get());
-  if (r == SQLITE_CONSTRAINT) {
+  std::u16string utf16key = ToU16String(env()->isolate(), key);
+  std::u16string utf16val = ToU16String(env()->isolate(), val);
+  auto it = items_.find(utf16key);
+  int64_t new_size = total_size_ + ByteLength(utf16val) +
+                     (it == items_.end() ? ByteLength(utf16key)
+                                         : -ByteLength(it->second));
+  // Mirrors the triggers of the nodejs_webstorage table.
+  if (new_size > max_size_) {
     ThrowQuotaExceededException(env()->context());
     return Nothing<void>();
   }
+  total_size_ = new_size;
+  if (it == items_.end()) {
+    items_.emplace(utf16key, utf16val);
+  } else {
+    it->second = utf16val;
+  }
+  pending_.insert_or_assign(std::move(utf16key), std::move(utf16val));
 
-  CHECK_ERROR_OR_THROW(env(), r, SQLITE_DONE, Nothing<void>());
+  if (pending_.size() >= kMaxPendingWrites) {
+    return FlushOrThrow();
+  }
+  ScheduleFlush();
   return JustVoid();
 }
 
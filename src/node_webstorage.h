@@ -8,6 +8,10 @@
 #include "sqlite3.h"
 #include "util.h"
 
+#include <map>
+#include <optional>
+#include <string>
+
 namespace node {
 namespace webstorage {
 
@@ -45,12 +49,40 @@ class Storage : public BaseObject {
   SET_SELF_SIZE(Storage)
 
  private:
+  // Flush synchronously once this many keys have pending changes.
+  static constexpr size_t kMaxPendingWrites = 1024;
+
   v8::Maybe<void> Open();
+  v8::Maybe<void> LoadItems(sqlite3* db);
+  // Writes the pending changes to the database in one transaction, and
+  // returns the SQLite result code. Does not call into JavaScript.
+  int Flush();
+  // Like Flush(), but throws if the changes could not be written. They are
+  // dropped in that case, and the items are reloaded from the database.
+  v8::Maybe<void> FlushOrThrow();
+  void DropPendingChanges();
+  void ScheduleFlush();
+  // Writes the pending changes when process.exit() is called, which does
+  // not wait for the immediate of ScheduleFlush().
+  static void FlushAtExit(void* arg);
 
   ~Storage() override;
   std::string location_;
   conn_unique_ptr db_;
   v8::Global<v8::Map> symbols_;
+  // All items, loaded when the database is opened. Reads are served from
+  // here, and writes are applied here before they reach the database.
+  std::map<std::u16string, std::u16string> items_;
+  // The changes that are not in the database yet, std::nullopt for removed
+  // keys. They are written at the end of the tick.
+  std::map<std::u16string, std::optional<std::u16string>> pending_;
+  // Whether the table has to be cleared before pending_ is written.
+  bool pending_clear_ = false;
+  bool flush_scheduled_ = false;
+  // The size of the keys and values in bytes, and its quota, as tracked by
+  // the nodejs_webstorage_state table.
+  int64_t total_size_ = 0;
+  int64_t max_size_ = 0;
 };
 
 }  // namespace webstorage
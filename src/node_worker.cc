@@ -8,11 +8,13 @@
 #include "node_external_reference.h"
 #include "node_options-inl.h"
 #include "node_perf.h"
+#include "node_process-inl.h"
 #include "node_snapshot_builder.h"
 #include "permission/permission.h"
 #include "util-inl.h"
 #include "v8-cppgc.h"
 
+#include <ctime>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,7 +28,9 @@ using v8::Context;
 using v8::Float64Array;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
 using v8::HandleScope;
+using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
@@ -40,6 +44,7 @@ using v8::ResourceConstraints;
 using v8::SealHandleScope;
 using v8::String;
 using v8::TryCatch;
+using v8::Uint32;
 using v8::Value;
 
 namespace node {
@@ -142,73 +147,44 @@ void Worker::UpdateResourceConstraints(ResourceConstraints* constraints) {
 class WorkerThreadData {
  public:
   explicit WorkerThreadData(Worker* w)
-    : w_(w) {
-    int ret = uv_loop_init(&loop_);
-    if (ret != 0) {
-      char err_buf[128];
-      uv_err_name_r(ret, err_buf, sizeof(err_buf));
+    : platform_(w->platform_), stack_base_(w->stack_base_) {
+    std::string error = Init(w->snapshot_data(),
+                             std::move(w->per_isolate_opts_),
+                             [w](ResourceConstraints* constraints) {
+                               w->UpdateResourceConstraints(constraints);
+                             });
+    if (!error.empty()) {
       // TODO(joyeecheung): maybe this should be kBootstrapFailure instead?
-      w->Exit(ExitCode::kGenericUserError, "ERR_WORKER_INIT_FAILED", err_buf);
+      w->Exit(
+          ExitCode::kGenericUserError, "ERR_WORKER_INIT_FAILED", error.c_str());
       return;
     }
-    loop_init_failed_ = false;
-    uv_loop_configure(&loop_, UV_METRICS_IDLE_TIME);
-
-    std::shared_ptr<ArrayBufferAllocator> allocator =
-        ArrayBufferAllocator::Create();
-    Isolate::CreateParams params;
-    SetIsolateCreateParamsForNode(&params);
-    w->UpdateResourceConstraints(&params.constraints);
-    params.array_buffer_allocator_shared = allocator;
-    Isolate* isolate =
-        NewIsolate(&params, &loop_, w->platform_, w->snapshot_data());
-    if (isolate == nullptr) {
-      // TODO(joyeecheung): maybe this should be kBootstrapFailure instead?
-      w->Exit(ExitCode::kGenericUserError,
-              "ERR_WORKER_INIT_FAILED",
-              "Failed to create new Isolate");
-      return;
-    }
-
-    SetIsolateUpForNode(isolate);
-
-    // Be sure it's called before Environment::InitializeDiagnostics()
-    // so that this callback stays when the callback of
-    // --heapsnapshot-near-heap-limit gets is popped.
-    isolate->AddNearHeapLimitCallback(Worker::NearHeapLimit, w);
-
-    {
-      Locker locker(isolate);
-      Isolate::Scope isolate_scope(isolate);
-      // V8 computes its stack limit the first time a `Locker` is used based on
-      // --stack-size. Reset it to the correct value.
-      isolate->SetStackLimit(w->stack_base_);
-
-      HandleScope handle_scope(isolate);
-      isolate_data_.reset(IsolateData::CreateIsolateData(
-          isolate,
-          &loop_,
-          w_->platform_,
-          allocator.get(),
-          w->snapshot_data()->AsEmbedderWrapper().get(),
-          std::move(w_->per_isolate_opts_)));
-      CHECK(isolate_data_);
-      CHECK(!isolate_data_->is_building_snapshot());
-      isolate_data_->set_worker_context(w_);
-      isolate_data_->max_young_gen_size =
-          params.constraints.max_young_generation_size_in_bytes();
-    }
+    Attach(w);
+  }
 
-    Mutex::ScopedLock lock(w_->mutex_);
-    w_->isolate_ = isolate;
+  // Sets up the loop, the Isolate and a Context ahead of time, on a thread
+  // of a PrewarmedWorkerPool, with the default resource limits.
+  WorkerThreadData(MultiIsolatePlatform* platform,
+                   const SnapshotData* snapshot_data,
+                   std::shared_ptr<PerIsolateOptions> per_isolate_opts,
+                   uintptr_t stack_base)
+    : platform_(platform), stack_base_(stack_base) {
+    std::string error = Init(snapshot_data,
+                             std::move(per_isolate_opts),
+                             [&](ResourceConstraints* constraints) {
+                               constraints->set_stack_limit(
+                                   reinterpret_cast<uint32_t*>(stack_base));
+                             });
+    if (error.empty()) CreatePrewarmedContext(snapshot_data);
   }
 
   ~WorkerThreadData() {
-    Debug(w_, "Worker %llu dispose isolate", w_->thread_id_.id);
-    Isolate* isolate;
-    {
+    if (w_ != nullptr)
+      Debug(w_, "Worker %llu dispose isolate", w_->thread_id_.id);
+    Isolate* isolate = isolate_;
+    if (w_ != nullptr) {
       Mutex::ScopedLock lock(w_->mutex_);
-      isolate = w_->isolate_;
+      CHECK_EQ(isolate, w_->isolate_);
       w_->isolate_ = nullptr;
     }
 
@@ -221,10 +197,11 @@ class WorkerThreadData {
       {
         Locker locker(isolate);
         Isolate::Scope isolate_scope(isolate);
+        context_.Reset();
         isolate_data_.reset();
       }
 
-      w_->platform_->AddIsolateFinishedCallback(isolate, [](void* data) {
+      platform_->AddIsolateFinishedCallback(isolate, [](void* data) {
         *static_cast<bool*>(data) = true;
       }, &platform_finished);
 
@@ -233,7 +210,7 @@ class WorkerThreadData {
       // new Isolate at the same address can successfully be registered with
       // the platform.
       // (Refs: https://github.com/nodejs/node/issues/30846)
-      w_->platform_->UnregisterIsolate(isolate);
+      platform_->UnregisterIsolate(isolate);
       isolate->Dispose();
 
       // Wait until the platform has cleaned up all relevant resources.
@@ -247,16 +224,375 @@ class WorkerThreadData {
   }
 
   bool loop_is_usable() const { return !loop_init_failed_; }
+  bool is_usable() const { return isolate_ != nullptr; }
+
+  // Hands the data over to `w`, whose thread this now is.
+  void Attach(Worker* w) {
+    w_ = w;
+    // Be sure it's called before Environment::InitializeDiagnostics()
+    // so that this callback stays when the callback of
+    // --heapsnapshot-near-heap-limit gets is popped.
+    isolate_->AddNearHeapLimitCallback(Worker::NearHeapLimit, w);
+    isolate_data_->set_worker_context(w);
+
+    Mutex::ScopedLock lock(w->mutex_);
+    for (int i = 0; i < kStackSizeMb; i++) {
+      if (w->resource_limits_[i] <= 0)
+        w->resource_limits_[i] = default_limits_[i];
+    }
+    w->isolate_ = isolate_;
+  }
 
  private:
-  Worker* const w_;
+  // Returns an error message on failure.
+  template <typename UpdateConstraints>
+  std::string Init(const SnapshotData* snapshot_data,
+                   std::shared_ptr<PerIsolateOptions> per_isolate_opts,
+                   UpdateConstraints update_constraints) {
+    int ret = uv_loop_init(&loop_);
+    if (ret != 0) {
+      char err_buf[128];
+      uv_err_name_r(ret, err_buf, sizeof(err_buf));
+      return err_buf;
+    }
+    loop_init_failed_ = false;
+    uv_loop_configure(&loop_, UV_METRICS_IDLE_TIME);
+
+    std::shared_ptr<ArrayBufferAllocator> allocator =
+        ArrayBufferAllocator::Create();
+    Isolate::CreateParams params;
+    SetIsolateCreateParamsForNode(&params);
+    update_constraints(&params.constraints);
+    default_limits_[kMaxYoungGenerationSizeMb] =
+        params.constraints.max_young_generation_size_in_bytes() / kMB;
+    default_limits_[kMaxOldGenerationSizeMb] =
+        params.constraints.max_old_generation_size_in_bytes() / kMB;
+    default_limits_[kCodeRangeSizeMb] =
+        params.constraints.code_range_size_in_bytes() / kMB;
+    params.array_buffer_allocator_shared = allocator;
+    Isolate* isolate = NewIsolate(&params, &loop_, platform_, snapshot_data);
+    if (isolate == nullptr) return "Failed to create new Isolate";
+
+    SetIsolateUpForNode(isolate);
+
+    {
+      Locker locker(isolate);
+      Isolate::Scope isolate_scope(isolate);
+      // V8 computes its stack limit the first time a `Locker` is used based on
+      // --stack-size. Reset it to the correct value.
+      isolate->SetStackLimit(stack_base_);
+
+      HandleScope handle_scope(isolate);
+      isolate_data_.reset(IsolateData::CreateIsolateData(
+          isolate,
+          &loop_,
+          platform_,
+          allocator.get(),
+          snapshot_data->AsEmbedderWrapper().get(),
+          std::move(per_isolate_opts)));
+      CHECK(isolate_data_);
+      CHECK(!isolate_data_->is_building_snapshot());
+      isolate_data_->max_young_gen_size =
+          params.constraints.max_young_generation_size_in_bytes();
+    }
+
+    isolate_ = isolate;
+    return {};
+  }
+
+  void CreatePrewarmedContext(const SnapshotData* snapshot_data) {
+    Locker locker(isolate_);
+    Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope(isolate_);
+    TryCatch try_catch(isolate_);
+    Local<Context> context;
+    if (snapshot_data != nullptr) {
+      if (!Context::FromSnapshot(isolate_,
+                                 SnapshotData::kNodeBaseContextIndex)
+               .ToLocal(&context) ||
+          !InitializeContextRuntime(context).IsJust()) {
+        return;
+      }
+    } else {
+      context = NewContext(isolate_);
+    }
+    // Without a Context, Worker::Run() creates one as usual.
+    if (!context.IsEmpty()) context_.Reset(isolate_, context);
+  }
+
+  Worker* w_ = nullptr;
+  MultiIsolatePlatform* const platform_;
+  const uintptr_t stack_base_;
   uv_loop_t loop_;
   bool loop_init_failed_ = true;
+  Isolate* isolate_ = nullptr;
   DeleteFnPtr<IsolateData, FreeIsolateData> isolate_data_;
-  const SnapshotData* snapshot_data_ = nullptr;
+  // A Context created ahead of time by a PrewarmedWorkerPool thread.
+  Global<Context> context_;
+  double default_limits_[kStackSizeMb] = {};
   friend class Worker;
+  friend class PrewarmedWorkerPool;
+};
+
+// Keeps threads whose event loop, Isolate and Context have already been
+// created from the parent's snapshot (the built-in one, or the one the
+// process was started from), so that a Worker started on one of them only
+// has to bootstrap its Environment. Only Workers that use the parent's
+// options and the default resource limits can be started this way.
+// A thread that is not claimed within the idle timeout disposes of its
+// Isolate and exits. The pool is topped up whenever a Worker is started.
+class PrewarmedWorkerPool {
+ public:
+  struct Stats {
+    uint64_t ready;
+    uint64_t warming;
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  // A size of zero stops all idle threads. The idle timeout applies to
+  // threads started afterwards; zero keeps them until they are claimed.
+  static void Configure(Environment* env,
+                        size_t size,
+                        uint64_t idle_timeout_ms);
+
+  // Starts `w` on a prewarmed thread, whose ID is stored in `tid`. Returns
+  // false if no thread is ready.
+  static bool Claim(Environment* env, Worker* w, uv_thread_t* tid);
+
+  static Stats GetStats(Environment* env);
+
+ private:
+  struct Thread {
+    enum State { kWarming, kReady, kClaimed, kStopping, kExited };
+
+    Mutex mutex;
+    ConditionVariable cond;
+    State state = kWarming;
+    Worker* worker = nullptr;
+    uv_thread_t tid;
+
+    // Only read by the thread before it is ready.
+    MultiIsolatePlatform* platform;
+    const SnapshotData* snapshot_data;
+    std::shared_ptr<PerIsolateOptions> per_isolate_opts;
+    uint64_t idle_timeout_ns;
+  };
+
+  explicit PrewarmedWorkerPool(Environment* env);
+  ~PrewarmedWorkerPool();
+
+  static PrewarmedWorkerPool* Get(Environment* env, bool create);
+  static void ThreadMain(void* arg);
+
+  // Joins threads that have exited and starts new ones up to size_.
+  void TopUp();
+
+  Environment* const env_;
+  size_t size_ = 0;
+  uint64_t idle_timeout_ns_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  std::vector<std::shared_ptr<Thread>> threads_;
+
+  static Mutex pools_mutex_;
+  static std::unordered_map<Environment*, PrewarmedWorkerPool*> pools_;
 };
 
+Mutex PrewarmedWorkerPool::pools_mutex_;
+std::unordered_map<Environment*, PrewarmedWorkerPool*>
+    PrewarmedWorkerPool::pools_;
+
+PrewarmedWorkerPool::PrewarmedWorkerPool(Environment* env) : env_(env) {
+  env->AddCleanupHook(
+      [](void* data) { delete static_cast<PrewarmedWorkerPool*>(data); },
+      this);
+}
+
+PrewarmedWorkerPool::~PrewarmedWorkerPool() {
+  {
+    Mutex::ScopedLock lock(pools_mutex_);
+    pools_.erase(env_);
+  }
+  for (const auto& thread : threads_) {
+    Mutex::ScopedLock lock(thread->mutex);
+    if (thread->state == Thread::kWarming || thread->state == Thread::kReady) {
+      thread->state = Thread::kStopping;
+      thread->cond.Signal(lock);
+    }
+  }
+  for (const auto& thread : threads_)
+    CHECK_EQ(uv_thread_join(&thread->tid), 0);
+}
+
+PrewarmedWorkerPool* PrewarmedWorkerPool::Get(Environment* env, bool create) {
+  Mutex::ScopedLock lock(pools_mutex_);
+  auto it = pools_.find(env);
+  if (it != pools_.end()) return it->second;
+  if (!create) return nullptr;
+  PrewarmedWorkerPool* pool = new PrewarmedWorkerPool(env);
+  pools_.emplace(env, pool);
+  return pool;
+}
+
+void PrewarmedWorkerPool::Configure(Environment* env,
+                                    size_t size,
+                                    uint64_t idle_timeout_ms) {
+  PrewarmedWorkerPool* pool = Get(env, size > 0);
+  if (pool == nullptr) return;
+  pool->size_ = size;
+  pool->idle_timeout_ns_ = idle_timeout_ms * 1000000;
+
+  size_t kept = 0;
+  for (const auto& thread : pool->threads_) {
+    Mutex::ScopedLock lock(thread->mutex);
+    if (thread->state != Thread::kWarming && thread->state != Thread::kReady)
+      continue;
+    if (++kept > size) {
+      thread->state = Thread::kStopping;
+      thread->cond.Signal(lock);
+    }
+  }
+  pool->TopUp();
+}
+
+bool PrewarmedWorkerPool::Claim(Environment* env,
+                                Worker* w,
+                                uv_thread_t* tid) {
+  PrewarmedWorkerPool* pool = Get(env, false);
+  if (pool == nullptr) return false;
+
+  bool claimed = false;
+  for (auto it = pool->threads_.begin(); it != pool->threads_.end(); ++it) {
+    Thread* thread = it->get();
+    Mutex::ScopedLock lock(thread->mutex);
+    if (thread->state != Thread::kReady) continue;
+    thread->state = Thread::kClaimed;
+    thread->worker = w;
+    thread->cond.Signal(lock);
+    *tid = thread->tid;
+    claimed = true;
+    // The Worker joins the thread from now on.
+    pool->threads_.erase(it);
+    break;
+  }
+
+  if (claimed)
+    pool->hits_++;
+  else
+    pool->misses_++;
+  pool->TopUp();
+  return claimed;
+}
+
+PrewarmedWorkerPool::Stats PrewarmedWorkerPool::GetStats(Environment* env) {
+  Stats stats{};
+  PrewarmedWorkerPool* pool = Get(env, false);
+  if (pool == nullptr) return stats;
+  stats.hits = pool->hits_;
+  stats.misses = pool->misses_;
+  for (const auto& thread : pool->threads_) {
+    Mutex::ScopedLock lock(thread->mutex);
+    if (thread->state == Thread::kReady) stats.ready++;
+    if (thread->state == Thread::kWarming) stats.warming++;
+  }
+  return stats;
+}
+
+void PrewarmedWorkerPool::TopUp() {
+  size_t active = 0;
+  for (auto it = threads_.begin(); it != threads_.end();) {
+    Thread* thread = it->get();
+    Thread::State state;
+    {
+      Mutex::ScopedLock lock(thread->mutex);
+      state = thread->state;
+    }
+    if (state == Thread::kExited) {
+      CHECK_EQ(uv_thread_join(&thread->tid), 0);
+      it = threads_.erase(it);
+      continue;
+    }
+    if (state == Thread::kWarming || state == Thread::kReady) active++;
+    ++it;
+  }
+
+  IsolateData* isolate_data = env_->isolate_data();
+  while (active < size_) {
+    auto thread = std::make_shared<Thread>();
+    thread->platform = isolate_data->platform();
+    thread->snapshot_data = isolate_data->snapshot_data();
+    thread->per_isolate_opts = isolate_data->options()->Clone();
+    thread->idle_timeout_ns = idle_timeout_ns_;
+
+    uv_thread_options_t thread_options;
+    thread_options.flags = UV_THREAD_HAS_STACK_SIZE;
+    thread_options.stack_size = Worker::kDefaultStackSize;
+    auto* arg = new std::shared_ptr<Thread>(thread);
+    if (uv_thread_create_ex(
+            &thread->tid, &thread_options, ThreadMain, arg) != 0) {
+      delete arg;
+      break;
+    }
+    threads_.push_back(std::move(thread));
+    active++;
+  }
+}
+
+void PrewarmedWorkerPool::ThreadMain(void* arg) {
+  std::shared_ptr<Thread> thread =
+      std::move(*static_cast<std::shared_ptr<Thread>*>(arg));
+  delete static_cast<std::shared_ptr<Thread>*>(arg);
+  // Same stack layout as a thread started by Worker::StartThread().
+  const uintptr_t stack_top = reinterpret_cast<uintptr_t>(&arg);
+  const uintptr_t stack_base =
+      stack_top - (Worker::kDefaultStackSize - Worker::kStackBufferSize);
+
+  auto data = std::make_unique<WorkerThreadData>(
+      thread->platform,
+      thread->snapshot_data,
+      std::move(thread->per_isolate_opts),
+      stack_base);
+
+  Worker* w = nullptr;
+  {
+    Mutex::ScopedLock lock(thread->mutex);
+    if (data->is_usable() && thread->state == Thread::kWarming) {
+      thread->state = Thread::kReady;
+      const uint64_t deadline = uv_hrtime() + thread->idle_timeout_ns;
+      while (thread->state == Thread::kReady) {
+        if (thread->idle_timeout_ns == 0) {
+          thread->cond.Wait(lock);
+          continue;
+        }
+        const uint64_t now = uv_hrtime();
+        if (now >= deadline ||
+            !thread->cond.TimedWait(lock, deadline - now)) {
+          if (thread->state == Thread::kReady)
+            thread->state = Thread::kStopping;
+        }
+      }
+    }
+    if (thread->state == Thread::kClaimed) {
+      w = thread->worker;
+    } else {
+      thread->state = Thread::kStopping;
+    }
+  }
+
+  if (w == nullptr) {
+    // Dispose of the Isolate before the parent may join this thread.
+    data.reset();
+    Mutex::ScopedLock lock(thread->mutex);
+    thread->state = Thread::kExited;
+    return;
+  }
+
+  w->stack_base_ = stack_base;
+  w->Run(std::move(data));
+  Worker::FinishThread(w);
+}
+
 size_t Worker::NearHeapLimit(void* data, size_t current_heap_limit,
                              size_t initial_heap_limit) {
   Worker* worker = static_cast<Worker*>(data);
@@ -280,18 +616,26 @@ size_t Worker::NearHeapLimit(void* data, size_t current_heap_limit,
   return new_limit;
 }
 
-void Worker::Run() {
+void Worker::Run(std::unique_ptr<WorkerThreadData> prewarmed) {
   std::string trace_name = "[worker " + std::to_string(thread_id_.id) + "]" +
                            (name_ == "" ? "" : " " + name_);
   TRACE_EVENT_METADATA1(
       "__metadata", "thread_name", "name", TRACE_STR_COPY(trace_name.c_str()));
   CHECK_NOT_NULL(platform_);
 
+  ApplyThreadScheduling();
+
   Debug(this, "Creating isolate for worker with id %llu", thread_id_.id);
 
-  WorkerThreadData data(this);
+  std::unique_ptr<WorkerThreadData> data = std::move(prewarmed);
+  if (data) {
+    Debug(this, "Worker %llu uses a prewarmed isolate", thread_id_.id);
+    data->Attach(this);
+  } else {
+    data = std::make_unique<WorkerThreadData>(this);
+  }
   if (isolate_ == nullptr) return;
-  CHECK(data.loop_is_usable());
+  CHECK(data->loop_is_usable());
 
   Debug(this, "Starting worker with id %llu", thread_id_.id);
   {
@@ -308,6 +652,7 @@ void Worker::Run() {
 
       if (!env_) return;
       env_->set_can_call_into_js(false);
+      child_port_.reset();
 
       {
         Mutex::ScopedLock lock(mutex_);
@@ -328,7 +673,10 @@ void Worker::Run() {
         // resource constraints, we need something in place to handle it,
         // though.
         TryCatch try_catch(isolate_);
-        if (snapshot_data_ != nullptr) {
+        if (!data->context_.IsEmpty()) {
+          context = data->context_.Get(isolate_);
+          data->context_.Reset();
+        } else if (snapshot_data_ != nullptr) {
           Debug(this,
                 "Worker %llu uses context from snapshot %d\n",
                 thread_id_.id,
@@ -362,7 +710,7 @@ void Worker::Run() {
         environment_flags_ |= EnvironmentFlags::kNoWaitForInspectorFrontend;
 #endif
         env_.reset(CreateEnvironment(
-            data.isolate_data_.get(),
+            data->isolate_data_.get(),
             context,
             std::move(argv_),
             std::move(exec_argv_),
@@ -393,6 +741,11 @@ void Worker::Run() {
         }
 
         Debug(this, "Created message port for worker %llu", thread_id_.id);
+        StartMetrics(env_.get());
+        for (const std::string& warning : scheduling_warnings_) {
+          if (ProcessEmitWarning(env_.get(), "%s", warning).IsNothing())
+            return;
+        }
         if (LoadEnvironment(env_.get(),
                             StartExecutionCallback{},
                             std::move(embedder_preload_))
@@ -421,6 +774,34 @@ void Worker::Run() {
   Debug(this, "Worker %llu thread stops", thread_id_.id);
 }
 
+void Worker::ApplyThreadScheduling() {
+  uv_thread_t self = uv_thread_self();
+  char err_buf[128];
+
+  if (!cpu_mask_.empty()) {
+    int err = uv_thread_setaffinity(
+        &self, cpu_mask_.data(), nullptr, cpu_mask_.size());
+    if (err != 0) {
+      uv_err_name_r(err, err_buf, sizeof(err_buf));
+      scheduling_warnings_.push_back(
+          SPrintF("Could not set the CPU affinity of worker %d: %s",
+                  thread_id_.id,
+                  err_buf));
+    }
+  }
+
+  if (thread_priority_.has_value()) {
+    int err = uv_thread_setpriority(self, thread_priority_.value());
+    if (err != 0) {
+      uv_err_name_r(err, err_buf, sizeof(err_buf));
+      scheduling_warnings_.push_back(
+          SPrintF("Could not set the priority of worker %d: %s",
+                  thread_id_.id,
+                  err_buf));
+    }
+  }
+}
+
 bool Worker::CreateEnvMessagePort(Environment* env) {
   HandleScope handle_scope(isolate_);
   std::unique_ptr<MessagePortData> data;
@@ -435,12 +816,90 @@ bool Worker::CreateEnvMessagePort(Environment* env) {
                                              std::move(data));
   // MessagePort::New() may return nullptr if execution is terminated
   // within it.
-  if (child_port != nullptr)
+  if (child_port != nullptr) {
     env->set_message_port(child_port->object(isolate_));
+    child_port_.reset(child_port);
+  }
 
   return child_port;
 }
 
+namespace {
+
+uint64_t GetThreadCPUTime() {
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(),
+                      &creation_time,
+                      &exit_time,
+                      &kernel_time,
+                      &user_time)) {
+    return 0;
+  }
+  auto to_ns = [](const FILETIME& time) {
+    return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+            time.dwLowDateTime) *
+           100;
+  };
+  return to_ns(kernel_time) + to_ns(user_time);
+#else
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+}  // anonymous namespace
+
+void Worker::StartMetrics(Environment* env) {
+  CHECK_EQ(uv_check_init(env->event_loop(), &metrics_check_), 0);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&metrics_check_));
+  CHECK_EQ(uv_check_start(&metrics_check_,
+                          [](uv_check_t* handle) {
+                            Worker* w =
+                                ContainerOf(&Worker::metrics_check_, handle);
+                            w->UpdateMetrics();
+                          }),
+           0);
+  env->RegisterHandleCleanup(
+      reinterpret_cast<uv_handle_t*>(&metrics_check_),
+      [](Environment* env, uv_handle_t* handle, void* arg) {
+        env->CloseHandle(handle, [](uv_handle_t* handle) {});
+      },
+      nullptr);
+  UpdateMetrics();
+}
+
+void Worker::UpdateMetrics() {
+  const uint64_t now = uv_hrtime();
+  if (metrics_updated_at_ != 0 &&
+      now - metrics_updated_at_ < WorkerMetrics::kWorkerMetricsIntervalMs *
+                                      1000000) {
+    return;
+  }
+  metrics_updated_at_ = now;
+
+  uv_loop_t* loop = metrics_check_.loop;
+  uv_metrics_t loop_metrics{};
+  uv_metrics_info(loop, &loop_metrics);
+  v8::HeapStatistics heap_statistics;
+  isolate_->GetHeapStatistics(&heap_statistics);
+  const uint64_t pending_messages =
+      child_port_ ? child_port_->queued_messages() : 0;
+
+  std::atomic<uint64_t>* fields = metrics_.fields;
+  auto set = [&](WorkerMetricsFields field, uint64_t value) {
+    fields[field].store(value, std::memory_order_relaxed);
+  };
+  set(kWorkerMetricsLoopCount, loop_metrics.loop_count);
+  set(kWorkerMetricsLoopIdleTime, uv_metrics_idle_time(loop));
+  set(kWorkerMetricsCPUTime, GetThreadCPUTime());
+  set(kWorkerMetricsHeapUsed, heap_statistics.used_heap_size());
+  set(kWorkerMetricsHeapTotal, heap_statistics.total_heap_size());
+  set(kWorkerMetricsPendingMessages, pending_messages);
+  fields[kWorkerMetricsUpdatedAt].store(now, std::memory_order_release);
+}
+
 void Worker::JoinThread() {
   if (!tid_.has_value())
     return;
@@ -692,6 +1151,12 @@ void Worker::New(const FunctionCallbackInfo<Value>& args) {
   limit_info->CopyContents(worker->resource_limits_,
                            sizeof(worker->resource_limits_));
 
+  worker->can_use_prewarmed_ =
+      !is_internal && !args[1]->IsObject() && !args[2]->IsArray() &&
+      worker->resource_limits_[kMaxYoungGenerationSizeMb] <= 0 &&
+      worker->resource_limits_[kMaxOldGenerationSizeMb] <= 0 &&
+      worker->resource_limits_[kCodeRangeSizeMb] <= 0;
+
   CHECK(args[4]->IsBoolean());
   if (args[4]->IsTrue() || env->tracks_unmanaged_fds())
     worker->environment_flags_ |= EnvironmentFlags::kTrackUnmanagedFds;
@@ -705,6 +1170,58 @@ void Worker::New(const FunctionCallbackInfo<Value>& args) {
     worker->environment_flags_ |= EnvironmentFlags::kNoBrowserGlobals;
 }
 
+// setThreadScheduling(cpus, priority) where cpus is undefined or an array of
+// CPU indices and priority is undefined or one of the UV_THREAD_PRIORITY_*
+// constants. Must be called before startThread().
+void Worker::SetThreadScheduling(const FunctionCallbackInfo<Value>& args) {
+  Worker* w;
+  ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
+  Environment* env = w->env();
+  // The thread has not been started yet, so nothing else reads these fields.
+  CHECK(!w->tid_.has_value());
+
+  if (args[0]->IsArray()) {
+    int mask_size = uv_cpumask_size();
+    if (mask_size < 0) {
+      char err_buf[128];
+      uv_err_name_r(mask_size, err_buf, sizeof(err_buf));
+      THROW_ERR_WORKER_INIT_FAILED(env, err_buf);
+      return;
+    }
+    std::vector<char> mask(mask_size, 0);
+    Local<Array> cpus = args[0].As<Array>();
+    for (uint32_t i = 0; i < cpus->Length(); i++) {
+      Local<Value> cpu;
+      if (!cpus->Get(env->context(), i).ToLocal(&cpu)) return;
+      CHECK(cpu->IsUint32());
+      uint32_t index = cpu.As<Uint32>()->Value();
+      if (index >= mask.size()) {
+        THROW_ERR_OUT_OF_RANGE(env,
+                               "CPU index %u is out of range, must be less "
+                               "than %d",
+                               index,
+                               mask_size);
+        return;
+      }
+      mask[index] = 1;
+    }
+    w->cpu_mask_ = std::move(mask);
+  } else {
+    CHECK(args[0]->IsUndefined());
+    w->cpu_mask_.clear();
+  }
+
+  if (args[1]->IsInt32()) {
+    int priority = args[1].As<Int32>()->Value();
+    CHECK_GE(priority, UV_THREAD_PRIORITY_LOWEST);
+    CHECK_LE(priority, UV_THREAD_PRIORITY_HIGHEST);
+    w->thread_priority_ = priority;
+  } else {
+    CHECK(args[1]->IsUndefined());
+    w->thread_priority_.reset();
+  }
+}
+
 void Worker::StartThread(const FunctionCallbackInfo<Value>& args) {
   Worker* w;
   ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
@@ -729,28 +1246,24 @@ void Worker::StartThread(const FunctionCallbackInfo<Value>& args) {
   thread_options.stack_size = w->stack_size_;
 
   uv_thread_t* tid = &w->tid_.emplace();  // Create uv_thread_t instance
-  int ret = uv_thread_create_ex(tid, &thread_options, [](void* arg) {
-    // XXX: This could become a std::unique_ptr, but that makes at least
-    // gcc 6.3 detect undefined behaviour when there shouldn't be any.
-    // gcc 7+ handles this well.
-    Worker* w = static_cast<Worker*>(arg);
-    const uintptr_t stack_top = reinterpret_cast<uintptr_t>(&arg);
-
-    // Leave a few kilobytes just to make sure we're within limits and have
-    // some space to do work in C++ land.
-    w->stack_base_ = stack_top - (w->stack_size_ - kStackBufferSize);
-
-    w->Run();
-
-    Mutex::ScopedLock lock(w->mutex_);
-    w->env()->SetImmediateThreadsafe(
-        [w = std::unique_ptr<Worker>(w)](Environment* env) {
-          if (w->has_ref_)
-            env->add_refs(-1);
-          w->JoinThread();
-          // implicitly delete w
-        });
-  }, static_cast<void*>(w));
+  int ret = 0;
+  if (!w->can_use_prewarmed_ || w->stack_size_ != kDefaultStackSize ||
+      !PrewarmedWorkerPool::Claim(w->env(), w, tid)) {
+    ret = uv_thread_create_ex(tid, &thread_options, [](void* arg) {
+      // XXX: This could become a std::unique_ptr, but that makes at least
+      // gcc 6.3 detect undefined behaviour when there shouldn't be any.
+      // gcc 7+ handles this well.
+      Worker* w = static_cast<Worker*>(arg);
+      const uintptr_t stack_top = reinterpret_cast<uintptr_t>(&arg);
+
+      // Leave a few kilobytes just to make sure we're within limits and have
+      // some space to do work in C++ land.
+      w->stack_base_ = stack_top - (w->stack_size_ - kStackBufferSize);
+
+      w->Run();
+      FinishThread(w);
+    }, static_cast<void*>(w));
+  }
 
   if (ret == 0) {
     // The object now owns the created thread and should not be garbage
@@ -775,6 +1288,17 @@ void Worker::StartThread(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+void Worker::FinishThread(Worker* w) {
+  Mutex::ScopedLock lock(w->mutex_);
+  w->env()->SetImmediateThreadsafe(
+      [w = std::unique_ptr<Worker>(w)](Environment* env) {
+        if (w->has_ref_)
+          env->add_refs(-1);
+        w->JoinThread();
+        // implicitly delete w
+      });
+}
+
 void Worker::StopThread(const FunctionCallbackInfo<Value>& args) {
   Worker* w;
   ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
@@ -952,10 +1476,67 @@ void Worker::LoopStartTime(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(loop_start_time / 1e6);
 }
 
+// getMetrics(float64Array) fills in the WorkerMetricsFields, with times in
+// milliseconds, and returns false if the thread has not published any yet.
+// It only reads atomics, so it never waits for the worker thread.
+void Worker::GetMetrics(const FunctionCallbackInfo<Value>& args) {
+  Worker* w;
+  ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), kWorkerMetricsFieldCount);
+  double* out = reinterpret_cast<double*>(
+      static_cast<char*>(array->Buffer()->Data()) + array->ByteOffset());
+
+  const std::atomic<uint64_t>* fields = w->metrics_.fields;
+  const uint64_t updated_at =
+      fields[kWorkerMetricsUpdatedAt].load(std::memory_order_acquire);
+  for (int i = 0; i < kWorkerMetricsFieldCount; i++) {
+    double value = fields[i].load(std::memory_order_relaxed);
+    switch (i) {
+      case kWorkerMetricsUpdatedAt:
+        value = updated_at;
+        [[fallthrough]];
+      case kWorkerMetricsLoopIdleTime:
+      case kWorkerMetricsCPUTime:
+        value /= 1e6;
+        break;
+      default:
+        break;
+    }
+    out[i] = value;
+  }
+  args.GetReturnValue().Set(updated_at != 0);
+}
+
 namespace {
 
 // Return the MessagePort that is global for this Environment and communicates
 // with the internal [kPort] port of the JS Worker class in the parent thread.
+void SetWorkerPool(const FunctionCallbackInfo<Value>& args) {
+  // args[0] == Number of prewarmed threads to keep, 0 to disable
+  // args[1] == Idle timeout in ms, 0 for none
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsUint32());
+  PrewarmedWorkerPool::Configure(env,
+                                 args[0].As<Uint32>()->Value(),
+                                 args[1].As<Uint32>()->Value());
+}
+
+void GetWorkerPoolStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  PrewarmedWorkerPool::Stats stats = PrewarmedWorkerPool::GetStats(env);
+  Local<Value> values[] = {
+      Number::New(env->isolate(), static_cast<double>(stats.ready)),
+      Number::New(env->isolate(), static_cast<double>(stats.warming)),
+      Number::New(env->isolate(), static_cast<double>(stats.hits)),
+      Number::New(env->isolate(), static_cast<double>(stats.misses)),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
 void GetEnvMessagePort(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Local<Object> port = env->message_port();
@@ -987,6 +1568,9 @@ void CreateWorkerPerIsolateProperties(IsolateData* isolate_data,
     SetProtoMethod(isolate, w, "takeHeapSnapshot", Worker::TakeHeapSnapshot);
     SetProtoMethod(isolate, w, "loopIdleTime", Worker::LoopIdleTime);
     SetProtoMethod(isolate, w, "loopStartTime", Worker::LoopStartTime);
+    SetProtoMethodNoSideEffect(isolate, w, "getMetrics", Worker::GetMetrics);
+    SetProtoMethod(
+        isolate, w, "setThreadScheduling", Worker::SetThreadScheduling);
 
     SetConstructorFunction(isolate, target, "Worker", w);
   }
@@ -1006,6 +1590,9 @@ void CreateWorkerPerIsolateProperties(IsolateData* isolate_data,
   }
 
   SetMethod(isolate, target, "getEnvMessagePort", GetEnvMessagePort);
+  SetMethod(isolate, target, "setWorkerPool", SetWorkerPool);
+  SetMethodNoSideEffect(
+      isolate, target, "getWorkerPoolStats", GetWorkerPoolStats);
 }
 
 void CreateWorkerPerContextProperties(Local<Object> target,
@@ -1046,11 +1633,27 @@ void CreateWorkerPerContextProperties(Local<Object> target,
   NODE_DEFINE_CONSTANT(target, kCodeRangeSizeMb);
   NODE_DEFINE_CONSTANT(target, kStackSizeMb);
   NODE_DEFINE_CONSTANT(target, kTotalResourceLimitCount);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsUpdatedAt);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsLoopCount);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsLoopIdleTime);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsCPUTime);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsHeapUsed);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsHeapTotal);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsPendingMessages);
+  NODE_DEFINE_CONSTANT(target, kWorkerMetricsFieldCount);
+  NODE_DEFINE_CONSTANT(target, UV_THREAD_PRIORITY_HIGHEST);
+  NODE_DEFINE_CONSTANT(target, UV_THREAD_PRIORITY_ABOVE_NORMAL);
+  NODE_DEFINE_CONSTANT(target, UV_THREAD_PRIORITY_NORMAL);
+  NODE_DEFINE_CONSTANT(target, UV_THREAD_PRIORITY_BELOW_NORMAL);
+  NODE_DEFINE_CONSTANT(target, UV_THREAD_PRIORITY_LOWEST);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetEnvMessagePort);
+  registry->Register(SetWorkerPool);
+  registry->Register(GetWorkerPoolStats);
   registry->Register(Worker::New);
+  registry->Register(Worker::SetThreadScheduling);
   registry->Register(Worker::StartThread);
   registry->Register(Worker::StopThread);
   registry->Register(Worker::HasRef);
@@ -1060,6 +1663,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Worker::TakeHeapSnapshot);
   registry->Register(Worker::LoopIdleTime);
   registry->Register(Worker::LoopStartTime);
+  registry->Register(Worker::GetMetrics);
 }
 
 }  // anonymous namespace
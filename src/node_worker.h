@@ -3,6 +3,7 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
 #include <optional>
 #include <unordered_map>
 #include "node_exit_code.h"
@@ -14,6 +15,7 @@ namespace node {
 struct SnapshotData;
 namespace worker {
 
+class PrewarmedWorkerPool;
 class WorkerThreadData;
 
 enum ResourceLimits {
@@ -24,6 +26,28 @@ enum ResourceLimits {
   kTotalResourceLimitCount
 };
 
+enum WorkerMetricsFields {
+  kWorkerMetricsUpdatedAt,
+  kWorkerMetricsLoopCount,
+  kWorkerMetricsLoopIdleTime,
+  kWorkerMetricsCPUTime,
+  kWorkerMetricsHeapUsed,
+  kWorkerMetricsHeapTotal,
+  kWorkerMetricsPendingMessages,
+  kWorkerMetricsFieldCount
+};
+
+// Figures that a worker thread publishes about itself, so that its parent can
+// read them at any time without taking a lock or exchanging messages. The
+// worker refreshes them after each event loop iteration, at most once per
+// kWorkerMetricsIntervalMs, so they go stale while it is idle in the poll
+// phase or blocked in JavaScript; kWorkerMetricsUpdatedAt tells how stale.
+struct WorkerMetrics {
+  static constexpr uint64_t kWorkerMetricsIntervalMs = 1;
+
+  std::atomic<uint64_t> fields[kWorkerMetricsFieldCount] = {};
+};
+
 // A worker thread, as represented in its parent thread.
 class Worker : public AsyncWrap {
  public:
@@ -37,8 +61,9 @@ class Worker : public AsyncWrap {
          const SnapshotData* snapshot_data);
   ~Worker() override;
 
-  // Run the worker. This is only called from the worker thread.
-  void Run();
+  // Run the worker. This is only called from the worker thread. `prewarmed`
+  // holds the loop and Isolate of a PrewarmedWorkerPool thread, if any.
+  void Run(std::unique_ptr<WorkerThreadData> prewarmed = {});
 
   // Forcibly exit the thread with a specified exit code. This may be called
   // from any thread. `error_code` and `error_message` can be used to create
@@ -76,11 +101,22 @@ class Worker : public AsyncWrap {
   static void TakeHeapSnapshot(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void LoopIdleTime(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void LoopStartTime(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetMetrics(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetThreadScheduling(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
 
  private:
   bool CreateEnvMessagePort(Environment* env);
+  // Schedules the cleanup of `w` on the parent thread after Run() returned.
+  static void FinishThread(Worker* w);
   static size_t NearHeapLimit(void* data, size_t current_heap_limit,
                               size_t initial_heap_limit);
+  // Called on the worker thread.
+  void StartMetrics(Environment* env);
+  void UpdateMetrics();
+  // Applies the CPU affinity and priority set through SetThreadScheduling()
+  // to the current thread. Failures are recorded in scheduling_warnings_.
+  void ApplyThreadScheduling();
 
   std::shared_ptr<PerIsolateOptions> per_isolate_opts_;
   std::vector<std::string> exec_argv_;
@@ -92,6 +128,19 @@ class Worker : public AsyncWrap {
 
   std::unique_ptr<InspectorParentHandle> inspector_parent_handle_;
 
+  // Written by the worker thread, read by the parent thread.
+  WorkerMetrics metrics_;
+  // Only used on the worker thread.
+  uv_check_t metrics_check_;
+  uint64_t metrics_updated_at_ = 0;
+  BaseObjectWeakPtr<MessagePort> child_port_;
+
+  // Set before the thread starts, read by the worker thread. An empty mask
+  // leaves the affinity inherited from the parent untouched.
+  std::vector<char> cpu_mask_;
+  std::optional<int> thread_priority_;
+  std::vector<std::string> scheduling_warnings_;
+
   // This mutex protects access to all variables listed below it.
   mutable Mutex mutex_;
 
@@ -108,7 +157,8 @@ class Worker : public AsyncWrap {
   void UpdateResourceConstraints(v8::ResourceConstraints* constraints);
 
   // Full size of the thread's stack.
-  size_t stack_size_ = 4 * 1024 * 1024;
+  static constexpr size_t kDefaultStackSize = 4 * 1024 * 1024;
+  size_t stack_size_ = kDefaultStackSize;
   // Stack buffer size that is not available to the JS engine.
   static constexpr size_t kStackBufferSize = 192 * 1024;
 
@@ -123,6 +173,9 @@ class Worker : public AsyncWrap {
   bool stopped_ = true;
 
   bool has_ref_ = true;
+  // Whether the worker can run on a thread from a PrewarmedWorkerPool, i.e.
+  // it uses the parent's options and the default resource limits.
+  bool can_use_prewarmed_ = false;
   uint64_t environment_flags_ = EnvironmentFlags::kNoFlags;
 
   // The real Environment of the worker object. It has a lesser
@@ -132,6 +185,7 @@ class Worker : public AsyncWrap {
   Environment* env_ = nullptr;
 
   const SnapshotData* snapshot_data_ = nullptr;
+  friend class PrewarmedWorkerPool;
   friend class WorkerThreadData;
 };
 
@@ -24,7 +24,11 @@
 #include "node_buffer.h"
 
 #include "async_wrap-inl.h"
+#include "dataqueue/queue.h"
 #include "env-inl.h"
+#include "node_blob.h"
+#include "node_bob-inl.h"
+#include "node_errors.h"
 #include "node_external_reference.h"
 #include "threadpoolwork-inl.h"
 #include "util-inl.h"
@@ -35,12 +39,21 @@
 #include "brotli/decode.h"
 #include "zlib.h"
 
+#if NODE_HAVE_ZSTD
+#include "zstd.h"
+#endif  // NODE_HAVE_ZSTD
+
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <atomic>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <vector>
 
 namespace node {
 
@@ -55,6 +68,7 @@ using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::Object;
+using v8::Uint32;
 using v8::Uint32Array;
 using v8::Value;
 
@@ -104,7 +118,9 @@ enum node_zlib_mode {
   INFLATERAW,
   UNZIP,
   BROTLI_DECODE,
-  BROTLI_ENCODE
+  BROTLI_ENCODE,
+  ZSTD_COMPRESS,
+  ZSTD_DECOMPRESS
 };
 
 constexpr uint8_t GZIP_HEADER_ID1 = 0x1f;
@@ -127,6 +143,213 @@ struct CompressionError {
   inline bool IsError() const { return code != nullptr; }
 };
 
+// Compresses a deflate, gzip or raw deflate stream pigz-style: the input is
+// split into blocks that are deflated independently on several threads, each
+// with the tail of the preceding input as its preset dictionary, and then
+// concatenated. Every block but the last ends on a sync flush, so the result
+// is a single ordinary stream that any reader can decompress. The checksum
+// is combined from those of the blocks.
+//
+// Input is buffered until a whole batch of blocks is available or the
+// stream is flushed, and output that did not fit into the caller's buffer
+// is kept for the following calls.
+class ParallelDeflate final {
+ public:
+  static constexpr uint32_t kMaxThreads = 64;
+  static constexpr uint32_t kMinBlockSize = 32 * 1024;
+  static constexpr uint32_t kMaxBlockSize = 64 * 1024 * 1024;
+
+  ParallelDeflate(node_zlib_mode mode,
+                  int window_bits,
+                  uint32_t threads,
+                  uint32_t block_size);
+
+  // Behaves like deflate(strm, flush) and returns a zlib status.
+  int Process(z_stream* strm,
+              int flush,
+              int level,
+              int mem_level,
+              int strategy);
+  void Reset();
+
+  size_t buffered() const {
+    return input_.capacity() + window_.capacity() + output_.capacity();
+  }
+
+ private:
+  bool CompressInput(size_t length,
+                     bool finish,
+                     int level,
+                     int mem_level,
+                     int strategy);
+  void WriteHeader(int level, int strategy);
+  void WriteTrailer();
+  void Drain(z_stream* strm);
+
+  const node_zlib_mode mode_;
+  const int window_bits_;
+  const uint32_t threads_;
+  const size_t block_size_;
+
+  std::vector<unsigned char> input_;   // Not compressed yet.
+  std::vector<unsigned char> window_;  // The end of the compressed input.
+  std::vector<unsigned char> output_;
+  size_t output_offset_ = 0;
+  uLong check_ = 0;
+  uLong total_in_ = 0;
+  bool header_written_ = false;
+  bool finished_ = false;
+};
+
+// A deflate z_stream that can be handed to a ZlibContextPool when its stream
+// is closed. zlib keeps a pointer back to the z_stream in its internal state,
+// so the z_stream stays where it is allocated instead of being moved.
+struct PooledZStream {
+  z_stream strm{};
+  // Where allocations made by zlib are accounted: the CompressionStream
+  // using the state, or the pool while it is idle.
+  std::atomic<ssize_t>* unreported_allocations = nullptr;
+  std::atomic<size_t> allocated{0};
+};
+
+void* AllocForPooledZStream(void* data, uInt items, uInt size) {
+  PooledZStream* state = static_cast<PooledZStream*>(data);
+  size_t real_size =
+      MultiplyWithOverflowCheck(static_cast<size_t>(items),
+                                static_cast<size_t>(size)) + sizeof(size_t);
+  char* memory = UncheckedMalloc(real_size);
+  if (UNLIKELY(memory == nullptr)) return nullptr;
+  *reinterpret_cast<size_t*>(memory) = real_size;
+  state->allocated.fetch_add(real_size, std::memory_order_relaxed);
+  state->unreported_allocations->fetch_add(real_size,
+                                           std::memory_order_relaxed);
+  return memory + sizeof(size_t);
+}
+
+void FreeForPooledZStream(void* data, void* pointer) {
+  if (UNLIKELY(pointer == nullptr)) return;
+  PooledZStream* state = static_cast<PooledZStream*>(data);
+  char* real_pointer = static_cast<char*>(pointer) - sizeof(size_t);
+  size_t real_size = *reinterpret_cast<size_t*>(real_pointer);
+  state->allocated.fetch_sub(real_size, std::memory_order_relaxed);
+  state->unreported_allocations->fetch_sub(real_size,
+                                           std::memory_order_relaxed);
+  free(real_pointer);
+}
+
+}  // anonymous namespace
+
+// Keeps the reset deflate states of closed streams of an Environment, so
+// that a new stream with the same mode and parameters can skip
+// deflateInit2() and its allocations. Short-lived streams, such as those
+// compressing HTTP responses, benefit most. The memory held by idle states
+// stays reported to V8. Owned by the Environment, see
+// Environment::zlib_context_pool().
+class ZlibContextPool final {
+ public:
+  static constexpr size_t kMaxIdleStates = 16;
+
+  struct Key {
+    int mode;
+    int level;
+    int window_bits;
+    int mem_level;
+    int strategy;
+
+    bool operator==(const Key& other) const {
+      return mode == other.mode && level == other.level &&
+             window_bits == other.window_bits &&
+             mem_level == other.mem_level && strategy == other.strategy;
+    }
+  };
+
+  explicit ZlibContextPool(Environment* env) : env_(env) {
+    env->AddMemoryPressureHook(OnMemoryPressure, this);
+  }
+  ~ZlibContextPool();
+
+  // Returns an idle state for the given parameters, or nullptr. Its
+  // allocations are accounted in unreported_allocations from now on.
+  std::unique_ptr<PooledZStream> Take(
+      const Key& key, std::atomic<ssize_t>* unreported_allocations);
+
+  // Takes over a state that was reset with deflateReset(). Returns false,
+  // leaving the state with the caller, if the pool is full.
+  bool Give(const Key& key, std::unique_ptr<PooledZStream>* state);
+
+  // Frees all idle states. Runs under memory pressure.
+  void Trim();
+
+ private:
+  static void OnMemoryPressure(void* data) {
+    static_cast<ZlibContextPool*>(data)->Trim();
+  }
+
+  void Report();
+
+  struct Entry {
+    Key key;
+    std::unique_ptr<PooledZStream> state;
+  };
+
+  Environment* env_;
+  std::vector<Entry> idle_;
+  std::atomic<ssize_t> unreported_allocations_{0};
+  ssize_t reported_ = 0;
+};
+
+namespace {
+
+// A dictionary registered with registerDictionary() under a numeric ID, so
+// that streams in any thread can refer to it instead of passing its contents.
+// What each library needs to start a stream with it is prepared once and
+// shared: a BrotliEncoderPreparedDictionary for Brotli, and deflate states
+// that have already processed the dictionary, which new deflate streams copy
+// with deflateCopy(). The prepared data is not attributed to any isolate.
+class SharedDictionary final {
+ public:
+  static constexpr size_t kMaxPrimedStates = 4;
+
+  explicit SharedDictionary(std::vector<unsigned char>&& data)
+      : data_(std::move(data)) {}
+  ~SharedDictionary();
+  SharedDictionary(const SharedDictionary&) = delete;
+  SharedDictionary& operator=(const SharedDictionary&) = delete;
+
+  // Registering an ID again replaces its dictionary. Streams that use the
+  // previous one keep it until they are closed.
+  static void Register(uint32_t id, std::shared_ptr<SharedDictionary> dict);
+  static bool Unregister(uint32_t id);
+  static std::shared_ptr<SharedDictionary> Get(uint32_t id);
+
+  const std::vector<unsigned char>& data() const { return data_; }
+
+  // Returns nullptr if the dictionary could not be prepared.
+  const BrotliEncoderPreparedDictionary* GetBrotliEncoderDictionary();
+
+  // Turns state, which must not be initialized yet, into a copy of a deflate
+  // state for the given parameters that has processed the dictionary. Its
+  // allocations are accounted in state->unreported_allocations. Returns false
+  // if no such state could be set up.
+  bool CopyDeflateState(const ZlibContextPool::Key& key,
+                        PooledZStream* state);
+
+ private:
+  struct PrimedState {
+    ZlibContextPool::Key key;
+    std::unique_ptr<PooledZStream> state;
+  };
+
+  PooledZStream* GetPrimedState(const ZlibContextPool::Key& key);
+
+  const std::vector<unsigned char> data_;
+  Mutex mutex_;  // Protects everything below.
+  DeleteFnPtr<BrotliEncoderPreparedDictionary,
+              BrotliEncoderDestroyPreparedDictionary> brotli_encoder_;
+  std::vector<PrimedState> primed_;
+  std::atomic<ssize_t> unreported_allocations_{0};
+};
+
 class ZlibContext final : public MemoryRetainer {
  public:
   ZlibContext() = default;
@@ -146,12 +369,24 @@ class ZlibContext final : public MemoryRetainer {
             std::vector<unsigned char>&& dictionary);
   void SetAllocationFunctions(alloc_func alloc, free_func free, void* opaque);
   CompressionError SetParams(int level, int strategy);
+  void SetParallel(uint32_t threads, uint32_t block_size);
+  // Lets a deflate stream reuse a state from the Environment's pool and
+  // return its own there when closed. Called right after Init().
+  void UsePool(Environment* env, std::atomic<ssize_t>* unreported_allocations);
+  // Uses a registered dictionary instead of one passed to Init(). Called
+  // right after Init(), before UsePool().
+  void UseSharedDictionary(std::shared_ptr<SharedDictionary> dictionary);
+  // Parallel compression waits for helper threads, so it never runs on the
+  // event loop thread.
+  bool UsesHelperThreads() const { return parallel_ != nullptr; }
 
   SET_MEMORY_INFO_NAME(ZlibContext)
   SET_SELF_SIZE(ZlibContext)
 
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackField("dictionary", dictionary_);
+    if (parallel_)
+      tracker->TrackFieldWithSize("parallel", parallel_->buffered());
   }
 
   ZlibContext(const ZlibContext&) = delete;
@@ -160,7 +395,12 @@ class ZlibContext final : public MemoryRetainer {
  private:
   CompressionError ErrorForMessage(const char* message) const;
   CompressionError SetDictionary();
+  const std::vector<unsigned char>& dictionary() const {
+    return shared_dictionary_ ? shared_dictionary_->data() : dictionary_;
+  }
   bool InitZlib();
+  ZlibContextPool::Key PoolKey() const;
+  bool ReturnToPool();
 
   Mutex mutex_;  // Protects zlib_init_done_.
   bool zlib_init_done_ = false;
@@ -173,8 +413,13 @@ class ZlibContext final : public MemoryRetainer {
   int window_bits_ = 0;
   unsigned int gzip_id_bytes_read_ = 0;
   std::vector<unsigned char> dictionary_;
+  std::shared_ptr<SharedDictionary> shared_dictionary_;
+  std::unique_ptr<ParallelDeflate> parallel_;
+  std::unique_ptr<PooledZStream> pooled_;
+  Environment* pool_env_ = nullptr;
 
-  z_stream strm_;
+  z_stream own_strm_;
+  z_stream* strm_ = &own_strm_;  // Points into pooled_ if there is one.
 };
 
 // Brotli has different data types for compression and decompression streams,
@@ -217,12 +462,20 @@ class BrotliEncoderContext final : public BrotliContext {
   CompressionError SetParams(int key, uint32_t value);
   CompressionError GetErrorInfo() const;
 
+  // Brotli-specific:
+  CompressionError UseSharedDictionary(
+      std::shared_ptr<SharedDictionary> dictionary);
+
   SET_MEMORY_INFO_NAME(BrotliEncoderContext)
   SET_SELF_SIZE(BrotliEncoderContext)
   SET_NO_MEMORY_INFO()  // state_ is covered through allocation tracking.
 
  private:
+  CompressionError AttachDictionary();
+
   bool last_result_ = false;
+  // Declared before state_, which refers to it.
+  std::shared_ptr<SharedDictionary> shared_dictionary_;
   DeleteFnPtr<BrotliEncoderState, BrotliEncoderDestroyInstance> state_;
 };
 
@@ -237,6 +490,10 @@ class BrotliDecoderContext final : public BrotliContext {
   CompressionError SetParams(int key, uint32_t value);
   CompressionError GetErrorInfo() const;
 
+  // Brotli-specific:
+  CompressionError UseSharedDictionary(
+      std::shared_ptr<SharedDictionary> dictionary);
+
   SET_MEMORY_INFO_NAME(BrotliDecoderContext)
   SET_SELF_SIZE(BrotliDecoderContext)
   SET_NO_MEMORY_INFO()  // state_ is covered through allocation tracking.
@@ -244,10 +501,91 @@ class BrotliDecoderContext final : public BrotliContext {
  private:
   BrotliDecoderResult last_result_ = BROTLI_DECODER_RESULT_SUCCESS;
   BrotliDecoderErrorCode error_ = BROTLI_DECODER_NO_ERROR;
+  CompressionError AttachDictionary();
+
   std::string error_string_;
+  // Declared before state_, which refers to it.
+  std::shared_ptr<SharedDictionary> shared_dictionary_;
   DeleteFnPtr<BrotliDecoderState, BrotliDecoderDestroyInstance> state_;
 };
 
+#if NODE_HAVE_ZSTD
+// zstd allocates through custom allocators only with its experimental API,
+// which shared builds of the library may not export, so the contexts use
+// the default allocator and report their size with ZSTD_sizeof_*().
+class ZstdContext : public MemoryRetainer {
+ public:
+  ZstdContext() = default;
+
+  void SetBuffers(const char* in, uint32_t in_len, char* out, uint32_t out_len);
+  void SetFlush(int flush);
+  void GetAfterWriteOffsets(uint32_t* avail_in, uint32_t* avail_out) const;
+  inline void SetMode(node_zlib_mode mode) { mode_ = mode; }
+
+  ZstdContext(const ZstdContext&) = delete;
+  ZstdContext& operator=(const ZstdContext&) = delete;
+
+ protected:
+  node_zlib_mode mode_ = NONE;
+  ZSTD_inBuffer input_ = {nullptr, 0, 0};
+  ZSTD_outBuffer output_ = {nullptr, 0, 0};
+  ZSTD_EndDirective flush_ = ZSTD_e_continue;
+  // The return value of the last streaming call: an error code, or a hint
+  // for how much is left to do, which is 0 once a frame is complete.
+  size_t last_result_ = 0;
+};
+
+inline void FreeZstdCCtx(ZSTD_CCtx* cctx) { ZSTD_freeCCtx(cctx); }
+inline void FreeZstdDCtx(ZSTD_DCtx* dctx) { ZSTD_freeDCtx(dctx); }
+
+class ZstdCompressContext final : public ZstdContext {
+ public:
+  void Close();
+  void DoThreadPoolWork();
+  CompressionError Init(uint64_t pledged_src_size,
+                        std::vector<unsigned char>&& dictionary);
+  CompressionError ResetStream();
+  CompressionError SetParams(int key, uint32_t value);
+  CompressionError GetErrorInfo() const;
+
+  bool UsesHelperThreads() const { return multithreaded_; }
+
+  SET_MEMORY_INFO_NAME(ZstdCompressContext)
+  SET_SELF_SIZE(ZstdCompressContext)
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize(
+        "cctx", cctx_ ? ZSTD_sizeof_CCtx(cctx_.get()) : 0);
+  }
+
+ private:
+  DeleteFnPtr<ZSTD_CCtx, FreeZstdCCtx> cctx_;
+  bool multithreaded_ = false;
+};
+
+class ZstdDecompressContext final : public ZstdContext {
+ public:
+  void Close();
+  void DoThreadPoolWork();
+  CompressionError Init(uint64_t pledged_src_size,
+                        std::vector<unsigned char>&& dictionary);
+  CompressionError ResetStream();
+  CompressionError SetParams(int key, uint32_t value);
+  CompressionError GetErrorInfo() const;
+
+  SET_MEMORY_INFO_NAME(ZstdDecompressContext)
+  SET_SELF_SIZE(ZstdDecompressContext)
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize(
+        "dctx", dctx_ ? ZSTD_sizeof_DCtx(dctx_.get()) : 0);
+  }
+
+ private:
+  DeleteFnPtr<ZSTD_DCtx, FreeZstdDCtx> dctx_;
+};
+#endif  // NODE_HAVE_ZSTD
+
 template <typename CompressionContext>
 class CompressionStream : public AsyncWrap, public ThreadPoolWork {
  public:
@@ -257,6 +595,10 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     kInternalFieldCount
   };
 
+  // Async writes of at most this many bytes are processed without a
+  // threadpool round-trip. setInlineThreshold() overrides it per stream.
+  static constexpr uint32_t kDefaultInlineThreshold = 1024;
+
   CompressionStream(Environment* env, Local<Object> wrap)
       : AsyncWrap(env, wrap, AsyncWrap::PROVIDER_ZLIB),
         ThreadPoolWork(env, "zlib"),
@@ -374,9 +716,45 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     }
 
     // async version
+    // A flushing write has to emit everything buffered since the last flush,
+    // so it is judged by that amount before the counter restarts.
+    bytes_since_flush_ += in_len;
+    const bool runs_inline = RunsInline(in_len);
+    if (flush != Z_NO_FLUSH) bytes_since_flush_ = 0;
+    if (runs_inline) {
+      // Small writes are cheaper to process right away than to send to the
+      // threadpool. The callback still runs asynchronously, like it would
+      // after a threadpool round-trip.
+      DoThreadPoolWork();
+      AsyncWrap::env()->SetImmediate([this](Environment* env) {
+        AfterThreadPoolWork(env->can_call_into_js() ? 0 : UV_ECANCELED);
+      });
+      return;
+    }
     ScheduleWork();
   }
 
+  // Writes are processed on the event loop thread if neither they nor the
+  // input buffered since the last flush exceed the threshold, which bounds
+  // the amount of work a single flush can do.
+  bool RunsInline(uint32_t in_len) const {
+    if (inline_threshold_ == 0 || in_len > inline_threshold_ ||
+        bytes_since_flush_ > inline_threshold_) {
+      return false;
+    }
+    if constexpr (requires { ctx_.UsesHelperThreads(); })
+      return !ctx_.UsesHelperThreads();
+    return true;
+  }
+
+  // setInlineThreshold(bytes)
+  static void SetInlineThreshold(const FunctionCallbackInfo<Value>& args) {
+    CHECK(args[0]->IsUint32());
+    CompressionStream* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+    wrap->inline_threshold_ = args[0].As<Uint32>()->Value();
+  }
+
   void UpdateWriteResult() {
     ctx_.GetAfterWriteOffsets(&write_result_[1], &write_result_[0]);
   }
@@ -521,6 +899,10 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     AsyncWrap::env()->isolate()->AdjustAmountOfExternalAllocatedMemory(report);
   }
 
+  std::atomic<ssize_t>* unreported_allocations() {
+    return &unreported_allocations_;
+  }
+
   struct AllocScope {
     explicit AllocScope(CompressionStream* stream) : stream(stream) {}
     ~AllocScope() { stream->AdjustAmountOfExternalAllocatedMemory(); }
@@ -547,6 +929,8 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
   bool closed_ = false;
   unsigned int refs_ = 0;
   uint32_t* write_result_ = nullptr;
+  uint32_t inline_threshold_ = kDefaultInlineThreshold;
+  uint64_t bytes_since_flush_ = 0;
   std::atomic<ssize_t> unreported_allocations_{0};
   size_t zlib_memory_ = 0;
 
@@ -583,6 +967,7 @@ class ZlibStream final : public CompressionStream<ZlibContext> {
     CHECK(args.Length() == 7 &&
       "init(windowBits, level, memLevel, strategy, writeResult, writeCallback,"
       " dictionary)");
+    // dictionary is a Buffer, the ID of a registered dictionary, or neither.
 
     ZlibStream* wrap;
     ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
@@ -628,6 +1013,19 @@ class ZlibStream final : public CompressionStream<ZlibContext> {
         AllocForZlib, FreeForZlib, static_cast<CompressionStream*>(wrap));
     wrap->context()->Init(level, window_bits, mem_level, strategy,
                           std::move(dictionary));
+    if (args[6]->IsUint32()) {
+      std::shared_ptr<SharedDictionary> shared =
+          SharedDictionary::Get(args[6].As<Uint32>()->Value());
+      if (!shared) {
+        wrap->EmitError(CompressionError("Unknown dictionary",
+                                         "ERR_ZLIB_INITIALIZATION_FAILED",
+                                         -1));
+        return;
+      }
+      wrap->context()->UseSharedDictionary(std::move(shared));
+    }
+    wrap->context()->UsePool(wrap->AsyncWrap::env(),
+                             wrap->unreported_allocations());
   }
 
   static void Params(const FunctionCallbackInfo<Value>& args) {
@@ -646,6 +1044,16 @@ class ZlibStream final : public CompressionStream<ZlibContext> {
       wrap->EmitError(err);
   }
 
+  static void SetParallel(const FunctionCallbackInfo<Value>& args) {
+    CHECK(args.Length() == 2 && "setParallel(threads, blockSize)");
+    ZlibStream* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+    CHECK(args[0]->IsUint32());
+    CHECK(args[1]->IsUint32());
+    wrap->context()->SetParallel(args[0].As<Uint32>()->Value(),
+                                 args[1].As<Uint32>()->Value());
+  }
+
   SET_MEMORY_INFO_NAME(ZlibStream)
   SET_SELF_SIZE(ZlibStream)
 };
@@ -677,7 +1085,8 @@ class BrotliCompressionStream final :
   static void Init(const FunctionCallbackInfo<Value>& args) {
     BrotliCompressionStream* wrap;
     ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
-    CHECK(args.Length() == 3 && "init(params, writeResult, writeCallback)");
+    CHECK((args.Length() == 3 || args.Length() == 4) &&
+          "init(params, writeResult, writeCallback[, dictionaryId])");
 
     CHECK(args[1]->IsUint32Array());
     uint32_t* write_result = reinterpret_cast<uint32_t*>(Buffer::Data(args[1]));
@@ -713,6 +1122,21 @@ class BrotliCompressionStream final :
       }
     }
 
+    if (args.Length() == 4 && !args[3]->IsUndefined()) {
+      CHECK(args[3]->IsUint32());
+      std::shared_ptr<SharedDictionary> shared =
+          SharedDictionary::Get(args[3].As<Uint32>()->Value());
+      err = shared ? wrap->context()->UseSharedDictionary(std::move(shared))
+                   : CompressionError("Unknown dictionary",
+                                      "ERR_ZLIB_INITIALIZATION_FAILED",
+                                      -1);
+      if (err.IsError()) {
+        wrap->EmitError(err);
+        args.GetReturnValue().Set(false);
+        return;
+      }
+    }
+
     args.GetReturnValue().Set(true);
   }
 
@@ -730,11 +1154,107 @@ class BrotliCompressionStream final :
 using BrotliEncoderStream = BrotliCompressionStream<BrotliEncoderContext>;
 using BrotliDecoderStream = BrotliCompressionStream<BrotliDecoderContext>;
 
+#if NODE_HAVE_ZSTD
+template <typename CompressionContext>
+class ZstdStream final : public CompressionStream<CompressionContext> {
+ public:
+  ZstdStream(Environment* env, Local<Object> wrap, node_zlib_mode mode)
+    : CompressionStream<CompressionContext>(env, wrap) {
+    context()->SetMode(mode);
+  }
+
+  inline CompressionContext* context() {
+    return this->CompressionStream<CompressionContext>::context();
+  }
+  typedef typename CompressionStream<CompressionContext>::AllocScope AllocScope;
+
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsInt32());
+    node_zlib_mode mode =
+        static_cast<node_zlib_mode>(args[0].As<Int32>()->Value());
+    new ZstdStream(env, args.This(), mode);
+  }
+
+  // Parameters are passed like for Brotli, in an array indexed by the
+  // ZSTD_cParameter or ZSTD_dParameter value, with -1 for the ones to leave
+  // alone. Signed parameters such as negative levels are passed as their
+  // two's complement. pledgedSrcSize is undefined when unknown.
+  static void Init(const FunctionCallbackInfo<Value>& args) {
+    ZstdStream* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+    CHECK(args.Length() == 5 &&
+          "init(params, pledgedSrcSize, writeResult, writeCallback, "
+          "dictionary)");
+
+    uint64_t pledged_src_size = ZSTD_CONTENTSIZE_UNKNOWN;
+    if (args[1]->IsNumber()) {
+      double size = args[1].As<v8::Number>()->Value();
+      CHECK(size >= 0 && "invalid pledgedSrcSize");
+      pledged_src_size = static_cast<uint64_t>(size);
+    }
+
+    CHECK(args[2]->IsUint32Array());
+    uint32_t* write_result = reinterpret_cast<uint32_t*>(Buffer::Data(args[2]));
+
+    CHECK(args[3]->IsFunction());
+    Local<Function> write_js_callback = args[3].As<Function>();
+    wrap->InitStream(write_result, write_js_callback);
+
+    std::vector<unsigned char> dictionary;
+    if (Buffer::HasInstance(args[4])) {
+      unsigned char* data =
+          reinterpret_cast<unsigned char*>(Buffer::Data(args[4]));
+      dictionary = std::vector<unsigned char>(
+          data,
+          data + Buffer::Length(args[4]));
+    }
+
+    AllocScope alloc_scope(wrap);
+    CompressionError err =
+        wrap->context()->Init(pledged_src_size, std::move(dictionary));
+    if (err.IsError()) {
+      wrap->EmitError(err);
+      args.GetReturnValue().Set(false);
+      return;
+    }
+
+    CHECK(args[0]->IsUint32Array());
+    const uint32_t* data = reinterpret_cast<uint32_t*>(Buffer::Data(args[0]));
+    size_t len = args[0].As<Uint32Array>()->Length();
+
+    for (int i = 0; static_cast<size_t>(i) < len; i++) {
+      if (data[i] == static_cast<uint32_t>(-1))
+        continue;
+      err = wrap->context()->SetParams(i, data[i]);
+      if (err.IsError()) {
+        wrap->EmitError(err);
+        args.GetReturnValue().Set(false);
+        return;
+      }
+    }
+
+    args.GetReturnValue().Set(true);
+  }
+
+  static void Params(const FunctionCallbackInfo<Value>& args) {
+    // Currently a no-op, and not accessed from JS land, as for Brotli.
+  }
+
+  SET_MEMORY_INFO_NAME(ZstdStream)
+  SET_SELF_SIZE(ZstdStream)
+};
+
+using ZstdCompressStream = ZstdStream<ZstdCompressContext>;
+using ZstdDecompressStream = ZstdStream<ZstdDecompressContext>;
+#endif  // NODE_HAVE_ZSTD
+
 void ZlibContext::Close() {
   {
     Mutex::ScopedLock lock(mutex_);
     if (!zlib_init_done_) {
       dictionary_.clear();
+      shared_dictionary_.reset();
       mode_ = NONE;
       return;
     }
@@ -744,76 +1264,338 @@ void ZlibContext::Close() {
 
   int status = Z_OK;
   if (mode_ == DEFLATE || mode_ == GZIP || mode_ == DEFLATERAW) {
-    status = deflateEnd(&strm_);
+    if (!ReturnToPool())
+      status = deflateEnd(strm_);
   } else if (mode_ == INFLATE || mode_ == GUNZIP || mode_ == INFLATERAW ||
              mode_ == UNZIP) {
-    status = inflateEnd(&strm_);
+    status = inflateEnd(strm_);
   }
 
   CHECK(status == Z_OK || status == Z_DATA_ERROR);
   mode_ = NONE;
 
   dictionary_.clear();
+  shared_dictionary_.reset();
+  pooled_.reset();
+  strm_ = &own_strm_;
 }
 
 
-void ZlibContext::DoThreadPoolWork() {
-  bool first_init_call = InitZlib();
-  if (first_init_call && err_ != Z_OK) {
+ZlibContextPool::Key ZlibContext::PoolKey() const {
+  return ZlibContextPool::Key {
+      mode_, level_, window_bits_, mem_level_, strategy_ };
+}
+
+
+bool ZlibContext::ReturnToPool() {
+  // A stream that failed is not trusted to reset cleanly.
+  if (!pooled_ || (err_ != Z_OK && err_ != Z_STREAM_END && err_ != Z_BUF_ERROR))
+    return false;
+  if (deflateReset(strm_) != Z_OK)
+    return false;
+  return pool_env_->zlib_context_pool()->Give(PoolKey(), &pooled_);
+}
+
+
+void ZlibContext::UsePool(Environment* env,
+                          std::atomic<ssize_t>* unreported_allocations) {
+  if (mode_ != DEFLATE && mode_ != GZIP && mode_ != DEFLATERAW)
+    return;
+
+  pool_env_ = env;
+  ZlibContextPool* pool = env->zlib_context_pool();
+  // Pooled states know nothing about dictionaries, so a stream with a shared
+  // one starts from a copy of a state that has processed it instead.
+  if (!shared_dictionary_)
+    pooled_ = pool->Take(PoolKey(), unreported_allocations);
+  if (pooled_) {
+    strm_ = &pooled_->strm;
+    {
+      Mutex::ScopedLock lock(mutex_);
+      zlib_init_done_ = true;
+    }
+    err_ = Z_OK;
+    SetDictionary();
     return;
   }
 
-  const Bytef* next_expected_header_byte = nullptr;
+  pooled_ = std::make_unique<PooledZStream>();
+  pooled_->unreported_allocations = unreported_allocations;
+  pooled_->strm.zalloc = AllocForPooledZStream;
+  pooled_->strm.zfree = FreeForPooledZStream;
+  pooled_->strm.opaque = pooled_.get();
+  strm_ = &pooled_->strm;
 
-  // If the avail_out is left at 0, then it means that it ran out
-  // of room.  If there was avail_out left over, then it means
-  // that all of the input was consumed.
-  switch (mode_) {
-    case DEFLATE:
-    case GZIP:
-    case DEFLATERAW:
-      err_ = deflate(&strm_, flush_);
-      break;
-    case UNZIP:
-      if (strm_.avail_in > 0) {
-        next_expected_header_byte = strm_.next_in;
-      }
+  if (shared_dictionary_ &&
+      shared_dictionary_->CopyDeflateState(PoolKey(), pooled_.get())) {
+    Mutex::ScopedLock lock(mutex_);
+    zlib_init_done_ = true;
+    err_ = Z_OK;
+  }
+  // Otherwise initialized lazily by InitZlib(), as usual.
+}
 
-      switch (gzip_id_bytes_read_) {
-        case 0:
-          if (next_expected_header_byte == nullptr) {
-            break;
-          }
 
-          if (*next_expected_header_byte == GZIP_HEADER_ID1) {
-            gzip_id_bytes_read_ = 1;
-            next_expected_header_byte++;
+void ZlibContext::UseSharedDictionary(
+    std::shared_ptr<SharedDictionary> dictionary) {
+  dictionary_.clear();
+  shared_dictionary_ = std::move(dictionary);
+}
 
-            if (strm_.avail_in == 1) {
-              // The only available byte was already read.
-              break;
-            }
-          } else {
-            mode_ = INFLATE;
-            break;
-          }
 
-          [[fallthrough]];
-        case 1:
-          if (next_expected_header_byte == nullptr) {
-            break;
-          }
+struct SharedDictionaryRegistry {
+  Mutex mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<SharedDictionary>> entries;
+};
 
-          if (*next_expected_header_byte == GZIP_HEADER_ID2) {
-            gzip_id_bytes_read_ = 2;
-            mode_ = GUNZIP;
-          } else {
-            // There is no actual difference between INFLATE and INFLATERAW
-            // (after initialization).
-            mode_ = INFLATE;
-          }
+SharedDictionaryRegistry* GetSharedDictionaryRegistry() {
+  return &LeakedSingleton<SharedDictionaryRegistry>::Get();
+}
 
-          break;
+
+void SharedDictionary::Register(uint32_t id,
+                                std::shared_ptr<SharedDictionary> dict) {
+  SharedDictionaryRegistry* registry = GetSharedDictionaryRegistry();
+  Mutex::ScopedLock lock(registry->mutex);
+  registry->entries[id] = std::move(dict);
+}
+
+
+bool SharedDictionary::Unregister(uint32_t id) {
+  SharedDictionaryRegistry* registry = GetSharedDictionaryRegistry();
+  Mutex::ScopedLock lock(registry->mutex);
+  return registry->entries.erase(id) > 0;
+}
+
+
+std::shared_ptr<SharedDictionary> SharedDictionary::Get(uint32_t id) {
+  SharedDictionaryRegistry* registry = GetSharedDictionaryRegistry();
+  Mutex::ScopedLock lock(registry->mutex);
+  auto it = registry->entries.find(id);
+  if (it == registry->entries.end()) return nullptr;
+  return it->second;
+}
+
+
+SharedDictionary::~SharedDictionary() {
+  for (PrimedState& primed : primed_)
+    CHECK_EQ(deflateEnd(&primed.state->strm), Z_OK);
+}
+
+
+const BrotliEncoderPreparedDictionary*
+SharedDictionary::GetBrotliEncoderDictionary() {
+  Mutex::ScopedLock lock(mutex_);
+  if (!brotli_encoder_) {
+    brotli_encoder_.reset(
+        BrotliEncoderPrepareDictionary(BROTLI_SHARED_DICTIONARY_RAW,
+                                       data_.size(),
+                                       data_.data(),
+                                       BROTLI_MAX_QUALITY,
+                                       nullptr,
+                                       nullptr,
+                                       nullptr));
+  }
+  return brotli_encoder_.get();
+}
+
+
+PooledZStream* SharedDictionary::GetPrimedState(
+    const ZlibContextPool::Key& key) {
+  for (PrimedState& primed : primed_) {
+    if (primed.key == key) return primed.state.get();
+  }
+  // The gzip wrapper does not support preset dictionaries.
+  if ((key.mode != DEFLATE && key.mode != DEFLATERAW) ||
+      primed_.size() >= kMaxPrimedStates) {
+    return nullptr;
+  }
+
+  auto state = std::make_unique<PooledZStream>();
+  state->unreported_allocations = &unreported_allocations_;
+  state->strm.zalloc = AllocForPooledZStream;
+  state->strm.zfree = FreeForPooledZStream;
+  state->strm.opaque = state.get();
+  if (deflateInit2(&state->strm,
+                   key.level,
+                   Z_DEFLATED,
+                   key.window_bits,
+                   key.mem_level,
+                   key.strategy) != Z_OK) {
+    return nullptr;
+  }
+  if (deflateSetDictionary(&state->strm, data_.data(), data_.size()) !=
+      Z_OK) {
+    CHECK_EQ(deflateEnd(&state->strm), Z_OK);
+    return nullptr;
+  }
+  primed_.push_back(PrimedState { key, std::move(state) });
+  return primed_.back().state.get();
+}
+
+
+bool SharedDictionary::CopyDeflateState(const ZlibContextPool::Key& key,
+                                        PooledZStream* state) {
+  Mutex::ScopedLock lock(mutex_);
+  PooledZStream* primed = GetPrimedState(key);
+  if (primed == nullptr) return false;
+
+  // deflateCopy() allocates through the allocator of the source state, and
+  // copies it over to the new one, so the allocations are moved afterwards.
+  const size_t before = primed->allocated.load(std::memory_order_relaxed);
+  if (deflateCopy(&state->strm, &primed->strm) != Z_OK) {
+    state->strm = z_stream {};
+    state->strm.zalloc = AllocForPooledZStream;
+    state->strm.zfree = FreeForPooledZStream;
+    state->strm.opaque = state;
+    return false;
+  }
+  const size_t copied =
+      primed->allocated.load(std::memory_order_relaxed) - before;
+  primed->allocated.fetch_sub(copied, std::memory_order_relaxed);
+  primed->unreported_allocations->fetch_sub(copied, std::memory_order_relaxed);
+  state->strm.opaque = state;
+  state->allocated.fetch_add(copied, std::memory_order_relaxed);
+  state->unreported_allocations->fetch_add(copied, std::memory_order_relaxed);
+  return true;
+}
+
+
+}  // anonymous namespace
+
+
+void DeleteZlibContextPool(ZlibContextPool* pool) {
+  delete pool;
+}
+
+
+ZlibContextPool* Environment::zlib_context_pool() {
+  if (!zlib_context_pool_)
+    zlib_context_pool_.reset(new ZlibContextPool(this));
+  return zlib_context_pool_.get();
+}
+
+
+ZlibContextPool::~ZlibContextPool() {
+  env_->RemoveMemoryPressureHook(OnMemoryPressure, this);
+  Trim();
+  CHECK_EQ(reported_, 0);
+}
+
+
+void ZlibContextPool::Trim() {
+  for (Entry& entry : idle_)
+    CHECK_EQ(deflateEnd(&entry.state->strm), Z_OK);
+  idle_.clear();
+  Report();
+}
+
+
+std::unique_ptr<PooledZStream> ZlibContextPool::Take(
+    const Key& key, std::atomic<ssize_t>* unreported_allocations) {
+  for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+    if (!(it->key == key)) continue;
+    std::unique_ptr<PooledZStream> state = std::move(it->state);
+    idle_.erase(it);
+    const ssize_t allocated = state->allocated.load(std::memory_order_relaxed);
+    unreported_allocations_.fetch_sub(allocated, std::memory_order_relaxed);
+    unreported_allocations->fetch_add(allocated, std::memory_order_relaxed);
+    state->unreported_allocations = unreported_allocations;
+    Report();
+    return state;
+  }
+  return nullptr;
+}
+
+
+bool ZlibContextPool::Give(const Key& key,
+                           std::unique_ptr<PooledZStream>* state) {
+  if (idle_.size() >= kMaxIdleStates) return false;
+  const ssize_t allocated =
+      (*state)->allocated.load(std::memory_order_relaxed);
+  (*state)->unreported_allocations->fetch_sub(allocated,
+                                              std::memory_order_relaxed);
+  unreported_allocations_.fetch_add(allocated, std::memory_order_relaxed);
+  (*state)->unreported_allocations = &unreported_allocations_;
+  idle_.push_back(Entry { key, std::move(*state) });
+  Report();
+  return true;
+}
+
+
+void ZlibContextPool::Report() {
+  ssize_t report =
+      unreported_allocations_.exchange(0, std::memory_order_relaxed);
+  if (report == 0) return;
+  reported_ += report;
+  env_->isolate()->AdjustAmountOfExternalAllocatedMemory(report);
+}
+
+namespace {
+
+
+void ZlibContext::DoThreadPoolWork() {
+  bool first_init_call = InitZlib();
+  if (first_init_call && err_ != Z_OK) {
+    return;
+  }
+
+  const Bytef* next_expected_header_byte = nullptr;
+
+  // If the avail_out is left at 0, then it means that it ran out
+  // of room.  If there was avail_out left over, then it means
+  // that all of the input was consumed.
+  switch (mode_) {
+    case DEFLATE:
+    case GZIP:
+    case DEFLATERAW:
+      if (parallel_) {
+        err_ = parallel_->Process(
+            strm_, flush_, level_, mem_level_, strategy_);
+      } else {
+        err_ = deflate(strm_, flush_);
+      }
+      break;
+    case UNZIP:
+      if (strm_->avail_in > 0) {
+        next_expected_header_byte = strm_->next_in;
+      }
+
+      switch (gzip_id_bytes_read_) {
+        case 0:
+          if (next_expected_header_byte == nullptr) {
+            break;
+          }
+
+          if (*next_expected_header_byte == GZIP_HEADER_ID1) {
+            gzip_id_bytes_read_ = 1;
+            next_expected_header_byte++;
+
+            if (strm_->avail_in == 1) {
+              // The only available byte was already read.
+              break;
+            }
+          } else {
+            mode_ = INFLATE;
+            break;
+          }
+
+          [[fallthrough]];
+        case 1:
+          if (next_expected_header_byte == nullptr) {
+            break;
+          }
+
+          if (*next_expected_header_byte == GZIP_HEADER_ID2) {
+            gzip_id_bytes_read_ = 2;
+            mode_ = GUNZIP;
+          } else {
+            // There is no actual difference between INFLATE and INFLATERAW
+            // (after initialization).
+            mode_ = INFLATE;
+          }
+
+          break;
         default:
           UNREACHABLE("invalid number of gzip magic number bytes read");
       }
@@ -822,20 +1604,20 @@ void ZlibContext::DoThreadPoolWork() {
     case INFLATE:
     case GUNZIP:
     case INFLATERAW:
-      err_ = inflate(&strm_, flush_);
+      err_ = inflate(strm_, flush_);
 
       // If data was encoded with dictionary (INFLATERAW will have it set in
       // SetDictionary, don't repeat that here)
       if (mode_ != INFLATERAW &&
           err_ == Z_NEED_DICT &&
-          !dictionary_.empty()) {
+          !dictionary().empty()) {
         // Load it
-        err_ = inflateSetDictionary(&strm_,
-                                    dictionary_.data(),
-                                    dictionary_.size());
+        err_ = inflateSetDictionary(strm_,
+                                    dictionary().data(),
+                                    dictionary().size());
         if (err_ == Z_OK) {
           // And try to decode again
-          err_ = inflate(&strm_, flush_);
+          err_ = inflate(strm_, flush_);
         } else if (err_ == Z_DATA_ERROR) {
           // Both inflateSetDictionary() and inflate() return Z_DATA_ERROR.
           // Make it possible for After() to tell a bad dictionary from bad
@@ -844,17 +1626,17 @@ void ZlibContext::DoThreadPoolWork() {
         }
       }
 
-      while (strm_.avail_in > 0 &&
+      while (strm_->avail_in > 0 &&
              mode_ == GUNZIP &&
              err_ == Z_STREAM_END &&
-             strm_.next_in[0] != 0x00) {
+             strm_->next_in[0] != 0x00) {
         // Bytes remain in input buffer. Perhaps this is another compressed
         // member in the same archive, or just trailing garbage.
         // Trailing zero bytes are okay, though, since they are frequently
         // used for padding.
 
         ResetStream();
-        err_ = inflate(&strm_, flush_);
+        err_ = inflate(strm_, flush_);
       }
       break;
     default:
@@ -865,10 +1647,10 @@ void ZlibContext::DoThreadPoolWork() {
 
 void ZlibContext::SetBuffers(const char* in, uint32_t in_len,
                              char* out, uint32_t out_len) {
-  strm_.avail_in = in_len;
-  strm_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(in));
-  strm_.avail_out = out_len;
-  strm_.next_out = reinterpret_cast<Bytef*>(out);
+  strm_->avail_in = in_len;
+  strm_->next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(in));
+  strm_->avail_out = out_len;
+  strm_->next_out = reinterpret_cast<Bytef*>(out);
 }
 
 
@@ -879,14 +1661,14 @@ void ZlibContext::SetFlush(int flush) {
 
 void ZlibContext::GetAfterWriteOffsets(uint32_t* avail_in,
                                        uint32_t* avail_out) const {
-  *avail_in = strm_.avail_in;
-  *avail_out = strm_.avail_out;
+  *avail_in = strm_->avail_in;
+  *avail_out = strm_->avail_out;
 }
 
 
 CompressionError ZlibContext::ErrorForMessage(const char* message) const {
-  if (strm_.msg != nullptr)
-    message = strm_.msg;
+  if (strm_->msg != nullptr)
+    message = strm_->msg;
 
   return CompressionError { message, ZlibStrerror(err_), err_ };
 }
@@ -897,14 +1679,14 @@ CompressionError ZlibContext::GetErrorInfo() const {
   switch (err_) {
   case Z_OK:
   case Z_BUF_ERROR:
-    if (strm_.avail_out != 0 && flush_ == Z_FINISH) {
+    if (strm_->avail_out != 0 && flush_ == Z_FINISH) {
       return ErrorForMessage("unexpected end of file");
     }
   case Z_STREAM_END:
     // normal statuses, not fatal
     break;
   case Z_NEED_DICT:
-    if (dictionary_.empty())
+    if (dictionary().empty())
       return ErrorForMessage("Missing dictionary");
     else
       return ErrorForMessage("Bad dictionary");
@@ -929,12 +1711,13 @@ CompressionError ZlibContext::ResetStream() {
     case DEFLATE:
     case DEFLATERAW:
     case GZIP:
-      err_ = deflateReset(&strm_);
+      err_ = deflateReset(strm_);
+      if (parallel_) parallel_->Reset();
       break;
     case INFLATE:
     case INFLATERAW:
     case GUNZIP:
-      err_ = inflateReset(&strm_);
+      err_ = inflateReset(strm_);
       break;
     default:
       break;
@@ -950,9 +1733,9 @@ CompressionError ZlibContext::ResetStream() {
 void ZlibContext::SetAllocationFunctions(alloc_func alloc,
                                          free_func free,
                                          void* opaque) {
-  strm_.zalloc = alloc;
-  strm_.zfree = free;
-  strm_.opaque = opaque;
+  strm_->zalloc = alloc;
+  strm_->zfree = free;
+  strm_->opaque = opaque;
 }
 
 
@@ -1013,7 +1796,7 @@ bool ZlibContext::InitZlib() {
     case DEFLATE:
     case GZIP:
     case DEFLATERAW:
-      err_ = deflateInit2(&strm_,
+      err_ = deflateInit2(strm_,
                           level_,
                           Z_DEFLATED,
                           window_bits_,
@@ -1024,7 +1807,7 @@ bool ZlibContext::InitZlib() {
     case GUNZIP:
     case INFLATERAW:
     case UNZIP:
-      err_ = inflateInit2(&strm_, window_bits_);
+      err_ = inflateInit2(strm_, window_bits_);
       break;
     default:
       UNREACHABLE();
@@ -1032,6 +1815,7 @@ bool ZlibContext::InitZlib() {
 
   if (err_ != Z_OK) {
     dictionary_.clear();
+    shared_dictionary_.reset();
     mode_ = NONE;
     return true;
   }
@@ -1043,7 +1827,7 @@ bool ZlibContext::InitZlib() {
 
 
 CompressionError ZlibContext::SetDictionary() {
-  if (dictionary_.empty())
+  if (dictionary().empty())
     return CompressionError {};
 
   err_ = Z_OK;
@@ -1051,16 +1835,16 @@ CompressionError ZlibContext::SetDictionary() {
   switch (mode_) {
     case DEFLATE:
     case DEFLATERAW:
-      err_ = deflateSetDictionary(&strm_,
-                                  dictionary_.data(),
-                                  dictionary_.size());
+      err_ = deflateSetDictionary(strm_,
+                                  dictionary().data(),
+                                  dictionary().size());
       break;
     case INFLATERAW:
       // The other inflate cases will have the dictionary set when inflate()
       // returns Z_NEED_DICT in Process()
-      err_ = inflateSetDictionary(&strm_,
-                                  dictionary_.data(),
-                                  dictionary_.size());
+      err_ = inflateSetDictionary(strm_,
+                                  dictionary().data(),
+                                  dictionary().size());
       break;
     default:
       break;
@@ -1085,7 +1869,7 @@ CompressionError ZlibContext::SetParams(int level, int strategy) {
   switch (mode_) {
     case DEFLATE:
     case DEFLATERAW:
-      err_ = deflateParams(&strm_, level, strategy);
+      err_ = deflateParams(strm_, level, strategy);
       break;
     default:
       break;
@@ -1095,10 +1879,270 @@ CompressionError ZlibContext::SetParams(int level, int strategy) {
     return ErrorForMessage("Failed to set parameters");
   }
 
+  // Blocks compressed in parallel are set up with these.
+  level_ = level;
+  strategy_ = strategy;
+
   return CompressionError {};
 }
 
 
+void ZlibContext::SetParallel(uint32_t threads, uint32_t block_size) {
+  CHECK((mode_ == DEFLATE || mode_ == GZIP || mode_ == DEFLATERAW) &&
+        "parallel compression needs a deflate stream");
+  CHECK(dictionary().empty() &&
+        "parallel compression does not support a dictionary");
+  CHECK((threads >= 1 && threads <= ParallelDeflate::kMaxThreads) &&
+        "invalid number of threads");
+  CHECK((block_size >= ParallelDeflate::kMinBlockSize &&
+         block_size <= ParallelDeflate::kMaxBlockSize) &&
+        "invalid block size");
+  CHECK_EQ(strm_->total_in, 0);
+
+  parallel_ = std::make_unique<ParallelDeflate>(
+      mode_, window_bits_, threads, block_size);
+}
+
+
+ParallelDeflate::ParallelDeflate(node_zlib_mode mode,
+                                 int window_bits,
+                                 uint32_t threads,
+                                 uint32_t block_size)
+    : mode_(mode),
+      // Without the gzip (+16) flag, and positive also for raw deflate.
+      window_bits_(window_bits < 0 ? -window_bits : window_bits & 15),
+      threads_(threads),
+      block_size_(block_size) {
+  Reset();
+}
+
+
+void ParallelDeflate::Reset() {
+  input_.clear();
+  window_.clear();
+  output_.clear();
+  output_offset_ = 0;
+  check_ = mode_ == GZIP ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0);
+  total_in_ = 0;
+  header_written_ = false;
+  finished_ = false;
+}
+
+
+int ParallelDeflate::Process(z_stream* strm,
+                             int flush,
+                             int level,
+                             int mem_level,
+                             int strategy) {
+  if (strm->avail_in > 0) {
+    if (finished_) return Z_STREAM_ERROR;
+    input_.insert(input_.end(), strm->next_in, strm->next_in + strm->avail_in);
+    strm->next_in += strm->avail_in;
+    strm->total_in += strm->avail_in;
+    strm->avail_in = 0;
+  }
+
+  Drain(strm);
+  if (output_offset_ < output_.size()) return Z_OK;
+  if (finished_) return Z_STREAM_END;
+
+  // Without a flush, only whole batches of blocks are compressed.
+  size_t length = input_.size();
+  if (flush == Z_NO_FLUSH) {
+    const size_t batch = block_size_ * threads_;
+    if (length < batch) return Z_OK;
+    length -= length % block_size_;
+  }
+
+  const bool finish = flush == Z_FINISH;
+  if (!header_written_) WriteHeader(level, strategy);
+  if (!CompressInput(length, finish, level, mem_level, strategy))
+    return Z_MEM_ERROR;
+  if (finish) {
+    WriteTrailer();
+    finished_ = true;
+  }
+
+  Drain(strm);
+  if (finished_ && output_offset_ == output_.size()) return Z_STREAM_END;
+  return Z_OK;
+}
+
+
+bool ParallelDeflate::CompressInput(size_t length,
+                                    bool finish,
+                                    int level,
+                                    int mem_level,
+                                    int strategy) {
+  struct Block {
+    const unsigned char* dictionary;
+    size_t dictionary_length;
+    const unsigned char* data;
+    size_t length;
+    std::vector<unsigned char> out;
+    uLong check;
+    bool ok;
+  };
+
+  const size_t window = size_t{1} << window_bits_;
+  // Finishing always needs a (possibly empty) last block.
+  const size_t count =
+      std::max<size_t>((length + block_size_ - 1) / block_size_, finish);
+  std::vector<Block> blocks(count);
+  for (size_t i = 0; i < count; i++) {
+    Block& block = blocks[i];
+    const size_t start = i * block_size_;
+    block.data = input_.data() + start;
+    block.length = std::min(block_size_, length - start);
+    if (start == 0) {
+      block.dictionary = window_.data();
+      block.dictionary_length = window_.size();
+    } else {
+      block.dictionary_length = std::min(window, start);
+      block.dictionary = block.data - block.dictionary_length;
+    }
+  }
+
+  auto compress = [&](Block* block, bool last) {
+    const bool gzip = mode_ == GZIP;
+    block->check = gzip ? crc32(0, block->data, block->length)
+                        : adler32(1, block->data, block->length);
+
+    z_stream strm{};
+    block->ok = false;
+    if (deflateInit2(&strm, level, Z_DEFLATED, -window_bits_, mem_level,
+                     strategy) != Z_OK) {
+      return;
+    }
+    if (block->dictionary_length > 0 &&
+        deflateSetDictionary(&strm, block->dictionary,
+                             block->dictionary_length) != Z_OK) {
+      deflateEnd(&strm);
+      return;
+    }
+
+    // Room for the sync flush marker on top of the worst case.
+    block->out.resize(deflateBound(&strm, block->length) + 16);
+    strm.next_in = const_cast<Bytef*>(block->data);
+    strm.avail_in = block->length;
+    strm.next_out = block->out.data();
+    strm.avail_out = block->out.size();
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int err;
+    while ((err = deflate(&strm, flush)) == Z_OK && strm.avail_out == 0) {
+      const size_t used = block->out.size();
+      block->out.resize(used * 2);
+      strm.next_out = block->out.data() + used;
+      strm.avail_out = block->out.size() - used;
+    }
+    block->out.resize(block->out.size() - strm.avail_out);
+    block->ok = err == (last ? Z_STREAM_END : Z_OK);
+    deflateEnd(&strm);
+  };
+
+  std::atomic<size_t> next{0};
+  auto run = [&]() {
+    for (size_t i; (i = next.fetch_add(1)) < count;)
+      compress(&blocks[i], finish && i == count - 1);
+  };
+  std::vector<std::thread> helpers;
+  const size_t helper_count = std::min<size_t>(threads_, count) - 1;
+  for (size_t i = 0; i < helper_count; i++) helpers.emplace_back(run);
+  run();
+  for (std::thread& helper : helpers) helper.join();
+
+  for (const Block& block : blocks) {
+    if (!block.ok) return false;
+    output_.insert(output_.end(), block.out.begin(), block.out.end());
+    check_ = mode_ == GZIP
+        ? crc32_combine(check_, block.check, block.length)
+        : adler32_combine(check_, block.check, block.length);
+  }
+  total_in_ += length;
+
+  const size_t keep = std::min(window, length + window_.size());
+  if (length >= keep) {
+    window_.assign(input_.begin() + length - keep, input_.begin() + length);
+  } else {
+    window_.erase(window_.begin(), window_.end() - (keep - length));
+    window_.insert(window_.end(), input_.begin(), input_.begin() + length);
+  }
+  input_.erase(input_.begin(), input_.begin() + length);
+  return true;
+}
+
+
+void ParallelDeflate::WriteHeader(int level, int strategy) {
+  header_written_ = true;
+  // The flags describing the level are computed as zlib does.
+  if (level == Z_DEFAULT_COMPRESSION) level = 6;
+  if (mode_ == GZIP) {
+    // No name, comment or modification time, as written by zlib itself.
+    unsigned char xfl = 0;
+    if (level == 9) {
+      xfl = 2;
+    } else if (level < 2 || strategy >= Z_HUFFMAN_ONLY) {
+      xfl = 4;
+    }
+#ifdef _WIN32
+    constexpr unsigned char kOS = 10;
+#else
+    constexpr unsigned char kOS = 3;
+#endif
+    const unsigned char header[] = {
+        GZIP_HEADER_ID1, GZIP_HEADER_ID2, Z_DEFLATED, 0, 0, 0, 0, 0, xfl, kOS};
+    output_.insert(output_.end(), header, header + sizeof(header));
+  } else if (mode_ == DEFLATE) {
+    // RFC 1950 2.2.
+    unsigned int flags = 3;
+    if (strategy >= Z_HUFFMAN_ONLY || level < 2) {
+      flags = 0;
+    } else if (level < 6) {
+      flags = 1;
+    } else if (level == 6) {
+      flags = 2;
+    }
+    unsigned int header = ((Z_DEFLATED + ((window_bits_ - 8) << 4)) << 8) |
+                          (flags << 6);
+    header += 31 - header % 31;
+    output_.push_back(static_cast<unsigned char>(header >> 8));
+    output_.push_back(static_cast<unsigned char>(header & 0xff));
+  }
+}
+
+
+void ParallelDeflate::WriteTrailer() {
+  if (mode_ == GZIP) {
+    // CRC-32 and input size, both little-endian (RFC 1952 2.3).
+    for (uLong value : {check_, total_in_}) {
+      for (int shift = 0; shift < 32; shift += 8)
+        output_.push_back(static_cast<unsigned char>(value >> shift));
+    }
+  } else if (mode_ == DEFLATE) {
+    // Adler-32, big-endian (RFC 1950 2.2).
+    for (int shift = 24; shift >= 0; shift -= 8)
+      output_.push_back(static_cast<unsigned char>(check_ >> shift));
+  }
+}
+
+
+void ParallelDeflate::Drain(z_stream* strm) {
+  const size_t n =
+      std::min<size_t>(strm->avail_out, output_.size() - output_offset_);
+  if (n > 0) {
+    memcpy(strm->next_out, output_.data() + output_offset_, n);
+    strm->next_out += n;
+    strm->avail_out -= n;
+    strm->total_out += n;
+    output_offset_ += n;
+  }
+  if (output_offset_ == output_.size()) {
+    output_.clear();
+    output_offset_ = 0;
+  }
+}
+
+
 void BrotliContext::SetBuffers(const char* in, uint32_t in_len,
                                char* out, uint32_t out_len) {
   next_in_ = reinterpret_cast<const uint8_t*>(in);
@@ -1137,6 +2181,7 @@ void BrotliEncoderContext::DoThreadPoolWork() {
 
 void BrotliEncoderContext::Close() {
   state_.reset();
+  shared_dictionary_.reset();
   mode_ = NONE;
 }
 
@@ -1157,7 +2202,28 @@ CompressionError BrotliEncoderContext::Init(brotli_alloc_func alloc,
 }
 
 CompressionError BrotliEncoderContext::ResetStream() {
-  return Init(alloc_, free_, alloc_opaque_);
+  CompressionError err = Init(alloc_, free_, alloc_opaque_);
+  if (err.IsError()) return err;
+  return AttachDictionary();
+}
+
+CompressionError BrotliEncoderContext::UseSharedDictionary(
+    std::shared_ptr<SharedDictionary> dictionary) {
+  shared_dictionary_ = std::move(dictionary);
+  return AttachDictionary();
+}
+
+CompressionError BrotliEncoderContext::AttachDictionary() {
+  if (!shared_dictionary_) return CompressionError {};
+  const BrotliEncoderPreparedDictionary* prepared =
+      shared_dictionary_->GetBrotliEncoderDictionary();
+  if (prepared == nullptr ||
+      !BrotliEncoderAttachPreparedDictionary(state_.get(), prepared)) {
+    return CompressionError("Failed to set dictionary",
+                            "ERR_BROTLI_DICTIONARY_FAILED",
+                            -1);
+  }
+  return CompressionError {};
 }
 
 CompressionError BrotliEncoderContext::SetParams(int key, uint32_t value) {
@@ -1185,6 +2251,7 @@ CompressionError BrotliEncoderContext::GetErrorInfo() const {
 
 void BrotliDecoderContext::Close() {
   state_.reset();
+  shared_dictionary_.reset();
   mode_ = NONE;
 }
 
@@ -1222,7 +2289,29 @@ CompressionError BrotliDecoderContext::Init(brotli_alloc_func alloc,
 }
 
 CompressionError BrotliDecoderContext::ResetStream() {
-  return Init(alloc_, free_, alloc_opaque_);
+  CompressionError err = Init(alloc_, free_, alloc_opaque_);
+  if (err.IsError()) return err;
+  return AttachDictionary();
+}
+
+CompressionError BrotliDecoderContext::UseSharedDictionary(
+    std::shared_ptr<SharedDictionary> dictionary) {
+  shared_dictionary_ = std::move(dictionary);
+  return AttachDictionary();
+}
+
+CompressionError BrotliDecoderContext::AttachDictionary() {
+  if (!shared_dictionary_) return CompressionError {};
+  const std::vector<unsigned char>& data = shared_dictionary_->data();
+  if (!BrotliDecoderAttachDictionary(state_.get(),
+                                     BROTLI_SHARED_DICTIONARY_RAW,
+                                     data.size(),
+                                     data.data())) {
+    return CompressionError("Failed to set dictionary",
+                            "ERR_BROTLI_DICTIONARY_FAILED",
+                            -1);
+  }
+  return CompressionError {};
 }
 
 CompressionError BrotliDecoderContext::SetParams(int key, uint32_t value) {
@@ -1254,6 +2343,497 @@ CompressionError BrotliDecoderContext::GetErrorInfo() const {
 }
 
 
+#if NODE_HAVE_ZSTD
+void ZstdContext::SetBuffers(const char* in, uint32_t in_len,
+                             char* out, uint32_t out_len) {
+  input_ = {in, in_len, 0};
+  output_ = {out, out_len, 0};
+}
+
+
+void ZstdContext::SetFlush(int flush) {
+  flush_ = static_cast<ZSTD_EndDirective>(flush);
+}
+
+
+void ZstdContext::GetAfterWriteOffsets(uint32_t* avail_in,
+                                       uint32_t* avail_out) const {
+  *avail_in = input_.size - input_.pos;
+  *avail_out = output_.size - output_.pos;
+}
+
+
+void ZstdCompressContext::DoThreadPoolWork() {
+  CHECK_EQ(mode_, ZSTD_COMPRESS);
+  CHECK(cctx_);
+  // Each ZSTD_e_end completes a frame. Writing more afterwards starts the
+  // next one, and decoders read the concatenated frames as one stream.
+  last_result_ = ZSTD_compressStream2(cctx_.get(), &output_, &input_, flush_);
+}
+
+
+void ZstdCompressContext::Close() {
+  cctx_.reset();
+  mode_ = NONE;
+}
+
+
+CompressionError ZstdCompressContext::Init(
+    uint64_t pledged_src_size, std::vector<unsigned char>&& dictionary) {
+  cctx_.reset(ZSTD_createCCtx());
+  if (!cctx_) {
+    return CompressionError("Could not initialize zstd instance",
+                            "ERR_ZLIB_INITIALIZATION_FAILED",
+                            -1);
+  }
+
+  if (!dictionary.empty() &&
+      ZSTD_isError(ZSTD_CCtx_loadDictionary(
+          cctx_.get(), dictionary.data(), dictionary.size()))) {
+    return CompressionError("Could not load zstd dictionary",
+                            "ERR_ZLIB_INITIALIZATION_FAILED",
+                            -1);
+  }
+
+  if (ZSTD_isError(
+          ZSTD_CCtx_setPledgedSrcSize(cctx_.get(), pledged_src_size))) {
+    return CompressionError("Could not set pledged size",
+                            "ERR_ZLIB_INITIALIZATION_FAILED",
+                            -1);
+  }
+
+  return CompressionError {};
+}
+
+
+CompressionError ZstdCompressContext::ResetStream() {
+  // Keeps the parameters and the dictionary.
+  if (ZSTD_isError(ZSTD_CCtx_reset(cctx_.get(), ZSTD_reset_session_only))) {
+    return CompressionError("Failed to reset stream",
+                            "ERR_ZSTD_RESET_FAILED",
+                            -1);
+  }
+  last_result_ = 0;
+  return CompressionError {};
+}
+
+
+CompressionError ZstdCompressContext::SetParams(int key, uint32_t value) {
+  // This is also how multithreaded compression is enabled, through
+  // ZSTD_c_nbWorkers, which fails if the library was built without it.
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx_.get(),
+                                          static_cast<ZSTD_cParameter>(key),
+                                          static_cast<int>(value)))) {
+    return CompressionError("Setting parameter failed",
+                            "ERR_ZSTD_PARAM_SET_FAILED",
+                            -1);
+  }
+  if (key == ZSTD_c_nbWorkers) multithreaded_ = value > 0;
+  return CompressionError {};
+}
+
+
+CompressionError ZstdCompressContext::GetErrorInfo() const {
+  if (ZSTD_isError(last_result_)) {
+    return CompressionError(ZSTD_getErrorName(last_result_),
+                            "ERR_ZSTD_COMPRESSION_FAILED",
+                            -1);
+  }
+  return CompressionError {};
+}
+
+
+void ZstdDecompressContext::DoThreadPoolWork() {
+  CHECK_EQ(mode_, ZSTD_DECOMPRESS);
+  CHECK(dctx_);
+  last_result_ = ZSTD_decompressStream(dctx_.get(), &output_, &input_);
+}
+
+
+void ZstdDecompressContext::Close() {
+  dctx_.reset();
+  mode_ = NONE;
+}
+
+
+CompressionError ZstdDecompressContext::Init(
+    uint64_t pledged_src_size, std::vector<unsigned char>&& dictionary) {
+  dctx_.reset(ZSTD_createDCtx());
+  if (!dctx_) {
+    return CompressionError("Could not initialize zstd instance",
+                            "ERR_ZLIB_INITIALIZATION_FAILED",
+                            -1);
+  }
+
+  if (!dictionary.empty() &&
+      ZSTD_isError(ZSTD_DCtx_loadDictionary(
+          dctx_.get(), dictionary.data(), dictionary.size()))) {
+    return CompressionError("Could not load zstd dictionary",
+                            "ERR_ZLIB_INITIALIZATION_FAILED",
+                            -1);
+  }
+
+  return CompressionError {};
+}
+
+
+CompressionError ZstdDecompressContext::ResetStream() {
+  if (ZSTD_isError(ZSTD_DCtx_reset(dctx_.get(), ZSTD_reset_session_only))) {
+    return CompressionError("Failed to reset stream",
+                            "ERR_ZSTD_RESET_FAILED",
+                            -1);
+  }
+  last_result_ = 0;
+  return CompressionError {};
+}
+
+
+CompressionError ZstdDecompressContext::SetParams(int key, uint32_t value) {
+  if (ZSTD_isError(ZSTD_DCtx_setParameter(dctx_.get(),
+                                          static_cast<ZSTD_dParameter>(key),
+                                          static_cast<int>(value)))) {
+    return CompressionError("Setting parameter failed",
+                            "ERR_ZSTD_PARAM_SET_FAILED",
+                            -1);
+  }
+  return CompressionError {};
+}
+
+
+CompressionError ZstdDecompressContext::GetErrorInfo() const {
+  if (ZSTD_isError(last_result_)) {
+    return CompressionError(ZSTD_getErrorName(last_result_),
+                            "ERR_ZSTD_DECOMPRESSION_FAILED",
+                            -1);
+  } else if (flush_ == ZSTD_e_end && last_result_ != 0 &&
+             input_.pos == input_.size && output_.pos < output_.size) {
+    // The input ended in the middle of a frame. Match zlib's behaviour.
+    return CompressionError("unexpected end of file",
+                            "Z_BUF_ERROR",
+                            Z_BUF_ERROR);
+  }
+  return CompressionError {};
+}
+#endif  // NODE_HAVE_ZSTD
+
+
+// Runs a compression context over the data of a DataQueue reader on the
+// threadpool, so that a Blob can be compressed or decompressed without
+// going through JavaScript streams. Input chunks are consumed in place and
+// released to the inner reader once the context has taken all of them.
+template <typename Context>
+class TransformReader final
+    : public DataQueue::Reader,
+      public std::enable_shared_from_this<TransformReader<Context>> {
+ public:
+  static constexpr size_t kOutputChunkSize = 64 * 1024;
+  // SetBuffers() takes 32-bit lengths.
+  static constexpr uint64_t kMaxInputSlice = 1024 * 1024 * 1024;
+
+  TransformReader(Environment* env, std::shared_ptr<DataQueue::Reader> inner)
+      : env_(env), inner_(std::move(inner)) {}
+
+  ~TransformReader() override { context_.Close(); }
+
+  Context* context() { return &context_; }
+
+  int Pull(Next next,
+           int options,
+           DataQueue::Vec* data,
+           size_t count,
+           size_t max_count_hint = bob::kMaxCountHint) override {
+    if (ended_) {
+      std::move(next)(bob::STATUS_EOS, nullptr, 0, [](size_t) {});
+      return bob::STATUS_EOS;
+    }
+    if (error_ != 0) {
+      std::move(next)(error_, nullptr, 0, [](size_t) {});
+      return error_;
+    }
+    CHECK(!next_);
+    next_ = std::move(next);
+    Step();
+    return error_ != 0 ? error_ : bob::STATUS_WAIT;
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(TransformReader)
+  SET_SELF_SIZE(TransformReader)
+
+ private:
+  class Work final : public ThreadPoolWork {
+   public:
+    explicit Work(std::shared_ptr<TransformReader> reader)
+        : ThreadPoolWork(reader->env_, "zlib"), reader_(std::move(reader)) {}
+
+    void DoThreadPoolWork() override { reader_->Process(); }
+
+    void AfterThreadPoolWork(int status) override {
+      std::unique_ptr<Work> self(this);
+      reader_->AfterProcess(status);
+    }
+
+   private:
+    std::shared_ptr<TransformReader> reader_;
+  };
+
+  bool has_input() const { return in_index_ < in_vecs_.size(); }
+
+  // Makes sure there is input to process, then processes it.
+  void Step() {
+    if (has_input() || input_ended_) {
+      (new Work(this->shared_from_this()))->ScheduleWork();
+      return;
+    }
+    auto self = this->shared_from_this();
+    inner_->Pull(
+        [self](int status,
+               const DataQueue::Vec* vecs,
+               size_t count,
+               bob::Done done) {
+          self->OnInput(status, vecs, count, std::move(done));
+        },
+        bob::OPTIONS_END,
+        nullptr,
+        0);
+  }
+
+  void OnInput(int status,
+               const DataQueue::Vec* vecs,
+               size_t count,
+               bob::Done done) {
+    if (status < 0) {
+      Fail(status);
+      return;
+    }
+    if (status == bob::STATUS_EOS) input_ended_ = true;
+    if (count > 0) {
+      in_vecs_.assign(vecs, vecs + count);
+      in_index_ = 0;
+      in_offset_ = 0;
+      in_done_ = std::move(done);
+    }
+    if (status == bob::STATUS_BLOCK && !has_input()) {
+      auto self = this->shared_from_this();
+      env_->SetImmediate([self](Environment* env) { self->Step(); });
+      return;
+    }
+    Step();
+  }
+
+  // Called on the threadpool. Fills one output chunk, or stops early when
+  // the input runs out or the stream ends.
+  void Process() {
+    output_ = std::make_shared<std::vector<uint8_t>>(kOutputChunkSize);
+    char* out = reinterpret_cast<char*>(output_->data());
+    uint32_t avail_out = kOutputChunkSize;
+    for (;;) {
+      const char* in = nullptr;
+      uint32_t in_len = 0;
+      if (has_input()) {
+        const DataQueue::Vec& vec = in_vecs_[in_index_];
+        in = reinterpret_cast<const char*>(vec.base + in_offset_);
+        in_len = static_cast<uint32_t>(
+            std::min(vec.len - in_offset_, kMaxInputSlice));
+      }
+      const bool finishing = !has_input() && input_ended_;
+      if (!has_input() && !finishing) break;
+
+      context_.SetBuffers(
+          in, in_len, out + (kOutputChunkSize - avail_out), avail_out);
+      if constexpr (std::is_same_v<Context, ZlibContext>) {
+        context_.SetFlush(finishing ? Z_FINISH : Z_NO_FLUSH);
+      } else {
+        context_.SetFlush(finishing ? BROTLI_OPERATION_FINISH
+                                    : BROTLI_OPERATION_PROCESS);
+      }
+      context_.DoThreadPoolWork();
+
+      uint32_t in_left;
+      uint32_t out_left;
+      context_.GetAfterWriteOffsets(&in_left, &out_left);
+      error_info_ = context_.GetErrorInfo();
+      if (error_info_.IsError()) break;
+
+      const uint32_t consumed = in_len - in_left;
+      const bool progress = consumed > 0 || out_left != avail_out;
+      avail_out = out_left;
+      if (has_input()) {
+        in_offset_ += consumed;
+        if (in_offset_ == in_vecs_[in_index_].len) {
+          in_index_++;
+          in_offset_ = 0;
+        }
+      }
+
+      // With all input given to the context, room left in the output means
+      // that everything has been written.
+      if (finishing && avail_out > 0) {
+        finished_ = true;
+        break;
+      }
+      if (avail_out == 0) break;
+      // The context takes no more input, for example because the
+      // compressed stream ended before the data did. Ignore the rest, as
+      // the zlib streams do.
+      if (!progress) {
+        finished_ = true;
+        break;
+      }
+    }
+    produced_ = kOutputChunkSize - avail_out;
+  }
+
+  void ReleaseInput() {
+    in_vecs_.clear();
+    in_index_ = 0;
+    in_offset_ = 0;
+    if (in_done_) std::move(in_done_)(0);
+    in_done_ = nullptr;
+  }
+
+  void AfterProcess(int status) {
+    if (status == UV_ECANCELED) {
+      Fail(UV_ECANCELED);
+      return;
+    }
+    if (!has_input() || finished_) ReleaseInput();
+    if (error_info_.IsError()) {
+      Fail(UV_EINVAL);
+      return;
+    }
+    if (finished_) ended_ = true;
+
+    if (produced_ == 0 && !ended_) {
+      output_.reset();
+      Step();
+      return;
+    }
+
+    Next next = std::move(next_);
+    next_ = nullptr;
+    if (produced_ == 0) {
+      output_.reset();
+      std::move(next)(bob::STATUS_EOS, nullptr, 0, [](size_t) {});
+      return;
+    }
+    DataQueue::Vec vec{output_->data(), produced_};
+    std::move(next)(ended_ ? bob::STATUS_EOS : bob::STATUS_CONTINUE,
+                    &vec,
+                    1,
+                    [output = std::move(output_)](size_t) {});
+  }
+
+  void Fail(int status) {
+    error_ = status;
+    ReleaseInput();
+    if (!next_) return;
+    Next next = std::move(next_);
+    next_ = nullptr;
+    std::move(next)(status, nullptr, 0, [](size_t) {});
+  }
+
+  Environment* env_;
+  std::shared_ptr<DataQueue::Reader> inner_;
+  Context context_;
+  Next next_;
+
+  // The chunk of input that the inner reader last yielded.
+  std::vector<DataQueue::Vec> in_vecs_;
+  size_t in_index_ = 0;
+  uint64_t in_offset_ = 0;
+  bob::Done in_done_;
+  bool input_ended_ = false;
+
+  // Written on the threadpool, read back in AfterProcess().
+  std::shared_ptr<std::vector<uint8_t>> output_;
+  size_t produced_ = 0;
+  CompressionError error_info_;
+  bool finished_ = false;
+
+  bool ended_ = false;
+  int error_ = 0;
+};
+
+// transformBlob(blob, mode, level) returns a Blob that yields the data of
+// |blob| compressed or decompressed with |mode|. The result can be read
+// once. |level| is the compression level for zlib and the quality for
+// Brotli, where -1 picks the default.
+static void TransformBlob(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(Blob::HasInstance(env, args[0]));
+  CHECK(args[1]->IsUint32());
+  CHECK(args[2]->IsInt32());
+  Blob* blob;
+  ASSIGN_OR_RETURN_UNWRAP(&blob, args[0]);
+  node_zlib_mode mode =
+      static_cast<node_zlib_mode>(args[1].As<Uint32>()->Value());
+  int level = args[2].As<Int32>()->Value();
+
+  std::shared_ptr<DataQueue::Reader> inner =
+      blob->getDataQueue().get_reader();
+  if (!inner) {
+    return THROW_ERR_INVALID_STATE(env, "The Blob has already been read");
+  }
+
+  std::shared_ptr<DataQueue::Reader> reader;
+  switch (mode) {
+    case DEFLATE:
+    case INFLATE:
+    case GZIP:
+    case GUNZIP:
+    case DEFLATERAW:
+    case INFLATERAW:
+    case UNZIP: {
+      CHECK(level >= Z_MIN_LEVEL && level <= Z_MAX_LEVEL);
+      auto transform = std::make_shared<TransformReader<ZlibContext>>(
+          env, std::move(inner));
+      ZlibContext* context = transform->context();
+      context->SetMode(mode);
+      context->SetAllocationFunctions(Z_NULL, Z_NULL, Z_NULL);
+      context->Init(level,
+                    Z_DEFAULT_WINDOWBITS,
+                    Z_DEFAULT_MEMLEVEL,
+                    Z_DEFAULT_STRATEGY,
+                    {});
+      reader = std::move(transform);
+      break;
+    }
+    case BROTLI_ENCODE: {
+      auto transform = std::make_shared<TransformReader<BrotliEncoderContext>>(
+          env, std::move(inner));
+      BrotliEncoderContext* context = transform->context();
+      context->SetMode(mode);
+      if (context->Init(nullptr, nullptr, nullptr).IsError()) {
+        return THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+      }
+      if (level >= 0) context->SetParams(BROTLI_PARAM_QUALITY, level);
+      reader = std::move(transform);
+      break;
+    }
+    case BROTLI_DECODE: {
+      auto transform = std::make_shared<TransformReader<BrotliDecoderContext>>(
+          env, std::move(inner));
+      BrotliDecoderContext* context = transform->context();
+      context->SetMode(mode);
+      if (context->Init(nullptr, nullptr, nullptr).IsError()) {
+        return THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+      }
+      reader = std::move(transform);
+      break;
+    }
+    default:
+      UNREACHABLE("unsupported mode for transformBlob");
+  }
+
+  std::shared_ptr<DataQueue> data_queue = DataQueue::Create();
+  CHECK(data_queue->append(DataQueue::CreateSourceEntry(std::move(reader)))
+            .value_or(false));
+  data_queue->cap();
+  BaseObjectPtr<Blob> result = Blob::Create(env, std::move(data_queue));
+  if (result) args.GetReturnValue().Set(result->object());
+}
+
 template <typename Stream>
 struct MakeClass {
   static void Make(Environment* env, Local<Object> target, const char* name) {
@@ -1271,6 +2851,10 @@ struct MakeClass {
     SetProtoMethod(isolate, z, "init", Stream::Init);
     SetProtoMethod(isolate, z, "params", Stream::Params);
     SetProtoMethod(isolate, z, "reset", Stream::Reset);
+    SetProtoMethod(
+        isolate, z, "setInlineThreshold", Stream::SetInlineThreshold);
+    if constexpr (requires { Stream::SetParallel; })
+      SetProtoMethod(isolate, z, "setParallel", Stream::SetParallel);
 
     SetConstructorFunction(env->context(), target, name, z);
   }
@@ -1283,6 +2867,9 @@ struct MakeClass {
     registry->Register(Stream::Init);
     registry->Register(Stream::Params);
     registry->Register(Stream::Reset);
+    registry->Register(Stream::SetInlineThreshold);
+    if constexpr (requires { Stream::SetParallel; })
+      registry->Register(Stream::SetParallel);
   }
 };
 
@@ -1313,6 +2900,25 @@ static void CRC32(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(result);
 }
 
+// registerDictionary(id, data)
+static void RegisterDictionary(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsArrayBufferView());
+  ArrayBufferViewContents<unsigned char> data(args[1]);
+  CHECK_GT(data.length(), 0);
+  SharedDictionary::Register(
+      args[0].As<Uint32>()->Value(),
+      std::make_shared<SharedDictionary>(std::vector<unsigned char>(
+          data.data(), data.data() + data.length())));
+}
+
+// unregisterDictionary(id)
+static void UnregisterDictionary(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  args.GetReturnValue().Set(
+      SharedDictionary::Unregister(args[0].As<Uint32>()->Value()));
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -1322,8 +2928,15 @@ void Initialize(Local<Object> target,
   MakeClass<ZlibStream>::Make(env, target, "Zlib");
   MakeClass<BrotliEncoderStream>::Make(env, target, "BrotliEncoder");
   MakeClass<BrotliDecoderStream>::Make(env, target, "BrotliDecoder");
+#if NODE_HAVE_ZSTD
+  MakeClass<ZstdCompressStream>::Make(env, target, "ZstdCompress");
+  MakeClass<ZstdDecompressStream>::Make(env, target, "ZstdDecompress");
+#endif  // NODE_HAVE_ZSTD
 
   SetMethod(context, target, "crc32", CRC32);
+  SetMethod(context, target, "registerDictionary", RegisterDictionary);
+  SetMethod(context, target, "unregisterDictionary", UnregisterDictionary);
+  SetMethod(context, target, "transformBlob", TransformBlob);
   target->Set(env->context(),
               FIXED_ONE_BYTE_STRING(env->isolate(), "ZLIB_VERSION"),
               FIXED_ONE_BYTE_STRING(env->isolate(), ZLIB_VERSION)).Check();
@@ -1333,7 +2946,14 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   MakeClass<ZlibStream>::Make(registry);
   MakeClass<BrotliEncoderStream>::Make(registry);
   MakeClass<BrotliDecoderStream>::Make(registry);
+#if NODE_HAVE_ZSTD
+  MakeClass<ZstdCompressStream>::Make(registry);
+  MakeClass<ZstdDecompressStream>::Make(registry);
+#endif  // NODE_HAVE_ZSTD
   registry->Register(CRC32);
+  registry->Register(RegisterDictionary);
+  registry->Register(UnregisterDictionary);
+  registry->Register(TransformBlob);
 }
 
 }  // anonymous namespace
@@ -1456,6 +3076,45 @@ void DefineZlibConstants(Local<Object> target) {
   NODE_DEFINE_CONSTANT(target, BROTLI_DECODER_ERROR_ALLOC_RING_BUFFER_2);
   NODE_DEFINE_CONSTANT(target, BROTLI_DECODER_ERROR_ALLOC_BLOCK_TYPE_TREES);
   NODE_DEFINE_CONSTANT(target, BROTLI_DECODER_ERROR_UNREACHABLE);
+
+#if NODE_HAVE_ZSTD
+  // Zstd constants
+  NODE_DEFINE_CONSTANT(target, ZSTD_COMPRESS);
+  NODE_DEFINE_CONSTANT(target, ZSTD_DECOMPRESS);
+  NODE_DEFINE_CONSTANT(target, ZSTD_e_continue);
+  NODE_DEFINE_CONSTANT(target, ZSTD_e_flush);
+  NODE_DEFINE_CONSTANT(target, ZSTD_e_end);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_compressionLevel);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_windowLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_hashLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_chainLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_searchLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_minMatch);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_targetLength);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_strategy);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_enableLongDistanceMatching);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_ldmHashLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_ldmMinMatch);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_ldmBucketSizeLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_ldmHashRateLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_contentSizeFlag);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_checksumFlag);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_dictIDFlag);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_nbWorkers);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_jobSize);
+  NODE_DEFINE_CONSTANT(target, ZSTD_c_overlapLog);
+  NODE_DEFINE_CONSTANT(target, ZSTD_d_windowLogMax);
+  NODE_DEFINE_CONSTANT(target, ZSTD_CLEVEL_DEFAULT);
+  NODE_DEFINE_CONSTANT(target, ZSTD_fast);
+  NODE_DEFINE_CONSTANT(target, ZSTD_dfast);
+  NODE_DEFINE_CONSTANT(target, ZSTD_greedy);
+  NODE_DEFINE_CONSTANT(target, ZSTD_lazy);
+  NODE_DEFINE_CONSTANT(target, ZSTD_lazy2);
+  NODE_DEFINE_CONSTANT(target, ZSTD_btlazy2);
+  NODE_DEFINE_CONSTANT(target, ZSTD_btopt);
+  NODE_DEFINE_CONSTANT(target, ZSTD_btultra);
+  NODE_DEFINE_CONSTANT(target, ZSTD_btultra2);
+#endif  // NODE_HAVE_ZSTD
 }
 
 }  // namespace node
@@ -2,10 +2,27 @@
 #include <string>
 #include <vector>
 #include "env-inl.h"
+#include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_mutex.h"
+#include "v8-fast-api-calls.h"
 
 namespace node {
 
+using v8::CFunction;
+using v8::Context;
+using v8::FastApiCallbackOptions;
+using v8::FastApiTypedArray;
+using v8::FastOneByteString;
+using v8::FunctionCallbackInfo;
+using v8::Isolate;
+using v8::Local;
+using v8::NewStringType;
+using v8::Object;
+using v8::String;
+using v8::Uint8Array;
+using v8::Value;
+
 #ifdef _WIN32
 constexpr bool IsPathSeparator(char c) noexcept {
   return c == '\\' || c == '/';
@@ -98,7 +115,7 @@ std::string PathResolve(Environment* env,
   std::string resolvedTail = "";
   bool resolvedAbsolute = false;
   const size_t numArgs = paths.size();
-  auto cwd = env->GetCwd(env->exec_path());
+  auto cwd = GetCachedCwd(env);
 
   for (int i = numArgs - 1; i >= -1; i--) {
     std::string path;
@@ -235,7 +252,7 @@ std::string PathResolve(Environment* env,
                         const std::vector<std::string_view>& paths) {
   std::string resolvedPath;
   bool resolvedAbsolute = false;
-  auto cwd = env->GetCwd(env->exec_path());
+  auto cwd = GetCachedCwd(env);
   const size_t numArgs = paths.size();
 
   for (int i = numArgs - 1; i >= -1 && !resolvedAbsolute; i--) {
@@ -264,8 +281,129 @@ std::string PathResolve(Environment* env,
 
   return normalizedPath;
 }
+
+std::string PathNormalize(std::string_view path) {
+  if (path.empty()) return ".";
+
+  const bool isAbsolute = path.front() == '/';
+  const bool trailingSeparator = path.back() == '/';
+
+  std::string normalized = NormalizeString(path, !isAbsolute, "/");
+
+  if (normalized.empty()) {
+    if (isAbsolute) return "/";
+    return trailingSeparator ? "./" : ".";
+  }
+  if (trailingSeparator) normalized += '/';
+
+  return isAbsolute ? "/" + normalized : normalized;
+}
+
+std::string PathJoin(const std::vector<std::string_view>& paths) {
+  std::string joined;
+  for (const std::string_view path : paths) {
+    if (path.empty()) continue;
+    if (!joined.empty()) joined += '/';
+    joined += path;
+  }
+  if (joined.empty()) return ".";
+  return PathNormalize(joined);
+}
+
+std::string PathRelative(Environment* env,
+                         std::string_view from,
+                         std::string_view to) {
+  if (from == to) return "";
+
+  const std::string from_path = PathResolve(env, {from});
+  const std::string to_path = PathResolve(env, {to});
+  if (from_path == to_path) return "";
+
+  // Both paths are absolute, so skip the leading slash.
+  const size_t fromStart = 1;
+  const size_t fromEnd = from_path.size();
+  const size_t fromLen = fromEnd - fromStart;
+  const size_t toStart = 1;
+  const size_t toLen = to_path.size() - toStart;
+
+  // Compare paths to find the longest common path from root.
+  const size_t length = std::min(fromLen, toLen);
+  int lastCommonSep = -1;
+  size_t i = 0;
+  for (; i < length; i++) {
+    const char fromCode = from_path[fromStart + i];
+    if (fromCode != to_path[toStart + i]) break;
+    if (fromCode == '/') lastCommonSep = i;
+  }
+
+  if (i == length) {
+    if (toLen > length) {
+      if (to_path[toStart + i] == '/') {
+        // `from` is the exact base path for `to`.
+        // For example: from='/foo/bar'; to='/foo/bar/baz'
+        return to_path.substr(toStart + i + 1);
+      }
+      if (i == 0) {
+        // `from` is the root.
+        // For example: from='/'; to='/foo'
+        return to_path.substr(toStart + i);
+      }
+    } else if (fromLen > length) {
+      if (from_path[fromStart + i] == '/') {
+        // `to` is the exact base path for `from`.
+        // For example: from='/foo/bar/baz'; to='/foo/bar'
+        lastCommonSep = i;
+      } else if (i == 0) {
+        // `to` is the root.
+        // For example: from='/foo/bar'; to='/'
+        lastCommonSep = 0;
+      }
+    }
+  }
+
+  // Generate the relative path based on the path difference between `to`
+  // and `from`.
+  std::string out;
+  for (i = fromStart + lastCommonSep + 1; i <= fromEnd; ++i) {
+    if (i == fromEnd || from_path[i] == '/') {
+      out += out.empty() ? ".." : "/..";
+    }
+  }
+
+  // Lastly, append the rest of the destination (`to`) path that comes after
+  // the common path parts.
+  return out + to_path.substr(toStart + lastCommonSep);
+}
 #endif  // _WIN32
 
+namespace {
+Mutex cwd_mutex;
+std::string cached_cwd;  // Empty while invalid.
+}  // namespace
+
+std::string GetCachedCwd(Environment* env) {
+  {
+    Mutex::ScopedLock lock(cwd_mutex);
+    if (!cached_cwd.empty()) return cached_cwd;
+  }
+
+  char cwd[PATH_MAX_BYTES];
+  size_t size = PATH_MAX_BYTES;
+  if (uv_cwd(cwd, &size) != 0) {
+    // Do not cache the exec_path fallback, the directory may come back.
+    return env->GetCwd(env->exec_path());
+  }
+
+  Mutex::ScopedLock lock(cwd_mutex);
+  cached_cwd.assign(cwd, size);
+  return cached_cwd;
+}
+
+void InvalidateCachedCwd() {
+  Mutex::ScopedLock lock(cwd_mutex);
+  cached_cwd.clear();
+}
+
 void ToNamespacedPath(Environment* env, BufferValue* path) {
 #ifdef _WIN32
   if (path->length() == 0) return;
@@ -326,4 +464,251 @@ void FromNamespacedPath(std::string* path) {
 #endif
 }
 
+namespace path {
+
+#ifndef _WIN32
+// Returned by the *Into() methods when the input cannot take the one-byte
+// path, for example because the cwd is not ASCII. The caller falls back to
+// the string returning methods.
+constexpr int32_t kFallback = -2;
+// Returned by the *Into() methods when |out| is too small for the result.
+constexpr int32_t kOutTooSmall = -1;
+
+static bool IsAscii(std::string_view str) {
+  for (const char c : str) {
+    if (static_cast<unsigned char>(c) >= 0x80) return false;
+  }
+  return true;
+}
+
+// Non-absolute paths are resolved against the cwd, which is UTF-8 and cannot
+// be mixed with the Latin-1 input of the *Into() methods unless it is ASCII.
+static bool CanResolveOneByte(Environment* env, std::string_view path) {
+  return (!path.empty() && path.front() == '/') ||
+         IsAscii(GetCachedCwd(env));
+}
+
+static int32_t WriteInto(const std::string& result,
+                         uint8_t* out,
+                         size_t out_length) {
+  if (result.size() > out_length) return kOutTooSmall;
+  memcpy(out, result.data(), result.size());
+  return static_cast<int32_t>(result.size());
+}
+
+// Reads a one-byte string as Latin-1 into a std::string. The path
+// algorithms only look at '/' and '.', so the other bytes pass through as
+// they are and the result can be decoded as Latin-1 again.
+static std::string ReadOneByte(Isolate* isolate, Local<String> str) {
+  std::string result(str->Length(), '\0');
+  str->WriteOneByte(isolate,
+                    reinterpret_cast<uint8_t*>(result.data()),
+                    0,
+                    result.size(),
+                    String::NO_NULL_TERMINATION);
+  return result;
+}
+
+static void ReturnString(const FunctionCallbackInfo<Value>& args,
+                         const std::string& result) {
+  Local<String> ret;
+  if (String::NewFromUtf8(args.GetIsolate(),
+                          result.data(),
+                          NewStringType::kNormal,
+                          result.size())
+          .ToLocal(&ret)) {
+    args.GetReturnValue().Set(ret);
+  }
+}
+
+static void Resolve(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  std::vector<Utf8Value> values;
+  values.reserve(args.Length());
+  std::vector<std::string_view> paths;
+  paths.reserve(args.Length());
+  for (int i = 0; i < args.Length(); i++) {
+    CHECK(args[i]->IsString());
+    values.emplace_back(env->isolate(), args[i]);
+    paths.push_back(values.back().ToStringView());
+  }
+  ReturnString(args, PathResolve(env, paths));
+}
+
+static void Normalize(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsString());
+  Utf8Value path(args.GetIsolate(), args[0]);
+  ReturnString(args, PathNormalize(path.ToStringView()));
+}
+
+static void Join(const FunctionCallbackInfo<Value>& args) {
+  std::vector<Utf8Value> values;
+  values.reserve(args.Length());
+  std::vector<std::string_view> paths;
+  paths.reserve(args.Length());
+  for (int i = 0; i < args.Length(); i++) {
+    CHECK(args[i]->IsString());
+    values.emplace_back(args.GetIsolate(), args[i]);
+    paths.push_back(values.back().ToStringView());
+  }
+  ReturnString(args, PathJoin(paths));
+}
+
+static void Relative(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  Utf8Value from(env->isolate(), args[0]);
+  Utf8Value to(env->isolate(), args[1]);
+  ReturnString(
+      args, PathRelative(env, from.ToStringView(), to.ToStringView()));
+}
+
+// The *Into() methods take one-byte strings and write the Latin-1 result
+// into |out|, returning its length. V8 fast calls cannot return strings, so
+// this lets the optimized callers skip both the UTF-8 transcoding and the
+// string allocation until they decode the bytes they need.
+static void NormalizeInto(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsUint8Array());
+  Local<String> path = args[0].As<String>();
+  if (!path->IsOneByte()) return args.GetReturnValue().Set(kFallback);
+  std::string result =
+      PathNormalize(ReadOneByte(args.GetIsolate(), path));
+  ArrayBufferViewContents<uint8_t> out(args[1]);
+  args.GetReturnValue().Set(
+      WriteInto(result, const_cast<uint8_t*>(out.data()), out.length()));
+}
+
+static int32_t FastNormalizeInto(Local<Value> receiver,
+                                 const FastOneByteString& path,
+                                 const FastApiTypedArray<uint8_t>& out) {
+  uint8_t* out_data;
+  CHECK(out.getStorageIfAligned(&out_data));
+  return WriteInto(
+      PathNormalize(std::string_view(path.data, path.length)),
+      out_data,
+      out.length());
+}
+
+static CFunction fast_normalize_into(CFunction::Make(FastNormalizeInto));
+
+static void ResolveInto(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsUint8Array());
+  Local<String> arg = args[0].As<String>();
+  if (!arg->IsOneByte()) return args.GetReturnValue().Set(kFallback);
+  std::string path = ReadOneByte(env->isolate(), arg);
+  if (!CanResolveOneByte(env, path)) {
+    return args.GetReturnValue().Set(kFallback);
+  }
+  ArrayBufferViewContents<uint8_t> out(args[1]);
+  args.GetReturnValue().Set(WriteInto(PathResolve(env, {path}),
+                                      const_cast<uint8_t*>(out.data()),
+                                      out.length()));
+}
+
+static int32_t FastResolveInto(
+    Local<Value> receiver,
+    const FastOneByteString& path,
+    const FastApiTypedArray<uint8_t>& out,
+    // NOLINTNEXTLINE(runtime/references) This is V8 api.
+    FastApiCallbackOptions& options) {
+  Environment* env = Environment::GetCurrent(options.isolate);
+  std::string_view input(path.data, path.length);
+  if (!CanResolveOneByte(env, input)) return kFallback;
+  uint8_t* out_data;
+  CHECK(out.getStorageIfAligned(&out_data));
+  return WriteInto(PathResolve(env, {input}), out_data, out.length());
+}
+
+static CFunction fast_resolve_into(CFunction::Make(FastResolveInto));
+
+static void RelativeInto(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  CHECK(args[2]->IsUint8Array());
+  Local<String> from_arg = args[0].As<String>();
+  Local<String> to_arg = args[1].As<String>();
+  if (!from_arg->IsOneByte() || !to_arg->IsOneByte()) {
+    return args.GetReturnValue().Set(kFallback);
+  }
+  std::string from = ReadOneByte(env->isolate(), from_arg);
+  std::string to = ReadOneByte(env->isolate(), to_arg);
+  if (!CanResolveOneByte(env, from) || !CanResolveOneByte(env, to)) {
+    return args.GetReturnValue().Set(kFallback);
+  }
+  ArrayBufferViewContents<uint8_t> out(args[2]);
+  args.GetReturnValue().Set(WriteInto(PathRelative(env, from, to),
+                                      const_cast<uint8_t*>(out.data()),
+                                      out.length()));
+}
+
+static int32_t FastRelativeInto(
+    Local<Value> receiver,
+    const FastOneByteString& from,
+    const FastOneByteString& to,
+    const FastApiTypedArray<uint8_t>& out,
+    // NOLINTNEXTLINE(runtime/references) This is V8 api.
+    FastApiCallbackOptions& options) {
+  Environment* env = Environment::GetCurrent(options.isolate);
+  std::string_view from_input(from.data, from.length);
+  std::string_view to_input(to.data, to.length);
+  if (!CanResolveOneByte(env, from_input) ||
+      !CanResolveOneByte(env, to_input)) {
+    return kFallback;
+  }
+  uint8_t* out_data;
+  CHECK(out.getStorageIfAligned(&out_data));
+  return WriteInto(
+      PathRelative(env, from_input, to_input), out_data, out.length());
+}
+
+static CFunction fast_relative_into(CFunction::Make(FastRelativeInto));
+#endif  // _WIN32
+
+// Only the POSIX variants are implemented natively. On Windows the binding
+// is empty and lib/path.js keeps using its JavaScript implementation.
+static void Initialize(Local<Object> target,
+                       Local<Value> unused,
+                       Local<Context> context,
+                       void* priv) {
+#ifndef _WIN32
+  SetMethodNoSideEffect(context, target, "resolve", Resolve);
+  SetMethodNoSideEffect(context, target, "normalize", Normalize);
+  SetMethodNoSideEffect(context, target, "join", Join);
+  SetMethodNoSideEffect(context, target, "relative", Relative);
+  SetFastMethod(
+      context, target, "normalizeInto", NormalizeInto, &fast_normalize_into);
+  SetFastMethod(
+      context, target, "resolveInto", ResolveInto, &fast_resolve_into);
+  SetFastMethod(
+      context, target, "relativeInto", RelativeInto, &fast_relative_into);
+#endif  // _WIN32
+}
+
+static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+#ifndef _WIN32
+  registry->Register(Resolve);
+  registry->Register(Normalize);
+  registry->Register(Join);
+  registry->Register(Relative);
+  registry->Register(NormalizeInto);
+  registry->Register(FastNormalizeInto);
+  registry->Register(fast_normalize_into.GetTypeInfo());
+  registry->Register(ResolveInto);
+  registry->Register(FastResolveInto);
+  registry->Register(fast_resolve_into.GetTypeInfo());
+  registry->Register(RelativeInto);
+  registry->Register(FastRelativeInto);
+  registry->Register(fast_relative_into.GetTypeInfo());
+#endif  // _WIN32
+}
+
+}  // namespace path
 }  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(path, node::path::Initialize)
+NODE_BINDING_EXTERNAL_REFERENCE(path, node::path::RegisterExternalReferences)
@@ -20,6 +20,20 @@ std::string NormalizeString(const std::string_view path,
 std::string PathResolve(Environment* env,
                         const std::vector<std::string_view>& paths);
 
+#ifndef _WIN32
+// Ports of the POSIX path.normalize(), path.join() and path.relative().
+std::string PathNormalize(std::string_view path);
+std::string PathJoin(const std::vector<std::string_view>& paths);
+std::string PathRelative(Environment* env,
+                         std::string_view from,
+                         std::string_view to);
+#endif  // _WIN32
+
+// Returns process.cwd(). The result is cached for the whole process until
+// the next successful process.chdir(), which calls InvalidateCachedCwd().
+std::string GetCachedCwd(Environment* env);
+void InvalidateCachedCwd();
+
 #ifdef _WIN32
 constexpr bool IsWindowsDeviceRoot(const char c) noexcept;
 #endif  // _WIN32
@@ -9,13 +9,63 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace {
 
+using node::permission::FSPermission;
+
+std::atomic<uint64_t> next_tree_generation{0};
+
+// The recent decisions of the current thread, keyed by the generation of
+// the tree and the resolved path. Since generations are never reused, grant
+// changes invalidate the entries without touching the caches of other
+// threads. The cache is cleared when it is full, which keeps it bounded
+// without the bookkeeping of an LRU.
+class DecisionCache {
+ public:
+  static constexpr size_t kMaxEntries = 512;
+
+  struct Key {
+    uint64_t generation;
+    std::string path;
+
+    bool operator==(const Key& other) const {
+      return generation == other.generation && path == other.path;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return std::hash<std::string>()(key.path) ^
+             std::hash<uint64_t>()(key.generation);
+    }
+  };
+
+  bool Get(const Key& key, bool* granted) const {
+    auto it = decisions_.find(key);
+    if (it == decisions_.end()) return false;
+    *granted = it->second;
+    return true;
+  }
+
+  void Set(Key&& key, bool granted) {
+    if (decisions_.size() >= kMaxEntries) decisions_.clear();
+    decisions_.emplace(std::move(key), granted);
+  }
+
+ private:
+  std::unordered_map<Key, bool, KeyHash> decisions_;
+};
+
+thread_local DecisionCache decision_cache;
+
 std::string WildcardIfDir(const std::string& res) noexcept {
   auto path = std::filesystem::path(res);
   auto file_status = std::filesystem::status(path);
@@ -37,16 +87,13 @@ void FreeRecursivelyNode(
     }
   }
 
-  if (node->wildcard_child != nullptr) {
-    delete node->wildcard_child;
-  }
+  FreeRecursivelyNode(node->wildcard_child);
   delete node;
 }
 
-bool is_tree_granted(
-    node::Environment* env,
-    const node::permission::FSPermission::RadixTree* granted_tree,
-    const std::string_view& param) {
+bool is_tree_granted(node::Environment* env,
+                     const FSPermission::RadixTree* granted_tree,
+                     const std::string_view& param) {
   std::string resolved_param = node::PathResolve(env, {param});
 #ifdef _WIN32
   // Remove leading "\\?\" from UNC path
@@ -63,7 +110,13 @@ bool is_tree_granted(
     resolved_param.erase(0, 2);
   }
 #endif
-  return granted_tree->Lookup(resolved_param, true);
+  DecisionCache::Key key{granted_tree->generation(),
+                         std::move(resolved_param)};
+  bool granted;
+  if (decision_cache.Get(key, &granted)) return granted;
+  granted = granted_tree->Lookup(key.path, true);
+  decision_cache.Set(std::move(key), granted);
+  return granted;
 }
 
 void PrintTree(const node::permission::FSPermission::RadixTree::Node* node,
@@ -163,35 +216,120 @@ bool FSPermission::is_granted(Environment* env,
   }
 }
 
-FSPermission::RadixTree::RadixTree() : root_node_(new Node("")) {}
+FSPermission::RadixTree::RadixTree()
+    : root_node_(new Node("")), generation_(++next_tree_generation) {
+  Flatten();
+}
 
 FSPermission::RadixTree::~RadixTree() {
   FreeRecursivelyNode(root_node_);
 }
 
+void FSPermission::RadixTree::Flatten() {
+  flat_nodes_.clear();
+  flat_children_.clear();
+  flat_prefixes_.clear();
+  FlattenNode(root_node_);
+}
+
+uint32_t FSPermission::RadixTree::FlattenNode(const Node* node) {
+  const uint32_t index = flat_nodes_.size();
+  const uint32_t first_child = flat_children_.size();
+  flat_nodes_.push_back({static_cast<uint32_t>(flat_prefixes_.size()),
+                         static_cast<uint32_t>(node->prefix.length()),
+                         first_child,
+                         static_cast<uint32_t>(node->children.size()),
+                         kNoNode,
+                         node->wildcard_child != nullptr,
+                         node->IsEndNode()});
+  flat_prefixes_ += node->prefix;
+
+  // Reserve the slots of the children first, so that they stay adjacent
+  // while their own subtrees are appended.
+  std::vector<std::pair<char, const Node*>> children(node->children.begin(),
+                                                     node->children.end());
+  std::sort(children.begin(), children.end());
+  flat_children_.resize(first_child + children.size());
+  for (size_t i = 0; i < children.size(); ++i) {
+    const uint32_t child = FlattenNode(children[i].second);
+    flat_children_[first_child + i] = {children[i].first, child};
+    if (children[i].first == '*') flat_nodes_[index].star_child = child;
+  }
+  return index;
+}
+
+uint32_t FSPermission::RadixTree::NextNode(uint32_t index,
+                                           const std::string_view& path,
+                                           size_t idx) const {
+  if (idx >= path.length()) {
+    return kNoNode;
+  }
+
+  const FlatNode& node = flat_nodes_[index];
+  // wildcard node takes precedence
+  if (node.child_count > 1 && node.star_child != kNoNode) {
+    return node.star_child;
+  }
+
+  uint32_t child = kNoNode;
+  for (uint32_t i = 0; i < node.child_count; ++i) {
+    const FlatChild& candidate = flat_children_[node.first_child + i];
+    if (candidate.label == path[idx]) {
+      child = candidate.node;
+      break;
+    }
+  }
+  if (child == kNoNode) {
+    return kNoNode;
+  }
+
+  // match prefix
+  const FlatNode& child_node = flat_nodes_[child];
+  const char* prefix = flat_prefixes_.data() + child_node.prefix_offset;
+  for (size_t i = 0; i < path.length(); ++i) {
+    if (i >= child_node.prefix_length || prefix[i] == '*') {
+      return child;
+    }
+
+    // Handle optional trailing
+    // path = /home/subdirectory
+    // child = subdirectory/*
+    if (idx >= path.length() &&
+        prefix[i] == std::filesystem::path::preferred_separator) {
+      continue;
+    }
+
+    if (idx >= path.length() || path[idx++] != prefix[i]) {
+      return kNoNode;
+    }
+  }
+  return child;
+}
+
 bool FSPermission::RadixTree::Lookup(const std::string_view& s,
                                      bool when_empty_return) const {
-  FSPermission::RadixTree::Node* current_node = root_node_;
-  if (current_node->children.empty()) {
+  uint32_t current_node = 0;
+  if (flat_nodes_[current_node].child_count == 0) {
     return when_empty_return;
   }
-  size_t parent_node_prefix_len = current_node->prefix.length();
-  const std::string path(s);
-  auto path_len = path.length();
+  size_t parent_node_prefix_len = flat_nodes_[current_node].prefix_length;
+  auto path_len = s.length();
 
   while (true) {
-    if (parent_node_prefix_len == path_len && current_node->IsEndNode()) {
+    if (parent_node_prefix_len == path_len &&
+        flat_nodes_[current_node].is_end_node) {
       return true;
     }
 
-    auto node = current_node->NextNode(path, parent_node_prefix_len);
-    if (node == nullptr) {
+    auto node = NextNode(current_node, s, parent_node_prefix_len);
+    if (node == kNoNode) {
       return false;
     }
 
     current_node = node;
-    parent_node_prefix_len += current_node->prefix.length();
-    if (current_node->wildcard_child != nullptr &&
+    const FlatNode& flat_node = flat_nodes_[current_node];
+    parent_node_prefix_len += flat_node.prefix_length;
+    if (flat_node.has_wildcard_child &&
         path_len >= (parent_node_prefix_len - 2 /* slash* */)) {
       return true;
     }
@@ -219,6 +357,9 @@ void FSPermission::RadixTree::Insert(const std::string& path) {
     }
   }
 
+  Flatten();
+  generation_ = ++next_tree_generation;
+
   if (UNLIKELY(per_process::enabled_debug_list.enabled(
           DebugCategory::PERMISSION_MODEL))) {
     per_process::Debug(DebugCategory::PERMISSION_MODEL, "Inserting %s\n", path);
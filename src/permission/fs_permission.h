@@ -5,8 +5,11 @@
 
 #include "v8.h"
 
+#include <cstdint>
 #include <filesystem>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "permission/permission_base.h"
 #include "util.h"
 
@@ -78,46 +81,6 @@ class FSPermission final : public PermissionBase {
         return wildcard_child;
       }
 
-      Node* NextNode(const std::string& path, size_t idx) const {
-        if (idx >= path.length()) {
-          return nullptr;
-        }
-
-        // wildcard node takes precedence
-        if (children.size() > 1) {
-          auto it = children.find('*');
-          if (it != children.end()) {
-            return it->second;
-          }
-        }
-
-        auto it = children.find(path[idx]);
-        if (it == children.end()) {
-          return nullptr;
-        }
-        auto child = it->second;
-        // match prefix
-        size_t prefix_len = child->prefix.length();
-        for (size_t i = 0; i < path.length(); ++i) {
-          if (i >= prefix_len || child->prefix[i] == '*') {
-            return child;
-          }
-
-          // Handle optional trailing
-          // path = /home/subdirectory
-          // child = subdirectory/*
-          if (idx >= path.length() &&
-              child->prefix[i] == std::filesystem::path::preferred_separator) {
-            continue;
-          }
-
-          if (path[idx++] != child->prefix[i]) {
-            return nullptr;
-          }
-        }
-        return child;
-      }
-
       // A node can be a *end* node and have children
       // E.g: */slower*, */slown* are inserted:
       // /slow
@@ -143,8 +106,42 @@ class FSPermission final : public PermissionBase {
     bool Lookup(const std::string_view& s) const { return Lookup(s, false); }
     bool Lookup(const std::string_view& s, bool when_empty_return) const;
 
+    // Changes whenever the tree changes, and is unique across all trees of
+    // the process, so that cached lookups can be keyed by it.
+    uint64_t generation() const { return generation_; }
+
    private:
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    // The tree laid out in contiguous arrays, which Lookup() walks instead
+    // of the nodes above. The children of a node are adjacent entries of
+    // flat_children_, and all prefixes share flat_prefixes_.
+    struct FlatNode {
+      uint32_t prefix_offset;
+      uint32_t prefix_length;
+      uint32_t first_child;
+      uint32_t child_count;
+      // The child labelled '*', which takes precedence over its siblings.
+      uint32_t star_child;
+      bool has_wildcard_child;
+      bool is_end_node;
+    };
+    struct FlatChild {
+      char label;
+      uint32_t node;
+    };
+
+    void Flatten();
+    uint32_t FlattenNode(const Node* node);
+    uint32_t NextNode(uint32_t index,
+                      const std::string_view& path,
+                      size_t idx) const;
+
     Node* root_node_;
+    std::vector<FlatNode> flat_nodes_;
+    std::vector<FlatChild> flat_children_;
+    std::string flat_prefixes_;
+    uint64_t generation_;
   };
 
  private:
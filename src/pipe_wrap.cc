@@ -76,6 +76,7 @@ void PipeWrap::Initialize(Local<Object> target,
 
   SetProtoMethod(isolate, t, "bind", Bind);
   SetProtoMethod(isolate, t, "listen", Listen);
+  SetProtoMethod(isolate, t, "setAcceptBatchSize", SetAcceptBatchSize);
   SetProtoMethod(isolate, t, "connect", Connect);
   SetProtoMethod(isolate, t, "open", Open);
 
@@ -107,6 +108,7 @@ void PipeWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(New);
   registry->Register(Bind);
   registry->Register(Listen);
+  registry->Register(SetAcceptBatchSize);
   registry->Register(Connect);
   registry->Register(Open);
 #ifdef _WIN32
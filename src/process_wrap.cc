@@ -29,6 +29,9 @@
 #include <climits>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace node {
 
@@ -66,11 +69,13 @@ class ProcessWrap : public HandleWrap {
     SetProtoMethod(isolate, constructor, "kill", Kill);
 
     SetConstructorFunction(context, target, "Process", constructor);
+    SetMethod(context, target, "spawnBatch", SpawnBatch);
   }
 
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
     registry->Register(New);
     registry->Register(Spawn);
+    registry->Register(SpawnBatch);
     registry->Register(Kill);
   }
 
@@ -150,161 +155,141 @@ class ProcessWrap : public HandleWrap {
     }
   }
 
-  static void Spawn(const FunctionCallbackInfo<Value>& args) {
-    Environment* env = Environment::GetCurrent(args);
-    Local<Context> context = env->context();
-    ProcessWrap* wrap;
-    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
-    THROW_IF_INSUFFICIENT_PERMISSIONS(
-        env, permission::PermissionScope::kChildProcess, "");
-    int err = 0;
-
-    Local<Object> js_options =
-        args[0]->ToObject(env->context()).ToLocalChecked();
-
-    uv_process_options_t options;
-    memset(&options, 0, sizeof(uv_process_options_t));
-
-    options.exit_cb = OnExit;
-
-    // options.uid
-    Local<Value> uid_v =
-        js_options->Get(context, env->uid_string()).ToLocalChecked();
-    if (!uid_v->IsUndefined() && !uid_v->IsNull()) {
-      CHECK(uid_v->IsInt32());
-      const int32_t uid = uid_v.As<Int32>()->Value();
-      options.flags |= UV_PROCESS_SETUID;
-      options.uid = static_cast<uv_uid_t>(uid);
-    }
-
-    // options.gid
-    Local<Value> gid_v =
-        js_options->Get(context, env->gid_string()).ToLocalChecked();
-    if (!gid_v->IsUndefined() && !gid_v->IsNull()) {
-      CHECK(gid_v->IsInt32());
-      const int32_t gid = gid_v.As<Int32>()->Value();
-      options.flags |= UV_PROCESS_SETGID;
-      options.gid = static_cast<uv_gid_t>(gid);
+  // The uv_process_options_t of a spawn, together with the storage its
+  // strings point into.
+  class SpawnOptions {
+   public:
+    SpawnOptions() {
+      memset(&options_, 0, sizeof(uv_process_options_t));
+      options_.exit_cb = OnExit;
     }
 
-    // TODO(bnoordhuis) is this possible to do without mallocing ?
-
-    // options.file
-    Local<Value> file_v =
-        js_options->Get(context, env->file_string()).ToLocalChecked();
-    CHECK(file_v->IsString());
-    node::Utf8Value file(env->isolate(), file_v);
-    options.file = *file;
-
-    // Undocumented feature of Win32 CreateProcess API allows spawning
-    // batch files directly but is potentially insecure because arguments
-    // are not escaped (and sometimes cannot be unambiguously escaped),
-    // hence why they are rejected here.
-    if (IsWindowsBatchFile(options.file))
-      err = UV_EINVAL;
-
-    // options.args
-    Local<Value> argv_v =
-        js_options->Get(context, env->args_string()).ToLocalChecked();
-    if (!argv_v.IsEmpty() && argv_v->IsArray()) {
-      Local<Array> js_argv = argv_v.As<Array>();
-      int argc = js_argv->Length();
-      CHECK_LT(argc, INT_MAX);  // Check for overflow.
-
-      // Heap allocate to detect errors. +1 is for nullptr.
-      options.args = new char*[argc + 1];
-      for (int i = 0; i < argc; i++) {
-        node::Utf8Value arg(env->isolate(),
-                            js_argv->Get(context, i).ToLocalChecked());
-        options.args[i] = strdup(*arg);
-        CHECK_NOT_NULL(options.args[i]);
+    ~SpawnOptions() {
+      if (options_.args) {
+        for (int i = 0; options_.args[i]; i++) free(options_.args[i]);
+        delete[] options_.args;
       }
-      options.args[argc] = nullptr;
-    }
-
-    // options.cwd
-    Local<Value> cwd_v =
-        js_options->Get(context, env->cwd_string()).ToLocalChecked();
-    node::Utf8Value cwd(env->isolate(),
-                        cwd_v->IsString() ? cwd_v : Local<Value>());
-    if (cwd.length() > 0) {
-      options.cwd = *cwd;
-    }
 
-    // options.env
-    Local<Value> env_v =
-        js_options->Get(context, env->env_pairs_string()).ToLocalChecked();
-    if (!env_v.IsEmpty() && env_v->IsArray()) {
-      Local<Array> env_opt = env_v.As<Array>();
-      int envc = env_opt->Length();
-      CHECK_LT(envc, INT_MAX);            // Check for overflow.
-      options.env = new char*[envc + 1];  // Heap allocated to detect errors.
-      for (int i = 0; i < envc; i++) {
-        node::Utf8Value pair(env->isolate(),
-                             env_opt->Get(context, i).ToLocalChecked());
-        options.env[i] = strdup(*pair);
-        CHECK_NOT_NULL(options.env[i]);
+      if (options_.env) {
+        for (int i = 0; options_.env[i]; i++) free(options_.env[i]);
+        delete[] options_.env;
       }
-      options.env[envc] = nullptr;
+
+      delete[] options_.stdio;
     }
 
-    // options.stdio
-    ParseStdioOptions(env, js_options, &options);
+    SpawnOptions(const SpawnOptions&) = delete;
+    SpawnOptions& operator=(const SpawnOptions&) = delete;
 
-    // options.windowsHide
-    Local<Value> hide_v =
-        js_options->Get(context, env->windows_hide_string()).ToLocalChecked();
+    // Returns 0, or a libuv error code if the options cannot be spawned.
+    int Parse(Environment* env, Local<Object> js_options);
 
-    if (hide_v->IsTrue()) {
-      options.flags |= UV_PROCESS_WINDOWS_HIDE;
+    // Whether a stdio entry refers to a stream handle. Those belong to a
+    // single child, so such options cannot be shared by a batch.
+    bool has_streams() const {
+      for (int i = 0; i < options_.stdio_count; i++) {
+        if (options_.stdio[i].flags & (UV_CREATE_PIPE | UV_INHERIT_STREAM)) {
+          return true;
+        }
+      }
+      return false;
     }
 
-    if (env->hide_console_windows()) {
-      options.flags |= UV_PROCESS_WINDOWS_HIDE_CONSOLE;
-    }
+    const uv_process_options_t* get() const { return &options_; }
+
+   private:
+    uv_process_options_t options_;
+    std::string file_;
+    std::string cwd_;
+  };
 
-    // options.windows_verbatim_arguments
-    Local<Value> wva_v =
-        js_options->Get(context, env->windows_verbatim_arguments_string())
-            .ToLocalChecked();
+  int SpawnWith(const SpawnOptions& options) {
+    int err = uv_spawn(env()->event_loop(), &process_, options.get());
+    MarkAsInitialized();
 
-    if (wva_v->IsTrue()) {
-      options.flags |= UV_PROCESS_WINDOWS_VERBATIM_ARGUMENTS;
+    if (err == 0) {
+      CHECK_EQ(process_.data, this);
+      object()
+          ->Set(env()->context(),
+                env()->pid_string(),
+                Integer::New(env()->isolate(), process_.pid))
+          .Check();
     }
+    return err;
+  }
 
-    // options.detached
-    Local<Value> detached_v =
-        js_options->Get(context, env->detached_string()).ToLocalChecked();
+  static void Spawn(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    ProcessWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+    THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env, permission::PermissionScope::kChildProcess, "");
 
-    if (detached_v->IsTrue()) {
-      options.flags |= UV_PROCESS_DETACHED;
-    }
+    Local<Object> js_options =
+        args[0]->ToObject(env->context()).ToLocalChecked();
 
+    SpawnOptions options;
+    int err = options.Parse(env, js_options);
     if (err == 0) {
-      err = uv_spawn(env->event_loop(), &wrap->process_, &options);
-      wrap->MarkAsInitialized();
+      err = wrap->SpawnWith(options);
     }
 
-    if (err == 0) {
-      CHECK_EQ(wrap->process_.data, wrap);
-      wrap->object()->Set(context, env->pid_string(),
-                          Integer::New(env->isolate(),
-                                       wrap->process_.pid)).Check();
-    }
+    args.GetReturnValue().Set(err);
+  }
 
-    if (options.args) {
-      for (int i = 0; options.args[i]; i++) free(options.args[i]);
-      delete [] options.args;
-    }
+  // spawnBatch(processes, options) spawns one child per Process object in
+  // a single call and returns the array of their error codes. |options| is
+  // either an array with the options of each child, or one object that is
+  // parsed once and shared by all of them, in which case its stdio cannot
+  // contain streams.
+  static void SpawnBatch(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    Local<Context> context = env->context();
+    THROW_IF_INSUFFICIENT_PERMISSIONS(
+        env, permission::PermissionScope::kChildProcess, "");
 
-    if (options.env) {
-      for (int i = 0; options.env[i]; i++) free(options.env[i]);
-      delete [] options.env;
+    CHECK(args[0]->IsArray());
+    CHECK(args[1]->IsObject());
+    Local<Array> processes = args[0].As<Array>();
+    const uint32_t count = processes->Length();
+
+    std::unique_ptr<SpawnOptions> shared_options;
+    int shared_err = 0;
+    if (!args[1]->IsArray()) {
+      shared_options = std::make_unique<SpawnOptions>();
+      shared_err = shared_options->Parse(env, args[1].As<Object>());
+      CHECK(!shared_options->has_streams());
+    } else {
+      CHECK_EQ(args[1].As<Array>()->Length(), count);
     }
 
-    delete[] options.stdio;
+    std::vector<Local<Value>> results(count);
+    for (uint32_t i = 0; i < count; i++) {
+      Local<Value> process;
+      if (!processes->Get(context, i).ToLocal(&process)) return;
+      ProcessWrap* wrap;
+      ASSIGN_OR_RETURN_UNWRAP(&wrap, process);
 
-    args.GetReturnValue().Set(err);
+      int err;
+      if (shared_options) {
+        err = shared_err == 0 ? wrap->SpawnWith(*shared_options) : shared_err;
+      } else {
+        Local<Value> js_options;
+        if (!args[1].As<Array>()->Get(context, i).ToLocal(&js_options)) {
+          return;
+        }
+        SpawnOptions options;
+        err = options.Parse(env, js_options->ToObject(context)
+                                     .ToLocalChecked());
+        if (err == 0) {
+          err = wrap->SpawnWith(options);
+        }
+      }
+      results[i] = Integer::New(env->isolate(), err);
+    }
+
+    args.GetReturnValue().Set(
+        Array::New(env->isolate(), results.data(), results.size()));
   }
 
   static void Kill(const FunctionCallbackInfo<Value>& args) {
@@ -337,6 +322,143 @@ class ProcessWrap : public HandleWrap {
   uv_process_t process_;
 };
 
+int ProcessWrap::SpawnOptions::Parse(Environment* env,
+                                     Local<Object> js_options) {
+  Local<Context> context = env->context();
+  int err = 0;
+
+  // options.uid
+  Local<Value> uid_v =
+      js_options->Get(context, env->uid_string()).ToLocalChecked();
+  if (!uid_v->IsUndefined() && !uid_v->IsNull()) {
+    CHECK(uid_v->IsInt32());
+    const int32_t uid = uid_v.As<Int32>()->Value();
+    options_.flags |= UV_PROCESS_SETUID;
+    options_.uid = static_cast<uv_uid_t>(uid);
+  }
+
+  // options.gid
+  Local<Value> gid_v =
+      js_options->Get(context, env->gid_string()).ToLocalChecked();
+  if (!gid_v->IsUndefined() && !gid_v->IsNull()) {
+    CHECK(gid_v->IsInt32());
+    const int32_t gid = gid_v.As<Int32>()->Value();
+    options_.flags |= UV_PROCESS_SETGID;
+    options_.gid = static_cast<uv_gid_t>(gid);
+  }
+
+  // TODO(bnoordhuis) is this possible to do without mallocing ?
+
+  // options.file
+  Local<Value> file_v =
+      js_options->Get(context, env->file_string()).ToLocalChecked();
+  CHECK(file_v->IsString());
+  file_ = node::Utf8Value(env->isolate(), file_v).ToString();
+  options_.file = file_.c_str();
+
+  // Undocumented feature of Win32 CreateProcess API allows spawning
+  // batch files directly but is potentially insecure because arguments
+  // are not escaped (and sometimes cannot be unambiguously escaped),
+  // hence why they are rejected here.
+  if (IsWindowsBatchFile(options_.file))
+    err = UV_EINVAL;
+
+  // options.args
+  Local<Value> argv_v =
+      js_options->Get(context, env->args_string()).ToLocalChecked();
+  if (!argv_v.IsEmpty() && argv_v->IsArray()) {
+    Local<Array> js_argv = argv_v.As<Array>();
+    int argc = js_argv->Length();
+    CHECK_LT(argc, INT_MAX);  // Check for overflow.
+
+    // Heap allocate to detect errors. +1 is for nullptr.
+    options_.args = new char*[argc + 1];
+    for (int i = 0; i < argc; i++) {
+      node::Utf8Value arg(env->isolate(),
+                          js_argv->Get(context, i).ToLocalChecked());
+      options_.args[i] = strdup(*arg);
+      CHECK_NOT_NULL(options_.args[i]);
+    }
+    options_.args[argc] = nullptr;
+  }
+
+  // options.cwd
+  Local<Value> cwd_v =
+      js_options->Get(context, env->cwd_string()).ToLocalChecked();
+  node::Utf8Value cwd(env->isolate(),
+                      cwd_v->IsString() ? cwd_v : Local<Value>());
+  if (cwd.length() > 0) {
+    cwd_ = cwd.ToString();
+    options_.cwd = cwd_.c_str();
+  }
+
+  // options.env
+  Local<Value> env_v =
+      js_options->Get(context, env->env_pairs_string()).ToLocalChecked();
+  if (!env_v.IsEmpty() && env_v->IsArray()) {
+    Local<Array> env_opt = env_v.As<Array>();
+    int envc = env_opt->Length();
+    CHECK_LT(envc, INT_MAX);             // Check for overflow.
+    options_.env = new char*[envc + 1];  // Heap allocated to detect errors.
+    for (int i = 0; i < envc; i++) {
+      node::Utf8Value pair(env->isolate(),
+                           env_opt->Get(context, i).ToLocalChecked());
+      options_.env[i] = strdup(*pair);
+      CHECK_NOT_NULL(options_.env[i]);
+    }
+    options_.env[envc] = nullptr;
+  }
+
+  // options.stdio
+  ParseStdioOptions(env, js_options, &options_);
+
+  // options.windowsHide
+  Local<Value> hide_v =
+      js_options->Get(context, env->windows_hide_string()).ToLocalChecked();
+
+  if (hide_v->IsTrue()) {
+    options_.flags |= UV_PROCESS_WINDOWS_HIDE;
+  }
+
+  if (env->hide_console_windows()) {
+    options_.flags |= UV_PROCESS_WINDOWS_HIDE_CONSOLE;
+  }
+
+  // options.windows_verbatim_arguments
+  Local<Value> wva_v =
+      js_options->Get(context, env->windows_verbatim_arguments_string())
+          .ToLocalChecked();
+
+  if (wva_v->IsTrue()) {
+    options_.flags |= UV_PROCESS_WINDOWS_VERBATIM_ARGUMENTS;
+  }
+
+  // options.detached
+  Local<Value> detached_v =
+      js_options->Get(context, env->detached_string()).ToLocalChecked();
+
+  if (detached_v->IsTrue()) {
+    options_.flags |= UV_PROCESS_DETACHED;
+  }
+
+  // options.preferPosixSpawn
+  // Spawning with posix_spawn() avoids copying the page tables of the whole
+  // process with fork(), which dominates the spawn latency of large
+  // processes. libuv still uses fork() when the other options need it.
+  // The flag is not part of upstream libuv yet, so builds against a shared
+  // libuv without it ignore the option and keep using fork().
+#ifdef UV_PROCESS_PREFER_POSIX_SPAWN
+  Local<Value> posix_spawn_v =
+      js_options->Get(context, env->prefer_posix_spawn_string())
+          .ToLocalChecked();
+
+  if (posix_spawn_v->IsTrue()) {
+    options_.flags |= UV_PROCESS_PREFER_POSIX_SPAWN;
+  }
+#endif  // UV_PROCESS_PREFER_POSIX_SPAWN
+
+  return err;
+}
 
 }  // anonymous namespace
 }  // namespace node
@@ -245,12 +245,25 @@ void Session::Application::SendPendingData() {
   const size_t max_packet_size = session_->max_packet_size();
 
   // The maximum number of packets to send in this call to SendPendingData.
-  const size_t max_packet_count = std::min(
-      kMaxPackets, ngtcp2_conn_get_send_quantum(*session_) / max_packet_size);
+  const size_t max_paced_count = session_->MaxPacedPacketCount(max_packet_size);
+  if (max_paced_count == 0) {
+    // Nothing may be sent until the pacing credit has been refilled. The
+    // session timer is rearmed to come back once it has.
+    Debug(session_, "Pacing limited");
+    return session_->UpdateTimer();
+  }
+  const size_t max_packet_count =
+      std::min({kMaxPackets,
+                ngtcp2_conn_get_send_quantum(*session_) / max_packet_size,
+                max_paced_count});
 
   // The number of packets that have been sent in this call to SendPendingData.
   size_t packet_send_count = 0;
 
+  // Packets prepared in this call are handed to the endpoint as one train
+  // once we return.
+  Endpoint::SendBatchScope send_batch(&session_->endpoint());
+
   Packet* packet = nullptr;
   uint8_t* pos = nullptr;
   uint8_t* begin = nullptr;
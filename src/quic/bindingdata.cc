@@ -11,13 +11,17 @@
 #include <node_mem-inl.h>
 #include <node_realm-inl.h>
 #include <v8.h>
+#include "logstream.h"
 
 namespace node {
 
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Isolate;
 using v8::Local;
+using v8::MaybeLocal;
+using v8::NewStringType;
 using v8::Object;
 using v8::String;
 using v8::Value;
@@ -28,6 +32,11 @@ BindingData& BindingData::Get(Environment* env) {
   return *(env->principal_realm()->GetBindingData<BindingData>());
 }
 
+std::shared_ptr<QlogWriter> BindingData::qlog_writer() {
+  if (!qlog_writer_) qlog_writer_ = std::make_shared<QlogWriter>();
+  return qlog_writer_;
+}
+
 BindingData::operator ngtcp2_mem() {
   return MakeAllocator();
 }
@@ -87,6 +96,37 @@ void BindingData::MemoryInfo(MemoryTracker* tracker) const {
   QUIC_STRINGS(V)
 
 #undef V
+
+  tracker->TrackFieldWithSize("header_cache", sizeof(header_cache_));
+}
+
+MaybeLocal<String> BindingData::GetCachedHeaderString(const uint8_t* data,
+                                                      size_t length) {
+  Isolate* isolate = env()->isolate();
+  if (length == 0 || length > kMaxCachedHeaderLength) {
+    return String::NewFromOneByte(
+        isolate, data, NewStringType::kInternalized, length);
+  }
+
+  // FNV-1a over the raw bytes.
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619u;
+  HeaderCacheEntry& entry = header_cache_[hash % kHeaderCacheSize];
+
+  if (entry.length == length && memcmp(entry.data, data, length) == 0) {
+    return entry.string.Get(isolate);
+  }
+
+  Local<String> string;
+  if (!String::NewFromOneByte(
+           isolate, data, NewStringType::kInternalized, length)
+           .ToLocal(&string)) {
+    return MaybeLocal<String>();
+  }
+  entry.length = static_cast<uint8_t>(length);
+  memcpy(entry.data, data, length);
+  entry.string.Reset(isolate, string);
+  return string;
 }
 
 #define V(name)                                                                \
@@ -12,6 +12,7 @@
 #include <node.h>
 #include <node_mem.h>
 #include <v8.h>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include "defs.h"
@@ -21,6 +22,7 @@ namespace quic {
 
 class Endpoint;
 class Packet;
+class QlogWriter;
 
 // ============================================================================
 
@@ -100,6 +102,7 @@ class Packet;
   V(max_header_length, "maxHeaderLength")                                      \
   V(max_header_pairs, "maxHeaderPairs")                                        \
   V(max_idle_timeout, "maxIdleTimeout")                                        \
+  V(max_pacing_rate, "maxPacingRate")                                          \
   V(max_payload_size, "maxPayloadSize")                                        \
   V(max_retries, "maxRetries")                                                 \
   V(max_stateless_resets, "maxStatelessResetsPerHost")                         \
@@ -110,6 +113,8 @@ class Packet;
   V(packetwrap, "PacketWrap")                                                  \
   V(preferred_address_strategy, "preferredAddressPolicy")                      \
   V(qlog, "qlog")                                                              \
+  V(qlog_dir, "qlogDir")                                                       \
+  V(qlog_sample_rate, "qlogSampleRate")                                        \
   V(qpack_blocked_streams, "qpackBlockedStreams")                              \
   V(qpack_encoder_max_dtable_capacity, "qpackEncoderMaxDTableCapacity")        \
   V(qpack_max_dtable_capacity, "qpackMaxDTableCapacity")                       \
@@ -117,8 +122,12 @@ class Packet;
   V(reno, "reno")                                                              \
   V(retry_token_expiration, "retryTokenExpiration")                            \
   V(reset_token_secret, "resetTokenSecret")                                    \
+  V(resumption_group, "resumptionGroup")                                       \
+  V(resumption_group_shared, "resumptionGroupShared")                          \
   V(rx_loss, "rxDiagnosticLoss")                                               \
   V(session, "Session")                                                        \
+  V(shard_count, "shardCount")                                                 \
+  V(shard_id, "shardId")                                                       \
   V(sni, "sni")                                                                \
   V(stream, "Stream")                                                          \
   V(success, "success")                                                        \
@@ -181,6 +190,17 @@ class BindingData final
   bool in_ngtcp2_callback_scope = false;
   bool in_nghttp3_callback_scope = false;
 
+  // Returns an internalized string for a short header name or value received
+  // over HTTP/3. Recently seen strings are kept in a small direct-mapped
+  // cache so that repeated headers (which QPACK makes very cheap to send)
+  // skip the V8 string table lookup. Longer strings are internalized as is.
+  v8::MaybeLocal<v8::String> GetCachedHeaderString(const uint8_t* data,
+                                                   size_t length);
+
+  // The writer for sessions that trace to qlog files, created when the
+  // first of them is.
+  std::shared_ptr<QlogWriter> qlog_writer();
+
   // The following set up various storage and accessors for common strings,
   // construction templates, and callbacks stored on the BindingData. These
   // are all defined in defs.h
@@ -208,6 +228,17 @@ class BindingData final
 
   size_t current_ngtcp2_memory_ = 0;
 
+  static constexpr size_t kHeaderCacheSize = 512;
+  static constexpr size_t kMaxCachedHeaderLength = 32;
+  struct HeaderCacheEntry {
+    uint8_t length = 0;
+    uint8_t data[kMaxCachedHeaderLength];
+    v8::Global<v8::String> string;
+  };
+  HeaderCacheEntry header_cache_[kHeaderCacheSize];
+
+  std::shared_ptr<QlogWriter> qlog_writer_;
+
 #define V(name) v8::Global<v8::FunctionTemplate> name##_constructor_template_;
   QUIC_CONSTRUCTORS(V)
 #undef V
@@ -143,6 +143,38 @@ class RandomCIDFactory : public CID::Factory {
   mutable uint8_t pool_[kPoolSize];
   mutable Mutex mutex_;
 };
+
+class ShardedCIDFactory : public CID::Factory {
+ public:
+  ShardedCIDFactory() = default;
+  DISALLOW_COPY_AND_MOVE(ShardedCIDFactory)
+
+  void set_shard_id(uint8_t shard_id) { shard_id_ = shard_id; }
+
+  CID Generate(size_t length_hint) const override {
+    ngtcp2_cid cid;
+    GenerateInto(&cid, length_hint);
+    return CID(cid);
+  }
+
+  CID GenerateInto(ngtcp2_cid* cid,
+                   size_t length_hint = CID::kMaxLength) const override {
+    CID::Factory::random().GenerateInto(cid, length_hint);
+    cid->data[0] = shard_id_;
+    return CID(cid);
+  }
+
+ private:
+  uint8_t shard_id_ = 0;
+};
+
+struct ShardedCIDFactories {
+  ShardedCIDFactories() {
+    for (size_t n = 0; n < arraysize(factories); n++)
+      factories[n].set_shard_id(static_cast<uint8_t>(n));
+  }
+  ShardedCIDFactory factories[256];
+};
 }  // namespace
 
 const CID::Factory& CID::Factory::random() {
@@ -150,6 +182,16 @@ const CID::Factory& CID::Factory::random() {
   return instance;
 }
 
+const CID::Factory& CID::Factory::sharded(uint8_t shard_id) {
+  static ShardedCIDFactories instances;
+  return instances.factories[shard_id];
+}
+
+uint8_t CID::Factory::ShardOf(const CID& cid) {
+  DCHECK(cid);
+  return static_cast<const uint8_t*>(cid)[0];
+}
+
 }  // namespace quic
 }  // namespace node
 #endif  // HAVE_OPENSSL && NODE_OPENSSL_HAS_QUIC
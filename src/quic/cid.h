@@ -118,6 +118,15 @@ class CID::Factory {
   // The default random CID generator instance.
   static const Factory& random();
 
+  // A random CID generator that writes the given shard id into the first
+  // byte of every CID it produces, similar to the plaintext mode of the
+  // QUIC Load Balancers draft. Endpoints that share a UDP port use this to
+  // find the endpoint that owns a connection from the DCID of a packet.
+  static const Factory& sharded(uint8_t shard_id);
+
+  // Returns the shard id that a CID created by sharded() encodes.
+  static uint8_t ShardOf(const CID& cid);
+
   // TODO(@jasnell): This will soon also include additional implementations
   // of CID::Factory that implement the QUIC Load Balancers spec.
 };
@@ -15,12 +15,30 @@
 #include <util-inl.h>
 #include <uv.h>
 #include <v8.h>
+#include <atomic>
 #include <limits>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include "application.h"
 #include "bindingdata.h"
 #include "defs.h"
 #include "ncrypto.h"
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#if defined(UDP_SEGMENT)
+#define QUIC_HAVE_UDP_GSO 1
+#endif
+#endif
+
 namespace node {
 
 using v8::ArrayBufferView;
@@ -71,7 +89,15 @@ namespace quic {
   V(RETRY_COUNT, retry_count)                                                  \
   V(VERSION_NEGOTIATION_COUNT, version_negotiation_count)                      \
   V(STATELESS_RESET_COUNT, stateless_reset_count)                              \
-  V(IMMEDIATE_CLOSE_COUNT, immediate_close_count)
+  V(IMMEDIATE_CLOSE_COUNT, immediate_close_count)                              \
+  /* Packets taken from the packet freelist */                                 \
+  V(PACKET_POOL_HITS, packet_pool_hits)                                        \
+  /* Packets that had to be newly allocated */                                 \
+  V(PACKET_POOL_MISSES, packet_pool_misses)                                    \
+  /* Packets handed off to the sibling shard that owns their dcid */           \
+  V(PACKETS_FORWARDED, packets_forwarded)                                      \
+  /* Packets handed off to this endpoint by a sibling shard */                 \
+  V(FORWARDED_PACKETS_RECEIVED, forwarded_packets_received)
 
 struct Endpoint::State {
 #define V(_, name, type) type name;
@@ -115,35 +141,7 @@ bool SetOption(Environment* env,
   if (!object->Get(env->context(), name).ToLocal(&value)) return false;
   if (!value->IsUndefined()) {
     ngtcp2_cc_algo algo;
-    if (value->IsString()) {
-      if (!getAlgoFromString(env, value.As<String>()).To(&algo)) {
-        THROW_ERR_INVALID_ARG_VALUE(env, "The cc_algorithm option is invalid");
-        return false;
-      }
-    } else {
-      if (!value->IsInt32()) {
-        THROW_ERR_INVALID_ARG_VALUE(
-            env, "The cc_algorithm option must be a string or an integer");
-        return false;
-      }
-      Local<Int32> num;
-      if (!value->ToInt32(env->context()).ToLocal(&num)) {
-        THROW_ERR_INVALID_ARG_VALUE(env, "The cc_algorithm option is invalid");
-        return false;
-      }
-      switch (num->Value()) {
-#define V(name, _)                                                             \
-  case NGTCP2_CC_ALGO_##name:                                                  \
-    break;
-        ENDPOINT_CC(V)
-#undef V
-        default:
-          THROW_ERR_INVALID_ARG_VALUE(env,
-                                      "The cc_algorithm option is invalid");
-          return false;
-      }
-      algo = static_cast<ngtcp2_cc_algo>(num->Value());
-    }
+    if (!Endpoint::Options::GetCCAlgorithm(env, value, &algo)) return false;
     options->*member = algo;
   }
   return true;
@@ -230,6 +228,40 @@ bool SetOption(Environment* env,
 }
 }  // namespace
 
+bool Endpoint::Options::GetCCAlgorithm(Environment* env,
+                                       Local<Value> value,
+                                       ngtcp2_cc_algo* algo) {
+  if (value->IsString()) {
+    if (!getAlgoFromString(env, value.As<String>()).To(algo)) {
+      THROW_ERR_INVALID_ARG_VALUE(env, "The cc_algorithm option is invalid");
+      return false;
+    }
+    return true;
+  }
+  if (!value->IsInt32()) {
+    THROW_ERR_INVALID_ARG_VALUE(
+        env, "The cc_algorithm option must be a string or an integer");
+    return false;
+  }
+  Local<Int32> num;
+  if (!value->ToInt32(env->context()).ToLocal(&num)) {
+    THROW_ERR_INVALID_ARG_VALUE(env, "The cc_algorithm option is invalid");
+    return false;
+  }
+  switch (num->Value()) {
+#define V(name, _)                                                             \
+  case NGTCP2_CC_ALGO_##name:                                                  \
+    break;
+    ENDPOINT_CC(V)
+#undef V
+    default:
+      THROW_ERR_INVALID_ARG_VALUE(env, "The cc_algorithm option is invalid");
+      return false;
+  }
+  *algo = static_cast<ngtcp2_cc_algo>(num->Value());
+  return true;
+}
+
 Maybe<Endpoint::Options> Endpoint::Options::From(Environment* env,
                                                  Local<Value> value) {
   if (value.IsEmpty() || !value->IsObject()) {
@@ -258,7 +290,32 @@ Maybe<Endpoint::Options> Endpoint::Options::From(Environment* env,
 #endif
       !SET(cc_algorithm) || !SET(udp_receive_buffer_size) ||
       !SET(udp_send_buffer_size) || !SET(udp_ttl) || !SET(reset_token_secret) ||
-      !SET(token_secret)) {
+      !SET(token_secret) || !SET(shard_id) || !SET(shard_count) ||
+      !SET(resumption_group) || !SET(resumption_group_shared)) {
+    return Nothing<Options>();
+  }
+
+  if (!options.resumption_group.empty()) {
+    if (options.resumption_group.find('/') != std::string::npos) {
+      THROW_ERR_INVALID_ARG_VALUE(
+          env, "The resumptionGroup option must not contain '/'");
+      return Nothing<Options>();
+    }
+    options.resumption_keys = ResumptionGroup::Get(
+        options.resumption_group, options.resumption_group_shared);
+    if (options.resumption_keys == nullptr) {
+      THROW_ERR_INVALID_STATE(env,
+                              "Unable to open the shared resumption group %s",
+                              options.resumption_group);
+      return Nothing<Options>();
+    }
+    options.token_secret = options.resumption_keys->token_secret();
+    options.reset_token_secret = options.resumption_keys->reset_token_secret();
+  }
+
+  if (options.shard_count > 1 && options.shard_id >= options.shard_count) {
+    THROW_ERR_INVALID_ARG_VALUE(
+        env, "The shardId option must be less than the shardCount option");
     return Nothing<Options>();
   }
 
@@ -354,6 +411,14 @@ std::string Endpoint::Options::ToString() const {
   res +=
       prefix + "udp send buffer size: " + std::to_string(udp_send_buffer_size);
   res += prefix + "udp ttl: " + std::to_string(udp_ttl);
+  if (!resumption_group.empty()) {
+    res += prefix + "resumption group: " + resumption_group +
+           (resumption_group_shared ? " (shared)" : "");
+  }
+  if (shard_count > 1) {
+    res += prefix + "shard: " + std::to_string(shard_id) + " of " +
+           std::to_string(shard_count);
+  }
 
   res += indent.Close();
   return res;
@@ -403,10 +468,58 @@ class Endpoint::UDP::Impl final : public HandleWrap {
                    reinterpret_cast<uv_handle_t*>(&handle_),
                    AsyncWrap::PROVIDER_QUIC_UDP),
         endpoint_(endpoint) {
-    CHECK_EQ(uv_udp_init(endpoint->env()->event_loop(), &handle_), 0);
+    CHECK_EQ(uv_udp_init_ex(endpoint->env()->event_loop(),
+                            &handle_,
+                            AF_UNSPEC | UV_UDP_RECVMMSG),
+             0);
     handle_.data = this;
   }
 
+#ifdef QUIC_HAVE_UDP_GSO
+  // Writes a packet train with a single sendmsg() call, leaving it to the
+  // kernel (or the NIC) to split it back into datagrams the size of the
+  // first packet.
+  int SendSegments(Packet* const* packets, size_t count) {
+    uv_os_fd_t fd;
+    int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&handle_), &fd);
+    if (err != 0) return err;
+
+    struct iovec iov[Endpoint::kMaxSendBatch];
+    CHECK_LE(count, arraysize(iov));
+    for (size_t n = 0; n < count; n++) {
+      uv_buf_t buf = *packets[n];
+      iov[n].iov_base = buf.base;
+      iov[n].iov_len = buf.len;
+    }
+
+    const SocketAddress& destination = packets[0]->destination();
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    struct msghdr msg = {};
+    msg.msg_name = const_cast<sockaddr*>(destination.data());
+    msg.msg_namelen = destination.length();
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segment_size = static_cast<uint16_t>(packets[0]->length());
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+
+    ssize_t nwritten;
+    do {
+      nwritten = sendmsg(fd, &msg, 0);
+    } while (nwritten == -1 && errno == EINTR);
+    if (nwritten == -1) return uv_translate_sys_error(errno);
+
+    for (size_t n = 0; n < count; n++) packets[n]->Done(0);
+    return 0;
+  }
+#endif  // QUIC_HAVE_UDP_GSO
+
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(Endpoint::UDP::Impl)
   SET_SELF_SIZE(Impl)
@@ -415,7 +528,20 @@ class Endpoint::UDP::Impl final : public HandleWrap {
   static void OnAlloc(uv_handle_t* handle,
                       size_t suggested_size,
                       uv_buf_t* buf) {
-    *buf = From(handle)->env()->allocate_managed_buffer(suggested_size);
+    auto impl = From(handle);
+    // With recvmmsg() libuv carves the buffer into one suggested_size slot
+    // per datagram. That buffer is reused for every read, and OnReceive
+    // copies each datagram out into a managed buffer of its own.
+    if (uv_udp_using_recvmmsg(&impl->handle_)) {
+      size_t length = suggested_size * kReceiveBatch;
+      if (impl->mmsg_buffer_length_ < length) {
+        impl->mmsg_buffer_ = std::make_unique<char[]>(length);
+        impl->mmsg_buffer_length_ = length;
+      }
+      *buf = uv_buf_init(impl->mmsg_buffer_.get(), length);
+      return;
+    }
+    *buf = impl->env()->allocate_managed_buffer(suggested_size);
   }
 
   static void OnReceive(uv_udp_t* handle,
@@ -423,15 +549,31 @@ class Endpoint::UDP::Impl final : public HandleWrap {
                         const uv_buf_t* buf,
                         const sockaddr* addr,
                         unsigned int flags) {
-    // Nothing to do in these cases. Specifically, if the nread
-    // is zero or we've received a partial packet, we're just
-    // going to ignore it.
-    if (nread == 0 || flags & UV_UDP_PARTIAL) return;
-
     auto impl = From(handle);
     DCHECK_NOT_NULL(impl);
     DCHECK_NOT_NULL(impl->endpoint_);
 
+    // A datagram from a recvmmsg() batch. The chunk lives in mmsg_buffer_
+    // and is overwritten by the next read.
+    if (flags & UV_UDP_MMSG_CHUNK) {
+      if (nread <= 0 || flags & UV_UDP_PARTIAL) return;
+      uv_buf_t copy = impl->env()->allocate_managed_buffer(nread);
+      memcpy(copy.base, buf->base, nread);
+      impl->endpoint_->Receive(
+          uv_buf_init(copy.base, static_cast<size_t>(nread)),
+          SocketAddress(addr));
+      return;
+    }
+
+    // Nothing to do in these cases. Specifically, if the nread
+    // is zero or we've received a partial packet, we're just
+    // going to ignore it.
+    if (nread <= 0 || flags & UV_UDP_PARTIAL) {
+      if (buf->base != nullptr && buf->base != impl->mmsg_buffer_.get())
+        impl->env()->release_managed_buffer(*buf);
+      if (nread == 0 || flags & UV_UDP_PARTIAL) return;
+    }
+
     if (nread < 0) {
       impl->endpoint_->Destroy(CloseContext::RECEIVE_FAILURE,
                                static_cast<int>(nread));
@@ -442,12 +584,48 @@ class Endpoint::UDP::Impl final : public HandleWrap {
                              SocketAddress(addr));
   }
 
+  // The number of datagrams read with a single recvmmsg() call.
+  static constexpr size_t kReceiveBatch = 8;
+
   uv_udp_t handle_;
   Endpoint* endpoint_;
+  std::unique_ptr<char[]> mmsg_buffer_;
+  size_t mmsg_buffer_length_ = 0;
+#ifdef QUIC_HAVE_UDP_GSO
+  // Set once the kernel or the device has refused a GSO send.
+  bool gso_disabled_ = false;
+#endif
 
   friend class UDP;
 };
 
+namespace {
+// Creates the socket for a sharded endpoint ourselves so that SO_REUSEPORT
+// is set before the bind. libuv only offers SO_REUSEADDR, which on Linux
+// does not spread incoming datagrams across the sockets sharing a port.
+int OpenReusePortSocket(uv_udp_t* handle, int family) {
+#if !defined(_WIN32) && defined(SO_REUSEPORT)
+  int type = SOCK_DGRAM;
+#ifdef SOCK_CLOEXEC
+  type |= SOCK_CLOEXEC;
+#endif
+  int fd = socket(family, type, 0);
+  if (fd == -1) return uv_translate_sys_error(errno);
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+    int err = uv_translate_sys_error(errno);
+    close(fd);
+    return err;
+  }
+  int err = uv_udp_open(handle, fd);
+  if (err != 0) close(fd);
+  return err;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+}  // namespace
+
 Endpoint::UDP::UDP(Endpoint* endpoint) : impl_(Impl::Create(endpoint)) {
   DCHECK(impl_);
 }
@@ -463,6 +641,11 @@ int Endpoint::UDP::Bind(const Endpoint::Options& options) {
   int flags = 0;
   if (options.local_address->family() == AF_INET6 && options.ipv6_only)
     flags |= UV_UDP_IPV6ONLY;
+  if (options.shard_count > 1) {
+    int err = OpenReusePortSocket(&impl_->handle_,
+                                  options.local_address->family());
+    if (err != 0) return err;
+  }
   int err = uv_udp_bind(&impl_->handle_, options.local_address->data(), flags);
   int size;
 
@@ -581,10 +764,202 @@ int Endpoint::UDP::Send(Packet* packet) {
   return err;
 }
 
+int Endpoint::UDP::Send(Packet* const* packets, size_t count) {
+  DCHECK_GT(count, 0);
+  if (count == 1) return Send(packets[0]);
+  if (is_closed_or_closing()) return UV_EBADF;
+
+#ifdef QUIC_HAVE_UDP_GSO
+  // The train can only bypass libuv when nothing is queued there, otherwise
+  // it would overtake packets that are still waiting to be written.
+  if (!impl_->gso_disabled_ &&
+      uv_udp_get_send_queue_count(&impl_->handle_) == 0) {
+    int err = impl_->SendSegments(packets, count);
+    if (err == 0) return 0;
+    // A full socket buffer is left for libuv to wait out. Anything else
+    // means segmentation offload is not available on this socket.
+    if (err != UV_EAGAIN) impl_->gso_disabled_ = true;
+  }
+#endif  // QUIC_HAVE_UDP_GSO
+
+  for (size_t n = 0; n < count; n++) {
+    int err = Send(packets[n]);
+    if (err != 0) {
+      while (++n < count) packets[n]->Done(UV_ECANCELED);
+      return err;
+    }
+  }
+  return 0;
+}
+
 void Endpoint::UDP::MemoryInfo(MemoryTracker* tracker) const {
   if (impl_) tracker->TrackField("impl", impl_);
 }
 
+// ============================================================================
+// Endpoint::ShardInbox
+
+// Every sharded endpoint owns an inbox that the sibling shards, running on
+// other threads, push misdirected packets into. The inbox is an intrusive
+// multi-producer single-consumer queue (after Dmitry Vyukov's design) so a
+// sender never takes a lock; the owning thread is woken with a uv_async_t
+// and drains the queue on its own event loop.
+class Endpoint::ShardInbox final
+    : public std::enable_shared_from_this<Endpoint::ShardInbox> {
+ public:
+  ShardInbox(Endpoint* endpoint, std::string key)
+      : endpoint_(endpoint), key_(std::move(key)) {
+    CHECK_EQ(uv_async_init(endpoint->env()->event_loop(), &async_, OnWakeup),
+             0);
+    uv_unref(reinterpret_cast<uv_handle_t*>(&async_));
+    async_.data = this;
+  }
+  DISALLOW_COPY_AND_MOVE(ShardInbox)
+
+  ~ShardInbox() {
+    while (Item* item = Pop()) delete item;
+  }
+
+  static std::string KeyFor(const SocketAddress& local_address,
+                            uint8_t shard_id) {
+    return local_address.ToString() + "#" + std::to_string(shard_id);
+  }
+
+  static std::shared_ptr<ShardInbox> Find(const std::string& key) {
+    auto& registry = Registry::Get();
+    Mutex::ScopedLock lock(registry.mutex);
+    auto it = registry.inboxes.find(key);
+    if (it == registry.inboxes.end()) return nullptr;
+    return it->second.lock();
+  }
+
+  // Returns false if another endpoint already claimed the shard.
+  bool Register() {
+    auto& registry = Registry::Get();
+    Mutex::ScopedLock lock(registry.mutex);
+    auto& entry = registry.inboxes[key_];
+    if (!entry.expired()) return false;
+    entry = weak_from_this();
+    return true;
+  }
+
+  // Called from any thread. Copies the packet into the queue.
+  bool Push(const SocketAddress& remote_address,
+            const uint8_t* data,
+            size_t length) {
+    producers_.fetch_add(1);
+    if (closed_.load()) {
+      producers_.fetch_sub(1);
+      return false;
+    }
+    Item* item = new Item(remote_address, data, length);
+    Enqueue(item);
+    uv_async_send(&async_);
+    producers_.fetch_sub(1);
+    return true;
+  }
+
+  // Called on the owning thread once the endpoint is being destroyed.
+  void Close() {
+    if (endpoint_ == nullptr) return;
+    {
+      auto& registry = Registry::Get();
+      Mutex::ScopedLock lock(registry.mutex);
+      auto it = registry.inboxes.find(key_);
+      if (it != registry.inboxes.end() && it->second.lock().get() == this)
+        registry.inboxes.erase(it);
+    }
+    closed_.store(true);
+    // A sender may still be between its check of closed_ and its
+    // uv_async_send(); the handle has to outlive that call.
+    while (producers_.load() > 0) std::this_thread::yield();
+    Environment* env = endpoint_->env();
+    endpoint_ = nullptr;
+    self_ = shared_from_this();
+    env->CloseHandle(&async_, [](uv_async_t* handle) {
+      auto inbox = static_cast<ShardInbox*>(handle->data);
+      inbox->self_.reset();
+    });
+  }
+
+ private:
+  struct Item final {
+    Item() = default;
+    Item(const SocketAddress& remote_address,
+         const uint8_t* data,
+         size_t length)
+        : remote_address(remote_address),
+          data(new uint8_t[length]),
+          length(length) {
+      memcpy(this->data.get(), data, length);
+    }
+
+    std::atomic<Item*> next{nullptr};
+    SocketAddress remote_address;
+    std::unique_ptr<uint8_t[]> data;
+    size_t length = 0;
+  };
+
+  struct Registry final {
+    static Registry& Get() { return LeakedSingleton<Registry>::Get(); }
+
+    Mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<ShardInbox>> inboxes;
+  };
+
+  void Enqueue(Item* item) {
+    item->next.store(nullptr, std::memory_order_relaxed);
+    Item* prev = head_.exchange(item, std::memory_order_acq_rel);
+    prev->next.store(item, std::memory_order_release);
+  }
+
+  // Only called on the owning thread. Returns nullptr when the queue is
+  // empty or a producer has not finished linking its item yet; in the
+  // latter case that producer's uv_async_send() is still to come.
+  Item* Pop() {
+    Item* tail = tail_;
+    Item* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) return nullptr;
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+    Enqueue(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  static void OnWakeup(uv_async_t* handle) {
+    auto inbox = static_cast<ShardInbox*>(handle->data);
+    while (Item* item = inbox->Pop()) {
+      std::unique_ptr<Item> owned(item);
+      if (inbox->endpoint_ == nullptr) continue;
+      inbox->endpoint_->ReceiveForwarded(
+          item->remote_address, item->data.get(), item->length);
+    }
+  }
+
+  uv_async_t async_;
+  Endpoint* endpoint_;
+  std::string key_;
+  std::atomic<bool> closed_{false};
+  std::atomic<size_t> producers_{0};
+  Item stub_;
+  std::atomic<Item*> head_{&stub_};
+  Item* tail_ = &stub_;
+  std::shared_ptr<ShardInbox> self_;
+};
+
 // ============================================================================
 
 bool Endpoint::HasInstance(Environment* env, Local<Value> value) {
@@ -815,6 +1190,28 @@ void Endpoint::Send(Packet* packet) {
   if (is_closed() || is_closing() || packet->length() == 0) return;
   Debug(this, "Sending %s", packet->ToString());
   state_->pending_callbacks++;
+
+  if (send_batch_depth_ > 0) {
+    STAT_INCREMENT_N(Stats, bytes_sent, packet->length());
+    STAT_INCREMENT(Stats, packets_sent);
+    // A train is a run of packets for one destination in which every packet
+    // but the last has the same length.
+    if (send_batch_count_ > 0) {
+      Packet* first = send_batch_[0];
+      if (send_batch_count_ == kMaxSendBatch ||
+          send_batch_bytes_ + packet->length() > kMaxSendBatchBytes ||
+          packet->length() > first->length() ||
+          send_batch_[send_batch_count_ - 1]->length() != first->length() ||
+          packet->destination() != first->destination()) {
+        FlushSendBatch();
+        if (is_closed()) return packet->Done(UV_ECANCELED);
+      }
+    }
+    send_batch_[send_batch_count_++] = packet;
+    send_batch_bytes_ += packet->length();
+    return;
+  }
+
   int err = udp_.Send(packet);
 
   if (err != 0) {
@@ -826,6 +1223,39 @@ void Endpoint::Send(Packet* packet) {
   STAT_INCREMENT(Stats, packets_sent);
 }
 
+Endpoint::SendBatchScope::SendBatchScope(Endpoint* endpoint)
+    : endpoint(endpoint) {
+  endpoint->send_batch_depth_++;
+}
+
+Endpoint::SendBatchScope::~SendBatchScope() {
+  if (--endpoint->send_batch_depth_ == 0) endpoint->FlushSendBatch();
+}
+
+void Endpoint::FlushSendBatch() {
+  if (send_batch_count_ == 0) return;
+  // Completing the packets may re-enter Send(), so take the train first.
+  Packet* batch[kMaxSendBatch];
+  size_t count = send_batch_count_;
+  std::copy_n(send_batch_, count, batch);
+  send_batch_count_ = 0;
+  send_batch_bytes_ = 0;
+
+  Debug(this, "Sending train of %zu packets", count);
+  int err = udp_.Send(batch, count);
+  if (err != 0) {
+    Debug(this, "Sending packet train failed with error %d", err);
+    Destroy(CloseContext::SEND_FAILURE, err);
+  }
+}
+
+void Endpoint::CancelSendBatch() {
+  size_t count = send_batch_count_;
+  send_batch_count_ = 0;
+  send_batch_bytes_ = 0;
+  for (size_t n = 0; n < count; n++) send_batch_[n]->Done(UV_ECANCELED);
+}
+
 void Endpoint::SendRetry(const PathDescriptor& options) {
   // Generating and sending retry packets does consume some system resources,
   // and it is possible for a malicious peer to trigger sending a large number
@@ -938,6 +1368,17 @@ bool Endpoint::Start() {
     state_->bound = 1;
   }
 
+  if (options_.shard_count > 1 && !shard_inbox_) {
+    auto inbox = std::make_shared<ShardInbox>(
+        this, ShardInbox::KeyFor(local_address(), options_.shard_id));
+    if (!inbox->Register()) {
+      inbox->Close();
+      Destroy(CloseContext::BIND_FAILURE, UV_EADDRINUSE);
+      return false;
+    }
+    shard_inbox_ = std::move(inbox);
+  }
+
   err = udp_.Start();
   if (err != 0) {
     // If we failed to start listening, destroy the endpoint. There's nothing we
@@ -967,7 +1408,8 @@ void Endpoint::Listen(const Session::Options& options) {
                        "not what you want.");
   }
 
-  auto context = TLSContext::CreateServer(options.tls_options);
+  auto context =
+      TLSContext::CreateServer(options.tls_options, options_.resumption_keys);
   if (!*context) {
     THROW_ERR_INVALID_STATE(
         env(), "Failed to create TLS context: %s", context->validation_error());
@@ -978,6 +1420,10 @@ void Endpoint::Listen(const Session::Options& options) {
       options,
       std::move(context),
   };
+  if (options_.shard_count > 1) {
+    server_state_->options.cid_factory =
+        &CID::Factory::sharded(options_.shard_id);
+  }
   if (Start()) {
     Debug(this, "Listening with options %s", server_state_->options);
     state_->listening = 1;
@@ -991,7 +1437,12 @@ BaseObjectPtr<Session> Endpoint::Connect(
   // If starting fails, the endpoint will be destroyed.
   if (!Start()) return BaseObjectPtr<Session>();
 
-  Session::Config config(*this, options, local_address(), remote_address);
+  Session::Options session_options = options;
+  if (options_.shard_count > 1) {
+    session_options.cid_factory = &CID::Factory::sharded(options_.shard_id);
+  }
+  Session::Config config(
+      *this, session_options, local_address(), remote_address);
 
   IF_QUIC_DEBUG(env()) {
     Debug(
@@ -1082,7 +1533,14 @@ void Endpoint::Destroy(CloseContext context, int status) {
   token_map_.clear();
   dcid_to_scid_.clear();
 
+  if (shard_inbox_) {
+    shard_inbox_->Close();
+    shard_inbox_.reset();
+  }
+
   udp_.Close();
+  // Once the UDP handle is gone the packets no longer count as pending.
+  CancelSendBatch();
   state_->closing = 0;
   state_->bound = 0;
   state_->receiving = 0;
@@ -1576,6 +2034,16 @@ void Endpoint::Receive(const uv_buf_t& buf,
       return;  // Stateless reset! Don't do any further processing.
     }
 
+    // A short header packet for a connection owned by a sibling shard,
+    // typically because the peer's address changed and the kernel picked
+    // a different socket for the new 4-tuple.
+    if (!scid && MaybeForwardToShard(dcid, store, addr, remote_address)) {
+      Debug(this,
+            "Packet was forwarded to shard %d",
+            CID::Factory::ShardOf(dcid));
+      return;
+    }
+
     // Process the packet as an initial packet...
     return acceptInitialPacket(pversion_cid.version,
                                dcid,
@@ -1591,6 +2059,32 @@ void Endpoint::Receive(const uv_buf_t& buf,
   receive(session.get(), std::move(store), addr, remote_address, dcid, scid);
 }
 
+bool Endpoint::MaybeForwardToShard(const CID& dcid,
+                                   const Store& store,
+                                   const SocketAddress& local_address,
+                                   const SocketAddress& remote_address) {
+  if (options_.shard_count < 2 || !dcid) return false;
+  uint8_t shard_id = CID::Factory::ShardOf(dcid);
+  if (shard_id == options_.shard_id || shard_id >= options_.shard_count)
+    return false;
+  auto inbox = ShardInbox::Find(ShardInbox::KeyFor(local_address, shard_id));
+  if (!inbox) return false;
+  ngtcp2_vec vec = store;
+  if (!inbox->Push(remote_address, vec.base, vec.len)) return false;
+  STAT_INCREMENT(Stats, packets_forwarded);
+  return true;
+}
+
+void Endpoint::ReceiveForwarded(const SocketAddress& remote_address,
+                                const uint8_t* data,
+                                size_t length) {
+  if (is_closed()) return;
+  STAT_INCREMENT(Stats, forwarded_packets_received);
+  uv_buf_t buf = env()->allocate_managed_buffer(length);
+  memcpy(buf.base, data, length);
+  Receive(uv_buf_init(buf.base, length), remote_address);
+}
+
 void Endpoint::PacketDone(int status) {
   if (is_closed()) return;
   // At this point we should be waiting on at least one packet.
@@ -1601,6 +2095,14 @@ void Endpoint::PacketDone(int status) {
   if (state_->closing == 1) MaybeDestroy();
 }
 
+void Endpoint::PacketCreated(bool from_freelist) {
+  if (from_freelist) {
+    STAT_INCREMENT(Stats, packet_pool_hits);
+  } else {
+    STAT_INCREMENT(Stats, packet_pool_misses);
+  }
+}
+
 void Endpoint::IncrementSocketAddressCounter(const SocketAddress& addr) {
   addrLRU_.Upsert(addr)->active_connections++;
 }
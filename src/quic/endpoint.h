@@ -176,6 +176,23 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
     // Setting to 0 uses the default.
     uint8_t udp_ttl = 0;
 
+    // When shard_count is greater than one, shard_count endpoints (typically
+    // one per worker thread) share the same local port using SO_REUSEPORT.
+    // Every CID issued by this endpoint encodes shard_id, so short header
+    // packets that the kernel delivers to the wrong endpoint (for instance
+    // after the peer migrates to a new address) can be handed off to the
+    // endpoint that owns the connection.
+    uint8_t shard_id = 0;
+    uint8_t shard_count = 0;
+
+    // When set, the token secrets above are replaced with those of the named
+    // ResumptionGroup, and TLS session tickets issued by this endpoint are
+    // encrypted with the group's ticket keys. When resumption_group_shared
+    // is true the group is shared across processes (see ResumptionGroup).
+    std::string resumption_group;
+    bool resumption_group_shared = false;
+    const ResumptionGroup* resumption_keys = nullptr;
+
     void MemoryInfo(MemoryTracker* tracker) const override;
     SET_MEMORY_INFO_NAME(Endpoint::Config)
     SET_SELF_SIZE(Options)
@@ -183,6 +200,12 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
     static v8::Maybe<Options> From(Environment* env,
                                    v8::Local<v8::Value> value);
 
+    // Parses a congestion control algorithm given either by name or by its
+    // ngtcp2_cc_algo value. Throws and returns false if the value is invalid.
+    static bool GetCCAlgorithm(Environment* env,
+                               v8::Local<v8::Value> value,
+                               ngtcp2_cc_algo* algo);
+
     std::string ToString() const;
   };
 
@@ -235,6 +258,18 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
 
   void Send(Packet* packet);
 
+  // While a SendBatchScope is active, consecutive packets sent to the same
+  // destination are held back and handed to the UDP socket as a single
+  // train once the scope closes (or the train can not grow any further).
+  // Where the platform supports it the train goes out with one UDP_SEGMENT
+  // (GSO) sendmsg() call rather than one uv_udp_send() per packet.
+  struct SendBatchScope {
+    BaseObjectPtr<Endpoint> endpoint;
+    explicit SendBatchScope(Endpoint* endpoint);
+    DISALLOW_COPY_AND_MOVE(SendBatchScope)
+    ~SendBatchScope();
+  };
+
   // Generates and sends a retry packet. This is terminal for the connection.
   // Retry packets are used to force explicit path validation by issuing a token
   // to the peer that it must thereafter include in all subsequent initial
@@ -300,6 +335,9 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
     void Stop();
     void Close();
     int Send(Packet* packet);
+    // Sends a train of packets for the same destination. All but the last
+    // packet must have the same length.
+    int Send(Packet* const* packets, size_t count);
 
     // Returns the local UDP socket address to which we are bound,
     // or fail with an assert if we are not bound.
@@ -358,6 +396,7 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
   void Release();
 
   void PacketDone(int status) override;
+  void PacketCreated(bool from_freelist) override;
 
   void EmitNewSession(const BaseObjectPtr<Session>& session);
   void EmitClose(CloseContext context, int status);
@@ -409,6 +448,19 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
 
   void Receive(const uv_buf_t& buf, const SocketAddress& from);
 
+  // Hands the packet to the sibling endpoint that owns the shard encoded in
+  // the dcid. Returns false if the packet should be processed locally.
+  bool MaybeForwardToShard(const CID& dcid,
+                           const Store& store,
+                           const SocketAddress& local_address,
+                           const SocketAddress& remote_address);
+  void ReceiveForwarded(const SocketAddress& remote_address,
+                        const uint8_t* data,
+                        size_t length);
+
+  void FlushSendBatch();
+  void CancelSendBatch();
+
   AliasedStruct<Stats> stats_;
   AliasedStruct<State> state_;
   const Options options_;
@@ -448,6 +500,18 @@ class Endpoint final : public AsyncWrap, public Packet::Listener {
   CloseContext close_context_ = CloseContext::CLOSE;
   int close_status_ = 0;
 
+  // The packet train collected by SendBatchScope.
+  static constexpr size_t kMaxSendBatch = 32;
+  static constexpr size_t kMaxSendBatchBytes = 64000;
+  size_t send_batch_depth_ = 0;
+  size_t send_batch_count_ = 0;
+  size_t send_batch_bytes_ = 0;
+  Packet* send_batch_[kMaxSendBatch];
+
+  // Receives packets forwarded by sibling shards on other threads.
+  class ShardInbox;
+  std::shared_ptr<ShardInbox> shard_inbox_;
+
   friend class UDP;
   friend class Packet;
   friend class Session;
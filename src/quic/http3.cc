@@ -11,6 +11,7 @@
 #include <node_http_common-inl.h>
 #include <node_sockaddr-inl.h>
 #include <util-inl.h>
+#include <unordered_set>
 #include "application.h"
 #include "bindingdata.h"
 #include "defs.h"
@@ -21,6 +22,10 @@ namespace node {
 namespace quic {
 namespace {
 
+// HTTP/3 unidirectional stream types (RFC 9204, section 4.2).
+constexpr uint8_t kStreamTypeQpackEncoder = 0x02;
+constexpr uint8_t kStreamTypeQpackDecoder = 0x03;
+
 struct Http3HeadersTraits {
   typedef nghttp3_nv nv_t;
 };
@@ -122,6 +127,7 @@ class Http3Application final : public Session::Application {
                          size_t datalen,
                          Stream::ReceiveDataFlags flags) override {
     Debug(&session(), "HTTP/3 application received %zu bytes of data", datalen);
+    MaybeRecordRemoteQpackBytes(stream->id(), data, datalen);
     ssize_t nread = nghttp3_conn_read_stream(
         *this, stream->id(), data, datalen, flags.fin ? 1 : 0);
 
@@ -382,6 +388,10 @@ class Http3Application final : public Session::Application {
           nghttp3_err_infer_quic_app_error_code(err)));
       return false;
     }
+    if (data->id == qpack_enc_stream_id_ || data->id == qpack_dec_stream_id_) {
+      session().RecordQpackStreamBytes(
+          data->id == qpack_enc_stream_id_, true, datalen);
+    }
     return true;
   }
 
@@ -426,6 +436,44 @@ class Http3Application final : public Session::Application {
            id == qpack_enc_stream_id_;
   }
 
+  // The peer's QPACK streams are identified by the stream type that opens
+  // every HTTP/3 unidirectional stream. nghttp3 does not expose that, so the
+  // first chunk of each peer-initiated unidirectional stream is inspected
+  // here until both QPACK streams have been seen.
+  void MaybeRecordRemoteQpackBytes(int64_t id,
+                                   const uint8_t* data,
+                                   size_t datalen) {
+    if (datalen == 0) return;
+    if (id == remote_qpack_enc_stream_id_ ||
+        id == remote_qpack_dec_stream_id_) {
+      session().RecordQpackStreamBytes(
+          id == remote_qpack_enc_stream_id_, false, datalen);
+      return;
+    }
+    if (remote_qpack_enc_stream_id_ != -1 &&
+        remote_qpack_dec_stream_id_ != -1) {
+      return;
+    }
+    if (ngtcp2_is_bidi_stream(id) ||
+        ngtcp2_conn_is_local_stream(session(), id) ||
+        !remote_uni_streams_seen_.insert(id).second) {
+      return;
+    }
+    switch (data[0]) {
+      case kStreamTypeQpackEncoder:
+        remote_qpack_enc_stream_id_ = id;
+        break;
+      case kStreamTypeQpackDecoder:
+        remote_qpack_dec_stream_id_ = id;
+        break;
+      default:
+        return;
+    }
+    remote_uni_streams_seen_.clear();
+    session().RecordQpackStreamBytes(
+        id == remote_qpack_enc_stream_id_, false, datalen);
+  }
+
   bool is_destroyed() const { return session().is_destroyed(); }
 
   Http3ConnectionPointer InitializeConnection() {
@@ -596,6 +644,9 @@ class Http3Application final : public Session::Application {
   int64_t control_stream_id_ = -1;
   int64_t qpack_dec_stream_id_ = -1;
   int64_t qpack_enc_stream_id_ = -1;
+  int64_t remote_qpack_dec_stream_id_ = -1;
+  int64_t remote_qpack_enc_stream_id_ = -1;
+  std::unordered_set<int64_t> remote_uni_streams_seen_;
 
   // ==========================================================================
   // Static callbacks
@@ -9,6 +9,7 @@
 #include <stream_base-inl.h>
 #include <uv.h>
 #include <v8.h>
+#include <unordered_map>
 #include "bindingdata.h"
 
 namespace node {
@@ -146,6 +147,142 @@ void LogStream::ensure_space(size_t amt) {
     buffer_.pop_front();
   }
 }
+
+// ============================================================================
+
+QlogWriter::QlogWriter() {
+  CHECK_EQ(uv_thread_create(&thread_, ThreadMain, this), 0);
+}
+
+QlogWriter::~QlogWriter() {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    stopping_ = true;
+    cond_.Signal(lock);
+  }
+  CHECK_EQ(uv_thread_join(&thread_), 0);
+}
+
+std::unique_ptr<QlogWriter::File> QlogWriter::Open(std::string path) {
+  uint64_t id;
+  {
+    Mutex::ScopedLock lock(mutex_);
+    id = next_id_++;
+  }
+  Enqueue(Record{Op::OPEN, id, std::move(path)});
+  return std::make_unique<File>(shared_from_this(), id);
+}
+
+void QlogWriter::Enqueue(Record&& record) {
+  Mutex::ScopedLock lock(mutex_);
+  if (record.op == Op::WRITE) {
+    if (pending_bytes_ + record.data.size() > kMaxPendingBytes) return;
+    pending_bytes_ += record.data.size();
+  }
+  bool was_empty = queue_.empty();
+  queue_.push_back(std::move(record));
+  if (was_empty) cond_.Signal(lock);
+}
+
+void QlogWriter::ThreadMain(void* arg) {
+  QlogWriter* writer = static_cast<QlogWriter*>(arg);
+  // Only the writer thread touches the file descriptors.
+  std::unordered_map<uint64_t, uv_file> files;
+  std::deque<Record> records;
+
+  const auto write_all = [](uv_file fd, const std::string& data) {
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(data.data()), data.size());
+    while (buf.len > 0) {
+      uv_fs_t req;
+      int r = uv_fs_write(nullptr, &req, fd, &buf, 1, -1, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (r == UV_EINTR) continue;
+      if (r <= 0) return;
+      buf.base += r;
+      buf.len -= r;
+    }
+  };
+
+  const auto close_file = [&](uint64_t id) {
+    auto it = files.find(id);
+    if (it == files.end()) return;
+    uv_fs_t req;
+    uv_fs_close(nullptr, &req, it->second, nullptr);
+    uv_fs_req_cleanup(&req);
+    files.erase(it);
+  };
+
+  while (true) {
+    bool stopping;
+    {
+      Mutex::ScopedLock lock(writer->mutex_);
+      while (writer->queue_.empty() && !writer->stopping_)
+        writer->cond_.Wait(lock);
+      // Everything that was queued before stopping is still written.
+      records.swap(writer->queue_);
+      stopping = writer->stopping_;
+    }
+
+    size_t written = 0;
+    for (Record& record : records) {
+      switch (record.op) {
+        case Op::OPEN: {
+          uv_fs_t req;
+          int fd = uv_fs_open(nullptr,
+                              &req,
+                              record.data.c_str(),
+                              UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC,
+                              0644,
+                              nullptr);
+          uv_fs_req_cleanup(&req);
+          if (fd >= 0) files[record.id] = fd;
+          break;
+        }
+        case Op::WRITE: {
+          auto it = files.find(record.id);
+          if (it != files.end()) write_all(it->second, record.data);
+          written += record.data.size();
+          break;
+        }
+        case Op::CLOSE:
+          close_file(record.id);
+          break;
+      }
+    }
+    records.clear();
+
+    {
+      Mutex::ScopedLock lock(writer->mutex_);
+      writer->pending_bytes_ -= written;
+    }
+
+    if (stopping) break;
+  }
+
+  // Files are closed by their owners before the writer can go away, since
+  // each of them holds a reference to it. This only catches leftovers.
+  while (!files.empty()) close_file(files.begin()->first);
+}
+
+QlogWriter::File::File(std::shared_ptr<QlogWriter> writer, uint64_t id)
+    : writer_(std::move(writer)), id_(id) {}
+
+QlogWriter::File::~File() {
+  Close();
+}
+
+void QlogWriter::File::Write(const void* data, size_t len) {
+  if (closed_ || len == 0) return;
+  writer_->Enqueue(Record{
+      Op::WRITE, id_, std::string(static_cast<const char*>(data), len)});
+}
+
+void QlogWriter::File::Close() {
+  if (closed_) return;
+  closed_ = true;
+  writer_->Enqueue(Record{Op::CLOSE, id_, std::string()});
+}
+
 }  // namespace quic
 }  // namespace node
 
@@ -6,8 +6,12 @@
 #include <async_wrap.h>
 #include <base_object.h>
 #include <env.h>
+#include <node_mutex.h>
 #include <stream_base.h>
 #include <deque>
+#include <memory>
+#include <string>
+#include "defs.h"
 
 namespace node {
 namespace quic {
@@ -76,6 +80,70 @@ class LogStream : public AsyncWrap, public StreamBase {
   void ensure_space(size_t amt);
 };
 
+// Writes qlog output straight to files from a background thread, so that
+// tracing a session costs neither a trip through JavaScript nor blocking
+// file I/O on the event loop. ngtcp2 produces qlog as JSON text sequences
+// (RFC 7464), which are written out as is. Opening, writing and closing the
+// files all happen on the writer thread, in the order they were requested.
+//
+// The writer is shared by the sessions of an Environment. Each QlogFile
+// keeps it alive, so that the last records of a session still get written
+// if the session outlives the binding.
+class QlogWriter final : public std::enable_shared_from_this<QlogWriter> {
+ public:
+  class File;
+
+  QlogWriter();
+  ~QlogWriter();
+  DISALLOW_COPY_AND_MOVE(QlogWriter)
+
+  // Creates (or truncates) the file at |path|. Errors opening or writing
+  // the file are ignored, tracing is best effort.
+  std::unique_ptr<File> Open(std::string path);
+
+  // A single qlog file. Closing it, or destroying it, flushes and closes
+  // the underlying file descriptor on the writer thread.
+  class File final {
+   public:
+    File(std::shared_ptr<QlogWriter> writer, uint64_t id);
+    ~File();
+    DISALLOW_COPY_AND_MOVE(File)
+
+    void Write(const void* data, size_t len);
+    void Close();
+
+   private:
+    std::shared_ptr<QlogWriter> writer_;
+    uint64_t id_;
+    bool closed_ = false;
+  };
+
+  // Records that are queued while more than this many bytes are waiting to
+  // be written are dropped, so that a slow disk cannot grow the queue
+  // without bound.
+  static constexpr size_t kMaxPendingBytes = 16 * 1024 * 1024;
+
+ private:
+  enum class Op { OPEN, WRITE, CLOSE };
+  struct Record {
+    Op op;
+    uint64_t id;
+    // The path for OPEN, the data for WRITE.
+    std::string data;
+  };
+
+  void Enqueue(Record&& record);
+  static void ThreadMain(void* arg);
+
+  Mutex mutex_;
+  ConditionVariable cond_;
+  std::deque<Record> queue_;
+  size_t pending_bytes_ = 0;
+  uint64_t next_id_ = 1;
+  bool stopping_ = false;
+  uv_thread_t thread_;
+};
+
 }  // namespace quic
 }  // namespace node
 
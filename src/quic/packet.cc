@@ -29,6 +29,8 @@ namespace {
 static constexpr size_t kRandlen = NGTCP2_MIN_STATELESS_RESET_RANDLEN * 5;
 static constexpr size_t kMinStatelessResetLen = 41;
 static constexpr size_t kMaxFreeList = 100;
+// Packets in the freelist hold on to data buffers up to this size.
+static constexpr size_t kMaxRetainedLength = NGTCP2_MAX_PMTUD_UDP_PAYLOAD_SIZE;
 }  // namespace
 
 std::string PathDescriptor::ToString() const {
@@ -49,8 +51,8 @@ struct Packet::Data final : public MemoryRetainer {
 
   // The diagnostic_label_ is used only as a debugging tool when
   // logging debug information about the packet. It identifies
-  // the purpose of the packet.
-  const std::string diagnostic_label_;
+  // the purpose of the packet. It is always a string literal.
+  const char* diagnostic_label_;
 
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackFieldWithSize("data", data_.length());
@@ -58,19 +60,26 @@ struct Packet::Data final : public MemoryRetainer {
   SET_MEMORY_INFO_NAME(Data)
   SET_SELF_SIZE(Data)
 
-  Data(size_t length, std::string_view diagnostic_label)
+  Data(size_t length, const char* diagnostic_label)
       : diagnostic_label_(diagnostic_label) {
     data_.AllocateSufficientStorage(length);
   }
 
+  // Prepares the buffer of a recycled packet for its next use.
+  void Reset(size_t length, const char* diagnostic_label) {
+    data_.AllocateSufficientStorage(length);
+    diagnostic_label_ = diagnostic_label;
+  }
+
   size_t length() const { return data_.length(); }
+  size_t capacity() const { return data_.capacity(); }
   operator uv_buf_t() {
     return uv_buf_init(reinterpret_cast<char*>(data_.out()), data_.length());
   }
   operator ngtcp2_vec() { return ngtcp2_vec{data_.out(), data_.length()}; }
 
   std::string ToString() const {
-    return diagnostic_label_ + ", " + std::to_string(length());
+    return std::string(diagnostic_label_) + ", " + std::to_string(length());
   }
 };
 
@@ -115,7 +124,8 @@ Packet* Packet::Create(Environment* env,
                        const SocketAddress& destination,
                        size_t length,
                        const char* diagnostic_label) {
-  if (BindingData::Get(env).packet_freelist.empty()) {
+  auto& binding = BindingData::Get(env);
+  if (binding.packet_freelist.empty()) {
     Local<Object> obj;
     if (UNLIKELY(!GetConstructorTemplate(env)
                       ->InstanceTemplate()
@@ -124,14 +134,22 @@ Packet* Packet::Create(Environment* env,
       return nullptr;
     }
 
+    if (listener != nullptr) listener->PacketCreated(false);
     return new Packet(
         env, listener, obj, destination, length, diagnostic_label);
   }
 
-  return FromFreeList(env,
-                      std::make_shared<Data>(length, diagnostic_label),
-                      listener,
-                      destination);
+  // The packet at the back of the freelist usually still owns the buffer
+  // from its previous use.
+  std::shared_ptr<Data> data = std::move(binding.packet_freelist.back()->data_);
+  if (data) {
+    data->Reset(length, diagnostic_label);
+  } else {
+    data = std::make_shared<Data>(length, diagnostic_label);
+  }
+
+  if (listener != nullptr) listener->PacketCreated(true);
+  return FromFreeList(env, std::move(data), listener, destination);
 }
 
 Packet* Packet::Clone() const {
@@ -206,7 +224,12 @@ void Packet::Done(int status) {
   if (binding.packet_freelist.size() < kMaxFreeList) {
     Debug(this, "Returning packet to freelist");
     listener_ = nullptr;
-    data_.reset();
+    // Keep the buffer for the next use of this packet unless a clone still
+    // shares it or it is larger than we want to hold on to.
+    if (data_ &&
+        (data_.use_count() > 1 || data_->capacity() > kMaxRetainedLength)) {
+      data_.reset();
+    }
     Reset();
     binding.packet_freelist.push_back(this);
   } else {
@@ -41,7 +41,10 @@ struct PathDescriptor {
 // a Packet, we'll check to see if there is a free
 // packet in the freelist and use it instead of starting
 // fresh with a new packet. The freelist can store at
-// most kMaxFreeList packets
+// most kMaxFreeList packets. A packet in the freelist
+// keeps its data buffer, as long as it is no larger
+// than a full sized datagram, so that reusing the
+// packet does not allocate either.
 //
 // Packets are always encrypted so their content should
 // be considered opaque to us. We leave it entirely up
@@ -57,6 +60,9 @@ class Packet final : public ReqWrap<uv_udp_send_t> {
   class Listener {
    public:
     virtual void PacketDone(int status) = 0;
+    // Called when a packet for this listener is created, reporting whether
+    // it was taken from the freelist.
+    virtual void PacketCreated(bool from_freelist) {}
   };
 
   // Do not use the Packet constructors directly to create
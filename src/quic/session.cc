@@ -104,7 +104,18 @@ namespace quic {
   V(DATAGRAMS_RECEIVED, datagrams_received)                                    \
   V(DATAGRAMS_SENT, datagrams_sent)                                            \
   V(DATAGRAMS_ACKNOWLEDGED, datagrams_acknowledged)                            \
-  V(DATAGRAMS_LOST, datagrams_lost)
+  V(DATAGRAMS_LOST, datagrams_lost)                                            \
+  /* The estimated send rate in bytes per second, cwnd / smoothed_rtt */       \
+  V(PACING_RATE, pacing_rate)                                                  \
+  /* The number of times the congestion controller lowered ssthresh */        \
+  V(CONGESTION_EVENTS, congestion_events)                                      \
+  /* The number of times sending was held back by max_pacing_rate */          \
+  V(PACING_LIMITED_COUNT, pacing_limited_count)                              \
+  /* Bytes carried on the HTTP/3 QPACK encoder and decoder streams */         \
+  V(QPACK_ENCODER_BYTES_SENT, qpack_encoder_bytes_sent)                        \
+  V(QPACK_ENCODER_BYTES_RECEIVED, qpack_encoder_bytes_received)                \
+  V(QPACK_DECODER_BYTES_SENT, qpack_decoder_bytes_sent)                        \
+  V(QPACK_DECODER_BYTES_RECEIVED, qpack_decoder_bytes_received)
 
 #define SESSION_JS_METHODS(V)                                                  \
   V(DoDestroy, destroy, false)                                                 \
@@ -266,6 +277,21 @@ bool SetOption(Environment* env,
   return true;
 }
 
+template <typename Opt, std::optional<ngtcp2_cc_algo> Opt::*member>
+bool SetOption(Environment* env,
+               Opt* options,
+               const v8::Local<Object>& object,
+               const v8::Local<String>& name) {
+  Local<Value> value;
+  if (!object->Get(env->context(), name).ToLocal(&value)) return false;
+  if (!value->IsUndefined()) {
+    ngtcp2_cc_algo algo;
+    if (!Endpoint::Options::GetCCAlgorithm(env, value, &algo)) return false;
+    options->*member = algo;
+  }
+  return true;
+}
+
 template <typename Opt, TransportParams::Options Opt::*member>
 bool SetOption(Environment* env,
                Opt* options,
@@ -310,7 +336,15 @@ Session::Config::Config(Side side,
   settings.tokenlen = 0;
   settings.token = nullptr;
 
-  if (options.qlog) {
+  if (!options.qlog_dir.empty() && options.qlog_sample_rate > 0) {
+    uint32_t sample = 0;
+    if (options.qlog_sample_rate < 100) {
+      CHECK(ncrypto::CSPRNG(&sample, sizeof(sample)));
+    }
+    qlog_to_file = sample % 100 < options.qlog_sample_rate;
+  }
+
+  if (options.qlog || qlog_to_file) {
     settings.qlog_write = on_qlog_write;
   }
 
@@ -325,7 +359,7 @@ Session::Config::Config(Side side,
   settings.handshake_timeout = config.handshake_timeout;
   settings.max_stream_window = config.max_stream_window;
   settings.max_window = config.max_window;
-  settings.cc_algo = config.cc_algorithm;
+  settings.cc_algo = options.cc_algorithm.value_or(config.cc_algorithm);
   settings.max_tx_udp_payload_size = config.max_payload_size;
   if (config.unacknowledged_packet_threshold > 0) {
     settings.ack_thresh = config.unacknowledged_packet_threshold;
@@ -422,12 +456,19 @@ Maybe<Session::Options> Session::Options::From(Environment* env,
 
   if (!SET(version) || !SET(min_version) || !SET(preferred_address_strategy) ||
       !SET(transport_params) || !SET(tls_options) ||
-      !SET(application_options) || !SET(qlog)) {
+      !SET(application_options) || !SET(qlog) || !SET(qlog_dir) ||
+      !SET(qlog_sample_rate) || !SET(cc_algorithm) || !SET(max_pacing_rate)) {
     return Nothing<Options>();
   }
 
 #undef SET
 
+  if (options.qlog_sample_rate > 100) {
+    THROW_ERR_INVALID_ARG_VALUE(
+        env, "The qlogSampleRate option must be between 0 and 100");
+    return Nothing<Options>();
+  }
+
   // TODO(@jasnell): Later we will also support setting the CID::Factory.
   // For now, we're just using the default random factory.
 
@@ -462,6 +503,16 @@ std::string Session::Options::ToString() const {
   res += prefix + "crypto options: " + tls_options.ToString();
   res += prefix + "application options: " + application_options.ToString();
   res += prefix + "qlog: " + (qlog ? std::string("yes") : std::string("no"));
+  if (!qlog_dir.empty()) {
+    res += prefix + "qlog dir: " + qlog_dir;
+    res += prefix + "qlog sample rate: " + std::to_string(qlog_sample_rate);
+  }
+  if (cc_algorithm.has_value()) {
+    res += prefix + "cc algorithm: " + std::to_string(cc_algorithm.value());
+  }
+  if (max_pacing_rate > 0) {
+    res += prefix + "max pacing rate: " + std::to_string(max_pacing_rate);
+  }
   res += indent.Close();
   return res;
 }
@@ -502,6 +553,7 @@ Session::Session(Endpoint* endpoint,
       config_(config),
       local_address_(config.local_address),
       remote_address_(config.remote_address),
+      qlog_file_(OpenQlogFile()),
       connection_(InitConnection()),
       tls_session_(tls_context->NewSession(this, session_ticket)),
       application_(select_application()),
@@ -637,7 +689,24 @@ const Session::Options& Session::options() const {
   return config_.options;
 }
 
+std::unique_ptr<QlogWriter::File> Session::OpenQlogFile() {
+  if (!config_.qlog_to_file) return nullptr;
+  // The scid is random, and the side tells the two ends of a connection
+  // apart when both of them are traced by the same process.
+  std::string path = config_.options.qlog_dir + "/" +
+                     (is_server() ? "server-" : "client-") +
+                     config_.scid.ToString() + ".sqlog";
+  Debug(this, "Writing qlog data to %s", path);
+  return BindingData::Get(env()).qlog_writer()->Open(std::move(path));
+}
+
 void Session::HandleQlog(uint32_t flags, const void* data, size_t len) {
+  if (qlog_file_) {
+    // Unlike the stream below, the file is written by native code only, so
+    // it is safe to write even while the Session is being destroyed.
+    qlog_file_->Write(data, len);
+    if (flags & NGTCP2_QLOG_WRITE_FLAG_FIN) qlog_file_->Close();
+  }
   if (qlog_stream_) {
     // Fun fact... ngtcp2 does not emit the final qlog statement until the
     // ngtcp2_conn object is destroyed. Ideally, destroying is explicit, but
@@ -850,6 +919,7 @@ void Session::Send(Packet* packet) {
   if (can_send_packets() && packet->length() > 0) {
     Debug(this, "Session is sending %s", packet->ToString());
     STAT_INCREMENT_N(Stats, bytes_sent, packet->length());
+    ConsumePacingCredit(packet->length());
     endpoint_->Send(packet);
     return;
   }
@@ -1262,11 +1332,79 @@ void Session::ExtendOffset(size_t amount) {
   ngtcp2_conn_extend_max_offset(*this, amount);
 }
 
+void Session::RecordQpackStreamBytes(bool encoder_stream,
+                                     bool sent,
+                                     size_t amount) {
+  if (encoder_stream) {
+    if (sent) {
+      STAT_INCREMENT_N(Stats, qpack_encoder_bytes_sent, amount);
+    } else {
+      STAT_INCREMENT_N(Stats, qpack_encoder_bytes_received, amount);
+    }
+  } else if (sent) {
+    STAT_INCREMENT_N(Stats, qpack_decoder_bytes_sent, amount);
+  } else {
+    STAT_INCREMENT_N(Stats, qpack_decoder_bytes_received, amount);
+  }
+}
+
+size_t Session::MaxPacedPacketCount(size_t max_packet_size) {
+  const uint64_t rate = config_.options.max_pacing_rate;
+  if (rate == 0) return SIZE_MAX;
+  DCHECK_GT(max_packet_size, 0);
+
+  // The bucket holds at most kMaxPacingBurst packets worth of credit so an
+  // idle session can not build up an unbounded burst.
+  static constexpr int64_t kMaxPacingBurst = 16;
+  const int64_t max_credit =
+      kMaxPacingBurst * static_cast<int64_t>(max_packet_size);
+  uint64_t now = uv_hrtime();
+  if (pacing_refill_ts_ == 0) {
+    pacing_credit_ = max_credit;
+  } else {
+    uint64_t refill = (now - pacing_refill_ts_) * rate / NGTCP2_SECONDS;
+    pacing_credit_ = std::min(
+        max_credit,
+        pacing_credit_ + static_cast<int64_t>(std::min<uint64_t>(
+                             refill, static_cast<uint64_t>(max_credit))));
+  }
+  pacing_refill_ts_ = now;
+
+  if (pacing_credit_ >= static_cast<int64_t>(max_packet_size)) {
+    pacing_wakeup_ts_ = 0;
+    return static_cast<size_t>(pacing_credit_) / max_packet_size;
+  }
+
+  uint64_t deficit =
+      static_cast<uint64_t>(static_cast<int64_t>(max_packet_size) -
+                            pacing_credit_);
+  pacing_wakeup_ts_ = now + std::max<uint64_t>(
+                                deficit * NGTCP2_SECONDS / rate, 1);
+  STAT_INCREMENT(Stats, pacing_limited_count);
+  return 0;
+}
+
+void Session::ConsumePacingCredit(size_t length) {
+  if (config_.options.max_pacing_rate == 0) return;
+  pacing_credit_ -= static_cast<int64_t>(length);
+}
+
 void Session::UpdateDataStats() {
   if (state_->destroyed) return;
   Debug(this, "Updating data stats");
   ngtcp2_conn_info info;
   ngtcp2_conn_get_conn_info(*this, &info);
+  uint64_t ssthresh = STAT_GET(Stats, ssthresh);
+  if (ssthresh != 0 && info.ssthresh < ssthresh) {
+    STAT_INCREMENT(Stats, congestion_events);
+  }
+  if (info.smoothed_rtt > 0) {
+    uint64_t pacing_rate = info.cwnd * NGTCP2_SECONDS / info.smoothed_rtt;
+    if (config_.options.max_pacing_rate > 0) {
+      pacing_rate = std::min(pacing_rate, config_.options.max_pacing_rate);
+    }
+    STAT_SET(Stats, pacing_rate, pacing_rate);
+  }
   STAT_SET(Stats, bytes_in_flight, info.bytes_in_flight);
   STAT_SET(Stats, cwnd, info.cwnd);
   STAT_SET(Stats, latest_rtt, info.latest_rtt);
@@ -1342,6 +1480,8 @@ void Session::UpdateTimer() {
   // Both uv_hrtime and ngtcp2_conn_get_expiry return nanosecond units.
   uint64_t expiry = ngtcp2_conn_get_expiry(*this);
   uint64_t now = uv_hrtime();
+  // Wake up early if the max_pacing_rate held back a packet.
+  if (pacing_wakeup_ts_ > now) expiry = std::min(expiry, pacing_wakeup_ts_);
   Debug(
       this, "Updating timer. Expiry: %" PRIu64 ", now: %" PRIu64, expiry, now);
 
@@ -68,9 +68,12 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
 
     // HTTP/3 specific options.
     uint64_t max_field_section_size = 0;
-    uint64_t qpack_max_dtable_capacity = 0;
-    uint64_t qpack_encoder_max_dtable_capacity = 0;
-    uint64_t qpack_blocked_streams = 0;
+    // By default both sides of the connection make use of a modest QPACK
+    // dynamic table so that repeated header fields are sent as small
+    // indexed references rather than as literals on every request.
+    uint64_t qpack_max_dtable_capacity = 4096;
+    uint64_t qpack_encoder_max_dtable_capacity = 4096;
+    uint64_t qpack_blocked_streams = 100;
 
     bool enable_connect_protocol = true;
     bool enable_datagrams = true;
@@ -123,6 +126,24 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
     // When true, QLog output will be enabled for the session.
     bool qlog = false;
 
+    // When set, the QLog output of the session is written by native code to
+    // a file in this directory instead of going through a JS stream.
+    std::string qlog_dir;
+
+    // The percentage of sessions that write a QLog file when qlog_dir is
+    // set, so that a fraction of the connections can be traced all the
+    // time.
+    uint32_t qlog_sample_rate = 100;
+
+    // The congestion control algorithm used by the session. When not set,
+    // the cc_algorithm configured for the Endpoint is used.
+    std::optional<ngtcp2_cc_algo> cc_algorithm = std::nullopt;
+
+    // An upper bound, in bytes per second, on the rate at which the session
+    // puts packets on the wire, on top of ngtcp2's own pacing. Zero means
+    // no limit.
+    uint64_t max_pacing_rate = 0;
+
     void MemoryInfo(MemoryTracker* tracker) const override;
     SET_MEMORY_INFO_NAME(Session::Options)
     SET_SELF_SIZE(Options)
@@ -164,6 +185,9 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
     CID retry_scid = CID::kInvalid;
     CID preferred_address_cid = CID::kInvalid;
 
+    // Whether this session was sampled to write a QLog file.
+    bool qlog_to_file = false;
+
     ngtcp2_settings settings = {};
     operator ngtcp2_settings*() { return &settings; }
     operator const ngtcp2_settings*() const { return &settings; }
@@ -266,6 +290,10 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
   void SetLastError(QuicError&& error);
   uint64_t max_data_left() const;
 
+  // Records traffic on the HTTP/3 QPACK encoder or decoder stream so that
+  // the effectiveness of the dynamic table can be observed in the stats.
+  void RecordQpackStreamBytes(bool encoder_stream, bool sent, size_t amount);
+
   enum class CloseMethod {
     // Roundtrip through JavaScript, causing all currently opened streams
     // to be closed. An attempt will be made to send a CONNECTION_CLOSE
@@ -364,6 +392,13 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
   void set_wrapped();
 
   void DoClose(bool silent = false);
+
+  // The number of packets of max_packet_size that the max_pacing_rate
+  // currently allows to be sent. Returns SIZE_MAX when the rate is not
+  // limited. When zero, the timer is armed to fire once a packet may go.
+  size_t MaxPacedPacketCount(size_t max_packet_size);
+  void ConsumePacingCredit(size_t length);
+
   void UpdateDataStats();
   void SendConnectionClose();
   void OnTimeout();
@@ -404,6 +439,7 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
   void UpdatePath(const PathStorage& path);
 
   QuicConnectionPointer InitConnection();
+  std::unique_ptr<QlogWriter::File> OpenQlogFile();
 
   std::unique_ptr<Application> select_application();
 
@@ -414,6 +450,9 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
   Config config_;
   SocketAddress local_address_;
   SocketAddress remote_address_;
+  // ngtcp2 writes the last QLog records while the connection is destroyed,
+  // so the file has to outlive connection_.
+  std::unique_ptr<QlogWriter::File> qlog_file_;
   QuicConnectionPointer connection_;
   std::unique_ptr<TLSSession> tls_session_;
   std::unique_ptr<Application> application_;
@@ -421,6 +460,11 @@ class Session final : public AsyncWrap, private SessionTicket::AppData::Source {
   TimerWrapHandle timer_;
   size_t send_scope_depth_ = 0;
   size_t connection_close_depth_ = 0;
+
+  // Token bucket state for max_pacing_rate, in bytes and nanoseconds.
+  int64_t pacing_credit_ = 0;
+  uint64_t pacing_refill_ts_ = 0;
+  uint64_t pacing_wakeup_ts_ = 0;
   QuicError last_error_;
   Packet* conn_closebuf_;
   BaseObjectPtr<LogStream> qlog_stream_;
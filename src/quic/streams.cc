@@ -325,6 +325,12 @@ class Stream::Outbound final : public MemoryRetainer {
            size_t count,
            size_t max_count_hint) {
     if (next_pending_) {
+      // A read (possibly a prefetch) is still in flight but whatever it
+      // has already delivered can be sent in the meantime.
+      if (uncommitted_ > 0) {
+        PullUncommitted(std::move(next));
+        return bob::Status::STATUS_CONTINUE;
+      }
       std::move(next)(bob::Status::STATUS_BLOCK, nullptr, 0, [](int) {});
       return bob::Status::STATUS_BLOCK;
     }
@@ -351,6 +357,7 @@ class Stream::Outbound final : public MemoryRetainer {
     // the queue.
     if (uncommitted_ >= kDefaultMaxPacketLength) {
       PullUncommitted(std::move(next));
+      MaybePrefetch();
       return bob::Status::STATUS_CONTINUE;
     }
 
@@ -360,69 +367,7 @@ class Stream::Outbound final : public MemoryRetainer {
     // At this point, we know our reader hasn't finished yet, there might be
     // uncommitted bytes but we want to go ahead and pull some more. We request
     // that the pull is sync but allow for it to be async.
-    int ret = reader_->Pull(
-        [this](auto status, auto vecs, auto count, auto done) {
-          // Always make sure next_pending_ is false when we're done.
-          auto on_exit = OnScopeLeave([this] { next_pending_ = false; });
-
-          // The status should never be wait here.
-          DCHECK_NE(status, bob::Status::STATUS_WAIT);
-
-          if (status < 0) {
-            // If next_pending_ is true then a pull from the reader ended up
-            // being asynchronous, our stream is blocking waiting for the data,
-            // but we have an error! oh no! We need to error the stream.
-            if (next_pending_) {
-              stream_->Destroy(
-                  QuicError::ForNgtcp2Error(NGTCP2_INTERNAL_ERROR));
-              // We do not need to worry about calling MarkErrored in this case
-              // since we are immediately destroying the stream which will
-              // release the outbound buffer anyway.
-            }
-            return;
-          }
-
-          if (status == bob::Status::STATUS_EOS) {
-            DCHECK_EQ(count, 0);
-            DCHECK_NULL(vecs);
-            MarkEnded();
-            // If next_pending_ is true then a pull from the reader ended up
-            // being asynchronous, our stream is blocking waiting for the data.
-            // Here, there is no more data to read, but we will might have data
-            // in the uncommitted queue. We'll resume the stream so that the
-            // session will try to read from it again.
-            if (next_pending_ && !stream_->is_destroyed()) {
-              stream_->session().ResumeStream(stream_->id());
-            }
-            return;
-          }
-
-          if (status == bob::Status::STATUS_BLOCK) {
-            DCHECK_EQ(count, 0);
-            DCHECK_NULL(vecs);
-            // If next_pending_ is true then a pull from the reader ended up
-            // being asynchronous, our stream is blocking waiting for the data.
-            // Here, we're still blocking! so there's nothing left for us to do!
-            return;
-          }
-
-          DCHECK_EQ(status, bob::Status::STATUS_CONTINUE);
-          // If the read returns bytes, those will be added to the uncommitted
-          // bytes in the queue.
-          Append(vecs, count, std::move(done));
-
-          // If next_pending_ is true, then a pull from the reader ended up
-          // being asynchronous, our stream is blocking waiting for the data.
-          // Now that we have data, let's resume the stream so the session will
-          // pull from it again.
-          if (next_pending_ && !stream_->is_destroyed()) {
-            stream_->session().ResumeStream(stream_->id());
-          }
-        },
-        bob::OPTIONS_SYNC,
-        nullptr,
-        0,
-        kMaxVectorCount);
+    int ret = PullFromReader();
 
     // There was an error. We'll report that immediately. We do not have
     // to destroy the stream here since that will be taken care of by
@@ -475,12 +420,14 @@ class Stream::Outbound final : public MemoryRetainer {
     // until the data is actually available.
     if (ret == bob::Status::STATUS_WAIT) {
       next_pending_ = true;
+      async_reader_ = true;
       std::move(next)(bob::Status::STATUS_BLOCK, nullptr, 0, [](int) {});
       return bob::Status::STATUS_BLOCK;
     }
 
     DCHECK_EQ(ret, bob::Status::STATUS_CONTINUE);
     PullUncommitted(std::move(next));
+    MaybePrefetch();
     return bob::Status::STATUS_CONTINUE;
   }
 
@@ -500,6 +447,99 @@ class Stream::Outbound final : public MemoryRetainer {
     ~OnComplete() { std::move(done)(0); }
   };
 
+  // Starts a read from reader_. The data it provides, synchronously or not,
+  // is appended to the uncommitted queue.
+  int PullFromReader() {
+    return reader_->Pull(
+        [this](auto status, auto vecs, auto count, auto done) {
+          // Always make sure next_pending_ is false when we're done.
+          auto on_exit = OnScopeLeave([this] { next_pending_ = false; });
+
+          // The status should never be wait here.
+          DCHECK_NE(status, bob::Status::STATUS_WAIT);
+
+          if (status < 0) {
+            // If next_pending_ is true then a pull from the reader ended up
+            // being asynchronous, our stream is blocking waiting for the data,
+            // but we have an error! oh no! We need to error the stream.
+            if (next_pending_) {
+              stream_->Destroy(
+                  QuicError::ForNgtcp2Error(NGTCP2_INTERNAL_ERROR));
+              // We do not need to worry about calling MarkErrored in this case
+              // since we are immediately destroying the stream which will
+              // release the outbound buffer anyway.
+            }
+            return;
+          }
+
+          if (status == bob::Status::STATUS_EOS) {
+            DCHECK_EQ(count, 0);
+            DCHECK_NULL(vecs);
+            MarkEnded();
+            // If next_pending_ is true then a pull from the reader ended up
+            // being asynchronous, our stream is blocking waiting for the data.
+            // Here, there is no more data to read, but we will might have data
+            // in the uncommitted queue. We'll resume the stream so that the
+            // session will try to read from it again.
+            if (next_pending_ && !stream_->is_destroyed()) {
+              stream_->session().ResumeStream(stream_->id());
+            }
+            return;
+          }
+
+          if (status == bob::Status::STATUS_BLOCK) {
+            DCHECK_EQ(count, 0);
+            DCHECK_NULL(vecs);
+            // If next_pending_ is true then a pull from the reader ended up
+            // being asynchronous, our stream is blocking waiting for the data.
+            // Here, we're still blocking! so there's nothing left for us to do!
+            return;
+          }
+
+          DCHECK_EQ(status, bob::Status::STATUS_CONTINUE);
+          // If the read returns bytes, those will be added to the uncommitted
+          // bytes in the queue.
+          Append(vecs, count, std::move(done));
+
+          // If next_pending_ is true, then a pull from the reader ended up
+          // being asynchronous, our stream is blocking waiting for the data.
+          // Now that we have data, let's resume the stream so the session will
+          // pull from it again.
+          if (next_pending_ && !stream_->is_destroyed()) {
+            stream_->session().ResumeStream(stream_->id());
+          }
+        },
+        bob::OPTIONS_SYNC,
+        nullptr,
+        0,
+        kMaxVectorCount);
+  }
+
+  // For readers that deliver asynchronously (such as FdEntry), keep one read
+  // in flight ahead of the stream so that it does not stall for a file read
+  // on every pull. The read-ahead is bounded by the stream's remaining flow
+  // control credit, so memory use follows the window rather than the size
+  // of the source. The buffers are handed to ngtcp2 as they come out of the
+  // reader; nothing is copied on the way to the packet.
+  void MaybePrefetch() {
+    if (!async_reader_ || next_pending_ || eos_ || errored_) return;
+    if (stream_->is_destroyed() || stream_->id() < 0) return;
+    uint64_t window = std::min<uint64_t>(
+        kMaxPrefetch,
+        ngtcp2_conn_get_max_stream_data_left(stream_->session(),
+                                             stream_->id()));
+    if (uncommitted_ >= window) return;
+
+    int ret = PullFromReader();
+    if (ret == bob::Status::STATUS_WAIT) {
+      next_pending_ = true;
+    } else if (ret < 0) {
+      MarkErrored();
+    } else if (ret == bob::Status::STATUS_EOS) {
+      MarkEnded();
+    }
+  }
+
   void PullUncommitted(bob::Next<ngtcp2_vec> next) {
     MaybeStackBuffer<ngtcp2_vec, 16> chunks;
     chunks.AllocateSufficientStorage(count_);
@@ -572,6 +612,13 @@ class Stream::Outbound final : public MemoryRetainer {
   // Will be set to true once reader_ has returned eos.
   bool eos_ = false;
 
+  // Will be set to true once reader_ has provided a pull result
+  // asynchronously. Only such readers are prefetched from.
+  bool async_reader_ = false;
+
+  // The most that MaybePrefetch will read ahead of the stream.
+  static constexpr uint64_t kMaxPrefetch = 256 * 1024;
+
   // The collection of buffers that we have pulled from reader_ and that we
   // are holding onto until they are acknowledged.
   struct Entry {
@@ -12,10 +12,15 @@
 #include <ngtcp2/ngtcp2_crypto_quictls.h>
 #include <node_sockaddr-inl.h>
 #include <openssl/ssl.h>
+#if OPENSSL_VERSION_MAJOR >= 3
+#include <openssl/core_names.h>
+#endif
 #include <v8.h>
 #include "bindingdata.h"
 #include "defs.h"
+#include "ncrypto.h"
 #include "session.h"
+#include "tokens.h"
 #include "transportparams.h"
 
 namespace node {
@@ -151,18 +156,71 @@ std::shared_ptr<TLSContext> TLSContext::CreateClient(const Options& options) {
   return std::make_shared<TLSContext>(Side::CLIENT, options);
 }
 
-std::shared_ptr<TLSContext> TLSContext::CreateServer(const Options& options) {
-  return std::make_shared<TLSContext>(Side::SERVER, options);
+std::shared_ptr<TLSContext> TLSContext::CreateServer(
+    const Options& options, const ResumptionGroup* resumption_group) {
+  return std::make_shared<TLSContext>(Side::SERVER, options, resumption_group);
 }
 
-TLSContext::TLSContext(Side side, const Options& options)
-    : side_(side), options_(options), ctx_(Initialize()) {}
+TLSContext::TLSContext(Side side,
+                       const Options& options,
+                       const ResumptionGroup* resumption_group)
+    : side_(side),
+      options_(options),
+      resumption_group_(resumption_group),
+      ctx_(Initialize()) {}
 
 TLSContext::operator SSL_CTX*() const {
   DCHECK(ctx_);
   return ctx_.get();
 }
 
+#if OPENSSL_VERSION_MAJOR >= 3
+int TLSContext::OnTicketKey(SSL* ssl,
+                            unsigned char* key_name,
+                            unsigned char* iv,
+                            EVP_CIPHER_CTX* ctx,
+                            EVP_MAC_CTX* hctx,
+                            int enc) {
+  auto group = static_cast<const ResumptionGroup*>(
+      SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  DCHECK_NOT_NULL(group);
+
+  const auto init = [&](ResumptionGroup::TicketKey& key) {
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(
+            OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key)),
+        OSSL_PARAM_construct_utf8_string(
+            OSSL_MAC_PARAM_DIGEST, const_cast<char*>("sha256"), 0),
+        OSSL_PARAM_construct_end(),
+    };
+    bool ok = EVP_MAC_CTX_set_params(hctx, params) == 1 &&
+              EVP_CipherInit_ex(
+                  ctx, EVP_aes_256_cbc(), nullptr, key.aes_key, iv, enc) == 1;
+    OPENSSL_cleanse(&key, sizeof(key));
+    return ok;
+  };
+
+  uint64_t epoch = ResumptionGroup::CurrentEpoch();
+  if (enc) {
+    auto key = group->ticket_key(epoch);
+    memcpy(key_name, key.name, sizeof(key.name));
+    if (!ncrypto::CSPRNG(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())))
+      return -1;
+    return init(key) ? 1 : -1;
+  }
+
+  // Tickets issued during the previous epoch are still accepted, but the
+  // client is handed a fresh one.
+  for (uint64_t age = 0; age < 2 && age <= epoch; age++) {
+    auto key = group->ticket_key(epoch - age);
+    if (memcmp(key_name, key.name, sizeof(key.name)) != 0) continue;
+    if (!init(key)) return -1;
+    return age == 0 ? 1 : 2;
+  }
+  return 0;
+}
+#endif
+
 int TLSContext::OnSelectAlpn(SSL* ssl,
                              const unsigned char** out,
                              unsigned char* outlen,
@@ -273,6 +331,15 @@ crypto::SSLCtxPointer TLSContext::Initialize() {
                                              SessionTicket::DecryptedCallback,
                                              nullptr),
                1);
+
+#if OPENSSL_VERSION_MAJOR >= 3
+      if (resumption_group_ != nullptr) {
+        SSL_CTX_set_app_data(ctx.get(),
+                             const_cast<ResumptionGroup*>(resumption_group_));
+        CHECK_EQ(SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx.get(), OnTicketKey),
+                 1);
+      }
+#endif
       break;
     }
     case Side::CLIENT: {
@@ -16,6 +16,7 @@
 namespace node {
 namespace quic {
 
+class ResumptionGroup;
 class Session;
 class TLSContext;
 
@@ -175,9 +176,15 @@ class TLSContext final : public MemoryRetainer,
   };
 
   static std::shared_ptr<TLSContext> CreateClient(const Options& options);
-  static std::shared_ptr<TLSContext> CreateServer(const Options& options);
-
-  TLSContext(Side side, const Options& options);
+  // When a ResumptionGroup is given, session tickets are encrypted with the
+  // group's ticket keys instead of keys private to this context.
+  static std::shared_ptr<TLSContext> CreateServer(
+      const Options& options,
+      const ResumptionGroup* resumption_group = nullptr);
+
+  TLSContext(Side side,
+             const Options& options,
+             const ResumptionGroup* resumption_group = nullptr);
   DISALLOW_COPY_AND_MOVE(TLSContext)
 
   // Each QUIC Session has exactly one TLSSession. Each TLSSession maintains
@@ -210,9 +217,18 @@ class TLSContext final : public MemoryRetainer,
                           unsigned int inlen,
                           void* arg);
   static int OnVerifyClientCertificate(int preverify_ok, X509_STORE_CTX* ctx);
+#if OPENSSL_VERSION_MAJOR >= 3
+  static int OnTicketKey(SSL* ssl,
+                         unsigned char* key_name,
+                         unsigned char* iv,
+                         EVP_CIPHER_CTX* ctx,
+                         EVP_MAC_CTX* hctx,
+                         int enc);
+#endif
 
   Side side_;
   Options options_;
+  const ResumptionGroup* resumption_group_;
   crypto::X509Pointer cert_;
   crypto::X509Pointer issuer_;
   crypto::SSLCtxPointer ctx_;
@@ -5,11 +5,24 @@
 #include <ngtcp2/ngtcp2_crypto.h>
 #include <node_sockaddr-inl.h>
 #include <string_bytes.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <util-inl.h>
 #include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <unordered_map>
 #include "nbytes.h"
 #include "ncrypto.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
 namespace node {
 namespace quic {
 
@@ -57,6 +70,175 @@ std::string TokenSecret::ToString() const {
   return std::string(dest, written);
 }
 
+// ============================================================================
+// ResumptionGroup
+
+namespace {
+#ifndef _WIN32
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory segments need address-free atomics");
+
+struct SharedSecretSegment {
+  std::atomic<uint32_t> ready;
+  uint8_t secret[ResumptionGroup::kSecretLength];
+};
+
+// The creator fills in the secret and then sets ready. Everyone else waits
+// (briefly) for that to happen. Every key of the group is derived from the
+// secret, so an existing segment is only used if it belongs to this user and
+// nobody else can access it; otherwise another local user could create the
+// segment first and choose the secret.
+bool LoadSharedSecret(const std::string& name, uint8_t* secret) {
+  static constexpr int kMaxWaitMs = 1000;
+  std::string shm_name = "/node-quic-" + name;
+  bool creator = true;
+  int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1) {
+    if (errno != EEXIST) return false;
+    creator = false;
+    fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+    if (fd == -1) return false;
+  }
+
+  if (creator) {
+    if (ftruncate(fd, sizeof(SharedSecretSegment)) != 0) {
+      close(fd);
+      shm_unlink(shm_name.c_str());
+      return false;
+    }
+  } else {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_uid != geteuid() ||
+        (st.st_mode & 077) != 0) {
+      close(fd);
+      return false;
+    }
+    // Another process may not have sized the segment yet.
+    for (int n = 0;; n++) {
+      if (fstat(fd, &st) != 0 || n == kMaxWaitMs) {
+        close(fd);
+        return false;
+      }
+      if (static_cast<size_t>(st.st_size) >= sizeof(SharedSecretSegment))
+        break;
+      usleep(1000);
+    }
+  }
+
+  void* addr = mmap(nullptr,
+                    sizeof(SharedSecretSegment),
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    fd,
+                    0);
+  close(fd);
+  if (addr == MAP_FAILED) return false;
+  auto segment = static_cast<SharedSecretSegment*>(addr);
+
+  bool ready = true;
+  if (creator) {
+    CHECK(ncrypto::CSPRNG(segment->secret, ResumptionGroup::kSecretLength));
+    segment->ready.store(1, std::memory_order_release);
+  } else {
+    for (int n = 0; segment->ready.load(std::memory_order_acquire) == 0; n++) {
+      if (n == kMaxWaitMs) {
+        ready = false;
+        break;
+      }
+      usleep(1000);
+    }
+  }
+  if (ready) memcpy(secret, segment->secret, ResumptionGroup::kSecretLength);
+  munmap(addr, sizeof(SharedSecretSegment));
+  return ready;
+}
+#endif  // _WIN32
+
+struct ResumptionGroups final {
+  static ResumptionGroups& Get() {
+    return LeakedSingleton<ResumptionGroups>::Get();
+  }
+
+  Mutex mutex;
+  std::unordered_map<std::string, std::unique_ptr<ResumptionGroup>> groups;
+};
+}  // namespace
+
+const ResumptionGroup* ResumptionGroup::Get(const std::string& name,
+                                            bool shared) {
+  auto& registry = ResumptionGroups::Get();
+  Mutex::ScopedLock lock(registry.mutex);
+  std::string key = (shared ? "shm:" : "local:") + name;
+  auto it = registry.groups.find(key);
+  if (it != registry.groups.end()) return it->second.get();
+
+  uint8_t secret[kSecretLength];
+  if (shared) {
+#ifndef _WIN32
+    if (!LoadSharedSecret(name, secret)) return nullptr;
+#else
+    return nullptr;
+#endif
+  } else {
+    CHECK(ncrypto::CSPRNG(secret, kSecretLength));
+  }
+  auto group = std::make_unique<ResumptionGroup>(secret);
+  memset(secret, 0, kSecretLength);
+  return registry.groups.emplace(key, std::move(group)).first->second.get();
+}
+
+uint64_t ResumptionGroup::CurrentEpoch() {
+  return static_cast<uint64_t>(time(nullptr)) / kTicketKeyLifetime;
+}
+
+ResumptionGroup::ResumptionGroup(const uint8_t* secret)
+    : token_secret_(DerivedSecret(secret, "quic token").data),
+      reset_token_secret_(DerivedSecret(secret, "quic stateless reset").data) {
+  memcpy(secret_, secret, kSecretLength);
+}
+
+ResumptionGroup::~ResumptionGroup() {
+  memset(secret_, 0, kSecretLength);
+}
+
+void ResumptionGroup::Derive(const uint8_t* secret,
+                             const char* label,
+                             uint64_t epoch,
+                             uint8_t* out) {
+  std::string input(label);
+  for (int n = 7; n >= 0; n--) {
+    input += static_cast<char>((epoch >> (n * 8)) & 0xff);
+  }
+  unsigned int len = kSecretLength;
+  CHECK_NOT_NULL(HMAC(EVP_sha256(),
+                      secret,
+                      kSecretLength,
+                      reinterpret_cast<const unsigned char*>(input.data()),
+                      input.length(),
+                      out,
+                      &len));
+  CHECK_EQ(len, kSecretLength);
+}
+
+ResumptionGroup::DerivedSecret::DerivedSecret(const uint8_t* secret,
+                                              const char* label) {
+  Derive(secret, label, 0, data);
+}
+
+ResumptionGroup::DerivedSecret::~DerivedSecret() {
+  memset(data, 0, kSecretLength);
+}
+
+ResumptionGroup::TicketKey ResumptionGroup::ticket_key(uint64_t epoch) const {
+  TicketKey key;
+  uint8_t name[kSecretLength];
+  Derive(secret_, "quic ticket name", epoch, name);
+  memcpy(key.name, name, sizeof(key.name));
+  Derive(secret_, "quic ticket aes", epoch, key.aes_key);
+  Derive(secret_, "quic ticket hmac", epoch, key.hmac_key);
+  return key;
+}
+
 // ============================================================================
 // StatelessResetToken
 
@@ -52,6 +52,68 @@ class TokenSecret final : public MemoryRetainer {
   uint8_t buf_[QUIC_TOKENSECRET_LEN];
 };
 
+// A ResumptionGroup is a named, process-wide master secret from which the
+// token secrets and the TLS session ticket keys of every Endpoint that joins
+// the group are derived. Endpoints in the same group (for instance one per
+// worker thread) accept each other's retry and regular tokens, stateless
+// resets and session tickets, so resumption and 0-RTT work no matter which
+// of them receives the client's first packet.
+//
+// When shared is true the master secret lives in a POSIX shared memory
+// segment named after the group, so that separate processes (such as the
+// workers of a cluster) join the same group. The segment is created by the
+// first process to join, and is only joined by processes of the same user.
+// It intentionally outlives the processes, so that a restarted worker still
+// accepts the tickets and tokens issued before the restart, and stays in
+// /dev/shm until it is removed or the machine reboots. To rotate the master
+// secret, remove /dev/shm/node-quic-<name> (or switch to a new group name)
+// and restart every process of the group.
+//
+// Ticket keys rotate every kTicketKeyLifetime seconds. Because they are
+// derived from the master secret and the epoch, the members of a group
+// rotate in lockstep without talking to each other.
+class ResumptionGroup final {
+ public:
+  static constexpr size_t kSecretLength = 32;
+  static constexpr uint64_t kTicketKeyLifetime = 12 * 60 * 60;
+
+  struct TicketKey final {
+    uint8_t name[16];
+    uint8_t aes_key[32];
+    uint8_t hmac_key[32];
+  };
+
+  // Returns nullptr if the shared memory segment could not be opened.
+  // Groups live for the rest of the process.
+  static const ResumptionGroup* Get(const std::string& name, bool shared);
+
+  static uint64_t CurrentEpoch();
+
+  const TokenSecret& token_secret() const { return token_secret_; }
+  const TokenSecret& reset_token_secret() const { return reset_token_secret_; }
+  TicketKey ticket_key(uint64_t epoch) const;
+
+  explicit ResumptionGroup(const uint8_t* secret);
+  ~ResumptionGroup();
+  DISALLOW_COPY_AND_MOVE(ResumptionGroup)
+
+ private:
+  static void Derive(const uint8_t* secret,
+                     const char* label,
+                     uint64_t epoch,
+                     uint8_t* out);
+
+  struct DerivedSecret final {
+    DerivedSecret(const uint8_t* secret, const char* label);
+    ~DerivedSecret();
+    uint8_t data[kSecretLength];
+  };
+
+  uint8_t secret_[kSecretLength];
+  TokenSecret token_secret_;
+  TokenSecret reset_token_secret_;
+};
+
 // A stateless reset token is used when a QUIC endpoint receives a QUIC packet
 // with a short header but the associated connection ID cannot be matched to any
 // known Session. In such cases, the receiver may choose to send a subtle opaque
@@ -0,0 +1,36 @@
+#include "request_object_pool.h"
+#include "base_object.h"
+#include "env-inl.h"
+
+namespace node {
+
+using v8::Local;
+using v8::MaybeLocal;
+using v8::Object;
+using v8::ObjectTemplate;
+
+MaybeLocal<Object> RequestObjectPool::Get(Environment* env,
+                                          Local<ObjectTemplate> tmpl) {
+  while (!objects_.empty()) {
+    Local<Object> object = objects_.back().Get(env->isolate());
+    objects_.pop_back();
+    // A wrap that is still referenced from elsewhere outlives Dispose(). Its
+    // object is dropped rather than waited for.
+    if (object->GetAlignedPointerFromInternalField(BaseObject::kSlot) ==
+        nullptr) {
+      return object;
+    }
+  }
+  return tmpl->NewInstance(env->context());
+}
+
+void RequestObjectPool::Put(Environment* env, Local<Object> object) {
+  if (objects_.size() >= env->options()->request_object_pool_size ||
+      !env->can_call_into_js() ||
+      env->async_hooks()->fields()[AsyncHooks::kInit] > 0) {
+    return;
+  }
+  objects_.emplace_back(env->isolate(), object);
+}
+
+}  // namespace node
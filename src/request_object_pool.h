@@ -0,0 +1,49 @@
+#ifndef SRC_REQUEST_OBJECT_POOL_H_
+#define SRC_REQUEST_OBJECT_POOL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "v8.h"
+
+#include <vector>
+
+namespace node {
+
+class Environment;
+
+// A free list of the JavaScript objects behind request wraps that C++
+// creates for itself, such as the WriteWrap of an internal stream write or
+// the FSReqPromise of a promise-based fs call. Those objects are never
+// handed to JavaScript, so they can back the next request of the same kind
+// once their wrap is gone, instead of feeding the scavenger one object per
+// request. The wraps built on them are new each time, so they still get
+// fresh async ids.
+//
+// The pool holds at most --request-object-pool-size objects per
+// Environment.
+class RequestObjectPool {
+ public:
+  RequestObjectPool() = default;
+  RequestObjectPool(const RequestObjectPool&) = delete;
+  RequestObjectPool& operator=(const RequestObjectPool&) = delete;
+
+  // Returns a pooled object that no wrap is attached to anymore, or a new
+  // instance of |tmpl|.
+  v8::MaybeLocal<v8::Object> Get(Environment* env,
+                                 v8::Local<v8::ObjectTemplate> tmpl);
+  // Keeps |object| for reuse, once the wrap attached to it is gone. Objects
+  // are not kept while async_hooks init hooks are enabled, because those
+  // may hold on to the resource.
+  void Put(Environment* env, v8::Local<v8::Object> object);
+
+  size_t size() const { return objects_.size(); }
+
+ private:
+  std::vector<v8::Global<v8::Object>> objects_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_REQUEST_OBJECT_POOL_H_
@@ -0,0 +1,423 @@
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "handle_wrap.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "spsc_ring.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <new>
+#include <string>
+
+// A message channel between two processes that share a memory segment.
+//
+// The segment holds one SPSCRing (see spsc_ring.h) per direction.
+// Messages are written with v8::ValueSerializer, the same wire format that
+// MessagePort uses, and deserialized straight out of the shared ring, so a
+// message never passes through the kernel. The only system calls are on a
+// FIFO per direction that is used as a doorbell, and only when the reader
+// has drained its ring and gone to sleep.
+//
+// The side that creates the channel writes ring 0 and reads ring 1; the side
+// that opens it does the opposite. Messages that do not fit, or that arrive
+// while the ring is full, are rejected so that the caller can fall back to
+// the regular IPC pipe.
+
+namespace node {
+
+using errors::TryCatchScope;
+using v8::Array;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Undefined;
+using v8::Value;
+using v8::ValueDeserializer;
+using v8::ValueSerializer;
+
+namespace {
+
+#ifndef _WIN32
+constexpr uint32_t kShmChannelMagic = 0x6e6f6465;  // "node"
+constexpr uint32_t kShmChannelVersion = 1;
+constexpr size_t kMinRingSize = 4096;
+
+// The words an SPSCRing is constructed over. Only ever accessed atomically.
+struct RingHeader {
+  // Total bytes ever written and consumed. Kept on separate cache lines
+  // because they are written by different processes.
+  alignas(64) uint64_t head = 0;
+  alignas(64) uint64_t tail = 0;
+  // Set by the consumer before it sleeps; the producer rings the doorbell
+  // only when it finds this set.
+  alignas(64) int32_t consumer_waiting = 0;
+};
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+  RingHeader rings[2];
+};
+
+constexpr size_t kSegmentHeaderSize =
+    SPSCRing::AlignUp(sizeof(SegmentHeader), alignof(SegmentHeader));
+#endif  // _WIN32
+
+class ShmChannelWrap : public HandleWrap {
+ public:
+  static void Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv) {
+    Environment* env = Environment::GetCurrent(context);
+    Isolate* isolate = env->isolate();
+    Local<FunctionTemplate> constructor = NewFunctionTemplate(isolate, New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(
+        ShmChannelWrap::kInternalFieldCount);
+    constructor->Inherit(HandleWrap::GetConstructorTemplate(env));
+
+    SetProtoMethod(isolate, constructor, "start", Start);
+    SetProtoMethod(isolate, constructor, "stop", Stop);
+    SetProtoMethod(isolate, constructor, "post", Post);
+
+    SetConstructorFunction(context, target, "ShmChannel", constructor);
+  }
+
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+    registry->Register(New);
+    registry->Register(Start);
+    registry->Register(Stop);
+    registry->Register(Post);
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(ShmChannelWrap)
+  SET_SELF_SIZE(ShmChannelWrap)
+
+  ~ShmChannelWrap() override {
+#ifndef _WIN32
+    if (segment_ != nullptr) munmap(segment_, segment_size_);
+    if (read_fd_ != -1) close(read_fd_);
+    if (write_fd_ != -1) close(write_fd_);
+    Unlink();
+#endif
+  }
+
+ private:
+  // new ShmChannel(name, doorbellPath, ringSize, create, ctx)
+  //
+  // |name| is the shm_open() name of the segment and |doorbellPath| the
+  // prefix of the two FIFOs. The creating side makes both; the opening side
+  // removes the names again once it is attached, so nothing is left behind.
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    CHECK(args.IsConstructCall());
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsString());
+    CHECK(args[1]->IsString());
+    CHECK(args[2]->IsUint32());
+    Utf8Value name(env->isolate(), args[0]);
+    Utf8Value doorbell(env->isolate(), args[1]);
+    size_t ring_size = args[2].As<v8::Uint32>()->Value();
+    bool create = args[3]->IsTrue();
+
+    int err = 0;
+    new ShmChannelWrap(
+        env, args.This(), *name, *doorbell, ring_size, create, &err);
+    if (err != 0) {
+      env->CollectUVExceptionInfo(args[4], err, "shm_open");
+      args.GetReturnValue().SetUndefined();
+    }
+  }
+
+  ShmChannelWrap(Environment* env,
+                 Local<Object> object,
+                 const std::string& name,
+                 const std::string& doorbell,
+                 size_t ring_size,
+                 bool create,
+                 int* init_err)
+      : HandleWrap(env,
+                   object,
+                   reinterpret_cast<uv_handle_t*>(&handle_),
+                   AsyncWrap::PROVIDER_SHMCHANNELWRAP),
+        side_(create ? 0 : 1) {
+#ifdef _WIN32
+    *init_err = UV_ENOTSUP;
+#else
+    name_ = name;
+    doorbell_paths_[0] = doorbell + "-0";
+    doorbell_paths_[1] = doorbell + "-1";
+    *init_err = create ? CreateSegment(ring_size) : OpenSegment();
+    if (*init_err == 0) *init_err = OpenDoorbells();
+    if (*init_err == 0)
+      *init_err = uv_poll_init(env->event_loop(), &handle_, read_fd_);
+    if (*init_err == 0 && !create) {
+      owns_names_ = true;
+      Unlink();
+    }
+#endif
+    if (*init_err != 0) MarkAsUninitialized();
+  }
+
+#ifndef _WIN32
+  int CreateSegment(size_t ring_size) {
+    ring_size = SPSCRing::AlignUp(std::max(ring_size, kMinRingSize),
+                                  SPSCRing::kRecordAlignment);
+    segment_size_ = kSegmentHeaderSize + 2 * ring_size;
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) return uv_translate_sys_error(errno);
+    owns_names_ = true;
+    int err = 0;
+    if (ftruncate(fd, segment_size_) != 0) err = uv_translate_sys_error(errno);
+    if (err == 0) err = Map(fd);
+    close(fd);
+    if (err != 0) return err;
+
+    SegmentHeader* header = new (segment_) SegmentHeader();
+    header->ring_size = ring_size;
+    header->version = kShmChannelVersion;
+    header->magic = kShmChannelMagic;
+
+    for (const std::string& path : doorbell_paths_) {
+      if (mkfifo(path.c_str(), 0600) != 0) return uv_translate_sys_error(errno);
+    }
+    return 0;
+  }
+
+  int OpenSegment() {
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd == -1) return uv_translate_sys_error(errno);
+    struct stat st;
+    int err = 0;
+    if (fstat(fd, &st) != 0) err = uv_translate_sys_error(errno);
+    if (err == 0 && static_cast<size_t>(st.st_size) < kSegmentHeaderSize)
+      err = UV_EINVAL;
+    if (err == 0) {
+      segment_size_ = st.st_size;
+      err = Map(fd);
+    }
+    close(fd);
+    if (err != 0) return err;
+
+    const SegmentHeader* header = this->header();
+    if (header->magic != kShmChannelMagic ||
+        header->version != kShmChannelVersion ||
+        header->ring_size % SPSCRing::kRecordAlignment != 0 ||
+        header->ring_size > (segment_size_ - kSegmentHeaderSize) / 2) {
+      return UV_EINVAL;
+    }
+    return 0;
+  }
+
+  int Map(int fd) {
+    void* addr = mmap(nullptr,
+                      segment_size_,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED,
+                      fd,
+                      0);
+    if (addr == MAP_FAILED) return uv_translate_sys_error(errno);
+    segment_ = addr;
+    return 0;
+  }
+
+  // The FIFO with index k is rung when ring k has new data. Both ends are
+  // opened O_RDWR: opening the write end then never fails with ENXIO before
+  // the peer has attached, and the read end never reports EOF while it is
+  // away. Whether the peer is still alive is left to the caller.
+  int OpenDoorbells() {
+    read_fd_ = open(doorbell_paths_[1 - side_].c_str(),
+                    O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd_ == -1) return uv_translate_sys_error(errno);
+    write_fd_ = open(doorbell_paths_[side_].c_str(),
+                     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (write_fd_ == -1) return uv_translate_sys_error(errno);
+    return 0;
+  }
+
+  void Unlink() {
+    if (!owns_names_) return;
+    shm_unlink(name_.c_str());
+    for (const std::string& path : doorbell_paths_) unlink(path.c_str());
+    owns_names_ = false;
+  }
+
+  SegmentHeader* header() const {
+    return static_cast<SegmentHeader*>(segment_);
+  }
+
+  char* ring_data(int ring) const {
+    return static_cast<char*>(segment_) + kSegmentHeaderSize +
+           ring * header()->ring_size;
+  }
+
+  SPSCRing ring(int side) const {
+    RingHeader* ring = &header()->rings[side];
+    return SPSCRing(&ring->head,
+                    &ring->tail,
+                    &ring->consumer_waiting,
+                    ring_data(side),
+                    header()->ring_size);
+  }
+
+  int Write(const uint8_t* data, size_t length) {
+    bool wake;
+    const int err = ring(side_).Write(data, length, &wake);
+    if (wake) {
+      ssize_t r;
+      do {
+        r = write(write_fd_, "", 1);
+      } while (r == -1 && errno == EINTR);
+      // EAGAIN means the FIFO is full, so the reader will wake up anyway.
+    }
+    return err;
+  }
+
+  // Deserializes everything in the incoming ring into |messages|. Returns 0,
+  // or an error if the peer wrote something that does not parse.
+  int Drain(Local<Array> messages) {
+    Environment* env = this->env();
+    Local<Context> context = env->context();
+    SPSCRing ring = this->ring(1 - side_);
+    uint32_t count = 0;
+
+    for (;;) {
+      const char* payload;
+      const int32_t length = ring.Peek(&payload);
+      if (length == SPSCRing::kEmpty) break;
+      if (length < 0) return length;
+
+      ValueDeserializer deserializer(
+          env->isolate(), reinterpret_cast<const uint8_t*>(payload), length);
+      Local<Value> value;
+      if (deserializer.ReadHeader(context).IsNothing() ||
+          !deserializer.ReadValue(context).ToLocal(&value) ||
+          messages->Set(context, count++, value).IsNothing()) {
+        return UV_EPROTO;
+      }
+      ring.Consume(length);
+    }
+    return 0;
+  }
+
+  // onmessage(status, messages)
+  void OnDoorbell(int status) {
+    Environment* env = this->env();
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+
+    if (status == 0) {
+      char scratch[64];
+      ssize_t r;
+      do {
+        r = read(read_fd_, scratch, sizeof(scratch));
+      } while (r > 0 || (r == -1 && errno == EINTR));
+    }
+
+    Local<Array> messages = Array::New(env->isolate());
+    if (status == 0) {
+      TryCatchScope try_catch(env);
+      status = Drain(messages);
+    }
+    // Spurious wakeups, e.g. from the immediate in Start(), stay silent.
+    if (status == 0 && messages->Length() == 0) return;
+
+    Local<Value> argv[] = {
+        Integer::New(env->isolate(), status),
+        status == 0 ? messages.As<Value>()
+                    : Undefined(env->isolate()).As<Value>()};
+    MakeCallback(env->onmessage_string(), arraysize(argv), argv);
+  }
+#endif  // _WIN32
+
+  static void Start(const FunctionCallbackInfo<Value>& args) {
+    ShmChannelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+#ifdef _WIN32
+    int err = UV_ENOTSUP;
+#else
+    int err = uv_poll_start(
+        &wrap->handle_, UV_READABLE, [](uv_poll_t* handle, int status, int) {
+          ShmChannelWrap* wrap = ContainerOf(&ShmChannelWrap::handle_, handle);
+          wrap->OnDoorbell(status);
+        });
+    // Messages may have been posted before the poll was started, with
+    // nobody to ring for; pick those up on the next tick.
+    if (err == 0) {
+      BaseObjectPtr<ShmChannelWrap> strong_ref{wrap};
+      wrap->env()->SetImmediate([strong_ref](Environment* env) {
+        if (!strong_ref->IsHandleClosing()) strong_ref->OnDoorbell(0);
+      });
+    }
+#endif
+    args.GetReturnValue().Set(err);
+  }
+
+  static void Stop(const FunctionCallbackInfo<Value>& args) {
+    ShmChannelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+#ifdef _WIN32
+    int err = UV_ENOTSUP;
+#else
+    int err = uv_poll_stop(&wrap->handle_);
+#endif
+    args.GetReturnValue().Set(err);
+  }
+
+  // post(value) returns 0, UV_EAGAIN when the ring is full, or UV_ENOBUFS
+  // when the message is too large for it. Throws if |value| cannot be
+  // serialized.
+  static void Post(const FunctionCallbackInfo<Value>& args) {
+    ShmChannelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+#ifdef _WIN32
+    args.GetReturnValue().Set(UV_ENOTSUP);
+#else
+    if (wrap->IsHandleClosing())
+      return args.GetReturnValue().Set(UV_EBADF);
+    Environment* env = wrap->env();
+    ValueSerializer serializer(env->isolate());
+    serializer.WriteHeader();
+    if (serializer.WriteValue(env->context(), args[0]).IsNothing()) return;
+    std::pair<uint8_t*, size_t> data = serializer.Release();
+    int err = wrap->Write(data.first, data.second);
+    free(data.first);
+    args.GetReturnValue().Set(err);
+#endif
+  }
+
+  uv_poll_t handle_;
+  const int side_;
+#ifndef _WIN32
+  std::string name_;
+  std::string doorbell_paths_[2];
+  bool owns_names_ = false;
+  void* segment_ = nullptr;
+  size_t segment_size_ = 0;
+  int read_fd_ = -1;
+  int write_fd_ = -1;
+#endif
+};
+
+}  // anonymous namespace
+}  // namespace node
+
+NODE_BINDING_CONTEXT_AWARE_INTERNAL(shm_channel_wrap,
+                                    node::ShmChannelWrap::Initialize)
+NODE_BINDING_EXTERNAL_REFERENCE(
+    shm_channel_wrap, node::ShmChannelWrap::RegisterExternalReferences)
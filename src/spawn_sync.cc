@@ -27,6 +27,9 @@
 #include "string_bytes.h"
 #include "util-inl.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include "nbytes.h"
 
@@ -51,45 +54,57 @@ using v8::Object;
 using v8::String;
 using v8::Value;
 
-void SyncProcessOutputBuffer::OnAlloc(size_t suggested_size,
-                                      uv_buf_t* buf) const {
-  if (used() == kBufferSize)
-    *buf = uv_buf_init(nullptr, 0);
-  else
-    *buf = uv_buf_init(data_ + used(), available());
+SyncProcessOutputBuffer::~SyncProcessOutputBuffer() {
+  free(data_);
 }
 
 
-void SyncProcessOutputBuffer::OnRead(const uv_buf_t* buf, size_t nread) {
-  // If we hand out the same chunk twice, this should catch it.
-  CHECK_EQ(buf->base, data_ + used());
-  used_ += static_cast<unsigned int>(nread);
-}
-
-
-size_t SyncProcessOutputBuffer::Copy(char* dest) const {
-  if (dest != nullptr) memcpy(dest, data_, used());
-  return used();
-}
+void SyncProcessOutputBuffer::OnAlloc(size_t budget, uv_buf_t* buf) {
+  if (used_ == capacity_) {
+    size_t max_capacity = SIZE_MAX;
+    if (budget < SIZE_MAX - used_ - kInitialSize)
+      max_capacity = used_ + budget + kInitialSize;
+    size_t capacity =
+        std::min(std::max(capacity_ * 2, kInitialSize), max_capacity);
 
+    char* data = UncheckedRealloc(data_, capacity);
+    if (data == nullptr) {
+      // libuv reports an empty buffer as UV_ENOBUFS to the read callback.
+      *buf = uv_buf_init(nullptr, 0);
+      return;
+    }
+    data_ = data;
+    capacity_ = capacity;
+  }
 
-unsigned int SyncProcessOutputBuffer::available() const {
-  return sizeof data_ - used();
+  // Use unsigned int because that's what `uv_buf_init` takes.
+  size_t available = std::min<size_t>(capacity_ - used_, UINT_MAX);
+  *buf = uv_buf_init(data_ + used_, static_cast<unsigned int>(available));
 }
 
 
-unsigned int SyncProcessOutputBuffer::used() const {
-  return used_;
+void SyncProcessOutputBuffer::OnRead(const uv_buf_t* buf, size_t nread) {
+  // If we hand out the same chunk twice, this should catch it.
+  CHECK_EQ(buf->base, data_ + used_);
+  used_ += nread;
 }
 
 
-SyncProcessOutputBuffer* SyncProcessOutputBuffer::next() const {
-  return next_;
-}
+MaybeLocal<Object> SyncProcessOutputBuffer::Release(Environment* env) {
+  if (used_ == 0) return Buffer::New(env, 0);
 
+  // Give back the unused tail of the last growth, which realloc() usually
+  // does in place.
+  char* data = UncheckedRealloc(data_, used_);
+  if (data != nullptr) data_ = data;
 
-void SyncProcessOutputBuffer::set_next(SyncProcessOutputBuffer* next) {
-  next_ = next;
+  data = data_;
+  size_t length = used_;
+  data_ = nullptr;
+  capacity_ = 0;
+  used_ = 0;
+  // Takes ownership of |data|.
+  return Buffer::New(env, data, length);
 }
 
 
@@ -102,9 +117,6 @@ SyncProcessStdioPipe::SyncProcessStdioPipe(SyncProcessRunner* process_handler,
       writable_(writable),
       input_buffer_(input_buffer),
 
-      first_output_buffer_(nullptr),
-      last_output_buffer_(nullptr),
-
       uv_pipe_(),
       write_req_(),
       shutdown_req_(),
@@ -116,14 +128,6 @@ SyncProcessStdioPipe::SyncProcessStdioPipe(SyncProcessRunner* process_handler,
 
 SyncProcessStdioPipe::~SyncProcessStdioPipe() {
   CHECK(lifecycle_ == kUninitialized || lifecycle_ == kClosed);
-
-  SyncProcessOutputBuffer* buf;
-  SyncProcessOutputBuffer* next;
-
-  for (buf = first_output_buffer_; buf != nullptr; buf = next) {
-    next = buf->next();
-    delete buf;
-  }
 }
 
 
@@ -185,11 +189,8 @@ void SyncProcessStdioPipe::Close() {
 }
 
 
-Local<Object> SyncProcessStdioPipe::GetOutputAsBuffer(Environment* env) const {
-  size_t length = OutputLength();
-  Local<Object> js_buffer = Buffer::New(env, length).ToLocalChecked();
-  CopyOutput(Buffer::Data(js_buffer));
-  return js_buffer;
+Local<Object> SyncProcessStdioPipe::GetOutputAsBuffer(Environment* env) {
+  return output_buffer_.Release(env).ToLocalChecked();
 }
 
 
@@ -232,45 +233,12 @@ uv_handle_t* SyncProcessStdioPipe::uv_handle() const {
 }
 
 
-size_t SyncProcessStdioPipe::OutputLength() const {
-  SyncProcessOutputBuffer* buf;
-  size_t size = 0;
-
-  for (buf = first_output_buffer_; buf != nullptr; buf = buf->next())
-    size += buf->used();
-
-  return size;
-}
-
-
-void SyncProcessStdioPipe::CopyOutput(char* dest) const {
-  SyncProcessOutputBuffer* buf;
-  size_t offset = 0;
-
-  for (buf = first_output_buffer_; buf != nullptr; buf = buf->next())
-    offset += buf->Copy(dest + offset);
-}
-
-
 void SyncProcessStdioPipe::OnAlloc(size_t suggested_size, uv_buf_t* buf) {
   // This function assumes that libuv will never allocate two buffers for the
   // same stream at the same time. There's an assert in
   // SyncProcessOutputBuffer::OnRead that would fail if this assumption was
   // ever violated.
-
-  if (last_output_buffer_ == nullptr) {
-    // Allocate the first capture buffer.
-    first_output_buffer_ = new SyncProcessOutputBuffer();
-    last_output_buffer_ = first_output_buffer_;
-
-  } else if (last_output_buffer_->available() == 0) {
-    // The current capture buffer is full so get us a new one.
-    SyncProcessOutputBuffer* buf = new SyncProcessOutputBuffer();
-    last_output_buffer_->set_next(buf);
-    last_output_buffer_ = buf;
-  }
-
-  last_output_buffer_->OnAlloc(suggested_size, buf);
+  output_buffer_.OnAlloc(process_handler_->RemainingBufferSize(), buf);
 }
 
 
@@ -284,7 +252,7 @@ void SyncProcessStdioPipe::OnRead(const uv_buf_t* buf, ssize_t nread) {
     uv_read_stop(uv_stream());
 
   } else {
-    last_output_buffer_->OnRead(buf, nread);
+    output_buffer_.OnRead(buf, nread);
     process_handler_->IncrementBufferSizeAndCheckOverflow(nread);
   }
 }
@@ -645,6 +613,16 @@ void SyncProcessRunner::IncrementBufferSizeAndCheckOverflow(ssize_t length) {
 }
 
 
+size_t SyncProcessRunner::RemainingBufferSize() const {
+  if (max_buffer_ <= 0) return SIZE_MAX;
+
+  double remaining = max_buffer_ - buffered_output_size_;
+  if (remaining <= 0) return 0;
+  if (remaining >= static_cast<double>(SIZE_MAX)) return SIZE_MAX;
+  return static_cast<size_t>(remaining);
+}
+
+
 void SyncProcessRunner::OnExit(int64_t exit_status, int term_signal) {
   if (exit_status < 0)
     return SetError(static_cast<int>(exit_status));
@@ -36,29 +36,30 @@ class SyncProcessStdioPipe;
 class SyncProcessRunner;
 
 
+// Collects the output of a pipe in a single buffer that grows geometrically,
+// so that it can be handed to a Buffer at the end without being copied.
 class SyncProcessOutputBuffer {
-  static const unsigned int kBufferSize = 65536;
+  static const size_t kInitialSize = 65536;
 
  public:
   inline SyncProcessOutputBuffer() = default;
+  inline ~SyncProcessOutputBuffer();
 
-  inline void OnAlloc(size_t suggested_size, uv_buf_t* buf) const;
-  inline void OnRead(const uv_buf_t* buf, size_t nread);
-
-  inline size_t Copy(char* dest) const;
+  SyncProcessOutputBuffer(const SyncProcessOutputBuffer&) = delete;
+  SyncProcessOutputBuffer& operator=(const SyncProcessOutputBuffer&) = delete;
 
-  inline unsigned int available() const;
-  inline unsigned int used() const;
+  // |budget| is how much more output the runner accepts. The buffer never
+  // grows past it by more than kInitialSize, the size of the first read.
+  inline void OnAlloc(size_t budget, uv_buf_t* buf);
+  inline void OnRead(const uv_buf_t* buf, size_t nread);
 
-  inline SyncProcessOutputBuffer* next() const;
-  inline void set_next(SyncProcessOutputBuffer* next);
+  // Moves the collected output into a new Buffer.
+  v8::MaybeLocal<v8::Object> Release(Environment* env);
 
  private:
-  // Use unsigned int because that's what `uv_buf_init` takes.
-  mutable char data_[kBufferSize];
-  unsigned int used_ = 0;
-
-  SyncProcessOutputBuffer* next_ = nullptr;
+  char* data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
 };
 
 
@@ -82,7 +83,7 @@ class SyncProcessStdioPipe {
   int Start();
   void Close();
 
-  v8::Local<v8::Object> GetOutputAsBuffer(Environment* env) const;
+  v8::Local<v8::Object> GetOutputAsBuffer(Environment* env);
 
   inline bool readable() const;
   inline bool writable() const;
@@ -93,9 +94,6 @@ class SyncProcessStdioPipe {
   inline uv_handle_t* uv_handle() const;
 
  private:
-  inline size_t OutputLength() const;
-  inline void CopyOutput(char* dest) const;
-
   inline void OnAlloc(size_t suggested_size, uv_buf_t* buf);
   inline void OnRead(const uv_buf_t* buf, ssize_t nread);
   inline void OnWriteDone(int result);
@@ -120,8 +118,7 @@ class SyncProcessStdioPipe {
   bool writable_;
   uv_buf_t input_buffer_;
 
-  SyncProcessOutputBuffer* first_output_buffer_;
-  SyncProcessOutputBuffer* last_output_buffer_;
+  SyncProcessOutputBuffer output_buffer_;
 
   mutable uv_pipe_t uv_pipe_;
   uv_write_t write_req_;
@@ -163,6 +160,7 @@ class SyncProcessRunner {
 
   void Kill();
   void IncrementBufferSizeAndCheckOverflow(ssize_t length);
+  size_t RemainingBufferSize() const;
 
   void OnExit(int64_t exit_status, int term_signal);
   void OnKillTimerTimeout();
@@ -0,0 +1,162 @@
+#ifndef SRC_SPSC_RING_H_
+#define SRC_SPSC_RING_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "uv.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace node {
+
+// A single-producer/single-consumer ring of framed records in memory that is
+// shared between threads or processes. It is used by RingChannel, over a
+// SharedArrayBuffer, and by ShmChannel, over a shared memory segment.
+//
+// The ring does not own any memory. The producer and the consumer each
+// construct an SPSCRing over the same words:
+//
+// - |head|, the number of bytes ever written, only written by the producer;
+// - |tail|, the number of bytes ever consumed, only written by the consumer;
+// - |waiting|, set by the consumer before it goes to sleep;
+// - |data|, |size| bytes of records, 8-byte aligned.
+//
+// Each record is a 32-bit length followed by the payload, padded to 8 bytes.
+// A record never wraps around: when it would not fit before the end of the
+// ring, the rest of the ring is marked with kPaddingRecord and the record
+// continues at offset 0.
+//
+// How a sleeping consumer is woken up is left to the caller: Write() reports
+// when the consumer has to be woken.
+class SPSCRing {
+ public:
+  static constexpr uint32_t kPaddingRecord = 0xffffffff;
+  static constexpr size_t kRecordAlignment = 8;
+  // Returned by Peek() when the ring is empty.
+  static constexpr int32_t kEmpty = -1;
+
+  static_assert(std::atomic_ref<uint64_t>::is_always_lock_free,
+                "rings in shared memory need address-free atomics");
+  static_assert(std::atomic_ref<int32_t>::is_always_lock_free,
+                "rings in shared memory need address-free atomics");
+
+  static constexpr size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  SPSCRing(uint64_t* head,
+           uint64_t* tail,
+           int32_t* waiting,
+           char* data,
+           size_t size)
+      : head_(head), tail_(tail), waiting_(waiting), data_(data), size_(size) {}
+
+  // Returns 0, UV_EAGAIN when the ring is full, or UV_ENOBUFS when the
+  // record is too large for it. Sets |*wake| when the consumer was waiting
+  // and has to be woken up.
+  int Write(const uint8_t* data, size_t length, bool* wake) {
+    *wake = false;
+    const uint64_t record =
+        AlignUp(sizeof(uint32_t) + length, kRecordAlignment);
+    // Anything larger than half the ring might never find a contiguous slot.
+    if (record > size_ / 2 ||
+        length > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+      return UV_ENOBUFS;
+    }
+
+    uint64_t head = this->head().load(std::memory_order_relaxed);
+    const uint64_t tail = this->tail().load(std::memory_order_acquire);
+    size_t pos = head % size_;
+    const uint64_t contiguous = size_ - pos;
+    const uint64_t needed = record <= contiguous ? record : contiguous + record;
+    if (size_ - (head - tail) < needed) return UV_EAGAIN;
+
+    if (record > contiguous) {
+      memcpy(data_ + pos, &kPaddingRecord, sizeof(kPaddingRecord));
+      head += contiguous;
+      pos = 0;
+    }
+    const uint32_t length32 = static_cast<uint32_t>(length);
+    memcpy(data_ + pos, &length32, sizeof(length32));
+    if (length > 0) memcpy(data_ + pos + sizeof(length32), data, length);
+    this->head().store(head + record, std::memory_order_seq_cst);
+
+    *wake = waiting().exchange(0, std::memory_order_seq_cst) == 1;
+    return 0;
+  }
+
+  // Returns the length of the next record and points |*payload| at it,
+  // kEmpty if there is none, or UV_EPROTO if the ring holds something that
+  // is not a record. An empty ring sets the waiting flag, so that the next
+  // Write() asks for the consumer to be woken up.
+  int32_t Peek(const char** payload) {
+    for (;;) {
+      const uint64_t tail = this->tail().load(std::memory_order_relaxed);
+      const uint64_t head = this->head().load(std::memory_order_acquire);
+      if (head == tail) {
+        // Announce that we are going to sleep, then look once more so that
+        // a write racing with the announcement is not missed.
+        waiting().store(1, std::memory_order_seq_cst);
+        if (this->head().load(std::memory_order_seq_cst) == tail)
+          return kEmpty;
+        waiting().store(0, std::memory_order_relaxed);
+        continue;
+      }
+
+      const size_t pos = tail % size_;
+      uint32_t length;
+      memcpy(&length, data_ + pos, sizeof(length));
+      if (length == kPaddingRecord) {
+        this->tail().store(tail + (size_ - pos), std::memory_order_release);
+        continue;
+      }
+      if (length > size_ - pos - sizeof(length) ||
+          length > static_cast<uint32_t>(std::numeric_limits<int32_t>::max()))
+        return UV_EPROTO;
+      *payload = data_ + pos + sizeof(length);
+      return static_cast<int32_t>(length);
+    }
+  }
+
+  // Releases the record of |length| bytes that Peek() last returned.
+  void Consume(int32_t length) {
+    const uint64_t tail = this->tail().load(std::memory_order_relaxed);
+    this->tail().store(
+        tail + AlignUp(sizeof(uint32_t) + length, kRecordAlignment),
+        std::memory_order_release);
+  }
+
+  // Sets the waiting flag on behalf of a consumer that starts listening, and
+  // returns whether records were written while nobody was waiting.
+  bool StartWaiting() {
+    waiting().store(1, std::memory_order_seq_cst);
+    return head().load(std::memory_order_seq_cst) !=
+           tail().load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic_ref<uint64_t> head() const {
+    return std::atomic_ref<uint64_t>(*head_);
+  }
+  std::atomic_ref<uint64_t> tail() const {
+    return std::atomic_ref<uint64_t>(*tail_);
+  }
+  std::atomic_ref<int32_t> waiting() const {
+    return std::atomic_ref<int32_t>(*waiting_);
+  }
+
+  uint64_t* head_;
+  uint64_t* tail_;
+  int32_t* waiting_;
+  char* data_;
+  size_t size_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_SPSC_RING_H_
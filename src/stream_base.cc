@@ -18,6 +18,7 @@ namespace node {
 
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
 using v8::BackingStore;
 using v8::ConstructorBehavior;
 using v8::Context;
@@ -100,9 +101,10 @@ StreamWriteResult StreamBase::Write(uv_buf_t* bufs,
 
   v8::HandleScope handle_scope(env->isolate());
 
-  if (req_wrap_obj.IsEmpty()) {
-    if (!env->write_wrap_template()
-             ->NewInstance(env->context())
+  bool pooled_object = req_wrap_obj.IsEmpty();
+  if (pooled_object) {
+    if (!env->write_wrap_pool()
+             ->Get(env, env->write_wrap_template())
              .ToLocal(&req_wrap_obj)) {
       return StreamWriteResult{false, UV_EBUSY, nullptr, 0, {}};
     }
@@ -112,6 +114,7 @@ StreamWriteResult StreamBase::Write(uv_buf_t* bufs,
   AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(GetAsyncWrap());
   WriteWrap* req_wrap = CreateWriteWrap(req_wrap_obj);
   BaseObjectPtr<AsyncWrap> req_wrap_ptr(req_wrap->GetAsyncWrap());
+  req_wrap->set_pooled_object(pooled_object);
 
   err = DoWrite(req_wrap, bufs, count, send_handle);
   bool async = err == 0;
@@ -168,9 +171,88 @@ int StreamBase::Shutdown(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsObject());
   Local<Object> req_wrap_obj = args[0].As<Object>();
 
+  FlushCorkedWrites();
   return Shutdown(req_wrap_obj);
 }
 
+// Flush a corked batch once it reaches this many bytes or buffers, so that a
+// stream that is never uncorked does not grow without bound within one turn.
+constexpr size_t kMaxCorkedBytes = 256 * 1024;
+constexpr size_t kMaxCorkedWrites = 64;
+
+int StreamBase::Cork(const FunctionCallbackInfo<Value>& args) {
+  corked_ = true;
+  return 0;
+}
+
+int StreamBase::Uncork(const FunctionCallbackInfo<Value>& args) {
+  corked_ = false;
+  FlushCorkedWrites();
+  return 0;
+}
+
+int StreamBase::QueueCorkedWrite(Local<Object> req_wrap_obj,
+                                 const uv_buf_t& buf,
+                                 std::shared_ptr<BackingStore> store) {
+  AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(GetAsyncWrap());
+  WriteWrap* req_wrap = CreateWriteWrap(req_wrap_obj);
+  corked_writes_.push_back(CorkedWrite{std::move(store),
+                                       buf,
+                                       req_wrap,
+                                       BaseObjectPtr<AsyncWrap>(
+                                           req_wrap->GetAsyncWrap())});
+  corked_bytes_ += buf.len;
+  SetWriteResult(StreamWriteResult{true, 0, req_wrap, buf.len, {}});
+
+  if (corked_bytes_ >= kMaxCorkedBytes ||
+      corked_writes_.size() >= kMaxCorkedWrites) {
+    FlushCorkedWrites();
+  } else if (!cork_flush_scheduled_) {
+    cork_flush_scheduled_ = true;
+    BaseObjectPtr<AsyncWrap> strong_ref{GetAsyncWrap()};
+    stream_env()->SetImmediate([this, strong_ref](Environment* env) {
+      cork_flush_scheduled_ = false;
+      FlushCorkedWrites();
+    });
+  }
+  return 0;
+}
+
+void StreamBase::FlushCorkedWrites() {
+  if (corked_writes_.empty()) return;
+  std::vector<CorkedWrite> writes;
+  writes.swap(corked_writes_);
+  corked_bytes_ = 0;
+
+  MaybeStackBuffer<uv_buf_t, 16> bufs(writes.size());
+  for (size_t i = 0; i < writes.size(); i++) bufs[i] = writes[i].buf;
+
+  StreamWriteResult res = Write(*bufs, writes.size());
+  if (res.async) {
+    cork_flushes_.push_back(CorkFlush{res.wrap, std::move(writes)});
+    return;
+  }
+
+  // The queued writes were reported to JS as asynchronous, so they must not
+  // complete from within the call that flushed them.
+  BaseObjectPtr<AsyncWrap> strong_ref{GetAsyncWrap()};
+  stream_env()->SetImmediate(
+      [writes = std::move(writes), err = res.err, strong_ref](
+          Environment* env) {
+        for (const CorkedWrite& write : writes) write.req_wrap->Done(err);
+      });
+}
+
+void StreamBase::CompleteCorkFlush(WriteWrap* req_wrap, int status) {
+  for (auto it = cork_flushes_.begin(); it != cork_flushes_.end(); ++it) {
+    if (it->req_wrap != req_wrap) continue;
+    std::vector<CorkedWrite> writes = std::move(it->writes);
+    cork_flushes_.erase(it);
+    for (const CorkedWrite& write : writes) write.req_wrap->Done(status);
+    return;
+  }
+}
+
 void StreamBase::SetWriteResult(const StreamWriteResult& res) {
   env_->stream_base_state()[kBytesWritten] = res.bytes;
   env_->stream_base_state()[kLastWriteWasAsync] = res.async;
@@ -188,6 +270,8 @@ int StreamBase::Writev(const FunctionCallbackInfo<Value>& args) {
   Local<Array> chunks = args[1].As<Array>();
   bool all_buffers = args[2]->IsTrue();
 
+  FlushCorkedWrites();
+
   size_t count;
   if (all_buffers)
     count = chunks->Length();
@@ -293,6 +377,18 @@ int StreamBase::Writev(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+int StreamBase::WriteFromNative(Local<Object> req_wrap_obj,
+                                uv_buf_t* bufs,
+                                size_t count,
+                                std::unique_ptr<BackingStore>* bs) {
+  FlushCorkedWrites();
+  StreamWriteResult res = Write(bufs, count, nullptr, req_wrap_obj);
+  SetWriteResult(res);
+  if (res.wrap != nullptr && *bs) res.wrap->SetBackingStore(std::move(*bs));
+  return res.err;
+}
+
+
 int StreamBase::WriteBuffer(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsObject());
 
@@ -310,6 +406,14 @@ int StreamBase::WriteBuffer(const FunctionCallbackInfo<Value>& args) {
 
   uv_stream_t* send_handle = nullptr;
 
+  if (corked_ && !(args[2]->IsObject() && IsIPCPipe())) {
+    return QueueCorkedWrite(
+        req_wrap_obj,
+        buf,
+        args[1].As<ArrayBufferView>()->Buffer()->GetBackingStore());
+  }
+  FlushCorkedWrites();
+
   if (args[2]->IsObject() && IsIPCPipe()) {
     Local<Object> send_handle_obj = args[2].As<Object>();
 
@@ -359,6 +463,19 @@ int StreamBase::WriteString(const FunctionCallbackInfo<Value>& args) {
   if (storage_size > INT_MAX)
     return UV_ENOBUFS;
 
+  if (corked_ && (!IsIPCPipe() || send_handle_obj.IsEmpty())) {
+    std::unique_ptr<BackingStore> bs;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+      bs = ArrayBuffer::NewBackingStore(isolate, storage_size);
+    }
+    size_t data_size = StringBytes::Write(
+        isolate, static_cast<char*>(bs->Data()), storage_size, string, enc);
+    uv_buf_t buf = uv_buf_init(static_cast<char*>(bs->Data()), data_size);
+    return QueueCorkedWrite(req_wrap_obj, buf, std::move(bs));
+  }
+  FlushCorkedWrites();
+
   // Try writing immediately if write size isn't too big
   char stack_storage[16384];  // 16kb
   size_t data_size;
@@ -569,6 +686,8 @@ void StreamBase::AddMethods(IsolateData* isolate_data,
   SetProtoMethod(
       isolate, t, "useUserBuffer", JSMethod<&StreamBase::UseUserBuffer>);
   SetProtoMethod(isolate, t, "writev", JSMethod<&StreamBase::Writev>);
+  SetProtoMethod(isolate, t, "cork", JSMethod<&StreamBase::Cork>);
+  SetProtoMethod(isolate, t, "uncork", JSMethod<&StreamBase::Uncork>);
   SetProtoMethod(isolate, t, "writeBuffer", JSMethod<&StreamBase::WriteBuffer>);
   SetProtoMethod(isolate,
                  t,
@@ -609,6 +728,8 @@ void StreamBase::RegisterExternalReferences(
   registry->Register(JSMethod<&StreamBase::Shutdown>);
   registry->Register(JSMethod<&StreamBase::UseUserBuffer>);
   registry->Register(JSMethod<&StreamBase::Writev>);
+  registry->Register(JSMethod<&StreamBase::Cork>);
+  registry->Register(JSMethod<&StreamBase::Uncork>);
   registry->Register(JSMethod<&StreamBase::WriteBuffer>);
   registry->Register(JSMethod<&StreamBase::WriteString<ASCII>>);
   registry->Register(JSMethod<&StreamBase::WriteString<UTF8>>);
@@ -699,6 +820,7 @@ void EmitToJSStreamListener::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
   std::unique_ptr<BackingStore> bs = env->release_managed_buffer(buf_);
 
   if (nread <= 0)  {
+    env->recycle_managed_buffer(std::move(bs));
     if (nread < 0)
       stream->CallJSOnreadMethod(nread, Local<ArrayBuffer>());
     return;
@@ -711,6 +833,7 @@ void EmitToJSStreamListener::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
     memcpy(static_cast<char*>(bs->Data()),
            static_cast<char*>(old_bs->Data()),
            nread);
+    env->recycle_managed_buffer(std::move(old_bs));
   }
 
   stream->CallJSOnreadMethod(nread, ArrayBuffer::New(isolate, std::move(bs)));
@@ -795,7 +918,14 @@ void ShutdownWrap::OnDone(int status) {
 }
 
 void WriteWrap::OnDone(int status) {
+  if (!stream()->cork_flushes_.empty())
+    stream()->CompleteCorkFlush(this, status);
   stream()->EmitAfterWrite(this, status);
+  if (pooled_object_ && status == 0) {
+    Environment* env = stream()->stream_env();
+    HandleScope handle_scope(env->isolate());
+    env->write_wrap_pool()->Put(env, object());
+  }
   Dispose();
 }
 
@@ -10,6 +10,10 @@
 
 #include "v8.h"
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 namespace node {
 
 // Forward declarations
@@ -105,8 +109,13 @@ class WriteWrap : public StreamReq {
   // Call stream()->EmitAfterWrite() and dispose of this request wrap.
   void OnDone(int status) override;
 
+  // Whether the object came from Environment::write_wrap_pool(), and goes
+  // back there once the write has succeeded.
+  void set_pooled_object(bool value) { pooled_object_ = value; }
+
  private:
   std::unique_ptr<v8::BackingStore> backing_store_;
+  bool pooled_object_ = false;
 };
 
 
@@ -141,6 +150,12 @@ class StreamListener {
   virtual void OnStreamRead(ssize_t nread,
                             const uv_buf_t& buf) = 0;
 
+  // Whether `OnStreamRead()` also takes over buffers that the stream got from
+  // `Environment::allocate_managed_buffer()` itself, rather than from
+  // `OnStreamAlloc()`. Streams that read ahead into memory of their own can
+  // then pass it on without copying it.
+  virtual bool AcceptsManagedBuffers() const { return false; }
+
   // This is called once a write has finished. `status` may be 0 or,
   // if negative, a libuv error code.
   // By default, this is simply passed on to the previous listener
@@ -198,6 +213,7 @@ class EmitToJSStreamListener : public ReportWritesToJSStreamListener {
  public:
   uv_buf_t OnStreamAlloc(size_t suggested_size) override;
   void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+  bool AcceptsManagedBuffers() const override { return true; }
 };
 
 
@@ -363,6 +379,16 @@ class StreamBase : public StreamResource {
       v8::Local<v8::Object> req_wrap_obj = v8::Local<v8::Object>(),
       bool skip_try_write = false);
 
+  // Writes data that was assembled in native code on behalf of a JS write
+  // request, reporting the result through the stream state fields like the
+  // JS write methods do. If the write completes asynchronously, ownership of
+  // |*bs| is taken over so that it outlives the write; otherwise |*bs| is
+  // left untouched so the caller can reuse it.
+  int WriteFromNative(v8::Local<v8::Object> req_wrap_obj,
+                      uv_buf_t* bufs,
+                      size_t count,
+                      std::unique_ptr<v8::BackingStore>* bs);
+
   // These can be overridden by subclasses to get more specific wrap instances.
   // For example, a subclass Foo could create a FooWriteWrap or FooShutdownWrap
   // (inheriting from ShutdownWrap/WriteWrap) that has extra fields, like
@@ -388,6 +414,13 @@ class StreamBase : public StreamResource {
   template <enum encoding enc>
   int WriteString(const v8::FunctionCallbackInfo<v8::Value>& args);
   int UseUserBuffer(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // While corked, writeBuffer() and write*String() calls are queued and sent
+  // with a single DoTryWrite()/DoWrite() on uncork(), at the end of the
+  // current event loop turn, or once enough data has accumulated. Each
+  // queued write is reported to JS as asynchronous and completes with the
+  // result of the combined write.
+  int Cork(const v8::FunctionCallbackInfo<v8::Value>& args);
+  int Uncork(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   static void GetFD(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void GetExternal(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -413,6 +446,32 @@ class StreamBase : public StreamResource {
   EmitToJSStreamListener default_listener_;
 
   void SetWriteResult(const StreamWriteResult& res);
+
+  struct CorkedWrite {
+    // Keeps the data alive; for Buffers this is the JS object's own store.
+    std::shared_ptr<v8::BackingStore> store;
+    uv_buf_t buf;
+    WriteWrap* req_wrap;
+    BaseObjectPtr<AsyncWrap> req_wrap_ptr;
+  };
+  struct CorkFlush {
+    WriteWrap* req_wrap;
+    std::vector<CorkedWrite> writes;
+  };
+
+  int QueueCorkedWrite(v8::Local<v8::Object> req_wrap_obj,
+                       const uv_buf_t& buf,
+                       std::shared_ptr<v8::BackingStore> store);
+  void FlushCorkedWrites();
+  // Called from WriteWrap::OnDone() to complete the writes that were
+  // combined into |req_wrap|, if any.
+  void CompleteCorkFlush(WriteWrap* req_wrap, int status);
+
+  bool corked_ = false;
+  bool cork_flush_scheduled_ = false;
+  size_t corked_bytes_ = 0;
+  std::vector<CorkedWrite> corked_writes_;
+  std::deque<CorkFlush> cork_flushes_;
   static void AddAccessor(v8::Isolate* isolate,
                           v8::Local<v8::Signature> sig,
                           enum v8::PropertyAttribute attributes,
@@ -1,10 +1,21 @@
 #include "stream_pipe.h"
 #include "stream_base-inl.h"
+#include "node_blob.h"
+#include "node_bob-inl.h"
 #include "node_buffer.h"
+#include "node_errors.h"
+#include "node_file.h"
+#include "stream_wrap.h"
+#include "threadpoolwork-inl.h"
 #include "util-inl.h"
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 namespace node {
 
+using v8::ArrayBuffer;
 using v8::BackingStore;
 using v8::Context;
 using v8::Function;
@@ -14,11 +25,66 @@ using v8::HandleScope;
 using v8::Isolate;
 using v8::Just;
 using v8::Local;
+using v8::Int32;
 using v8::Maybe;
 using v8::Nothing;
 using v8::Object;
 using v8::Value;
 
+// The most a single sendfile() call is asked to send. Non-blocking sockets
+// usually accept less and return early.
+constexpr size_t kSendfileChunkSize = 1024 * 1024;
+// The size of the chunks written the regular way while the socket is full.
+constexpr size_t kSendfileFallbackChunkSize = 64 * 1024;
+
+class StreamPipe::SendfileWork final : public ThreadPoolWork {
+ public:
+  SendfileWork(StreamPipe* pipe,
+               int out_fd,
+               int in_fd,
+               int64_t offset,
+               size_t length)
+      : ThreadPoolWork(pipe->env(), "sendfile"),
+        pipe_(pipe),
+        out_fd_(out_fd),
+        in_fd_(in_fd),
+        offset_(offset),
+        length_(length) {}
+
+  void DoThreadPoolWork() override {
+#ifdef __linux__
+    // uv_fs_sendfile() would try copy_file_range() first, which fails for
+    // sockets and makes it fall back to copying through user space.
+    off_t offset = offset_;
+    ssize_t result;
+    do {
+      result = sendfile(out_fd_, in_fd_, &offset, length_);
+    } while (result == -1 && errno == EINTR);
+    result_ = result >= 0 ? result : uv_translate_sys_error(errno);
+#else
+    uv_fs_t req;
+    result_ = uv_fs_sendfile(
+        nullptr, &req, out_fd_, in_fd_, offset_, length_, nullptr);
+    uv_fs_req_cleanup(&req);
+#endif
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<SendfileWork> self(this);
+    BaseObjectPtr<StreamPipe> pipe = std::move(pipe_);
+    pipe->AfterSendfile(
+        status == UV_ECANCELED ? static_cast<ssize_t>(UV_ECANCELED) : result_);
+  }
+
+ private:
+  BaseObjectPtr<StreamPipe> pipe_;
+  int out_fd_;
+  int in_fd_;
+  int64_t offset_;
+  size_t length_;
+  ssize_t result_ = 0;
+};
+
 StreamPipe::StreamPipe(StreamBase* source,
                        StreamBase* sink,
                        Local<Object> obj)
@@ -144,6 +210,7 @@ void StreamPipe::ProcessData(size_t nread,
   uv_buf_t buffer = uv_buf_init(static_cast<char*>(bs->Data()), nread);
   StreamWriteResult res = sink()->Write(&buffer, 1);
   pending_writes_++;
+  if (res.err == 0) bytes_written_ += nread;
   if (!res.async) {
     writable_listener_.OnStreamAfterWrite(nullptr, res.err);
   } else {
@@ -154,6 +221,137 @@ void StreamPipe::ProcessData(size_t nread,
   }
 }
 
+bool StreamPipe::CanUseSendfile() {
+#ifdef _WIN32
+  return false;
+#else
+  if (source()->GetAsyncWrap()->provider_type() !=
+      AsyncWrap::PROVIDER_FILEHANDLE) {
+    return false;
+  }
+  // Sinks that transform the data, like TLS, need it in memory.
+  const AsyncWrap::ProviderType sink_type =
+      sink()->GetAsyncWrap()->provider_type();
+  if (sink_type != AsyncWrap::PROVIDER_TCPWRAP &&
+      sink_type != AsyncWrap::PROVIDER_PIPEWRAP) {
+    return false;
+  }
+  if (sink()->GetFD() < 0) return false;
+  return static_cast<fs::FileHandle*>(source())->StartSendfile(
+      &sendfile_offset_, &sendfile_remaining_);
+#endif
+}
+
+void StreamPipe::SendfileNext() {
+  if (sendfile_remaining_ == 0) {
+    readable_listener_.OnStreamRead(UV_EOF, uv_buf_init(nullptr, 0));
+    return;
+  }
+
+  // Whatever else was written to the sink has to go out first, or sendfile()
+  // would overtake it. A regular write queues up behind it.
+  uv_stream_t* stream = static_cast<LibuvStreamWrap*>(sink())->stream();
+  if (uv_stream_get_write_queue_size(stream) > 0) {
+    ReadFallbackChunk();
+    return;
+  }
+
+  size_t length = kSendfileChunkSize;
+  if (sendfile_remaining_ > 0 &&
+      static_cast<uint64_t>(sendfile_remaining_) < length) {
+    length = static_cast<size_t>(sendfile_remaining_);
+  }
+  sendfile_busy_ = true;
+  pending_writes_++;
+  auto* work = new SendfileWork(
+      this, sink()->GetFD(), source()->GetFD(), sendfile_offset_, length);
+  work->ScheduleWork();
+}
+
+void StreamPipe::AfterSendfile(ssize_t result) {
+  sendfile_busy_ = false;
+  if (!env()->can_call_into_js()) return;
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+
+  if (result > 0 && !is_closed_) {
+    sendfile_offset_ += result;
+    if (sendfile_remaining_ > 0) sendfile_remaining_ -= result;
+    bytes_written_ += result;
+    static_cast<fs::FileHandle*>(source())->AdvanceSendfile(result);
+  }
+
+  if (result > 0 || is_closed_) {
+    writable_listener_.OnStreamAfterWrite(nullptr, 0);
+    return;
+  }
+
+  pending_writes_--;
+  if (result == UV_EAGAIN) {
+    // The socket is full. A regular write waits for it to drain, and its
+    // completion brings us back to SendfileNext().
+    ReadFallbackChunk();
+    return;
+  }
+  // The file ended early or sendfile() failed.
+  readable_listener_.OnStreamRead(
+      result == 0 ? static_cast<ssize_t>(UV_EOF) : result,
+      uv_buf_init(nullptr, 0));
+}
+
+void StreamPipe::ReadFallbackChunk() {
+  size_t length = kSendfileFallbackChunkSize;
+  if (sendfile_remaining_ > 0 &&
+      static_cast<uint64_t>(sendfile_remaining_) < length) {
+    length = static_cast<size_t>(sendfile_remaining_);
+  }
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    fallback_store_ = ArrayBuffer::NewBackingStore(env()->isolate(), length);
+  }
+  uv_buf_t buf =
+      uv_buf_init(static_cast<char*>(fallback_store_->Data()), length);
+  int err = uv_fs_read(env()->event_loop(),
+                       &fallback_req_,
+                       source()->GetFD(),
+                       &buf,
+                       1,
+                       sendfile_offset_,
+                       AfterFallbackRead);
+  if (err < 0) {
+    fallback_store_.reset();
+    readable_listener_.OnStreamRead(err, uv_buf_init(nullptr, 0));
+    return;
+  }
+  sendfile_busy_ = true;
+  fallback_keepalive_.reset(this);
+}
+
+void StreamPipe::AfterFallbackRead(uv_fs_t* req) {
+  StreamPipe* pipe = ContainerOf(&StreamPipe::fallback_req_, req);
+  BaseObjectPtr<StreamPipe> keepalive = std::move(pipe->fallback_keepalive_);
+  std::unique_ptr<BackingStore> bs = std::move(pipe->fallback_store_);
+  const ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  pipe->sendfile_busy_ = false;
+
+  Environment* env = pipe->env();
+  if (pipe->is_closed_ || !env->can_call_into_js()) return;
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  if (result <= 0) {
+    pipe->readable_listener_.OnStreamRead(
+        result == 0 ? static_cast<ssize_t>(UV_EOF) : result,
+        uv_buf_init(nullptr, 0));
+    return;
+  }
+  pipe->sendfile_offset_ += result;
+  if (pipe->sendfile_remaining_ > 0) pipe->sendfile_remaining_ -= result;
+  static_cast<fs::FileHandle*>(pipe->source())->AdvanceSendfile(result);
+  pipe->ProcessData(result, std::move(bs));
+}
+
 void StreamPipe::WritableListener::OnStreamAfterWrite(WriteWrap* w,
                                                       int status) {
   StreamPipe* pipe = ContainerOf(&StreamPipe::writable_listener_, this);
@@ -201,6 +399,11 @@ void StreamPipe::WritableListener::OnStreamAfterShutdown(ShutdownWrap* w,
   prev->OnStreamAfterShutdown(w, status);
 }
 
+void StreamPipe::ReadableListener::OnStreamWantsWrite(size_t suggested_size) {
+  if (previous_listener_ != nullptr)
+    previous_listener_->OnStreamWantsWrite(suggested_size);
+}
+
 void StreamPipe::ReadableListener::OnStreamDestroy() {
   StreamPipe* pipe = ContainerOf(&StreamPipe::readable_listener_, this);
   pipe->source_destroyed_ = true;
@@ -225,6 +428,10 @@ void StreamPipe::WritableListener::OnStreamWantsWrite(size_t suggested_size) {
   HandleScope handle_scope(pipe->env()->isolate());
   InternalCallbackScope callback_scope(pipe,
       InternalCallbackScope::kSkipTaskQueues);
+  if (pipe->uses_sendfile_) {
+    if (!pipe->sendfile_busy_ && !pipe->is_eof_) pipe->SendfileNext();
+    return;
+  }
   pipe->is_reading_ = true;
   pipe->source()->ReadStart();
 }
@@ -286,6 +493,7 @@ void StreamPipe::Start(const FunctionCallbackInfo<Value>& args) {
   StreamPipe* pipe;
   ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
   pipe->is_closed_ = false;
+  pipe->uses_sendfile_ = pipe->CanUseSendfile();
   pipe->writable_listener_.OnStreamWantsWrite(65536);
 }
 
@@ -307,6 +515,303 @@ void StreamPipe::PendingWrites(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(pipe->pending_writes_);
 }
 
+void StreamPipe::BytesWritten(const FunctionCallbackInfo<Value>& args) {
+  StreamPipe* pipe;
+  ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
+  args.GetReturnValue().Set(static_cast<double>(pipe->bytes_written_));
+}
+
+BlobStreamPipe::BlobStreamPipe(Environment* env,
+                               std::shared_ptr<DataQueue::Reader> reader,
+                               StreamBase* sink,
+                               Local<Object> obj)
+    : AsyncWrap(env, obj, AsyncWrap::PROVIDER_STREAMPIPE),
+      reader_(std::move(reader)) {
+  MakeWeak();
+
+  CHECK_NOT_NULL(sink);
+  sink->PushStreamListener(&writable_listener_);
+  uses_wants_write_ = sink->HasWantsWrite();
+}
+
+BlobStreamPipe::~BlobStreamPipe() {
+  Unpipe(true);
+}
+
+StreamBase* BlobStreamPipe::sink() {
+  return static_cast<StreamBase*>(writable_listener_.stream());
+}
+
+void BlobStreamPipe::Unpipe(bool is_in_deletion) {
+  if (is_closed_)
+    return;
+
+  is_closed_ = true;
+  if (pending_writes_ == 0)
+    sink()->RemoveStreamListener(&writable_listener_);
+
+  if (is_in_deletion) return;
+
+  // As in StreamPipe::Unpipe(), this may run where JS cannot.
+  HandleScope handle_scope(env()->isolate());
+  BaseObjectPtr<BlobStreamPipe> strong_ref{this};
+  env()->SetImmediate([this, strong_ref](Environment* env) {
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Object> object = this->object();
+
+    Local<Value> onunpipe;
+    if (!object->Get(env->context(), env->onunpipe_string()).ToLocal(&onunpipe))
+      return;
+    Local<Value> arg = Int32::New(env->isolate(), error_);
+    if (onunpipe->IsFunction() &&
+        MakeCallback(onunpipe.As<Function>(), 1, &arg).IsEmpty()) {
+      return;
+    }
+
+    Local<Value> null = Null(env->isolate());
+    Local<Value> sink_v;
+    if (!object->Get(env->context(), env->sink_string()).ToLocal(&sink_v) ||
+        !sink_v->IsObject()) {
+      return;
+    }
+    if (object->Set(env->context(), env->sink_string(), null).IsNothing() ||
+        sink_v.As<Object>()
+            ->Set(env->context(), env->pipe_source_string(), null)
+            .IsNothing()) {
+      return;
+    }
+  });
+}
+
+void BlobStreamPipe::PullNext() {
+  if (in_pull_loop_) {
+    pull_again_ = true;
+    return;
+  }
+  BaseObjectPtr<BlobStreamPipe> strong_ref{this};
+  in_pull_loop_ = true;
+  do {
+    pull_again_ = false;
+    is_pulling_ = true;
+    reader_->Pull(
+        [strong_ref](int status,
+                     const DataQueue::Vec* vecs,
+                     size_t count,
+                     bob::Done done) {
+          strong_ref->OnData(status, vecs, count, std::move(done));
+        },
+        bob::OPTIONS_END,
+        nullptr,
+        0);
+  } while (pull_again_ && !is_closed_);
+  in_pull_loop_ = false;
+}
+
+void BlobStreamPipe::OnData(int status,
+                            const DataQueue::Vec* vecs,
+                            size_t count,
+                            bob::Done done) {
+  is_pulling_ = false;
+  if (is_closed_ || !env()->can_call_into_js()) {
+    if (count > 0) std::move(done)(0);
+    return;
+  }
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+
+  if (status < 0) {
+    OnEnd(status);
+    return;
+  }
+
+  if (count == 0) {
+    if (status == bob::STATUS_EOS) {
+      OnEnd(0);
+    } else if (status == bob::STATUS_BLOCK) {
+      BaseObjectPtr<BlobStreamPipe> strong_ref{this};
+      env()->SetImmediate([strong_ref](Environment* env) {
+        if (!strong_ref->is_closed_) strong_ref->PullNext();
+      });
+    } else if (status == bob::STATUS_CONTINUE) {
+      PullNext();
+    }
+    return;
+  }
+
+  MaybeStackBuffer<uv_buf_t, 16> bufs(count);
+  size_t total = 0;
+  for (size_t n = 0; n < count; n++) {
+    bufs[n] = uv_buf_init(reinterpret_cast<char*>(vecs[n].base),
+                          static_cast<unsigned int>(vecs[n].len));
+    total += vecs[n].len;
+  }
+  if (status == bob::STATUS_EOS) is_eof_ = true;
+
+  StreamWriteResult res = sink()->Write(*bufs, count);
+  pending_writes_++;
+  if (res.err == 0) bytes_written_ += total;
+  if (!res.async) {
+    // The data has been written or copied out already.
+    std::move(done)(0);
+    writable_listener_.OnStreamAfterWrite(nullptr, res.err);
+  } else {
+    pending_dones_.push_back(std::move(done));
+  }
+}
+
+void BlobStreamPipe::OnEnd(int status) {
+  is_eof_ = true;
+  if (status < 0) {
+    error_ = status;
+    Unpipe();
+    return;
+  }
+  // Otherwise, the last write finishing shuts the sink down.
+  if (pending_writes_ == 0) {
+    sink()->Shutdown();
+    Unpipe();
+  }
+}
+
+void BlobStreamPipe::WritableListener::OnStreamAfterWrite(WriteWrap* w,
+                                                          int status) {
+  BlobStreamPipe* pipe = ContainerOf(&BlobStreamPipe::writable_listener_, this);
+  pipe->pending_writes_--;
+  if (w != nullptr && !pipe->pending_dones_.empty()) {
+    bob::Done done = std::move(pipe->pending_dones_.front());
+    pipe->pending_dones_.pop_front();
+    std::move(done)(0);
+  }
+  if (pipe->is_closed_) {
+    if (pipe->pending_writes_ == 0) {
+      Environment* env = pipe->env();
+      HandleScope handle_scope(env->isolate());
+      Context::Scope context_scope(env->context());
+      if (pipe->MakeCallback(env->oncomplete_string(), 0, nullptr).IsEmpty())
+        return;
+      stream()->RemoveStreamListener(this);
+    }
+    return;
+  }
+
+  if (pipe->is_eof_) {
+    HandleScope handle_scope(pipe->env()->isolate());
+    InternalCallbackScope callback_scope(pipe,
+        InternalCallbackScope::kSkipTaskQueues);
+    pipe->sink()->Shutdown();
+    pipe->Unpipe();
+    return;
+  }
+
+  if (status != 0) {
+    CHECK_NOT_NULL(previous_listener_);
+    StreamListener* prev = previous_listener_;
+    pipe->Unpipe();
+    prev->OnStreamAfterWrite(w, status);
+    return;
+  }
+
+  if (!pipe->uses_wants_write_) {
+    OnStreamWantsWrite(65536);
+  }
+}
+
+void BlobStreamPipe::WritableListener::OnStreamAfterShutdown(ShutdownWrap* w,
+                                                             int status) {
+  BlobStreamPipe* pipe = ContainerOf(&BlobStreamPipe::writable_listener_, this);
+  CHECK_NOT_NULL(previous_listener_);
+  StreamListener* prev = previous_listener_;
+  pipe->Unpipe();
+  prev->OnStreamAfterShutdown(w, status);
+}
+
+void BlobStreamPipe::WritableListener::OnStreamDestroy() {
+  BlobStreamPipe* pipe = ContainerOf(&BlobStreamPipe::writable_listener_, this);
+  pipe->sink_destroyed_ = true;
+  pipe->is_eof_ = true;
+  pipe->pending_writes_ = 0;
+  // The sink will not report its writes anymore, release their chunks.
+  pipe->pending_dones_.clear();
+  pipe->Unpipe();
+}
+
+void BlobStreamPipe::WritableListener::OnStreamWantsWrite(
+    size_t suggested_size) {
+  BlobStreamPipe* pipe = ContainerOf(&BlobStreamPipe::writable_listener_, this);
+  if (pipe->is_pulling_ || pipe->is_closed_ || pipe->is_eof_)
+    return;
+  HandleScope handle_scope(pipe->env()->isolate());
+  InternalCallbackScope callback_scope(pipe,
+      InternalCallbackScope::kSkipTaskQueues);
+  pipe->PullNext();
+}
+
+uv_buf_t BlobStreamPipe::WritableListener::OnStreamAlloc(
+    size_t suggested_size) {
+  CHECK_NOT_NULL(previous_listener_);
+  return previous_listener_->OnStreamAlloc(suggested_size);
+}
+
+void BlobStreamPipe::WritableListener::OnStreamRead(ssize_t nread,
+                                                    const uv_buf_t& buf) {
+  CHECK_NOT_NULL(previous_listener_);
+  return previous_listener_->OnStreamRead(nread, buf);
+}
+
+void BlobStreamPipe::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(Blob::HasInstance(env, args[0]));
+  CHECK(args[1]->IsObject());
+  Blob* blob;
+  ASSIGN_OR_RETURN_UNWRAP(&blob, args[0]);
+  StreamBase* sink = StreamBase::FromObject(args[1].As<Object>());
+
+  std::shared_ptr<DataQueue::Reader> reader =
+      blob->getDataQueue().get_reader();
+  if (!reader) {
+    return THROW_ERR_INVALID_STATE(env, "The Blob has already been read");
+  }
+
+  Local<Object> obj = args.This();
+  new BlobStreamPipe(env, std::move(reader), sink, obj);
+
+  // Link the pipe and the sink so that they are collected as a group, as
+  // StreamPipe::New() does.
+  if (obj->Set(env->context(), env->sink_string(), sink->GetObject())
+          .IsNothing()) {
+    return;
+  }
+  USE(sink->GetObject()->Set(
+      env->context(), env->pipe_source_string(), obj));
+}
+
+void BlobStreamPipe::Start(const FunctionCallbackInfo<Value>& args) {
+  BlobStreamPipe* pipe;
+  ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
+  pipe->is_closed_ = false;
+  pipe->writable_listener_.OnStreamWantsWrite(65536);
+}
+
+void BlobStreamPipe::Unpipe(const FunctionCallbackInfo<Value>& args) {
+  BlobStreamPipe* pipe;
+  ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
+  pipe->Unpipe();
+}
+
+void BlobStreamPipe::IsClosed(const FunctionCallbackInfo<Value>& args) {
+  BlobStreamPipe* pipe;
+  ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
+  args.GetReturnValue().Set(pipe->is_closed_);
+}
+
+void BlobStreamPipe::BytesWritten(const FunctionCallbackInfo<Value>& args) {
+  BlobStreamPipe* pipe;
+  ASSIGN_OR_RETURN_UNWRAP(&pipe, args.This());
+  args.GetReturnValue().Set(static_cast<double>(pipe->bytes_written_));
+}
+
 namespace {
 
 void InitializeStreamPipe(Local<Object> target,
@@ -322,10 +827,23 @@ void InitializeStreamPipe(Local<Object> target,
   SetProtoMethod(isolate, pipe, "start", StreamPipe::Start);
   SetProtoMethod(isolate, pipe, "isClosed", StreamPipe::IsClosed);
   SetProtoMethod(isolate, pipe, "pendingWrites", StreamPipe::PendingWrites);
+  SetProtoMethod(isolate, pipe, "bytesWritten", StreamPipe::BytesWritten);
   pipe->Inherit(AsyncWrap::GetConstructorTemplate(env));
   pipe->InstanceTemplate()->SetInternalFieldCount(
       StreamPipe::kInternalFieldCount);
   SetConstructorFunction(context, target, "StreamPipe", pipe);
+
+  Local<FunctionTemplate> blob_pipe =
+      NewFunctionTemplate(isolate, BlobStreamPipe::New);
+  SetProtoMethod(isolate, blob_pipe, "unpipe", BlobStreamPipe::Unpipe);
+  SetProtoMethod(isolate, blob_pipe, "start", BlobStreamPipe::Start);
+  SetProtoMethod(isolate, blob_pipe, "isClosed", BlobStreamPipe::IsClosed);
+  SetProtoMethod(
+      isolate, blob_pipe, "bytesWritten", BlobStreamPipe::BytesWritten);
+  blob_pipe->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  blob_pipe->InstanceTemplate()->SetInternalFieldCount(
+      BlobStreamPipe::kInternalFieldCount);
+  SetConstructorFunction(context, target, "BlobStreamPipe", blob_pipe);
 }
 
 }  // anonymous namespace
@@ -3,8 +3,11 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "dataqueue/queue.h"
 #include "stream_base.h"
 
+#include <deque>
+
 namespace node {
 
 class StreamPipe : public AsyncWrap {
@@ -21,6 +24,7 @@ class StreamPipe : public AsyncWrap {
   static void Unpipe(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void IsClosed(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void PendingWrites(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void BytesWritten(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(StreamPipe)
@@ -33,6 +37,9 @@ class StreamPipe : public AsyncWrap {
   inline StreamBase* sink();
 
   int pending_writes_ = 0;
+  // Total number of bytes handed to the sink, whether through Write() or
+  // sendfile().
+  uint64_t bytes_written_ = 0;
   bool is_reading_ = false;
   bool is_eof_ = false;
   bool is_closed_ = true;
@@ -48,10 +55,36 @@ class StreamPipe : public AsyncWrap {
 
   void ProcessData(size_t nread, std::unique_ptr<v8::BackingStore> bs);
 
+  // When the source is a FileHandle and the sink a plain TCP or pipe
+  // socket, the file is sent with sendfile() on the threadpool instead of
+  // being read into memory and written. If the socket is full, one chunk is
+  // read and written the regular way, and its completion resumes sendfile().
+  class SendfileWork;
+  bool CanUseSendfile();
+  void SendfileNext();
+  void AfterSendfile(ssize_t result);
+  void ReadFallbackChunk();
+  static void AfterFallbackRead(uv_fs_t* req);
+
+  bool uses_sendfile_ = false;
+  // Set while a SendfileWork or a fallback read is in flight.
+  bool sendfile_busy_ = false;
+  int64_t sendfile_offset_ = 0;
+  // -1 means until the end of the file.
+  int64_t sendfile_remaining_ = -1;
+  uv_fs_t fallback_req_;
+  std::unique_ptr<v8::BackingStore> fallback_store_;
+  BaseObjectPtr<StreamPipe> fallback_keepalive_;
+
   class ReadableListener : public StreamListener {
    public:
     uv_buf_t OnStreamAlloc(size_t suggested_size) override;
     void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+    bool AcceptsManagedBuffers() const override { return true; }
+    // A stream can be the source of one pipe and the sink of another, as in
+    // a bidirectional relay; pass wants-write events on to the listener
+    // below us in that case.
+    void OnStreamWantsWrite(size_t suggested_size) override;
     void OnStreamDestroy() override;
   };
 
@@ -69,6 +102,72 @@ class StreamPipe : public AsyncWrap {
   WritableListener writable_listener_;
 };
 
+// Writes the contents of a Blob into a StreamBase without going through
+// JavaScript for every chunk. The sink's backpressure is honored the same
+// way StreamPipe does it: the next chunk is only pulled from the Blob's
+// DataQueue once the sink has finished writing or asks for more data.
+class BlobStreamPipe : public AsyncWrap {
+ public:
+  ~BlobStreamPipe() override;
+
+  void Unpipe(bool is_in_deletion = false);
+
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Unpipe(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void IsClosed(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void BytesWritten(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(BlobStreamPipe)
+  SET_SELF_SIZE(BlobStreamPipe)
+
+ private:
+  BlobStreamPipe(Environment* env,
+                 std::shared_ptr<DataQueue::Reader> reader,
+                 StreamBase* sink,
+                 v8::Local<v8::Object> obj);
+
+  inline StreamBase* sink();
+
+  // Pulls the next chunk from reader_. Chunks that are available right away
+  // are written in a loop rather than through recursion.
+  void PullNext();
+  void OnData(int status,
+              const DataQueue::Vec* vecs,
+              size_t count,
+              bob::Done done);
+  void OnEnd(int status);
+
+  std::shared_ptr<DataQueue::Reader> reader_;
+  // The Done callbacks of the chunks that the sink is still writing, in the
+  // order of the writes.
+  std::deque<bob::Done> pending_dones_;
+  int pending_writes_ = 0;
+  uint64_t bytes_written_ = 0;
+  // The error that reading the Blob failed with, passed to onunpipe.
+  int error_ = 0;
+  bool is_pulling_ = false;
+  bool in_pull_loop_ = false;
+  bool pull_again_ = false;
+  bool is_eof_ = false;
+  bool is_closed_ = true;
+  bool sink_destroyed_ = false;
+  bool uses_wants_write_ = false;
+
+  class WritableListener : public StreamListener {
+   public:
+    uv_buf_t OnStreamAlloc(size_t suggested_size) override;
+    void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+    void OnStreamAfterWrite(WriteWrap* w, int status) override;
+    void OnStreamAfterShutdown(ShutdownWrap* w, int status) override;
+    void OnStreamWantsWrite(size_t suggested_size) override;
+    void OnStreamDestroy() override;
+  };
+
+  WritableListener writable_listener_;
+};
+
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
@@ -30,11 +30,13 @@
 #include "pipe_wrap.h"
 #include "req_wrap-inl.h"
 #include "tcp_wrap.h"
+#include "timer_wrap-inl.h"
 #include "udp_wrap.h"
 #include "util-inl.h"
 
 #include <cstring>  // memcpy()
 #include <climits>  // INT_MAX
+#include <vector>
 
 
 namespace node {
@@ -51,6 +53,7 @@ using v8::JustVoid;
 using v8::Local;
 using v8::Maybe;
 using v8::MaybeLocal;
+using v8::Number;
 using v8::Nothing;
 using v8::Object;
 using v8::PropertyAttribute;
@@ -116,6 +119,7 @@ void LibuvStreamWrap::RegisterExternalReferences(
   registry->Register(IsConstructCallCallback);
   registry->Register(GetWriteQueueSize);
   registry->Register(SetBlocking);
+  registry->Register(SetIdleTimeout);
   StreamBase::RegisterExternalReferences(registry);
 }
 
@@ -154,6 +158,7 @@ Local<FunctionTemplate> LibuvStreamWrap::GetConstructorTemplate(
         Local<FunctionTemplate>(),
         static_cast<PropertyAttribute>(ReadOnly | DontDelete));
     SetProtoMethod(isolate, tmpl, "setBlocking", SetBlocking);
+    SetProtoMethod(isolate, tmpl, "setIdleTimeout", SetIdleTimeout);
     StreamBase::AddMethods(env, tmpl);
     env->set_libuv_stream_wrap_ctor_template(tmpl);
   }
@@ -266,6 +271,8 @@ Maybe<void> LibuvStreamWrap::OnUvRead(ssize_t nread, const uv_buf_t* buf) {
   CHECK_EQ(persistent().IsEmpty(), false);
 
   if (nread > 0) {
+    MarkActive();
+
     MaybeLocal<Object> pending_obj;
 
     if (type == UV_TCP) {
@@ -321,6 +328,113 @@ void LibuvStreamWrap::SetBlocking(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(uv_stream_set_blocking(wrap->stream(), enable));
 }
 
+
+// setIdleTimeout(msecs) makes the stream emit `ontimeout` once it has had
+// no reads or writes for |msecs| milliseconds, replacing a JS timer that
+// is refreshed on every read and write. 0 disables the timeout.
+void LibuvStreamWrap::SetIdleTimeout(const FunctionCallbackInfo<Value>& args) {
+  LibuvStreamWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.This());
+  CHECK(args[0]->IsNumber());
+
+  wrap->idle_timeout_node_.Remove();
+  wrap->idle_timeout_ = static_cast<uint64_t>(args[0].As<Number>()->Value());
+  if (wrap->idle_timeout_ != 0 && wrap->IsAlive() && !wrap->IsClosing())
+    wrap->UpdateIdleTimeout();
+}
+
+
+void LibuvStreamWrap::UpdateIdleTimeout() {
+  last_activity_ = uv_now(env()->event_loop());
+  // Streams that are already in a bucket are checked against the new time
+  // when the bucket is swept, so only timed-out ones need scheduling.
+  if (idle_timeout_node_.IsEmpty())
+    env()->stream_idle_timeouts()->Schedule(this);
+}
+
+
+StreamIdleTimeouts::StreamIdleTimeouts(Environment* env)
+    : env_(env), timer_(env, [this]() { Sweep(); }) {
+  // Like the timers of JS socket timeouts, this does not keep the loop
+  // alive.
+  timer_.Unref();
+}
+
+
+void StreamIdleTimeouts::Schedule(LibuvStreamWrap* wrap) {
+  if (!running_) {
+    current_tick_ = uv_now(env_->event_loop()) / kTickMs;
+    timer_.Update(kTickMs, kTickMs);
+    running_ = true;
+  }
+  // Round up, so that the stream is not visited before its deadline, and
+  // park deadlines beyond the wheel in its last slot to be rescheduled from
+  // there.
+  uint64_t deadline = wrap->last_activity_ + wrap->idle_timeout_;
+  uint64_t tick = (deadline + kTickMs - 1) / kTickMs;
+  tick = std::max(tick, current_tick_ + 1);
+  tick = std::min<uint64_t>(tick, current_tick_ + kSlots - 1);
+  buckets_[tick % kSlots].PushBack(wrap);
+}
+
+
+void StreamIdleTimeouts::Sweep() {
+  uint64_t now = uv_now(env_->event_loop());
+  uint64_t now_tick = now / kTickMs;
+  // After a blocked loop, visiting each slot once is enough.
+  if (now_tick >= current_tick_ + kSlots) current_tick_ = now_tick - kSlots + 1;
+
+  std::vector<BaseObjectPtr<LibuvStreamWrap>> expired;
+  for (; current_tick_ <= now_tick; current_tick_++) {
+    Bucket& bucket = buckets_[current_tick_ % kSlots];
+    while (LibuvStreamWrap* wrap = bucket.PopFront()) {
+      // Closed streams leave the wheel here, or when they are destroyed.
+      if (!wrap->IsAlive() || wrap->IsClosing()) continue;
+      if (wrap->last_activity_ + wrap->idle_timeout_ > now) {
+        Schedule(wrap);
+      } else {
+        expired.emplace_back(wrap);
+      }
+    }
+  }
+
+  bool empty = true;
+  for (const Bucket& bucket : buckets_) {
+    if (!bucket.IsEmpty()) {
+      empty = false;
+      break;
+    }
+  }
+  if (empty) {
+    timer_.Stop();
+    running_ = false;
+  }
+
+  if (expired.empty()) return;
+  HandleScope handle_scope(env_->isolate());
+  Context::Scope context_scope(env_->context());
+  for (const BaseObjectPtr<LibuvStreamWrap>& wrap : expired) {
+    // An earlier callback may have closed the stream or changed its timeout.
+    if (!wrap->IsAlive() || wrap->IsClosing() || wrap->idle_timeout_ == 0 ||
+        !wrap->idle_timeout_node_.IsEmpty()) {
+      continue;
+    }
+    wrap->MakeCallback(env_->ontimeout_string(), 0, nullptr);
+  }
+}
+
+
+void StreamIdleTimeouts::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("timer", timer_);
+}
+
+
+StreamIdleTimeouts* Environment::stream_idle_timeouts() {
+  if (!stream_idle_timeouts_)
+    stream_idle_timeouts_ = std::make_unique<StreamIdleTimeouts>(this);
+  return stream_idle_timeouts_.get();
+}
+
 typedef SimpleShutdownWrap<ReqWrap<uv_shutdown_t>> LibuvShutdownWrap;
 typedef SimpleWriteWrap<ReqWrap<uv_write_t>> LibuvWriteWrap;
 
@@ -364,6 +478,8 @@ int LibuvStreamWrap::DoTryWrite(uv_buf_t** bufs, size_t* count) {
     return 0;
   if (err < 0)
     return err;
+  if (err > 0)
+    MarkActive();
 
   // Slice off the buffers: skip all written buffers and slice the one that
   // was partially written.
@@ -394,6 +510,7 @@ int LibuvStreamWrap::DoWrite(WriteWrap* req_wrap,
                              size_t count,
                              uv_stream_t* send_handle) {
   LibuvWriteWrap* w = static_cast<LibuvWriteWrap*>(req_wrap);
+  MarkActive();
   return w->Dispatch(uv_write2,
                      stream(),
                      bufs,
@@ -408,6 +525,10 @@ void LibuvStreamWrap::AfterUvWrite(uv_write_t* req, int status) {
   LibuvWriteWrap* req_wrap = static_cast<LibuvWriteWrap*>(
       LibuvWriteWrap::from_req(req));
   CHECK_NOT_NULL(req_wrap);
+  // Progress on a write that was queued keeps the stream from timing out,
+  // like the write queue check of the JS socket timeout.
+  if (status == 0)
+    static_cast<LibuvStreamWrap*>(req_wrap->stream())->MarkActive();
   HandleScope scope(req_wrap->env()->isolate());
   Context::Scope context_scope(req_wrap->env()->context());
   req_wrap->Done(status);
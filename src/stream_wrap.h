@@ -26,6 +26,8 @@
 
 #include "stream_base.h"
 #include "handle_wrap.h"
+#include "timer_wrap.h"
+#include "util.h"
 #include "v8.h"
 
 namespace node {
@@ -80,6 +82,11 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
 
   static LibuvStreamWrap* From(Environment* env, v8::Local<v8::Object> object);
 
+  // Records read or write activity for the idle timeout.
+  inline void MarkActive() {
+    if (idle_timeout_ != 0) UpdateIdleTimeout();
+  }
+
  protected:
   LibuvStreamWrap(Environment* env,
                   v8::Local<v8::Object> object,
@@ -103,6 +110,9 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
   static void GetWriteQueueSize(
       const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SetBlocking(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetIdleTimeout(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  void UpdateIdleTimeout();
 
   // Callbacks for libuv
   void OnUvAlloc(size_t suggested_size, uv_buf_t* buf);
@@ -113,6 +123,14 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
 
   uv_stream_t* const stream_;
 
+  // Idle timeout in milliseconds, or 0. The stream is in a bucket of
+  // StreamIdleTimeouts while the timeout is armed.
+  uint64_t idle_timeout_ = 0;
+  uint64_t last_activity_ = 0;
+  ListNode<LibuvStreamWrap> idle_timeout_node_;
+
+  friend class StreamIdleTimeouts;
+
 #ifdef _WIN32
   // We don't always have an FD that we could look up on the stream_
   // object itself on Windows. However, for some cases, we open handles
@@ -124,6 +142,39 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
 #endif
 };
 
+// Tracks the idle timeouts of the LibuvStreamWraps of an Environment.
+// Reads and writes only stamp the last activity time of a stream. A timer
+// wheel with kTickMs granularity visits each stream around its deadline,
+// emits `ontimeout` if it has really been idle since, and otherwise moves
+// it to the bucket of its new deadline. A timed-out stream is rearmed by
+// its next activity, like a refreshed JS timer.
+class StreamIdleTimeouts final : public MemoryRetainer {
+ public:
+  explicit StreamIdleTimeouts(Environment* env);
+
+  // Puts |wrap| into the bucket of its current deadline.
+  void Schedule(LibuvStreamWrap* wrap);
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(StreamIdleTimeouts)
+  SET_SELF_SIZE(StreamIdleTimeouts)
+
+ private:
+  static constexpr uint64_t kTickMs = 100;
+  static constexpr size_t kSlots = 128;
+
+  void Sweep();
+
+  using Bucket =
+      ListHead<LibuvStreamWrap, &LibuvStreamWrap::idle_timeout_node_>;
+
+  Environment* env_;
+  TimerWrapHandle timer_;
+  bool running_ = false;
+  // The tick whose bucket the next sweep starts with.
+  uint64_t current_tick_ = 0;
+  Bucket buckets_[kSlots];
+};
 
 }  // namespace node
 
@@ -40,6 +40,7 @@
 
 namespace node {
 
+using v8::BackingStore;
 using v8::HandleScope;
 using v8::Isolate;
 using v8::Just;
@@ -198,6 +199,66 @@ MaybeLocal<Value> ExternTwoByteString::NewSimpleFromCopy(Isolate* isolate,
   return str.ToLocalChecked();
 }
 
+
+// An external string over the memory of a BackingStore, which it keeps
+// alive instead of owning a copy of the data.
+template <typename ResourceType, typename TypeName>
+class BackingStoreString : public ResourceType {
+ public:
+  const TypeName* data() const override { return data_; }
+
+  size_t length() const override { return length_; }
+
+  static MaybeLocal<Value> New(Isolate* isolate,
+                               std::shared_ptr<BackingStore> store,
+                               const TypeName* data,
+                               size_t length,
+                               Local<Value>* error) {
+    BackingStoreString* h_str =
+        new BackingStoreString(std::move(store), data, length);
+    Local<String> str;
+    if (!NewExternal(isolate, h_str).ToLocal(&str)) {
+      delete h_str;
+      *error = node::ERR_STRING_TOO_LONG(isolate);
+      return MaybeLocal<Value>();
+    }
+    return str;
+  }
+
+ private:
+  BackingStoreString(std::shared_ptr<BackingStore> store,
+                     const TypeName* data,
+                     size_t length)
+      : store_(std::move(store)), data_(data), length_(length) {}
+
+  static MaybeLocal<String> NewExternal(Isolate* isolate,
+                                        BackingStoreString* h_str);
+
+  std::shared_ptr<BackingStore> store_;
+  const TypeName* data_;
+  size_t length_;
+};
+
+
+typedef BackingStoreString<String::ExternalOneByteStringResource,
+                           char> BackingStoreOneByteString;
+typedef BackingStoreString<String::ExternalStringResource,
+                           uint16_t> BackingStoreTwoByteString;
+
+
+template <>
+MaybeLocal<String> BackingStoreOneByteString::NewExternal(
+    Isolate* isolate, BackingStoreOneByteString* h_str) {
+  return String::NewExternalOneByte(isolate, h_str);
+}
+
+
+template <>
+MaybeLocal<String> BackingStoreTwoByteString::NewExternal(
+    Isolate* isolate, BackingStoreTwoByteString* h_str) {
+  return String::NewExternalTwoByte(isolate, h_str);
+}
+
 }  // anonymous namespace
 
 size_t StringBytes::WriteUCS2(
@@ -560,6 +621,47 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
 
     case UTF8:
       {
+        // Validate and transcode with simdutf so that ASCII and Latin-1 text
+        // becomes a one-byte string without going through V8's scalar
+        // decoder. Ill-formed input is left to V8, which replaces invalid
+        // sequences with U+FFFD.
+        if (!simdutf::validate_ascii_with_errors(buf, buflen).error) {
+          return ExternOneByteString::NewFromCopy(isolate, buf, buflen, error);
+        }
+
+        char* latin1 = node::UncheckedMalloc(buflen);
+        if (latin1 == nullptr) {
+          *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
+          return MaybeLocal<Value>();
+        }
+        size_t latin1_length =
+            simdutf::convert_utf8_to_latin1(buf, buflen, latin1);
+        if (latin1_length != 0) {
+          return ExternOneByteString::New(
+              isolate, latin1, latin1_length, error);
+        }
+        free(latin1);
+
+        uint16_t* utf16 = node::UncheckedMalloc<uint16_t>(buflen);
+        if (utf16 == nullptr) {
+          *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
+          return MaybeLocal<Value>();
+        }
+        simdutf::result result = simdutf::convert_utf8_to_utf16_with_errors(
+            buf, buflen, reinterpret_cast<char16_t*>(utf16));
+        if (result.error == simdutf::SUCCESS) {
+          // Multibyte text transcodes to fewer code units than input bytes.
+          // Give back the slack before the buffer is kept by an external
+          // string.
+          if (result.count >= EXTERN_APEX && result.count < buflen) {
+            uint16_t* shrunk =
+                node::UncheckedRealloc<uint16_t>(utf16, result.count);
+            if (shrunk != nullptr) utf16 = shrunk;
+          }
+          return ExternTwoByteString::New(isolate, utf16, result.count, error);
+        }
+        free(utf16);
+
         val = String::NewFromUtf8(isolate,
                                   buf,
                                   v8::NewStringType::kNormal,
@@ -681,6 +783,44 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
   }
 }
 
+MaybeLocal<Value> StringBytes::EncodeExternal(
+    Isolate* isolate,
+    std::shared_ptr<BackingStore> store,
+    size_t offset,
+    size_t length,
+    enum encoding encoding,
+    Local<Value>* error) {
+  CHECK_LE(offset, store->ByteLength());
+  CHECK_LE(length, store->ByteLength() - offset);
+  const char* data = static_cast<const char*>(store->Data()) + offset;
+
+  // Below EXTERN_APEX, copying into a sequential string is cheaper.
+  if (length >= EXTERN_APEX) {
+    switch (encoding) {
+      case ASCII:
+      case UTF8:
+        // Only pure ASCII decodes to the very same bytes.
+        if (simdutf::validate_ascii_with_errors(data, length).error) break;
+        [[fallthrough]];
+      case LATIN1:
+        return BackingStoreOneByteString::New(
+            isolate, std::move(store), data, length, error);
+      case UCS2:
+        if (IsBigEndian() || reinterpret_cast<uintptr_t>(data) % 2 != 0)
+          break;
+        return BackingStoreTwoByteString::New(
+            isolate,
+            std::move(store),
+            reinterpret_cast<const uint16_t*>(data),
+            length / 2,
+            error);
+      default:
+        break;
+    }
+  }
+  return Encode(isolate, data, length, encoding, error);
+}
+
 MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
                                       const char* buf,
                                       enum encoding encoding,
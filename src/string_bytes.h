@@ -29,6 +29,7 @@
 #include "v8.h"
 #include "env-inl.h"
 
+#include <memory>
 #include <string>
 
 namespace node {
@@ -98,6 +99,18 @@ class StringBytes {
                                           enum encoding encoding,
                                           v8::Local<v8::Value>* error);
 
+  // Like Encode(), but large latin1, ASCII-only ascii or utf8, and aligned
+  // ucs2 data becomes an external string over |store| itself, which the
+  // string keeps alive. Only for data that is never modified again, such
+  // as single executable assets.
+  static v8::MaybeLocal<v8::Value> EncodeExternal(
+      v8::Isolate* isolate,
+      std::shared_ptr<v8::BackingStore> store,
+      size_t offset,
+      size_t length,
+      enum encoding encoding,
+      v8::Local<v8::Value>* error);
+
  private:
   static size_t WriteUCS2(v8::Isolate* isolate,
                           char* buf,
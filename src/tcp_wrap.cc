@@ -28,18 +28,30 @@
 #include "node_buffer.h"
 #include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_probes.h"
 #include "stream_base-inl.h"
 #include "stream_wrap.h"
 #include "util-inl.h"
 
 #include <cstdlib>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 
 namespace node {
 
 using v8::Boolean;
 using v8::Context;
 using v8::EscapableHandleScope;
+using v8::Float64Array;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
@@ -90,6 +102,7 @@ void TCPWrap::Initialize(Local<Object> target,
   SetProtoMethod(isolate, t, "open", Open);
   SetProtoMethod(isolate, t, "bind", Bind);
   SetProtoMethod(isolate, t, "listen", Listen);
+  SetProtoMethod(isolate, t, "setAcceptBatchSize", SetAcceptBatchSize);
   SetProtoMethod(isolate, t, "connect", Connect);
   SetProtoMethod(isolate, t, "bind6", Bind6);
   SetProtoMethod(isolate, t, "connect6", Connect6);
@@ -103,6 +116,8 @@ void TCPWrap::Initialize(Local<Object> target,
                  GetSockOrPeerName<TCPWrap, uv_tcp_getpeername>);
   SetProtoMethod(isolate, t, "setNoDelay", SetNoDelay);
   SetProtoMethod(isolate, t, "setKeepAlive", SetKeepAlive);
+  SetProtoMethod(isolate, t, "setIncomingCpu", SetIncomingCpu);
+  SetProtoMethod(isolate, t, "getTCPInfo", GetTCPInfo);
   SetProtoMethod(isolate, t, "reset", Reset);
 
 #ifdef _WIN32
@@ -123,6 +138,20 @@ void TCPWrap::Initialize(Local<Object> target,
   NODE_DEFINE_CONSTANT(constants, SOCKET);
   NODE_DEFINE_CONSTANT(constants, SERVER);
   NODE_DEFINE_CONSTANT(constants, UV_TCP_IPV6ONLY);
+  NODE_DEFINE_CONSTANT(constants, kReusePort);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoState);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoRtt);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoRttVar);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoSndCwnd);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoSndSsthresh);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoSndMss);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoRcvMss);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoUnacked);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoLost);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoRetransmits);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoTotalRetrans);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoBytesInFlight);
+  NODE_DEFINE_CONSTANT(constants, kTCPInfoFieldsCount);
   target->Set(context,
               env->constants_string(),
               constants).Check();
@@ -133,6 +162,7 @@ void TCPWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Open);
   registry->Register(Bind);
   registry->Register(Listen);
+  registry->Register(SetAcceptBatchSize);
   registry->Register(Connect);
   registry->Register(Bind6);
   registry->Register(Connect6);
@@ -141,6 +171,8 @@ void TCPWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetSockOrPeerName<TCPWrap, uv_tcp_getpeername>);
   registry->Register(SetNoDelay);
   registry->Register(SetKeepAlive);
+  registry->Register(SetIncomingCpu);
+  registry->Register(GetTCPInfo);
   registry->Register(Reset);
 #ifdef _WIN32
   registry->Register(SetSimultaneousAccepts);
@@ -246,18 +278,21 @@ void TCPWrap::Bind(
   int port;
   unsigned int flags = 0;
   if (!args[1]->Int32Value(env->context()).To(&port)) return;
-  if (family == AF_INET6 &&
+  if ((family == AF_INET6 || !args[2]->IsUndefined()) &&
       !args[2]->Uint32Value(env->context()).To(&flags)) {
     return;
   }
+  if (family != AF_INET6) flags &= ~UV_TCP_IPV6ONLY;
 
   T addr;
   int err = uv_ip_addr(*ip_address, port, &addr);
 
+  if (err == 0 && (flags & kReusePort)) err = wrap->EnableReusePort(family);
+
   if (err == 0) {
     err = uv_tcp_bind(&wrap->handle_,
                       reinterpret_cast<const sockaddr*>(&addr),
-                      flags);
+                      flags & ~kReusePort);
   }
   args.GetReturnValue().Set(err);
 }
@@ -267,6 +302,116 @@ void TCPWrap::Bind(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+// SO_REUSEPORT has to be set before bind(2), but libuv only creates the
+// socket inside uv_tcp_bind(). Create it here when needed and hand it to
+// libuv so that the option can be applied first. Where the kernel offers a
+// load-balancing variant (SO_REUSEPORT_LB on FreeBSD) it is preferred; on
+// Linux plain SO_REUSEPORT already spreads connections across listeners.
+int TCPWrap::EnableReusePort(int family) {
+#if defined(_WIN32) || (!defined(SO_REUSEPORT) && !defined(SO_REUSEPORT_LB))
+  return UV_ENOTSUP;
+#else
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&handle_), &fd);
+  if (err == UV_EBADF) {
+    int type = SOCK_STREAM;
+#ifdef SOCK_CLOEXEC
+    type |= SOCK_CLOEXEC;
+#endif
+    fd = socket(family, type, 0);
+    if (fd == -1) return uv_translate_sys_error(errno);
+    err = uv_tcp_open(&handle_, fd);
+    if (err != 0) {
+      close(fd);
+      return err;
+    }
+  } else if (err != 0) {
+    return err;
+  }
+
+#ifdef SO_REUSEPORT_LB
+  const int optname = SO_REUSEPORT_LB;
+#else
+  const int optname = SO_REUSEPORT;
+#endif
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, optname, &on, sizeof(on)) != 0)
+    return uv_translate_sys_error(errno);
+  return 0;
+#endif
+}
+
+
+// getTCPInfo(array) copies the kernel's TCP_INFO for the connection into a
+// caller-owned Float64Array of at least kTCPInfoFieldsCount elements, so
+// that it can be sampled per request without allocating.
+void TCPWrap::GetTCPInfo(const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(
+      &wrap, args.This(), args.GetReturnValue().Set(UV_EBADF));
+  CHECK(args[0]->IsFloat64Array());
+  Local<Float64Array> array = args[0].As<Float64Array>();
+  CHECK_GE(array->Length(), static_cast<size_t>(kTCPInfoFieldsCount));
+
+#ifdef __linux__
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err != 0) return args.GetReturnValue().Set(err);
+
+  struct tcp_info info;
+  socklen_t len = sizeof(info);
+  if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+    return args.GetReturnValue().Set(uv_translate_sys_error(errno));
+
+  double* fields = reinterpret_cast<double*>(
+      static_cast<char*>(array->Buffer()->Data()) + array->ByteOffset());
+  fields[kTCPInfoState] = info.tcpi_state;
+  fields[kTCPInfoRtt] = info.tcpi_rtt;
+  fields[kTCPInfoRttVar] = info.tcpi_rttvar;
+  fields[kTCPInfoSndCwnd] = info.tcpi_snd_cwnd;
+  fields[kTCPInfoSndSsthresh] = info.tcpi_snd_ssthresh;
+  fields[kTCPInfoSndMss] = info.tcpi_snd_mss;
+  fields[kTCPInfoRcvMss] = info.tcpi_rcv_mss;
+  fields[kTCPInfoUnacked] = info.tcpi_unacked;
+  fields[kTCPInfoLost] = info.tcpi_lost;
+  fields[kTCPInfoRetransmits] = info.tcpi_retransmits;
+  fields[kTCPInfoTotalRetrans] = info.tcpi_total_retrans;
+  // Segments sent but neither acknowledged nor presumed lost, as in
+  // tcp_packets_in_flight(), scaled to bytes by the current MSS.
+  uint32_t in_flight = info.tcpi_unacked - info.tcpi_sacked - info.tcpi_lost +
+                       info.tcpi_retrans;
+  fields[kTCPInfoBytesInFlight] =
+      static_cast<double>(in_flight) * info.tcpi_snd_mss;
+  args.GetReturnValue().Set(0);
+#else
+  args.GetReturnValue().Set(UV_ENOTSUP);
+#endif
+}
+
+
+// Steers connections to the listener whose SO_INCOMING_CPU matches the CPU
+// that processed the packet. Only meaningful for SO_REUSEPORT groups.
+void TCPWrap::SetIncomingCpu(const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(
+      &wrap, args.This(), args.GetReturnValue().Set(UV_EBADF));
+  Environment* env = wrap->env();
+  int cpu;
+  if (!args[0]->Int32Value(env->context()).To(&cpu)) return;
+#ifdef SO_INCOMING_CPU
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err == 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != 0) {
+    err = uv_translate_sys_error(errno);
+  }
+#else
+  int err = UV_ENOTSUP;
+#endif
+  args.GetReturnValue().Set(err);
+}
+
+
 void TCPWrap::Bind6(const FunctionCallbackInfo<Value>& args) {
   Bind<sockaddr_in6>(args, AF_INET6, uv_ip6_addr);
 }
@@ -339,6 +484,8 @@ void TCPWrap::Connect(const FunctionCallbackInfo<Value>& args,
     } else {
       CHECK(args[2]->Uint32Value(env->context()).IsJust());
       int port = args[2]->Uint32Value(env->context()).FromJust();
+      if (NODE_PROBE_ENABLED(tcp__connect__start))
+        NODE_PROBE1(tcp__connect__start, req_wrap);
       TRACE_EVENT_NESTABLE_ASYNC_BEGIN2(TRACING_CATEGORY_NODE2(net, native),
                                         "connect",
                                         req_wrap,
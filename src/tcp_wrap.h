@@ -39,6 +39,29 @@ class TCPWrap : public ConnectionWrap<TCPWrap, uv_tcp_t> {
     SERVER
   };
 
+  // Bind flag, kept clear of the UV_TCP_* flags, that asks for the socket to
+  // be bound with SO_REUSEPORT so that several threads or processes can each
+  // own a listening socket on the same address.
+  static constexpr unsigned int kReusePort = 1 << 16;
+
+  // Layout of the Float64Array filled by getTCPInfo(). Times are in
+  // microseconds, windows and in-flight counts in segments.
+  enum TCPInfoField {
+    kTCPInfoState,
+    kTCPInfoRtt,
+    kTCPInfoRttVar,
+    kTCPInfoSndCwnd,
+    kTCPInfoSndSsthresh,
+    kTCPInfoSndMss,
+    kTCPInfoRcvMss,
+    kTCPInfoUnacked,
+    kTCPInfoLost,
+    kTCPInfoRetransmits,
+    kTCPInfoTotalRetrans,
+    kTCPInfoBytesInFlight,
+    kTCPInfoFieldsCount
+  };
+
   static v8::MaybeLocal<v8::Object> Instantiate(Environment* env,
                                                 AsyncWrap* parent,
                                                 SocketType type);
@@ -88,7 +111,10 @@ class TCPWrap : public ConnectionWrap<TCPWrap, uv_tcp_t> {
       const v8::FunctionCallbackInfo<v8::Value>& args,
       int family,
       std::function<int(const char* ip_address, int port, T* addr)> uv_ip_addr);
+  static void GetTCPInfo(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetIncomingCpu(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Reset(const v8::FunctionCallbackInfo<v8::Value>& args);
+  int EnableReusePort(int family);
   int Reset(v8::Local<v8::Value> close_callback = v8::Local<v8::Value>());
 
 #ifdef _WIN32
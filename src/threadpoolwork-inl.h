@@ -25,6 +25,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "node_internals.h"
+#include "node_probes.h"
 #include "tracing/trace_event.h"
 #include "util-inl.h"
 
@@ -34,20 +35,35 @@ void ThreadPoolWork::ScheduleWork() {
   env_->IncreaseWaitingRequestCounter();
   TRACE_EVENT_NESTABLE_ASYNC_BEGIN0(
       TRACING_CATEGORY_NODE2(threadpoolwork, async), type_, this);
-  int status = uv_queue_work(
-      env_->event_loop(),
+  ThreadPoolWorkQueue* queue = env_->threadpool_work_queue();
+  if (NODE_PROBE_ENABLED(threadpool__work__queued))
+    NODE_PROBE2(threadpool__work__queued, this, type_);
+  queued_at_ = queue->WorkQueued(category_);
+  int status = queue->Queue(
+      category_,
       &work_req_,
       [](uv_work_t* req) {
         ThreadPoolWork* self = ContainerOf(&ThreadPoolWork::work_req_, req);
+        ThreadPoolWorkQueue* queue = self->env_->threadpool_work_queue();
+        uint64_t started_at =
+            queue->WorkStarted(self->category_, self->queued_at_);
+        if (NODE_PROBE_ENABLED(threadpool__work__start))
+          NODE_PROBE2(threadpool__work__start, self, self->type_);
         TRACE_EVENT_BEGIN0(TRACING_CATEGORY_NODE2(threadpoolwork, sync),
                            self->type_);
         self->DoThreadPoolWork();
         TRACE_EVENT_END0(TRACING_CATEGORY_NODE2(threadpoolwork, sync),
                          self->type_);
+        queue->WorkFinished(self->category_, started_at);
       },
       [](uv_work_t* req, int status) {
         ThreadPoolWork* self = ContainerOf(&ThreadPoolWork::work_req_, req);
+        ThreadPoolWorkQueue* queue = self->env_->threadpool_work_queue();
+        if (status == UV_ECANCELED) queue->WorkCancelled(self->category_);
+        queue->Done(self->category_);
         self->env_->DecreaseWaitingRequestCounter();
+        if (NODE_PROBE_ENABLED(threadpool__work__done))
+          NODE_PROBE3(threadpool__work__done, self, self->type_, status);
         TRACE_EVENT_NESTABLE_ASYNC_END1(
             TRACING_CATEGORY_NODE2(threadpoolwork, async),
             self->type_,
@@ -60,7 +76,7 @@ void ThreadPoolWork::ScheduleWork() {
 }
 
 int ThreadPoolWork::CancelWork() {
-  return uv_cancel(reinterpret_cast<uv_req_t*>(&work_req_));
+  return env_->threadpool_work_queue()->Cancel(category_, &work_req_);
 }
 
 }  // namespace node
@@ -0,0 +1,180 @@
+#include "env-inl.h"
+#include "histogram-inl.h"
+#include "node_internals.h"
+#include "node_options-inl.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace node {
+
+size_t GetLibuvThreadPoolSize() {
+  const char* size = getenv("UV_THREADPOOL_SIZE");
+  size_t threads = size != nullptr ? strtoul(size, nullptr, 10) : 4;
+  if (threads == 0) threads = 1;
+  return std::min<size_t>(threads, 1024);
+}
+
+ThreadPoolWorkQueue::ThreadPoolWorkQueue(Environment* env) : env_(env) {
+  int64_t limits[kThreadPoolWorkCategoryCount];
+  {
+    Mutex::ScopedLock lock(per_process::cli_options_mutex);
+    limits[kThreadPoolWorkFs] = per_process::cli_options->threadpool_fs_limit;
+    limits[kThreadPoolWorkCrypto] =
+        per_process::cli_options->threadpool_crypto_limit;
+    limits[kThreadPoolWorkZlib] =
+        per_process::cli_options->threadpool_zlib_limit;
+    limits[kThreadPoolWorkUser] =
+        per_process::cli_options->threadpool_user_limit;
+  }
+  // By default each category leaves at least one thread to the others.
+  size_t default_limit = std::max<size_t>(GetLibuvThreadPoolSize() - 1, 1);
+  for (int i = 0; i < kThreadPoolWorkCategoryCount; i++) {
+    lanes_[i].limit =
+        limits[i] > 0 ? static_cast<size_t>(limits[i]) : default_limit;
+  }
+}
+
+ThreadPoolWorkQueue::Category ThreadPoolWorkQueue::GetCategory(
+    const char* type) {
+  static constexpr const char* kFsTypes[] = {"readdir",
+                                             "readdirwithstats",
+                                             "readfilemapped",
+                                             "rmrecursive",
+                                             "cprecursive",
+                                             "sendfile",
+                                             "http2_sendfile"};
+  for (const char* fs_type : kFsTypes) {
+    if (strcmp(type, fs_type) == 0) return kThreadPoolWorkFs;
+  }
+  if (strcmp(type, "crypto") == 0) return kThreadPoolWorkCrypto;
+  if (strcmp(type, "zlib") == 0) return kThreadPoolWorkZlib;
+  return kThreadPoolWorkUser;
+}
+
+const char* ThreadPoolWorkQueue::GetCategoryName(Category category) {
+  switch (category) {
+    case kThreadPoolWorkFs:
+      return "fs";
+    case kThreadPoolWorkCrypto:
+      return "crypto";
+    case kThreadPoolWorkZlib:
+      return "zlib";
+    case kThreadPoolWorkUser:
+      return "user";
+    default:
+      UNREACHABLE();
+  }
+}
+
+int ThreadPoolWorkQueue::Queue(Category category,
+                               uv_work_t* req,
+                               uv_work_cb work_cb,
+                               uv_after_work_cb after_work_cb) {
+  Lane* lane = &lanes_[category];
+  if (lane->active >= lane->limit) {
+    lane->pending.push_back(Pending{req, work_cb, after_work_cb});
+    return 0;
+  }
+  int status = uv_queue_work(env_->event_loop(), req, work_cb, after_work_cb);
+  if (status == 0) lane->active++;
+  return status;
+}
+
+void ThreadPoolWorkQueue::Done(Category category) {
+  Lane* lane = &lanes_[category];
+  CHECK_GT(lane->active, 0);
+  lane->active--;
+  TraceCounters(category);
+  while (!lane->pending.empty() && lane->active < lane->limit) {
+    Pending next = lane->pending.front();
+    lane->pending.pop_front();
+    int status = uv_queue_work(
+        env_->event_loop(), next.req, next.work_cb, next.after_work_cb);
+    CHECK_EQ(status, 0);
+    lane->active++;
+  }
+}
+
+int ThreadPoolWorkQueue::Cancel(Category category, uv_work_t* req) {
+  Lane* lane = &lanes_[category];
+  auto it = std::find_if(lane->pending.begin(),
+                         lane->pending.end(),
+                         [req](const Pending& pending) {
+                           return pending.req == req;
+                         });
+  if (it == lane->pending.end())
+    return uv_cancel(reinterpret_cast<uv_req_t*>(req));
+
+  // As with uv_cancel(), the callback runs later with UV_ECANCELED. The work
+  // counts as active until then because the callback calls Done().
+  uv_after_work_cb after_work_cb = it->after_work_cb;
+  lane->pending.erase(it);
+  lane->active++;
+  env_->SetImmediate([req, after_work_cb](Environment* env) {
+    after_work_cb(req, UV_ECANCELED);
+  });
+  return 0;
+}
+
+uint64_t ThreadPoolWorkQueue::WorkQueued(Category category) {
+  lanes_[category].queued.fetch_add(1, std::memory_order_relaxed);
+  TraceCounters(category);
+  return monitoring_ ? uv_hrtime() : 0;
+}
+
+uint64_t ThreadPoolWorkQueue::WorkStarted(Category category,
+                                          uint64_t queued_at) {
+  Lane* lane = &lanes_[category];
+  lane->queued.fetch_sub(1, std::memory_order_relaxed);
+  lane->running.fetch_add(1, std::memory_order_relaxed);
+  if (queued_at == 0) return 0;
+  uint64_t now = uv_hrtime();
+  lane->wait_time->Record(std::max<int64_t>(now - queued_at, 1));
+  return now;
+}
+
+void ThreadPoolWorkQueue::WorkFinished(Category category,
+                                       uint64_t started_at) {
+  Lane* lane = &lanes_[category];
+  lane->running.fetch_sub(1, std::memory_order_relaxed);
+  if (started_at == 0) return;
+  lane->run_time->Record(std::max<int64_t>(uv_hrtime() - started_at, 1));
+}
+
+void ThreadPoolWorkQueue::WorkCancelled(Category category) {
+  lanes_[category].queued.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPoolWorkQueue::StartMonitoring() {
+  for (Lane& lane : lanes_) {
+    if (!lane.wait_time) {
+      // Recorded from every threadpool thread.
+      Histogram::Options options;
+      options.concurrent = true;
+      lane.wait_time = std::make_shared<Histogram>(options);
+      lane.run_time = std::make_shared<Histogram>(options);
+    }
+  }
+  monitoring_ = true;
+}
+
+void ThreadPoolWorkQueue::TraceCounters(Category category) const {
+  TRACE_COUNTER2(TRACING_CATEGORY_NODE2(threadpoolwork, counters),
+                 GetCategoryName(category),
+                 "queued",
+                 queued(category),
+                 "running",
+                 running(category));
+}
+
+ThreadPoolWorkQueue* Environment::threadpool_work_queue() {
+  if (!threadpool_work_queue_)
+    threadpool_work_queue_ = std::make_unique<ThreadPoolWorkQueue>(this);
+  return threadpool_work_queue_.get();
+}
+
+}  // namespace node
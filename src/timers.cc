@@ -1,24 +1,171 @@
 #include "timers.h"
 #include "env-inl.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_internals.h"
+#include "timer_wrap-inl.h"
 #include "util-inl.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cstdint>
 
 namespace node {
 namespace timers {
 
+using v8::ArrayBuffer;
 using v8::Context;
 using v8::Function;
 using v8::FunctionCallbackInfo;
+using v8::HandleScope;
+using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
+using v8::Uint32Array;
 using v8::Value;
 
+TimerWheel::TimerWheel() : slots_(kSlotCount, kInvalidId) {}
+
+uint32_t TimerWheel::Insert(uint64_t now, uint64_t duration_ms, bool ref) {
+  uint32_t id;
+  if (free_head_ != kInvalidId) {
+    id = free_head_;
+    free_head_ = entries_[id].next;
+  } else {
+    CHECK_LT(entries_.size(), kInvalidId);
+    id = static_cast<uint32_t>(entries_.size());
+    entries_.emplace_back();
+  }
+  // Skip the slots that passed while the wheel was empty.
+  if (scheduled_count_ == 0)
+    current_tick_ = std::max(current_tick_, now / kResolutionMs);
+
+  Entry& entry = entries_[id];
+  entry.duration_ms = duration_ms;
+  entry.ref = ref;
+  Link(id, now);
+  return id;
+}
+
+void TimerWheel::Cancel(uint32_t id) {
+  if (!IsValid(id, State::kScheduled)) return;
+  Unlink(id);
+  Entry& entry = entries_[id];
+  entry.state = State::kFree;
+  entry.next = free_head_;
+  free_head_ = id;
+}
+
+bool TimerWheel::Refresh(uint32_t id, uint64_t now) {
+  if (IsValid(id, State::kScheduled)) {
+    Unlink(id);
+  } else if (!IsValid(id, State::kExpired)) {
+    return false;
+  }
+  Link(id, now);
+  return true;
+}
+
+void TimerWheel::SetRef(uint32_t id, bool ref) {
+  if (id >= entries_.size()) return;
+  Entry& entry = entries_[id];
+  if (entry.state == State::kFree || entry.ref == ref) return;
+  entry.ref = ref;
+  if (entry.state == State::kScheduled) {
+    if (ref)
+      refed_count_++;
+    else
+      refed_count_--;
+  }
+}
+
+void TimerWheel::Advance(uint64_t now, std::vector<uint32_t>* expired) {
+  uint64_t target = now / kResolutionMs;
+  if (target <= current_tick_) return;
+
+  // Every scheduled timer expires after current_tick_, so walking at most
+  // one rotation visits all timers that are due.
+  uint64_t steps = std::min<uint64_t>(target - current_tick_, kSlotCount);
+  for (uint64_t i = 1; i <= steps; i++) {
+    uint32_t id = slots_[(current_tick_ + i) & (kSlotCount - 1)];
+    while (id != kInvalidId) {
+      Entry& entry = entries_[id];
+      uint32_t next = entry.next;
+      if (entry.expiry_tick <= target) {
+        Unlink(id);
+        entry.state = State::kExpired;
+        expired->push_back(id);
+      }
+      id = next;
+    }
+  }
+  current_tick_ = target;
+}
+
+void TimerWheel::ReleaseExpired(const std::vector<uint32_t>& expired) {
+  for (uint32_t id : expired) {
+    // Timers refreshed while the batch was delivered are scheduled again.
+    if (!IsValid(id, State::kExpired)) continue;
+    Entry& entry = entries_[id];
+    entry.state = State::kFree;
+    entry.next = free_head_;
+    free_head_ = id;
+  }
+}
+
+uint64_t TimerWheel::NextTickTime() const {
+  if (scheduled_count_ == 0) return UINT64_MAX;
+  for (uint64_t tick = current_tick_ + 1;; tick++) {
+    if (slots_[tick & (kSlotCount - 1)] != kInvalidId)
+      return tick * kResolutionMs;
+  }
+}
+
+uint64_t TimerWheel::ExpiryTime(uint32_t id) const {
+  DCHECK(IsValid(id, State::kScheduled));
+  return entries_[id].expiry_tick * kResolutionMs;
+}
+
+size_t TimerWheel::SelfSize() const {
+  return entries_.capacity() * sizeof(Entry) +
+         slots_.capacity() * sizeof(uint32_t);
+}
+
+void TimerWheel::Link(uint32_t id, uint64_t now) {
+  Entry& entry = entries_[id];
+  // Round up so that timers never fire early.
+  uint64_t expiry_tick =
+      (now + entry.duration_ms + kResolutionMs - 1) / kResolutionMs;
+  entry.expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+
+  uint32_t& head = slots_[entry.expiry_tick & (kSlotCount - 1)];
+  entry.prev = kInvalidId;
+  entry.next = head;
+  if (head != kInvalidId) entries_[head].prev = id;
+  head = id;
+
+  entry.state = State::kScheduled;
+  scheduled_count_++;
+  if (entry.ref) refed_count_++;
+}
+
+void TimerWheel::Unlink(uint32_t id) {
+  Entry& entry = entries_[id];
+  if (entry.prev != kInvalidId) {
+    entries_[entry.prev].next = entry.next;
+  } else {
+    slots_[entry.expiry_tick & (kSlotCount - 1)] = entry.next;
+  }
+  if (entry.next != kInvalidId) entries_[entry.next].prev = entry.prev;
+
+  scheduled_count_--;
+  if (entry.ref) refed_count_--;
+}
+
 void BindingData::SetupTimers(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsFunction());
   CHECK(args[1]->IsFunction());
@@ -83,11 +230,187 @@ void BindingData::ToggleImmediateRefImpl(BindingData* data, bool ref) {
   data->env()->ToggleImmediateRef(ref);
 }
 
+void BindingData::SetupTimerWheel(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsFunction());
+  Isolate* isolate = args.GetIsolate();
+  BindingData* data = Realm::GetBindingData<BindingData>(args);
+
+  data->timer_wheel_callback_.Reset(isolate, args[0].As<Function>());
+  if (!data->timer_wheel_batch_store_) {
+    data->timer_wheel_batch_store_ = ArrayBuffer::NewBackingStore(
+        isolate, kTimerWheelBatchSize * sizeof(uint32_t));
+  }
+  // The callback is called with the number of expired ids that were written
+  // to the start of this array.
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(isolate, data->timer_wheel_batch_store_);
+  args.GetReturnValue().Set(Uint32Array::New(ab, 0, kTimerWheelBatchSize));
+}
+
+void BindingData::SlowTimerWheelInsert(
+    const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  uint32_t id =
+      TimerWheelInsertImpl(Realm::GetBindingData<BindingData>(args),
+                           args[0].As<v8::Uint32>()->Value(),
+                           args[1]->IsTrue());
+  args.GetReturnValue().Set(id);
+}
+
+uint32_t BindingData::FastTimerWheelInsert(Local<Object> receiver,
+                                           uint32_t duration,
+                                           bool ref) {
+  return TimerWheelInsertImpl(FromJSObject<BindingData>(receiver),
+                              duration,
+                              ref);
+}
+
+uint32_t BindingData::TimerWheelInsertImpl(BindingData* data,
+                                           uint32_t duration,
+                                           bool ref) {
+  CHECK(!data->timer_wheel_callback_.IsEmpty());
+  uint64_t now = data->env()->GetNowUint64();
+  uint32_t id = data->timer_wheel_.Insert(now, duration, ref);
+  data->UpdateTimerWheelHandle(data->timer_wheel_.ExpiryTime(id), now);
+  return id;
+}
+
+void BindingData::SlowTimerWheelCancel(
+    const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  TimerWheelCancelImpl(Realm::GetBindingData<BindingData>(args),
+                       args[0].As<v8::Uint32>()->Value());
+}
+
+void BindingData::FastTimerWheelCancel(Local<Object> receiver, uint32_t id) {
+  TimerWheelCancelImpl(FromJSObject<BindingData>(receiver), id);
+}
+
+void BindingData::TimerWheelCancelImpl(BindingData* data, uint32_t id) {
+  data->timer_wheel_.Cancel(id);
+  // The driving timer is left running when other timers remain; at worst it
+  // fires once without expiring anything.
+  data->UpdateTimerWheelHandle(UINT64_MAX, 0);
+}
+
+void BindingData::SlowTimerWheelRefresh(
+    const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  TimerWheelRefreshImpl(Realm::GetBindingData<BindingData>(args),
+                        args[0].As<v8::Uint32>()->Value());
+}
+
+void BindingData::FastTimerWheelRefresh(Local<Object> receiver, uint32_t id) {
+  TimerWheelRefreshImpl(FromJSObject<BindingData>(receiver), id);
+}
+
+void BindingData::TimerWheelRefreshImpl(BindingData* data, uint32_t id) {
+  uint64_t now = data->env()->GetNowUint64();
+  if (!data->timer_wheel_.Refresh(id, now)) return;
+  data->UpdateTimerWheelHandle(data->timer_wheel_.ExpiryTime(id), now);
+}
+
+void BindingData::SlowTimerWheelToggleRef(
+    const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsUint32());
+  TimerWheelToggleRefImpl(Realm::GetBindingData<BindingData>(args),
+                          args[0].As<v8::Uint32>()->Value(),
+                          args[1]->IsTrue());
+}
+
+void BindingData::FastTimerWheelToggleRef(Local<Object> receiver,
+                                          uint32_t id,
+                                          bool ref) {
+  TimerWheelToggleRefImpl(FromJSObject<BindingData>(receiver), id, ref);
+}
+
+void BindingData::TimerWheelToggleRefImpl(BindingData* data,
+                                          uint32_t id,
+                                          bool ref) {
+  data->timer_wheel_.SetRef(id, ref);
+  data->UpdateTimerWheelHandle(UINT64_MAX, 0);
+}
+
+void BindingData::UpdateTimerWheelHandle(uint64_t expiry, uint64_t now) {
+  if (timer_wheel_.scheduled_count() == 0) {
+    timer_wheel_handle_.Stop();
+    timer_wheel_scheduled_time_ = UINT64_MAX;
+  } else if (expiry < timer_wheel_scheduled_time_) {
+    timer_wheel_handle_.Update(expiry > now ? expiry - now : 0);
+    timer_wheel_scheduled_time_ = expiry;
+  }
+
+  bool refed = timer_wheel_.refed_count() > 0;
+  if (refed == timer_wheel_handle_refed_) return;
+  timer_wheel_handle_refed_ = refed;
+  if (refed)
+    timer_wheel_handle_.Ref();
+  else
+    timer_wheel_handle_.Unref();
+}
+
+void BindingData::OnTimerWheelTick() {
+  Environment* env = this->env();
+  timer_wheel_scheduled_time_ = UINT64_MAX;
+
+  timer_wheel_expired_.clear();
+  timer_wheel_.Advance(env->GetNowUint64(), &timer_wheel_expired_);
+  if (!timer_wheel_expired_.empty()) {
+    if (!env->can_call_into_js()) return;
+    DeliverExpiredTimers();
+    timer_wheel_.ReleaseExpired(timer_wheel_expired_);
+    timer_wheel_expired_.clear();
+  }
+
+  UpdateTimerWheelHandle(timer_wheel_.NextTickTime(), env->GetNowUint64());
+}
+
+void BindingData::DeliverExpiredTimers() {
+  TRACE_EVENT0(TRACING_CATEGORY_NODE1(environment), "RunTimerWheel");
+  Environment* env = this->env();
+  performance::LoopPhaseTimer::Scope phase_scope(
+      env->loop_phase_timer(), performance::NODE_PERFORMANCE_LOOP_PHASE_TIMERS);
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+
+  Local<Object> process = env->process_object();
+  InternalCallbackScope scope(env, process, {0, 0});
+
+  Local<Function> cb = timer_wheel_callback_.Get(isolate);
+  uint32_t* batch = static_cast<uint32_t*>(timer_wheel_batch_store_->Data());
+  size_t expired_count = timer_wheel_expired_.size();
+  // An exception thrown for one batch is reported and does not keep the
+  // remaining batches from being delivered.
+  for (size_t offset = 0; offset < expired_count && env->can_call_into_js();
+       offset += kTimerWheelBatchSize) {
+    uint32_t count = static_cast<uint32_t>(
+        std::min<size_t>(expired_count - offset, kTimerWheelBatchSize));
+    std::copy_n(timer_wheel_expired_.begin() + offset, count, batch);
+    Local<Value> arg = Integer::NewFromUnsigned(isolate, count);
+    errors::TryCatchScope try_catch(env);
+    try_catch.SetVerbose(true);
+    USE(cb->Call(env->context(), process, 1, &arg));
+  }
+}
+
 BindingData::BindingData(Realm* realm, Local<Object> object)
-    : SnapshotableObject(realm, object, type_int) {}
+    : SnapshotableObject(realm, object, type_int),
+      timer_wheel_handle_(realm->env(), [this]() { OnTimerWheelTick(); }) {}
+
+void BindingData::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("timer_wheel", timer_wheel_.SelfSize());
+  tracker->TrackField("timer_wheel_handle", timer_wheel_handle_);
+  tracker->TrackField("timer_wheel_callback", timer_wheel_callback_);
+}
 
 bool BindingData::PrepareForSerialization(Local<Context> context,
                                           v8::SnapshotCreator* creator) {
+  // The wheel is not serialized, so setupTimerWheel() has to be called again
+  // after deserialization.
+  CHECK_EQ(timer_wheel_.scheduled_count(), 0);
+  timer_wheel_callback_.Reset();
+  timer_wheel_batch_store_.reset();
   // Return true because we need to maintain the reference to the binding from
   // JS land.
   return true;
@@ -120,6 +443,14 @@ v8::CFunction BindingData::fast_toggle_timer_ref_(
     v8::CFunction::Make(FastToggleTimerRef));
 v8::CFunction BindingData::fast_toggle_immediate_ref_(
     v8::CFunction::Make(FastToggleImmediateRef));
+v8::CFunction BindingData::fast_timer_wheel_insert_(
+    v8::CFunction::Make(FastTimerWheelInsert));
+v8::CFunction BindingData::fast_timer_wheel_cancel_(
+    v8::CFunction::Make(FastTimerWheelCancel));
+v8::CFunction BindingData::fast_timer_wheel_refresh_(
+    v8::CFunction::Make(FastTimerWheelRefresh));
+v8::CFunction BindingData::fast_timer_wheel_toggle_ref_(
+    v8::CFunction::Make(FastTimerWheelToggleRef));
 
 void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
                                              Local<ObjectTemplate> target) {
@@ -143,6 +474,33 @@ void BindingData::CreatePerIsolateProperties(IsolateData* isolate_data,
                 "toggleImmediateRef",
                 SlowToggleImmediateRef,
                 &fast_toggle_immediate_ref_);
+
+  SetMethod(isolate, target, "setupTimerWheel", SetupTimerWheel);
+  SetFastMethod(isolate,
+                target,
+                "timerWheelInsert",
+                SlowTimerWheelInsert,
+                &fast_timer_wheel_insert_);
+  SetFastMethod(isolate,
+                target,
+                "timerWheelCancel",
+                SlowTimerWheelCancel,
+                &fast_timer_wheel_cancel_);
+  SetFastMethod(isolate,
+                target,
+                "timerWheelRefresh",
+                SlowTimerWheelRefresh,
+                &fast_timer_wheel_refresh_);
+  SetFastMethod(isolate,
+                target,
+                "timerWheelToggleRef",
+                SlowTimerWheelToggleRef,
+                &fast_timer_wheel_toggle_ref_);
+  target->Set(FIXED_ONE_BYTE_STRING(isolate, "kTimerWheelMinDuration"),
+              Integer::NewFromUnsigned(isolate, kTimerWheelMinDurationMs));
+  target->Set(FIXED_ONE_BYTE_STRING(isolate, "kTimerWheelResolution"),
+              Integer::NewFromUnsigned(
+                  isolate, static_cast<uint32_t>(TimerWheel::kResolutionMs)));
 }
 
 void BindingData::CreatePerContextProperties(Local<Object> target,
@@ -187,6 +545,24 @@ void BindingData::RegisterTimerExternalReferences(
   registry->Register(SlowToggleImmediateRef);
   registry->Register(FastToggleImmediateRef);
   registry->Register(fast_toggle_immediate_ref_.GetTypeInfo());
+
+  registry->Register(SetupTimerWheel);
+
+  registry->Register(SlowTimerWheelInsert);
+  registry->Register(FastTimerWheelInsert);
+  registry->Register(fast_timer_wheel_insert_.GetTypeInfo());
+
+  registry->Register(SlowTimerWheelCancel);
+  registry->Register(FastTimerWheelCancel);
+  registry->Register(fast_timer_wheel_cancel_.GetTypeInfo());
+
+  registry->Register(SlowTimerWheelRefresh);
+  registry->Register(FastTimerWheelRefresh);
+  registry->Register(fast_timer_wheel_refresh_.GetTypeInfo());
+
+  registry->Register(SlowTimerWheelToggleRef);
+  registry->Register(FastTimerWheelToggleRef);
+  registry->Register(fast_timer_wheel_toggle_ref_.GetTypeInfo());
 }
 
 }  // namespace timers
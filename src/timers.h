@@ -4,12 +4,87 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include <cinttypes>
+#include <vector>
 #include "node_snapshotable.h"
+#include "timer_wrap.h"
 
 namespace node {
 class ExternalReferenceRegistry;
 
 namespace timers {
+
+// A hashed timer wheel for coarse timeouts, such as per-connection idle
+// timeouts, where JS would otherwise keep one list per duration and pay for
+// list manipulation on every refresh. Timers are identified by the index of
+// their entry, and each slot holds an intrusive doubly linked list of
+// entries, so inserting, cancelling and refreshing a timer are O(1).
+// Expiry times are rounded up to the next tick, so timers never fire early
+// but may fire up to kResolutionMs late. Times are in milliseconds on the
+// same clock as getLibuvNow().
+class TimerWheel {
+ public:
+  static constexpr uint64_t kResolutionMs = 32;
+  static constexpr uint32_t kSlotCount = 1024;
+  static constexpr uint32_t kInvalidId = UINT32_MAX;
+
+  TimerWheel();
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Returns the id of the new timer.
+  uint32_t Insert(uint64_t now, uint64_t duration_ms, bool ref);
+  // Cancelling an unknown or already expired id is a no-op.
+  void Cancel(uint32_t id);
+  // Reschedules the timer to expire duration_ms after now. Refreshing a timer
+  // that has expired in the current batch schedules it again. Returns false
+  // if id does not name a timer that can be refreshed.
+  bool Refresh(uint32_t id, uint64_t now);
+  void SetRef(uint32_t id, bool ref);
+
+  // Unlinks all timers that are due at now and appends their ids to
+  // expired. The ids stay reserved until ReleaseExpired() so that timers
+  // inserted while the batch is delivered cannot reuse them.
+  void Advance(uint64_t now, std::vector<uint32_t>* expired);
+  void ReleaseExpired(const std::vector<uint32_t>& expired);
+
+  // Returns the time, in milliseconds, at which the wheel next needs to be
+  // advanced, or UINT64_MAX if no timer is scheduled. This may be earlier
+  // than the nearest expiry when the nearest occupied slot only holds timers
+  // for a later rotation.
+  uint64_t NextTickTime() const;
+  // Returns the time, in milliseconds, at which a scheduled timer is due.
+  uint64_t ExpiryTime(uint32_t id) const;
+
+  size_t scheduled_count() const { return scheduled_count_; }
+  size_t refed_count() const { return refed_count_; }
+  size_t SelfSize() const;
+
+ private:
+  enum class State : uint8_t { kFree, kScheduled, kExpired };
+
+  struct Entry {
+    uint64_t expiry_tick;
+    uint64_t duration_ms;
+    uint32_t prev;
+    uint32_t next;
+    State state;
+    bool ref;
+  };
+
+  bool IsValid(uint32_t id, State state) const {
+    return id < entries_.size() && entries_[id].state == state;
+  }
+  void Link(uint32_t id, uint64_t now);
+  void Unlink(uint32_t id);
+
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> slots_;
+  uint32_t free_head_ = kInvalidId;
+  uint64_t current_tick_ = 0;
+  size_t scheduled_count_ = 0;
+  size_t refed_count_ = 0;
+};
+
 class BindingData : public SnapshotableObject {
  public:
   BindingData(Realm* env, v8::Local<v8::Object> obj);
@@ -19,7 +94,7 @@ class BindingData : public SnapshotableObject {
   SET_BINDING_ID(timers_binding_data)
   SERIALIZABLE_OBJECT_METHODS()
 
-  SET_NO_MEMORY_INFO()
+  void MemoryInfo(MemoryTracker* tracker) const override;
   SET_SELF_SIZE(BindingData)
   SET_MEMORY_INFO_NAME(BindingData)
 
@@ -45,6 +120,36 @@ class BindingData : public SnapshotableObject {
   static void FastToggleImmediateRef(v8::Local<v8::Object> receiver, bool ref);
   static void ToggleImmediateRefImpl(BindingData* data, bool ref);
 
+  static void SetupTimerWheel(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  static void SlowTimerWheelInsert(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static uint32_t FastTimerWheelInsert(v8::Local<v8::Object> receiver,
+                                       uint32_t duration,
+                                       bool ref);
+  static uint32_t TimerWheelInsertImpl(BindingData* data,
+                                       uint32_t duration,
+                                       bool ref);
+
+  static void SlowTimerWheelCancel(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void FastTimerWheelCancel(v8::Local<v8::Object> receiver,
+                                   uint32_t id);
+  static void TimerWheelCancelImpl(BindingData* data, uint32_t id);
+
+  static void SlowTimerWheelRefresh(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void FastTimerWheelRefresh(v8::Local<v8::Object> receiver,
+                                    uint32_t id);
+  static void TimerWheelRefreshImpl(BindingData* data, uint32_t id);
+
+  static void SlowTimerWheelToggleRef(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void FastTimerWheelToggleRef(v8::Local<v8::Object> receiver,
+                                      uint32_t id,
+                                      bool ref);
+  static void TimerWheelToggleRefImpl(BindingData* data, uint32_t id, bool ref);
+
   static void CreatePerIsolateProperties(IsolateData* isolate_data,
                                          v8::Local<v8::ObjectTemplate> target);
   static void CreatePerContextProperties(v8::Local<v8::Object> target,
@@ -55,10 +160,35 @@ class BindingData : public SnapshotableObject {
       ExternalReferenceRegistry* registry);
 
  private:
+  // Timers with a duration below this stay on the precise JS lists.
+  static constexpr uint32_t kTimerWheelMinDurationMs = 1000;
+  // Maximum number of expired ids delivered to JS in one callback.
+  static constexpr uint32_t kTimerWheelBatchSize = 1024;
+
+  void OnTimerWheelTick();
+  void DeliverExpiredTimers();
+  // Moves the driving timer earlier if expiry is before the time it is
+  // scheduled for, stops it if the wheel is empty, and refs or unrefs it to
+  // match the timers in the wheel.
+  void UpdateTimerWheelHandle(uint64_t expiry, uint64_t now);
+
+  TimerWheel timer_wheel_;
+  TimerWrapHandle timer_wheel_handle_;
+  bool timer_wheel_handle_refed_ = false;
+  // Absolute time at which the driving timer fires, UINT64_MAX if stopped.
+  uint64_t timer_wheel_scheduled_time_ = UINT64_MAX;
+  std::vector<uint32_t> timer_wheel_expired_;
+  v8::Global<v8::Function> timer_wheel_callback_;
+  std::shared_ptr<v8::BackingStore> timer_wheel_batch_store_;
+
   static v8::CFunction fast_get_libuv_now_;
   static v8::CFunction fast_schedule_timers_;
   static v8::CFunction fast_toggle_timer_ref_;
   static v8::CFunction fast_toggle_immediate_ref_;
+  static v8::CFunction fast_timer_wheel_insert_;
+  static v8::CFunction fast_timer_wheel_cancel_;
+  static v8::CFunction fast_timer_wheel_refresh_;
+  static v8::CFunction fast_timer_wheel_toggle_ref_;
 };
 
 }  // namespace timers
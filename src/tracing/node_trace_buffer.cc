@@ -1,38 +1,84 @@
 #include "tracing/node_trace_buffer.h"
 
 #include <memory>
+#include <thread>
 #include "util-inl.h"
 
 namespace node {
 namespace tracing {
 
+namespace {
+
+// Epochs are unique across all buffers, so that an ownership record can
+// never match a different buffer that reuses the same address.
+std::atomic<uint32_t> next_epoch{1};
+
+// The chunk the current thread owns in each of the two buffers of a
+// NodeTraceBuffer, indexed by buffer id.
+struct ChunkOwnership {
+  uint32_t epoch = 0;
+  size_t chunk_index = 0;
+};
+thread_local ChunkOwnership owned_chunks[2];
+
+}  // namespace
+
 InternalTraceBuffer::InternalTraceBuffer(size_t max_chunks, uint32_t id,
                                          Agent* agent)
-    : flushing_(false), max_chunks_(max_chunks),
-      agent_(agent), id_(id) {
+    : epoch_(next_epoch++), max_chunks_(max_chunks),
+      agent_(agent), chunk_states_(new ChunkState[max_chunks]), id_(id) {
   chunks_.resize(max_chunks);
 }
 
-TraceObject* InternalTraceBuffer::AddTraceEvent(uint64_t* handle) {
-  Mutex::ScopedLock scoped_lock(mutex_);
-  // Create new chunk if last chunk is full or there is no chunk.
-  if (total_chunks_ == 0 || chunks_[total_chunks_ - 1]->IsFull()) {
-    auto& chunk = chunks_[total_chunks_++];
-    if (chunk) {
-      chunk->Reset(current_chunk_seq_++);
-    } else {
-      chunk = std::make_unique<TraceBufferChunk>(current_chunk_seq_++);
-    }
-  }
-  auto& chunk = chunks_[total_chunks_ - 1];
+TraceObject* InternalTraceBuffer::AddToChunk(size_t chunk_index,
+                                             uint64_t* handle) {
+  auto& chunk = chunks_[chunk_index];
+  if (chunk->IsFull()) return nullptr;
   size_t event_index;
   TraceObject* trace_object = chunk->AddTraceEvent(&event_index);
-  *handle = MakeHandle(total_chunks_ - 1, chunk->seq(), event_index);
+  chunk_states_[chunk_index].committed.store(event_index + 1,
+                                             std::memory_order_release);
+  *handle = MakeHandle(chunk_index, chunk->seq(), event_index);
   return trace_object;
 }
 
-TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
+TraceObject* InternalTraceBuffer::AddTraceEvent(uint64_t* handle) {
+  ChunkOwnership& owned = owned_chunks[id_];
+  if (owned.epoch == epoch_.load(std::memory_order_relaxed)) {
+    ChunkState& state = chunk_states_[owned.chunk_index];
+    // Pairs with Flush(): either the flush sees this thread busy and waits
+    // for it, or this thread sees the new epoch and leaves the chunk alone.
+    state.busy.store(true);
+    TraceObject* trace_object = nullptr;
+    if (owned.epoch == epoch_.load())
+      trace_object = AddToChunk(owned.chunk_index, handle);
+    state.busy.store(false, std::memory_order_release);
+    if (trace_object != nullptr) return trace_object;
+  }
+
   Mutex::ScopedLock scoped_lock(mutex_);
+  if (total_chunks_ == max_chunks_) {
+    full_.store(true, std::memory_order_release);
+    return nullptr;
+  }
+  size_t chunk_index = total_chunks_++;
+  auto& chunk = chunks_[chunk_index];
+  if (chunk) {
+    chunk->Reset(current_chunk_seq_++);
+  } else {
+    chunk = std::make_unique<TraceBufferChunk>(current_chunk_seq_++);
+  }
+  chunk_states_[chunk_index].committed.store(0, std::memory_order_relaxed);
+  chunk_states_[chunk_index].seq.store(chunk->seq(),
+                                       std::memory_order_release);
+  if (total_chunks_ == max_chunks_)
+    full_.store(true, std::memory_order_release);
+  owned.epoch = epoch_.load(std::memory_order_relaxed);
+  owned.chunk_index = chunk_index;
+  return AddToChunk(chunk_index, handle);
+}
+
+TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
   if (handle == 0) {
     // A handle value of zero never has a trace event associated with it.
     return nullptr;
@@ -40,28 +86,35 @@ TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
   size_t chunk_index, event_index;
   uint32_t buffer_id, chunk_seq;
   ExtractHandle(handle, &buffer_id, &chunk_index, &chunk_seq, &event_index);
-  if (buffer_id != id_ || chunk_index >= total_chunks_) {
-    // Either the chunk belongs to the other buffer, or is outside the current
-    // range of chunks loaded in memory (the latter being true suggests that
-    // the chunk has already been flushed and is no longer in memory.)
+  if (buffer_id != id_ || chunk_index >= max_chunks_) {
     return nullptr;
   }
-  auto& chunk = chunks_[chunk_index];
-  if (chunk->seq() != chunk_seq) {
-    // Chunk is no longer in memory.
+  if (chunk_states_[chunk_index].seq.load(std::memory_order_acquire) !=
+      chunk_seq) {
+    // The chunk has already been flushed and is no longer in memory.
     return nullptr;
   }
-  return chunk->GetEventAt(event_index);
+  return chunks_[chunk_index]->GetEventAt(event_index);
 }
 
 void InternalTraceBuffer::Flush(bool blocking) {
   {
     Mutex::ScopedLock scoped_lock(mutex_);
     if (total_chunks_ > 0) {
-      flushing_ = true;
+      flushing_.store(true, std::memory_order_release);
+      // Take the chunks back from their owners. Once an owner that was in
+      // the middle of adding an event is done, nobody writes to them.
+      epoch_.store(next_epoch++);
+      for (size_t i = 0; i < total_chunks_; ++i) {
+        while (chunk_states_[i].busy.load()) {
+          std::this_thread::yield();
+        }
+      }
       for (size_t i = 0; i < total_chunks_; ++i) {
         auto& chunk = chunks_[i];
-        for (size_t j = 0; j < chunk->size(); ++j) {
+        ChunkState& state = chunk_states_[i];
+        size_t committed = state.committed.load(std::memory_order_acquire);
+        for (size_t j = 0; j < committed; ++j) {
           TraceObject* trace_event = chunk->GetEventAt(j);
           // Another thread may have added a trace that is yet to be
           // initialized. Skip such traces.
@@ -70,9 +123,11 @@ void InternalTraceBuffer::Flush(bool blocking) {
             agent_->AppendTraceEvent(trace_event);
           }
         }
+        state.seq.store(0, std::memory_order_relaxed);
       }
       total_chunks_ = 0;
-      flushing_ = false;
+      full_.store(false, std::memory_order_release);
+      flushing_.store(false, std::memory_order_release);
     }
   }
   agent_->Flush(blocking);
@@ -129,11 +184,17 @@ TraceObject* NodeTraceBuffer::AddTraceEvent(uint64_t* handle) {
     *handle = 0;
     return nullptr;
   }
-  return current_buf_.load()->AddTraceEvent(handle);
+  TraceObject* trace_object = current_buf_.load()->AddTraceEvent(handle);
+  // The buffer may have run out of chunks since it was loaded.
+  if (trace_object == nullptr && TryLoadAvailableBuffer())
+    trace_object = current_buf_.load()->AddTraceEvent(handle);
+  if (trace_object == nullptr) *handle = 0;
+  return trace_object;
 }
 
 TraceObject* NodeTraceBuffer::GetEventByHandle(uint64_t handle) {
-  return current_buf_.load()->GetEventByHandle(handle);
+  // The lowest bit of a handle is the id of the buffer it belongs to.
+  return (handle & 1 ? buffer2_ : buffer1_).GetEventByHandle(handle);
 }
 
 bool NodeTraceBuffer::Flush() {
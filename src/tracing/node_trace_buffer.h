@@ -17,6 +17,9 @@ using v8::platform::tracing::TraceObject;
 // forward declaration
 class NodeTraceBuffer;
 
+// Trace events are added without taking a lock: each thread that records
+// events owns a whole chunk at a time and fills it on its own. mutex_ is only
+// taken to hand out a new chunk once a thread's chunk is full, and to flush.
 class InternalTraceBuffer {
  public:
   InternalTraceBuffer(size_t max_chunks, uint32_t id, Agent* agent);
@@ -24,14 +27,26 @@ class InternalTraceBuffer {
   TraceObject* AddTraceEvent(uint64_t* handle);
   TraceObject* GetEventByHandle(uint64_t handle);
   void Flush(bool blocking);
-  bool IsFull() const {
-    return total_chunks_ == max_chunks_ && chunks_[total_chunks_ - 1]->IsFull();
-  }
+  // True once every chunk has been handed out, which is when the buffer
+  // should be flushed.
+  bool IsFull() const { return full_.load(std::memory_order_acquire); }
   bool IsFlushing() const {
-    return flushing_;
+    return flushing_.load(std::memory_order_acquire);
   }
 
  private:
+  struct ChunkState {
+    // Number of events added to the chunk so far, published by its owner.
+    std::atomic<size_t> committed{0};
+    // Sequence number of the chunk while it holds unflushed events, 0
+    // otherwise. Lets GetEventByHandle() check handles without the lock.
+    std::atomic<uint32_t> seq{0};
+    // Set by the owner while it adds an event, so that Flush() can wait for
+    // it before reading the chunk.
+    std::atomic<bool> busy{false};
+  };
+
+  TraceObject* AddToChunk(size_t chunk_index, uint64_t* handle);
   uint64_t MakeHandle(size_t chunk_index, uint32_t chunk_seq,
                       size_t event_index) const;
   void ExtractHandle(uint64_t handle, uint32_t* buffer_id, size_t* chunk_index,
@@ -39,10 +54,15 @@ class InternalTraceBuffer {
   size_t Capacity() const { return max_chunks_ * TraceBufferChunk::kChunkSize; }
 
   Mutex mutex_;
-  bool flushing_;
+  std::atomic<bool> flushing_{false};
+  std::atomic<bool> full_{false};
+  // Changes on every flush. Chunks handed out before a flush are no longer
+  // owned by anyone after it.
+  std::atomic<uint32_t> epoch_;
   size_t max_chunks_;
   Agent* agent_;
   std::vector<std::unique_ptr<TraceBufferChunk>> chunks_;
+  std::unique_ptr<ChunkState[]> chunk_states_;
   size_t total_chunks_ = 0;
   uint32_t current_chunk_seq_ = 1;
   uint32_t id_;
@@ -0,0 +1,291 @@
+#include "tracing/perfetto_trace_writer.h"
+
+#include "tracing/trace_event_common.h"
+
+#include <cstring>
+
+namespace node {
+namespace tracing {
+
+using v8::platform::tracing::TracingController;
+
+namespace {
+
+// Field numbers from the Perfetto protos (protos/perfetto/trace/).
+constexpr int kTracePacket = 1;
+
+constexpr int kPacketTimestamp = 8;
+constexpr int kPacketSequenceId = 10;
+constexpr int kPacketTrackEvent = 11;
+constexpr int kPacketInternedData = 12;
+constexpr int kPacketSequenceFlags = 13;
+constexpr int kPacketTrackDescriptor = 60;
+
+constexpr uint64_t kSeqIncrementalStateCleared = 1;
+constexpr uint64_t kSeqNeedsIncrementalState = 2;
+
+constexpr int kInternedEventCategories = 1;
+constexpr int kInternedEventNames = 2;
+constexpr int kInternedDebugAnnotationNames = 3;
+
+constexpr int kTrackEventCategoryIids = 3;
+constexpr int kTrackEventDebugAnnotations = 4;
+constexpr int kTrackEventLegacyEvent = 6;
+constexpr int kTrackEventNameIid = 10;
+
+constexpr int kLegacyPhase = 2;
+constexpr int kLegacyDurationUs = 3;
+constexpr int kLegacyThreadDurationUs = 4;
+constexpr int kLegacyUnscopedId = 6;
+constexpr int kLegacyIdScope = 7;
+constexpr int kLegacyBindId = 8;
+constexpr int kLegacyLocalId = 10;
+constexpr int kLegacyGlobalId = 11;
+constexpr int kLegacyFlowDirection = 13;
+constexpr int kLegacyPidOverride = 18;
+constexpr int kLegacyTidOverride = 19;
+
+constexpr int kAnnotationNameIid = 1;
+constexpr int kAnnotationBool = 2;
+constexpr int kAnnotationUint = 3;
+constexpr int kAnnotationInt = 4;
+constexpr int kAnnotationDouble = 5;
+constexpr int kAnnotationString = 6;
+constexpr int kAnnotationPointer = 7;
+constexpr int kAnnotationLegacyJson = 9;
+
+constexpr int kTrackDescriptorUuid = 1;
+constexpr int kTrackDescriptorProcess = 3;
+constexpr int kTrackDescriptorThread = 4;
+constexpr int kProcessDescriptorPid = 1;
+constexpr int kProcessDescriptorName = 6;
+constexpr int kThreadDescriptorPid = 1;
+constexpr int kThreadDescriptorTid = 2;
+constexpr int kThreadDescriptorName = 5;
+
+}  // namespace
+
+// Just enough of the protobuf wire format to write TracePackets.
+class PerfettoTraceWriter::ProtoWriter {
+ public:
+  void Varint(int field, uint64_t value) {
+    Key(field, 0);
+    RawVarint(value);
+  }
+
+  void Double(int field, double value) {
+    Key(field, 1);
+    char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    buffer_.append(bytes, sizeof(bytes));
+  }
+
+  void Bytes(int field, std::string_view value) {
+    BytesHeader(field, value.size());
+    buffer_.append(value);
+  }
+
+  // Writes only the key and length of a length-delimited field.
+  void BytesHeader(int field, size_t size) {
+    Key(field, 2);
+    RawVarint(size);
+  }
+
+  void Message(int field, const ProtoWriter& message) {
+    Bytes(field, message.buffer_);
+  }
+
+  bool empty() const { return buffer_.empty(); }
+  const std::string& buffer() const { return buffer_; }
+
+ private:
+  void Key(int field, int wire_type) {
+    RawVarint(static_cast<uint64_t>(field) << 3 | wire_type);
+  }
+
+  void RawVarint(uint64_t value) {
+    while (value >= 0x80) {
+      buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    buffer_.push_back(static_cast<char>(value));
+  }
+
+  std::string buffer_;
+};
+
+PerfettoTraceWriter::PerfettoTraceWriter(std::ostream& stream)
+    : stream_(stream) {}
+
+uint64_t PerfettoTraceWriter::Intern(
+    std::unordered_map<std::string, uint64_t>* table,
+    int field,
+    std::string_view str,
+    ProtoWriter* interned_data) {
+  auto [it, inserted] = table->emplace(str, table->size() + 1);
+  if (inserted) {
+    // EventCategory, EventName and DebugAnnotationName all share this layout.
+    ProtoWriter entry;
+    entry.Varint(1, it->second);
+    entry.Bytes(2, str);
+    interned_data->Message(field, entry);
+  }
+  return it->second;
+}
+
+void PerfettoTraceWriter::AppendTraceEvent(TraceObject* trace_event) {
+  if (trace_event->phase() == TRACE_EVENT_PHASE_METADATA)
+    return AppendMetadata(trace_event);
+
+  ProtoWriter interned_data;
+  ProtoWriter track_event;
+  track_event.Varint(
+      kTrackEventCategoryIids,
+      Intern(&categories_,
+             kInternedEventCategories,
+             TracingController::GetCategoryGroupName(
+                 trace_event->category_enabled_flag()),
+             &interned_data));
+  track_event.Varint(kTrackEventNameIid,
+                     Intern(&event_names_,
+                            kInternedEventNames,
+                            trace_event->name(),
+                            &interned_data));
+
+  for (int i = 0; i < trace_event->num_args(); ++i) {
+    ProtoWriter annotation;
+    annotation.Varint(kAnnotationNameIid,
+                      Intern(&annotation_names_,
+                             kInternedDebugAnnotationNames,
+                             trace_event->arg_names()[i],
+                             &interned_data));
+    const TraceObject::ArgValue& value = trace_event->arg_values()[i];
+    switch (trace_event->arg_types()[i]) {
+      case TRACE_VALUE_TYPE_BOOL:
+        annotation.Varint(kAnnotationBool, value.as_uint != 0);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        annotation.Varint(kAnnotationUint, value.as_uint);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        annotation.Varint(kAnnotationInt, static_cast<uint64_t>(value.as_int));
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE:
+        annotation.Double(kAnnotationDouble, value.as_double);
+        break;
+      case TRACE_VALUE_TYPE_POINTER:
+        annotation.Varint(kAnnotationPointer,
+                          reinterpret_cast<uintptr_t>(value.as_pointer));
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        annotation.Bytes(kAnnotationString,
+                         value.as_string != nullptr ? value.as_string : "");
+        break;
+      case TRACE_VALUE_TYPE_CONVERTABLE: {
+        std::string json;
+        trace_event->arg_convertables()[i]->AppendAsTraceFormat(&json);
+        annotation.Bytes(kAnnotationLegacyJson, json);
+        break;
+      }
+      default:
+        continue;
+    }
+    track_event.Message(kTrackEventDebugAnnotations, annotation);
+  }
+
+  ProtoWriter legacy_event;
+  legacy_event.Varint(kLegacyPhase, trace_event->phase());
+  if (trace_event->phase() == TRACE_EVENT_PHASE_COMPLETE) {
+    legacy_event.Varint(kLegacyDurationUs, trace_event->duration());
+    if (trace_event->cpu_duration() != 0) {
+      legacy_event.Varint(kLegacyThreadDurationUs,
+                          trace_event->cpu_duration());
+    }
+  }
+  unsigned int flags = trace_event->flags();
+  if (flags & TRACE_EVENT_FLAG_HAS_ID) {
+    legacy_event.Varint(kLegacyUnscopedId, trace_event->id());
+  } else if (flags & TRACE_EVENT_FLAG_HAS_LOCAL_ID) {
+    legacy_event.Varint(kLegacyLocalId, trace_event->id());
+  } else if (flags & TRACE_EVENT_FLAG_HAS_GLOBAL_ID) {
+    legacy_event.Varint(kLegacyGlobalId, trace_event->id());
+  }
+  if (trace_event->scope() != nullptr)
+    legacy_event.Bytes(kLegacyIdScope, trace_event->scope());
+  if (flags & (TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT)) {
+    legacy_event.Varint(kLegacyBindId, trace_event->bind_id());
+    // FlowDirection: FLOW_IN = 1, FLOW_OUT = 2, FLOW_INOUT = 3.
+    legacy_event.Varint(kLegacyFlowDirection,
+                        ((flags & TRACE_EVENT_FLAG_FLOW_IN) ? 1 : 0) |
+                            ((flags & TRACE_EVENT_FLAG_FLOW_OUT) ? 2 : 0));
+  }
+  legacy_event.Varint(kLegacyPidOverride, trace_event->pid());
+  legacy_event.Varint(kLegacyTidOverride, trace_event->tid());
+  track_event.Message(kTrackEventLegacyEvent, legacy_event);
+
+  ProtoWriter packet;
+  // Trace event timestamps are in microseconds.
+  packet.Varint(kPacketTimestamp, trace_event->ts() * 1000);
+  packet.Message(kPacketTrackEvent, track_event);
+  if (!interned_data.empty())
+    packet.Message(kPacketInternedData, interned_data);
+  WritePacket(&packet);
+}
+
+void PerfettoTraceWriter::AppendMetadata(TraceObject* trace_event) {
+  // Node.js only emits process_name and thread_name metadata, each with a
+  // single string argument.
+  if (trace_event->num_args() != 1 ||
+      (trace_event->arg_types()[0] != TRACE_VALUE_TYPE_STRING &&
+       trace_event->arg_types()[0] != TRACE_VALUE_TYPE_COPY_STRING)) {
+    return;
+  }
+  const char* name = trace_event->arg_values()[0].as_string;
+  if (name == nullptr) return;
+
+  uint64_t pid = static_cast<uint32_t>(trace_event->pid());
+  uint64_t tid = static_cast<uint32_t>(trace_event->tid());
+  ProtoWriter descriptor;
+  if (strcmp(trace_event->name(), "process_name") == 0) {
+    ProtoWriter process;
+    process.Varint(kProcessDescriptorPid, pid);
+    process.Bytes(kProcessDescriptorName, name);
+    descriptor.Varint(kTrackDescriptorUuid, pid);
+    descriptor.Message(kTrackDescriptorProcess, process);
+  } else if (strcmp(trace_event->name(), "thread_name") == 0) {
+    ProtoWriter thread;
+    thread.Varint(kThreadDescriptorPid, pid);
+    thread.Varint(kThreadDescriptorTid, tid);
+    thread.Bytes(kThreadDescriptorName, name);
+    descriptor.Varint(kTrackDescriptorUuid, pid << 32 | tid);
+    descriptor.Message(kTrackDescriptorThread, thread);
+  } else {
+    return;
+  }
+
+  ProtoWriter packet;
+  packet.Varint(kPacketTimestamp, trace_event->ts() * 1000);
+  packet.Message(kPacketTrackDescriptor, descriptor);
+  WritePacket(&packet);
+}
+
+void PerfettoTraceWriter::WritePacket(ProtoWriter* packet) {
+  // All packets of a file form one sequence, whose interning state starts
+  // out empty with the first packet.
+  packet->Varint(kPacketSequenceId, 1);
+  uint64_t sequence_flags = kSeqNeedsIncrementalState;
+  if (first_packet_) sequence_flags |= kSeqIncrementalStateCleared;
+  packet->Varint(kPacketSequenceFlags, sequence_flags);
+  first_packet_ = false;
+
+  ProtoWriter header;
+  header.BytesHeader(kTracePacket, packet->buffer().size());
+  stream_.write(header.buffer().data(), header.buffer().size());
+  stream_.write(packet->buffer().data(), packet->buffer().size());
+}
+
+void PerfettoTraceWriter::Flush() {}
+
+}  // namespace tracing
+}  // namespace node
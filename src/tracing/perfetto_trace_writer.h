@@ -0,0 +1,56 @@
+#ifndef SRC_TRACING_PERFETTO_TRACE_WRITER_H_
+#define SRC_TRACING_PERFETTO_TRACE_WRITER_H_
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "libplatform/v8-tracing.h"
+
+namespace node {
+namespace tracing {
+
+using v8::platform::tracing::TraceObject;
+using v8::platform::tracing::TraceWriter;
+
+// Writes trace events as a Perfetto protobuf trace (perfetto.protos.Trace),
+// which is a plain sequence of TracePacket messages. This makes every chunk
+// written to the stream a valid trace on its own, so unlike JSON there is no
+// prefix or suffix to write.
+//
+// Events are converted through TrackEvent.legacy_event, which Perfetto keeps
+// for exactly this kind of TRACE_EVENT macro data. Event names, categories
+// and argument names are interned, so each string is only written once per
+// file.
+class PerfettoTraceWriter : public TraceWriter {
+ public:
+  explicit PerfettoTraceWriter(std::ostream& stream);
+
+  void AppendTraceEvent(TraceObject* trace_event) override;
+  void Flush() override;
+
+ private:
+  class ProtoWriter;
+
+  // Returns the iid of `str` in `table`. If it had none yet, one is assigned
+  // and the entry is added to the interned data of the current packet as a
+  // message of type `field` in InternedData.
+  uint64_t Intern(std::unordered_map<std::string, uint64_t>* table,
+                  int field,
+                  std::string_view str,
+                  ProtoWriter* interned_data);
+  void AppendMetadata(TraceObject* trace_event);
+  void WritePacket(ProtoWriter* packet);
+
+  std::ostream& stream_;
+  std::unordered_map<std::string, uint64_t> categories_;
+  std::unordered_map<std::string, uint64_t> event_names_;
+  std::unordered_map<std::string, uint64_t> annotation_names_;
+  bool first_packet_ = true;
+};
+
+}  // namespace tracing
+}  // namespace node
+
+#endif  // SRC_TRACING_PERFETTO_TRACE_WRITER_H_
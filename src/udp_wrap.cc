@@ -29,6 +29,14 @@
 #include "req_wrap-inl.h"
 #include "util-inl.h"
 
+#include <algorithm>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#endif
+
 namespace node {
 
 using errors::TryCatchScope;
@@ -49,6 +57,7 @@ using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
 using v8::Signature;
+using v8::Uint32Array;
 using v8::Uint32;
 using v8::Undefined;
 using v8::Value;
@@ -140,15 +149,18 @@ void UDPWrapBase::RegisterExternalReferences(
   registry->Register(RecvStop);
 }
 
-UDPWrap::UDPWrap(Environment* env, Local<Object> object)
+UDPWrap::UDPWrap(Environment* env, Local<Object> object, uint32_t flags)
     : HandleWrap(env,
                  object,
                  reinterpret_cast<uv_handle_t*>(&handle_),
-                 AsyncWrap::PROVIDER_UDPWRAP) {
+                 AsyncWrap::PROVIDER_UDPWRAP),
+      recv_batch_(flags & kRecvBatch) {
   object->SetAlignedPointerInInternalField(
       UDPWrapBase::kUDPWrapBaseField, static_cast<UDPWrapBase*>(this));
 
-  int r = uv_udp_init(env->event_loop(), &handle_);
+  int r = uv_udp_init_ex(env->event_loop(),
+                         &handle_,
+                         AF_UNSPEC | (recv_batch_ ? UV_UDP_RECVMMSG : 0));
   CHECK_EQ(r, 0);  // can't fail anyway
 
   set_listener(this);
@@ -187,6 +199,9 @@ void UDPWrap::Initialize(Local<Object> target,
   SetProtoMethod(isolate, t, "bind6", Bind6);
   SetProtoMethod(isolate, t, "connect6", Connect6);
   SetProtoMethod(isolate, t, "send6", Send6);
+  SetProtoMethod(isolate, t, "sendBatch", SendBatch);
+  SetProtoMethod(isolate, t, "sendBatch6", SendBatch6);
+  SetProtoMethod(isolate, t, "setGsoSegmentSize", SetGsoSegmentSize);
   SetProtoMethod(isolate, t, "disconnect", Disconnect);
   SetProtoMethod(isolate,
                  t,
@@ -231,6 +246,7 @@ void UDPWrap::Initialize(Local<Object> target,
   Local<Object> constants = Object::New(isolate);
   NODE_DEFINE_CONSTANT(constants, UV_UDP_IPV6ONLY);
   NODE_DEFINE_CONSTANT(constants, UV_UDP_REUSEADDR);
+  NODE_DEFINE_CONSTANT(constants, kRecvBatch);
   target->Set(context,
               env->constants_string(),
               constants).Check();
@@ -248,6 +264,9 @@ void UDPWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Bind6);
   registry->Register(Connect6);
   registry->Register(Send6);
+  registry->Register(SendBatch);
+  registry->Register(SendBatch6);
+  registry->Register(SetGsoSegmentSize);
   registry->Register(Disconnect);
   registry->Register(GetSockOrPeerName<UDPWrap, uv_udp_getpeername>);
   registry->Register(GetSockOrPeerName<UDPWrap, uv_udp_getsockname>);
@@ -268,7 +287,8 @@ void UDPWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
 void UDPWrap::New(const FunctionCallbackInfo<Value>& args) {
   CHECK(args.IsConstructCall());
   Environment* env = Environment::GetCurrent(args);
-  new UDPWrap(env, args.This());
+  uint32_t flags = args[0]->IsUint32() ? args[0].As<Uint32>()->Value() : 0;
+  new UDPWrap(env, args.This(), flags);
 }
 
 
@@ -656,6 +676,139 @@ void UDPWrap::Send6(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+// sendBatch(list, list.length[, port, address]) sends every chunk in |list|
+// as its own datagram. Only what the socket accepts without blocking is
+// sent; the return value is the number of datagrams sent, and the caller
+// queues the remainder through send().
+void UDPWrap::DoSendBatch(const FunctionCallbackInfo<Value>& args,
+                          int family) {
+  Environment* env = Environment::GetCurrent(args);
+
+  UDPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(
+      &wrap, args.This(), args.GetReturnValue().Set(UV_EBADF));
+
+  CHECK(args.Length() == 2 || args.Length() == 4);
+  CHECK(args[0]->IsArray());
+  CHECK(args[1]->IsUint32());
+
+  Local<Array> chunks = args[0].As<Array>();
+  size_t count = args[1].As<Uint32>()->Value();
+
+  MaybeStackBuffer<uv_buf_t, 16> bufs(count);
+  for (size_t i = 0; i < count; i++) {
+    Local<Value> chunk;
+    if (!chunks->Get(env->context(), i).ToLocal(&chunk)) return;
+    bufs[i] = uv_buf_init(Buffer::Data(chunk), Buffer::Length(chunk));
+  }
+
+  int err = 0;
+  struct sockaddr_storage addr_storage;
+  sockaddr* addr = nullptr;
+  if (args.Length() == 4) {
+    CHECK(args[2]->IsUint32());
+    CHECK(args[3]->IsString());
+    const unsigned short port = args[2].As<Uint32>()->Value();
+    node::Utf8Value address(env->isolate(), args[3]);
+    err = sockaddr_for_family(family, address.out(), port, &addr_storage);
+    if (err == 0)
+      addr = reinterpret_cast<sockaddr*>(&addr_storage);
+  }
+
+  if (err == 0)
+    err = static_cast<int>(wrap->SendBatch(*bufs, count, addr));
+
+  args.GetReturnValue().Set(err);
+}
+
+ssize_t UDPWrap::SendBatch(uv_buf_t* bufs, size_t count, const sockaddr* addr) {
+  if (IsHandleClosing()) return UV_EBADF;
+  // Datagrams must go out in order, so do not overtake queued sends.
+  if (uv_udp_get_send_queue_count(&handle_) > 0) return 0;
+
+  size_t sent = 0;
+#if defined(__linux__)
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&handle_), &fd);
+  if (err != 0) return err;
+
+  socklen_t addrlen = 0;
+  if (addr != nullptr) {
+    addrlen = addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6)
+                                          : sizeof(sockaddr_in);
+  }
+
+  // uv_buf_t is layout-compatible with struct iovec on Unix.
+  static constexpr size_t kMaxMessages = 64;
+  mmsghdr msgs[kMaxMessages];
+  while (sent < count) {
+    size_t n = std::min(count - sent, kMaxMessages);
+    memset(msgs, 0, n * sizeof(msgs[0]));
+    for (size_t i = 0; i < n; i++) {
+      msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(addr);
+      msgs[i].msg_hdr.msg_namelen = addrlen;
+      msgs[i].msg_hdr.msg_iov = reinterpret_cast<iovec*>(&bufs[sent + i]);
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int r;
+    do {
+      r = sendmmsg(fd, msgs, n, 0);
+    } while (r == -1 && errno == EINTR);
+    if (r == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) break;
+      if (sent == 0) return uv_translate_sys_error(errno);
+      break;
+    }
+    sent += r;
+    if (static_cast<size_t>(r) < n) break;
+  }
+#else
+  for (; sent < count; sent++) {
+    int err = uv_udp_try_send(&handle_, &bufs[sent], 1, addr);
+    if (err == UV_EAGAIN || err == UV_ENOSYS) break;
+    if (err < 0) {
+      if (sent == 0) return err;
+      break;
+    }
+  }
+#endif
+  return sent;
+}
+
+
+void UDPWrap::SendBatch(const FunctionCallbackInfo<Value>& args) {
+  DoSendBatch(args, AF_INET);
+}
+
+
+void UDPWrap::SendBatch6(const FunctionCallbackInfo<Value>& args) {
+  DoSendBatch(args, AF_INET6);
+}
+
+
+// Enables UDP generic segmentation offload: a single send of a buffer
+// larger than |size| is split by the kernel (or NIC) into |size|-byte
+// datagrams. 0 turns it off again.
+void UDPWrap::SetGsoSegmentSize(const FunctionCallbackInfo<Value>& args) {
+  UDPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(
+      &wrap, args.This(), args.GetReturnValue().Set(UV_EBADF));
+  CHECK(args[0]->IsUint32());
+#if defined(__linux__) && defined(UDP_SEGMENT)
+  int size = static_cast<int>(args[0].As<Uint32>()->Value());
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err == 0 &&
+      setsockopt(fd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) != 0) {
+    err = uv_translate_sys_error(errno);
+  }
+#else
+  int err = UV_ENOTSUP;
+#endif
+  args.GetReturnValue().Set(err);
+}
+
+
 AsyncWrap* UDPWrap::GetAsyncWrap() {
   return this;
 }
@@ -714,6 +867,12 @@ void UDPWrap::OnAlloc(uv_handle_t* handle,
                       uv_buf_t* buf) {
   UDPWrap* wrap = ContainerOf(&UDPWrap::handle_,
                               reinterpret_cast<uv_udp_t*>(handle));
+  if (wrap->recv_batch_) {
+    if (!wrap->recv_batch_buf_)
+      wrap->recv_batch_buf_.reset(new char[kRecvBatchBufferSize]);
+    *buf = uv_buf_init(wrap->recv_batch_buf_.get(), kRecvBatchBufferSize);
+    return;
+  }
   *buf = wrap->listener()->OnAlloc(suggested_size);
 }
 
@@ -727,9 +886,123 @@ void UDPWrap::OnRecv(uv_udp_t* handle,
                      const sockaddr* addr,
                      unsigned int flags) {
   UDPWrap* wrap = ContainerOf(&UDPWrap::handle_, handle);
+  if (wrap->recv_batch_) {
+    wrap->OnRecvBatched(nread, *buf, addr, flags);
+    return;
+  }
   wrap->listener()->OnRecv(nread, *buf, addr, flags);
 }
 
+void UDPWrap::OnRecvBatched(ssize_t nread,
+                            const uv_buf_t& buf,
+                            const sockaddr* addr,
+                            unsigned int flags) {
+  // The end of a recvmmsg() batch, an empty read or an error: whatever has
+  // been collected so far goes out first so that ordering is preserved.
+  if ((flags & UV_UDP_MMSG_FREE) || nread < 0 || addr == nullptr) {
+    FlushRecvBatch();
+    if (nread < 0 && !IsHandleClosing())
+      listener()->OnRecv(nread, uv_buf_init(nullptr, 0), nullptr, 0);
+    return;
+  }
+
+  if (listener() != this) {
+    // Other listeners consume datagrams one by one out of their own
+    // buffers; the batch buffer is reused by libuv as soon as we return.
+    uv_buf_t copy = listener()->OnAlloc(nread);
+    if (copy.base == nullptr || copy.len < static_cast<size_t>(nread)) {
+      listener()->OnRecv(UV_ENOBUFS, copy, nullptr, 0);
+      return;
+    }
+    memcpy(copy.base, buf.base, nread);
+    listener()->OnRecv(nread, copy, addr, flags & ~UV_UDP_MMSG_CHUNK);
+    return;
+  }
+
+  if (batch_offsets_.empty()) batch_offsets_.push_back(0);
+  batch_data_.insert(batch_data_.end(), buf.base, buf.base + nread);
+  batch_offsets_.push_back(static_cast<uint32_t>(batch_data_.size()));
+  sockaddr_storage storage;
+  memcpy(&storage,
+         addr,
+         addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6)
+                                     : sizeof(sockaddr_in));
+  batch_addrs_.push_back(storage);
+
+  if (batch_addrs_.size() >= kMaxRecvBatchDatagrams) FlushRecvBatch();
+}
+
+// onmessagebatch(count, handle, buffer, offsets, addresses): datagram i is
+// buffer[offsets[i], offsets[i + 1]) and was sent from addresses[i].
+void UDPWrap::FlushRecvBatch() {
+  if (batch_addrs_.empty()) return;
+  std::vector<char> data = std::move(batch_data_);
+  std::vector<uint32_t> offsets = std::move(batch_offsets_);
+  std::vector<sockaddr_storage> addrs = std::move(batch_addrs_);
+  batch_data_.clear();
+  batch_offsets_.clear();
+  batch_addrs_.clear();
+  if (IsHandleClosing()) return;
+
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+
+  Local<Value> argv[] = {
+      Integer::New(isolate, static_cast<int32_t>(addrs.size())),
+      object(),
+      Undefined(isolate),
+      Undefined(isolate),
+      Undefined(isolate)};
+
+  bool has_caught = false;
+  {
+    TryCatchScope try_catch(env);
+    std::unique_ptr<BackingStore> bs;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+      bs = ArrayBuffer::NewBackingStore(isolate, data.size());
+    }
+    if (!data.empty()) memcpy(bs->Data(), data.data(), data.size());
+    Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(bs));
+
+    Local<ArrayBuffer> offsets_ab =
+        ArrayBuffer::New(isolate, offsets.size() * sizeof(uint32_t));
+    memcpy(offsets_ab->Data(),
+           offsets.data(),
+           offsets.size() * sizeof(uint32_t));
+    argv[3] = Uint32Array::New(offsets_ab, 0, offsets.size());
+
+    Local<Array> addresses = Array::New(isolate, addrs.size());
+    for (size_t i = 0; i < addrs.size() && !has_caught; i++) {
+      Local<Object> address;
+      if (!AddressToJS(env, reinterpret_cast<const sockaddr*>(&addrs[i]))
+               .ToLocal(&address) ||
+          addresses->Set(env->context(), i, address).IsNothing()) {
+        has_caught = true;
+      }
+    }
+    argv[4] = addresses;
+
+    if (!has_caught &&
+        !Buffer::New(env, ab, 0, ab->ByteLength()).ToLocal(&argv[2])) {
+      has_caught = true;
+    }
+    if (has_caught) {
+      DCHECK(try_catch.HasCaught() && !try_catch.HasTerminated());
+      argv[2] = try_catch.Exception();
+      DCHECK(!argv[2].IsEmpty());
+    }
+  }
+
+  if (has_caught) {
+    MakeCallback(env->onerror_string(), 3, argv);
+    return;
+  }
+  MakeCallback(env->onmessagebatch_string(), arraysize(argv), argv);
+}
+
 void UDPWrap::OnRecv(ssize_t nread,
                      const uv_buf_t& buf_,
                      const sockaddr* addr,
@@ -738,6 +1011,7 @@ void UDPWrap::OnRecv(ssize_t nread,
   Isolate* isolate = env->isolate();
   std::unique_ptr<BackingStore> bs = env->release_managed_buffer(buf_);
   if (nread == 0 && addr == nullptr) {
+    env->recycle_managed_buffer(std::move(bs));
     return;
   }
 
@@ -751,9 +1025,11 @@ void UDPWrap::OnRecv(ssize_t nread,
       Undefined(isolate)};
 
   if (nread < 0) {
+    env->recycle_managed_buffer(std::move(bs));
     MakeCallback(env->onmessage_string(), arraysize(argv), argv);
     return;
   } else if (nread == 0) {
+    env->recycle_managed_buffer(std::move(bs));
     bs = ArrayBuffer::NewBackingStore(isolate, 0);
   } else if (static_cast<size_t>(nread) != bs->ByteLength()) {
     CHECK_LE(static_cast<size_t>(nread), bs->ByteLength());
@@ -762,6 +1038,7 @@ void UDPWrap::OnRecv(ssize_t nread,
     memcpy(static_cast<char*>(bs->Data()),
            static_cast<char*>(old_bs->Data()),
            nread);
+    env->recycle_managed_buffer(std::move(old_bs));
   }
 
   Local<Object> address;
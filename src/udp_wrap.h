@@ -30,6 +30,9 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <memory>
+#include <vector>
+
 namespace node {
 
 class ExternalReferenceRegistry;
@@ -124,6 +127,10 @@ class UDPWrap final : public HandleWrap,
   enum SocketType {
     SOCKET
   };
+  // Constructor flag that switches the handle to batched receive: datagrams
+  // are read with recvmmsg() where available and delivered to JS through
+  // onmessagebatch as one contiguous buffer plus an offsets array.
+  static constexpr uint32_t kRecvBatch = 1;
   static void Initialize(v8::Local<v8::Object> target,
                          v8::Local<v8::Value> unused,
                          v8::Local<v8::Context> context,
@@ -138,6 +145,10 @@ class UDPWrap final : public HandleWrap,
   static void Bind6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Connect6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Send6(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SendBatch(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SendBatch6(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetGsoSegmentSize(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Disconnect(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void AddMembership(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void DropMembership(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -189,7 +200,7 @@ class UDPWrap final : public HandleWrap,
             int (*F)(const typename T::HandleType*, sockaddr*, int*)>
   friend void GetSockOrPeerName(const v8::FunctionCallbackInfo<v8::Value>&);
 
-  UDPWrap(Environment* env, v8::Local<v8::Object> object);
+  UDPWrap(Environment* env, v8::Local<v8::Object> object, uint32_t flags = 0);
 
   static void DoBind(const v8::FunctionCallbackInfo<v8::Value>& args,
                      int family);
@@ -197,6 +208,9 @@ class UDPWrap final : public HandleWrap,
                      int family);
   static void DoSend(const v8::FunctionCallbackInfo<v8::Value>& args,
                      int family);
+  static void DoSendBatch(const v8::FunctionCallbackInfo<v8::Value>& args,
+                          int family);
+  ssize_t SendBatch(uv_buf_t* bufs, size_t count, const sockaddr* addr);
   static void SetMembership(const v8::FunctionCallbackInfo<v8::Value>& args,
                             uv_membership membership);
   static void SetSourceMembership(
@@ -212,8 +226,29 @@ class UDPWrap final : public HandleWrap,
                      const struct sockaddr* addr,
                      unsigned int flags);
 
+  // Batched receive. libuv hands out one datagram per callback, either
+  // carved out of the recvmmsg() buffer or, where that is unavailable, read
+  // one at a time into it; they are accumulated here and flushed to JS once
+  // libuv reports the end of the batch.
+  void OnRecvBatched(ssize_t nread,
+                     const uv_buf_t& buf,
+                     const sockaddr* addr,
+                     unsigned int flags);
+  void FlushRecvBatch();
+
+  // libuv caps a recvmmsg() call at 20 datagrams of 64 KiB each.
+  static constexpr size_t kMaxRecvBatchDatagrams = 20;
+  static constexpr size_t kRecvBatchBufferSize =
+      kMaxRecvBatchDatagrams * 64 * 1024;
+
   uv_udp_t handle_;
 
+  bool recv_batch_ = false;
+  std::unique_ptr<char[]> recv_batch_buf_;
+  std::vector<char> batch_data_;
+  std::vector<uint32_t> batch_offsets_;
+  std::vector<sockaddr_storage> batch_addrs_;
+
   bool current_send_has_callback_;
   v8::Local<v8::Object> current_send_req_wrap_;
 };
@@ -48,6 +48,7 @@
 #include <sys/types.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstring>
@@ -302,6 +303,94 @@ int ReadFileSync(std::string* result, const char* path) {
   return 0;
 }
 
+#ifdef __linux__
+namespace {
+
+// Reads the CPU limit of a cgroup v2 directory from cpu.max, which holds
+// "<quota> <period>", or "max <period>" if there is none.
+double ReadCpuMax(const std::string& dir) {
+  std::string text;
+  if (ReadFileSync(&text, (dir + "/cpu.max").c_str()) != 0) return 0;
+  if (text.compare(0, 3, "max") == 0) return 0;
+  char* end;
+  double quota = strtod(text.c_str(), &end);
+  double period = strtod(end, nullptr);
+  return quota > 0 && period > 0 ? quota / period : 0;
+}
+
+// Reads the CPU limit of a cgroup v1 directory of the cpu controller. A
+// quota of -1 means that there is none.
+double ReadCfsQuota(const std::string& dir) {
+  std::string quota;
+  std::string period;
+  if (ReadFileSync(&quota, (dir + "/cpu.cfs_quota_us").c_str()) != 0 ||
+      ReadFileSync(&period, (dir + "/cpu.cfs_period_us").c_str()) != 0) {
+    return 0;
+  }
+  double quota_us = strtod(quota.c_str(), nullptr);
+  double period_us = strtod(period.c_str(), nullptr);
+  return quota_us > 0 && period_us > 0 ? quota_us / period_us : 0;
+}
+
+double ReadCgroupCpuQuota() {
+  std::string cgroup;
+  if (ReadFileSync(&cgroup, "/proc/self/cgroup") != 0) return 0;
+
+  double limit = 0;
+  auto apply = [&](double quota) {
+    if (quota > 0 && (limit == 0 || quota < limit)) limit = quota;
+  };
+  std::istringstream lines(cgroup);
+  std::string line;
+  while (std::getline(lines, line)) {
+    // Each line is "<id>:<controllers>:<path>".
+    size_t first = line.find(':');
+    size_t second =
+        first == std::string::npos ? first : line.find(':', first + 1);
+    if (second == std::string::npos) continue;
+    std::string controllers = line.substr(first + 1, second - first - 1);
+    std::string path = line.substr(second + 1);
+
+    if (controllers.empty()) {
+      // cgroup v2. The limits of the ancestors apply as well.
+      while (true) {
+        apply(ReadCpuMax("/sys/fs/cgroup" + path));
+        size_t slash = path.rfind('/');
+        if (slash == std::string::npos || path.size() <= 1) break;
+        path.resize(slash);
+      }
+    } else if (("," + controllers + ",").find(",cpu,") != std::string::npos) {
+      // cgroup v1. Containers usually have their own cgroup mounted as the
+      // root of the hierarchy, where the host has no limit.
+      apply(ReadCfsQuota("/sys/fs/cgroup/cpu" + path));
+      apply(ReadCfsQuota("/sys/fs/cgroup/cpu"));
+    }
+  }
+  return limit;
+}
+
+}  // anonymous namespace
+#endif  // __linux__
+
+double GetCgroupCpuQuota() {
+#ifdef __linux__
+  static const double quota = ReadCgroupCpuQuota();
+  return quota;
+#else
+  return 0;
+#endif
+}
+
+unsigned int GetAvailableParallelism() {
+  unsigned int parallelism = uv_available_parallelism();
+  double quota = GetCgroupCpuQuota();
+  if (quota > 0) {
+    unsigned int cpus = static_cast<unsigned int>(std::ceil(quota));
+    parallelism = std::min(parallelism, std::max(cpus, 1u));
+  }
+  return parallelism;
+}
+
 std::vector<char> ReadFileSync(FILE* fp) {
   CHECK_EQ(ftell(fp), 0);
   int err = fseek(fp, 0, SEEK_END);
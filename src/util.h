@@ -693,6 +693,20 @@ struct FunctionDeleter {
 template <typename T, void (*function)(T*)>
 using DeleteFnPtr = typename FunctionDeleter<T, function>::Pointer;
 
+// Holds the process-wide instance of T, which is created on first use and
+// intentionally never destroyed. Worker threads, libuv threadpool tasks and
+// threads owned by the instance itself may still use it while exit() runs
+// static destructors on the main thread, so it must outlive them all.
+// A T with a private constructor has to befriend LeakedSingleton<T>.
+template <typename T>
+class LeakedSingleton {
+ public:
+  static T& Get() {
+    static T* const instance = new T();
+    return *instance;
+  }
+};
+
 // Convert a v8::Array into an std::vector using the callback-based API.
 // This can be faster than calling Array::Get() repeatedly when the array
 // has more than 2 entries.
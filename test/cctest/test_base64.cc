@@ -1,9 +1,12 @@
+#include "encoding_binding.h"
 #include "nbytes.h"
 #include "simdutf.h"
 #include "util-inl.h"
 
 #include <cstddef>
 #include <cstring>
+#include <string>
+#include <string_view>
 
 #include "gtest/gtest.h"
 
@@ -146,3 +149,181 @@ TEST(Base64Test, Decode) {
        "dCBjdXBpZGF0YXQgbm9uIHByb2lkZW50LCBzdW50IGluIGN1bHBhIHF1aSBvZmZpY2lh\n"
        "IGRlc2VydW50IG1vbGxpdCBhbmltIGlkIGVzdCBsYWJvcnVtLg", text);
 }
+
+using node::encoding_binding::ChunkedCodec;
+
+// Feeds |input| to |codec| in chunks of |chunk_size| bytes, with output
+// buffers of the size that MaxOutputLength() asks for. Returns false if the
+// codec rejects the input.
+static bool RunChunked(ChunkedCodec* codec,
+                       std::string_view input,
+                       size_t chunk_size,
+                       std::string* output) {
+  output->clear();
+  size_t offset = 0;
+  do {
+    const size_t length = std::min(chunk_size, input.size() - offset);
+    const bool final = offset + length == input.size();
+    std::string out(codec->MaxOutputLength(length, final), '\0');
+    size_t read;
+    size_t written;
+    if (!codec->Update(input.data() + offset, length,
+                       out.data(), out.size(), final, &read, &written)) {
+      return false;
+    }
+    EXPECT_EQ(read, length);
+    EXPECT_LE(written, out.size());
+    output->append(out.data(), written);
+    offset += length;
+  } while (offset < input.size());
+  return true;
+}
+
+TEST(Base64Test, StreamingEncode) {
+  const std::string text = "Lorem ipsum dolor sit amet, consectetur elit.";
+  for (auto encoding : {node::BASE64, node::BASE64URL}) {
+    const simdutf::base64_options options =
+        encoding == node::BASE64URL ? simdutf::base64_url
+                                    : simdutf::base64_default;
+    for (size_t length = 0; length <= text.size(); length++) {
+      std::string expected(
+          simdutf::base64_length_from_binary(length, options), '\0');
+      simdutf::binary_to_base64(text.data(), length, expected.data(), options);
+      // Every chunk size puts the 3-byte group boundaries somewhere else.
+      for (size_t chunk_size = 1; chunk_size <= length + 1; chunk_size++) {
+        ChunkedCodec codec(encoding, false);
+        std::string output;
+        ASSERT_TRUE(RunChunked(
+            &codec, std::string_view(text).substr(0, length), chunk_size,
+            &output));
+        EXPECT_EQ(output, expected) << length << " bytes in chunks of "
+                                    << chunk_size;
+      }
+    }
+  }
+
+  ChunkedCodec codec(node::BASE64URL, false);
+  std::string output;
+  ASSERT_TRUE(RunChunked(&codec, "\xfb\xff\xbf", 1, &output));
+  EXPECT_EQ(output, "-_-_");
+}
+
+TEST(Base64Test, StreamingEncodeCarry) {
+  ChunkedCodec codec(node::BASE64, false);
+  char out[8];
+  size_t read;
+  size_t written;
+
+  // Two bytes are not a complete group yet and are carried.
+  ASSERT_TRUE(codec.Update("ab", 2, out, sizeof(out), false, &read, &written));
+  EXPECT_EQ(read, 2u);
+  EXPECT_EQ(written, 0u);
+  EXPECT_EQ(codec.MaxOutputLength(0, true), 4u);
+
+  // Without room for the completed group, nothing more is read.
+  ASSERT_TRUE(codec.Update("cdef", 4, out, 3, false, &read, &written));
+  EXPECT_EQ(read, 1u);
+  EXPECT_EQ(written, 0u);
+  ASSERT_TRUE(codec.Update("def", 3, out, 4, false, &read, &written));
+  EXPECT_EQ(read, 0u);
+  EXPECT_EQ(std::string(out, written), "YWJj");
+
+  ASSERT_TRUE(codec.Update("def", 3, out, 4, false, &read, &written));
+  EXPECT_EQ(read, 3u);
+  EXPECT_EQ(std::string(out, written), "ZGVm");
+
+  // The final remainder is padded.
+  ASSERT_TRUE(codec.Update("g", 1, out, sizeof(out), true, &read, &written));
+  EXPECT_EQ(read, 1u);
+  EXPECT_EQ(std::string(out, written), "Zw==");
+  EXPECT_EQ(codec.MaxOutputLength(0, true), 0u);
+}
+
+TEST(Base64Test, StreamingDecode) {
+  auto test = [](const char* base64_string, const char* string) {
+    const std::string_view input(base64_string);
+    for (auto encoding : {node::BASE64, node::BASE64URL}) {
+      for (size_t chunk_size = 1; chunk_size <= input.size(); chunk_size++) {
+        ChunkedCodec codec(encoding, true);
+        std::string output;
+        ASSERT_TRUE(RunChunked(&codec, input, chunk_size, &output))
+            << base64_string << " in chunks of " << chunk_size;
+        EXPECT_EQ(output, string) << base64_string << " in chunks of "
+                                  << chunk_size;
+      }
+    }
+  };
+
+  test("YQ==", "a");
+  test("YWI=", "ab");
+  test("YWJj", "abc");
+  test("YWJjZA==", "abcd");
+  test("YWJjZGU=", "abcde");
+  test("YWJjZGVm", "abcdef");
+  test("YWJjZGU", "abcde");
+  test("YW Jj\nZG\r\nU=", "abcde");
+  test(" YWJj ZGVm \n", "abcdef");
+  test("YQ==\n", "a");
+  test("TG9yZW0gaXBzdW0gZG9sb3Igc2l0IGFtZXQsIGNvbnNlY3RldHVy\n"
+       "IGVsaXQu",
+       "Lorem ipsum dolor sit amet, consectetur elit.");
+}
+
+TEST(Base64Test, StreamingDecodeInvalid) {
+  auto rejects = [](enum node::encoding encoding, const char* input) {
+    const std::string_view view(input);
+    for (size_t chunk_size = 1; chunk_size <= view.size(); chunk_size++) {
+      ChunkedCodec codec(encoding, true);
+      std::string output;
+      EXPECT_FALSE(RunChunked(&codec, view, chunk_size, &output))
+          << input << " in chunks of " << chunk_size;
+    }
+  };
+
+  rejects(node::BASE64, "YQ*=");
+  rejects(node::BASE64, "YWJj\x80");
+  // Data after padding.
+  rejects(node::BASE64, "YQ==YQ==");
+  rejects(node::BASE64, "YQ==Y");
+  // A lone character does not make up a byte.
+  rejects(node::BASE64, "YWJjZ");
+  // Each variant rejects the characters that only the other one uses.
+  rejects(node::BASE64, "-_-_");
+  rejects(node::BASE64URL, "+/+/");
+
+  // The codec can be used again after rejecting input.
+  ChunkedCodec codec(node::BASE64, true);
+  std::string output;
+  EXPECT_FALSE(RunChunked(&codec, "YQ=*", 4, &output));
+  ASSERT_TRUE(RunChunked(&codec, "YWI=", 4, &output));
+  EXPECT_EQ(output, "ab");
+}
+
+TEST(Base64Test, StreamingHex) {
+  const std::string_view binary("\x00\x01\x7f\x80\xab\xff", 6);
+  for (size_t chunk_size = 1; chunk_size <= 12; chunk_size++) {
+    ChunkedCodec encoder(node::HEX, false);
+    std::string hex;
+    ASSERT_TRUE(RunChunked(&encoder, binary, chunk_size, &hex));
+    EXPECT_EQ(hex, "00017f80abff");
+
+    ChunkedCodec decoder(node::HEX, true);
+    std::string output;
+    ASSERT_TRUE(RunChunked(&decoder, "00017F80aBff", chunk_size, &output));
+    EXPECT_EQ(output, binary);
+
+    // An odd number of characters is only an error at the end.
+    EXPECT_FALSE(RunChunked(&decoder, "00017f80abf", chunk_size, &output));
+    EXPECT_FALSE(RunChunked(&decoder, "0g", chunk_size, &output));
+  }
+
+  ChunkedCodec decoder(node::HEX, true);
+  char out[2];
+  size_t read;
+  size_t written;
+  ASSERT_TRUE(decoder.Update("a", 1, out, sizeof(out), false, &read, &written));
+  EXPECT_EQ(read, 1u);
+  EXPECT_EQ(written, 0u);
+  ASSERT_TRUE(decoder.Update("b", 1, out, sizeof(out), true, &read, &written));
+  EXPECT_EQ(std::string(out, written), "\xab");
+}
@@ -0,0 +1,225 @@
+#include "env-inl.h"
+#include "gtest/gtest.h"
+#include "node_test_fixture.h"
+#include "permission/fs_permission.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+using node::permission::FSPermission;
+using node::permission::PermissionScope;
+using Node = FSPermission::RadixTree::Node;
+
+namespace {
+
+// The tree as it was looked up before it was flattened: the same nodes,
+// walked through their pointers. Lookup() must agree with it on every path.
+class PointerTree {
+ public:
+  PointerTree() : root_(new Node("")) {}
+  ~PointerTree() { Free(root_); }
+
+  PointerTree(const PointerTree&) = delete;
+  PointerTree& operator=(const PointerTree&) = delete;
+
+  void Insert(const std::string& path) {
+    Node* current_node = root_;
+    size_t parent_node_prefix_len = current_node->prefix.length();
+    for (size_t i = 1; i <= path.length(); ++i) {
+      const bool is_wildcard_node = path[i - 1] == '*';
+      if (is_wildcard_node || i == path.length()) {
+        current_node = current_node->CreateChild(
+            path.substr(parent_node_prefix_len, i));
+      }
+      if (is_wildcard_node) {
+        current_node = current_node->CreateWildcardChild();
+        parent_node_prefix_len = i;
+      }
+    }
+  }
+
+  bool Lookup(const std::string& path) const {
+    const Node* current_node = root_;
+    if (current_node->children.empty()) return false;
+    size_t parent_node_prefix_len = current_node->prefix.length();
+    while (true) {
+      if (parent_node_prefix_len == path.length() &&
+          current_node->IsEndNode()) {
+        return true;
+      }
+      current_node = NextNode(current_node, path, parent_node_prefix_len);
+      if (current_node == nullptr) return false;
+      parent_node_prefix_len += current_node->prefix.length();
+      if (current_node->wildcard_child != nullptr &&
+          path.length() >= parent_node_prefix_len - 2) {
+        return true;
+      }
+    }
+  }
+
+ private:
+  static const Node* NextNode(const Node* node,
+                              const std::string& path,
+                              size_t idx) {
+    if (idx >= path.length()) return nullptr;
+    if (node->children.size() > 1) {
+      auto it = node->children.find('*');
+      if (it != node->children.end()) return it->second;
+    }
+    auto it = node->children.find(path[idx]);
+    if (it == node->children.end()) return nullptr;
+    const Node* child = it->second;
+    for (size_t i = 0; i < path.length(); ++i) {
+      if (i >= child->prefix.length() || child->prefix[i] == '*') return child;
+      if (idx >= path.length() &&
+          child->prefix[i] == std::filesystem::path::preferred_separator) {
+        continue;
+      }
+      if (idx >= path.length() || path[idx++] != child->prefix[i]) {
+        return nullptr;
+      }
+    }
+    return child;
+  }
+
+  static void Free(Node* node) {
+    if (node == nullptr) return;
+    for (auto& child : node->children) Free(child.second);
+    Free(node->wildcard_child);
+    delete node;
+  }
+
+  Node* root_;
+};
+
+const std::vector<std::string> kGrants = {
+    "/tmp/*",
+    "/home/user/file.md",
+    "/home/user/dir/*",
+    "/home/user/directory.txt",
+    "/slower*",
+    "/slown*",
+    "/slow*",
+    "/var/log/app-*.log",
+    "/a/b/c/*",
+    "/a/b/d",
+    "/opt/*/bin",
+};
+
+// Every grant, its prefixes, and variations of it with characters added,
+// changed or removed, so that every node boundary is crossed both ways.
+std::vector<std::string> CandidatePaths() {
+  std::vector<std::string> paths = {"/", "", "/nonexistent", "/home/user"};
+  for (const std::string& grant : kGrants) {
+    for (size_t i = 0; i <= grant.length(); ++i) {
+      const std::string prefix = grant.substr(0, i);
+      paths.push_back(prefix);
+      paths.push_back(prefix + "/");
+      paths.push_back(prefix + "x");
+      paths.push_back(prefix + "/x/y.js");
+    }
+    std::string expanded = grant;
+    for (size_t pos; (pos = expanded.find('*')) != std::string::npos;)
+      expanded.replace(pos, 1, "some/file");
+    paths.push_back(expanded);
+    paths.push_back(expanded + ".bak");
+    paths.push_back(expanded.substr(0, expanded.length() - 1));
+  }
+  return paths;
+}
+
+}  // namespace
+
+TEST(FSPermissionRadixTree, EmptyTree) {
+  FSPermission::RadixTree tree;
+  EXPECT_TRUE(tree.Lookup("/tmp/file", true));
+  EXPECT_FALSE(tree.Lookup("/tmp/file", false));
+}
+
+TEST(FSPermissionRadixTree, Lookup) {
+  FSPermission::RadixTree tree;
+  for (const std::string& grant : kGrants) tree.Insert(grant);
+
+  EXPECT_TRUE(tree.Lookup("/tmp/file.txt"));
+  EXPECT_TRUE(tree.Lookup("/tmp/a/b/c"));
+  EXPECT_FALSE(tree.Lookup("/tmpfile"));
+  EXPECT_TRUE(tree.Lookup("/home/user/file.md"));
+  EXPECT_FALSE(tree.Lookup("/home/user/file.md.bak"));
+  EXPECT_FALSE(tree.Lookup("/home/user/file"));
+  EXPECT_FALSE(tree.Lookup("/home/user/other.md"));
+  EXPECT_TRUE(tree.Lookup("/home/user/dir/nested/file.js"));
+  EXPECT_TRUE(tree.Lookup("/home/user/directory.txt"));
+  EXPECT_TRUE(tree.Lookup("/slower"));
+  EXPECT_TRUE(tree.Lookup("/slowness"));
+  EXPECT_TRUE(tree.Lookup("/slow/file"));
+  EXPECT_FALSE(tree.Lookup("/slo"));
+  EXPECT_TRUE(tree.Lookup("/var/log/app-1.log"));
+  EXPECT_FALSE(tree.Lookup("/var/log/other.log"));
+  // A directory grant also covers the directory itself.
+  EXPECT_TRUE(tree.Lookup("/a/b/c"));
+  EXPECT_TRUE(tree.Lookup("/a/b/c/d"));
+  EXPECT_TRUE(tree.Lookup("/a/b/d"));
+  EXPECT_FALSE(tree.Lookup("/a/b/e"));
+  EXPECT_FALSE(tree.Lookup("/a/b"));
+}
+
+TEST(FSPermissionRadixTree, MatchesPointerTree) {
+  FSPermission::RadixTree tree;
+  PointerTree reference;
+  // Compare after every insertion, so that splits of existing nodes and the
+  // '*' child precedence are covered with partial trees as well.
+  for (const std::string& grant : kGrants) {
+    tree.Insert(grant);
+    reference.Insert(grant);
+    for (const std::string& path : CandidatePaths()) {
+      EXPECT_EQ(tree.Lookup(path), reference.Lookup(path))
+          << path << " after inserting " << grant;
+    }
+  }
+}
+
+class FSPermissionTest : public EnvironmentTestFixture {};
+
+TEST_F(FSPermissionTest, CachedDecisions) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  const std::string dir = "/nonexistent-node-cctest";
+  const std::string file = dir + "/file.txt";
+  const std::string other = dir + "/other.txt";
+
+  FSPermission permission;
+  EXPECT_FALSE(
+      permission.is_granted(*env, PermissionScope::kFileSystemRead, file));
+  permission.Apply(*env, {file}, PermissionScope::kFileSystemRead);
+  // Asked twice, so that the second answer comes from the cache.
+  for (int i = 0; i < 2; i++) {
+    EXPECT_TRUE(
+        permission.is_granted(*env, PermissionScope::kFileSystemRead, file));
+    EXPECT_FALSE(
+        permission.is_granted(*env, PermissionScope::kFileSystemRead, other));
+    EXPECT_FALSE(
+        permission.is_granted(*env, PermissionScope::kFileSystemWrite, file));
+  }
+
+  // New grants invalidate the cached denials.
+  permission.Apply(*env, {dir + "/*"}, PermissionScope::kFileSystemRead);
+  EXPECT_TRUE(
+      permission.is_granted(*env, PermissionScope::kFileSystemRead, other));
+  EXPECT_TRUE(permission.is_granted(
+      *env, PermissionScope::kFileSystemRead, dir + "/./nested/../other.txt"));
+
+  // Decisions are not shared between trees that are asked about the same
+  // path.
+  FSPermission unrelated;
+  unrelated.Apply(*env, {"/unrelated/*"}, PermissionScope::kFileSystemRead);
+  for (int i = 0; i < 2; i++) {
+    EXPECT_FALSE(
+        unrelated.is_granted(*env, PermissionScope::kFileSystemRead, file));
+    EXPECT_TRUE(
+        permission.is_granted(*env, PermissionScope::kFileSystemRead, file));
+  }
+}
+#endif  // _WIN32
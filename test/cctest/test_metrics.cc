@@ -0,0 +1,218 @@
+#include "env-inl.h"
+#include "gtest/gtest.h"
+#include "node_metrics.h"
+#include "node_test_fixture.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using node::metrics::Counter;
+using node::metrics::Gauge;
+using node::metrics::HistogramMetric;
+using node::metrics::Registry;
+
+// The registry is process-wide, so every test uses names of its own and
+// looks for its metrics among those of the others.
+
+namespace {
+
+std::string Render() {
+  std::string out;
+  Registry::Get()->Render(&out);
+  return out;
+}
+
+bool Contains(const std::string& haystack, const std::string& needle) {
+  return haystack.find(needle) != std::string::npos;
+}
+
+std::vector<std::string> Lines(const std::string& text) {
+  std::vector<std::string> lines;
+  std::istringstream stream(text);
+  for (std::string line; std::getline(stream, line);) lines.push_back(line);
+  return lines;
+}
+
+// Checks the parts of the OpenMetrics text format that the renderer is
+// responsible for: metadata comes before the samples of its family, every
+// sample belongs to the family declared last, and samples are a name, an
+// optional label set and a value.
+void ExpectValidExposition(const std::string& text) {
+  ASSERT_FALSE(text.empty());
+  ASSERT_EQ(text.back(), '\n');
+  std::string family;
+  std::string type;
+  for (const std::string& line : Lines(text)) {
+    if (line.rfind("# TYPE ", 0) == 0) {
+      std::istringstream stream(line.substr(7));
+      stream >> family >> type;
+      EXPECT_TRUE(type == "counter" || type == "gauge" || type == "summary")
+          << line;
+      continue;
+    }
+    if (line.rfind("# HELP " + family + " ", 0) == 0) continue;
+    if (line == "# EOF") continue;
+    ASSERT_NE(line[0], '#') << line;
+
+    const size_t name_end = line.find_first_of("{ ");
+    ASSERT_NE(name_end, std::string::npos) << line;
+    const std::string name = line.substr(0, name_end);
+    if (type == "counter") {
+      EXPECT_EQ(name, family + "_total") << line;
+    } else if (type == "summary") {
+      EXPECT_TRUE(name == family || name == family + "_sum" ||
+                  name == family + "_count")
+          << line;
+    } else {
+      EXPECT_EQ(name, family) << line;
+    }
+
+    size_t value_start = name_end + 1;
+    if (line[name_end] == '{') {
+      const size_t labels_end = line.find("} ", name_end);
+      ASSERT_NE(labels_end, std::string::npos) << line;
+      value_start = labels_end + 2;
+    }
+    const std::string value = line.substr(value_start);
+    if (value == "NaN" || value == "+Inf" || value == "-Inf") continue;
+    size_t parsed = 0;
+    std::stod(value, &parsed);
+    EXPECT_EQ(parsed, value.size()) << line;
+  }
+}
+
+}  // namespace
+
+TEST(MetricsTest, Counter) {
+  Counter* counter =
+      Registry::Get()->GetCounter("cctest_counter", "Requests served.");
+  ASSERT_NE(counter, nullptr);
+  counter->Increment();
+  counter->Increment(41);
+  EXPECT_EQ(counter->value(), 42u);
+
+  const std::string out = Render();
+  EXPECT_TRUE(Contains(out,
+                       "# TYPE cctest_counter counter\n"
+                       "# HELP cctest_counter Requests served.\n"
+                       "cctest_counter_total 42\n"));
+  ExpectValidExposition(out);
+}
+
+TEST(MetricsTest, Gauge) {
+  Gauge* gauge = Registry::Get()->GetGauge("cctest_gauge", "");
+  ASSERT_NE(gauge, nullptr);
+  gauge->Set(1.5);
+  gauge->Add(-4);
+  // Without help text, there is no HELP line.
+  EXPECT_TRUE(
+      Contains(Render(), "# TYPE cctest_gauge gauge\ncctest_gauge -2.5\n"));
+
+  gauge->Set(std::numeric_limits<double>::infinity());
+  EXPECT_TRUE(Contains(Render(), "\ncctest_gauge +Inf\n"));
+  gauge->Set(-std::numeric_limits<double>::infinity());
+  EXPECT_TRUE(Contains(Render(), "\ncctest_gauge -Inf\n"));
+  gauge->Set(std::nan(""));
+  EXPECT_TRUE(Contains(Render(), "\ncctest_gauge NaN\n"));
+  // Integers are rendered without an exponent or a fraction.
+  gauge->Set(1234567);
+  EXPECT_TRUE(Contains(Render(), "\ncctest_gauge 1234567\n"));
+  // Values keep full precision where they need it.
+  gauge->Set(0.1 + 0.2);
+  EXPECT_TRUE(Contains(Render(), "\ncctest_gauge 0.30000000000000004\n"));
+  ExpectValidExposition(Render());
+}
+
+TEST(MetricsTest, HelpIsEscaped) {
+  ASSERT_NE(Registry::Get()->GetGauge("cctest_escaped", "a\\b\nc \"d\""),
+            nullptr);
+  EXPECT_TRUE(Contains(Render(),
+                       "# HELP cctest_escaped a\\\\b\\nc \"d\"\n"));
+}
+
+TEST(MetricsTest, Histogram) {
+  HistogramMetric* histogram =
+      Registry::Get()->GetHistogram("cctest_histogram", "Sizes.");
+  ASSERT_NE(histogram, nullptr);
+  EXPECT_TRUE(Contains(Render(),
+                       "# TYPE cctest_histogram summary\n"
+                       "# HELP cctest_histogram Sizes.\n"
+                       "cctest_histogram{quantile=\"0.5\"} NaN\n"
+                       "cctest_histogram{quantile=\"0.9\"} NaN\n"
+                       "cctest_histogram{quantile=\"0.99\"} NaN\n"
+                       "cctest_histogram{quantile=\"0.999\"} NaN\n"
+                       "cctest_histogram_sum 0\n"
+                       "cctest_histogram_count 0\n"));
+
+  for (int i = 1; i <= 100; i++) histogram->Record(i);
+  const std::string out = Render();
+  EXPECT_TRUE(Contains(out, "\ncctest_histogram{quantile=\"0.5\"} 50\n"));
+  EXPECT_TRUE(Contains(out,
+                       "\ncctest_histogram_sum 5050\n"
+                       "cctest_histogram_count 100\n"));
+  ExpectValidExposition(out);
+}
+
+TEST(MetricsTest, HistogramScale) {
+  HistogramMetric* histogram = Registry::Get()->GetHistogram(
+      "cctest_histogram_seconds", "Durations.", 1e-3);
+  ASSERT_NE(histogram, nullptr);
+  histogram->Record(2000);
+  histogram->Record(2000);
+  const std::string out = Render();
+  EXPECT_TRUE(Contains(out, "\ncctest_histogram_seconds_sum 4\n"));
+  EXPECT_TRUE(Contains(out, "\ncctest_histogram_seconds_count 2\n"));
+}
+
+TEST(MetricsTest, Names) {
+  Registry* registry = Registry::Get();
+  EXPECT_EQ(registry->GetCounter("", ""), nullptr);
+  EXPECT_EQ(registry->GetCounter("1cctest", ""), nullptr);
+  EXPECT_EQ(registry->GetCounter("cctest-dash", ""), nullptr);
+  EXPECT_EQ(registry->GetCounter("cctest name", ""), nullptr);
+  EXPECT_NE(registry->GetCounter("cctest:valid_name_1", ""), nullptr);
+
+  // A name belongs to one metric, of one type.
+  Counter* counter = registry->GetCounter("cctest_taken", "");
+  ASSERT_NE(counter, nullptr);
+  EXPECT_EQ(registry->GetCounter("cctest_taken", "Other help."), counter);
+  EXPECT_EQ(registry->GetGauge("cctest_taken", ""), nullptr);
+  EXPECT_EQ(registry->GetHistogram("cctest_taken", ""), nullptr);
+}
+
+TEST(MetricsTest, Ids) {
+  Registry* registry = Registry::Get();
+  Gauge* gauge = registry->GetGauge("cctest_by_id", "");
+  ASSERT_NE(gauge, nullptr);
+  const int32_t id = registry->GetId(gauge);
+  ASSERT_GE(id, 0);
+  EXPECT_EQ(registry->FromId<Gauge>(id), gauge);
+  EXPECT_EQ(registry->FromId<Counter>(id), nullptr);
+  EXPECT_EQ(registry->FromId<Gauge>(Registry::kMaxMetrics), nullptr);
+}
+
+class MetricsEnvironmentTest : public EnvironmentTestFixture {};
+
+TEST_F(MetricsEnvironmentTest, RenderOpenMetrics) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+
+  std::string out;
+  node::metrics::RenderOpenMetrics(*env, &out);
+  ExpectValidExposition(out);
+
+  // The runtime metrics are always there, and the exposition ends with a
+  // single EOF marker.
+  EXPECT_TRUE(Contains(out, "# TYPE nodejs_gc_runs counter\n"));
+  EXPECT_TRUE(Contains(out, "# TYPE nodejs_gc_duration_seconds summary\n"));
+  EXPECT_TRUE(Contains(out, "# TYPE nodejs_active_handles gauge\n"));
+  EXPECT_TRUE(Contains(out, "# TYPE nodejs_heap_used_bytes gauge\n"));
+  EXPECT_TRUE(Contains(out, "nodejs_threadpool_queued{category=\""));
+  ASSERT_GE(out.size(), 6u);
+  EXPECT_EQ(out.substr(out.size() - 6), "# EOF\n");
+  EXPECT_EQ(out.find("# EOF"), out.size() - 6);
+}
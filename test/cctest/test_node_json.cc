@@ -0,0 +1,337 @@
+#include "env-inl.h"
+#include "gtest/gtest.h"
+#include "node_json.h"
+#include "node_test_fixture.h"
+#include "util-inl.h"
+
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+using v8::Array;
+using v8::ArrayBuffer;
+using v8::Context;
+using v8::Function;
+using v8::Isolate;
+using v8::JSON;
+using v8::Local;
+using v8::MaybeLocal;
+using v8::Object;
+using v8::String;
+using v8::TryCatch;
+using v8::Uint8Array;
+using v8::Value;
+
+namespace {
+
+// Documents that JSON.parse() rejects.
+const std::vector<std::string> kMalformed = {
+    "",
+    " ",
+    "[",
+    "]",
+    "{",
+    "}",
+    "[1",
+    "[1,",
+    "[1,]",
+    "[,1]",
+    "[1 2]",
+    "[1,,2]",
+    "{\"a\"}",
+    "{\"a\":}",
+    "{\"a\":1,}",
+    "{,\"a\":1}",
+    "{\"a\" 1}",
+    "{a:1}",
+    "{'a':1}",
+    "{\"a\":1 \"b\":2}",
+    "{\"a\":1}}",
+    "[1]]",
+    "{\"a\":[1}",
+    "[{\"a\":1]}",
+    "\"abc",
+    "\"a\\\"",
+    "\"\\x\"",
+    "\"\\u12\"",
+    "\"\\u12G4\"",
+    "[\"\\x\"]",
+    "{\"\\x\":1}",
+    "\"a\tb\"",
+    "\"a\nb\"",
+    "tru",
+    "true1",
+    "nul",
+    "nulll",
+    "falsey",
+    "True",
+    "NaN",
+    "Infinity",
+    "-Infinity",
+    "undefined",
+    "01",
+    "-01",
+    "1.",
+    ".5",
+    "-",
+    "+1",
+    "1e",
+    "1e+",
+    "0x10",
+    "1.5.2",
+    "--1",
+    "1 2",
+    "1E400 x",
+    "\"\\ud800\" 1",
+    "[1] x",
+    "{\"a\":1} {\"b\":2}",
+    "null null",
+    "/* c */ 1",
+    "[1]//",
+};
+
+// Documents that simdjson does not take as they are, or that need care to
+// be converted like JSON.parse() does.
+const std::vector<std::string> kValid = {
+    "1",
+    " 1 ",
+    "-0",
+    "[-0]",
+    "0.1e-5",
+    "1e-400",
+    "9007199254740993",
+    "-9223372036854775808",
+    "-9223372036854775809",
+    "18446744073709551615",
+    "18446744073709551616",
+    "123456789012345678901234567890",
+    "[123456789012345678901234567890]",
+    "\"\\u00e9\\ud83d\\ude00\"",
+    "\"\\ud800\"",
+    "\"\\udc00x\"",
+    "[\"\\ud800\",\"a\"]",
+    "{\"\\ud800\":\"\\udfff\",\"b\":1}",
+    " [ 1 , 2 ] ",
+    "{\"a\":{\"b\":[true,false,null]}}",
+    "{\"a\":1,\"a\":2}",
+    "[[[[]]]]",
+    "{}",
+    "[]",
+};
+
+class Binding {
+ public:
+  explicit Binding(Local<Context> context)
+      : isolate_(context->GetIsolate()), context_(context) {
+    target_ = Object::New(isolate_);
+    node::json::CreatePerContextProperties(
+        target_, v8::Undefined(isolate_), context_, nullptr);
+  }
+
+  Local<String> Str(const std::string& value) const {
+    return String::NewFromUtf8(isolate_,
+                               value.data(),
+                               v8::NewStringType::kNormal,
+                               value.size())
+        .ToLocalChecked();
+  }
+
+  // Returns a Uint8Array of |json|. Views that are |padded| are followed by
+  // bytes that would complete most documents, and that the parser must not
+  // look at. The others end where their ArrayBuffer ends.
+  Local<Value> View(const std::string& json, bool padded) const {
+    const std::string filler = "1]}\"";
+    const size_t size = padded ? json.size() + 4096 : json.size();
+    Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate_, size);
+    char* data = static_cast<char*>(buffer->Data());
+    if (!json.empty()) memcpy(data, json.data(), json.size());
+    for (size_t i = json.size(); i < size; i++)
+      data[i] = filler[i % filler.size()];
+    return Uint8Array::New(buffer, 0, json.size());
+  }
+
+  MaybeLocal<Value> Call(const char* method,
+                         Local<Value> view,
+                         Local<Value> pointers = Local<Value>()) const {
+    Local<Value> args[] = {view, pointers};
+    Local<Function> function =
+        target_->Get(context_, node::OneByteString(isolate_, method))
+            .ToLocalChecked()
+            .As<Function>();
+    return function->Call(
+        context_, target_, pointers.IsEmpty() ? 1 : 2, args);
+  }
+
+  MaybeLocal<Value> ParseFields(const std::string& json,
+                                std::initializer_list<const char*> paths) {
+    Local<Array> pointers = Array::New(isolate_);
+    uint32_t i = 0;
+    for (const char* path : paths)
+      pointers->Set(context_, i++, Str(path)).Check();
+    return Call("parseFields", View(json, false), pointers);
+  }
+
+  std::string Stringify(Local<Value> value) const {
+    return node::Utf8Value(
+               isolate_, JSON::Stringify(context_, value).ToLocalChecked())
+        .ToString();
+  }
+
+  // Returns the name of the error that |try_catch| caught.
+  std::string ErrorName(const TryCatch& try_catch) const {
+    if (!try_catch.HasCaught() || !try_catch.Exception()->IsObject())
+      return "";
+    Local<Value> name =
+        try_catch.Exception()
+            .As<Object>()
+            ->Get(context_, node::FIXED_ONE_BYTE_STRING(isolate_, "name"))
+            .ToLocalChecked();
+    return node::Utf8Value(isolate_, name).ToString();
+  }
+
+ private:
+  Isolate* isolate_;
+  Local<Context> context_;
+  Local<Object> target_;
+};
+
+}  // namespace
+
+class NodeJSONTest : public EnvironmentTestFixture {};
+
+TEST_F(NodeJSONTest, MalformedDocuments) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Local<Context> context = (*env)->context();
+  Binding binding(context);
+
+  for (const std::string& json : kMalformed) {
+    {
+      TryCatch try_catch(isolate_);
+      ASSERT_TRUE(JSON::Parse(context, binding.Str(json)).IsEmpty()) << json;
+    }
+    for (bool padded : {false, true}) {
+      TryCatch try_catch(isolate_);
+      EXPECT_TRUE(binding.Call("parse", binding.View(json, padded)).IsEmpty())
+          << json << (padded ? " in place" : " copied");
+      EXPECT_EQ(binding.ErrorName(try_catch), "SyntaxError")
+          << json << (padded ? " in place" : " copied");
+    }
+  }
+}
+
+TEST_F(NodeJSONTest, InvalidUTF8) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  // The bytes are not decoded with replacement characters first, as
+  // buf.toString() would.
+  for (const std::string json :
+       {"\"\xff\"", "[\"a\xc3\"]", "{\"\xed\xa0\x80\":1}"}) {
+    TryCatch try_catch(isolate_);
+    EXPECT_TRUE(binding.Call("parse", binding.View(json, false)).IsEmpty());
+    EXPECT_EQ(binding.ErrorName(try_catch), "SyntaxError");
+  }
+}
+
+TEST_F(NodeJSONTest, MatchesJSONParse) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Local<Context> context = (*env)->context();
+  Binding binding(context);
+
+  for (const std::string& json : kValid) {
+    Local<Value> expected = JSON::Parse(context, binding.Str(json))
+                                .ToLocalChecked();
+    for (bool padded : {false, true}) {
+      TryCatch try_catch(isolate_);
+      Local<Value> actual;
+      ASSERT_TRUE(
+          binding.Call("parse", binding.View(json, padded)).ToLocal(&actual))
+          << json << (padded ? " in place" : " copied");
+      EXPECT_EQ(binding.Stringify(actual), binding.Stringify(expected))
+          << json;
+      if (expected->IsNumber()) {
+        ASSERT_TRUE(actual->IsNumber()) << json;
+        const double a = actual.As<v8::Number>()->Value();
+        const double e = expected.As<v8::Number>()->Value();
+        EXPECT_EQ(a, e) << json;
+        EXPECT_EQ(std::signbit(a), std::signbit(e)) << json;
+      }
+    }
+  }
+
+  // JSON.stringify() turns these into null.
+  for (const std::string json : {"1E400", "-1e999", " 1e999 "}) {
+    Local<Value> expected = JSON::Parse(context, binding.Str(json))
+                                .ToLocalChecked();
+    Local<Value> actual;
+    ASSERT_TRUE(
+        binding.Call("parse", binding.View(json, false)).ToLocal(&actual))
+        << json;
+    ASSERT_TRUE(actual->IsNumber()) << json;
+    EXPECT_TRUE(std::isinf(actual.As<v8::Number>()->Value())) << json;
+    EXPECT_TRUE(actual->StrictEquals(expected)) << json;
+  }
+  Local<Value> actual;
+  ASSERT_TRUE(
+      binding.Call("parse", binding.View("[1E400,{\"a\":-1e999}]", false))
+          .ToLocal(&actual));
+  EXPECT_EQ(binding.Stringify(actual), "[null,{\"a\":null}]");
+}
+
+TEST_F(NodeJSONTest, ParseFields) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+  const std::string document =
+      "{\"a\":1,\"b\":[1,{\"c\":\"\\ud800\"}],\"d/e\":2,\"f~g\":3}";
+
+  Local<Value> result;
+  ASSERT_TRUE(binding
+                  .ParseFields(document,
+                               {"/a", "/b/1", "/b/5", "/x", "/d~1e", "/f~0g",
+                                "", "/b/-"})
+                  .ToLocal(&result));
+  ASSERT_TRUE(result->IsArray());
+  EXPECT_EQ(binding.Stringify(result),
+            "[1,{\"c\":\"\\ud800\"},null,null,2,3," + document + ",null]");
+  // Fields that the document does not have are undefined, not null.
+  Local<Value> missing =
+      result.As<Array>()->Get((*env)->context(), 2).ToLocalChecked();
+  EXPECT_TRUE(missing->IsUndefined());
+
+  // Malformed parts of the document that lead to the selected fields are
+  // reported like parse() does.
+  for (const auto& [json, pointer] :
+       std::vector<std::pair<const char*, const char*>>{
+           {"{\"a\":1,\"b\":[1,2", "/a"},
+           {"{\"a\":{\"b\":[1,]}}", "/a/b"},
+           {"{\"a\":{\"b\":tru}}", "/a/b"},
+           {"{\"a\":{\"b\":01}}", "/a/b"},
+           {"{\"a\":\"\\x\"}", "/a"},
+       }) {
+    TryCatch try_catch(isolate_);
+    EXPECT_TRUE(binding.ParseFields(json, {pointer}).IsEmpty()) << json;
+    EXPECT_EQ(binding.ErrorName(try_catch), "SyntaxError") << json;
+  }
+
+  // Parts that are not read are not validated.
+  ASSERT_TRUE(binding.ParseFields("{\"a\":1,}", {"/a"}).ToLocal(&result));
+  EXPECT_EQ(binding.Stringify(result), "[1]");
+
+  for (const char* pointer : {"a", "/a/01"}) {
+    TryCatch try_catch(isolate_);
+    EXPECT_TRUE(
+        binding.ParseFields("{\"a\":[1]}", {pointer}).IsEmpty()) << pointer;
+    EXPECT_EQ(binding.ErrorName(try_catch), "TypeError") << pointer;
+  }
+}
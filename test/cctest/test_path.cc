@@ -89,3 +89,98 @@ TEST_F(PathTest, ToNamespacedPath) {
   EXPECT_EQ(data.ToStringView(), "hello world");  // Input should not be mutated
 #endif
 }
+
+#ifndef _WIN32
+using node::GetCachedCwd;
+using node::InvalidateCachedCwd;
+using node::PathJoin;
+using node::PathNormalize;
+using node::PathRelative;
+
+// The expectations below mirror the posix cases of test/parallel/
+// test-path-normalize.js, test-path-join.js and test-path-relative.js.
+TEST_F(PathTest, PathNormalize) {
+  EXPECT_EQ(PathNormalize(""), ".");
+  EXPECT_EQ(PathNormalize("./"), "./");
+  EXPECT_EQ(PathNormalize("/"), "/");
+  EXPECT_EQ(PathNormalize("./fixtures///b/../b/c.js"), "fixtures/b/c.js");
+  EXPECT_EQ(PathNormalize("/foo/../../../bar"), "/bar");
+  EXPECT_EQ(PathNormalize("a//b//../b"), "a/b");
+  EXPECT_EQ(PathNormalize("a//b//./c"), "a/b/c");
+  EXPECT_EQ(PathNormalize("a//b//."), "a/b");
+  EXPECT_EQ(PathNormalize("/a/b/c/../../../x/y/z"), "/x/y/z");
+  EXPECT_EQ(PathNormalize("///..//./foo/.//bar"), "/foo/bar");
+  EXPECT_EQ(PathNormalize("bar/foo../../"), "bar/");
+  EXPECT_EQ(PathNormalize("bar/foo../.."), "bar");
+  EXPECT_EQ(PathNormalize("bar/foo../../baz"), "bar/baz");
+  EXPECT_EQ(PathNormalize("bar/foo../"), "bar/foo../");
+  EXPECT_EQ(PathNormalize("bar/foo.."), "bar/foo..");
+  EXPECT_EQ(PathNormalize("../foo../../../bar"), "../../bar");
+  EXPECT_EQ(PathNormalize("../.../.././.../../../bar"), "../../bar");
+}
+
+TEST_F(PathTest, PathJoin) {
+  EXPECT_EQ(PathJoin({}), ".");
+  EXPECT_EQ(PathJoin({"", ""}), ".");
+  EXPECT_EQ(PathJoin({".", "x/b", "..", "/b/c.js"}), "x/b/c.js");
+  EXPECT_EQ(PathJoin({"/.", "x/b", "..", "/b/c.js"}), "/x/b/c.js");
+  EXPECT_EQ(PathJoin({"/foo", "../../../bar"}), "/bar");
+  EXPECT_EQ(PathJoin({"foo", "../../../bar"}), "../../bar");
+  EXPECT_EQ(PathJoin({"foo/", "../../../bar"}), "../../bar");
+  EXPECT_EQ(PathJoin({"foo/x", "../../../bar"}), "../bar");
+  EXPECT_EQ(PathJoin({"foo/x", "./bar"}), "foo/x/bar");
+  EXPECT_EQ(PathJoin({"./", "..", "/foo"}), "../foo");
+  EXPECT_EQ(PathJoin({"", "/foo"}), "/foo");
+  EXPECT_EQ(PathJoin({" ", "."}), " ");
+  EXPECT_EQ(PathJoin({"/", "/", "/"}), "/");
+  EXPECT_EQ(PathJoin({"foo", "/bar"}), "foo/bar");
+  EXPECT_EQ(PathJoin({"foo/", ""}), "foo/");
+}
+
+TEST_F(PathTest, PathRelative) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  EXPECT_EQ(PathRelative(*env, "/var/lib", "/var"), "..");
+  EXPECT_EQ(PathRelative(*env, "/var/lib", "/bin"), "../../bin");
+  EXPECT_EQ(PathRelative(*env, "/var/lib", "/var/lib"), "");
+  EXPECT_EQ(PathRelative(*env, "/var/lib", "/var/apache"), "../apache");
+  EXPECT_EQ(PathRelative(*env, "/var/", "/var/lib"), "lib");
+  EXPECT_EQ(PathRelative(*env, "/", "/var/lib"), "var/lib");
+  EXPECT_EQ(PathRelative(*env, "/foo/test", "/foo/test/bar/package.json"),
+            "bar/package.json");
+  EXPECT_EQ(PathRelative(*env, "/Users/a/web/b/test/mails", "/Users/a/web/b"),
+            "../..");
+  EXPECT_EQ(PathRelative(*env, "/foo/bar/baz-quux", "/foo/bar/baz"), "../baz");
+  EXPECT_EQ(PathRelative(*env, "/foo/bar/baz", "/foo/bar/baz-quux"),
+            "../baz-quux");
+  EXPECT_EQ(PathRelative(*env, "/baz-quux", "/baz"), "../baz");
+  EXPECT_EQ(PathRelative(*env, "/baz", "/baz-quux"), "../baz-quux");
+  EXPECT_EQ(PathRelative(*env, "/page1/page2/foo", "/"), "../../..");
+  // Relative paths are resolved against the current working directory.
+  EXPECT_EQ(PathRelative(*env, "a", "a/b"), "b");
+  EXPECT_EQ(PathRelative(*env, "a/b", "a"), "..");
+}
+
+TEST_F(PathTest, CachedCwd) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  InvalidateCachedCwd();
+  const std::string cwd = (*env)->GetCwd((*env)->exec_path());
+  EXPECT_EQ(GetCachedCwd(*env), cwd);
+
+  // Changing directories behind the cache's back keeps the old value until
+  // the cache is invalidated, like process.chdir() does.
+  ASSERT_EQ(uv_chdir("/"), 0);
+  EXPECT_EQ(GetCachedCwd(*env), cwd);
+  EXPECT_EQ(PathResolve(*env, {"a"}), PathJoin({cwd, "a"}));
+  InvalidateCachedCwd();
+  EXPECT_EQ(GetCachedCwd(*env), "/");
+  EXPECT_EQ(PathResolve(*env, {"a"}), "/a");
+
+  ASSERT_EQ(uv_chdir(cwd.c_str()), 0);
+  InvalidateCachedCwd();
+  EXPECT_EQ(GetCachedCwd(*env), cwd);
+}
+#endif  // _WIN32
@@ -1,7 +1,10 @@
 #include "node_internals.h"
 #include "libplatform/libplatform.h"
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "node_test_fixture.h"
 
@@ -123,3 +126,159 @@ TEST_F(PlatformTest, TracingControllerNullptr) {
   node::SetTracingController(orig_controller);
   EXPECT_EQ(node::GetTracingController(), orig_controller);
 }
+
+namespace {
+
+using node::WorkerThreadsTaskRunner;
+using v8::TaskPriority;
+
+class CallbackTask : public v8::Task {
+ public:
+  explicit CallbackTask(std::function<void()> callback)
+      : callback_(std::move(callback)) {}
+
+  void Run() final { callback_(); }
+
+ private:
+  std::function<void()> callback_;
+};
+
+std::unique_ptr<v8::Task> MakeTask(std::function<void()> callback) {
+  return std::make_unique<CallbackTask>(std::move(callback));
+}
+
+// Polls |condition| for up to ten seconds.
+bool WaitFor(const std::function<bool()>& condition) {
+  for (int i = 0; i < 10000; i++) {
+    if (condition()) return true;
+    uv_sleep(1);
+  }
+  return condition();
+}
+
+}  // namespace
+
+TEST(WorkerThreadsTaskRunnerTest, RunsHigherPrioritiesFirst) {
+  WorkerThreadsTaskRunner runner(1);
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  // Keep the only worker busy until everything has been queued.
+  runner.PostTask(TaskPriority::kUserBlocking, MakeTask([&] {
+                    started = true;
+                    while (!release) uv_sleep(1);
+                  }));
+  EXPECT_TRUE(WaitFor([&] { return started.load(); }));
+
+  std::vector<std::string> order;
+  auto record = [&](const char* name) {
+    return MakeTask([&order, name] { order.push_back(name); });
+  };
+  runner.PostTask(TaskPriority::kBestEffort, record("best-effort 1"));
+  runner.PostTask(TaskPriority::kUserVisible, record("user-visible 1"));
+  runner.PostTask(TaskPriority::kUserBlocking, record("user-blocking 1"));
+  runner.PostTask(TaskPriority::kBestEffort, record("best-effort 2"));
+  runner.PostTask(TaskPriority::kUserBlocking, record("user-blocking 2"));
+  runner.PostTask(TaskPriority::kUserVisible, record("user-visible 2"));
+  release = true;
+  runner.BlockingDrain();
+
+  // Tasks of the same priority run in the order they were posted.
+  EXPECT_EQ(order,
+            (std::vector<std::string>{"user-blocking 1",
+                                      "user-blocking 2",
+                                      "user-visible 1",
+                                      "user-visible 2",
+                                      "best-effort 1",
+                                      "best-effort 2"}));
+  runner.Shutdown();
+}
+
+TEST(WorkerThreadsTaskRunnerTest, RunsDelayedTasksByDeadline) {
+  WorkerThreadsTaskRunner runner(1);
+  std::vector<std::string> order;
+  std::atomic<int> ran{0};
+  auto record = [&](const char* name) {
+    return MakeTask([&order, &ran, name] {
+      order.push_back(name);
+      ran++;
+    });
+  };
+  runner.PostDelayedTask(TaskPriority::kUserVisible, record("later"), 0.2);
+  runner.PostDelayedTask(TaskPriority::kUserVisible, record("sooner"), 0.01);
+  runner.PostDelayedTask(TaskPriority::kUserVisible, record("now"), 0);
+  EXPECT_TRUE(WaitFor([&] { return ran.load() == 3; }));
+  runner.BlockingDrain();
+
+  EXPECT_EQ(order, (std::vector<std::string>{"now", "sooner", "later"}));
+  runner.Shutdown();
+}
+
+TEST(WorkerThreadsTaskRunnerTest, IdleWorkersStealTasks) {
+  WorkerThreadsTaskRunner runner(2);
+  constexpr int kChildren = 8;
+  std::atomic<int> children{0};
+  std::atomic<bool> stolen{false};
+  runner.PostTask(TaskPriority::kUserVisible, MakeTask([&] {
+                    // Tasks posted from a worker are queued for that worker,
+                    // which stays busy until the other one has run them all.
+                    for (int i = 0; i < kChildren; i++) {
+                      runner.PostTask(TaskPriority::kUserVisible,
+                                      MakeTask([&] { children++; }));
+                    }
+                    stolen = WaitFor([&] { return children == kChildren; });
+                  }));
+  runner.BlockingDrain();
+
+  EXPECT_TRUE(stolen);
+  EXPECT_EQ(children, kChildren);
+  runner.Shutdown();
+}
+
+TEST(WorkerThreadsTaskRunnerTest, MultipleProducersStress) {
+  constexpr int kProducers = 4;
+  constexpr int kTasksPerProducer = 2000;
+  // Every 16th task posts kChildren more tasks from the worker thread.
+  constexpr int kChildren = 4;
+  constexpr int kExpected =
+      kProducers * (kTasksPerProducer + kTasksPerProducer / 16 * kChildren);
+
+  WorkerThreadsTaskRunner runner(4);
+  std::atomic<int> ran{0};
+
+  struct Producer {
+    WorkerThreadsTaskRunner* runner;
+    std::atomic<int>* ran;
+    uv_thread_t thread;
+  };
+  std::vector<Producer> producers(kProducers, Producer{&runner, &ran, {}});
+  for (Producer& producer : producers) {
+    ASSERT_EQ(0, uv_thread_create(&producer.thread, [](void* arg) {
+      Producer* producer = static_cast<Producer*>(arg);
+      WorkerThreadsTaskRunner* runner = producer->runner;
+      std::atomic<int>* ran = producer->ran;
+      for (int i = 0; i < kTasksPerProducer; i++) {
+        const TaskPriority priority = static_cast<TaskPriority>(i % 3);
+        runner->PostTask(priority, MakeTask([runner, ran, i, priority] {
+          (*ran)++;
+          if (i % 16 != 0) return;
+          for (int j = 0; j < kChildren; j++)
+            runner->PostTask(priority, MakeTask([ran] { (*ran)++; }));
+        }));
+      }
+    }, &producer));
+  }
+
+  // Resizing the pool while tasks are being posted and run must not lose
+  // any of them.
+  runner.SetThreadPoolSize(2);
+  runner.SetThreadPoolSize(6);
+  runner.SetThreadPoolSize(3);
+
+  for (Producer& producer : producers)
+    ASSERT_EQ(0, uv_thread_join(&producer.thread));
+  runner.BlockingDrain();
+
+  EXPECT_EQ(ran, kExpected);
+  EXPECT_EQ(runner.NumberOfWorkerThreads(), 3);
+  runner.Shutdown();
+}
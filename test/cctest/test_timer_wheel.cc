@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "timers.h"
+
+#include <algorithm>
+#include <vector>
+
+using node::timers::TimerWheel;
+
+namespace {
+
+constexpr uint64_t kTick = TimerWheel::kResolutionMs;
+constexpr uint64_t kRotation = TimerWheel::kSlotCount * kTick;
+
+std::vector<uint32_t> Advance(TimerWheel* wheel, uint64_t now) {
+  std::vector<uint32_t> expired;
+  wheel->Advance(now, &expired);
+  std::sort(expired.begin(), expired.end());
+  return expired;
+}
+
+}  // namespace
+
+TEST(TimerWheelTest, ExpiresAtTheNextTick) {
+  TimerWheel wheel;
+  EXPECT_EQ(wheel.NextTickTime(), UINT64_MAX);
+
+  // 1000ms is rounded up to the next tick, so the timer never fires early.
+  const uint32_t id = wheel.Insert(0, 1000, true);
+  EXPECT_EQ(wheel.ExpiryTime(id), 32 * kTick);
+  EXPECT_EQ(wheel.NextTickTime(), 32 * kTick);
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+
+  EXPECT_TRUE(Advance(&wheel, 32 * kTick - 1).empty());
+  EXPECT_EQ(Advance(&wheel, 32 * kTick), std::vector<uint32_t>{id});
+  EXPECT_EQ(wheel.scheduled_count(), 0u);
+  EXPECT_EQ(wheel.NextTickTime(), UINT64_MAX);
+
+  // Exact multiples of the resolution are not rounded.
+  const uint32_t exact = wheel.Insert(32 * kTick, 2 * kTick, true);
+  EXPECT_EQ(wheel.ExpiryTime(exact), 34 * kTick);
+}
+
+TEST(TimerWheelTest, ExpiresEverythingThatIsDue) {
+  TimerWheel wheel;
+  const uint32_t a = wheel.Insert(0, 1000, true);
+  const uint32_t b = wheel.Insert(0, 1000, false);
+  const uint32_t c = wheel.Insert(0, 2000, true);
+  const uint32_t d = wheel.Insert(0, 5000, true);
+
+  // Timers that share a slot expire together.
+  EXPECT_EQ(Advance(&wheel, 1500), (std::vector<uint32_t>{a, b}));
+  // Advancing past several slots at once visits all of them.
+  EXPECT_EQ(Advance(&wheel, 6000), (std::vector<uint32_t>{c, d}));
+  EXPECT_TRUE(Advance(&wheel, 7000).empty());
+  // Going back in time is a no-op.
+  EXPECT_TRUE(Advance(&wheel, 0).empty());
+}
+
+TEST(TimerWheelTest, LaterRotations) {
+  TimerWheel wheel;
+  // Due after three rotations of the wheel, in the same slot as a timer
+  // that is due in the first one.
+  const uint64_t duration = 3 * kRotation + 100 * kTick;
+  const uint32_t late = wheel.Insert(0, duration, true);
+  const uint32_t early = wheel.Insert(0, 100 * kTick, true);
+  EXPECT_EQ(wheel.ExpiryTime(late), duration);
+
+  EXPECT_EQ(wheel.NextTickTime(), 100 * kTick);
+  EXPECT_EQ(Advance(&wheel, 100 * kTick), std::vector<uint32_t>{early});
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+
+  // The slot comes around once per rotation, before the timer is due.
+  for (uint64_t rotation = 1; rotation < 3; rotation++) {
+    const uint64_t tick_time = rotation * kRotation + 100 * kTick;
+    EXPECT_EQ(wheel.NextTickTime(), tick_time);
+    EXPECT_TRUE(Advance(&wheel, tick_time).empty());
+  }
+  EXPECT_EQ(wheel.NextTickTime(), duration);
+  EXPECT_TRUE(Advance(&wheel, duration - 1).empty());
+  EXPECT_EQ(Advance(&wheel, duration), std::vector<uint32_t>{late});
+
+  // A jump over many rotations expires the timer once.
+  const uint32_t again = wheel.Insert(duration, duration, true);
+  EXPECT_EQ(Advance(&wheel, 100 * kRotation), std::vector<uint32_t>{again});
+  EXPECT_EQ(wheel.scheduled_count(), 0u);
+}
+
+TEST(TimerWheelTest, SkipsSlotsWhileEmpty) {
+  TimerWheel wheel;
+  wheel.Cancel(wheel.Insert(0, 1000, true));
+
+  // The first timer after a long idle period is not placed relative to the
+  // time the wheel was last advanced.
+  const uint64_t now = 1000 * kRotation + 5;
+  const uint32_t id = wheel.Insert(now, 1000, true);
+  EXPECT_EQ(wheel.ExpiryTime(id), now - 5 + 32 * kTick);
+  EXPECT_EQ(wheel.NextTickTime(), wheel.ExpiryTime(id));
+  EXPECT_EQ(Advance(&wheel, wheel.ExpiryTime(id)), std::vector<uint32_t>{id});
+}
+
+TEST(TimerWheelTest, Cancel) {
+  TimerWheel wheel;
+  const uint32_t a = wheel.Insert(0, 1000, true);
+  const uint32_t b = wheel.Insert(0, 1000, true);
+  wheel.Cancel(a);
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+  EXPECT_EQ(wheel.refed_count(), 1u);
+  // Cancelling twice, or an unknown id, is a no-op.
+  wheel.Cancel(a);
+  wheel.Cancel(12345);
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+
+  EXPECT_EQ(Advance(&wheel, 2000), std::vector<uint32_t>{b});
+  EXPECT_FALSE(wheel.Refresh(a, 2000));
+  // Ids are reused once they are free.
+  EXPECT_EQ(wheel.Insert(2000, 1000, true), a);
+}
+
+TEST(TimerWheelTest, Refresh) {
+  TimerWheel wheel;
+  const uint32_t id = wheel.Insert(0, 1000, true);
+  EXPECT_TRUE(wheel.Refresh(id, 500));
+  EXPECT_EQ(wheel.ExpiryTime(id), 47 * kTick);
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+  EXPECT_EQ(wheel.refed_count(), 1u);
+  EXPECT_TRUE(Advance(&wheel, 32 * kTick).empty());
+  EXPECT_EQ(Advance(&wheel, 47 * kTick), std::vector<uint32_t>{id});
+
+  // A timer refreshed while its batch is delivered is scheduled again and
+  // keeps its id.
+  EXPECT_TRUE(wheel.Refresh(id, 47 * kTick));
+  wheel.ReleaseExpired({id});
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+  const uint32_t other = wheel.Insert(47 * kTick, 1000, true);
+  EXPECT_NE(other, id);
+  EXPECT_EQ(Advance(&wheel, 79 * kTick), (std::vector<uint32_t>{id, other}));
+
+  // Expired ids stay reserved until the batch is released.
+  const uint32_t next = wheel.Insert(79 * kTick, 1000, true);
+  EXPECT_NE(next, id);
+  EXPECT_NE(next, other);
+  wheel.ReleaseExpired({id, other});
+  EXPECT_FALSE(wheel.Refresh(id, 79 * kTick));
+}
+
+TEST(TimerWheelTest, RefCounts) {
+  TimerWheel wheel;
+  const uint32_t a = wheel.Insert(0, 1000, true);
+  const uint32_t b = wheel.Insert(0, 2000, false);
+  EXPECT_EQ(wheel.refed_count(), 1u);
+
+  wheel.SetRef(b, true);
+  EXPECT_EQ(wheel.refed_count(), 2u);
+  wheel.SetRef(b, true);
+  EXPECT_EQ(wheel.refed_count(), 2u);
+  wheel.SetRef(a, false);
+  EXPECT_EQ(wheel.refed_count(), 1u);
+
+  // Expired and cancelled timers are not counted.
+  wheel.SetRef(a, true);
+  EXPECT_EQ(Advance(&wheel, 1500), std::vector<uint32_t>{a});
+  EXPECT_EQ(wheel.refed_count(), 1u);
+  wheel.SetRef(a, false);
+  wheel.SetRef(a, true);
+  EXPECT_EQ(wheel.refed_count(), 1u);
+  wheel.Cancel(b);
+  EXPECT_EQ(wheel.refed_count(), 0u);
+
+  // A refresh keeps the ref state.
+  wheel.ReleaseExpired({a});
+  const uint32_t c = wheel.Insert(1500, 1000, false);
+  EXPECT_TRUE(wheel.Refresh(c, 1600));
+  EXPECT_EQ(wheel.refed_count(), 0u);
+  EXPECT_EQ(wheel.scheduled_count(), 1u);
+}
@@ -0,0 +1,435 @@
+#include "env-inl.h"
+#include "gtest/gtest.h"
+#include "node_test_fixture.h"
+#include "node_url_pattern.h"
+#include "util-inl.h"
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <utility>
+
+using v8::Array;
+using v8::Boolean;
+using v8::Context;
+using v8::Function;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::TryCatch;
+using v8::Value;
+
+namespace {
+
+using Components = std::initializer_list<std::pair<const char*, const char*>>;
+
+// Calls into the binding the way lib/ does: patterns are created from
+// objects of component strings, and URLs are passed as strings or objects.
+class Binding {
+ public:
+  explicit Binding(Local<Context> context)
+      : isolate_(context->GetIsolate()), context_(context) {
+    Local<Object> target = Object::New(isolate_);
+    node::url_pattern::CreatePerContextProperties(
+        target, v8::Undefined(isolate_), context_, nullptr);
+    pattern_ = Get(target, "URLPattern").As<Function>();
+    list_ = Get(target, "URLPatternList").As<Function>();
+  }
+
+  Local<Value> Str(const char* value) const {
+    return node::OneByteString(isolate_, value);
+  }
+
+  Local<v8::Object> Init(Components components) const {
+    Local<v8::Object> object = v8::Object::New(isolate_);
+    for (const auto& [name, value] : components)
+      object->Set(context_, Str(name), Str(value)).Check();
+    return object;
+  }
+
+  Local<Value> Get(Local<v8::Object> object, const char* name) const {
+    return object->Get(context_, Str(name)).ToLocalChecked();
+  }
+
+  std::string GetString(Local<v8::Object> object, const char* name) const {
+    return node::Utf8Value(isolate_, Get(object, name)).ToString();
+  }
+
+  // Returns an empty handle if the constructor threw.
+  Local<v8::Object> New(Components components, bool ignore_case = false) {
+    Local<Value> args[] = {Init(components),
+                           Boolean::New(isolate_, ignore_case)};
+    return pattern_->NewInstance(context_, node::arraysize(args), args)
+        .FromMaybe(Local<v8::Object>());
+  }
+
+  Local<v8::Object> NewList(std::initializer_list<Local<Value>> patterns) {
+    Local<Value> args[] = {
+        Array::New(isolate_, const_cast<Local<Value>*>(patterns.begin()),
+                   patterns.size())};
+    return list_->NewInstance(context_, node::arraysize(args), args)
+        .FromMaybe(Local<v8::Object>());
+  }
+
+  Local<Value> Call(Local<v8::Object> receiver,
+                    const char* method,
+                    Local<Value> input,
+                    const char* base = nullptr) {
+    Local<Value> args[] = {input, v8::Undefined(isolate_)};
+    if (base != nullptr) args[1] = Str(base);
+    return Get(receiver, method)
+        .As<Function>()
+        ->Call(context_, receiver, node::arraysize(args), args)
+        .ToLocalChecked();
+  }
+
+  bool Test(Local<v8::Object> pattern,
+            const char* input,
+            const char* base = nullptr) {
+    return Call(pattern, "test", Str(input), base)->IsTrue();
+  }
+
+  // Returns the group |name| of |component| that exec() reports, or
+  // std::nullopt if the pattern does not match.
+  std::optional<std::string> Group(Local<v8::Object> pattern,
+                                   const char* input,
+                                   const char* component,
+                                   const char* name) {
+    Local<Value> result = Call(pattern, "exec", Str(input));
+    if (result->IsNull()) return std::nullopt;
+    Local<v8::Object> entry = Get(result.As<v8::Object>(), component)
+                                  .As<v8::Object>();
+    return GetString(Get(entry, "groups").As<v8::Object>(), name);
+  }
+
+  // Returns the index of the pattern that match() picks, or -1.
+  int Match(Local<v8::Object> list, const char* input) {
+    Local<Value> result = Call(list, "match", Str(input));
+    if (result->IsNull()) return -1;
+    return Get(result.As<v8::Object>(), "0")
+        ->Int32Value(context_)
+        .FromJust();
+  }
+
+ private:
+  Isolate* isolate_;
+  Local<Context> context_;
+  Local<Function> pattern_;
+  Local<Function> list_;
+};
+
+}  // namespace
+
+class URLPatternTest : public EnvironmentTestFixture {};
+
+TEST_F(URLPatternTest, NamedGroups) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> pattern = binding.New({{"pathname", "/books/:id"}});
+  ASSERT_FALSE(pattern.IsEmpty());
+  EXPECT_EQ(binding.GetString(pattern, "pathname"), "/books/:id");
+  EXPECT_EQ(binding.GetString(pattern, "hostname"), "*");
+
+  EXPECT_TRUE(binding.Test(pattern, "https://example.com/books/123"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com/books"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com/books/"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com/books/1/2"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com/authors/1"));
+  EXPECT_EQ(binding.Group(pattern, "https://example.com/books/123",
+                          "pathname", "id"),
+            "123");
+  EXPECT_EQ(binding.Group(pattern, "https://example.com/books/123",
+                          "hostname", "0"),
+            "example.com");
+  EXPECT_EQ(binding.Group(pattern, "https://example.com/books", "pathname",
+                          "id"),
+            std::nullopt);
+
+  // exec() reports the input of every component and the URL it was given.
+  Local<Value> result =
+      binding.Call(pattern, "exec", binding.Str("https://example.com/books/1"));
+  ASSERT_TRUE(result->IsObject());
+  Local<Object> pathname =
+      binding.Get(result.As<Object>(), "pathname").As<Object>();
+  EXPECT_EQ(binding.GetString(pathname, "input"), "/books/1");
+  Local<Value> inputs = binding.Get(result.As<Object>(), "inputs");
+  ASSERT_TRUE(inputs->IsArray());
+  EXPECT_EQ(binding.GetString(inputs.As<Object>(), "0"),
+            "https://example.com/books/1");
+}
+
+TEST_F(URLPatternTest, Modifiers) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  // The '/' before an optional group is optional together with it.
+  Local<Object> optional = binding.New({{"pathname", "/books/:id?"}});
+  ASSERT_FALSE(optional.IsEmpty());
+  EXPECT_TRUE(binding.Test(optional, "https://example.com/books"));
+  EXPECT_TRUE(binding.Test(optional, "https://example.com/books/1"));
+  EXPECT_FALSE(binding.Test(optional, "https://example.com/books/"));
+  EXPECT_FALSE(binding.Test(optional, "https://example.com/books/1/2"));
+
+  Local<Object> one_or_more = binding.New({{"pathname", "/:path+"}});
+  ASSERT_FALSE(one_or_more.IsEmpty());
+  EXPECT_FALSE(binding.Test(one_or_more, "https://example.com/"));
+  EXPECT_EQ(binding.Group(one_or_more, "https://example.com/a/b/c",
+                          "pathname", "path"),
+            "a/b/c");
+
+  Local<Object> zero_or_more = binding.New({{"pathname", "/files/:path*"}});
+  ASSERT_FALSE(zero_or_more.IsEmpty());
+  EXPECT_TRUE(binding.Test(zero_or_more, "https://example.com/files"));
+  EXPECT_EQ(binding.Group(zero_or_more, "https://example.com/files/a/b",
+                          "pathname", "path"),
+            "a/b");
+  EXPECT_FALSE(binding.Test(zero_or_more, "https://example.com/filesx"));
+
+  Local<Object> group = binding.New({{"pathname", "/item{s}?"}});
+  ASSERT_FALSE(group.IsEmpty());
+  EXPECT_TRUE(binding.Test(group, "https://example.com/item"));
+  EXPECT_TRUE(binding.Test(group, "https://example.com/items"));
+  EXPECT_FALSE(binding.Test(group, "https://example.com/itemss"));
+
+  Local<Object> group_with_name =
+      binding.New({{"pathname", "/blog{/:year(\\d+)}?/:slug"}});
+  ASSERT_FALSE(group_with_name.IsEmpty());
+  EXPECT_EQ(binding.Group(group_with_name, "https://example.com/blog/2024/x",
+                          "pathname", "year"),
+            "2024");
+  EXPECT_TRUE(binding.Test(group_with_name, "https://example.com/blog/x"));
+  EXPECT_FALSE(
+      binding.Test(group_with_name, "https://example.com/blog/abc/x"));
+}
+
+TEST_F(URLPatternTest, WildcardsAndRegExps) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> wildcard = binding.New({{"pathname", "/files/*"}});
+  ASSERT_FALSE(wildcard.IsEmpty());
+  EXPECT_EQ(binding.Group(wildcard, "https://example.com/files/a/b.txt",
+                          "pathname", "0"),
+            "a/b.txt");
+  EXPECT_EQ(binding.Group(wildcard, "https://example.com/files/",
+                          "pathname", "0"),
+            "");
+  EXPECT_FALSE(binding.Test(wildcard, "https://example.com/files"));
+
+  Local<Object> digits = binding.New({{"pathname", "/:id(\\d+)"}});
+  ASSERT_FALSE(digits.IsEmpty());
+  EXPECT_TRUE(binding.Test(digits, "https://example.com/42"));
+  EXPECT_FALSE(binding.Test(digits, "https://example.com/abc"));
+
+  Local<Object> unnamed = binding.New({{"pathname", "/(foo|bar)/x"}});
+  ASSERT_FALSE(unnamed.IsEmpty());
+  EXPECT_EQ(binding.Group(unnamed, "https://example.com/bar/x", "pathname",
+                          "0"),
+            "bar");
+  EXPECT_FALSE(binding.Test(unnamed, "https://example.com/baz/x"));
+
+  // Characters that are special in regular expressions are matched as they
+  // are written.
+  Local<Object> escaped = binding.New({{"pathname", "/v1.0/:name"}});
+  ASSERT_FALSE(escaped.IsEmpty());
+  EXPECT_TRUE(binding.Test(escaped, "https://example.com/v1.0/x"));
+  EXPECT_FALSE(binding.Test(escaped, "https://example.com/v1x0/x"));
+
+  // Only the pathname has '/' as its segment delimiter.
+  Local<Object> subdomain = binding.New({{"hostname", "*.example.com"}});
+  ASSERT_FALSE(subdomain.IsEmpty());
+  EXPECT_EQ(binding.Group(subdomain, "https://a.b.example.com/", "hostname",
+                          "0"),
+            "a.b");
+  EXPECT_FALSE(binding.Test(subdomain, "https://example.com/"));
+  Local<Object> label = binding.New({{"hostname", ":sub.example.com"}});
+  ASSERT_FALSE(label.IsEmpty());
+  EXPECT_TRUE(binding.Test(label, "https://api.example.com/"));
+  EXPECT_FALSE(binding.Test(label, "https://a.b.example.com/"));
+
+  Local<Object> search = binding.New({{"search", "q=:term"}});
+  ASSERT_FALSE(search.IsEmpty());
+  EXPECT_EQ(binding.Group(search, "https://example.com/?q=a/b", "search",
+                          "term"),
+            "a/b");
+}
+
+TEST_F(URLPatternTest, Components) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> pattern = binding.New({{"protocol", "http{s}?"},
+                                       {"hostname", "example.com"},
+                                       {"port", ""},
+                                       {"pathname", "/api/*"}});
+  ASSERT_FALSE(pattern.IsEmpty());
+  EXPECT_TRUE(binding.Test(pattern, "https://example.com/api/x"));
+  EXPECT_TRUE(binding.Test(pattern, "http://example.com/api/x"));
+  EXPECT_FALSE(binding.Test(pattern, "ftp://example.com/api/x"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.org/api/x"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com:8080/api/x"));
+  // The default port of the scheme is not part of the URL.
+  EXPECT_TRUE(binding.Test(pattern, "https://example.com:443/api/x"));
+  EXPECT_FALSE(binding.Test(pattern, "https://example.com/other"));
+
+  Local<Object> hash = binding.New({{"hash", "section-:n"}});
+  ASSERT_FALSE(hash.IsEmpty());
+  EXPECT_EQ(binding.Group(hash, "https://example.com/#section-2", "hash",
+                          "n"),
+            "2");
+
+  Local<Object> credentials =
+      binding.New({{"username", "admin"}, {"password", "*"}});
+  ASSERT_FALSE(credentials.IsEmpty());
+  EXPECT_TRUE(binding.Test(credentials, "https://admin:pw@example.com/"));
+  EXPECT_FALSE(binding.Test(credentials, "https://guest:pw@example.com/"));
+}
+
+TEST_F(URLPatternTest, Inputs) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> pattern = binding.New({{"pathname", "/books/:id"}});
+  ASSERT_FALSE(pattern.IsEmpty());
+
+  EXPECT_TRUE(binding.Test(pattern, "/books/1", "https://example.com"));
+  EXPECT_TRUE(binding.Test(pattern, "../books/1", "https://example.com/a/"));
+  // A relative URL without a base, or with an invalid base, does not match.
+  EXPECT_FALSE(binding.Test(pattern, "/books/1"));
+  EXPECT_FALSE(binding.Test(pattern, "/books/1", "not a url"));
+  EXPECT_TRUE(binding.Call(pattern, "exec", binding.Str("/books/1"))
+                  ->IsNull());
+
+  // An object of components is matched as it is, without being parsed.
+  EXPECT_TRUE(binding
+                  .Call(pattern, "test",
+                        binding.Init({{"pathname", "/books/7"}}))
+                  ->IsTrue());
+  EXPECT_FALSE(binding
+                   .Call(pattern, "test",
+                         binding.Init({{"pathname", "/books"}}))
+                   ->IsTrue());
+}
+
+TEST_F(URLPatternTest, IgnoreCase) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> exact = binding.New({{"pathname", "/Books/:id"}});
+  Local<Object> ignore_case =
+      binding.New({{"pathname", "/Books/:id"}}, true);
+  ASSERT_FALSE(exact.IsEmpty());
+  ASSERT_FALSE(ignore_case.IsEmpty());
+  EXPECT_FALSE(binding.Test(exact, "https://example.com/books/1"));
+  EXPECT_TRUE(binding.Test(exact, "https://example.com/Books/1"));
+  EXPECT_TRUE(binding.Test(ignore_case, "https://example.com/books/1"));
+  EXPECT_TRUE(binding.Test(ignore_case, "https://example.com/BOOKS/1"));
+
+  // Patterns without groups are compared as strings unless the case is
+  // ignored.
+  Local<Object> literal = binding.New({{"pathname", "/About"}}, true);
+  ASSERT_FALSE(literal.IsEmpty());
+  EXPECT_TRUE(binding.Test(literal, "https://example.com/about"));
+}
+
+TEST_F(URLPatternTest, InvalidPatterns) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  for (const char* source : {"/:id(",
+                             "/:id(\\d+",
+                             "/:(\\d+)x",
+                             "/:",
+                             "/(a(b))",
+                             "/()",
+                             "/{a{b}}",
+                             "/{:a:b}",
+                             "/{a",
+                             "/a\\"}) {
+    TryCatch try_catch(isolate_);
+    EXPECT_TRUE(binding.New({{"pathname", source}}).IsEmpty()) << source;
+    EXPECT_TRUE(try_catch.HasCaught()) << source;
+  }
+
+  // Non-capturing groups keep the indices of the named groups.
+  TryCatch try_catch(isolate_);
+  Local<Object> pattern = binding.New({{"pathname", "/:id((?:a|b)+)"}});
+  ASSERT_FALSE(pattern.IsEmpty());
+  EXPECT_FALSE(try_catch.HasCaught());
+  EXPECT_EQ(binding.Group(pattern, "https://example.com/abba", "pathname",
+                          "id"),
+            "abba");
+}
+
+TEST_F(URLPatternTest, List) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+  Env env{handle_scope, argv, node::EnvironmentFlags::kNoBrowserGlobals};
+  Binding binding((*env)->context());
+
+  Local<Object> list = binding.NewList({
+      binding.New({{"pathname", "/books/new"}}),
+      binding.New({{"pathname", "/books/:id(\\d+)"}}),
+      binding.New({{"hostname", "api.example.com"}, {"pathname", "/*"}}),
+      binding.New({{"pathname", "/books/:slug"}}),
+  });
+  ASSERT_FALSE(list.IsEmpty());
+
+  // The first pattern that matches wins, in the order of the list.
+  EXPECT_EQ(binding.Match(list, "https://example.com/books/new"), 0);
+  EXPECT_EQ(binding.Match(list, "https://example.com/books/12"), 1);
+  EXPECT_EQ(binding.Match(list, "https://api.example.com/books/12"), 1);
+  EXPECT_EQ(binding.Match(list, "https://api.example.com/authors"), 2);
+  EXPECT_EQ(binding.Match(list, "https://example.com/books/dune"), 3);
+  EXPECT_EQ(binding.Match(list, "https://example.com/authors"), -1);
+  EXPECT_EQ(binding.Match(list, "not a url"), -1);
+
+  // The result is the exec() result of the pattern that matched.
+  Local<Value> result =
+      binding.Call(list, "match", binding.Str("https://example.com/books/12"));
+  ASSERT_TRUE(result->IsArray());
+  Local<Object> exec =
+      binding.Get(result.As<Object>(), "1").As<Object>();
+  Local<Object> pathname = binding.Get(exec, "pathname").As<Object>();
+  EXPECT_EQ(
+      binding.GetString(binding.Get(pathname, "groups").As<Object>(), "id"),
+      "12");
+  EXPECT_EQ(binding.GetString(binding.Get(exec, "inputs").As<Object>(), "0"),
+            "https://example.com/books/12");
+
+  // Every pattern is compared against the same input, whichever component
+  // ruled out the previous ones.
+  Local<Object> components = binding.NewList({
+      binding.New({{"protocol", "http"}}),
+      binding.New({{"search", "q=:q"}}),
+      binding.New({{"hash", "top"}}),
+  });
+  ASSERT_FALSE(components.IsEmpty());
+  EXPECT_EQ(binding.Match(components, "https://example.com/?q=1#top"), 1);
+  EXPECT_EQ(binding.Match(components, "https://example.com/#top"), 2);
+  EXPECT_EQ(binding.Match(components, "http://example.com/#top"), 0);
+
+  Local<Object> empty = binding.NewList({});
+  ASSERT_FALSE(empty.IsEmpty());
+  EXPECT_EQ(binding.Match(empty, "https://example.com/"), -1);
+
+  TryCatch try_catch(isolate_);
+  EXPECT_TRUE(binding.NewList({binding.Str("/books/:id")}).IsEmpty());
+  EXPECT_TRUE(try_catch.HasCaught());
+}
@@ -26,6 +26,19 @@ using v8::Value;
 static int RunNodeInstance(MultiIsolatePlatform* platform,
                            const std::vector<std::string>& args,
                            const std::vector<std::string>& exec_args);
+static int RunRequests(MultiIsolatePlatform* platform,
+                       const node::EmbedderSnapshotData* snapshot,
+                       const std::vector<std::string>& args,
+                       const std::vector<std::string>& exec_args,
+                       int requests,
+                       bool print_setup_time);
+
+static const char kMainScript[] =
+    "const publicRequire = require('module').createRequire(process.cwd() "
+    "+ '/');"
+    "globalThis.require = publicRequire;"
+    "globalThis.embedVars = { nön_ascıı: '🏳️‍🌈' };"
+    "require('vm').runInThisContext(process.argv[1]);";
 
 NODE_MAIN(int argc, node::argv_type raw_argv[]) {
   char** argv = nullptr;
@@ -84,6 +97,11 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
   //           arg1 arg2...
   // No snapshot:
   // embedtest arg1 arg2...
+  // Running the script once per Environment on a reused isolate, with or
+  // without a snapshot:
+  // embedtest --embedder-requests count
+  //           [--embedder-print-setup-time]
+  //           arg1 arg2...
   node::EmbedderSnapshotData::Pointer snapshot;
 
   std::string binary_path = args[0];
@@ -92,6 +110,8 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
   bool snapshot_as_file = false;
   std::optional<node::SnapshotConfig> snapshot_config;
   std::string snapshot_blob_path;
+  int requests = 0;
+  bool print_setup_time = false;
   for (size_t i = 0; i < args.size(); ++i) {
     const std::string& arg = args[i];
     if (arg == "--embedder-snapshot-create") {
@@ -109,6 +129,13 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
       assert(i + 1 < args.size());
       snapshot_blob_path = args[i + 1];
       i++;
+    } else if (arg == "--embedder-requests") {
+      assert(i + 1 < args.size());
+      requests = std::stoi(args[i + 1]);
+      assert(requests > 0);
+      i++;
+    } else if (arg == "--embedder-print-setup-time") {
+      print_setup_time = true;
     } else {
       filtered_args.push_back(arg);
     }
@@ -137,6 +164,16 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
     assert(ret == 0);
   }
 
+  if (requests > 0) {
+    assert(!is_building_snapshot);
+    return RunRequests(platform,
+                       snapshot.get(),
+                       filtered_args,
+                       exec_args,
+                       requests,
+                       print_setup_time);
+  }
+
   if (is_building_snapshot) {
     // It contains at least the binary path, the code to snapshot,
     // and --embedder-snapshot-create (which is filtered, so at least
@@ -194,13 +231,7 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
           "globalThis.require = require;"
           "require('vm').runInThisContext(process.argv[2]);");
     } else {
-      loadenv_ret = node::LoadEnvironment(
-          env,
-          "const publicRequire = require('module').createRequire(process.cwd() "
-          "+ '/');"
-          "globalThis.require = publicRequire;"
-          "globalThis.embedVars = { nön_ascıı: '🏳️‍🌈' };"
-          "require('vm').runInThisContext(process.argv[1]);");
+      loadenv_ret = node::LoadEnvironment(env, kMainScript);
     }
 
     if (loadenv_ret.IsEmpty())  // There has been a JS exception.
@@ -230,3 +261,76 @@ int RunNodeInstance(MultiIsolatePlatform* platform,
 
   return exit_code;
 }
+
+// Runs the script once per request, each time in a new Environment. The
+// isolates come from a pool, so only the first request pays for creating
+// one. With --embedder-print-setup-time, the average time it took to get a
+// ready Environment per request is printed to stderr.
+int RunRequests(MultiIsolatePlatform* platform,
+                const node::EmbedderSnapshotData* snapshot,
+                const std::vector<std::string>& args,
+                const std::vector<std::string>& exec_args,
+                int requests,
+                bool print_setup_time) {
+  node::CommonEnvironmentSetupPool pool(
+      1,
+      [&](std::vector<std::string>* errors) {
+        if (snapshot != nullptr) {
+          return CommonEnvironmentSetup::CreateFromSnapshot(
+              platform, errors, snapshot, args, exec_args);
+        }
+        return CommonEnvironmentSetup::Create(
+            platform, errors, args, exec_args);
+      },
+      [&](CommonEnvironmentSetup* setup, std::vector<std::string>* errors) {
+        return setup->RecreateEnvironment(errors, args, exec_args);
+      });
+
+  int exit_code = 0;
+  uint64_t setup_time = 0;
+  for (int i = 0; i < requests && exit_code == 0; i++) {
+    uint64_t start = uv_hrtime();
+    std::vector<std::string> errors;
+    std::unique_ptr<CommonEnvironmentSetup> setup = pool.Acquire(&errors);
+    if (!setup) {
+      for (const std::string& err : errors)
+        fprintf(stderr, "%s: %s\n", args[0].c_str(), err.c_str());
+      return 1;
+    }
+    setup_time += uv_hrtime() - start;
+
+    Isolate* isolate = setup->isolate();
+    Environment* env = setup->env();
+    {
+      Locker locker(isolate);
+      Isolate::Scope isolate_scope(isolate);
+      HandleScope handle_scope(isolate);
+      Context::Scope context_scope(setup->context());
+
+      MaybeLocal<Value> loadenv_ret;
+      if (snapshot != nullptr) {
+        loadenv_ret =
+            node::LoadEnvironment(env, node::StartExecutionCallback{});
+      } else {
+        loadenv_ret = node::LoadEnvironment(env, kMainScript);
+      }
+      if (loadenv_ret.IsEmpty())  // There has been a JS exception.
+        exit_code = 1;
+      else
+        exit_code = node::SpinEventLoop(env).FromMaybe(1);
+    }
+    node::Stop(env);
+
+    // The next Environment is created when the setup goes back to the pool.
+    start = uv_hrtime();
+    pool.Release(std::move(setup));
+    setup_time += uv_hrtime() - start;
+  }
+
+  if (print_setup_time) {
+    fprintf(stderr,
+            "setup: %.1f us per request\n",
+            setup_time / 1e3 / requests);
+  }
+  return exit_code;
+}
@@ -153,6 +153,22 @@ for (const extraSnapshotArgs of [
     { cwd: tmpdir.path });
 }
 
+// Run one Environment per request on a reused isolate. Every request gets
+// a fresh context, so globals do not leak from one request to the next.
+spawnSyncAndAssert(
+  binary,
+  [
+    '--',
+    'globalThis.count = (globalThis.count ?? 0) + 1; console.log(count)',
+    '--embedder-requests', '3',
+    '--embedder-print-setup-time',
+  ],
+  {
+    trim: true,
+    stdout: '1\n1\n1',
+    stderr: /setup: [\d.]+ us per request/,
+  });
+
 // Guarantee NODE_REPL_EXTERNAL_MODULE won't bypass kDisableNodeOptionsEnv
 {
   spawnSyncAndExit(
@@ -0,0 +1,42 @@
+#include "aliased_buffer-inl.h"
+#include "microbench.h"
+#include "node_test_fixture.h"
+#include "v8.h"
+
+using node::AliasedFloat64Array;
+using node::AliasedUint32Array;
+
+class AliasedBufferBenchmark : public NodeTestFixture {};
+
+// Bindings share their state with JavaScript through AliasedBuffers, and
+// write to them on hot paths such as the stream and timer state.
+BENCHMARK_F(AliasedBufferBenchmark, WriteUint32) {
+  v8::Isolate::Scope isolate_scope(isolate_);
+  v8::HandleScope handle_scope(isolate_);
+  v8::Local<v8::Context> context = v8::Context::New(isolate_);
+  v8::Context::Scope context_scope(context);
+
+  constexpr size_t kLength = 1024;
+  AliasedUint32Array buffer(isolate_, kLength);
+  uint32_t value = 0;
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < kLength; i++) buffer[i] = value++;
+  }
+  microbench::DoNotOptimize(buffer[0]);
+  state.SetItemsProcessed(state.iterations() * kLength);
+}
+
+BENCHMARK_F(AliasedBufferBenchmark, IncrementFloat64) {
+  v8::Isolate::Scope isolate_scope(isolate_);
+  v8::HandleScope handle_scope(isolate_);
+  v8::Local<v8::Context> context = v8::Context::New(isolate_);
+  v8::Context::Scope context_scope(context);
+
+  constexpr size_t kLength = 16;
+  AliasedFloat64Array buffer(isolate_, kLength);
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < kLength; i++) buffer[i] += 1;
+  }
+  microbench::DoNotOptimize(buffer[0]);
+  state.SetItemsProcessed(state.iterations() * kLength);
+}
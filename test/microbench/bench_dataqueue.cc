@@ -0,0 +1,76 @@
+#include <dataqueue/queue.h>
+#include <node_bob-inl.h>
+#include <util-inl.h>
+#include <v8.h>
+#include <memory>
+#include <vector>
+#include "microbench.h"
+
+using node::DataQueue;
+using v8::ArrayBuffer;
+using v8::BackingStore;
+
+namespace {
+constexpr size_t kEntries = 16;
+constexpr size_t kEntrySize = 4096;
+
+// Reads everything from |reader|, which only has in-memory entries and
+// therefore completes synchronously. Returns the number of bytes read.
+size_t ReadAll(const std::shared_ptr<DataQueue::Reader>& reader) {
+  size_t total = 0;
+  int status;
+  do {
+    status = reader->Pull(
+        [&](int status, const DataQueue::Vec* vecs, size_t count, auto done) {
+          for (size_t i = 0; i < count; i++) total += vecs[i].len;
+          std::move(done)(0);
+        },
+        node::bob::OPTIONS_SYNC,
+        nullptr,
+        0,
+        node::bob::kMaxCountHint);
+  } while (status == node::bob::STATUS_CONTINUE);
+  CHECK_EQ(status, node::bob::STATUS_EOS);
+  return total;
+}
+}  // anonymous namespace
+
+// Blobs are idempotent DataQueues that are read once per stream() or
+// arrayBuffer() call.
+BENCHMARK(DataQueue, ReadIdempotent) {
+  static char buffer[kEntrySize];
+  std::shared_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+      buffer, sizeof(buffer), [](void*, size_t, void*) {}, nullptr);
+  std::vector<std::unique_ptr<DataQueue::Entry>> list;
+  for (size_t i = 0; i < kEntries; i++) {
+    list.push_back(
+        DataQueue::CreateInMemoryEntryFromBackingStore(store, 0, kEntrySize));
+  }
+  std::shared_ptr<DataQueue> data_queue =
+      DataQueue::CreateIdempotent(std::move(list));
+  CHECK_NOT_NULL(data_queue);
+
+  size_t total = 0;
+  while (state.KeepRunning()) {
+    total += ReadAll(data_queue->get_reader());
+  }
+  state.SetBytesProcessed(total);
+}
+
+BENCHMARK(DataQueue, AppendAndRead) {
+  static char buffer[kEntrySize];
+  std::shared_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+      buffer, sizeof(buffer), [](void*, size_t, void*) {}, nullptr);
+
+  size_t total = 0;
+  while (state.KeepRunning()) {
+    std::shared_ptr<DataQueue> data_queue = DataQueue::Create();
+    for (size_t i = 0; i < kEntries; i++) {
+      data_queue->append(
+          DataQueue::CreateInMemoryEntryFromBackingStore(store, 0, kEntrySize));
+    }
+    data_queue->cap();
+    total += ReadAll(data_queue->get_reader());
+  }
+  state.SetBytesProcessed(total);
+}
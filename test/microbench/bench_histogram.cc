@@ -0,0 +1,33 @@
+#include "histogram-inl.h"
+#include "microbench.h"
+
+using node::Histogram;
+
+// perf_hooks records every event loop delay and timerify() call.
+BENCHMARK(Histogram, Record) {
+  Histogram histogram(Histogram::Options{});
+  int64_t value = 1;
+  while (state.KeepRunning()) {
+    histogram.Record(value);
+    value = value * 7 % 1000003;
+  }
+}
+
+BENCHMARK(Histogram, RecordConcurrent) {
+  Histogram::Options options;
+  options.concurrent = true;
+  Histogram histogram(options);
+  int64_t value = 1;
+  while (state.KeepRunning()) {
+    histogram.Record(value);
+    value = value * 7 % 1000003;
+  }
+}
+
+BENCHMARK(Histogram, Percentile) {
+  Histogram histogram(Histogram::Options{});
+  for (int64_t i = 1; i <= 100000; i++) histogram.Record(i);
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(histogram.Percentile(99));
+  }
+}
@@ -0,0 +1,42 @@
+#include <string>
+#include "microbench.h"
+#include "permission/fs_permission.h"
+
+using node::permission::FSPermission;
+
+namespace {
+void InsertPaths(FSPermission::RadixTree* tree) {
+  for (int i = 0; i < 256; i++) {
+    tree->Insert("/home/user/project-" + std::to_string(i) + "/src/*");
+  }
+  tree->Insert("/usr/lib/node_modules/*");
+  tree->Insert("/tmp/*");
+}
+}  // anonymous namespace
+
+// Every fs call is checked against the tree when the permission model is
+// enabled.
+BENCHMARK(RadixTree, LookupGranted) {
+  FSPermission::RadixTree tree;
+  InsertPaths(&tree);
+  const std::string path = "/home/user/project-128/src/lib/index.js";
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(tree.Lookup(path, true));
+  }
+}
+
+BENCHMARK(RadixTree, LookupDenied) {
+  FSPermission::RadixTree tree;
+  InsertPaths(&tree);
+  const std::string path = "/home/user/other/src/lib/index.js";
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(tree.Lookup(path, true));
+  }
+}
+
+BENCHMARK(RadixTree, Insert) {
+  while (state.KeepRunning()) {
+    FSPermission::RadixTree tree;
+    InsertPaths(&tree);
+  }
+}
@@ -0,0 +1,55 @@
+#include <memory>
+#include <string>
+#include "microbench.h"
+#include "node_sockaddr-inl.h"
+
+using node::SocketAddress;
+using node::SocketAddressBlockList;
+
+namespace {
+std::shared_ptr<SocketAddress> MakeAddress(int family,
+                                           const char* host,
+                                           uint32_t port = 0) {
+  sockaddr_storage storage;
+  CHECK(SocketAddress::ToSockAddr(family, host, port, &storage));
+  return std::make_shared<SocketAddress>(
+      reinterpret_cast<const sockaddr*>(&storage));
+}
+}  // anonymous namespace
+
+// QUIC endpoints look up sessions and validation state by address for
+// every packet they receive.
+BENCHMARK(SocketAddress, Hash) {
+  std::shared_ptr<SocketAddress> address =
+      MakeAddress(AF_INET6, "2001:db8::1", 443);
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(SocketAddress::Hash()(*address));
+  }
+}
+
+BENCHMARK(SocketAddress, MapLookup) {
+  SocketAddress::Map<size_t> map;
+  for (size_t i = 0; i < 1024; i++) {
+    std::string host = "10.0." + std::to_string(i / 256) + "." +
+                       std::to_string(i % 256);
+    map[*MakeAddress(AF_INET, host.c_str(), 443)] = i;
+  }
+  std::shared_ptr<SocketAddress> address =
+      MakeAddress(AF_INET, "10.0.3.7", 443);
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(map.find(*address));
+  }
+}
+
+BENCHMARK(SocketAddressBlockList, Apply) {
+  SocketAddressBlockList blocklist;
+  for (int i = 0; i < 64; i++) {
+    std::string host = "192.168." + std::to_string(i) + ".0";
+    blocklist.AddSocketAddressMask(MakeAddress(AF_INET, host.c_str()), 24);
+  }
+  // Not blocked, so every rule is checked.
+  std::shared_ptr<SocketAddress> address = MakeAddress(AF_INET, "10.0.0.1");
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(blocklist.Apply(address));
+  }
+}
@@ -0,0 +1,83 @@
+#include <string>
+#include "microbench.h"
+#include "node_test_fixture.h"
+#include "string_bytes.h"
+#include "v8.h"
+
+using node::StringBytes;
+using v8::HandleScope;
+using v8::Local;
+using v8::String;
+using v8::Value;
+
+class StringBytesBenchmark : public NodeTestFixture {};
+
+namespace {
+constexpr size_t kLength = 16 * 1024;
+
+std::string MakeData() {
+  std::string data(kLength, '\0');
+  for (size_t i = 0; i < kLength; i++) data[i] = 'a' + i % 26;
+  return data;
+}
+
+// Buffer#toString() and string writes go through StringBytes.
+void BenchmarkEncode(microbench::State& state,
+                     v8::Isolate* isolate,
+                     enum node::encoding encoding) {
+  std::string data = MakeData();
+  while (state.KeepRunning()) {
+    HandleScope scope(isolate);
+    Local<Value> error;
+    microbench::DoNotOptimize(
+        StringBytes::Encode(isolate, data.data(), data.size(), encoding, &error)
+            .ToLocalChecked());
+  }
+  state.SetBytesProcessed(state.iterations() * kLength);
+}
+
+void BenchmarkWrite(microbench::State& state,
+                    v8::Isolate* isolate,
+                    enum node::encoding encoding) {
+  std::string data = MakeData();
+  Local<Value> string =
+      String::NewFromUtf8(isolate, data.data(), v8::NewStringType::kNormal,
+                          data.size())
+          .ToLocalChecked();
+  if (encoding != node::UTF8) {
+    Local<Value> error;
+    string =
+        StringBytes::Encode(isolate, data.data(), data.size(), encoding, &error)
+            .ToLocalChecked();
+  }
+  std::string out(StringBytes::Size(isolate, string, encoding).FromJust(),
+                  '\0');
+  while (state.KeepRunning()) {
+    microbench::DoNotOptimize(
+        StringBytes::Write(isolate, out.data(), out.size(), string, encoding));
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+}  // anonymous namespace
+
+#define STRING_BYTES_BENCHMARKS(V)                                             \
+  V(Utf8, UTF8)                                                                \
+  V(Latin1, LATIN1)                                                            \
+  V(Hex, HEX)                                                                  \
+  V(Base64, BASE64)
+
+#define V(name, encoding)                                                      \
+  BENCHMARK_F(StringBytesBenchmark, Encode##name) {                            \
+    v8::Isolate::Scope isolate_scope(isolate_);                                \
+    HandleScope handle_scope(isolate_);                                        \
+    v8::Context::Scope context_scope(v8::Context::New(isolate_));              \
+    BenchmarkEncode(state, isolate_, node::encoding);                          \
+  }                                                                            \
+  BENCHMARK_F(StringBytesBenchmark, Write##name) {                             \
+    v8::Isolate::Scope isolate_scope(isolate_);                                \
+    HandleScope handle_scope(isolate_);                                        \
+    v8::Context::Scope context_scope(v8::Context::New(isolate_));              \
+    BenchmarkWrite(state, isolate_, node::encoding);                           \
+  }
+STRING_BYTES_BENCHMARKS(V)
+#undef V
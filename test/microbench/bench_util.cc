@@ -0,0 +1,65 @@
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "cleanup_queue-inl.h"
+#include "microbench.h"
+#include "node_mutex.h"
+#include "node_threadsafe_cow.h"
+#include "node_threadsafe_cow-inl.h"
+
+using node::CleanupQueue;
+using node::ThreadsafeCopyOnWrite;
+
+namespace {
+void Noop(void* arg) {}
+}  // anonymous namespace
+
+// Environment cleanup hooks are added and removed in pairs by most
+// BaseObjects over their lifetime.
+BENCHMARK(CleanupQueue, AddRemove) {
+  CleanupQueue queue;
+  std::vector<int> args(1024);
+  while (state.KeepRunning()) {
+    for (int& arg : args) queue.Add(Noop, &arg);
+    for (int& arg : args) queue.Remove(Noop, &arg);
+  }
+  state.SetItemsProcessed(state.iterations() * args.size());
+}
+
+BENCHMARK(CleanupQueue, Drain) {
+  CleanupQueue queue;
+  std::vector<int> args(1024);
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    for (int& arg : args) queue.Add(Noop, &arg);
+    state.ResumeTiming();
+    queue.Drain();
+  }
+  state.SetItemsProcessed(state.iterations() * args.size());
+}
+
+using StringMap = std::unordered_map<std::string, std::string>;
+
+// The builtin sources are read through a ThreadsafeCopyOnWrite by every
+// worker that loads a builtin.
+BENCHMARK(ThreadsafeCopyOnWrite, Read) {
+  ThreadsafeCopyOnWrite<StringMap> cow;
+  cow.write()->emplace("fs", "source");
+  while (state.KeepRunning()) {
+    auto read = cow.read();
+    microbench::DoNotOptimize(read->find("fs"));
+  }
+}
+
+BENCHMARK(ThreadsafeCopyOnWrite, CopyAndWrite) {
+  ThreadsafeCopyOnWrite<StringMap> cow;
+  for (int i = 0; i < 64; i++) {
+    cow.write()->emplace(std::to_string(i), "source");
+  }
+  while (state.KeepRunning()) {
+    // The copy shares the data until it is written to.
+    ThreadsafeCopyOnWrite<StringMap> copy(std::as_const(cow));
+    copy.write()->emplace("fs", "source");
+  }
+}
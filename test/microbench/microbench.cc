@@ -0,0 +1,116 @@
+#include "microbench.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "uv.h"
+
+namespace microbench {
+
+namespace {
+
+uint64_t GetEnvUint(const char* name, uint64_t default_value) {
+  const char* value = getenv(name);
+  if (value == nullptr || *value == '\0') return default_value;
+  char* end;
+  uint64_t result = strtoull(value, &end, 10);
+  return *end == '\0' && result > 0 ? result : default_value;
+}
+
+constexpr uint64_t kMaxIterations = 1000000000;
+
+struct Result {
+  uint64_t iterations;
+  uint64_t elapsed_ns;
+  uint64_t bytes_processed;
+  uint64_t items_processed;
+
+  double ns_per_op() const {
+    return static_cast<double>(elapsed_ns) / iterations;
+  }
+};
+
+Result RunOnce(const std::function<void(State&)>& fn, uint64_t iterations) {
+  State state(iterations);
+  fn(state);
+  // The body has to run the loop to completion.
+  EXPECT_EQ(state.iterations(), iterations);
+  return Result{std::max<uint64_t>(state.iterations(), 1),
+                state.elapsed_ns(),
+                state.bytes_processed(),
+                state.items_processed()};
+}
+
+}  // anonymous namespace
+
+State::State(uint64_t max_iterations) : max_iterations_(max_iterations) {}
+
+void State::PauseTiming() {
+  if (!running_) return;
+  elapsed_ns_ += uv_hrtime() - start_ns_;
+  running_ = false;
+}
+
+void State::ResumeTiming() {
+  if (running_) return;
+  running_ = true;
+  start_ns_ = uv_hrtime();
+}
+
+void Run(const char* name, const std::function<void(State&)>& fn) {
+  const uint64_t min_time_ns =
+      GetEnvUint("NODE_MICROBENCH_MIN_TIME", 100) * 1000000;
+  const uint64_t repetitions = GetEnvUint("NODE_MICROBENCH_REPETITIONS", 3);
+
+  // Grow the number of iterations until a run is long enough to measure,
+  // predicting the count from the last run like Google Benchmark does.
+  uint64_t iterations = 1;
+  Result result = RunOnce(fn, iterations);
+  while (result.elapsed_ns < min_time_ns && iterations < kMaxIterations) {
+    double multiplier =
+        result.elapsed_ns == 0
+            ? 10
+            : 1.4 * min_time_ns / static_cast<double>(result.elapsed_ns);
+    multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+    iterations = std::min<uint64_t>(iterations * multiplier, kMaxIterations);
+    result = RunOnce(fn, iterations);
+  }
+
+  std::vector<Result> results{result};
+  while (results.size() < repetitions) {
+    results.push_back(RunOnce(fn, iterations));
+  }
+  std::sort(results.begin(), results.end(), [](const auto& a, const auto& b) {
+    return a.ns_per_op() < b.ns_per_op();
+  });
+  const Result& median = results[results.size() / 2];
+
+  double seconds = median.elapsed_ns / 1e9;
+  double ns_per_op = median.ns_per_op();
+  ::testing::Test::RecordProperty("iterations",
+                                  static_cast<int>(std::min<uint64_t>(
+                                      median.iterations, INT32_MAX)));
+  ::testing::Test::RecordProperty("ns_per_op", std::to_string(ns_per_op));
+  printf("[ BENCH    ] %-48s %14.2f ns/op %12" PRIu64 " iterations",
+         name,
+         ns_per_op,
+         median.iterations);
+  if (median.bytes_processed > 0 && seconds > 0) {
+    double bytes_per_second = median.bytes_processed / seconds;
+    ::testing::Test::RecordProperty("bytes_per_second",
+                                    std::to_string(bytes_per_second));
+    printf(" %10.2f MB/s", bytes_per_second / (1024 * 1024));
+  }
+  if (median.items_processed > 0 && seconds > 0) {
+    double items_per_second = median.items_processed / seconds;
+    ::testing::Test::RecordProperty("items_per_second",
+                                    std::to_string(items_per_second));
+    printf(" %14.0f items/s", items_per_second);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+}  // namespace microbench
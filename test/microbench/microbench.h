@@ -0,0 +1,112 @@
+#ifndef TEST_MICROBENCH_MICROBENCH_H_
+#define TEST_MICROBENCH_MICROBENCH_H_
+
+#include <cstdint>
+#include <functional>
+#include "gtest/gtest.h"
+
+// A small harness for benchmarking the C++ internals of Node.js, in the
+// style of Google Benchmark, that runs on top of googletest so that the
+// fixtures of test/cctest can be reused.
+//
+//   BENCHMARK(SocketAddress, Hash) {
+//     SocketAddress addr = ...;
+//     while (state.KeepRunning()) {
+//       microbench::DoNotOptimize(SocketAddress::Hash()(addr));
+//     }
+//   }
+//
+// Each benchmark is a test, so --gtest_filter selects them. The number of
+// iterations is raised until a run takes at least NODE_MICROBENCH_MIN_TIME
+// milliseconds (100 by default), and the median of
+// NODE_MICROBENCH_REPETITIONS runs (3 by default) is reported. The results
+// are printed, and recorded as test properties, so that
+// --gtest_output=json:<file> produces a machine-readable report.
+
+namespace microbench {
+
+class State {
+ public:
+  explicit State(uint64_t max_iterations);
+
+  // Starts the timer on the first call. Returns false, with the timer
+  // stopped, once max_iterations iterations have run.
+  inline bool KeepRunning() {
+    if (!started_) {
+      started_ = true;
+      ResumeTiming();
+    }
+    if (iterations_ < max_iterations_) {
+      iterations_++;
+      return true;
+    }
+    PauseTiming();
+    return false;
+  }
+
+  // Excludes setup done inside the loop from the measurement.
+  void PauseTiming();
+  void ResumeTiming();
+
+  // Reported as throughput, per second, when set.
+  void SetBytesProcessed(uint64_t bytes) { bytes_processed_ = bytes; }
+  void SetItemsProcessed(uint64_t items) { items_processed_ = items; }
+
+  uint64_t max_iterations() const { return max_iterations_; }
+  uint64_t iterations() const { return iterations_; }
+  uint64_t elapsed_ns() const { return elapsed_ns_; }
+  uint64_t bytes_processed() const { return bytes_processed_; }
+  uint64_t items_processed() const { return items_processed_; }
+
+ private:
+  const uint64_t max_iterations_;
+  uint64_t iterations_ = 0;
+  bool started_ = false;
+  bool running_ = false;
+  uint64_t start_ns_ = 0;
+  uint64_t elapsed_ns_ = 0;
+  uint64_t bytes_processed_ = 0;
+  uint64_t items_processed_ = 0;
+};
+
+// Runs |fn| as the benchmark |name|. Must be called from a test.
+void Run(const char* name, const std::function<void(State&)>& fn);
+
+// Keeps the compiler from optimizing away the computation of |value|.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+}  // namespace microbench
+
+#define MICROBENCH_BODY_(suite, name) suite##_##name##_Benchmark
+
+// Defines a benchmark without a fixture.
+#define BENCHMARK(suite, name)                                                 \
+  static void MICROBENCH_BODY_(suite, name)(::microbench::State & state);      \
+  TEST(suite, name) {                                                          \
+    ::microbench::Run(#suite "." #name, MICROBENCH_BODY_(suite, name));       \
+  }                                                                            \
+  static void MICROBENCH_BODY_(suite, name)(::microbench::State & state)
+
+// Defines a benchmark that runs in a test fixture, such as the
+// NodeTestFixture of test/cctest. The body can use the members of the
+// fixture.
+#define BENCHMARK_F(fixture, name)                                             \
+  class MICROBENCH_BODY_(fixture, name) : public fixture {                     \
+   public:                                                                     \
+    void Body(::microbench::State& state);                                     \
+  };                                                                           \
+  TEST_F(MICROBENCH_BODY_(fixture, name), name) {                              \
+    ::microbench::Run(#fixture "." #name,                                      \
+                      [this](::microbench::State& state) { Body(state); });    \
+  }                                                                            \
+  void MICROBENCH_BODY_(fixture, name)::Body(::microbench::State& state)
+
+#endif  // TEST_MICROBENCH_MICROBENCH_H_